@@ -0,0 +1,57 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/log.h>
+
+#include <tracy/Tracy.hpp>
+
+#include <chrono>
+
+namespace app {
+
+/// Logs the time spent in a stage of the boot once it is finished or goes out of scope
+class BootStageTimer {
+public:
+    explicit BootStageTimer(const char *name)
+        : name(name)
+        , start(std::chrono::steady_clock::now()) {}
+
+    ~BootStageTimer() {
+        finish();
+    }
+
+    void finish() {
+        if (!name)
+            return;
+        const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+        LOG_INFO("Boot stage {} done in {:.1f} ms", name, duration.count());
+        name = nullptr;
+    }
+
+private:
+    const char *name;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace app
+
+// Tracy - Track a boot stage until the end of the scope, its duration is also logged
+#define BOOT_STAGE(name)         \
+    ZoneScopedNC(name, 0x4CAF50); \
+    const app::BootStageTimer ___boot_stage_timer(name)
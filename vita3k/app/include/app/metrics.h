@@ -0,0 +1,32 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+struct EmuEnvState;
+
+namespace app {
+
+// Metrics of a session, sampled every second from the counters of the performance overlay.
+// The samples are written to a CSV file as they are taken and to a JSON file with a summary of the session
+// once it ends, both in the log folder, so sessions of many runs can be compared.
+void start_metrics(EmuEnvState &emuenv);
+// Called by the renderer thread after every frame, takes a sample once a second has passed
+void sample_metrics(EmuEnvState &emuenv);
+void stop_metrics(EmuEnvState &emuenv);
+
+} // namespace app
@@ -15,16 +15,20 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <app/boot_profile.h>
 #include <app/functions.h>
+#include <app/metrics.h>
 
 #include <audio/state.h>
 #include <config/functions.h>
 #include <config/state.h>
 #include <config/version.h>
+#include <ctrl/state.h>
 #include <display/state.h>
 #include <emuenv/state.h>
 #include <gui/imgui_impl_sdl.h>
 #include <io/functions.h>
+#include <kernel/import_profiler.h>
 #include <kernel/state.h>
 #include <ngs/state.h>
 #include <renderer/state.h>
@@ -32,6 +36,7 @@
 #include <nids/functions.h>
 #include <renderer/functions.h>
 #include <rtc/rtc.h>
+#include <util/alloc_tracker.h>
 #include <util/fs.h>
 #include <util/lock_and_find.h>
 #include <util/log.h>
@@ -50,6 +55,9 @@
 #include <SDL_video.h>
 #include <SDL_vulkan.h>
 
+#include <algorithm>
+#include <future>
+
 namespace app {
 void update_viewport(EmuEnvState &state) {
     int w = 0;
@@ -64,6 +72,10 @@ void update_viewport(EmuEnvState &state) {
         SDL_Vulkan_GetDrawableSize(state.window.get(), &w, &h);
         break;
 
+    case renderer::Backend::Null:
+        SDL_GetWindowSize(state.window.get(), &w, &h);
+        break;
+
     default:
         LOG_ERROR("Unimplemented backend render: {}.", static_cast<int>(state.renderer->current_backend));
         break;
@@ -225,6 +237,8 @@ bool init(EmuEnvState &state, Config &cfg, const Root &root_paths) {
 #endif
     LOG_INFO("User pref path: {}", state.pref_path.string());
 
+    alloc_tracker::set_enabled(state.cfg.track_host_allocations);
+
     if (ImGui::GetCurrentContext() == NULL) {
         ImGui::CreateContext();
     }
@@ -240,6 +254,8 @@ bool init(EmuEnvState &state, Config &cfg, const Root &root_paths) {
         state.cfg.backend_renderer = "Vulkan";
         config::serialize_config(state.cfg, state.cfg.config_path);
 #endif
+    } else if (string_utils::toupper(state.cfg.backend_renderer) == "NULL") {
+        state.backend_renderer = renderer::Backend::Null;
     }
 
     int window_type = 0;
@@ -252,6 +268,10 @@ bool init(EmuEnvState &state, Config &cfg, const Root &root_paths) {
         window_type = SDL_WINDOW_VULKAN;
         break;
 
+    case renderer::Backend::Null:
+        window_type = SDL_WINDOW_HIDDEN;
+        break;
+
     default:
         LOG_ERROR("Unimplemented backend render: {}.", state.cfg.backend_renderer);
         break;
@@ -285,15 +305,25 @@ bool init(EmuEnvState &state, Config &cfg, const Root &root_paths) {
 #endif
     state.res_width_dpi_scale = static_cast<uint32_t>(DEFAULT_RES_WIDTH * state.dpi_scale);
     state.res_height_dpi_scale = static_cast<uint32_t>(DEFAULT_RES_HEIGHT * state.dpi_scale);
-    state.window = WindowPtr(SDL_CreateWindow(window_title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, state.res_width_dpi_scale, state.res_height_dpi_scale, window_type | SDL_WINDOW_RESIZABLE), SDL_DestroyWindow);
+    {
+        BOOT_STAGE("Window creation");
+        state.window = WindowPtr(SDL_CreateWindow(window_title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, state.res_width_dpi_scale, state.res_height_dpi_scale, window_type | SDL_WINDOW_RESIZABLE), SDL_DestroyWindow);
+    }
 
     if (!state.window) {
         LOG_ERROR("SDL failed to create window!");
         return false;
     }
 
+    // the file system only creates folders, it is initialized while the renderer, which must stay on this thread, is created
+    auto io_init = std::async(std::launch::async, [&state]() {
+        BOOT_STAGE("IO init");
+        return init(state.io, state.cache_path, state.log_path, state.pref_path, state.cfg.console);
+    });
+
     // initialize the renderer first because we need to know if we need a page table
     if (!state.cfg.console) {
+        BOOT_STAGE("Renderer init");
         if (renderer::init(state.window.get(), state.renderer, state.backend_renderer, state.cfg, root_paths)) {
             update_viewport(state);
         } else {
@@ -314,7 +344,7 @@ bool init(EmuEnvState &state, Config &cfg, const Root &root_paths) {
         }
     }
 
-    if (!init(state.io, state.cache_path, state.log_path, state.pref_path, state.cfg.console)) {
+    if (!io_init.get()) {
         LOG_ERROR("Failed to initialize file system for the emulator!");
         return false;
     }
@@ -329,17 +359,7 @@ bool init(EmuEnvState &state, Config &cfg, const Root &root_paths) {
 }
 
 bool late_init(EmuEnvState &state) {
-    // note: mem is not initialized yet but that's not an issue
-    // the renderer is not using it yet, just storing it for later uses
-    state.renderer->late_init(state.cfg, state.app_path, state.mem);
-
-    if (!init(state.mem, state.renderer->need_page_table)) {
-        LOG_ERROR("Failed to initialize memory for emulator state!");
-        return false;
-    }
-
-    if (state.mem.use_page_table && state.kernel.cpu_backend == CPUBackend::Unicorn)
-        LOG_CRITICAL("Unicorn backend is not supported with a page table");
+    BOOT_STAGE("Late init");
 
     const ResumeAudioThread resume_thread = [&state](SceUID thread_id) {
         const auto thread = lock_and_find(thread_id, state.kernel.threads, state.kernel.mutex);
@@ -348,15 +368,40 @@ bool late_init(EmuEnvState &state) {
             thread->update_status(ThreadStatus::run);
         }
     };
-    if (!state.audio.init(resume_thread, state.cfg.audio_backend)) {
-        LOG_WARN("Failed to initialize audio! Audio will not work.");
+    // opening the audio device can take a while and nothing else depends on it
+    auto audio_init = std::async(std::launch::async, [&state, &resume_thread]() {
+        BOOT_STAGE("Audio init");
+        state.audio.resampler_quality = static_cast<AudioResamplerQuality>(std::clamp(state.cfg.audio_resampler_quality, 0, 2));
+        return state.audio.init(resume_thread, state.cfg.audio_backend);
+    });
+
+    {
+        BOOT_STAGE("Renderer late init");
+        // note: mem is not initialized yet but that's not an issue
+        // the renderer is not using it yet, just storing it for later uses
+        state.renderer->late_init(state.cfg, state.app_path, state.mem);
     }
 
+    {
+        BOOT_STAGE("Memory init");
+        if (!init(state.mem, state.renderer->need_page_table, state.cfg.huge_pages, state.cfg.write_watch, state.cfg.merge_guest_memory)) {
+            LOG_ERROR("Failed to initialize memory for emulator state!");
+            return false;
+        }
+    }
+
+    if (state.mem.use_page_table && state.kernel.cpu_backend == CPUBackend::Unicorn)
+        LOG_CRITICAL("Unicorn backend is not supported with a page table");
+
     if (!ngs::init(state.ngs, state.mem)) {
         LOG_ERROR("Failed to initialize ngs.");
         return false;
     }
 
+    if (!audio_init.get()) {
+        LOG_WARN("Failed to initialize audio! Audio will not work.");
+    }
+
     return true;
 }
 
@@ -370,6 +415,15 @@ void destroy(EmuEnvState &emuenv, ImGui_State *imgui) {
     if (emuenv.cfg.gdbstub)
         server_close(emuenv);
 
+    dump_import_profile(emuenv.log_path / "hle_profile.csv");
+    logging::close_binary_log();
+    stop_metrics(emuenv);
+    stop_input_record(emuenv.ctrl.input_record);
+    if (emuenv.renderer) {
+        emuenv.audio.set_capture(nullptr);
+        emuenv.renderer->recorder.stop();
+    }
+
     // There may be changes that made in the GUI, so we should save, again
     if (emuenv.cfg.overwrite_config)
         config::serialize_config(emuenv.cfg, emuenv.cfg.config_path);
@@ -0,0 +1,297 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <app/metrics.h>
+
+#include <audio/state.h>
+#include <config/state.h>
+#include <display/state.h>
+#include <emuenv/state.h>
+#include <io/state.h>
+#include <kernel/state.h>
+#include <renderer/state.h>
+#include <renderer/texture_cache.h>
+#include <util/log.h>
+#include <util/safe_time.h>
+#include <util/thread_utils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <vector>
+
+namespace app {
+
+struct MetricsSample {
+    float time = 0.f;
+    float fps = 0.f;
+    float frame_time_avg = 0.f;
+    float frame_time_p50 = 0.f;
+    float frame_time_p95 = 0.f;
+    float frame_time_p99 = 0.f;
+    float frame_time_max = 0.f;
+    // cpu time in ms spent during the second
+    float renderer_cpu = 0.f;
+    float guest_cpu = 0.f;
+    uint64_t shader_compiles = 0;
+    uint64_t pipeline_compiles = 0;
+    uint64_t texture_uploads = 0;
+    uint64_t audio_underruns = 0;
+};
+
+// Counters are totals since the boot, the samples hold the difference with the previous sample
+struct MetricsCounters {
+    uint64_t shaders_compiled = 0;
+    uint64_t pipeline_compiles = 0;
+    uint64_t texture_misses = 0;
+    uint64_t audio_underruns = 0;
+    uint64_t renderer_cpu_ns = 0;
+    std::map<SceUID, uint64_t> guest_cpu_ns;
+};
+
+struct MetricsRecorder {
+    bool running = false;
+    fs::path csv_path;
+    fs::path json_path;
+    std::ofstream csv;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last_sample;
+    size_t frames_since_sample = 0;
+    thread_utils::ThreadCpuClock renderer_clock;
+    MetricsCounters counters;
+    std::vector<MetricsSample> samples;
+    // all the frame times of the session, for the percentiles of the summary
+    std::vector<float> frame_times;
+};
+
+static MetricsRecorder recorder;
+
+static const char *CSV_HEADER = "time_s,fps,frame_time_avg_ms,frame_time_p50_ms,frame_time_p95_ms,frame_time_p99_ms,frame_time_max_ms,"
+                                "renderer_cpu_ms,guest_cpu_ms,shader_compiles,pipeline_compiles,texture_uploads,audio_underruns";
+
+// the values must be sorted
+static float percentile(const std::vector<float> &values, float rank) {
+    if (values.empty())
+        return 0.f;
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(rank * static_cast<float>(values.size())));
+    return values[index];
+}
+
+static uint64_t get_audio_underruns(AudioState &audio) {
+    uint64_t underruns = 0;
+    const std::lock_guard<std::mutex> lock(audio.mutex);
+    for (const auto &[_, port] : audio.out_ports)
+        underruns += port->underruns.load(std::memory_order_relaxed);
+    return underruns;
+}
+
+// Sums the cpu time of the guest threads since the last sample, the threads which exited since then are left out
+static uint64_t get_guest_cpu_delta(KernelState &kernel, std::map<SceUID, uint64_t> &last_times) {
+    std::map<SceUID, uint64_t> times;
+    uint64_t delta = 0;
+    const std::lock_guard<std::mutex> lock(kernel.mutex);
+    for (const auto &[id, thread] : kernel.threads) {
+        uint64_t time;
+        {
+            const std::lock_guard<std::mutex> thread_lock(thread->mutex);
+            time = thread_utils::get_thread_cpu_time_ns(thread->host_cpu_clock);
+        }
+        if (time == 0)
+            continue;
+        const auto last = last_times.find(id);
+        if (last != last_times.end() && time >= last->second)
+            delta += time - last->second;
+        times.emplace(id, time);
+    }
+    last_times = std::move(times);
+    return delta;
+}
+
+// Counters which only ever grow, except the audio underruns which are lost with their port
+static uint64_t counter_delta(uint64_t now, uint64_t &last) {
+    const uint64_t delta = now >= last ? now - last : 0;
+    last = now;
+    return delta;
+}
+
+void start_metrics(EmuEnvState &emuenv) {
+    if (!emuenv.cfg.metrics_export || recorder.running)
+        return;
+
+    const std::time_t now = std::time(nullptr);
+    tm local = {};
+    SAFE_LOCALTIME(&now, &local);
+    const std::string name = fmt::format("metrics_{}_{:04}{:02}{:02}-{:02}{:02}{:02}", emuenv.io.title_id,
+        local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+    recorder.csv_path = emuenv.log_path / (name + ".csv");
+    recorder.json_path = emuenv.log_path / (name + ".json");
+
+    recorder.csv.open(recorder.csv_path.string(), std::ios::trunc);
+    if (!recorder.csv.is_open()) {
+        LOG_ERROR("Failed to create the metrics file {}", recorder.csv_path.string());
+        return;
+    }
+    recorder.csv << CSV_HEADER << '\n';
+
+    recorder.running = true;
+    recorder.start = std::chrono::steady_clock::now();
+    recorder.last_sample = recorder.start;
+    recorder.frames_since_sample = 0;
+    recorder.samples.clear();
+    recorder.frame_times.clear();
+    {
+        const std::lock_guard<std::mutex> lock(emuenv.display.frame_times_mutex);
+        emuenv.display.frame_times.clear();
+    }
+
+    // start from the current totals so the first sample only holds the first second
+    recorder.renderer_clock = thread_utils::get_current_thread_cpu_clock();
+    recorder.counters = {};
+    recorder.counters.renderer_cpu_ns = thread_utils::get_thread_cpu_time_ns(recorder.renderer_clock);
+    recorder.counters.shaders_compiled = emuenv.renderer->shaders_count_compiled;
+    recorder.counters.pipeline_compiles = emuenv.renderer->pipeline_compiles.load(std::memory_order_relaxed);
+    recorder.counters.texture_misses = emuenv.renderer->get_texture_cache()->stats.misses.load(std::memory_order_relaxed);
+    recorder.counters.audio_underruns = get_audio_underruns(emuenv.audio);
+    get_guest_cpu_delta(emuenv.kernel, recorder.counters.guest_cpu_ns);
+
+    LOG_INFO("Recording the session metrics to {}", recorder.csv_path.string());
+}
+
+void sample_metrics(EmuEnvState &emuenv) {
+    if (!recorder.running)
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    const float elapsed = std::chrono::duration<float>(now - recorder.last_sample).count();
+    if (elapsed < 1.f)
+        return;
+    recorder.last_sample = now;
+
+    std::vector<float> frame_times;
+    {
+        const std::lock_guard<std::mutex> lock(emuenv.display.frame_times_mutex);
+        frame_times.swap(emuenv.display.frame_times);
+    }
+
+    MetricsSample sample;
+    sample.time = std::chrono::duration<float>(now - recorder.start).count();
+    sample.fps = static_cast<float>(frame_times.size()) / elapsed;
+    if (!frame_times.empty()) {
+        recorder.frame_times.insert(recorder.frame_times.end(), frame_times.begin(), frame_times.end());
+        std::sort(frame_times.begin(), frame_times.end());
+        float total = 0.f;
+        for (const float frame_time : frame_times)
+            total += frame_time;
+        sample.frame_time_avg = total / static_cast<float>(frame_times.size());
+        sample.frame_time_p50 = percentile(frame_times, 0.50f);
+        sample.frame_time_p95 = percentile(frame_times, 0.95f);
+        sample.frame_time_p99 = percentile(frame_times, 0.99f);
+        sample.frame_time_max = frame_times.back();
+    }
+
+    // per second, so sessions sampled at slightly different intervals stay comparable
+    MetricsCounters &counters = recorder.counters;
+    const uint64_t renderer_ns = counter_delta(thread_utils::get_thread_cpu_time_ns(recorder.renderer_clock), counters.renderer_cpu_ns);
+    sample.renderer_cpu = static_cast<float>(renderer_ns) / 1e6f / elapsed;
+    sample.guest_cpu = static_cast<float>(get_guest_cpu_delta(emuenv.kernel, counters.guest_cpu_ns)) / 1e6f / elapsed;
+    sample.shader_compiles = counter_delta(emuenv.renderer->shaders_count_compiled, counters.shaders_compiled);
+    sample.pipeline_compiles = counter_delta(emuenv.renderer->pipeline_compiles.load(std::memory_order_relaxed), counters.pipeline_compiles);
+    // every miss of the texture cache uploads the texture
+    sample.texture_uploads = counter_delta(emuenv.renderer->get_texture_cache()->stats.misses.load(std::memory_order_relaxed), counters.texture_misses);
+    sample.audio_underruns = counter_delta(get_audio_underruns(emuenv.audio), counters.audio_underruns);
+
+    recorder.csv << fmt::format("{:.1f},{:.1f},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f},{:.1f},{:.1f},{},{},{},{}\n",
+        sample.time, sample.fps, sample.frame_time_avg, sample.frame_time_p50, sample.frame_time_p95, sample.frame_time_p99, sample.frame_time_max,
+        sample.renderer_cpu, sample.guest_cpu, sample.shader_compiles, sample.pipeline_compiles, sample.texture_uploads, sample.audio_underruns);
+    // a session which crashes still leaves its samples
+    recorder.csv.flush();
+
+    recorder.samples.push_back(sample);
+}
+
+void stop_metrics(EmuEnvState &emuenv) {
+    if (!recorder.running)
+        return;
+    recorder.running = false;
+    recorder.csv.close();
+    thread_utils::release_thread_cpu_clock(recorder.renderer_clock);
+
+    std::vector<float> &frame_times = recorder.frame_times;
+    std::sort(frame_times.begin(), frame_times.end());
+    const float duration = std::chrono::duration<float>(std::chrono::steady_clock::now() - recorder.start).count();
+    float fps_total = 0.f;
+    float renderer_cpu_total = 0.f;
+    float guest_cpu_total = 0.f;
+    uint64_t shader_compiles = 0;
+    uint64_t pipeline_compiles = 0;
+    uint64_t texture_uploads = 0;
+    uint64_t audio_underruns = 0;
+    for (const auto &sample : recorder.samples) {
+        fps_total += sample.fps;
+        renderer_cpu_total += sample.renderer_cpu;
+        guest_cpu_total += sample.guest_cpu;
+        shader_compiles += sample.shader_compiles;
+        pipeline_compiles += sample.pipeline_compiles;
+        texture_uploads += sample.texture_uploads;
+        audio_underruns += sample.audio_underruns;
+    }
+    const float sample_count = std::max(1.f, static_cast<float>(recorder.samples.size()));
+
+    std::ofstream json(recorder.json_path.string(), std::ios::trunc);
+    if (!json.is_open()) {
+        LOG_ERROR("Failed to create the metrics file {}", recorder.json_path.string());
+        return;
+    }
+
+    json << "{\n";
+    json << fmt::format("  \"title_id\": \"{}\",\n", emuenv.io.title_id);
+    json << fmt::format("  \"renderer\": \"{}\",\n", emuenv.cfg.backend_renderer);
+    json << fmt::format("  \"cpu_backend\": \"{}\",\n", emuenv.cfg.current_config.cpu_backend);
+    json << fmt::format("  \"resolution_multiplier\": {},\n", emuenv.cfg.resolution_multiplier);
+    json << "  \"summary\": {\n";
+    json << fmt::format("    \"duration_s\": {:.1f},\n", duration);
+    json << fmt::format("    \"fps_avg\": {:.2f},\n", fps_total / sample_count);
+    json << fmt::format("    \"frame_time_p50_ms\": {:.2f},\n", percentile(frame_times, 0.50f));
+    json << fmt::format("    \"frame_time_p95_ms\": {:.2f},\n", percentile(frame_times, 0.95f));
+    json << fmt::format("    \"frame_time_p99_ms\": {:.2f},\n", percentile(frame_times, 0.99f));
+    json << fmt::format("    \"frame_time_max_ms\": {:.2f},\n", frame_times.empty() ? 0.f : frame_times.back());
+    json << fmt::format("    \"renderer_cpu_ms_per_s\": {:.1f},\n", renderer_cpu_total / sample_count);
+    json << fmt::format("    \"guest_cpu_ms_per_s\": {:.1f},\n", guest_cpu_total / sample_count);
+    json << fmt::format("    \"shader_compiles\": {},\n", shader_compiles);
+    json << fmt::format("    \"pipeline_compiles\": {},\n", pipeline_compiles);
+    json << fmt::format("    \"texture_uploads\": {},\n", texture_uploads);
+    json << fmt::format("    \"audio_underruns\": {}\n", audio_underruns);
+    json << "  },\n";
+    json << "  \"samples\": [\n";
+    for (size_t i = 0; i < recorder.samples.size(); i++) {
+        const MetricsSample &sample = recorder.samples[i];
+        json << fmt::format("    {{ \"time_s\": {:.1f}, \"fps\": {:.1f}, \"frame_time_avg_ms\": {:.2f}, \"frame_time_p50_ms\": {:.2f}, "
+                            "\"frame_time_p95_ms\": {:.2f}, \"frame_time_p99_ms\": {:.2f}, \"frame_time_max_ms\": {:.2f}, "
+                            "\"renderer_cpu_ms\": {:.1f}, \"guest_cpu_ms\": {:.1f}, \"shader_compiles\": {}, \"pipeline_compiles\": {}, "
+                            "\"texture_uploads\": {}, \"audio_underruns\": {} }}{}\n",
+            sample.time, sample.fps, sample.frame_time_avg, sample.frame_time_p50, sample.frame_time_p95, sample.frame_time_p99, sample.frame_time_max,
+            sample.renderer_cpu, sample.guest_cpu, sample.shader_compiles, sample.pipeline_compiles, sample.texture_uploads, sample.audio_underruns,
+            i + 1 < recorder.samples.size() ? "," : "");
+    }
+    json << "  ]\n";
+    json << "}\n";
+
+    LOG_INFO("Session metrics written to {}", recorder.json_path.string());
+}
+
+} // namespace app
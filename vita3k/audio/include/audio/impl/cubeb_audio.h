@@ -39,6 +39,18 @@ struct CubebAudioOutPort : AudioOutPort {
     // position of the next audio buffer to put audio
     int next_audio_buffer = 0;
     int nb_buffers_ready = 0;
+    // number of buffers the guest can queue, grown on underruns and shrunk back to min_buffers_ready
+    // once the output has been stable for a while
+    int max_buffers_ready = 0;
+    int min_buffers_ready = 0;
+    // frames played since the last underrun or resize
+    uint64_t stable_frames = 0;
+    // did the previous callback output any data
+    bool was_playing = false;
+    // latency of the cubeb stream itself, in frames
+    uint32_t stream_latency = 0;
+    // number of frames of a buffer once resampled to the rate of the stream
+    uint32_t buffer_frames = 0;
 
     // use the destructor to destroy the cubeb stream
     ~CubebAudioOutPort();
@@ -0,0 +1,66 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// number of filter taps used for each output sample, more taps give a sharper low-pass filter at a higher cost
+enum class AudioResamplerQuality {
+    Low = 0, // 8 taps
+    Medium = 1, // 16 taps
+    High = 2, // 32 taps
+};
+
+// Polyphase windowed sinc resampler converting s16 audio with 1 or 2 channels to stereo s16
+// the state of the filter is kept between calls so it must be used by a single stream
+class AudioResampler {
+public:
+    void init(int nb_channels, int in_freq, int out_freq, AudioResamplerQuality quality);
+
+    // resample nb_frames of input and append the resulting stereo frames to output
+    // returns the number of frames appended
+    size_t process(const int16_t *input, size_t nb_frames, std::vector<int16_t> &output);
+
+    int channels() const {
+        return nb_channels;
+    }
+
+    // the output is the same as the input, it can be used without calling process
+    bool is_identity() const {
+        return passthrough && (nb_channels == 2);
+    }
+
+private:
+    int nb_channels = 2;
+    int nb_taps = 0;
+    // the output rate is in_freq * nb_phases / step
+    uint32_t nb_phases = 1;
+    uint32_t step = 1;
+    // phase and first input sample of the window of the next output sample
+    uint32_t phase = 0;
+    size_t position = 0;
+    // same rate, the input only has to be copied
+    bool passthrough = false;
+    // nb_taps coefficients for each phase
+    std::vector<float> filters;
+    // input samples still needed by the filter, one buffer per channel
+    std::vector<float> history[2];
+};
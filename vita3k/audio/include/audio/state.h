@@ -17,10 +17,14 @@
 
 #pragma once
 
+#include <audio/resampler.h>
+
+#include <util/byte_ring_buffer.h>
 #include <util/types.h>
 
 #include <SDL_audio.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -30,7 +34,6 @@
 #define SCE_AUDIO_OUT_MAX_VOL 32768 //!< Maximum output port volume
 #define SCE_AUDIO_VOLUME_0DB SCE_AUDIO_OUT_MAX_VOL //!< Maximum output port volume
 
-typedef std::shared_ptr<SDL_AudioStream> AudioStreamPtr;
 typedef std::function<void(SceUID)> ResumeAudioThread;
 
 struct AudioOutPort {
@@ -48,15 +51,23 @@ struct AudioOutPort {
     int freq = 0;
     int mode = 0;
 
-    std::mutex mutex;
-    // stream to get the data
-    AudioStreamPtr stream;
+    // resampler converting the guest data to the host format, only used by the guest thread
+    AudioResampler resampler;
+    // converted data waiting to be mixed by the host audio callback
+    std::unique_ptr<SPSCByteRingBuffer> ring;
+    // converted stereo frames which did not fit in the ring yet
+    std::vector<int16_t> converted;
     // thread currently waiting for the audio to be processed
-    SceUID thread = -1;
+    std::atomic<SceUID> thread = -1;
+
+    // only tracked by the adapters which open one host stream per port
+    std::atomic<uint32_t> underruns = 0;
+    std::atomic<float> latency_ms = 0.f;
 };
 
 typedef std::shared_ptr<AudioOutPort> AudioOutPortPtr;
 typedef std::map<int, AudioOutPortPtr> AudioOutPortPtrs;
+typedef std::vector<AudioOutPortPtr> AudioOutPortList;
 
 struct AudioInPort {
     SDL_AudioDeviceID id;
@@ -75,11 +86,19 @@ struct AudioSpec {
 struct ThreadState;
 struct AudioState;
 
+// receives a copy of the mixed output of the host audio callback
+class AudioCapture {
+public:
+    virtual ~AudioCapture() = default;
+    // stereo s16 samples, called by the host audio thread
+    virtual void push_audio(const int16_t *samples, size_t nb_frames) = 0;
+};
+
 // abstract class that need to be overloaded with an audio implementation
 class AudioAdapter {
 private:
-    // buffer used to mix audio
-    std::vector<uint8_t> temp_buffer;
+    // buffer the ports are mixed in before being converted to the output
+    std::vector<float> mix_buffer;
 
 protected:
     AudioState &state;
@@ -106,6 +125,14 @@ public:
 
 struct AudioState {
     AudioSpec spec;
+    // copy of out_ports read by the host audio callback without locking, replaced by publish_out_ports
+    // it must be before the adapter so it is only destroyed once the callback can no longer run
+    std::unique_ptr<AudioOutPortList> published_ports;
+    std::atomic<const AudioOutPortList *> active_ports = nullptr;
+    // incremented when the host audio callback starts and ends, odd while it is running
+    std::atomic<uint32_t> callback_epoch = 0;
+    // read by the host audio callback, replaced by set_capture
+    std::atomic<AudioCapture *> capture = nullptr;
     // the adapter must be before out_ports for the destructors to work correctly
     std::unique_ptr<AudioAdapter> adapter;
     std::mutex mutex;
@@ -114,10 +141,17 @@ struct AudioState {
     AudioInPort in_port;
     ResumeAudioThread resume_thread;
     std::string audio_backend;
+    // used by the ports opened after it is changed
+    AudioResamplerQuality resampler_quality = AudioResamplerQuality::Medium;
 
     bool init(const ResumeAudioThread &resume_thread, const std::string &adapter_name);
     void set_backend(const std::string &adapter_name);
     AudioOutPortPtr open_port(int nb_channels, int freq, int nb_sample);
+    // must be called with mutex locked after out_ports was modified
+    void publish_out_ports();
+    // only the adapters mixing all the ports in a single stream can give their output, returns false for the others
+    // once it returns, the previous capture is no longer used
+    bool set_capture(AudioCapture *capture);
     void audio_output(ThreadState &thread, AudioOutPort &out_port, const void *buffer);
     void set_volume(AudioOutPort &out_port, float volume);
     void switch_state(const bool pause);
@@ -24,40 +24,164 @@
 
 #include <kernel/thread/thread_state.h>
 
+#include <util/instrset_detect.h>
 #include <util/log.h>
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <thread>
 
-static void mix_out_port(uint8_t *stream, uint8_t *temp_buffer, int len, AudioOutPort &port, const ResumeAudioThread &resume_thread) {
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#define AUDIO_SIMD_X64
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((__target__("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_AVX2
+#include <intrin.h>
+#endif
+#endif
+
+// all the ports are accumulated as floats with their volume applied, then saturated once to s16
+static void accumulate_s16_basic(float *dst, const int16_t *src, const size_t count, const float volume) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] += static_cast<float>(src[i]) * volume;
+}
+
+static void store_s16_basic(int16_t *dst, const float *src, const size_t count) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = static_cast<int16_t>(std::clamp(std::nearbyint(src[i]), -32768.0f, 32767.0f));
+}
+
+#if defined(__aarch64__)
+static void accumulate_s16_neon(float *dst, const int16_t *src, const size_t count, const float volume) {
+    const float32x4_t vol = vdupq_n_f32(volume);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t value = vld1q_s16(src + i);
+        const float32x4_t low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(value)));
+        const float32x4_t high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(value)));
+        vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), low, vol));
+        vst1q_f32(dst + i + 4, vmlaq_f32(vld1q_f32(dst + i + 4), high, vol));
+    }
+    accumulate_s16_basic(dst + i, src + i, count - i, volume);
+}
+
+static void store_s16_neon(int16_t *dst, const float *src, const size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int32x4_t low = vcvtnq_s32_f32(vld1q_f32(src + i));
+        const int32x4_t high = vcvtnq_s32_f32(vld1q_f32(src + i + 4));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+    }
+    store_s16_basic(dst + i, src + i, count - i);
+}
+#elif defined(AUDIO_SIMD_X64)
+static void accumulate_s16_sse2(float *dst, const int16_t *src, const size_t count, const float volume) {
+    const __m128 vol = _mm_set1_ps(volume);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        // sign extend by putting each sample in the upper half of a 32-bit lane
+        const __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16));
+        const __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(low, vol)));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(high, vol)));
+    }
+    accumulate_s16_basic(dst + i, src + i, count - i, volume);
+}
+
+static void TARGET_AVX2 accumulate_s16_avx2(float *dst, const int16_t *src, const size_t count, const float volume) {
+    const __m256 vol = _mm256_set1_ps(volume);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 value = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(value, vol)));
+    }
+    accumulate_s16_basic(dst + i, src + i, count - i, volume);
+}
+
+static void store_s16_sse2(int16_t *dst, const float *src, const size_t count) {
+    // clamp before the conversion, out of range floats would become INT32_MIN
+    const __m128 min_value = _mm_set1_ps(-32768.0f);
+    const __m128 max_value = _mm_set1_ps(32767.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i low = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), min_value), max_value));
+        const __m128i high = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), min_value), max_value));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(low, high));
+    }
+    store_s16_basic(dst + i, src + i, count - i);
+}
+#endif
+
+using AccumulateS16Func = void (*)(float *dst, const int16_t *src, const size_t count, const float volume);
+using StoreS16Func = void (*)(int16_t *dst, const float *src, const size_t count);
+
+static AccumulateS16Func select_accumulate_s16() {
+#if defined(__aarch64__)
+    return accumulate_s16_neon;
+#elif defined(AUDIO_SIMD_X64)
+    if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2)
+        return accumulate_s16_avx2;
+    return accumulate_s16_sse2;
+#else
+    return accumulate_s16_basic;
+#endif
+}
+
+static StoreS16Func select_store_s16() {
+#if defined(__aarch64__)
+    return store_s16_neon;
+#elif defined(AUDIO_SIMD_X64)
+    return store_s16_sse2;
+#else
+    return store_s16_basic;
+#endif
+}
+
+static const AccumulateS16Func accumulate_s16 = select_accumulate_s16();
+static const StoreS16Func store_s16 = select_store_s16();
+
+static void mix_out_port(float *mix_buffer, int len, AudioOutPort &port, const ResumeAudioThread &resume_thread) {
     ZoneScopedC(0xF6C2FF); // Tracy - Track function scope with color thistle
 
     // How much data is available?
-    std::unique_lock<std::mutex> lock(port.mutex);
-    const int bytes_available = SDL_AudioStreamAvailable(port.stream.get());
-    assert(bytes_available >= 0);
+    const int bytes_available = static_cast<int>(port.ring->Used());
 
     // Running out of data?
     // The (len * 3) is according to the value in sceAudioOutOutput
     if (bytes_available < len * 3) {
         // Is there a thread waiting for playback to finish?
-        if (port.thread >= 0) {
+        const SceUID thread = port.thread.exchange(-1);
+        if (thread >= 0) {
             // Wake the thread up.
-            resume_thread(port.thread);
-            port.thread = -1;
+            resume_thread(thread);
         }
     }
 
     if (bytes_available == 0)
         return;
 
-    // Mix as much as we need.
-    const int bytes_to_get = std::min(len, bytes_available);
-    const int bytes_got = SDL_AudioStreamGet(port.stream.get(), temp_buffer, bytes_to_get);
-    lock.unlock();
+    // Mix as much as we need, straight from the ring.
+    // the ring only contains whole frames and its size is a power of two, a part never ends in the middle of a sample
+    const char *first;
+    const char *second;
+    size_t first_size;
+    const size_t bytes_got = port.ring->ReadInPlace(std::min(len, bytes_available), first, first_size, second);
     if (bytes_got > 0) {
-        SDL_MixAudioFormat(stream, temp_buffer, AUDIO_S16LSB, bytes_got, static_cast<int>(port.volume * SDL_MIX_MAXVOLUME));
+        const size_t first_samples = first_size / sizeof(int16_t);
+        accumulate_s16(mix_buffer, reinterpret_cast<const int16_t *>(first), first_samples, port.volume);
+        accumulate_s16(mix_buffer + first_samples, reinterpret_cast<const int16_t *>(second), (bytes_got - first_size) / sizeof(int16_t), port.volume);
+        port.ring->Discard(bytes_got);
     }
 }
 
@@ -65,20 +189,24 @@ void AudioAdapter::audio_callback(uint8_t *stream, int len_bytes) {
     tracy::SetThreadName("Host audio thread"); // Tracy - Declare belonging of this function to the audio thread
     ZoneScopedC(0xF6C2FF); // Tracy - Track function scope with color thistle
 
-    std::vector<AudioOutPortPtr> ports;
-    {
-        // Read from shared state.
-        const std::lock_guard<std::mutex> lock(state.mutex);
-        ports.reserve(state.out_ports.size());
-        for (const AudioOutPortPtrs::value_type &port : state.out_ports) {
-            ports.push_back(port.second);
+    // the port list can only be freed by publish_out_ports once the epoch is even again
+    state.callback_epoch.fetch_add(1, std::memory_order_seq_cst);
+    const AudioOutPortList *ports = state.active_ports.load(std::memory_order_seq_cst);
+    const size_t nb_samples = len_bytes / sizeof(int16_t);
+    std::fill_n(mix_buffer.data(), nb_samples, 0.0f);
+
+    if (ports) {
+        for (const AudioOutPortPtr &port : *ports) {
+            if (port->ring)
+                mix_out_port(mix_buffer.data(), len_bytes, *port.get(), state.resume_thread);
         }
     }
-    std::memset(stream, state.spec.silence, len_bytes);
 
-    for (const AudioOutPortPtr &port : ports) {
-        mix_out_port(stream, temp_buffer.data(), len_bytes, *port.get(), state.resume_thread);
-    }
+    // the output is always s16, for which the silence value is 0
+    store_s16(reinterpret_cast<int16_t *>(stream), mix_buffer.data(), nb_samples);
+    if (AudioCapture *capture = state.capture.load(std::memory_order_acquire))
+        capture->push_audio(reinterpret_cast<const int16_t *>(stream), nb_samples / 2);
+    state.callback_epoch.fetch_add(1, std::memory_order_release);
 
     FrameMarkNamed("Audio"); // Tracy - End discontinuous frame for audio rendering
 }
@@ -98,7 +226,11 @@ void AudioState::set_backend(const std::string &adapter_name) {
         return;
 
     // first delete all ports then delete the backend
-    out_ports.clear();
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        out_ports.clear();
+        publish_out_ports();
+    }
     adapter.reset();
     if (adapter_name == "SDL") {
         adapter = std::make_unique<SDLAudioAdapter>(*this);
@@ -117,19 +249,20 @@ void AudioState::set_backend(const std::string &adapter_name) {
         return;
     }
 
-    adapter->temp_buffer.resize(spec.nb_samples * 2 * sizeof(uint16_t));
+    adapter->mix_buffer.resize(spec.nb_samples * 2);
 }
 
 AudioOutPortPtr AudioState::open_port(int nb_channels, int freq, int nb_sample) {
     if (adapter->single_stream) {
         // handle everything here
-        const AudioStreamPtr stream(SDL_NewAudioStream(AUDIO_S16LSB, nb_channels, freq, AUDIO_S16LSB, 2, spec.freq), SDL_FreeAudioStream);
-        if (!stream)
-            return nullptr;
-
         const AudioOutPortPtr port = std::make_shared<AudioOutPort>();
         port->len_bytes = nb_sample * nb_channels * sizeof(int16_t);
-        port->stream = stream;
+        port->resampler.init(nb_channels, freq, spec.freq, resampler_quality);
+
+        // room for what sceAudioOutOutput keeps queued (see audio_output) and a few converted buffers on top of it
+        const size_t converted_bytes = static_cast<size_t>(nb_sample) * spec.freq / freq * 2 * sizeof(int16_t);
+        port->ring = std::make_unique<SPSCByteRingBuffer>(4 * spec.nb_samples * 2 * sizeof(int16_t) + 2 * converted_bytes);
+        port->converted.reserve(port->ring->Capacity() / sizeof(int16_t));
 
         return port;
     } else {
@@ -141,11 +274,26 @@ AudioOutPortPtr AudioState::open_port(int nb_channels, int freq, int nb_sample)
 
 void AudioState::audio_output(ThreadState &thread, AudioOutPort &out_port, const void *buffer) {
     if (adapter->single_stream) {
-        // Put audio to the port's stream and see how much is left to play.
-        std::unique_lock<std::mutex> lock(out_port.mutex);
-        SDL_AudioStreamPut(out_port.stream.get(), buffer, out_port.len_bytes);
-        const int available = SDL_AudioStreamAvailable(out_port.stream.get());
-        lock.unlock();
+        // Resample the audio of the port and move as much as possible to the ring the host callback reads from.
+        // the buffer can be empty to drain the port
+        if (buffer && out_port.resampler.is_identity() && out_port.converted.empty()) {
+            // the guest data is already in the host format, it can go to the ring without being staged first
+            const int16_t *samples = static_cast<const int16_t *>(buffer);
+            const size_t inserted = out_port.ring->Insert(samples, std::min<size_t>(out_port.len_bytes, out_port.ring->Free() & ~3));
+            out_port.converted.insert(out_port.converted.end(), samples + inserted / sizeof(int16_t), samples + out_port.len_bytes / sizeof(int16_t));
+        } else if (buffer) {
+            const size_t nb_frames = out_port.len_bytes / (out_port.resampler.channels() * sizeof(int16_t));
+            out_port.resampler.process(static_cast<const int16_t *>(buffer), nb_frames, out_port.converted);
+        }
+        // only whole stereo s16 frames are moved to the ring
+        const size_t to_insert = std::min(out_port.converted.size() * sizeof(int16_t), out_port.ring->Free()) & ~3;
+        if (to_insert > 0) {
+            out_port.ring->Insert(out_port.converted.data(), to_insert);
+            out_port.converted.erase(out_port.converted.begin(), out_port.converted.begin() + to_insert / sizeof(int16_t));
+        }
+
+        // See how much is left to play.
+        const size_t available = out_port.ring->Used() + out_port.converted.size() * sizeof(int16_t);
 
         // If there's lots of audio left to play, stop this thread.
         // The audio callback will wake it up later when it's running out of data.
@@ -166,6 +314,36 @@ void AudioState::audio_output(ThreadState &thread, AudioOutPort &out_port, const
     }
 }
 
+// wait for a running host audio callback to end, it may still use what was just replaced
+static void wait_for_callback(const std::atomic<uint32_t> &callback_epoch) {
+    const uint32_t epoch = callback_epoch.load(std::memory_order_seq_cst);
+    if (epoch & 1) {
+        while (callback_epoch.load(std::memory_order_acquire) == epoch)
+            std::this_thread::yield();
+    }
+}
+
+void AudioState::publish_out_ports() {
+    auto ports = std::make_unique<AudioOutPortList>();
+    ports->reserve(out_ports.size());
+    for (const AudioOutPortPtrs::value_type &port : out_ports)
+        ports->push_back(port.second);
+    active_ports.store(ports.get(), std::memory_order_seq_cst);
+
+    // the previous list can only be freed once no callback uses it
+    wait_for_callback(callback_epoch);
+    published_ports = std::move(ports);
+}
+
+bool AudioState::set_capture(AudioCapture *capture) {
+    if (capture && (!adapter || !adapter->single_stream))
+        return false;
+
+    this->capture.store(capture, std::memory_order_seq_cst);
+    wait_for_callback(callback_epoch);
+    return true;
+}
+
 void AudioState::set_volume(AudioOutPort &out_port, float volume) {
     out_port.volume = volume;
 
@@ -23,6 +23,25 @@
 
 #include "util/log.h"
 
+// how many buffers can be added to the minimum after underruns
+static constexpr int MAX_EXTRA_BUFFERS = 8;
+// how long the output must play without underrun before giving back a buffer
+static constexpr uint32_t STABLE_SECONDS = 10;
+
+static void update_latency(CubebAudioOutPort &port) {
+    const uint32_t frames = port.stream_latency + port.max_buffers_ready * port.buffer_frames;
+    port.latency_ms = static_cast<float>(frames) * 1000.f / port.spec.rate;
+}
+
+static void resize_queue(CubebAudioOutPort &port, const int max_buffers_ready) {
+    std::unique_lock<std::mutex> lock(port.mutex);
+    port.max_buffers_ready = max_buffers_ready;
+    port.stable_frames = 0;
+    update_latency(port);
+    lock.unlock();
+    port.cond_var.notify_one();
+}
+
 static long impl_cubeb_audio_callback(cubeb_stream *stream, void *user_data, const void *input, void *output, long nframes) {
     assert(user_data != nullptr);
     assert(stream != nullptr);
@@ -40,11 +59,12 @@ static long impl_cubeb_audio_callback(cubeb_stream *stream, void *user_data, con
 
         AudioBuffer &audio_buffer = port->audio_buffers[port->next_audio_buffer];
         // compute the number of bytes we can copy from this buffer to the output
-        const int bytes_to_copy = std::min(bytes_to_give - bytes_given, port->len_bytes - audio_buffer.buffer_position);
+        const int buffer_size = static_cast<int>(audio_buffer.buffer.size());
+        const int bytes_to_copy = std::min(bytes_to_give - bytes_given, buffer_size - audio_buffer.buffer_position);
         memcpy(&output_buffer[bytes_given], &audio_buffer.buffer[audio_buffer.buffer_position], bytes_to_copy);
         audio_buffer.buffer_position += bytes_to_copy;
 
-        if (audio_buffer.buffer_position == port->len_bytes) {
+        if (audio_buffer.buffer_position == buffer_size) {
             // if we are done with this buffer, tell it
             std::unique_lock<std::mutex> lock(port->mutex);
             port->next_audio_buffer = (port->next_audio_buffer + 1) % port->audio_buffers.size();
@@ -56,6 +76,23 @@ static long impl_cubeb_audio_callback(cubeb_stream *stream, void *user_data, con
         bytes_given += bytes_to_copy;
     }
 
+    if (bytes_given < bytes_to_give) {
+        memset(&output_buffer[bytes_given], 0, bytes_to_give - bytes_given);
+
+        // the guest did not give its data in time, allow it to queue one more buffer
+        if (port->was_playing) {
+            port->underruns++;
+            if (port->max_buffers_ready < static_cast<int>(port->audio_buffers.size()))
+                resize_queue(*port, port->max_buffers_ready + 1);
+        }
+        port->was_playing = false;
+    } else {
+        port->was_playing = true;
+        port->stable_frames += nframes;
+        if (port->stable_frames >= STABLE_SECONDS * port->spec.rate && port->max_buffers_ready > port->min_buffers_ready)
+            resize_queue(*port, port->max_buffers_ready - 1);
+    }
+
     return nframes;
 }
 
@@ -91,11 +128,16 @@ bool CubebAudioAdapter::init() {
 
 AudioOutPortPtr CubebAudioAdapter::open_port(int nb_channels, int freq, int nb_sample) {
     std::shared_ptr<CubebAudioOutPort> port = std::make_shared<CubebAudioOutPort>();
+    // the stream is opened at the rate of the device so cubeb does not have to resample it again
+    uint32_t rate;
+    if (cubeb_get_preferred_sample_rate(cubeb_ctx, &rate) != CUBEB_OK)
+        rate = static_cast<uint32_t>(freq);
     port->spec = {
         // all the ps vita samples are signed 16 bits low edian
         .format = CUBEB_SAMPLE_S16LE,
-        .rate = static_cast<uint32_t>(freq),
-        .channels = static_cast<uint32_t>(nb_channels),
+        .rate = rate,
+        // the resampler always outputs stereo
+        .channels = 2,
         .layout = CUBEB_LAYOUT_UNDEFINED,
         // we could use the params of sceAudioOutOpenPort to select some prefs, although I don't think it will change anything
         .prefs = CUBEB_STREAM_PREF_NONE
@@ -112,16 +154,24 @@ AudioOutPortPtr CubebAudioAdapter::open_port(int nb_channels, int freq, int nb_s
     }
 
     port->len_bytes = nb_sample * nb_channels * sizeof(uint16_t);
-
-    // allocate enough buffers to be able to satisfy a callback (+1 to make sure one buffer can be ready)
-    const int nb_buffers = (latency + nb_sample - 1) / nb_sample + 1;
-    port->audio_buffers.resize(nb_buffers);
+    port->resampler.init(nb_channels, freq, rate, state.resampler_quality);
+    port->buffer_frames = std::max<uint32_t>(1, static_cast<uint64_t>(nb_sample) * rate / freq);
+
+    // start with enough buffers to be able to satisfy a callback (+1 to make sure one buffer can be ready)
+    // and allocate the ones which can be added after underruns right away
+    port->min_buffers_ready = (latency + port->buffer_frames - 1) / port->buffer_frames + 1;
+    port->max_buffers_ready = port->min_buffers_ready;
+    port->audio_buffers.resize(port->min_buffers_ready + MAX_EXTRA_BUFFERS);
     for (AudioBuffer &audio_buffer : port->audio_buffers) {
-        // initialize all of the buffers
-        audio_buffer.buffer.resize(port->len_bytes);
+        // reserve room for the resampler rounding up the number of frames
+        audio_buffer.buffer.reserve((port->buffer_frames + 2) * 2 * sizeof(uint16_t));
         audio_buffer.buffer_position = 0;
     }
 
+    if (cubeb_stream_get_latency(port->out_stream, &port->stream_latency) != CUBEB_OK)
+        port->stream_latency = latency;
+    update_latency(*port);
+
     cubeb_stream_start(port->out_stream);
     return port;
 }
@@ -129,11 +179,18 @@ AudioOutPortPtr CubebAudioAdapter::open_port(int nb_channels, int freq, int nb_s
 void CubebAudioAdapter::audio_output(ThreadState &thread, AudioOutPort &out_port, const void *buffer) {
     CubebAudioOutPort &port = static_cast<CubebAudioOutPort &>(out_port);
 
+    // the resampler is only used by the guest thread, it can run before waiting for a free buffer
+    if (buffer) {
+        const size_t nb_frames = port.len_bytes / (port.resampler.channels() * sizeof(int16_t));
+        port.converted.clear();
+        port.resampler.process(static_cast<const int16_t *>(buffer), nb_frames, port.converted);
+    }
+
     std::unique_lock<std::mutex> lock(port.mutex);
-    if (port.nb_buffers_ready == port.audio_buffers.size()) {
+    if (port.nb_buffers_ready >= port.max_buffers_ready) {
         // is it really useful to update the thread status?
         thread.update_status(ThreadStatus::wait);
-        port.cond_var.wait(lock);
+        port.cond_var.wait(lock, [&]() { return port.nb_buffers_ready < port.max_buffers_ready; });
         thread.update_status(ThreadStatus::run);
     }
 
@@ -142,7 +199,8 @@ void CubebAudioAdapter::audio_output(ThreadState &thread, AudioOutPort &out_port
         // the buffer can be empty to drain the port
         int next_buffer_pos = (port.next_audio_buffer + port.nb_buffers_ready) % port.audio_buffers.size();
         // we could unlock the lock here and re-lock it right after, but will this be faster?
-        memcpy(port.audio_buffers[next_buffer_pos].buffer.data(), buffer, port.len_bytes);
+        const uint8_t *converted = reinterpret_cast<const uint8_t *>(port.converted.data());
+        port.audio_buffers[next_buffer_pos].buffer.assign(converted, converted + port.converted.size() * sizeof(int16_t));
         port.audio_buffers[next_buffer_pos].buffer_position = 0;
         port.nb_buffers_ready++;
     }
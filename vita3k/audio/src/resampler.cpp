@@ -0,0 +1,208 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <audio/resampler.h>
+
+#include <util/instrset_detect.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <numeric>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#define AUDIO_SIMD_X64
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((__target__("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_AVX2
+#include <intrin.h>
+#endif
+#endif
+
+// a ratio needing more phases than this is rounded, the pitch error is way below what can be heard
+static constexpr uint32_t MAX_PHASES = 1024;
+// part of the lowest nyquist frequency kept by the filter, the rest is used by the transition band
+static constexpr double CUTOFF = 0.9;
+
+// the number of taps is always a multiple of 8, a whole filter can be computed with full vectors
+static float dot_basic(const float *a, const float *b, const size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+#if defined(__aarch64__)
+static float dot_neon(const float *a, const float *b, const size_t count) {
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < count; i += 8) {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+#elif defined(AUDIO_SIMD_X64)
+static float dot_sse2(const float *a, const float *b, const size_t count) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (size_t i = 0; i < count; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+static float TARGET_AVX2 dot_avx2(const float *a, const float *b, const size_t count) {
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t i = 0; i < count; i += 8)
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+}
+#endif
+
+using DotFunc = float (*)(const float *a, const float *b, const size_t count);
+
+static DotFunc select_dot() {
+#if defined(__aarch64__)
+    return dot_neon;
+#elif defined(AUDIO_SIMD_X64)
+    if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2)
+        return dot_avx2;
+    return dot_sse2;
+#else
+    return dot_basic;
+#endif
+}
+
+static const DotFunc dot = select_dot();
+
+static int16_t to_s16(const float value) {
+    return static_cast<int16_t>(std::clamp(std::nearbyint(value), -32768.0f, 32767.0f));
+}
+
+void AudioResampler::init(int nb_channels, int in_freq, int out_freq, AudioResamplerQuality quality) {
+    this->nb_channels = nb_channels;
+    passthrough = (in_freq == out_freq);
+    phase = 0;
+    position = 0;
+    filters.clear();
+    for (std::vector<float> &channel : history)
+        channel.clear();
+    if (passthrough)
+        return;
+
+    nb_taps = 8 << static_cast<int>(quality);
+    const uint32_t divisor = std::gcd(in_freq, out_freq);
+    nb_phases = out_freq / divisor;
+    step = in_freq / divisor;
+    if (nb_phases > MAX_PHASES) {
+        step = std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(static_cast<double>(step) * MAX_PHASES / nb_phases)));
+        nb_phases = MAX_PHASES;
+    }
+
+    // each phase is the sinc centered on its fractional position between two input samples,
+    // with a blackman window and its sum normalized so the gain is exactly 1
+    const double cutoff = CUTOFF * std::min(1.0, static_cast<double>(out_freq) / in_freq);
+    const double half_width = nb_taps / 2.0;
+    filters.resize(static_cast<size_t>(nb_phases) * nb_taps);
+    for (uint32_t p = 0; p < nb_phases; p++) {
+        float *filter = &filters[static_cast<size_t>(p) * nb_taps];
+        const double offset = static_cast<double>(p) / nb_phases;
+        double sum = 0.0;
+        for (int i = 0; i < nb_taps; i++) {
+            const double distance = i - half_width + 1.0 - offset;
+            const double x = std::numbers::pi * cutoff * distance;
+            const double sinc = (x == 0.0) ? 1.0 : std::sin(x) / x;
+            const double window_pos = std::numbers::pi * distance / half_width;
+            const double window = 0.42 + 0.5 * std::cos(window_pos) + 0.08 * std::cos(2.0 * window_pos);
+            const double coefficient = (std::abs(distance) < half_width) ? sinc * window : 0.0;
+            filter[i] = static_cast<float>(coefficient);
+            sum += coefficient;
+        }
+        for (int i = 0; i < nb_taps; i++)
+            filter[i] = static_cast<float>(filter[i] / sum);
+    }
+
+    // the first output sample is centered on the first input sample
+    for (int c = 0; c < nb_channels; c++)
+        history[c].assign(nb_taps / 2 - 1, 0.0f);
+}
+
+size_t AudioResampler::process(const int16_t *input, size_t nb_frames, std::vector<int16_t> &output) {
+    if (passthrough) {
+        const size_t start = output.size();
+        output.resize(start + nb_frames * 2);
+        if (nb_channels == 2) {
+            memcpy(&output[start], input, nb_frames * 2 * sizeof(int16_t));
+        } else {
+            for (size_t i = 0; i < nb_frames; i++)
+                output[start + i * 2] = output[start + i * 2 + 1] = input[i];
+        }
+        return nb_frames;
+    }
+
+    for (int c = 0; c < nb_channels; c++) {
+        std::vector<float> &channel = history[c];
+        const size_t start = channel.size();
+        channel.resize(start + nb_frames);
+        for (size_t i = 0; i < nb_frames; i++)
+            channel[start + i] = static_cast<float>(input[i * nb_channels + c]);
+    }
+
+    const size_t available = history[0].size();
+    // upper bound of the number of frames which can be produced, the exact amount depends on the phase
+    const size_t max_frames = (available >= position + nb_taps) ? ((available - position - nb_taps + 1) * nb_phases + step - 1) / step + 1 : 0;
+    const size_t start = output.size();
+    output.resize(start + max_frames * 2);
+
+    int16_t *dst = &output[start];
+    size_t nb_output = 0;
+    while (position + nb_taps <= available) {
+        const float *filter = &filters[static_cast<size_t>(phase) * nb_taps];
+        const int16_t left = to_s16(dot(filter, &history[0][position], nb_taps));
+        const int16_t right = (nb_channels == 2) ? to_s16(dot(filter, &history[1][position], nb_taps)) : left;
+        dst[nb_output * 2] = left;
+        dst[nb_output * 2 + 1] = right;
+        nb_output++;
+
+        phase += step;
+        position += phase / nb_phases;
+        phase %= nb_phases;
+    }
+    output.resize(start + nb_output * 2);
+
+    // only keep the samples the next windows still need
+    const size_t consumed = std::min(position, available);
+    for (int c = 0; c < nb_channels; c++)
+        history[c].erase(history[c].begin(), history[c].begin() + consumed);
+    position -= consumed;
+
+    return nb_output;
+}
@@ -0,0 +1,219 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+// Micro-benchmarks of the hot kernels of the emulator on synthetic data, reports JSON on stdout.
+// Each kernel is run several times and the median is kept, so the output of two commits can be compared.
+// Usage: vita3k-bench [iterations] [kernel name filter]
+
+#include <audio/resampler.h>
+#include <config/version.h>
+#include <gxm/types.h>
+#include <kernel/relocation.h>
+#include <mem/allocator.h>
+#include <mem/functions.h>
+#include <mem/state.h>
+#include <ngs/mix.h>
+#include <renderer/functions.h>
+#include <shader/usse_program_analyzer.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+static constexpr int REPEATS = 5;
+
+struct Benchmark {
+    const char *name;
+    // bytes processed by one iteration, 0 when a throughput does not make sense
+    uint64_t bytes;
+    std::function<void()> run;
+};
+
+struct BenchmarkResult {
+    double median_us = 0;
+    double min_us = 0;
+};
+
+static BenchmarkResult run_benchmark(const Benchmark &benchmark, uint32_t iterations) {
+    using clock = std::chrono::steady_clock;
+    // warm up the caches and the lazily initialized tables
+    benchmark.run();
+
+    std::vector<double> times;
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        const auto start = clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            benchmark.run();
+        times.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count() / iterations);
+    }
+    std::sort(times.begin(), times.end());
+    return { times[times.size() / 2], times.front() };
+}
+
+static std::vector<uint8_t> random_bytes(std::mt19937 &rng, size_t size) {
+    std::vector<uint8_t> bytes(size);
+    std::generate(bytes.begin(), bytes.end(), [&] { return static_cast<uint8_t>(rng()); });
+    return bytes;
+}
+
+// format 0 entries patching an absolute address in every word of the patched segment
+static std::vector<uint32_t> make_relocations(uint32_t count) {
+    constexpr uint32_t ABS32 = 2;
+    std::vector<uint32_t> entries;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t symbol_segment = 0;
+        const uint32_t patch_segment = 1;
+        entries.push_back(symbol_segment << 4 | ABS32 << 8 | patch_segment << 16);
+        entries.push_back(i * 16); // addend
+        entries.push_back(i * 4); // offset
+    }
+    return entries;
+}
+
+int main(int argc, char *argv[]) {
+    const uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 100;
+    const std::string filter = argc > 2 ? argv[2] : "";
+    if (iterations == 0) {
+        fmt::print(stderr, "Usage: vita3k-bench [iterations] [kernel name filter]\n");
+        return 1;
+    }
+
+    MemState mem;
+    if (!init(mem, false)) {
+        fmt::print(stderr, "Failed to initialize the guest memory\n");
+        return 1;
+    }
+
+    std::mt19937 rng(42);
+
+    // a 1024x1024 RGBA8 texture in guest memory
+    constexpr uint16_t TEXTURE_SIZE = 1024;
+    constexpr uint32_t TEXTURE_BYTES = TEXTURE_SIZE * TEXTURE_SIZE * 4;
+    const Address texture_addr = alloc_aligned(mem, TEXTURE_BYTES, "bench texture", 4);
+    const std::vector<uint8_t> texture_data = random_bytes(rng, TEXTURE_BYTES);
+    memcpy(Ptr<uint8_t>(texture_addr).get(mem), texture_data.data(), TEXTURE_BYTES);
+    SceGxmTexture texture{};
+    texture.data_addr = texture_addr >> 2;
+    std::vector<uint8_t> linear(TEXTURE_BYTES);
+    std::vector<uint32_t> decompressed(TEXTURE_SIZE * TEXTURE_SIZE);
+
+    // the relocations of a 256 KiB data segment pointing to a code segment
+    constexpr uint32_t RELOCATION_COUNT = 64 * 1024;
+    const Address code_addr = alloc(mem, KiB(64), "bench code");
+    const Address data_addr = alloc(mem, RELOCATION_COUNT * 4, "bench data");
+    const std::vector<uint32_t> relocations = make_relocations(RELOCATION_COUNT);
+    const SegmentInfosForReloc segments = {
+        { 0, { code_addr, code_addr, KiB(64) } },
+        { 1, { data_addr, data_addr, RELOCATION_COUNT * 4 } },
+    };
+
+    // allocations and frees of random sizes like the ones of the gpu and of the kernel memory blocks
+    BitmapAllocator allocator(64 * 1024);
+    std::vector<int> allocation_sizes(4096);
+    std::generate(allocation_sizes.begin(), allocation_sizes.end(), [&] { return 1 + static_cast<int>(rng() % 64); });
+
+    // random instruction words, most of them are not branches so the whole decoder is run
+    std::vector<uint64_t> instructions(64 * 1024);
+    std::generate(instructions.begin(), instructions.end(), [&] { return (static_cast<uint64_t>(rng()) << 32) | rng(); });
+
+    // 512 stereo frames, the granularity most games use with NGS
+    constexpr uint32_t NGS_FRAMES = 512;
+    std::uniform_real_distribution<float> sample_dist(-1.5f, 1.5f);
+    std::vector<float> ngs_src(NGS_FRAMES * 2);
+    std::generate(ngs_src.begin(), ngs_src.end(), [&] { return sample_dist(rng); });
+    std::vector<float> ngs_dest(NGS_FRAMES * 2, 0.0f);
+    std::vector<int16_t> ngs_output(NGS_FRAMES * 2);
+    const float matrix[2][2] = { { 0.8f, 0.3f }, { 0.25f, 1.2f } };
+
+    // one 10 ms buffer of a 44.1 kHz stereo stream resampled to the 48 kHz of the host
+    constexpr uint32_t AUDIO_FRAMES = 441;
+    std::vector<int16_t> audio_input(AUDIO_FRAMES * 2);
+    std::generate(audio_input.begin(), audio_input.end(), [&] { return static_cast<int16_t>(rng()); });
+    std::vector<int16_t> audio_output;
+    AudioResampler resampler;
+    resampler.init(2, 44100, 48000, AudioResamplerQuality::Medium);
+
+    uint64_t sink = 0;
+    const std::vector<Benchmark> benchmarks = {
+        { "hash_texture_data", TEXTURE_BYTES, [&] { sink += renderer::texture::hash_texture_data(texture, TEXTURE_BYTES, mem); } },
+        { "swizzled_texture_to_linear", TEXTURE_BYTES, [&] { renderer::texture::swizzled_texture_to_linear_texture(linear.data(), texture_data.data(), TEXTURE_SIZE, TEXTURE_SIZE, 32); } },
+        { "tiled_texture_to_linear", TEXTURE_BYTES, [&] { renderer::texture::tiled_texture_to_linear_texture(linear.data(), texture_data.data(), TEXTURE_SIZE, TEXTURE_SIZE, 32); } },
+        // BC1 has 8 bytes for each block of 4x4 pixels
+        { "decompress_bc1", TEXTURE_SIZE * TEXTURE_SIZE / 2, [&] { renderer::texture::decompress_bc_image(TEXTURE_SIZE, TEXTURE_SIZE, texture_data.data(), decompressed.data(), 0); } },
+        { "decompress_bc3", TEXTURE_SIZE * TEXTURE_SIZE, [&] { renderer::texture::decompress_bc_image(TEXTURE_SIZE, TEXTURE_SIZE, texture_data.data(), decompressed.data(), 2); } },
+        { "bitmap_allocator", 0, [&] {
+             std::vector<int> offsets;
+             offsets.reserve(allocation_sizes.size());
+             for (int size : allocation_sizes) {
+                 int allocated_size = size;
+                 offsets.push_back(allocator.allocate_from(0, allocated_size));
+             }
+             // free every other allocation first to fragment the bitmap
+             for (size_t i = 0; i < offsets.size(); i += 2) {
+                 if (offsets[i] >= 0)
+                     allocator.free(offsets[i], allocation_sizes[i]);
+             }
+             for (size_t i = 1; i < offsets.size(); i += 2) {
+                 if (offsets[i] >= 0)
+                     allocator.free(offsets[i], allocation_sizes[i]);
+             }
+         } },
+        { "usse_decode", instructions.size() * sizeof(uint64_t), [&] {
+             for (const uint64_t inst : instructions) {
+                 uint8_t pred;
+                 int32_t br_off;
+                 int base, cursor, offset, size;
+                 sink += shader::usse::is_branch(inst, pred, br_off) + shader::usse::is_kill(inst) + shader::usse::get_predicate(inst);
+                 sink += shader::usse::does_write_to_predicate(inst, pred) + shader::usse::is_buffer_fetch_or_store(inst, base, cursor, offset, size);
+             }
+         } },
+        { "relocate", relocations.size() * sizeof(uint32_t), [&] { sink += relocate(relocations.data(), relocations.size() * sizeof(uint32_t), segments, mem); } },
+        { "ngs_mix_stereo", NGS_FRAMES * 2 * sizeof(float), [&] { ngs::mix_stereo(ngs_dest.data(), ngs_src.data(), NGS_FRAMES, matrix); } },
+        { "ngs_mix_mono_to_stereo", NGS_FRAMES * sizeof(float), [&] { ngs::mix_mono_to_stereo(ngs_dest.data(), ngs_src.data(), NGS_FRAMES, 0.7f, 0.4f); } },
+        { "ngs_convert_f32_to_s16", NGS_FRAMES * 2 * sizeof(float), [&] { ngs::convert_f32_to_s16(ngs_output.data(), ngs_dest.data(), NGS_FRAMES * 2); } },
+        { "audio_resample", AUDIO_FRAMES * 2 * sizeof(int16_t), [&] {
+             audio_output.clear();
+             resampler.process(audio_input.data(), AUDIO_FRAMES, audio_output);
+         } },
+    };
+
+    std::string results;
+    for (const Benchmark &benchmark : benchmarks) {
+        if (!filter.empty() && (std::string(benchmark.name).find(filter) == std::string::npos))
+            continue;
+
+        const BenchmarkResult result = run_benchmark(benchmark, iterations);
+        const double mib_per_s = (benchmark.bytes && result.median_us > 0) ? (benchmark.bytes / (1024.0 * 1024.0)) / (result.median_us / 1e6) : 0.0;
+        if (!results.empty())
+            results += ',';
+        results += fmt::format(R"({{"kernel":"{}","median_us":{:.3f},"min_us":{:.3f},"mib_per_s":{:.1f}}})", benchmark.name, result.median_us, result.min_us, mib_per_s);
+    }
+
+    // printed so the work of the kernels can't be removed by the optimizer
+    fmt::print(R"({{"revision":"{}","iterations":{},"repeats":{},"checksum":{},"kernels":[{}]}})"
+               "\n",
+        app_hash, iterations, REPEATS, sink, results);
+    return 0;
+}
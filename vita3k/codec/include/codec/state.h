@@ -17,11 +17,17 @@
 
 #pragma once
 
+#include <util/alloc_tracker.h>
+
 #include <array>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
+#include <vector>
 
 struct AVFrame;
 struct AVPacket;
@@ -30,6 +36,7 @@ struct AVCodecContext;
 struct AVFormatContext;
 struct AVCodecParserContext;
 struct AVCodec;
+struct AVBufferRef;
 struct SwrContext;
 
 union DecoderSize {
@@ -69,6 +76,8 @@ enum class DecoderQuery {
 
 struct DecoderState {
     AVCodecContext *context{};
+    // settings the context was opened with, if set the context goes back to the pool when the decoder is destroyed
+    std::string pool_key;
 
     virtual uint32_t get(DecoderQuery query);
 
@@ -80,6 +89,14 @@ struct DecoderState {
     virtual ~DecoderState();
 };
 
+/**
+ * @brief Take an opened context given back by a destroyed decoder with the same pool key.
+ * The context is flushed so it can decode a new stream.
+ *
+ * @return The context, or nullptr if there is none and a new one must be opened
+ */
+AVCodecContext *acquire_pooled_context(const std::string &key);
+
 struct H264DecoderOptions {
     uint32_t pts_upper;
     uint32_t pts_lower;
@@ -89,6 +106,15 @@ struct H264DecoderOptions {
 
 struct H264DecoderState : public DecoderState {
     AVCodecParserContext *parser{};
+    // reused by each call to send and receive
+    AVPacket *packet{};
+    AVFrame *frame{};
+    AVFrame *sw_frame{};
+    // copy of the access unit given to send with the padding needed by FFmpeg
+    std::vector<uint8_t> au_buffer;
+    // set if the decoding is done by the hardware, the frames must then be copied back before being used
+    AVBufferRef *hw_device{};
+    int hw_pixel_format = -1;
 
     uint32_t width_in = 0;
     uint32_t height_in = 0;
@@ -117,7 +143,11 @@ struct H264DecoderState : public DecoderState {
     void get_pts(uint32_t &upper, uint32_t &lower);
     void set_output_format(bool is_yuv_p3);
 
-    H264DecoderState(uint32_t width, uint32_t height);
+    /**
+     * @param hwaccel FFmpeg name of the hardware decoding API (vaapi, d3d11va, videotoolbox, vulkan...), "Auto" to
+     * use the first one available on this platform, anything else (like "None") to only decode in software
+     */
+    H264DecoderState(uint32_t width, uint32_t height, const std::string &hwaccel = {});
     ~H264DecoderState() override;
 };
 
@@ -126,6 +156,8 @@ struct MjpegDecoderState : public DecoderState {
 
     bool send(const uint8_t *data, uint32_t size) override;
     bool receive(uint8_t *data, DecoderSize *size) override;
+    // Converts the decoded frame straight from its planes, fails if it needs more than rgba_size bytes
+    bool receive_rgba(uint8_t *rgba, uint32_t rgba_size, DecoderSize *size);
     DecoderColorSpace get_color_space();
 
     MjpegDecoderState();
@@ -160,6 +192,10 @@ struct Atrac9DecoderState : public DecoderState {
 
 struct Mp3DecoderState : public DecoderState {
     const AVCodec *codec;
+    AVFrame *frame;
+    AVPacket *packet;
+    // copy of the data given to send with the padding needed by FFmpeg
+    std::vector<uint8_t> es_buffer;
     uint32_t es_size_used;
 
     uint32_t get(DecoderQuery query) override;
@@ -179,6 +215,18 @@ struct ADPCMHistory {
     int32_t hist4;
 };
 
+constexpr uint32_t HEVAG_FRAME_SIZE = 0x10;
+constexpr uint32_t HEVAG_FRAME_SAMPLES = (HEVAG_FRAME_SIZE - 2) * 2;
+
+/**
+ * @brief Decode a 16 bytes (HE-)VAG frame to HEVAG_FRAME_SAMPLES samples.
+ * Regular VAG frames use the first five coefficients of the table and are decoded the same way.
+ *
+ * @param stride Distance between two samples in dest, to interleave channels
+ * @return The flags of the frame (loop start, loop end, end of data)
+ */
+uint8_t decode_hevag_frame(const uint8_t *frame, ADPCMHistory &history, int16_t *dest, uint32_t stride = 1);
+
 struct PCMDecoderState : public DecoderState {
 private:
     std::vector<std::uint8_t> final_result;
@@ -213,6 +261,8 @@ struct AacDecoderState : public DecoderState {
     const AVCodec *codec;
     SwrContext *swr = nullptr;
     AVFrame *frame;
+    // only points to the data given to send
+    AVPacket *packet;
     uint32_t es_size_used;
     uint32_t get(DecoderQuery query) override;
 
@@ -224,6 +274,58 @@ struct AacDecoderState : public DecoderState {
     ~AacDecoderState();
 };
 
+template <typename T>
+struct PlayerFrame {
+    std::vector<T> data;
+    uint64_t timestamp = 0;
+    uint32_t channels = 0;
+    uint32_t sample_rate = 0;
+    uint32_t sample_count = 0;
+};
+
+// frames decoded ahead by the decode thread, the buffers of the consumed frames are reused
+template <typename T>
+struct PlayerFrameQueue {
+    std::queue<PlayerFrame<T>> frames;
+    std::vector<std::vector<T>> pool;
+    size_t capacity = 0;
+    // memory of all the buffers in the queue, the pool and the last frame given to the guest, in bytes
+    size_t buffers_size = 0;
+
+    bool is_full() const {
+        return frames.size() >= capacity;
+    }
+
+    std::vector<T> get_buffer() {
+        if (pool.empty())
+            return {};
+        std::vector<T> buffer = std::move(pool.back());
+        pool.pop_back();
+        return buffer;
+    }
+
+    // the buffer of the frame has grown from previous_capacity
+    void push(PlayerFrame<T> &&frame, size_t previous_capacity) {
+        buffers_size += (frame.data.capacity() - previous_capacity) * sizeof(T);
+        TRACK_HOST_ALLOC(CodecBuffers, this, buffers_size);
+        frames.push(std::move(frame));
+    }
+
+    // the previous buffer of data goes back to the pool
+    void pop(PlayerFrame<T> &frame) {
+        pool.push_back(std::move(frame.data));
+        frame = std::move(frames.front());
+        frames.pop();
+    }
+
+    void clear() {
+        while (!frames.empty()) {
+            pool.push_back(std::move(frames.front().data));
+            frames.pop();
+        }
+    }
+};
+
 struct PlayerState {
     std::string video_playing;
     std::queue<std::string> videos_queue;
@@ -234,9 +336,25 @@ struct PlayerState {
     int32_t video_stream_id = -1;
     int32_t audio_stream_id = -1;
 
+    // only used by the decode thread
     std::queue<AVPacket *> audio_packets;
     std::queue<AVPacket *> video_packets;
 
+    // demuxes and decodes both streams into the frame queues while the video is playing
+    std::thread decode_thread;
+    std::mutex mutex;
+    // notified when a frame is consumed or the decode thread must stop
+    std::condition_variable space_available;
+    bool stop_decoding = false;
+    bool video_ended = false;
+    bool audio_ended = false;
+    PlayerFrameQueue<uint8_t> video_frames;
+    PlayerFrameQueue<int16_t> audio_frames;
+
+    // last frames given to the guest
+    PlayerFrame<uint8_t> video_frame;
+    PlayerFrame<int16_t> audio_frame;
+
     uint64_t time_of_last_frame = 0;
     uint64_t framerate_microseconds = 0;
 
@@ -253,9 +371,16 @@ struct PlayerState {
     void switch_video(const std::string &path);
 
     bool next_packet(int32_t stream_id);
-
-    std::vector<int16_t> receive_audio();
-    std::vector<uint8_t> receive_video();
+    bool decode_audio(AVFrame *frame);
+    bool decode_video(AVFrame *frame);
+    void decode_loop();
+    // called once a stream has been fully consumed, play the next queued video if there is any
+    void end_of_video();
+
+    // never block, return false if no frame has been decoded yet
+    // the frame stays valid in audio_frame or video_frame until the next call
+    bool receive_audio();
+    bool receive_video();
 
     void queue(const std::string &path);
 
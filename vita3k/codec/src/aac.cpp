@@ -38,22 +38,30 @@ AacDecoderState::AacDecoderState(uint32_t sample_rate, uint32_t channels) {
     codec = avcodec_find_decoder(AV_CODEC_ID_AAC);
     assert(codec);
 
-    context = avcodec_alloc_context3(codec);
-    assert(context);
-
     frame = av_frame_alloc();
+    packet = av_packet_alloc();
+
+    pool_key = fmt::format("aac:{}:{}", sample_rate, channels);
+    context = acquire_pooled_context(pool_key);
+    if (!context) {
+        context = avcodec_alloc_context3(codec);
+        assert(context);
 
-    context->codec_type = AVMEDIA_TYPE_AUDIO;
-    av_channel_layout_default(&context->ch_layout, channels);
-    context->sample_rate = sample_rate;
+        context->codec_type = AVMEDIA_TYPE_AUDIO;
+        av_channel_layout_default(&context->ch_layout, channels);
+        context->sample_rate = sample_rate;
 
-    int err = avcodec_open2(context, codec, nullptr);
-    assert(err == 0);
+        int err = avcodec_open2(context, codec, nullptr);
+        assert(err == 0);
+    }
 
+    // a pooled context has the layout of its previous stream, use the one asked for
+    AVChannelLayout ch_layout;
+    av_channel_layout_default(&ch_layout, channels);
     swr = nullptr;
     int ret = swr_alloc_set_opts2(&swr,
-        &context->ch_layout, AV_SAMPLE_FMT_S16, sample_rate,
-        &context->ch_layout, AV_SAMPLE_FMT_FLTP, sample_rate,
+        &ch_layout, AV_SAMPLE_FMT_S16, sample_rate,
+        &ch_layout, AV_SAMPLE_FMT_FLTP, sample_rate,
         0, nullptr);
     assert(ret == 0);
 
@@ -63,6 +71,7 @@ AacDecoderState::AacDecoderState(uint32_t sample_rate, uint32_t channels) {
 
 AacDecoderState::~AacDecoderState() {
     av_frame_free(&frame);
+    av_packet_free(&packet);
     swr_free(&swr);
 }
 
@@ -77,7 +86,6 @@ uint32_t AacDecoderState::get(DecoderQuery query) {
 }
 
 bool AacDecoderState::send(const uint8_t *data, uint32_t size) {
-    AVPacket *packet = av_packet_alloc();
     packet->data = const_cast<uint8_t *>(data);
     packet->size = size;
 
@@ -88,7 +96,6 @@ bool AacDecoderState::send(const uint8_t *data, uint32_t size) {
     int len = ff_codec->cb.decode(context, frame, &got_frame, packet);
     assert(got_frame);
 
-    av_packet_free(&packet);
     if (len < 0) {
         LOG_WARN("Error sending Aac packet: {}.", codec_error_name(len));
         return false;
@@ -24,6 +24,49 @@ extern "C" {
 #include <util/log.h>
 
 #include <cassert>
+#include <map>
+#include <mutex>
+
+// how many opened contexts are kept for each key, enough for the titles creating a few decoders at the same time
+static constexpr size_t MAX_POOLED_CONTEXTS = 4;
+
+// opened contexts of the destroyed decoders, sorted by the settings they were opened with
+struct CodecContextPool {
+    std::mutex mutex;
+    std::map<std::string, std::vector<AVCodecContext *>> contexts;
+
+    ~CodecContextPool() {
+        for (auto &[_, key_contexts] : contexts) {
+            for (AVCodecContext *context : key_contexts)
+                avcodec_free_context(&context);
+        }
+    }
+};
+
+static CodecContextPool context_pool;
+
+AVCodecContext *acquire_pooled_context(const std::string &key) {
+    const std::lock_guard<std::mutex> lock(context_pool.mutex);
+    const auto it = context_pool.contexts.find(key);
+    if (it == context_pool.contexts.end() || it->second.empty())
+        return nullptr;
+
+    AVCodecContext *context = it->second.back();
+    it->second.pop_back();
+    // reset the context to decode a new stream
+    avcodec_flush_buffers(context);
+    return context;
+}
+
+static bool release_pooled_context(const std::string &key, AVCodecContext *context) {
+    const std::lock_guard<std::mutex> lock(context_pool.mutex);
+    std::vector<AVCodecContext *> &key_contexts = context_pool.contexts[key];
+    if (key_contexts.size() >= MAX_POOLED_CONTEXTS)
+        return false;
+
+    key_contexts.push_back(context);
+    return true;
+}
 
 uint32_t DecoderState::get(DecoderQuery query) {
     return 0;
@@ -38,6 +81,8 @@ void DecoderState::flush() {
 }
 
 DecoderState::~DecoderState() {
+    if (context && !pool_key.empty() && release_pooled_context(pool_key, context))
+        return;
     avcodec_free_context(&context);
 }
 
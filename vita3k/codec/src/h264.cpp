@@ -21,9 +21,12 @@
 
 extern "C" {
 #include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
 }
 
 #include <cassert>
+#include <utility>
+#include <vector>
 
 void copy_yuv_data_from_frame(AVFrame *frame, uint8_t *dest, const uint32_t width, const uint32_t height, bool is_p3) {
     for (uint32_t i = 0; i < height; i++) {
@@ -31,7 +34,24 @@ void copy_yuv_data_from_frame(AVFrame *frame, uint8_t *dest, const uint32_t widt
         dest += width;
     }
 
-    if (is_p3) {
+    if (frame->format == AV_PIX_FMT_NV12) {
+        // frames copied back from the hardware decoder already have U and V interleaved
+        if (is_p3) {
+            for (uint32_t plane = 0; plane < 2; plane++) {
+                for (uint32_t i = 0; i < height / 2; i++) {
+                    const uint8_t *src_uv = &frame->data[1][frame->linesize[1] * i];
+                    for (uint32_t j = 0; j < width / 2; j++)
+                        dest[j] = src_uv[j * 2 + plane];
+                    dest += width / 2;
+                }
+            }
+        } else {
+            for (uint32_t i = 0; i < height / 2; i++) {
+                memcpy(dest, &frame->data[1][frame->linesize[1] * i], width);
+                dest += width;
+            }
+        }
+    } else if (is_p3) {
         for (uint32_t i = 0; i < height / 2; i++) {
             memcpy(dest, &frame->data[1][frame->linesize[1] * i], width / 2);
             dest += width / 2;
@@ -54,6 +74,67 @@ void copy_yuv_data_from_frame(AVFrame *frame, uint8_t *dest, const uint32_t widt
     }
 }
 
+static AVPixelFormat get_hw_format(AVCodecContext *context, const AVPixelFormat *formats) {
+    const auto hw_format = static_cast<AVPixelFormat>(reinterpret_cast<intptr_t>(context->opaque));
+    for (const AVPixelFormat *format = formats; *format != AV_PIX_FMT_NONE; format++) {
+        if (*format == hw_format)
+            return *format;
+    }
+
+    // the hardware does not support this stream (profile or size), the decoder falls back to software
+    LOG_WARN("H264 hardware decoding is not available for this video, using software decoding.");
+    return avcodec_default_get_format(context, formats);
+}
+
+static std::vector<std::string> get_hwaccel_candidates(const std::string &hwaccel) {
+    if (hwaccel != "Auto")
+        return { hwaccel };
+
+#ifdef _WIN32
+    return { "d3d11va", "dxva2", "vulkan" };
+#elif defined(__APPLE__)
+    return { "videotoolbox" };
+#else
+    return { "vaapi", "vdpau", "vulkan" };
+#endif
+}
+
+// return the device context of the first hardware decoder which can be used and set its pixel format
+static AVBufferRef *create_hw_device(const AVCodec *codec, const std::string &hwaccel, int &hw_pixel_format) {
+    if (hwaccel.empty() || hwaccel == "None")
+        return nullptr;
+
+    for (const std::string &name : get_hwaccel_candidates(hwaccel)) {
+        const AVHWDeviceType type = av_hwdevice_find_type_by_name(name.c_str());
+        if (type == AV_HWDEVICE_TYPE_NONE) {
+            LOG_WARN("Unknown H264 hardware decoder {}.", name);
+            continue;
+        }
+
+        const AVCodecHWConfig *config = nullptr;
+        for (int i = 0; (config = avcodec_get_hw_config(codec, i)); i++) {
+            if ((config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) && config->device_type == type)
+                break;
+        }
+        if (!config)
+            continue;
+
+        AVBufferRef *device = nullptr;
+        const int error = av_hwdevice_ctx_create(&device, type, nullptr, nullptr, 0);
+        if (error < 0) {
+            LOG_WARN("Could not create the {} H264 hardware decoder: {}.", name, codec_error_name(error));
+            continue;
+        }
+
+        LOG_INFO("Using the {} H264 hardware decoder.", name);
+        hw_pixel_format = config->pix_fmt;
+        return device;
+    }
+
+    LOG_WARN("No H264 hardware decoder available for {}, using software decoding.", hwaccel);
+    return nullptr;
+}
+
 uint32_t H264DecoderState::buffer_size(DecoderSize size) {
     return size.width * size.height * 3 / 2;
 }
@@ -69,20 +150,18 @@ uint32_t H264DecoderState::get(DecoderQuery query) {
 bool H264DecoderState::send(const uint8_t *data, uint32_t size) {
     int error = 0;
 
-    std::vector<uint8_t> au_frame(size + AV_INPUT_BUFFER_PADDING_SIZE);
-    memcpy(au_frame.data(), data, size);
+    // the padding after the data must be zeroed
+    if (au_buffer.size() < size + AV_INPUT_BUFFER_PADDING_SIZE)
+        au_buffer.resize(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    memcpy(au_buffer.data(), data, size);
+    memset(au_buffer.data() + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 
-    AVPacket *packet = av_packet_alloc();
-    if (!packet) {
-        LOG_ERROR("Error allocating H264 packet.");
-        return false;
-    }
     error = av_parser_parse2(
         parser, // AVCodecParserContext *s,
         context, // AVCodecContext *avctx,
         &packet->data, // uint8_t **poutbuf,
         &packet->size, // int *poutbuf_size,
-        au_frame.data(), // const uint8_t *buf,
+        au_buffer.data(), // const uint8_t *buf,
         size, // int buf_size,
         pts == ~0ull ? AV_NOPTS_VALUE : pts, // int64_t pts,
         dts == ~0ull ? AV_NOPTS_VALUE : dts, // int64_t dts,
@@ -90,7 +169,6 @@ bool H264DecoderState::send(const uint8_t *data, uint32_t size) {
     );
     if (error < 0) {
         LOG_WARN("Error parsing H264 packet: {}.", codec_error_name(error));
-        av_packet_free(&packet);
         return false;
     }
 
@@ -98,7 +176,6 @@ bool H264DecoderState::send(const uint8_t *data, uint32_t size) {
     packet->dts = parser->dts;
 
     error = avcodec_send_packet(context, packet);
-    av_packet_free(&packet);
     if (error < 0) {
         LOG_WARN("Error sending H264 packet: {}.", codec_error_name(error));
         return false;
@@ -108,15 +185,26 @@ bool H264DecoderState::send(const uint8_t *data, uint32_t size) {
 }
 
 bool H264DecoderState::receive(uint8_t *data, DecoderSize *size) {
-    AVFrame *frame = av_frame_alloc();
-
     int error = avcodec_receive_frame(context, frame);
     if (error < 0) {
         LOG_WARN("Error receiving H264 frame: {}.", codec_error_name(error));
-        av_frame_free(&frame);
         return false;
     }
 
+    if (frame->format == hw_pixel_format) {
+        // the hardware usually outputs NV12, handled by copy_yuv_data_from_frame
+        error = av_hwframe_transfer_data(sw_frame, frame, 0);
+        if (error >= 0)
+            error = av_frame_copy_props(sw_frame, frame);
+        av_frame_unref(frame);
+        if (error < 0) {
+            LOG_WARN("Error transferring H264 frame from the hardware: {}.", codec_error_name(error));
+            av_frame_unref(sw_frame);
+            return false;
+        }
+        std::swap(frame, sw_frame);
+    }
+
     if (data) {
         copy_yuv_data_from_frame(frame, data, width_in, height_in, output_yuvp3);
     }
@@ -130,7 +218,7 @@ bool H264DecoderState::receive(uint8_t *data, DecoderSize *size) {
 
     pts_out = frame->pts;
 
-    av_frame_free(&frame);
+    av_frame_unref(frame);
     return true;
 }
 
@@ -160,7 +248,7 @@ void H264DecoderState::set_output_format(bool is_yuv_p3) {
     this->output_yuvp3 = is_yuv_p3;
 }
 
-H264DecoderState::H264DecoderState(uint32_t width, uint32_t height) {
+H264DecoderState::H264DecoderState(uint32_t width, uint32_t height, const std::string &hwaccel) {
     const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
     assert(codec);
 
@@ -168,15 +256,41 @@ H264DecoderState::H264DecoderState(uint32_t width, uint32_t height) {
     assert(parser);
     parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
 
+    packet = av_packet_alloc();
+    frame = av_frame_alloc();
+    sw_frame = av_frame_alloc();
+
+    pool_key = fmt::format("h264:{}:{}:{}", width, height, hwaccel);
+    context = acquire_pooled_context(pool_key);
+    if (context) {
+        // the hardware decoder of the pooled context is kept
+        if (context->hw_device_ctx) {
+            hw_device = av_buffer_ref(context->hw_device_ctx);
+            hw_pixel_format = static_cast<int>(reinterpret_cast<intptr_t>(context->opaque));
+        }
+        return;
+    }
+
     context = avcodec_alloc_context3(codec);
     assert(context);
     context->width = width;
     context->height = height;
 
+    hw_device = create_hw_device(codec, hwaccel, hw_pixel_format);
+    if (hw_device) {
+        context->hw_device_ctx = av_buffer_ref(hw_device);
+        context->opaque = reinterpret_cast<void *>(static_cast<intptr_t>(hw_pixel_format));
+        context->get_format = get_hw_format;
+    }
+
     int result = avcodec_open2(context, codec, nullptr);
     assert(result == 0);
 }
 
 H264DecoderState::~H264DecoderState() {
     av_parser_close(parser);
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    av_frame_free(&sw_frame);
+    av_buffer_unref(&hw_device);
 }
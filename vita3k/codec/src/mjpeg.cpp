@@ -29,6 +29,41 @@ extern "C" {
 
 #include <cassert>
 
+// Creating a context computes all its filters and tables, so the context is kept for the next
+// conversion, which is usually done with the same size and formats
+struct CachedSwsContext {
+    SwsContext *context = nullptr;
+
+    ~CachedSwsContext() {
+        sws_freeContext(context);
+    }
+
+    SwsContext *get(uint32_t width, uint32_t height, AVPixelFormat src_format, AVPixelFormat dst_format) {
+        context = sws_getCachedContext(context, width, height, src_format, width, height, dst_format,
+            SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND, nullptr, nullptr, nullptr);
+        assert(context);
+        return context;
+    }
+};
+
+static thread_local CachedSwsContext yuv_to_rgb_context;
+static thread_local CachedSwsContext rgb_to_yuv_context;
+
+static void convert_planes_to_rgb(const uint8_t *const planes[], const int strides[], AVPixelFormat format, uint8_t *rgba, uint32_t width, uint32_t height) {
+    SwsContext *context = yuv_to_rgb_context.get(width, height, format, AV_PIX_FMT_RGBA);
+
+    uint8_t *dst_slices[] = {
+        rgba,
+    };
+
+    const int dst_strides[] = {
+        static_cast<int>(width * 4),
+    };
+
+    int error = sws_scale(context, planes, strides, 0, height, dst_slices, dst_strides);
+    assert(error == height);
+}
+
 void convert_yuv_to_rgb(const uint8_t *yuv, uint8_t *rgba, uint32_t width, uint32_t height, const DecoderColorSpace color_space) {
     AVPixelFormat format = AV_PIX_FMT_YUVJ444P;
     int strides_divisor = 1;
@@ -52,9 +87,6 @@ void convert_yuv_to_rgb(const uint8_t *yuv, uint8_t *rgba, uint32_t width, uint3
         break;
     }
 
-    SwsContext *context = sws_getContext(width, height, format, width, height, AV_PIX_FMT_RGBA, SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND, nullptr, nullptr, nullptr);
-    assert(context);
-
     const uint8_t *slices[] = {
         &yuv[0], // Y Slice
         &yuv[width * height], // U Slice
@@ -67,17 +99,7 @@ void convert_yuv_to_rgb(const uint8_t *yuv, uint8_t *rgba, uint32_t width, uint3
         static_cast<int>(width) / strides_divisor,
     };
 
-    uint8_t *dst_slices[] = {
-        rgba,
-    };
-
-    const int dst_strides[] = {
-        static_cast<int>(width * 4),
-    };
-
-    int error = sws_scale(context, slices, strides, 0, height, dst_slices, dst_strides);
-    assert(error == height);
-    sws_freeContext(context);
+    convert_planes_to_rgb(slices, strides, format, rgba, width, height);
 }
 
 void convert_rgb_to_yuv(const uint8_t *rgba, uint8_t *yuv, uint32_t width, uint32_t height, const DecoderColorSpace color_space, int32_t inPitch) {
@@ -103,9 +125,7 @@ void convert_rgb_to_yuv(const uint8_t *rgba, uint8_t *yuv, uint32_t width, uint3
         break;
     }
 
-    SwsContext *context = sws_getContext(width, height, AV_PIX_FMT_RGBA, width, height, format,
-        SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND, nullptr, nullptr, nullptr);
-    assert(context);
+    SwsContext *context = rgb_to_yuv_context.get(width, height, AV_PIX_FMT_RGBA, format);
 
     const uint8_t *slices[] = {
         rgba,
@@ -128,7 +148,6 @@ void convert_rgb_to_yuv(const uint8_t *rgba, uint8_t *yuv, uint32_t width, uint3
     };
 
     int error = sws_scale(context, slices, strides, 0, height, dst_slices, dst_strides);
-    sws_freeContext(context);
     assert(error == height);
 }
 
@@ -340,6 +359,54 @@ bool MjpegDecoderState::receive(uint8_t *data, DecoderSize *size) {
     return true;
 }
 
+bool MjpegDecoderState::receive_rgba(uint8_t *rgba, uint32_t rgba_size, DecoderSize *size) {
+    AVFrame *frame = av_frame_alloc();
+    int error = avcodec_receive_frame(context, frame);
+    if (error < 0) {
+        LOG_WARN("Error receiving Mjpeg frame: {}.", codec_error_name(error));
+        av_frame_free(&frame);
+        return false;
+    }
+
+    // the planes are read as limited range like convert_yuv_to_rgb does with the planes given by receive
+    AVPixelFormat format;
+    switch (frame->format) {
+    case AV_PIX_FMT_YUVJ444P:
+        format = AV_PIX_FMT_YUV444P;
+        this->color_space_out = COLORSPACE_YUV444P;
+        break;
+    case AV_PIX_FMT_YUVJ422P:
+        format = AV_PIX_FMT_YUV422P;
+        this->color_space_out = COLORSPACE_YUV422P;
+        break;
+    case AV_PIX_FMT_YUVJ420P:
+        format = AV_PIX_FMT_YUV420P;
+        this->color_space_out = COLORSPACE_YUV420P;
+        break;
+    default:
+        LOG_WARN("Mjpeg frame is in unimplemented format {}.", frame->format);
+        av_frame_free(&frame);
+        return false;
+    }
+
+    if (static_cast<uint64_t>(frame->width) * frame->height * 4 > rgba_size) {
+        LOG_WARN("Mjpeg frame of size {}x{} does not fit in an output of {} bytes.", frame->width, frame->height, rgba_size);
+        av_frame_free(&frame);
+        return false;
+    }
+
+    convert_planes_to_rgb(frame->data, frame->linesize, format, rgba, frame->width, frame->height);
+
+    if (size) {
+        size->width = frame->width;
+        size->height = frame->height;
+    }
+
+    av_frame_free(&frame);
+
+    return true;
+}
+
 DecoderColorSpace MjpegDecoderState::get_color_space() {
     return this->color_space_out;
 }
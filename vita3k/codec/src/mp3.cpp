@@ -131,22 +131,22 @@ uint32_t Mp3DecoderState::get(DecoderQuery query) {
 }
 
 bool Mp3DecoderState::send(const uint8_t *data, uint32_t size) {
-    AVPacket *packet = av_packet_alloc();
-
     es_size_used = get_mp3_data_size(data);
     if (es_size_used != 0)
         size = std::min(size, es_size_used);
     else
         es_size_used = size;
 
-    std::vector<uint8_t> temporary(size + AV_INPUT_BUFFER_PADDING_SIZE);
-    memcpy(temporary.data(), data, size);
+    // the padding after the data must be zeroed
+    if (es_buffer.size() < size + AV_INPUT_BUFFER_PADDING_SIZE)
+        es_buffer.resize(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    memcpy(es_buffer.data(), data, size);
+    memset(es_buffer.data() + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 
     packet->size = size;
-    packet->data = temporary.data();
+    packet->data = es_buffer.data();
 
     int err = avcodec_send_packet(context, packet);
-    av_packet_free(&packet);
     if (err < 0) {
         LOG_WARN("Error sending Mp3 packet: {}.", log_hex(static_cast<uint32_t>(err)));
         return false;
@@ -156,12 +156,9 @@ bool Mp3DecoderState::send(const uint8_t *data, uint32_t size) {
 }
 
 bool Mp3DecoderState::receive(uint8_t *data, DecoderSize *size) {
-    AVFrame *frame = av_frame_alloc();
-
     int err = avcodec_receive_frame(context, frame);
     if (err < 0) {
         LOG_WARN("Error receiving Mp3 frame: {}.", log_hex(static_cast<uint32_t>(err)));
-        av_frame_free(&frame);
         return false;
     }
 
@@ -181,7 +178,7 @@ bool Mp3DecoderState::receive(uint8_t *data, DecoderSize *size) {
         size->samples = frame->nb_samples;
     }
 
-    av_frame_free(&frame);
+    av_frame_unref(frame);
     return true;
 }
 
@@ -189,6 +186,14 @@ Mp3DecoderState::Mp3DecoderState(uint32_t channels) {
     codec = avcodec_find_decoder(AV_CODEC_ID_MP3);
     assert(codec);
 
+    frame = av_frame_alloc();
+    packet = av_packet_alloc();
+
+    pool_key = fmt::format("mp3:{}", channels);
+    context = acquire_pooled_context(pool_key);
+    if (context)
+        return;
+
     context = avcodec_alloc_context3(codec);
     assert(context);
 
@@ -202,8 +207,6 @@ Mp3DecoderState::Mp3DecoderState(uint32_t channels) {
 }
 
 Mp3DecoderState::~Mp3DecoderState() {
-    avcodec_close(context);
-    av_free(context);
-
-    context = nullptr;
+    av_frame_free(&frame);
+    av_packet_free(&packet);
 }
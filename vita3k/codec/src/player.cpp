@@ -28,6 +28,10 @@ extern "C" {
 #include <cassert>
 #include <chrono>
 
+// number of frames decoded ahead for each stream
+constexpr size_t VIDEO_QUEUE_SIZE = 4;
+constexpr size_t AUDIO_QUEUE_SIZE = 16;
+
 uint64_t PlayerState::get_framerate_microseconds() {
     AVRational rational = format->streams[video_stream_id]->avg_frame_rate;
     return static_cast<float>(rational.den) / static_cast<float>(rational.num) * 1000000;
@@ -46,6 +50,17 @@ void PlayerState::pop_video() {
 }
 
 void PlayerState::free_video() {
+    if (decode_thread.joinable()) {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            stop_decoding = true;
+        }
+        space_available.notify_all();
+        decode_thread.join();
+    }
+    video_frames.clear();
+    audio_frames.clear();
+
     if (video_context)
         avcodec_free_context(&video_context);
 
@@ -100,7 +115,19 @@ void PlayerState::switch_video(const std::string &path) {
         audio_context = avcodec_alloc_context3(audio_codec);
         avcodec_parameters_to_context(audio_context, audio_stream->codecpar);
         avcodec_open2(audio_context, audio_codec, nullptr);
+
+        // known before the first frame is decoded
+        last_channels = audio_context->ch_layout.nb_channels;
+        last_sample_rate = audio_context->sample_rate;
+        last_sample_count = audio_context->frame_size;
     }
+
+    stop_decoding = false;
+    video_ended = false;
+    audio_ended = false;
+    video_frames.capacity = VIDEO_QUEUE_SIZE;
+    audio_frames.capacity = AUDIO_QUEUE_SIZE;
+    decode_thread = std::thread(&PlayerState::decode_loop, this);
 }
 
 bool PlayerState::next_packet(int32_t stream_id) {
@@ -138,100 +165,182 @@ bool PlayerState::next_packet(int32_t stream_id) {
     }
 }
 
-std::vector<int16_t> PlayerState::receive_audio() {
-    if (audio_stream_id < 0)
-        return {};
+bool PlayerState::decode_audio(AVFrame *frame) {
+    while (true) {
+        const int error = avcodec_receive_frame(audio_context, frame);
 
-    if (video_playing.empty())
-        return {};
+        if (error == AVERROR(EAGAIN) && next_packet(audio_stream_id))
+            continue;
 
-    int error;
-    AVFrame *frame = av_frame_alloc();
-    std::vector<int16_t> data;
+        if (error != 0)
+            return false;
+
+        break;
+    }
+
+    LOG_WARN_IF(frame->format != AV_SAMPLE_FMT_FLTP, "Unknown audio format {}.", frame->format);
+
+    PlayerFrame<int16_t> decoded{
+        .timestamp = static_cast<uint64_t>(frame->best_effort_timestamp),
+        .channels = static_cast<uint32_t>(frame->ch_layout.nb_channels),
+        .sample_rate = static_cast<uint32_t>(frame->sample_rate),
+        .sample_count = static_cast<uint32_t>(frame->nb_samples),
+    };
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        decoded.data = audio_frames.get_buffer();
+    }
+    const size_t previous_capacity = decoded.data.capacity();
+    decoded.data.resize(frame->nb_samples * frame->ch_layout.nb_channels);
+
+    for (int a = 0; a < frame->nb_samples; a++) {
+        for (int b = 0; b < frame->ch_layout.nb_channels; b++) {
+            auto *frame_data = reinterpret_cast<float *>(frame->data[b]);
+            float current_sample = frame_data[a];
+            int16_t pcm_sample = current_sample * INT16_MAX;
+
+            decoded.data[a * frame->ch_layout.nb_channels + b] = pcm_sample;
+        }
+    }
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    audio_frames.push(std::move(decoded), previous_capacity);
+    return true;
+}
+
+bool PlayerState::decode_video(AVFrame *frame) {
     while (true) {
-        error = avcodec_receive_frame(audio_context, frame);
+        const int error = avcodec_receive_frame(video_context, frame);
 
-        if (error == AVERROR(EAGAIN) && next_packet(audio_stream_id))
+        if (error == AVERROR(EAGAIN) && next_packet(video_stream_id))
             continue;
 
-        if (error != 0) {
-            if (videos_queue.empty()) {
-                // Stop playing videos or
-                video_playing.clear();
+        if (error != 0)
+            return false;
+
+        break;
+    }
+
+    PlayerFrame<uint8_t> decoded{
+        .timestamp = static_cast<uint64_t>(frame->best_effort_timestamp),
+    };
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        decoded.data = video_frames.get_buffer();
+    }
+    const size_t previous_capacity = decoded.data.capacity();
+    decoded.data.resize(H264DecoderState::buffer_size(
+        { { static_cast<uint32_t>(video_context->width), static_cast<uint32_t>(video_context->height) } }));
+    copy_yuv_data_from_frame(frame, decoded.data.data(), frame->width, frame->height, false);
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    video_frames.push(std::move(decoded), previous_capacity);
+    return true;
+}
+
+void PlayerState::decode_loop() {
+    AVFrame *frame = av_frame_alloc();
+    bool video_done = video_stream_id < 0;
+    bool audio_done = audio_stream_id < 0;
+
+    while (!video_done || !audio_done) {
+        bool want_video;
+        bool want_audio;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // wait until one of the streams is short of frames
+            space_available.wait(lock, [&] {
+                return stop_decoding || (!video_done && !video_frames.is_full()) || (!audio_done && !audio_frames.is_full());
+            });
+            if (stop_decoding)
                 break;
-            } else {
-                // Play the next video (if there is any).
-                switch_video(videos_queue.front());
-                videos_queue.pop();
-                continue;
+
+            want_video = !video_done && !video_frames.is_full();
+            want_audio = !audio_done && !audio_frames.is_full();
+            // fill the queue which is the emptiest compared to its capacity first
+            if (want_video && want_audio)
+                want_video = video_frames.frames.size() * audio_frames.capacity <= audio_frames.frames.size() * video_frames.capacity;
+        }
+
+        if (want_video) {
+            video_done = !decode_video(frame);
+            if (video_done) {
+                const std::lock_guard<std::mutex> lock(mutex);
+                video_ended = true;
+            }
+        } else if (want_audio) {
+            audio_done = !decode_audio(frame);
+            if (audio_done) {
+                const std::lock_guard<std::mutex> lock(mutex);
+                audio_ended = true;
             }
         }
+    }
 
-        LOG_WARN_IF(frame->format != AV_SAMPLE_FMT_FLTP, "Unknown audio format {}.", frame->format);
+    av_frame_free(&frame);
+}
 
-        last_channels = frame->ch_layout.nb_channels;
-        last_sample_count = frame->nb_samples;
-        last_sample_rate = frame->sample_rate;
+void PlayerState::end_of_video() {
+    if (videos_queue.empty()) {
+        // Stop playing videos or
+        video_playing.clear();
+    } else {
+        // Play the next video (if there is any).
+        pop_video();
+    }
+}
+
+bool PlayerState::receive_audio() {
+    if (audio_stream_id < 0)
+        return false;
 
-        data.resize(frame->nb_samples * frame->ch_layout.nb_channels);
+    if (video_playing.empty())
+        return false;
 
-        for (int a = 0; a < frame->nb_samples; a++) {
-            for (int b = 0; b < frame->ch_layout.nb_channels; b++) {
-                auto *frame_data = reinterpret_cast<float *>(frame->data[b]);
-                float current_sample = frame_data[a];
-                int16_t pcm_sample = current_sample * INT16_MAX;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!audio_frames.frames.empty()) {
+            audio_frames.pop(audio_frame);
+            space_available.notify_one();
 
-                data[a * frame->ch_layout.nb_channels + b] = pcm_sample;
-            }
+            last_channels = audio_frame.channels;
+            last_sample_count = audio_frame.sample_count;
+            last_sample_rate = audio_frame.sample_rate;
+            return true;
         }
 
-        break;
+        // the decode thread is still running, it will have a frame later
+        if (!audio_ended)
+            return false;
     }
 
-    av_frame_free(&frame);
-    return data;
+    end_of_video();
+    return false;
 }
 
-std::vector<uint8_t> PlayerState::receive_video() {
+bool PlayerState::receive_video() {
     if (video_stream_id < 0)
-        return {};
+        return false;
 
     if (video_playing.empty())
-        return {};
+        return false;
 
-    int error;
-    AVFrame *frame = av_frame_alloc();
-    std::vector<uint8_t> data;
-    while (true) {
-        error = avcodec_receive_frame(video_context, frame);
-
-        if (error == AVERROR(EAGAIN) && next_packet(video_stream_id))
-            continue;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!video_frames.frames.empty()) {
+            video_frames.pop(video_frame);
+            space_available.notify_one();
 
-        if (error != 0) {
-            if (videos_queue.empty()) {
-                // Stop playing videos or
-                video_playing.clear();
-                break;
-            } else {
-                // Play the next video (if there is any).
-                switch_video(videos_queue.front());
-                videos_queue.pop();
-                continue;
-            }
+            last_timestamp = video_frame.timestamp;
+            return true;
         }
 
-        last_timestamp = frame->best_effort_timestamp;
-
-        data.resize(H264DecoderState::buffer_size(
-            { { static_cast<uint32_t>(video_context->width), static_cast<uint32_t>(video_context->height) } }));
-        copy_yuv_data_from_frame(frame, data.data(), frame->width, frame->height, false);
-
-        break;
+        if (!video_ended)
+            return false;
     }
 
-    av_frame_free(&frame);
-    return data;
+    end_of_video();
+    return false;
 }
 
 void PlayerState::queue(const std::string &path) {
@@ -248,6 +357,8 @@ void PlayerState::queue(const std::string &path) {
 
 PlayerState::~PlayerState() {
     free_video();
+    TRACK_HOST_FREE(&video_frames);
+    TRACK_HOST_FREE(&audio_frames);
 
     video_playing = "";
     videos_queue = {};
@@ -23,10 +23,14 @@
 #include <emuenv/state.h>
 #include <gui/state.h>
 
+#include <util/mapped_file.h>
 #include <util/net_utils.h>
 
 #include <pugixml.hpp>
 
+#include <cstring>
+#include <fstream>
+
 enum LabelIdState {
     Nothing = 1260231569, // 0x4b1d9b91
     Bootable = 1344750319, // 0x502742ef
@@ -42,42 +46,87 @@ namespace compat {
 static std::string db_updated_at;
 static const uint32_t db_version = 1;
 
-bool load_app_compat_db(GuiState &gui, EmuEnvState &emuenv) {
-    const auto app_compat_db_path = emuenv.cache_path / "app_compat_db.xml";
-    if (!fs::exists(app_compat_db_path)) {
-        LOG_WARN("Compatibility database not found at {}.", app_compat_db_path.string());
+// The XML database is converted once to this binary cache, which is mapped and read as is until the XML changes
+static constexpr char COMPAT_CACHE_MAGIC[4] = { 'V', '3', 'K', 'C' };
+static constexpr uint32_t COMPAT_CACHE_VERSION = 1;
+
+struct CompatCacheHeader {
+    char magic[4];
+    uint32_t cache_version;
+    uint32_t db_version;
+    uint32_t entry_count;
+    // size and last write time of the XML the cache was made from
+    uint64_t xml_size;
+    int64_t xml_write_time;
+    char db_updated_at[32];
+};
+
+struct CompatCacheEntry {
+    char title_id[16];
+    uint32_t issue_id;
+    int32_t state;
+    int64_t updated_at;
+};
+
+static bool load_compat_cache(const fs::path &cache_path, uint64_t xml_size, int64_t xml_write_time, std::map<std::string, Compatibility> &compat_db, std::string &updated_at) {
+    MappedFile file;
+    if (!file.open(cache_path) || file.size() < sizeof(CompatCacheHeader))
         return false;
-    }
 
-    // Parse and load file of compatibility database
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(app_compat_db_path.c_str());
-    if (!result) {
-        LOG_ERROR("Compatibility database {} could not be loaded: {}", app_compat_db_path.string(), result.description());
+    CompatCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, COMPAT_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.cache_version != COMPAT_CACHE_VERSION
+        || header.db_version != db_version || header.xml_size != xml_size || header.xml_write_time != xml_write_time
+        || file.size() != sizeof(header) + static_cast<size_t>(header.entry_count) * sizeof(CompatCacheEntry))
         return false;
-    }
 
-    // Check compatibility database version
-    const auto compatibility = doc.child("compatibility");
-    const auto version = compatibility.attribute("version").as_uint();
-    if (db_version != version) {
-        LOG_WARN("Compatibility database version {} is outdated, download it again.", version);
-        return update_app_compat_db(gui, emuenv);
+    header.db_updated_at[sizeof(header.db_updated_at) - 1] = '\0';
+    updated_at = header.db_updated_at;
+
+    // the entries are sorted by title id, so each one is inserted at the end of the map
+    const uint8_t *entries = file.data() + sizeof(header);
+    for (uint32_t i = 0; i < header.entry_count; i++) {
+        CompatCacheEntry entry;
+        memcpy(&entry, entries + i * sizeof(CompatCacheEntry), sizeof(entry));
+        entry.title_id[sizeof(entry.title_id) - 1] = '\0';
+        compat_db.emplace_hint(compat_db.end(), entry.title_id, Compatibility{ entry.issue_id, static_cast<CompatibilityState>(entry.state), static_cast<time_t>(entry.updated_at) });
     }
 
-    // Check if compatibility database is up to date in first load
-    if (db_updated_at.empty()) {
-        db_updated_at = compatibility.attribute("db_updated_at").as_string();
-        if (update_app_compat_db(gui, emuenv))
-            return true;
+    return true;
+}
+
+static void save_compat_cache(const fs::path &cache_path, uint64_t xml_size, int64_t xml_write_time, const std::map<std::string, Compatibility> &compat_db, const std::string &updated_at) {
+    CompatCacheHeader header{};
+    memcpy(header.magic, COMPAT_CACHE_MAGIC, sizeof(header.magic));
+    header.cache_version = COMPAT_CACHE_VERSION;
+    header.db_version = db_version;
+    header.xml_size = xml_size;
+    header.xml_write_time = xml_write_time;
+    strncpy(header.db_updated_at, updated_at.c_str(), sizeof(header.db_updated_at) - 1);
+
+    std::vector<CompatCacheEntry> entries;
+    entries.reserve(compat_db.size());
+    for (const auto &[title_id, compat] : compat_db) {
+        if (title_id.size() >= sizeof(CompatCacheEntry::title_id))
+            continue;
+        CompatCacheEntry entry{};
+        memcpy(entry.title_id, title_id.data(), title_id.size());
+        entry.issue_id = compat.issue_id;
+        entry.state = compat.state;
+        entry.updated_at = static_cast<int64_t>(compat.updated_at);
+        entries.push_back(entry);
     }
+    header.entry_count = static_cast<uint32_t>(entries.size());
 
-    // Clear old compat database
-    gui.compat.compat_db_loaded = false;
-    gui.compat.app_compat_db.clear();
+    std::ofstream file(cache_path.string(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(CompatCacheEntry));
+    if (!file)
+        LOG_WARN("Failed to write the compatibility database cache {}", cache_path.string());
+}
 
-    //  Load compatibility database
-    for (const auto &app : doc.child("compatibility")) {
+static void load_compat_xml(const pugi::xml_node &compatibility, EmuEnvState &emuenv, std::map<std::string, Compatibility> &app_compat_db) {
+    for (const auto &app : compatibility) {
         const std::string title_id = app.attribute("title_id").as_string();
         const auto issue_id = app.child("issue_id").text().as_uint();
 
@@ -111,11 +160,59 @@ bool load_app_compat_db(GuiState &gui, EmuEnvState &emuenv) {
             LOG_WARN_IF(emuenv.cfg.log_compat_warn, "App with Title ID {} has an issue but no status label. Please check GitHub issue {} and request a status label be added.", title_id, issue_id);
 
         // Check if app already exists in compatibility database
-        if (gui.compat.app_compat_db.contains(title_id))
-            LOG_WARN_IF(emuenv.cfg.log_compat_warn, "App with Title ID {} already exists in compatibility database. Please check and close GitHub issue {}.", title_id, gui.compat.app_compat_db[title_id].issue_id);
+        if (app_compat_db.contains(title_id))
+            LOG_WARN_IF(emuenv.cfg.log_compat_warn, "App with Title ID {} already exists in compatibility database. Please check and close GitHub issue {}.", title_id, app_compat_db[title_id].issue_id);
 
-        gui.compat.app_compat_db[title_id] = { issue_id, state, updated_at };
+        app_compat_db[title_id] = { issue_id, state, updated_at };
     }
+}
+
+bool load_app_compat_db(GuiState &gui, EmuEnvState &emuenv) {
+    const auto app_compat_db_path = emuenv.cache_path / "app_compat_db.xml";
+    if (!fs::exists(app_compat_db_path)) {
+        LOG_WARN("Compatibility database not found at {}.", app_compat_db_path.string());
+        return false;
+    }
+
+    boost::system::error_code error;
+    const uint64_t xml_size = fs::file_size(app_compat_db_path, error);
+    const int64_t xml_write_time = static_cast<int64_t>(fs::last_write_time(app_compat_db_path, error));
+    const auto app_compat_db_cache_path = emuenv.cache_path / "app_compat_db.bin";
+
+    std::map<std::string, Compatibility> app_compat_db;
+    std::string xml_updated_at;
+    if (!load_compat_cache(app_compat_db_cache_path, xml_size, xml_write_time, app_compat_db, xml_updated_at)) {
+        // Parse and load file of compatibility database
+        pugi::xml_document doc;
+        pugi::xml_parse_result result = doc.load_file(app_compat_db_path.c_str());
+        if (!result) {
+            LOG_ERROR("Compatibility database {} could not be loaded: {}", app_compat_db_path.string(), result.description());
+            return false;
+        }
+
+        // Check compatibility database version
+        const auto compatibility = doc.child("compatibility");
+        const auto version = compatibility.attribute("version").as_uint();
+        if (db_version != version) {
+            LOG_WARN("Compatibility database version {} is outdated, download it again.", version);
+            return update_app_compat_db(gui, emuenv);
+        }
+
+        xml_updated_at = compatibility.attribute("db_updated_at").as_string();
+        load_compat_xml(compatibility, emuenv, app_compat_db);
+        save_compat_cache(app_compat_db_cache_path, xml_size, xml_write_time, app_compat_db, xml_updated_at);
+    }
+
+    // Check if compatibility database is up to date in first load
+    if (db_updated_at.empty()) {
+        db_updated_at = xml_updated_at;
+        if (update_app_compat_db(gui, emuenv))
+            return true;
+    }
+
+    // Replace old compat database
+    gui.compat.compat_db_loaded = false;
+    gui.compat.app_compat_db = std::move(app_compat_db);
 
     // Update compatibility status of all user apps
     for (auto &app : gui.app_selector.user_apps)
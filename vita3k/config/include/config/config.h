@@ -64,24 +64,44 @@ enum PerfomanceOverleyPosition {
     code(bool, "show-live-area-screen", true, show_live_area_screen)                                    \
     code(int, "icon-size", 64, icon_size)                                                               \
     code(bool, "archive-log", false, archive_log)                                                       \
+    code(bool, "log-drop-on-overflow", false, log_drop_on_overflow)                                     \
+    code(bool, "binary-import-log", false, binary_import_log)                                           \
+    code(bool, "metrics-export", false, metrics_export)                                                 \
+    code(bool, "track-host-allocations", false, track_host_allocations)                                 \
+    code(int, "gpu-capture-frames", 60, gpu_capture_frames)                                             \
+    code(std::string, "recording-video-encoder", "Auto", recording_video_encoder)                       \
+    code(int, "recording-bitrate", 20000, recording_bitrate)                                            \
     code(std::string, "backend-renderer", "OpenGL", backend_renderer)                                   \
     code(int, "gpu-idx", 0, gpu_idx)                                                                    \
     code(bool, "high-accuracy", true, high_accuracy)                                                    \
     code(int, "resolution-multiplier", 1, resolution_multiplier)                                        \
     code(bool, "disable-surface-sync", true, disable_surface_sync)                                      \
+    code(bool, "async-surface-sync", false, async_surface_sync)                                         \
     code(std::string, "screen-filter", "Bilinear", screen_filter)                                       \
     code(bool, "v-sync", true, v_sync)                                                                  \
+    code(bool, "precise-vblank", true, precise_vblank)                                                  \
+    code(bool, "low-latency", false, low_latency)                                                       \
+    code(int, "ctrl-poll-rate", 0, ctrl_poll_rate)                                                      \
     code(int, "anisotropic-filtering", 1, anisotropic_filtering)                                        \
     code(bool, "texture-cache", true, texture_cache)                                                    \
     code(bool, "async-pipeline-compilation", true, async_pipeline_compilation)                          \
     code(bool, "show-compile-shaders", true, show_compile_shaders)                                      \
     code(bool, "hashless-texture-cache", false, hashless_texture_cache)                                 \
+    code(bool, "async-texture-decode", false, async_texture_decode)                                     \
+    code(bool, "gpu-texture-decode", false, gpu_texture_decode)                                         \
+    code(bool, "gpu-mipmap-generation", false, gpu_mipmap_generation)                                   \
+    code(bool, "texture-disk-cache", false, texture_disk_cache)                                         \
+    code(int, "texture-cache-budget", 0, texture_cache_budget)                                          \
     code(bool, "import-textures", false, import_textures)                                               \
     code(bool, "export-textures", false, export_textures)                                               \
     code(bool, "export-as-png", true, export_as_png)                                                    \
+    code(bool, "async-texture-import", true, async_texture_import)                                      \
+    code(bool, "prewarm-texture-import", false, prewarm_texture_import)                                 \
     code(bool, "boot-apps-full-screen", false, boot_apps_full_screen)                                   \
     code(std::string, "audio-backend", "SDL", audio_backend)                                            \
+    code(int, "audio-resampler-quality", 1, audio_resampler_quality)                                    \
     code(bool, "ngs-enable", true, ngs_enable)                                                          \
+    code(std::string, "video-decoder-hwaccel", "None", video_decoder_hwaccel)                           \
     code(int, "sys-button", static_cast<int>(SCE_SYSTEM_PARAM_ENTER_BUTTON_CROSS), sys_button)          \
     code(int, "sys-lang", static_cast<int>(SCE_SYSTEM_PARAM_LANG_ENGLISH_US), sys_lang)                 \
     code(int, "sys-date-format", (int)SCE_SYSTEM_PARAM_DATE_FORMAT_MMDDYYYY, sys_date_format)           \
@@ -94,12 +114,24 @@ enum PerfomanceOverleyPosition {
     code(int, "log-level", static_cast<int>(spdlog::level::trace), log_level)                           \
     code(std::string, "cpu-backend", "Dynarmic", cpu_backend)                                           \
     code(bool, "cpu-opt", true, cpu_opt)                                                                \
+    code(bool, "jit-cache", true, jit_cache)                                                            \
+    code(bool, "libc-fast-paths", false, libc_fast_paths)                                               \
+    code(bool, "slab-heap", false, slab_heap)                                                           \
+    code(bool, "host-thread-mapping", true, host_thread_mapping)                                        \
+    code(bool, "scalable-exclusive-monitor", false, scalable_exclusive_monitor)                         \
+    code(bool, "huge-pages", false, huge_pages)                                                         \
+    code(bool, "write-watch", false, write_watch)                                                       \
+    code(bool, "merge-guest-memory", false, merge_guest_memory)                                         \
+    code(bool, "module-image-cache", true, module_image_cache)                                          \
+    code(int, "guest-threads-per-core", 0, guest_threads_per_core)                                      \
+    code(std::string, "host-cpu-set", std::string{}, host_cpu_set)                                      \
     code(std::string, "pref-path", std::string{}, pref_path)                                            \
     code(bool, "discord-rich-presence", true, discord_rich_presence)                                    \
     code(bool, "wait-for-debugger", false, wait_for_debugger)                                           \
     code(bool, "color-surface-debug", false, color_surface_debug)                                       \
     code(bool, "show-touchpad-cursor", true, show_touchpad_cursor)                                      \
     code(bool, "performance-overlay", false, performance_overlay)                                       \
+    code(bool, "guest-profiler", false, guest_profiler)                                                 \
     code(int, "perfomance-overlay-detail", static_cast<int>(MINIMUM), performance_overlay_detail)       \
     code(int, "perfomance-overlay-position", static_cast<int>(TOP_LEFT), performance_overlay_position)  \
     code(int, "keyboard-button-select", 229, keyboard_button_select)                                    \
@@ -131,6 +163,11 @@ enum PerfomanceOverleyPosition {
     code(int, "keyboard-gui-fullscreen", 68, keyboard_gui_fullscreen)                                   \
     code(int, "keyboard-gui-toggle-touch", 23, keyboard_gui_toggle_touch)                               \
     code(int, "keyboard-toggle-texture-replacement", 0, keyboard_toggle_texture_replacement)            \
+    code(int, "keyboard-save-snapshot", 0, keyboard_save_snapshot)                                      \
+    code(int, "keyboard-load-snapshot", 0, keyboard_load_snapshot)                                      \
+    code(int, "keyboard-gpu-capture", 0, keyboard_gpu_capture)                                          \
+    code(int, "keyboard-gameplay-recording", 0, keyboard_gameplay_recording)                            \
+    code(int, "keyboard-screenshot", 0, keyboard_screenshot)                                            \
     code(std::string, "user-id", std::string{}, user_id)                                                \
     code(bool, "user-auto-connect", false, auto_user_login)                                             \
     code(std::string, "user-lang", std::string{}, user_lang)                                            \
@@ -140,6 +177,8 @@ enum PerfomanceOverleyPosition {
     code(bool, "asia-font-support", false, asia_font_support)                                           \
     code(bool, "shader-cache", true, shader_cache)                                                      \
     code(bool, "spirv-shader", false, spirv_shader)                                                     \
+    code(bool, "optimize-shaders", false, optimize_shaders)                                             \
+    code(bool, "null-renderer-shaders", true, null_renderer_shaders)                                    \
     code(uint64_t, "current-ime-lang", 4, current_ime_lang)                                             \
     code(int, "psn-signed-in", false, psn_signed_in)                                                    \
     code(bool, "http-enable", true, http_enable)                                                        \
@@ -69,6 +69,12 @@ private:
             run_app_path = rhs.run_app_path;
         if (rhs.recompile_shader_path.has_value())
             recompile_shader_path = rhs.recompile_shader_path;
+        if (rhs.replay_capture_path.has_value())
+            replay_capture_path = rhs.replay_capture_path;
+        if (rhs.record_input_path.has_value())
+            record_input_path = rhs.record_input_path;
+        if (rhs.replay_input_path.has_value())
+            replay_input_path = rhs.replay_input_path;
         if (rhs.delete_title_id.has_value())
             delete_title_id = rhs.delete_title_id;
         if (rhs.pkg_path.has_value())
@@ -93,6 +99,9 @@ public:
     std::optional<fs::path> content_path;
     std::optional<std::string> run_app_path;
     std::optional<std::string> recompile_shader_path;
+    std::optional<std::string> replay_capture_path;
+    std::optional<std::string> record_input_path;
+    std::optional<std::string> replay_input_path;
     std::optional<std::string> delete_title_id;
     std::optional<std::string> pkg_path;
     std::optional<std::string> pkg_zrif;
@@ -116,6 +125,8 @@ public:
     struct CurrentConfig {
         std::string cpu_backend;
         bool cpu_opt = true;
+        bool libc_fast_paths = false;
+        bool slab_heap = false;
         int modules_mode = ModulesMode::AUTOMATIC;
         std::vector<std::string> lle_modules = {};
         bool pstv_mode = false;
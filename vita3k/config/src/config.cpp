@@ -154,6 +154,12 @@ ExitCode init_config(Config &cfg, int argc, char **argv, const Root &root_paths)
         ->default_str({})->check(CLI::IsMember(get_file_set(fs::path(cfg.pref_path) / "ux0/app")))->group("Input");
     input->add_option("--recompile-shader,-s", command_line.recompile_shader_path, "Recompile the given PS Vita shader (GXP format) to SPIR_V / GLSL and quit")
         ->default_str({})->group("Input");
+    input->add_option("--replay-capture", command_line.replay_capture_path, "Replay a GPU capture with the selected renderer backend, log the CPU and GPU time of each frame and quit")
+        ->default_str({})->group("Input");
+    auto input_record = input->add_option("--record-input", command_line.record_input_path, "Record the input given to the app on each vblank to the given file")
+        ->default_str({})->group("Input");
+    input->add_option("--replay-input", command_line.replay_input_path, "Give the input recorded in the given file to the app instead of the input of the host devices")
+        ->default_str({})->excludes(input_record)->group("Input");
     input->add_option("--deleted-id,-d", command_line.delete_title_id, "Title ID of installed app to delete")
         ->default_str({})->check(CLI::IsMember(get_file_set(fs::path(cfg.pref_path) / "ux0/app")))->group("Input");
     input->add_option("--firmware", command_line.pup_path, "Path to the firmware file (.pup extension) to install");
@@ -167,8 +173,8 @@ ExitCode init_config(Config &cfg, int argc, char **argv, const Root &root_paths)
     auto config = app.add_option_group("Configuration", "Modify Vita3K's config.yml file");
     config->add_flag("--" + cfg[e_archive_log] + ",-A", command_line.archive_log, "Make a duplicate of the log file with TITLE_ID and Game ID as title")
         ->group("Logging");
-    config->add_option("--" + cfg[e_backend_renderer] + ",-B", command_line.backend_renderer, "Renderer backend to use")
-        ->ignore_case()->check(CLI::IsMember(std::set<std::string>{ "OpenGL", "Vulkan" }))->group("Vita Emulation");
+    config->add_option("--" + cfg[e_backend_renderer] + ",-B", command_line.backend_renderer, "Renderer backend to use, Null runs the app headless without rendering anything")
+        ->ignore_case()->check(CLI::IsMember(std::set<std::string>{ "OpenGL", "Vulkan", "Null" }))->group("Vita Emulation");
     config->add_flag("--" + cfg[e_color_surface_debug] + ",-C", command_line.color_surface_debug, "Save color surfaces")
         ->group("Vita Emulation");
     config->add_option("--config-location,-c", command_line.config_path, "Get a configuration file from a given location. If a filename is given, it must end with \".yml\", otherwise it will be assumed to be a directory. \nDefault loaded: <Vita3K>/config.yml \nDefaults: <Vita3K>/data/config/default.yml")
@@ -256,6 +262,8 @@ ExitCode init_config(Config &cfg, int argc, char **argv, const Root &root_paths)
     if (cfg.pref_path.empty())
         cfg.pref_path = root_paths.get_pref_path_string();
 
+    logging::set_overflow_policy(cfg.log_drop_on_overflow ? logging::OverflowPolicy::Drop : logging::OverflowPolicy::Block);
+
     if (!cfg.console) {
         LOG_INFO_IF(cfg.load_config, "Custom configuration file loaded successfully.");
 
@@ -0,0 +1,154 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Headless harness running one guest function of a SELF on every cpu backend, reports JSON on stdout.
+// Usage: cpu-benchmark <self> <function offset in the first segment> [iterations] [r0]
+
+#include <cpu/functions.h>
+#include <kernel/load_self.h>
+#include <kernel/state.h>
+#include <kernel/thread/thread_state.h>
+#include <mem/functions.h>
+#include <mem/state.h>
+#include <util/fs.h>
+#include <util/log.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchmarkResult {
+    std::string backend;
+    bool success = false;
+    uint32_t return_value = 0;
+    double first_call_us = 0;
+    double mean_call_us = 0;
+    double min_call_us = 0;
+    uint64_t import_calls = 0;
+};
+
+static BenchmarkResult run_backend(CPUBackend backend, const std::vector<uint8_t> &self, const std::string &self_path, uint32_t offset, uint32_t iterations, uint32_t arg) {
+    using clock = std::chrono::steady_clock;
+
+    BenchmarkResult result;
+    result.backend = backend == CPUBackend::Dynarmic ? "dynarmic" : "unicorn";
+
+    MemState mem;
+    KernelState kernel;
+    std::atomic<uint64_t> import_calls = 0;
+    // Imports are not resolved in the harness, they return 0 so the function can carry on
+    const auto call_import = [&](CPUState &cpu, uint32_t, SceUID) {
+        import_calls++;
+        write_reg(cpu, 0, 0);
+    };
+    const auto call_hle_import = [&](CPUState &cpu, uint32_t, SceUID, bool) {
+        import_calls++;
+        write_reg(cpu, 0, 0);
+        return true;
+    };
+
+    if (!init(mem, false) || !kernel.init(mem, call_import, call_hle_import, backend, true)) {
+        LOG_ERROR("Failed to initialize the {} backend", result.backend);
+        return result;
+    }
+
+    const SceUID module_id = load_self(kernel, mem, self.data(), self_path, "");
+    if (module_id < 0) {
+        LOG_ERROR("Failed to load {}", self_path);
+        return result;
+    }
+    const Address function = kernel.loaded_modules[module_id]->segments[0].vaddr.address() + offset;
+
+    const ThreadStatePtr thread = kernel.create_thread(mem, "cpu-benchmark", Ptr<const void>(function));
+    if (!thread) {
+        LOG_ERROR("Failed to create the benchmark thread");
+        return result;
+    }
+
+    std::vector<double> durations;
+    durations.reserve(iterations);
+    for (uint32_t i = 0; i < iterations; i++) {
+        const auto start = clock::now();
+        // Without argp the argument length lands in r0 untouched, which is how the argument is passed
+        result.return_value = thread->run_guest_function(function, arg);
+        durations.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+    }
+
+    kernel.exit_delete_all_threads();
+    // The host thread still touches the kernel on its way out
+    while (true) {
+        const std::lock_guard<std::mutex> guard(kernel.mutex);
+        if (kernel.threads.empty())
+            break;
+        std::this_thread::yield();
+    }
+
+    result.success = !durations.empty();
+    if (result.success) {
+        // The first call pays for block compilation on JIT backends, keep it out of the steady state numbers
+        result.first_call_us = durations.front();
+        const auto steady_begin = durations.size() > 1 ? durations.begin() + 1 : durations.begin();
+        double total = 0;
+        for (auto it = steady_begin; it != durations.end(); ++it)
+            total += *it;
+        result.mean_call_us = total / std::distance(steady_begin, durations.end());
+        result.min_call_us = *std::min_element(steady_begin, durations.end());
+    }
+    result.import_calls = import_calls;
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: cpu-benchmark <self> <function offset> [iterations] [r0]" << std::endl;
+        return 1;
+    }
+
+    const fs::path self_path{ argv[1] };
+    const uint32_t offset = std::stoul(argv[2], nullptr, 0);
+    const uint32_t iterations = std::max<uint32_t>(argc > 3 ? std::stoul(argv[3], nullptr, 0) : 1000, 1);
+    const uint32_t arg = argc > 4 ? std::stoul(argv[4], nullptr, 0) : 0;
+
+    fs::ifstream file(self_path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Could not open " << self_path.string() << std::endl;
+        return 1;
+    }
+    const std::vector<uint8_t> self((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::string entries;
+    for (const CPUBackend backend : { CPUBackend::Dynarmic, CPUBackend::Unicorn }) {
+        const BenchmarkResult result = run_backend(backend, self, self_path.string(), offset, iterations, arg);
+        const double calls_per_second = result.mean_call_us > 0 ? 1e6 / result.mean_call_us : 0;
+        if (!entries.empty())
+            entries += ',';
+        entries += fmt::format(
+            R"({{"backend":"{}","success":{},"iterations":{},"return_value":{},"first_call_us":{:.3f},"mean_call_us":{:.3f},"min_call_us":{:.3f},"calls_per_second":{:.1f},"compile_overhead_us":{:.3f},"import_calls":{}}})",
+            result.backend, result.success, iterations, result.return_value, result.first_call_us, result.mean_call_us, result.min_call_us,
+            calls_per_second, std::max(result.first_call_us - result.mean_call_us, 0.0), result.import_calls);
+    }
+
+    fmt::print("{{\"self\":\"{}\",\"offset\":{},\"results\":[{}]}}\n", self_path.filename().string(), offset, entries);
+    return 0;
+}
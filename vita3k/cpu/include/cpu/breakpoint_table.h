@@ -0,0 +1,65 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <mem/util.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <shared_mutex>
+
+struct CPUState;
+
+// Evaluated by the thread reaching the breakpoint, it only stops if the condition is true
+typedef std::function<bool(CPUState &cpu)> BreakpointCondition;
+
+/**
+ * \brief Breakpoints consulted by the JIT instead of being patched in the guest code.
+ *
+ * The code read by the JIT has a breakpoint instruction at the address of every breakpoint, so the blocks
+ * still end right before it, but the guest memory is left untouched. Removing a breakpoint does not invalidate
+ * the translated code: a breakpoint which is no longer in the table, or whose condition is false, is stepped
+ * over the original instruction by the cpu without stopping the thread.
+ */
+class BreakpointTable {
+public:
+    void add(Address addr, bool thumb_mode, BreakpointCondition condition = nullptr);
+    // Returns false if there was no breakpoint at the address
+    bool remove(Address addr);
+
+    bool empty() const {
+        return count.load(std::memory_order_relaxed) == 0;
+    }
+
+    // Returns the code word read by the JIT at the 4 bytes aligned address, with the breakpoints it holds
+    uint32_t apply(Address aligned_addr, uint32_t code) const;
+    bool contains(Address addr) const;
+    // Called by the thread which reached the breakpoint at addr
+    bool should_break(CPUState &cpu, Address addr) const;
+
+private:
+    struct Entry {
+        bool thumb_mode;
+        BreakpointCondition condition;
+    };
+
+    mutable std::shared_mutex mutex;
+    std::map<Address, Entry> entries;
+    std::atomic<size_t> count = 0;
+};
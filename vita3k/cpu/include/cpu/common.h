@@ -34,6 +34,8 @@ struct MemState;
 struct CPUContext;
 struct CPUInterface;
 struct ThreadState;
+class BreakpointTable;
+class JitCache;
 
 typedef std::function<void(CPUState &cpu, uint32_t, Address)> CallSVC;
 
@@ -44,8 +46,12 @@ typedef void *ExclusiveMonitorPtr;
 
 struct CPUProtocolBase {
     virtual void call_svc(CPUState &cpu, uint32_t svc, Address pc, ThreadState &thread) = 0;
+    // Called by the cpu while it runs, returns false if the svc must be handled by call_svc once the cpu has stopped
+    virtual bool call_svc_in_run_loop(CPUState &cpu, uint32_t svc) = 0;
     virtual Address get_watch_memory_addr(Address addr) = 0;
     virtual ExclusiveMonitorPtr get_exlusive_monitor() = 0;
+    virtual JitCache *get_jit_cache() = 0;
+    virtual BreakpointTable *get_breakpoint_table() = 0;
     virtual ~CPUProtocolBase() = default;
 };
 
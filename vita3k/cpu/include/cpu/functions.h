@@ -32,6 +32,8 @@ int step(CPUState &state);
 void stop(CPUState &state);
 void set_thread_id(CPUState &state, SceUID thread_id);
 SceUID get_thread_id(CPUState &state);
+void set_thread_state(CPUState &state, ThreadState *thread);
+ThreadState *get_thread_state(CPUState &state);
 uint32_t read_reg(CPUState &state, size_t index);
 float read_float_reg(CPUState &state, size_t index);
 void write_float_reg(CPUState &state, size_t index, float value);
@@ -47,6 +49,7 @@ void write_tpidruro(CPUState &state, uint32_t value);
 bool is_thumb_mode(CPUState &state);
 CPUContext save_context(CPUState &state);
 void load_context(CPUState &state, CPUContext ctx);
+void swap_context(CPUState &state, CPUContext &save_to, const CPUContext &load_from);
 std::size_t get_processor_id(CPUState &state);
 void invalidate_jit_cache(CPUState &state, Address start, size_t length);
 
@@ -60,9 +63,19 @@ uint32_t stack_free(CPUState &state, size_t size);
 
 ExclusiveMonitorPtr new_exclusive_monitor(int max_num_cores);
 void free_exclusive_monitor(ExclusiveMonitorPtr monitor);
-void clear_exclusive(ExclusiveMonitorPtr monitor, std::size_t core_num);
+void clear_exclusive(CPUState &state);
+
+struct ExclusiveMonitorStats {
+    uint64_t store_count = 0;
+    uint64_t store_failures = 0;
+};
+// Exclusive stores (STREX family) that reached memory since boot, and how many of them lost the race
+ExclusiveMonitorStats get_exclusive_monitor_stats();
 
 // Debugging helpers
+// Number of iterations of guest polling loops detected by the JIT since boot
+uint64_t get_idle_loop_count();
+
 std::string disassemble(CPUState &state, uint64_t at, bool thumb, uint16_t *insn_size = nullptr);
 std::string disassemble(CPUState &state, uint64_t at, uint16_t *insn_size = nullptr);
 bool hit_breakpoint(CPUState &state);
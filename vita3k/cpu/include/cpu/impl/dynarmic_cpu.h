@@ -27,9 +27,14 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 class ArmDynarmicCallback;
 class ArmDynarmicCP15;
+class BreakpointTable;
+class JitCache;
 
 class DynarmicCPU : public CPUInterface {
     friend class ArmDynarmicCallback;
@@ -39,19 +44,33 @@ class DynarmicCPU : public CPUInterface {
     std::unique_ptr<Dynarmic::A32::Jit> jit;
     std::unique_ptr<ArmDynarmicCallback> cb;
     std::shared_ptr<ArmDynarmicCP15> cp15;
+    // Set when the kernel has no shared monitor: reservations are then private to this cpu and
+    // exclusive stores are arbitrated by the compare-and-swap in MemoryWriteExclusive alone
+    std::unique_ptr<Dynarmic::ExclusiveMonitor> own_monitor;
     Dynarmic::ExclusiveMonitor *monitor;
+    JitCache *jit_cache;
+    BreakpointTable *breakpoint_table;
 
     std::size_t core_id = 0;
 
     bool exit_request = false;
     bool halted = false;
     bool break_ = false;
+    // Single steps translate the original code, they are also used to step over the breakpoints which must not stop
+    bool stepping = false;
 
     bool log_mem = false;
     bool log_code = false;
     bool cpu_opt;
 
+    // Invalidations requested from other threads, kept sorted and merged as [start, end) ranges
+    // and applied by the owning thread before it enters the JIT again
+    std::mutex invalidation_mutex;
+    std::vector<std::pair<Address, Address>> pending_invalidations;
+
     std::unique_ptr<Dynarmic::A32::Jit> make_jit();
+    void flush_pending_invalidations();
+    bool is_guest_breakpoint(Address pc);
 
 public:
     DynarmicCPU(CPUState *state, std::size_t processor_id, Dynarmic::ExclusiveMonitor *monitor, bool cpu_opt);
@@ -85,6 +104,7 @@ public:
 
     CPUContext save_context() override;
     void load_context(CPUContext context) override;
+    void swap_context(CPUContext &save_to, const CPUContext &load_from) override;
 
     bool is_thumb_mode() override;
     int step() override;
@@ -98,4 +118,5 @@ public:
 
     std::size_t processor_id() const override;
     void invalidate_jit_cache(Address start, size_t length) override;
+    void clear_exclusive() override;
 };
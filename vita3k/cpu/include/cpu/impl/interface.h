@@ -55,6 +55,11 @@ struct CPUInterface {
 
     virtual CPUContext save_context() = 0;
     virtual void load_context(CPUContext context) = 0;
+    // Saves the current context then loads another one, used by fibers which switch contexts very often
+    virtual void swap_context(CPUContext &save_to, const CPUContext &load_from) {
+        save_to = save_context();
+        load_context(load_from);
+    }
     virtual void invalidate_jit_cache(Address start, size_t length) = 0;
 
     virtual bool is_thumb_mode() = 0;
@@ -70,4 +75,7 @@ struct CPUInterface {
     virtual std::size_t processor_id() const {
         return 0;
     }
+
+    // Drops the exclusive reservation held by this cpu, if the backend tracks one
+    virtual void clear_exclusive() {}
 };
@@ -0,0 +1,64 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <mem/util.h>
+#include <util/fs.h>
+
+#include <map>
+#include <mutex>
+#include <set>
+
+/**
+ * \brief Persistent record of the guest code blocks translated by the JIT.
+ *
+ * Blocks are keyed by the NID of the module that owns them and their offset inside its executable segment,
+ * so the record stays valid across boots even when relocatable modules end up at a different address.
+ * dynarmic does not expose the host code it emits, so what is reused on a warm boot is the translated
+ * footprint: it sizes the code cache of every new JIT so it never has to be flushed during play.
+ */
+class JitCache {
+public:
+    bool load(const fs::path &cache_dir);
+    void save();
+
+    void add_module(uint32_t nid, Address base, uint32_t size);
+    void record_block(Address pc, bool thumb);
+    void invalidate(Address start, size_t length);
+
+    // Returns 0 if nothing is known about this title yet
+    size_t get_code_cache_size() const;
+
+private:
+    struct Module {
+        uint32_t nid = 0;
+        Address base = 0;
+        uint32_t size = 0;
+    };
+
+    mutable std::mutex mutex;
+    fs::path path;
+    bool dirty = false;
+
+    // Loaded modules sorted by base address
+    std::map<Address, Module> modules;
+    // Block offsets (thumb bit included) by module NID
+    std::map<uint32_t, std::set<uint32_t>> blocks;
+
+    const Module *find_module(Address addr) const;
+};
@@ -0,0 +1,67 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <mem/util.h>
+#include <util/fs.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct GuestProfileEntry {
+    Address pc;
+    uint64_t samples;
+};
+
+/**
+ * \brief Sampling profiler of the guest code
+ *
+ * A host thread wakes up at a fixed interval and asks the owner for the pc of every running guest thread.
+ * Samples are aggregated by pc, which is good enough to find hot functions: the JIT only updates the guest pc
+ * on block boundaries, so all the samples of a block land on its first instruction.
+ */
+class GuestProfiler {
+public:
+    typedef std::function<void(std::vector<Address> &pcs)> CollectPCs;
+    typedef std::function<std::string(Address pc)> ResolvePC;
+
+    ~GuestProfiler();
+
+    void start(CollectPCs collect, uint32_t interval_us);
+    void stop();
+    bool is_running() const { return running; }
+
+    uint64_t get_total_samples() const;
+    std::vector<GuestProfileEntry> get_top(size_t count) const;
+    void clear();
+
+    bool dump(const fs::path &path, const ResolvePC &resolve) const;
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<Address, uint64_t> samples;
+    uint64_t total_samples = 0;
+
+    std::atomic<bool> running = false;
+    std::thread sampler;
+};
@@ -25,6 +25,8 @@ struct CPUState {
     CPUState() = default;
 
     SceUID thread_id = 0;
+    // guest thread owning this cpu, reached from the import calls without looking it up by id
+    ThreadState *thread = nullptr;
     MemState *mem = nullptr;
     CPUProtocolBase *protocol = nullptr;
     DisasmState disasm;
@@ -0,0 +1,77 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <cpu/breakpoint_table.h>
+
+#include <mutex>
+
+constexpr uint16_t THUMB_BREAKPOINT = 0xBE00;
+constexpr uint32_t ARM_BREAKPOINT = 0xE1200070;
+
+void BreakpointTable::add(Address addr, bool thumb_mode, BreakpointCondition condition) {
+    const std::unique_lock<std::shared_mutex> lock(mutex);
+    entries.insert_or_assign(addr, Entry{ thumb_mode, std::move(condition) });
+    count = entries.size();
+}
+
+bool BreakpointTable::remove(Address addr) {
+    const std::unique_lock<std::shared_mutex> lock(mutex);
+    const bool removed = entries.erase(addr) != 0;
+    count = entries.size();
+    return removed;
+}
+
+uint32_t BreakpointTable::apply(Address aligned_addr, uint32_t code) const {
+    if (empty())
+        return code;
+
+    const std::shared_lock<std::shared_mutex> lock(mutex);
+    for (auto it = entries.lower_bound(aligned_addr); it != entries.end() && it->first < aligned_addr + 4; ++it) {
+        if (!it->second.thumb_mode) {
+            code = ARM_BREAKPOINT;
+        } else {
+            // the thumb instructions are read by words, the breakpoint replaces the half at its address
+            const uint32_t shift = (it->first & 2) * 8;
+            code = (code & ~(0xFFFFu << shift)) | (THUMB_BREAKPOINT << shift);
+        }
+    }
+    return code;
+}
+
+bool BreakpointTable::contains(Address addr) const {
+    if (empty())
+        return false;
+
+    const std::shared_lock<std::shared_mutex> lock(mutex);
+    return entries.contains(addr);
+}
+
+bool BreakpointTable::should_break(CPUState &cpu, Address addr) const {
+    BreakpointCondition condition;
+    {
+        const std::shared_lock<std::shared_mutex> lock(mutex);
+        const auto it = entries.find(addr);
+        if (it == entries.end())
+            return false;
+        if (!it->second.condition)
+            return true;
+        condition = it->second.condition;
+    }
+
+    // the condition can read the guest memory or registers, it is evaluated without the lock
+    return condition(cpu);
+}
@@ -46,6 +46,14 @@ SceUID get_thread_id(CPUState &state) {
     return state.thread_id;
 }
 
+void set_thread_state(CPUState &state, ThreadState *thread) {
+    state.thread = thread;
+}
+
+ThreadState *get_thread_state(CPUState &state) {
+    return state.thread;
+}
+
 CPUStatePtr init_cpu(CPUBackend backend, bool cpu_opt, SceUID thread_id, std::size_t processor_id, MemState &mem, CPUProtocolBase *protocol) {
     CPUStatePtr state(new CPUState(), delete_cpu_state);
     state->mem = &mem;
@@ -193,6 +201,10 @@ void invalidate_jit_cache(CPUState &state, Address start, size_t length) {
     state.cpu->invalidate_jit_cache(start, length);
 }
 
+void clear_exclusive(CPUState &state) {
+    state.cpu->clear_exclusive();
+}
+
 std::string disassemble(CPUState &state, uint64_t at, bool thumb, uint16_t *insn_size) {
     MemState &mem = *state.mem;
     const uint8_t *const code = Ptr<const uint8_t>(static_cast<Address>(at)).get(mem);
@@ -213,6 +225,10 @@ void load_context(CPUState &state, CPUContext ctx) {
     state.cpu->load_context(ctx);
 }
 
+void swap_context(CPUState &state, CPUContext &save_to, const CPUContext &load_from) {
+    state.cpu->swap_context(save_to, load_from);
+}
+
 uint32_t stack_alloc(CPUState &state, size_t size) {
     const uint32_t new_sp = read_sp(state) - size;
     write_sp(state, new_sp);
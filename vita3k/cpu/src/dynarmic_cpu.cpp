@@ -16,11 +16,17 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "cpu/common.h"
+#include <cpu/breakpoint_table.h>
 #include <cpu/disasm/functions.h>
 #include <cpu/impl/dynarmic_cpu.h>
 #include <cpu/impl/interface.h>
+#include <cpu/jit_cache.h>
 #include <cpu/state.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <set>
+#include <thread>
 #include <util/log.h>
 
 #include <mem/ptr.h>
@@ -86,11 +92,85 @@ public:
     }
 };
 
+static std::atomic<uint64_t> idle_loop_count = 0;
+
+uint64_t get_idle_loop_count() {
+    return idle_loop_count;
+}
+
+static std::atomic<uint64_t> exclusive_store_count = 0;
+static std::atomic<uint64_t> exclusive_store_failures = 0;
+
+// Counted per host thread and published in batches so the counters don't become a contended line themselves
+static void count_exclusive_store(bool success) {
+    constexpr uint32_t PUBLISH_INTERVAL = 256;
+    thread_local uint32_t stores = 0;
+    thread_local uint32_t failures = 0;
+
+    stores++;
+    if (!success)
+        failures++;
+    if (stores == PUBLISH_INTERVAL) {
+        exclusive_store_count.fetch_add(stores, std::memory_order_relaxed);
+        exclusive_store_failures.fetch_add(failures, std::memory_order_relaxed);
+        stores = 0;
+        failures = 0;
+    }
+}
+
+ExclusiveMonitorStats get_exclusive_monitor_stats() {
+    return { exclusive_store_count.load(std::memory_order_relaxed), exclusive_store_failures.load(std::memory_order_relaxed) };
+}
+
+static bool is_thumb_load(uint16_t inst) {
+    return (inst & 0xF000) == 0x6000 // LDR (immediate)
+        || (inst & 0xF800) == 0x7800 // LDRB (immediate)
+        || (inst & 0xF800) == 0x8800 // LDRH (immediate)
+        || (inst & 0xF800) == 0x4800 // LDR (literal)
+        || (inst & 0xF800) == 0x9800 // LDR (SP relative)
+        || (inst & 0xFE00) == 0x5800; // LDR, LDRB (register)
+}
+
+static bool is_thumb_compare(uint16_t inst) {
+    return (inst & 0xF800) == 0x2800 // CMP (immediate)
+        || (inst & 0xFFC0) == 0x4280 // CMP (register)
+        || (inst & 0xFFC0) == 0x4200; // TST (register)
+}
+
+static std::optional<uint32_t> thumb_cond_branch_target(uint16_t inst, uint32_t pc) {
+    if ((inst & 0xF000) != 0xD000 || (inst & 0x0E00) == 0x0E00)
+        return std::nullopt;
+    const int32_t offset = static_cast<int8_t>(inst & 0xFF) * 2;
+    return pc + 4 + offset;
+}
+
+static bool is_arm_load(uint32_t inst) {
+    return (inst & 0x0C500000) == 0x04100000 // LDR, LDRB
+        || (inst & 0x0E1000F0) == 0x001000B0; // LDRH
+}
+
+static bool is_arm_compare(uint32_t inst) {
+    return (inst & 0x0DF00000) == 0x01500000 // CMP
+        || (inst & 0x0DF00000) == 0x01100000; // TST
+}
+
+static std::optional<uint32_t> arm_cond_branch_target(uint32_t inst, uint32_t pc) {
+    if ((inst & 0x0F000000) != 0x0A000000 || (inst >> 28) >= 0xE)
+        return std::nullopt;
+    const int32_t offset = (static_cast<int32_t>(inst << 8) >> 8) * 4;
+    return pc + 8 + offset;
+}
+
+constexpr Dynarmic::HaltReason INVALIDATION_HALT = Dynarmic::HaltReason::UserDefined7;
+constexpr Dynarmic::HaltReason STEP_OVER_HALT = Dynarmic::HaltReason::UserDefined6;
+
 class ArmDynarmicCallback : public Dynarmic::A32::UserCallbacks {
     friend class DynarmicCPU;
 
     CPUState *parent;
     DynarmicCPU *cpu;
+    Dynarmic::A32::VAddr last_translated_pc = 0;
+    uint32_t idle_loop_iterations = 0;
 
 public:
     explicit ArmDynarmicCallback(CPUState &parent, DynarmicCPU &cpu)
@@ -102,7 +182,10 @@ public:
     std::optional<std::uint32_t> MemoryReadCode(Dynarmic::A32::VAddr addr) override {
         if (cpu->log_mem)
             LOG_TRACE("Instruction fetch at address 0x{:X}", addr);
-        return MemoryRead32(addr);
+        const uint32_t code = MemoryRead32(addr);
+        if (cpu->stepping || !cpu->breakpoint_table)
+            return code;
+        return cpu->breakpoint_table->apply(addr, code);
     }
 
     static void TraceInstruction(uint64_t self_, uint64_t address, uint64_t is_thumb) {
@@ -117,7 +200,56 @@ public:
         LOG_TRACE("{} ({}): {} {}", log_hex(self_), self.parent->thread_id, log_hex(address), disassembly);
     }
 
+    // Recognize a block which only loads a value, compares it and branches back to itself,
+    // the shape of a thread polling a flag written by another thread or by the host
+    bool is_idle_loop(Dynarmic::A32::VAddr pc, bool is_thumb) {
+        const auto read_code = [&](Dynarmic::A32::VAddr addr, auto &value) {
+            Ptr<std::remove_reference_t<decltype(value)>> ptr{ addr };
+            if (!ptr.valid(*parent->mem))
+                return false;
+            value = *ptr.get(*parent->mem);
+            return true;
+        };
+
+        if (is_thumb) {
+            uint16_t insts[3];
+            for (int i = 0; i < 3; i++) {
+                if (!read_code(pc + i * 2, insts[i]))
+                    return false;
+            }
+            return is_thumb_load(insts[0]) && is_thumb_compare(insts[1]) && thumb_cond_branch_target(insts[2], pc + 4) == pc;
+        }
+
+        uint32_t insts[3];
+        for (int i = 0; i < 3; i++) {
+            if (!read_code(pc + i * 4, insts[i]))
+                return false;
+        }
+        return is_arm_load(insts[0]) && is_arm_compare(insts[1]) && arm_cond_branch_target(insts[2], pc + 8) == pc;
+    }
+
+    static void IdleLoopHook(uint64_t self_) {
+        ArmDynarmicCallback &self = *reinterpret_cast<ArmDynarmicCallback *>(self_);
+        idle_loop_count++;
+
+        // Give the core to the thread being waited for, and back off a bit if the wait goes on
+        if ((++self.idle_loop_iterations & 0x3F) == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        else
+            std::this_thread::yield();
+    }
+
     void PreCodeTranslationHook(bool is_thumb, Dynarmic::A32::VAddr pc, Dynarmic::A32::IREmitter &ir) override {
+        // The hook runs for every translated instruction, a new block starts whenever the pc is not right after the last one
+        const bool block_start = pc <= last_translated_pc || pc > last_translated_pc + 4;
+        last_translated_pc = pc;
+        if (block_start) {
+            if (cpu->jit_cache)
+                cpu->jit_cache->record_block(pc, is_thumb);
+            if (cpu->cpu_opt && is_idle_loop(pc, is_thumb))
+                ir.CallHostFunction(&IdleLoopHook, ir.Imm64((uint64_t)this));
+        }
+
         if (cpu->log_code) {
             ir.CallHostFunction(&TraceInstruction, ir.Imm64((uint64_t)this), ir.Imm64(pc), ir.Imm64(is_thumb));
         }
@@ -211,6 +343,7 @@ public:
         }
 
         auto result = Ptr<T>(addr).atomic_compare_and_swap(*parent->mem, value, expected);
+        count_exclusive_store(result);
         if (cpu->log_mem) {
             LOG_TRACE("Write uint{}_t at addr: 0x{:x}, val = 0x{:x}, expected = 0x{:x}", sizeof(T) * 8, addr, value, expected);
         }
@@ -240,12 +373,22 @@ public:
     void ExceptionRaised(uint32_t pc, Dynarmic::A32::Exception exception) override {
         switch (exception) {
         case Dynarmic::A32::Exception::Breakpoint: {
-            cpu->break_ = true;
-            cpu->jit->HaltExecution();
             if (cpu->is_thumb_mode())
                 cpu->set_pc(pc | 1);
             else
                 cpu->set_pc(pc);
+
+            // a breakpoint instruction of the guest code always stops, the ones of the table only if their condition is met
+            if (cpu->is_guest_breakpoint(pc) || !cpu->breakpoint_table || cpu->breakpoint_table->should_break(*parent, pc)) {
+                cpu->break_ = true;
+                cpu->jit->HaltExecution();
+                break;
+            }
+
+            // the breakpoint was removed since the block was translated, the original code is translated again
+            if (!cpu->breakpoint_table->contains(pc))
+                cpu->invalidate_jit_cache(pc, 4);
+            cpu->jit->HaltExecution(STEP_OVER_HALT);
             break;
         }
         case Dynarmic::A32::Exception::WaitForInterrupt: {
@@ -282,6 +425,9 @@ public:
     }
 
     void CallSVC(uint32_t svc) override {
+        // non blocking HLE calls are done right away, the jit resumes without leaving the run loop
+        if (parent->protocol->call_svc_in_run_loop(*parent, svc))
+            return;
         parent->svc_called = true;
         parent->svc = svc;
         cpu->jit->HaltExecution(Dynarmic::HaltReason::UserDefined8);
@@ -308,8 +454,13 @@ std::unique_ptr<Dynarmic::A32::Jit> DynarmicCPU::make_jit() {
     config.enable_cycle_counting = false;
     config.global_monitor = monitor;
     config.coprocessors[15] = cp15;
-    config.processor_id = core_id;
+    config.processor_id = own_monitor ? 0 : core_id;
     config.optimizations = cpu_opt ? Dynarmic::all_safe_optimizations : Dynarmic::no_optimizations;
+    if (jit_cache) {
+        const size_t code_cache_size = jit_cache->get_code_cache_size();
+        if (code_cache_size)
+            config.code_cache_size = code_cache_size;
+    }
 
     return std::make_unique<Dynarmic::A32::Jit>(config);
 }
@@ -318,7 +469,10 @@ DynarmicCPU::DynarmicCPU(CPUState *state, std::size_t processor_id, Dynarmic::Ex
     : parent(state)
     , cb(std::make_unique<ArmDynarmicCallback>(*state, *this))
     , cp15(std::make_shared<ArmDynarmicCP15>())
-    , monitor(monitor)
+    , own_monitor(monitor ? nullptr : std::make_unique<Dynarmic::ExclusiveMonitor>(1))
+    , monitor(monitor ? monitor : own_monitor.get())
+    , jit_cache(state->protocol->get_jit_cache())
+    , breakpoint_table(state->protocol->get_breakpoint_table())
     , core_id(processor_id)
     , cpu_opt(cpu_opt) {
     jit = make_jit();
@@ -332,16 +486,46 @@ int DynarmicCPU::run() {
     break_ = false;
     exit_request = false;
     parent->svc_called = false;
-    jit->Run();
+    flush_pending_invalidations();
+    for (;;) {
+        const Dynarmic::HaltReason reason = jit->Run();
+        if (Dynarmic::Has(reason, INVALIDATION_HALT))
+            flush_pending_invalidations();
+
+        if (Dynarmic::Has(reason, STEP_OVER_HALT)) {
+            stepping = true;
+            jit->Step();
+            stepping = false;
+            if (parent->svc_called || halted || break_ || exit_request)
+                break;
+            continue;
+        }
+
+        // An invalidation request alone only interrupts the guest long enough to apply it
+        if (reason != INVALIDATION_HALT)
+            break;
+    }
     return halted;
 }
 
 int DynarmicCPU::step() {
     parent->svc_called = false;
+    flush_pending_invalidations();
+    stepping = true;
     jit->Step();
+    stepping = false;
     return 0;
 }
 
+bool DynarmicCPU::is_guest_breakpoint(Address pc) {
+    if (is_thumb_mode()) {
+        const Ptr<uint16_t> inst(pc);
+        return inst.valid(*parent->mem) && (*inst.get(*parent->mem) & 0xFF00) == 0xBE00;
+    }
+    const Ptr<uint32_t> inst(pc);
+    return inst.valid(*parent->mem) && (*inst.get(*parent->mem) & 0x0FF000F0) == 0x01200070;
+}
+
 bool DynarmicCPU::hit_breakpoint() {
     return break_;
 }
@@ -460,6 +644,22 @@ void DynarmicCPU::load_context(CPUContext ctx) {
     jit->LoadContext(dctx);
 }
 
+void DynarmicCPU::swap_context(CPUContext &save_to, const CPUContext &load_from) {
+    // the registers of the jit are copied directly, without the heap allocated Dynarmic::A32::Context
+    auto &regs = jit->Regs();
+    auto &ext_regs = jit->ExtRegs();
+    static_assert(sizeof(save_to.fpu_registers) == sizeof(ext_regs));
+    save_to.cpu_registers = regs;
+    memcpy(save_to.fpu_registers.data(), ext_regs.data(), sizeof(save_to.fpu_registers));
+    save_to.cpsr = jit->Cpsr();
+    save_to.fpscr = jit->Fpscr();
+
+    regs = load_from.cpu_registers;
+    memcpy(ext_regs.data(), load_from.fpu_registers.data(), sizeof(load_from.fpu_registers));
+    jit->SetCpsr(load_from.cpsr);
+    jit->SetFpscr(load_from.fpscr);
+}
+
 uint32_t DynarmicCPU::get_lr() {
     return jit->Regs()[14];
 }
@@ -481,7 +681,41 @@ std::size_t DynarmicCPU::processor_id() const {
 }
 
 void DynarmicCPU::invalidate_jit_cache(Address start, size_t length) {
-    jit->InvalidateCacheRange(start, length);
+    if (length == 0)
+        return;
+
+    Address end = start + static_cast<Address>(length);
+    const std::lock_guard<std::mutex> guard(invalidation_mutex);
+    const bool was_empty = pending_invalidations.empty();
+
+    // Merge with every pending range that overlaps or touches [start, end)
+    auto it = std::lower_bound(pending_invalidations.begin(), pending_invalidations.end(), start,
+        [](const std::pair<Address, Address> &range, Address addr) { return range.second < addr; });
+    auto last = it;
+    while (last != pending_invalidations.end() && last->first <= end) {
+        start = std::min(start, last->first);
+        end = std::max(end, last->second);
+        ++last;
+    }
+    it = pending_invalidations.erase(it, last);
+    pending_invalidations.insert(it, { start, end });
+
+    // The first pending range asks the JIT to stop at the next block boundary, later ones ride along
+    if (was_empty)
+        jit->HaltExecution(INVALIDATION_HALT);
+}
+
+void DynarmicCPU::flush_pending_invalidations() {
+    std::vector<std::pair<Address, Address>> ranges;
+    {
+        const std::lock_guard<std::mutex> guard(invalidation_mutex);
+        if (pending_invalidations.empty())
+            return;
+        ranges.swap(pending_invalidations);
+    }
+
+    for (const auto &[start, end] : ranges)
+        jit->InvalidateCacheRange(start, end - start);
 }
 
 // TODO: proper abstraction
@@ -494,7 +728,6 @@ void free_exclusive_monitor(ExclusiveMonitorPtr monitor) {
     delete monitor_;
 }
 
-void clear_exclusive(ExclusiveMonitorPtr monitor, std::size_t core_num) {
-    Dynarmic::ExclusiveMonitor *monitor_ = reinterpret_cast<Dynarmic::ExclusiveMonitor *>(monitor);
-    monitor_->ClearProcessor(core_num);
+void DynarmicCPU::clear_exclusive() {
+    monitor->ClearProcessor(own_monitor ? 0 : core_id);
 }
@@ -0,0 +1,171 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <cpu/jit_cache.h>
+
+#include <util/log.h>
+
+#include <algorithm>
+#include <vector>
+
+static constexpr uint32_t JIT_CACHE_VERSION = 1;
+static constexpr const char *JIT_CACHE_FILE_NAME = "blocks.dat";
+
+// Rough amount of host code emitted by dynarmic per guest block, including its far code
+static constexpr size_t HOST_BYTES_PER_BLOCK = 4 * 1024;
+static constexpr size_t MIN_CODE_CACHE_SIZE = 128 * 1024 * 1024;
+static constexpr size_t MAX_CODE_CACHE_SIZE = 512 * 1024 * 1024;
+
+bool JitCache::load(const fs::path &cache_dir) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    path = cache_dir / JIT_CACHE_FILE_NAME;
+    blocks.clear();
+    dirty = false;
+
+    fs::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    uint32_t version = 0;
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    if (version != JIT_CACHE_VERSION) {
+        LOG_WARN("JIT cache version {} is outdated, recreating it.", version);
+        return false;
+    }
+
+    uint32_t modules_count = 0;
+    file.read(reinterpret_cast<char *>(&modules_count), sizeof(modules_count));
+    for (uint32_t i = 0; i < modules_count && file.good(); i++) {
+        uint32_t nid = 0;
+        uint32_t blocks_count = 0;
+        file.read(reinterpret_cast<char *>(&nid), sizeof(nid));
+        file.read(reinterpret_cast<char *>(&blocks_count), sizeof(blocks_count));
+
+        std::vector<uint32_t> offsets(blocks_count);
+        file.read(reinterpret_cast<char *>(offsets.data()), blocks_count * sizeof(uint32_t));
+        blocks[nid].insert(offsets.begin(), offsets.end());
+    }
+
+    if (!file.good()) {
+        LOG_WARN("JIT cache {} is corrupted, recreating it.", path.string());
+        blocks.clear();
+        return false;
+    }
+
+    LOG_INFO("Loaded JIT cache with {} modules", blocks.size());
+    return true;
+}
+
+void JitCache::save() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (path.empty() || !dirty)
+        return;
+
+    if (!fs::exists(path.parent_path()))
+        fs::create_directories(path.parent_path());
+
+    fs::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to save JIT cache to {}", path.string());
+        return;
+    }
+
+    file.write(reinterpret_cast<const char *>(&JIT_CACHE_VERSION), sizeof(JIT_CACHE_VERSION));
+    const uint32_t modules_count = static_cast<uint32_t>(blocks.size());
+    file.write(reinterpret_cast<const char *>(&modules_count), sizeof(modules_count));
+    for (const auto &[nid, offsets] : blocks) {
+        const uint32_t blocks_count = static_cast<uint32_t>(offsets.size());
+        file.write(reinterpret_cast<const char *>(&nid), sizeof(nid));
+        file.write(reinterpret_cast<const char *>(&blocks_count), sizeof(blocks_count));
+        for (const uint32_t offset : offsets)
+            file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+
+    dirty = false;
+}
+
+void JitCache::add_module(uint32_t nid, Address base, uint32_t size) {
+    const std::lock_guard<std::mutex> guard(mutex);
+
+    // Drop any stale module that used to live in this range
+    auto it = modules.lower_bound(base);
+    if (it != modules.begin() && std::prev(it)->second.base + std::prev(it)->second.size > base)
+        --it;
+    while (it != modules.end() && it->first < base + size)
+        it = modules.erase(it);
+
+    modules[base] = { nid, base, size };
+}
+
+const JitCache::Module *JitCache::find_module(Address addr) const {
+    auto it = modules.upper_bound(addr);
+    if (it == modules.begin())
+        return nullptr;
+    --it;
+    if (addr >= it->second.base + it->second.size)
+        return nullptr;
+    return &it->second;
+}
+
+void JitCache::record_block(Address pc, bool thumb) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    const Module *module = find_module(pc);
+    if (!module)
+        return;
+
+    if (blocks[module->nid].insert((pc - module->base) | (thumb ? 1 : 0)).second)
+        dirty = true;
+}
+
+void JitCache::invalidate(Address start, size_t length) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    const Address end = start + static_cast<Address>(length);
+    auto it = modules.upper_bound(start);
+    if (it != modules.begin())
+        --it;
+    for (; it != modules.end() && it->first < end; ++it) {
+        const Module &module = it->second;
+        if (module.base + module.size <= start)
+            continue;
+
+        // Patched code must be retranslated, forget whatever was recorded for it
+        auto &offsets = blocks[module.nid];
+        const uint32_t first = start > module.base ? start - module.base : 0;
+        const uint32_t last = std::min(end, module.base + module.size) - module.base;
+        const auto erase_begin = offsets.lower_bound(first);
+        const auto erase_end = offsets.lower_bound(last);
+        if (erase_begin != erase_end) {
+            offsets.erase(erase_begin, erase_end);
+            dirty = true;
+        }
+    }
+}
+
+size_t JitCache::get_code_cache_size() const {
+    const std::lock_guard<std::mutex> guard(mutex);
+    size_t blocks_count = 0;
+    for (const auto &[_, module] : modules) {
+        const auto it = blocks.find(module.nid);
+        if (it != blocks.end())
+            blocks_count += it->second.size();
+    }
+
+    if (blocks_count == 0)
+        return 0;
+
+    return std::clamp(blocks_count * HOST_BYTES_PER_BLOCK, MIN_CODE_CACHE_SIZE, MAX_CODE_CACHE_SIZE);
+}
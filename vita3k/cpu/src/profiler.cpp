@@ -0,0 +1,109 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <cpu/profiler.h>
+
+#include <util/log.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+
+GuestProfiler::~GuestProfiler() {
+    stop();
+}
+
+void GuestProfiler::start(CollectPCs collect, uint32_t interval_us) {
+    if (running)
+        return;
+
+    running = true;
+    sampler = std::thread([this, collect = std::move(collect), interval_us]() {
+        std::vector<Address> pcs;
+        while (running) {
+            pcs.clear();
+            collect(pcs);
+            {
+                const std::lock_guard<std::mutex> guard(mutex);
+                for (const Address pc : pcs)
+                    samples[pc]++;
+                total_samples += pcs.size();
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+        }
+    });
+}
+
+void GuestProfiler::stop() {
+    running = false;
+    if (sampler.joinable())
+        sampler.join();
+}
+
+uint64_t GuestProfiler::get_total_samples() const {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return total_samples;
+}
+
+std::vector<GuestProfileEntry> GuestProfiler::get_top(size_t count) const {
+    std::vector<GuestProfileEntry> entries;
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        entries.reserve(samples.size());
+        for (const auto &[pc, pc_samples] : samples)
+            entries.push_back({ pc, pc_samples });
+    }
+
+    count = std::min(count, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), [](const GuestProfileEntry &a, const GuestProfileEntry &b) {
+        return a.samples > b.samples;
+    });
+    entries.resize(count);
+    return entries;
+}
+
+void GuestProfiler::clear() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    samples.clear();
+    total_samples = 0;
+}
+
+bool GuestProfiler::dump(const fs::path &path, const ResolvePC &resolve) const {
+    const auto entries = get_top(SIZE_MAX);
+    const uint64_t total = get_total_samples();
+    if (total == 0)
+        return false;
+
+    if (!fs::exists(path.parent_path()))
+        fs::create_directories(path.parent_path());
+
+    fs::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to write guest profile to {}", path.string());
+        return false;
+    }
+
+    file << fmt::format("# {} samples\n# samples    percent  pc          location\n", total);
+    for (const auto &entry : entries) {
+        const double percent = static_cast<double>(entry.samples) * 100.0 / static_cast<double>(total);
+        file << fmt::format("{:>9}  {:>8.3f}%  0x{:08X}  {}\n", entry.samples, percent, entry.pc, resolve(entry.pc));
+    }
+
+    LOG_INFO("Guest profile saved to {}", path.string());
+    return true;
+}
@@ -0,0 +1,122 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Measures the throughput of the AES modes and of SHA-256 and reports JSON on stdout.
+// Every mode is run with the lookup table implementation and, when the cpu supports it, with the hardware instructions.
+// Usage: crypto-benchmark [size in MiB]
+
+#include <crypto/aes.h>
+#include <crypto/hash.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+static double measure_mib_s(size_t size, const std::function<void()> &run) {
+    using clock = std::chrono::steady_clock;
+
+    // warm up the caches and the branch predictors before measuring
+    run();
+    const auto start = clock::now();
+    run();
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    return seconds > 0 ? static_cast<double>(size) / (1024 * 1024) / seconds : 0;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t size = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64) * 1024 * 1024;
+    if (size == 0) {
+        fmt::print(stderr, "Usage: crypto-benchmark [size in MiB]\n");
+        return 1;
+    }
+
+    std::vector<unsigned char> input(size);
+    std::vector<unsigned char> output(size);
+    for (size_t i = 0; i < size; i++)
+        input[i] = static_cast<unsigned char>(i * 31 + 7);
+
+    const unsigned char key[32] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+    aes_context enc_ctx;
+    aes_context dec_ctx;
+    aes_setkey_enc(&enc_ctx, key, 128);
+    aes_setkey_dec(&dec_ctx, key, 128);
+
+    const auto run_aes = [&]() {
+        std::string results;
+        const auto add = [&](const char *name, double mib_s) {
+            if (!results.empty())
+                results += ',';
+            results += fmt::format(R"("{}":{:.1f})", name, mib_s);
+        };
+
+        add("ecb_encrypt", measure_mib_s(size, [&]() {
+            for (size_t i = 0; i < size; i += 16)
+                aes_crypt_ecb(&enc_ctx, AES_ENCRYPT, &input[i], &output[i]);
+        }));
+        add("ecb_decrypt", measure_mib_s(size, [&]() {
+            for (size_t i = 0; i < size; i += 16)
+                aes_crypt_ecb(&dec_ctx, AES_DECRYPT, &input[i], &output[i]);
+        }));
+        add("cbc_encrypt", measure_mib_s(size, [&]() {
+            unsigned char iv[16] = {};
+            aes_crypt_cbc(&enc_ctx, AES_ENCRYPT, size, iv, input.data(), output.data());
+        }));
+        add("cbc_decrypt", measure_mib_s(size, [&]() {
+            unsigned char iv[16] = {};
+            aes_crypt_cbc(&dec_ctx, AES_DECRYPT, size, iv, input.data(), output.data());
+        }));
+        add("ctr", measure_mib_s(size, [&]() {
+            unsigned char counter[16] = {};
+            unsigned char stream_block[16];
+            size_t nc_off = 0;
+            aes_crypt_ctr(&enc_ctx, size, &nc_off, counter, stream_block, input.data(), output.data());
+        }));
+        return results;
+    };
+
+    const auto run_sha256 = [&]() {
+        return measure_mib_s(size, [&]() {
+            volatile uint8_t first = sha256(input.data(), size)[0];
+            (void)first;
+        });
+    };
+
+    aes_set_hw_enabled(0);
+    sha256_set_hw_enabled(false);
+    const std::string aes_tables = run_aes();
+    const double sha256_portable = run_sha256();
+
+    std::string aes_hw = "null";
+    std::string sha256_hw = "null";
+    if (aes_hw_supported()) {
+        aes_set_hw_enabled(1);
+        aes_hw = '{' + run_aes() + '}';
+    }
+    if (sha256_hw_supported()) {
+        sha256_set_hw_enabled(true);
+        sha256_hw = fmt::format("{:.1f}", run_sha256());
+    }
+
+    fmt::print(R"({{"size_mib":{},"aes_tables":{{{}}},"aes_hw":{},"sha256_portable":{:.1f},"sha256_hw":{}}})"
+               "\n",
+        size / (1024 * 1024), aes_tables, aes_hw, sha256_portable, sha256_hw);
+    return 0;
+}
@@ -173,6 +173,23 @@ int aes_crypt_ctr(aes_context *ctx,
 
 void aes_cmac(aes_context *ctx, int length, unsigned char *input, unsigned char *output);
 
+/**
+ * \brief          Check if the AES-NI (x86) or Crypto Extension (ARMv8)
+ *                 instructions are available. When they are, the functions
+ *                 above use them instead of the lookup tables.
+ *
+ * \return         1 if supported, 0 otherwise
+ */
+int aes_hw_supported(void);
+
+/**
+ * \brief          Allow or forbid the use of the hardware instructions,
+ *                 used to compare both implementations
+ *
+ * \param enabled  0 to always use the lookup tables
+ */
+void aes_set_hw_enabled(int enabled);
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,6 +24,10 @@
 using Sha256Hash = std::array<uint8_t, 32>;
 
 Sha256Hash sha256(const void *data, size_t size);
+// true if sha256 uses the SHA-NI (x86) or SHA2 (ARMv8) instructions
+bool sha256_hw_supported();
+// used to compare the hardware and portable implementations
+void sha256_set_hw_enabled(bool enabled);
 typedef std::array<char, 65> Sha256HashText;
 
 void hex_buf(const std::uint8_t *hash, char *dst, const std::size_t source_size);
@@ -567,6 +567,178 @@ int aes_setkey_dec(aes_context *ctx, const unsigned char *key, unsigned int keys
         X3 = *RK++ ^ RT0[(Y3)&0xFF] ^ RT1[(Y2 >> 8) & 0xFF] ^ RT2[(Y1 >> 16) & 0xFF] ^ RT3[(Y0 >> 24) & 0xFF]; \
     }
 
+/*
+ * Hardware AES (AES-NI on x86, Crypto Extension on ARMv8)
+ *
+ * Both instruction sets work on the round keys computed above: the encryption
+ * schedule is the plain FIPS-197 one and the decryption schedule is already the
+ * "equivalent inverse cipher" one, with InvMixColumns applied to the middle keys.
+ * The keys are stored as little endian words, so their bytes are in order in memory.
+ */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define AES_HW_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AES_HW_TARGET
+#else
+#include <cpuid.h>
+#define AES_HW_TARGET __attribute__((target("aes,sse2")))
+#endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define AES_HW_ARM
+#include <arm_neon.h>
+#endif
+
+// blocks in flight in the hardware loops, and blocks prepared per call by the CBC and CTR modes
+#define AES_HW_BATCH 4
+#define AES_HW_CHUNK 32
+
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+static int aes_hw_detect(void) {
+#if defined(AES_HW_X86)
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[2] >> 25) & 1;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (ecx >> 25) & 1;
+#endif
+#else
+    // the build only enables this path when the target has the crypto extension
+    return 1;
+#endif
+}
+
+static const int aes_hw_supported_flag = aes_hw_detect();
+static int aes_hw_enabled = 1;
+
+static int aes_hw_available(void) {
+    return aes_hw_supported_flag && aes_hw_enabled;
+}
+
+#if defined(AES_HW_X86)
+/*
+ * Encrypt or decrypt AES_HW_BATCH independent blocks so their rounds are in flight
+ * together. input and output may be the same buffer.
+ */
+AES_HW_TARGET static inline void aes_hw_crypt_batch(const __m128i *rk, int nr, int mode, const unsigned char *input, unsigned char *output) {
+    __m128i b[AES_HW_BATCH];
+    for (int j = 0; j < AES_HW_BATCH; j++)
+        b[j] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input) + j), rk[0]);
+
+    if (mode == AES_DECRYPT) {
+        for (int i = 1; i < nr; i++) {
+            for (int j = 0; j < AES_HW_BATCH; j++)
+                b[j] = _mm_aesdec_si128(b[j], rk[i]);
+        }
+        for (int j = 0; j < AES_HW_BATCH; j++)
+            b[j] = _mm_aesdeclast_si128(b[j], rk[nr]);
+    } else {
+        for (int i = 1; i < nr; i++) {
+            for (int j = 0; j < AES_HW_BATCH; j++)
+                b[j] = _mm_aesenc_si128(b[j], rk[i]);
+        }
+        for (int j = 0; j < AES_HW_BATCH; j++)
+            b[j] = _mm_aesenclast_si128(b[j], rk[nr]);
+    }
+
+    for (int j = 0; j < AES_HW_BATCH; j++)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output) + j, b[j]);
+}
+
+AES_HW_TARGET static void aes_hw_crypt_blocks(const aes_context *ctx, int mode, const unsigned char *input, unsigned char *output, size_t blocks) {
+    __m128i rk[15];
+    const int nr = ctx->nr;
+    for (int i = 0; i <= nr; i++)
+        rk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctx->rk) + i);
+#else
+/*
+ * Same as above with the ARMv8 instructions, AESE/AESD include the round key
+ * addition so the last key is xored separately.
+ */
+static inline void aes_hw_crypt_batch(const uint8x16_t *rk, int nr, int mode, const unsigned char *input, unsigned char *output) {
+    uint8x16_t b[AES_HW_BATCH];
+    for (int j = 0; j < AES_HW_BATCH; j++)
+        b[j] = vld1q_u8(input + j * 16);
+
+    if (mode == AES_DECRYPT) {
+        for (int i = 0; i < nr - 1; i++) {
+            for (int j = 0; j < AES_HW_BATCH; j++)
+                b[j] = vaesimcq_u8(vaesdq_u8(b[j], rk[i]));
+        }
+        for (int j = 0; j < AES_HW_BATCH; j++)
+            b[j] = veorq_u8(vaesdq_u8(b[j], rk[nr - 1]), rk[nr]);
+    } else {
+        for (int i = 0; i < nr - 1; i++) {
+            for (int j = 0; j < AES_HW_BATCH; j++)
+                b[j] = vaesmcq_u8(vaeseq_u8(b[j], rk[i]));
+        }
+        for (int j = 0; j < AES_HW_BATCH; j++)
+            b[j] = veorq_u8(vaeseq_u8(b[j], rk[nr - 1]), rk[nr]);
+    }
+
+    for (int j = 0; j < AES_HW_BATCH; j++)
+        vst1q_u8(output + j * 16, b[j]);
+}
+
+static void aes_hw_crypt_blocks(const aes_context *ctx, int mode, const unsigned char *input, unsigned char *output, size_t blocks) {
+    uint8x16_t rk[15];
+    const int nr = ctx->nr;
+    for (int i = 0; i <= nr; i++)
+        rk[i] = vld1q_u8(reinterpret_cast<const uint8_t *>(ctx->rk) + i * 16);
+#endif
+
+    for (; blocks >= AES_HW_BATCH; blocks -= AES_HW_BATCH) {
+        aes_hw_crypt_batch(rk, nr, mode, input, output);
+        input += 16 * AES_HW_BATCH;
+        output += 16 * AES_HW_BATCH;
+    }
+
+    // the last blocks go through a full batch too, it takes about as long as a single block
+    if (blocks > 0) {
+        unsigned char tail[16 * AES_HW_BATCH] = {};
+        memcpy(tail, input, blocks * 16);
+        aes_hw_crypt_batch(rk, nr, mode, tail, tail);
+        memcpy(output, tail, blocks * 16);
+    }
+}
+
+#else
+static int aes_hw_available(void) {
+    return 0;
+}
+
+static void aes_hw_crypt_blocks(const aes_context *ctx, int mode, const unsigned char *input, unsigned char *output, size_t blocks) {
+}
+#endif
+
+int aes_hw_supported(void) {
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+    return aes_hw_supported_flag;
+#else
+    return 0;
+#endif
+}
+
+void aes_set_hw_enabled(int enabled) {
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+    aes_hw_enabled = enabled;
+#endif
+}
+
+/*
+ * Increment the 128-bit big endian counter of CTR mode
+ */
+static void aes_ctr_increment(unsigned char nonce_counter[16]) {
+    for (int i = 16; i > 0; i--)
+        if (++nonce_counter[i - 1] != 0)
+            break;
+}
+
 /*
  * AES-ECB block encryption/decryption
  */
@@ -577,6 +749,11 @@ int aes_crypt_ecb(aes_context *ctx,
     int i;
     uint32_t *RK, X0, X1, X2, X3, Y0, Y1, Y2, Y3;
 
+    if (aes_hw_available()) {
+        aes_hw_crypt_blocks(ctx, mode, input, output, 1);
+        return (0);
+    }
+
     RK = ctx->rk;
 
     GET_UINT32_LE(X0, input, 0);
@@ -645,7 +822,29 @@ int aes_crypt_cbc(aes_context *ctx,
     if (length % 16)
         return (POLARSSL_ERR_AES_INVALID_INPUT_LENGTH);
 
-    if (mode == AES_DECRYPT) {
+    if (mode == AES_DECRYPT && aes_hw_available()) {
+        // the blocks do not depend on each other when decrypting, so decrypt them in batches
+        unsigned char chain[16];
+        unsigned char cipher[16 * AES_HW_CHUNK];
+        size_t j;
+        memcpy(chain, iv, 16);
+        while (length > 0) {
+            const size_t size = length < sizeof(cipher) ? length : sizeof(cipher);
+            memcpy(cipher, input, size);
+            aes_hw_crypt_blocks(ctx, mode, input, output, size / 16);
+
+            for (i = 0; i < 16; i++)
+                output[i] = (unsigned char)(output[i] ^ chain[i]);
+            for (j = 16; j < size; j++)
+                output[j] = (unsigned char)(output[j] ^ cipher[j - 16]);
+
+            memcpy(chain, cipher + size - 16, 16);
+
+            input += size;
+            output += size;
+            length -= size;
+        }
+    } else if (mode == AES_DECRYPT) {
         memcpy(orig_iv, iv, 16);
         while (length > 0) {
             memcpy(temp, input, 16);
@@ -728,16 +927,44 @@ int aes_crypt_ctr(aes_context *ctx,
     unsigned char stream_block[16],
     const unsigned char *input,
     unsigned char *output) {
-    int c, i;
+    int c;
     size_t n = *nc_off;
 
+    if (aes_hw_available()) {
+        unsigned char counters[16 * AES_HW_CHUNK];
+        unsigned char stream[16 * AES_HW_CHUNK];
+        size_t j;
+
+        // finish the stream block of the previous call, then generate whole batches
+        while (n != 0 && length > 0) {
+            c = *input++;
+            *output++ = (unsigned char)(c ^ stream_block[n]);
+            n = (n + 1) & 0x0F;
+            length--;
+        }
+
+        while (length >= 16) {
+            const size_t blocks = length / 16 < AES_HW_CHUNK ? length / 16 : AES_HW_CHUNK;
+            for (j = 0; j < blocks; j++) {
+                memcpy(counters + j * 16, nonce_counter, 16);
+                aes_ctr_increment(nonce_counter);
+            }
+            aes_hw_crypt_blocks(ctx, AES_ENCRYPT, counters, stream, blocks);
+
+            for (j = 0; j < blocks * 16; j++)
+                output[j] = (unsigned char)(input[j] ^ stream[j]);
+            memcpy(stream_block, stream + (blocks - 1) * 16, 16);
+
+            input += blocks * 16;
+            output += blocks * 16;
+            length -= blocks * 16;
+        }
+    }
+
     while (length--) {
         if (n == 0) {
             aes_crypt_ecb(ctx, AES_ENCRYPT, nonce_counter, stream_block);
-
-            for (i = 16; i > 0; i--)
-                if (++nonce_counter[i - 1] != 0)
-                    break;
+            aes_ctr_increment(nonce_counter);
         }
         c = *input++;
         *output++ = (unsigned char)(c ^ stream_block[n]);
@@ -16,13 +16,192 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include <crypto/hash.h>
+#include <cstring>
 #include <string>
 
 extern "C" {
 #include <sha256.h>
 }
 
+// SHA-NI (x86) and ARMv8 SHA2 instructions, used for whole messages instead of crypto-algorithms
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SHA_HW_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SHA_HW_TARGET
+#else
+#include <cpuid.h>
+#define SHA_HW_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define SHA_HW_ARM
+#include <arm_neon.h>
+#endif
+
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM)
+alignas(16) static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static bool sha256_hw_detect() {
+#if defined(SHA_HW_X86)
+    // SHA extensions in leaf 7, SSSE3 and SSE4.1 in leaf 1
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return false;
+    __cpuid(regs, 1);
+    const unsigned int ecx = regs[2];
+    __cpuidex(regs, 7, 0);
+    const unsigned int ebx = regs[1];
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+    __cpuid(1, eax, ebx, ecx, edx);
+    const unsigned int leaf1_ecx = ecx;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    ecx = leaf1_ecx;
+#endif
+    return (ebx & (1u << 29)) && (ecx & (1u << 19)) && (ecx & (1u << 9));
+#else
+    // the build only enables this path when the target has the SHA2 instructions
+    return true;
+#endif
+}
+
+static const bool sha256_hw_supported_flag = sha256_hw_detect();
+static bool sha256_hw_enabled = true;
+
+#if defined(SHA_HW_X86)
+SHA_HW_TARGET static void sha256_hw_blocks(uint32_t state[8], const uint8_t *data, size_t blocks) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // the rounds instruction works on the ABEF and CDGH halves of the state
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0])), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4])), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        const __m128i abef = state0;
+        const __m128i cdgh = state1;
+        __m128i w[4];
+
+        for (int i = 0; i < 16; i++) {
+            if (i < 4) {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data) + i), mask);
+            } else {
+                // w[i % 4] holds the words of 16 rounds ago, computes the 4 next ones in place
+                const __m128i w7 = _mm_alignr_epi8(w[(i + 3) % 4], w[(i + 2) % 4], 4);
+                w[i % 4] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w[i % 4], w[(i + 1) % 4]), w7), w[(i + 3) % 4]);
+            }
+
+            __m128i msg = _mm_add_epi32(w[i % 4], _mm_load_si128(reinterpret_cast<const __m128i *>(&sha256_k[i * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), state1);
+}
+#else
+static void sha256_hw_blocks(uint32_t state[8], const uint8_t *data, size_t blocks) {
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        const uint32x4_t abcd = state0;
+        const uint32x4_t efgh = state1;
+        uint32x4_t w[4];
+
+        for (int i = 0; i < 16; i++) {
+            if (i < 4)
+                w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+            else
+                w[i % 4] = vsha256su1q_u32(vsha256su0q_u32(w[i % 4], w[(i + 1) % 4]), w[(i + 2) % 4], w[(i + 3) % 4]);
+
+            const uint32x4_t msg = vaddq_u32(w[i % 4], vld1q_u32(&sha256_k[i * 4]));
+            const uint32x4_t prev = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, prev, msg);
+        }
+
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif
+
+static Sha256Hash sha256_hw(const void *data, size_t size) {
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    sha256_hw_blocks(state, bytes, size / 64);
+
+    // the padding takes one or two more blocks
+    uint8_t tail[128] = {};
+    const size_t remaining = size % 64;
+    if (remaining != 0)
+        memcpy(tail, bytes + size - remaining, remaining);
+    tail[remaining] = 0x80;
+    const size_t tail_size = remaining < 56 ? 64 : 128;
+    const uint64_t bits = static_cast<uint64_t>(size) * 8;
+    for (int i = 0; i < 8; i++)
+        tail[tail_size - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    sha256_hw_blocks(state, tail, tail_size / 64);
+
+    Sha256Hash hash;
+    for (int i = 0; i < 8; i++) {
+        hash[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        hash[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        hash[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        hash[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+    return hash;
+}
+#endif
+
+bool sha256_hw_supported() {
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM)
+    return sha256_hw_supported_flag;
+#else
+    return false;
+#endif
+}
+
+void sha256_set_hw_enabled(bool enabled) {
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM)
+    sha256_hw_enabled = enabled;
+#endif
+}
+
 Sha256Hash sha256(const void *data, size_t size) {
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM)
+    if (sha256_hw_supported_flag && sha256_hw_enabled)
+        return sha256_hw(data, size);
+#endif
+
     Sha256Hash hash;
     SHA256_CTX sha_ctx = {};
     sha256_init_one(&sha_ctx);
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <ctrl/input_record.h>
 #include <ctrl/state.h>
 #include <emuenv/state.h>
 
@@ -26,3 +27,5 @@ std::array<ControllerBinding, 15> get_controller_bindings_ext(EmuEnvState &emuen
 SceCtrlExternalInputMode get_type_of_controller(const int idx);
 int ctrl_get(const SceUID thread_id, EmuEnvState &emuenv, int port, SceCtrlData2 *pData, SceUInt32 count, bool negative, bool is_peek, bool is_v2, bool from_ext);
 void refresh_controllers(CtrlState &state, EmuEnvState &emuenv);
+// buttons and axes of the keyboard and the controllers bound to the port, the mutex of the state must be locked
+CtrlPortInput get_host_ctrl_input(EmuEnvState &emuenv, int port);
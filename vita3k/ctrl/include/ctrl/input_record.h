@@ -0,0 +1,101 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <ctrl/ctrl.h>
+#include <touch/touch.h>
+#include <util/fs.h>
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct EmuEnvState;
+
+enum class InputRecordMode {
+    None,
+    Record,
+    Replay
+};
+
+struct CtrlPortInput {
+    // with the layout of the functions without and with the L2/R2/L3/R3 buttons
+    uint32_t buttons = 0;
+    uint32_t buttons_ext = 0;
+    // lx, ly, rx, ry in analog mode
+    std::array<uint8_t, 4> axes = { 0x80, 0x80, 0x80, 0x80 };
+
+    bool operator==(const CtrlPortInput &rhs) const = default;
+};
+
+struct TouchPortInput {
+    uint32_t status = 0;
+    std::vector<SceTouchReport> reports;
+};
+
+struct MotionInputUpdate {
+    SceFVector3 acceleration;
+    SceFVector3 gyroscope;
+    // time since the previous update of the sensors, in microseconds
+    uint64_t accel_elapsed;
+    uint64_t gyro_elapsed;
+};
+
+// Input given to the app during one vblank
+struct InputFrame {
+    std::array<CtrlPortInput, SCE_CTRL_MAX_WIRELESS_NUM> ctrl;
+    std::array<TouchPortInput, SCE_TOUCH_PORT_MAX_NUM> touch;
+    // only set on the vblanks the sensors were read
+    bool has_motion = false;
+    MotionInputUpdate motion;
+};
+
+// The input of each vblank is written to a file, or read from it and given to the app at the same vcount,
+// so two runs of a benchmark follow the same path through the app
+// Only the vblanks where the input changes are stored
+struct InputRecord {
+    InputRecordMode mode = InputRecordMode::None;
+    fs::path path;
+    std::fstream file;
+
+    // input of the current vblank, read by sceCtrl instead of the host devices when recording or replaying
+    // ctrl is protected by the mutex of CtrlState
+    InputFrame frame;
+
+    // last frame written, or next frame to give to the app and its vcount
+    InputFrame last_frame;
+    uint64_t next_vcount = 0;
+    uint64_t frames_count = 0;
+
+    // motion state when the last frame was recorded, the next update is relative to it
+    uint32_t motion_counter = 0;
+    uint64_t gyro_timestamp = 0;
+    uint64_t accel_timestamp = 0;
+
+    bool is_active() const {
+        return mode != InputRecordMode::None;
+    }
+};
+
+bool start_input_record(InputRecord &record, const fs::path &path, const std::string &title_id);
+bool start_input_replay(InputRecord &record, const fs::path &path, const std::string &title_id);
+void stop_input_record(InputRecord &record);
+
+// called by the vblank thread once the touch and motion states of the vblank are updated
+void update_input_record(EmuEnvState &emuenv, uint64_t vcount);
@@ -0,0 +1,75 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#pragma once
+
+#include <ctrl/input_record.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+struct EmuEnvState;
+
+// Input of a port sampled by the polling thread
+struct CtrlSnapshot {
+    // steady clock time in microseconds, like the timestamps given to the app
+    uint64_t timestamp = 0;
+    CtrlPortInput input;
+};
+
+// Snapshots written by the polling thread and read by sceCtrl without any lock
+// Each slot is guarded by a sequence number which is odd while the slot is written, a reader retries when it changed
+class CtrlSnapshotRing {
+public:
+    // about one second of history at 1 kHz
+    static constexpr size_t SIZE = 1024;
+
+    // only called by the polling thread
+    void push(const CtrlSnapshot &snapshot);
+    // latest snapshot taken at or before the timestamp, or the oldest one kept, false if there is none yet
+    bool find(uint64_t timestamp, CtrlSnapshot &snapshot) const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<uint64_t> timestamp{ 0 };
+        std::atomic<uint64_t> buttons{ 0 };
+        std::atomic<uint32_t> axes{ 0 };
+    };
+
+    void read_slot(const Slot &slot, CtrlSnapshot &snapshot) const;
+
+    std::array<Slot, SIZE> slots;
+    std::atomic<uint64_t> count{ 0 };
+};
+
+// Thread sampling the keyboard and the controllers at a fixed rate, so the input read by the app
+// does not depend on how often the main loop pumps the events
+struct CtrlPoller {
+    std::array<CtrlSnapshotRing, SCE_CTRL_MAX_WIRELESS_NUM> rings;
+    std::atomic<bool> running{ false };
+    std::thread thread;
+
+    // the thread is only stopped with the state of the controllers
+    ~CtrlPoller();
+};
+
+// starts the polling thread if a polling rate is set in the config
+void start_ctrl_polling(EmuEnvState &emuenv);
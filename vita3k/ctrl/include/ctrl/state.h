@@ -19,6 +19,8 @@
 
 #include <ctrl/ctrl.h>
 #include <ctrl/functions.h>
+#include <ctrl/input_record.h>
+#include <ctrl/poller.h>
 
 #include <SDL_gamecontroller.h>
 #include <SDL_haptic.h>
@@ -67,4 +69,9 @@ struct CtrlState {
 
     // last vsync the data was read
     uint64_t last_vcount[5] = {};
+
+    InputRecord input_record;
+
+    // set once the polling thread is started, the host devices are then read from its snapshots
+    std::unique_ptr<CtrlPoller> poller;
 };
@@ -255,17 +255,42 @@ static void apply_controller(EmuEnvState &emuenv, uint32_t *buttons, float axes[
     axes[3] += axis_to_axis(SDL_GameControllerGetAxis(controller, SDL_CONTROLLER_AXIS_RIGHTY));
 }
 
-static void retrieve_ctrl_data(EmuEnvState &emuenv, int port, bool is_v2, bool negative, bool from_ext_function, SceUInt32 &buttons, SceUInt8 &lx, SceUInt8 &ly, SceUInt8 &rx, SceUInt8 &ry) {
+static void apply_host_input(EmuEnvState &emuenv, int port, bool is_v2, uint32_t *buttons, float axes[4]) {
+    if (port == 1) {
+        apply_keyboard(buttons, axes, is_v2, emuenv);
+    }
+    for (const auto &controller : emuenv.ctrl.controllers) {
+        if (controller.second.port == port) {
+            apply_controller(emuenv, buttons, axes, controller.second.controller.get(), is_v2);
+        }
+    }
+}
+
+CtrlPortInput get_host_ctrl_input(EmuEnvState &emuenv, int port) {
+    CtrlPortInput input;
+    std::array<float, 4> axes;
+    axes.fill(0);
+    apply_host_input(emuenv, port, false, &input.buttons, axes.data());
+
+    axes.fill(0);
+    apply_host_input(emuenv, port, true, &input.buttons_ext, axes.data());
+    for (size_t i = 0; i < axes.size(); i++)
+        input.axes[i] = float_to_byte(axes[i]);
+
+    return input;
+}
+
+// the host input is taken from the polled snapshot when there is one, otherwise the devices are read now
+static void retrieve_ctrl_data(EmuEnvState &emuenv, int port, bool is_v2, bool negative, bool from_ext_function, const CtrlPortInput *polled_input, SceUInt32 &buttons, SceUInt8 &lx, SceUInt8 &ly, SceUInt8 &rx, SceUInt8 &ry) {
     std::lock_guard<std::mutex> guard(emuenv.ctrl.mutex);
 
     if (port == 0) {
         port++;
     }
     CtrlState &state = emuenv.ctrl;
-    refresh_controllers(state, emuenv);
 
-    std::array<float, 4> axes;
-    axes.fill(0);
+    std::array<uint8_t, 4> axes;
+    axes.fill(float_to_byte(0));
 
     const auto reset_axes = [&]() {
         SceCtrlPadInputMode mode = from_ext_function ? state.input_mode_ext : state.input_mode;
@@ -275,10 +300,10 @@ static void retrieve_ctrl_data(EmuEnvState &emuenv, int port, bool is_v2, bool n
             rx = 0x80;
             ry = 0x80;
         } else {
-            lx = float_to_byte(axes[0]);
-            ly = float_to_byte(axes[1]);
-            rx = float_to_byte(axes[2]);
-            ry = float_to_byte(axes[3]);
+            lx = axes[0];
+            ly = axes[1];
+            rx = axes[2];
+            ry = axes[3];
         }
     };
 
@@ -289,13 +314,27 @@ static void retrieve_ctrl_data(EmuEnvState &emuenv, int port, bool is_v2, bool n
         return;
     }
 
-    if (port == 1) {
-        apply_keyboard(&buttons, axes.data(), is_v2, emuenv);
-    }
-    for (const auto &controller : state.controllers) {
-        if (controller.second.port == port) {
-            apply_controller(emuenv, &buttons, axes.data(), controller.second.controller.get(), is_v2);
-        }
+    if (state.input_record.is_active()) {
+        // the input sampled at the last vblank, the one which is recorded or replayed
+        const CtrlPortInput &input = state.input_record.frame.ctrl[port - 1];
+        buttons = is_v2 ? input.buttons_ext : input.buttons;
+        axes = input.axes;
+    } else if (polled_input) {
+        buttons = is_v2 ? polled_input->buttons_ext : polled_input->buttons;
+        axes = polled_input->axes;
+    } else {
+        refresh_controllers(state, emuenv);
+
+        // in low latency mode, poll the controllers now instead of using the state from the last event loop
+        // the keyboard state can only be updated by the main thread
+        if (emuenv.cfg.low_latency)
+            SDL_GameControllerUpdate();
+
+        std::array<float, 4> host_axes;
+        host_axes.fill(0);
+        apply_host_input(emuenv, port, is_v2, &buttons, host_axes.data());
+        for (size_t i = 0; i < host_axes.size(); i++)
+            axes[i] = float_to_byte(host_axes[i]);
     }
 
     reset_axes();
@@ -332,8 +371,27 @@ int ctrl_get(const SceUID thread_id, EmuEnvState &emuenv, int port, SceCtrlData2
 
     std::chrono::time_point<std::chrono::steady_clock> ts = std::chrono::steady_clock::now();
     uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(ts.time_since_epoch()).count();
+
+    const CtrlPoller *poller;
+    {
+        const std::lock_guard<std::mutex> guard(state.mutex);
+        poller = state.poller.get();
+    }
+    CtrlSnapshot snapshot;
+    if (poller && poller->rings[std::max(port, 1) - 1].find(timestamp, snapshot)) {
+        // each buffer entry is the input sampled at its vsync, with the time it was sampled
+        for (int i = 0; i < nb_returned_data; i++) {
+            if (i > 0)
+                poller->rings[std::max(port, 1) - 1].find(timestamp - i * 16667ULL, snapshot);
+            pData[i].timeStamp = snapshot.timestamp;
+            retrieve_ctrl_data(emuenv, port, is_v2, negative, from_ext, &snapshot.input, pData[i].buttons, pData[i].lx, pData[i].ly, pData[i].rx, pData[i].ry);
+        }
+
+        return nb_returned_data;
+    }
+
     pData->timeStamp = timestamp;
-    retrieve_ctrl_data(emuenv, port, is_v2, negative, from_ext, pData->buttons, pData->lx, pData->ly, pData->rx, pData->ry);
+    retrieve_ctrl_data(emuenv, port, is_v2, negative, from_ext, nullptr, pData->buttons, pData->lx, pData->ly, pData->rx, pData->ry);
 
     for (int i = 1; i < nb_returned_data; i++) {
         memcpy(&pData[i], &pData[0], sizeof(SceCtrlData2));
@@ -0,0 +1,289 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <ctrl/functions.h>
+#include <ctrl/input_record.h>
+#include <ctrl/state.h>
+
+#include <emuenv/state.h>
+#include <motion/state.h>
+#include <touch/functions.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+// Layout of an input record: magic, version, title id, then for each vblank where the input changes,
+// its vcount, a mask of the parts which changed and these parts
+constexpr char INPUT_RECORD_MAGIC[4] = { 'V', '3', 'K', 'I' };
+constexpr uint32_t INPUT_RECORD_VERSION = 1;
+
+enum InputChange : uint8_t {
+    // one bit for each controller port
+    INPUT_CHANGE_CTRL = 1 << 0,
+    INPUT_CHANGE_TOUCH = 1 << SCE_CTRL_MAX_WIRELESS_NUM,
+    INPUT_CHANGE_MOTION = 1 << (SCE_CTRL_MAX_WIRELESS_NUM + SCE_TOUCH_PORT_MAX_NUM)
+};
+
+template <typename T>
+static void write_value(std::fstream &file, const T &value) {
+    file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_value(std::fstream &file, T &value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+static bool operator==(const TouchPortInput &lhs, const TouchPortInput &rhs) {
+    return (lhs.status == rhs.status) && (lhs.reports.size() == rhs.reports.size())
+        && (memcmp(lhs.reports.data(), rhs.reports.data(), lhs.reports.size() * sizeof(SceTouchReport)) == 0);
+}
+
+bool start_input_record(InputRecord &record, const fs::path &path, const std::string &title_id) {
+    record.file.open(path.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!record.file.is_open()) {
+        LOG_ERROR("Failed to create the input record {}", path.string());
+        return false;
+    }
+
+    record.file.write(INPUT_RECORD_MAGIC, sizeof(INPUT_RECORD_MAGIC));
+    write_value(record.file, INPUT_RECORD_VERSION);
+    write_value(record.file, static_cast<uint32_t>(title_id.size()));
+    record.file.write(title_id.data(), title_id.size());
+
+    record.path = path;
+    record.frame = {};
+    record.last_frame = {};
+    record.frames_count = 0;
+    record.motion_counter = 0;
+    record.gyro_timestamp = 0;
+    record.accel_timestamp = 0;
+    record.mode = InputRecordMode::Record;
+    LOG_INFO("Recording the input to {}", path.string());
+    return true;
+}
+
+// read the changes of the next vblank in last_frame, return false at the end of the record
+static bool read_next_frame(InputRecord &record) {
+    uint8_t changes = 0;
+    if (!read_value(record.file, record.next_vcount) || !read_value(record.file, changes))
+        return false;
+
+    for (int port = 0; port < SCE_CTRL_MAX_WIRELESS_NUM; port++) {
+        if (changes & (INPUT_CHANGE_CTRL << port)) {
+            CtrlPortInput &input = record.last_frame.ctrl[port];
+            read_value(record.file, input.buttons);
+            read_value(record.file, input.buttons_ext);
+            read_value(record.file, input.axes);
+        }
+    }
+
+    for (int port = 0; port < SCE_TOUCH_PORT_MAX_NUM; port++) {
+        if (changes & (INPUT_CHANGE_TOUCH << port)) {
+            TouchPortInput &input = record.last_frame.touch[port];
+            uint8_t report_count = 0;
+            read_value(record.file, input.status);
+            read_value(record.file, report_count);
+            input.reports.resize(std::min<uint8_t>(report_count, SCE_TOUCH_MAX_REPORT));
+            record.file.read(reinterpret_cast<char *>(input.reports.data()), input.reports.size() * sizeof(SceTouchReport));
+        }
+    }
+
+    record.last_frame.has_motion = changes & INPUT_CHANGE_MOTION;
+    if (record.last_frame.has_motion)
+        read_value(record.file, record.last_frame.motion);
+
+    return static_cast<bool>(record.file);
+}
+
+bool start_input_replay(InputRecord &record, const fs::path &path, const std::string &title_id) {
+    record.file.open(path.string(), std::ios::in | std::ios::binary);
+
+    char magic[sizeof(INPUT_RECORD_MAGIC)];
+    uint32_t version = 0;
+    uint32_t title_id_size = 0;
+    if (!record.file.read(magic, sizeof(magic)) || memcmp(magic, INPUT_RECORD_MAGIC, sizeof(magic)) != 0
+        || !read_value(record.file, version) || (version != INPUT_RECORD_VERSION)
+        || !read_value(record.file, title_id_size) || (title_id_size > 64)) {
+        LOG_ERROR("{} is not a valid input record", path.string());
+        record.file.close();
+        return false;
+    }
+
+    std::string record_title_id(title_id_size, '\0');
+    record.file.read(record_title_id.data(), title_id_size);
+    if (record_title_id != title_id)
+        LOG_WARN("The input record {} was made with {}, not {}", path.string(), record_title_id, title_id);
+
+    record.path = path;
+    record.frame = {};
+    record.last_frame = {};
+    record.frames_count = 0;
+    if (!read_next_frame(record)) {
+        LOG_WARN("The input record {} is empty", path.string());
+        record.file.close();
+        return false;
+    }
+
+    record.mode = InputRecordMode::Replay;
+    LOG_INFO("Replaying the input from {}", path.string());
+    return true;
+}
+
+void stop_input_record(InputRecord &record) {
+    if (!record.is_active())
+        return;
+
+    if (record.mode == InputRecordMode::Record)
+        LOG_INFO("Input record {} written, {} changes", record.path.string(), record.frames_count);
+    record.mode = InputRecordMode::None;
+    record.file.close();
+}
+
+static void write_frame(InputRecord &record, uint64_t vcount) {
+    const InputFrame &frame = record.frame;
+    uint8_t changes = frame.has_motion ? INPUT_CHANGE_MOTION : 0;
+    for (int port = 0; port < SCE_CTRL_MAX_WIRELESS_NUM; port++) {
+        if (!(frame.ctrl[port] == record.last_frame.ctrl[port]))
+            changes |= INPUT_CHANGE_CTRL << port;
+    }
+    for (int port = 0; port < SCE_TOUCH_PORT_MAX_NUM; port++) {
+        if (!(frame.touch[port] == record.last_frame.touch[port]))
+            changes |= INPUT_CHANGE_TOUCH << port;
+    }
+    if (changes == 0)
+        return;
+
+    write_value(record.file, vcount);
+    write_value(record.file, changes);
+    for (int port = 0; port < SCE_CTRL_MAX_WIRELESS_NUM; port++) {
+        if (changes & (INPUT_CHANGE_CTRL << port)) {
+            write_value(record.file, frame.ctrl[port].buttons);
+            write_value(record.file, frame.ctrl[port].buttons_ext);
+            write_value(record.file, frame.ctrl[port].axes);
+        }
+    }
+    for (int port = 0; port < SCE_TOUCH_PORT_MAX_NUM; port++) {
+        if (changes & (INPUT_CHANGE_TOUCH << port)) {
+            write_value(record.file, frame.touch[port].status);
+            write_value(record.file, static_cast<uint8_t>(frame.touch[port].reports.size()));
+            record.file.write(reinterpret_cast<const char *>(frame.touch[port].reports.data()), frame.touch[port].reports.size() * sizeof(SceTouchReport));
+        }
+    }
+    if (frame.has_motion)
+        write_value(record.file, frame.motion);
+
+    record.last_frame = frame;
+    record.frames_count++;
+}
+
+static void record_input(EmuEnvState &emuenv, InputRecord &record, uint64_t vcount) {
+    {
+        const std::lock_guard<std::mutex> guard(emuenv.ctrl.mutex);
+        refresh_controllers(emuenv.ctrl, emuenv);
+        for (int port = 0; port < SCE_CTRL_MAX_WIRELESS_NUM; port++)
+            record.frame.ctrl[port] = get_host_ctrl_input(emuenv, port + 1);
+    }
+
+    for (int port = 0; port < SCE_TOUCH_PORT_MAX_NUM; port++) {
+        const SceTouchData &data = touch_get_vsync_data(port);
+        TouchPortInput &input = record.frame.touch[port];
+        input.status = data.status;
+        input.reports.assign(data.report, data.report + std::min<uint32_t>(data.reportNum, SCE_TOUCH_MAX_REPORT));
+    }
+
+    {
+        MotionState &motion = emuenv.motion;
+        const std::lock_guard<std::mutex> guard(motion.mutex);
+        record.frame.has_motion = motion.last_counter != record.motion_counter;
+        if (record.frame.has_motion) {
+            const Util::Vec3f acceleration = motion.motion_data.GetAcceleration();
+            const Util::Vec3f gyroscope = motion.motion_data.GetGyroscope();
+            record.frame.motion.acceleration = { acceleration.x, acceleration.y, acceleration.z };
+            record.frame.motion.gyroscope = { gyroscope.x, gyroscope.y, gyroscope.z };
+            record.frame.motion.accel_elapsed = motion.last_accel_timestamp - record.accel_timestamp;
+            record.frame.motion.gyro_elapsed = motion.last_gyro_timestamp - record.gyro_timestamp;
+        }
+        record.motion_counter = motion.last_counter;
+        record.gyro_timestamp = motion.last_gyro_timestamp;
+        record.accel_timestamp = motion.last_accel_timestamp;
+    }
+
+    write_frame(record, vcount);
+}
+
+// the touch data of the vblank is replaced, it keeps the timestamp of the host
+static void apply_touch_input(const InputRecord &record) {
+    for (int port = 0; port < SCE_TOUCH_PORT_MAX_NUM; port++) {
+        const TouchPortInput &input = record.frame.touch[port];
+        SceTouchData &data = touch_get_vsync_data(port);
+        data.status = input.status;
+        data.reportNum = static_cast<uint32_t>(input.reports.size());
+        std::copy(input.reports.begin(), input.reports.end(), data.report);
+    }
+}
+
+static void replay_input(EmuEnvState &emuenv, InputRecord &record, uint64_t vcount) {
+    while (record.next_vcount <= vcount) {
+        {
+            const std::lock_guard<std::mutex> guard(emuenv.ctrl.mutex);
+            record.frame.ctrl = record.last_frame.ctrl;
+        }
+        record.frame.touch = record.last_frame.touch;
+
+        if (record.last_frame.has_motion) {
+            const MotionInputUpdate &update = record.last_frame.motion;
+            MotionState &motion = emuenv.motion;
+            const std::lock_guard<std::mutex> guard(motion.mutex);
+            motion.motion_data.SetGyroscope({ update.gyroscope.x, update.gyroscope.y, update.gyroscope.z });
+            motion.motion_data.SetAcceleration({ update.acceleration.x, update.acceleration.y, update.acceleration.z });
+            motion.motion_data.UpdateRotation(update.gyro_elapsed);
+            motion.motion_data.UpdateOrientation(update.accel_elapsed);
+            motion.last_gyro_timestamp += update.gyro_elapsed;
+            motion.last_accel_timestamp += update.accel_elapsed;
+            motion.last_counter++;
+        }
+        record.frames_count++;
+
+        if (!read_next_frame(record)) {
+            LOG_INFO("Input replay of {} finished at vcount {}, the host devices are used again", record.path.string(), vcount);
+            // the last input stays until the next vblank
+            apply_touch_input(record);
+            stop_input_record(record);
+            return;
+        }
+    }
+
+    apply_touch_input(record);
+}
+
+void update_input_record(EmuEnvState &emuenv, uint64_t vcount) {
+    InputRecord &record = emuenv.ctrl.input_record;
+    switch (record.mode) {
+    case InputRecordMode::Record:
+        record_input(emuenv, record, vcount);
+        break;
+
+    case InputRecordMode::Replay:
+        replay_input(emuenv, record, vcount);
+        break;
+
+    default:
+        break;
+    }
+}
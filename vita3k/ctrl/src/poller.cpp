@@ -0,0 +1,142 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <ctrl/functions.h>
+#include <ctrl/poller.h>
+#include <ctrl/state.h>
+
+#include <config/state.h>
+#include <emuenv/state.h>
+#include <util/log.h>
+
+#include <SDL_gamecontroller.h>
+
+#include <algorithm>
+#include <chrono>
+
+// the polling rate is limited so a wrong value does not keep a host core busy
+static constexpr int MAX_POLL_RATE = 8000;
+// the slots this close to the writer can be overwritten while they are searched
+static constexpr size_t WRITER_MARGIN = 16;
+
+static uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CtrlSnapshotRing::push(const CtrlSnapshot &snapshot) {
+    const uint64_t index = count.load(std::memory_order_relaxed);
+    Slot &slot = slots[index % SIZE];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto &axes = snapshot.input.axes;
+    slot.timestamp.store(snapshot.timestamp, std::memory_order_relaxed);
+    slot.buttons.store(snapshot.input.buttons | (static_cast<uint64_t>(snapshot.input.buttons_ext) << 32), std::memory_order_relaxed);
+    slot.axes.store(axes[0] | (axes[1] << 8) | (axes[2] << 16) | (static_cast<uint32_t>(axes[3]) << 24), std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    count.store(index + 1, std::memory_order_release);
+}
+
+void CtrlSnapshotRing::read_slot(const Slot &slot, CtrlSnapshot &snapshot) const {
+    uint64_t sequence;
+    uint64_t buttons;
+    uint32_t axes;
+    do {
+        sequence = slot.sequence.load(std::memory_order_acquire);
+        snapshot.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+        buttons = slot.buttons.load(std::memory_order_relaxed);
+        axes = slot.axes.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || (slot.sequence.load(std::memory_order_relaxed) != sequence));
+
+    snapshot.input.buttons = static_cast<uint32_t>(buttons);
+    snapshot.input.buttons_ext = static_cast<uint32_t>(buttons >> 32);
+    for (size_t i = 0; i < snapshot.input.axes.size(); i++)
+        snapshot.input.axes[i] = static_cast<uint8_t>(axes >> (i * 8));
+}
+
+bool CtrlSnapshotRing::find(const uint64_t timestamp, CtrlSnapshot &snapshot) const {
+    const uint64_t end = count.load(std::memory_order_acquire);
+    if (end == 0)
+        return false;
+
+    // the snapshots are searched from the newest one, the app usually asks for the last few vblanks
+    const uint64_t begin = end - std::min<uint64_t>(end, SIZE - WRITER_MARGIN);
+    for (uint64_t index = end; index > begin; index--) {
+        read_slot(slots[(index - 1) % SIZE], snapshot);
+        if (snapshot.timestamp <= timestamp)
+            return true;
+    }
+
+    return true;
+}
+
+static void polling_thread(EmuEnvState &emuenv, CtrlPoller &poller, const int rate) {
+    CtrlState &state = emuenv.ctrl;
+    const std::chrono::microseconds interval(1000000 / rate);
+    auto next_poll = std::chrono::steady_clock::now();
+
+    while (poller.running.load(std::memory_order_relaxed)) {
+        {
+            const std::lock_guard<std::mutex> guard(state.mutex);
+            refresh_controllers(state, emuenv);
+            SDL_GameControllerUpdate();
+
+            // the keyboard state can only be updated by the main thread, its last state is used
+            const uint64_t timestamp = now_us();
+            const int ports = emuenv.cfg.current_config.pstv_mode ? SCE_CTRL_MAX_WIRELESS_NUM : 1;
+            for (int port = 1; port <= ports; port++)
+                poller.rings[port - 1].push({ timestamp, get_host_ctrl_input(emuenv, port) });
+        }
+
+        // the polls which were missed are not caught up
+        next_poll += interval;
+        const auto now = std::chrono::steady_clock::now();
+        if (now > next_poll + interval)
+            next_poll = now;
+        std::this_thread::sleep_until(next_poll);
+    }
+}
+
+void start_ctrl_polling(EmuEnvState &emuenv) {
+    const int rate = std::min(emuenv.cfg.ctrl_poll_rate, MAX_POLL_RATE);
+    if ((rate <= 0) || emuenv.ctrl.poller)
+        return;
+
+    // the replayed input must come from the record only
+    if (emuenv.ctrl.input_record.is_active())
+        return;
+
+    auto poller = std::make_unique<CtrlPoller>();
+    poller->running = true;
+    poller->thread = std::thread(polling_thread, std::ref(emuenv), std::ref(*poller), rate);
+    {
+        // the app can already be reading the input
+        const std::lock_guard<std::mutex> guard(emuenv.ctrl.mutex);
+        emuenv.ctrl.poller = std::move(poller);
+    }
+    LOG_INFO("Polling the controllers at {} Hz", rate);
+}
+
+CtrlPoller::~CtrlPoller() {
+    running = false;
+    if (thread.joinable())
+        thread.join();
+}
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <kernel/callback.h>
 #include <mem/ptr.h>
 #include <memory>
@@ -67,6 +68,10 @@ struct DisplayState {
     std::atomic<std::uint64_t> vblank_count{ 0 };
     std::vector<DisplayStateVBlankWaitInfo> vblank_wait_infos;
     std::atomic<uint64_t> last_setframe_vblank_count = 0;
+    // time (in ms) between the frames set by the guest, taken by the metrics recorder
+    std::mutex frame_times_mutex;
+    std::vector<float> frame_times;
+    std::chrono::steady_clock::time_point last_frame_time{};
     std::map<SceUID, CallbackPtr> vblank_callbacks{};
 
     // should contain the list of sync objects / swapchain images (in the order they appear in the cycle)
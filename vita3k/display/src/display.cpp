@@ -24,20 +24,25 @@
 #include <renderer/state.h>
 
 #include <chrono>
+#include <config/state.h>
+#include <ctrl/input_record.h>
 #include <motion/functions.h>
 #include <touch/functions.h>
 #include <util/find.h>
+#include <util/thread_utils.h>
 
 // Code heavily influenced by PPSSSPP's SceDisplay.cpp
 
 static constexpr int TARGET_FPS = 60;
 static constexpr int64_t TARGET_MICRO_PER_FRAME = 1000000LL / TARGET_FPS;
+static constexpr std::chrono::nanoseconds TARGET_NANO_PER_FRAME(1000000000LL / TARGET_FPS);
 // how many cycles do we need to see before we start predicting the next frame
 static constexpr int predict_threshold = 3;
 static constexpr int max_expected_swapchain_size = 6;
 
 static void vblank_sync_thread(EmuEnvState &emuenv) {
     DisplayState &display = emuenv.display;
+    auto next_vblank = std::chrono::steady_clock::now();
 
     while (!display.abort.load()) {
         {
@@ -59,6 +64,7 @@ static void vblank_sync_thread(EmuEnvState &emuenv) {
             // maybe we should also use a mutex for this part, but it shouldn't be an issue
             touch_vsync_update(emuenv);
             refresh_motion(emuenv.motion, emuenv.ctrl);
+            update_input_record(emuenv, display.vblank_count);
 
             // Notify Vblank callback in each VBLANK start
             for (auto &cb : display.vblank_callbacks)
@@ -76,9 +82,19 @@ static void vblank_sync_thread(EmuEnvState &emuenv) {
                 }
             }
         }
-        const auto time_ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-        const auto time_left = TARGET_MICRO_PER_FRAME - (time_ms % TARGET_MICRO_PER_FRAME);
-        std::this_thread::sleep_for(std::chrono::microseconds(time_left));
+        if (emuenv.cfg.precise_vblank) {
+            next_vblank += TARGET_NANO_PER_FRAME;
+            const auto now = std::chrono::steady_clock::now();
+            // if we are more than a frame late (the host was suspended, a debugger break...)
+            // start again from now instead of sending all the missed vblanks at once
+            if (now > next_vblank + TARGET_NANO_PER_FRAME)
+                next_vblank = now;
+            thread_utils::precise_sleep_until(next_vblank);
+        } else {
+            const auto time_ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            const auto time_left = TARGET_MICRO_PER_FRAME - (time_ms % TARGET_MICRO_PER_FRAME);
+            std::this_thread::sleep_for(std::chrono::microseconds(time_left));
+        }
     }
 }
 
@@ -17,8 +17,12 @@
 
 #pragma once
 
+#include <deque>
 #include <functional>
+#include <map>
 #include <memory>
+#include <set>
+#include <string>
 #include <thread>
 
 #ifdef _WIN32
@@ -34,6 +38,8 @@ constexpr socket_t BAD_SOCK = -1;
 #endif
 
 constexpr uint32_t GDB_SERVER_PORT = 2159;
+// Largest packet sent or received, advertised to gdb with qSupported
+constexpr uint32_t GDB_PACKET_SIZE = 0x4000;
 
 struct GDBState {
 #ifdef _WIN32
@@ -47,9 +53,21 @@ struct GDBState {
     bool server_die = false;
 
     std::string last_reply = "";
+    // Received bytes which do not form a full packet yet
+    std::string receive_buffer;
     int thread_info_index = 0;
 
     SceUID inferior_thread = 0;
 
     SceUID current_thread = 0;
+
+    // In non-stop mode, only the threads reaching a breakpoint stop and gdb is told with %Stop notifications
+    bool non_stop = false;
+    // Stop replies not acknowledged by vStopped yet, the front one has been sent
+    std::deque<std::string> pending_stops;
+    bool stop_notified = false;
+    // Stopped threads which have been reported to gdb
+    std::set<SceUID> reported_stops;
+    // Threads asked to step or stop with vCont, with the signal to report once they are stopped
+    std::map<SceUID, uint8_t> awaited_stops;
 };
@@ -57,7 +57,7 @@
 
 // Credit to jfhs for their GDB stub for RPCS3 which this stub is based on.
 
-typedef char PacketData[1200];
+typedef char PacketData[GDB_PACKET_SIZE];
 
 struct PacketCommand {
     char *data{};
@@ -107,6 +107,33 @@ static uint32_t parse_hex(const std::string &hex) {
     return value;
 }
 
+static void append_hex(std::string &out, const uint8_t *data, uint32_t length) {
+    constexpr char digits[] = "0123456789abcdef";
+    out.reserve(out.size() + length * 2);
+    for (uint32_t a = 0; a < length; a++) {
+        out += digits[data[a] >> 4];
+        out += digits[data[a] & 0xF];
+    }
+}
+
+// The bytes which would be mistaken for the packet framing are sent as 0x7d followed by the byte xored with 0x20
+static bool needs_escape(char c) {
+    return c == '$' || c == '#' || c == '}' || c == '*';
+}
+
+static void append_escaped(std::string &out, const uint8_t *data, uint32_t length) {
+    out.reserve(out.size() + length);
+    for (uint32_t a = 0; a < length; a++) {
+        const char c = static_cast<char>(data[a]);
+        if (needs_escape(c)) {
+            out += '}';
+            out += static_cast<char>(c ^ 0x20);
+        } else {
+            out += c;
+        }
+    }
+}
+
 static uint8_t make_checksum(const char *data, int64_t length) {
     size_t sum = 0;
 
@@ -149,14 +176,21 @@ static PacketCommand parse_command(char *data, int64_t length) {
     return command;
 }
 
-static int64_t server_reply(GDBState &state, const char *data, int64_t length) {
+// The acknowledgement of the command can be sent in the same segment as the reply
+static int64_t server_reply(GDBState &state, const char *data, int64_t length, bool ack = false) {
     uint8_t checksum = make_checksum(data, length);
-    std::string packet_data = fmt::format("${}#{:0>2x}", std::string(data, length), checksum);
+    std::string packet_data = fmt::format("{}${}#{:0>2x}", ack ? "+" : "", std::string_view(data, length), checksum);
     return send(state.client_socket, &packet_data[0], packet_data.size(), 0);
 }
 
-static int64_t server_reply(GDBState &state, const char *text) {
-    return server_reply(state, text, strlen(text));
+static int64_t server_reply(GDBState &state, const std::string &reply, bool ack = false) {
+    return server_reply(state, reply.data(), reply.size(), ack);
+}
+
+static int64_t server_notify(GDBState &state, const std::string &notification) {
+    uint8_t checksum = make_checksum(notification.data(), notification.size());
+    std::string packet_data = fmt::format("%{}#{:0>2x}", notification, checksum);
+    return send(state.client_socket, &packet_data[0], packet_data.size(), 0);
 }
 
 static int64_t server_ack(GDBState &state, char ack = '+') {
@@ -165,7 +199,9 @@ static int64_t server_ack(GDBState &state, char ack = '+') {
 
 static std::string cmd_supported(EmuEnvState &state, PacketCommand &command) {
     return "multiprocess-;swbreak+;hwbreak-;qRelocInsn-;fork-events-;vfork-events-;"
-           "exec-events-;vContSupported+;QThreadEvents-;no-resumed-;xmlRegisters=arm";
+           "exec-events-;vContSupported+;QThreadEvents-;no-resumed-;xmlRegisters=arm;"
+           "binary-upload+;qXfer:memory-map:read+;QNonStop+;ConditionalBreakpoints+;"
+        + fmt::format("PacketSize={:x}", GDB_PACKET_SIZE);
 }
 
 static std::string cmd_reply_empty(EmuEnvState &state, PacketCommand &command) {
@@ -361,13 +397,31 @@ static std::string cmd_read_memory(EmuEnvState &state, PacketCommand &command) {
     if (!check_memory_region(address, length, state.mem))
         return "EAA";
 
-    std::stringstream stream;
+    // gdb reads the rest with other packets when the reply is shorter
+    std::string reply;
+    append_hex(reply, &state.mem.memory[address], std::min<uint32_t>(length, (GDB_PACKET_SIZE - 4) / 2));
 
-    for (uint32_t a = 0; a < length; a++) {
-        stream << fmt::format("{:0>2x}", static_cast<uint8_t>(state.mem.memory[address + a]));
-    }
+    return reply;
+}
 
-    return stream.str();
+static std::string cmd_read_binary(EmuEnvState &state, PacketCommand &command) {
+    const std::string content = content_string(command);
+    const size_t pos = content.find(',');
+
+    const uint32_t address = parse_hex(content.substr(1, pos - 1));
+    const uint32_t length = parse_hex(content.substr(pos + 1));
+
+    // a read of 0 bytes is used by gdb to probe the support of the packet
+    if (length == 0)
+        return "b";
+    if (!check_memory_region(address, length, state.mem))
+        return "EAA";
+
+    // every byte can be escaped, the reply must still fit in a packet
+    std::string reply = "b";
+    append_escaped(reply, &state.mem.memory[address], std::min<uint32_t>(length, (GDB_PACKET_SIZE - 5) / 2));
+
+    return reply;
 }
 
 static std::string cmd_write_memory(EmuEnvState &state, PacketCommand &command) {
@@ -391,8 +445,6 @@ static std::string cmd_write_memory(EmuEnvState &state, PacketCommand &command)
     return "OK";
 }
 
-// server_next() might not be able to tell the difference between the end of the packet ($) and 0x24 ($).
-// Thus, cmd_write_binary is disabled.
 static std::string cmd_write_binary(EmuEnvState &state, PacketCommand &command) {
     const std::string content = content_string(command);
     const size_t pos_first = content.find(',');
@@ -403,12 +455,16 @@ static std::string cmd_write_binary(EmuEnvState &state, PacketCommand &command)
     const uint32_t address = parse_hex(first);
     const uint32_t length = parse_hex(second);
     const char *data = command.content_start + pos_second + 1;
+    const char *data_end = command.content_start + command.content_length;
 
     if (!check_memory_region(address, length, state.mem))
         return "EAA";
 
-    for (uint32_t a = 0; a < length; a++) {
-        state.mem.memory[address + a] = data[a];
+    for (uint32_t a = 0; a < length && data < data_end; a++) {
+        char c = *data++;
+        if (c == '}' && data < data_end)
+            c = static_cast<char>(*data++ ^ 0x20);
+        state.mem.memory[address + a] = static_cast<uint8_t>(c);
     }
 
     return "OK";
@@ -416,8 +472,185 @@ static std::string cmd_write_binary(EmuEnvState &state, PacketCommand &command)
 
 static std::string cmd_detach(EmuEnvState &state, PacketCommand &command) { return "OK"; }
 
+// The allocations which are next to each other are merged in one region of the map
+static std::string memory_map_xml(MemState &mem) {
+    std::string xml = "<?xml version=\"1.0\"?>\n<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" "
+                      "\"http://sourceware.org/gdb/gdb-memory-map.dtd\">\n<memory-map>\n";
+
+    const std::lock_guard<std::mutex> lock(mem.generation_mutex);
+    uint64_t region_start = 0;
+    uint64_t region_end = 0;
+    for (const auto &[page_num, _] : mem.page_name_map) {
+        const uint64_t start = static_cast<uint64_t>(page_num) * mem.page_size;
+        const uint64_t end = start + static_cast<uint64_t>(mem.alloc_table[page_num].size) * mem.page_size;
+        if (start != region_end) {
+            if (region_end != region_start)
+                xml += fmt::format("<memory type=\"ram\" start=\"0x{:x}\" length=\"0x{:x}\"/>\n", region_start, region_end - region_start);
+            region_start = start;
+        }
+        region_end = end;
+    }
+    if (region_end != region_start)
+        xml += fmt::format("<memory type=\"ram\" start=\"0x{:x}\" length=\"0x{:x}\"/>\n", region_start, region_end - region_start);
+
+    xml += "</memory-map>\n";
+    return xml;
+}
+
+// qXfer:memory-map:read::offset,length
+static std::string cmd_read_memory_map(EmuEnvState &state, PacketCommand &command) {
+    const std::string content = content_string(command);
+    const size_t pos_offset = content.find("::");
+    const size_t pos_length = content.find(',', pos_offset);
+    if (pos_offset == std::string::npos || pos_length == std::string::npos)
+        return "E00";
+
+    const uint32_t offset = parse_hex(content.substr(pos_offset + 2, pos_length - pos_offset - 2));
+    const uint32_t length = std::min<uint32_t>(parse_hex(content.substr(pos_length + 1)), GDB_PACKET_SIZE - 5);
+
+    const std::string xml = memory_map_xml(state.mem);
+    if (offset >= xml.size())
+        return "l";
+
+    // The map has no byte which needs to be escaped
+    const std::string part = xml.substr(offset, length);
+    return ((offset + part.size() < xml.size()) ? "m" : "l") + part;
+}
+
+static std::string stop_reply(SceUID thread_id, uint8_t signal) {
+    return fmt::format("T{:0>2x}thread:{};", signal, to_hex(thread_id));
+}
+
+// Called by the server loop in non-stop mode to report to gdb the threads which stopped on their own
+static void check_stopped_threads(EmuEnvState &state) {
+    {
+        const auto guard = std::lock_guard(state.kernel.mutex);
+        for (const auto &[id, thread] : state.kernel.threads) {
+            if (state.gdb.reported_stops.contains(id))
+                continue;
+
+            const auto thread_guard = std::lock_guard(thread->mutex);
+            if (!thread->is_stopped())
+                continue;
+
+            const auto awaited = state.gdb.awaited_stops.find(id);
+            uint8_t signal = 0;
+            if (awaited != state.gdb.awaited_stops.end()) {
+                signal = awaited->second;
+                state.gdb.awaited_stops.erase(awaited);
+            } else if (hit_breakpoint(*thread->cpu)) {
+                signal = 5;
+                LOG_INFO("GDB Breakpoint trigger (thread name: {}, thread_id: {})", thread->name, thread->id);
+            } else {
+                continue;
+            }
+
+            state.gdb.reported_stops.insert(id);
+            state.gdb.pending_stops.push_back(stop_reply(id, signal));
+        }
+    }
+
+    // the next stop is only notified once gdb has read all the stops with vStopped
+    if (!state.gdb.stop_notified && !state.gdb.pending_stops.empty()) {
+        state.gdb.stop_notified = true;
+        server_notify(state.gdb, "Stop:" + state.gdb.pending_stops.front());
+    }
+}
+
+static std::string cmd_stopped(EmuEnvState &state, PacketCommand &command) {
+    if (!state.gdb.pending_stops.empty())
+        state.gdb.pending_stops.pop_front();
+    if (state.gdb.pending_stops.empty()) {
+        state.gdb.stop_notified = false;
+        return "OK";
+    }
+    return state.gdb.pending_stops.front();
+}
+
+static std::string cmd_set_non_stop(EmuEnvState &state, PacketCommand &command) {
+    const std::string content = content_string(command);
+    state.gdb.non_stop = content.substr(content.find(':') + 1) == "1";
+    state.gdb.pending_stops.clear();
+    state.gdb.stop_notified = false;
+    state.gdb.reported_stops.clear();
+    state.gdb.awaited_stops.clear();
+    return "OK";
+}
+
+// In non-stop mode, the actions only apply to the threads they name and the reply is sent without waiting
+static std::string cmd_continue_non_stop(EmuEnvState &state, const std::string &content) {
+    std::vector<ThreadStatePtr> handled;
+    {
+        const auto guard = std::lock_guard(state.kernel.mutex);
+        for (const auto &[id, thread] : state.kernel.threads)
+            handled.push_back(thread);
+    }
+
+    uint64_t index = 5;
+    uint64_t next = 0;
+    do {
+        next = content.find(';', index + 1);
+        const std::string text = content.substr(index + 1, next - index - 1);
+        index = next;
+        if (text.empty())
+            continue;
+
+        // without a thread id, the action applies to all the threads not named by a previous action
+        const uint64_t colon = text.find(':');
+        const bool all_threads = colon == std::string::npos || text.substr(colon + 1) == "-1";
+        const SceUID thread_id = all_threads ? 0 : static_cast<SceUID>(parse_hex(text.substr(colon + 1)));
+
+        for (auto it = handled.begin(); it != handled.end();) {
+            const ThreadStatePtr thread = *it;
+            if (!all_threads && thread->id != thread_id) {
+                ++it;
+                continue;
+            }
+            it = handled.erase(it);
+
+            switch (text[0]) {
+            case 'c':
+            case 'C':
+            case 's':
+            case 'S': {
+                const bool step = text[0] == 's' || text[0] == 'S';
+                {
+                    const auto thread_guard = std::lock_guard(thread->mutex);
+                    if (!thread->is_stopped())
+                        break;
+                }
+                state.gdb.reported_stops.erase(thread->id);
+                if (step)
+                    state.gdb.awaited_stops[thread->id] = 5;
+                thread->resume(step);
+                break;
+            }
+            case 't': {
+                const auto thread_guard = std::lock_guard(thread->mutex);
+                if (thread->can_suspend()) {
+                    state.gdb.awaited_stops[thread->id] = 0;
+                    thread->suspend();
+                } else if (thread->is_stopped()) {
+                    // gdb expects a stop reply for every thread it stops, even if it was stopped already
+                    state.gdb.reported_stops.erase(thread->id);
+                    state.gdb.awaited_stops[thread->id] = 0;
+                }
+                break;
+            }
+            default:
+                LOG_GDB("Unsupported vCont command '{}'", text[0]);
+                break;
+            }
+        }
+    } while (next != std::string::npos);
+
+    return "OK";
+}
+
 static std::string cmd_continue(EmuEnvState &state, PacketCommand &command) {
     const std::string content = content_string(command);
+    if (state.gdb.non_stop)
+        return cmd_continue_non_stop(state, content);
     const auto watch_delay = std::chrono::milliseconds(100);
 
     uint64_t index = 5;
@@ -548,7 +781,30 @@ static std::string cmd_attached(EmuEnvState &state, PacketCommand &command) { re
 
 static std::string cmd_thread_status(EmuEnvState &state, PacketCommand &command) { return "T0"; }
 
-static std::string cmd_reason(EmuEnvState &state, PacketCommand &command) { return "S05"; }
+static std::string cmd_reason(EmuEnvState &state, PacketCommand &command) {
+    if (!state.gdb.non_stop)
+        return "S05";
+
+    // in non-stop mode, the reply is the stop of one thread and the other stopped threads are read with vStopped
+    state.gdb.pending_stops.clear();
+    state.gdb.reported_stops.clear();
+    {
+        const auto guard = std::lock_guard(state.kernel.mutex);
+        for (const auto &[id, thread] : state.kernel.threads) {
+            const auto thread_guard = std::lock_guard(thread->mutex);
+            if (!thread->is_stopped())
+                continue;
+            const auto awaited = state.gdb.awaited_stops.find(id);
+            const uint8_t signal = (awaited != state.gdb.awaited_stops.end()) ? awaited->second : 5;
+            state.gdb.awaited_stops.erase(id);
+            state.gdb.reported_stops.insert(id);
+            state.gdb.pending_stops.push_back(stop_reply(id, signal));
+        }
+    }
+
+    state.gdb.stop_notified = !state.gdb.pending_stops.empty();
+    return state.gdb.stop_notified ? state.gdb.pending_stops.front() : "OK";
+}
 
 static std::string cmd_get_first_thread(EmuEnvState &state, PacketCommand &command) {
     const auto guard = std::lock_guard(state.kernel.mutex);
@@ -580,6 +836,170 @@ static std::string cmd_get_next_thread(EmuEnvState &state, PacketCommand &comman
     return stream.str();
 }
 
+typedef std::vector<uint8_t> AgentExpression;
+
+// Evaluates the gdb agent expressions sent with the breakpoints, without the trace and variable bytecodes
+// https://sourceware.org/gdb/current/onlinedocs/gdb.html/Bytecode-Descriptions.html
+static bool eval_agent_expression(CPUState &cpu, const AgentExpression &code) {
+    std::vector<int64_t> stack;
+    size_t pc = 0;
+
+    const auto pop = [&]() -> int64_t {
+        if (stack.empty())
+            return 0;
+        const int64_t value = stack.back();
+        stack.pop_back();
+        return value;
+    };
+    const auto read_operand = [&](size_t size) -> uint64_t {
+        uint64_t value = 0;
+        for (size_t i = 0; i < size && pc < code.size(); i++)
+            value = (value << 8) | code[pc++];
+        return value;
+    };
+    const auto read_memory = [&](Address address, size_t size) -> int64_t {
+        if (!check_memory_region(address, static_cast<Address>(size), *cpu.mem))
+            return 0;
+        uint64_t value = 0;
+        std::memcpy(&value, &cpu.mem->memory[address], size);
+        return static_cast<int64_t>(value);
+    };
+    const auto binary = [&](auto op) {
+        const int64_t b = pop();
+        const int64_t a = pop();
+        stack.push_back(static_cast<int64_t>(op(a, b)));
+    };
+    const auto sign_extend = [](int64_t value, uint64_t bits) -> int64_t {
+        if (bits == 0 || bits >= 64)
+            return value;
+        const uint64_t mask = 1ull << (bits - 1);
+        const uint64_t truncated = static_cast<uint64_t>(value) & ((1ull << bits) - 1);
+        return static_cast<int64_t>((truncated ^ mask) - mask);
+    };
+
+    while (pc < code.size()) {
+        const uint8_t op = code[pc++];
+        switch (op) {
+        case 0x02: binary(std::plus<int64_t>()); break; // add
+        case 0x03: binary(std::minus<int64_t>()); break; // sub
+        case 0x04: binary(std::multiplies<int64_t>()); break; // mul
+        case 0x05: // div_signed
+        case 0x06: // div_unsigned
+        case 0x07: // rem_signed
+        case 0x08: { // rem_unsigned
+            const int64_t b = pop();
+            const int64_t a = pop();
+            // stopping is the safe outcome of an expression which cannot be evaluated
+            if (b == 0)
+                return true;
+            if (op == 0x05)
+                stack.push_back(a / b);
+            else if (op == 0x06)
+                stack.push_back(static_cast<int64_t>(static_cast<uint64_t>(a) / static_cast<uint64_t>(b)));
+            else if (op == 0x07)
+                stack.push_back(a % b);
+            else
+                stack.push_back(static_cast<int64_t>(static_cast<uint64_t>(a) % static_cast<uint64_t>(b)));
+            break;
+        }
+        case 0x09: binary([](int64_t a, int64_t b) { return static_cast<int64_t>(static_cast<uint64_t>(a) << (b & 63)); }); break; // lsh
+        case 0x0A: binary([](int64_t a, int64_t b) { return a >> (b & 63); }); break; // rsh_signed
+        case 0x0B: binary([](int64_t a, int64_t b) { return static_cast<int64_t>(static_cast<uint64_t>(a) >> (b & 63)); }); break; // rsh_unsigned
+        case 0x0E: stack.push_back(pop() == 0); break; // log_not
+        case 0x0F: binary(std::bit_and<int64_t>()); break; // bit_and
+        case 0x10: binary(std::bit_or<int64_t>()); break; // bit_or
+        case 0x11: binary(std::bit_xor<int64_t>()); break; // bit_xor
+        case 0x12: stack.push_back(~pop()); break; // bit_not
+        case 0x13: binary(std::equal_to<int64_t>()); break; // equal
+        case 0x14: binary(std::less<int64_t>()); break; // less_signed
+        case 0x15: binary([](int64_t a, int64_t b) { return static_cast<uint64_t>(a) < static_cast<uint64_t>(b); }); break; // less_unsigned
+        case 0x16: stack.push_back(sign_extend(pop(), read_operand(1))); break; // ext
+        case 0x17: stack.push_back(read_memory(static_cast<Address>(pop()), 1)); break; // ref8
+        case 0x18: stack.push_back(read_memory(static_cast<Address>(pop()), 2)); break; // ref16
+        case 0x19: stack.push_back(read_memory(static_cast<Address>(pop()), 4)); break; // ref32
+        case 0x1A: stack.push_back(read_memory(static_cast<Address>(pop()), 8)); break; // ref64
+        case 0x20: { // if_goto
+            const uint64_t target = read_operand(2);
+            if (pop() != 0)
+                pc = target;
+            break;
+        }
+        case 0x21: pc = read_operand(2); break; // goto
+        case 0x22: stack.push_back(static_cast<int64_t>(read_operand(1))); break; // const8
+        case 0x23: stack.push_back(static_cast<int64_t>(read_operand(2))); break; // const16
+        case 0x24: stack.push_back(static_cast<int64_t>(read_operand(4))); break; // const32
+        case 0x25: stack.push_back(static_cast<int64_t>(read_operand(8))); break; // const64
+        case 0x26: stack.push_back(fetch_reg(cpu, static_cast<uint32_t>(read_operand(2)))); break; // reg
+        case 0x27: return !stack.empty() && stack.back() != 0; // end
+        case 0x28: // dup
+            if (stack.empty())
+                return true;
+            stack.push_back(stack.back());
+            break;
+        case 0x29: pop(); break; // pop
+        case 0x2A: { // zero_ext
+            const uint64_t bits = read_operand(1);
+            if (bits < 64)
+                stack.push_back(static_cast<int64_t>(static_cast<uint64_t>(pop()) & ((1ull << bits) - 1)));
+            break;
+        }
+        case 0x2B: // swap
+            if (stack.size() < 2)
+                return true;
+            std::swap(stack[stack.size() - 1], stack[stack.size() - 2]);
+            break;
+        case 0x32: { // pick
+            const uint64_t depth = read_operand(1);
+            if (depth >= stack.size())
+                return true;
+            stack.push_back(stack[stack.size() - 1 - depth]);
+            break;
+        }
+        case 0x33: { // rot
+            const int64_t c = pop();
+            const int64_t b = pop();
+            const int64_t a = pop();
+            stack.push_back(c);
+            stack.push_back(a);
+            stack.push_back(b);
+            break;
+        }
+        default:
+            LOG_GDB("GDB Server Unsupported Agent Expression Bytecode {}", log_hex(op));
+            return true;
+        }
+    }
+
+    return true;
+}
+
+// The conditions come after the kind as ";X<length>,<bytecode>", the breakpoint stops if one of them is true
+static BreakpointCondition parse_breakpoint_conditions(const std::string &content) {
+    std::vector<AgentExpression> conditions;
+    for (size_t pos = content.find(";X"); pos != std::string::npos; pos = content.find(";X", pos + 1)) {
+        const size_t comma = content.find(',', pos);
+        if (comma == std::string::npos)
+            break;
+        const uint32_t length = parse_hex(content.substr(pos + 2, comma - pos - 2));
+        if (comma + 1 + length * 2 > content.size())
+            break;
+
+        AgentExpression expression(length);
+        for (uint32_t a = 0; a < length; a++)
+            expression[a] = static_cast<uint8_t>(parse_hex(content.substr(comma + 1 + a * 2, 2)));
+        conditions.push_back(std::move(expression));
+    }
+
+    if (conditions.empty())
+        return nullptr;
+
+    return [conditions = std::move(conditions)](CPUState &cpu) {
+        return std::any_of(conditions.begin(), conditions.end(), [&](const AgentExpression &condition) {
+            return eval_agent_expression(cpu, condition);
+        });
+    };
+}
+
 static std::string cmd_add_breakpoint(EmuEnvState &state, PacketCommand &command) {
     const std::string content = content_string(command);
 
@@ -589,11 +1009,21 @@ static std::string cmd_add_breakpoint(EmuEnvState &state, PacketCommand &command
     const uint32_t address = parse_hex(content.substr(first + 1, second - 1 - first));
     const uint32_t kind = static_cast<uint32_t>(std::stol(content.substr(second + 1, content.size() - second - 1)));
 
+    // only write watchpoints can be done with the page protection, kind is then the size of the range
+    if (type == 2) {
+        LOG_GDB("GDB Server New Write Watchpoint at {} ({} bytes).", log_hex(address), kind);
+        state.kernel.debugger.add_watch_memory_addr(state.mem, address, kind);
+        return "OK";
+    } else if (type > 2) {
+        return "";
+    }
+
     LOG_GDB("GDB Server New Breakpoint at {} ({}, {}).", log_hex(address), type, kind);
 
     // kind is 2 if it's thumb mode
     // https://sourceware.org/gdb/current/onlinedocs/gdb/ARM-Breakpoint-Kinds.html#ARM-Breakpoint-Kinds
-    state.kernel.debugger.add_breakpoint(state.mem, address, kind == 2);
+    // the conditions are evaluated by the thread reaching the breakpoint, gdb is only told when one is true
+    state.kernel.debugger.add_breakpoint(state.mem, address, kind == 2, parse_breakpoint_conditions(content));
 
     return "OK";
 }
@@ -607,6 +1037,14 @@ static std::string cmd_remove_breakpoint(EmuEnvState &state, PacketCommand &comm
     const uint32_t address = parse_hex(content.substr(first + 1, second - 1 - first));
     const uint32_t kind = static_cast<uint32_t>(std::stol(content.substr(second + 1, content.size() - second - 1)));
 
+    if (type == 2) {
+        LOG_GDB("GDB Server Removed Write Watchpoint at {}.", log_hex(address));
+        state.kernel.debugger.remove_watch_memory_addr(state.mem, address);
+        return "OK";
+    } else if (type > 2) {
+        return "";
+    }
+
     LOG_GDB("GDB Server Removed Breakpoint at {} ({}, {}).", log_hex(address), type, kind);
     state.kernel.debugger.remove_breakpoint(state.mem, address);
 
@@ -645,7 +1083,8 @@ const static PacketFunctionBundle functions[] = {
     { "G", cmd_write_registers },
     { "m", cmd_read_memory },
     { "M", cmd_write_memory },
-    { "X", cmd_unimplemented }, // change cmd_unimplemented to cmd_write_binary to enable binary downloading
+    { "x", cmd_read_binary },
+    { "X", cmd_write_binary },
 
     // Query Packets
     { "qfThreadInfo", cmd_get_first_thread },
@@ -654,7 +1093,9 @@ const static PacketFunctionBundle functions[] = {
     { "qAttached", cmd_attached },
     { "qTStatus", cmd_thread_status },
     { "qC", cmd_get_current_thread },
+    { "qXfer:memory-map:read", cmd_read_memory_map },
     { "q", cmd_unimplemented },
+    { "QNonStop:", cmd_set_non_stop },
     { "Q", cmd_unimplemented },
 
     // Shutdown
@@ -668,6 +1109,7 @@ const static PacketFunctionBundle functions[] = {
     { "vCont", cmd_continue },
     { "vKill", cmd_kill },
     { "vMustReplyEmpty", cmd_reply_empty },
+    { "vStopped", cmd_stopped },
     { "v", cmd_unimplemented },
 
     // Breakpoints
@@ -702,16 +1144,35 @@ static bool command_begins_with(PacketCommand &command, const std::string &small
     return std::memcmp(command.content_start, small_str.c_str(), small_str.size()) == 0;
 }
 
+static void server_handle_command(EmuEnvState &state, PacketCommand &command) {
+    for (const auto &function : functions) {
+        if (command_begins_with(command, function.name)) {
+            LOG_GDB("GDB Server Recognized Command as {}. {}", function.name,
+                std::string(command.content_start, command.content_length));
+            state.gdb.last_reply = function.function(state, command);
+            if (!state.gdb.server_die)
+                server_reply(state.gdb, state.gdb.last_reply, true);
+            return;
+        }
+    }
+    LOG_GDB("GDB Server Unrecognized Command. {}", std::string(command.content_start, command.content_length));
+}
+
 static int64_t server_next(EmuEnvState &state) {
     PacketData buffer;
 
     // Wait for the server to close or a packet to be received.
+    // In non-stop mode, the threads are also checked regularly to notify gdb of their stops.
     fd_set readSet;
-    timeval timeout = { 1, 0 };
+    int ready = 0;
     do {
+        if (state.gdb.non_stop)
+            check_stopped_threads(state);
+        timeval timeout = { 0, state.gdb.non_stop ? 100000 : 1000000 };
         readSet = { 0 };
         FD_SET(state.gdb.client_socket, &readSet);
-    } while (select(state.gdb.client_socket + 1, &readSet, nullptr, nullptr, &timeout) < 1 && !state.gdb.server_die);
+        ready = select(state.gdb.client_socket + 1, &readSet, nullptr, nullptr, &timeout);
+    } while (ready < 1 && !state.gdb.server_die);
     if (state.gdb.server_die)
         return -1;
 
@@ -720,51 +1181,58 @@ static int64_t server_next(EmuEnvState &state) {
         LOG_GDB("GDB Server Connection Closed");
         return -1;
     }
-    buffer[length] = '\0';
 
-    for (int64_t a = 0; a < length; a++) {
-        switch (buffer[a]) {
+    // A packet can be split over several segments and a segment can hold several packets
+    std::string &received = state.gdb.receive_buffer;
+    received.append(buffer, length);
+
+    size_t pos = 0;
+    bool incomplete = false;
+    while (pos < received.size() && !incomplete && !state.gdb.server_die) {
+        switch (received[pos]) {
         case '+': {
+            pos++;
             break; // Cool.
         }
         case '-': {
-            LOG_GDB("GDB Server Transmission Error. {}", std::string(buffer, length));
-            server_reply(state.gdb, state.gdb.last_reply.c_str());
+            LOG_GDB("GDB Server Transmission Error. {}", received);
+            server_reply(state.gdb, state.gdb.last_reply);
+            pos++;
             break;
         }
         case '$': {
-            server_ack(state.gdb, '+');
-
-            PacketCommand command = parse_command(buffer + a, length - a);
-            if (command.is_valid) {
-                for (const auto &function : functions) {
-                    if (command_begins_with(command, function.name)) {
-                        LOG_GDB("GDB Server Recognized Command as {}. {}", function.name,
-                            std::string(command.content_start, command.content_length));
-                        state.gdb.last_reply = function.function(state, command);
-                        if (state.gdb.server_die)
-                            break;
-                        server_reply(state.gdb, state.gdb.last_reply.c_str());
-                        break;
-                    }
+            // binary data has its '#' escaped, so the first one ends the packet
+            const size_t end = received.find('#', pos);
+            if (end == std::string::npos || end + 2 >= received.size()) {
+                // wait for the rest of the packet
+                if (received.size() - pos > GDB_PACKET_SIZE * 2) {
+                    LOG_GDB("GDB Server Packet Too Large.");
+                    server_ack(state.gdb, '-');
+                    pos = received.size();
                 }
-                LOG_GDB("GDB Server Unrecognized Command. {}", std::string(command.content_start, command.content_length));
-
-                a += command.content_length + 3;
+                incomplete = true;
+                break;
+            }
 
+            PacketCommand command = parse_command(&received[pos], static_cast<int64_t>(end + 3 - pos));
+            if (command.is_valid) {
+                server_handle_command(state, command);
             } else {
                 server_ack(state.gdb, '-');
 
-                LOG_GDB("GDB Server Invalid Command. {}", std::string(buffer, length));
+                LOG_GDB("GDB Server Invalid Command. {}", std::string(&received[pos], end + 3 - pos));
             }
+            pos = end + 3;
             break;
         }
-        default: break;
-        }
-        if (state.gdb.server_die)
+        default:
+            pos++;
             break;
+        }
     }
 
+    received.erase(0, pos);
+
     return length;
 }
 
@@ -45,6 +45,7 @@ public:
     bool init(renderer::Generator *generator, renderer::Deleter *deleter) {
         assert(generator != nullptr);
         assert(deleter != nullptr);
+        this->generator = generator;
         this->deleter = deleter;
         generator(static_cast<GLsizei>(names.size()), &names[0]);
 
@@ -57,6 +58,13 @@ public:
         return names[i];
     }
 
+    // delete the object at index i and put a new one in its place
+    void regenerate(size_t i) {
+        assert(i < names.size());
+        deleter(1, &names[i]);
+        generator(1, &names[i]);
+    }
+
     size_t size() const {
         return names.size();
     }
@@ -68,5 +76,6 @@ private:
     const GLObjectArray &operator=(const GLObjectArray &);
 
     Names names;
+    renderer::Generator *generator = nullptr;
     renderer::Deleter *deleter = nullptr;
 };
@@ -17,9 +17,12 @@
 
 #include <glutil/object.h>
 
+#include <util/alloc_tracker.h>
+
 #include <cassert>
 
 GLObject::~GLObject() {
+    TRACK_HOST_FREE(this);
     if (aggregate_deleter != nullptr) {
         aggregate_deleter(1, &name);
     }
@@ -48,7 +48,7 @@ void delete_app(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path)
 void get_app_info(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path);
 size_t get_app_size(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path);
 App *get_app_index(GuiState &gui, const std::string &app_path);
-std::map<std::string, ImGui_Texture>::const_iterator get_app_icon(GuiState &gui, const std::string &app_path);
+AppIcon get_app_icon(GuiState &gui, const std::string &app_path);
 std::vector<std::string>::iterator get_live_area_current_open_apps_list_index(GuiState &gui, const std::string &app_path);
 std::map<DateTime, std::string> get_date_time(GuiState &gui, EmuEnvState &emuenv, const tm &date_time);
 std::string get_unit_size(const size_t size);
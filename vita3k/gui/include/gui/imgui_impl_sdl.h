@@ -37,6 +37,8 @@ IMGUI_API void ImGui_ImplSdl_GetDrawableSize(ImGui_State *state, int &width, int
 
 IMGUI_API ImTextureID ImGui_ImplSdl_CreateTexture(ImGui_State *state, void *data, int width, int height);
 IMGUI_API void ImGui_ImplSdl_DeleteTexture(ImGui_State *state, ImTextureID texture);
+// Replaces a width x height rectangle at (x, y) of an existing RGBA texture
+IMGUI_API void ImGui_ImplSdl_UpdateTexture(ImGui_State *state, ImTextureID texture, int x, int y, int width, int height, const void *data);
 
 // Use if you want to reset your rendering device without losing ImGui state.
 IMGUI_API void ImGui_ImplSdl_InvalidateDeviceObjects(ImGui_State *state);
@@ -42,6 +42,7 @@ IMGUI_API void ImGui_ImplSdlGL3_RenderDrawData(ImGui_GLState &state);
 
 IMGUI_API ImTextureID ImGui_ImplSdlGL3_CreateTexture(void *data, int width, int height);
 IMGUI_API void ImGui_ImplSdlGL3_DeleteTexture(ImTextureID texture);
+IMGUI_API void ImGui_ImplSdlGL3_UpdateTexture(ImTextureID texture, int x, int y, int width, int height, const void *data);
 
 // Use if you want to reset your rendering device without losing ImGui state.
 IMGUI_API void ImGui_ImplSdlGL3_InvalidateDeviceObjects(ImGui_GLState &state);
@@ -32,6 +32,9 @@
 #include <glutil/object.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <optional>
 #include <queue>
@@ -103,6 +106,89 @@ struct IconAsyncLoader {
     ~IconAsyncLoader();
 };
 
+// Reads and decodes images on a background thread, the textures are then created on the UI thread by commit.
+// Images are committed in the order they were requested, so a list of images can be filled as they arrive.
+class AsyncImageLoader {
+public:
+    using ReadImage = std::function<std::vector<uint8_t>()>;
+    using ImageLoaded = std::function<void(ImGui_Texture &&texture, int32_t width, int32_t height)>;
+
+    // the loading thread waits while this much decoded data has not been committed yet
+    static constexpr size_t MAX_DECODED_SIZE = 64 * 1024 * 1024;
+    static constexpr uint32_t MAX_COMMITS_PER_FRAME = 8;
+
+    // read is called on the loading thread and returns the file content, or nothing if it is missing
+    void load(const std::string &group, const std::string &name, ReadImage read, ImageLoaded loaded);
+    void cancel(const std::string &group);
+    void commit(ImGui_State *state);
+
+    ~AsyncImageLoader();
+
+private:
+    struct Job {
+        std::string group;
+        std::string name;
+        ReadImage read;
+        ImageLoaded loaded;
+        IconData image;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Job> queued;
+    std::deque<Job> decoded;
+    size_t decoded_size = 0;
+    // group of the job being decoded, cleared when that group is cancelled
+    std::optional<std::string> current_group;
+    std::thread thread;
+    bool quit = false;
+
+    void run();
+};
+
+// Texture of an app icon, with the sub-rectangle of the texture it uses
+struct AppIcon {
+    ImTextureID texture = nullptr;
+    ImVec2 uv0{ 0.f, 0.f };
+    ImVec2 uv1{ 1.f, 1.f };
+
+    operator bool() const { return texture != nullptr; }
+};
+
+// The 128x128 icons of the user apps are packed in a few large textures instead of using one texture per app.
+// Decoded icons stay in memory until they are drawn for the first time, so only the visible part of the app list is uploaded.
+class IconAtlas {
+public:
+    static constexpr int32_t ICON_SIZE = 128;
+    static constexpr int32_t PAGE_SIZE = 2048;
+    static constexpr uint32_t ICONS_PER_ROW = PAGE_SIZE / ICON_SIZE;
+    static constexpr uint32_t ICONS_PER_PAGE = ICONS_PER_ROW * ICONS_PER_ROW;
+    // the icons which do not fit in the budget of a frame are uploaded in the next frames
+    static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 16;
+
+    void add(const std::string &path, IconData icon);
+    AppIcon get(ImGui_State *state, const std::string &path);
+    bool contains(const std::string &path) const;
+    void erase(const std::string &path);
+    void clear();
+    void new_frame();
+
+private:
+    struct Slot {
+        uint32_t page;
+        uint32_t index;
+    };
+
+    std::vector<ImGui_Texture> pages;
+    std::map<std::string, Slot> slots;
+    std::vector<Slot> free_slots;
+    uint32_t used_slots = 0;
+    std::map<std::string, IconData> pending;
+    uint32_t uploads_left = MAX_UPLOADS_PER_FRAME;
+
+    bool upload(ImGui_State *state, const std::string &path, const IconData &icon);
+};
+
 struct AppsSelector {
     std::vector<App> sys_apps;
     std::vector<App> user_apps;
@@ -110,7 +196,7 @@ struct AppsSelector {
     AppInfo app_info;
     std::optional<IconAsyncLoader> icon_async_loader;
     std::map<std::string, ImGui_Texture> sys_apps_icon;
-    std::map<std::string, ImGui_Texture> user_apps_icon;
+    IconAtlas user_apps_icon;
     bool is_app_list_sorted{ false };
     std::map<SortType, SortState> app_list_sorted;
 };
@@ -146,6 +232,7 @@ struct DebugMenuState {
     bool lwmutexes_dialog = false;
     bool eventflags_dialog = false;
     bool allocations_dialog = false;
+    bool import_profiler_dialog = false;
     bool memory_editor_dialog = false;
     bool disassembly_dialog = false;
 };
@@ -341,6 +428,9 @@ struct GuiState {
     };
     std::map<std::string, UserBackgroundInfos> user_backgrounds_infos;
 
+    // live area and trophy images
+    gui::AsyncImageLoader image_loader;
+
     std::map<std::string, std::map<std::string, ImGui_Texture>> trophy_np_com_id_list_icons;
     std::map<std::string, ImGui_Texture> trophy_list;
 
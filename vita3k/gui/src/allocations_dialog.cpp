@@ -18,6 +18,8 @@
 #include "private.h"
 
 #include <cpu/functions.h>
+#include <mem/functions.h>
+#include <mem/state.h>
 
 #include <imgui_memory_editor.h>
 
@@ -33,6 +35,17 @@ const char *blacklist[] = {
 void draw_allocations_dialog(GuiState &gui, EmuEnvState &emuenv) {
     ImGui::Begin("Memory Allocations", &gui.debug_menu.allocations_dialog);
 
+    ImGui::Text("Free: %u KiB, largest free block: %u KiB", mem_available(emuenv.mem) / KiB(1), mem_largest_free_block(emuenv.mem) / KiB(1));
+    if (ImGui::TreeNode("Usage per name")) {
+        for (const auto &[name, usage] : mem_usage_by_name(emuenv.mem)) {
+            if (usage.blocks == 0)
+                continue;
+            ImGui::Text("%s: %llu KiB in %u block[s], peak %llu KiB", name.c_str(), static_cast<unsigned long long>(usage.allocated / KiB(1)), usage.blocks, static_cast<unsigned long long>(usage.peak / KiB(1)));
+        }
+        ImGui::TreePop();
+    }
+    ImGui::Separator();
+
     const std::lock_guard<std::mutex> lock(emuenv.mem.generation_mutex);
     for (const auto &pair : emuenv.mem.page_name_map) {
         const auto generation_num = pair.first;
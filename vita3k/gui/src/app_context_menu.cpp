@@ -247,10 +247,7 @@ void delete_app(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path)
         if (fs::exists(IMPORT_TEXTURES_PATH))
             fs::remove_all(IMPORT_TEXTURES_PATH);
 
-        if (gui.app_selector.user_apps_icon.contains(app_path)) {
-            gui.app_selector.user_apps_icon[app_path] = {};
-            gui.app_selector.user_apps_icon.erase(app_path);
-        }
+        gui.app_selector.user_apps_icon.erase(app_path);
 
         const auto time_app_index = get_time_app_index(gui, emuenv, app_path);
         if (time_app_index != gui.time_apps[emuenv.io.user_id].end()) {
@@ -563,11 +560,11 @@ void draw_app_context_menu(GuiState &gui, EmuEnvState &emuenv, const std::string
         } else {
             // Delete Data
             const auto ICON_MARGIN = 24.f * SCALE.y;
-            if (gui.app_selector.user_apps_icon.contains(title_id)) {
+            if (const auto APP_ICON = gui.app_selector.user_apps_icon.get(gui.imgui_state.get(), title_id)) {
                 ImGui::SetCursorPos(ImVec2((WINDOW_SIZE.x / 2.f) - (PUPOP_ICON_SIZE.x / 2.f), ICON_MARGIN));
                 const auto POS_MIN = ImGui::GetCursorScreenPos();
                 const ImVec2 POS_MAX(POS_MIN.x + PUPOP_ICON_SIZE.x, POS_MIN.y + PUPOP_ICON_SIZE.y);
-                ImGui::GetWindowDrawList()->AddImageRounded(gui.app_selector.user_apps_icon[title_id], POS_MIN, POS_MAX, ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, PUPOP_ICON_SIZE.x * SCALE.x, ImDrawFlags_RoundCornersAll);
+                ImGui::GetWindowDrawList()->AddImageRounded(APP_ICON.texture, POS_MIN, POS_MAX, APP_ICON.uv0, APP_ICON.uv1, IM_COL32_WHITE, PUPOP_ICON_SIZE.x * SCALE.x, ImDrawFlags_RoundCornersAll);
             }
             ImGui::SetWindowFontScale(1.6f * RES_SCALE.x);
             ImGui::SetCursorPos(ImVec2((WINDOW_SIZE.x / 2.f) - (ImGui::CalcTextSize(APP_INDEX->stitle.c_str()).x / 2.f), ICON_MARGIN + PUPOP_ICON_SIZE.y + (4.f * SCALE.y)));
@@ -615,11 +612,11 @@ void draw_app_context_menu(GuiState &gui, EmuEnvState &emuenv, const std::string
             gui.vita_area.app_information = false;
             gui.vita_area.information_bar = true;
         }
-        if (get_app_icon(gui, title_id)->first == title_id) {
+        if (const auto APP_ICON = get_app_icon(gui, title_id)) {
             ImGui::SetCursorPos(ImVec2((display_size.x / 2.f) - (INFO_ICON_SIZE.x / 2.f), 22.f * SCALE.x));
             const auto POS_MIN = ImGui::GetCursorScreenPos();
             const ImVec2 POS_MAX(POS_MIN.x + INFO_ICON_SIZE.x, POS_MIN.y + INFO_ICON_SIZE.y);
-            ImGui::GetWindowDrawList()->AddImageRounded(get_app_icon(gui, title_id)->second, POS_MIN, POS_MAX, ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, INFO_ICON_SIZE.x * SCALE.x, ImDrawFlags_RoundCornersAll);
+            ImGui::GetWindowDrawList()->AddImageRounded(APP_ICON.texture, POS_MIN, POS_MAX, APP_ICON.uv0, APP_ICON.uv1, IM_COL32_WHITE, INFO_ICON_SIZE.x * SCALE.x, ImDrawFlags_RoundCornersAll);
         }
         ImGui::SetCursorPos(ImVec2((display_size.x / 2.f) - ImGui::CalcTextSize((lang.info["name"] + "  ").c_str()).x, INFO_ICON_SIZE.y + (50.f * SCALE.y)));
         ImGui::TextColored(GUI_COLOR_TEXT, "%s ", lang.info["name"].c_str());
@@ -42,9 +42,9 @@ void draw_pre_compiling_shaders_progress(GuiState &gui, EmuEnvState &emuenv, con
     ImGui::SetWindowFontScale(1.1f * RES_SCALE.x);
 
     // Check if icon exist
-    if (gui.app_selector.user_apps_icon.contains(emuenv.io.app_path)) {
+    if (const auto APP_ICON = gui.app_selector.user_apps_icon.get(gui.imgui_state.get(), emuenv.io.app_path)) {
         ImGui::SetCursorPos(ImVec2(54.f * SCALE.x, 32.f * SCALE.y));
-        ImGui::Image(get_app_icon(gui, emuenv.io.app_path)->second, ICON_SIZE_SCALE);
+        ImGui::Image(APP_ICON.texture, ICON_SIZE_SCALE, APP_ICON.uv0, APP_ICON.uv1);
     }
 
     const auto current_time = std::time(nullptr);
@@ -60,11 +60,13 @@ void draw_pre_compiling_shaders_progress(GuiState &gui, EmuEnvState &emuenv, con
     ImGui::SetCursorPos(ImVec2((ImGui::GetWindowWidth() / 2) - (PROGRESS_BAR_WIDTH / 2.f), ImGui::GetCursorPosY() + 30.f * emuenv.dpi_scale));
     ImGui::PushStyleColor(ImGuiCol_PlotHistogram, GUI_PROGRESS_BAR);
     ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 12.f);
-    const auto progress_programs = (emuenv.renderer->programs_count_pre_compiled * 100) / total;
+    // the warm-up keeps going in the background once the tasks needed to boot are done
+    const uint32_t programs_done = std::min(emuenv.renderer->programs_count_pre_compiled.load(), total);
+    const auto progress_programs = (programs_done * 100) / total;
     ImGui::ProgressBar(progress_programs / 100.f, ImVec2(PROGRESS_BAR_WIDTH, 15.f * emuenv.dpi_scale), "");
     ImGui::PopStyleColor();
     ImGui::PopStyleVar();
-    const auto progress_programs_str = fmt::format("{}/{}", emuenv.renderer->programs_count_pre_compiled, total);
+    const auto progress_programs_str = fmt::format("{}/{}", programs_done, total);
     ImGui::SetCursorPos(ImVec2((ImGui::GetWindowWidth() / 2.f) - (ImGui::CalcTextSize(progress_programs_str.c_str()).x / 2.f), ImGui::GetCursorPosY() + (6.f * emuenv.dpi_scale)));
     ImGui::TextColored(GUI_COLOR_TEXT, "%s", progress_programs_str.c_str());
     ImGui::End();
@@ -276,7 +276,8 @@ void draw_content_manager(GuiState &gui, EmuEnvState &emuenv) {
 
     if (menu == "info") {
         ImGui::SetCursorPos(ImVec2(90.f * SCALE.x, 10.f * SCALE.y));
-        ImGui::Image(gui.app_selector.user_apps_icon[app_selected], SIZE_ICON_DETAIL);
+        const auto APP_ICON = gui.app_selector.user_apps_icon.get(gui.imgui_state.get(), app_selected);
+        ImGui::Image(APP_ICON.texture, SIZE_ICON_DETAIL, APP_ICON.uv0, APP_ICON.uv1);
         const auto CALC_NAME = ImGui::CalcTextSize(get_app_index(gui, app_selected)->title.c_str(), nullptr, false, SIZE_INFO.x - SIZE_ICON_DETAIL.x).y / 2.f;
         ImGui::SetCursorPos(ImVec2((110.f * SCALE.x) + SIZE_ICON_DETAIL.x, (SIZE_ICON_DETAIL.y / 2.f) - CALC_NAME + (10.f * SCALE.y)));
         ImGui::PushTextWrapPos(SIZE_INFO.x);
@@ -433,7 +434,8 @@ void draw_content_manager(GuiState &gui, EmuEnvState &emuenv) {
                     ImGui::Checkbox("##selected", &contents_selected[app.path]);
                     ImGui::NextColumn();
                     ImGui::SetCursorPosY(ImGui::GetCursorPosY() + (8.f * SCALE.y));
-                    ImGui::Image(gui.app_selector.user_apps_icon[app.path], SIZE_ICON_LIST);
+                    const auto APP_ICON = gui.app_selector.user_apps_icon.get(gui.imgui_state.get(), app.path);
+                    ImGui::Image(APP_ICON.texture, SIZE_ICON_LIST, APP_ICON.uv0, APP_ICON.uv1);
                     ImGui::NextColumn();
                     const auto Title_POS = ImGui::GetCursorPosY();
                     ImGui::SetWindowFontScale(1.1f);
@@ -482,7 +484,8 @@ void draw_content_manager(GuiState &gui, EmuEnvState &emuenv) {
                     ImGui::Checkbox("##selected", &contents_selected[save.title_id]);
                     ImGui::NextColumn();
                     ImGui::SetCursorPosY(ImGui::GetCursorPosY() + (8.f * SCALE.y));
-                    ImGui::Image(gui.app_selector.user_apps_icon[save.title_id], SIZE_ICON_LIST);
+                    const auto APP_ICON = gui.app_selector.user_apps_icon.get(gui.imgui_state.get(), save.title_id);
+                    ImGui::Image(APP_ICON.texture, SIZE_ICON_LIST, APP_ICON.uv0, APP_ICON.uv1);
                     ImGui::NextColumn();
                     const auto Title_POS = ImGui::GetCursorPosY();
                     ImGui::SetWindowFontScale(1.1f);
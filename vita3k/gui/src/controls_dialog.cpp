@@ -195,6 +195,11 @@ void draw_controls_dialog(GuiState &gui, EmuEnvState &emuenv) {
         ImGui::TableSetupColumn("button");
         ImGui::TableSetupColumn("mapped_button");
         remapper_button(gui, emuenv, &emuenv.cfg.keyboard_toggle_texture_replacement, lang["toggle_texture_replacement"].c_str());
+        remapper_button(gui, emuenv, &emuenv.cfg.keyboard_save_snapshot, lang["save_snapshot"].c_str(), lang["snapshot_description"].c_str());
+        remapper_button(gui, emuenv, &emuenv.cfg.keyboard_load_snapshot, lang["load_snapshot"].c_str(), lang["snapshot_description"].c_str());
+        remapper_button(gui, emuenv, &emuenv.cfg.keyboard_gpu_capture, lang["gpu_capture"].c_str(), lang["gpu_capture_description"].c_str());
+        remapper_button(gui, emuenv, &emuenv.cfg.keyboard_gameplay_recording, lang["gameplay_recording"].c_str(), lang["gameplay_recording_description"].c_str());
+        remapper_button(gui, emuenv, &emuenv.cfg.keyboard_screenshot, lang["screenshot"].c_str(), lang["screenshot_description"].c_str());
         ImGui::EndTable();
     }
 
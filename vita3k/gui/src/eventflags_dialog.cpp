@@ -25,7 +25,7 @@ void draw_event_flags_dialog(GuiState &gui, EmuEnvState &emuenv) {
     ImGui::Begin("Event Flags", &gui.debug_menu.eventflags_dialog);
     ImGui::TextColored(GUI_COLOR_TEXT_TITLE, "%-16s %-32s  %-7s   %-8s   %-16s", "ID", "EventFlag Name", "Flags", "Attributes", "Waiting Threads");
 
-    const std::lock_guard<std::mutex> lock(emuenv.kernel.mutex);
+    const std::shared_lock<std::shared_mutex> lock(emuenv.kernel.sync_objects_mutex);
 
     for (const auto &event : emuenv.kernel.eventflags) {
         std::shared_ptr<EventFlag> event_state = event.second;
@@ -42,6 +42,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <ctime>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -322,25 +323,241 @@ static IconData load_app_icon(GuiState &gui, EmuEnvState &emuenv, const std::str
 void init_app_icon(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path) {
     IconData data = load_app_icon(gui, emuenv, app_path);
     if (data.data) {
-        gui.app_selector.user_apps_icon[app_path].init(gui.imgui_state.get(), data.data.get(), data.width, data.height);
+        gui.app_selector.user_apps_icon.add(app_path, std::move(data));
     }
 }
 
 IconData::IconData()
     : data(nullptr, stbi_image_free) {}
 
+void IconAtlas::add(const std::string &path, IconData icon) {
+    erase(path);
+    pending[path] = std::move(icon);
+}
+
+AppIcon IconAtlas::get(ImGui_State *state, const std::string &path) {
+    auto slot = slots.find(path);
+    if (slot == slots.end()) {
+        const auto icon = pending.find(path);
+        if ((icon == pending.end()) || (uploads_left == 0) || !upload(state, path, icon->second))
+            return {};
+
+        uploads_left--;
+        pending.erase(icon);
+        slot = slots.find(path);
+    }
+
+    // keep half a texel away from the borders so linear filtering does not pick the neighbouring icons
+    const float x = static_cast<float>((slot->second.index % ICONS_PER_ROW) * ICON_SIZE);
+    const float y = static_cast<float>((slot->second.index / ICONS_PER_ROW) * ICON_SIZE);
+    return {
+        pages[slot->second.page],
+        ImVec2((x + 0.5f) / PAGE_SIZE, (y + 0.5f) / PAGE_SIZE),
+        ImVec2((x + ICON_SIZE - 0.5f) / PAGE_SIZE, (y + ICON_SIZE - 0.5f) / PAGE_SIZE),
+    };
+}
+
+bool IconAtlas::upload(ImGui_State *state, const std::string &path, const IconData &icon) {
+    if (!icon.data || (icon.width != ICON_SIZE) || (icon.height != ICON_SIZE))
+        return false;
+
+    Slot slot;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        if (used_slots == pages.size() * ICONS_PER_PAGE) {
+            const std::vector<uint8_t> blank(PAGE_SIZE * PAGE_SIZE * 4);
+            pages.emplace_back(state, (void *)blank.data(), PAGE_SIZE, PAGE_SIZE);
+        }
+        slot = { used_slots / ICONS_PER_PAGE, used_slots % ICONS_PER_PAGE };
+        used_slots++;
+    }
+
+    const int x = (slot.index % ICONS_PER_ROW) * ICON_SIZE;
+    const int y = (slot.index / ICONS_PER_ROW) * ICON_SIZE;
+    ImGui_ImplSdl_UpdateTexture(state, pages[slot.page], x, y, ICON_SIZE, ICON_SIZE, icon.data.get());
+    slots[path] = slot;
+
+    return true;
+}
+
+bool IconAtlas::contains(const std::string &path) const {
+    return slots.contains(path) || pending.contains(path);
+}
+
+void IconAtlas::erase(const std::string &path) {
+    const auto slot = slots.find(path);
+    if (slot != slots.end()) {
+        free_slots.push_back(slot->second);
+        slots.erase(slot);
+    }
+    pending.erase(path);
+}
+
+void IconAtlas::clear() {
+    pages.clear();
+    slots.clear();
+    free_slots.clear();
+    pending.clear();
+    used_slots = 0;
+}
+
+void IconAtlas::new_frame() {
+    uploads_left = MAX_UPLOADS_PER_FRAME;
+}
+
 void IconAsyncLoader::commit(GuiState &gui) {
     std::lock_guard<std::mutex> lock(mutex);
 
-    for (const auto &pair : icon_data) {
+    for (auto &pair : icon_data) {
         if (pair.second.data) {
-            gui.app_selector.user_apps_icon[pair.first].init(gui.imgui_state.get(), pair.second.data.get(), pair.second.width, pair.second.height);
+            gui.app_selector.user_apps_icon.add(pair.first, std::move(pair.second));
         }
     }
 
     icon_data.clear();
 }
 
+void AsyncImageLoader::load(const std::string &group, const std::string &name, ReadImage read, ImageLoaded loaded) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Job job;
+    job.group = group;
+    job.name = name;
+    job.read = std::move(read);
+    job.loaded = std::move(loaded);
+    queued.push_back(std::move(job));
+
+    if (!thread.joinable())
+        thread = std::thread(&AsyncImageLoader::run, this);
+    cond.notify_all();
+}
+
+void AsyncImageLoader::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [&] { return quit || (!queued.empty() && (decoded_size < MAX_DECODED_SIZE)); });
+        if (quit)
+            return;
+
+        Job job = std::move(queued.front());
+        queued.pop_front();
+        current_group = job.group;
+
+        lock.unlock();
+        const std::vector<uint8_t> buffer = job.read();
+        if (!buffer.empty()) {
+            job.image.data.reset(stbi_load_from_memory(buffer.data(), static_cast<int>(buffer.size()),
+                &job.image.width, &job.image.height, nullptr, STBI_rgb_alpha));
+            if (!job.image.data)
+                LOG_ERROR("Invalid image '{}' for {}.", job.name, job.group);
+        }
+        lock.lock();
+
+        // the group may have been cancelled while the image was decoded
+        if (job.image.data && current_group) {
+            decoded_size += job.image.width * job.image.height * 4;
+            decoded.push_back(std::move(job));
+        }
+        current_group.reset();
+    }
+}
+
+void AsyncImageLoader::cancel(const std::string &group) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto in_group = [&](const Job &job) { return job.group == group; };
+    queued.erase(std::remove_if(queued.begin(), queued.end(), in_group), queued.end());
+    for (auto job = decoded.begin(); job != decoded.end();) {
+        if (in_group(*job)) {
+            decoded_size -= job->image.width * job->image.height * 4;
+            job = decoded.erase(job);
+        } else
+            ++job;
+    }
+    if (current_group == group)
+        current_group.reset();
+    cond.notify_all();
+}
+
+void AsyncImageLoader::commit(ImGui_State *state) {
+    std::deque<Job> jobs;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!decoded.empty() && (jobs.size() < MAX_COMMITS_PER_FRAME)) {
+            decoded_size -= decoded.front().image.width * decoded.front().image.height * 4;
+            jobs.push_back(std::move(decoded.front()));
+            decoded.pop_front();
+        }
+        if (!jobs.empty())
+            cond.notify_all();
+    }
+
+    // the callbacks may queue or cancel other images, so they are called without the lock
+    for (auto &job : jobs)
+        job.loaded(ImGui_Texture(state, job.image.data.get(), job.image.width, job.image.height), job.image.width, job.image.height);
+}
+
+AsyncImageLoader::~AsyncImageLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        cond.notify_all();
+    }
+    if (thread.joinable())
+        thread.join();
+}
+
+static std::time_t get_app_icon_time(EmuEnvState &emuenv, const std::string &app_path) {
+    boost::system::error_code ec;
+    const std::time_t time = fs::last_write_time(emuenv.pref_path / "ux0/app" / app_path / "sce_sys/icon0.png", ec);
+    return ec ? 0 : time;
+}
+
+struct CachedIcon {
+    std::time_t time = 0;
+    IconData icon;
+};
+
+// Decoded icons of the user apps with the time of their icon0.png, so the icons do not need to be decoded again on startup
+static std::map<std::string, CachedIcon> load_icons_cache(const fs::path &cache_path) {
+    std::map<std::string, CachedIcon> icons;
+    fs::ifstream icons_cache(cache_path, std::ios::in | std::ios::binary);
+    if (!icons_cache.is_open())
+        return icons;
+
+    size_t size = 0;
+    uint32_t versionInFile = 0;
+    icons_cache.read((char *)&size, sizeof(size));
+    icons_cache.read((char *)&versionInFile, sizeof(uint32_t));
+    if (versionInFile != 1)
+        return icons;
+
+    for (size_t i = 0; i < size && icons_cache; i++) {
+        size_t path_size = 0;
+        icons_cache.read((char *)&path_size, sizeof(path_size));
+        std::string path(path_size, '\0');
+        icons_cache.read(path.data(), path_size);
+
+        CachedIcon cached;
+        icons_cache.read((char *)&cached.time, sizeof(cached.time));
+        icons_cache.read((char *)&cached.icon.width, sizeof(int32_t));
+        icons_cache.read((char *)&cached.icon.height, sizeof(int32_t));
+        if (!icons_cache || cached.icon.width != 128 || cached.icon.height != 128)
+            break;
+
+        // allocated like stb_image does, so the deleter of IconData can free it
+        const size_t pixels_size = cached.icon.width * cached.icon.height * 4;
+        cached.icon.data.reset(malloc(pixels_size));
+        icons_cache.read((char *)cached.icon.data.get(), pixels_size);
+        if (!icons_cache)
+            break;
+
+        icons[path] = std::move(cached);
+    }
+
+    return icons;
+}
+
 IconAsyncLoader::IconAsyncLoader(GuiState &gui, EmuEnvState &emuenv, const std::vector<gui::App> &app_list) {
     // I don't feel comfortable passing app_list down to be iterated by thread.
     // Methods like delete_app might mutate it, so I'd like to copy what I need now.
@@ -353,12 +570,39 @@ IconAsyncLoader::IconAsyncLoader(GuiState &gui, EmuEnvState &emuenv, const std::
 
     quit = false;
     thread = std::thread([&, paths = paths()]() {
+        const auto icons_cache_path{ emuenv.pref_path / "ux0/temp/app_icons.dat" };
+        std::map<std::string, CachedIcon> icons_cache = load_icons_cache(icons_cache_path);
+
+        // the new cache is written as it goes and saved at the end if any icon had to be decoded
+        std::string new_cache;
+        size_t new_cache_size = 0;
+        bool cache_outdated = icons_cache.size() != paths.size();
+
         for (const auto &path : paths) {
             if (quit)
                 return;
 
-            // load the actual texture
-            IconData data = load_app_icon(gui, emuenv, path);
+            const std::time_t icon_time = get_app_icon_time(emuenv, path);
+            IconData data;
+            const auto cached = icons_cache.find(path);
+            if (cached != icons_cache.end() && cached->second.time == icon_time) {
+                data = std::move(cached->second.icon);
+            } else {
+                // load the actual texture
+                data = load_app_icon(gui, emuenv, path);
+                cache_outdated = true;
+            }
+
+            if (data.data) {
+                const size_t path_size = path.size();
+                new_cache.append((const char *)&path_size, sizeof(path_size));
+                new_cache.append(path);
+                new_cache.append((const char *)&icon_time, sizeof(icon_time));
+                new_cache.append((const char *)&data.width, sizeof(int32_t));
+                new_cache.append((const char *)&data.height, sizeof(int32_t));
+                new_cache.append((const char *)data.data.get(), data.width * data.height * 4);
+                new_cache_size++;
+            }
 
             // Duplicate code here from init_app_icon
             {
@@ -366,6 +610,16 @@ IconAsyncLoader::IconAsyncLoader(GuiState &gui, EmuEnvState &emuenv, const std::
                 icon_data[path] = std::move(data);
             }
         }
+
+        if (cache_outdated) {
+            fs::ofstream icons_cache_file(icons_cache_path, std::ios::out | std::ios::binary);
+            if (icons_cache_file.is_open()) {
+                const uint32_t versionInFile = 1;
+                icons_cache_file.write((char *)&new_cache_size, sizeof(new_cache_size));
+                icons_cache_file.write((char *)&versionInFile, sizeof(uint32_t));
+                icons_cache_file.write(new_cache.data(), new_cache.size());
+            }
+        }
     });
 }
 
@@ -417,6 +671,13 @@ std::string get_sys_lang_name(uint32_t lang_id) {
     return current_sys_lang->second;
 }
 
+// Installing or deleting an app changes the time of the app folder, the cache is rebuilt when it does not match
+static std::time_t get_user_apps_time(EmuEnvState &emuenv) {
+    boost::system::error_code ec;
+    const std::time_t time = fs::last_write_time(emuenv.pref_path / "ux0/app", ec);
+    return ec ? 0 : time;
+}
+
 static bool get_user_apps(GuiState &gui, EmuEnvState &emuenv) {
     const auto apps_cache_path{ emuenv.pref_path / "ux0/temp/apps.dat" };
     fs::ifstream apps_cache(apps_cache_path, std::ios::in | std::ios::binary);
@@ -429,7 +690,7 @@ static bool get_user_apps(GuiState &gui, EmuEnvState &emuenv) {
         // Check version of cache
         uint32_t versionInFile;
         apps_cache.read((char *)&versionInFile, sizeof(uint32_t));
-        if (versionInFile != 1) {
+        if (versionInFile != 2) {
             LOG_WARN("Current version of cache: {}, is outdated, recreate it.", versionInFile);
             return false;
         }
@@ -441,6 +702,14 @@ static bool get_user_apps(GuiState &gui, EmuEnvState &emuenv) {
             return false;
         }
 
+        // Read time of the app folder when the cache was written
+        std::time_t apps_time;
+        apps_cache.read((char *)&apps_time, sizeof(apps_time));
+        if (apps_time != get_user_apps_time(emuenv)) {
+            LOG_INFO("The app folder changed since the cache was written, recreate it.");
+            return false;
+        }
+
         // Read App info value
         for (size_t a = 0; a < size; a++) {
             auto read = [&apps_cache]() {
@@ -489,13 +758,17 @@ void save_apps_cache(GuiState &gui, EmuEnvState &emuenv) {
         apps_cache.write((char *)&size, sizeof(size));
 
         // Write version of cache
-        const uint32_t versionInFile = 1;
+        const uint32_t versionInFile = 2;
         apps_cache.write((char *)&versionInFile, sizeof(uint32_t));
 
         // Write language of cache
         gui.app_selector.apps_cache_lang = emuenv.cfg.sys_lang;
         apps_cache.write((char *)&gui.app_selector.apps_cache_lang, sizeof(uint32_t));
 
+        // Write time of the app folder
+        const std::time_t apps_time = get_user_apps_time(emuenv);
+        apps_cache.write((char *)&apps_time, sizeof(apps_time));
+
         // Write Apps list
         for (const App &app : gui.app_selector.user_apps) {
             auto write = [&apps_cache](const std::string &i) {
@@ -561,13 +834,15 @@ void init_user_app(GuiState &gui, EmuEnvState &emuenv, const std::string &app_pa
     gui.app_selector.is_app_list_sorted = false;
 }
 
-std::map<std::string, ImGui_Texture>::const_iterator get_app_icon(GuiState &gui, const std::string &app_path) {
-    const auto &app_type = app_path.starts_with("NPXS") && (app_path != "NPXS10007") ? gui.app_selector.sys_apps_icon : gui.app_selector.user_apps_icon;
-    const auto app_icon = std::find_if(app_type.begin(), app_type.end(), [&](const auto &i) {
-        return i.first == app_path;
-    });
+AppIcon get_app_icon(GuiState &gui, const std::string &app_path) {
+    if (!app_path.starts_with("NPXS") || (app_path == "NPXS10007"))
+        return gui.app_selector.user_apps_icon.get(gui.imgui_state.get(), app_path);
+
+    const auto app_icon = gui.app_selector.sys_apps_icon.find(app_path);
+    if (app_icon == gui.app_selector.sys_apps_icon.end())
+        return {};
 
-    return app_icon;
+    return { app_icon->second };
 }
 
 App *get_app_index(GuiState &gui, const std::string &app_path) {
@@ -746,6 +1021,8 @@ void draw_begin(GuiState &gui, EmuEnvState &emuenv) {
     // cant bind opengl context outside main thread on macos now
     if (gui.app_selector.icon_async_loader)
         gui.app_selector.icon_async_loader->commit(gui);
+    gui.app_selector.user_apps_icon.new_frame();
+    gui.image_loader.commit(gui.imgui_state.get());
 }
 
 void draw_end(GuiState &gui, SDL_Window *window) {
@@ -872,6 +1149,8 @@ void draw_ui(GuiState &gui, EmuEnvState &emuenv) {
         draw_event_flags_dialog(gui, emuenv);
     if (gui.debug_menu.allocations_dialog)
         draw_allocations_dialog(gui, emuenv);
+    if (gui.debug_menu.import_profiler_dialog)
+        draw_import_profiler_dialog(gui, emuenv);
     if (gui.debug_menu.disassembly_dialog)
         draw_disassembly_dialog(gui, emuenv);
 
@@ -42,6 +42,8 @@ void init_user_apps(GuiState &gui, EmuEnvState &emuenv) {
     gui.app_selector.user_apps_icon.clear();
     gui.live_area_app_current_open = -1;
     gui.live_area_current_open_apps_list.clear();
+    for (const auto &contents : gui.live_area_contents)
+        gui.image_loader.cancel(contents.first);
     gui.live_area_contents.clear();
     gui.live_items.clear();
     if (gui.app_selector.icon_async_loader)
@@ -116,6 +118,7 @@ void update_live_area_current_open_apps_list(GuiState &gui, EmuEnvState &emuenv,
     gui.live_area_app_current_open = 0;
     if (gui.live_area_current_open_apps_list.size() > 6) {
         const auto last_app = gui.live_area_current_open_apps_list.back() == emuenv.io.app_path ? gui.live_area_current_open_apps_list[gui.live_area_current_open_apps_list.size() - 2] : gui.live_area_current_open_apps_list.back();
+        gui.image_loader.cancel(last_app);
         gui.live_area_contents.erase(last_app);
         gui.live_items.erase(last_app);
         gui.live_area_current_open_apps_list.erase(get_live_area_current_open_apps_list_index(gui, last_app));
@@ -246,11 +249,11 @@ void draw_app_close(GuiState &gui, EmuEnvState &emuenv) {
     ImGui::SetWindowFontScale(1.4f * RES_SCALE.x);
     ImGui::SetCursorPos(ImVec2(50.f * SCALE.x, 108.f * SCALE.y));
     ImGui::TextColored(GUI_COLOR_TEXT, "%s", gui.lang.game_data["app_close"].c_str());
-    if (gui.app_selector.user_apps_icon.contains(emuenv.io.app_path)) {
+    if (const auto APP_ICON = gui.app_selector.user_apps_icon.get(gui.imgui_state.get(), emuenv.io.app_path)) {
         const auto ICON_POS_SCALE = ImVec2(50.f * SCALE.x, (WINDOW_SIZE.y / 2.f) - (ICON_SIZE.y / 2.f) - (10.f * SCALE.y));
         ImGui::SetCursorPos(ICON_POS_SCALE);
         const auto POS_MIN = ImGui::GetCursorScreenPos();
-        ImGui::GetWindowDrawList()->AddImageRounded(get_app_icon(gui, emuenv.io.app_path)->second, POS_MIN, ImVec2(POS_MIN.x + ICON_SIZE.x, POS_MIN.y + ICON_SIZE.y), ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, ICON_SIZE.x, ImDrawFlags_RoundCornersAll);
+        ImGui::GetWindowDrawList()->AddImageRounded(APP_ICON.texture, POS_MIN, ImVec2(POS_MIN.x + ICON_SIZE.x, POS_MIN.y + ICON_SIZE.y), APP_ICON.uv0, APP_ICON.uv1, IM_COL32_WHITE, ICON_SIZE.x, ImDrawFlags_RoundCornersAll);
     }
     ImGui::SetCursorPos(ImVec2(ICON_SIZE.x + (72.f * SCALE.x), (WINDOW_SIZE.y / 2.f) - ImGui::CalcTextSize(emuenv.current_app_title.c_str()).y + (4.f * SCALE.y)));
     ImGui::TextColored(GUI_COLOR_TEXT, "%s", emuenv.current_app_title.c_str());
@@ -750,7 +753,7 @@ void draw_home_screen(GuiState &gui, EmuEnvState &emuenv) {
 
     std::vector<int32_t> visible_apps{};
 
-    const auto display_app = [&](const std::vector<gui::App> &apps_list, std::map<std::string, ImGui_Texture> &apps_icon) {
+    const auto display_app = [&](const std::vector<gui::App> &apps_list) {
         for (const auto &app : apps_list) {
             bool selected = false;
             const auto is_sys = app.path.starts_with("NPXS") && (app.path != "NPXS10007");
@@ -831,15 +834,15 @@ void draw_home_screen(GuiState &gui, EmuEnvState &emuenv) {
                 if (!gui.is_nav_button && ImGui::IsItemHovered())
                     current_selected_app_index = current_app_index;
 
-                // Draw the app icon
-                if (apps_icon.contains(app.path)) {
+                // Draw the app icon, user app icons are uploaded to the atlas the first time they are visible
+                if (const auto APP_ICON = get_app_icon(gui, app.path)) {
                     if (emuenv.cfg.apps_list_grid)
                         ImGui::SetCursorPosX(GRID_ICON_POS);
                     else
                         ImGui::SetCursorPos(ImVec2(POS_ICON.x + (5.f * VIEWPORT_SCALE.x), POS_ICON.y + (5.f * VIEWPORT_SCALE.y)));
                     const auto POS_MIN = ImGui::GetCursorScreenPos();
                     const ImVec2 POS_MAX(POS_MIN.x + ICON_SIZE.x, POS_MIN.y + ICON_SIZE.y);
-                    ImGui::GetWindowDrawList()->AddImageRounded(apps_icon[app.path], POS_MIN, POS_MAX, ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, ICON_SIZE.x * VIEWPORT_SCALE.x, ImDrawFlags_RoundCornersAll);
+                    ImGui::GetWindowDrawList()->AddImageRounded(APP_ICON.texture, POS_MIN, POS_MAX, APP_ICON.uv0, APP_ICON.uv1, IM_COL32_WHITE, ICON_SIZE.x * VIEWPORT_SCALE.x, ImDrawFlags_RoundCornersAll);
                 }
 
                 // Draw the custom config button
@@ -915,10 +918,10 @@ void draw_home_screen(GuiState &gui, EmuEnvState &emuenv) {
 
     // Draw System Applications
     if (emuenv.cfg.display_system_apps)
-        display_app(gui.app_selector.sys_apps, gui.app_selector.sys_apps_icon);
+        display_app(gui.app_selector.sys_apps);
 
     // Draw User Applications
-    display_app(gui.app_selector.user_apps, gui.app_selector.user_apps_icon);
+    display_app(gui.app_selector.user_apps);
 
     ImGui::PopStyleColor();
     ImGui::Columns(1);
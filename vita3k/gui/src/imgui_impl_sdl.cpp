@@ -46,6 +46,13 @@ IMGUI_API ImGui_State *ImGui_ImplSdl_Init(renderer::State *renderer, SDL_Window
         state = reinterpret_cast<ImGui_State *>(ImGui_ImplSdlVulkan_Init(renderer, window));
         break;
 
+    case renderer::Backend::Null:
+        // the interface is still built but never drawn
+        state = new ImGui_State;
+        state->renderer = renderer;
+        state->window = window;
+        break;
+
     default:
         LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(renderer->current_backend));
         return nullptr;
@@ -108,6 +115,9 @@ IMGUI_API void ImGui_ImplSdl_Shutdown(ImGui_State *state) {
     case renderer::Backend::Vulkan:
         return ImGui_ImplSdlVulkan_Shutdown(dynamic_cast<ImGui_VulkanState &>(*state));
 
+    case renderer::Backend::Null:
+        return;
+
     default:
         LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(state->renderer->current_backend));
     }
@@ -162,6 +172,9 @@ IMGUI_API void ImGui_ImplSdl_RenderDrawData(ImGui_State *state) {
 
     case renderer::Backend::Vulkan:
         return ImGui_ImplSdlVulkan_RenderDrawData(dynamic_cast<ImGui_VulkanState &>(*state));
+
+    case renderer::Backend::Null:
+        return;
     }
 }
 
@@ -222,6 +235,10 @@ IMGUI_API void ImGui_ImplSdl_GetDrawableSize(ImGui_State *state, int &width, int
         SDL_Vulkan_GetDrawableSize(state->window, &width, &height);
         break;
 
+    case renderer::Backend::Null:
+        SDL_GetWindowSize(state->window, &width, &height);
+        break;
+
     default:
         LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(state->renderer->current_backend));
     }
@@ -235,6 +252,9 @@ IMGUI_API ImTextureID ImGui_ImplSdl_CreateTexture(ImGui_State *state, void *data
     case renderer::Backend::Vulkan:
         return ImGui_ImplSdlVulkan_CreateTexture(dynamic_cast<ImGui_VulkanState &>(*state), data, width, height);
 
+    case renderer::Backend::Null:
+        return (void *)0;
+
     default:
         LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(state->renderer->current_backend));
         return (void *)0;
@@ -249,6 +269,25 @@ IMGUI_API void ImGui_ImplSdl_DeleteTexture(ImGui_State *state, ImTextureID textu
     case renderer::Backend::Vulkan:
         return ImGui_ImplSdlVulkan_DeleteTexture(dynamic_cast<ImGui_VulkanState &>(*state), texture);
 
+    case renderer::Backend::Null:
+        return;
+
+    default:
+        LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(state->renderer->current_backend));
+    }
+}
+
+IMGUI_API void ImGui_ImplSdl_UpdateTexture(ImGui_State *state, ImTextureID texture, int x, int y, int width, int height, const void *data) {
+    switch (state->renderer->current_backend) {
+    case renderer::Backend::OpenGL:
+        return ImGui_ImplSdlGL3_UpdateTexture(texture, x, y, width, height, data);
+
+    case renderer::Backend::Vulkan:
+        return ImGui_ImplSdlVulkan_UpdateTexture(dynamic_cast<ImGui_VulkanState &>(*state), texture, x, y, width, height, data);
+
+    case renderer::Backend::Null:
+        return;
+
     default:
         LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(state->renderer->current_backend));
     }
@@ -263,6 +302,9 @@ IMGUI_API void ImGui_ImplSdl_InvalidateDeviceObjects(ImGui_State *state) {
     case renderer::Backend::Vulkan:
         return ImGui_ImplSdlVulkan_InvalidateDeviceObjects(dynamic_cast<ImGui_VulkanState &>(*state));
 
+    case renderer::Backend::Null:
+        return;
+
     default:
         LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(state->renderer->current_backend));
     }
@@ -275,6 +317,14 @@ IMGUI_API bool ImGui_ImplSdl_CreateDeviceObjects(ImGui_State *state) {
     case renderer::Backend::Vulkan:
         return ImGui_ImplSdlVulkan_CreateDeviceObjects(dynamic_cast<ImGui_VulkanState &>(*state));
 
+    case renderer::Backend::Null: {
+        // ImGui needs a built font atlas to start a frame
+        unsigned char *pixels;
+        int width, height;
+        ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+        return true;
+    }
+
     default:
         LOG_ERROR("Missing ImGui init for backend {}.", static_cast<int>(state->renderer->current_backend));
         return false;
@@ -369,3 +369,8 @@ IMGUI_API void ImGui_ImplSdlGL3_DeleteTexture(ImTextureID texture) {
     auto texture_name = static_cast<GLuint>(reinterpret_cast<uintptr_t>(texture));
     glDeleteTextures(1, &texture_name);
 }
+
+IMGUI_API void ImGui_ImplSdlGL3_UpdateTexture(ImTextureID texture, int x, int y, int width, int height, const void *data) {
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<uintptr_t>(texture)));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+}
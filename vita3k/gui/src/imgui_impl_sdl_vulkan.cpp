@@ -713,6 +713,86 @@ IMGUI_API void ImGui_ImplSdlVulkan_DeleteTexture(ImGui_VulkanState &state, ImTex
     delete texture_ptr;
 }
 
+IMGUI_API void ImGui_ImplSdlVulkan_UpdateTexture(ImGui_VulkanState &state, ImTextureID texture, int x, int y, int width, int height, const void *pixels) {
+    auto texture_ptr = reinterpret_cast<TextureState *>(texture);
+    auto &vk_state = get_renderer(state);
+
+    const size_t buffer_size = width * height * 4;
+
+    vk::BufferCreateInfo buffer_info{
+        .size = buffer_size,
+        .usage = vk::BufferUsageFlagBits::eTransferSrc,
+        .sharingMode = vk::SharingMode::eExclusive,
+    };
+
+    vma::AllocationInfo alloc_info;
+    auto [temp_buffer, temp_allocation] = vk_state.allocator.createBuffer(buffer_info, vkutil::vma_mapped_alloc, alloc_info);
+
+    vk_state.allocator.invalidateAllocation(temp_allocation, 0, buffer_size);
+    std::memcpy(alloc_info.pMappedData, pixels, buffer_size);
+    vk_state.allocator.flushAllocation(temp_allocation, 0, buffer_size);
+
+    // the texture may still be sampled by a frame in flight
+    vk_state.device.waitIdle();
+
+    vk::CommandBuffer transfer_buffer = vkutil::create_single_time_command(vk_state.device,
+        vk_state.transfer_command_pool);
+
+    // the rest of the texture is kept, so the old layout is not undefined
+    vk::ImageMemoryBarrier image_transfer_optimal_barrier{
+        .srcAccessMask = vk::AccessFlagBits(),
+        .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture_ptr->image,
+        .subresourceRange = vkutil::color_subresource_range
+    };
+
+    transfer_buffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(),
+        0, nullptr,
+        0, nullptr,
+        1, &image_transfer_optimal_barrier);
+
+    vk::BufferImageCopy region{
+        0, // Buffer Offset
+        static_cast<uint32_t>(width), // Buffer Row Length
+        static_cast<uint32_t>(height), // Buffer Height
+        vk::ImageSubresourceLayers{
+            vk::ImageAspectFlagBits::eColor, // Aspects
+            0, 0, 1 // First Layer/Level
+        },
+        vk::Offset3D{ x, y, 0 }, // Image Offset
+        vk::Extent3D{ static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 } // Image Extent
+    };
+
+    transfer_buffer.copyBufferToImage(temp_buffer, texture_ptr->image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+
+    vk::ImageMemoryBarrier image_shader_read_only_barrier{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits(),
+        .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture_ptr->image,
+        .subresourceRange = vkutil::color_subresource_range
+    };
+
+    transfer_buffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+        vk::DependencyFlags(),
+        0, nullptr,
+        0, nullptr,
+        1, &image_shader_read_only_barrier);
+
+    vkutil::end_single_time_command(vk_state.device, vk_state.transfer_queue, vk_state.transfer_command_pool, transfer_buffer);
+    vk_state.allocator.destroyBuffer(temp_buffer, temp_allocation);
+}
+
 // Use if you want to reset your rendering device without losing ImGui state.
 IMGUI_API void ImGui_ImplSdlVulkan_InvalidateDeviceObjects(ImGui_VulkanState &state) {
     auto &vk_state = get_renderer(state);
@@ -0,0 +1,102 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "private.h"
+
+#include <kernel/import_profiler.h>
+#include <nids/functions.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace gui {
+
+enum ImportProfileColumn {
+    IMPORT_PROFILE_NAME,
+    IMPORT_PROFILE_NID,
+    IMPORT_PROFILE_CALLS,
+    IMPORT_PROFILE_TOTAL,
+    IMPORT_PROFILE_AVERAGE,
+    IMPORT_PROFILE_MAX,
+};
+
+static bool compare_entries(const ImportProfileEntry &a, const ImportProfileEntry &b, ImGuiID column) {
+    switch (column) {
+    case IMPORT_PROFILE_NAME: return strcmp(import_name(a.nid), import_name(b.nid)) < 0;
+    case IMPORT_PROFILE_NID: return a.nid < b.nid;
+    case IMPORT_PROFILE_CALLS: return a.calls < b.calls;
+    case IMPORT_PROFILE_AVERAGE: return a.total_ns * b.calls < b.total_ns * a.calls;
+    case IMPORT_PROFILE_MAX: return a.max_ns < b.max_ns;
+    default: return a.total_ns < b.total_ns;
+    }
+}
+
+void draw_import_profiler_dialog(GuiState &gui, EmuEnvState &emuenv) {
+    ImGui::Begin("HLE Profiler", &gui.debug_menu.import_profiler_dialog);
+
+    bool enabled = is_import_profiling();
+    if (ImGui::Checkbox("Enabled", &enabled))
+        set_import_profiling(enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset"))
+        reset_import_profile();
+    ImGui::SameLine();
+    ImGui::TextDisabled("Host time of the HLE imports, including the time their thread waited in them");
+
+    std::vector<ImportProfileEntry> entries = get_import_profile();
+    const ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV;
+    if (ImGui::BeginTable("import_profile", 6, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch, 0.0f, IMPORT_PROFILE_NAME);
+        ImGui::TableSetupColumn("NID", ImGuiTableColumnFlags_WidthFixed, 0.0f, IMPORT_PROFILE_NID);
+        ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed, 0.0f, IMPORT_PROFILE_CALLS);
+        ImGui::TableSetupColumn("Total (ms)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending, 0.0f, IMPORT_PROFILE_TOTAL);
+        ImGui::TableSetupColumn("Average (us)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 0.0f, IMPORT_PROFILE_AVERAGE);
+        ImGui::TableSetupColumn("Max (us)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_PreferSortDescending, 0.0f, IMPORT_PROFILE_MAX);
+        ImGui::TableHeadersRow();
+
+        // the counters change all the time, so they are sorted again on each frame
+        const ImGuiTableSortSpecs *sort_specs = ImGui::TableGetSortSpecs();
+        if (sort_specs && sort_specs->SpecsCount > 0) {
+            const ImGuiTableColumnSortSpecs &spec = sort_specs->Specs[0];
+            std::sort(entries.begin(), entries.end(), [&](const ImportProfileEntry &a, const ImportProfileEntry &b) {
+                return (spec.SortDirection == ImGuiSortDirection_Ascending) ? compare_entries(a, b, spec.ColumnUserID) : compare_entries(b, a, spec.ColumnUserID);
+            });
+        }
+
+        for (const auto &entry : entries) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(import_name(entry.nid));
+            ImGui::TableNextColumn();
+            ImGui::Text("%08X", entry.nid);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(entry.calls));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", entry.total_ns / 1000000.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", entry.total_ns / 1000.0 / entry.calls);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", entry.max_ns / 1000.0);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+} // namespace gui
@@ -572,11 +572,11 @@ void draw_information_bar(GuiState &gui, EmuEnvState &emuenv) {
             const ImVec2 ICON_POS_MAX(ICON_POS_MIN.x + ICON_SIZE_SCALE, ICON_POS_MIN.y + ICON_SIZE_SCALE);
             const ImVec2 ICON_CENTER_POS(ICON_POS_MIN.x + (ICON_SIZE_SCALE / 2.f), ICON_POS_MIN.y + (ICON_SIZE_SCALE / 2.f));
             const auto APPS_OPENED = gui.live_area_current_open_apps_list[a];
-            auto &APP_ICON_TYPE = APPS_OPENED.starts_with("NPXS") && (APPS_OPENED != "NPXS10007") ? gui.app_selector.sys_apps_icon : gui.app_selector.user_apps_icon;
+            const auto APP_ICON = get_app_icon(gui, APPS_OPENED);
 
             // Check if icon exist
-            if (APP_ICON_TYPE.contains(APPS_OPENED))
-                draw_list->AddImageRounded(APP_ICON_TYPE[APPS_OPENED], ICON_POS_MIN, ICON_POS_MAX, ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, ICON_SIZE_SCALE, ImDrawFlags_RoundCornersAll);
+            if (APP_ICON)
+                draw_list->AddImageRounded(APP_ICON.texture, ICON_POS_MIN, ICON_POS_MAX, APP_ICON.uv0, APP_ICON.uv1, IM_COL32_WHITE, ICON_SIZE_SCALE, ImDrawFlags_RoundCornersAll);
             else
                 draw_list->AddCircleFilled(ICON_CENTER_POS, ICON_SIZE_SCALE / 2.f, IM_COL32_WHITE);
 
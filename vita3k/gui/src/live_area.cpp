@@ -34,7 +34,6 @@
 #include <pugixml.hpp>
 
 #include <chrono>
-#include <stb_image.h>
 
 namespace gui {
 
@@ -242,36 +241,39 @@ void init_live_area(GuiState &gui, EmuEnvState &emuenv, const std::string &app_p
                 name["livearea-background"].erase(remove(name["livearea-background"].begin(), name["livearea-background"].end(), '\n'), name["livearea-background"].end());
             name["livearea-background"].erase(remove_if(name["livearea-background"].begin(), name["livearea-background"].end(), isspace), name["livearea-background"].end());
 
-            for (const auto &contents : name) {
-                int32_t width = 0;
-                int32_t height = 0;
-                vfs::FileBuffer buffer;
+            // the images are read and decoded in the background, the screen is drawn without them until they are ready
+            gui.image_loader.cancel(app_path);
+            gui.live_area_contents[app_path].clear();
+            gui.live_items[app_path].clear();
+
+            const auto pref_path = emuenv.pref_path.wstring();
+            const auto title = APP_INDEX->title;
+            const auto read_content = [=](const std::string &kind, const std::string &content_name) {
+                return [=]() {
+                    vfs::FileBuffer buffer;
+                    if (default_contents)
+                        vfs::read_file(VitaIoDevice::vs0, buffer, pref_path, "data/internal/livearea/default/sce_sys/livearea/contents/" + content_name);
+                    else if (app_device == VitaIoDevice::vs0)
+                        vfs::read_file(VitaIoDevice::vs0, buffer, pref_path, "app/" + app_path + "/sce_sys/livearea/contents/" + content_name);
+                    else
+                        vfs::read_app_file(buffer, pref_path, app_path, live_area_path.string() + "/contents/" + content_name);
+
+                    if (buffer.empty() && (is_ps_app || is_sys_app))
+                        LOG_WARN("{} '{}' Not found for title {} [{}].", kind, content_name, app_path, title);
+                    return buffer;
+                };
+            };
 
+            for (const auto &contents : name) {
                 if (contents.second.empty()) {
                     LOG_WARN("Content '{}' is empty for title {} [{}].", contents.first, app_path, APP_INDEX->title);
                     continue;
                 }
 
-                if (default_contents)
-                    vfs::read_file(VitaIoDevice::vs0, buffer, emuenv.pref_path.wstring(), "data/internal/livearea/default/sce_sys/livearea/contents/" + contents.second);
-                else if (app_device == VitaIoDevice::vs0)
-                    vfs::read_file(VitaIoDevice::vs0, buffer, emuenv.pref_path.wstring(), "app/" + app_path + "/sce_sys/livearea/contents/" + contents.second);
-                else
-                    vfs::read_app_file(buffer, emuenv.pref_path.wstring(), app_path, live_area_path.string() + "/contents/" + contents.second);
-
-                if (buffer.empty()) {
-                    if (is_ps_app || is_sys_app)
-                        LOG_WARN("Contents {} '{}' Not found for title {} [{}].", contents.first, contents.second, app_path, APP_INDEX->title);
-                    continue;
-                }
-                stbi_uc *data = stbi_load_from_memory(&buffer[0], static_cast<int>(buffer.size()), &width, &height, nullptr, STBI_rgb_alpha);
-                if (!data) {
-                    LOG_ERROR("Invalid Live Area Contents for title {} [{}].", app_path, APP_INDEX->title);
-                    continue;
-                }
-
-                gui.live_area_contents[app_path][contents.first].init(gui.imgui_state.get(), data, width, height);
-                stbi_image_free(data);
+                gui.image_loader.load(app_path, contents.second, read_content(contents.first, contents.second),
+                    [&gui, app_path, content = contents.first](ImGui_Texture &&texture, int32_t, int32_t) {
+                        gui.live_area_contents[app_path][content] = std::move(texture);
+                    });
             }
 
             std::map<std::string, std::map<std::string, std::vector<std::string>>> items_name;
@@ -438,29 +440,11 @@ void init_live_area(GuiState &gui, EmuEnvState &emuenv, const std::string &app_p
                                 bg_name.erase(remove(bg_name.begin(), bg_name.end(), '\n'), bg_name.end());
                             bg_name.erase(remove_if(bg_name.begin(), bg_name.end(), isspace), bg_name.end());
 
-                            int32_t width = 0;
-                            int32_t height = 0;
-                            vfs::FileBuffer buffer;
-
-                            if (app_device == VitaIoDevice::vs0)
-                                vfs::read_file(VitaIoDevice::vs0, buffer, emuenv.pref_path.wstring(), "app/" + app_path + "/sce_sys/livearea/contents/" + bg_name);
-                            else
-                                vfs::read_app_file(buffer, emuenv.pref_path.wstring(), app_path, live_area_path.string() + "/contents/" + bg_name);
-
-                            if (buffer.empty()) {
-                                if (is_ps_app || is_sys_app)
-                                    LOG_WARN("background, Id: {}, Name: '{}', Not found for title: {} [{}].", item.first, bg_name, app_path, APP_INDEX->title);
-                                continue;
-                            }
-                            stbi_uc *data = stbi_load_from_memory(&buffer[0], static_cast<int>(buffer.size()), &width, &height, nullptr, STBI_rgb_alpha);
-                            if (!data) {
-                                LOG_ERROR("Frame: {}, Invalid Live Area Contents for title: {} [{}].", item.first, app_path, APP_INDEX->title);
-                                continue;
-                            }
-
-                            items_size[app_path][item.first]["background"] = ImVec2(float(width), float(height));
-                            gui.live_items[app_path][item.first]["background"].emplace_back(gui.imgui_state.get(), data, width, height);
-                            stbi_image_free(data);
+                            gui.image_loader.load(app_path, bg_name, read_content("Frame " + item.first + " background", bg_name),
+                                [&gui, app_path, frame = item.first](ImGui_Texture &&texture, int32_t width, int32_t height) {
+                                    items_size[app_path][frame]["background"] = ImVec2(float(width), float(height));
+                                    gui.live_items[app_path][frame]["background"].push_back(std::move(texture));
+                                });
                         }
                     }
 
@@ -470,29 +454,11 @@ void init_live_area(GuiState &gui, EmuEnvState &emuenv, const std::string &app_p
                                 img_name.erase(remove(img_name.begin(), img_name.end(), '\n'), img_name.end());
                             img_name.erase(remove_if(img_name.begin(), img_name.end(), isspace), img_name.end());
 
-                            int32_t width = 0;
-                            int32_t height = 0;
-                            vfs::FileBuffer buffer;
-
-                            if (app_device == VitaIoDevice::vs0)
-                                vfs::read_file(VitaIoDevice::vs0, buffer, emuenv.pref_path.wstring(), "app/" + app_path + "/sce_sys/livearea/contents/" + img_name);
-                            else
-                                vfs::read_app_file(buffer, emuenv.pref_path.wstring(), app_path, live_area_path.string() + "/contents/" + img_name);
-
-                            if (buffer.empty()) {
-                                if (is_ps_app || is_sys_app)
-                                    LOG_WARN("Image, Id: {} Name: '{}', Not found for title {} [{}].", item.first, img_name, app_path, APP_INDEX->title);
-                                continue;
-                            }
-                            stbi_uc *data = stbi_load_from_memory(&buffer[0], static_cast<int>(buffer.size()), &width, &height, nullptr, STBI_rgb_alpha);
-                            if (!data) {
-                                LOG_ERROR("Frame: {}, Invalid Live Area Contents for title: {} [{}].", item.first, app_path, APP_INDEX->title);
-                                continue;
-                            }
-
-                            items_size[app_path][item.first]["image"] = ImVec2(float(width), float(height));
-                            gui.live_items[app_path][item.first]["image"].emplace_back(gui.imgui_state.get(), data, width, height);
-                            stbi_image_free(data);
+                            gui.image_loader.load(app_path, img_name, read_content("Frame " + item.first + " image", img_name),
+                                [&gui, app_path, frame = item.first](ImGui_Texture &&texture, int32_t width, int32_t height) {
+                                    items_size[app_path][frame]["image"] = ImVec2(float(width), float(height));
+                                    gui.live_items[app_path][frame]["image"].push_back(std::move(texture));
+                                });
                         }
                     }
                 }
@@ -516,6 +482,7 @@ void open_search(const std::string &title) {
 }
 
 void update_app(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path) {
+    gui.image_loader.cancel(app_path);
     if (gui.live_area_contents.contains(app_path))
         gui.live_area_contents.erase(app_path);
     if (gui.live_items.contains(app_path))
@@ -1065,10 +1032,9 @@ void draw_live_area_screen(GuiState &gui, EmuEnvState &emuenv) {
         const auto ICON_POS_MAX_SCALE = ImVec2(ICON_POS_MINI_SCALE.x + ICON_SIZE_SCALE, ICON_POS_MINI_SCALE.y + ICON_SIZE_SCALE);
 
         // check if app icon exist
-        auto &APP_ICON_TYPE = app_path.starts_with("NPXS") && (app_path != "NPXS10007") ? gui.app_selector.sys_apps_icon : gui.app_selector.user_apps_icon;
-        if (APP_ICON_TYPE.contains(app_path)) {
-            window_draw_list->AddImageRounded(APP_ICON_TYPE[app_path], ICON_POS_MINI_SCALE, ICON_POS_MAX_SCALE,
-                ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, 75.f * SCALE.x, ImDrawFlags_RoundCornersAll);
+        if (const auto APP_ICON = get_app_icon(gui, app_path)) {
+            window_draw_list->AddImageRounded(APP_ICON.texture, ICON_POS_MINI_SCALE, ICON_POS_MAX_SCALE,
+                APP_ICON.uv0, APP_ICON.uv1, IM_COL32_WHITE, 75.f * SCALE.x, ImDrawFlags_RoundCornersAll);
         } else
             window_draw_list->AddCircleFilled(ICON_CENTER_POS, ICON_SIZE_SCALE / 2.f, IM_COL32_WHITE);
     }
@@ -64,10 +64,10 @@ static void draw_emulation_menu(GuiState &gui, EmuEnvState &emuenv) {
         ImGui::PushStyleColor(ImGuiCol_Text, GUI_COLOR_TEXT_TITLE);
         ImGui::PushID(app.path.c_str());
         const auto APP_ICON = get_app_icon(gui, app.path);
-        if (!APP_ICON->first.empty()) {
+        if (APP_ICON) {
             const auto POS_MIN = ImGui::GetCursorScreenPos();
             const ImVec2 POS_MAX(POS_MIN.x + ICON_SIZE.x, POS_MIN.y + ICON_SIZE.y);
-            ImGui::GetWindowDrawList()->AddImageRounded(APP_ICON->second, POS_MIN, POS_MAX, ImVec2(0, 0), ImVec2(1, 1), IM_COL32_WHITE, ICON_SIZE.x * SCALE.x, ImDrawFlags_RoundCornersAll);
+            ImGui::GetWindowDrawList()->AddImageRounded(APP_ICON.texture, POS_MIN, POS_MAX, APP_ICON.uv0, APP_ICON.uv1, IM_COL32_WHITE, ICON_SIZE.x * SCALE.x, ImDrawFlags_RoundCornersAll);
             ImGui::SetCursorPosX(ImGui::GetCursorPosX() + ICON_SIZE.x + PADDING);
         }
         ImGui::PushStyleVar(ImGuiStyleVar_SelectableTextAlign, ImVec2(0.5f, 0.5f));
@@ -114,6 +114,7 @@ static void draw_debug_menu(GuiState &gui, DebugMenuState &state) {
         ImGui::MenuItem(lang["lightweight_condition_variables"].c_str(), nullptr, &state.lwcondvars_dialog);
         ImGui::MenuItem(lang["event_flags"].c_str(), nullptr, &state.eventflags_dialog);
         ImGui::MenuItem(lang["memory_allocations"].c_str(), nullptr, &state.allocations_dialog);
+        ImGui::MenuItem(lang["hle_profiler"].c_str(), nullptr, &state.import_profiler_dialog);
         ImGui::MenuItem(lang["disassembly"].c_str(), nullptr, &state.disassembly_dialog);
         ImGui::EndMenu();
     }
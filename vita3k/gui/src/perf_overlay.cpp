@@ -17,7 +17,18 @@
 
 #include "private.h"
 
+#include <audio/state.h>
 #include <config/state.h>
+#include <cpu/functions.h>
+#include <kernel/state.h>
+#include <mem/functions.h>
+#include <renderer/profile.h>
+#include <renderer/state.h>
+#include <renderer/texture_cache.h>
+#include <util/alloc_tracker.h>
+
+#include <algorithm>
+#include <chrono>
 
 namespace gui {
 static const ImVec2 PERF_OVERLAY_PAD = ImVec2(12.f, 12.f);
@@ -45,7 +56,7 @@ static ImVec2 get_perf_pos(ImVec2 window_size, EmuEnvState &emuenv) {
 
 static float get_perf_height(EmuEnvState &emuenv) {
     switch (emuenv.cfg.performance_overlay_detail) {
-    case MAXIMUM: return 138.f;
+    case MAXIMUM: return (emuenv.renderer->current_backend == renderer::Backend::Vulkan ? 222.f : 194.f) + (emuenv.audio.audio_backend == "Cubeb" ? 14.f : 0.f);
     case MEDIUM: return 80.f;
     case LOW:
     case MINIMUM:
@@ -55,6 +66,237 @@ static float get_perf_height(EmuEnvState &emuenv) {
     return 57.f;
 }
 
+// Rate of the guest polling loop iterations caught by the JIT, refreshed every second
+static uint32_t get_idle_loops_per_second() {
+    static uint64_t last_count = 0;
+    static uint32_t last_rate = 0;
+    static auto last_time = std::chrono::steady_clock::now();
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time).count();
+    if (elapsed >= 1000) {
+        const uint64_t count = get_idle_loop_count();
+        last_rate = static_cast<uint32_t>((count - last_count) * 1000 / elapsed);
+        last_count = count;
+        last_time = now;
+    }
+
+    return last_rate;
+}
+
+struct GuestMemoryState {
+    uint32_t free_mib = 0;
+    uint32_t largest_free_mib = 0;
+};
+
+// Guest memory left and its fragmentation, refreshed every second
+static GuestMemoryState get_guest_memory_state(MemState &mem) {
+    static GuestMemoryState state;
+    static auto last_time = std::chrono::steady_clock::time_point{};
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_time >= std::chrono::seconds(1)) {
+        state.free_mib = mem_available(mem) / MiB(1);
+        state.largest_free_mib = mem_largest_free_block(mem) / MiB(1);
+        last_time = now;
+    }
+
+    return state;
+}
+
+struct TextureCacheState {
+    uint32_t used_mib = 0;
+    uint32_t budget_mib = 0;
+    uint32_t hit_percent = 0;
+    float evictions_per_frame = 0.f;
+};
+
+// Texture cache occupancy and activity over the last second, refreshed every second
+static TextureCacheState get_texture_cache_state(EmuEnvState &emuenv) {
+    static TextureCacheState state;
+    static uint64_t last_hits = 0;
+    static uint64_t last_misses = 0;
+    static uint64_t last_evictions = 0;
+    static auto last_time = std::chrono::steady_clock::now();
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time).count();
+    if (elapsed >= 1000) {
+        const renderer::TextureCacheStats &stats = emuenv.renderer->get_texture_cache()->stats;
+        const uint64_t hits = stats.hits;
+        const uint64_t misses = stats.misses;
+        const uint64_t evictions = stats.evictions;
+
+        const uint64_t lookups = (hits - last_hits) + (misses - last_misses);
+        state.hit_percent = lookups > 0 ? static_cast<uint32_t>((hits - last_hits) * 100 / lookups) : 100;
+        const float frames = static_cast<float>(emuenv.fps) * elapsed / 1000.f;
+        state.evictions_per_frame = frames > 0.f ? static_cast<float>(evictions - last_evictions) / frames : 0.f;
+        state.used_mib = static_cast<uint32_t>(stats.memory_used / MiB(1));
+        state.budget_mib = static_cast<uint32_t>(stats.memory_budget / MiB(1));
+
+        last_hits = hits;
+        last_misses = misses;
+        last_evictions = evictions;
+        last_time = now;
+    }
+
+    return state;
+}
+
+struct PipelineCacheState {
+    float lookups_per_frame = 0.f;
+    float compiles_per_frame = 0.f;
+};
+
+// Pipeline lookups and compilations averaged over the last second, refreshed every second
+static PipelineCacheState get_pipeline_cache_state(EmuEnvState &emuenv) {
+    static PipelineCacheState state;
+    static uint64_t last_lookups = 0;
+    static uint64_t last_compiles = 0;
+    static auto last_time = std::chrono::steady_clock::now();
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time).count();
+    if (elapsed >= 1000) {
+        const uint64_t lookups = emuenv.renderer->pipeline_lookups.load(std::memory_order_relaxed);
+        const uint64_t compiles = emuenv.renderer->pipeline_compiles.load(std::memory_order_relaxed);
+
+        const float frames = static_cast<float>(emuenv.fps) * elapsed / 1000.f;
+        state.lookups_per_frame = frames > 0.f ? static_cast<float>(lookups - last_lookups) / frames : 0.f;
+        state.compiles_per_frame = frames > 0.f ? static_cast<float>(compiles - last_compiles) / frames : 0.f;
+
+        last_lookups = lookups;
+        last_compiles = compiles;
+        last_time = now;
+    }
+
+    return state;
+}
+
+struct AudioOutputState {
+    float latency_ms = 0.f;
+    uint32_t underruns = 0;
+};
+
+// Highest output latency of the open ports and their underruns since they were opened, refreshed every second
+static AudioOutputState get_audio_output_state(AudioState &audio) {
+    static AudioOutputState state;
+    static auto last_time = std::chrono::steady_clock::time_point{};
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_time >= std::chrono::seconds(1)) {
+        state = {};
+        const std::lock_guard<std::mutex> lock(audio.mutex);
+        for (const auto &[_, port] : audio.out_ports) {
+            state.latency_ms = std::max(state.latency_ms, port->latency_ms.load(std::memory_order_relaxed));
+            state.underruns += port->underruns.load(std::memory_order_relaxed);
+        }
+        last_time = now;
+    }
+
+    return state;
+}
+
+static void draw_guest_profile(GuiState &gui, EmuEnvState &emuenv, const ImVec2 SCALE, const ImVec2 RES_SCALE) {
+    constexpr size_t TOP_COUNT = 10;
+    const auto total = emuenv.kernel.guest_profiler.get_total_samples();
+    if (total == 0)
+        return;
+
+    const auto WINDOW_SIZE = ImVec2(300.f * SCALE.x, (24.f + TOP_COUNT * 12.f) * SCALE.y);
+    ImGui::SetNextWindowSize(WINDOW_SIZE);
+    ImGui::SetNextWindowPos(ImVec2(emuenv.viewport_pos.x + emuenv.viewport_size.x - WINDOW_SIZE.x, emuenv.viewport_pos.y));
+    ImGui::SetNextWindowBgAlpha(PERF_OVERLAY_BG_COLOR.w);
+    ImGui::Begin("##guest_profile", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoInputs);
+    ImGui::PushFont(gui.vita_font);
+    ImGui::SetWindowFontScale(0.6f * RES_SCALE.x);
+    ImGui::TextUnformatted(gui.lang.performance_overlay["top_guest_functions"].c_str());
+    ImGui::Separator();
+    for (const auto &entry : emuenv.kernel.guest_profiler.get_top(TOP_COUNT)) {
+        const float percent = static_cast<float>(entry.samples) * 100.f / static_cast<float>(total);
+        ImGui::Text("%5.1f%% %s", percent, emuenv.kernel.resolve_guest_pc(entry.pc).c_str());
+    }
+    ImGui::PopFont();
+    ImGui::End();
+}
+
+#ifdef RENDERER_FRAME_TIMERS
+static constexpr size_t FRAME_TIMER_COUNT = static_cast<size_t>(renderer::FrameTimer::Count);
+
+// Cpu time of each part of the renderer averaged on the frames of the last second, refreshed every second
+static const std::array<float, FRAME_TIMER_COUNT> &get_renderer_breakdown(EmuEnvState &emuenv) {
+    static std::array<float, FRAME_TIMER_COUNT> ms_per_frame = {};
+    static std::array<uint64_t, FRAME_TIMER_COUNT> last_ns = {};
+    static auto last_time = std::chrono::steady_clock::now();
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time).count();
+    if (elapsed >= 1000) {
+        const float frames = static_cast<float>(emuenv.fps) * elapsed / 1000.f;
+        for (size_t i = 0; i < FRAME_TIMER_COUNT; i++) {
+            const uint64_t total_ns = renderer::frame_timers.total_ns[i].load(std::memory_order_relaxed);
+            ms_per_frame[i] = frames > 0.f ? static_cast<float>(total_ns - last_ns[i]) / 1e6f / frames : 0.f;
+            last_ns[i] = total_ns;
+        }
+        last_time = now;
+    }
+
+    return ms_per_frame;
+}
+
+static void draw_renderer_breakdown(GuiState &gui, EmuEnvState &emuenv, const ImVec2 SCALE, const ImVec2 RES_SCALE) {
+    // in the order of renderer::FrameTimer
+    static const char *const TIMER_NAMES[FRAME_TIMER_COUNT] = { "renderer_commands", "renderer_textures", "renderer_surfaces", "renderer_pipelines", "renderer_descriptors", "renderer_submit" };
+    const auto &ms_per_frame = get_renderer_breakdown(emuenv);
+
+    const auto WINDOW_SIZE = ImVec2(160.f * SCALE.x, (24.f + FRAME_TIMER_COUNT * 12.f) * SCALE.y);
+    ImGui::SetNextWindowSize(WINDOW_SIZE);
+    ImGui::SetNextWindowPos(ImVec2(emuenv.viewport_pos.x, emuenv.viewport_pos.y + emuenv.viewport_size.y - WINDOW_SIZE.y));
+    ImGui::SetNextWindowBgAlpha(PERF_OVERLAY_BG_COLOR.w);
+    ImGui::Begin("##renderer_breakdown", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoInputs);
+    ImGui::PushFont(gui.vita_font);
+    ImGui::SetWindowFontScale(0.6f * RES_SCALE.x);
+    ImGui::TextUnformatted(gui.lang.performance_overlay["renderer_time"].c_str());
+    ImGui::Separator();
+    for (size_t i = 0; i < FRAME_TIMER_COUNT; i++)
+        ImGui::Text("%s: %.2f ms", gui.lang.performance_overlay[TIMER_NAMES[i]].c_str(), ms_per_frame[i]);
+    ImGui::PopFont();
+    ImGui::End();
+}
+#endif
+
+// Host memory tracked for each subsystem, refreshed every second
+static const alloc_tracker::Usage &get_host_memory_usage() {
+    static alloc_tracker::Usage usage = alloc_tracker::get_usage();
+    static auto last_time = std::chrono::steady_clock::now();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_time >= std::chrono::seconds(1)) {
+        usage = alloc_tracker::get_usage();
+        last_time = now;
+    }
+
+    return usage;
+}
+
+static void draw_host_memory(GuiState &gui, EmuEnvState &emuenv, const ImVec2 SCALE, const ImVec2 RES_SCALE) {
+    const alloc_tracker::Usage &usage = get_host_memory_usage();
+
+    const auto WINDOW_SIZE = ImVec2(200.f * SCALE.x, (24.f + usage.size() * 12.f) * SCALE.y);
+    ImGui::SetNextWindowSize(WINDOW_SIZE);
+    ImGui::SetNextWindowPos(ImVec2(emuenv.viewport_pos.x + emuenv.viewport_size.x - WINDOW_SIZE.x, emuenv.viewport_pos.y + emuenv.viewport_size.y - WINDOW_SIZE.y));
+    ImGui::SetNextWindowBgAlpha(PERF_OVERLAY_BG_COLOR.w);
+    ImGui::Begin("##host_memory", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoInputs);
+    ImGui::PushFont(gui.vita_font);
+    ImGui::SetWindowFontScale(0.6f * RES_SCALE.x);
+    ImGui::TextUnformatted(gui.lang.performance_overlay["host_memory"].c_str());
+    ImGui::Separator();
+    for (const alloc_tracker::SubsystemUsage &subsystem : usage)
+        ImGui::Text("%s: %.1f MiB (%llu)", subsystem.name, static_cast<float>(subsystem.bytes) / MiB(1), static_cast<unsigned long long>(subsystem.allocations));
+    ImGui::PopFont();
+    ImGui::End();
+}
+
 void draw_perf_overlay(GuiState &gui, EmuEnvState &emuenv) {
     auto lang = gui.lang.performance_overlay;
 
@@ -65,7 +307,8 @@ void draw_perf_overlay(GuiState &gui, EmuEnvState &emuenv) {
     const auto MAIN_WINDOW_SIZE = ImVec2((emuenv.cfg.performance_overlay_detail == MINIMUM ? 95.5f : 152.f) * SCALE.x, get_perf_height(emuenv) * SCALE.y);
 
     const auto WINDOW_POS = get_perf_pos(MAIN_WINDOW_SIZE, emuenv);
-    const auto WINDOW_SIZE = ImVec2((emuenv.cfg.performance_overlay_detail == MINIMUM ? 72.5f : 130.f) * SCALE.x, (emuenv.cfg.performance_overlay_detail <= LOW ? 35.f : 58.f) * SCALE.y);
+    const bool show_audio_output = emuenv.audio.audio_backend == "Cubeb";
+    const auto WINDOW_SIZE = ImVec2((emuenv.cfg.performance_overlay_detail == MINIMUM ? 72.5f : 130.f) * SCALE.x, (emuenv.cfg.performance_overlay_detail <= LOW ? 35.f : (emuenv.cfg.performance_overlay_detail == MAXIMUM ? (emuenv.renderer->current_backend == renderer::Backend::Vulkan ? 142.f : 114.f) + (show_audio_output ? 14.f : 0.f) : 58.f)) * SCALE.y);
 
     ImGui::SetNextWindowSize(MAIN_WINDOW_SIZE);
     ImGui::SetNextWindowPos(WINDOW_POS);
@@ -84,6 +327,31 @@ void draw_perf_overlay(GuiState &gui, EmuEnvState &emuenv) {
         ImGui::Separator();
         ImGui::Text("%s: %d %s: %d", lang["min"].c_str(), emuenv.min_fps, lang["max"].c_str(), emuenv.max_fps);
     }
+    if (emuenv.cfg.performance_overlay_detail == PerfomanceOverleyDetail::MAXIMUM) {
+        ImGui::Text("%s: %u", lang["idle_loops"].c_str(), get_idle_loops_per_second());
+        const GuestMemoryState memory = get_guest_memory_state(emuenv.mem);
+        ImGui::Text("%s: %u MiB %s: %u MiB", lang["memory_free"].c_str(), memory.free_mib, lang["memory_largest"].c_str(), memory.largest_free_mib);
+        const TextureCacheState textures = get_texture_cache_state(emuenv);
+        if (textures.budget_mib > 0)
+            ImGui::Text("%s: %u/%u MiB %s: %u%%", lang["texture_memory"].c_str(), textures.used_mib, textures.budget_mib, lang["texture_hit_rate"].c_str(), textures.hit_percent);
+        else
+            ImGui::Text("%s: %u MiB %s: %u%%", lang["texture_memory"].c_str(), textures.used_mib, lang["texture_hit_rate"].c_str(), textures.hit_percent);
+        ImGui::Text("%s: %.2f", lang["texture_evictions"].c_str(), textures.evictions_per_frame);
+        if (emuenv.renderer->current_backend == renderer::Backend::Vulkan) {
+            const PipelineCacheState pipelines = get_pipeline_cache_state(emuenv);
+            ImGui::Text("%s: %.0f %s: %.1f", lang["pipeline_lookups"].c_str(), pipelines.lookups_per_frame, lang["pipeline_compiles"].c_str(), pipelines.compiles_per_frame);
+            // measured a few frames late, the longest scene is shown between parentheses
+            const float gpu_time = emuenv.renderer->gpu_frame_time.load(std::memory_order_relaxed);
+            const float gpu_max_scene_time = emuenv.renderer->gpu_max_scene_time.load(std::memory_order_relaxed);
+            const uint32_t gpu_scenes = emuenv.renderer->gpu_scene_count.load(std::memory_order_relaxed);
+            ImGui::Text("%s: %.2f ms %s: %u (%.2f)", lang["gpu_time"].c_str(), gpu_time, lang["gpu_scenes"].c_str(), gpu_scenes, gpu_max_scene_time);
+        }
+        // only the cubeb backend adapts its latency to the underruns
+        if (show_audio_output) {
+            const AudioOutputState audio = get_audio_output_state(emuenv.audio);
+            ImGui::Text("%s: %.1f ms %s: %u", lang["audio_latency"].c_str(), audio.latency_ms, lang["audio_underruns"].c_str(), audio.underruns);
+        }
+    }
     ImGui::PopFont();
     ImGui::EndChild();
     ImGui::PopStyleVar();
@@ -94,6 +362,17 @@ void draw_perf_overlay(GuiState &gui, EmuEnvState &emuenv) {
     }
     ImGui::End();
     ImGui::PopStyleVar();
+
+    if (emuenv.kernel.guest_profiler.is_running())
+        draw_guest_profile(gui, emuenv, SCALE, RES_SCALE);
+
+    if (alloc_tracker::enabled.load(std::memory_order_relaxed))
+        draw_host_memory(gui, emuenv, SCALE, RES_SCALE);
+
+#ifdef RENDERER_FRAME_TIMERS
+    if (emuenv.cfg.performance_overlay_detail == PerfomanceOverleyDetail::MAXIMUM)
+        draw_renderer_breakdown(gui, emuenv, SCALE, RES_SCALE);
+#endif
 }
 
 } // namespace gui
@@ -58,6 +58,7 @@ void draw_lw_condvars_dialog(GuiState &gui, EmuEnvState &emuenv);
 void draw_condvars_dialog(GuiState &gui, EmuEnvState &emuenv);
 void draw_event_flags_dialog(GuiState &gui, EmuEnvState &emuenv);
 void draw_allocations_dialog(GuiState &gui, EmuEnvState &emuenv);
+void draw_import_profiler_dialog(GuiState &gui, EmuEnvState &emuenv);
 void draw_disassembly_dialog(GuiState &gui, EmuEnvState &emuenv);
 void draw_settings_dialog(GuiState &gui, EmuEnvState &emuenv);
 void draw_controls_dialog(GuiState &gui, EmuEnvState &emuenv);
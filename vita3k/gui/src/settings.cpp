@@ -846,6 +846,8 @@ void draw_settings(GuiState &gui, EmuEnvState &emuenv) {
                             }
                             const auto live_area_state = get_live_area_current_open_apps_list_index(gui, "NPXS10015") != gui.live_area_current_open_apps_list.end();
                             gui.live_area_current_open_apps_list.clear();
+                            for (const auto &contents : gui.live_area_contents)
+                                gui.image_loader.cancel(contents.first);
                             gui.live_area_contents.clear();
                             gui.live_items.clear();
                             init_notice_info(gui, emuenv);
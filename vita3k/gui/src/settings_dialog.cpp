@@ -167,6 +167,8 @@ static bool get_custom_config(GuiState &gui, EmuEnvState &emuenv, const std::str
                 const auto cpu_child = config_child.child("cpu");
                 config.cpu_backend = cpu_child.attribute("cpu-backend").as_string();
                 config.cpu_opt = cpu_child.attribute("cpu-opt").as_bool();
+                config.libc_fast_paths = cpu_child.attribute("libc-fast-paths").as_bool();
+                config.slab_heap = cpu_child.attribute("slab-heap").as_bool();
             }
 
             // Load GPU Config
@@ -233,6 +235,8 @@ void init_config(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path
     if (!get_custom_config(gui, emuenv, app_path)) {
         config.cpu_backend = emuenv.cfg.cpu_backend;
         config.cpu_opt = emuenv.cfg.cpu_opt;
+        config.libc_fast_paths = emuenv.cfg.libc_fast_paths;
+        config.slab_heap = emuenv.cfg.slab_heap;
         config.modules_mode = emuenv.cfg.modules_mode;
         config.lle_modules = emuenv.cfg.lle_modules;
         config.high_accuracy = emuenv.cfg.high_accuracy;
@@ -314,6 +318,8 @@ static void save_config(GuiState &gui, EmuEnvState &emuenv) {
         auto cpu_child = config_child.append_child("cpu");
         cpu_child.append_attribute("cpu-backend") = config.cpu_backend.c_str();
         cpu_child.append_attribute("cpu-opt") = config.cpu_opt;
+        cpu_child.append_attribute("libc-fast-paths") = config.libc_fast_paths;
+        cpu_child.append_attribute("slab-heap") = config.slab_heap;
 
         // GPU
         auto gpu_child = config_child.append_child("gpu");
@@ -347,6 +353,8 @@ static void save_config(GuiState &gui, EmuEnvState &emuenv) {
     } else {
         emuenv.cfg.cpu_backend = config.cpu_backend;
         emuenv.cfg.cpu_opt = config.cpu_opt;
+        emuenv.cfg.libc_fast_paths = config.libc_fast_paths;
+        emuenv.cfg.slab_heap = config.slab_heap;
         emuenv.cfg.modules_mode = config.modules_mode;
         emuenv.cfg.lle_modules = config.lle_modules;
         emuenv.cfg.pstv_mode = config.pstv_mode;
@@ -410,6 +418,8 @@ void set_config(GuiState &gui, EmuEnvState &emuenv, const std::string &app_path)
         // Else inherit the values from the global emulator config
         emuenv.cfg.current_config.cpu_backend = emuenv.cfg.cpu_backend;
         emuenv.cfg.current_config.cpu_opt = emuenv.cfg.cpu_opt;
+        emuenv.cfg.current_config.libc_fast_paths = emuenv.cfg.libc_fast_paths;
+        emuenv.cfg.current_config.slab_heap = emuenv.cfg.slab_heap;
         emuenv.cfg.current_config.modules_mode = emuenv.cfg.modules_mode;
         emuenv.cfg.current_config.lle_modules = emuenv.cfg.lle_modules;
         emuenv.cfg.current_config.pstv_mode = emuenv.cfg.pstv_mode;
@@ -557,6 +567,14 @@ void draw_settings_dialog(GuiState &gui, EmuEnvState &emuenv) {
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("%s", lang.cpu["cpu_opt_description"].c_str());
         }
+        ImGui::Spacing();
+        ImGui::Checkbox(lang.cpu["libc_fast_paths"].c_str(), &config.libc_fast_paths);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("%s", lang.cpu["libc_fast_paths_description"].c_str());
+        ImGui::Spacing();
+        ImGui::Checkbox(lang.cpu["slab_heap"].c_str(), &config.slab_heap);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("%s", lang.cpu["slab_heap_description"].c_str());
         ImGui::EndTabItem();
     } else
         ImGui::PopStyleColor();
@@ -615,15 +633,13 @@ void draw_settings_dialog(GuiState &gui, EmuEnvState &emuenv) {
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("%s", lang.gpu["surface_sync_description"].c_str());
 
-            if (is_vulkan)
-                ImGui::SameLine();
+            ImGui::SameLine();
         }
 
-        if (is_vulkan) {
-            ImGui::Checkbox("Aynchronous pipeline compilation", &config.async_pipeline_compilation);
-            if (ImGui::IsItemHovered())
-                ImGui::SetTooltip("Allow pipelines to be compiler concurrently on multiple concurrent threads.\n This decreases pipeline compilation stutter at the cost of temporary graphical glitches");
-        }
+        // with OpenGL, it needs GL_KHR_parallel_shader_compile and the shaders are compiled by the driver
+        ImGui::Checkbox("Aynchronous pipeline compilation", &config.async_pipeline_compilation);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Allow pipelines to be compiler concurrently on multiple concurrent threads.\n This decreases pipeline compilation stutter at the cost of temporary graphical glitches");
 
         // Screen Filter
         ImGui::Spacing();
@@ -751,6 +767,12 @@ void draw_settings_dialog(GuiState &gui, EmuEnvState &emuenv) {
         int export_format_pos = config.export_as_png ? 0 : 1;
         if (ImGui::Combo(lang.gpu["texture_exporting_format"].c_str(), &export_format_pos, export_formats, IM_ARRAYSIZE(export_formats)))
             config.export_as_png = export_format_pos == 0;
+        if (!emuenv.io.title_id.empty()) {
+            if (ImGui::Button(lang.gpu["pack_exported_textures"].c_str()))
+                emuenv.renderer->get_texture_cache()->pack_exported_textures();
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("%s", lang.gpu["pack_exported_textures_description"].c_str());
+        }
 
         // Shaders
         ImGui::SetCursorPosX((ImGui::GetWindowWidth() / 2.f) - (ImGui::CalcTextSize(lang.gpu["shaders"].c_str()).x / 2.f));
@@ -28,7 +28,6 @@
 #include <io/functions.h>
 
 #include <pugixml.hpp>
-#include <stb_image.h>
 
 namespace gui {
 using namespace np::trophy;
@@ -128,6 +127,7 @@ void init_trophy_collection(GuiState &gui, EmuEnvState &emuenv) {
     const auto TROPHY_PATH{ emuenv.pref_path / "ux0/user" / emuenv.io.user_id / "trophy" };
     const auto TROPHY_CONF_PATH = TROPHY_PATH / "conf";
 
+    gui.image_loader.cancel("trophy_collection");
     gui.trophy_np_com_id_list_icons.clear(), np_com_id_info.clear(), np_com_id_list.clear();
 
     if (fs::exists(TROPHY_CONF_PATH) && !fs::is_empty(TROPHY_CONF_PATH)) {
@@ -231,26 +231,21 @@ void init_trophy_collection(GuiState &gui, EmuEnvState &emuenv) {
 
                 np_com_id_list.push_back({ np_com_id, np_com_id_info[np_com_id].name["000"], progress, updated });
 
+                // the icons are read and decoded in the background, the list is drawn without them until they are ready
                 for (const auto &group : np_com_list_name_icons) {
-                    int32_t width = 0;
-                    int32_t height = 0;
-                    vfs::FileBuffer buffer;
-
-                    vfs::read_file(VitaIoDevice::ux0, buffer, emuenv.pref_path.wstring(), "user/" + emuenv.io.user_id + "/trophy/conf/" + np_com_id + "/" + group.second);
-
-                    if (buffer.empty()) {
-                        LOG_WARN("Icon: '{}', Not found for NPComId: {}.", group.second, np_com_id);
-                        continue;
-                    }
-
-                    stbi_uc *data = stbi_load_from_memory(&buffer[0], static_cast<int>(buffer.size()), &width, &height, nullptr, STBI_rgb_alpha);
-                    if (!data) {
-                        LOG_ERROR("Invalid icon: '{}' for NPComId: {}.", group.second, np_com_id);
-                        continue;
-                    }
-
-                    gui.trophy_np_com_id_list_icons[np_com_id][group.first].init(gui.imgui_state.get(), data, width, height);
-                    stbi_image_free(data);
+                    const auto icon_path = "user/" + emuenv.io.user_id + "/trophy/conf/" + np_com_id + "/" + group.second;
+                    gui.image_loader.load(
+                        "trophy_collection", icon_path,
+                        [pref_path = emuenv.pref_path.wstring(), icon_path, icon_name = group.second, np_com_id]() {
+                            vfs::FileBuffer buffer;
+                            vfs::read_file(VitaIoDevice::ux0, buffer, pref_path, icon_path);
+                            if (buffer.empty())
+                                LOG_WARN("Icon: '{}', Not found for NPComId: {}.", icon_name, np_com_id);
+                            return buffer;
+                        },
+                        [&gui, np_com_id, group_id = group.first](ImGui_Texture &&texture, int32_t, int32_t) {
+                            gui.trophy_np_com_id_list_icons[np_com_id][group_id] = std::move(texture);
+                        });
                 }
             }
         }
@@ -291,6 +286,7 @@ static void get_trophy_list(GuiState &gui, EmuEnvState &emuenv, const std::strin
         return;
     }
 
+    gui.image_loader.cancel("trophy_list");
     gui.trophy_list.clear(), trophy_info.clear(), trophy_list.clear();
 
     const std::string sfm_name = fs::exists(trophy_conf_id_path / fmt::format("TROP_{:0>2d}.SFM", emuenv.cfg.sys_lang)) ? fmt::format("TROP_{:0>2d}.SFM", emuenv.cfg.sys_lang) : "TROP.SFM";
@@ -312,25 +308,25 @@ static void get_trophy_list(GuiState &gui, EmuEnvState &emuenv, const std::strin
     }
 
     for (const auto &trophy : trophy_info) {
-        int32_t width = 0;
-        int32_t height = 0;
-        vfs::FileBuffer buffer;
         const std::string trophy_id = trophy.first;
         const std::string icon_name = fmt::format("TROP{}.PNG", trophy_id);
-
-        vfs::read_file(VitaIoDevice::ux0, buffer, emuenv.pref_path.wstring(), "user/" + emuenv.io.user_id + "/trophy/conf/" + np_com_id + "/" + icon_name);
-        if (buffer.empty()) {
+        const auto icon_path = "user/" + emuenv.io.user_id + "/trophy/conf/" + np_com_id + "/" + icon_name;
+        if (!fs::exists(emuenv.pref_path / "ux0" / icon_path)) {
             LOG_WARN("Trophy icon, Name: '{}', Not found for trophy id: {}.", icon_name, trophy.first);
             continue;
         }
-        stbi_uc *data = stbi_load_from_memory(&buffer[0], static_cast<int>(buffer.size()), &width, &height, nullptr, STBI_rgb_alpha);
-        if (!data) {
-            LOG_ERROR("Invalid trophy icon for trophy id {} [{}].", icon_name, trophy_id);
-            continue;
-        }
 
-        gui.trophy_list[trophy_id].init(gui.imgui_state.get(), data, width, height);
-        stbi_image_free(data);
+        // the icon is drawn once it has been decoded in the background
+        gui.image_loader.load(
+            "trophy_list", icon_path,
+            [pref_path = emuenv.pref_path.wstring(), icon_path]() {
+                vfs::FileBuffer buffer;
+                vfs::read_file(VitaIoDevice::ux0, buffer, pref_path, icon_path);
+                return buffer;
+            },
+            [&gui, trophy_id](ImGui_Texture &&texture, int32_t, int32_t) {
+                gui.trophy_list[trophy_id] = std::move(texture);
+            });
 
         auto common = gui.lang.common.main;
         const auto trophy_type = np_com_id_info[np_com_id].context.trophy_kinds[string_utils::stoi_def(trophy_id, 0, "trophy id")];
@@ -50,6 +50,8 @@ bool is_yuv_format(SceGxmTextureBaseFormat base_format);
 uint32_t attribute_format_size(SceGxmAttributeFormat format);
 uint32_t index_element_size(SceGxmIndexFormat format);
 bool is_stream_instancing(SceGxmIndexSource source);
+// biggest index of an index buffer, used to know the size of the vertex streams read by a draw
+uint32_t get_max_index(const void *indices, uint32_t count, SceGxmIndexFormat format);
 bool convert_color_format_to_texture_format(SceGxmColorFormat format, SceGxmTextureFormat &dest_format);
 
 // Transfer
@@ -19,9 +19,12 @@
 
 #include <gxm/types.h>
 #include <mem/ptr.h>
-#include <threads/queue.h>
+#include <threads/spsc_queue.h>
+#include <util/containers.h>
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 
 struct SDL_Thread;
@@ -48,12 +51,27 @@ struct MemoryMapInfo {
     std::uint32_t perm;
 };
 
+// max index of an index buffer, kept while the guest does not write to it
+struct IndexRange {
+    // set by the write protection of the index buffer
+    std::atomic<bool> dirty = true;
+    SceGxmIndexFormat format = SCE_GXM_INDEX_FORMAT_U16;
+    uint32_t max_index = 0;
+    // number of times the index buffer was protected, once too high it is considered dynamic and always scanned
+    uint32_t protect_count = 0;
+    bool is_dynamic = false;
+};
+
 struct GxmState {
     SceGxmInitializeParams params;
-    Queue<DisplayCallback> display_queue;
+    // at most 2 entries are pending, see sceGxmInitialize
+    SPSCQueue<DisplayCallback, 4> display_queue;
     Ptr<SceGxmSyncObject> last_fbo_sync_object;
     Ptr<uint32_t> notification_region;
     SceUID display_queue_thread;
     std::map<Address, MemoryMapInfo> memory_mapped_regions;
     std::mutex callback_lock;
+    // key is (index buffer address << 32 | index buffer size), only used without memory mapping
+    std::mutex index_ranges_mutex;
+    unordered_map_fast<uint64_t, std::shared_ptr<IndexRange>> index_ranges;
 };
@@ -21,6 +21,7 @@
 
 #define SCE_GXM_DEFAULT_UNIFORM_BUFFER_CONTAINER_INDEX 0
 #define SCE_GXM_GPU_CORE_COUNT 4U
+#define SCE_GXM_MAX_VERTEX_ATTRIBUTES 16
 #define SCE_GXM_MAX_VERTEX_STREAMS 16
 #define SCE_GXM_MAX_TEXTURE_UNITS 16
 #define SCE_GXM_MAX_UNIFORM_BUFFERS 14
@@ -17,8 +17,105 @@
 
 #include <gxm/functions.h>
 
+#include <util/instrset_detect.h>
+
+#include <algorithm>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#define STREAM_SIMD_X64
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((__target__("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_AVX2
+#include <intrin.h>
+#endif
+#endif
+
 namespace gxm {
 bool is_stream_instancing(SceGxmIndexSource source) {
     return (source == SCE_GXM_INDEX_SOURCE_EACH_INSTANCE_16BIT) || (source == SCE_GXM_INDEX_SOURCE_EACH_INSTANCE_32BIT);
 }
+
+template <typename T>
+static uint32_t get_max_index_basic(const T *indices, size_t count) {
+    if (count == 0)
+        return 0;
+    return *std::max_element(indices, indices + count);
+}
+
+#if defined(__aarch64__)
+static uint32_t get_max_index_u16_neon(const uint16_t *indices, size_t count) {
+    uint16x8_t max_value = vdupq_n_u16(0);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        max_value = vmaxq_u16(max_value, vld1q_u16(indices + i));
+    return std::max<uint32_t>(vmaxvq_u16(max_value), get_max_index_basic(indices + i, count - i));
+}
+
+static uint32_t get_max_index_u32_neon(const uint32_t *indices, size_t count) {
+    uint32x4_t max_value = vdupq_n_u32(0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        max_value = vmaxq_u32(max_value, vld1q_u32(indices + i));
+    return std::max<uint32_t>(vmaxvq_u32(max_value), get_max_index_basic(indices + i, count - i));
+}
+#elif defined(STREAM_SIMD_X64)
+static uint32_t TARGET_AVX2 get_max_index_u16_avx2(const uint16_t *indices, size_t count) {
+    __m256i max_value = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        max_value = _mm256_max_epu16(max_value, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + i)));
+
+    alignas(32) uint16_t lanes[16];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), max_value);
+    return std::max(get_max_index_basic(lanes, 16), get_max_index_basic(indices + i, count - i));
+}
+
+static uint32_t TARGET_AVX2 get_max_index_u32_avx2(const uint32_t *indices, size_t count) {
+    __m256i max_value = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        max_value = _mm256_max_epu32(max_value, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + i)));
+
+    alignas(32) uint32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), max_value);
+    return std::max(get_max_index_basic(lanes, 8), get_max_index_basic(indices + i, count - i));
+}
+#endif
+
+using GetMaxIndexU16Func = uint32_t (*)(const uint16_t *indices, size_t count);
+using GetMaxIndexU32Func = uint32_t (*)(const uint32_t *indices, size_t count);
+
+static GetMaxIndexU16Func select_get_max_index_u16() {
+#if defined(__aarch64__)
+    return get_max_index_u16_neon;
+#elif defined(STREAM_SIMD_X64)
+    if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2)
+        return get_max_index_u16_avx2;
+#endif
+    return get_max_index_basic<uint16_t>;
+}
+
+static GetMaxIndexU32Func select_get_max_index_u32() {
+#if defined(__aarch64__)
+    return get_max_index_u32_neon;
+#elif defined(STREAM_SIMD_X64)
+    if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2)
+        return get_max_index_u32_avx2;
+#endif
+    return get_max_index_basic<uint32_t>;
+}
+
+uint32_t get_max_index(const void *indices, uint32_t count, SceGxmIndexFormat format) {
+    static const GetMaxIndexU16Func get_max_index_u16 = select_get_max_index_u16();
+    static const GetMaxIndexU32Func get_max_index_u32 = select_get_max_index_u32();
+
+    if (format == SCE_GXM_INDEX_FORMAT_U16)
+        return get_max_index_u16(static_cast<const uint16_t *>(indices), count);
+    else
+        return get_max_index_u32(static_cast<const uint32_t *>(indices), count);
+}
 } // namespace gxm
@@ -19,6 +19,7 @@
 
 #include <mem/ptr.h>
 
+#include <chrono>
 #include <map>
 #include <string>
 #include <util/types.h>
@@ -236,6 +237,23 @@ struct SceConnection {
     SceBool keepAlive;
     bool isSecure;
     int sockfd;
+    void *ssl = nullptr;
+    // scheme, host and port of the connection, the key of the idle connections pool
+    std::string hostKey;
+    // the last response was fully read and the server did not ask to close the connection
+    bool reusable = false;
+};
+
+struct HttpIdleConnection {
+    int sockfd;
+    void *ssl;
+    std::chrono::steady_clock::time_point lastUsed;
+};
+
+struct HttpResolvedHost {
+    int family;
+    std::vector<uint8_t> address;
+    std::chrono::steady_clock::time_point expires;
 };
 
 struct SceRequestResponse {
@@ -276,4 +294,8 @@ struct HTTPState {
     std::map<SceInt, SceRequest> requests;
     std::vector<Ptr<void>> guestPointers;
     void *ssl_ctx = nullptr;
+    // kept alive connections of deleted connections, reused by the next connections to the same host
+    std::multimap<std::string, HttpIdleConnection> idleConnections;
+    // resolved addresses by host and port
+    std::map<std::string, HttpResolvedHost> resolvedHosts;
 };
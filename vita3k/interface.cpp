@@ -19,6 +19,8 @@
 
 #include "module/load_module.h"
 
+#include <app/boot_profile.h>
+#include <audio/state.h>
 #include <config/state.h>
 #include <ctrl/functions.h>
 #include <ctrl/state.h>
@@ -43,11 +45,19 @@
 #include <touch/touch.h>
 #include <util/find.h>
 #include <util/log.h>
+#include <util/safe_time.h>
 #include <util/string_utils.h>
 
 #include <gui/imgui_impl_sdl.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <fstream>
+#include <mutex>
 #include <regex>
+#include <thread>
 
 #include <SDL.h>
 
@@ -57,6 +67,10 @@
 #include <app/discord.h>
 #endif
 
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
 static size_t write_to_buffer(void *pOpaque, mz_uint64 file_ofs, const void *pBuf, size_t n) {
     vfs::FileBuffer *const buffer = static_cast<vfs::FileBuffer *>(pOpaque);
     assert(file_ofs == buffer->size());
@@ -71,6 +85,138 @@ static const char *miniz_get_error(const ZipPtr &zip) {
     return mz_zip_get_error_string(mz_zip_get_last_error(zip.get()));
 }
 
+static FILE *open_archive_file(const fs::path &archive_path) {
+    FILE *fp;
+#ifdef WIN32
+    _wfopen_s(&fp, archive_path.generic_path().wstring().c_str(), L"rb");
+#else
+    fp = fopen(archive_path.generic_path().string().c_str(), "rb");
+#endif
+    return fp;
+}
+
+struct ArchiveFileJob {
+    mz_uint index;
+    fs::path output;
+    mz_uint64 size;
+};
+
+static size_t write_to_file(void *pOpaque, mz_uint64 file_ofs, const void *pBuf, size_t n) {
+    return fwrite(pBuf, 1, n, static_cast<FILE *>(pOpaque));
+}
+
+static bool extract_archive_file(mz_zip_archive &zip, const ArchiveFileJob &job) {
+#ifdef WIN32
+    FILE *fp = _wfopen(job.output.generic_path().wstring().c_str(), L"wb");
+#else
+    FILE *fp = fopen(job.output.generic_path().string().c_str(), "wb");
+#endif
+    if (!fp)
+        return false;
+
+    // reserve the whole file up front so the file system does not have to extend it on every write
+#ifdef __linux__
+    if (job.size > 0)
+        posix_fallocate(fileno(fp), 0, static_cast<off_t>(job.size));
+#endif
+    std::vector<char> write_buffer(std::min<mz_uint64>(job.size, 1024 * 1024) + 1);
+    setvbuf(fp, write_buffer.data(), _IOFBF, write_buffer.size());
+
+    const bool success = mz_zip_reader_extract_to_callback(&zip, job.index, &write_to_file, fp, 0);
+    const bool closed = fclose(fp) == 0;
+    return success && closed;
+}
+
+/**
+ * \brief Extract the files of a content from the archive on several threads.
+ *
+ * The directories are created first on the calling thread, then each worker opens its own reader
+ * on the archive and takes the next file to extract until there are none left.
+ * progress_callback is called on the calling thread with the percentage of bytes extracted.
+ */
+static void extract_archive_files(const fs::path &archive_path, const ZipPtr &zip, const std::string &content_path, const fs::path &output_path, const std::function<void(float)> &progress_callback) {
+    std::vector<ArchiveFileJob> jobs;
+    mz_uint64 total_size = 0;
+    const mz_uint num_files = mz_zip_reader_get_num_files(zip.get());
+    for (mz_uint i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(zip.get(), i, &file_stat))
+            continue;
+        const std::string m_filename = file_stat.m_filename;
+        if (m_filename.find(content_path) == std::string::npos)
+            continue;
+
+        const fs::path file_output = { output_path / m_filename.substr(content_path.size()) };
+        if (mz_zip_reader_is_file_a_directory(zip.get(), i)) {
+            fs::create_directories(file_output);
+        } else {
+            if (!fs::exists(file_output.parent_path()))
+                fs::create_directories(file_output.parent_path());
+            jobs.push_back({ i, file_output, file_stat.m_uncomp_size });
+            total_size += file_stat.m_uncomp_size;
+        }
+    }
+
+    // start with the biggest files so a large one does not end up alone at the end
+    std::sort(jobs.begin(), jobs.end(), [](const ArchiveFileJob &a, const ArchiveFileJob &b) { return a.size > b.size; });
+
+    std::atomic<size_t> next_job = 0;
+    std::atomic<mz_uint64> extracted_size = 0;
+    std::atomic<uint32_t> running_workers = 0;
+    std::mutex mutex;
+    std::condition_variable done_cond;
+
+    const auto worker = [&]() {
+        mz_zip_archive worker_zip = {};
+        FILE *fp = open_archive_file(archive_path);
+        if (!fp || !mz_zip_reader_init_cfile(&worker_zip, fp, 0, 0)) {
+            LOG_ERROR("Failed to open the archive {} for extraction", archive_path.generic_path().string());
+            if (fp)
+                fclose(fp);
+        } else {
+            for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+                const ArchiveFileJob &job = jobs[i];
+                LOG_INFO("Extracting {}", job.output.generic_path().string());
+                if (!extract_archive_file(worker_zip, job))
+                    LOG_ERROR("miniz error: {} extracting file: {}", mz_zip_get_error_string(mz_zip_get_last_error(&worker_zip)), job.output.generic_path().string());
+                extracted_size += job.size;
+            }
+            mz_zip_reader_end(&worker_zip);
+            fclose(fp);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running_workers--;
+        done_cond.notify_one();
+    };
+
+    const uint32_t max_workers = static_cast<uint32_t>(std::min<size_t>(std::max<size_t>(jobs.size(), 1), 8));
+    const uint32_t num_workers = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1, max_workers);
+    running_workers = num_workers;
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < num_workers; i++)
+        workers.emplace_back(worker);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done_cond.wait_for(lock, std::chrono::milliseconds(50), [&] { return running_workers == 0; })) {
+            if (progress_callback && total_size > 0)
+                progress_callback(static_cast<float>(extracted_size) / total_size * 100.0f);
+        }
+    }
+    for (auto &thread : workers)
+        thread.join();
+
+    // a worker could not open the archive, extract what is left of the files here
+    if (next_job < jobs.size()) {
+        for (size_t i = next_job; i < jobs.size(); i++) {
+            LOG_INFO("Extracting {}", jobs[i].output.generic_path().string());
+            if (!extract_archive_file(*zip, jobs[i]))
+                LOG_ERROR("miniz error: {} extracting file: {}", miniz_get_error(zip), jobs[i].output.generic_path().string());
+        }
+    }
+}
+
 static void set_theme_name(EmuEnvState &emuenv, vfs::FileBuffer &buf) {
     emuenv.app_info.app_title = gui::get_theme_title_from_buffer(buf);
     emuenv.app_info.app_title_id = string_utils::remove_special_chars(emuenv.app_info.app_title);
@@ -185,30 +331,12 @@ bool install_archive_content(EmuEnvState &emuenv, GuiState *gui, const fs::path
             progress_callback({ {}, {}, { file_progress * 0.7f + decrypt_progress * 0.3f } });
     };
 
-    int num_files = mz_zip_reader_get_num_files(zip.get());
-    for (auto i = 0; i < num_files; i++) {
-        mz_zip_archive_file_stat file_stat;
-        if (!mz_zip_reader_file_stat(zip.get(), i, &file_stat)) {
-            continue;
-        }
-        const std::string m_filename = file_stat.m_filename;
-        if (m_filename.find(content_path) != std::string::npos) {
-            file_progress = static_cast<float>(i) / num_files * 100.0f;
-            update_progress();
-
-            std::string replace_filename = m_filename.substr(content_path.size());
-            const fs::path file_output = { output_path / replace_filename };
-            if (mz_zip_reader_is_file_a_directory(zip.get(), i)) {
-                fs::create_directories(file_output);
-            } else {
-                if (!fs::exists(file_output.parent_path()))
-                    fs::create_directories(file_output.parent_path());
-
-                LOG_INFO("Extracting {}", file_output.generic_path().string());
-                mz_zip_reader_extract_to_file(zip.get(), i, file_output.generic_path().string().c_str(), 0);
-            }
-        }
-    }
+    update_progress();
+    extract_archive_files(archive_path, zip, content_path, output_path, [&](float progress) {
+        file_progress = progress;
+        update_progress();
+    });
+    file_progress = 100.0f;
 
     // Rename directory on correct name when is request, Todo of extract zip, no support unicode
     if (emuenv.app_info.app_category == "theme") {
@@ -284,13 +412,7 @@ std::vector<ContentInfo> install_archive(EmuEnvState &emuenv, GuiState *gui, con
     const ZipPtr zip(new mz_zip_archive, delete_zip);
     std::memset(zip.get(), 0, sizeof(*zip));
 
-    FILE *vpk_fp;
-
-#ifdef WIN32
-    _wfopen_s(&vpk_fp, archive_path.generic_path().wstring().c_str(), L"rb");
-#else
-    vpk_fp = fopen(archive_path.generic_path().string().c_str(), "rb");
-#endif
+    FILE *vpk_fp = open_archive_file(archive_path);
 
     if (!mz_zip_reader_init_cfile(zip.get(), vpk_fp, 0, 0)) {
         LOG_CRITICAL("miniz error reading archive: {}", miniz_get_error(zip));
@@ -424,9 +546,16 @@ static ExitCode load_app_impl(SceUID &main_module_id, EmuEnvState &emuenv, const
     const auto call_import = [&emuenv](CPUState &cpu, uint32_t nid, SceUID thread_id) {
         ::call_import(emuenv, cpu, nid, thread_id);
     };
-    if (!emuenv.kernel.init(emuenv.mem, call_import, emuenv.kernel.cpu_backend, emuenv.kernel.cpu_opt)) {
-        LOG_WARN("Failed to init kernel!");
-        return KernelInitFailed;
+    const auto call_hle_import = [&emuenv](CPUState &cpu, uint32_t import_index, SceUID thread_id, bool nonblocking_only) {
+        return ::call_hle_import(emuenv, cpu, import_index, thread_id, nonblocking_only);
+    };
+    emuenv.kernel.scalable_exclusive_monitor = emuenv.cfg.scalable_exclusive_monitor;
+    {
+        BOOT_STAGE("Kernel init");
+        if (!emuenv.kernel.init(emuenv.mem, call_import, call_hle_import, emuenv.kernel.cpu_backend, emuenv.kernel.cpu_opt)) {
+            LOG_WARN("Failed to init kernel!");
+            return KernelInitFailed;
+        }
     }
 
     if (emuenv.cfg.archive_log) {
@@ -438,6 +567,10 @@ static ExitCode load_app_impl(SceUID &main_module_id, EmuEnvState &emuenv, const
         logging::set_level(static_cast<spdlog::level::level_enum>(emuenv.cfg.log_level));
     }
 
+    // the import calls are recorded without being formatted, so watching them barely slows the guest down
+    if (emuenv.cfg.binary_import_log)
+        logging::open_binary_log(emuenv.log_path / "imports.bin");
+
     LOG_INFO("{}: {}", emuenv.cfg[e_cpu_backend], emuenv.cfg.current_config.cpu_backend);
     LOG_INFO_IF(emuenv.kernel.cpu_backend == CPUBackend::Dynarmic, "CPU Optimisation state: {}", emuenv.cfg.current_config.cpu_opt);
     LOG_INFO("ngs state: {}", emuenv.cfg.current_config.ngs_enable);
@@ -468,14 +601,28 @@ static ExitCode load_app_impl(SceUID &main_module_id, EmuEnvState &emuenv, const
     init_savedata_app_path(emuenv.io, emuenv.pref_path);
 
     // todo: VAR_NID(__sce_libcparam, 0xDF084DFA) is loaded wrong
-    for (const auto &var : get_var_exports()) {
-        auto addr = var.factory(emuenv);
-        emuenv.kernel.export_nids.emplace(var.nid, addr);
+    {
+        BOOT_STAGE("Variable exports");
+        for (const auto &var : get_var_exports()) {
+            auto addr = var.factory(emuenv);
+            emuenv.kernel.export_nids.emplace(var.nid, addr);
+        }
     }
 
+    emuenv.kernel.host_fast_paths_enabled = emuenv.cfg.current_config.libc_fast_paths;
+    if (emuenv.cfg.current_config.slab_heap)
+        emuenv.kernel.slab_heap = std::make_unique<SlabHeap>(emuenv.mem);
+    emuenv.kernel.host_thread_mapping = emuenv.cfg.host_thread_mapping;
+    emuenv.kernel.set_host_cpu_set(emuenv.cfg.host_cpu_set);
+    // 3 user cores are available to applications
+    emuenv.kernel.scheduler.set_slot_count(std::max(emuenv.cfg.guest_threads_per_core, 0) * 3);
+
     // Load main executable
     emuenv.self_path = !emuenv.cfg.self_path.empty() ? emuenv.cfg.self_path : EBOOT_PATH;
-    main_module_id = load_module(emuenv, "app0:" + emuenv.self_path);
+    {
+        BOOT_STAGE("Main executable loading");
+        main_module_id = load_module(emuenv, "app0:" + emuenv.self_path);
+    }
     if (main_module_id >= 0) {
         const auto module = emuenv.kernel.loaded_modules[main_module_id];
         LOG_INFO("Main executable {} ({}) loaded", module->module_name, emuenv.self_path);
@@ -484,6 +631,14 @@ static ExitCode load_app_impl(SceUID &main_module_id, EmuEnvState &emuenv, const
     // Set self name from self path, can contain folder, get file name only
     emuenv.self_name = fs::path(emuenv.self_path).filename().string();
 
+    if (emuenv.cfg.jit_cache && (emuenv.kernel.cpu_backend == CPUBackend::Dynarmic)) {
+        BOOT_STAGE("JIT cache loading");
+        emuenv.kernel.jit_cache.load(emuenv.cache_path / "jit" / emuenv.io.title_id / emuenv.self_name);
+    }
+
+    if (emuenv.cfg.guest_profiler)
+        emuenv.kernel.start_guest_profiler(emuenv.log_path / "profiles" / fmt::format("{}-{}.txt", emuenv.io.title_id, emuenv.self_name));
+
     // get list of preload modules
     SceUInt32 process_preload_disabled = 0;
     auto process_param = emuenv.kernel.process_param.get(emuenv.mem);
@@ -520,6 +675,7 @@ static ExitCode load_app_impl(SceUID &main_module_id, EmuEnvState &emuenv, const
     add_preload_module(0x01000000, SCE_SYSMODULE_INVALID, "libpvf", false);
     add_preload_module(0x02000000, SCE_SYSMODULE_PERF, "libperf", false); // if DEVELOPMENT_MODE dipsw is set
 
+    BOOT_STAGE("Preload modules loading");
     for (const auto &module_path : lib_load_list) {
         auto res = load_module(emuenv, module_path);
         if (res < 0)
@@ -552,6 +708,80 @@ static void toggle_texture_replacement(EmuEnvState &emuenv) {
     emuenv.renderer->get_texture_cache()->set_replacement_state(emuenv.cfg.current_config.import_textures, emuenv.cfg.current_config.export_textures, emuenv.cfg.current_config.export_as_png);
 }
 
+static fs::path get_snapshot_path(EmuEnvState &emuenv) {
+    return emuenv.cache_path / "snapshots" / emuenv.io.title_id / fmt::format("{}.snap", emuenv.self_name);
+}
+
+static void save_snapshot(EmuEnvState &emuenv) {
+    const auto snapshot_path = get_snapshot_path(emuenv);
+    fs::create_directories(snapshot_path.parent_path());
+    emuenv.kernel.save_snapshot(emuenv.mem, snapshot_path);
+}
+
+static void load_snapshot(EmuEnvState &emuenv) {
+    const auto snapshot_path = get_snapshot_path(emuenv);
+    if (!fs::exists(snapshot_path)) {
+        LOG_WARN("No snapshot found for {}", emuenv.io.title_id);
+        return;
+    }
+    emuenv.kernel.load_snapshot(emuenv.mem, snapshot_path);
+}
+
+static std::string get_date_string() {
+    const std::time_t now = std::time(nullptr);
+    tm local = {};
+    SAFE_LOCALTIME(&now, &local);
+    return fmt::format("{:04}{:02}{:02}-{:02}{:02}{:02}", local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+}
+
+static void request_gpu_capture(EmuEnvState &emuenv) {
+    if (emuenv.renderer->capture.is_capturing()) {
+        LOG_WARN("A GPU capture is already running");
+        return;
+    }
+    const auto capture_path = emuenv.log_path / "captures" / fmt::format("{}_{}.v3kcap", emuenv.io.title_id, get_date_string());
+    fs::create_directories(capture_path.parent_path());
+    emuenv.renderer->capture.request(capture_path, static_cast<uint32_t>(std::max(emuenv.cfg.gpu_capture_frames, 1)));
+}
+
+static void take_screenshot(EmuEnvState &emuenv) {
+    const auto screenshot_path = emuenv.pref_path / "ux0/picture/SCREENSHOT" / emuenv.io.title_id / fmt::format("{}_{}.png", emuenv.io.title_id, get_date_string());
+    emuenv.renderer->screenshot.request(screenshot_path);
+}
+
+// Forwards the mixed output of the audio backend to the gameplay recorder
+class RecorderAudioCapture : public AudioCapture {
+public:
+    renderer::GameplayRecorder *recorder = nullptr;
+
+    void push_audio(const int16_t *samples, size_t nb_frames) override {
+        recorder->push_audio(samples, nb_frames);
+    }
+};
+
+static void toggle_gameplay_recording(EmuEnvState &emuenv) {
+    static RecorderAudioCapture audio_capture;
+    auto &recorder = emuenv.renderer->recorder;
+    if (recorder.is_recording()) {
+        emuenv.audio.set_capture(nullptr);
+        recorder.stop();
+        return;
+    }
+    if (emuenv.backend_renderer != renderer::Backend::Vulkan) {
+        LOG_WARN("Gameplay recording is only supported with the Vulkan renderer");
+        return;
+    }
+
+    const auto recording_path = emuenv.log_path / "recordings" / fmt::format("{}_{}.mkv", emuenv.io.title_id, get_date_string());
+    fs::create_directories(recording_path.parent_path());
+    // the audio is only recorded when the backend mixes all the ports in a single stream
+    audio_capture.recorder = &recorder;
+    const bool with_audio = emuenv.audio.set_capture(&audio_capture);
+    const uint32_t sample_rate = with_audio ? static_cast<uint32_t>(emuenv.audio.spec.freq) : 0;
+    if (!recorder.start(recording_path, sample_rate, emuenv.cfg.recording_video_encoder, static_cast<uint32_t>(std::max(emuenv.cfg.recording_bitrate, 1000))))
+        emuenv.audio.set_capture(nullptr);
+}
+
 bool handle_events(EmuEnvState &emuenv, GuiState &gui) {
     refresh_controllers(emuenv.ctrl, emuenv);
     const auto allow_switch_state = !emuenv.io.title_id.empty() && !gui.vita_area.app_close && !gui.vita_area.home_screen && !gui.vita_area.user_management && !gui.configuration_menu.custom_settings_dialog && !gui.configuration_menu.settings_dialog && !gui.controls_menu.controls_dialog && gui::get_sys_apps_state(gui);
@@ -703,6 +933,18 @@ bool handle_events(EmuEnvState &emuenv, GuiState &gui) {
                 switch_full_screen(emuenv);
             if (event.key.keysym.scancode == emuenv.cfg.keyboard_toggle_texture_replacement && !gui.is_key_capture_dropped)
                 toggle_texture_replacement(emuenv);
+            if (!emuenv.io.title_id.empty() && !gui.vita_area.home_screen && !gui.is_key_capture_dropped) {
+                if (event.key.keysym.scancode == emuenv.cfg.keyboard_save_snapshot)
+                    save_snapshot(emuenv);
+                else if (event.key.keysym.scancode == emuenv.cfg.keyboard_load_snapshot)
+                    load_snapshot(emuenv);
+                else if (event.key.keysym.scancode == emuenv.cfg.keyboard_gpu_capture)
+                    request_gpu_capture(emuenv);
+                else if (event.key.keysym.scancode == emuenv.cfg.keyboard_gameplay_recording)
+                    toggle_gameplay_recording(emuenv);
+                else if (event.key.keysym.scancode == emuenv.cfg.keyboard_screenshot)
+                    take_screenshot(emuenv);
+            }
 
             if (sce_ctrl_btn != 0)
                 ui_navigation(sce_ctrl_btn);
@@ -773,6 +1015,7 @@ bool handle_events(EmuEnvState &emuenv, GuiState &gui) {
 }
 
 ExitCode load_app(int32_t &main_module_id, EmuEnvState &emuenv, const std::wstring &path) {
+    BOOT_STAGE("App loading");
     if (load_app_impl(main_module_id, emuenv, path) != Success) {
         std::string message = "Failed to load \"";
         message += string_utils::wide_to_utf(path);
@@ -837,9 +1080,12 @@ ExitCode run_app(EmuEnvState &emuenv, int32_t main_module_id) {
     emuenv.main_thread_id = main_thread->id;
 
     // Run `module_start` export (entry point) of loaded libraries
-    for (auto &[_, module] : emuenv.kernel.loaded_modules) {
-        if (module->modid != main_module_id)
-            start_module(emuenv, module);
+    {
+        BOOT_STAGE("Modules start");
+        for (auto &[_, module] : emuenv.kernel.loaded_modules) {
+            if (module->modid != main_module_id)
+                start_module(emuenv, module);
+        }
     }
 
     SceKernelThreadOptParam param{ 0, 0 };
@@ -859,6 +1105,12 @@ ExitCode run_app(EmuEnvState &emuenv, int32_t main_module_id) {
         return RunThreadFailed;
     }
 
+    if (emuenv.cfg.record_input_path.has_value())
+        start_input_record(emuenv.ctrl.input_record, fs::path(*emuenv.cfg.record_input_path), emuenv.io.title_id);
+    else if (emuenv.cfg.replay_input_path.has_value())
+        start_input_replay(emuenv.ctrl.input_record, fs::path(*emuenv.cfg.replay_input_path), emuenv.io.title_id);
+    start_ctrl_polling(emuenv);
+
     start_sync_thread(emuenv);
 
     if (emuenv.cfg.boot_apps_full_screen && !emuenv.display.fullscreen.load())
@@ -866,3 +1118,62 @@ ExitCode run_app(EmuEnvState &emuenv, int32_t main_module_id) {
 
     return Success;
 }
+
+// the values must be sorted
+static float get_percentile(const std::vector<float> &sorted_values, float rank) {
+    if (sorted_values.empty())
+        return 0.f;
+    return sorted_values[std::min(sorted_values.size() - 1, static_cast<size_t>(rank * static_cast<float>(sorted_values.size())))];
+}
+
+ExitCode run_capture_replay(EmuEnvState &emuenv, GuiState &gui, const fs::path &path) {
+    if (!app::late_init(emuenv))
+        return InitConfigFailed;
+
+    renderer::CaptureReplay replay;
+    if (!replay.open(*emuenv.renderer, emuenv.renderer->features, emuenv.mem, emuenv.cfg, emuenv.display, path))
+        return FileNotFound;
+
+    const auto csv_path = emuenv.log_path / fmt::format("replay_{}_{}.csv", path.stem().string(), get_date_string());
+    std::ofstream csv(csv_path.string(), std::ios::trunc);
+    csv << "frame,cpu_ms,gpu_ms\n";
+
+    std::vector<float> cpu_times;
+    std::vector<float> gpu_times;
+    while (handle_events(emuenv, gui)) {
+        const auto start = std::chrono::steady_clock::now();
+        if (!replay.replay_frame(*emuenv.renderer, emuenv.renderer->features, emuenv.mem, emuenv.cfg, emuenv.display))
+            break;
+
+        const SceFVector2 viewport_pos = { emuenv.viewport_pos.x, emuenv.viewport_pos.y };
+        const SceFVector2 viewport_size = { emuenv.viewport_size.x, emuenv.viewport_size.y };
+        emuenv.renderer->render_frame(viewport_pos, viewport_size, emuenv.display, emuenv.gxm, emuenv.mem);
+        const std::chrono::duration<float, std::milli> cpu_time = std::chrono::steady_clock::now() - start;
+
+        gui::draw_begin(gui, emuenv);
+        gui::draw_end(gui, emuenv.window.get());
+        emuenv.renderer->swap_window(emuenv.window.get());
+
+        // the GPU time is only measured by the Vulkan renderer, from timestamps which are read a few frames late
+        const float gpu_time = emuenv.renderer->gpu_frame_time.load(std::memory_order_relaxed);
+        csv << fmt::format("{},{:.3f},{:.3f}\n", cpu_times.size(), cpu_time.count(), gpu_time);
+        cpu_times.push_back(cpu_time.count());
+        gpu_times.push_back(gpu_time);
+    }
+    replay.close(*emuenv.renderer, emuenv.renderer->features, emuenv.mem, emuenv.cfg);
+
+    const auto log_summary = [](const char *name, std::vector<float> &times) {
+        std::sort(times.begin(), times.end());
+        float total = 0.f;
+        for (const float time : times)
+            total += time;
+        LOG_INFO("Replay {} time: avg {:.3f} ms, p50 {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms", name,
+            times.empty() ? 0.f : total / static_cast<float>(times.size()), get_percentile(times, 0.5f), get_percentile(times, 0.95f), get_percentile(times, 0.99f));
+    };
+    LOG_INFO("Replayed {} of the {} frames of {}, frame times written to {}", cpu_times.size(), replay.get_frame_count(), path.string(), csv_path.string());
+    log_summary("CPU", cpu_times);
+    if (emuenv.backend_renderer == renderer::Backend::Vulkan)
+        log_summary("GPU", gpu_times);
+
+    return Success;
+}
@@ -59,3 +59,5 @@ uint32_t install_contents(EmuEnvState &emuenv, GuiState *gui, const fs::path &pa
 
 ExitCode load_app(int32_t &main_module_id, EmuEnvState &emuenv, const std::wstring &path);
 ExitCode run_app(EmuEnvState &emuenv, int32_t main_module_id);
+// Replays a GPU capture written by the renderer and logs the time of each frame
+ExitCode run_capture_replay(EmuEnvState &emuenv, GuiState &gui, const fs::path &path);
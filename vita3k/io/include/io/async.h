@@ -0,0 +1,71 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/types.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// request of a sceIo*Async function
+struct AsyncIoRequest {
+    SceUID op_id;
+    std::function<SceInt64()> run;
+    // called by the worker once the request is done, before the waiters are woken up
+    std::function<void(SceUID op_id, SceInt64 result)> on_complete;
+};
+
+struct AsyncIoOp {
+    bool done = false;
+    SceInt64 result = 0;
+};
+
+// runs the async requests on worker threads, so the thread issuing them does not stall on the host file system
+struct AsyncIoState {
+    std::mutex mutex;
+    // signaled when a fd has a request ready to run
+    std::condition_variable condvar;
+    // signaled when a request is done
+    std::condition_variable op_done;
+    bool stopping = false;
+
+    // requests of each fd (or of each op for the ones not using a fd yet), run one after the other in submission order
+    // a fd stays in the map while one of its requests is running
+    std::map<SceUID, std::deque<AsyncIoRequest>> pending;
+    // fds whose next request is not running yet
+    std::deque<SceUID> ready;
+    std::map<SceUID, AsyncIoOp> ops;
+
+    ~AsyncIoState();
+
+    void submit(SceUID fd, AsyncIoRequest &&request);
+    // block until the request is done and forget it, return false if op_id is unknown
+    bool wait(SceUID op_id, SceInt64 &result);
+    // remove a request which has not started yet, it completes with result
+    bool cancel(SceUID op_id, SceInt64 result);
+
+protected:
+    std::vector<std::thread> workers;
+
+    void worker_thread();
+};
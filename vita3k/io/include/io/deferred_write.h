@@ -0,0 +1,63 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// whole content of a file waiting to be written
+struct DeferredWrite {
+    std::vector<uint8_t> data;
+    std::chrono::steady_clock::time_point last_update;
+};
+
+// writes small metadata files (trophy progress, savedata params) on a worker thread, so the thread updating them
+// does not wait on the host file system, the updates of a file done within the delay are merged into the last one
+struct DeferredWriteState {
+    std::mutex mutex;
+    // signaled when a write is queued or the state is destroyed
+    std::condition_variable condvar;
+    // signaled when the worker is done with a file
+    std::condition_variable written;
+    bool stopping = false;
+
+    // by host path
+    std::map<std::string, DeferredWrite> pending;
+    // host path the worker is writing, empty if none
+    std::string writing;
+
+    // writes all the pending files
+    ~DeferredWriteState();
+
+    void write(const std::string &host_path, std::vector<uint8_t> &&data);
+    // write the pending content of host_path now and wait for the worker to be done with it
+    void flush(const std::string &host_path);
+    void flush_all();
+    bool empty();
+
+protected:
+    std::thread worker;
+
+    void worker_thread();
+};
@@ -68,13 +68,23 @@ bool copy_path(const fs::path &src_path, const std::wstring &pref_path, const st
 
 SceUID open_file(IOState &io, const char *path, const int flags, const std::wstring &pref_path, const char *export_name);
 int read_file(void *data, IOState &io, SceUID fd, SceSize size, const char *export_name);
-int write_file(SceUID fd, const void *data, SceSize size, const IOState &io, const char *export_name);
-int truncate_file(SceUID fd, unsigned long long length, const IOState &io, const char *export_name);
+// does not move the file position
+int pread_file(void *data, IOState &io, SceUID fd, SceSize size, SceOff offset, const char *export_name);
+int write_file(SceUID fd, const void *data, SceSize size, IOState &io, const char *export_name);
+// Writes the whole content of a file later on a worker thread, a later write to the same file replaces the pending one.
+// The file is written before it is opened, statted, renamed or removed and before its directory is opened.
+int write_file_deferred(IOState &io, const char *path, const void *data, SceSize size, const std::wstring &pref_path, const char *export_name);
+// Reads the start of a savedata slot file through the in-memory slot index, only the first read of a directory looks at the
+// file system. Returns the number of bytes read, or SCE_ERROR_ERRNO_ENOENT without logging an error if the file doesn't exist
+int read_savedata_slot_file(IOState &io, const char *path, void *data, SceSize size, const std::wstring &pref_path, const char *export_name);
+int truncate_file(SceUID fd, unsigned long long length, IOState &io, const char *export_name);
 SceOff seek_file(SceUID fd, SceOff offset, SceIoSeekMode whence, IOState &io, const char *export_name);
 SceOff tell_file(IOState &io, const SceUID fd, const char *export_name);
 int stat_file(IOState &io, const char *file, SceIoStat *statp, const std::wstring &pref_path, const char *export_name, SceUID fd = invalid_fd);
 int stat_file_by_fd(IOState &io, const SceUID fd, SceIoStat *statp, const std::wstring &pref_path, const char *export_name);
 int close_file(IOState &io, SceUID fd, const char *export_name);
+int sync_file(IOState &io, SceUID fd, const char *export_name);
+int sync_device(IOState &io, const char *device, const char *export_name);
 int remove_file(IOState &io, const char *file, const std::wstring &pref_path, const char *export_name);
 int rename(IOState &io, const char *old_name, const char *new_name, const std::wstring &pref_path, const char *export_name);
 
@@ -86,4 +96,5 @@ int remove_dir(IOState &io, const char *dir, const std::wstring &pref_path, cons
 
 // SceFios functions
 SceUID create_overlay(IOState &io, SceFiosProcessOverlay *fios_overlay);
+bool remove_overlay(IOState &io, SceUID overlay_id);
 std::string resolve_path(IOState &io, const char *input, const bool is_write, const SceUInt32 min_order = 0, const SceUInt32 max_order = 0x7F);
@@ -0,0 +1,58 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/fs.h>
+#include <util/mapped_file.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PsarcEntry {
+    // path inside the archive, without a leading slash
+    std::string name;
+    uint32_t block_index;
+    uint64_t size;
+    uint64_t offset;
+};
+
+// Reader of the PSARC archives mounted by sceFiosArchiveMount
+// Entries use independent blocks, so they can be extracted from several threads at the same time.
+class PsarcArchive {
+public:
+    // return false if the file is not a PSARC archive this reader supports (zlib compressed, unencrypted toc)
+    bool open(const fs::path &path);
+
+    const std::vector<PsarcEntry> &get_entries() const {
+        return entries;
+    }
+    uint32_t get_toc_size() const {
+        return toc_size;
+    }
+
+    bool read_entry(const PsarcEntry &entry, std::vector<uint8_t> &data) const;
+
+private:
+    MappedFile file;
+    uint32_t toc_size = 0;
+    uint32_t block_size = 0;
+    // compressed size of each block, 0 for a full block stored as is
+    std::vector<uint32_t> block_sizes;
+    std::vector<PsarcEntry> entries;
+};
@@ -0,0 +1,53 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#pragma once
+
+#include <util/fs.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// a file of a listed directory, its content is only read when it is first asked for
+struct SaveDataSlotFile {
+    bool loaded = false;
+    std::vector<uint8_t> data;
+};
+
+// content of the savedata slot param files, so the slots can be searched and shown without opening every slot file.
+// A directory is listed the first time one of its files is read, the changes made through io/ then keep it up to date
+struct SaveDataSlotIndex {
+    std::mutex mutex;
+    // files of each listed directory by name, by host path of the directory
+    std::map<std::string, std::map<std::string, SaveDataSlotFile>> directories;
+
+    bool listed(const fs::path &directory);
+    // false if the file doesn't exist
+    bool read(const fs::path &host_path, std::vector<uint8_t> &data);
+
+    // the whole content of the file was written
+    void update(const fs::path &host_path, const std::vector<uint8_t> &data);
+    // the file was created or opened for writing, its content is read again on the next read
+    void changed(const fs::path &host_path);
+    // the file or directory was removed or renamed
+    void removed(const fs::path &host_path);
+    void clear();
+};
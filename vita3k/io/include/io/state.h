@@ -17,23 +17,73 @@
 
 #pragma once
 
+#include <io/async.h>
+#include <io/deferred_write.h>
+#include <io/savedata_slot_index.h>
 #include <io/filesystem.h>
 #include <io/types.h>
 #include <io/util.h>
+#include <util/alloc_tracker.h>
+#include <util/containers.h>
+#include <util/mapped_file.h>
 
+#include <ctime>
+#include <iterator>
 #include <map>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
+
+// Content of a savedata file opened for writing, it replaces the host file at once when flushed
+// so many small writes cost a single host write and a crash never leaves a partially written file.
+struct WriteBackBuffer {
+    fs::path path;
+    std::vector<uint8_t> data;
+    bool dirty = false;
+
+    ~WriteBackBuffer();
+    bool flush();
+};
 
 // Class for all needed information to access files on Vita3K.
 class FileStats : public VitaStats {
     // Shared file pointer
     FilePtr wrapped_file;
+    // used instead of wrapped_file for read-only game data, reads are a single copy from the mapping
+    std::shared_ptr<MappedFile> mapped_file;
+    // used instead of wrapped_file for writable savedata
+    std::shared_ptr<WriteBackBuffer> write_buffer;
+    mutable SceOff position = 0;
+
+    // reads following each other are prefetched ahead by a window, so the next ones do not wait for the disk
+    mutable SceOff next_read_offset = 0;
+    mutable uint32_t sequential_reads = 0;
+    mutable SceOff prefetched_end = 0;
+    void track_read(SceOff offset, SceOff size) const;
 
 public:
     // Constructor used for files
     // Based on https://codereview.stackexchange.com/questions/4679/
-    explicit FileStats(const char *vita, const std::string &t, const fs::path &file, const int open) {
-        wrapped_file = create_shared_file(file, open);
+    explicit FileStats(const char *vita, const std::string &t, const fs::path &file, const int open, const bool map_if_read_only = false, const bool buffer_writes = false) {
+        if (map_if_read_only && !can_write(open)) {
+            auto mapping = std::make_shared<MappedFile>();
+            // empty files can not be mapped
+            if (mapping->open(file))
+                mapped_file = std::move(mapping);
+        }
+        if (buffer_writes && can_write(open)) {
+            write_buffer = std::make_shared<WriteBackBuffer>();
+            write_buffer->path = file;
+            if (open & SCE_O_TRUNC) {
+                write_buffer->dirty = true;
+            } else {
+                fs::ifstream in{ file, fs::ifstream::binary };
+                write_buffer->data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                TRACK_HOST_ALLOC(IoCache, write_buffer.get(), write_buffer->data.capacity());
+            }
+        }
+        if (!mapped_file && !write_buffer)
+            wrapped_file = create_shared_file(file, open);
 
         file_info.vita_loc = vita;
         file_info.translated = t;
@@ -62,10 +112,48 @@ public:
 
     // File functions
     SceOff read(void *input_data, int element_size, SceSize element_count) const;
+    // read at offset without moving the file position
+    SceOff pread(void *data, SceSize size, SceOff offset) const;
     SceOff write(const void *data, SceSize size, int count) const;
     int truncate(const SceSize size) const;
     bool seek(SceOff offset, SceIoSeekMode seek_mode) const;
     SceOff tell() const;
+    // write the buffered content or the FILE buffer to the host file
+    bool flush() const;
+    // size of the content not flushed yet, -1 if the file is not buffered
+    SceOff get_buffered_size() const;
+};
+
+// Directories of an app0 or addcont0 root indexed for case-insensitive lookups, with the modification
+// times used to know when the index (and its copy in the cache directory) is stale
+struct CaseIndex {
+    std::vector<std::pair<std::string, std::time_t>> dirs;
+};
+
+// Host path a guest path was resolved to, and its stat result once it has been statted
+struct PathCacheInfo {
+    std::string guest_path;
+    fs::path system_path;
+    std::string normalized_path;
+    bool is_game_data = false;
+    bool is_savedata = false;
+    bool is_directory = false;
+    bool has_stat = false;
+    SceIoStat stat;
+};
+
+// Resolved paths of sceIoOpen and sceIoGetstat, only paths that exist are cached.
+// Entries are dropped by writes, renames and removes done through io.cpp.
+struct PathCache {
+    static constexpr size_t size = 512;
+    // log the hit rate every time this many lookups were done
+    static constexpr uint64_t log_interval = 0x4000;
+
+    std::mutex mutex;
+    unordered_map_fast<std::string, PathCacheInfo *> lookup;
+    lru::Queue<PathCacheInfo> queue;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
 };
 
 // Class for implementing Directory structure; path names are wide for Windows, normal for else
@@ -122,9 +210,20 @@ struct IOState {
 
     std::unordered_map<std::string, std::string> cachemap;
     bool case_isens_find_enabled = false;
+    // roots already in cachemap, indexes are saved and loaded from case_index_path
+    std::map<std::string, CaseIndex> case_indexes;
+    fs::path case_index_path;
+
+    PathCache path_cache;
 
     std::mutex overlay_mutex;
     SceUID next_overlay_id = 1;
     // overlay in the order they should be applied
     std::vector<FiosOverlay> overlays;
+    // results of resolve_path for the current overlays, by input path and order range
+    std::map<std::tuple<std::string, SceUInt32, SceUInt32>, std::string> overlay_resolutions;
+
+    AsyncIoState async;
+    DeferredWriteState deferred_writes;
+    SaveDataSlotIndex savedata_slots;
 };
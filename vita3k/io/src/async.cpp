@@ -0,0 +1,139 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/async.h>
+
+#include <util/log.h>
+
+#include <algorithm>
+
+// file system calls mostly wait on the disk, there is no need for more
+constexpr int NB_ASYNC_IO_WORKERS = 2;
+
+AsyncIoState::~AsyncIoState() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condvar.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void AsyncIoState::submit(SceUID fd, AsyncIoRequest &&request) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (workers.empty()) {
+            LOG_INFO("Running asynchronous IO requests with {} threads", NB_ASYNC_IO_WORKERS);
+            for (int i = 0; i < NB_ASYNC_IO_WORKERS; i++)
+                workers.emplace_back(&AsyncIoState::worker_thread, this);
+        }
+
+        ops[request.op_id] = {};
+        const auto [it, is_idle] = pending.try_emplace(fd);
+        it->second.push_back(std::move(request));
+        // otherwise the worker running a request of this fd will queue it again once done
+        if (!is_idle)
+            return;
+
+        ready.push_back(fd);
+    }
+    condvar.notify_one();
+}
+
+bool AsyncIoState::wait(SceUID op_id, SceInt64 &result) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = ops.find(op_id);
+    op_done.wait(lock, [&] {
+        // another thread may have waited for the same op
+        it = ops.find(op_id);
+        return it == ops.end() || it->second.done;
+    });
+    if (it == ops.end())
+        return false;
+
+    result = it->second.result;
+    ops.erase(it);
+    return true;
+}
+
+bool AsyncIoState::cancel(SceUID op_id, SceInt64 result) {
+    AsyncIoRequest request;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        bool found = false;
+        for (auto &[fd, requests] : pending) {
+            const auto it = std::find_if(requests.begin(), requests.end(), [&](const AsyncIoRequest &request) { return request.op_id == op_id; });
+            if (it != requests.end()) {
+                request = std::move(*it);
+                requests.erase(it);
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+    }
+
+    if (request.on_complete)
+        request.on_complete(op_id, result);
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        ops[op_id] = { true, result };
+    }
+    op_done.notify_all();
+    return true;
+}
+
+void AsyncIoState::worker_thread() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condvar.wait(lock, [&] { return stopping || !ready.empty(); });
+        if (stopping)
+            break;
+
+        const SceUID fd = ready.front();
+        ready.pop_front();
+        const auto requests = pending.find(fd);
+        if (requests->second.empty()) {
+            // all its requests were cancelled
+            pending.erase(requests);
+            continue;
+        }
+
+        AsyncIoRequest request = std::move(requests->second.front());
+        requests->second.pop_front();
+
+        lock.unlock();
+        const SceInt64 result = request.run();
+        if (request.on_complete)
+            request.on_complete(request.op_id, result);
+        lock.lock();
+
+        // the next request of this fd can run now
+        if (requests->second.empty()) {
+            pending.erase(requests);
+        } else {
+            ready.push_back(fd);
+            condvar.notify_one();
+        }
+
+        ops[request.op_id] = { true, result };
+        op_done.notify_all();
+    }
+}
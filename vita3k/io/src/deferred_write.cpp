@@ -0,0 +1,135 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/deferred_write.h>
+
+#include <util/fs.h>
+#include <util/log.h>
+
+// a file is written once it was not updated for this long
+constexpr auto DEFERRED_WRITE_DELAY = std::chrono::milliseconds(500);
+
+static void write_host_file(const std::string &host_path, const std::vector<uint8_t> &data) {
+    const fs::path path(host_path);
+    if (!fs::exists(path.parent_path()))
+        fs::create_directories(path.parent_path());
+
+    fs::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open() || !file.write(reinterpret_cast<const char *>(data.data()), data.size()))
+        LOG_ERROR("Failed to write {}", host_path);
+}
+
+DeferredWriteState::~DeferredWriteState() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condvar.notify_all();
+    if (worker.joinable())
+        worker.join();
+
+    for (const auto &[host_path, write] : pending)
+        write_host_file(host_path, write.data);
+}
+
+void DeferredWriteState::write(const std::string &host_path, std::vector<uint8_t> &&data) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable())
+            worker = std::thread(&DeferredWriteState::worker_thread, this);
+
+        pending[host_path] = { std::move(data), std::chrono::steady_clock::now() };
+    }
+    condvar.notify_one();
+}
+
+void DeferredWriteState::flush(const std::string &host_path) {
+    std::unique_lock<std::mutex> lock(mutex);
+    // one file is written at a time
+    written.wait(lock, [&] { return writing.empty(); });
+
+    const auto it = pending.find(host_path);
+    if (it == pending.end())
+        return;
+
+    const DeferredWrite write = std::move(it->second);
+    pending.erase(it);
+    // the worker can not take another update of this file before this one is written
+    writing = host_path;
+    lock.unlock();
+    write_host_file(host_path, write.data);
+    lock.lock();
+    writing.clear();
+    written.notify_all();
+}
+
+void DeferredWriteState::flush_all() {
+    while (true) {
+        std::string host_path;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (pending.empty()) {
+                written.wait(lock, [&] { return writing.empty(); });
+                break;
+            }
+            host_path = pending.begin()->first;
+        }
+        flush(host_path);
+    }
+}
+
+bool DeferredWriteState::empty() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return pending.empty() && writing.empty();
+}
+
+void DeferredWriteState::worker_thread() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condvar.wait(lock, [&] { return stopping || !pending.empty(); });
+        if (stopping)
+            break;
+
+        // write the file whose last update is the oldest once the delay is over
+        auto oldest = pending.begin();
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            if (it->second.last_update < oldest->second.last_update)
+                oldest = it;
+        }
+        const auto deadline = oldest->second.last_update + DEFERRED_WRITE_DELAY;
+        if (std::chrono::steady_clock::now() < deadline) {
+            // the file can be updated or flushed in the meantime, it is looked for again after waiting
+            condvar.wait_until(lock, deadline, [&] { return stopping; });
+            continue;
+        }
+        if (!writing.empty()) {
+            // flushed by another thread, it notifies written once done
+            written.wait(lock, [&] { return writing.empty(); });
+            continue;
+        }
+
+        const std::string host_path = oldest->first;
+        const DeferredWrite write = std::move(oldest->second);
+        pending.erase(oldest);
+        writing = host_path;
+        lock.unlock();
+        write_host_file(host_path, write.data);
+        lock.lock();
+        writing.clear();
+        written.notify_all();
+    }
+}
@@ -24,10 +24,13 @@
 #include <io/vfs.h>
 
 #include <rtc/rtc.h>
+#include <util/alloc_tracker.h>
 #include <util/log.h>
 #include <util/preprocessor.h>
 #include <util/string_utils.h>
 
+#include <fmt/format.h>
+
 #ifdef WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -36,9 +39,11 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <iterator>
+#include <optional>
 #include <string>
 
 #if defined(__aarch64__) && defined(__APPLE__)
@@ -71,10 +76,8 @@ bool read_file(const VitaIoDevice device, FileBuffer &buf, const std::wstring &p
     if (!f)
         return false;
 
-    f.unsetf(fs::ifstream::skipws);
-    buf.reserve(fs::file_size(host_file_path));
-    buf.insert(buf.begin(), std::istream_iterator<uint8_t>(f), std::istream_iterator<uint8_t>());
-    return true;
+    buf.resize(fs::file_size(host_file_path));
+    return static_cast<bool>(f.read(reinterpret_cast<char *>(buf.data()), buf.size()));
 }
 
 bool read_app_file(FileBuffer &buf, const std::wstring &pref_path, const std::string &app_path, const fs::path &vfs_file_path) {
@@ -142,6 +145,10 @@ bool init(IOState &io, const fs::path &cache_path, const fs::path &log_path, con
         fs::create_directories(vd0_network);
 
     fs::create_directories(cache_path / "shaders");
+    io.case_index_path = cache_path / "case_index";
+
+    io.path_cache.queue.init(PathCache::size);
+    io.path_cache.lookup.reserve(PathCache::size);
     fs::create_directory(log_path / "shaderlog");
     fs::create_directory(log_path / "texturelog");
 
@@ -171,10 +178,128 @@ bool init_savedata_app_path(IOState &io, const fs::path &pref_path) {
         fs::create_directory(savedata_path);
     if (!fs::exists(savedata_game_path))
         fs::create_directory(savedata_game_path);
+    // the savedata may have been changed outside of io/ since the last app was run
+    io.savedata_slots.clear();
+
+    return true;
+}
+
+static constexpr uint32_t CASE_INDEX_MAGIC = 0x58444943; // 'CIDX'
+static constexpr uint32_t CASE_INDEX_VERSION = 1;
+
+static bool is_case_index_valid(const CaseIndex &index) {
+    boost::system::error_code error;
+    for (const auto &[dir, write_time] : index.dirs) {
+        if (fs::last_write_time(dir, error) != write_time || error)
+            return false;
+    }
+    return true;
+}
+
+static void build_case_index(const std::string &root, CaseIndex &index, std::vector<std::string> &files) {
+    boost::system::error_code error;
+    index.dirs.emplace_back(root, fs::last_write_time(root, error));
+    for (const auto &file : fs::recursive_directory_iterator(root)) {
+        files.push_back(file.path().string());
+        if (fs::is_directory(file.status()))
+            index.dirs.emplace_back(files.back(), fs::last_write_time(file.path(), error));
+    }
+}
+
+// Entries are stored relative to the root: a directory flag, the modification time and the path suffix
+static bool load_case_index(const fs::path &index_file, const std::string &root, CaseIndex &index, std::vector<std::string> &files) {
+    fs::ifstream in{ index_file, fs::ifstream::binary };
+    if (!in)
+        return false;
+
+    const auto read_string = [&in](std::string &str) {
+        uint32_t size = 0;
+        in.read(reinterpret_cast<char *>(&size), sizeof(size));
+        if (!in || size > 0x10000)
+            return false;
+        str.resize(size);
+        return static_cast<bool>(in.read(str.data(), size));
+    };
+
+    uint32_t magic = 0, version = 0, count = 0;
+    std::string stored_root;
+    in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char *>(&version), sizeof(version));
+    if (!in || magic != CASE_INDEX_MAGIC || version != CASE_INDEX_VERSION || !read_string(stored_root) || stored_root != root)
+        return false;
+
+    int64_t root_time = 0;
+    in.read(reinterpret_cast<char *>(&root_time), sizeof(root_time));
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!in)
+        return false;
+    index.dirs.emplace_back(root, static_cast<std::time_t>(root_time));
+
+    files.reserve(count);
+    std::string suffix;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t is_dir = 0;
+        int64_t write_time = 0;
+        in.read(reinterpret_cast<char *>(&is_dir), sizeof(is_dir));
+        in.read(reinterpret_cast<char *>(&write_time), sizeof(write_time));
+        if (!in || !read_string(suffix))
+            return false;
+        files.push_back(root + suffix);
+        if (is_dir)
+            index.dirs.emplace_back(files.back(), static_cast<std::time_t>(write_time));
+    }
 
     return true;
 }
 
+static void save_case_index(const fs::path &index_path, const fs::path &index_file, const std::string &root, const CaseIndex &index, const std::vector<std::string> &files) {
+    boost::system::error_code error;
+    fs::create_directories(index_path, error);
+
+    const fs::path temp_file = fs::path(index_file).replace_extension(".tmp");
+    {
+        fs::ofstream out{ temp_file, fs::ofstream::binary };
+        if (!out)
+            return;
+
+        const auto write_string = [&out](const char *str, uint32_t size) {
+            out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            out.write(str, size);
+        };
+
+        const uint32_t count = static_cast<uint32_t>(files.size());
+        const int64_t root_time = index.dirs.front().second;
+        out.write(reinterpret_cast<const char *>(&CASE_INDEX_MAGIC), sizeof(CASE_INDEX_MAGIC));
+        out.write(reinterpret_cast<const char *>(&CASE_INDEX_VERSION), sizeof(CASE_INDEX_VERSION));
+        write_string(root.data(), static_cast<uint32_t>(root.size()));
+        out.write(reinterpret_cast<const char *>(&root_time), sizeof(root_time));
+        out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+
+        // dirs are in the same order as files, skipping the root
+        size_t dir = 1;
+        for (const auto &file : files) {
+            const bool is_dir = dir < index.dirs.size() && index.dirs[dir].first == file;
+            const uint8_t dir_flag = is_dir ? 1 : 0;
+            const int64_t write_time = is_dir ? index.dirs[dir++].second : 0;
+            out.write(reinterpret_cast<const char *>(&dir_flag), sizeof(dir_flag));
+            out.write(reinterpret_cast<const char *>(&write_time), sizeof(write_time));
+            write_string(file.data() + root.size(), static_cast<uint32_t>(file.size() - root.size()));
+        }
+    }
+    fs::rename(temp_file, index_file, error);
+    if (error)
+        LOG_WARN("Failed to write case-insensitive index {}: {}", index_file.string(), error.message());
+}
+
+// rough host memory used by the case-insensitive index, the two strings and the node of each entry
+static uint64_t get_cachemap_size(const IOState &io) {
+    uint64_t size = io.cachemap.bucket_count() * sizeof(void *);
+    for (const auto &[lower_path, path] : io.cachemap)
+        size += sizeof(std::pair<std::string, std::string>) + sizeof(void *) + lower_path.capacity() + path.capacity();
+
+    return size;
+}
+
 bool find_case_isens_path(IOState &io, VitaIoDevice &device, const fs::path &translated_path, const fs::path &system_path) {
     std::string final_path{};
 
@@ -197,10 +322,26 @@ bool find_case_isens_path(IOState &io, VitaIoDevice &device, const fs::path &tra
     if (!fs::exists(final_path))
         return false;
 
-    for (const auto &file : fs::recursive_directory_iterator(final_path)) {
-        io.cachemap.insert(std::make_pair(string_utils::tolower(file.path().string()), file.path().string()));
+    // a miss on a root that has not changed since it was indexed is a file that does not exist
+    const auto loaded = io.case_indexes.find(final_path);
+    if (loaded != io.case_indexes.end() && is_case_index_valid(loaded->second))
+        return true;
+
+    const fs::path index_file = io.case_index_path / fmt::format("{:016X}.bin", std::hash<std::string>{}(final_path));
+    CaseIndex index;
+    std::vector<std::string> files;
+    if (!load_case_index(index_file, final_path, index, files) || !is_case_index_valid(index)) {
+        index.dirs.clear();
+        files.clear();
+        build_case_index(final_path, index, files);
+        save_case_index(io.case_index_path, index_file, final_path, index, files);
     }
 
+    for (const auto &file : files)
+        io.cachemap.insert(std::make_pair(string_utils::tolower(file), file));
+    io.case_indexes[final_path] = std::move(index);
+    TRACK_HOST_ALLOC(IoCache, &io.cachemap, get_cachemap_size(io));
+
     return true;
 }
 
@@ -279,6 +420,64 @@ std::string translate_path(const char *path, VitaIoDevice &device, const IOState
     return relative_path;
 }
 
+static std::optional<PathCacheInfo> find_cached_path(IOState &io, const char *path) {
+    PathCache &cache = io.path_cache;
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+
+    std::optional<PathCacheInfo> result;
+    const auto it = cache.lookup.find(path);
+    if (it != cache.lookup.end()) {
+        cache.queue.set_as_mru(it->second);
+        result = *it->second;
+        cache.hits++;
+    } else {
+        cache.misses++;
+    }
+
+    const uint64_t lookups = cache.hits + cache.misses;
+    if (lookups % PathCache::log_interval == 0)
+        LOG_DEBUG("Path cache: {} hits, {} misses ({:.1f}% hit rate)", cache.hits, cache.misses, cache.hits * 100.0 / lookups);
+
+    return result;
+}
+
+static void cache_path(IOState &io, const PathCacheInfo &info) {
+    PathCache &cache = io.path_cache;
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+
+    PathCacheInfo *entry;
+    const auto it = cache.lookup.find(info.guest_path);
+    if (it != cache.lookup.end()) {
+        entry = it->second;
+    } else {
+        entry = cache.queue.get_lru();
+        if (!entry->guest_path.empty())
+            cache.lookup.erase(entry->guest_path);
+        cache.lookup[info.guest_path] = entry;
+    }
+    *entry = info;
+    cache.queue.set_as_mru(entry);
+    TRACK_HOST_ALLOC(IoCache, entry, sizeof(PathCacheInfo) + entry->guest_path.capacity() + entry->system_path.native().capacity() + entry->normalized_path.capacity());
+}
+
+// drop the entries resolved to this host path, the path is empty to drop everything
+static void invalidate_cached_path(IOState &io, const fs::path &system_path) {
+    PathCache &cache = io.path_cache;
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+
+    for (auto it = cache.lookup.begin(); it != cache.lookup.end();) {
+        PathCacheInfo *entry = it->second;
+        if (system_path.empty() || entry->system_path == system_path) {
+            entry->guest_path.clear();
+            cache.queue.set_as_lru(entry);
+            TRACK_HOST_FREE(entry);
+            it = cache.lookup.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 std::string expand_path(IOState &io, const char *path, const std::wstring &pref_path) {
     auto device = device::get_device(path);
 
@@ -286,6 +485,60 @@ std::string expand_path(IOState &io, const char *path, const std::wstring &pref_
     return device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio).string();
 }
 
+// the pending deferred write of a file is done before the file system is looked at
+static void flush_deferred_write(IOState &io, const char *path, const std::wstring &pref_path) {
+    if (!io.deferred_writes.empty())
+        io.deferred_writes.flush(expand_path(io, path, pref_path));
+}
+
+int write_file_deferred(IOState &io, const char *path, const void *data, const SceSize size, const std::wstring &pref_path, const char *export_name) {
+    auto device = device::get_device(path);
+    if (device == VitaIoDevice::_INVALID) {
+        LOG_ERROR("Cannot find device for path: {}", path);
+        return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+    }
+
+    const auto translated_path = translate_path(path, device, io.device_paths);
+    if (translated_path.empty()) {
+        LOG_ERROR("Cannot translate path: {}", path);
+        return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+    }
+
+    const auto system_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    std::vector<uint8_t> content(bytes, bytes + size);
+    io.savedata_slots.update(system_path, content);
+    io.deferred_writes.write(system_path.string(), std::move(content));
+    invalidate_cached_path(io, system_path);
+    invalidate_cached_path(io, system_path.parent_path());
+
+    LOG_TRACE_IF(log_file_op, "{}: Queuing the write of {} bytes to {}", export_name, size, path);
+    return size;
+}
+
+int read_savedata_slot_file(IOState &io, const char *path, void *data, const SceSize size, const std::wstring &pref_path, const char *export_name) {
+    auto device = device::get_device(path);
+    const auto translated_path = translate_path(path, device, io.device_paths);
+    if ((device == VitaIoDevice::_INVALID) || translated_path.empty()) {
+        LOG_ERROR("Cannot translate path: {}", path);
+        return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+    }
+
+    const auto system_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+    // the files only queued for writing would be missing from the listing
+    if (!io.savedata_slots.listed(system_path.parent_path()))
+        io.deferred_writes.flush_all();
+
+    std::vector<uint8_t> content;
+    if (!io.savedata_slots.read(system_path, content))
+        return SCE_ERROR_ERRNO_ENOENT;
+
+    const SceSize read_size = std::min(size, static_cast<SceSize>(content.size()));
+    memcpy(data, content.data(), read_size);
+    LOG_TRACE_IF(log_file_op && log_file_read, "{}: Reading {} bytes of slot file {}", export_name, read_size, path);
+    return static_cast<int>(read_size);
+}
+
 SceUID open_file(IOState &io, const char *path, const int flags, const std::wstring &pref_path, const char *export_name) {
     auto device = device::get_device(path);
     auto device_for_icase = device;
@@ -310,53 +563,85 @@ SceUID open_file(IOState &io, const char *path, const int flags, const std::wstr
         return fd;
     }
 
-    const auto translated_path = translate_path(path, device, io.device_paths);
-    if (translated_path.empty()) {
-        LOG_ERROR("Cannot translate path: {}", path);
-        return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
-    }
+    flush_deferred_write(io, path, pref_path);
+
+    fs::path system_path;
+    std::string normalized_path;
+    bool is_game_data;
+    bool is_savedata;
+    if (const auto cached = find_cached_path(io, path); cached && !cached->is_directory) {
+        system_path = cached->system_path;
+        normalized_path = cached->normalized_path;
+        is_game_data = cached->is_game_data;
+        is_savedata = cached->is_savedata;
+    } else {
+        const auto translated_path = translate_path(path, device, io.device_paths);
+        if (translated_path.empty()) {
+            LOG_ERROR("Cannot translate path: {}", path);
+            return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+        }
 
-    auto system_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
-    if (fs::is_directory(system_path)) {
-        LOG_ERROR("Cannot open directory: {}", system_path.string(), path);
-        return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
-    }
+        system_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+        if (fs::is_directory(system_path)) {
+            LOG_ERROR("Cannot open directory: {}", system_path.string(), path);
+            return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+        }
 
-    // Do not allow any new files if they do not have a write flag.
-    if (!fs::exists(system_path)) {
-        if (!(flags & SCE_O_CREAT)) {
-            if (io.case_isens_find_enabled) {
-                // Attempt a case-insensitive file search.
-                const auto original_system_path = system_path;
-                const auto cached_path = find_in_cache(io, string_utils::tolower(system_path.string()));
-                if (!cached_path.empty()) {
-                    system_path = cached_path;
-                    LOG_TRACE("Found cached filepath at {}", system_path.string());
-                } else {
-                    const bool path_found = find_case_isens_path(io, device_for_icase, translated_path, system_path);
-                    system_path = find_in_cache(io, string_utils::tolower(system_path.string()));
-                    if (!system_path.empty() && path_found) {
-                        LOG_TRACE("Found file on case-sensitive filesystem at {}", system_path.string());
+        // Do not allow any new files if they do not have a write flag.
+        if (!fs::exists(system_path)) {
+            if (!(flags & SCE_O_CREAT)) {
+                if (io.case_isens_find_enabled) {
+                    // Attempt a case-insensitive file search.
+                    const auto original_system_path = system_path;
+                    const auto cached_path = find_in_cache(io, string_utils::tolower(system_path.string()));
+                    if (!cached_path.empty()) {
+                        system_path = cached_path;
+                        LOG_TRACE("Found cached filepath at {}", system_path.string());
                     } else {
-                        LOG_ERROR("Missing file at {} (target path: {})", original_system_path.string(), path);
-                        return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+                        const bool path_found = find_case_isens_path(io, device_for_icase, translated_path, system_path);
+                        system_path = find_in_cache(io, string_utils::tolower(system_path.string()));
+                        if (!system_path.empty() && path_found) {
+                            LOG_TRACE("Found file on case-sensitive filesystem at {}", system_path.string());
+                        } else {
+                            LOG_ERROR("Missing file at {} (target path: {})", original_system_path.string(), path);
+                            return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+                        }
                     }
+                } else {
+                    LOG_ERROR("Missing file at {} (target path: {})", system_path.string(), path);
+                    return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
                 }
             } else {
-                LOG_ERROR("Missing file at {} (target path: {})", system_path.string(), path);
-                return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
-            }
-        } else {
-            if (!fs::exists(system_path.parent_path())) {
-                fs::create_directories(system_path.parent_path());
+                if (!fs::exists(system_path.parent_path())) {
+                    fs::create_directories(system_path.parent_path());
+                }
+                std::ofstream file(system_path.string());
+                invalidate_cached_path(io, system_path.parent_path());
             }
-            std::ofstream file(system_path.string());
         }
-    }
 
-    const auto normalized_path = device::construct_normalized_path(device, translated_path);
+        normalized_path = device::construct_normalized_path(device, translated_path);
+
+        // game data can not be modified, map it to save the copy through the FILE buffer
+        // translate_path redirects these devices to ux0
+        is_game_data = (device_for_icase == VitaIoDevice::app0 || device_for_icase == VitaIoDevice::addcont0);
+        // savedata writes are buffered until the file is closed or synced
+        is_savedata = (device_for_icase == VitaIoDevice::savedata0 || device_for_icase == VitaIoDevice::savedata1);
+
+        PathCacheInfo info;
+        info.guest_path = path;
+        info.system_path = system_path;
+        info.normalized_path = normalized_path;
+        info.is_game_data = is_game_data;
+        info.is_savedata = is_savedata;
+        cache_path(io, info);
+    }
+    if (flags & SCE_O_TRUNC)
+        invalidate_cached_path(io, system_path);
+    if (flags & SCE_O_WRONLY)
+        io.savedata_slots.changed(system_path);
 
-    FileStats f{ path, normalized_path, system_path, flags };
+    FileStats f{ path, normalized_path, system_path, flags, is_game_data, is_savedata };
     const auto fd = io.next_fd++;
     io.std_files.emplace(fd, f);
 
@@ -388,7 +673,22 @@ int read_file(void *data, IOState &io, const SceUID fd, const SceSize size, cons
     return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 }
 
-int write_file(SceUID fd, const void *data, const SceSize size, const IOState &io, const char *export_name) {
+int pread_file(void *data, IOState &io, const SceUID fd, const SceSize size, const SceOff offset, const char *export_name) {
+    assert(data != nullptr);
+
+    const auto file = io.std_files.find(fd);
+    if (file == io.std_files.end())
+        return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
+
+    const auto read = file->second.pread(data, size, offset);
+    if (read < 0)
+        return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
+
+    LOG_TRACE_IF(log_file_op && log_file_read, "{}: Reading {} bytes of fd {} at offset {}", export_name, read, log_hex(fd), log_hex(offset));
+    return static_cast<int>(read);
+}
+
+int write_file(SceUID fd, const void *data, const SceSize size, IOState &io, const char *export_name) {
     assert(data != nullptr);
     assert(size >= 0);
 
@@ -425,6 +725,7 @@ int write_file(SceUID fd, const void *data, const SceSize size, const IOState &i
     }
 
     if (file->second.can_write_file()) {
+        invalidate_cached_path(io, file->second.get_system_location());
         const auto written = file->second.write(data, 1, size);
         LOG_TRACE_IF(log_file_op, "{}: Writing to fd: {}, size: {}", export_name, log_hex(fd), size);
         return static_cast<int>(written);
@@ -433,13 +734,14 @@ int write_file(SceUID fd, const void *data, const SceSize size, const IOState &i
     return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 }
 
-int truncate_file(const SceUID fd, unsigned long long length, const IOState &io, const char *export_name) {
+int truncate_file(const SceUID fd, unsigned long long length, IOState &io, const char *export_name) {
     if (fd < 0)
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
 
     const auto file = io.std_files.find(fd);
     if (file == io.std_files.end())
         return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
+    invalidate_cached_path(io, file->second.get_system_location());
     auto trunc = file->second.truncate(length);
     LOG_TRACE_IF(log_file_op, "{}: Truncating fd: {}, to size: {}", export_name, log_hex(fd), length);
     return trunc;
@@ -492,41 +794,62 @@ int stat_file(IOState &io, const char *file, SceIoStat *statp, const std::wstrin
     memset(statp, '\0', sizeof(SceIoStat));
 
     fs::path file_path = "";
+    PathCacheInfo info;
+    SceOff buffered_size = -1;
     if (fd == invalid_fd) {
-        auto device = device::get_device(file);
-        auto device_for_icase = device;
-        if (device == VitaIoDevice::_INVALID) {
-            LOG_ERROR("Cannot find device for path: {}", file);
-            return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+        flush_deferred_write(io, file, pref_path);
+        const auto cached = find_cached_path(io, file);
+        if (cached && cached->has_stat) {
+            *statp = cached->stat;
+            LOG_TRACE_IF(log_file_op && log_file_stat, "{}: Statting cached file: {} ({})", export_name, file, cached->normalized_path);
+            return 0;
         }
 
-        const auto translated_path = translate_path(file, device, io.device_paths);
-        file_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
-
-        if (!fs::exists(file_path)) {
-            if (io.case_isens_find_enabled) {
-                // Attempt a case-insensitive file search.
-                const auto original_file_path = file_path;
-                const auto cached_path = find_in_cache(io, string_utils::tolower(file_path.string()));
-                if (!cached_path.empty()) {
-                    file_path = cached_path;
-                    LOG_TRACE("Found cached filepath at {}", file_path.string());
-                } else {
-                    const bool path_found = find_case_isens_path(io, device_for_icase, translated_path, file_path);
-                    file_path = find_in_cache(io, string_utils::tolower(file_path.string()));
-                    if (!file_path.empty() && path_found) {
-                        LOG_TRACE("Found file on case-sensitive filesystem at {}", file_path.string());
+        if (cached) {
+            info = *cached;
+            file_path = info.system_path;
+        } else {
+            auto device = device::get_device(file);
+            auto device_for_icase = device;
+            if (device == VitaIoDevice::_INVALID) {
+                LOG_ERROR("Cannot find device for path: {}", file);
+                return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+            }
+
+            const auto translated_path = translate_path(file, device, io.device_paths);
+            file_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+
+            if (!fs::exists(file_path)) {
+                if (io.case_isens_find_enabled) {
+                    // Attempt a case-insensitive file search.
+                    const auto original_file_path = file_path;
+                    const auto cached_path = find_in_cache(io, string_utils::tolower(file_path.string()));
+                    if (!cached_path.empty()) {
+                        file_path = cached_path;
+                        LOG_TRACE("Found cached filepath at {}", file_path.string());
                     } else {
-                        LOG_ERROR("Missing file at {} (target path: {})", original_file_path.string(), file);
-                        return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+                        const bool path_found = find_case_isens_path(io, device_for_icase, translated_path, file_path);
+                        file_path = find_in_cache(io, string_utils::tolower(file_path.string()));
+                        if (!file_path.empty() && path_found) {
+                            LOG_TRACE("Found file on case-sensitive filesystem at {}", file_path.string());
+                        } else {
+                            LOG_ERROR("Missing file at {} (target path: {})", original_file_path.string(), file);
+                            return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
+                        }
                     }
+                } else {
+                    LOG_ERROR("Missing file at {} (target path: {})", file_path.string(), file);
+                    return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
                 }
-            } else {
-                LOG_ERROR("Missing file at {} (target path: {})", file_path.string(), file);
-                return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
             }
+
+            info.guest_path = file;
+            info.system_path = file_path;
+            info.normalized_path = device::construct_normalized_path(device, translated_path);
+            info.is_game_data = (device_for_icase == VitaIoDevice::app0 || device_for_icase == VitaIoDevice::addcont0);
+            info.is_savedata = (device_for_icase == VitaIoDevice::savedata0 || device_for_icase == VitaIoDevice::savedata1);
+            LOG_TRACE_IF(log_file_op && log_file_stat, "{}: Statting file: {} ({})", export_name, file, info.normalized_path);
         }
-        LOG_TRACE_IF(log_file_op && log_file_stat, "{}: Statting file: {} ({})", export_name, file, device::construct_normalized_path(device, translated_path));
     } else { // We have previously opened and defined the location
         const auto fd_file = io.std_files.find(fd);
         if (fd_file == io.std_files.end())
@@ -536,6 +859,7 @@ int stat_file(IOState &io, const char *file, SceIoStat *statp, const std::wstrin
         LOG_TRACE_IF(log_file_op && log_file_stat, "{}: Statting fd: {}", export_name, log_hex(fd));
 
         statp->st_attr = fd_file->second.get_file_mode();
+        buffered_size = fd_file->second.get_buffered_size();
     }
 
     std::uint64_t last_access_time_ticks;
@@ -565,7 +889,8 @@ int stat_file(IOState &io, const char *file, SceIoStat *statp, const std::wstrin
     statp->st_mode = SCE_S_IRUSR | SCE_S_IRGRP | SCE_S_IROTH | SCE_S_IXUSR | SCE_S_IXGRP | SCE_S_IXOTH;
 
     if (fs::is_regular_file(file_path)) {
-        statp->st_size = fs::file_size(file_path);
+        // the host file is behind the writes not flushed yet
+        statp->st_size = buffered_size >= 0 ? buffered_size : fs::file_size(file_path);
         statp->st_attr = SCE_SO_IFREG;
         statp->st_mode |= SCE_S_IFREG;
     }
@@ -578,6 +903,13 @@ int stat_file(IOState &io, const char *file, SceIoStat *statp, const std::wstrin
     __RtcTicksToPspTime(&statp->st_mtime, last_modification_time_ticks);
     __RtcTicksToPspTime(&statp->st_ctime, creation_time_ticks);
 
+    if (!info.guest_path.empty()) {
+        info.is_directory = statp->st_attr == SCE_SO_IFDIR;
+        info.has_stat = true;
+        info.stat = *statp;
+        cache_path(io, info);
+    }
+
     return 0;
 }
 
@@ -600,11 +932,42 @@ int close_file(IOState &io, const SceUID fd, const char *export_name) {
     LOG_TRACE_IF(log_file_op, "{}: Closing file fd: {}", export_name, log_hex(fd));
 
     io.tty_files.erase(fd);
-    io.std_files.erase(fd);
+    const auto file = io.std_files.find(fd);
+    if (file != io.std_files.end()) {
+        file->second.flush();
+        invalidate_cached_path(io, file->second.get_system_location());
+        io.std_files.erase(file);
+    }
+
+    return 0;
+}
+
+int sync_file(IOState &io, const SceUID fd, const char *export_name) {
+    const auto file = io.std_files.find(fd);
+    if (file == io.std_files.end())
+        return IO_ERROR(SCE_ERROR_ERRNO_EBADFD);
+
+    LOG_TRACE_IF(log_file_op, "{}: Syncing file fd: {}", export_name, log_hex(fd));
+    invalidate_cached_path(io, file->second.get_system_location());
+    if (!file->second.flush())
+        return IO_ERROR(SCE_ERROR_ERRNO_EIO);
 
     return 0;
 }
 
+int sync_device(IOState &io, const char *device, const char *export_name) {
+    LOG_TRACE_IF(log_file_op, "{}: Syncing device {}", export_name, device ? device : "");
+
+    // the files of every device are synced, they are few to be buffered
+    bool success = true;
+    for (auto &[fd, file] : io.std_files) {
+        invalidate_cached_path(io, file.get_system_location());
+        success &= file.flush();
+    }
+
+    return success ? 0 : IO_ERROR(SCE_ERROR_ERRNO_EIO);
+}
+
 int remove_file(IOState &io, const char *file, const std::wstring &pref_path, const char *export_name) {
     auto device = device::get_device(file);
     if (device == VitaIoDevice::_INVALID) {
@@ -619,6 +982,8 @@ int remove_file(IOState &io, const char *file, const std::wstring &pref_path, co
     }
 
     const auto emulated_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+    // a file only queued for writing does not exist yet
+    io.deferred_writes.flush(emulated_path.string());
     if (!fs::exists(emulated_path) || fs::is_directory(emulated_path)) {
         LOG_ERROR("File does not exist at path: {} (target path: {})", emulated_path.string(), file);
     }
@@ -627,6 +992,8 @@ int remove_file(IOState &io, const char *file, const std::wstring &pref_path, co
 
     boost::system::error_code error_code{};
     auto res = fs::detail::remove(emulated_path, &error_code);
+    invalidate_cached_path(io, {});
+    io.savedata_slots.removed(emulated_path);
 
     if (!(res && !(error_code.value()))) {
         LOG_ERROR("Cannot remove file: {} ({})", file, device::construct_normalized_path(device, translated_path));
@@ -657,17 +1024,23 @@ int rename(IOState &io, const char *old_name, const char *new_name, const std::w
     }
 
     const auto emulated_old_path = device::construct_emulated_path(device, translated_old_path, pref_path, io.redirect_stdio);
+    io.deferred_writes.flush(emulated_old_path.string());
     if (!fs::exists(emulated_old_path)) {
         LOG_ERROR("File does not exist at path: {} (target path: {})", emulated_old_path.string(), old_name);
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
 
     const auto emulated_new_path = device::construct_emulated_path(device, translated_new_path, pref_path, io.redirect_stdio);
+    io.deferred_writes.flush(emulated_new_path.string());
 
     LOG_TRACE_IF(log_file_op, "{}: Renaming file {} to {} ({} to {})", export_name, old_name, new_name, emulated_old_path.string(), emulated_new_path.string());
 
     boost::system::error_code error_code{};
     fs::rename(emulated_old_path, emulated_new_path, error_code);
+    invalidate_cached_path(io, {});
+    io.savedata_slots.removed(emulated_old_path);
+    io.savedata_slots.removed(emulated_new_path);
+    io.savedata_slots.changed(emulated_new_path);
 
     if (error_code.value()) {
         LOG_ERROR("Cannot rename file: {} to {} ({} to {})", old_name, new_name, emulated_old_path.string(), emulated_new_path.string());
@@ -679,6 +1052,9 @@ int rename(IOState &io, const char *old_name, const char *new_name, const std::w
 }
 
 SceUID open_dir(IOState &io, const char *path, const std::wstring &pref_path, const char *export_name) {
+    // the files only queued for writing would be missing from the listing
+    io.deferred_writes.flush_all();
+
     auto device = device::get_device(path);
     auto device_for_icase = device;
     const auto translated_path = translate_path(path, device, io.device_paths);
@@ -806,6 +1182,8 @@ int create_dir(IOState &io, const char *dir, int mode, const std::wstring &pref_
     }
 
     const auto emulated_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+    // the modification time of the parent directories changes
+    invalidate_cached_path(io, {});
     if (recursive)
         return fs::create_directories(emulated_path);
     if (fs::exists(emulated_path))
@@ -854,7 +1232,11 @@ int remove_dir(IOState &io, const char *dir, const std::wstring &pref_path, cons
 
     LOG_TRACE_IF(log_file_op, "{}: Removing dir {} ({})", export_name, dir, device::construct_normalized_path(device, translated_path));
 
-    if (!fs::remove_all(device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio))) {
+    invalidate_cached_path(io, {});
+
+    const auto emulated_path = device::construct_emulated_path(device, translated_path, pref_path, io.redirect_stdio);
+    io.savedata_slots.removed(emulated_path);
+    if (!fs::remove_all(emulated_path)) {
         LOG_ERROR("Cannot remove dir: {} ({})", dir, device::construct_normalized_path(device, translated_path));
         return IO_ERROR(SCE_ERROR_ERRNO_ENOENT);
     }
@@ -890,13 +1272,37 @@ SceUID create_overlay(IOState &io, SceFiosProcessOverlay *fios_overlay) {
         overlay_index++;
 
     io.overlays.insert(io.overlays.begin() + overlay_index, std::move(overlay));
+    io.overlay_resolutions.clear();
 
     return overlay.id;
 }
 
+bool remove_overlay(IOState &io, SceUID overlay_id) {
+    std::lock_guard<std::mutex> lock(io.overlay_mutex);
+
+    const auto overlay = std::find_if(io.overlays.begin(), io.overlays.end(), [&](const FiosOverlay &overlay) { return overlay.id == overlay_id; });
+    if (overlay == io.overlays.end())
+        return false;
+
+    io.overlays.erase(overlay);
+    io.overlay_resolutions.clear();
+    return true;
+}
+
+// games resolve the same few paths over and over, drop everything if they do not
+constexpr size_t MAX_OVERLAY_RESOLUTIONS = 4096;
+
 std::string resolve_path(IOState &io, const char *input, const bool is_write, const SceUInt32 min_order, const SceUInt32 max_order) {
     std::lock_guard<std::mutex> lock(io.overlay_mutex);
 
+    if (io.overlays.empty())
+        return input;
+
+    auto key = std::make_tuple(std::string(input), min_order, max_order);
+    const auto cached = io.overlay_resolutions.find(key);
+    if (cached != io.overlay_resolutions.end())
+        return cached->second;
+
     std::string curr_path = input;
 
     size_t overlay_idx = 0;
@@ -917,5 +1323,9 @@ std::string resolve_path(IOState &io, const char *input, const bool is_write, co
         curr_path = overlay.src + curr_path.substr(overlay.dst.size());
     }
 
+    if (io.overlay_resolutions.size() >= MAX_OVERLAY_RESOLUTIONS)
+        io.overlay_resolutions.clear();
+    io.overlay_resolutions.emplace(std::move(key), curr_path);
+
     return curr_path;
 }
@@ -0,0 +1,132 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <io/psarc.h>
+
+#include <util/log.h>
+
+#include <miniz.h>
+
+#include <cstring>
+
+// all the fields of a PSARC archive are big endian, some of them 40 bits long
+static uint64_t read_be(const uint8_t *data, const int size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+constexpr size_t PSARC_HEADER_SIZE = 32;
+constexpr uint32_t PSARC_FLAG_ENCRYPTED_TOC = 4;
+
+bool PsarcArchive::open(const fs::path &path) {
+    if (!file.open(path) || file.size() < PSARC_HEADER_SIZE)
+        return false;
+
+    const uint8_t *header = file.data();
+    if (memcmp(header, "PSAR", 4) != 0)
+        return false;
+    if (memcmp(header + 8, "zlib", 4) != 0) {
+        LOG_ERROR("Unsupported PSARC compression {}", std::string(reinterpret_cast<const char *>(header + 8), 4));
+        return false;
+    }
+
+    toc_size = static_cast<uint32_t>(read_be(header + 12, 4));
+    const uint32_t toc_entry_size = static_cast<uint32_t>(read_be(header + 16, 4));
+    const uint32_t nb_entries = static_cast<uint32_t>(read_be(header + 20, 4));
+    block_size = static_cast<uint32_t>(read_be(header + 24, 4));
+    const uint32_t flags = static_cast<uint32_t>(read_be(header + 28, 4));
+    if (flags & PSARC_FLAG_ENCRYPTED_TOC) {
+        LOG_ERROR("PSARC archives with an encrypted toc are not supported");
+        return false;
+    }
+
+    const uint64_t entries_end = PSARC_HEADER_SIZE + static_cast<uint64_t>(nb_entries) * toc_entry_size;
+    if (nb_entries == 0 || toc_entry_size < 30 || block_size == 0 || toc_size > file.size() || entries_end > toc_size)
+        return false;
+
+    // entry sizes are stored with the least number of bytes that can hold block_size
+    const int block_size_bytes = block_size <= 0x10000 ? 2 : (block_size <= 0x1000000 ? 3 : 4);
+    const uint8_t *block_table = file.data() + entries_end;
+    block_sizes.resize((toc_size - entries_end) / block_size_bytes);
+    for (size_t i = 0; i < block_sizes.size(); i++)
+        block_sizes[i] = static_cast<uint32_t>(read_be(block_table + i * block_size_bytes, block_size_bytes));
+
+    entries.resize(nb_entries);
+    for (uint32_t i = 0; i < nb_entries; i++) {
+        const uint8_t *toc_entry = file.data() + PSARC_HEADER_SIZE + i * toc_entry_size;
+        // skip the md5 of the name
+        entries[i].block_index = static_cast<uint32_t>(read_be(toc_entry + 16, 4));
+        entries[i].size = read_be(toc_entry + 20, 5);
+        entries[i].offset = read_be(toc_entry + 25, 5);
+    }
+
+    // the first entry is the manifest, with the name of all the other entries in order
+    std::vector<uint8_t> manifest;
+    if (!read_entry(entries[0], manifest))
+        return false;
+    entries.erase(entries.begin());
+
+    size_t name_start = 0;
+    for (PsarcEntry &entry : entries) {
+        size_t name_end = name_start;
+        while (name_end < manifest.size() && manifest[name_end] != '\n')
+            name_end++;
+        std::string name(reinterpret_cast<const char *>(manifest.data()) + name_start, name_end - name_start);
+        if (name.starts_with('/'))
+            name.erase(0, 1);
+        entry.name = std::move(name);
+        name_start = name_end + 1;
+    }
+
+    return true;
+}
+
+bool PsarcArchive::read_entry(const PsarcEntry &entry, std::vector<uint8_t> &data) const {
+    data.resize(entry.size);
+
+    uint64_t offset = entry.offset;
+    uint64_t written = 0;
+    for (uint32_t block = entry.block_index; written < entry.size; block++) {
+        if (block >= block_sizes.size())
+            return false;
+
+        const uint64_t uncompressed_size = std::min<uint64_t>(block_size, entry.size - written);
+        const uint64_t compressed_size = block_sizes[block] == 0 ? block_size : block_sizes[block];
+        if (offset + compressed_size > file.size())
+            return false;
+
+        const uint8_t *src = file.data() + offset;
+        // blocks which do not get smaller are stored without the zlib header
+        const bool is_compressed = compressed_size != uncompressed_size && compressed_size >= 2 && src[0] == 0x78 && src[1] == 0xDA;
+        if (is_compressed) {
+            mz_ulong dest_bytes = static_cast<mz_ulong>(uncompressed_size);
+            if (mz_uncompress(data.data() + written, &dest_bytes, src, static_cast<mz_ulong>(compressed_size)) != MZ_OK || dest_bytes != uncompressed_size)
+                return false;
+        } else {
+            if (compressed_size < uncompressed_size)
+                return false;
+            memcpy(data.data() + written, src, uncompressed_size);
+        }
+
+        offset += compressed_size;
+        written += uncompressed_size;
+    }
+
+    return true;
+}
@@ -0,0 +1,95 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <io/savedata_slot_index.h>
+
+#include <iterator>
+
+bool SaveDataSlotIndex::listed(const fs::path &directory) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return directories.contains(directory.string());
+}
+
+bool SaveDataSlotIndex::read(const fs::path &host_path, std::vector<uint8_t> &data) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const fs::path directory = host_path.parent_path();
+    auto dir_it = directories.find(directory.string());
+    if (dir_it == directories.end()) {
+        // one listing tells which slots don't exist without looking for each of them
+        std::map<std::string, SaveDataSlotFile> files;
+        boost::system::error_code error;
+        for (fs::directory_iterator it(directory, error), end; !error && (it != end); it.increment(error)) {
+            if (fs::is_regular_file(it->status()))
+                files.emplace(it->path().filename().string(), SaveDataSlotFile{});
+        }
+        dir_it = directories.emplace(directory.string(), std::move(files)).first;
+    }
+
+    const auto file_it = dir_it->second.find(host_path.filename().string());
+    if (file_it == dir_it->second.end())
+        return false;
+    SaveDataSlotFile &file = file_it->second;
+    if (!file.loaded) {
+        fs::ifstream stream(host_path, std::ios::in | std::ios::binary);
+        if (!stream.is_open() || !fs::is_regular_file(host_path)) {
+            dir_it->second.erase(file_it);
+            return false;
+        }
+        file.data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        file.loaded = true;
+    }
+
+    data = file.data;
+    return true;
+}
+
+void SaveDataSlotIndex::update(const fs::path &host_path, const std::vector<uint8_t> &data) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto dir_it = directories.find(host_path.parent_path().string());
+    if (dir_it != directories.end())
+        dir_it->second[host_path.filename().string()] = SaveDataSlotFile{ true, data };
+}
+
+void SaveDataSlotIndex::changed(const fs::path &host_path) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto dir_it = directories.find(host_path.parent_path().string());
+    if (dir_it != directories.end())
+        dir_it->second[host_path.filename().string()] = SaveDataSlotFile{};
+}
+
+void SaveDataSlotIndex::removed(const fs::path &host_path) {
+    std::string path = host_path.string();
+    while (!path.empty() && ((path.back() == '/') || (path.back() == '\\')))
+        path.pop_back();
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto dir_it = directories.find(fs::path(path).parent_path().string());
+    if (dir_it != directories.end())
+        dir_it->second.erase(fs::path(path).filename().string());
+
+    // the listings of the directory and of the directories inside it
+    for (auto it = directories.lower_bound(path); (it != directories.end()) && it->first.starts_with(path);) {
+        const bool inside = (it->first.size() == path.size()) || (it->first[path.size()] == '/') || (it->first[path.size()] == '\\');
+        it = inside ? directories.erase(it) : std::next(it);
+    }
+}
+
+void SaveDataSlotIndex::clear() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    directories.clear();
+}
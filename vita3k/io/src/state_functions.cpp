@@ -19,6 +19,7 @@
 #include <io.h>
 #else
 #define _FILE_OFFSET_BITS 64
+#include <fcntl.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -26,21 +27,147 @@
 
 #include <io/state.h>
 
+#include <util/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+WriteBackBuffer::~WriteBackBuffer() {
+    flush();
+    TRACK_HOST_FREE(this);
+}
+
+bool WriteBackBuffer::flush() {
+    if (!dirty)
+        return true;
+
+    // write the whole content next to the file and swap them, the rename replaces the old file atomically
+    fs::path temp_path = path;
+    temp_path += ".tmp";
+    {
+        fs::ofstream out{ temp_path, fs::ofstream::binary | fs::ofstream::trunc };
+        out.write(reinterpret_cast<const char *>(data.data()), data.size());
+        if (!out) {
+            LOG_ERROR("Failed to write savedata file {}", temp_path.string());
+            return false;
+        }
+    }
+
+    boost::system::error_code error;
+    fs::rename(temp_path, path, error);
+    if (error) {
+        LOG_ERROR("Failed to replace savedata file {}: {}", path.string(), error.message());
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+// a stream is considered sequential after this many reads starting where the previous one ended
+static constexpr uint32_t SEQUENTIAL_READ_THRESHOLD = 2;
+static constexpr SceOff READ_AHEAD_WINDOW = 512 * 1024;
+
+void FileStats::track_read(const SceOff offset, const SceOff size) const {
+    if (offset == next_read_offset) {
+        sequential_reads++;
+    } else {
+        sequential_reads = 0;
+        prefetched_end = 0;
+    }
+    next_read_offset = offset + size;
+
+    // prefetch the next window once half of the previous one has been consumed
+    if (sequential_reads < SEQUENTIAL_READ_THRESHOLD || next_read_offset + READ_AHEAD_WINDOW / 2 < prefetched_end)
+        return;
+
+    const SceOff start = std::max(prefetched_end, next_read_offset);
+    prefetched_end = next_read_offset + READ_AHEAD_WINDOW;
+    if (mapped_file) {
+        mapped_file->prefetch(start, prefetched_end - start);
+    } else {
+#ifdef __linux__
+        posix_fadvise(fileno(wrapped_file.get()), start, prefetched_end - start, POSIX_FADV_WILLNEED);
+#endif
+    }
+}
+
 SceOff FileStats::read(void *input_data, const int element_size, const SceSize element_count) const {
+    if (mapped_file || write_buffer) {
+        const SceOff read_count = pread(input_data, element_size * element_count, position) / element_size;
+        position += read_count * element_size;
+        return read_count;
+    }
+
     if (!wrapped_file)
         return -1;
 
-    return fread(input_data, element_size, element_count, wrapped_file.get());
+    const SceOff offset = tell();
+    const SceOff read_count = fread(input_data, element_size, element_count, wrapped_file.get());
+    track_read(offset, read_count * element_size);
+    return read_count;
+}
+
+SceOff FileStats::pread(void *data, const SceSize size, const SceOff offset) const {
+    if (mapped_file) {
+        const SceOff file_size = static_cast<SceOff>(mapped_file->size());
+        if (offset >= file_size)
+            return 0;
+
+        const SceOff read_size = std::min<SceOff>(size, file_size - offset);
+        track_read(offset, read_size);
+        memcpy(data, mapped_file->data() + offset, read_size);
+        return read_size;
+    }
+
+    if (write_buffer) {
+        const SceOff file_size = static_cast<SceOff>(write_buffer->data.size());
+        if (offset >= file_size)
+            return 0;
+
+        const SceOff read_size = std::min<SceOff>(size, file_size - offset);
+        memcpy(data, write_buffer->data.data() + offset, read_size);
+        return read_size;
+    }
+
+    const SceOff pos = tell();
+    if (pos < 0 || !seek(offset, SCE_SEEK_SET))
+        return -1;
+    const SceOff read_size = read(data, 1, size);
+    seek(pos, SCE_SEEK_SET);
+    return read_size;
 }
 
 SceOff FileStats::write(const void *data, const SceSize size, const int count) const {
     if (!can_write_file())
         return -1;
 
+    if (write_buffer) {
+        if (file_info.open_mode & SCE_O_APPEND)
+            position = static_cast<SceOff>(write_buffer->data.size());
+
+        const SceOff write_size = static_cast<SceOff>(size) * count;
+        if (position + write_size > static_cast<SceOff>(write_buffer->data.size())) {
+            write_buffer->data.resize(position + write_size);
+            TRACK_HOST_ALLOC(IoCache, write_buffer.get(), write_buffer->data.capacity());
+        }
+        memcpy(write_buffer->data.data() + position, data, write_size);
+        position += write_size;
+        write_buffer->dirty = true;
+        return count;
+    }
+
     return fwrite(data, size, count, get_file_pointer());
 }
 
 int FileStats::truncate(const SceSize size) const {
+    if (write_buffer) {
+        write_buffer->data.resize(size);
+        write_buffer->dirty = true;
+        TRACK_HOST_ALLOC(IoCache, write_buffer.get(), write_buffer->data.capacity());
+        return 0;
+    }
+
 #ifdef _WIN32
     return _chsize_s(_fileno(get_file_pointer()), size);
 #else
@@ -49,6 +176,28 @@ int FileStats::truncate(const SceSize size) const {
 }
 
 bool FileStats::seek(const SceOff offset, const SceIoSeekMode seek_mode) const {
+    if (mapped_file || write_buffer) {
+        SceOff new_position;
+        switch (seek_mode) {
+        case SCE_SEEK_SET:
+            new_position = offset;
+            break;
+        case SCE_SEEK_CUR:
+            new_position = position + offset;
+            break;
+        case SCE_SEEK_END:
+            new_position = static_cast<SceOff>(mapped_file ? mapped_file->size() : write_buffer->data.size()) + offset;
+            break;
+        default:
+            return false;
+        }
+        if (new_position < 0)
+            return false;
+
+        position = new_position;
+        return true;
+    }
+
     if (!wrapped_file)
         return false;
 
@@ -75,6 +224,9 @@ bool FileStats::seek(const SceOff offset, const SceIoSeekMode seek_mode) const {
 }
 
 SceOff FileStats::tell() const {
+    if (mapped_file || write_buffer)
+        return position;
+
     if (!wrapped_file)
         return -1;
 
@@ -84,3 +236,15 @@ SceOff FileStats::tell() const {
     return ftello(wrapped_file.get());
 #endif
 }
+
+bool FileStats::flush() const {
+    if (write_buffer)
+        return write_buffer->flush();
+    if (wrapped_file)
+        return fflush(wrapped_file.get()) == 0;
+    return true;
+}
+
+SceOff FileStats::get_buffered_size() const {
+    return write_buffer ? static_cast<SceOff>(write_buffer->data.size()) : -1;
+}
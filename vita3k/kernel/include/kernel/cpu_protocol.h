@@ -22,16 +22,22 @@
 struct KernelState;
 
 typedef std::function<void(CPUState &cpu, uint32_t nid, SceUID thread_id)> CallImportFunc;
+// With nonblocking_only, the import is only called if it can run while the cpu is running, returns whether it was called
+typedef std::function<bool(CPUState &cpu, uint32_t import_index, SceUID thread_id, bool nonblocking_only)> CallHleImportFunc;
 
 struct CPUProtocol : public CPUProtocolBase {
-    CPUProtocol(KernelState &kernel, MemState &mem, const CallImportFunc &func);
+    CPUProtocol(KernelState &kernel, MemState &mem, const CallImportFunc &func, const CallHleImportFunc &hle_func);
     ~CPUProtocol() override = default;
     void call_svc(CPUState &cpu, uint32_t svc, Address pc, ThreadState &thread) override;
+    bool call_svc_in_run_loop(CPUState &cpu, uint32_t svc) override;
     Address get_watch_memory_addr(Address addr) override;
     ExclusiveMonitorPtr get_exlusive_monitor() override;
+    JitCache *get_jit_cache() override;
+    BreakpointTable *get_breakpoint_table() override;
 
 private:
     CallImportFunc call_import;
+    CallHleImportFunc call_hle_import;
     KernelState *kernel;
     MemState *mem;
 };
@@ -16,7 +16,10 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #pragma once
+#include <cpu/breakpoint_table.h>
 #include <cpu/state.h>
+
+#include <atomic>
 #include <map>
 #include <mem/state.h>
 #include <mem/util.h>
@@ -46,6 +49,8 @@ struct Breakpoint {
 struct WatchMemory {
     Address start;
     size_t size;
+    // whether the pages of the watch are write protected, a write releases them until rearm_watches
+    bool armed;
 };
 
 typedef std::map<Address, WatchMemory> WatchMemoryAddrs;
@@ -65,9 +70,13 @@ struct Debugger {
     bool log_exports = false;
     bool dump_elfs = false;
 
-    void add_watch_memory_addr(Address addr, size_t size);
-    void remove_watch_memory_addr(KernelState &state, Address addr);
-    void add_breakpoint(MemState &mem, uint32_t addr, bool thumb_mode);
+    // Writes to the range are logged, only its pages are write protected so the rest of the memory stays fast
+    void add_watch_memory_addr(MemState &mem, Address addr, size_t size);
+    void remove_watch_memory_addr(MemState &mem, Address addr);
+    // Write protects again the pages of the watches written since the last call
+    void rearm_watches(MemState &mem);
+    // With dynarmic the breakpoints are only in the breakpoint table, unicorn still needs them patched in the guest code
+    void add_breakpoint(MemState &mem, uint32_t addr, bool thumb_mode, BreakpointCondition condition = nullptr);
     void remove_breakpoint(MemState &mem, uint32_t addr);
     void add_trampoile(MemState &mem, uint32_t addr, bool thumb_mode, TrampolineCallback callback);
     Trampoline *get_trampoline(Address addr);
@@ -75,7 +84,13 @@ struct Debugger {
     Address get_watch_memory_addr(Address addr);
     void update_watches();
 
+    std::atomic<bool> watches_released = false;
+    BreakpointTable breakpoint_table;
+
 private:
+    bool handle_watch_write(Address start, Address addr);
+    void arm_watch(MemState &mem, const WatchMemory &watch);
+
     std::mutex mutex;
     KernelState &parent;
     WatchMemoryAddrs watch_memory_addrs;
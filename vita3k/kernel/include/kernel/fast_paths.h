@@ -0,0 +1,46 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <mem/util.h>
+
+#include <cstdint>
+#include <string>
+
+struct CPUState;
+struct KernelState;
+struct MemState;
+
+constexpr uint32_t HOST_FAST_PATH_SVC = 0x55;
+
+typedef void (*HostFastPathFn)(CPUState &cpu, MemState &mem);
+
+/**
+ * \brief Look for guest copies of common libc routines in a text segment and redirect them to the host.
+ *
+ * Every function recognized is patched with a `svc HOST_FAST_PATH_SVC; bx lr` stub, the svc handler then runs
+ * the host implementation on the guest arguments.
+ * \return Number of functions redirected
+ */
+size_t install_host_fast_paths(KernelState &kernel, MemState &mem, Address text_addr, uint32_t text_size, const std::string &module_name);
+
+/**
+ * \param svc_pc Address of the svc instruction of the stub
+ * \return False if there is no fast path installed at this address
+ */
+bool call_host_fast_path(KernelState &kernel, CPUState &cpu, MemState &mem, Address svc_pc);
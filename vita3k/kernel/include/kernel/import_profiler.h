@@ -0,0 +1,57 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/fs.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+struct ImportProfileEntry {
+    uint32_t nid = 0;
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+using ImportProfileClock = std::chrono::steady_clock;
+
+extern std::atomic<bool> import_profiling_enabled;
+
+inline bool is_import_profiling() {
+    return import_profiling_enabled.load(std::memory_order_relaxed);
+}
+
+void set_import_profiling(bool enabled);
+
+/**
+ * \brief Count a call to an HLE import and the host time spent in it.
+ *
+ * The counters are kept by the calling host thread and only merged with the shared ones every few
+ * milliseconds and when the thread exits, so recording does not contend between guest threads.
+ */
+void record_import_call(uint32_t nid, ImportProfileClock::duration duration);
+
+/// Merged counters of every import called so far, in no particular order
+std::vector<ImportProfileEntry> get_import_profile();
+void reset_import_profile();
+
+/// Writes the counters as csv, sorted by total time. Does nothing if no import was recorded
+bool dump_import_profile(const fs::path &path);
@@ -19,7 +19,9 @@
 
 #include <util/types.h>
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 struct Config;
 struct KernelState;
@@ -27,4 +29,15 @@ struct MemState;
 template <class T>
 class Ptr;
 
-SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std::string &self_path, const std::string &dump_path);
+/**
+ * \param image_path Host file holding the same bytes as self if there is one, its uncompressed
+ * read-only segments are then mapped in guest memory instead of being copied
+ * \return Negative on failure
+ */
+SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std::string &self_path, const std::string &dump_path, const std::string &image_path = "");
+
+/**
+ * \brief Build a copy of a SELF where every compressed segment is stored inflated, so load_self can copy it as-is.
+ * \return False if the SELF is not in a format load_self supports
+ */
+bool inflate_self(const void *self, size_t self_size, std::vector<uint8_t> &inflated);
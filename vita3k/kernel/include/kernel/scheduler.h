@@ -0,0 +1,57 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <utility>
+
+/**
+ * \brief Optional run queue limiting how many guest threads execute guest code at the same time.
+ *
+ * When enabled, a thread must own one of the emulated core slots while its cpu is running. Threads
+ * waiting for a slot are served by guest priority (lower value first), then in arrival order. Slots
+ * are given back whenever the cpu stops, which happens at least on every syscall, so a thread spinning
+ * in guest code without calling into the kernel is not preempted.
+ */
+class GuestScheduler {
+public:
+    /**
+     * \param slot_count Number of guest threads allowed to run at once, 0 disables the scheduler
+     */
+    void set_slot_count(uint32_t slot_count);
+
+    bool is_enabled() const {
+        return slot_count > 0;
+    }
+
+    // Blocks until the calling thread may run guest code
+    void acquire(int priority);
+    void release();
+
+private:
+    std::mutex mutex;
+    std::condition_variable slot_freed;
+    uint32_t slot_count = 0;
+    uint32_t running = 0;
+    uint64_t next_ticket = 0;
+    // (priority, ticket) of every thread waiting for a slot, begin() is the next one to run
+    std::set<std::pair<int, uint64_t>> waiting;
+};
@@ -18,18 +18,25 @@
 #pragma once
 
 #include <cpu/functions.h>
+#include <cpu/jit_cache.h>
+#include <cpu/profiler.h>
 #include <kernel/callback.h>
 #include <kernel/cpu_protocol.h>
 #include <kernel/debugger.h>
+#include <kernel/fast_paths.h>
+#include <kernel/scheduler.h>
 #include <kernel/sync_primitives.h>
+#include <kernel/timer_wheel.h>
 #include <kernel/types.h>
 #include <mem/allocator.h>
 #include <mem/ptr.h>
+#include <mem/slab_heap.h>
 #include <mem/util.h>
 #include <rtc/rtc.h>
 #include <util/containers.h>
 #include <util/pool.h>
 
+#include <array>
 #include <atomic>
 #include <kernel/object_store.h>
 #include <map>
@@ -59,7 +66,7 @@ typedef std::map<SceUID, ThreadStatePtr> ThreadStatePtrs;
 typedef std::shared_ptr<SDL_Thread> ThreadPtr;
 typedef std::map<SceUID, ThreadPtr> ThreadPtrs;
 typedef std::map<SceUID, SceKernelModuleInfoPtr> SceKernelModuleInfoPtrs;
-typedef std::map<SceUID, CallbackPtr> CallbackPtrs;
+typedef unordered_map_fast<SceUID, CallbackPtr> CallbackPtrs;
 typedef unordered_map_fast<uint32_t, Address> ExportNids;
 
 typedef std::map<Address, uint32_t> NotFoundVars;
@@ -93,6 +100,10 @@ typedef std::multimap<uint32_t, late_binding_info> VarLateBindingInfos;
 
 typedef std::map<uint32_t, uint32_t> ModuleUidByNid;
 
+// The svc immediate of a HLE import stub is HLE_IMPORT_SVC_BASE + the index of the import in KernelState::hle_import_nids
+constexpr uint32_t HLE_IMPORT_SVC_BASE = 0x100;
+constexpr uint32_t MAX_HLE_IMPORTS = 0x8000;
+
 struct KernelState {
     KernelState();
 
@@ -108,6 +119,9 @@ struct KernelState {
     Ptr<const void> thread_event_end = Ptr<const void>(0);
     Address thread_event_end_arg = 0;
 
+    // Guards the tables of the simple events, event flags and message pipes instead of the kernel mutex,
+    // they are looked up on every call so threads using different objects do not wait for each other
+    std::shared_mutex sync_objects_mutex;
     SimpleEventPtrs simple_events;
     TimerPtrs timers;
     SemaphorePtrs semaphores;
@@ -129,12 +143,35 @@ struct KernelState {
     std::mutex export_nids_mutex;
     VarLateBindingInfos late_binding_infos;
     ModuleUidByNid module_uid_by_nid;
+    // Incremented every time a function export is added, the HLE import fast path uses it to know when to look for an LLE export again
+    std::atomic<uint32_t> export_nids_generation = 0;
+
+    std::vector<uint32_t> hle_import_nids;
+    unordered_map_fast<uint32_t, uint32_t> hle_import_indices;
+
+    bool host_fast_paths_enabled = false;
+    std::unordered_map<Address, HostFastPathFn> host_fast_paths;
+    std::shared_mutex host_fast_paths_mutex;
+
+    // Heap of the HLE libc malloc when enabled for the app, the page allocator is used otherwise
+    std::unique_ptr<SlabHeap> slab_heap;
+
+    bool host_thread_mapping = false;
+    // Host cores backing each of the three guest user cores
+    std::array<std::vector<int>, 3> host_core_groups;
+    GuestScheduler scheduler;
+    // Wakes up the guest threads once their delay or wait timeout is over
+    TimerWheel timer_wheel;
 
     bool cpu_opt;
     CPUBackend cpu_backend;
     CorenumAllocator corenum_allocator;
     CPUProtocolPtr cpu_protocol;
+    bool scalable_exclusive_monitor = false;
     ExclusiveMonitorPtr exclusive_monitor;
+    JitCache jit_cache;
+    GuestProfiler guest_profiler;
+    fs::path guest_profile_path;
 
     ObjectStore obj_store;
 
@@ -148,8 +185,9 @@ struct KernelState {
         return next_uid++;
     }
 
-    bool init(MemState &mem, CallImportFunc call_import, CPUBackend cpu_backend, bool cpu_opt);
+    bool init(MemState &mem, CallImportFunc call_import, CallHleImportFunc call_hle_import, CPUBackend cpu_backend, bool cpu_opt);
     void load_process_param(MemState &mem, Ptr<uint32_t> ptr);
+    std::optional<uint32_t> bind_hle_import(uint32_t nid);
     ThreadStatePtr create_thread(MemState &mem, const char *name, Ptr<const void> entry_point = Ptr<const void>(0));
     ThreadStatePtr create_thread(MemState &mem, const char *name, Ptr<const void> entry_point, int init_priority, SceInt32 affinity_mask, int stack_size, const SceKernelThreadOptParam *option);
 
@@ -161,10 +199,23 @@ struct KernelState {
     void pause_threads();
     void resume_threads();
 
+    // Pauses the guest and writes its memory with the context of the threads stopped between two instructions
+    bool save_snapshot(MemState &mem, const fs::path &path);
+    // Restores a snapshot written during this boot of the app. Kernel objects and renderer resources
+    // are not part of the snapshot, threads waiting in host code keep their current state
+    bool load_snapshot(MemState &mem, const fs::path &path);
+
     void set_memory_watch(bool enabled);
     void invalidate_jit_cache(Address start, size_t length);
     std::shared_ptr<SceKernelModuleInfo> find_module_by_addr(Address address);
 
+    void start_guest_profiler(const fs::path &dump_path);
+    std::string resolve_guest_pc(Address pc);
+
+    void set_host_cpu_set(const std::string &cpu_set);
+    // Must be called from the host thread running the given guest thread
+    void apply_host_thread_mapping(const ThreadState &thread);
+
 private:
     std::atomic<SceUID> next_uid{ 1 };
     std::map<SceUID, ThreadStatus> paused_threads_status;
@@ -21,9 +21,19 @@
 #include <kernel/thread/thread_data_queue.h>
 #include <kernel/types.h>
 #include <util/byte_ring_buffer.h>
+#include <util/containers.h>
+
+#include <atomic>
 
 struct KernelState;
 
+// Buffer of a thread waiting on an empty message pipe, a sender can copy its message there directly
+struct MsgPipeDirectRecv {
+    void *buffer;
+    SceSize size;
+    SceSize received = 0;
+};
+
 struct WaitingThreadData {
     ThreadStatePtr thread;
     int32_t priority;
@@ -53,6 +63,7 @@ struct WaitingThreadData {
         // struct { }; // condvar
         struct { // msgpipe
             SceSize request_size;
+            MsgPipeDirectRecv *direct_recv;
         } mp;
     };
 
@@ -76,7 +87,7 @@ struct WaitingThreadData {
 typedef std::unique_ptr<ThreadDataQueue<WaitingThreadData>> WaitingThreadQueuePtr;
 
 // NOTE: uid is copied to sync primitives here for debugging,
-//       not really needed since they are put in std::map's
+//       not really needed since they are put in uid-keyed maps
 struct SyncPrimitive {
     SceUID uid;
 
@@ -92,6 +103,9 @@ struct SyncPrimitive {
 struct SimpleEvent : SyncPrimitive {
     WaitingThreadQueuePtr waiting_threads;
     SceUInt32 pattern;
+    // bits some waiting thread waits for, the waiting threads are only scanned when one of them is set.
+    // bits of threads which timed out are removed at the next scan
+    SceUInt32 waiting_pattern = 0;
     SceUInt64 last_user_data;
 
     bool auto_reset;
@@ -99,7 +113,7 @@ struct SimpleEvent : SyncPrimitive {
 };
 
 typedef std::shared_ptr<SimpleEvent> SimpleEventPtr;
-typedef std::map<SceUID, SimpleEventPtr> SimpleEventPtrs;
+typedef unordered_map_fast<SceUID, SimpleEventPtr> SimpleEventPtrs;
 
 struct Timer : SyncPrimitive {
     WaitingThreadQueuePtr waiting_threads;
@@ -115,7 +129,7 @@ struct Timer : SyncPrimitive {
 };
 
 typedef std::shared_ptr<Timer> TimerPtr;
-typedef std::map<SceUID, TimerPtr> TimerPtrs;
+typedef unordered_map_fast<SceUID, TimerPtr> TimerPtrs;
 
 struct Semaphore : SyncPrimitive {
     WaitingThreadQueuePtr waiting_threads;
@@ -125,18 +139,28 @@ struct Semaphore : SyncPrimitive {
 };
 
 typedef std::shared_ptr<Semaphore> SemaphorePtr;
-typedef std::map<SceUID, SemaphorePtr> SemaphorePtrs;
+typedef unordered_map_fast<SceUID, SemaphorePtr> SemaphorePtrs;
 
 struct Mutex : SyncPrimitive {
+    // owner_word holds the owner thread id in its low 32 bits and WAITERS_FLAG while threads
+    // are queued, so that an uncontended lock or unlock is a single compare-exchange
+    static constexpr uint64_t OWNER_MASK = 0xFFFFFFFF;
+    static constexpr uint64_t WAITERS_FLAG = 1ULL << 32;
+
     int init_count;
+    // only modified by the owner thread, or under mutex when ownership is handed over
     int lock_count;
-    ThreadStatePtr owner;
+    std::atomic<uint64_t> owner_word = 0;
     WaitingThreadQueuePtr waiting_threads;
     Ptr<SceKernelLwMutexWork> workarea;
+
+    SceUID owner_id() const {
+        return static_cast<SceUID>(owner_word.load(std::memory_order_acquire) & OWNER_MASK);
+    }
 };
 
 typedef std::shared_ptr<Mutex> MutexPtr;
-typedef std::map<SceUID, MutexPtr> MutexPtrs;
+typedef unordered_map_fast<SceUID, MutexPtr> MutexPtrs;
 
 enum class RWLockState {
     Unlocked,
@@ -154,15 +178,17 @@ struct RWLock : SyncPrimitive {
 };
 
 typedef std::shared_ptr<RWLock> RWLockPtr;
-typedef std::map<SceUID, RWLockPtr> RWLockPtrs;
+typedef unordered_map_fast<SceUID, RWLockPtr> RWLockPtrs;
 
 struct EventFlag : SyncPrimitive {
     WaitingThreadQueuePtr waiting_threads;
     int flags;
+    // same as SimpleEvent::waiting_pattern
+    SceUInt32 waiting_flags = 0;
 };
 
 typedef std::shared_ptr<EventFlag> EventFlagPtr;
-typedef std::map<SceUID, EventFlagPtr> EventFlagPtrs;
+typedef unordered_map_fast<SceUID, EventFlagPtr> EventFlagPtrs;
 
 struct Condvar : SyncPrimitive {
     struct SignalTarget {
@@ -186,7 +212,7 @@ struct Condvar : SyncPrimitive {
     MutexPtr associated_mutex;
 };
 typedef std::shared_ptr<Condvar> CondvarPtr;
-typedef std::map<SceUID, CondvarPtr> CondvarPtrs;
+typedef unordered_map_fast<SceUID, CondvarPtr> CondvarPtrs;
 
 struct MsgPipe : SyncPrimitive {
     MsgPipe(std::size_t bufSize)
@@ -201,7 +227,7 @@ struct MsgPipe : SyncPrimitive {
 };
 
 typedef std::shared_ptr<MsgPipe> MsgPipePtr;
-typedef std::map<SceUID, MsgPipePtr> MsgPipePtrs;
+typedef unordered_map_fast<SceUID, MsgPipePtr> MsgPipePtrs;
 
 enum class SyncWeight {
     Light, // lightweight
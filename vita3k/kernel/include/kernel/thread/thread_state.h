@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <cpu/state.h>
 #include <kernel/callback.h>
@@ -26,7 +27,9 @@
 #include <mem/ptr.h>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string>
+#include <util/thread_utils.h>
 
 struct CPUState;
 struct CPUContext;
@@ -80,6 +83,10 @@ struct ThreadState {
 
     int priority;
     SceInt32 affinity_mask;
+    // set when priority or affinity changed from another thread, applied by the thread itself
+    std::atomic<bool> host_mapping_changed = false;
+    // cpu time of the host thread running this thread, protected by mutex
+    thread_utils::ThreadCpuClock host_cpu_clock;
     uint64_t start_tick;
     uint64_t last_vblank_waited;
     // set to true if thread is processing kernel callbacks
@@ -109,7 +116,11 @@ struct ThreadState {
     void raise_waiting_threads();
 
     // this function must be called from the thread itself (inside a svc call)
-    uint32_t run_callback(Address callback_address, const std::vector<uint32_t> &args);
+    // the arguments are only read while the callback is set up, so they can live on the stack of the caller
+    uint32_t run_callback(Address callback_address, std::span<const uint32_t> args);
+    uint32_t run_callback(Address callback_address, std::initializer_list<uint32_t> args) {
+        return run_callback(callback_address, std::span<const uint32_t>(args.begin(), args.size()));
+    }
 
     // this function is called from another thread when this one is dormant
     // it is only used for module loading and gxm display queue right now
@@ -118,10 +129,14 @@ struct ThreadState {
 
     void suspend();
     void resume(bool step = false);
+    // these must be called with the mutex locked
+    // stopped once the run loop has handled the suspension and waits to be resumed
+    bool is_stopped() const;
+    bool can_suspend() const;
     std::string log_stack_traceback() const;
 
 private:
-    void push_arguments(Address callback_address, const std::vector<uint32_t> &args);
+    void push_arguments(Address callback_address, std::span<const uint32_t> args);
 
     KernelState &kernel;
 
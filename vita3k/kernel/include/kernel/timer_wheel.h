@@ -0,0 +1,127 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Timeouts of the guest threads, expired by a single wakeup thread.
+ *
+ * Timers are kept in a hierarchical wheel: the first level has one slot per tick, each next level
+ * has slots covering a whole rotation of the previous one and its timers are moved down once their
+ * slot is reached. Adding and cancelling a timer is constant time and the wakeup thread only wakes up
+ * for the next timer to expire, sleeping until shortly before it then spinning to reach it precisely.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+
+    TimerWheel();
+    ~TimerWheel();
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    // The callback is called from the wakeup thread once the deadline is reached, it must not block
+    TimerId add(Clock::time_point deadline, std::function<void()> callback);
+    // Returns false if the timer has already expired, its callback may still be running
+    bool cancel(TimerId id);
+    // Waits for the callbacks of the timers which have already expired to return
+    void wait_for_callbacks();
+
+    void sleep_until(Clock::time_point deadline);
+
+    // Same as std::condition_variable::wait_until, the mutex of the lock is taken by the wheel to wake up the waiter
+    template <typename Predicate>
+    bool wait_until(std::condition_variable &cond, std::unique_lock<std::mutex> &lock, Clock::time_point deadline, Predicate pred) {
+        if (pred())
+            return true;
+
+        std::mutex &mutex = *lock.mutex();
+        bool expired = false;
+        const TimerId id = add(deadline, [&] {
+            const std::lock_guard<std::mutex> guard(mutex);
+            expired = true;
+            cond.notify_all();
+        });
+        cond.wait(lock, [&] { return expired || pred(); });
+        if (!expired && !cancel(id)) {
+            // the callback is running and needs the mutex, it uses the variables of this function
+            lock.unlock();
+            wait_for_callbacks();
+            lock.lock();
+        }
+
+        return pred();
+    }
+
+    template <typename Rep, typename Period, typename Predicate>
+    bool wait_for(std::condition_variable &cond, std::unique_lock<std::mutex> &lock, std::chrono::duration<Rep, Period> timeout, Predicate pred) {
+        return wait_until(cond, lock, Clock::now() + timeout, pred);
+    }
+
+private:
+    static constexpr uint32_t LEVEL_COUNT = 4;
+    static constexpr uint32_t SLOT_BITS = 6;
+    static constexpr uint32_t SLOT_COUNT = 1 << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOT_COUNT - 1;
+
+    struct Timer {
+        uint64_t tick;
+        std::function<void()> callback;
+        uint32_t level = 0;
+        uint32_t slot = 0;
+    };
+
+    std::mutex mutex;
+    // held by the wakeup thread from the moment timers are expired until their callbacks returned
+    std::mutex callback_mutex;
+    std::condition_variable wakeup_cond;
+    std::thread wakeup_thread;
+    bool stopping = false;
+
+    Clock::time_point start;
+    // next tick to be processed, every timer expires at this tick or later
+    uint64_t current_tick = 0;
+    // tick the wakeup thread sleeps until, the thread only has to be woken up for an earlier timer
+    uint64_t wakeup_tick = 0;
+    TimerId next_id = 1;
+    std::unordered_map<TimerId, Timer> timers;
+    std::array<std::array<std::vector<TimerId>, SLOT_COUNT>, LEVEL_COUNT> slots;
+    // one bit per non empty slot of each level
+    std::array<uint64_t, LEVEL_COUNT> occupied = {};
+    std::vector<TimerId> cascading;
+    std::vector<std::function<void()>> expired;
+
+    uint64_t tick_of(Clock::time_point time) const;
+    void place(TimerId id, Timer &timer);
+    void unplace(TimerId id, const Timer &timer);
+    void cascade();
+    void advance(uint64_t target_tick);
+    std::optional<uint64_t> next_event_tick() const;
+    void run();
+};
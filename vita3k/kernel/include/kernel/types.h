@@ -71,6 +71,7 @@
 #define SCE_UID_INVALID_UID (SceUID)(0xFFFFFFFF)
 
 #define SCE_ERROR_ERRNO_EINVAL 0x80010016
+#define SCE_ERROR_ERRNO_ECANCELED 0x8001008C
 
 constexpr size_t MODULE_INFO_NUM_SEGMENTS = 4;
 
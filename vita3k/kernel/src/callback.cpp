@@ -15,6 +15,7 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <array>
 #include <kernel/callback.h>
 #include <kernel/state.h>
 #include <kernel/thread/thread_state.h>
@@ -90,7 +91,7 @@ void Callback::execute(KernelState &kernel, std::function<void()> deleter) {
     if (!this->is_notified())
         return;
 
-    std::vector<uint32_t> args = { (uint32_t)(this->notifier_id), this->num_notifications, (uint32_t)this->notification_arg, this->userdata.address() };
+    const std::array<uint32_t, 4> args = { (uint32_t)(this->notifier_id), this->num_notifications, (uint32_t)this->notification_arg, this->userdata.address() };
     int ret = kernel.get_thread(this->thread_id)->run_callback(this->cb_func.address(), args);
     if (ret != 0) {
         deleter();
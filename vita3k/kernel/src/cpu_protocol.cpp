@@ -18,14 +18,18 @@
 #include <kernel/cpu_protocol.h>
 #include <kernel/state.h>
 #include <util/lock_and_find.h>
+#include <util/log.h>
 
-CPUProtocol::CPUProtocol(KernelState &kernel, MemState &mem, const CallImportFunc &func)
+CPUProtocol::CPUProtocol(KernelState &kernel, MemState &mem, const CallImportFunc &func, const CallHleImportFunc &hle_func)
     : call_import(func)
+    , call_hle_import(hle_func)
     , kernel(&kernel)
     , mem(&mem) {
 }
 
 void CPUProtocol::call_svc(CPUState &cpu, uint32_t svc, Address pc, ThreadState &thread) {
+    kernel->debugger.rearm_watches(*mem);
+
     // Handle trampoline
     // 1. Handle trampoline jumper
     // to save the space we use interrupt to implement jumper
@@ -48,14 +52,41 @@ void CPUProtocol::call_svc(CPUState &cpu, uint32_t svc, Address pc, ThreadState
         return;
     }
 
+    // 3. Call host implementation of a recognized guest function
+    if (svc == HOST_FAST_PATH_SVC) {
+        if (!call_host_fast_path(*kernel, cpu, *mem, pc - 2))
+            LOG_ERROR("No host fast path installed at {}", log_hex(pc - 2));
+        return;
+    }
+
+    // 4. HLE import bound by load_self, the svc immediate is its index in the import table
+    if (svc >= HLE_IMPORT_SVC_BASE) {
+        call_hle_import(cpu, svc - HLE_IMPORT_SVC_BASE, thread.id, false);
+        clear_exclusive(cpu);
+        return;
+    }
+
     // This is usual service call
     uint32_t nid = *Ptr<uint32_t>(pc + 4).get(*mem);
-    // TODO: just supply ThreadStatePtr to call_import
-    // the only benefit of using thread_id instead--namely less locking-- has been gone for long
+    // the thread itself is reachable from the cpu state, only its id is given to the exports
     call_import(cpu, nid, thread.id);
 
     // ARM recommends claering exclusive state inside interrupt handler
-    clear_exclusive(kernel->exclusive_monitor, get_processor_id(cpu));
+    clear_exclusive(cpu);
+}
+
+bool CPUProtocol::call_svc_in_run_loop(CPUState &cpu, uint32_t svc) {
+    kernel->debugger.rearm_watches(*mem);
+
+    // everything else may block, reschedule, run guest code or change the code of the guest
+    if (svc < HLE_IMPORT_SVC_BASE)
+        return false;
+
+    if (!call_hle_import(cpu, svc - HLE_IMPORT_SVC_BASE, get_thread_id(cpu), true))
+        return false;
+
+    clear_exclusive(cpu);
+    return true;
 }
 
 Address CPUProtocol::get_watch_memory_addr(Address addr) {
@@ -65,3 +96,11 @@ Address CPUProtocol::get_watch_memory_addr(Address addr) {
 ExclusiveMonitorPtr CPUProtocol::get_exlusive_monitor() {
     return kernel->exclusive_monitor;
 }
+
+JitCache *CPUProtocol::get_jit_cache() {
+    return &kernel->jit_cache;
+}
+
+BreakpointTable *CPUProtocol::get_breakpoint_table() {
+    return &kernel->debugger.breakpoint_table;
+}
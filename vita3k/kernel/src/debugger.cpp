@@ -17,6 +17,7 @@
 
 #include <kernel/debugger.h>
 #include <kernel/state.h>
+#include <mem/functions.h>
 #include <util/align.h>
 #include <util/arm.h>
 #include <util/log.h>
@@ -28,7 +29,14 @@ inline bool is_thumb16(uint32_t inst) {
     return (inst & 0xF8000000) < 0xE8000000;
 }
 
-void Debugger::add_breakpoint(MemState &mem, uint32_t addr, bool thumb_mode) {
+void Debugger::add_breakpoint(MemState &mem, uint32_t addr, bool thumb_mode, BreakpointCondition condition) {
+    if (parent.cpu_backend == CPUBackend::Dynarmic) {
+        breakpoint_table.add(addr, thumb_mode, std::move(condition));
+        // the blocks already translated have to be read again with the breakpoint
+        parent.invalidate_jit_cache(addr, 4);
+        return;
+    }
+
     const auto lock = std::lock_guard(mutex);
     Breakpoint bk;
     bk.thumb_mode = thumb_mode;
@@ -44,6 +52,10 @@ void Debugger::add_breakpoint(MemState &mem, uint32_t addr, bool thumb_mode) {
 }
 
 void Debugger::remove_breakpoint(MemState &mem, uint32_t addr) {
+    // the translated blocks which still hold the breakpoint step over it
+    if (breakpoint_table.remove(addr))
+        return;
+
     const auto lock = std::lock_guard(mutex);
     if (breakpoints.contains(addr)) {
         auto last = breakpoints[addr];
@@ -124,16 +136,73 @@ Debugger::Debugger(KernelState &kernel)
     : parent(kernel) {
 }
 
-void Debugger::add_watch_memory_addr(Address addr, size_t size) {
-    std::lock_guard<std::mutex> lock(mutex);
-    watch_memory_addrs.emplace(addr, WatchMemory{ addr, size });
+// Called by the access violation handler with the protect mutex held, so add_protect is never called with the debugger mutex held
+bool Debugger::handle_watch_write(Address start, Address addr) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = watch_memory_addrs.find(start);
+        // the watch was removed, its pages are simply released
+        if (it == watch_memory_addrs.end())
+            return true;
+
+        it->second.armed = false;
+        if (addr >= start && addr < start + it->second.size)
+            LOG_INFO("Write at watched address {} (watch {} + {})", log_hex(addr), log_hex(start), addr - start);
+    }
+
+    // the pages are released so the write can go through, the watch is armed again by the next svc
+    watches_released = true;
+    return true;
+}
+
+void Debugger::arm_watch(MemState &mem, const WatchMemory &watch) {
+    // whole pages are protected, every write to them is seen by the watch which checks the exact range itself
+    const Address begin = align_down(watch.start, mem.page_size);
+    const Address end = align(watch.start + static_cast<Address>(watch.size), mem.page_size);
+    const Address start = watch.start;
+    add_protect(mem, begin, end - begin, MemPerm::ReadOnly, [this, start](Address addr, bool write) {
+        return handle_watch_write(start, addr);
+    });
 }
 
-void Debugger::remove_watch_memory_addr(KernelState &state, Address addr) {
+void Debugger::add_watch_memory_addr(MemState &mem, Address addr, size_t size) {
+    if (size == 0)
+        return;
+
+    const WatchMemory watch{ addr, size, true };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!watch_memory_addrs.emplace(addr, watch).second)
+            return;
+    }
+    arm_watch(mem, watch);
+}
+
+void Debugger::remove_watch_memory_addr(MemState &mem, Address addr) {
     std::lock_guard<std::mutex> lock(mutex);
+    // the pages stay protected until the next write to them, which then finds no watch and releases them
     watch_memory_addrs.erase(addr);
 }
 
+void Debugger::rearm_watches(MemState &mem) {
+    // checked first so the svcs do not all write to the flag
+    if (!watches_released.load(std::memory_order_relaxed) || !watches_released.exchange(false))
+        return;
+
+    std::vector<WatchMemory> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &[_, watch] : watch_memory_addrs) {
+            if (watch.armed)
+                continue;
+            watch.armed = true;
+            released.push_back(watch);
+        }
+    }
+    for (const auto &watch : released)
+        arm_watch(mem, watch);
+}
+
 // TODO use boost icl or interval tree instead if this turns out to be a significant bottleneck
 Address Debugger::get_watch_memory_addr(Address addr) {
     std::lock_guard<std::mutex> lock(mutex);
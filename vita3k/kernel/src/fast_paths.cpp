@@ -0,0 +1,162 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/fast_paths.h>
+
+#include <cpu/functions.h>
+#include <kernel/state.h>
+#include <mem/functions.h>
+#include <mem/ptr.h>
+#include <util/log.h>
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+static bool check_range(MemState &mem, Address addr, uint32_t size, const char *name) {
+    if (size == 0 || is_valid_addr_range(mem, addr, addr + size))
+        return true;
+
+    LOG_ERROR("Host {} fast path called on invalid range {}-{}", name, log_hex(addr), log_hex(addr + size));
+    return false;
+}
+
+static void host_memcpy(CPUState &cpu, MemState &mem) {
+    const Address dst = read_reg(cpu, 0);
+    const Address src = read_reg(cpu, 1);
+    const uint32_t size = read_reg(cpu, 2);
+    if (!check_range(mem, dst, size, "memcpy") || !check_range(mem, src, size, "memcpy"))
+        return;
+
+    uint8_t *const host_dst = Ptr<uint8_t>(dst).get(mem);
+    const uint8_t *const host_src = Ptr<uint8_t>(src).get(mem);
+    if (dst > src && dst < src + size) {
+        // The guest byte loop copies forward, keep the same result for overlapping ranges
+        for (uint32_t i = 0; i < size; i++)
+            host_dst[i] = host_src[i];
+    } else {
+        memmove(host_dst, host_src, size);
+    }
+}
+
+static void host_memset(CPUState &cpu, MemState &mem) {
+    const Address dst = read_reg(cpu, 0);
+    const uint32_t size = read_reg(cpu, 2);
+    if (!check_range(mem, dst, size, "memset"))
+        return;
+
+    memset(Ptr<uint8_t>(dst).get(mem), static_cast<uint8_t>(read_reg(cpu, 1)), size);
+}
+
+static void host_strlen(CPUState &cpu, MemState &mem) {
+    const Address str = read_reg(cpu, 0);
+    if (!check_range(mem, str, 1, "strlen"))
+        return;
+
+    write_reg(cpu, 0, static_cast<uint32_t>(strlen(Ptr<char>(str).get(mem))));
+}
+
+static void host_strcmp(CPUState &cpu, MemState &mem) {
+    const Address lhs = read_reg(cpu, 0);
+    const Address rhs = read_reg(cpu, 1);
+    if (!check_range(mem, lhs, 1, "strcmp") || !check_range(mem, rhs, 1, "strcmp"))
+        return;
+
+    const uint8_t *a = Ptr<uint8_t>(lhs).get(mem);
+    const uint8_t *b = Ptr<uint8_t>(rhs).get(mem);
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    write_reg(cpu, 0, static_cast<uint32_t>(static_cast<int32_t>(*a) - static_cast<int32_t>(*b)));
+}
+
+struct FastPathSignature {
+    const char *name;
+    // Thumb halfwords in memory order
+    std::vector<uint16_t> code;
+    HostFastPathFn fn;
+};
+
+// Byte loops emitted for the reference libc routines at -Os by the ARM toolchains used on the Vita
+static const std::array<FastPathSignature, 4> signatures = { {
+    { "memcpy", { 0xB132, 0x4603, 0xF811, 0xCB01, 0x3A01, 0xF803, 0xCB01, 0xD1F9, 0x4770 }, host_memcpy },
+    { "memset", { 0xB122, 0x4603, 0xF803, 0x1B01, 0x3A01, 0xD1FB, 0x4770 }, host_memset },
+    { "strlen", { 0x4601, 0xF811, 0x2B01, 0x2A00, 0xD1FB, 0x1A08, 0x3801, 0x4770 }, host_strlen },
+    { "strcmp", { 0xF810, 0x2B01, 0xF811, 0x3B01, 0x2A01, 0xBF28, 0x429A, 0xD0F7, 0x1AD0, 0x4770 }, host_strcmp },
+} };
+
+static constexpr uint16_t THUMB_SVC_FAST_PATH = 0xDF00 | HOST_FAST_PATH_SVC;
+static constexpr uint16_t THUMB_BX_LR = 0x4770;
+static constexpr uint16_t THUMB_NOP = 0xBF00;
+
+// A recognized body is only patched if it starts right after the end of another function,
+// otherwise it may be a loop inlined in the middle of a bigger one
+static bool is_function_boundary(const uint16_t *code, size_t index) {
+    if (index == 0)
+        return true;
+    const uint16_t prev = code[index - 1];
+    return prev == THUMB_BX_LR || prev == THUMB_NOP || prev == 0 || (prev & 0xFF00) == 0xBD00; // pop {..., pc}
+}
+
+size_t install_host_fast_paths(KernelState &kernel, MemState &mem, Address text_addr, uint32_t text_size, const std::string &module_name) {
+    uint16_t *const code = Ptr<uint16_t>(text_addr).get(mem);
+    const size_t count = text_size / sizeof(uint16_t);
+
+    size_t installed = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (const auto &signature : signatures) {
+            const size_t length = signature.code.size();
+            if (i + length > count || code[i] != signature.code[0])
+                continue;
+            if (memcmp(&code[i], signature.code.data(), length * sizeof(uint16_t)) != 0 || !is_function_boundary(code, i))
+                continue;
+
+            const Address addr = text_addr + static_cast<Address>(i * sizeof(uint16_t));
+            code[i] = THUMB_SVC_FAST_PATH;
+            code[i + 1] = THUMB_BX_LR;
+            {
+                const std::unique_lock<std::shared_mutex> lock(kernel.host_fast_paths_mutex);
+                kernel.host_fast_paths[addr] = signature.fn;
+            }
+            LOG_INFO("{}: redirected guest {} at {} to the host", module_name, signature.name, log_hex(addr));
+
+            installed++;
+            i += length - 1;
+            break;
+        }
+    }
+
+    if (installed)
+        kernel.invalidate_jit_cache(text_addr, text_size);
+
+    return installed;
+}
+
+bool call_host_fast_path(KernelState &kernel, CPUState &cpu, MemState &mem, Address svc_pc) {
+    HostFastPathFn fn;
+    {
+        const std::shared_lock<std::shared_mutex> lock(kernel.host_fast_paths_mutex);
+        const auto it = kernel.host_fast_paths.find(svc_pc);
+        if (it == kernel.host_fast_paths.end())
+            return false;
+        fn = it->second;
+    }
+
+    fn(cpu, mem);
+    return true;
+}
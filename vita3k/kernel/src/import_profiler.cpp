@@ -0,0 +1,129 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/import_profiler.h>
+
+#include <nids/functions.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+// how long a host thread keeps its counters before merging them with the shared ones
+constexpr auto MERGE_INTERVAL = std::chrono::milliseconds(50);
+
+typedef std::unordered_map<uint32_t, ImportProfileEntry> ImportProfileEntries;
+
+std::atomic<bool> import_profiling_enabled = false;
+
+static std::mutex profile_mutex;
+static ImportProfileEntries profile_entries;
+// incremented by each reset, so counters recorded before it by other threads are dropped
+static std::atomic<uint32_t> profile_generation = 0;
+
+static void merge_entries(ImportProfileEntries &entries, uint32_t generation) {
+    const std::lock_guard<std::mutex> lock(profile_mutex);
+    if (generation == profile_generation) {
+        for (const auto &[nid, local] : entries) {
+            ImportProfileEntry &entry = profile_entries[nid];
+            entry.nid = nid;
+            entry.calls += local.calls;
+            entry.total_ns += local.total_ns;
+            entry.max_ns = std::max(entry.max_ns, local.max_ns);
+        }
+    }
+    entries.clear();
+}
+
+struct LocalImportProfile {
+    ImportProfileEntries entries;
+    uint32_t generation = 0;
+    ImportProfileClock::time_point last_merge;
+
+    ~LocalImportProfile() {
+        if (!entries.empty())
+            merge_entries(entries, generation);
+    }
+};
+
+static thread_local LocalImportProfile local_profile;
+
+void set_import_profiling(bool enabled) {
+    import_profiling_enabled = enabled;
+}
+
+void record_import_call(uint32_t nid, ImportProfileClock::duration duration) {
+    const uint32_t generation = profile_generation.load(std::memory_order_relaxed);
+    if (local_profile.generation != generation) {
+        local_profile.entries.clear();
+        local_profile.generation = generation;
+    }
+
+    const uint64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    ImportProfileEntry &entry = local_profile.entries[nid];
+    entry.calls++;
+    entry.total_ns += duration_ns;
+    entry.max_ns = std::max(entry.max_ns, duration_ns);
+
+    const auto now = ImportProfileClock::now();
+    if (now - local_profile.last_merge >= MERGE_INTERVAL) {
+        merge_entries(local_profile.entries, generation);
+        local_profile.last_merge = now;
+    }
+}
+
+std::vector<ImportProfileEntry> get_import_profile() {
+    std::vector<ImportProfileEntry> entries;
+    const std::lock_guard<std::mutex> lock(profile_mutex);
+    entries.reserve(profile_entries.size());
+    for (const auto &[_, entry] : profile_entries)
+        entries.push_back(entry);
+    return entries;
+}
+
+void reset_import_profile() {
+    const std::lock_guard<std::mutex> lock(profile_mutex);
+    profile_entries.clear();
+    profile_generation++;
+}
+
+bool dump_import_profile(const fs::path &path) {
+    std::vector<ImportProfileEntry> entries = get_import_profile();
+    if (entries.empty())
+        return true;
+
+    std::sort(entries.begin(), entries.end(), [](const ImportProfileEntry &a, const ImportProfileEntry &b) {
+        return a.total_ns > b.total_ns;
+    });
+
+    std::ofstream file(path.string(), std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to write HLE profile {}", path.string());
+        return false;
+    }
+
+    file << "nid,name,calls,total_us,average_us,max_us\n";
+    for (const auto &entry : entries) {
+        file << fmt::format("{},{},{},{:.3f},{:.3f},{:.3f}\n", log_hex(entry.nid), import_name(entry.nid), entry.calls,
+            entry.total_ns / 1000.0, entry.total_ns / 1000.0 / entry.calls, entry.max_ns / 1000.0);
+    }
+
+    LOG_INFO("HLE profile of {} imports written to {}", entries.size(), path.string());
+    return true;
+}
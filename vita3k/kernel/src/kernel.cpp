@@ -29,6 +29,7 @@
 #include <util/arm.h>
 #include <util/find.h>
 #include <util/log.h>
+#include <util/thread_utils.h>
 
 #include <SDL_thread.h>
 #include <spdlog/fmt/fmt.h>
@@ -72,8 +73,17 @@ static int SDLCALL thread_function(void *data) {
     }
 #endif
 
+    params.kernel->apply_host_thread_mapping(*thread);
+    {
+        const std::lock_guard<std::mutex> thread_lock(thread->mutex);
+        thread->host_cpu_clock = thread_utils::get_current_thread_cpu_clock();
+    }
     thread->run_loop();
     const uint32_t r0 = read_reg(*thread->cpu, 0);
+    {
+        const std::lock_guard<std::mutex> thread_lock(thread->mutex);
+        thread_utils::release_thread_cpu_clock(thread->host_cpu_clock);
+    }
 
     std::lock_guard<std::mutex> lock(params.kernel->mutex);
     params.kernel->threads.erase(thread->id);
@@ -86,20 +96,39 @@ KernelState::KernelState()
     : debugger(*this) {
 }
 
-bool KernelState::init(MemState &mem, CallImportFunc call_import, CPUBackend cpu_backend, bool cpu_opt) {
+bool KernelState::init(MemState &mem, CallImportFunc call_import, CallHleImportFunc call_hle_import, CPUBackend cpu_backend, bool cpu_opt) {
     constexpr std::size_t MAX_CORE_COUNT = 150;
 
     corenum_allocator.set_max_core_count(MAX_CORE_COUNT);
-    exclusive_monitor = new_exclusive_monitor(MAX_CORE_COUNT);
+    // Without a shared monitor every cpu keeps its own reservation, see DynarmicCPU::own_monitor
+    exclusive_monitor = scalable_exclusive_monitor ? nullptr : new_exclusive_monitor(MAX_CORE_COUNT);
     start_tick = rtc_get_ticks(rtc_base_ticks());
     base_tick = { rtc_base_ticks() };
-    cpu_protocol = std::make_unique<CPUProtocol>(*this, mem, call_import);
+    cpu_protocol = std::make_unique<CPUProtocol>(*this, mem, call_import, call_hle_import);
     this->cpu_backend = cpu_backend;
     this->cpu_opt = cpu_opt;
 
+    // Never reallocated so the svc handler can read it while modules are being loaded
+    hle_import_nids.reserve(MAX_HLE_IMPORTS);
+
     return true;
 }
 
+std::optional<uint32_t> KernelState::bind_hle_import(uint32_t nid) {
+    const std::lock_guard<std::mutex> guard(export_nids_mutex);
+    const auto it = hle_import_indices.find(nid);
+    if (it != hle_import_indices.end())
+        return it->second;
+
+    if (hle_import_nids.size() >= MAX_HLE_IMPORTS)
+        return std::nullopt;
+
+    const uint32_t index = static_cast<uint32_t>(hle_import_nids.size());
+    hle_import_nids.push_back(nid);
+    hle_import_indices.emplace(nid, index);
+    return index;
+}
+
 void KernelState::load_process_param(MemState &mem, Ptr<uint32_t> ptr) {
     const SceProcessParam *param = ptr.cast<SceProcessParam>().get(mem);
     if (param->version == 0) {
@@ -124,6 +153,7 @@ void KernelState::set_memory_watch(bool enabled) {
 }
 
 void KernelState::invalidate_jit_cache(Address start, size_t length) {
+    jit_cache.invalidate(start, length);
     std::lock_guard<std::mutex> lock(mutex);
     for (auto thread : threads) {
         ::invalidate_jit_cache(*thread.second->cpu, start, length);
@@ -167,6 +197,15 @@ Ptr<Ptr<void>> KernelState::get_thread_tls_addr(MemState &mem, SceUID thread_id,
 }
 
 void KernelState::exit_delete_all_threads() {
+    jit_cache.save();
+    if (guest_profiler.is_running()) {
+        guest_profiler.stop();
+        guest_profiler.dump(guest_profile_path, [this](Address pc) { return resolve_guest_pc(pc); });
+        guest_profiler.clear();
+    }
+    const ExclusiveMonitorStats monitor_stats = get_exclusive_monitor_stats();
+    if (monitor_stats.store_count)
+        LOG_INFO("Exclusive stores: {}, failed: {} ({:.2f}%)", monitor_stats.store_count, monitor_stats.store_failures, monitor_stats.store_failures * 100.0 / monitor_stats.store_count);
     const std::lock_guard<std::mutex> lock(mutex);
     for (auto [_, thread] : threads) {
         thread->exit_delete();
@@ -204,3 +243,73 @@ std::shared_ptr<SceKernelModuleInfo> KernelState::find_module_by_addr(Address ad
     }
     return nullptr;
 }
+
+void KernelState::start_guest_profiler(const fs::path &dump_path) {
+    guest_profile_path = dump_path;
+    guest_profiler.clear();
+
+    // Sample every millisecond, the sampler thread only reads the last pc written back by the JIT
+    guest_profiler.start([this](std::vector<Address> &pcs) {
+        const std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &[_, thread] : threads) {
+            if (thread->status == ThreadStatus::run)
+                pcs.push_back(read_pc(*thread->cpu));
+        }
+    },
+        1000);
+}
+
+std::string KernelState::resolve_guest_pc(Address pc) {
+    const auto mod = find_module_by_addr(pc);
+    if (!mod)
+        return "unknown";
+
+    for (const auto &seg : mod->segments) {
+        if (seg.size && seg.vaddr.address() <= pc && pc <= seg.vaddr.address() + seg.memsz)
+            return fmt::format("{}+0x{:X}", mod->module_name, pc - seg.vaddr.address());
+    }
+
+    return mod->module_name;
+}
+
+void KernelState::set_host_cpu_set(const std::string &cpu_set) {
+    std::vector<int> cores = thread_utils::parse_cpu_set(cpu_set);
+    if (cores.empty()) {
+        for (int core = 0; core < thread_utils::get_host_cpu_count(); core++)
+            cores.push_back(core);
+    }
+
+    // Deal the host cores round-robin so every guest core gets at least one when possible
+    for (auto &group : host_core_groups)
+        group.clear();
+    for (size_t i = 0; i < cores.size(); i++)
+        host_core_groups[i % host_core_groups.size()].push_back(cores[i]);
+    if (cores.size() < host_core_groups.size()) {
+        for (size_t i = cores.size(); i < host_core_groups.size(); i++)
+            host_core_groups[i] = host_core_groups[i % cores.size()];
+    }
+}
+
+void KernelState::apply_host_thread_mapping(const ThreadState &thread) {
+    if (!host_thread_mapping)
+        return;
+
+    std::vector<int> cores;
+    const SceInt32 user_mask = thread.affinity_mask & SCE_KERNEL_CPU_MASK_USER_ALL;
+    // A mask covering every user core (or none) leaves the host scheduler free to place the thread
+    if (user_mask != 0 && user_mask != SCE_KERNEL_CPU_MASK_USER_ALL) {
+        for (size_t i = 0; i < host_core_groups.size(); i++) {
+            if (user_mask & (0x10000 << i))
+                cores.insert(cores.end(), host_core_groups[i].begin(), host_core_groups[i].end());
+        }
+    }
+    if (!thread_utils::set_current_thread_affinity(cores) && !cores.empty())
+        LOG_DEBUG("Could not set host affinity for thread {}", thread.name);
+
+    SDL_ThreadPriority priority = SDL_THREAD_PRIORITY_NORMAL;
+    if (thread.priority < 96)
+        priority = SDL_THREAD_PRIORITY_HIGH;
+    else if (thread.priority > SCE_KERNEL_GAME_DEFAULT_PRIORITY_ACTUAL)
+        priority = SDL_THREAD_PRIORITY_LOW;
+    SDL_SetThreadPriority(priority);
+}
@@ -21,7 +21,10 @@
 #include <kernel/state.h>
 #include <kernel/types.h>
 
+#include <mem/functions.h>
+#include <mem/state.h>
 #include <nids/functions.h>
+#include <util/align.h>
 #include <util/arm.h>
 #include <util/fs.h>
 #include <util/log.h>
@@ -39,8 +42,10 @@
 #include <cassert>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <thread>
 
 #define NID_MODULE_STOP 0x79F8E492
 #define NID_MODULE_EXIT 0x913482A9
@@ -51,6 +56,40 @@
 
 static constexpr bool LOG_MODULE_LOADING = false;
 
+// Below this amount of work, spawning a host thread costs more than it saves
+static constexpr uint32_t PARALLEL_LOAD_MIN_BYTES = 64 * 1024;
+
+// Largest page size of the hosts the segments of an inflated image can be mapped on
+static constexpr uint64_t IMAGE_SEGMENT_ALIGNMENT = KiB(16);
+
+struct LoadJob {
+    uint32_t size; // Bytes processed by the job, used to decide if it's worth running on its own thread
+    std::function<bool()> run;
+};
+
+/**
+ * \brief Run independent loading jobs (segment inflate, relocation tables) concurrently.
+ * \return Index of the first job that failed in submission order, or -1 if they all succeeded
+ */
+static int run_load_jobs(const std::vector<LoadJob> &jobs) {
+    std::vector<uint8_t> results(jobs.size(), false);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].size >= PARALLEL_LOAD_MIN_BYTES && i + 1 < jobs.size())
+            threads.emplace_back([&, i] { results[i] = jobs[i].run(); });
+        else
+            results[i] = jobs[i].run();
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (!results[i])
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
 struct VarImportsHeader {
     uint32_t unk : 4; // Must be zero
     uint32_t reloc_data_size : 24; // Size of Relocation data in bytes, includes this header.
@@ -137,7 +176,10 @@ static bool load_func_imports(const uint32_t *nids, const Ptr<uint32_t> *entries
         */
 
         if (export_address == kernel.export_nids.end()) {
-            stub[0] = 0xef000000; // svc #0 - Call our interrupt hook.
+            // Use the import index as svc immediate so the interrupt hook can dispatch without looking up the NID,
+            // fall back to svc #0 (NID lookup) if the table is full
+            const auto import_index = kernel.bind_hle_import(nid);
+            stub[0] = 0xef000000 | (import_index ? HLE_IMPORT_SVC_BASE + *import_index : 0); // svc - Call our interrupt hook.
             stub[1] = 0xe1a0f00e; // mov pc, lr - Return to the caller.
             stub[2] = nid; // Our interrupt hook will read this.
         } else {
@@ -243,6 +285,7 @@ static bool load_func_exports(SceKernelModuleInfo *kernel_module_info, const uin
         {
             const std::lock_guard<std::mutex> guard(kernel.export_nids_mutex);
             kernel.export_nids.emplace(nid, entry.address());
+            kernel.export_nids_generation++;
         }
 
         if (kernel.debugger.log_exports) {
@@ -378,10 +421,72 @@ static bool load_exports(SceKernelModuleInfo *kernel_module_info, const sce_modu
     return true;
 }
 
+bool inflate_self(const void *self, size_t self_size, std::vector<uint8_t> &inflated) {
+    const uint8_t *const self_bytes = static_cast<const uint8_t *>(self);
+    const SCE_header &self_header = *static_cast<const SCE_header *>(self);
+    if (self_size < sizeof(SCE_header) || self_header.magic != 0x00454353 || self_header.version != 3 || self_header.header_type != 1)
+        return false;
+
+    const Elf32_Ehdr &elf = *reinterpret_cast<const Elf32_Ehdr *>(self_bytes + self_header.elf_offset);
+    const Elf32_Phdr *const segments = reinterpret_cast<const Elf32_Phdr *>(self_bytes + self_header.phdr_offset);
+
+    // the headers are padded so the largest read-only segment starts on a page of the image, load_self can then map it
+    const Elf32_Phdr *mapped_segment = nullptr;
+    for (Elf_Half seg_index = 0; seg_index < elf.e_phnum; ++seg_index) {
+        const Elf32_Phdr &seg_header = segments[seg_index];
+        if ((seg_header.p_type == PT_LOAD) && !(seg_header.p_flags & PF_W) && (!mapped_segment || (seg_header.p_filesz > mapped_segment->p_filesz)))
+            mapped_segment = &seg_header;
+    }
+    uint64_t header_len = self_header.header_len;
+    if (mapped_segment)
+        header_len = align(header_len + mapped_segment->p_offset, IMAGE_SEGMENT_ALIGNMENT) - mapped_segment->p_offset;
+
+    // load_self reads uncompressed segments at header_len + p_offset, which is the layout of the embedded ELF image
+    inflated.assign(header_len + self_header.elf_filesize, 0);
+    memcpy(inflated.data(), self_bytes, self_header.header_len);
+    if (elf.e_phoff + elf.e_phnum * sizeof(Elf32_Phdr) > self_header.elf_filesize)
+        return false;
+    // keep the ELF headers in the image too, they are used when dumping ELFs
+    memcpy(inflated.data() + header_len, &elf, sizeof(Elf32_Ehdr));
+    memcpy(inflated.data() + header_len + elf.e_phoff, segments, elf.e_phnum * sizeof(Elf32_Phdr));
+    segment_info *const seg_infos = reinterpret_cast<segment_info *>(inflated.data() + self_header.section_info_offset);
+
+    for (Elf_Half seg_index = 0; seg_index < elf.e_phnum; ++seg_index) {
+        const Elf32_Phdr &seg_header = segments[seg_index];
+        if (seg_header.p_filesz == 0)
+            continue;
+        if (seg_header.p_offset + seg_header.p_filesz > self_header.elf_filesize)
+            return false;
+
+        uint8_t *const dest = inflated.data() + header_len + seg_header.p_offset;
+        if (seg_infos[seg_index].compression == 2) {
+            if (seg_infos[seg_index].offset + seg_infos[seg_index].length > self_size)
+                return false;
+
+            mz_ulong dest_bytes = seg_header.p_filesz;
+            if (mz_uncompress(dest, &dest_bytes, self_bytes + seg_infos[seg_index].offset, static_cast<mz_ulong>(seg_infos[seg_index].length)) != MZ_OK)
+                return false;
+
+            seg_infos[seg_index].offset = header_len + seg_header.p_offset;
+            seg_infos[seg_index].length = seg_header.p_filesz;
+            seg_infos[seg_index].compression = 1;
+        } else {
+            if (self_header.header_len + seg_header.p_offset + seg_header.p_filesz > self_size)
+                return false;
+
+            memcpy(dest, self_bytes + self_header.header_len + seg_header.p_offset, seg_header.p_filesz);
+        }
+    }
+
+    reinterpret_cast<SCE_header *>(inflated.data())->header_len = header_len;
+    reinterpret_cast<SCE_header *>(inflated.data())->self_filesize = inflated.size();
+    return true;
+}
+
 /**
  * \return Negative on failure
  */
-SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std::string &self_path, const std::string &dump_path) {
+SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std::string &self_path, const std::string &dump_path, const std::string &image_path) {
     // TODO: use raw I/O from path when io becomes less bad
     const uint8_t *const self_bytes = static_cast<const uint8_t *>(self);
     const SCE_header &self_header = *static_cast<const SCE_header *>(self);
@@ -477,6 +582,9 @@ SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std
     };
 
     SegmentInfosForReloc segment_reloc_info;
+    std::vector<LoadJob> segment_jobs;
+    std::vector<LoadJob> reloc_jobs;
+    std::vector<std::unique_ptr<uint8_t[]>> uncompressed_relocs;
 
     auto free_all_segments = [](MemState &mem, SegmentInfosForReloc &segs_info) {
         for (auto &[_, segment] : segs_info) {
@@ -533,36 +641,50 @@ SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std
                     return SCE_KERNEL_ERROR_NO_MEMORY; // TODO is this correct?
                 }
 
-                const Ptr<uint8_t> seg_ptr(segment_address);
+                uint8_t *const seg_dest = Ptr<uint8_t>(segment_address).get(mem);
                 if (seg_infos[seg_index].compression == 2) {
-                    unsigned long dest_bytes = seg_header.p_filesz;
                     const uint8_t *const compressed_segment_bytes = self_bytes + seg_infos[seg_index].offset;
-
-                    int res = mz_uncompress(reinterpret_cast<uint8_t *>(seg_ptr.get(mem)), &dest_bytes, compressed_segment_bytes, static_cast<mz_ulong>(seg_infos[seg_index].length));
-                    assert(res == MZ_OK);
+                    const mz_ulong compressed_size = static_cast<mz_ulong>(seg_infos[seg_index].length);
+                    const uint32_t filesz = seg_header.p_filesz;
+                    auto inflate = [=] {
+                        unsigned long dest_bytes = filesz;
+                        int res = mz_uncompress(seg_dest, &dest_bytes, compressed_segment_bytes, compressed_size);
+                        assert(res == MZ_OK);
+                        return true;
+                    };
+                    segment_jobs.push_back({ filesz, inflate });
                 } else {
-                    memcpy(seg_ptr.get(mem), seg_bytes, seg_header.p_filesz);
+                    // the full pages of read-only segments are mapped from the image on disk instead of copied,
+                    // relocations and patches then only copy the pages they write to
+                    const uint64_t image_offset = self_header.header_len + seg_header.p_offset;
+                    uint32_t mapped_size = 0;
+                    if (!image_path.empty() && !(seg_header.p_flags & PF_W) && (image_offset % mem.page_size == 0)) {
+                        mapped_size = align_down(seg_header.p_filesz, mem.page_size);
+                        if (!map_file(mem, segment_address, mapped_size, image_path, image_offset))
+                            mapped_size = 0;
+                    }
+                    memcpy(seg_dest + mapped_size, seg_bytes + mapped_size, seg_header.p_filesz - mapped_size);
                 }
 
                 segment_reloc_info[seg_index] = { segment_address, seg_header.p_vaddr, seg_header.p_memsz };
             }
         } else if (seg_header.p_type == PT_SCE_RELA) {
+            // Relocation tables are applied once every segment is in place, each table is independent from the others
+            const uint8_t *reloc_bytes = seg_bytes;
+            const uint32_t filesz = seg_header.p_filesz;
             if (seg_infos[seg_index].compression == 2) {
                 unsigned long dest_bytes = seg_header.p_filesz;
                 const uint8_t *const compressed_segment_bytes = self_bytes + seg_infos[seg_index].offset;
-                auto uncompressed = std::make_unique<uint8_t[]>(dest_bytes);
+                auto &uncompressed = uncompressed_relocs.emplace_back(std::make_unique<uint8_t[]>(dest_bytes));
 
                 int res = mz_uncompress(uncompressed.get(), &dest_bytes, compressed_segment_bytes, static_cast<mz_ulong>(seg_infos[seg_index].length));
                 assert(res == MZ_OK);
-                if (!relocate(uncompressed.get(), seg_header.p_filesz, segment_reloc_info, mem)) {
-                    return -1;
-                }
-
-            } else {
-                if (!relocate(seg_bytes, seg_header.p_filesz, segment_reloc_info, mem)) {
-                    return -1;
-                }
+                reloc_bytes = uncompressed.get();
             }
+            auto apply_relocs = [reloc_bytes, filesz, &segment_reloc_info, &mem] {
+                return relocate(reloc_bytes, filesz, segment_reloc_info, mem);
+            };
+            reloc_jobs.push_back({ filesz, apply_relocs });
         } else if ((seg_header.p_type == PT_SCE_COMMENT) || (seg_header.p_type == PT_SCE_VERSION)
             || (seg_header.p_type == PT_ARM_EXIDX) /* TODO: this may be important and require being loaded */) {
             LOG_INFO("{}: Skipping special segment {}...", self_path, log_hex(seg_header.p_type));
@@ -571,6 +693,10 @@ SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std
         }
     }
 
+    run_load_jobs(segment_jobs);
+    if (run_load_jobs(reloc_jobs) != -1)
+        return -1;
+
     if (kernel.debugger.dump_elfs) {
         // Dump elf
         std::vector<uint8_t> dump_elf(self_bytes + self_header.header_len, self_bytes + self_header.self_filesize);
@@ -599,6 +725,12 @@ SceUID load_self(KernelState &kernel, MemState &mem, const void *self, const std
     const uint8_t *const module_info_segment_bytes = module_info_segment_address.get(mem);
     const sce_module_info_raw *const module_info = reinterpret_cast<const sce_module_info_raw *>(module_info_segment_bytes + module_info_offset);
 
+    // module_info lives in the text segment, which is the code the JIT cache has to track
+    const auto &text_segment = segment_reloc_info[module_info_segment_index];
+    kernel.jit_cache.add_module(module_info->module_nid, text_segment.addr, static_cast<uint32_t>(text_segment.size));
+    if (kernel.host_fast_paths_enabled)
+        install_host_fast_paths(kernel, mem, text_segment.addr, static_cast<uint32_t>(text_segment.size), self_path);
+
     for (const auto &[seg, infos] : segment_reloc_info) {
         LOG_INFO("Loaded module segment {} @ [0x{:08X} - 0x{:08X} / 0x{:08X}] (size: 0x{:08X}) of module {}", seg, infos.addr, infos.addr + infos.size, infos.p_vaddr, infos.size, self_path);
     }
@@ -0,0 +1,55 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/scheduler.h>
+
+void GuestScheduler::set_slot_count(uint32_t slot_count) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    this->slot_count = slot_count;
+    slot_freed.notify_all();
+}
+
+void GuestScheduler::acquire(int priority) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (slot_count == 0)
+        return;
+
+    if (waiting.empty() && running < slot_count) {
+        running++;
+        return;
+    }
+
+    const auto key = std::make_pair(priority, next_ticket++);
+    waiting.insert(key);
+    slot_freed.wait(lock, [&] {
+        return slot_count == 0 || (running < slot_count && *waiting.begin() == key);
+    });
+    waiting.erase(key);
+    running++;
+
+    // more than one slot may have been freed, let the next thread in line check
+    if (!waiting.empty() && running < slot_count)
+        slot_freed.notify_all();
+}
+
+void GuestScheduler::release() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (running > 0)
+        running--;
+    if (!waiting.empty())
+        slot_freed.notify_all();
+}
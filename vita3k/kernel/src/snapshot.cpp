@@ -0,0 +1,169 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/state.h>
+#include <kernel/thread/thread_state.h>
+
+#include <cpu/functions.h>
+#include <mem/functions.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// Layout of a kernel snapshot: magic, version, the threads stopped between two instructions
+// with their context, then the memory snapshot
+constexpr char SNAPSHOT_MAGIC[4] = { 'V', '3', 'K', 'S' };
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+// large buffers so the snapshot is streamed with few write calls
+constexpr size_t SNAPSHOT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+struct ThreadSnapshot {
+    SceUID id;
+    std::string name;
+    CPUContext context;
+};
+
+// Threads which were running are suspended once their cpu stops, the others are waiting in host code
+static std::vector<ThreadStatePtr> wait_for_suspended_threads(KernelState &kernel) {
+    std::vector<ThreadStatePtr> threads;
+    {
+        const std::lock_guard<std::mutex> lock(kernel.mutex);
+        for (const auto &[_, thread] : kernel.threads)
+            threads.push_back(thread);
+    }
+
+    std::vector<ThreadStatePtr> suspended;
+    for (const auto &thread : threads) {
+        std::unique_lock<std::mutex> lock(thread->mutex);
+        thread->status_cond.wait_for(lock, std::chrono::seconds(1), [&] { return thread->status != ThreadStatus::run; });
+        if (thread->status == ThreadStatus::suspend)
+            suspended.push_back(thread);
+    }
+    return suspended;
+}
+
+bool KernelState::save_snapshot(MemState &mem, const fs::path &path) {
+    const bool was_paused = is_threads_paused();
+    if (!was_paused)
+        pause_threads();
+
+    const std::vector<ThreadStatePtr> threads = wait_for_suspended_threads(*this);
+
+    std::vector<char> buffer(SNAPSHOT_BUFFER_SIZE);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path.string(), std::ios::binary | std::ios::trunc);
+
+    bool success = file.is_open();
+    if (success) {
+        file.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        file.write(reinterpret_cast<const char *>(&SNAPSHOT_VERSION), sizeof(SNAPSHOT_VERSION));
+        const uint32_t thread_count = static_cast<uint32_t>(threads.size());
+        file.write(reinterpret_cast<const char *>(&thread_count), sizeof(thread_count));
+        for (const auto &thread : threads) {
+            const CPUContext context = ::save_context(*thread->cpu);
+            const uint32_t name_size = static_cast<uint32_t>(thread->name.size());
+            file.write(reinterpret_cast<const char *>(&thread->id), sizeof(thread->id));
+            file.write(reinterpret_cast<const char *>(&name_size), sizeof(name_size));
+            file.write(thread->name.data(), name_size);
+            file.write(reinterpret_cast<const char *>(&context), sizeof(context));
+        }
+
+        success = ::save_snapshot(mem, file) && file.flush();
+    }
+
+    if (!was_paused)
+        resume_threads();
+
+    if (!success) {
+        LOG_ERROR("Failed to write snapshot {}", path.string());
+        return false;
+    }
+
+    LOG_INFO("Snapshot of {} threads written to {}", threads.size(), path.string());
+    return true;
+}
+
+bool KernelState::load_snapshot(MemState &mem, const fs::path &path) {
+    std::vector<char> buffer(SNAPSHOT_BUFFER_SIZE);
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path.string(), std::ios::binary);
+
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint32_t version = 0;
+    uint32_t thread_count = 0;
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0
+        || !file.read(reinterpret_cast<char *>(&version), sizeof(version)) || (version != SNAPSHOT_VERSION)
+        || !file.read(reinterpret_cast<char *>(&thread_count), sizeof(thread_count))) {
+        LOG_ERROR("{} is not a valid snapshot", path.string());
+        return false;
+    }
+
+    std::vector<ThreadSnapshot> snapshot_threads;
+    for (uint32_t i = 0; i < thread_count; i++) {
+        ThreadSnapshot thread;
+        uint32_t name_size = 0;
+        file.read(reinterpret_cast<char *>(&thread.id), sizeof(thread.id));
+        file.read(reinterpret_cast<char *>(&name_size), sizeof(name_size));
+        if (!file || (name_size > KiB(1))) {
+            LOG_ERROR("{} is not a valid snapshot", path.string());
+            return false;
+        }
+        thread.name.resize(name_size);
+        file.read(thread.name.data(), name_size);
+        file.read(reinterpret_cast<char *>(&thread.context), sizeof(thread.context));
+        snapshot_threads.push_back(std::move(thread));
+    }
+    if (!file) {
+        LOG_ERROR("{} is not a valid snapshot", path.string());
+        return false;
+    }
+
+    const bool was_paused = is_threads_paused();
+    if (!was_paused)
+        pause_threads();
+
+    // the contexts are only restored to the threads of this boot which are stopped between two instructions
+    const std::vector<ThreadStatePtr> threads = wait_for_suspended_threads(*this);
+    const bool success = ::load_snapshot(mem, file);
+    if (success) {
+        uint32_t restored = 0;
+        for (const auto &snapshot_thread : snapshot_threads) {
+            const auto thread = std::find_if(threads.begin(), threads.end(), [&](const ThreadStatePtr &t) {
+                return (t->id == snapshot_thread.id) && (t->name == snapshot_thread.name);
+            });
+            if (thread == threads.end()) {
+                LOG_WARN("Thread {} ({}) of the snapshot is not suspended, its context is not restored", snapshot_thread.name, snapshot_thread.id);
+                continue;
+            }
+            ::load_context(*(*thread)->cpu, snapshot_thread.context);
+            restored++;
+        }
+        invalidate_jit_cache(0, 0xFFFFFFFF);
+        LOG_INFO("Snapshot {} loaded, {} thread contexts restored", path.string(), restored);
+    }
+
+    if (!was_paused)
+        resume_threads();
+
+    return success;
+}
@@ -77,7 +77,7 @@ inline int find_condvar(CondvarPtr &condvar_out, CondvarPtrs **condvars_out, Ker
 
 // TODO: Write remaining time to timeout ptr when it's successfully signaled
 // Assumes primitive_lock is locked and thread_lock is unlocked
-inline int handle_timeout(const ThreadStatePtr &thread, std::unique_lock<std::mutex> &thread_lock,
+inline int handle_timeout(KernelState &kernel, const ThreadStatePtr &thread, std::unique_lock<std::mutex> &thread_lock,
     std::unique_lock<std::mutex> &primitive_lock, WaitingThreadQueuePtr &queue,
     const WaitingThreadData &data, const ThreadDataQueueInterator<WaitingThreadData> &data_it,
     const char *export_name, SceUInt *const timeout) {
@@ -85,7 +85,7 @@ inline int handle_timeout(const ThreadStatePtr &thread, std::unique_lock<std::mu
         bool status = false;
         auto start = std::chrono::steady_clock::now();
         if (*timeout > 0) {
-            status = thread->status_cond.wait_for(primitive_lock, std::chrono::microseconds{ *timeout }, [&] { return thread->status == ThreadStatus::run; });
+            status = kernel.timer_wheel.wait_for(thread->status_cond, primitive_lock, std::chrono::microseconds{ *timeout }, [&] { return thread->status == ThreadStatus::run; });
         }
 
         if (!status) {
@@ -145,14 +145,14 @@ SceUID simple_event_create(KernelState &kernel, MemState &mem, const char *expor
     event->auto_reset = (event->attr & SCE_KERNEL_EVENT_ATTR_AUTO_RESET);
     event->cb_wakeup_only = (event->attr & SCE_KERNEL_ATTR_NOTIFY_CB_WAKEUP_ONLY);
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
+    const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
     kernel.simple_events.emplace(uid, event);
 
     return uid;
 }
 
 SceInt32 simple_event_waitorpoll(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID event_id, SceUInt32 wait_pattern, SceUInt32 *result_pattern, SceUInt64 *user_data, SceUInt32 *timeout, bool is_wait) {
-    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.mutex);
+    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.sync_objects_mutex);
     if (!event) {
         // this may also be a timer event
         return timer_waitorpoll(kernel, export_name, thread_id, event_id, wait_pattern, result_pattern, user_data, timeout, is_wait);
@@ -165,8 +165,6 @@ SceInt32 simple_event_waitorpoll(KernelState &kernel, const char *export_name, S
             event->waiting_threads->size());
     }
 
-    const ThreadStatePtr thread = kernel.get_thread(thread_id);
-
     std::unique_lock<std::mutex> event_lock(event->mutex);
 
     if (result_pattern)
@@ -182,6 +180,8 @@ SceInt32 simple_event_waitorpoll(KernelState &kernel, const char *export_name, S
 
         return SCE_KERNEL_OK;
     } else if (is_wait) {
+        // the thread is only looked up when it has to wait, the kernel mutex is not taken otherwise
+        const ThreadStatePtr thread = kernel.get_thread(thread_id);
         std::unique_lock<std::mutex> thread_lock(thread->mutex);
         thread->update_status(ThreadStatus::wait, ThreadStatus::run);
 
@@ -193,9 +193,10 @@ SceInt32 simple_event_waitorpoll(KernelState &kernel, const char *export_name, S
         data.priority = thread->priority;
 
         const auto data_it = event->waiting_threads->push(data);
+        event->waiting_pattern |= wait_pattern;
         thread_lock.unlock();
 
-        const int err = handle_timeout(thread, thread_lock, event_lock, event->waiting_threads, data, data_it, export_name, timeout);
+        const int err = handle_timeout(kernel, thread, thread_lock, event_lock, event->waiting_threads, data, data_it, export_name, timeout);
         if (err < 0) {
             // set it only if a timeout occurs
             // otherwise set in simple_event_setorpulse
@@ -211,7 +212,7 @@ SceInt32 simple_event_waitorpoll(KernelState &kernel, const char *export_name, S
 }
 
 SceInt32 simple_event_setorpulse(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID event_id, SceUInt32 pattern, SceUInt64 user_data, bool is_set) {
-    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.mutex);
+    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.sync_objects_mutex);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVENT_ID);
     }
@@ -231,7 +232,10 @@ SceInt32 simple_event_setorpulse(KernelState &kernel, const char *export_name, S
     event->pattern = new_pattern;
     event->last_user_data = user_data;
 
-    for (auto it = event->waiting_threads->begin(); it != event->waiting_threads->end();) {
+    const bool may_wake_up = event->pattern & event->waiting_pattern;
+    if (may_wake_up)
+        event->waiting_pattern = 0;
+    for (auto it = event->waiting_threads->begin(); may_wake_up && (it != event->waiting_threads->end());) {
         const auto waiting_thread_data = *it;
         const auto waiting_thread = waiting_thread_data.thread;
         const auto waiting_pattern = waiting_thread_data.pattern;
@@ -253,6 +257,7 @@ SceInt32 simple_event_setorpulse(KernelState &kernel, const char *export_name, S
 
             event->waiting_threads->erase(it++);
         } else {
+            event->waiting_pattern |= waiting_pattern;
             ++it;
         }
     }
@@ -266,7 +271,7 @@ SceInt32 simple_event_setorpulse(KernelState &kernel, const char *export_name, S
 }
 
 SceInt32 simple_event_clear(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID event_id, SceUInt32 clear_pattern) {
-    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.mutex);
+    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.sync_objects_mutex);
     if (!event) {
         // this may also be a timer event
         return timer_clear(kernel, export_name, thread_id, event_id, clear_pattern);
@@ -285,7 +290,7 @@ SceInt32 simple_event_clear(KernelState &kernel, const char *export_name, SceUID
 }
 
 SceInt32 simple_event_delete(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID event_id) {
-    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.mutex);
+    const SimpleEventPtr event = lock_and_find(event_id, kernel.simple_events, kernel.sync_objects_mutex);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVENT_ID);
     }
@@ -296,8 +301,8 @@ SceInt32 simple_event_delete(KernelState &kernel, const char *export_name, SceUI
     }
 
     if (event->waiting_threads->empty()) {
-        const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
-        kernel.eventflags.erase(event_id);
+        const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
+        kernel.simple_events.erase(event_id);
     } else {
         // TODO:
         LOG_WARN("Can't delete sync object, it has waiting threads.");
@@ -557,11 +562,8 @@ SceUID mutex_create(SceUID *uid_out, KernelState &kernel, MemState &mem, const c
     mutex->workarea = workarea;
     std::copy(mutex_name, mutex_name + KERNELOBJECT_MAX_NAME_LENGTH, mutex->name);
     mutex->attr = attr;
-    mutex->owner = nullptr;
-    if (init_count > 0) {
-        const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
-        mutex->owner = thread;
-    }
+    if (init_count > 0)
+        mutex->owner_word = static_cast<uint32_t>(thread_id);
     if (mutex->attr & SCE_KERNEL_ATTR_TH_PRIO) {
         mutex->waiting_threads = std::make_unique<PriorityThreadDataQueue<WaitingThreadData>>();
     } else {
@@ -611,6 +613,14 @@ SceUID mutex_find(KernelState &kernel, const char *export_name, const char *pNam
     return RET_ERROR(SCE_KERNEL_ERROR_UID_CANNOT_FIND_BY_NAME);
 }
 
+inline void mutex_update_workarea(MemState &mem, const MutexPtr &mutex, SceUID thread_id, SyncWeight weight) {
+    if (weight == SyncWeight::Light) {
+        SceKernelLwMutexWork *workarea = mutex->workarea.get(mem);
+        workarea->lockCount = mutex->lock_count;
+        workarea->owner = thread_id;
+    }
+}
+
 inline int mutex_lock_impl(KernelState &kernel, MemState &mem, const char *export_name, SceUID thread_id, int lock_count, MutexPtr &mutex, SyncWeight weight, SceUInt *timeout, bool only_try) {
     if (LOG_SYNC_PRIMITIVES) {
         LOG_DEBUG("{}: uid: {} thread_id: {} name: \"{}\" attr: {} lock_count: {} timeout: {} waiting_threads: {}",
@@ -618,75 +628,90 @@ inline int mutex_lock_impl(KernelState &kernel, MemState &mem, const char *expor
             mutex->waiting_threads->size());
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+    const uint64_t self = static_cast<uint32_t>(thread_id);
 
-    std::unique_lock<std::mutex> mutex_lock(mutex->mutex);
-
-    bool is_recursive = (mutex->attr & SCE_KERNEL_MUTEX_ATTR_RECURSIVE);
+    // Fast path: not owned and nobody waiting, take ownership without going through the kernel
+    uint64_t word = 0;
+    if (mutex->owner_word.compare_exchange_strong(word, self, std::memory_order_acquire)) {
+        mutex->lock_count = lock_count;
+        mutex_update_workarea(mem, mutex, thread_id, weight);
 
-    // Already owned
-    if (mutex->lock_count > 0) {
-        // Owned by ourselves
-        if (mutex->owner == thread) {
-            if (is_recursive) {
-                mutex->lock_count += lock_count;
-                if (weight == SyncWeight::Light)
-                    mutex->workarea.get(mem)->lockCount += lock_count;
+        return SCE_KERNEL_OK;
+    }
 
-                return SCE_KERNEL_OK;
-            }
+    // Owned by ourselves, nobody else can change the lock count
+    if ((word & Mutex::OWNER_MASK) == self) {
+        if (mutex->attr & SCE_KERNEL_MUTEX_ATTR_RECURSIVE) {
+            mutex->lock_count += lock_count;
             if (weight == SyncWeight::Light)
-                return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_RECURSIVE);
+                mutex->workarea.get(mem)->lockCount += lock_count;
 
-            return RET_ERROR(SCE_KERNEL_ERROR_MUTEX_RECURSIVE);
+            return SCE_KERNEL_OK;
         }
-        // Owned by someone else
+        if (weight == SyncWeight::Light)
+            return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_RECURSIVE);
 
-        // Don't sleep if only_try is set
-        if (only_try) {
-            if (weight == SyncWeight::Light)
-                return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_FAILED_TO_OWN);
+        return RET_ERROR(SCE_KERNEL_ERROR_MUTEX_RECURSIVE);
+    }
 
-            return RET_ERROR(SCE_KERNEL_ERROR_MUTEX_FAILED_TO_OWN);
-        }
+    // Owned by someone else
 
-        // Sleep thread!
-        std::unique_lock<std::mutex> thread_lock(thread->mutex);
-        thread->update_status(ThreadStatus::wait, ThreadStatus::run);
+    // Don't sleep if only_try is set
+    if (only_try && (word & Mutex::OWNER_MASK) != 0) {
+        if (weight == SyncWeight::Light)
+            return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_FAILED_TO_OWN);
 
-        WaitingThreadData data;
-        data.thread = thread;
-        data.lock_count = lock_count;
-        data.priority = thread->priority;
+        return RET_ERROR(SCE_KERNEL_ERROR_MUTEX_FAILED_TO_OWN);
+    }
 
-        const auto data_it = mutex->waiting_threads->push(data);
-        thread_lock.unlock();
+    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
 
-        int res = handle_timeout(thread, thread_lock, mutex_lock, mutex->waiting_threads, data, data_it, export_name, timeout);
+    std::unique_lock<std::mutex> mutex_lock(mutex->mutex);
 
-        if (weight == SyncWeight::Light) {
-            mutex->workarea.get(mem)->lockCount = mutex->lock_count;
-            if (mutex->owner == thread) {
-                mutex->workarea.get(mem)->owner = thread_id;
+    // Set the waiters flag so the owner goes through the slow unlock path and hands the mutex over to us.
+    // If it was released in the meantime, take it instead.
+    word = mutex->owner_word.load(std::memory_order_relaxed);
+    while (true) {
+        if ((word & Mutex::OWNER_MASK) == 0) {
+            const uint64_t waiters = mutex->waiting_threads->empty() ? 0 : Mutex::WAITERS_FLAG;
+            if (mutex->owner_word.compare_exchange_weak(word, self | waiters, std::memory_order_acquire)) {
+                mutex->lock_count = lock_count;
+                mutex_update_workarea(mem, mutex, thread_id, weight);
+
+                return SCE_KERNEL_OK;
             }
-        }
+        } else if (only_try) {
+            if (weight == SyncWeight::Light)
+                return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_FAILED_TO_OWN);
 
-        return res;
+            return RET_ERROR(SCE_KERNEL_ERROR_MUTEX_FAILED_TO_OWN);
+        } else if (mutex->owner_word.compare_exchange_weak(word, word | Mutex::WAITERS_FLAG, std::memory_order_relaxed)) {
+            break;
+        }
     }
-    // Not owned
-    // Take ownership!
 
-    mutex->lock_count += lock_count;
-    mutex->owner = thread;
+    // Sleep thread!
+    std::unique_lock<std::mutex> thread_lock(thread->mutex);
+    thread->update_status(ThreadStatus::wait, ThreadStatus::run);
 
-    if (weight == SyncWeight::Light) {
-        mutex->workarea.get(mem)->lockCount = mutex->lock_count;
-        if (mutex->owner == thread) {
-            mutex->workarea.get(mem)->owner = thread_id;
-        }
+    WaitingThreadData data;
+    data.thread = thread;
+    data.lock_count = lock_count;
+    data.priority = thread->priority;
+
+    const auto data_it = mutex->waiting_threads->push(data);
+    thread_lock.unlock();
+
+    int res = handle_timeout(kernel, thread, thread_lock, mutex_lock, mutex->waiting_threads, data, data_it, export_name, timeout);
+
+    if (res == SCE_KERNEL_OK) {
+        // the owner handed the mutex over to us, owner_word and lock_count are already set
+        mutex_update_workarea(mem, mutex, thread_id, weight);
+    } else if (mutex->waiting_threads->empty()) {
+        mutex->owner_word.fetch_and(~Mutex::WAITERS_FLAG, std::memory_order_relaxed);
     }
 
-    return SCE_KERNEL_OK;
+    return res;
 }
 
 int mutex_lock(KernelState &kernel, MemState &mem, const char *export_name, SceUID thread_id, SceUID mutexid, int lock_count, unsigned int *timeout, SyncWeight weight) {
@@ -710,35 +735,44 @@ int mutex_try_lock(KernelState &kernel, MemState &mem, const char *export_name,
 }
 
 inline int mutex_unlock_impl(KernelState &kernel, const char *export_name, SceUID thread_id, int unlock_count, MutexPtr &mutex) {
-    const ThreadStatePtr current_thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
-
-    const std::lock_guard<std::mutex> mutex_lock(mutex->mutex);
+    const uint64_t self = static_cast<uint32_t>(thread_id);
 
-    if (current_thread == mutex->owner) {
-        if (unlock_count > mutex->lock_count) {
-            return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_UNLOCK_UDF);
-        }
+    if ((mutex->owner_word.load(std::memory_order_relaxed) & Mutex::OWNER_MASK) != self)
+        return SCE_KERNEL_OK;
 
-        mutex->lock_count -= unlock_count;
+    if (unlock_count > mutex->lock_count) {
+        return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_UNLOCK_UDF);
+    }
 
-        if (mutex->lock_count == 0) {
-            mutex->owner = nullptr;
+    mutex->lock_count -= unlock_count;
+    if (mutex->lock_count > 0)
+        return SCE_KERNEL_OK;
 
-            if (!mutex->waiting_threads->empty()) {
-                const auto waiting_thread_data = *mutex->waiting_threads->begin();
-                const auto waiting_thread = waiting_thread_data.thread;
-                const auto waiting_lock_count = waiting_thread_data.lock_count;
+    // Fast path: nobody is waiting, just release it
+    uint64_t word = self;
+    if (mutex->owner_word.compare_exchange_strong(word, 0, std::memory_order_release))
+        return SCE_KERNEL_OK;
 
-                const std::lock_guard<std::mutex> waiting_thread_lock(waiting_thread->mutex);
-                waiting_thread->update_status(ThreadStatus::run, ThreadStatus::wait);
+    // Slow path: hand the mutex over to the first waiting thread
+    const std::lock_guard<std::mutex> mutex_lock(mutex->mutex);
 
-                mutex->waiting_threads->pop();
-                mutex->lock_count += waiting_lock_count;
-                mutex->owner = waiting_thread;
-            }
-        }
+    if (mutex->waiting_threads->empty()) {
+        mutex->owner_word.store(0, std::memory_order_release);
+        return SCE_KERNEL_OK;
     }
 
+    const auto waiting_thread_data = *mutex->waiting_threads->begin();
+    const auto waiting_thread = waiting_thread_data.thread;
+
+    const std::lock_guard<std::mutex> waiting_thread_lock(waiting_thread->mutex);
+    waiting_thread->update_status(ThreadStatus::run, ThreadStatus::wait);
+
+    mutex->waiting_threads->pop();
+    mutex->lock_count = waiting_thread_data.lock_count;
+
+    const uint64_t waiters = mutex->waiting_threads->empty() ? 0 : Mutex::WAITERS_FLAG;
+    mutex->owner_word.store(static_cast<uint32_t>(waiting_thread->id) | waiters, std::memory_order_release);
+
     return SCE_KERNEL_OK;
 }
 
@@ -881,7 +915,7 @@ SceInt32 rwlock_lock(KernelState &kernel, MemState &mem, const char *export_name
         const auto data_it = rwlock->waiting_threads->push(data);
         thread_lock.unlock();
 
-        return handle_timeout(thread, thread_lock, rwlock_lock, rwlock->waiting_threads, data, data_it, export_name, timeout);
+        return handle_timeout(kernel, thread, thread_lock, rwlock_lock, rwlock->waiting_threads, data, data_it, export_name, timeout);
     }
 }
 
@@ -1059,7 +1093,7 @@ SceInt32 semaphore_wait(KernelState &kernel, const char *export_name, SceUID thr
         const auto data_it = semaphore->waiting_threads->push(data);
         thread_lock.unlock();
 
-        auto res = handle_timeout(thread, thread_lock, semaphore_lock, semaphore->waiting_threads, data, data_it, export_name, pTimeout);
+        auto res = handle_timeout(kernel, thread, thread_lock, semaphore_lock, semaphore->waiting_threads, data, data_it, export_name, pTimeout);
         if (was_canceled)
             res = SCE_KERNEL_ERROR_WAIT_CANCEL;
         return res;
@@ -1253,7 +1287,7 @@ int condvar_wait(KernelState &kernel, MemState &mem, const char *export_name, Sc
     const auto data_it = condvar->waiting_threads->push(data);
     thread_lock.unlock();
 
-    if (auto error = handle_timeout(thread, thread_lock, condition_variable_lock, condvar->waiting_threads, data, data_it, export_name, timeout))
+    if (auto error = handle_timeout(kernel, thread, thread_lock, condition_variable_lock, condvar->waiting_threads, data, data_it, export_name, timeout))
         return error;
 
     condition_variable_lock.unlock();
@@ -1337,7 +1371,7 @@ int condvar_delete(KernelState &kernel, const char *export_name, SceUID thread_i
 // **************
 
 SceUID eventflag_clear(KernelState &kernel, const char *export_name, SceUID evfId, SceUInt32 bitPattern) {
-    const EventFlagPtr event = lock_and_find(evfId, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = lock_and_find(evfId, kernel.eventflags, kernel.sync_objects_mutex);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     }
@@ -1377,7 +1411,7 @@ SceUID eventflag_create(KernelState &kernel, const char *export_name, SceUID thr
         event->waiting_threads = std::make_unique<FIFOThreadDataQueue<WaitingThreadData>>();
     }
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
+    const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
     kernel.eventflags.emplace(uid, event);
 
     return uid;
@@ -1390,7 +1424,7 @@ SceUID eventflag_find(KernelState &kernel, const char *export_name, const char *
     if (LOG_SYNC_PRIMITIVES)
         LOG_DEBUG("{}: name: \"{}\"", export_name, pName);
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
+    const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
 
     const auto it = std::find_if(kernel.eventflags.begin(), kernel.eventflags.end(), [=](const auto &evf) {
         return strncmp(evf.second->name, pName, KERNELOBJECT_MAX_NAME_LENGTH) == 0;
@@ -1406,7 +1440,7 @@ static int eventflag_waitorpoll(KernelState &kernel, const char *export_name, Sc
     assert(event_id >= 0);
 
     // TODO Don't lock twice.
-    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.sync_objects_mutex);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     }
@@ -1422,8 +1456,6 @@ static int eventflag_waitorpoll(KernelState &kernel, const char *export_name, Sc
         return RET_ERROR(SCE_KERNEL_ERROR_EVF_MULTI);
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
-
     std::unique_lock<std::mutex> event_lock(event->mutex);
 
     bool condition;
@@ -1448,6 +1480,8 @@ static int eventflag_waitorpoll(KernelState &kernel, const char *export_name, Sc
 
         return SCE_KERNEL_OK;
     } else if (dowait) {
+        // the thread is only looked up when it has to wait, the kernel mutex is not taken otherwise
+        const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
         std::unique_lock<std::mutex> thread_lock(thread->mutex);
         thread->update_status(ThreadStatus::wait, ThreadStatus::run);
 
@@ -1462,9 +1496,10 @@ static int eventflag_waitorpoll(KernelState &kernel, const char *export_name, Sc
         data.was_canceled = &was_canceled;
 
         const auto data_it = event->waiting_threads->push(data);
+        event->waiting_flags |= flags;
         thread_lock.unlock();
 
-        int err = handle_timeout(thread, thread_lock, event_lock, event->waiting_threads, data, data_it, export_name, timeout);
+        int err = handle_timeout(kernel, thread, thread_lock, event_lock, event->waiting_threads, data, data_it, export_name, timeout);
         if (err < 0 && outBits) {
             // set it only if a timeout occurs
             // otherwise set in eventflag_set
@@ -1491,7 +1526,7 @@ SceInt32 eventflag_set(KernelState &kernel, const char *export_name, SceUID thre
     assert(evfId >= 0);
 
     // TODO Don't lock twice.
-    const EventFlagPtr event = lock_and_find(evfId, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = lock_and_find(evfId, kernel.eventflags, kernel.sync_objects_mutex);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     }
@@ -1506,7 +1541,10 @@ SceInt32 eventflag_set(KernelState &kernel, const char *export_name, SceUID thre
     const std::lock_guard<std::mutex> event_lock(event->mutex);
     event->flags |= bitPattern;
 
-    for (auto it = event->waiting_threads->begin(); it != event->waiting_threads->end();) {
+    const bool may_wake_up = event->flags & event->waiting_flags;
+    if (may_wake_up)
+        event->waiting_flags = 0;
+    for (auto it = event->waiting_threads->begin(); may_wake_up && (it != event->waiting_threads->end());) {
         const auto waiting_thread_data = *it;
         const auto waiting_thread = waiting_thread_data.thread;
         const auto waiting_flags = waiting_thread_data.flags;
@@ -1537,6 +1575,7 @@ SceInt32 eventflag_set(KernelState &kernel, const char *export_name, SceUID thre
 
             event->waiting_threads->erase(it++);
         } else {
+            event->waiting_flags |= waiting_flags;
             ++it;
         }
     }
@@ -1547,7 +1586,7 @@ SceInt32 eventflag_set(KernelState &kernel, const char *export_name, SceUID thre
 SceInt32 eventflag_cancel(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID event_id, SceUInt32 pattern, SceUInt32 *num_wait_threads) {
     assert(event_id >= 0);
 
-    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.sync_objects_mutex);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     }
@@ -1578,6 +1617,7 @@ SceInt32 eventflag_cancel(KernelState &kernel, const char *export_name, SceUID t
     }
 
     event->flags = pattern;
+    event->waiting_flags = 0;
 
     if (num_wait_threads)
         *num_wait_threads = nb_threads;
@@ -1588,7 +1628,7 @@ SceInt32 eventflag_cancel(KernelState &kernel, const char *export_name, SceUID t
 int eventflag_delete(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID event_id) {
     assert(event_id >= 0);
 
-    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.sync_objects_mutex);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     }
@@ -1599,7 +1639,7 @@ int eventflag_delete(KernelState &kernel, const char *export_name, SceUID thread
     }
 
     if (event->waiting_threads->empty()) {
-        const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
+        const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
         kernel.eventflags.erase(event_id);
     } else {
         // TODO:
@@ -1640,7 +1680,7 @@ SceUID msgpipe_create(KernelState &kernel, const char *export_name, const char *
     // TODO do senders respect priority?
     msgpipe->senders = std::make_unique<FIFOThreadDataQueue<WaitingThreadData>>();
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
+    const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
     kernel.msgpipes.emplace(uid, msgpipe);
 
     return uid;
@@ -1653,7 +1693,7 @@ SceUID msgpipe_find(KernelState &kernel, const char *export_name, const char *pN
     if (LOG_SYNC_PRIMITIVES)
         LOG_DEBUG("{}: name: \"{}\"", export_name, pName);
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
+    const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
 
     const auto it = std::find_if(kernel.msgpipes.begin(), kernel.msgpipes.end(), [=](const auto &msg_pipe) {
         return strncmp(msg_pipe.second->name, pName, KERNELOBJECT_MAX_NAME_LENGTH) == 0;
@@ -1670,7 +1710,7 @@ SceSize msgpipe_recv(KernelState &kernel, const char *export_name, SceUID thread
 
     const bool ASAP = !(waitMode & SCE_KERNEL_MSG_PIPE_MODE_FULL);
 
-    const MsgPipePtr msgpipe = lock_and_find(msgPipeId, kernel.msgpipes, kernel.mutex);
+    const MsgPipePtr msgpipe = lock_and_find(msgPipeId, kernel.msgpipes, kernel.sync_objects_mutex);
     if (!msgpipe) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_MSG_PIPE_ID);
     }
@@ -1693,7 +1733,6 @@ SceSize msgpipe_recv(KernelState &kernel, const char *export_name, SceUID thread
         }
     };
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
     std::unique_lock msgpipe_lock(msgpipe->mutex);
     // check in case of delete happens while waiting (un)lock
     if (msgpipe->beingDeleted) {
@@ -1723,10 +1762,15 @@ SceSize msgpipe_recv(KernelState &kernel, const char *export_name, SceUID thread
     } else if (waitMode & SCE_KERNEL_MSG_PIPE_MODE_DONT_WAIT) {
         return 0;
     } else { // sleep until we can insert
+        const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+        // while the pipe is empty, a sender copies its message directly to the buffer of the first receiver
+        MsgPipeDirectRecv direct_recv{ pRecvBuf, recvSize };
+
         WaitingThreadData wait_data;
         wait_data.thread = thread;
         wait_data.priority = thread->priority;
         wait_data.mp.request_size = (ASAP) ? 1 : recvSize; // If ASAP, we can read as low as 1 byte
+        wait_data.mp.direct_recv = (waitMode & SCE_KERNEL_MSG_PIPE_MODE_DONT_REMOVE) ? nullptr : &direct_recv;
 
         msgpipe->receivers->push(wait_data);
 
@@ -1735,6 +1779,8 @@ SceSize msgpipe_recv(KernelState &kernel, const char *export_name, SceUID thread
 
         const auto finish = [&] {
             thread->update_status(ThreadStatus::run); // Wake up
+            if (direct_recv.received)
+                return direct_recv.received;
 
             SceSize readSize = (SceSize)copyOut();
             // msgpipe->receivers->erase(wait_data); //we've already been erased by the sender
@@ -1753,19 +1799,27 @@ SceSize msgpipe_recv(KernelState &kernel, const char *export_name, SceUID thread
                 }
                 msgpipe_lock.lock(); // Lock message pipe again
                 availableSize = msgpipe->data_buffer.Used();
-            } while (!((availableSize >= recvSize) || (ASAP && (availableSize > 0))));
+            } while (!direct_recv.received && !((availableSize >= recvSize) || (ASAP && (availableSize > 0))));
 
             return finish();
         } else { // There's a timeout - wait until we can fill buffer or timeout
             msgpipe_lock.unlock(); // Unlock message pipe object, else we'll deadlock
-            auto status = thread->status_cond.wait_for(thread_lock, std::chrono::microseconds{ *pTimeout }, [&] { return thread->status == ThreadStatus::run; });
+            auto status = kernel.timer_wheel.wait_for(thread->status_cond, thread_lock, std::chrono::microseconds{ *pTimeout }, [&] { return thread->status == ThreadStatus::run; });
             if (msgpipe->beingDeleted) {
                 std::atomic_fetch_add(&msgpipe->remainingThreads, -1);
                 return SCE_KERNEL_ERROR_WAIT_DELETE;
             }
 
             if (!status) { // Timed out and buffer hasn't been touched
-                thread->update_status(ThreadStatus::run, ThreadStatus::wait);
+                // a sender can still copy to this thread until it is removed from the receivers
+                thread_lock.unlock();
+                msgpipe_lock.lock();
+                const auto it = msgpipe->receivers->find(thread);
+                if (it != msgpipe->receivers->end())
+                    msgpipe->receivers->erase(it);
+                thread->update_status(ThreadStatus::run);
+                if (direct_recv.received)
+                    return direct_recv.received;
                 return RET_ERROR(SCE_KERNEL_ERROR_WAIT_TIMEOUT);
             }
             msgpipe_lock.lock(); // Lock message pipe again
@@ -1780,7 +1834,7 @@ SceSize msgpipe_send(KernelState &kernel, const char *export_name, SceUID thread
 
     const bool ASAP = !(waitMode & SCE_KERNEL_MSG_PIPE_MODE_FULL);
 
-    const MsgPipePtr msgpipe = lock_and_find(msgPipeId, kernel.msgpipes, kernel.mutex);
+    const MsgPipePtr msgpipe = lock_and_find(msgPipeId, kernel.msgpipes, kernel.sync_objects_mutex);
     if (!msgpipe) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_MSG_PIPE_ID);
     }
@@ -1808,13 +1862,34 @@ SceSize msgpipe_send(KernelState &kernel, const char *export_name, SceUID thread
         }
     };
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
     std::unique_lock<std::mutex> msgpipe_lock(msgpipe->mutex);
     // check in case of delete happens while waiting (un)lock
     if (msgpipe->beingDeleted) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_MSG_PIPE_ID);
     }
 
+    // the first receiver waiting on the empty pipe gets the message without going through the buffer
+    if ((msgpipe->data_buffer.Used() == 0) && !msgpipe->receivers->empty()) {
+        const auto it = msgpipe->receivers->begin();
+        const WaitingThreadData receiver = *it;
+        MsgPipeDirectRecv *direct_recv = receiver.mp.direct_recv;
+        // a receiver waiting for a full message can only take it if it is sent at once
+        if (direct_recv && (sendSize >= receiver.mp.request_size)) {
+            const SceSize direct_size = std::min(sendSize, direct_recv->size);
+            memcpy(direct_recv->buffer, pSendBuf, direct_size);
+            direct_recv->received = direct_size;
+            msgpipe->receivers->erase(it);
+            receiver.thread->update_status(ThreadStatus::run);
+            if (direct_size == sendSize)
+                return sendSize;
+
+            // the rest always fits in the empty buffer
+            const SceSize inserted_size = (SceSize)msgpipe->data_buffer.Insert(static_cast<const uint8_t *>(pSendBuf) + direct_size, sendSize - direct_size);
+            wakeup_receivers();
+            return direct_size + inserted_size;
+        }
+    }
+
     // If ASAP and there's at least 1 free byte, or FULL and there's enough space, copy and return directly.
     std::size_t freeSize = msgpipe->data_buffer.Free();
     if ((freeSize >= sendSize) || (ASAP && (freeSize >= 1))) {
@@ -1826,6 +1901,7 @@ SceSize msgpipe_send(KernelState &kernel, const char *export_name, SceUID thread
     } else if (waitMode & SCE_KERNEL_MSG_PIPE_MODE_DONT_WAIT) {
         return 0;
     } else { // Go to sleep until there's more space
+        const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
         WaitingThreadData wait_data;
         wait_data.thread = thread;
         wait_data.priority = thread->priority;
@@ -1862,7 +1938,7 @@ SceSize msgpipe_send(KernelState &kernel, const char *export_name, SceUID thread
             return finish();
         } else { // There's a timeout - wait until we can fill buffer or timeout
             msgpipe_lock.unlock(); // Unlock message pipe object, else we'll deadlock
-            auto status = thread->status_cond.wait_for(thread_lock, std::chrono::microseconds{ *pTimeout }, [&] { return thread->status == ThreadStatus::run; });
+            auto status = kernel.timer_wheel.wait_for(thread->status_cond, thread_lock, std::chrono::microseconds{ *pTimeout }, [&] { return thread->status == ThreadStatus::run; });
             if (msgpipe->beingDeleted) {
                 std::atomic_fetch_add(&msgpipe->remainingThreads, -1);
                 return SCE_KERNEL_ERROR_WAIT_DELETE;
@@ -1881,7 +1957,7 @@ SceSize msgpipe_send(KernelState &kernel, const char *export_name, SceUID thread
 SceInt32 msgpipe_delete(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID msgpipe_id) {
     assert(msgpipe_id >= 0);
 
-    const MsgPipePtr msgpipe = lock_and_find(msgpipe_id, kernel.msgpipes, kernel.mutex);
+    const MsgPipePtr msgpipe = lock_and_find(msgpipe_id, kernel.msgpipes, kernel.sync_objects_mutex);
     if (!msgpipe) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_MSG_PIPE_ID);
     }
@@ -1908,7 +1984,7 @@ SceInt32 msgpipe_delete(KernelState &kernel, const char *export_name, SceUID thr
             std::this_thread::yield();
     }
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
+    const std::lock_guard<std::shared_mutex> objects_lock(kernel.sync_objects_mutex);
     kernel.msgpipes.erase(msgpipe->uid);
 
     return SCE_KERNEL_OK;
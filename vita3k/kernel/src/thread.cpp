@@ -79,6 +79,7 @@ int ThreadState::init(const char *name, Ptr<const void> entry_point, int init_pr
     if (!cpu) {
         return SCE_KERNEL_ERROR_ERROR;
     }
+    set_thread_state(*cpu, this);
     if (kernel.debugger.watch_code) {
         set_log_code(*cpu, true);
     }
@@ -238,6 +239,9 @@ bool ThreadState::run_loop() {
 
             lock.unlock();
 
+            if (host_mapping_changed.exchange(false))
+                kernel.apply_host_thread_mapping(*this);
+
             if (run_start_callback) {
                 run_start_callback = false;
 
@@ -249,16 +253,18 @@ bool ThreadState::run_loop() {
             }
 
             // Run the cpu
+            kernel.scheduler.acquire(priority);
             if (to_do == ThreadToDo::step) {
                 res = step(*cpu);
                 to_do = ThreadToDo::suspend;
 
             } else
                 res = run(*cpu);
+            kernel.scheduler.release();
 
             // handle svc call if this was what stopped the cpu
             if (cpu->svc_called) {
-                cpu->protocol->call_svc(*cpu, cpu->svc_called, read_pc(*cpu), *this);
+                cpu->protocol->call_svc(*cpu, cpu->svc, read_pc(*cpu), *this);
             }
 
             lock.lock();
@@ -303,7 +309,7 @@ bool ThreadState::run_loop() {
     }
 }
 
-void ThreadState::push_arguments(Address callback_address, const std::vector<uint32_t> &args) {
+void ThreadState::push_arguments(Address callback_address, std::span<const uint32_t> args) {
     Address sp = read_sp(*cpu);
     for (size_t i = 0; i < std::min(args.size(), static_cast<size_t>(4)); i++) {
         write_reg(*cpu, i, args[i]);
@@ -317,7 +323,7 @@ void ThreadState::push_arguments(Address callback_address, const std::vector<uin
     write_sp(*cpu, sp);
 }
 
-uint32_t ThreadState::run_callback(Address callback_address, const std::vector<uint32_t> &args) {
+uint32_t ThreadState::run_callback(Address callback_address, std::span<const uint32_t> args) {
     if (call_level == 0) {
         LOG_ERROR("run_callback should not be called as the first thread entry");
         return 0;
@@ -409,6 +415,14 @@ void ThreadState::resume(bool step) {
     something_to_do.notify_one();
 }
 
+bool ThreadState::is_stopped() const {
+    return status == ThreadStatus::suspend && (to_do == ThreadToDo::wait || to_do == ThreadToDo::suspend);
+}
+
+bool ThreadState::can_suspend() const {
+    return status == ThreadStatus::run && to_do == ThreadToDo::run;
+}
+
 std::string ThreadState::log_stack_traceback() const {
     constexpr Address START_OFFSET = 0;
     constexpr Address END_OFFSET = 1024;
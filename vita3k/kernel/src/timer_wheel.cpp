@@ -0,0 +1,241 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <kernel/timer_wheel.h>
+
+#include <algorithm>
+#include <bit>
+
+#include <tracy/Tracy.hpp>
+
+// each slot of the first level covers this much time, the levels span 640us, 41ms, 2.6s and 168s
+constexpr auto TIMER_TICK = std::chrono::microseconds(10);
+// how late the os wakes up a sleeping thread, this part of the wait is spent spinning instead
+#ifdef _WIN32
+constexpr auto TIMER_SPIN_MARGIN = std::chrono::microseconds(1000);
+#else
+constexpr auto TIMER_SPIN_MARGIN = std::chrono::microseconds(200);
+#endif
+
+TimerWheel::TimerWheel()
+    : start(Clock::now()) {
+}
+
+TimerWheel::~TimerWheel() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup_cond.notify_all();
+    if (wakeup_thread.joinable())
+        wakeup_thread.join();
+}
+
+uint64_t TimerWheel::tick_of(const Clock::time_point time) const {
+    if (time <= start)
+        return 0;
+    const auto tick_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TIMER_TICK).count();
+    const auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time - start).count();
+    // rounded up so a timer never expires before its deadline
+    return static_cast<uint64_t>((elapsed_ns + tick_ns - 1) / tick_ns);
+}
+
+TimerWheel::TimerId TimerWheel::add(const Clock::time_point deadline, std::function<void()> callback) {
+    bool notify = false;
+    TimerId id;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!wakeup_thread.joinable())
+            wakeup_thread = std::thread(&TimerWheel::run, this);
+
+        // an empty wheel can jump to the current time instead of going through all the ticks it missed
+        if (timers.empty())
+            current_tick = std::max(current_tick, static_cast<uint64_t>((Clock::now() - start) / TIMER_TICK));
+
+        id = next_id++;
+        Timer &timer = timers[id];
+        timer.tick = tick_of(deadline);
+        timer.callback = std::move(callback);
+        place(id, timer);
+        notify = timer.tick < wakeup_tick;
+    }
+    if (notify)
+        wakeup_cond.notify_one();
+
+    return id;
+}
+
+bool TimerWheel::cancel(const TimerId id) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto it = timers.find(id);
+    if (it == timers.end())
+        return false;
+
+    unplace(id, it->second);
+    timers.erase(it);
+    return true;
+}
+
+void TimerWheel::wait_for_callbacks() {
+    const std::lock_guard<std::mutex> lock(callback_mutex);
+}
+
+void TimerWheel::sleep_until(const Clock::time_point deadline) {
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cond;
+    bool done = false;
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    add(deadline, [&] {
+        // notified with the mutex locked, the sleeping thread can only leave once the callback is done with the variables
+        const std::lock_guard<std::mutex> guard(sleep_mutex);
+        done = true;
+        sleep_cond.notify_one();
+    });
+    sleep_cond.wait(lock, [&] { return done; });
+}
+
+void TimerWheel::place(const TimerId id, Timer &timer) {
+    const uint64_t tick = std::max(timer.tick, current_tick);
+    const uint64_t delta = tick - current_tick;
+    uint32_t level = 0;
+    while ((level < LEVEL_COUNT - 1) && (delta >> (SLOT_BITS * (level + 1))))
+        level++;
+
+    // timers farther than the whole wheel wait in the last slot in range of the last level, they are placed again once it is reached
+    const uint64_t slot_tick = (delta >> (SLOT_BITS * LEVEL_COUNT)) ? current_tick + (1ull << (SLOT_BITS * LEVEL_COUNT)) - 1 : tick;
+    timer.level = level;
+    timer.slot = static_cast<uint32_t>((slot_tick >> (SLOT_BITS * level)) & SLOT_MASK);
+    slots[level][timer.slot].push_back(id);
+    occupied[level] |= 1ull << timer.slot;
+}
+
+void TimerWheel::unplace(const TimerId id, const Timer &timer) {
+    std::vector<TimerId> &slot = slots[timer.level][timer.slot];
+    const auto it = std::find(slot.begin(), slot.end(), id);
+    if (it != slot.end()) {
+        *it = slot.back();
+        slot.pop_back();
+    }
+    if (slot.empty())
+        occupied[timer.level] &= ~(1ull << timer.slot);
+}
+
+void TimerWheel::cascade() {
+    // the higher levels first, their timers can end up in the slot of a lower level reached at the same tick
+    for (uint32_t level = LEVEL_COUNT - 1; level > 0; level--) {
+        const uint32_t shift = SLOT_BITS * level;
+        if (current_tick & ((1ull << shift) - 1))
+            continue;
+
+        const uint32_t index = static_cast<uint32_t>((current_tick >> shift) & SLOT_MASK);
+        if (!(occupied[level] & (1ull << index)))
+            continue;
+
+        cascading.clear();
+        std::swap(cascading, slots[level][index]);
+        occupied[level] &= ~(1ull << index);
+        for (const TimerId id : cascading)
+            place(id, timers[id]);
+    }
+}
+
+void TimerWheel::advance(const uint64_t target_tick) {
+    while (current_tick <= target_tick) {
+        if ((current_tick & SLOT_MASK) == 0)
+            cascade();
+
+        const uint32_t index = static_cast<uint32_t>(current_tick & SLOT_MASK);
+        if (occupied[0] & (1ull << index)) {
+            for (const TimerId id : slots[0][index]) {
+                const auto it = timers.find(id);
+                expired.push_back(std::move(it->second.callback));
+                timers.erase(it);
+            }
+            slots[0][index].clear();
+            occupied[0] &= ~(1ull << index);
+        }
+
+        // skip to the next timer of the first level in this rotation, or to the next cascade
+        const uint64_t later_slots = (index + 1 < SLOT_COUNT) ? (occupied[0] & (~0ull << (index + 1))) : 0;
+        const uint64_t next_tick = later_slots ? (current_tick & ~SLOT_MASK) + std::countr_zero(later_slots) : (current_tick | SLOT_MASK) + 1;
+        current_tick = std::min(next_tick, target_tick + 1);
+    }
+}
+
+std::optional<uint64_t> TimerWheel::next_event_tick() const {
+    std::optional<uint64_t> next;
+    for (uint32_t level = 0; level < LEVEL_COUNT; level++) {
+        if (!occupied[level])
+            continue;
+
+        const uint32_t shift = SLOT_BITS * level;
+        const uint64_t block = current_tick >> shift;
+        uint64_t slots_from_current = std::rotr(occupied[level], static_cast<int>(block & SLOT_MASK));
+        // the slot of the current block has already been cascaded unless its first tick is the next one processed
+        if ((level > 0) && (current_tick & ((1ull << shift) - 1)))
+            slots_from_current &= ~1ull;
+        const uint64_t distance = slots_from_current ? std::countr_zero(slots_from_current) : SLOT_COUNT;
+        const uint64_t tick = (level == 0) ? current_tick + distance : (block + distance) << shift;
+        if (!next || (tick < *next))
+            next = tick;
+    }
+    return next;
+}
+
+void TimerWheel::run() {
+    tracy::SetThreadName("Timer wheel thread");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        const auto now = Clock::now();
+        const uint64_t now_tick = static_cast<uint64_t>((now - start) / TIMER_TICK);
+        // not sleeping, every new timer is seen before the next wait
+        wakeup_tick = 0;
+        if (!timers.empty() && (now_tick >= current_tick)) {
+            lock.unlock();
+            {
+                const std::lock_guard<std::mutex> callback_lock(callback_mutex);
+                lock.lock();
+                advance(now_tick);
+                lock.unlock();
+                for (auto &callback : expired)
+                    callback();
+                expired.clear();
+            }
+            lock.lock();
+            // the wheel could have been stopped while the callbacks were running
+            continue;
+        }
+
+        const std::optional<uint64_t> next_tick = next_event_tick();
+        if (!next_tick) {
+            wakeup_tick = UINT64_MAX;
+            wakeup_cond.wait(lock);
+            continue;
+        }
+
+        const auto wakeup = start + static_cast<int64_t>(*next_tick) * TIMER_TICK;
+        const auto now_after = Clock::now();
+        if (wakeup - now_after > TIMER_SPIN_MARGIN) {
+            wakeup_tick = *next_tick;
+            wakeup_cond.wait_until(lock, wakeup - TIMER_SPIN_MARGIN);
+        } else if (wakeup > now_after) {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+}
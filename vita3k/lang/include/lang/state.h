@@ -118,6 +118,7 @@ struct LangState {
             { "lightweight_condition_variables", "Lightweight Condition Variables" },
             { "event_flags", "Event Flags" },
             { "memory_allocations", "Memory Allocations" },
+            { "hle_profiler", "HLE Profiler" },
             { "disassembly", "Disassembly" }
         };
         std::map<std::string, std::string> configuration = {
@@ -307,6 +308,15 @@ struct LangState {
         { "toggle_gui_visibility_description", "Toggles between showing and hiding the GUI at the top of the screen while the app is running." },
         { "miscellaneous", "Miscellaneous" },
         { "toggle_texture_replacement", "Toggle Texture Replacement" },
+        { "save_snapshot", "Save Snapshot" },
+        { "load_snapshot", "Load Snapshot" },
+        { "snapshot_description", "Saves or restores the guest memory and the suspended threads of the running app. A snapshot can only be loaded during the boot of the app it was saved in." },
+        { "gpu_capture", "GPU Capture" },
+        { "gpu_capture_description", "Records the graphics commands of the next frames of the running app to the captures folder of the logs, they can be replayed with --replay-capture." },
+        { "gameplay_recording", "Gameplay Recording" },
+        { "gameplay_recording_description", "Starts or stops recording the video and audio of the running app to the recordings folder of the logs. Requires the Vulkan renderer." },
+        { "screenshot", "Screenshot" },
+        { "screenshot_description", "Saves the next frame of the running app to the SCREENSHOT folder of ux0:picture." },
         { "error", "Error" },
         { "error_duplicate_key", "The key is used for other bindings or it is reserved." }
     };
@@ -444,7 +454,28 @@ struct LangState {
     std::map<std::string, std::string> performance_overlay = {
         { "avg", "Avg" },
         { "min", "Min" },
-        { "max", "Max" }
+        { "max", "Max" },
+        { "top_guest_functions", "Top guest functions" },
+        { "host_memory", "Host memory" },
+        { "idle_loops", "Idle loops/s" },
+        { "memory_free", "Free" },
+        { "memory_largest", "Largest" },
+        { "texture_memory", "Tex" },
+        { "texture_hit_rate", "Hit" },
+        { "texture_evictions", "Evictions/frame" },
+        { "pipeline_lookups", "Pipelines/frame" },
+        { "pipeline_compiles", "Compiled" },
+        { "gpu_time", "GPU" },
+        { "gpu_scenes", "Scenes" },
+        { "audio_latency", "Audio" },
+        { "audio_underruns", "Underruns" },
+        { "renderer_time", "Renderer (cpu/frame)" },
+        { "renderer_commands", "Commands" },
+        { "renderer_textures", "Textures" },
+        { "renderer_surfaces", "Surfaces" },
+        { "renderer_pipelines", "Pipelines" },
+        { "renderer_descriptors", "Descriptors" },
+        { "renderer_submit", "Submit/present" }
     };
     struct Settings {
         std::map<std::string, std::string> main = { { "title", "Settings" } };
@@ -531,7 +562,11 @@ struct LangState {
             { "cpu_backend", "CPU Backend" },
             { "select_cpu_backend", "Select your preferred CPU backend." },
             { "cpu_opt", "Enable optimizations" },
-            { "cpu_opt_description", "Check the box to enable additional CPU JIT optimizations." }
+            { "cpu_opt_description", "Check the box to enable additional CPU JIT optimizations." },
+            { "libc_fast_paths", "Host libc fast paths" },
+            { "libc_fast_paths_description", "Check the box to run the copies of memcpy, memset, strlen and strcmp found in the app on the host. Only enable it for apps known to work with it." },
+            { "slab_heap", "Thread-caching malloc" },
+            { "slab_heap_description", "Check the box to serve the malloc of the emulated libc from size classes cached by each thread. Speeds up apps allocating a lot from several threads, the allocation statistics are logged when the app exits." }
         };
         std::map<std::string, std::string> gpu = {
             { "reset", "Reset" },
@@ -554,6 +589,8 @@ struct LangState {
             { "export_textures", "Export Textures" },
             { "import_textures", "Import Textures" },
             { "texture_exporting_format", "Texture Exporting Format" },
+            { "pack_exported_textures", "Pack Exported Textures" },
+            { "pack_exported_textures_description", "Put the textures exported as DDS in a single texture pack file inside the import folder." },
             { "shaders", "Shaders" },
             { "shader_cache", "Use Shader Cache" },
             { "shader_cache_description", "Check the box to enable shader cache to pre-compile it at game startup.\nUncheck to disable this feature." },
@@ -17,7 +17,9 @@
 
 #include "interface.h"
 
+#include <app/boot_profile.h>
 #include <app/functions.h>
+#include <app/metrics.h>
 #include <config/functions.h>
 #include <config/version.h>
 #include <display/state.h>
@@ -31,6 +33,7 @@
 #include <packages/pkg.h>
 #include <packages/sfo.h>
 #include <renderer/functions.h>
+#include <renderer/profile.h>
 #include <renderer/shaders.h>
 #include <renderer/state.h>
 #include <shader/spirv_recompiler.h>
@@ -49,6 +52,7 @@
 #include <SDL.h>
 #include <chrono>
 #include <cstdlib>
+#include <future>
 #include <thread>
 #include <tracy/Tracy.hpp>
 
@@ -179,6 +183,10 @@ int main(int argc, char *argv[]) {
         SDL_SetHint(SDL_HINT_JOYSTICK_HIDAPI_SWITCH, "1");
         SDL_SetHint(SDL_HINT_JOYSTICK_HIDAPI_JOY_CONS, "1");
 
+        // the null renderer must also run on servers without any display
+        if (string_utils::toupper(cfg.backend_renderer) == "NULL")
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
         if (SDL_Init(SDL_INIT_GAMECONTROLLER | SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
             app::error_dialog("SDL initialisation failed.");
             return SDLInitFailed;
@@ -194,19 +202,28 @@ int main(int argc, char *argv[]) {
     if (cfg.run_app_path)
         run_type = app::AppRunType::Extracted;
 
-    if (!app::init(emuenv, cfg, root_paths)) {
-        app::error_dialog("Emulated environment initialization failed.", emuenv.window.get());
-        return 1;
+    {
+        BOOT_STAGE("Emulated environment init");
+        if (!app::init(emuenv, cfg, root_paths)) {
+            app::error_dialog("Emulated environment initialization failed.", emuenv.window.get());
+            return 1;
+        }
     }
 
     if (emuenv.cfg.controller_binds.empty() || (emuenv.cfg.controller_binds.size() != 15))
         gui::reset_controller_binding(emuenv);
 
-    init_libraries(emuenv);
+    {
+        BOOT_STAGE("Libraries init");
+        init_libraries(emuenv);
+    }
 
     GuiState gui;
     if (!cfg.console) {
-        gui::pre_init(gui, emuenv);
+        {
+            BOOT_STAGE("GUI pre init");
+            gui::pre_init(gui, emuenv);
+        }
         if (!emuenv.cfg.initial_setup) {
             while (!emuenv.cfg.initial_setup) {
                 if (handle_events(emuenv, gui)) {
@@ -220,9 +237,18 @@ int main(int argc, char *argv[]) {
             config::serialize_config(emuenv.cfg, emuenv.config_path);
             run_execv(argv, emuenv);
         }
+        BOOT_STAGE("GUI init");
         gui::init(gui, emuenv);
     }
 
+    if (cfg.replay_capture_path.has_value()) {
+        if (cfg.console) {
+            LOG_ERROR("GPU capture replay is not supported in console mode");
+            return InitConfigFailed;
+        }
+        return run_capture_replay(emuenv, gui, fs::path(*cfg.replay_capture_path));
+    }
+
     if (cfg.content_path.has_value()) {
         auto gui_ptr = cfg.console ? nullptr : &gui;
         const auto extention = string_utils::tolower(cfg.content_path->extension().string());
@@ -320,6 +346,9 @@ int main(int argc, char *argv[]) {
         return Success;
     }
 
+    // measures the whole boot of the app, up to the start of its main thread
+    app::BootStageTimer app_boot_timer("App boot");
+
     gui::set_config(gui, emuenv, emuenv.io.app_path);
 
     const auto APP_INDEX = gui::get_app_index(gui, emuenv.io.app_path);
@@ -367,6 +396,15 @@ int main(int argc, char *argv[]) {
             gui::draw_background(gui, emuenv);
     };
 
+    // the shader cache only needs the title id and the self name, it is read while the modules are loaded
+    const std::string boot_self_name = fs::path(!emuenv.cfg.self_path.empty() ? emuenv.cfg.self_path : EBOOT_PATH).filename().string();
+    emuenv.renderer->title_id = emuenv.io.title_id.c_str();
+    emuenv.renderer->self_name = boot_self_name.c_str();
+    auto shaders_cache_read = std::async(std::launch::async, [&emuenv]() {
+        BOOT_STAGE("Shaders cache reading");
+        return renderer::get_shaders_cache_hashs(*emuenv.renderer);
+    });
+
     int32_t main_module_id;
     {
         const auto err = load_app(main_module_id, emuenv, string_utils::utf_to_wide(emuenv.io.app_path));
@@ -375,28 +413,47 @@ int main(int argc, char *argv[]) {
     }
     gui.vita_area.information_bar = false;
 
-    // Pre-Compile Shaders
-    emuenv.renderer->title_id = emuenv.io.title_id.c_str();
+    const bool has_shaders_cache = shaders_cache_read.get();
     emuenv.renderer->self_name = emuenv.self_name.c_str();
-    if (renderer::get_shaders_cache_hashs(*emuenv.renderer) && cfg.shader_cache) {
+
+    // Pre-Compile Shaders
+    if (has_shaders_cache && cfg.shader_cache) {
+        BOOT_STAGE("Shaders pre-compilation");
         SDL_SetWindowTitle(emuenv.window.get(), fmt::format("{} | {} ({}) | Please wait, compiling shaders...", window_title, emuenv.current_app_title, emuenv.io.title_id).c_str());
-        for (const auto &hash : emuenv.renderer->shaders_cache_hashs) {
-            handle_events(emuenv, gui);
-            gui::draw_begin(gui, emuenv);
-            draw_app_background(gui, emuenv);
+        const uint32_t nb_warmup_tasks = emuenv.renderer->start_shader_warmup();
+        if (nb_warmup_tasks > 0) {
+            // the shaders and pipelines are built on worker threads, only display the progress
+            while (emuenv.renderer->programs_count_pre_compiled.load(std::memory_order_acquire) < nb_warmup_tasks) {
+                handle_events(emuenv, gui);
+                gui::draw_begin(gui, emuenv);
+                draw_app_background(gui, emuenv);
 
-            emuenv.renderer->precompile_shader(hash);
-            gui::draw_pre_compiling_shaders_progress(gui, emuenv, uint32_t(emuenv.renderer->shaders_cache_hashs.size()));
+                gui::draw_pre_compiling_shaders_progress(gui, emuenv, nb_warmup_tasks);
 
-            gui::draw_end(gui, emuenv.window.get());
-            emuenv.renderer->swap_window(emuenv.window.get());
+                gui::draw_end(gui, emuenv.window.get());
+                emuenv.renderer->swap_window(emuenv.window.get());
+            }
+        } else {
+            for (const auto &hash : emuenv.renderer->shaders_cache_hashs) {
+                handle_events(emuenv, gui);
+                gui::draw_begin(gui, emuenv);
+                draw_app_background(gui, emuenv);
+
+                emuenv.renderer->precompile_shader(hash);
+                gui::draw_pre_compiling_shaders_progress(gui, emuenv, uint32_t(emuenv.renderer->shaders_cache_hashs.size()));
+
+                gui::draw_end(gui, emuenv.window.get());
+                emuenv.renderer->swap_window(emuenv.window.get());
+            }
         }
     }
     {
+        BOOT_STAGE("App start");
         const auto err = run_app(emuenv, main_module_id);
         if (err != Success)
             return err;
     }
+    app_boot_timer.finish();
     SDL_SetWindowTitle(emuenv.window.get(), fmt::format("{} | {} ({}) | Please wait, loading...", window_title, emuenv.current_app_title, emuenv.io.title_id).c_str());
 
     while (handle_events(emuenv, gui) && (emuenv.frame_count == 0) && !emuenv.load_exec) {
@@ -417,8 +474,15 @@ int main(int argc, char *argv[]) {
         FrameMark; // Tracy - Frame end mark for game loading loop
     }
 
+    // the session is measured from its first frame, once the loading is done
+    app::start_metrics(emuenv);
+
     while (handle_events(emuenv, gui) && !emuenv.load_exec) {
         ZoneScopedN("Game rendering"); // Tracy - Track game rendering loop scope
+#ifdef RENDERER_FRAME_TIMERS
+        // the breakdown of the renderer is only measured while the performance overlay shows it
+        renderer::frame_timers.enabled.store(emuenv.cfg.performance_overlay && (emuenv.cfg.performance_overlay_detail == PerfomanceOverleyDetail::MAXIMUM), std::memory_order_relaxed);
+#endif
         // Driver acto!
         renderer::process_batches(*emuenv.renderer.get(), emuenv.renderer->features, emuenv.mem, emuenv.cfg);
 
@@ -427,6 +491,7 @@ int main(int argc, char *argv[]) {
         emuenv.renderer->render_frame(viewport_pos, viewport_size, emuenv.display, emuenv.gxm, emuenv.mem);
         // Calculate FPS
         app::calculate_fps(emuenv);
+        app::sample_metrics(emuenv);
 
         // Set shaders compiled display
         gui::set_shaders_compiled_display(gui, emuenv);
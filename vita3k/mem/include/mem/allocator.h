@@ -22,11 +22,18 @@
 #include <vector>
 
 struct BitmapAllocator {
+    // A set bit is a free slot, slot 0 of a word is its most significant bit
     std::vector<std::uint32_t> words;
+    // One bit per word, cleared only once the word is fully used. Writing to words directly is fine
+    // as long as it only takes slots, otherwise the search may skip the word.
+    std::vector<std::uint64_t> summary;
     std::size_t max_offset;
 
 protected:
     int force_fill(const std::uint32_t offset, const int size, const bool or_mode = false);
+    void update_summary(const std::size_t word_index);
+    std::size_t find_next_free(std::size_t bit) const;
+    std::size_t find_next_used(std::size_t bit) const;
 
 public:
     BitmapAllocator() = default;
@@ -41,4 +48,6 @@ public:
 
     // Count free bits in [offset, offset_end) (exclusive)
     int free_slot_count(const std::uint32_t offset, const std::uint32_t offset_end) const;
+    // Length of the longest run of free bits below max_offset
+    int largest_free_run() const;
 };
@@ -20,7 +20,13 @@
 #include <mem/block.h>
 #include <mem/util.h>
 
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
 struct MemState;
+struct MemNameUsage;
 
 typedef std::function<bool(uint8_t *addr, bool write)> AccessViolationHandler;
 
@@ -35,7 +41,7 @@ enum struct MemPerm {
     ReadWrite = ReadOnly | WriteOnly
 };
 
-bool init(MemState &state, const bool use_page_table);
+bool init(MemState &state, const bool use_page_table, const bool use_huge_pages = false, const bool use_write_watch = false, const bool use_page_merging = false);
 Address alloc(MemState &state, uint32_t size, const char *name, Address start_addr = user_main_memory_start);
 Address alloc_aligned(MemState &state, uint32_t size, const char *name, unsigned int alignment, Address start_addr = user_main_memory_start);
 void protect_inner(MemState &state, Address addr, uint32_t size, const MemPerm perm);
@@ -49,9 +55,28 @@ bool is_protecting(MemState &state, Address addr, MemPerm *perm = nullptr);
 bool is_valid_addr(const MemState &state, Address addr);
 bool is_valid_addr_range(const MemState &state, Address start, Address end);
 bool handle_access_violation(MemState &state, uint8_t *addr, bool write) noexcept;
+// Releases the protections of a range the host is about to access in bulk, calling each protected block once
+// like its first fault would instead of faulting on every page
+void prepare_host_access(MemState &state, Address addr, uint32_t size, bool write);
+// Write watch: guest writes recorded by the host kernel without protection faults, only valid if state.use_write_watch is set
+bool was_written(MemState &state, Address addr, uint32_t size);
+void reset_write_watch(MemState &state);
 Block alloc_block(MemState &mem, uint32_t size, const char *name, Address start_addr = user_main_memory_start);
 Address alloc_at(MemState &state, Address address, uint32_t size, const char *name);
 Address try_alloc_at(MemState &state, Address address, uint32_t size, const char *name);
+// Replaces the content of a range which was just allocated with a private copy-on-write mapping of a host file,
+// its pages are then only read from the file once accessed. The range and the offset must be page aligned,
+// the range is left zeroed on failure
+bool map_file(MemState &state, Address addr, uint32_t size, const std::string &path, uint64_t offset);
 void free(MemState &state, Address address);
 uint32_t mem_available(MemState &state);
+// Size in bytes of the largest block that can still be allocated
+uint32_t mem_largest_free_block(MemState &state);
+// Snapshot of the per-name accounting, sorted by bytes currently allocated
+std::vector<std::pair<std::string, MemNameUsage>> mem_usage_by_name(MemState &state);
 const char *mem_name(Address address, MemState &state);
+// Writes every allocated block with its content, skipping zero chunks and compressing the others
+bool save_snapshot(MemState &state, std::ostream &out);
+// Restores a snapshot written by save_snapshot. Its blocks must be free or allocated the same way,
+// the current blocks which are not in the snapshot are kept as is
+bool load_snapshot(MemState &state, std::istream &in);
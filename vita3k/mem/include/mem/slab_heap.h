@@ -0,0 +1,67 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#pragma once
+
+#include <mem/util.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Statistics of a size class of a SlabHeap, block_size is 0 for the blocks too large for every class
+struct SlabHeapStats {
+    uint32_t block_size = 0;
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes_in_use = 0;
+    uint32_t slabs = 0;
+};
+
+/**
+ * \brief Guest heap made of size classes, each thread allocating from its own cache of free blocks.
+ *
+ * The blocks are in guest memory, only the free lists are kept on the host so the guest can't corrupt them.
+ * The threads only take a lock when their cache of a size class is empty or full, then exchanging a batch
+ * of blocks with the heap. Blocks larger than the largest class are allocated in guest memory directly.
+ */
+class SlabHeap {
+public:
+    explicit SlabHeap(MemState &mem);
+    ~SlabHeap();
+    SlabHeap(const SlabHeap &) = delete;
+    SlabHeap &operator=(const SlabHeap &) = delete;
+
+    /// \return 0 if there is no guest memory left
+    Address alloc(uint32_t size, uint32_t alignment = 0);
+    /// \return False if the address was not allocated by this heap
+    bool free(Address address);
+    /// \return 0 if the address was not allocated by this heap
+    uint32_t usable_size(Address address);
+    /// The counters of the other threads are published each time they exchange blocks with the heap
+    std::vector<SlabHeapStats> stats();
+    void log_stats();
+
+    struct Shared;
+
+private:
+    std::shared_ptr<Shared> shared;
+};
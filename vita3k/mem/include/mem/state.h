@@ -21,12 +21,15 @@
 #include <mem/util.h>
 
 #include <array>
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
 
 struct AllocMemPage {
-    uint32_t allocated : 4;
+    uint32_t allocated : 3;
+    uint32_t file_mapped : 1; // part of the block is backed by a file, see map_file
     uint32_t size : 28;
 };
 
@@ -38,6 +41,14 @@ typedef std::unique_ptr<AllocMemPage[]> AllocPageTable;
 typedef std::unique_ptr<PagePtr[]> PageTable;
 typedef std::map<int, std::string> PageNameMap;
 
+struct MemNameUsage {
+    uint64_t allocated = 0; // bytes
+    uint64_t peak = 0; // bytes
+    uint32_t blocks = 0;
+};
+typedef std::map<std::string, MemNameUsage> MemNameUsageMap;
+typedef std::unique_ptr<std::atomic<uint8_t>[]> PageProtectionTable;
+
 struct ProtectBlockInfo {
     uint32_t size = 0;
     ProtectCallback callback;
@@ -65,17 +76,27 @@ struct MemExternalMapping {
 
 struct MemState {
     std::mutex generation_mutex;
-    std::mutex protect_mutex;
+    std::shared_mutex protect_mutex;
 
     uint32_t page_size = 0;
     Memory memory;
     AllocPageTable alloc_table;
     BitmapAllocator allocator;
     ProtectSegmentTrees protect_tree;
+    // One entry per page, non-zero while protect_inner may have restricted the host access to it.
+    // Written around every host protection change and read without protect_mutex by the fault handler.
+    PageProtectionTable page_protection;
 
     PageNameMap page_name_map;
+    // Accounting per allocation name, kept with page_name_map under generation_mutex
+    MemNameUsageMap name_usage;
 
     bool use_page_table = false;
     PageTable page_table;
+    bool use_huge_pages = false;
+    bool use_write_watch = false;
+    bool use_page_merging = false;
+    // /proc/self/pagemap, used to read the soft-dirty bits on Linux
+    int pagemap_fd = -1;
     std::map<uint64_t, MemExternalMapping, std::greater<uint64_t>> external_mapping;
 };
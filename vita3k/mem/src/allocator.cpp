@@ -17,9 +17,17 @@
 
 #include <mem/allocator.h>
 
+#include <algorithm>
+#include <bit>
+
+static std::size_t summary_size(const std::size_t word_count) {
+    return (word_count + 63) >> 6;
+}
+
 BitmapAllocator::BitmapAllocator(const std::size_t total_bits)
     : words((total_bits >> 5) + ((total_bits % 32 != 0) ? 1 : 0), 0xFFFFFFFF)
     , max_offset(total_bits) {
+    summary.resize(summary_size(words.size()), ~0ULL);
 }
 
 void BitmapAllocator::set_maximum(const std::size_t total_bits) {
@@ -27,10 +35,12 @@ void BitmapAllocator::set_maximum(const std::size_t total_bits) {
     const std::size_t total_after = (total_bits >> 5) + ((total_bits % 32 != 0) ? 1 : 0);
 
     words.resize(total_after);
+    summary.resize(summary_size(total_after), 0);
 
     if (total_after > total_before) {
         for (std::size_t i = total_before; i < total_after; i++) {
             words[i] = 0xFFFFFFFFU;
+            update_summary(i);
         }
     }
 
@@ -39,6 +49,65 @@ void BitmapAllocator::set_maximum(const std::size_t total_bits) {
 
 void BitmapAllocator::reset() {
     words.clear();
+    summary.clear();
+}
+
+void BitmapAllocator::update_summary(const std::size_t word_index) {
+    const std::uint64_t bit = 1ULL << (word_index & 63);
+    if (words[word_index] != 0)
+        summary[word_index >> 6] |= bit;
+    else
+        summary[word_index >> 6] &= ~bit;
+}
+
+// Returns the first free slot at or after bit, or the total slot count if there is none
+std::size_t BitmapAllocator::find_next_free(const std::size_t bit) const {
+    const std::size_t total_bits = words.size() << 5;
+    if (bit >= total_bits)
+        return total_bits;
+
+    std::size_t index = bit >> 5;
+    const std::uint32_t first = words[index] & (0xFFFFFFFFU >> (bit & 31));
+    if (first != 0)
+        return (index << 5) + std::countl_zero(first);
+
+    // Skip the fully used words 64 at a time with the summary
+    index++;
+    while (index < words.size()) {
+        std::uint64_t pending = summary[index >> 6] & (~0ULL << (index & 63));
+        if (pending == 0) {
+            index = ((index >> 6) + 1) << 6;
+            continue;
+        }
+
+        index = ((index >> 6) << 6) + std::countr_zero(pending);
+        if (index >= words.size())
+            break;
+        if (words[index] != 0)
+            return (index << 5) + std::countl_zero(words[index]);
+        index++;
+    }
+
+    return total_bits;
+}
+
+// Returns the first used slot at or after bit, or the total slot count if there is none
+std::size_t BitmapAllocator::find_next_used(const std::size_t bit) const {
+    const std::size_t total_bits = words.size() << 5;
+    if (bit >= total_bits)
+        return total_bits;
+
+    std::size_t index = bit >> 5;
+    const std::uint32_t first = ~words[index] & (0xFFFFFFFFU >> (bit & 31));
+    if (first != 0)
+        return (index << 5) + std::countl_zero(first);
+
+    for (index++; index < words.size(); index++) {
+        if (words[index] != 0xFFFFFFFFU)
+            return (index << 5) + std::countl_zero(~words[index]);
+    }
+
+    return total_bits;
 }
 
 int BitmapAllocator::force_fill(const std::uint32_t offset, const int size, const bool or_mode) {
@@ -57,6 +126,7 @@ int BitmapAllocator::force_fill(const std::uint32_t offset, const int size, cons
         } else {
             *word = wval & (~mask);
         }
+        update_summary(word - words.data());
 
         return std::min<int>(size, static_cast<int>((words.size() << 5) - set_bit));
     }
@@ -72,6 +142,7 @@ int BitmapAllocator::force_fill(const std::uint32_t offset, const int size, cons
         } else {
             *word = wval & (~mask);
         }
+        update_summary(word - words.data());
 
         word += 1;
 
@@ -101,75 +172,40 @@ int BitmapAllocator::allocate_from(const std::uint32_t start_offset, int &size,
         return -1;
     }
 
-    std::uint32_t *word = &words[0] + (start_offset >> 5);
-
-    // We have arrived at le word that still have free position (bit 1)
-    std::uint32_t *word_end = &words[words.size() - 1];
-
-    int bflmin = 0xFFFFFF;
-    int bofmin = -1;
-    std::uint32_t *wordmin = nullptr;
-
-    // Keep finding
-    while (word <= word_end) {
-        std::uint32_t wv = *word;
-
-        if (wv != 0) {
-            // Still have free stuff
-            int bflen = 0;
-            int boff = 0;
-            std::uint32_t *bword = nullptr;
-
-            int cursor = 31;
-
-            while (cursor >= 0) {
-                if (((wv >> cursor) & 1) == 1) {
-                    boff = cursor;
-                    bflen = 0;
-                    bword = word;
-
-                    while (cursor >= 0 && (((wv >> cursor) & 1) == 1)) {
-                        bflen++;
-                        cursor--;
-
-                        if (cursor < 0 && (word + 1 <= word_end)) {
-                            cursor = 31;
-                            word++;
-                            wv = *word;
-                        }
-                    }
-
-                    if (bflen >= size) {
-                        if (!best_fit) {
-                            // Force allocate and then return
-                            const int offset = static_cast<int>(31 - boff + ((bword - &words[0]) << 5));
-                            if ((static_cast<std::size_t>(offset) + size) <= max_offset) {
-                                size = force_fill(static_cast<const std::uint32_t>(offset), size, false);
-                                return offset;
-                            }
-                        } else {
-                            if (bflen < bflmin) {
-                                bflmin = bflen;
-                                bofmin = boff;
-                                wordmin = bword;
-                            }
-                        }
-                    }
+    const std::size_t total_bits = words.size() << 5;
+    std::size_t best_offset = total_bits;
+    std::size_t best_length = 0xFFFFFF;
+
+    // Walk the free runs starting from the word containing start_offset
+    std::size_t cursor = (start_offset >> 5) << 5;
+    while (cursor < total_bits) {
+        const std::size_t run_begin = find_next_free(cursor);
+        if (run_begin >= total_bits)
+            break;
+        const std::size_t run_end = find_next_used(run_begin);
+        const std::size_t run_length = run_end - run_begin;
+
+        if (run_length >= static_cast<std::size_t>(size)) {
+            if (!best_fit) {
+                if (run_begin + size <= max_offset) {
+                    // Force allocate and then return
+                    size = force_fill(static_cast<std::uint32_t>(run_begin), size, false);
+                    return static_cast<int>(run_begin);
                 }
-
-                cursor--;
+            } else if (run_length < best_length) {
+                best_length = run_length;
+                best_offset = run_begin;
             }
         }
 
-        word++;
+        cursor = run_end;
     }
 
-    if (best_fit && bofmin != -1) {
+    if (best_fit && best_offset != total_bits) {
         // Force allocate and then return
-        const int offset = static_cast<int>(31 - bofmin + ((wordmin - &words[0]) << 5));
-        if ((static_cast<std::size_t>(offset) + size) <= max_offset) {
-            size = force_fill(static_cast<std::uint32_t>(offset), size, false);
-            return offset;
+        if (best_offset + size <= max_offset) {
+            size = force_fill(static_cast<std::uint32_t>(best_offset), size, false);
+            return static_cast<int>(best_offset);
         }
     }
 
@@ -185,12 +221,6 @@ int BitmapAllocator::allocate_at(const std::uint32_t start_offset, int size) {
     return 0;
 }
 
-static int number_of_set_bits(std::uint32_t i) {
-    i = i - ((i >> 1) & 0x55555555);
-    i = (i & 0x33333333) + ((i >> 2) & 0x33333333);
-    return (((i + (i >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
-}
-
 int BitmapAllocator::free_slot_count(const std::uint32_t offset, const std::uint32_t offset_end) const {
     if (offset >= offset_end) {
         return -1;
@@ -214,10 +244,25 @@ int BitmapAllocator::free_slot_count(const std::uint32_t offset, const std::uint
         const int left_shift = start_bit & 31;
         const int right_shift = (31 - (next_end_bit - 1) & 31);
         std::uint32_t word_to_scan = words[start_bit >> 5] << left_shift >> right_shift >> left_shift;
-        free_count += number_of_set_bits(word_to_scan);
+        free_count += std::popcount(word_to_scan);
 
         start_bit = next_end_bit;
     }
 
     return free_count;
 }
+
+int BitmapAllocator::largest_free_run() const {
+    std::size_t largest = 0;
+    std::size_t cursor = 0;
+    while (cursor < max_offset) {
+        const std::size_t run_begin = find_next_free(cursor);
+        if (run_begin >= max_offset)
+            break;
+        const std::size_t run_end = std::min(find_next_used(run_begin), max_offset);
+        largest = std::max(largest, run_end - run_begin);
+        cursor = run_end;
+    }
+
+    return static_cast<int>(largest);
+}
@@ -26,20 +26,25 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <vector>
 
 #ifdef WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #else
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
 constexpr uint32_t STANDARD_PAGE_SIZE = KiB(4);
 constexpr size_t TOTAL_MEM_SIZE = GiB(4);
+// User CDRAM (0x60000000), user main phycont (0x70000000) and user main (0x80000000)
+constexpr Address HUGE_PAGE_REGION_START = 0x60000000;
+constexpr size_t HUGE_PAGE_REGION_SIZE = GiB(1);
 constexpr bool LOG_PROTECT = false;
-constexpr bool PAGE_NAME_TRACKING = false;
 
 // TODO: support multiple handlers
 static AccessViolationHandler access_violation_handler;
@@ -58,7 +63,93 @@ static std::string get_error_msg() {
 }
 #endif
 
-bool init(MemState &state, const bool use_page_table) {
+// Asks the host to back the guest user regions with 2 MiB pages where it can.
+// Transparent huge pages are used rather than MAP_HUGETLB so that allocations and protections keep
+// working on 4 KiB pages, the kernel splits a huge page again wherever the protection differs inside it.
+static bool enable_huge_pages(MemState &state) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (madvise(&state.memory[HUGE_PAGE_REGION_START], HUGE_PAGE_REGION_SIZE, MADV_HUGEPAGE) == -1) {
+        LOG_WARN("Transparent huge pages are not available, using regular pages: {}", get_error_msg());
+        return false;
+    }
+    return true;
+#else
+    // Windows large pages must be committed and locked all at once, which does not fit the reserve/commit
+    // model used by alloc_inner and protect_inner, and macOS only offers superpages to mach_vm_allocate
+    LOG_WARN("Huge pages are not supported on this platform, using regular pages");
+    return false;
+#endif
+}
+
+#ifdef __linux__
+static bool clear_soft_dirty() {
+    // Clears the soft-dirty bit of every page of the process, there is no per-range variant
+    const int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd == -1)
+        return false;
+    const bool success = write(fd, "4", 1) == 1;
+    close(fd);
+    return success;
+}
+
+// Reads the pagemap entries of the host pages covering the range in one go, an unreadable range counts as written
+static bool is_soft_dirty(MemState &state, Address addr, uint32_t size) {
+    constexpr uint64_t PAGEMAP_SOFT_DIRTY = 1ULL << 55;
+    static const uint64_t host_page_size = sysconf(_SC_PAGESIZE);
+
+    const uint64_t first_page = reinterpret_cast<uintptr_t>(&state.memory[addr]) / host_page_size;
+    const uint64_t last_page = (reinterpret_cast<uintptr_t>(&state.memory[addr]) + size - 1) / host_page_size;
+    std::vector<uint64_t> entries(last_page - first_page + 1);
+    const ssize_t entries_size = static_cast<ssize_t>(entries.size() * sizeof(uint64_t));
+    if (pread(state.pagemap_fd, entries.data(), entries_size, static_cast<off_t>(first_page * sizeof(uint64_t))) != entries_size)
+        return true;
+
+    return std::any_of(entries.begin(), entries.end(), [](uint64_t entry) { return entry & PAGEMAP_SOFT_DIRTY; });
+}
+#endif
+
+// Lets the kernel share the identical guest pages of several instances running on the same host (KSM on Linux).
+// Mostly useful to test farms running many instances of the same app, the scanning has a cpu cost.
+static bool enable_page_merging(MemState &state) {
+#if defined(__linux__) && defined(MADV_MERGEABLE)
+    if (madvise(state.memory.get(), TOTAL_MEM_SIZE, MADV_MERGEABLE) == -1) {
+        LOG_WARN("Guest pages can not be merged: {}", get_error_msg());
+        return false;
+    }
+    return true;
+#else
+    LOG_WARN("Page merging is not supported on this platform");
+    return false;
+#endif
+}
+
+// Soft-dirty bits on Linux, write watches on Windows (requested at reservation time)
+static bool enable_write_watch(MemState &state) {
+#ifdef WIN32
+    ULONG_PTR count = 0;
+    DWORD granularity = 0;
+    return GetWriteWatch(0, state.memory.get(), state.page_size, nullptr, &count, &granularity) == 0;
+#elif defined(__linux__)
+    state.pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+    if (state.pagemap_fd == -1 || !clear_soft_dirty()) {
+        LOG_WARN("Soft-dirty tracking is not available, using protection faults: {}", get_error_msg());
+        return false;
+    }
+
+    // Kernels built without CONFIG_MEM_SOFT_DIRTY accept clear_refs but never set the bit
+    const Address probe = alloc_inner(state, 1, 1, "write watch probe", true);
+    state.memory[probe] = 1;
+    const bool supported = is_soft_dirty(state, probe, 1);
+    free(state, probe);
+    LOG_WARN_IF(!supported, "Soft-dirty tracking is not supported by this kernel, using protection faults");
+    return supported;
+#else
+    LOG_WARN("Write watch is not supported on this platform, using protection faults");
+    return false;
+#endif
+}
+
+bool init(MemState &state, const bool use_page_table, const bool use_huge_pages, const bool use_write_watch, const bool use_page_merging) {
 #ifdef WIN32
     SYSTEM_INFO system_info = {};
     GetSystemInfo(&system_info);
@@ -74,10 +165,11 @@ bool init(MemState &state, const bool use_page_table) {
     void *preferred_address = reinterpret_cast<void *>(1ULL << 34);
 
 #ifdef WIN32
-    state.memory = Memory(static_cast<uint8_t *>(VirtualAlloc(preferred_address, TOTAL_MEM_SIZE, MEM_RESERVE, PAGE_NOACCESS)), delete_memory);
+    const DWORD reserve_flags = use_write_watch ? (MEM_RESERVE | MEM_WRITE_WATCH) : MEM_RESERVE;
+    state.memory = Memory(static_cast<uint8_t *>(VirtualAlloc(preferred_address, TOTAL_MEM_SIZE, reserve_flags, PAGE_NOACCESS)), delete_memory);
     if (!state.memory) {
         // fallback
-        state.memory = Memory(static_cast<uint8_t *>(VirtualAlloc(nullptr, TOTAL_MEM_SIZE, MEM_RESERVE, PAGE_NOACCESS)), delete_memory);
+        state.memory = Memory(static_cast<uint8_t *>(VirtualAlloc(nullptr, TOTAL_MEM_SIZE, reserve_flags, PAGE_NOACCESS)), delete_memory);
 
         if (!state.memory) {
             LOG_CRITICAL("VirtualAlloc failed: {}", get_error_msg());
@@ -98,9 +190,19 @@ bool init(MemState &state, const bool use_page_table) {
     }
 #endif
 
+    state.use_huge_pages = use_huge_pages && enable_huge_pages(state);
+    LOG_INFO_IF(state.use_huge_pages, "Guest user memory is backed by transparent huge pages");
+    // the kernel only merges regular pages, it splits the huge pages it finds identical parts in
+    LOG_WARN_IF(use_page_merging && state.use_huge_pages, "Page merging splits the huge pages of the guest memory");
+    state.use_page_merging = use_page_merging && enable_page_merging(state);
+    LOG_INFO_IF(state.use_page_merging, "Identical guest pages can be merged with the other instances");
+
     const size_t table_length = TOTAL_MEM_SIZE / state.page_size;
     state.alloc_table = AllocPageTable(new AllocMemPage[table_length]);
     memset(state.alloc_table.get(), 0, sizeof(AllocMemPage) * table_length);
+    state.page_protection = PageProtectionTable(new std::atomic<uint8_t>[table_length]);
+    for (size_t i = 0; i < table_length; i++)
+        state.page_protection[i].store(0, std::memory_order_relaxed);
 
     state.allocator.set_maximum(table_length);
 
@@ -111,6 +213,8 @@ bool init(MemState &state, const bool use_page_table) {
 
     const Address null_address = alloc_inner(state, 0, 1, "null", true);
     assert(null_address == 0);
+    // The null page is never accessible, faults on it must not take the already unprotected shortcut
+    state.page_protection[0] = 1;
 #ifdef WIN32
     DWORD old_protect = 0;
     const BOOL ret = VirtualProtect(state.memory.get(), state.page_size, PAGE_NOACCESS, &old_protect);
@@ -120,6 +224,11 @@ bool init(MemState &state, const bool use_page_table) {
     LOG_CRITICAL_IF(ret == -1, "mprotect failed: {}", get_error_msg());
 #endif
 
+    // External mappings redirect guest writes away from the watched memory
+    LOG_WARN_IF(use_write_watch && use_page_table, "Write watch cannot be used with a page table, using protection faults");
+    state.use_write_watch = use_write_watch && !use_page_table && enable_write_watch(state);
+    LOG_INFO_IF(state.use_write_watch, "Guest writes are tracked with write watch");
+
     state.use_page_table = use_page_table;
     if (use_page_table) {
         state.page_table = PageTable(new PagePtr[TOTAL_MEM_SIZE / KiB(4)]);
@@ -182,11 +291,14 @@ static Address alloc_inner(MemState &state, uint32_t start_page, int page_count,
     AllocMemPage &page = state.alloc_table[page_num];
     assert(!page.allocated);
     page.allocated = 1;
+    page.file_mapped = 0;
     page.size = page_count;
 
-    if (PAGE_NAME_TRACKING) {
-        state.page_name_map.emplace(page_num, name);
-    }
+    const auto [name_it, _] = state.page_name_map.emplace(page_num, name ? name : "");
+    MemNameUsage &usage = state.name_usage[name_it->second];
+    usage.allocated += size;
+    usage.peak = std::max(usage.peak, usage.allocated);
+    usage.blocks++;
 
     return addr;
 }
@@ -210,11 +322,25 @@ Address alloc_aligned(MemState &state, uint32_t size, const char *name, unsigned
         page.allocated = 0;
         align_page.allocated = 1;
         align_page.size = page.size - remnant_front;
+
+        auto name_node = state.page_name_map.extract(page_num);
+        state.name_usage[name_node.mapped()].allocated -= remnant_front * state.page_size;
+        name_node.key() = align_page_num;
+        state.page_name_map.insert(std::move(name_node));
     }
 
     return align_addr;
 }
 
+static void set_page_protection(MemState &state, Address addr, uint32_t size, bool is_protected) {
+    if (size == 0)
+        return;
+    const uint32_t first_page = addr / state.page_size;
+    const uint32_t last_page = (static_cast<uint64_t>(addr) + size - 1) / state.page_size;
+    for (uint32_t page = first_page; page <= last_page; page++)
+        state.page_protection[page].store(is_protected, std::memory_order_release);
+}
+
 static void align_to_page(MemState &state, Address &addr, Address &size) {
     const Address end = align(addr + size, state.page_size);
     addr = align_down(addr, state.page_size);
@@ -235,10 +361,14 @@ void unprotect_inner(MemState &state, Address addr, uint32_t size) {
     const int ret = mprotect(&addr_ptr[addr], size, PROT_READ | PROT_WRITE);
     LOG_CRITICAL_IF(ret == -1, "mprotect failed: {}", get_error_msg());
 #endif
+    // Only cleared once the host access is restored, so a reader seeing 0 can simply retry
+    set_page_protection(state, addr, size, false);
 }
 
 void protect_inner(MemState &state, Address addr, uint32_t size, const MemPerm perm) {
     uint8_t *addr_ptr = state.use_page_table ? state.page_table[addr / KiB(4)] : state.memory.get();
+    // Set before the host access is restricted, see unprotect_inner
+    set_page_protection(state, addr, size, perm != MemPerm::ReadWrite);
 
 #ifdef WIN32
     DWORD old_protect = 0;
@@ -250,12 +380,49 @@ void protect_inner(MemState &state, Address addr, uint32_t size, const MemPerm p
 #endif
 }
 
+// Shrinks a segment to the blocks it still protects once some of them were released, or removes it
+static void update_protect_segment(MemState &state, ProtectSegmentTrees::iterator it) {
+    ProtectSegmentInfo &info = it->second;
+    if (info.blocks.size() == 0) {
+        if (info.ref_count == 0) {
+            unprotect_inner(state, it->first, info.size);
+            state.protect_tree.erase(it);
+        }
+        return;
+    }
+
+    const Address previous_beg = it->first;
+    Address beg_region = info.blocks.begin()->first;
+    Address end_region = info.blocks.rbegin()->first + info.blocks.rbegin()->second.size;
+
+    beg_region = align_down(beg_region, state.page_size);
+    end_region = align(end_region, state.page_size);
+
+    if (beg_region != previous_beg) {
+        ProtectSegmentInfo new_info = std::move(info);
+        new_info.size = end_region - beg_region;
+
+        state.protect_tree.erase(it);
+        state.protect_tree.emplace(beg_region, std::move(new_info));
+    } else {
+        info.size = end_region - beg_region;
+    }
+}
+
 bool handle_access_violation(MemState &state, uint8_t *addr, bool write) noexcept {
     const uintptr_t memory_addr = reinterpret_cast<uintptr_t>(state.memory.get());
     const uintptr_t fault_addr = reinterpret_cast<uintptr_t>(addr);
 
+    // Fault storms usually hit pages another thread has just unprotected, those only need the access to be retried.
+    // This path does not take protect_mutex so that faults on unrelated pages don't queue behind each other.
+    if (fault_addr >= memory_addr && fault_addr < memory_addr + TOTAL_MEM_SIZE) {
+        const Address fault_vaddr = static_cast<Address>(fault_addr - memory_addr);
+        if (state.page_protection[fault_vaddr / state.page_size].load(std::memory_order_acquire) == 0 && is_valid_addr(state, fault_vaddr))
+            return true;
+    }
+
     Address vaddr = 0;
-    const std::unique_lock<std::mutex> lock(state.protect_mutex);
+    const std::unique_lock<std::shared_mutex> lock(state.protect_mutex);
     if (fault_addr < memory_addr || fault_addr >= memory_addr + TOTAL_MEM_SIZE) {
         if (state.use_page_table) {
             // this may come from an external mapping
@@ -296,7 +463,6 @@ bool handle_access_violation(MemState &state, uint8_t *addr, bool write) noexcep
         return true;
     }
 
-    Address previous_beg = it->first;
     for (auto ite = info.blocks.begin(); ite != info.blocks.end();) {
         if (vaddr >= ite->first && vaddr < ite->first + ite->second.size && ite->second.callback(vaddr, write)) {
             Address beg_unpr = align_down(ite->first, state.page_size);
@@ -309,32 +475,51 @@ bool handle_access_violation(MemState &state, uint8_t *addr, bool write) noexcep
         }
     }
 
-    if (info.blocks.size() == 0 && info.ref_count == 0) {
-        unprotect_inner(state, it->first, info.size);
-        state.protect_tree.erase(it);
-    } else {
-        Address beg_region = info.blocks.begin()->first;
-        Address end_region = info.blocks.rbegin()->first + info.blocks.rbegin()->second.size;
+    update_protect_segment(state, it);
+    return true;
+}
 
-        beg_region = align_down(beg_region, state.page_size);
-        end_region = align(end_region, state.page_size);
+void prepare_host_access(MemState &state, Address addr, uint32_t size, bool write) {
+    if (size == 0)
+        return;
+
+    const Address end = addr + size;
+    const std::unique_lock<std::shared_mutex> lock(state.protect_mutex);
+    // the tree is in reverse order, this is the last segment starting in the range
+    auto it = state.protect_tree.lower_bound(end - 1);
+    while (it != state.protect_tree.end() && it->first + it->second.size > addr) {
+        ProtectSegmentInfo &info = it->second;
+        const auto next = std::next(it);
+        // reads only fault on the segments which can not be read
+        if (!write && info.perm != MemPerm::None) {
+            it = next;
+            continue;
+        }
 
-        if (beg_region != previous_beg) {
-            ProtectSegmentInfo new_info = std::move(info);
-            new_info.size = end_region - beg_region;
+        bool released = false;
+        for (auto ite = info.blocks.begin(); ite != info.blocks.end();) {
+            const Address block_end = ite->first + ite->second.size;
+            if (ite->first < end && block_end > addr && ite->second.callback(std::max(ite->first, addr), write)) {
+                Address beg_unpr = align_down(ite->first, state.page_size);
+                Address end_unpr = align(block_end, state.page_size);
+                unprotect_inner(state, beg_unpr, end_unpr - beg_unpr);
 
-            state.protect_tree.erase(it);
-            state.protect_tree.emplace(beg_region, std::move(new_info));
-        } else {
-            info.size = end_region - beg_region;
+                ite = info.blocks.erase(ite);
+                released = true;
+            } else {
+                ite++;
+            }
         }
-    }
 
-    return true;
+        // the segment can only shrink, so the next one is still the segment before it
+        if (released)
+            update_protect_segment(state, it);
+        it = next;
+    }
 }
 
 bool add_protect(MemState &state, Address addr, const uint32_t size, const MemPerm perm, ProtectCallback callback) {
-    const std::lock_guard<std::mutex> lock(state.protect_mutex);
+    const std::lock_guard<std::shared_mutex> lock(state.protect_mutex);
     ProtectSegmentInfo protect(size, perm);
     align_to_page(state, addr, protect.size);
 
@@ -377,7 +562,7 @@ bool add_protect(MemState &state, Address addr, const uint32_t size, const MemPe
 }
 
 bool is_protecting(MemState &state, Address addr, MemPerm *perm) {
-    const std::lock_guard<std::mutex> lock(state.protect_mutex);
+    const std::shared_lock<std::shared_mutex> lock(state.protect_mutex);
     auto ite = state.protect_tree.lower_bound(addr);
 
     if (ite != state.protect_tree.end() && addr < ite->first + ite->second.size) {
@@ -391,7 +576,7 @@ bool is_protecting(MemState &state, Address addr, MemPerm *perm) {
 }
 
 void open_access_parent_protect_segment(MemState &state, Address addr) {
-    const std::lock_guard<std::mutex> lock(state.protect_mutex);
+    const std::lock_guard<std::shared_mutex> lock(state.protect_mutex);
     auto ite = state.protect_tree.lower_bound(addr);
 
     if (ite != state.protect_tree.end() && addr < ite->first + ite->second.size) {
@@ -405,7 +590,7 @@ void open_access_parent_protect_segment(MemState &state, Address addr) {
 }
 
 void close_access_parent_protect_segment(MemState &state, Address addr) {
-    const std::lock_guard<std::mutex> lock(state.protect_mutex);
+    const std::lock_guard<std::shared_mutex> lock(state.protect_mutex);
     auto ite = state.protect_tree.lower_bound(addr);
 
     if (ite != state.protect_tree.end()) {
@@ -441,7 +626,7 @@ void add_external_mapping(MemState &mem, Address addr, uint32_t size, uint8_t *a
     protect_inner(mem, addr, size, MemPerm::None);
     mem.page_table[addr / KiB(4)] = page_table_entry;
 
-    const std::unique_lock<std::mutex> lock(mem.protect_mutex);
+    const std::unique_lock<std::shared_mutex> lock(mem.protect_mutex);
     mem.external_mapping[addr_value] = { addr, size };
 }
 
@@ -449,7 +634,7 @@ void remove_external_mapping(MemState &mem, uint8_t *addr_ptr) {
     uint64_t addr_value = std::bit_cast<uint64_t>(addr_ptr);
     MemExternalMapping mapping;
     {
-        const std::unique_lock<std::mutex> lock(mem.protect_mutex);
+        const std::unique_lock<std::shared_mutex> lock(mem.protect_mutex);
         auto it = mem.external_mapping.find(addr_value);
         assert(it != mem.external_mapping.end());
 
@@ -460,7 +645,7 @@ void remove_external_mapping(MemState &mem, uint8_t *addr_ptr) {
     // remove all protections on this range
     unprotect_inner(mem, mapping.address, mapping.size);
     {
-        const std::unique_lock<std::mutex> lock(mem.protect_mutex);
+        const std::unique_lock<std::shared_mutex> lock(mem.protect_mutex);
         auto prot_it = mem.protect_tree.lower_bound(mapping.address);
         if (prot_it->first + prot_it->second.size <= mapping.address) {
             if (prot_it == mem.protect_tree.begin())
@@ -536,8 +721,12 @@ void free(MemState &state, Address address) {
     page.allocated = 0;
 
     state.allocator.free(page_num, page.size);
-    if (PAGE_NAME_TRACKING) {
-        state.page_name_map.erase(page_num);
+    const auto name_it = state.page_name_map.find(page_num);
+    if (name_it != state.page_name_map.end()) {
+        MemNameUsage &usage = state.name_usage[name_it->second];
+        usage.allocated -= static_cast<uint64_t>(page.size) * state.page_size;
+        usage.blocks--;
+        state.page_name_map.erase(name_it);
     }
 
     assert(!state.use_page_table || state.page_table[address / KiB(4)] == state.memory.get());
@@ -547,6 +736,14 @@ void free(MemState &state, Address address) {
     const BOOL ret = VirtualFree(memory, page.size * state.page_size, MEM_DECOMMIT);
     LOG_CRITICAL_IF(!ret, "VirtualFree failed: {}", get_error_msg());
 #else
+    if (page.file_mapped) {
+        // put back anonymous memory, dropping the pages would only make them read from the file again
+        const void *const anonymous = mmap(memory, page.size * state.page_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        LOG_CRITICAL_IF(anonymous == MAP_FAILED, "mmap failed: {}", get_error_msg());
+        if (state.use_page_merging)
+            madvise(memory, page.size * state.page_size, MADV_MERGEABLE);
+        return;
+    }
     int ret = mprotect(memory, page.size * state.page_size, PROT_NONE);
     LOG_CRITICAL_IF(ret == -1, "mprotect failed: {}", get_error_msg());
     ret = madvise(memory, page.size * state.page_size, MADV_DONTNEED);
@@ -554,15 +751,93 @@ void free(MemState &state, Address address) {
 #endif
 }
 
+bool map_file(MemState &state, Address addr, uint32_t size, const std::string &path, uint64_t offset) {
+#ifdef WIN32
+    // a view can only replace a part of the reservation if it was split with placeholders
+    return false;
+#else
+    if ((addr % state.page_size != 0) || (size % state.page_size != 0) || (offset % state.page_size != 0) || (size == 0))
+        return false;
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    // mapping past the end of the file would fault on access instead of reading zeros
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) == -1) || (static_cast<uint64_t>(file_stat.st_size) < offset + size)) {
+        close(fd);
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> lock(state.generation_mutex);
+    uint8_t *const memory = &state.memory[addr];
+    const void *const mapped = mmap(memory, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(offset));
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_WARN("Failed to map {} in guest memory: {}", path, get_error_msg());
+        // the previous mapping of the range may already be gone
+        const void *const anonymous = mmap(memory, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        LOG_CRITICAL_IF(anonymous == MAP_FAILED, "mmap failed: {}", get_error_msg());
+        return false;
+    }
+    if (state.use_page_merging)
+        madvise(memory, size, MADV_MERGEABLE);
+
+    // the block the range is in has to be found to remap it on free
+    uint32_t page_num = addr / state.page_size;
+    while (!state.alloc_table[page_num].allocated)
+        page_num--;
+    state.alloc_table[page_num].file_mapped = 1;
+    return true;
+#endif
+}
+
+bool was_written(MemState &state, Address addr, uint32_t size) {
+    if (size == 0)
+        return false;
+#ifdef WIN32
+    PVOID written_page = nullptr;
+    ULONG_PTR count = 1;
+    DWORD granularity = 0;
+    if (GetWriteWatch(0, &state.memory[addr], size, &written_page, &count, &granularity) != 0)
+        return true;
+    return count > 0;
+#elif defined(__linux__)
+    return is_soft_dirty(state, addr, size);
+#else
+    return true;
+#endif
+}
+
+void reset_write_watch(MemState &state) {
+#ifdef WIN32
+    ResetWriteWatch(state.memory.get(), TOTAL_MEM_SIZE);
+#elif defined(__linux__)
+    clear_soft_dirty();
+#endif
+}
+
 uint32_t mem_available(MemState &state) {
     return state.allocator.free_slot_count(0, state.allocator.max_offset) * state.page_size;
 }
 
-const char *mem_name(Address address, MemState &state) {
-    if (PAGE_NAME_TRACKING) {
-        return state.page_name_map.find(address / state.page_size)->second.c_str();
+uint32_t mem_largest_free_block(MemState &state) {
+    return state.allocator.largest_free_run() * state.page_size;
+}
+
+std::vector<std::pair<std::string, MemNameUsage>> mem_usage_by_name(MemState &state) {
+    std::vector<std::pair<std::string, MemNameUsage>> usage;
+    {
+        const std::lock_guard<std::mutex> lock(state.generation_mutex);
+        usage.assign(state.name_usage.begin(), state.name_usage.end());
     }
-    return "";
+    std::sort(usage.begin(), usage.end(), [](const auto &a, const auto &b) { return a.second.allocated > b.second.allocated; });
+    return usage;
+}
+
+const char *mem_name(Address address, MemState &state) {
+    const auto it = state.page_name_map.find(address / state.page_size);
+    return it != state.page_name_map.end() ? it->second.c_str() : "";
 }
 
 #ifdef WIN32
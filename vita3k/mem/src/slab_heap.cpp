@@ -0,0 +1,296 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <mem/functions.h>
+#include <mem/slab_heap.h>
+
+#include <util/log.h>
+
+#include <algorithm>
+
+// Slabs are aligned to their size so the class of a block is found from its address alone
+constexpr uint32_t SLAB_SIZE = KiB(64);
+// Slabs are taken from guest memory by groups, alloc_aligned pads every allocation with its alignment
+constexpr uint32_t SLAB_GROUP_SIZE = MiB(1);
+constexpr uint32_t SLAB_COUNT = static_cast<uint32_t>((1ULL << 32) / SLAB_SIZE);
+
+// Every class is a multiple of 16 bytes, which is the alignment of its blocks
+constexpr std::array<uint32_t, 14> SIZE_CLASSES = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048 };
+constexpr uint32_t MAX_CLASS_SIZE = SIZE_CLASSES.back();
+constexpr uint32_t CLASS_ALIGNMENT = 16;
+constexpr size_t CLASS_COUNT = SIZE_CLASSES.size();
+
+// A thread keeps at most CACHE_LIMIT free blocks of a class, it exchanges them with the heap CACHE_BATCH at a time
+constexpr size_t CACHE_LIMIT = 128;
+constexpr size_t CACHE_BATCH = 64;
+
+// Class of each size, in steps of 16 bytes
+static constexpr std::array<uint8_t, MAX_CLASS_SIZE / CLASS_ALIGNMENT + 1> CLASS_OF_SIZE = [] {
+    std::array<uint8_t, MAX_CLASS_SIZE / CLASS_ALIGNMENT + 1> classes{};
+    uint8_t size_class = 0;
+    for (size_t i = 0; i < classes.size(); i++) {
+        while (SIZE_CLASSES[size_class] < i * CLASS_ALIGNMENT)
+            size_class++;
+        classes[i] = size_class;
+    }
+    return classes;
+}();
+
+struct SizeClass {
+    std::mutex mutex;
+    std::vector<Address> free_blocks;
+    // published by the threads when they exchange blocks with the heap
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint32_t slabs = 0;
+};
+
+struct SlabHeap::Shared {
+    MemState &mem;
+    std::array<SizeClass, CLASS_COUNT> classes;
+    // class + 1 of each slab of the address space, 0 if the slab is not part of the heap
+    std::unique_ptr<std::atomic<uint8_t>[]> slab_classes;
+
+    std::mutex slabs_mutex;
+    std::vector<Address> slab_groups;
+    std::vector<Address> spare_slabs;
+
+    std::mutex large_mutex;
+    std::unordered_map<Address, uint32_t> large_blocks;
+    uint64_t large_allocations = 0;
+    uint64_t large_frees = 0;
+    uint64_t large_bytes = 0;
+
+    explicit Shared(MemState &mem)
+        : mem(mem)
+        , slab_classes(new std::atomic<uint8_t>[SLAB_COUNT]) {
+        for (uint32_t i = 0; i < SLAB_COUNT; i++)
+            slab_classes[i].store(0, std::memory_order_relaxed);
+    }
+};
+
+namespace {
+
+/**
+ * Free blocks of a thread for the heap it last used, given back to that heap when the thread exits.
+ * The heap state is shared with the caches so a thread exiting after the heap is destroyed is harmless.
+ */
+struct ThreadCache {
+    std::shared_ptr<SlabHeap::Shared> owner;
+    std::array<std::vector<Address>, CLASS_COUNT> blocks;
+    std::array<uint64_t, CLASS_COUNT> allocations{};
+    std::array<uint64_t, CLASS_COUNT> frees{};
+
+    ~ThreadCache() {
+        flush();
+    }
+
+    void publish(size_t size_class) {
+        SizeClass &heap_class = owner->classes[size_class];
+        heap_class.allocations += allocations[size_class];
+        heap_class.frees += frees[size_class];
+        allocations[size_class] = 0;
+        frees[size_class] = 0;
+    }
+
+    void flush() {
+        if (!owner)
+            return;
+        for (size_t size_class = 0; size_class < CLASS_COUNT; size_class++) {
+            SizeClass &heap_class = owner->classes[size_class];
+            const std::lock_guard<std::mutex> lock(heap_class.mutex);
+            heap_class.free_blocks.insert(heap_class.free_blocks.end(), blocks[size_class].begin(), blocks[size_class].end());
+            blocks[size_class].clear();
+            publish(size_class);
+        }
+        owner.reset();
+    }
+};
+
+// a guest thread runs on the same host thread for its whole life, so this is also the cache of the guest thread
+thread_local ThreadCache thread_cache;
+
+ThreadCache &get_thread_cache(const std::shared_ptr<SlabHeap::Shared> &shared) {
+    if (thread_cache.owner != shared) {
+        thread_cache.flush();
+        thread_cache.owner = shared;
+    }
+    return thread_cache;
+}
+
+} // namespace
+
+// Adds the blocks of a new slab to the free list of the class, the lock of the class must be held
+static bool add_slab(SlabHeap::Shared &shared, size_t size_class) {
+    Address slab;
+    {
+        const std::lock_guard<std::mutex> lock(shared.slabs_mutex);
+        if (shared.spare_slabs.empty()) {
+            const Address group = alloc_aligned(shared.mem, SLAB_GROUP_SIZE, "slab heap", SLAB_SIZE);
+            if (!group)
+                return false;
+            shared.slab_groups.push_back(group);
+            // in decreasing order so the slabs are handed out from the start of the group
+            for (uint32_t i = SLAB_GROUP_SIZE / SLAB_SIZE; i > 0; i--)
+                shared.spare_slabs.push_back(group + (i - 1) * SLAB_SIZE);
+        }
+        slab = shared.spare_slabs.back();
+        shared.spare_slabs.pop_back();
+    }
+    shared.slab_classes[slab / SLAB_SIZE].store(static_cast<uint8_t>(size_class + 1), std::memory_order_release);
+
+    // same for the blocks of the slab
+    const uint32_t block_size = SIZE_CLASSES[size_class];
+    SizeClass &heap_class = shared.classes[size_class];
+    for (uint32_t i = SLAB_SIZE / block_size; i > 0; i--)
+        heap_class.free_blocks.push_back(slab + (i - 1) * block_size);
+    heap_class.slabs++;
+    return true;
+}
+
+SlabHeap::SlabHeap(MemState &mem)
+    : shared(std::make_shared<Shared>(mem)) {
+}
+
+SlabHeap::~SlabHeap() {
+    if (thread_cache.owner == shared)
+        thread_cache.flush();
+
+    log_stats();
+
+    // the blocks still in the caches of the other threads are forgotten with the slabs
+    for (const Address group : shared->slab_groups)
+        ::free(shared->mem, group);
+    for (const auto &[address, _] : shared->large_blocks)
+        ::free(shared->mem, address);
+}
+
+Address SlabHeap::alloc(uint32_t size, uint32_t alignment) {
+    if ((size > MAX_CLASS_SIZE) || (alignment > CLASS_ALIGNMENT)) {
+        const Address address = alloc_aligned(shared->mem, size, "slab heap large block", alignment);
+        if (!address)
+            return 0;
+        const std::lock_guard<std::mutex> lock(shared->large_mutex);
+        shared->large_blocks.emplace(address, size);
+        shared->large_allocations++;
+        shared->large_bytes += size;
+        return address;
+    }
+
+    const size_t size_class = CLASS_OF_SIZE[(size + CLASS_ALIGNMENT - 1) / CLASS_ALIGNMENT];
+    ThreadCache &cache = get_thread_cache(shared);
+    std::vector<Address> &blocks = cache.blocks[size_class];
+    if (blocks.empty()) {
+        SizeClass &heap_class = shared->classes[size_class];
+        const std::lock_guard<std::mutex> lock(heap_class.mutex);
+        if (heap_class.free_blocks.empty() && !add_slab(*shared, size_class))
+            return 0;
+        const size_t count = std::min(CACHE_BATCH, heap_class.free_blocks.size());
+        blocks.insert(blocks.end(), heap_class.free_blocks.end() - count, heap_class.free_blocks.end());
+        heap_class.free_blocks.resize(heap_class.free_blocks.size() - count);
+        cache.publish(size_class);
+    }
+
+    const Address address = blocks.back();
+    blocks.pop_back();
+    cache.allocations[size_class]++;
+    return address;
+}
+
+bool SlabHeap::free(Address address) {
+    const uint8_t slab_class = shared->slab_classes[address / SLAB_SIZE].load(std::memory_order_acquire);
+    if (slab_class == 0) {
+        {
+            const std::lock_guard<std::mutex> lock(shared->large_mutex);
+            const auto it = shared->large_blocks.find(address);
+            if (it == shared->large_blocks.end())
+                return false;
+            shared->large_frees++;
+            shared->large_bytes -= it->second;
+            shared->large_blocks.erase(it);
+        }
+        ::free(shared->mem, address);
+        return true;
+    }
+
+    const size_t size_class = slab_class - 1;
+    if ((address % SLAB_SIZE) % SIZE_CLASSES[size_class] != 0)
+        return false;
+
+    ThreadCache &cache = get_thread_cache(shared);
+    std::vector<Address> &blocks = cache.blocks[size_class];
+    blocks.push_back(address);
+    cache.frees[size_class]++;
+    if (blocks.size() > CACHE_LIMIT) {
+        SizeClass &heap_class = shared->classes[size_class];
+        const std::lock_guard<std::mutex> lock(heap_class.mutex);
+        heap_class.free_blocks.insert(heap_class.free_blocks.end(), blocks.end() - CACHE_BATCH, blocks.end());
+        blocks.resize(blocks.size() - CACHE_BATCH);
+        cache.publish(size_class);
+    }
+    return true;
+}
+
+uint32_t SlabHeap::usable_size(Address address) {
+    const uint8_t slab_class = shared->slab_classes[address / SLAB_SIZE].load(std::memory_order_acquire);
+    if (slab_class != 0)
+        return SIZE_CLASSES[slab_class - 1];
+
+    const std::lock_guard<std::mutex> lock(shared->large_mutex);
+    const auto it = shared->large_blocks.find(address);
+    return (it == shared->large_blocks.end()) ? 0 : it->second;
+}
+
+std::vector<SlabHeapStats> SlabHeap::stats() {
+    std::vector<SlabHeapStats> result;
+    for (size_t size_class = 0; size_class < CLASS_COUNT; size_class++) {
+        SizeClass &heap_class = shared->classes[size_class];
+        SlabHeapStats stats;
+        stats.block_size = SIZE_CLASSES[size_class];
+        {
+            const std::lock_guard<std::mutex> lock(heap_class.mutex);
+            if (thread_cache.owner == shared)
+                thread_cache.publish(size_class);
+            stats.allocations = heap_class.allocations;
+            stats.frees = heap_class.frees;
+            stats.slabs = heap_class.slabs;
+        }
+        // the frees of a block can be published before its allocation
+        stats.bytes_in_use = (stats.allocations > stats.frees) ? (stats.allocations - stats.frees) * stats.block_size : 0;
+        result.push_back(stats);
+    }
+
+    const std::lock_guard<std::mutex> lock(shared->large_mutex);
+    SlabHeapStats large;
+    large.allocations = shared->large_allocations;
+    large.frees = shared->large_frees;
+    large.bytes_in_use = shared->large_bytes;
+    result.push_back(large);
+    return result;
+}
+
+void SlabHeap::log_stats() {
+    for (const SlabHeapStats &stats : stats()) {
+        if (stats.allocations == 0)
+            continue;
+        if (stats.block_size == 0)
+            LOG_INFO("Slab heap large blocks: {} allocations, {} frees, {} bytes in use", stats.allocations, stats.frees, stats.bytes_in_use);
+        else
+            LOG_INFO("Slab heap {} bytes blocks: {} allocations, {} frees, {} bytes in use, {} slabs", stats.block_size, stats.allocations, stats.frees, stats.bytes_in_use, stats.slabs);
+    }
+}
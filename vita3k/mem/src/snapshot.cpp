@@ -0,0 +1,271 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/functions.h>
+#include <mem/state.h>
+
+#include <util/log.h>
+
+#include <miniz.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Layout of a memory snapshot:
+// - header: magic, version, page size, block count
+// - one entry per allocated block: first page, page count, name
+// - the content of each block, in the same order, cut in chunks which are each either all zero, raw or deflated
+constexpr char SNAPSHOT_MAGIC[4] = { 'V', '3', 'K', 'M' };
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t SNAPSHOT_CHUNK_SIZE = KiB(256);
+
+enum class SnapshotChunk : uint8_t {
+    Zero,
+    Raw,
+    Deflate,
+};
+
+struct SnapshotBlock {
+    uint32_t page;
+    uint32_t page_count;
+    std::string name;
+};
+
+struct ChunkData {
+    uint8_t *memory;
+    uint32_t size;
+    SnapshotChunk type;
+    std::vector<uint8_t> data;
+};
+
+template <typename T>
+static void write_value(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_value(std::istream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+// Runs job(i) for every i in [0, count) on all the host cores
+template <typename Job>
+static void parallel_for(size_t count, Job job) {
+    const size_t thread_count = std::max<size_t>(std::min<size_t>(std::thread::hardware_concurrency(), count), 1);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; t++)
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < count; i += thread_count)
+                job(i);
+        });
+    for (size_t i = 0; i < count; i += thread_count)
+        job(i);
+    for (auto &thread : threads)
+        thread.join();
+}
+
+static bool is_zero(const uint8_t *data, size_t size) {
+    const uint64_t *words = reinterpret_cast<const uint64_t *>(data);
+    return std::all_of(words, words + size / sizeof(uint64_t), [](uint64_t word) { return word == 0; });
+}
+
+static std::vector<SnapshotBlock> get_allocated_blocks(const MemState &state) {
+    std::vector<SnapshotBlock> blocks;
+    // the null page is never accessible and is always allocated
+    for (uint32_t page = 1; page < state.allocator.max_offset;) {
+        const AllocMemPage &alloc_page = state.alloc_table[page];
+        if (!alloc_page.allocated) {
+            page++;
+            continue;
+        }
+        const auto name = state.page_name_map.find(page);
+        blocks.push_back({ page, alloc_page.size, name != state.page_name_map.end() ? name->second : "" });
+        page += alloc_page.size;
+    }
+    return blocks;
+}
+
+// Cut the blocks in the chunks which are compressed (or decompressed) together
+static std::vector<ChunkData> get_chunks(const MemState &state, const std::vector<SnapshotBlock> &blocks) {
+    std::vector<ChunkData> chunks;
+    for (const auto &block : blocks) {
+        uint8_t *const memory = &state.memory[static_cast<size_t>(block.page) * state.page_size];
+        const size_t size = static_cast<size_t>(block.page_count) * state.page_size;
+        for (size_t offset = 0; offset < size; offset += SNAPSHOT_CHUNK_SIZE)
+            chunks.push_back({ memory + offset, static_cast<uint32_t>(std::min<size_t>(SNAPSHOT_CHUNK_SIZE, size - offset)), SnapshotChunk::Zero, {} });
+    }
+    return chunks;
+}
+
+bool save_snapshot(MemState &state, std::ostream &out) {
+    const std::lock_guard<std::mutex> lock(state.generation_mutex);
+
+    const std::vector<SnapshotBlock> blocks = get_allocated_blocks(state);
+    out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    write_value(out, SNAPSHOT_VERSION);
+    write_value(out, state.page_size);
+    write_value(out, static_cast<uint32_t>(blocks.size()));
+    for (const auto &block : blocks) {
+        write_value(out, block.page);
+        write_value(out, block.page_count);
+        write_value(out, static_cast<uint32_t>(block.name.size()));
+        out.write(block.name.data(), block.name.size());
+    }
+
+    // chunks are compressed a batch at a time so the memory used stays small while the file is streamed
+    std::vector<ChunkData> chunks = get_chunks(state, blocks);
+    const size_t batch_size = std::max(std::thread::hardware_concurrency(), 1u) * 4;
+    for (size_t batch = 0; batch < chunks.size(); batch += batch_size) {
+        const size_t count = std::min(batch_size, chunks.size() - batch);
+        parallel_for(count, [&](size_t i) {
+            ChunkData &chunk = chunks[batch + i];
+            if (is_zero(chunk.memory, chunk.size))
+                return;
+
+            mz_ulong compressed_size = mz_compressBound(chunk.size);
+            chunk.data.resize(compressed_size);
+            if ((mz_compress2(chunk.data.data(), &compressed_size, chunk.memory, chunk.size, MZ_BEST_SPEED) == MZ_OK) && (compressed_size < chunk.size)) {
+                chunk.type = SnapshotChunk::Deflate;
+                chunk.data.resize(compressed_size);
+            } else {
+                chunk.type = SnapshotChunk::Raw;
+                chunk.data.assign(chunk.memory, chunk.memory + chunk.size);
+            }
+        });
+
+        for (size_t i = batch; i < batch + count; i++) {
+            write_value(out, chunks[i].type);
+            write_value(out, static_cast<uint32_t>(chunks[i].data.size()));
+            out.write(reinterpret_cast<const char *>(chunks[i].data.data()), chunks[i].data.size());
+            chunks[i].data = {};
+        }
+    }
+
+    if (!out) {
+        LOG_ERROR("Failed to write the memory snapshot");
+        return false;
+    }
+
+    return true;
+}
+
+bool load_snapshot(MemState &state, std::istream &in) {
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint32_t version = 0;
+    uint32_t page_size = 0;
+    uint32_t block_count = 0;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0
+        || !read_value(in, version) || !read_value(in, page_size) || !read_value(in, block_count)) {
+        LOG_ERROR("Invalid memory snapshot");
+        return false;
+    }
+    if ((version != SNAPSHOT_VERSION) || (page_size != state.page_size) || (block_count > state.allocator.max_offset)) {
+        LOG_ERROR("Memory snapshot version {} with page size {} is not supported", version, page_size);
+        return false;
+    }
+
+    std::vector<SnapshotBlock> blocks(block_count);
+    for (auto &block : blocks) {
+        uint32_t name_size = 0;
+        if (!read_value(in, block.page) || !read_value(in, block.page_count) || !read_value(in, name_size)) {
+            LOG_ERROR("Invalid memory snapshot");
+            return false;
+        }
+        block.name.resize(name_size);
+        in.read(block.name.data(), name_size);
+        if (!in || (block.page == 0) || (static_cast<uint64_t>(block.page) + block.page_count > state.allocator.max_offset)) {
+            LOG_ERROR("Invalid memory snapshot");
+            return false;
+        }
+    }
+
+    const std::lock_guard<std::mutex> lock(state.generation_mutex);
+
+    // the blocks must either be allocated the same way or be free, memory is only written once they all are checked
+    for (const auto &block : blocks) {
+        const AllocMemPage &alloc_page = state.alloc_table[block.page];
+        const bool same_block = alloc_page.allocated && (alloc_page.size == block.page_count);
+        if (!same_block && (state.allocator.free_slot_count(block.page, block.page + block.page_count) != static_cast<int>(block.page_count))) {
+            LOG_ERROR("Memory snapshot block {} at page {} overlaps another allocation", block.name, block.page);
+            return false;
+        }
+    }
+    for (const auto &block : blocks) {
+        if (!state.alloc_table[block.page].allocated)
+            try_alloc_at(state, block.page * state.page_size, block.page_count * state.page_size, block.name.c_str());
+    }
+
+    std::vector<ChunkData> chunks = get_chunks(state, blocks);
+    const size_t batch_size = std::max(std::thread::hardware_concurrency(), 1u) * 4;
+    bool success = true;
+    for (size_t batch = 0; (batch < chunks.size()) && success; batch += batch_size) {
+        const size_t count = std::min(batch_size, chunks.size() - batch);
+        for (size_t i = batch; i < batch + count; i++) {
+            uint32_t data_size = 0;
+            if (!read_value(in, chunks[i].type) || !read_value(in, data_size) || (data_size > mz_compressBound(chunks[i].size))) {
+                success = false;
+                break;
+            }
+            chunks[i].data.resize(data_size);
+            in.read(reinterpret_cast<char *>(chunks[i].data.data()), data_size);
+        }
+        if (!in || !success) {
+            success = false;
+            break;
+        }
+
+        std::atomic<bool> batch_success = true;
+        parallel_for(count, [&](size_t i) {
+            ChunkData &chunk = chunks[batch + i];
+            switch (chunk.type) {
+            case SnapshotChunk::Zero:
+                memset(chunk.memory, 0, chunk.size);
+                break;
+            case SnapshotChunk::Raw:
+                if (chunk.data.size() == chunk.size)
+                    memcpy(chunk.memory, chunk.data.data(), chunk.size);
+                else
+                    batch_success = false;
+                break;
+            case SnapshotChunk::Deflate: {
+                mz_ulong size = chunk.size;
+                if ((mz_uncompress(chunk.memory, &size, chunk.data.data(), chunk.data.size()) != MZ_OK) || (size != chunk.size))
+                    batch_success = false;
+                break;
+            }
+            default:
+                batch_success = false;
+                break;
+            }
+            chunk.data = {};
+        });
+        success = batch_success;
+    }
+
+    if (!success) {
+        LOG_ERROR("Memory snapshot is truncated or corrupted, guest memory is partially restored");
+        return false;
+    }
+
+    return true;
+}
@@ -15,7 +15,9 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <chrono>
 #include <list>
+#include <string>
 #include <mem/allocator.h>
 #include <mem/util.h>
 
@@ -243,3 +245,34 @@ TEST(bitmap_allocator, count_unaligned) {
     // 4 valid bits + 12 bits + 5 valid bits = 21
     ASSERT_EQ(alloc.free_slot_count(22, 92), 21);
 }
+
+// Micro-benchmark: a guest-sized heap (one slot per 4 KiB page) fragmented into small free holes,
+// every large allocation has to skip all of them to reach the free tail
+TEST(bitmap_allocator, fragmented_heap_benchmark) {
+    constexpr int SLOT_COUNT = GiB(4) / KiB(4);
+    constexpr int HOLE_STRIDE = 64;
+    constexpr int ALLOCATION_COUNT = 200;
+    constexpr int ALLOCATION_SIZE = 256;
+
+    BitmapAllocator allocator(SLOT_COUNT);
+    int fragmented_size = SLOT_COUNT / 2;
+    ASSERT_EQ(allocator.allocate_from(0, fragmented_size), 0);
+    for (int i = 0; i < SLOT_COUNT / 2; i += HOLE_STRIDE)
+        allocator.free(i, 2);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ALLOCATION_COUNT; i++) {
+        int size = ALLOCATION_SIZE;
+        ASSERT_EQ(allocator.allocate_from(0, size), SLOT_COUNT / 2 + i * ALLOCATION_SIZE);
+        ASSERT_EQ(size, ALLOCATION_SIZE);
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    // the holes are still found by small allocations
+    int size = 2;
+    ASSERT_EQ(allocator.allocate_from(0, size), 0);
+    size = 2;
+    ASSERT_EQ(allocator.allocate_from(0, size, true), HOLE_STRIDE);
+
+    RecordProperty("allocate_from_us", std::to_string(elapsed.count() / ALLOCATION_COUNT));
+}
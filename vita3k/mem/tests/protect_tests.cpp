@@ -0,0 +1,58 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/functions.h>
+#include <mem/state.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+TEST(mem_protect, prepare_host_access_calls_each_block_once) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    const Address texture = alloc(mem, KiB(64), "texture");
+    const Address surface = alloc(mem, KiB(64), "surface");
+    int texture_calls = 0;
+    int surface_calls = 0;
+    add_protect(mem, texture, KiB(64), MemPerm::ReadOnly, [&](Address, bool) {
+        texture_calls++;
+        return true;
+    });
+    add_protect(mem, surface, KiB(64), MemPerm::None, [&](Address, bool) {
+        surface_calls++;
+        return true;
+    });
+
+    // reading a read only protection does not need to release it
+    prepare_host_access(mem, texture, KiB(64), false);
+    EXPECT_EQ(texture_calls, 0);
+    EXPECT_TRUE(is_protecting(mem, texture));
+
+    prepare_host_access(mem, surface + KiB(4), KiB(32), false);
+    EXPECT_EQ(surface_calls, 1);
+    EXPECT_FALSE(is_protecting(mem, surface));
+
+    prepare_host_access(mem, texture, KiB(64), true);
+    EXPECT_EQ(texture_calls, 1);
+    EXPECT_FALSE(is_protecting(mem, texture));
+
+    // the whole range is accessible without any fault
+    memset(&mem.memory[texture], 0xAB, KiB(64));
+    EXPECT_EQ(mem.memory[texture + KiB(63)], 0xAB);
+}
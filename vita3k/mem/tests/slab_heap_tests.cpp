@@ -0,0 +1,94 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <mem/functions.h>
+#include <mem/slab_heap.h>
+#include <mem/state.h>
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST(slab_heap, blocks_are_distinct_and_reused) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    SlabHeap heap(mem);
+
+    std::set<Address> blocks;
+    for (uint32_t i = 0; i < 4000; i++) {
+        const uint32_t size = i % 3000;
+        const Address address = heap.alloc(size);
+        ASSERT_NE(address, 0u);
+        EXPECT_TRUE(is_valid_addr(mem, address));
+        EXPECT_GE(heap.usable_size(address), size);
+        EXPECT_TRUE(blocks.insert(address).second);
+        if (size <= 2048)
+            EXPECT_EQ(address % 16, 0u);
+    }
+
+    const Address aligned = heap.alloc(100, 256);
+    EXPECT_EQ(aligned % 256, 0u);
+    EXPECT_TRUE(heap.free(aligned));
+    for (const Address address : blocks)
+        EXPECT_TRUE(heap.free(address));
+    // not allocated by the heap
+    EXPECT_FALSE(heap.free(alloc(mem, 16, "other")));
+
+    // a freed small block is handed out again by the same thread
+    const Address first = heap.alloc(40);
+    heap.free(first);
+    EXPECT_EQ(heap.alloc(40), first);
+}
+
+TEST(slab_heap, threads_share_the_heap) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+    SlabHeap heap(mem);
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; t++) {
+        threads.emplace_back([&heap, &mem, t] {
+            std::vector<Address> blocks;
+            for (uint32_t round = 0; round < 50; round++) {
+                for (uint32_t i = 0; i < 300; i++) {
+                    const Address address = heap.alloc((i * 7 + t) % 600);
+                    mem.memory[address] = static_cast<uint8_t>(t);
+                    blocks.push_back(address);
+                }
+                for (const Address address : blocks) {
+                    EXPECT_EQ(mem.memory[address], t);
+                    EXPECT_TRUE(heap.free(address));
+                }
+                blocks.clear();
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    // the caches of the threads are given back when they exit
+    uint64_t allocations = 0;
+    for (const SlabHeapStats &stats : heap.stats()) {
+        allocations += stats.allocations;
+        EXPECT_EQ(stats.allocations, stats.frees);
+        EXPECT_EQ(stats.bytes_in_use, 0u);
+    }
+    EXPECT_EQ(allocations, 4u * 50 * 300);
+}
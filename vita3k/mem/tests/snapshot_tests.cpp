@@ -0,0 +1,70 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/functions.h>
+#include <mem/state.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sstream>
+
+TEST(mem_snapshot, restores_content_and_allocations) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    const Address sparse = alloc(mem, MiB(4), "sparse");
+    const Address dense = alloc(mem, KiB(300), "dense");
+    for (uint32_t i = 0; i < MiB(4); i += KiB(64))
+        mem.memory[sparse + i] = static_cast<uint8_t>(i / KiB(64));
+    for (uint32_t i = 0; i < KiB(300); i++)
+        mem.memory[dense + i] = static_cast<uint8_t>(i * 2654435761u >> 13);
+
+    std::stringstream snapshot;
+    ASSERT_TRUE(save_snapshot(mem, snapshot));
+    // zero chunks are skipped and the others are compressed
+    EXPECT_LT(snapshot.str().size(), KiB(300));
+
+    std::vector<uint8_t> dense_copy(&mem.memory[dense], &mem.memory[dense] + KiB(300));
+    mem.memory[sparse + KiB(64)] = 0xFF;
+    mem.memory[dense] ^= 1;
+    const Address later = alloc(mem, KiB(4), "later");
+
+    ASSERT_TRUE(load_snapshot(mem, snapshot));
+    EXPECT_EQ(mem.memory[sparse + KiB(64)], 1);
+    EXPECT_EQ(memcmp(&mem.memory[dense], dense_copy.data(), dense_copy.size()), 0);
+    // blocks allocated after the snapshot are kept
+    EXPECT_TRUE(is_valid_addr(mem, later));
+
+    // a snapshot can also be loaded in a memory state with none of its blocks
+    MemState other;
+    ASSERT_TRUE(init(other, false));
+    snapshot.clear();
+    snapshot.seekg(0);
+    ASSERT_TRUE(load_snapshot(other, snapshot));
+    EXPECT_TRUE(is_valid_addr(other, sparse));
+    EXPECT_STREQ(mem_name(dense, other), "dense");
+    EXPECT_EQ(memcmp(&other.memory[dense], dense_copy.data(), dense_copy.size()), 0);
+}
+
+TEST(mem_snapshot, rejects_invalid_data) {
+    MemState mem;
+    ASSERT_TRUE(init(mem, false));
+
+    std::stringstream invalid("not a snapshot");
+    EXPECT_FALSE(load_snapshot(mem, invalid));
+}
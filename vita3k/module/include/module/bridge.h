@@ -30,33 +30,66 @@
 #include <config/state.h>
 #include <emuenv/state.h>
 
-using ImportFn = std::function<void(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id)>;
+#include <algorithm>
+
+// Plain function pointer generated for each export, so calling an import needs no type erased wrapper
+using ImportFn = void (*)(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id);
 using ImportVarFactory = std::function<Address(EmuEnvState &emuenv)>;
 
-// Function returns a value that is written to CPU registers.
-template <typename Ret, typename... Args, size_t... indices>
-std::enable_if_t<!std::is_same_v<Ret, void>> call(Ret (*export_fn)(EmuEnvState &, SceUID, const char *, Args...), const char *export_name, const ArgsLayout<Args...> &args_layout, const LayoutArgsState &state, std::index_sequence<indices...>, SceUID thread_id, CPUState &cpu, EmuEnvState &emuenv) {
-    const Ret ret = (*export_fn)(emuenv, thread_id, export_name, read<Args, indices, Args...>(cpu, args_layout, state, emuenv.mem)...);
-    write_return_value(cpu, ret);
-}
+struct HleExport {
+    ImportFn fn = nullptr;
+    // Never waits, reschedules, runs guest code or changes the guest code, so it can be called while the cpu runs
+    bool nonblocking = false;
+};
 
-// Function does not return a value.
-template <typename... Args, size_t... indices>
-void call(void (*export_fn)(EmuEnvState &, SceUID, const char *, Args...), const char *export_name, const ArgsLayout<Args...> &args_layout, const LayoutArgsState &state, std::index_sequence<indices...>, SceUID thread_id, CPUState &cpu, EmuEnvState &emuenv) {
-    (*export_fn)(emuenv, thread_id, export_name, read<Args, indices, Args...>(cpu, args_layout, state, emuenv.mem)...);
-}
+// Name of an export given as template argument, so it is known at compile time like the export itself
+template <size_t N>
+struct ExportName {
+    constexpr ExportName(const char (&name)[N]) {
+        std::copy_n(name, N, value);
+    }
+
+    char value[N];
+};
+
+template <auto export_fn, typename ExportFn = decltype(export_fn)>
+struct ExportBridge;
 
-template <typename Ret, typename... Args>
-ImportFn bridge(Ret (*export_fn)(EmuEnvState &, SceUID, const char *, Args...), const char *export_name) {
-    constexpr std::tuple<ArgsLayout<Args...>, LayoutArgsState> args_layout = lay_out<typename BridgeTypes<Args>::ArmType...>();
+template <auto export_fn, typename Ret, typename... Args>
+struct ExportBridge<export_fn, Ret (*)(EmuEnvState &, SceUID, const char *, Args...)> {
+    static constexpr std::tuple<ArgsLayout<Args...>, LayoutArgsState> args_layout = lay_out<typename BridgeTypes<Args>::ArmType...>();
 
-    return [export_fn, export_name, args_layout](EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id) {
+    // The layout is a constant of this instantiation, the location of each argument is folded away
+    // and only the register or stack reads are left
+    template <size_t... indices>
+    static void call(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id, const char *export_name, std::index_sequence<indices...>) {
+        if constexpr (std::is_same_v<Ret, void>) {
+            export_fn(emuenv, thread_id, export_name, read<Args, indices, Args...>(cpu, std::get<0>(args_layout), std::get<1>(args_layout), emuenv.mem)...);
+        } else {
+            // Function returns a value that is written to CPU registers.
+            const Ret ret = export_fn(emuenv, thread_id, export_name, read<Args, indices, Args...>(cpu, std::get<0>(args_layout), std::get<1>(args_layout), emuenv.mem)...);
+            write_return_value(cpu, ret);
+        }
+    }
+
+    static void call(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id, const char *export_name) {
+        call(emuenv, cpu, thread_id, export_name, std::index_sequence_for<Args...>());
+    }
+};
+
+template <auto export_fn, ExportName export_name>
+void bridge(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id) {
 #ifdef TRACY_ENABLE
-        ZoneNamedC(___tracy_scoped_zone, 0xFFF34C, emuenv.cfg.tracy_primitive_impl); // Tracy - Track function scope and set color to yellow
-        ZoneNameV(___tracy_scoped_zone, export_name, strlen(export_name)); // Tracy - Edit scope name based on export_name
+    ZoneNamedC(___tracy_scoped_zone, 0xFFF34C, emuenv.cfg.tracy_primitive_impl); // Tracy - Track function scope and set color to yellow
+    ZoneNameV(___tracy_scoped_zone, export_name.value, sizeof(export_name.value) - 1); // Tracy - Edit scope name based on export_name
 #endif
 
-        using Indices = std::index_sequence_for<Args...>;
-        call(export_fn, export_name, std::get<0>(args_layout), std::get<1>(args_layout), Indices(), thread_id, cpu, emuenv);
-    };
+    ExportBridge<export_fn>::call(emuenv, cpu, thread_id, export_name.value);
+}
+
+// Same as bridge without the Tracy zone, for tiny functions called so often that tracking them would
+// cost more than the call itself
+template <auto export_fn, ExportName export_name>
+void bridge_leaf(EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id) {
+    ExportBridge<export_fn>::call(emuenv, cpu, thread_id, export_name.value);
 }
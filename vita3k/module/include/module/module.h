@@ -36,9 +36,22 @@
 #define CALL_EXPORT(name, ...) export_##name(emuenv, thread_id, #name, ##__VA_ARGS__)
 
 #define DECL_EXPORT(ret, name, ...) ret export_##name(EmuEnvState &emuenv, SceUID thread_id, const char *export_name, ##__VA_ARGS__)
-#define EXPORT(ret, name, ...)                                           \
-    DECL_EXPORT(ret, name, ##__VA_ARGS__);                               \
-    extern const ImportFn import_##name = bridge(&export_##name, #name); \
+#define EXPORT(ret, name, ...)                                                        \
+    DECL_EXPORT(ret, name, ##__VA_ARGS__);                                            \
+    extern const HleExport import_##name = { &bridge<&export_##name, #name>, false }; \
+    DECL_EXPORT(ret, name, ##__VA_ARGS__)
+
+// For exports which never block, see HleExport::nonblocking
+#define NONBLOCKING_EXPORT(ret, name, ...)                                           \
+    DECL_EXPORT(ret, name, ##__VA_ARGS__);                                           \
+    extern const HleExport import_##name = { &bridge<&export_##name, #name>, true }; \
+    DECL_EXPORT(ret, name, ##__VA_ARGS__)
+
+// For the hot leaf functions like the libc string and memory ones, which are also non blocking.
+// Their body must not use TRACY_FUNC either
+#define LEAF_EXPORT(ret, name, ...)                                                       \
+    DECL_EXPORT(ret, name, ##__VA_ARGS__);                                                \
+    extern const HleExport import_##name = { &bridge_leaf<&export_##name, #name>, true }; \
     DECL_EXPORT(ret, name, ##__VA_ARGS__)
 
 #define DECL_VAR_EXPORT(name) Address export_##name(EmuEnvState &emuenv)
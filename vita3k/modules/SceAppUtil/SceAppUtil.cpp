@@ -306,9 +306,7 @@ EXPORT(int, sceAppUtilSaveDataDataSave, SceAppUtilSaveDataFileSlot *slot, SceApp
         modified_time.minute = local.tm_min;
         modified_time.second = local.tm_sec;
         slot->slotParam.get(emuenv.mem)->modifiedTime = modified_time;
-        fd = open_file(emuenv.io, construct_slotparam_path(slot->id).c_str(), SCE_O_WRONLY | SCE_O_CREAT, emuenv.pref_path.wstring(), export_name);
-        write_file(fd, slot->slotParam.get(emuenv.mem), sizeof(SceAppUtilSaveDataSlotParam), emuenv.io, export_name);
-        close_file(emuenv.io, fd, export_name);
+        write_file_deferred(emuenv.io, construct_slotparam_path(slot->id).c_str(), slot->slotParam.get(emuenv.mem), sizeof(SceAppUtilSaveDataSlotParam), emuenv.pref_path.wstring(), export_name);
     }
 
     return 0;
@@ -328,9 +326,7 @@ EXPORT(int, sceAppUtilSaveDataMount) {
 
 EXPORT(int, sceAppUtilSaveDataSlotCreate, unsigned int slotId, SceAppUtilSaveDataSlotParam *param, SceAppUtilMountPoint *mountPoint) {
     TRACY_FUNC(sceAppUtilSaveDataSlotCreate, slotId, param, mountPoint);
-    const auto fd = open_file(emuenv.io, construct_slotparam_path(slotId).c_str(), SCE_O_WRONLY | SCE_O_CREAT, emuenv.pref_path.wstring(), export_name);
-    write_file(fd, param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.io, export_name);
-    close_file(emuenv.io, fd, export_name);
+    write_file_deferred(emuenv.io, construct_slotparam_path(slotId).c_str(), param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.pref_path.wstring(), export_name);
     return 0;
 }
 
@@ -342,11 +338,8 @@ EXPORT(int, sceAppUtilSaveDataSlotDelete, unsigned int slotId, SceAppUtilMountPo
 
 EXPORT(int, sceAppUtilSaveDataSlotGetParam, unsigned int slotId, SceAppUtilSaveDataSlotParam *param, SceAppUtilMountPoint *mountPoint) {
     TRACY_FUNC(sceAppUtilSaveDataSlotGetParam, slotId, param, mountPoint);
-    const auto fd = open_file(emuenv.io, construct_slotparam_path(slotId).c_str(), SCE_O_RDONLY, emuenv.pref_path.wstring(), export_name);
-    if (fd < 0)
+    if (read_savedata_slot_file(emuenv.io, construct_slotparam_path(slotId).c_str(), param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.pref_path.wstring(), export_name) < 0)
         return RET_ERROR(SCE_APPUTIL_ERROR_SAVEDATA_SLOT_NOT_FOUND);
-    read_file(param, emuenv.io, fd, sizeof(SceAppUtilSaveDataSlotParam), export_name);
-    close_file(emuenv.io, fd, export_name);
     param->status = 0;
     return 0;
 }
@@ -372,14 +365,13 @@ EXPORT(SceInt32, sceAppUtilSaveDataSlotSearch, SceAppUtilWorkBuffer *workBuf, co
             slotList[i].emptyParam = Ptr<SceAppUtilSaveDataSlotEmptyParam>(0);
         }
 
-        const auto fd = open_file(emuenv.io, construct_slotparam_path(i).c_str(), SCE_O_RDONLY, emuenv.pref_path.wstring(), export_name);
+        // the slot files are read from the slot index, the directory is only listed by the first search
+        SceAppUtilSaveDataSlotParam param{};
+        const bool exists = read_savedata_slot_file(emuenv.io, construct_slotparam_path(i).c_str(), &param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.pref_path.wstring(), export_name) >= 0;
         switch (cond->type) {
         case SCE_APPUTIL_SAVEDATA_SLOT_SEARCH_TYPE_EXIST_SLOT:
-            if (fd > 0) {
+            if (exists) {
                 if (slotList) {
-                    SceAppUtilSaveDataSlotParam param;
-                    memset(&param, 0, sizeof(SceAppUtilSaveDataSlotParam));
-                    read_file(&param, emuenv.io, fd, sizeof(SceAppUtilSaveDataSlotParam), export_name);
                     slotList[result->hitNum].userParam = param.userParam;
                     slotList[result->hitNum].status = param.status;
                     slotList[result->hitNum].id = i;
@@ -388,7 +380,7 @@ EXPORT(SceInt32, sceAppUtilSaveDataSlotSearch, SceAppUtilWorkBuffer *workBuf, co
             }
             break;
         case SCE_APPUTIL_SAVEDATA_SLOT_SEARCH_TYPE_EMPTY_SLOT:
-            if (fd < 0) {
+            if (!exists) {
                 if (slotList)
                     slotList[result->hitNum].id = i;
                 result->hitNum++;
@@ -396,9 +388,6 @@ EXPORT(SceInt32, sceAppUtilSaveDataSlotSearch, SceAppUtilWorkBuffer *workBuf, co
             break;
         default: break;
         }
-
-        if (fd > 0)
-            close_file(emuenv.io, fd, export_name);
     }
 
     return 0;
@@ -406,11 +395,11 @@ EXPORT(SceInt32, sceAppUtilSaveDataSlotSearch, SceAppUtilWorkBuffer *workBuf, co
 
 EXPORT(SceInt32, sceAppUtilSaveDataSlotSetParam, SceAppUtilSaveDataSlotId slotId, SceAppUtilSaveDataSlotParam *param, SceAppUtilMountPoint *mountPoint) {
     TRACY_FUNC(sceAppUtilSaveDataSlotSetParam, slotId, param, mountPoint);
-    const auto fd = open_file(emuenv.io, construct_slotparam_path(slotId).c_str(), SCE_O_WRONLY, emuenv.pref_path.wstring(), export_name);
-    if (fd < 0)
+    const auto slot_param_path = construct_slotparam_path(slotId);
+    SceAppUtilSaveDataSlotParam current_param;
+    if (read_savedata_slot_file(emuenv.io, slot_param_path.c_str(), &current_param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.pref_path.wstring(), export_name) < 0)
         return RET_ERROR(SCE_APPUTIL_ERROR_SAVEDATA_SLOT_NOT_FOUND);
-    write_file(fd, param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.io, export_name);
-    close_file(emuenv.io, fd, export_name);
+    write_file_deferred(emuenv.io, slot_param_path.c_str(), param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.pref_path.wstring(), export_name);
     return 0;
 }
 
@@ -183,6 +183,7 @@ EXPORT(int, sceAudioOutOpenPort, SceAudioOutPortType type, int len, int freq, Sc
     const std::lock_guard<std::mutex> lock(emuenv.audio.mutex);
     const int port_id = emuenv.audio.next_port_id++;
     emuenv.audio.out_ports.emplace(port_id, port);
+    emuenv.audio.publish_out_ports();
 
     return port_id;
 }
@@ -211,7 +212,8 @@ EXPORT(int, sceAudioOutGetRestSample, int port) {
         return RET_ERROR(SCE_AUDIO_OUT_ERROR_INVALID_PORT);
     }
 
-    const int bytes_available = SDL_AudioStreamAvailable(prt->stream.get());
+    // the data is either waiting to be moved to the ring or already in it
+    const int bytes_available = static_cast<int>(prt->converted.size() * sizeof(int16_t)) + (prt->ring ? static_cast<int>(prt->ring->Used()) : 0);
 
     // we have the number of bytes left, we can convert it back to the number of samples left
     return bytes_available / (2 * sizeof(int16_t));
@@ -228,6 +230,7 @@ EXPORT(int, sceAudioOutReleasePort, int port) {
     if (!emuenv.audio.out_ports.erase(port)) {
         return RET_ERROR(SCE_AUDIO_OUT_ERROR_INVALID_PORT);
     }
+    emuenv.audio.publish_out_ports();
 
     return 0;
 }
@@ -290,6 +293,7 @@ EXPORT(int, sceAudioOutSetConfig, int port, SceSize len, int freq, SceAudioOutMo
 
     const std::lock_guard<std::mutex> lock(emuenv.audio.mutex);
     emuenv.audio.out_ports.emplace(port, prt);
+    emuenv.audio.publish_out_ports();
 
     return 0;
 }
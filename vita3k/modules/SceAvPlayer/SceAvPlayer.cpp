@@ -335,11 +335,10 @@ EXPORT(bool, sceAvPlayerGetAudioData, SceUID player_handle, SceAvPlayerFrameInfo
                 player_info->player.last_sample_count * sizeof(int16_t) * player_info->player.last_channels, true);
         }
     } else {
-        std::vector<int16_t> data = player_info->player.receive_audio();
-
-        if (data.empty())
+        if (!player_info->player.receive_audio())
             return false;
 
+        const std::vector<int16_t> &data = player_info->player.audio_frame.data;
         buffer = get_buffer(player_info, MediaType::AUDIO, emuenv.mem, (uint32_t)data.size() * sizeof(int16_t), false);
         std::memcpy(buffer.get(emuenv.mem), data.data(), data.size() * sizeof(int16_t));
     }
@@ -372,7 +371,6 @@ EXPORT(uint32_t, sceAvPlayerGetStreamInfo, SceUID player_handle, SceUInt32 strea
         stream_info->stream_details.video.aspect_ratio = static_cast<float>(size.width) / static_cast<float>(size.height);
         strcpy(stream_info->stream_details.video.language, "ENG");
     } else if (stream_no == 1) { // audio
-        player_info->player.receive_audio(); // TODO: Get audio info without skipping data frames
         stream_info->stream_type = MediaType::AUDIO;
         stream_info->stream_details.audio.channels = player_info->player.last_channels;
         stream_info->stream_details.audio.sample_rate = player_info->player.last_sample_rate;
@@ -399,21 +397,23 @@ EXPORT(bool, sceAvPlayerGetVideoData, SceUID player_handle, SceAvPlayerFrameInfo
 
     // needs new frame
     if (player_info->last_frame_time + framerate < current_time()) {
-        if (CATCHUP_VIDEO_PLAYBACK)
-            player_info->last_frame_time += framerate;
-        else
-            player_info->last_frame_time = current_time();
+        const uint64_t next_frame_time = CATCHUP_VIDEO_PLAYBACK ? player_info->last_frame_time + framerate : current_time();
 
         if (player_info->paused) {
+            player_info->last_frame_time = next_frame_time;
             if (REJECT_DATA_ON_PAUSE)
                 return false;
             else
                 buffer = get_buffer(player_info, MediaType::VIDEO, emuenv.mem, H264DecoderState::buffer_size(size), false);
-        } else {
+        } else if (player_info->player.receive_video()) {
+            player_info->last_frame_time = next_frame_time;
             buffer = get_buffer(player_info, MediaType::VIDEO, emuenv.mem, H264DecoderState::buffer_size(size), true);
 
-            std::vector<uint8_t> data = player_info->player.receive_video();
+            const std::vector<uint8_t> &data = player_info->player.video_frame.data;
             std::memcpy(buffer.get(emuenv.mem), data.data(), data.size());
+        } else {
+            // the decode thread is late, give the previous frame again and try on the next call
+            buffer = get_buffer(player_info, MediaType::VIDEO, emuenv.mem, H264DecoderState::buffer_size(size), false);
         }
     } else {
         buffer = get_buffer(player_info, MediaType::VIDEO, emuenv.mem, H264DecoderState::buffer_size(size), false);
@@ -836,15 +836,12 @@ static void check_empty_param(EmuEnvState &emuenv, const SceAppUtilSaveDataSlotE
 }
 
 static void check_save_file(const uint32_t index, EmuEnvState &emuenv, const char *export_name) {
-    SceUID fd = open_file(emuenv.io, construct_slotparam_path(emuenv.common_dialog.savedata.slot_id[index]).c_str(), SCE_O_RDONLY, emuenv.pref_path.wstring(), export_name);
-    if (fd < 0) {
+    SceAppUtilSaveDataSlotParam slot_param{};
+    if (read_savedata_slot_file(emuenv.io, construct_slotparam_path(emuenv.common_dialog.savedata.slot_id[index]).c_str(), &slot_param, sizeof(SceAppUtilSaveDataSlotParam), emuenv.pref_path.wstring(), export_name) < 0) {
         auto empty_param = emuenv.common_dialog.savedata.list_empty_param[index];
         check_empty_param(emuenv, empty_param, index);
     } else {
         vfs::FileBuffer thumbnail_buffer;
-        SceAppUtilSaveDataSlotParam slot_param{};
-        read_file(&slot_param, emuenv.io, fd, sizeof(SceAppUtilSaveDataSlotParam), export_name);
-        close_file(emuenv.io, fd, export_name);
         emuenv.common_dialog.savedata.slot_info[index].isExist = 1;
         emuenv.common_dialog.savedata.title[index] = slot_param.title;
         emuenv.common_dialog.savedata.subtitle[index] = slot_param.subTitle;
@@ -128,6 +128,14 @@ EXPORT(SceInt32, _sceDisplaySetFrameBuf, const SceDisplayFrameBuf *pFrameBuf, Sc
     emuenv.display.last_setframe_vblank_count = emuenv.display.vblank_count.load();
     emuenv.frame_count++;
 
+    if (emuenv.cfg.metrics_export) {
+        const auto now = std::chrono::steady_clock::now();
+        const std::lock_guard<std::mutex> lock(emuenv.display.frame_times_mutex);
+        if (emuenv.display.last_frame_time != std::chrono::steady_clock::time_point{})
+            emuenv.display.frame_times.push_back(std::chrono::duration<float, std::milli>(now - emuenv.display.last_frame_time).count());
+        emuenv.display.last_frame_time = now;
+    }
+
 #ifdef TRACY_ENABLE
     FrameMarkNamed("SCE frame buffer"); // Tracy - Secondary frame end mark for the emulated frame buffer
 #endif
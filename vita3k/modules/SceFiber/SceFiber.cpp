@@ -22,7 +22,6 @@
 #include <kernel/state.h>
 
 #include <sstream>
-#include <util/lock_and_find.h>
 #include <util/log.h>
 
 #include <util/tracy.h>
@@ -70,58 +69,51 @@ static_assert(sizeof(SceFiber) <= 128, "SceFiber struct size is more than 128");
 
 const static int DEFAULT_FIBER_STACK_SIZE = 4096;
 
-struct FiberState {
-    std::mutex mutex;
-    std::map<SceUID, SceFiber *> thread_fibers;
-    std::map<SceUID, CPUContext> thread_contexts;
+// Fibers only run on the thread they were started from, and each guest thread has its own host thread,
+// so the fiber state of a thread is kept in a thread local variable instead of being looked up on every switch
+struct ThreadFiberState {
+    SceUID thread_id = SCE_KERNEL_ERROR_ILLEGAL_THREAD_ID;
+    ThreadState *thread = nullptr;
+    // fiber running on the thread, nullptr when the thread runs its own context
+    SceFiber *fiber = nullptr;
+    // context of the thread saved when it started to run a fiber
+    CPUContext context;
 };
 
-LIBRARY_INIT(SceFiber) {
-    emuenv.kernel.obj_store.create<FiberState>();
-}
+static thread_local ThreadFiberState thread_fiber_state;
 
 constexpr bool LOG_FIBER = false;
 
-void set_thread_fiber(FiberState &state, const SceUID &tid, SceFiber *fiber) {
-    state.thread_fibers[tid] = fiber;
-}
-
-SceFiber *get_thread_fiber(FiberState &state, const SceUID &tid) {
-    auto fiber = state.thread_fibers.find(tid);
-    if (fiber == state.thread_fibers.end()) {
-        return nullptr;
+static ThreadFiberState &get_thread_fiber_state(EmuEnvState &emuenv, SceUID thread_id) {
+    ThreadFiberState &state = thread_fiber_state;
+    if (state.thread_id != thread_id) {
+        // the host thread keeps a reference to its guest thread until it exits
+        state = {};
+        state.thread_id = thread_id;
+        state.thread = emuenv.kernel.get_thread(thread_id).get();
     }
-    return fiber->second;
-}
-
-void set_thread_context(FiberState &state, const SceUID &tid, const CPUContext &ctx) {
-    state.thread_contexts[tid] = ctx;
-}
-
-CPUContext get_thread_context(FiberState &state, const SceUID &tid) {
-    return state.thread_contexts[tid];
+    return state;
 }
 
-std::string describe_fiber(FiberState &state, ThreadStatePtr thread, SceFiber *fiber) {
+std::string describe_fiber(const ThreadFiberState &state, SceFiber *fiber) {
     std::stringstream ss;
     ss << fmt::format("Fiber (name: {})\n", fiber->name);
     ss << fmt::format("entry: {}\n", log_hex(fiber->cpu->get_pc()), log_hex(fiber->entry.address()));
     ss << "CPU Context:\n";
     ss << fiber->cpu->description();
-    ss << "Referenced from " << thread->id << "\n";
+    ss << "Referenced from " << state.thread_id << "\n";
     ss << "CPU Context:\n";
-    auto ctx = get_thread_context(state, thread->id);
-    ss << ctx.description();
+    ss << state.context.description();
     return ss.str();
 }
 
-void log_fiber(FiberState &state, ThreadStatePtr thread, SceFiber *fiber, const std::string &function_name) {
+void log_fiber(const ThreadFiberState &state, SceFiber *fiber, const std::string &function_name) {
     std::string log_msg = function_name + "\n";
-    log_msg += describe_fiber(state, thread, fiber);
+    log_msg += describe_fiber(state, fiber);
     LOG_INFO("{}", log_msg);
 }
 
-void setup_fiber_to_run(EmuEnvState &emuenv, const ThreadStatePtr thread, SceFiber *fiber, uint32_t thread_sp, const uint32_t &argOnRunTo) {
+void setup_fiber_to_run(EmuEnvState &emuenv, SceFiber *fiber, uint32_t thread_sp, const uint32_t &argOnRunTo) {
     assert(fiber->status != FiberStatus::RUN);
     if (!fiber->addrContext) {
         fiber->cpu->set_sp(thread_sp);
@@ -140,7 +132,7 @@ void setup_fiber_to_run(EmuEnvState &emuenv, const ThreadStatePtr thread, SceFib
     fiber->status = FiberStatus::RUN;
 }
 
-void initialize_fiber(EmuEnvState &emuenv, const ThreadStatePtr thread, SceFiber *fiber, const char *name, Ptr<SceFiberEntry> entry, SceUInt32 argOnInitialize, Ptr<void> addrContext, SceSize sizeContext, SceFiberOptParam *params) {
+void initialize_fiber(EmuEnvState &emuenv, ThreadState &thread, SceFiber *fiber, const char *name, Ptr<SceFiberEntry> entry, SceUInt32 argOnInitialize, Ptr<void> addrContext, SceSize sizeContext, SceFiberOptParam *params) {
     fiber->entry = entry;
     strncpy(fiber->name, name, 32);
     fiber->argOnInitialize = argOnInitialize;
@@ -149,7 +141,7 @@ void initialize_fiber(EmuEnvState &emuenv, const ThreadStatePtr thread, SceFiber
     fiber->sizeContext = sizeContext;
     fiber->cpu = new CPUContext;
     fiber->status = FiberStatus::INIT;
-    *fiber->cpu = save_context(*thread->cpu);
+    *fiber->cpu = save_context(*thread.cpu);
 
     if (addrContext && sizeContext > 0) {
         memset(addrContext.get(emuenv.mem), 0xCC, sizeContext);
@@ -162,13 +154,11 @@ EXPORT(int, _sceFiberAttachContextAndRun, SceFiber *fiber, Address addrContext,
     TRACY_FUNC(_sceFiberAttachContextAndRun, fiber, addrContext, sizeContext, argOnRunTo, argOnRun);
     // Maybe Need more check on real hw
     STUBBED("Todo: not sure for now");
-    const auto state = emuenv.kernel.obj_store.get<FiberState>();
-    const std::lock_guard<std::mutex> lock(state->mutex);
-    const auto thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
-    assert(!get_thread_fiber(*state, thread->id));
+    ThreadFiberState &state = get_thread_fiber_state(emuenv, thread_id);
+    assert(!state.fiber);
     assert(!fiber->addrContext);
     if (LOG_FIBER) {
-        log_fiber(*state, thread, fiber, "Attach context and run");
+        log_fiber(state, fiber, "Attach context and run");
     }
 
     fiber->addrContext = addrContext;
@@ -177,11 +167,10 @@ EXPORT(int, _sceFiberAttachContextAndRun, SceFiber *fiber, Address addrContext,
         fiber->cpu->set_sp(addrContext + sizeContext);
     }
 
-    setup_fiber_to_run(emuenv, thread, fiber, read_sp(*thread->cpu), argOnRunTo);
-    set_thread_context(*state, thread->id, save_context(*thread->cpu));
-    set_thread_fiber(*state, thread->id, fiber);
+    setup_fiber_to_run(emuenv, fiber, read_sp(*state.thread->cpu), argOnRunTo);
+    state.fiber = fiber;
 
-    load_context(*thread->cpu, *fiber->cpu);
+    swap_context(*state.thread->cpu, state.context, *fiber->cpu);
     return fiber->cpu->cpu_registers[0];
 }
 
@@ -189,13 +178,10 @@ EXPORT(int, _sceFiberAttachContextAndSwitch, SceFiber *fiber, Address addrContex
     TRACY_FUNC(_sceFiberAttachContextAndSwitch, fiber, addrContext, sizeContext, argOnRunTo, argOnRun);
     // Maybe Need more check on real hw
     STUBBED("Todo: not sure for now");
-    const auto state = emuenv.kernel.obj_store.get<FiberState>();
-    const std::lock_guard<std::mutex> lock(state->mutex);
-    const auto thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
-    auto ctx = get_thread_context(*state, thread->id);
-    SceFiber *thread_fiber = get_thread_fiber(*state, thread->id);
+    ThreadFiberState &state = get_thread_fiber_state(emuenv, thread_id);
+    SceFiber *thread_fiber = state.fiber;
     if (LOG_FIBER) {
-        log_fiber(*state, thread, fiber, "Attach context and switch");
+        log_fiber(state, fiber, "Attach context and switch");
     }
 
     assert(thread_fiber);
@@ -206,13 +192,12 @@ EXPORT(int, _sceFiberAttachContextAndSwitch, SceFiber *fiber, Address addrContex
         fiber->cpu->set_sp(addrContext + sizeContext);
     }
 
-    *thread_fiber->cpu = save_context(*thread->cpu);
-    setup_fiber_to_run(emuenv, thread, fiber, ctx.get_sp(), argOnRunTo);
+    setup_fiber_to_run(emuenv, fiber, state.context.get_sp(), argOnRunTo);
+    swap_context(*state.thread->cpu, *thread_fiber->cpu, *fiber->cpu);
     thread_fiber->status = FiberStatus::SUSPEND;
     thread_fiber->argOnRun = argOnRun;
     thread_fiber->cpu->cpu_registers[0] = SCE_FIBER_OK;
-    set_thread_fiber(*state, thread->id, fiber);
-    load_context(*thread->cpu, *fiber->cpu);
+    state.fiber = fiber;
 
     return fiber->cpu->cpu_registers[0];
 }
@@ -231,12 +216,12 @@ EXPORT(SceInt32, _sceFiberInitializeImpl, SceFiber *fiber, const char *name, Ptr
         return RET_ERROR(SCE_FIBER_ERROR_INVALID);
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
-    if (!thread) {
+    const ThreadFiberState &state = get_thread_fiber_state(emuenv, thread_id);
+    if (!state.thread) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID);
     }
 
-    initialize_fiber(emuenv, thread, fiber, name, entry, argOnInitialize, addrContext, sizeContext, params);
+    initialize_fiber(emuenv, *state.thread, fiber, name, entry, argOnInitialize, addrContext, sizeContext, params);
 
     return SCE_FIBER_OK;
 }
@@ -255,12 +240,12 @@ EXPORT(int, _sceFiberInitializeWithInternalOptionImpl, SceFiber *fiber, const ch
         return RET_ERROR(SCE_FIBER_ERROR_INVALID);
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
-    if (!thread) {
+    const ThreadFiberState &state = get_thread_fiber_state(emuenv, thread_id);
+    if (!state.thread) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID);
     }
 
-    initialize_fiber(emuenv, thread, fiber, name, entry, argOnInitialize, addrContext, sizeContext, nullptr);
+    initialize_fiber(emuenv, *state.thread, fiber, name, entry, argOnInitialize, addrContext, sizeContext, nullptr);
 
     return SCE_FIBER_OK;
 }
@@ -306,13 +291,11 @@ EXPORT(int, sceFiberGetInfo, SceFiber *fiber, SceFiberInfo *fiberInfo) {
 
 EXPORT(SceUInt32, sceFiberGetSelf, Ptr<SceFiber> *fiber) {
     TRACY_FUNC(sceFiberGetSelf, fiber);
-    const auto state = emuenv.kernel.obj_store.get<FiberState>();
     if (!fiber) {
         return RET_ERROR(SCE_FIBER_ERROR_NULL);
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
-    SceFiber *thread_fiber = get_thread_fiber(*state, thread->id);
+    SceFiber *thread_fiber = get_thread_fiber_state(emuenv, thread_id).fiber;
     if (thread_fiber)
         *fiber = Ptr<SceFiber>(thread_fiber, emuenv.mem);
     else
@@ -343,28 +326,24 @@ EXPORT(int, sceFiberRenameSelf) {
 
 EXPORT(SceInt32, sceFiberReturnToThread, uint32_t argOnReturnTo, Ptr<uint32_t> argOnRun) {
     TRACY_FUNC(sceFiberReturnToThread, argOnReturnTo, argOnRun);
-    const auto state = emuenv.kernel.obj_store.get<FiberState>();
-    const std::lock_guard<std::mutex> lock(state->mutex);
-    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
-    SceFiber *fiber = get_thread_fiber(*state, thread->id);
+    ThreadFiberState &state = get_thread_fiber_state(emuenv, thread_id);
+    SceFiber *fiber = state.fiber;
     if (!fiber) {
         return RET_ERROR(SCE_FIBER_ERROR_PERMISSION);
     }
 
-    CPUContext thread_context = get_thread_context(*state, thread->id);
     assert(fiber->status == FiberStatus::RUN);
     if (LOG_FIBER) {
-        log_fiber(*state, thread, fiber, "Return to thread");
+        log_fiber(state, fiber, "Return to thread");
     }
 
-    *fiber->cpu = save_context(*thread->cpu);
+    swap_context(*state.thread->cpu, *fiber->cpu, state.context);
     fiber->cpu->cpu_registers[0] = SCE_FIBER_OK;
     fiber->status = FiberStatus::SUSPEND;
     fiber->argOnRun = argOnRun;
-    set_thread_fiber(*state, thread->id, nullptr);
+    state.fiber = nullptr;
 
-    load_context(*thread->cpu, thread_context);
-    Address argOnReturn = thread_context.cpu_registers[2];
+    Address argOnReturn = state.context.cpu_registers[2];
     if (argOnReturn) {
         *(Ptr<uint32_t>(argOnReturn).get(emuenv.mem)) = argOnReturnTo;
     }
@@ -374,9 +353,6 @@ EXPORT(SceInt32, sceFiberReturnToThread, uint32_t argOnReturnTo, Ptr<uint32_t> a
 
 EXPORT(SceUInt32, sceFiberRun, SceFiber *fiber, SceUInt32 argOnRunTo, Ptr<SceUInt32> argOnReturn) {
     TRACY_FUNC(sceFiberRun, fiber, argOnRunTo, argOnReturn);
-    const auto state = emuenv.kernel.obj_store.get<FiberState>();
-    const std::lock_guard<std::mutex> lock(state->mutex);
-    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
     if (!fiber) {
         return RET_ERROR(SCE_FIBER_ERROR_NULL);
     }
@@ -385,19 +361,19 @@ EXPORT(SceUInt32, sceFiberRun, SceFiber *fiber, SceUInt32 argOnRunTo, Ptr<SceUIn
         return RET_ERROR(SCE_FIBER_ERROR_STATE);
     }
 
-    if (get_thread_fiber(*state, thread->id)) {
+    ThreadFiberState &state = get_thread_fiber_state(emuenv, thread_id);
+    if (state.fiber) {
         return RET_ERROR(SCE_FIBER_ERROR_PERMISSION);
     }
 
     if (LOG_FIBER) {
-        log_fiber(*state, thread, fiber, "Run");
+        log_fiber(state, fiber, "Run");
     }
 
-    setup_fiber_to_run(emuenv, thread, fiber, read_sp(*thread->cpu), argOnRunTo);
-    set_thread_context(*state, thread->id, save_context(*thread->cpu));
-    set_thread_fiber(*state, thread->id, fiber);
+    setup_fiber_to_run(emuenv, fiber, read_sp(*state.thread->cpu), argOnRunTo);
+    state.fiber = fiber;
 
-    load_context(*thread->cpu, *fiber->cpu);
+    swap_context(*state.thread->cpu, state.context, *fiber->cpu);
     return fiber->cpu->cpu_registers[0];
 }
 
@@ -413,10 +389,6 @@ EXPORT(int, sceFiberStopContextSizeCheck) {
 
 EXPORT(SceUInt32, sceFiberSwitch, SceFiber *fiber, SceUInt32 argOnRunTo, Ptr<SceUInt32> argOnRun) {
     TRACY_FUNC(sceFiberSwitch, fiber, argOnRunTo, argOnRun);
-    const auto state = emuenv.kernel.obj_store.get<FiberState>();
-    const std::lock_guard<std::mutex> lock(state->mutex);
-    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
-    auto ctx = get_thread_context(*state, thread->id);
     if (!fiber) {
         return RET_ERROR(SCE_FIBER_ERROR_NULL);
     }
@@ -425,22 +397,22 @@ EXPORT(SceUInt32, sceFiberSwitch, SceFiber *fiber, SceUInt32 argOnRunTo, Ptr<Sce
         return RET_ERROR(SCE_FIBER_ERROR_STATE);
     }
 
-    SceFiber *thread_fiber = get_thread_fiber(*state, thread->id);
+    ThreadFiberState &state = get_thread_fiber_state(emuenv, thread_id);
+    SceFiber *thread_fiber = state.fiber;
     if (!thread_fiber) {
         return RET_ERROR(SCE_FIBER_ERROR_PERMISSION);
     }
 
     if (LOG_FIBER) {
-        log_fiber(*state, thread, fiber, "Switch");
+        log_fiber(state, fiber, "Switch");
     }
 
-    *thread_fiber->cpu = save_context(*thread->cpu);
+    setup_fiber_to_run(emuenv, fiber, state.context.get_sp(), argOnRunTo);
+    swap_context(*state.thread->cpu, *thread_fiber->cpu, *fiber->cpu);
     thread_fiber->status = FiberStatus::SUSPEND;
     thread_fiber->argOnRun = argOnRun;
     thread_fiber->cpu->cpu_registers[0] = SCE_FIBER_OK;
-    set_thread_fiber(*state, thread->id, fiber);
-    setup_fiber_to_run(emuenv, thread, fiber, ctx.get_sp(), argOnRunTo);
-    load_context(*thread->cpu, *fiber->cpu);
+    state.fiber = fiber;
 
     return fiber->cpu->cpu_registers[0];
 }
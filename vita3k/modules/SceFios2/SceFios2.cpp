@@ -16,81 +16,449 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include <module/module.h>
+#include <modules/module_parent.h>
+
+#include <io/functions.h>
+#include <io/psarc.h>
+#include <io/state.h>
+#include <kernel/state.h>
+#include <util/mapped_file.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+#include <util/tracy.h>
+TRACY_MODULE_NAME(SceFios2);
+
+enum SceFiosErrorCode : uint32_t {
+    SCE_FIOS_OK = 0,
+    SCE_FIOS_ERROR_UNKNOWN = 0x80820001,
+    SCE_FIOS_ERROR_BAD_PATH = 0x80820006,
+    SCE_FIOS_ERROR_BAD_OP = 0x80820008,
+    SCE_FIOS_ERROR_BAD_FH = 0x80820009,
+    SCE_FIOS_ERROR_BAD_PARAM = 0x8082000D,
+    SCE_FIOS_ERROR_BAD_ARCHIVE = 0x80820013
+};
+
+typedef int32_t SceFiosOp;
+typedef int32_t SceFiosFH;
+typedef int64_t SceFiosOffset;
+typedef int64_t SceFiosSize;
+
+// prefetched ranges are tracked with this granularity
+constexpr SceFiosSize FIOS_CACHE_BLOCK_SIZE = 64 * 1024;
+constexpr int FIOS_MAX_DECOMPRESSOR_THREADS = 8;
+
+// file kept mapped once prefetched, reading its pages fills the host page cache the guest reads are served from
+struct FiosCacheEntry {
+    std::shared_ptr<MappedFile> file;
+    std::vector<bool> blocks;
+};
+
+struct FiosOp {
+    bool done = false;
+    SceInt64 result = 0;
+};
+
+struct FiosArchive {
+    fs::path host_path;
+    SceUID overlay_id;
+};
+
+struct FiosState {
+    std::mutex mutex;
+    std::condition_variable op_done;
+    std::map<SceFiosOp, FiosOp> ops;
+    std::map<fs::path, FiosCacheEntry> cache;
+    std::map<SceFiosFH, FiosArchive> archives;
+    int decompressor_thread_count = 1;
+};
+
+LIBRARY_INIT(SceFios2) {
+    emuenv.kernel.obj_store.create<FiosState>();
+}
+
+// run the op on the async IO workers, its result is kept until sceFiosOpDelete
+static SceFiosOp submit_op(EmuEnvState &emuenv, std::function<SceInt64()> run) {
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const SceFiosOp op = emuenv.kernel.get_next_uid();
+    {
+        const std::lock_guard<std::mutex> lock(state->mutex);
+        state->ops[op] = {};
+    }
+
+    AsyncIoRequest request{
+        .op_id = op,
+        .run = std::move(run),
+        .on_complete = [state](SceUID op_id, SceInt64 result) {
+            {
+                const std::lock_guard<std::mutex> lock(state->mutex);
+                const auto it = state->ops.find(op_id);
+                if (it != state->ops.end())
+                    it->second = { true, result };
+            }
+            state->op_done.notify_all();
+        }
+    };
+    emuenv.io.async.submit(op, std::move(request));
+    return op;
+}
+
+static SceInt64 wait_op(FiosState &state, SceFiosOp op) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    auto it = state.ops.find(op);
+    state.op_done.wait(lock, [&] {
+        it = state.ops.find(op);
+        return it == state.ops.end() || it->second.done;
+    });
+    if (it == state.ops.end())
+        return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_OP);
+    return it->second.result;
+}
+
+static fs::path get_host_path(EmuEnvState &emuenv, const char *path) {
+    return fs::path(expand_path(emuenv.io, path, emuenv.pref_path.wstring()));
+}
+
+// a negative length goes up to the end of the file
+static SceInt64 prefetch_file_range(FiosState &state, const fs::path &host_path, SceFiosOffset offset, SceFiosSize length) {
+    std::shared_ptr<MappedFile> file;
+    {
+        const std::lock_guard<std::mutex> lock(state.mutex);
+        FiosCacheEntry &entry = state.cache[host_path];
+        if (!entry.file) {
+            auto mapping = std::make_shared<MappedFile>();
+            if (!mapping->open(host_path)) {
+                state.cache.erase(host_path);
+                return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_PATH);
+            }
+            entry.blocks.resize((mapping->size() + FIOS_CACHE_BLOCK_SIZE - 1) / FIOS_CACHE_BLOCK_SIZE);
+            entry.file = std::move(mapping);
+        }
+        file = entry.file;
+
+        const SceFiosSize file_size = static_cast<SceFiosSize>(file->size());
+        if (offset < 0 || offset >= file_size)
+            return 0;
+        if (length < 0 || length > file_size - offset)
+            length = file_size - offset;
+        for (SceFiosSize block = offset / FIOS_CACHE_BLOCK_SIZE; block * FIOS_CACHE_BLOCK_SIZE < offset + length; block++)
+            entry.blocks[block] = true;
+    }
+
+    file->prefetch(offset, length);
+    // touch every page so the range is in memory once the op is done, not only requested
+    uint8_t sum = 0;
+    for (SceFiosSize page = offset; page < offset + length; page += 4096)
+        sum += *reinterpret_cast<const volatile uint8_t *>(file->data() + page);
+    (void)sum;
+
+    return length;
+}
+
+static bool cache_contains_range(FiosState &state, const fs::path &host_path, SceFiosOffset offset, SceFiosSize length) {
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    const auto entry = state.cache.find(host_path);
+    if (entry == state.cache.end())
+        return false;
+
+    const SceFiosSize file_size = static_cast<SceFiosSize>(entry->second.file->size());
+    if (offset < 0 || offset >= file_size)
+        return false;
+    if (length < 0 || length > file_size - offset)
+        length = file_size - offset;
+    for (SceFiosSize block = offset / FIOS_CACHE_BLOCK_SIZE; block * FIOS_CACHE_BLOCK_SIZE < offset + length; block++) {
+        if (!entry->second.blocks[block])
+            return false;
+    }
+    return true;
+}
+
+static void cache_flush_range(FiosState &state, const fs::path &host_path, SceFiosOffset offset, SceFiosSize length) {
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    const auto entry = state.cache.find(host_path);
+    if (entry == state.cache.end())
+        return;
+
+    const SceFiosSize file_size = static_cast<SceFiosSize>(entry->second.file->size());
+    if (offset <= 0 && (length < 0 || length >= file_size)) {
+        state.cache.erase(entry);
+        return;
+    }
+    if (offset >= file_size)
+        return;
+    if (length < 0 || length > file_size - offset)
+        length = file_size - offset;
+    // only drop the blocks fully in the range
+    const SceFiosSize first = (std::max<SceFiosOffset>(offset, 0) + FIOS_CACHE_BLOCK_SIZE - 1) / FIOS_CACHE_BLOCK_SIZE;
+    for (SceFiosSize block = first; (block + 1) * FIOS_CACHE_BLOCK_SIZE <= offset + length; block++)
+        entry->second.blocks[block] = false;
+}
+
+static SceInt64 prefetch_fh(EmuEnvState &emuenv, SceFiosFH fh, SceFiosOffset offset, SceFiosSize length) {
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    fs::path host_path;
+    {
+        // only the archive handles are known, sceFiosFHOpen is not implemented
+        const std::lock_guard<std::mutex> lock(state->mutex);
+        const auto archive = state->archives.find(fh);
+        if (archive == state->archives.end())
+            return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_FH);
+        host_path = archive->second.host_path;
+    }
+    return prefetch_file_range(*state, host_path, offset, length);
+}
+
+// extract the archive in the temp directory with the decompressor threads and add an overlay from the mount point to it
+static SceInt64 mount_archive(EmuEnvState &emuenv, SceFiosFH *out_fh, const std::string &archive_path, const std::string &mount_point) {
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const fs::path host_path = get_host_path(emuenv, archive_path.c_str());
+
+    PsarcArchive archive;
+    if (!fs::exists(host_path))
+        return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_PATH);
+    if (!archive.open(host_path))
+        return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_ARCHIVE);
+
+    // the extracted copy is reused as long as the archive does not change
+    boost::system::error_code error;
+    const uint64_t key = std::hash<std::string>{}(host_path.string()) ^ fs::file_size(host_path, error) ^ (static_cast<uint64_t>(fs::last_write_time(host_path, error)) * 0x9E3779B97F4A7C15ULL);
+    const std::string extract_path = fmt::format("ur0:temp/fios2/{:016X}", key);
+    const fs::path host_extract_path = get_host_path(emuenv, extract_path.c_str());
+    const fs::path complete_marker = host_extract_path / ".complete";
+
+    if (!fs::exists(complete_marker)) {
+        int thread_count;
+        {
+            const std::lock_guard<std::mutex> lock(state->mutex);
+            thread_count = state->decompressor_thread_count;
+        }
+
+        const std::vector<PsarcEntry> &entries = archive.get_entries();
+        std::atomic<size_t> next_entry = 0;
+        std::atomic<bool> failed = false;
+        const auto decompress = [&]() {
+            std::vector<uint8_t> data;
+            for (size_t i = next_entry++; i < entries.size() && !failed; i = next_entry++) {
+                if (!archive.read_entry(entries[i], data)) {
+                    LOG_ERROR("Failed to decompress {} from {}", entries[i].name, archive_path);
+                    failed = true;
+                    break;
+                }
+                const fs::path dest = host_extract_path / fs::path(entries[i].name);
+                boost::system::error_code create_error;
+                fs::create_directories(dest.parent_path(), create_error);
+                fs::ofstream out{ dest, fs::ofstream::binary };
+                out.write(reinterpret_cast<const char *>(data.data()), data.size());
+            }
+        };
+
+        std::vector<std::thread> decompressors;
+        for (int i = 1; i < thread_count; i++)
+            decompressors.emplace_back(decompress);
+        decompress();
+        for (std::thread &decompressor : decompressors)
+            decompressor.join();
+
+        if (failed)
+            return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_ARCHIVE);
+        fs::ofstream{ complete_marker };
+        LOG_INFO("Extracted {} files of archive {} with {} threads", entries.size(), archive_path, thread_count);
+    }
+
+    SceFiosProcessOverlay overlay{};
+    overlay.type = SCE_FIOS_OVERLAY_TYPE_OPAQUE;
+    strncpy(overlay.dst, mount_point.c_str(), sizeof(overlay.dst) - 1);
+    strncpy(overlay.src, extract_path.c_str(), sizeof(overlay.src) - 1);
+    overlay.dst_size = static_cast<int16_t>(strlen(overlay.dst));
+    overlay.src_size = static_cast<int16_t>(strlen(overlay.src));
+
+    const SceFiosFH fh = emuenv.kernel.get_next_uid();
+    {
+        const std::lock_guard<std::mutex> lock(state->mutex);
+        state->archives[fh] = { host_path, create_overlay(emuenv.io, &overlay) };
+    }
+    if (out_fh)
+        *out_fh = fh;
+
+    return SCE_FIOS_OK;
+}
+
+static SceInt64 unmount_archive(EmuEnvState &emuenv, SceFiosFH fh) {
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    const auto archive = state->archives.find(fh);
+    if (archive == state->archives.end())
+        return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_FH);
+
+    remove_overlay(emuenv.io, archive->second.overlay_id);
+    state->cache.erase(archive->second.host_path);
+    state->archives.erase(archive);
+    return SCE_FIOS_OK;
+}
+
+static SceInt64 get_mount_buffer_size(EmuEnvState &emuenv, const std::string &archive_path) {
+    PsarcArchive archive;
+    if (!archive.open(get_host_path(emuenv, archive_path.c_str())))
+        return static_cast<int32_t>(SCE_FIOS_ERROR_BAD_PATH);
+    // the toc is what FIOS keeps in the mount buffer
+    return archive.get_toc_size();
+}
 
 EXPORT(int, sceFiosArchiveGetDecompressorThreadCount) {
-    return UNIMPLEMENTED();
+    TRACY_FUNC(sceFiosArchiveGetDecompressorThreadCount);
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    return state->decompressor_thread_count;
 }
 
-EXPORT(int, sceFiosArchiveGetMountBufferSize) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOp, sceFiosArchiveGetMountBufferSize, const void *pAttr, const char *pArchivePath, const void *pOpenParams) {
+    TRACY_FUNC(sceFiosArchiveGetMountBufferSize, pAttr, pArchivePath, pOpenParams);
+    if (!pArchivePath)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    return submit_op(emuenv, [&emuenv, archive_path = std::string(pArchivePath)]() {
+        return get_mount_buffer_size(emuenv, archive_path);
+    });
 }
 
-EXPORT(int, sceFiosArchiveGetMountBufferSizeSync) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosSize, sceFiosArchiveGetMountBufferSizeSync, const void *pAttr, const char *pArchivePath, const void *pOpenParams) {
+    TRACY_FUNC(sceFiosArchiveGetMountBufferSizeSync, pAttr, pArchivePath, pOpenParams);
+    if (!pArchivePath)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    return get_mount_buffer_size(emuenv, pArchivePath);
 }
 
-EXPORT(int, sceFiosArchiveMount) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOp, sceFiosArchiveMount, const void *pAttr, SceFiosFH *pOutFH, const char *pArchivePath, const char *pMountPoint, Ptr<void> mountBuffer, SceSize mountBufferLength, const void *pOpenParams) {
+    TRACY_FUNC(sceFiosArchiveMount, pAttr, pOutFH, pArchivePath, pMountPoint, mountBuffer, mountBufferLength, pOpenParams);
+    if (!pArchivePath || !pMountPoint)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    return submit_op(emuenv, [&emuenv, pOutFH, archive_path = std::string(pArchivePath), mount_point = std::string(pMountPoint)]() {
+        return mount_archive(emuenv, pOutFH, archive_path, mount_point);
+    });
 }
 
-EXPORT(int, sceFiosArchiveMountSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosArchiveMountSync, const void *pAttr, SceFiosFH *pOutFH, const char *pArchivePath, const char *pMountPoint, Ptr<void> mountBuffer, SceSize mountBufferLength, const void *pOpenParams) {
+    TRACY_FUNC(sceFiosArchiveMountSync, pAttr, pOutFH, pArchivePath, pMountPoint, mountBuffer, mountBufferLength, pOpenParams);
+    if (!pArchivePath || !pMountPoint)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    return static_cast<int>(mount_archive(emuenv, pOutFH, pArchivePath, pMountPoint));
 }
 
-EXPORT(int, sceFiosArchiveSetDecompressorThreadCount) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosArchiveSetDecompressorThreadCount, int threadCount) {
+    TRACY_FUNC(sceFiosArchiveSetDecompressorThreadCount, threadCount);
+    if (threadCount < 1)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PARAM);
+
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    const int previous = state->decompressor_thread_count;
+    state->decompressor_thread_count = std::min(threadCount, FIOS_MAX_DECOMPRESSOR_THREADS);
+    return previous;
 }
 
-EXPORT(int, sceFiosArchiveUnmount) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOp, sceFiosArchiveUnmount, const void *pAttr, SceFiosFH fh) {
+    TRACY_FUNC(sceFiosArchiveUnmount, pAttr, fh);
+    return submit_op(emuenv, [&emuenv, fh]() {
+        return unmount_archive(emuenv, fh);
+    });
 }
 
-EXPORT(int, sceFiosArchiveUnmountSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosArchiveUnmountSync, const void *pAttr, SceFiosFH fh) {
+    TRACY_FUNC(sceFiosArchiveUnmountSync, pAttr, fh);
+    return static_cast<int>(unmount_archive(emuenv, fh));
 }
 
-EXPORT(int, sceFiosCacheContainsFileRangeSync) {
-    return UNIMPLEMENTED();
+EXPORT(bool, sceFiosCacheContainsFileRangeSync, const void *pAttr, const char *pPath, SceFiosOffset startOffset, SceFiosSize length) {
+    TRACY_FUNC(sceFiosCacheContainsFileRangeSync, pAttr, pPath, startOffset, length);
+    if (!pPath)
+        return false;
+
+    return cache_contains_range(*emuenv.kernel.obj_store.get<FiosState>(), get_host_path(emuenv, pPath), startOffset, length);
 }
 
-EXPORT(int, sceFiosCacheContainsFileSync) {
-    return UNIMPLEMENTED();
+EXPORT(bool, sceFiosCacheContainsFileSync, const void *pAttr, const char *pPath) {
+    TRACY_FUNC(sceFiosCacheContainsFileSync, pAttr, pPath);
+    if (!pPath)
+        return false;
+
+    return cache_contains_range(*emuenv.kernel.obj_store.get<FiosState>(), get_host_path(emuenv, pPath), 0, -1);
 }
 
-EXPORT(int, sceFiosCacheFlushFileRangeSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCacheFlushFileRangeSync, const void *pAttr, const char *pPath, SceFiosOffset startOffset, SceFiosSize length) {
+    TRACY_FUNC(sceFiosCacheFlushFileRangeSync, pAttr, pPath, startOffset, length);
+    if (!pPath)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    cache_flush_range(*emuenv.kernel.obj_store.get<FiosState>(), get_host_path(emuenv, pPath), startOffset, length);
+    return SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosCacheFlushFileSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCacheFlushFileSync, const void *pAttr, const char *pPath) {
+    TRACY_FUNC(sceFiosCacheFlushFileSync, pAttr, pPath);
+    if (!pPath)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    cache_flush_range(*emuenv.kernel.obj_store.get<FiosState>(), get_host_path(emuenv, pPath), 0, -1);
+    return SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosCacheFlushSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCacheFlushSync, const void *pAttr) {
+    TRACY_FUNC(sceFiosCacheFlushSync, pAttr);
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    state->cache.clear();
+    return SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosCachePrefetchFH) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOp, sceFiosCachePrefetchFH, const void *pAttr, SceFiosFH fh) {
+    TRACY_FUNC(sceFiosCachePrefetchFH, pAttr, fh);
+    return submit_op(emuenv, [&emuenv, fh]() {
+        return prefetch_fh(emuenv, fh, 0, -1);
+    });
 }
 
-EXPORT(int, sceFiosCachePrefetchFHRange) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOp, sceFiosCachePrefetchFHRange, const void *pAttr, SceFiosFH fh, SceFiosOffset startOffset, SceFiosSize length) {
+    TRACY_FUNC(sceFiosCachePrefetchFHRange, pAttr, fh, startOffset, length);
+    return submit_op(emuenv, [&emuenv, fh, startOffset, length]() {
+        return prefetch_fh(emuenv, fh, startOffset, length);
+    });
 }
 
-EXPORT(int, sceFiosCachePrefetchFHRangeSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCachePrefetchFHRangeSync, const void *pAttr, SceFiosFH fh, SceFiosOffset startOffset, SceFiosSize length) {
+    TRACY_FUNC(sceFiosCachePrefetchFHRangeSync, pAttr, fh, startOffset, length);
+    const SceInt64 result = prefetch_fh(emuenv, fh, startOffset, length);
+    return result < 0 ? static_cast<int>(result) : SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosCachePrefetchFHSync) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosCachePrefetchFHSync, const void *pAttr, SceFiosFH fh) {
+    TRACY_FUNC(sceFiosCachePrefetchFHSync, pAttr, fh);
+    const SceInt64 result = prefetch_fh(emuenv, fh, 0, -1);
+    return result < 0 ? static_cast<int>(result) : SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosCachePrefetchFile) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOp, sceFiosCachePrefetchFile, const void *pAttr, const char *pPath) {
+    TRACY_FUNC(sceFiosCachePrefetchFile, pAttr, pPath);
+    if (!pPath)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    return submit_op(emuenv, [&emuenv, host_path = get_host_path(emuenv, pPath)]() {
+        return prefetch_file_range(*emuenv.kernel.obj_store.get<FiosState>(), host_path, 0, -1);
+    });
 }
 
-EXPORT(int, sceFiosCachePrefetchFileRange) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosOp, sceFiosCachePrefetchFileRange, const void *pAttr, const char *pPath, SceFiosOffset startOffset, SceFiosSize length) {
+    TRACY_FUNC(sceFiosCachePrefetchFileRange, pAttr, pPath, startOffset, length);
+    if (!pPath)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_PATH);
+
+    return submit_op(emuenv, [&emuenv, host_path = get_host_path(emuenv, pPath), startOffset, length]() {
+        return prefetch_file_range(*emuenv.kernel.obj_store.get<FiosState>(), host_path, startOffset, length);
+    });
 }
 
 EXPORT(int, sceFiosCancelAllOps) {
@@ -501,12 +869,28 @@ EXPORT(int, sceFiosOpCancel) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosOpDelete) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosOpDelete, SceFiosOp op) {
+    TRACY_FUNC(sceFiosOpDelete, op);
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    wait_op(*state, op);
+    // forget the op on the workers side too
+    SceInt64 result;
+    emuenv.io.async.wait(op, result);
+
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->ops.erase(op) == 0)
+        return RET_ERROR(SCE_FIOS_ERROR_BAD_OP);
+    return SCE_FIOS_OK;
 }
 
-EXPORT(int, sceFiosOpGetActualCount) {
-    return UNIMPLEMENTED();
+EXPORT(SceFiosSize, sceFiosOpGetActualCount, SceFiosOp op) {
+    TRACY_FUNC(sceFiosOpGetActualCount, op);
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    const auto it = state->ops.find(op);
+    if (it == state->ops.end() || !it->second.done || it->second.result < 0)
+        return 0;
+    return it->second.result;
 }
 
 EXPORT(int, sceFiosOpGetAttr) {
@@ -517,8 +901,14 @@ EXPORT(int, sceFiosOpGetBuffer) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosOpGetError) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosOpGetError, SceFiosOp op) {
+    TRACY_FUNC(sceFiosOpGetError, op);
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    const auto it = state->ops.find(op);
+    if (it == state->ops.end())
+        return SCE_FIOS_ERROR_BAD_OP;
+    return it->second.result < 0 ? static_cast<int>(it->second.result) : SCE_FIOS_OK;
 }
 
 EXPORT(int, sceFiosOpGetOffset) {
@@ -537,8 +927,12 @@ EXPORT(int, sceFiosOpIsCancelled) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosOpIsDone) {
-    return UNIMPLEMENTED();
+EXPORT(bool, sceFiosOpIsDone, SceFiosOp op) {
+    TRACY_FUNC(sceFiosOpIsDone, op);
+    FiosState *state = emuenv.kernel.obj_store.get<FiosState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    const auto it = state->ops.find(op);
+    return it == state->ops.end() || it->second.done;
 }
 
 EXPORT(int, sceFiosOpReschedule) {
@@ -557,8 +951,10 @@ EXPORT(int, sceFiosOpSyncWaitForIO) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceFiosOpWait) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceFiosOpWait, SceFiosOp op) {
+    TRACY_FUNC(sceFiosOpWait, op);
+    const SceInt64 result = wait_op(*emuenv.kernel.obj_store.get<FiosState>(), op);
+    return result < 0 ? static_cast<int>(result) : SCE_FIOS_OK;
 }
 
 EXPORT(int, sceFiosOpWaitUntil) {
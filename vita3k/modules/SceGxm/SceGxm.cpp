@@ -33,6 +33,7 @@
 #include <gxm/state.h>
 #include <gxm/types.h>
 #include <kernel/state.h>
+#include <mem/functions.h>
 #include <mem/state.h>
 
 #include <SDL.h>
@@ -40,6 +41,7 @@
 #include <mem/allocator.h>
 #include <mem/mempool.h>
 #include <renderer/functions.h>
+#include <renderer/shaders.h>
 #include <renderer/state.h>
 #include <renderer/types.h>
 #include <util/bytes.h>
@@ -905,40 +907,43 @@ static void display_entry_thread(EmuEnvState &emuenv) {
     Ptr<SceGxmSyncObject> previous_sync = Ptr<SceGxmSyncObject>();
 
     while (true) {
-        auto display_callback = display_queue.top();
-        if (!display_callback)
+        const DisplayCallback *entry = display_queue.front();
+        if (!entry)
             break;
 
-        SceGxmSyncObject *old_sync = display_callback->old_sync.get(emuenv.mem);
-        SceGxmSyncObject *new_sync = display_callback->new_sync.get(emuenv.mem);
+        // the slot can be reused by sceGxmDisplayQueueAddEntry as soon as it is popped
+        const DisplayCallback display_callback = *entry;
+
+        SceGxmSyncObject *old_sync = display_callback.old_sync.get(emuenv.mem);
+        SceGxmSyncObject *new_sync = display_callback.new_sync.get(emuenv.mem);
 
         // Wait for fragment on the new buffer to finish
         // set a (big) time limit to make sure we don't softlock
         constexpr int one_second = 1'000'000;
-        if (!renderer::wishlist(new_sync, display_callback->new_sync_timestamp, one_second))
+        if (!renderer::wishlist(new_sync, display_callback.new_sync_timestamp, one_second))
             LOG_ERROR_ONCE("Failed to wait for the new frame to be ready");
 
         // now we can remove the thread from the display queue
         display_queue.pop();
 
         // specify whether the call to SceDisplaySetFrameBuf is expected to do something
-        emuenv.display.predicting = display_callback->frame_predicted;
-        emuenv.display.current_sync_object = display_callback->new_sync.address();
+        emuenv.display.predicting = display_callback.frame_predicted;
+        emuenv.display.current_sync_object = display_callback.new_sync.address();
 
         // Now run callback
-        display_thread->run_guest_function(callback_address, display_callback->data);
+        display_thread->run_guest_function(callback_address, display_callback.data);
 
-        free(emuenv.mem, display_callback->data);
+        free(emuenv.mem, display_callback.data);
 
         // The only thing old buffer should be waiting for is to stop being displayed
         renderer::subject_done(old_sync, std::min(old_sync->timestamp_current + 1, old_sync->timestamp_ahead.load()));
-        if (previous_sync && display_callback->old_sync != previous_sync) {
+        if (previous_sync && display_callback.old_sync != previous_sync) {
             // in this case, also set the previous sync object to avoid deadlocks
             SceGxmSyncObject *other_old_sync = previous_sync.get(emuenv.mem);
             renderer::subject_done(other_old_sync, std::min(other_old_sync->timestamp_current + 1, other_old_sync->timestamp_ahead.load()));
         }
 
-        previous_sync = display_callback->new_sync;
+        previous_sync = display_callback.new_sync;
     }
 
     return;
@@ -1009,6 +1014,9 @@ struct SceGxmContext {
 
     bool last_precomputed = false;
 
+    // ring buffers the game did not map, mapped by sceGxmCreateContext when memory mapping is used
+    std::vector<Address> mapped_ring_buffers;
+
     // this is used for deferred contexts
     Ptr<uint8_t> alloc_space_start{};
     std::set<CommandListRange> command_list_ranges;
@@ -1169,7 +1177,7 @@ struct SceGxmContext {
                 new_command = alloc_space.cast<renderer::Command>().get(mem) + offset;
                 new (new_command) renderer::Command;
             } else {
-                new_command = new renderer::Command;
+                new_command = renderer::generic_command_allocate();
                 new_command->flags |= renderer::Command::FLAG_FROM_HOST;
             }
         } else {
@@ -1185,7 +1193,7 @@ struct SceGxmContext {
     void free_new_command(renderer::Command *cmd) {
         if (!(cmd->flags & renderer::Command::FLAG_NO_FREE)) {
             if (cmd->flags & renderer::Command::FLAG_FROM_HOST) {
-                delete cmd;
+                renderer::generic_command_free(cmd);
             } else {
                 command_last_free_pos++;
             }
@@ -1217,9 +1225,17 @@ struct FragmentProgramCacheKey {
 
 typedef std::map<FragmentProgramCacheKey, Ptr<SceGxmFragmentProgram>> FragmentProgramCache;
 
+// renderer data of programs whose last reference was released, so recreating them is only a lookup
+typedef std::map<VertexProgramCacheKey, std::unique_ptr<renderer::VertexProgram>> ReleasedVertexPrograms;
+typedef std::map<FragmentProgramCacheKey, std::unique_ptr<renderer::FragmentProgram>> ReleasedFragmentPrograms;
+
+static constexpr size_t MAX_RELEASED_PROGRAMS = 256;
+
 struct SceGxmShaderPatcher {
     VertexProgramCache vertex_program_cache;
     FragmentProgramCache fragment_program_cache;
+    ReleasedVertexPrograms released_vertex_programs;
+    ReleasedFragmentPrograms released_fragment_programs;
     SceGxmShaderPatcherParams params;
 };
 
@@ -1770,6 +1786,37 @@ EXPORT(void, sceGxmColorSurfaceSetScaleMode, SceGxmColorSurface *surface, SceGxm
     UNIMPLEMENTED();
 }
 
+// with memory mapping, the default uniform buffers reserved in the ring buffers are read by the GPU in place
+// games are expected to map these ring buffers, map the ones which are not so the renderer never has to copy them
+static void gxmMapRingBuffer(EmuEnvState &emuenv, SceGxmContext *ctx, Ptr<void> buffer, uint32_t size) {
+    if (!emuenv.renderer->features.support_memory_mapping || !buffer || size == 0)
+        return;
+
+    GxmState &gxm = emuenv.gxm;
+    const Address start = align_down(buffer.address(), KiB(4));
+    const Address end = align(buffer.address() + size, KiB(4));
+
+    // look for a mapped region containing or overlapping the ring buffer
+    auto ite = gxm.memory_mapped_regions.lower_bound(start);
+    if (ite != gxm.memory_mapped_regions.begin()) {
+        const auto prev = std::prev(ite);
+        if (prev->first + prev->second.size >= buffer.address() + size)
+            return;
+        if (prev->first + prev->second.size > start)
+            ite = prev;
+    }
+    if (ite != gxm.memory_mapped_regions.end() && ite->first < end) {
+        if (ite->first > buffer.address() || ite->first + ite->second.size < buffer.address() + size)
+            LOG_WARN("Ring buffer at 0x{:X} is partially mapped, default uniform buffers may not be read by the GPU", buffer.address());
+        return;
+    }
+
+    LOG_INFO("Mapping the ring buffer at 0x{:X} which was not mapped by the game", buffer.address());
+    gxm.memory_mapped_regions.emplace(start, MemoryMapInfo{ start, end - start, SCE_GXM_MEMORY_ATTRIB_READ });
+    renderer::send_single_command(*emuenv.renderer, nullptr, renderer::CommandOpcode::MemoryMap, true, Ptr<void>(start), end - start);
+    ctx->mapped_ring_buffers.push_back(start);
+}
+
 EXPORT(int, sceGxmCreateContext, const SceGxmContextParams *params, Ptr<SceGxmContext> *context) {
     TRACY_FUNC(sceGxmCreateContext, params, context);
     if (!params || !context)
@@ -1796,6 +1843,9 @@ EXPORT(int, sceGxmCreateContext, const SceGxmContextParams *params, Ptr<SceGxmCo
         return RET_ERROR(SCE_GXM_ERROR_DRIVER);
     }
 
+    gxmMapRingBuffer(emuenv, ctx, params->vertexRingBufferMem, params->vertexRingBufferMemSize);
+    gxmMapRingBuffer(emuenv, ctx, params->fragmentRingBufferMem, params->fragmentRingBufferMemSize);
+
     // Set VDM buffer space
     ctx->state.vdm_buffer = params->vdmRingBufferMem;
     ctx->state.vdm_buffer_size = params->vdmRingBufferMemSize;
@@ -2019,7 +2069,14 @@ EXPORT(int, sceGxmDestroyContext, Ptr<SceGxmContext> context) {
     if (!context)
         return RET_ERROR(SCE_GXM_ERROR_INVALID_POINTER);
 
-    renderer::destroy_context(*emuenv.renderer, context.get(emuenv.mem)->renderer);
+    SceGxmContext *ctx = context.get(emuenv.mem);
+    renderer::destroy_context(*emuenv.renderer, ctx->renderer);
+
+    for (const Address ring_buffer : ctx->mapped_ring_buffers) {
+        renderer::send_single_command(*emuenv.renderer, nullptr, renderer::CommandOpcode::MemoryUnmap, true, Ptr<void>(ring_buffer));
+        emuenv.gxm.memory_mapped_regions.erase(ring_buffer);
+    }
+    ctx->mapped_ring_buffers.clear();
 
     return 0;
 }
@@ -2137,6 +2194,60 @@ static void gxmSetUniformBuffers(renderer::State &state, GxmState &gxm, SceGxmCo
     }
 }
 
+// below this count, scanning the indices is cheaper than looking up the cache
+constexpr uint32_t INDEX_RANGE_CACHE_MIN_COUNT = 256;
+// an index buffer written more often than this is not protected anymore
+constexpr uint32_t INDEX_RANGE_MAX_PROTECT_COUNT = 8;
+
+// static index buffers are only scanned again once the guest writes to them
+static uint32_t get_max_index(EmuEnvState &emuenv, Ptr<const void> index_data, uint32_t index_count, SceGxmIndexFormat index_format) {
+    const void *indices = index_data.get(emuenv.mem);
+    if (index_count < INDEX_RANGE_CACHE_MIN_COUNT)
+        return gxm::get_max_index(indices, index_count, index_format);
+
+    const uint32_t size = index_count * gxm::index_element_size(index_format);
+    const uint64_t key = (static_cast<uint64_t>(index_data.address()) << 32) | size;
+
+    const std::lock_guard<std::mutex> guard(emuenv.gxm.index_ranges_mutex);
+    std::shared_ptr<IndexRange> &range = emuenv.gxm.index_ranges[key];
+    if (!range) {
+        // only protect the index buffers which are used more than once
+        range = std::make_shared<IndexRange>();
+        return gxm::get_max_index(indices, index_count, index_format);
+    }
+
+    if (range->is_dynamic)
+        return gxm::get_max_index(indices, index_count, index_format);
+
+    if (range->dirty.load(std::memory_order_acquire)) {
+        if (range->protect_count == INDEX_RANGE_MAX_PROTECT_COUNT) {
+            // this is not a static index buffer, protecting it only adds faults
+            range->is_dynamic = true;
+            return gxm::get_max_index(indices, index_count, index_format);
+        }
+
+        // protect before scanning the indices so that no write is missed
+        range->dirty = false;
+        range->protect_count++;
+        const Address protect_begin = align_down(index_data.address(), emuenv.mem.page_size);
+        const Address protect_end = align(index_data.address() + size, emuenv.mem.page_size);
+        const bool is_protected = add_protect(emuenv.mem, protect_begin, protect_end - protect_begin, MemPerm::ReadOnly, [range = range](Address, bool) {
+            range->dirty.store(true, std::memory_order_release);
+            return true;
+        });
+        if (!is_protected) {
+            range->is_dynamic = true;
+            return gxm::get_max_index(indices, index_count, index_format);
+        }
+    } else if (range->format == index_format) {
+        return range->max_index;
+    }
+
+    range->format = index_format;
+    range->max_index = gxm::get_max_index(indices, index_count, index_format);
+    return range->max_index;
+}
+
 static int gxmDrawElementGeneral(EmuEnvState &emuenv, const char *export_name, const SceUID thread_id, SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, Ptr<const void> indexData, uint32_t indexCount, uint32_t instanceCount) {
     if (!context || !indexData)
         return RET_ERROR(SCE_GXM_ERROR_INVALID_POINTER);
@@ -2160,8 +2271,6 @@ static int gxmDrawElementGeneral(EmuEnvState &emuenv, const char *export_name, c
     const SceGxmProgram &vertex_program_gxp = *gxm_vertex_program.program.get(emuenv.mem);
     const SceGxmProgram &fragment_program_gxp = *gxm_fragment_program.program.get(emuenv.mem);
 
-    const void *indices_ptr = indexData.get(emuenv.mem);
-
     gxmSetUniformBuffers(*emuenv.renderer, emuenv.gxm, context, vertex_program_gxp, context->state.vertex_uniform_buffers, gxm_vertex_program.renderer_data->uniform_buffer_sizes,
         emuenv.kernel, emuenv.mem, thread_id);
     gxmSetUniformBuffers(*emuenv.renderer, emuenv.gxm, context, fragment_program_gxp, context->state.fragment_uniform_buffers, gxm_fragment_program.renderer_data->uniform_buffer_sizes,
@@ -2197,13 +2306,7 @@ static int gxmDrawElementGeneral(EmuEnvState &emuenv, const char *export_name, c
     size_t max_index = 0;
     if (!emuenv.renderer->features.support_memory_mapping) {
         // we don't need to get the vertex buffer size with memory mapping
-        if (indexType == SCE_GXM_INDEX_FORMAT_U16) {
-            const uint16_t *const data = reinterpret_cast<const uint16_t *>(indices_ptr);
-            max_index = *std::max_element(&data[0], &data[indexCount]);
-        } else {
-            const uint32_t *const data = reinterpret_cast<const uint32_t *>(indices_ptr);
-            max_index = *std::max_element(&data[0], &data[indexCount]);
-        }
+        max_index = get_max_index(emuenv, indexData, indexCount, indexType);
     }
 
     size_t max_data_length[SCE_GXM_MAX_VERTEX_STREAMS] = {};
@@ -2222,19 +2325,16 @@ static int gxmDrawElementGeneral(EmuEnvState &emuenv, const char *export_name, c
         stream_used |= (1 << attribute.streamIndex);
     }
 
-    // Copy and queue upload
+    // Streams are sent along with the draw itself
+    renderer::GXMStreamInfo streams[SCE_GXM_MAX_VERTEX_STREAMS];
     for (size_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; ++stream_index) {
-        // Upload it
         if (stream_used & (1 << static_cast<std::uint16_t>(stream_index))) {
-            const size_t data_length = max_data_length[stream_index];
-            const Ptr<const void> data = context->state.stream_data[stream_index];
-
-            renderer::set_vertex_stream(*emuenv.renderer, context->renderer.get(), stream_index,
-                data_length, data);
+            streams[stream_index].data = context->state.stream_data[stream_index].cast<const uint8_t>();
+            streams[stream_index].size = max_data_length[stream_index];
         }
     }
 
-    renderer::draw(*emuenv.renderer, context->renderer.get(), primType, indexType, indexData, indexCount, instanceCount);
+    renderer::draw_packed(*emuenv.renderer, context->renderer.get(), primType, indexType, indexData, indexCount, instanceCount, static_cast<std::uint16_t>(stream_used), streams);
 
     // increase the ringbuffer position if a default vertex or fragment buffer was reserved, we know the new position will fit in the ringbuffer
     if (context->was_vert_default_uniform_reserved) {
@@ -2320,13 +2420,7 @@ EXPORT(int, sceGxmDrawPrecomputed, SceGxmContext *context, SceGxmPrecomputedDraw
     uint32_t max_index = 0;
     if (!emuenv.renderer->features.support_memory_mapping) {
         // we don't need to get the vertex buffer size with memory mapping
-        if (draw->index_format == SCE_GXM_INDEX_FORMAT_U16) {
-            const uint16_t *const data = draw->index_data.cast<const uint16_t>().get(emuenv.mem);
-            max_index = *std::max_element(&data[0], &data[draw->vertex_count]);
-        } else {
-            const uint32_t *const data = draw->index_data.cast<const uint32_t>().get(emuenv.mem);
-            max_index = *std::max_element(&data[0], &data[draw->vertex_count]);
-        }
+        max_index = get_max_index(emuenv, draw->index_data, draw->vertex_count, draw->index_format);
     }
 
     // set all textures that are used and mark them as dirty
@@ -2346,10 +2440,17 @@ EXPORT(int, sceGxmDrawPrecomputed, SceGxmContext *context, SceGxmPrecomputedDraw
             renderer::set_texture(*emuenv.renderer, context->renderer.get(), texture_index, frag_textures[texture_index]);
     }
 
+    // the streams used were computed by sceGxmPrecomputedDrawInit, the attributes only have to be walked again
+    // to get the size of the data to copy or if the draw is done with another vertex program
     size_t max_data_length[SCE_GXM_MAX_VERTEX_STREAMS] = {};
-    std::uint32_t stream_used = 0;
-    for (const SceGxmVertexAttribute &attribute : vertex_program->attributes) {
-        if (!emuenv.renderer->features.support_memory_mapping) {
+    std::uint32_t stream_used = draw->stream_used;
+    if (!emuenv.renderer->features.support_memory_mapping || draw->program != vertex_program_gptr) {
+        stream_used = 0;
+        for (const SceGxmVertexAttribute &attribute : vertex_program->attributes) {
+            stream_used |= (1 << attribute.streamIndex);
+            if (emuenv.renderer->features.support_memory_mapping)
+                continue;
+
             const SceGxmAttributeFormat attribute_format = static_cast<SceGxmAttributeFormat>(attribute.format);
             const size_t attribute_size = gxm::attribute_format_size(attribute_format) * attribute.componentCount;
             const SceGxmVertexStream &stream = vertex_program->streams[attribute.streamIndex];
@@ -2358,24 +2459,19 @@ EXPORT(int, sceGxmDrawPrecomputed, SceGxmContext *context, SceGxmPrecomputedDraw
             const size_t data_length = attribute.offset + data_passed_length + attribute_size;
             max_data_length[attribute.streamIndex] = std::max<size_t>(max_data_length[attribute.streamIndex], data_length);
         }
-
-        stream_used |= (1 << attribute.streamIndex);
     }
 
     auto stream_data = draw->stream_data.get(emuenv.mem);
-    // Copy and queue upload
+    // Streams are sent along with the draw itself
+    renderer::GXMStreamInfo streams[SCE_GXM_MAX_VERTEX_STREAMS];
     for (size_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; ++stream_index) {
-        // Upload it
         if (stream_used & (1 << static_cast<std::uint16_t>(stream_index))) {
-            const size_t data_length = max_data_length[stream_index];
-            const Ptr<const void> data = stream_data[stream_index];
-
-            renderer::set_vertex_stream(*emuenv.renderer, context->renderer.get(), stream_index,
-                data_length, data);
+            streams[stream_index].data = stream_data[stream_index].cast<const uint8_t>();
+            streams[stream_index].size = max_data_length[stream_index];
         }
     }
 
-    renderer::draw(*emuenv.renderer, context->renderer.get(), draw->type, draw->index_format, draw->index_data, draw->vertex_count, draw->instance_count);
+    renderer::draw_packed(*emuenv.renderer, context->renderer.get(), draw->type, draw->index_format, draw->index_data, draw->vertex_count, draw->instance_count, static_cast<std::uint16_t>(stream_used), streams);
 
     // increase the ringbuffer position if a default vertex or fragment buffer was reserved, we know the new position will fit in the ringbuffer
     // also even in a precomputed draw, this is needed as some parts of the pipeline can be not precomputed
@@ -2664,7 +2760,7 @@ EXPORT(int, sceGxmInitialize, const SceGxmInitializeParams *params) {
     // also, the last frame won't be in the queue so decrease the count by 1
     // the case where displayQueueMaxPendingCount is 1 handled in sceGxmDisplayQueueAddEntry
     const uint32_t max_queue_size = std::max(std::min(params->displayQueueMaxPendingCount, 3U) - 1, 1U);
-    emuenv.gxm.display_queue.maxPendingCount_ = max_queue_size;
+    emuenv.gxm.display_queue.max_pending = max_queue_size;
 
     const ThreadStatePtr main_thread = util::find(thread_id, emuenv.kernel.threads);
     const ThreadStatePtr display_queue_thread = emuenv.kernel.create_thread(emuenv.mem, "SceGxmDisplayQueue", Ptr<void>(0), SCE_KERNEL_HIGHEST_PRIORITY_USER, SCE_KERNEL_THREAD_CPU_AFFINITY_MASK_DEFAULT, SCE_KERNEL_STACK_SIZE_USER_DEFAULT, nullptr);
@@ -2787,13 +2883,7 @@ EXPORT(int, sceGxmNotificationWait, const SceGxmNotification *notification) {
         return RET_ERROR(SCE_GXM_ERROR_INVALID_POINTER);
     }
 
-    std::uint32_t volatile *value = notification->address.get(emuenv.mem);
-    const std::uint32_t target_value = notification->value;
-
-    std::unique_lock<std::mutex> lock(emuenv.renderer->notification_mutex);
-    if (*value != target_value) {
-        emuenv.renderer->notification_ready.wait(lock, [&]() { return *value == target_value; });
-    }
+    renderer::wait_notification(*emuenv.renderer, emuenv.mem, *notification);
 
     return 0;
 }
@@ -2831,12 +2921,15 @@ EXPORT(int, sceGxmPrecomputedDrawInit, SceGxmPrecomputedDraw *state, Ptr<const S
     new_draw.program = program;
 
     uint16_t max_stream_index = 0;
+    uint16_t stream_used = 0;
     const auto &gxm_vertex_program = *program.get(emuenv.mem);
     for (const SceGxmVertexAttribute &attribute : gxm_vertex_program.attributes) {
         max_stream_index = std::max(attribute.streamIndex, max_stream_index);
+        stream_used |= (1 << attribute.streamIndex);
     }
 
     new_draw.stream_count = max_stream_index + 1;
+    new_draw.stream_used = stream_used;
     new_draw.stream_data = extra_data.cast<StreamData>();
 
     *state = new_draw;
@@ -4290,6 +4383,12 @@ void free_callbacked(EmuEnvState &emuenv, SceUID thread_id, SceGxmShaderPatcher
     free_callbacked(emuenv, thread_id, shaderPatcher, data.address());
 }
 
+// the program can be loaded again at the same address with another content once unregistered
+static void purge_released_programs(SceGxmShaderPatcher *shaderPatcher, Ptr<const SceGxmProgram> program) {
+    std::erase_if(shaderPatcher->released_vertex_programs, [&](const auto &entry) { return entry.first.vertex_program.program == program; });
+    std::erase_if(shaderPatcher->released_fragment_programs, [&](const auto &entry) { return entry.first.fragment_program.program == program; });
+}
+
 EXPORT(int, sceGxmShaderPatcherAddRefFragmentProgram, SceGxmShaderPatcher *shaderPatcher, SceGxmFragmentProgram *fragmentProgram) {
     TRACY_FUNC(sceGxmShaderPatcherAddRefFragmentProgram, shaderPatcher, fragmentProgram);
     if (!shaderPatcher || !fragmentProgram)
@@ -4361,7 +4460,11 @@ EXPORT(int, sceGxmShaderPatcherCreateFragmentProgram, SceGxmShaderPatcher *shade
     fp->is_maskupdate = false;
     fp->program = programId->program;
 
-    if (!renderer::create(fp->renderer_data, *emuenv.renderer, *programId->program.get(mem), blendInfo, emuenv.renderer->gxp_ptr_map, emuenv.cache_path.string().c_str(), emuenv.io.title_id.c_str())) {
+    const auto released = shaderPatcher->released_fragment_programs.find(key);
+    if (released != shaderPatcher->released_fragment_programs.end()) {
+        fp->renderer_data = std::move(released->second);
+        shaderPatcher->released_fragment_programs.erase(released);
+    } else if (!renderer::create(fp->renderer_data, *emuenv.renderer, *programId->program.get(mem), blendInfo, emuenv.renderer->gxp_ptr_map, emuenv.cache_path.string().c_str(), emuenv.io.title_id.c_str())) {
         return RET_ERROR(SCE_GXM_ERROR_DRIVER);
     }
 
@@ -4440,8 +4543,17 @@ EXPORT(int, sceGxmShaderPatcherCreateVertexProgram, SceGxmShaderPatcher *shaderP
         vp->attributes.insert(vp->attributes.end(), &attributes[0], &attributes[attributeCount]);
     }
 
-    if (!renderer::create(vp->renderer_data, *emuenv.renderer, *programId->program.get(mem), emuenv.renderer->gxp_ptr_map, vp->attributes, emuenv.cache_path.string().c_str(), emuenv.io.title_id.c_str())) {
-        return RET_ERROR(SCE_GXM_ERROR_DRIVER);
+    const auto released = shaderPatcher->released_vertex_programs.find(key);
+    if (released != shaderPatcher->released_vertex_programs.end()) {
+        vp->renderer_data = std::move(released->second);
+        shaderPatcher->released_vertex_programs.erase(released);
+    } else {
+        if (!renderer::create(vp->renderer_data, *emuenv.renderer, *programId->program.get(mem), emuenv.renderer->gxp_ptr_map, vp->attributes, emuenv.cache_path.string().c_str(), emuenv.io.title_id.c_str())) {
+            return RET_ERROR(SCE_GXM_ERROR_DRIVER);
+        }
+
+        // programs without their symbols can only be translated once the attributes are known
+        renderer::translate_shader_async(*emuenv.renderer, *programId->program.get(mem), &vp->attributes, emuenv.cfg.shader_cache, emuenv.cfg.spirv_shader);
     }
 
     shaderPatcher->vertex_program_cache.emplace(key, *vertexProgram);
@@ -4496,6 +4608,7 @@ EXPORT(int, sceGxmShaderPatcherForceUnregisterProgram, SceGxmShaderPatcher *shad
         }
     }
 
+    purge_released_programs(shaderPatcher, rp->program);
     rp->program.reset();
     free_callbacked(emuenv, thread_id, shaderPatcher, programId);
 
@@ -4573,6 +4686,9 @@ EXPORT(int, sceGxmShaderPatcherRegisterProgram, SceGxmShaderPatcher *shaderPatch
     SceGxmRegisteredProgram *const rp = programId->get(emuenv.mem);
     rp->program = programHeader;
 
+    // start translating the shader now so the first draw using it does not have to
+    renderer::translate_shader_async(*emuenv.renderer, *programHeader.get(emuenv.mem), nullptr, emuenv.cfg.shader_cache, emuenv.cfg.spirv_shader);
+
     return 0;
 }
 
@@ -4589,6 +4705,9 @@ EXPORT(int, sceGxmShaderPatcherReleaseFragmentProgram, SceGxmShaderPatcher *shad
 
         for (FragmentProgramCache::const_iterator it = shaderPatcher->fragment_program_cache.begin(); it != shaderPatcher->fragment_program_cache.end(); ++it) {
             if (it->second == fragmentProgram) {
+                if (shaderPatcher->released_fragment_programs.size() >= MAX_RELEASED_PROGRAMS)
+                    shaderPatcher->released_fragment_programs.erase(shaderPatcher->released_fragment_programs.begin());
+                shaderPatcher->released_fragment_programs.insert_or_assign(it->first, std::move(fp->renderer_data));
                 shaderPatcher->fragment_program_cache.erase(it);
                 break;
             }
@@ -4612,6 +4731,9 @@ EXPORT(int, sceGxmShaderPatcherReleaseVertexProgram, SceGxmShaderPatcher *shader
 
         for (VertexProgramCache::const_iterator it = shaderPatcher->vertex_program_cache.begin(); it != shaderPatcher->vertex_program_cache.end(); ++it) {
             if (it->second == vertexProgram) {
+                if (shaderPatcher->released_vertex_programs.size() >= MAX_RELEASED_PROGRAMS)
+                    shaderPatcher->released_vertex_programs.erase(shaderPatcher->released_vertex_programs.begin());
+                shaderPatcher->released_vertex_programs.insert_or_assign(it->first, std::move(vp->renderer_data));
                 shaderPatcher->vertex_program_cache.erase(it);
                 break;
             }
@@ -4642,6 +4764,7 @@ EXPORT(int, sceGxmShaderPatcherUnregisterProgram, SceGxmShaderPatcher *shaderPat
         return RET_ERROR(SCE_GXM_ERROR_INVALID_POINTER);
 
     SceGxmRegisteredProgram *const rp = programId.get(emuenv.mem);
+    purge_released_programs(shaderPatcher, rp->program);
     rp->program.reset();
 
     free_callbacked(emuenv, thread_id, shaderPatcher, programId);
@@ -5368,6 +5491,8 @@ EXPORT(int, sceGxmTransferDownscale, SceGxmTransferFormat srcFormat, Ptr<void> s
     dest->address = destAddress;
     dest->x = destX;
     dest->y = destY;
+    dest->width = srcWidth / 2;
+    dest->height = srcHeight / 2;
     dest->stride = destStride;
 
     renderer::transfer_downscale(*emuenv.renderer, src, dest);
@@ -117,6 +117,81 @@ std::string to_debug_str<SceHttpsFlags>(const MemState &mem, SceHttpsFlags type)
     return out;
 }
 
+// getaddrinfo does not give the TTL of the records, so the resolved addresses are kept for a fixed time
+constexpr auto RESOLVED_HOST_TTL = std::chrono::seconds(60);
+// servers usually close kept alive connections after a few seconds without requests
+constexpr auto IDLE_CONNECTION_TIMEOUT = std::chrono::seconds(15);
+constexpr size_t MAX_IDLE_CONNECTIONS_PER_HOST = 4;
+
+static void close_connection(int sockfd, void *ssl) {
+    if (ssl)
+        SSL_free((SSL *)ssl);
+    if (sockfd < 0)
+        return;
+#ifdef WIN32
+    closesocket(sockfd);
+#else
+    close(sockfd);
+#endif // WIN32
+}
+
+static bool resolve_host(HTTPState &http, const std::string &hostname, const std::string &port, HttpResolvedHost &host) {
+    const auto now = std::chrono::steady_clock::now();
+    const std::string key = hostname + ":" + port;
+    const auto it = http.resolvedHosts.find(key);
+    if ((it != http.resolvedHosts.end()) && (it->second.expires > now)) {
+        host = it->second;
+        return true;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC; /* Allow IPv4 or IPv6 */
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    const auto ret = getaddrinfo(hostname.c_str(), port.c_str(), &hints, &result);
+    if (ret != 0) {
+        LOG_ERROR("getaddrinfo({},{},...) = {}", hostname, port, ret);
+        return false;
+    }
+
+    host.family = result->ai_family;
+    host.address.assign(reinterpret_cast<const uint8_t *>(result->ai_addr), reinterpret_cast<const uint8_t *>(result->ai_addr) + result->ai_addrlen);
+    host.expires = now + RESOLVED_HOST_TTL;
+    freeaddrinfo(result);
+
+    http.resolvedHosts[key] = host;
+    return true;
+}
+
+// the server may have closed an idle connection, which then is readable without data
+static bool is_connection_alive(int sockfd) {
+    net_utils::socketSetBlocking(sockfd, false);
+    char byte;
+    const auto ret = recv(sockfd, &byte, 1, MSG_PEEK);
+#ifdef WIN32
+    const bool wouldBlock = (ret < 0) && (WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+    const bool wouldBlock = (ret < 0) && ((errno == EWOULDBLOCK) || (errno == EAGAIN));
+#endif
+    net_utils::socketSetBlocking(sockfd, true);
+    return wouldBlock;
+}
+
+static bool take_idle_connection(HTTPState &http, const std::string &hostKey, HttpIdleConnection &connection) {
+    const auto now = std::chrono::steady_clock::now();
+    const auto [begin, end] = http.idleConnections.equal_range(hostKey);
+    for (auto it = begin; it != end;) {
+        const HttpIdleConnection idle = it->second;
+        it = http.idleConnections.erase(it);
+        if ((now - idle.lastUsed < IDLE_CONNECTION_TIMEOUT) && is_connection_alive(idle.sockfd)) {
+            connection = idle;
+            return true;
+        }
+        close_connection(idle.sockfd, idle.ssl);
+    }
+    return false;
+}
+
 EXPORT(int, sceHttpAbortRequest) {
     TRACY_FUNC(sceHttpAbortRequest);
     return UNIMPLEMENTED();
@@ -252,25 +327,24 @@ EXPORT(SceInt, sceHttpCreateConnectionWithURL, SceInt tmplId, const char *url, S
         port = parsed.port;
     // If fifth character is an s (meaning https) use 443, else 80
 
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    assert(sockfd);
-    if (sockfd < 0) {
-        LOG_ERROR("ERROR opening socket");
-        return RET_ERROR(SCE_HTTP_ERROR_UNKNOWN);
-    }
-
-    const addrinfo hints = {
-        AI_PASSIVE, /* For wildcard IP address */
-        AF_UNSPEC, /* Allow IPv4 or IPv6 */
-        SOCK_DGRAM, /* Datagram socket */
-        0, /* Any protocol */
-    };
-    addrinfo *result = { 0 };
-
     const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
+    const std::string hostKey = (isSecure ? "https://" : "http://") + parsed.hostname + ":" + port;
+
+    // reuse a kept alive connection to the same host, this skips the DNS lookup, the TCP connection and the TLS handshake
+    HttpIdleConnection idle;
+    if (emuenv.cfg.http_enable && enableKeepalive && take_idle_connection(emuenv.http, hostKey, idle)) {
+        for (auto &callback : emuenv.netctl.callbacks) {
+            if (callback.pc != 0) {
+                thread->run_callback(callback.pc, { SCE_NET_CTL_EVENT_TYPE_IPOBTAINED, callback.arg });
+            }
+        }
+        LOG_TRACE("Reusing connection to {}", url);
+        emuenv.http.connections.emplace(connId, SceConnection{ tmplId, urlStr, enableKeepalive, isSecure, idle.sockfd, idle.ssl, hostKey });
+        return connId;
+    }
 
-    auto ret = getaddrinfo(parsed.hostname.c_str(), port.c_str(), &hints, &result);
-    if (ret < 0) {
+    HttpResolvedHost host;
+    if (!resolve_host(emuenv.http, parsed.hostname, port, host)) {
         if (!emuenv.cfg.http_enable) {
             LOG_WARN("getaddrinfo failed, but http is disabled, asume we still got it");
 
@@ -281,12 +355,11 @@ EXPORT(SceInt, sceHttpCreateConnectionWithURL, SceInt tmplId, const char *url, S
                 }
             }
             // Need to push the connection here so the id exists when "sending" the request
-            emuenv.http.connections.emplace(connId, SceConnection{ tmplId, urlStr, enableKeepalive, isSecure, sockfd });
+            emuenv.http.connections.emplace(connId, SceConnection{ tmplId, urlStr, enableKeepalive, isSecure, -1 });
 
             return connId;
         }
 
-        LOG_ERROR("getaddrinfo({},{},...) = {}", url, port, ret);
         return RET_ERROR(SCE_HTTP_ERROR_RESOLVER_ENODNS);
     }
 
@@ -299,43 +372,58 @@ EXPORT(SceInt, sceHttpCreateConnectionWithURL, SceInt tmplId, const char *url, S
 
     if (!emuenv.cfg.http_enable) {
         // Need to push the connection here so the id exists when "sending" the request
-        emuenv.http.connections.emplace(connId, SceConnection{ tmplId, urlStr, enableKeepalive, isSecure, sockfd });
+        emuenv.http.connections.emplace(connId, SceConnection{ tmplId, urlStr, enableKeepalive, isSecure, -1 });
         return connId;
     }
 
-    ret = connect(sockfd, result->ai_addr, result->ai_addrlen);
+    int sockfd = socket(host.family, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        LOG_ERROR("ERROR opening socket");
+        return RET_ERROR(SCE_HTTP_ERROR_UNKNOWN);
+    }
+
+    auto ret = connect(sockfd, reinterpret_cast<const sockaddr *>(host.address.data()), static_cast<socklen_t>(host.address.size()));
     if (ret < 0) {
         LOG_ERROR("connect({},...) = {}, errno={}({})", sockfd, ret, errno, strerror(errno));
+        close_connection(sockfd, nullptr);
+        // the address may have changed
+        emuenv.http.resolvedHosts.erase(parsed.hostname + ":" + port);
         return RET_ERROR(SCE_HTTP_ERROR_RESOLVER_ENOHOST);
     }
 
     LOG_TRACE("Connected to {}", url);
 
+    SSL *ssl = nullptr;
     if (isSecure) {
         if (!emuenv.http.sslInited) {
             LOG_ERROR("SSL not inited on secure connection");
+            close_connection(sockfd, nullptr);
             return RET_ERROR(SCE_HTTP_ERROR_SSL);
         }
 
-        SSL_set_fd((SSL *)tmpl->second.ssl, sockfd);
+        // each connection has its own session, created with the options of the template
+        ssl = SSL_new(SSL_get_SSL_CTX((SSL *)tmpl->second.ssl));
+        SSL_set_fd(ssl, sockfd);
 
         // This is needed as some servers are using handshake protocols older than the person writing this code
-        SSL_set_security_level((SSL *)tmpl->second.ssl, 0);
+        SSL_set_security_level(ssl, 0);
 
-        int err = SSL_connect((SSL *)tmpl->second.ssl);
+        int err = SSL_connect(ssl);
         if (err != 1) {
-            int sslErr = SSL_get_error((SSL *)tmpl->second.ssl, err);
+            int sslErr = SSL_get_error(ssl, err);
             LOG_ERROR("SSL_connect(...) = {}, SSLERR = {}", err, sslErr);
-            if (sslErr == SSL_ERROR_SSL)
+            if (sslErr == SSL_ERROR_SSL) {
+                close_connection(sockfd, ssl);
                 return RET_ERROR(SCE_HTTP_ERROR_SSL);
+            }
         }
 
-        long verify_flag = SSL_get_verify_result((SSL *)tmpl->second.ssl);
+        long verify_flag = SSL_get_verify_result(ssl);
         if (verify_flag != X509_V_OK && verify_flag != X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY)
             LOG_ERROR("Certificate verification error ({}) but continuing...\n", (int)verify_flag);
     }
 
-    emuenv.http.connections.emplace(connId, SceConnection{ tmplId, urlStr, enableKeepalive, isSecure, sockfd });
+    emuenv.http.connections.emplace(connId, SceConnection{ tmplId, urlStr, enableKeepalive, isSecure, sockfd, ssl, hostKey });
 
     return connId;
 }
@@ -567,11 +655,13 @@ EXPORT(SceInt, sceHttpDeleteConnection, SceInt connId) {
 
     if (connIt == emuenv.http.connections.end())
         return RET_ERROR(SCE_HTTP_ERROR_INVALID_ID);
-#ifdef WIN32
-    closesocket(connIt->second.sockfd);
-#else
-    close(connIt->second.sockfd);
-#endif // WIN32
+
+    // keep the connection open for the next connection to the same host
+    const SceConnection &conn = connIt->second;
+    if (conn.reusable && (emuenv.http.idleConnections.count(conn.hostKey) < MAX_IDLE_CONNECTIONS_PER_HOST))
+        emuenv.http.idleConnections.emplace(conn.hostKey, HttpIdleConnection{ conn.sockfd, conn.ssl, std::chrono::steady_clock::now() });
+    else
+        close_connection(conn.sockfd, conn.ssl);
 
     emuenv.http.connections.erase(connIt);
 
@@ -964,6 +1054,9 @@ EXPORT(SceInt, sceHttpSendRequest, SceInt reqId, const char *postData, SceSize s
 
     LOG_DEBUG("Sending {} request to {}", net_utils::int_method_to_char(req->second.method), req->second.url);
 
+    // the connection can only be reused once a whole response has been read from it
+    conn->second.reusable = false;
+
     // TODO: Also support file scheme, doesn't really require any connections, not sure how it handles headers and such
     if (req->second.method == SCE_HTTP_METHOD_TRACE || req->second.method == SCE_HTTP_METHOD_CONNECT) {
         LOG_WARN("Unimplemented method {}, report to devs", req->second.method);
@@ -1015,7 +1108,7 @@ EXPORT(SceInt, sceHttpSendRequest, SceInt reqId, const char *postData, SceSize s
     do {
         int bytes = 0;
         if (conn->second.isSecure)
-            bytes = SSL_write((SSL *)tmpl->second.ssl, req->second.message.c_str() + reqBytesSent, msgLength - reqBytesSent);
+            bytes = SSL_write((SSL *)conn->second.ssl, req->second.message.c_str() + reqBytesSent, msgLength - reqBytesSent);
         else
             bytes = write(conn->second.sockfd, req->second.message.c_str() + reqBytesSent, msgLength - reqBytesSent);
 
@@ -1036,7 +1129,7 @@ EXPORT(SceInt, sceHttpSendRequest, SceInt reqId, const char *postData, SceSize s
         auto dataBytes = 0;
         do {
             if (conn->second.isSecure)
-                dataBytes = SSL_write((SSL *)tmpl->second.ssl, postData + dataSent, size - dataSent);
+                dataBytes = SSL_write((SSL *)conn->second.ssl, postData + dataSent, size - dataSent);
             else
                 dataBytes = write(conn->second.sockfd, postData + dataSent, size - dataSent);
 
@@ -1068,7 +1161,7 @@ EXPORT(SceInt, sceHttpSendRequest, SceInt reqId, const char *postData, SceSize s
     do {
         int bytes = 0;
         if (conn->second.isSecure)
-            bytes = SSL_read((SSL *)tmpl->second.ssl, resHeaders + totalReceived, resHeadersMaxSize - totalReceived);
+            bytes = SSL_read((SSL *)conn->second.ssl, resHeaders + totalReceived, resHeadersMaxSize - totalReceived);
         else
             bytes = read(conn->second.sockfd, resHeaders + totalReceived, resHeadersMaxSize - totalReceived);
         if (bytes < 0) {
@@ -1146,7 +1239,7 @@ EXPORT(SceInt, sceHttpSendRequest, SceInt reqId, const char *postData, SceSize s
     while (remainingToRead != 0) {
         int bytes = 0;
         if (conn->second.isSecure)
-            bytes = SSL_read((SSL *)tmpl->second.ssl, reqResponse + totalReceived, remainingToRead);
+            bytes = SSL_read((SSL *)conn->second.ssl, reqResponse + totalReceived, remainingToRead);
         else
             bytes = read(conn->second.sockfd, reqResponse + totalReceived, remainingToRead);
         if (bytes < 0) {
@@ -1201,6 +1294,10 @@ EXPORT(SceInt, sceHttpSendRequest, SceInt reqId, const char *postData, SceSize s
     req->second.res.responseRaw = reqResponse;
     req->second.res.body = reqResponse + resHeadersOnly.length() + strlen("\r\n\r\n");
 
+    const auto connectionHeader = req->second.res.headers.find("Connection");
+    const bool serverCloses = (connectionHeader != req->second.res.headers.end()) && boost::iequals(connectionHeader->second, "close");
+    conn->second.reusable = conn->second.keepAlive && (tmpl->second.httpVersion == SCE_HTTP_VERSION_1_1) && (req->second.res.httpVer != "1.0") && !serverCloses;
+
     LOG_TRACE("Request finished nicely");
 
     return 0;
@@ -1375,6 +1472,12 @@ EXPORT(SceInt, sceHttpTerm) {
     }
     emuenv.http.connections.clear();
 
+    for (auto &[_, idle] : emuenv.http.idleConnections) {
+        close_connection(idle.sockfd, idle.ssl);
+    }
+    emuenv.http.idleConnections.clear();
+    emuenv.http.resolvedHosts.clear();
+
     for (auto &req : emuenv.http.requests) {
         CALL_EXPORT(sceHttpDeleteRequest, req.first);
     }
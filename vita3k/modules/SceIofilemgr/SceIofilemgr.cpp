@@ -18,11 +18,31 @@
 #include "SceIofilemgr.h"
 
 #include <io/functions.h>
+#include <kernel/state.h>
+#include <kernel/sync_primitives.h>
 #include <kernel/types.h>
 
 #include <util/tracy.h>
 TRACY_MODULE_NAME(SceIofilemgr);
 
+SceUID submit_async_io(EmuEnvState &emuenv, const char *export_name, SceUID thread_id, SceUID fd, std::function<SceInt64()> run) {
+    const SceUID op_id = simple_event_create(emuenv.kernel, emuenv.mem, export_name, "SceIoAsyncOp", thread_id, SCE_KERNEL_EVENT_ATTR_MANUAL_RESET, 0);
+    if (op_id < 0)
+        return op_id;
+
+    KernelState &kernel = emuenv.kernel;
+    AsyncIoRequest request{
+        .op_id = op_id,
+        .run = std::move(run),
+        .on_complete = [&kernel, export_name, thread_id](SceUID op_id, SceInt64 result) {
+            simple_event_setorpulse(kernel, export_name, thread_id, op_id, SCE_IO_ASYNC_EVENT_DONE, result, true);
+        }
+    };
+    // requests not using a fd yet do not have to wait for any other
+    emuenv.io.async.submit(fd < 0 ? op_id : fd, std::move(request));
+    return op_id;
+}
+
 EXPORT(int, _sceIoChstat) {
     TRACY_FUNC(_sceIoChstat);
     return UNIMPLEMENTED();
@@ -96,9 +116,13 @@ EXPORT(SceOff, _sceIoLseek, const SceUID fd, Ptr<_sceIoLseekOpt> opt) {
     return seek_file(fd, opt.get(emuenv.mem)->offset, opt.get(emuenv.mem)->whence, emuenv.io, export_name);
 }
 
-EXPORT(int, _sceIoLseekAsync) {
-    TRACY_FUNC(_sceIoLseekAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, _sceIoLseekAsync, const SceUID fd, Ptr<_sceIoLseekOpt> opt) {
+    TRACY_FUNC(_sceIoLseekAsync, fd, opt);
+    const SceOff offset = opt.get(emuenv.mem)->offset;
+    const SceIoSeekMode whence = opt.get(emuenv.mem)->whence;
+    return submit_async_io(emuenv, export_name, thread_id, fd, [&emuenv, export_name, fd, offset, whence]() -> SceInt64 {
+        return seek_file(fd, offset, whence, emuenv.io, export_name);
+    });
 }
 
 EXPORT(int, _sceIoMkdir, const char *dir, const SceMode mode) {
@@ -120,9 +144,15 @@ EXPORT(int, _sceIoOpen, const char *file, const int flags, const SceMode mode) {
     return open_file(emuenv.io, file, flags, emuenv.pref_path.wstring(), export_name);
 }
 
-EXPORT(int, _sceIoOpenAsync) {
-    TRACY_FUNC(_sceIoOpenAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, _sceIoOpenAsync, const char *file, const int flags, const SceMode mode) {
+    TRACY_FUNC(_sceIoOpenAsync, file, flags, mode);
+    if (file == nullptr) {
+        return RET_ERROR(SCE_ERROR_ERRNO_EINVAL);
+    }
+    LOG_INFO("Opening file asynchronously: {}", file);
+    return submit_async_io(emuenv, export_name, thread_id, invalid_fd, [&emuenv, export_name, path = std::string(file), flags]() -> SceInt64 {
+        return open_file(emuenv.io, path.c_str(), flags, emuenv.pref_path.wstring(), export_name);
+    });
 }
 
 EXPORT(int, _sceIoPread) {
@@ -175,9 +205,9 @@ EXPORT(int, _sceIoRmdirAsync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, _sceIoSync) {
-    TRACY_FUNC(_sceIoSync);
-    return UNIMPLEMENTED();
+EXPORT(int, _sceIoSync, const char *device, const unsigned int unk) {
+    TRACY_FUNC(_sceIoSync, device, unk);
+    return sync_device(emuenv.io, device, export_name);
 }
 
 EXPORT(int, _sceIoSyncAsync) {
@@ -185,9 +215,12 @@ EXPORT(int, _sceIoSyncAsync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceIoCancel) {
-    TRACY_FUNC(sceIoCancel);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoCancel, const SceUID op_id) {
+    TRACY_FUNC(sceIoCancel, op_id);
+    // requests already running can not be stopped
+    if (!emuenv.io.async.cancel(op_id, static_cast<int>(SCE_ERROR_ERRNO_ECANCELED)))
+        return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVENT_ID);
+    return 0;
 }
 
 EXPORT(int, sceIoChstatByFdAsync) {
@@ -200,14 +233,23 @@ EXPORT(int, sceIoClose, const SceUID fd) {
     return close_file(emuenv.io, fd, export_name);
 }
 
-EXPORT(int, sceIoCloseAsync) {
-    TRACY_FUNC(sceIoCloseAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoCloseAsync, const SceUID fd) {
+    TRACY_FUNC(sceIoCloseAsync, fd);
+    return submit_async_io(emuenv, export_name, thread_id, fd, [&emuenv, export_name, fd]() -> SceInt64 {
+        return close_file(emuenv.io, fd, export_name);
+    });
 }
 
-EXPORT(int, sceIoComplete) {
-    TRACY_FUNC(sceIoComplete);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoComplete, const SceUID op_id) {
+    TRACY_FUNC(sceIoComplete, op_id);
+    SceInt64 result;
+    if (!emuenv.io.async.wait(op_id, result))
+        return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVENT_ID);
+
+    // the op id can not be used anymore
+    const std::lock_guard<std::shared_mutex> lock(emuenv.kernel.sync_objects_mutex);
+    emuenv.kernel.simple_events.erase(op_id);
+    return static_cast<int>(result);
 }
 
 EXPORT(int, sceIoDclose, const SceUID fd) {
@@ -275,9 +317,11 @@ EXPORT(int, sceIoRead, const SceUID fd, void *data, const SceSize size) {
     return read_file(data, emuenv.io, fd, size, export_name);
 }
 
-EXPORT(int, sceIoReadAsync) {
-    TRACY_FUNC(sceIoReadAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoReadAsync, const SceUID fd, void *data, const SceSize size) {
+    TRACY_FUNC(sceIoReadAsync, fd, data, size);
+    return submit_async_io(emuenv, export_name, thread_id, fd, [&emuenv, export_name, fd, data, size]() -> SceInt64 {
+        return read_file(data, emuenv.io, fd, size, export_name);
+    });
 }
 
 EXPORT(int, sceIoSetPriority) {
@@ -305,9 +349,9 @@ EXPORT(int, sceIoSetThreadDefaultPriorityForSystem) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceIoSyncByFd) {
-    TRACY_FUNC(sceIoSyncByFd);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoSyncByFd, const SceUID fd, const int flag) {
+    TRACY_FUNC(sceIoSyncByFd, fd, flag);
+    return sync_file(emuenv.io, fd, export_name);
 }
 
 EXPORT(int, sceIoSyncByFdAsync) {
@@ -320,7 +364,9 @@ EXPORT(int, sceIoWrite, const SceUID fd, const void *data, const SceSize size) {
     return write_file(fd, data, size, emuenv.io, export_name);
 }
 
-EXPORT(int, sceIoWriteAsync) {
-    TRACY_FUNC(sceIoWriteAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoWriteAsync, const SceUID fd, const void *data, const SceSize size) {
+    TRACY_FUNC(sceIoWriteAsync, fd, data, size);
+    return submit_async_io(emuenv, export_name, thread_id, fd, [&emuenv, export_name, fd, data, size]() -> SceInt64 {
+        return write_file(fd, data, size, emuenv.io, export_name);
+    });
 }
@@ -20,14 +20,24 @@
 #include <io/types.h>
 #include <module/module.h>
 
+#include <functional>
+
 typedef struct _sceIoLseekOpt {
     SceOff offset;
     SceIoSeekMode whence;
     uint32_t unk;
 } _sceIoLseekOpt;
 
+// pattern set on the event of an async request once it is done, with the result as user data
+#define SCE_IO_ASYNC_EVENT_DONE 0x1U
+
+// the returned op id is a simple event the guest can wait for or poll
+SceUID submit_async_io(EmuEnvState &emuenv, const char *export_name, SceUID thread_id, SceUID fd, std::function<SceInt64()> run);
+
 DECL_EXPORT(int, _sceIoDopen, const char *dir);
 DECL_EXPORT(int, _sceIoDread, const SceUID fd, SceIoDirent *dir);
 DECL_EXPORT(int, _sceIoMkdir, const char *dir, const SceMode mode);
 DECL_EXPORT(SceOff, _sceIoLseek, const SceUID fd, Ptr<_sceIoLseekOpt> opt);
+DECL_EXPORT(SceUID, _sceIoLseekAsync, const SceUID fd, Ptr<_sceIoLseekOpt> opt);
+DECL_EXPORT(SceUID, _sceIoOpenAsync, const char *file, const int flags, const SceMode mode);
 DECL_EXPORT(int, _sceIoGetstat, const char *file, SceIoStat *stat);
@@ -138,13 +138,9 @@ EXPORT(int, sceJpegDecodeMJpeg, const unsigned char *pJpeg, SceSize isize, uint8
 
     DecoderSize size = {};
 
-    // the yuv data will always be smaller than the rgba data, so osize is an upper bound
-    std::vector<uint8_t> temporary(osize);
-
+    // the decoded planes are converted straight to the output
     state->decoder->send(pJpeg, isize);
-    state->decoder->receive(temporary.data(), &size);
-
-    convert_yuv_to_rgb(temporary.data(), pRGBA, size.width, size.height, state->decoder->get_color_space());
+    state->decoder->receive_rgba(pRGBA, osize, &size);
 
     // Top 16 bits = width, bottom 16 bits = height.
     return (size.width << 16u) | size.height;
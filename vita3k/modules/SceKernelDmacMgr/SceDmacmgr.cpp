@@ -17,10 +17,36 @@
 
 #include <module/module.h>
 
-EXPORT(int, sceDmacMemcpy) {
-    return UNIMPLEMENTED();
+#include <mem/functions.h>
+
+#include <cstring>
+
+#include <util/tracy.h>
+TRACY_MODULE_NAME(SceDmacmgr);
+
+// Copies are usually whole framebuffers or streamed buffers which the renderer may be watching,
+// their protections are released once for the whole range instead of faulting on every page
+EXPORT(Ptr<void>, sceDmacMemcpy, Ptr<void> dst, Ptr<const void> src, SceSize size) {
+    TRACY_FUNC(sceDmacMemcpy, dst, src, size);
+    if (!is_valid_addr_range(emuenv.mem, dst.address(), dst.address() + size) || !is_valid_addr_range(emuenv.mem, src.address(), src.address() + size)) {
+        LOG_ERROR("Invalid copy from {} to {} of size {}", log_hex(src.address()), log_hex(dst.address()), size);
+        return Ptr<void>();
+    }
+
+    prepare_host_access(emuenv.mem, src.address(), size, false);
+    prepare_host_access(emuenv.mem, dst.address(), size, true);
+    memcpy(dst.get(emuenv.mem), src.get(emuenv.mem), size);
+    return dst;
 }
 
-EXPORT(int, sceDmacMemset) {
-    return UNIMPLEMENTED();
+EXPORT(Ptr<void>, sceDmacMemset, Ptr<void> dst, int c, SceSize size) {
+    TRACY_FUNC(sceDmacMemset, dst, c, size);
+    if (!is_valid_addr_range(emuenv.mem, dst.address(), dst.address() + size)) {
+        LOG_ERROR("Invalid fill of {} with size {}", log_hex(dst.address()), size);
+        return Ptr<void>();
+    }
+
+    prepare_host_access(emuenv.mem, dst.address(), size, true);
+    memset(dst.get(emuenv.mem), c, size);
+    return dst;
 }
@@ -223,7 +223,7 @@ EXPORT(SceInt32, _sceKernelGetCondInfo, SceUID condId, Ptr<SceKernelCondInfo> pI
 
 EXPORT(SceInt32, _sceKernelGetEventFlagInfo, SceUID evfId, Ptr<SceKernelEventFlagInfo> pInfo) {
     TRACY_FUNC(_sceKernelGetEventFlagInfo, evfId, pInfo);
-    const EventFlagPtr eventflag = lock_and_find(evfId, emuenv.kernel.eventflags, emuenv.kernel.mutex);
+    const EventFlagPtr eventflag = lock_and_find(evfId, emuenv.kernel.eventflags, emuenv.kernel.sync_objects_mutex);
     if (!eventflag)
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
 
@@ -281,11 +281,7 @@ EXPORT(int, _sceKernelGetLwMutexInfoById, SceUID lightweight_mutex_id, Ptr<SceKe
         info_data->pWork = mutex->workarea;
         info_data->initCount = mutex->init_count;
         info_data->currentCount = mutex->lock_count;
-        if (mutex->owner == 0) {
-            info_data->currentOwnerId = 0;
-        } else {
-            info_data->currentOwnerId = mutex->owner->id;
-        }
+        info_data->currentOwnerId = mutex->owner_id();
         info_data->numWaitThreads = static_cast<SceUInt32>(mutex->waiting_threads->size());
         if (info_size < sizeof(SceKernelLwMutexInfo)) {
             memcpy(info.get(emuenv.mem), &info_data_local, info_size);
@@ -322,11 +318,7 @@ EXPORT(int, _sceKernelGetMutexInfo, SceUID mutexId, SceKernelMutexInfo *pInfo) {
     info_data->attr = mutex->attr;
     info_data->initCount = mutex->init_count;
     info_data->currentCount = mutex->lock_count;
-    if (mutex->owner) {
-        info_data->currentOwnerId = mutex->owner->id;
-    } else {
-        info_data->currentOwnerId = 0;
-    }
+    info_data->currentOwnerId = mutex->owner_id();
     info_data->numWaitThreads = mutex->waiting_threads->size();
     if (info_size < sizeof(*pInfo)) {
         memcpy(pInfo, &info_data_local, info_size);
@@ -883,6 +875,14 @@ EXPORT(int, sceKernelChangeActiveCpuMask) {
     return UNIMPLEMENTED();
 }
 
+static void update_host_thread_mapping(KernelState &kernel, ThreadState &thread, SceUID caller_id) {
+    // Host affinity can only be changed from the thread itself
+    if (thread.id == caller_id)
+        kernel.apply_host_thread_mapping(thread);
+    else
+        thread.host_mapping_changed = true;
+}
+
 EXPORT(SceInt32, sceKernelChangeThreadCpuAffinityMask, SceUID thid, SceInt32 affinity_mask) {
     TRACY_FUNC(sceKernelChangeThreadCpuAffinityMask, thid, affinity_mask);
     const ThreadStatePtr thread = emuenv.kernel.get_thread(thid ? thid : thread_id);
@@ -896,6 +896,7 @@ EXPORT(SceInt32, sceKernelChangeThreadCpuAffinityMask, SceUID thid, SceInt32 aff
         return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_CPU_AFFINITY_MASK);
 
     thread->affinity_mask = affinity_mask;
+    update_host_thread_mapping(emuenv.kernel, *thread, thread_id);
     return old_affinity;
 }
 
@@ -920,6 +921,7 @@ EXPORT(SceInt32, sceKernelChangeThreadPriority2, SceUID thid, SceInt32 priority)
         return RET_ERROR(SCE_KERNEL_ERROR_ILLEGAL_PRIORITY);
 
     thread->priority = priority;
+    update_host_thread_mapping(emuenv.kernel, *thread, thread_id);
 
     return old_priority;
 }
@@ -1030,11 +1032,14 @@ EXPORT(int, sceKernelCreateThreadForUser, const char *name, SceKernelThreadEntry
     return thread->id;
 }
 
-int delay_thread(SceUInt delay_us) {
-    if (delay_us == 0)
+int delay_thread(KernelState &kernel, SceUInt delay_us) {
+    if (delay_us == 0) {
+        // Games call this in a loop to wait for another thread, let it run
+        std::this_thread::yield();
         return SCE_KERNEL_ERROR_INVALID_ARGUMENT;
+    }
 
-    std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+    kernel.timer_wheel.sleep_until(std::chrono::steady_clock::now() + std::chrono::microseconds(delay_us));
 
     return SCE_KERNEL_OK;
 }
@@ -1046,21 +1051,21 @@ int delay_thread_cb(EmuEnvState &emuenv, SceUID thread_id, SceUInt delay_us) {
     auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 
     if (delay_us > elapsed.count()) // If we spent less time than requested processing callbacks, sleep the remaining time
-        return delay_thread(delay_us - elapsed.count());
+        return delay_thread(emuenv.kernel, delay_us - elapsed.count());
     else // Else return directly
         return SCE_KERNEL_OK;
 }
 
 EXPORT(int, sceKernelDelayThread, SceUInt delay) {
     TRACY_FUNC(sceKernelDelayThread, delay);
-    return delay_thread(delay);
+    return delay_thread(emuenv.kernel, delay);
 }
 
 EXPORT(int, sceKernelDelayThread200, SceUInt delay) {
     TRACY_FUNC(sceKernelDelayThread200, delay);
     if (delay < 201)
         delay = 201;
-    return delay_thread(delay);
+    return delay_thread(emuenv.kernel, delay);
 }
 
 EXPORT(int, sceKernelDelayThreadCB, SceUInt delay) {
@@ -1172,7 +1177,7 @@ EXPORT(int, sceKernelGetProcessId) {
     return 1;
 }
 
-EXPORT(uint64_t, sceKernelGetSystemTimeWide) {
+NONBLOCKING_EXPORT(uint64_t, sceKernelGetSystemTimeWide) {
     TRACY_FUNC(sceKernelGetSystemTimeWide);
     return get_current_time();
 }
@@ -609,9 +609,16 @@ EXPORT(SceOff, sceIoLseek, const SceUID fd, const SceOff offset, const SceIoSeek
     return res;
 }
 
-EXPORT(int, sceIoLseekAsync) {
-    TRACY_FUNC(sceIoLseekAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoLseekAsync, const SceUID fd, const SceOff offset, const SceIoSeekMode whence) {
+    TRACY_FUNC(sceIoLseekAsync, fd, offset, whence);
+    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
+
+    Ptr<_sceIoLseekOpt> options = Ptr<_sceIoLseekOpt>(stack_alloc(*thread->cpu, sizeof(_sceIoLseekOpt)));
+    options.get(emuenv.mem)->offset = offset;
+    options.get(emuenv.mem)->whence = whence;
+    const SceUID res = CALL_EXPORT(_sceIoLseekAsync, fd, options);
+    stack_free(*thread->cpu, sizeof(_sceIoLseekOpt));
+    return res;
 }
 
 EXPORT(int, sceIoMkdir, const char *dir, const SceMode mode) {
@@ -633,26 +640,21 @@ EXPORT(SceUID, sceIoOpen, const char *file, const int flags, const SceMode mode)
     return open_file(emuenv.io, file, flags, emuenv.pref_path.wstring(), export_name);
 }
 
-EXPORT(int, sceIoOpenAsync) {
-    TRACY_FUNC(sceIoOpenAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoOpenAsync, const char *file, const int flags, const SceMode mode) {
+    TRACY_FUNC(sceIoOpenAsync, file, flags, mode);
+    return CALL_EXPORT(_sceIoOpenAsync, file, flags, mode);
 }
 
 EXPORT(SceSSize, sceIoPread, SceUID fd, void *buf, SceSize nbyte, SceOff offset) {
     TRACY_FUNC(sceIoPread, fd, buf, nbyte, offset);
-    auto pos = tell_file(emuenv.io, fd, export_name);
-    if (pos < 0) {
-        return static_cast<SceSSize>(pos);
-    }
-    seek_file(fd, offset, SCE_SEEK_SET, emuenv.io, export_name);
-    const auto res = read_file(buf, emuenv.io, fd, nbyte, export_name);
-    seek_file(fd, pos, SCE_SEEK_SET, emuenv.io, export_name);
-    return res;
+    return pread_file(buf, emuenv.io, fd, nbyte, offset, export_name);
 }
 
-EXPORT(int, sceIoPreadAsync) {
-    TRACY_FUNC(sceIoPreadAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoPreadAsync, SceUID fd, void *buf, SceSize nbyte, SceOff offset) {
+    TRACY_FUNC(sceIoPreadAsync, fd, buf, nbyte, offset);
+    return submit_async_io(emuenv, export_name, thread_id, fd, [&emuenv, export_name, fd, buf, nbyte, offset]() -> SceInt64 {
+        return pread_file(buf, emuenv.io, fd, nbyte, offset, export_name);
+    });
 }
 
 EXPORT(SceSSize, sceIoPwrite, SceUID fd, const void *buf, SceSize nbyte, SceOff offset) {
@@ -667,9 +669,17 @@ EXPORT(SceSSize, sceIoPwrite, SceUID fd, const void *buf, SceSize nbyte, SceOff
     return res;
 }
 
-EXPORT(int, sceIoPwriteAsync) {
-    TRACY_FUNC(sceIoPwriteAsync);
-    return UNIMPLEMENTED();
+EXPORT(SceUID, sceIoPwriteAsync, SceUID fd, const void *buf, SceSize nbyte, SceOff offset) {
+    TRACY_FUNC(sceIoPwriteAsync, fd, buf, nbyte, offset);
+    return submit_async_io(emuenv, export_name, thread_id, fd, [&emuenv, export_name, fd, buf, nbyte, offset]() -> SceInt64 {
+        const auto pos = tell_file(emuenv.io, fd, export_name);
+        if (pos < 0)
+            return pos;
+        seek_file(fd, offset, SCE_SEEK_SET, emuenv.io, export_name);
+        const auto res = write_file(fd, buf, nbyte, emuenv.io, export_name);
+        seek_file(fd, pos, SCE_SEEK_SET, emuenv.io, export_name);
+        return res;
+    });
 }
 
 EXPORT(int, sceIoRead2) {
@@ -717,9 +727,9 @@ EXPORT(int, sceIoRmdirAsync) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sceIoSync) {
-    TRACY_FUNC(sceIoSync);
-    return UNIMPLEMENTED();
+EXPORT(int, sceIoSync, const char *device, const unsigned int unk) {
+    TRACY_FUNC(sceIoSync, device, unk);
+    return sync_device(emuenv.io, device, export_name);
 }
 
 EXPORT(int, sceIoSyncAsync) {
@@ -1387,12 +1397,12 @@ EXPORT(int, sceKernelGetProcessTime, SceUInt64 *time) {
     return 0;
 }
 
-EXPORT(SceUInt32, sceKernelGetProcessTimeLow) {
+NONBLOCKING_EXPORT(SceUInt32, sceKernelGetProcessTimeLow) {
     TRACY_FUNC(sceKernelGetProcessTimeLow);
     return static_cast<SceUInt32>(rtc_get_ticks(emuenv.kernel.base_tick.tick) - emuenv.kernel.start_tick);
 }
 
-EXPORT(SceUInt64, sceKernelGetProcessTimeWide) {
+NONBLOCKING_EXPORT(SceUInt64, sceKernelGetProcessTimeWide) {
     TRACY_FUNC(sceKernelGetProcessTimeWide);
     return rtc_get_ticks(emuenv.kernel.base_tick.tick) - emuenv.kernel.start_tick;
 }
@@ -1417,7 +1427,7 @@ EXPORT(int, sceKernelGetSystemTime) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(Ptr<Ptr<void>>, sceKernelGetTLSAddr, int key) {
+NONBLOCKING_EXPORT(Ptr<Ptr<void>>, sceKernelGetTLSAddr, int key) {
     TRACY_FUNC(sceKernelGetTLSAddr, key);
     return emuenv.kernel.get_thread_tls_addr(emuenv.mem, thread_id, key);
 }
@@ -1471,7 +1481,7 @@ EXPORT(int, sceKernelGetThreadExitStatus, SceUID thid, SceInt32 *pExitStatus) {
     return 0;
 }
 
-EXPORT(int, sceKernelGetThreadId) {
+NONBLOCKING_EXPORT(int, sceKernelGetThreadId) {
     TRACY_FUNC(sceKernelGetThreadId);
     return thread_id;
 }
@@ -17,1189 +17,1210 @@
 
 #include <module/module.h>
 
+#include <util/bytes.h>
+
+#include <atomic>
+#include <bit>
+#include <thread>
+
+// calls of an export are logged once this many times and then each time their count doubles
+static constexpr uint64_t HOT_CALL_THRESHOLD = 64 * 1024;
+
+// The bridge is usually loaded from the app, its exports are only called when it is forced to HLE.
+// The calls of each unimplemented export are counted so the hot ones can be found and given a host implementation
+#define COUNTED_UNIMPLEMENTED()                                                                             \
+    ([&]() {                                                                                                \
+        static std::atomic<uint64_t> calls = 0;                                                             \
+        const uint64_t count = calls.fetch_add(1, std::memory_order_relaxed) + 1;                           \
+        if ((count >= HOT_CALL_THRESHOLD) && std::has_single_bit(count))                                    \
+            LOG_INFO("Unimplemented {} import called {} times, it is a hot candidate", export_name, count); \
+        return UNIMPLEMENTED();                                                                             \
+    })()
+
 EXPORT(int, __aeabi_unwind_cpp_pr0) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __aeabi_unwind_cpp_pr1) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __ashldi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __divdi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __divsi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __lshrdi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __moddi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __modsi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __sce_aeabi_idiv1) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __sce_aeabi_ldiv1) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __udivdi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __udivsi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __umoddi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, __umodsi3) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 #pragma push_macro("environ")
 #undef environ
 EXPORT(int, environ) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 #pragma pop_macro("environ")
 
 EXPORT(int, g_ascii_strcasecmp) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, g_file_vita_get_current_dir) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, g_file_vita_get_full_path) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, g_file_vita_set_current_dir) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, getenv) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_assertion_message) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_array_append_vals) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_array_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_array_insert_vals) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_array_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ascii_strdown) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ascii_strncasecmp) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ascii_tolower) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ascii_xdigit_value) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_build_path) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_convert) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_dir_close) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_dir_open) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_dir_read_name) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_direct_equal) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_direct_hash) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_error_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_file_get_contents) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_file_open_tmp) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_file_test) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_filename_from_uri) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_filename_from_utf8) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_filename_to_uri) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_find_program_in_path) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_get_charset) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_get_current_dir) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_get_home_dir) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_get_tmp_dir) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_get_user_name) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_getenv) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_destroy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_foreach) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_foreach_remove) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_foreach_steal) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_insert_replace) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_iter_init) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_iter_next) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_lookup) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_lookup_extended) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_new_full) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_remove) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_hash_table_size) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_alloc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_append) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_copy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_delete_link) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_find) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_foreach) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_insert_before) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_length) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_nth) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_nth_data) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_prepend) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_remove) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_remove_link) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_reverse) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_list_sort) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_locale_from_utf8) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_locale_to_utf8) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_log) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_log_set_always_fatal) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_log_set_fatal_mask) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_logv) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_markup_parse_context_end_parse) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_markup_parse_context_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_markup_parse_context_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_markup_parse_context_parse) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_memdup) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_path_get_basename) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_path_get_dirname) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_path_is_absolute) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_print) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_printerr) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_add) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_remove) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_remove_fast) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_remove_index) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_remove_index_fast) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ptr_array_sized_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_queue_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_queue_is_empty) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_queue_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_queue_pop_head) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_queue_push_head) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_set_prgname) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_setenv) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_shell_quote) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_append) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_concat) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_copy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_delete_link) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_find) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_foreach) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_free_1) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_insert_sorted) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_last) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_length) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_nth) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_nth_data) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_prepend) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_remove) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_slist_reverse) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_snprintf) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_spaced_primes_closest) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_spawn_async_with_pipes) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_str_equal) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_str_has_prefix) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_str_hash) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strchomp) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strchug) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strconcat) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strdup_printf) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strdup_vprintf) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strerror) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strfreev) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_string_append) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_string_append_c) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_string_append_len) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_string_append_printf) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_string_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_string_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_string_printf) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strjoin) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strlcpy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strndup) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strreverse) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_strsplit) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_timer_destroy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_timer_elapsed) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_timer_new) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_timer_start) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_timer_stop) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_ucs4_to_utf16) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_unichar_tolower) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_unichar_type) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_unichar_xdigit_value) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_unsetenv) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_usleep) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_utf16_to_ucs4) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_utf16_to_utf8) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_utf8_strdown) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_utf8_to_utf16) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_g_utf8_validate) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_malloc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_malloc0) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_realloc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_try_malloc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, monoeg_try_realloc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_alloc_mem) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_alloc_raw) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_app_exit_liveboard) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_code_mem_alloc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_code_mem_flush_icache) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_code_mem_free) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_code_mem_initialize) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_code_mem_lock) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_code_mem_terminate) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_code_mem_unlock) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_create_semaphore) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_crypto_close) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_crypto_fread) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_crypto_open) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_crypto_read) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_delay_thread) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_delete_semaphore) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_disable_ftz) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_errno_loc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_free_mem) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_free_prng_provider) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_free_raw) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_get_errnoloc) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_get_prng_provider) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_get_thread_context) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_get_ticks_32) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_get_ticks_64) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_get_ticks_since_111) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_get_win32_filetime) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
-EXPORT(int, pss_getpagesize) {
-    return UNIMPLEMENTED();
+LEAF_EXPORT(int, pss_getpagesize) {
+    return 4 * 1024;
 }
 
 EXPORT(int, pss_getpid) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_gettimeofday) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_chstat) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_close) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_dclose) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_dopen) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_getstat) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_lseek) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_mkdir) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_open) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_read) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_remove) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_rename) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_rmdir) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_io_write) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_nanosleep) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_accept) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_bind) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_connect) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_epoll_create) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_epoll_ctl) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_epoll_destroy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_epoll_wait) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_gethostname) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_getpeername) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_getsockname) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_getsockopt) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
-EXPORT(int, pss_net_htonl) {
-    return UNIMPLEMENTED();
+LEAF_EXPORT(uint32_t, pss_net_htonl, uint32_t n) {
+    return network_to_host_order(n);
 }
 
-EXPORT(int, pss_net_htons) {
-    return UNIMPLEMENTED();
+LEAF_EXPORT(uint16_t, pss_net_htons, uint16_t n) {
+    return network_to_host_order(n);
 }
 
 EXPORT(int, pss_net_init) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_listen) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
-EXPORT(int, pss_net_ntohl) {
-    return UNIMPLEMENTED();
+LEAF_EXPORT(uint32_t, pss_net_ntohl, uint32_t n) {
+    return network_to_host_order(n);
 }
 
-EXPORT(int, pss_net_ntohs) {
-    return UNIMPLEMENTED();
+LEAF_EXPORT(uint16_t, pss_net_ntohs, uint16_t n) {
+    return network_to_host_order(n);
 }
 
 EXPORT(int, pss_net_recv) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_recvfrom) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_resolver_create) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_resolver_start_aton) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_resolver_start_ntoa) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_send) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_sendto) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_setsockopt) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_shutdown) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_socket) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_net_socket_close) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_prng_fill) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_resume_thread) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_set_thread_context) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_set_win32_filetime) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_signal_semaphore) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_supports_fast_tls) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_suspend_thread) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_threads_initialize) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_usb_transport_close1) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_usb_transport_close2) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_usb_transport_connect) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_usb_transport_recv) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_usb_transport_send) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pss_wait_semaphore) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_attr_init) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_attr_setstacksize) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cleanup_pop_) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cleanup_push_) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cond_broadcast) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cond_destroy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cond_init) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cond_signal) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cond_timedwait) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_cond_wait) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_create) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_detach) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
-EXPORT(int, pthread_equal) {
-    return UNIMPLEMENTED();
+LEAF_EXPORT(int, pthread_equal, uint32_t thread1, uint32_t thread2) {
+    return thread1 == thread2;
 }
 
 EXPORT(int, pthread_exit) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_getspecific) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_getspecific_for_thread) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_join) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_key_create) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_key_delete) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutex_destroy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutex_init) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutex_lock) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutex_trylock) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutex_unlock) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutexattr_destroy) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutexattr_init) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_mutexattr_settype) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_self) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_setspecific) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_vita_tls_create_np) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_vita_tls_get_np) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
 EXPORT(int, pthread_vita_tls_set_np) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
 
-EXPORT(int, sched_yield) {
-    return UNIMPLEMENTED();
+NONBLOCKING_EXPORT(int, sched_yield) {
+    std::this_thread::yield();
+    return 0;
 }
 
 EXPORT(int, unlink) {
-    return UNIMPLEMENTED();
+    return COUNTED_UNIMPLEMENTED();
 }
@@ -30,6 +30,22 @@ TRACY_MODULE_NAME(SceLibc);
 
 Ptr<void> g_dso;
 
+// guest pointer to the character found by a host string function inside the guest string, or null
+static Ptr<char> offset_in_string(EmuEnvState &emuenv, Ptr<char> str, const char *found) {
+    return found ? Ptr<char>(str.address() + static_cast<Address>(found - str.get(emuenv.mem))) : Ptr<char>();
+}
+
+// strcasecmp is not available on every host, only ascii letters are folded like in the C locale
+static int compare_ignore_case(const char *str1, const char *str2, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        const int c1 = tolower(static_cast<unsigned char>(str1[i]));
+        const int c2 = tolower(static_cast<unsigned char>(str2[i]));
+        if ((c1 != c2) || (c1 == '\0'))
+            return c1 - c2;
+    }
+    return 0;
+}
+
 EXPORT(int, _Assert) {
     TRACY_FUNC(_Assert);
     return UNIMPLEMENTED();
@@ -477,6 +493,8 @@ EXPORT(int, fread) {
 
 EXPORT(void, free, Address mem) {
     TRACY_FUNC(free, mem);
+    if (emuenv.kernel.slab_heap && emuenv.kernel.slab_heap->free(mem))
+        return;
     free(emuenv.mem, mem);
 }
 
@@ -762,12 +780,17 @@ EXPORT(int, longjmp) {
 
 EXPORT(int, malloc, SceSize size) {
     TRACY_FUNC(malloc, size);
+    if (emuenv.kernel.slab_heap)
+        return emuenv.kernel.slab_heap->alloc(size);
     return alloc(emuenv.mem, size, __FUNCTION__);
 }
 
 EXPORT(int, malloc_stats) {
     TRACY_FUNC(malloc_stats);
-    return UNIMPLEMENTED();
+    if (!emuenv.kernel.slab_heap)
+        return UNIMPLEMENTED();
+    emuenv.kernel.slab_heap->log_stats();
+    return 0;
 }
 
 EXPORT(int, malloc_stats_fast) {
@@ -775,9 +798,11 @@ EXPORT(int, malloc_stats_fast) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, malloc_usable_size) {
-    TRACY_FUNC(malloc_usable_size);
-    return UNIMPLEMENTED();
+EXPORT(int, malloc_usable_size, Address mem) {
+    TRACY_FUNC(malloc_usable_size, mem);
+    if (!emuenv.kernel.slab_heap)
+        return UNIMPLEMENTED();
+    return emuenv.kernel.slab_heap->usable_size(mem);
 }
 
 EXPORT(int, mblen) {
@@ -837,24 +862,25 @@ EXPORT(int, mbtowc) {
 
 EXPORT(Ptr<void>, memalign, uint32_t alignment, uint32_t size) {
     TRACY_FUNC(memalign, alignment, size);
+    if (emuenv.kernel.slab_heap)
+        return Ptr<void>(emuenv.kernel.slab_heap->alloc(size, alignment));
     Address address = alloc_aligned(emuenv.mem, size, "memalign", alignment);
 
     return Ptr<void>(address);
 }
 
-EXPORT(int, memchr) {
-    TRACY_FUNC(memchr);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(Ptr<void>, memchr, Ptr<const void> ptr, int value, uint32_t num) {
+    const void *found = memchr(ptr.get(emuenv.mem), value, num);
+    return found ? Ptr<void>(ptr.address() + static_cast<Address>(static_cast<const uint8_t *>(found) - static_cast<const uint8_t *>(ptr.get(emuenv.mem)))) : Ptr<void>();
 }
 
-EXPORT(int, memcmp) {
-    TRACY_FUNC(memcmp);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(int, memcmp, const void *ptr1, const void *ptr2, uint32_t num) {
+    return memcmp(ptr1, ptr2, num);
 }
 
-EXPORT(void, memcpy, void *destination, const void *source, uint32_t num) {
-    TRACY_FUNC(memcpy, destination, source, num);
-    memcpy(destination, source, num);
+LEAF_EXPORT(Ptr<void>, memcpy, Ptr<void> destination, const void *source, uint32_t num) {
+    memcpy(destination.get(emuenv.mem), source, num);
+    return destination;
 }
 
 EXPORT(int, memcpy_s) {
@@ -862,9 +888,9 @@ EXPORT(int, memcpy_s) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(void, memmove, void *destination, const void *source, uint32_t num) {
-    TRACY_FUNC(memmove, destination, source, num);
-    memmove(destination, source, num);
+LEAF_EXPORT(Ptr<void>, memmove, Ptr<void> destination, const void *source, uint32_t num) {
+    memmove(destination.get(emuenv.mem), source, num);
+    return destination;
 }
 
 EXPORT(int, memmove_s) {
@@ -872,9 +898,9 @@ EXPORT(int, memmove_s) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(void, memset, Ptr<void> str, int c, uint32_t n) {
-    TRACY_FUNC(memset, str, c, n);
+LEAF_EXPORT(Ptr<void>, memset, Ptr<void> str, int c, uint32_t n) {
     memset(str.get(emuenv.mem), c, n);
+    return str;
 }
 
 EXPORT(int, mktime) {
@@ -1162,14 +1188,12 @@ EXPORT(int, sscanf_s) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, strcasecmp) {
-    TRACY_FUNC(strcasecmp);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(int, strcasecmp, const char *str1, const char *str2) {
+    return compare_ignore_case(str1, str2, SIZE_MAX);
 }
 
-EXPORT(Ptr<char>, strcat, Ptr<char> destination, Ptr<char> source) {
-    TRACY_FUNC(strcat, destination, source);
-    strcat(destination.get(emuenv.mem), source.get(emuenv.mem));
+LEAF_EXPORT(Ptr<char>, strcat, Ptr<char> destination, const char *source) {
+    strcat(destination.get(emuenv.mem), source);
     return destination;
 }
 
@@ -1178,24 +1202,21 @@ EXPORT(int, strcat_s) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, strchr) {
-    TRACY_FUNC(strchr);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(Ptr<char>, strchr, Ptr<char> str, int ch) {
+    return offset_in_string(emuenv, str, strchr(str.get(emuenv.mem), ch));
 }
 
-EXPORT(int, strcmp) {
-    TRACY_FUNC(strcmp);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(int, strcmp, const char *str1, const char *str2) {
+    return strcmp(str1, str2);
 }
 
-EXPORT(int, strcoll) {
-    TRACY_FUNC(strcoll);
-    return UNIMPLEMENTED();
+// only the C locale exists, where collation is the byte order
+LEAF_EXPORT(int, strcoll, const char *str1, const char *str2) {
+    return strcmp(str1, str2);
 }
 
-EXPORT(Ptr<char>, strcpy, Ptr<char> destination, Ptr<char> source) {
-    TRACY_FUNC(strcpy, destination, source);
-    strcpy(destination.get(emuenv.mem), source.get(emuenv.mem));
+LEAF_EXPORT(Ptr<char>, strcpy, Ptr<char> destination, const char *source) {
+    strcpy(destination.get(emuenv.mem), source);
     return destination;
 }
 
@@ -1204,9 +1225,8 @@ EXPORT(int, strcpy_s) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, strcspn) {
-    TRACY_FUNC(strcspn);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(uint32_t, strcspn, const char *str1, const char *str2) {
+    return static_cast<uint32_t>(strcspn(str1, str2));
 }
 
 EXPORT(int, strdup) {
@@ -1234,19 +1254,17 @@ EXPORT(int, strftime) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, strlen, char *str) {
-    TRACY_FUNC(strlen, str);
-    return static_cast<int>(strlen(str));
+LEAF_EXPORT(uint32_t, strlen, const char *str) {
+    return static_cast<uint32_t>(strlen(str));
 }
 
-EXPORT(int, strncasecmp) {
-    TRACY_FUNC(strncasecmp);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(int, strncasecmp, const char *str1, const char *str2, SceSize num) {
+    return compare_ignore_case(str1, str2, num);
 }
 
-EXPORT(int, strncat) {
-    TRACY_FUNC(strncat);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(Ptr<char>, strncat, Ptr<char> destination, const char *source, SceSize num) {
+    strncat(destination.get(emuenv.mem), source, num);
+    return destination;
 }
 
 EXPORT(int, strncat_s) {
@@ -1254,14 +1272,12 @@ EXPORT(int, strncat_s) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, strncmp, const char *str1, const char *str2, SceSize num) {
-    TRACY_FUNC(strncmp, str1, str2, num);
+LEAF_EXPORT(int, strncmp, const char *str1, const char *str2, SceSize num) {
     return strncmp(str1, str2, num);
 }
 
-EXPORT(Ptr<char>, strncpy, Ptr<char> destination, Ptr<char> source, SceSize size) {
-    TRACY_FUNC(strncpy, destination, source, size);
-    strncpy(destination.get(emuenv.mem), source.get(emuenv.mem), size);
+LEAF_EXPORT(Ptr<char>, strncpy, Ptr<char> destination, const char *source, SceSize size) {
+    strncpy(destination.get(emuenv.mem), source, size);
     return destination;
 }
 
@@ -1270,39 +1286,27 @@ EXPORT(int, strncpy_s) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, strnlen_s) {
-    TRACY_FUNC(strnlen_s);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(uint32_t, strnlen_s, const char *str, SceSize size) {
+    if (!str)
+        return 0;
+    const void *end = memchr(str, '\0', size);
+    return end ? static_cast<uint32_t>(static_cast<const char *>(end) - str) : size;
 }
 
-EXPORT(int, strpbrk) {
-    TRACY_FUNC(strpbrk);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(Ptr<char>, strpbrk, Ptr<char> str1, const char *str2) {
+    return offset_in_string(emuenv, str1, strpbrk(str1.get(emuenv.mem), str2));
 }
 
-EXPORT(Ptr<char>, strrchr, Ptr<char> str, char ch) {
-    TRACY_FUNC(strrchr, str, ch);
-    Ptr<char> res = Ptr<char>();
-    char *_str = str.get(emuenv.mem);
-    for (int i = static_cast<int>(strlen(_str) - 1); i >= 0; i--) {
-        const char ch1 = _str[i];
-        if (ch1 == ch) {
-            res = str + i * sizeof(char);
-            break;
-        }
-    }
-
-    return res;
+LEAF_EXPORT(Ptr<char>, strrchr, Ptr<char> str, int ch) {
+    return offset_in_string(emuenv, str, strrchr(str.get(emuenv.mem), ch));
 }
 
-EXPORT(int, strspn) {
-    TRACY_FUNC(strspn);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(uint32_t, strspn, const char *str1, const char *str2) {
+    return static_cast<uint32_t>(strspn(str1, str2));
 }
 
-EXPORT(int, strstr) {
-    TRACY_FUNC(strstr);
-    return UNIMPLEMENTED();
+LEAF_EXPORT(Ptr<char>, strstr, Ptr<char> str1, const char *str2) {
+    return offset_in_string(emuenv, str1, strstr(str1.get(emuenv.mem), str2));
 }
 
 EXPORT(int, strtod) {
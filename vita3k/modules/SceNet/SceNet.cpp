@@ -19,6 +19,7 @@
 
 #include <cstdio>
 #include <kernel/state.h>
+#include <kernel/thread/thread_state.h>
 #include <net/functions.h>
 #include <net/state.h>
 #include <net/types.h>
@@ -111,18 +112,64 @@ std::string to_debug_str<SceNetSocketOption>(const MemState &mem, SceNetSocketOp
     return std::to_string(socketOption);
 }
 
+// The host sockets never block, a guest thread doing a blocking call on a socket which is not ready
+// waits until the reactor reports the socket ready or the timeout of the socket elapses
+static bool wait_for_socket(EmuEnvState &emuenv, SceUID thread_id, const Socket &sock, unsigned int events) {
+    const abs_socket host_sock = sock.get_wait_socket();
+    const ThreadStatePtr thread = lock_and_find(thread_id, emuenv.kernel.threads, emuenv.kernel.mutex);
+    if ((host_sock == INVALID_HOST_SOCKET) || !thread) {
+        return false;
+    }
+
+    const auto ready = std::make_shared<bool>(false);
+    std::unique_lock<std::mutex> lock(thread->mutex);
+    thread->update_status(ThreadStatus::wait);
+    emuenv.net.reactor.wait(host_sock, events, sock.get_timeout(events), [thread, ready](bool socket_ready) {
+        const std::lock_guard<std::mutex> lock(thread->mutex);
+        *ready = socket_ready;
+        if (thread->status == ThreadStatus::wait) {
+            thread->update_status(ThreadStatus::run);
+        }
+    });
+    thread->status_cond.wait(lock, [&]() { return thread->status == ThreadStatus::run; });
+    return *ready;
+}
+
+// Retries a call which failed because the socket was not ready once it is, unless the guest socket is non-blocking
+template <typename Call>
+static int blocking_socket_call(EmuEnvState &emuenv, SceUID thread_id, const SocketPtr &sock, unsigned int events, int flags, Call call) {
+    while (true) {
+        const int res = call();
+        if ((res != static_cast<int>(SCE_NET_ERROR_EWOULDBLOCK)) || !sock->is_blocking(flags)) {
+            return res;
+        }
+        // on timeout the guest gets EWOULDBLOCK like on the console
+        if (!wait_for_socket(emuenv, thread_id, *sock, events)) {
+            return res;
+        }
+    }
+}
+
 EXPORT(int, sceNetAccept, int sid, SceNetSockaddr *addr, unsigned int *addrlen) {
     TRACY_FUNC(sceNetAccept, sid, addr, addrlen);
     auto sock = lock_and_find(sid, emuenv.net.socks, emuenv.kernel.mutex);
     if (!sock) {
         return RET_ERROR(SCE_NET_EBADF);
     }
+    const auto posix_sock = std::dynamic_pointer_cast<PosixSocket>(sock);
     auto newsock = sock->accept(addr, addrlen);
+    while (!newsock && posix_sock && posix_sock->is_blocking(0) && PosixSocket::last_call_would_block()) {
+        if (!wait_for_socket(emuenv, thread_id, *posix_sock, SCE_NET_EPOLLIN)) {
+            return RET_ERROR(SCE_NET_ERROR_EWOULDBLOCK);
+        }
+        newsock = sock->accept(addr, addrlen);
+    }
     if (!newsock) {
         return RET_ERROR(-1);
     }
+    const std::lock_guard<std::mutex> lock(emuenv.kernel.mutex);
     auto id = ++emuenv.net.next_id;
-    emuenv.net.socks.emplace(id, sock);
+    emuenv.net.socks.emplace(id, newsock);
     return id;
 }
 
@@ -146,7 +193,17 @@ EXPORT(int, sceNetConnect, int sid, const SceNetSockaddr *addr, unsigned int add
     if (!sock) {
         return RET_ERROR(SCE_NET_EBADF);
     }
-    return sock->connect(addr, addrlen);
+    const int res = sock->connect(addr, addrlen);
+    const auto posix_sock = std::dynamic_pointer_cast<PosixSocket>(sock);
+    // a non-blocking connect is in progress until the socket is ready for writing
+    const bool in_progress = (res == static_cast<int>(SCE_NET_ERROR_EINPROGRESS)) || (res == static_cast<int>(SCE_NET_ERROR_EWOULDBLOCK));
+    if (!in_progress || !posix_sock || !posix_sock->is_blocking(0)) {
+        return res;
+    }
+    if (!wait_for_socket(emuenv, thread_id, *posix_sock, SCE_NET_EPOLLOUT)) {
+        return RET_ERROR(SCE_NET_ERROR_ETIMEDOUT);
+    }
+    return posix_sock->get_connect_result();
 }
 
 EXPORT(int, sceNetDumpAbort) {
@@ -437,7 +494,9 @@ EXPORT(int, sceNetRecv, int sid, void *buf, unsigned int len, int flags) {
     if (!sock) {
         return RET_ERROR(SCE_NET_ERROR_EBADF);
     }
-    return sock->recv_packet(buf, len, flags, nullptr, 0);
+    return blocking_socket_call(emuenv, thread_id, sock, SCE_NET_EPOLLIN, flags, [&]() {
+        return sock->recv_packet(buf, len, flags, nullptr, 0);
+    });
 }
 
 EXPORT(int, sceNetRecvfrom, int sid, void *buf, unsigned int len, int flags, SceNetSockaddr *from, unsigned int *fromlen) {
@@ -446,7 +505,9 @@ EXPORT(int, sceNetRecvfrom, int sid, void *buf, unsigned int len, int flags, Sce
     if (!sock) {
         return RET_ERROR(SCE_NET_ERROR_EBADF);
     }
-    return sock->recv_packet(buf, len, flags, from, fromlen);
+    return blocking_socket_call(emuenv, thread_id, sock, SCE_NET_EPOLLIN, flags, [&]() {
+        return sock->recv_packet(buf, len, flags, from, fromlen);
+    });
 }
 
 EXPORT(int, sceNetRecvmsg) {
@@ -499,7 +560,9 @@ EXPORT(int, sceNetSend, int sid, const void *msg, unsigned int len, int flags) {
     if (!sock) {
         return RET_ERROR(SCE_NET_EBADF);
     }
-    return sock->send_packet(msg, len, flags, nullptr, 0);
+    return blocking_socket_call(emuenv, thread_id, sock, SCE_NET_EPOLLOUT, flags, [&]() {
+        return sock->send_packet(msg, len, flags, nullptr, 0);
+    });
 }
 
 EXPORT(int, sceNetSendmsg) {
@@ -513,7 +576,9 @@ EXPORT(int, sceNetSendto, int sid, const void *msg, unsigned int len, int flags,
     if (!sock) {
         return RET_ERROR(SCE_NET_EBADF);
     }
-    return sock->send_packet(msg, len, flags, to, tolen);
+    return blocking_socket_call(emuenv, thread_id, sock, SCE_NET_EPOLLOUT, flags, [&]() {
+        return sock->send_packet(msg, len, flags, to, tolen);
+    });
 }
 
 EXPORT(int, sceNetSetDnsInfo) {
@@ -561,7 +626,7 @@ EXPORT(int, sceNetSocket, const char *name, int domain, SceNetSocketType type, S
     TRACY_FUNC(sceNetSocket, name, domain, type, protocol);
     SocketPtr sock;
     if (type < SCE_NET_SOCK_STREAM || type > SCE_NET_SOCK_RAW) {
-        sock = std::make_shared<P2PSocket>(domain, type, protocol);
+        sock = std::make_shared<P2PSocket>(domain, type, protocol, emuenv.net.p2p);
     } else {
         sock = std::make_shared<PosixSocket>(domain, type, protocol);
     }
@@ -581,7 +646,13 @@ EXPORT(int, sceNetSocketClose, int sid) {
     if (!sock) {
         return RET_ERROR(SCE_NET_EBADF);
     }
-    return sock->close();
+    const abs_socket host_sock = sock->get_wait_socket();
+    const int res = sock->close();
+    // the threads waiting on the socket try their call again and get the error of the closed socket
+    if (host_sock != INVALID_HOST_SOCKET) {
+        emuenv.net.reactor.cancel(host_sock);
+    }
+    return res;
 }
 
 EXPORT(int, sceNetTerm) {
@@ -17,134 +17,940 @@
 
 #include <module/module.h>
 
-EXPORT(int, sceSasCore) {
-    return UNIMPLEMENTED();
+#include <codec/state.h>
+#include <kernel/state.h>
+#include <modules/module_parent.h>
+#include <ngs/mix.h>
+#include <util/tracy.h>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <sstream>
+
+TRACY_MODULE_NAME(SceSas);
+
+enum SceSasErrorCode : uint32_t {
+    SCE_SAS_ERROR_INVALID_GRAIN = 0x80420001,
+    SCE_SAS_ERROR_INVALID_MAX_VOICES = 0x80420002,
+    SCE_SAS_ERROR_INVALID_OUTPUT_MODE = 0x80420003,
+    SCE_SAS_ERROR_INVALID_ADDRESS = 0x80420005,
+    SCE_SAS_ERROR_INVALID_VOICE = 0x80420010,
+    SCE_SAS_ERROR_INVALID_NOISE_CLOCK = 0x80420011,
+    SCE_SAS_ERROR_INVALID_PITCH = 0x80420012,
+    SCE_SAS_ERROR_INVALID_ADSR_CURVE_MODE = 0x80420013,
+    SCE_SAS_ERROR_INVALID_PARAMETER = 0x80420014,
+    SCE_SAS_ERROR_INVALID_LOOP_POS = 0x80420015,
+    SCE_SAS_ERROR_INVALID_VOLUME = 0x80420018,
+    SCE_SAS_ERROR_INVALID_ADSR_RATE = 0x80420019,
+    SCE_SAS_ERROR_INVALID_SIZE = 0x8042001A,
+    SCE_SAS_ERROR_INVALID_EFFECT_TYPE = 0x80420020,
+    SCE_SAS_ERROR_INVALID_EFFECT_FEEDBACK = 0x80420021,
+    SCE_SAS_ERROR_INVALID_EFFECT_DELAY = 0x80420022,
+    SCE_SAS_ERROR_INVALID_EFFECT_VOLUME = 0x80420023,
+    SCE_SAS_ERROR_INVALID_CONFIG = 0x80420024,
+    SCE_SAS_ERROR_NOT_INITIALIZED = 0x80420100,
+    SCE_SAS_ERROR_ALREADY_INITIALIZED = 0x80420101,
+};
+
+enum SceSasOutputMode : uint32_t {
+    SCE_SAS_OUTPUTMODE_STEREO = 0,
+    // dry and wet outputs are written separately as 4 channels
+    SCE_SAS_OUTPUTMODE_MULTI = 1
+};
+
+enum SceSasAdsrFlag : uint32_t {
+    SCE_SAS_ATTACK_VALID = 1,
+    SCE_SAS_DECAY_VALID = 2,
+    SCE_SAS_SUSTAIN_VALID = 4,
+    SCE_SAS_RELEASE_VALID = 8
+};
+
+enum SceSasAdsrCurveMode : uint32_t {
+    SCE_SAS_ADSR_MODE_LINEAR_INC = 0,
+    SCE_SAS_ADSR_MODE_LINEAR_DEC = 1,
+    SCE_SAS_ADSR_MODE_BENT_LINEAR_INC = 2,
+    SCE_SAS_ADSR_MODE_EXPONENT_DEC = 3,
+    SCE_SAS_ADSR_MODE_EXPONENT_INC = 4,
+    SCE_SAS_ADSR_MODE_DIRECT = 5
+};
+
+enum SceSasEffectType : int32_t {
+    SCE_SAS_FX_TYPE_OFF = -1,
+    SCE_SAS_FX_TYPE_ROOM = 0,
+    SCE_SAS_FX_TYPE_STUDIO_SMALL = 1,
+    SCE_SAS_FX_TYPE_STUDIO_MEDIUM = 2,
+    SCE_SAS_FX_TYPE_STUDIO_LARGE = 3,
+    SCE_SAS_FX_TYPE_HALL = 4,
+    SCE_SAS_FX_TYPE_SPACE = 5,
+    SCE_SAS_FX_TYPE_ECHO = 6,
+    SCE_SAS_FX_TYPE_DELAY = 7,
+    SCE_SAS_FX_TYPE_PIPE = 8
+};
+
+constexpr int32_t SCE_SAS_VOICE_MAX = 32;
+constexpr uint32_t SCE_SAS_GRAIN_SAMPLES_MIN = 64;
+constexpr uint32_t SCE_SAS_GRAIN_SAMPLES_MAX = 2048;
+constexpr uint32_t SCE_SAS_GRAIN_SAMPLES_DEFAULT = 256;
+constexpr int32_t SCE_SAS_VOLUME_MAX = 0x1000;
+constexpr int32_t SCE_SAS_PITCH_BASE = 0x1000;
+constexpr int32_t SCE_SAS_PITCH_MAX = 0x4000;
+constexpr uint32_t SCE_SAS_NOISE_CLOCK_MAX = 0x3F;
+constexpr int32_t SCE_SAS_ENVELOPE_HEIGHT_MAX = 0x40000000;
+constexpr int32_t SCE_SAS_EFFECT_PARAM_MAX = 0x7F;
+
+constexpr uint32_t SAS_SAMPLE_RATE = 48000;
+// the ECHO and DELAY effects can delay the wet output by up to a second
+constexpr uint32_t SAS_MAX_DELAY_SAMPLES = SAS_SAMPLE_RATE;
+// the noise generator is clocked once per output sample with the highest clock
+constexpr uint32_t SAS_NOISE_PERIOD = 7 << (SCE_SAS_NOISE_CLOCK_MAX >> 2);
+
+enum class SasEnvelopeStage {
+    ATTACK,
+    DECAY,
+    SUSTAIN,
+    RELEASE,
+    OFF
+};
+
+struct SasEnvelope {
+    // attack, decay, sustain and release
+    int32_t rates[4] = { SCE_SAS_ENVELOPE_HEIGHT_MAX, 0, 0, SCE_SAS_ENVELOPE_HEIGHT_MAX };
+    uint32_t modes[4] = { SCE_SAS_ADSR_MODE_LINEAR_INC, SCE_SAS_ADSR_MODE_LINEAR_DEC, SCE_SAS_ADSR_MODE_LINEAR_DEC, SCE_SAS_ADSR_MODE_LINEAR_DEC };
+    int32_t sustain_level = SCE_SAS_ENVELOPE_HEIGHT_MAX;
+
+    int64_t height = 0;
+    SasEnvelopeStage stage = SasEnvelopeStage::OFF;
+
+    static int64_t walk(int64_t height, uint32_t mode, int32_t rate) {
+        switch (mode) {
+        case SCE_SAS_ADSR_MODE_LINEAR_INC:
+            return height + rate;
+        case SCE_SAS_ADSR_MODE_LINEAR_DEC:
+            return height - rate;
+        case SCE_SAS_ADSR_MODE_BENT_LINEAR_INC:
+            // slows down for the last quarter
+            return height + (height < SCE_SAS_ENVELOPE_HEIGHT_MAX / 4 * 3 ? rate : rate / 4);
+        case SCE_SAS_ADSR_MODE_EXPONENT_DEC:
+            return height - ((height * rate) >> 31) - 1;
+        case SCE_SAS_ADSR_MODE_EXPONENT_INC:
+            return height + (((SCE_SAS_ENVELOPE_HEIGHT_MAX - height) * rate) >> 31) + 1;
+        case SCE_SAS_ADSR_MODE_DIRECT:
+            return rate;
+        default:
+            return height;
+        }
+    }
+
+    void step() {
+        switch (stage) {
+        case SasEnvelopeStage::ATTACK:
+            height = walk(height, modes[0], rates[0]);
+            if (height >= SCE_SAS_ENVELOPE_HEIGHT_MAX) {
+                height = SCE_SAS_ENVELOPE_HEIGHT_MAX;
+                stage = SasEnvelopeStage::DECAY;
+            }
+            break;
+        case SasEnvelopeStage::DECAY:
+            height = walk(height, modes[1], rates[1]);
+            if (height <= sustain_level) {
+                height = sustain_level;
+                stage = SasEnvelopeStage::SUSTAIN;
+            }
+            break;
+        case SasEnvelopeStage::SUSTAIN:
+            height = std::clamp<int64_t>(walk(height, modes[2], rates[2]), 0, SCE_SAS_ENVELOPE_HEIGHT_MAX);
+            break;
+        case SasEnvelopeStage::RELEASE:
+            height = walk(height, modes[3], rates[3]);
+            if (height <= 0) {
+                height = 0;
+                stage = SasEnvelopeStage::OFF;
+            }
+            break;
+        case SasEnvelopeStage::OFF:
+            break;
+        }
+    }
+};
+
+enum class SasVoiceType {
+    NONE,
+    VAG,
+    PCM,
+    NOISE
+};
+
+struct SasVoice {
+    SasVoiceType type = SasVoiceType::NONE;
+    Ptr<const void> data;
+    // in bytes for VAG data and in samples for PCM data
+    uint32_t size = 0;
+    bool loop = false;
+    // first sample repeated by a looping PCM voice, negative if it does not loop
+    int32_t loop_pos = -1;
+    uint32_t noise_clock = 0;
+    int32_t pitch = SCE_SAS_PITCH_BASE;
+
+    float dry_left = 1.0f;
+    float dry_right = 1.0f;
+    float wet_left = 0.0f;
+    float wet_right = 0.0f;
+    int32_t distortion = 0;
+
+    SasEnvelope envelope;
+    bool playing = false;
+    bool paused = false;
+    bool ended = true;
+    // peaks of the last grain, in s16 units
+    int32_t dry_peak = 0;
+    int32_t wet_peak = 0;
+    int32_t pre_master_peak = 0;
+
+    // frame index for VAG data, sample index for PCM data
+    uint32_t read_pos = 0;
+    int16_t frame[HEVAG_FRAME_SAMPLES] = {};
+    uint32_t frame_pos = HEVAG_FRAME_SAMPLES;
+    uint8_t frame_flags = 0;
+    ADPCMHistory history{};
+    uint32_t loop_frame = 0;
+    ADPCMHistory loop_history{};
+
+    // resampling between the two last source samples, in SCE_SAS_PITCH_BASE units
+    uint32_t pitch_pos = 0;
+    int32_t prev_sample = 0;
+    int32_t cur_sample = 0;
+
+    uint32_t noise_counter = 0;
+    uint16_t noise_lfsr = 1;
+
+    void key_on() {
+        read_pos = 0;
+        frame_pos = HEVAG_FRAME_SAMPLES;
+        frame_flags = 0;
+        history = {};
+        loop_frame = 0;
+        loop_history = {};
+        pitch_pos = 0;
+        prev_sample = 0;
+        cur_sample = 0;
+        noise_counter = 0;
+
+        envelope.height = 0;
+        envelope.stage = SasEnvelopeStage::ATTACK;
+        playing = type != SasVoiceType::NONE;
+        ended = !playing;
+    }
+
+    void stop() {
+        playing = false;
+        ended = true;
+        envelope.height = 0;
+        envelope.stage = SasEnvelopeStage::OFF;
+    }
+};
+
+struct SasEffect {
+    SceSasEffectType type = SCE_SAS_FX_TYPE_OFF;
+    bool dry = true;
+    bool wet = false;
+    float left = 0.0f;
+    float right = 0.0f;
+    uint32_t delay = 0;
+    float feedback = 0.0f;
+
+    std::vector<float> delay_line;
+    uint32_t delay_pos = 0;
+};
+
+struct SasState {
+    std::mutex mutex;
+    bool initialized = false;
+    Ptr<void> buffer;
+    SceSize buffer_size = 0;
+
+    uint32_t grain = SCE_SAS_GRAIN_SAMPLES_DEFAULT;
+    SceSasOutputMode output_mode = SCE_SAS_OUTPUTMODE_STEREO;
+    std::vector<SasVoice> voices;
+    SasEffect effect;
+
+    // interleaved stereo float buffers of a grain
+    std::vector<float> dry_buffer;
+    std::vector<float> wet_buffer;
+    std::vector<float> voice_buffer;
+    std::vector<float> multi_buffer;
+};
+
+struct SasConfig {
+    uint32_t grain = SCE_SAS_GRAIN_SAMPLES_DEFAULT;
+    uint32_t voices = SCE_SAS_VOICE_MAX;
+    uint32_t reverbs = 1;
+};
+
+// the configuration is a string like "numGrains=256 numVoices=32 numReverbs=1"
+static int parse_config(const char *config, SasConfig &result) {
+    if (!config)
+        return 0;
+
+    std::istringstream stream(config);
+    std::string token;
+    while (stream >> token) {
+        const size_t separator = token.find('=');
+        if (separator == std::string::npos)
+            return SCE_SAS_ERROR_INVALID_CONFIG;
+
+        const std::string key = token.substr(0, separator);
+        const uint32_t value = static_cast<uint32_t>(std::strtoul(token.c_str() + separator + 1, nullptr, 10));
+        if (key == "numGrains")
+            result.grain = value;
+        else if (key == "numVoices")
+            result.voices = value;
+        else if (key == "numReverbs")
+            result.reverbs = value;
+        else
+            LOG_WARN("Unknown SAS config option {}", key);
+    }
+
+    if (result.grain < SCE_SAS_GRAIN_SAMPLES_MIN || result.grain > SCE_SAS_GRAIN_SAMPLES_MAX)
+        return SCE_SAS_ERROR_INVALID_GRAIN;
+    if (result.voices == 0 || result.voices > SCE_SAS_VOICE_MAX)
+        return SCE_SAS_ERROR_INVALID_MAX_VOICES;
+
+    return 0;
+}
+
+static void set_grain(SasState &state, uint32_t grain) {
+    state.grain = grain;
+    state.dry_buffer.resize(grain * 2);
+    state.wet_buffer.resize(grain * 2);
+    state.voice_buffer.resize(grain);
+}
+
+// return false once the voice has no more data
+static bool next_source_sample(const MemState &mem, SasVoice &voice, int32_t &sample) {
+    switch (voice.type) {
+    case SasVoiceType::PCM:
+        if (voice.read_pos >= voice.size) {
+            if (voice.loop_pos < 0)
+                return false;
+            voice.read_pos = voice.loop_pos;
+        }
+        sample = voice.data.cast<const int16_t>().get(mem)[voice.read_pos++];
+        return true;
+
+    case SasVoiceType::VAG:
+        if (voice.frame_pos == HEVAG_FRAME_SAMPLES) {
+            // the end of the previous frame jumps back to the loop start or ends the voice
+            if (voice.frame_flags & 1) {
+                if (!(voice.frame_flags & 2) || !voice.loop)
+                    return false;
+                voice.read_pos = voice.loop_frame;
+                voice.history = voice.loop_history;
+            }
+            if ((voice.read_pos + 1) * HEVAG_FRAME_SIZE > voice.size)
+                return false;
+
+            const uint8_t *frame = voice.data.cast<const uint8_t>().get(mem) + voice.read_pos * HEVAG_FRAME_SIZE;
+            const uint8_t flags = frame[1] & 0xF;
+            // 7 marks the end of the data, the frame is silent
+            if (flags == 7)
+                return false;
+            if (flags & 4) {
+                voice.loop_frame = voice.read_pos;
+                voice.loop_history = voice.history;
+            }
+
+            voice.frame_flags = decode_hevag_frame(frame, voice.history, voice.frame);
+            voice.read_pos++;
+            voice.frame_pos = 0;
+        }
+        sample = voice.frame[voice.frame_pos++];
+        return true;
+
+    case SasVoiceType::NOISE:
+        // 16 bits Galois LFSR, its clock gets higher with the noise clock like the SPU one
+        voice.noise_counter += (4 + (voice.noise_clock & 3)) << (voice.noise_clock >> 2);
+        while (voice.noise_counter >= SAS_NOISE_PERIOD) {
+            voice.noise_counter -= SAS_NOISE_PERIOD;
+            voice.noise_lfsr = (voice.noise_lfsr >> 1) ^ (-(voice.noise_lfsr & 1) & 0xB400);
+        }
+        sample = static_cast<int16_t>(voice.noise_lfsr);
+        return true;
+
+    case SasVoiceType::NONE:
+    default:
+        return false;
+    }
+}
+
+// resample the voice to the output rate and apply its envelope, the samples are in [-1, 1]
+static void render_voice(const MemState &mem, SasVoice &voice, float *dest, uint32_t nb_samples) {
+    constexpr float scale = 1.0f / (32768.0f * SCE_SAS_ENVELOPE_HEIGHT_MAX);
+
+    uint32_t i = 0;
+    for (; i < nb_samples; i++) {
+        voice.pitch_pos += voice.pitch;
+        bool has_data = true;
+        while (has_data && voice.pitch_pos >= SCE_SAS_PITCH_BASE) {
+            voice.pitch_pos -= SCE_SAS_PITCH_BASE;
+            voice.prev_sample = voice.cur_sample;
+            has_data = next_source_sample(mem, voice, voice.cur_sample);
+        }
+
+        voice.envelope.step();
+        if (!has_data || voice.envelope.stage == SasEnvelopeStage::OFF) {
+            voice.stop();
+            break;
+        }
+
+        const int32_t sample = voice.prev_sample + (((voice.cur_sample - voice.prev_sample) * static_cast<int32_t>(voice.pitch_pos)) >> 12);
+        dest[i] = static_cast<float>(sample) * static_cast<float>(voice.envelope.height) * scale;
+    }
+
+    std::fill(dest + i, dest + nb_samples, 0.0f);
+}
+
+static void apply_effect(SasEffect &effect, float *wet, uint32_t nb_frames) {
+    switch (effect.type) {
+    case SCE_SAS_FX_TYPE_OFF:
+        std::fill_n(wet, nb_frames * 2, 0.0f);
+        return;
+
+    case SCE_SAS_FX_TYPE_ECHO:
+    case SCE_SAS_FX_TYPE_DELAY: {
+        const uint32_t delay_frames = std::max<uint32_t>(1, (effect.delay + 1) * SAS_MAX_DELAY_SAMPLES / (SCE_SAS_EFFECT_PARAM_MAX + 1));
+        if (effect.delay_line.size() != delay_frames * 2) {
+            effect.delay_line.assign(delay_frames * 2, 0.0f);
+            effect.delay_pos = 0;
+        }
+
+        for (uint32_t k = 0; k < nb_frames * 2; k++) {
+            const float delayed = effect.delay_line[effect.delay_pos];
+            effect.delay_line[effect.delay_pos] = wet[k] + delayed * effect.feedback;
+            wet[k] = delayed;
+            effect.delay_pos = (effect.delay_pos + 1) % effect.delay_line.size();
+        }
+        return;
+    }
+
+    default:
+        // the reverbs are not emulated, the wet output is sent as is
+        LOG_WARN_ONCE("Unimplemented SAS effect type {}", static_cast<int32_t>(effect.type));
+        return;
+    }
+}
+
+// mix a grain of all the voices, the dry buffer then contains the output of the stereo mode
+static void mix_grain(const MemState &mem, SasState &state) {
+    std::fill(state.dry_buffer.begin(), state.dry_buffer.end(), 0.0f);
+    std::fill(state.wet_buffer.begin(), state.wet_buffer.end(), 0.0f);
+
+    for (SasVoice &voice : state.voices) {
+        voice.dry_peak = 0;
+        voice.wet_peak = 0;
+        voice.pre_master_peak = 0;
+        if (!voice.playing || voice.paused)
+            continue;
+
+        render_voice(mem, voice, state.voice_buffer.data(), state.grain);
+
+        float peak = 0.0f;
+        for (const float sample : state.voice_buffer)
+            peak = std::max(peak, std::abs(sample));
+        voice.pre_master_peak = static_cast<int32_t>(std::min(peak, 1.0f) * 32767.0f);
+        voice.dry_peak = static_cast<int32_t>(std::min(peak * std::max(std::abs(voice.dry_left), std::abs(voice.dry_right)), 1.0f) * 32767.0f);
+        voice.wet_peak = static_cast<int32_t>(std::min(peak * std::max(std::abs(voice.wet_left), std::abs(voice.wet_right)), 1.0f) * 32767.0f);
+
+        if (state.effect.dry)
+            ngs::mix_mono_to_stereo(state.dry_buffer.data(), state.voice_buffer.data(), state.grain, voice.dry_left, voice.dry_right);
+        if (state.effect.wet)
+            ngs::mix_mono_to_stereo(state.wet_buffer.data(), state.voice_buffer.data(), state.grain, voice.wet_left, voice.wet_right);
+    }
+
+    if (state.effect.wet)
+        apply_effect(state.effect, state.wet_buffer.data(), state.grain);
+    if (state.output_mode == SCE_SAS_OUTPUTMODE_STEREO && state.effect.wet) {
+        const float matrix[2][2] = { { state.effect.left, 0.0f }, { 0.0f, state.effect.right } };
+        ngs::mix_stereo(state.dry_buffer.data(), state.wet_buffer.data(), state.grain, matrix);
+    }
+}
+
+static void write_output(SasState &state, int16_t *out) {
+    if (state.output_mode == SCE_SAS_OUTPUTMODE_STEREO) {
+        ngs::convert_f32_to_s16(out, state.dry_buffer.data(), state.grain * 2);
+        return;
+    }
+
+    // dry L R then wet L R
+    state.multi_buffer.resize(state.grain * 4);
+    for (uint32_t k = 0; k < state.grain; k++) {
+        state.multi_buffer[k * 4] = state.dry_buffer[k * 2];
+        state.multi_buffer[k * 4 + 1] = state.dry_buffer[k * 2 + 1];
+        state.multi_buffer[k * 4 + 2] = state.wet_buffer[k * 2] * state.effect.left;
+        state.multi_buffer[k * 4 + 3] = state.wet_buffer[k * 2 + 1] * state.effect.right;
+    }
+    ngs::convert_f32_to_s16(out, state.multi_buffer.data(), state.grain * 4);
+}
+
+static float to_volume(int32_t volume) {
+    return static_cast<float>(volume) / SCE_SAS_VOLUME_MAX;
+}
+
+static bool is_valid_volume(int32_t volume) {
+    return volume >= -SCE_SAS_VOLUME_MAX && volume <= SCE_SAS_VOLUME_MAX;
+}
+
+static bool is_valid_adsr_mode(uint32_t stage, uint32_t mode) {
+    switch (stage) {
+    case 0:
+        // attack must increase
+        return mode == SCE_SAS_ADSR_MODE_LINEAR_INC || mode == SCE_SAS_ADSR_MODE_BENT_LINEAR_INC || mode == SCE_SAS_ADSR_MODE_DIRECT;
+    case 2:
+        return mode <= SCE_SAS_ADSR_MODE_DIRECT;
+    default:
+        // decay and release must decrease
+        return mode == SCE_SAS_ADSR_MODE_LINEAR_DEC || mode == SCE_SAS_ADSR_MODE_EXPONENT_DEC || mode == SCE_SAS_ADSR_MODE_DIRECT;
+    }
+}
+
+// conversions of the SPU style ADSR registers used by sceSasSetSimpleADSR
+static int32_t simple_rate(uint32_t n) {
+    n &= 0x7F;
+    if (n == 0x7F)
+        return 0;
+    const int32_t rate = ((7 - (n & 3)) << 26) >> (n >> 2);
+    return rate == 0 ? 1 : rate;
+}
+
+static int32_t simple_exponent_rate(uint32_t n) {
+    if (n == 0)
+        return 0x7FFFFFFF;
+    return static_cast<int32_t>(0x80000000U >> (n + 2));
+}
+
+static void set_simple_adsr(SasEnvelope &envelope, uint32_t adsr1, uint32_t adsr2) {
+    envelope.rates[0] = simple_rate(adsr1 >> 8);
+    envelope.modes[0] = (adsr1 & 0x8000) ? SCE_SAS_ADSR_MODE_BENT_LINEAR_INC : SCE_SAS_ADSR_MODE_LINEAR_INC;
+    envelope.rates[1] = simple_exponent_rate((adsr1 >> 4) & 0xF);
+    envelope.modes[1] = SCE_SAS_ADSR_MODE_EXPONENT_DEC;
+    envelope.sustain_level = ((adsr1 & 0xF) + 1) << 26;
+
+    envelope.rates[2] = simple_rate(adsr2 >> 6);
+    switch ((adsr2 >> 13) & 7) {
+    case 0:
+        envelope.modes[2] = SCE_SAS_ADSR_MODE_LINEAR_INC;
+        break;
+    case 2:
+        envelope.modes[2] = SCE_SAS_ADSR_MODE_LINEAR_DEC;
+        break;
+    case 4:
+        envelope.modes[2] = SCE_SAS_ADSR_MODE_BENT_LINEAR_INC;
+        break;
+    default:
+        envelope.modes[2] = SCE_SAS_ADSR_MODE_EXPONENT_DEC;
+        break;
+    }
+
+    const uint32_t release = adsr2 & 0x1F;
+    if (adsr2 & 0x20) {
+        envelope.modes[3] = SCE_SAS_ADSR_MODE_EXPONENT_DEC;
+        envelope.rates[3] = release == 31 ? 0 : simple_exponent_rate(release);
+    } else {
+        envelope.modes[3] = SCE_SAS_ADSR_MODE_LINEAR_DEC;
+        if (release == 31)
+            envelope.rates[3] = 0;
+        else if (release == 30)
+            envelope.rates[3] = SCE_SAS_ENVELOPE_HEIGHT_MAX;
+        else if (release == 29)
+            envelope.rates[3] = 1;
+        else
+            envelope.rates[3] = 0x10000000 >> release;
+    }
+}
+
+// lock the state and check the voice number, used by all the voice functions
+#define SAS_VOICE_GUARD()                                                  \
+    const auto state = emuenv.kernel.obj_store.get<SasState>();            \
+    const std::lock_guard<std::mutex> lock(state->mutex);                  \
+    if (!state->initialized)                                               \
+        return RET_ERROR(SCE_SAS_ERROR_NOT_INITIALIZED);                   \
+    if (voice_num < 0 || voice_num >= static_cast<int>(state->voices.size())) \
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_VOICE);                     \
+    SasVoice &voice = state->voices[voice_num];
+
+#define SAS_STATE_GUARD()                                       \
+    const auto state = emuenv.kernel.obj_store.get<SasState>(); \
+    const std::lock_guard<std::mutex> lock(state->mutex);       \
+    if (!state->initialized)                                    \
+        return RET_ERROR(SCE_SAS_ERROR_NOT_INITIALIZED);
+
+LIBRARY_INIT(SceSas) {
+    emuenv.kernel.obj_store.create<SasState>();
+}
+
+static int init_sas(EmuEnvState &emuenv, const char *export_name, const char *config, uint32_t grain, Ptr<void> buffer, SceSize buffer_size) {
+    SasConfig sas_config;
+    const int result = parse_config(config, sas_config);
+    if (result < 0)
+        return RET_ERROR(result);
+    if (grain != 0) {
+        if (grain < SCE_SAS_GRAIN_SAMPLES_MIN || grain > SCE_SAS_GRAIN_SAMPLES_MAX)
+            return RET_ERROR(SCE_SAS_ERROR_INVALID_GRAIN);
+        sas_config.grain = grain;
+    }
+
+    const auto state = emuenv.kernel.obj_store.get<SasState>();
+    const std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->initialized)
+        return RET_ERROR(SCE_SAS_ERROR_ALREADY_INITIALIZED);
+
+    state->initialized = true;
+    state->buffer = buffer;
+    state->buffer_size = buffer_size;
+    state->output_mode = SCE_SAS_OUTPUTMODE_STEREO;
+    state->voices.assign(sas_config.voices, SasVoice{});
+    state->effect = SasEffect{};
+    set_grain(*state, sas_config.grain);
+    return 0;
+}
+
+EXPORT(int, sceSasCore, int16_t *out) {
+    TRACY_FUNC(sceSasCore, out);
+    SAS_STATE_GUARD();
+    if (!out)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_ADDRESS);
+
+    mix_grain(emuenv.mem, *state);
+    write_output(*state, out);
+    return 0;
+}
+
+EXPORT(int, sceSasCoreWithMix, int16_t *in_out, int left_volume, int right_volume) {
+    TRACY_FUNC(sceSasCoreWithMix, in_out, left_volume, right_volume);
+    SAS_STATE_GUARD();
+    if (!in_out)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_ADDRESS);
+    if (!is_valid_volume(left_volume) || !is_valid_volume(right_volume))
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_VOLUME);
+
+    mix_grain(emuenv.mem, *state);
+
+    // the input is only mixed with the dry output in multichannel mode
+    const float left = to_volume(left_volume) / 32768.0f;
+    const float right = to_volume(right_volume) / 32768.0f;
+    const uint32_t stride = state->output_mode == SCE_SAS_OUTPUTMODE_STEREO ? 2 : 4;
+    for (uint32_t k = 0; k < state->grain; k++) {
+        state->dry_buffer[k * 2] += in_out[k * stride] * left;
+        state->dry_buffer[k * 2 + 1] += in_out[k * stride + 1] * right;
+    }
+    write_output(*state, in_out);
+    return 0;
+}
+
+EXPORT(int, sceSasExit, Ptr<void> *buffer, SceSize *buffer_size) {
+    TRACY_FUNC(sceSasExit, buffer, buffer_size);
+    SAS_STATE_GUARD();
+
+    if (buffer)
+        *buffer = state->buffer;
+    if (buffer_size)
+        *buffer_size = state->buffer_size;
+
+    state->initialized = false;
+    state->voices.clear();
+    state->effect = SasEffect{};
+    return 0;
+}
+
+EXPORT(int, sceSasGetDryPeak, int voice_num) {
+    TRACY_FUNC(sceSasGetDryPeak, voice_num);
+    SAS_VOICE_GUARD();
+    return voice.dry_peak;
+}
+
+EXPORT(int, sceSasGetEndState, int voice_num) {
+    TRACY_FUNC(sceSasGetEndState, voice_num);
+    SAS_VOICE_GUARD();
+    return voice.ended ? 1 : 0;
+}
+
+EXPORT(int, sceSasGetEnvelope, int voice_num) {
+    TRACY_FUNC(sceSasGetEnvelope, voice_num);
+    SAS_VOICE_GUARD();
+    return static_cast<int>(voice.envelope.height);
 }
 
-EXPORT(int, sceSasCoreWithMix) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasGetGrain) {
+    TRACY_FUNC(sceSasGetGrain);
+    SAS_STATE_GUARD();
+    return static_cast<int>(state->grain);
 }
 
-EXPORT(int, sceSasExit) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasGetNeededMemorySize, const char *config, SceSize *size) {
+    TRACY_FUNC(sceSasGetNeededMemorySize, config, size);
+    if (!size)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_ADDRESS);
 
-EXPORT(int, sceSasGetDryPeak) {
-    return UNIMPLEMENTED();
-}
+    SasConfig sas_config;
+    const int result = parse_config(config, sas_config);
+    if (result < 0)
+        return RET_ERROR(result);
 
-EXPORT(int, sceSasGetEndState) {
-    return UNIMPLEMENTED();
+    // the work buffer is not used by the HLE implementation, ask for the size of the state it replaces
+    *size = static_cast<SceSize>(sizeof(SasState) + sas_config.voices * sizeof(SasVoice)
+        + sas_config.grain * 5 * sizeof(float) + sas_config.reverbs * SAS_MAX_DELAY_SAMPLES * 2 * sizeof(float));
+    return 0;
 }
 
-EXPORT(int, sceSasGetEnvelope) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasGetOutputmode) {
+    TRACY_FUNC(sceSasGetOutputmode);
+    SAS_STATE_GUARD();
+    return static_cast<int>(state->output_mode);
 }
 
-EXPORT(int, sceSasGetGrain) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasGetPauseState, int voice_num) {
+    TRACY_FUNC(sceSasGetPauseState, voice_num);
+    SAS_VOICE_GUARD();
+    return voice.paused ? 1 : 0;
 }
 
-EXPORT(int, sceSasGetNeededMemorySize) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasGetPreMasterPeak, int voice_num) {
+    TRACY_FUNC(sceSasGetPreMasterPeak, voice_num);
+    SAS_VOICE_GUARD();
+    return voice.pre_master_peak;
 }
 
-EXPORT(int, sceSasGetOutputmode) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasGetWetPeak, int voice_num) {
+    TRACY_FUNC(sceSasGetWetPeak, voice_num);
+    SAS_VOICE_GUARD();
+    return voice.wet_peak;
 }
 
-EXPORT(int, sceSasGetPauseState) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasInit, const char *config, Ptr<void> buffer, SceSize buffer_size) {
+    TRACY_FUNC(sceSasInit, config, buffer, buffer_size);
+    return init_sas(emuenv, export_name, config, 0, buffer, buffer_size);
 }
 
-EXPORT(int, sceSasGetPreMasterPeak) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasInitWithGrain, const char *config, uint32_t grain, Ptr<void> buffer, SceSize buffer_size) {
+    TRACY_FUNC(sceSasInitWithGrain, config, grain, buffer, buffer_size);
+    if (grain == 0)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_GRAIN);
+    return init_sas(emuenv, export_name, config, grain, buffer, buffer_size);
 }
 
-EXPORT(int, sceSasGetWetPeak) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetADSR, int voice_num, uint32_t flags, uint32_t attack, uint32_t decay, uint32_t sustain, uint32_t release) {
+    TRACY_FUNC(sceSasSetADSR, voice_num, flags, attack, decay, sustain, release);
+    SAS_VOICE_GUARD();
 
-EXPORT(int, sceSasInit) {
-    return UNIMPLEMENTED();
+    const uint32_t rates[4] = { attack, decay, sustain, release };
+    for (uint32_t i = 0; i < 4; i++) {
+        if ((flags & (1 << i)) && (rates[i] & 0x80000000))
+            return RET_ERROR(SCE_SAS_ERROR_INVALID_ADSR_RATE);
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        if (flags & (1 << i))
+            voice.envelope.rates[i] = static_cast<int32_t>(rates[i]);
+    }
+    return 0;
 }
 
-EXPORT(int, sceSasInitWithGrain) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetADSRmode, int voice_num, uint32_t flags, uint32_t attack, uint32_t decay, uint32_t sustain, uint32_t release) {
+    TRACY_FUNC(sceSasSetADSRmode, voice_num, flags, attack, decay, sustain, release);
+    SAS_VOICE_GUARD();
 
-EXPORT(int, sceSasSetADSR) {
-    return UNIMPLEMENTED();
+    const uint32_t modes[4] = { attack, decay, sustain, release };
+    for (uint32_t i = 0; i < 4; i++) {
+        if ((flags & (1 << i)) && !is_valid_adsr_mode(i, modes[i]))
+            return RET_ERROR(SCE_SAS_ERROR_INVALID_ADSR_CURVE_MODE);
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        if (flags & (1 << i))
+            voice.envelope.modes[i] = modes[i];
+    }
+    return 0;
 }
 
-EXPORT(int, sceSasSetADSRmode) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetDistortion, int voice_num, int wet_volume) {
+    TRACY_FUNC(sceSasSetDistortion, voice_num, wet_volume);
+    SAS_VOICE_GUARD();
+    if (!is_valid_volume(wet_volume))
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_VOLUME);
 
-EXPORT(int, sceSasSetDistortion) {
-    return UNIMPLEMENTED();
+    voice.distortion = wet_volume;
+    return STUBBED("distortion is not applied");
 }
 
-EXPORT(int, sceSasSetEffect) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasSetEffect, int dry, int wet) {
+    TRACY_FUNC(sceSasSetEffect, dry, wet);
+    SAS_STATE_GUARD();
+    state->effect.dry = dry != 0;
+    state->effect.wet = wet != 0;
+    return 0;
 }
 
-EXPORT(int, sceSasSetEffectParam) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetEffectParam, uint32_t delay, uint32_t feedback) {
+    TRACY_FUNC(sceSasSetEffectParam, delay, feedback);
+    SAS_STATE_GUARD();
+    if (delay > SCE_SAS_EFFECT_PARAM_MAX)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_EFFECT_DELAY);
+    if (feedback > SCE_SAS_EFFECT_PARAM_MAX)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_EFFECT_FEEDBACK);
 
-EXPORT(int, sceSasSetEffectType) {
-    return UNIMPLEMENTED();
+    state->effect.delay = delay;
+    state->effect.feedback = static_cast<float>(feedback) / (SCE_SAS_EFFECT_PARAM_MAX + 1);
+    return 0;
 }
 
-EXPORT(int, sceSasSetEffectVolume) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetEffectType, SceSasEffectType type) {
+    TRACY_FUNC(sceSasSetEffectType, type);
+    SAS_STATE_GUARD();
+    if (type < SCE_SAS_FX_TYPE_OFF || type > SCE_SAS_FX_TYPE_PIPE)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_EFFECT_TYPE);
 
-EXPORT(int, sceSasSetGrain) {
-    return UNIMPLEMENTED();
+    state->effect.type = type;
+    state->effect.delay_line.clear();
+    return 0;
 }
 
-EXPORT(int, sceSasSetKeyOff) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetEffectVolume, int left_volume, int right_volume) {
+    TRACY_FUNC(sceSasSetEffectVolume, left_volume, right_volume);
+    SAS_STATE_GUARD();
+    if (!is_valid_volume(left_volume) || !is_valid_volume(right_volume))
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_EFFECT_VOLUME);
 
-EXPORT(int, sceSasSetKeyOn) {
-    return UNIMPLEMENTED();
+    state->effect.left = to_volume(left_volume);
+    state->effect.right = to_volume(right_volume);
+    return 0;
 }
 
-EXPORT(int, sceSasSetNoise) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetGrain, uint32_t grain) {
+    TRACY_FUNC(sceSasSetGrain, grain);
+    SAS_STATE_GUARD();
+    if (grain < SCE_SAS_GRAIN_SAMPLES_MIN || grain > SCE_SAS_GRAIN_SAMPLES_MAX)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_GRAIN);
 
-EXPORT(int, sceSasSetOutputmode) {
-    return UNIMPLEMENTED();
-}
+    set_grain(*state, grain);
+    return 0;
+}
+
+EXPORT(int, sceSasSetKeyOff, int voice_num) {
+    TRACY_FUNC(sceSasSetKeyOff, voice_num);
+    SAS_VOICE_GUARD();
+    if (voice.playing && voice.envelope.stage != SasEnvelopeStage::OFF)
+        voice.envelope.stage = SasEnvelopeStage::RELEASE;
+    return 0;
+}
+
+EXPORT(int, sceSasSetKeyOn, int voice_num) {
+    TRACY_FUNC(sceSasSetKeyOn, voice_num);
+    SAS_VOICE_GUARD();
+    voice.key_on();
+    return 0;
+}
 
-EXPORT(int, sceSasSetPause) {
-    return UNIMPLEMENTED();
-}
+EXPORT(int, sceSasSetNoise, int voice_num, uint32_t clock) {
+    TRACY_FUNC(sceSasSetNoise, voice_num, clock);
+    SAS_VOICE_GUARD();
+    if (clock > SCE_SAS_NOISE_CLOCK_MAX)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_NOISE_CLOCK);
+
+    voice.type = SasVoiceType::NOISE;
+    voice.noise_clock = clock;
+    return 0;
+}
+
+EXPORT(int, sceSasSetOutputmode, SceSasOutputMode mode) {
+    TRACY_FUNC(sceSasSetOutputmode, mode);
+    SAS_STATE_GUARD();
+    if (mode != SCE_SAS_OUTPUTMODE_STEREO && mode != SCE_SAS_OUTPUTMODE_MULTI)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_OUTPUT_MODE);
 
-EXPORT(int, sceSasSetPitch) {
-    return UNIMPLEMENTED();
+    state->output_mode = mode;
+    return 0;
 }
 
-EXPORT(int, sceSasSetSL) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasSetPause, int voice_num, int pause) {
+    TRACY_FUNC(sceSasSetPause, voice_num, pause);
+    SAS_VOICE_GUARD();
+    voice.paused = pause != 0;
+    return 0;
 }
 
-EXPORT(int, sceSasSetSimpleADSR) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasSetPitch, int voice_num, int pitch) {
+    TRACY_FUNC(sceSasSetPitch, voice_num, pitch);
+    SAS_VOICE_GUARD();
+    if (pitch <= 0 || pitch > SCE_SAS_PITCH_MAX)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_PITCH);
+
+    voice.pitch = pitch;
+    return 0;
 }
 
-EXPORT(int, sceSasSetVoice) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasSetSL, int voice_num, uint32_t level) {
+    TRACY_FUNC(sceSasSetSL, voice_num, level);
+    SAS_VOICE_GUARD();
+    if (level > SCE_SAS_ENVELOPE_HEIGHT_MAX)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_PARAMETER);
+
+    voice.envelope.sustain_level = static_cast<int32_t>(level);
+    return 0;
 }
 
-EXPORT(int, sceSasSetVoicePCM) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasSetSimpleADSR, int voice_num, uint32_t adsr1, uint32_t adsr2) {
+    TRACY_FUNC(sceSasSetSimpleADSR, voice_num, adsr1, adsr2);
+    SAS_VOICE_GUARD();
+    // the sustain mode is in the 3 upper bits and must be even
+    if ((adsr2 >> 13) & 1)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_ADSR_CURVE_MODE);
+
+    set_simple_adsr(voice.envelope, adsr1, adsr2);
+    return 0;
 }
 
-EXPORT(int, sceSasSetVolume) {
-    return UNIMPLEMENTED();
+EXPORT(int, sceSasSetVoice, int voice_num, Ptr<const void> data, SceSize size, int loop) {
+    TRACY_FUNC(sceSasSetVoice, voice_num, data, size, loop);
+    SAS_VOICE_GUARD();
+    if (!data)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_ADDRESS);
+    if (size == 0 || size % HEVAG_FRAME_SIZE != 0)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_SIZE);
+    if (loop != 0 && loop != 1)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_LOOP_POS);
+
+    voice.type = SasVoiceType::VAG;
+    voice.data = data;
+    voice.size = size;
+    voice.loop = loop != 0;
+    return 0;
+}
+
+EXPORT(int, sceSasSetVoicePCM, int voice_num, Ptr<const void> data, SceSize size, int loop_pos) {
+    TRACY_FUNC(sceSasSetVoicePCM, voice_num, data, size, loop_pos);
+    SAS_VOICE_GUARD();
+    if (!data)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_ADDRESS);
+    if (size == 0)
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_SIZE);
+    if (loop_pos >= static_cast<int>(size))
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_LOOP_POS);
+
+    voice.type = SasVoiceType::PCM;
+    voice.data = data;
+    voice.size = size;
+    voice.loop_pos = loop_pos < 0 ? -1 : loop_pos;
+    voice.loop = loop_pos >= 0;
+    return 0;
+}
+
+EXPORT(int, sceSasSetVolume, int voice_num, int left, int right, int wet_left, int wet_right) {
+    TRACY_FUNC(sceSasSetVolume, voice_num, left, right, wet_left, wet_right);
+    SAS_VOICE_GUARD();
+    if (!is_valid_volume(left) || !is_valid_volume(right) || !is_valid_volume(wet_left) || !is_valid_volume(wet_right))
+        return RET_ERROR(SCE_SAS_ERROR_INVALID_VOLUME);
+
+    voice.dry_left = to_volume(left);
+    voice.dry_right = to_volume(right);
+    voice.wet_left = to_volume(wet_left);
+    voice.wet_right = to_volume(wet_right);
+    return 0;
 }
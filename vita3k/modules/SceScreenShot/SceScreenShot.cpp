@@ -17,8 +17,20 @@
 
 #include <module/module.h>
 
+#include <io/state.h>
+#include <renderer/state.h>
+#include <util/safe_time.h>
+
+#include <ctime>
+
 EXPORT(int, sceScreenShotCapture) {
-    return UNIMPLEMENTED();
+    // the frame is read back and saved by the renderer, the app does not wait for it
+    const std::time_t now = std::time(nullptr);
+    tm local = {};
+    SAFE_LOCALTIME(&now, &local);
+    const auto file_name = fmt::format("{}_{:04}{:02}{:02}-{:02}{:02}{:02}.png", emuenv.io.title_id, local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+    emuenv.renderer->screenshot.request(emuenv.pref_path / "ux0/picture/SCREENSHOT" / emuenv.io.title_id / file_name);
+    return 0;
 }
 
 EXPORT(int, sceScreenShotDisable) {
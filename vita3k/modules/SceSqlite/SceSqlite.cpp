@@ -17,6 +17,19 @@
 
 #include <module/module.h>
 
+#ifdef USE_SYSTEM_SQLITE
+#include <io/functions.h>
+#include <kernel/state.h>
+#include <mem/functions.h>
+#include <util/log.h>
+
+#include <sqlite3.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#endif
+
 EXPORT(int, sceSqliteConfigMallocMethods) {
     return UNIMPLEMENTED();
 }
@@ -53,42 +66,14 @@ EXPORT(int, sqlite3_backup_step) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_bind_blob) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_bind_double) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_bind_int) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_bind_int64) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_bind_null) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_bind_parameter_count) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_bind_parameter_index) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_bind_parameter_name) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_bind_text) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_bind_text16) {
     return UNIMPLEMENTED();
 }
@@ -97,10 +82,6 @@ EXPORT(int, sqlite3_bind_value) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_bind_zeroblob) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_blob_bytes) {
     return UNIMPLEMENTED();
 }
@@ -125,22 +106,6 @@ EXPORT(int, sqlite3_busy_handler) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_busy_timeout) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_changes) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_clear_bindings) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_close) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_collation_needed) {
     return UNIMPLEMENTED();
 }
@@ -149,22 +114,10 @@ EXPORT(int, sqlite3_collation_needed16) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_column_blob) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_column_bytes) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_column_bytes16) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_column_count) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_column_decltype) {
     return UNIMPLEMENTED();
 }
@@ -177,34 +130,14 @@ EXPORT(int, sqlite3_column_double) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_column_int) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_column_int64) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_column_name) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_column_name16) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_column_text) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_column_text16) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_column_type) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_column_value) {
     return UNIMPLEMENTED();
 }
@@ -257,10 +190,6 @@ EXPORT(int, sqlite3_create_module_v2) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_data_count) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_db_config) {
     return UNIMPLEMENTED();
 }
@@ -289,30 +218,14 @@ EXPORT(int, sqlite3_enable_shared_cache) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_errcode) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_errmsg) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_errmsg16) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_exec) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_expired) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_extended_errcode) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_extended_result_codes) {
     return UNIMPLEMENTED();
 }
@@ -321,22 +234,10 @@ EXPORT(int, sqlite3_file_control) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_finalize) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_free) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_free_table) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_get_autocommit) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_get_auxdata) {
     return UNIMPLEMENTED();
 }
@@ -349,26 +250,14 @@ EXPORT(int, sqlite3_global_recover) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_initialize) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_interrupt) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_last_insert_rowid) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_libversion) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_libversion_number) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_limit) {
     return UNIMPLEMENTED();
 }
@@ -377,10 +266,6 @@ EXPORT(int, sqlite3_load_extension) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_malloc) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_memory_alarm) {
     return UNIMPLEMENTED();
 }
@@ -421,18 +306,10 @@ EXPORT(int, sqlite3_next_stmt) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_open) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_open16) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_open_v2) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_os_end) {
     return UNIMPLEMENTED();
 }
@@ -445,10 +322,6 @@ EXPORT(int, sqlite3_overload_function) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_prepare) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_prepare16) {
     return UNIMPLEMENTED();
 }
@@ -457,10 +330,6 @@ EXPORT(int, sqlite3_prepare16_v2) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_prepare_v2) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_profile) {
     return UNIMPLEMENTED();
 }
@@ -481,10 +350,6 @@ EXPORT(int, sqlite3_release_memory) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_reset) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_reset_auto_extension) {
     return UNIMPLEMENTED();
 }
@@ -565,10 +430,6 @@ EXPORT(int, sqlite3_set_auxdata) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_shutdown) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_sleep) {
     return UNIMPLEMENTED();
 }
@@ -593,10 +454,6 @@ EXPORT(int, sqlite3_status) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_step) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_stmt_status) {
     return UNIMPLEMENTED();
 }
@@ -617,14 +474,6 @@ EXPORT(int, sqlite3_thread_cleanup) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, sqlite3_threadsafe) {
-    return UNIMPLEMENTED();
-}
-
-EXPORT(int, sqlite3_total_changes) {
-    return UNIMPLEMENTED();
-}
-
 EXPORT(int, sqlite3_trace) {
     return UNIMPLEMENTED();
 }
@@ -708,3 +557,650 @@ EXPORT(int, sqlite3_vfs_unregister) {
 EXPORT(int, sqlite3_vmprintf) {
     return UNIMPLEMENTED();
 }
+
+#ifdef USE_SYSTEM_SQLITE
+
+// The exports below run on the sqlite of the host, the databases are opened directly at their host path.
+// The guest only gets handles to the connections and statements, never the host objects
+
+// size of the file window mapped by sqlite instead of reading it through the page cache
+constexpr int SQLITE_MMAP_SIZE = 64 * 1024 * 1024;
+// values of the sqlite3_destructor_type given by the guest which are not functions
+constexpr Address GUEST_SQLITE_STATIC = 0;
+constexpr Address GUEST_SQLITE_TRANSIENT = 0xFFFFFFFF;
+
+struct SqliteConnection {
+    sqlite3 *db = nullptr;
+    bool wal = false;
+    // guest copy of the last error message, valid until the next call to sqlite3_errmsg
+    Address errmsg = 0;
+};
+
+struct SqliteStatement {
+    sqlite3_stmt *stmt = nullptr;
+    uint32_t db = 0;
+    // guest copies of the texts and blobs of the current row, freed with the row
+    std::map<int, Address> texts;
+    std::map<int, Address> blobs;
+    // guest copies of the column names, valid until the statement is finalized
+    std::map<int, Address> names;
+};
+
+struct SqliteState {
+    std::mutex mutex;
+    uint32_t next_handle = 1;
+    std::map<uint32_t, SqliteConnection> connections;
+    std::map<uint32_t, SqliteStatement> statements;
+};
+
+static SqliteState sqlite_state;
+
+static SqliteConnection *find_connection(uint32_t handle) {
+    const std::lock_guard<std::mutex> lock(sqlite_state.mutex);
+    const auto it = sqlite_state.connections.find(handle);
+    return (it != sqlite_state.connections.end()) ? &it->second : nullptr;
+}
+
+static SqliteStatement *find_statement(uint32_t handle) {
+    const std::lock_guard<std::mutex> lock(sqlite_state.mutex);
+    const auto it = sqlite_state.statements.find(handle);
+    return (it != sqlite_state.statements.end()) ? &it->second : nullptr;
+}
+
+static Address copy_to_guest(MemState &mem, const void *data, uint32_t size, const char *name) {
+    // always null terminated, so texts can be copied with the size given by sqlite
+    const Address address = alloc(mem, size + 1, name);
+    if (!address)
+        return 0;
+    uint8_t *const dest = Ptr<uint8_t>(address).get(mem);
+    if (size > 0)
+        memcpy(dest, data, size);
+    dest[size] = 0;
+    return address;
+}
+
+static void free_guest_copies(MemState &mem, std::map<int, Address> &copies) {
+    for (const auto &[_, address] : copies)
+        free(mem, address);
+    copies.clear();
+}
+
+static void free_row(MemState &mem, SqliteStatement &statement) {
+    free_guest_copies(mem, statement.texts);
+    free_guest_copies(mem, statement.blobs);
+}
+
+static void call_guest_destructor(EmuEnvState &emuenv, SceUID thread_id, Address destructor, Address data) {
+    // the data is always copied by sqlite, so it is released right away
+    if ((destructor == GUEST_SQLITE_STATIC) || (destructor == GUEST_SQLITE_TRANSIENT))
+        return;
+    const ThreadStatePtr thread = emuenv.kernel.get_thread(thread_id);
+    thread->run_callback(destructor, { data });
+}
+
+static int open_database(EmuEnvState &emuenv, const char *filename, Ptr<uint32_t> db_handle, int flags) {
+    if (!filename || !db_handle)
+        return SQLITE_MISUSE;
+
+    const bool in_memory = (filename[0] == '\0') || (strcmp(filename, ":memory:") == 0);
+    const std::string path = in_memory ? filename : expand_path(emuenv.io, filename, emuenv.pref_path.wstring());
+    const int host_flags = (flags & (SQLITE_OPEN_READONLY | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)) | SQLITE_OPEN_SHAREDCACHE | SQLITE_OPEN_FULLMUTEX;
+
+    sqlite3 *db = nullptr;
+    const int ret = sqlite3_open_v2(path.c_str(), &db, host_flags, nullptr);
+    if (!db) {
+        *db_handle.get(emuenv.mem) = 0;
+        return ret;
+    }
+
+    SqliteConnection connection;
+    connection.db = db;
+    if ((ret == SQLITE_OK) && !in_memory && !sqlite3_db_readonly(db, "main")) {
+        // readers do not block the writer and commits only append to the log
+        sqlite3_stmt *journal_mode = nullptr;
+        if (sqlite3_prepare_v2(db, "PRAGMA journal_mode=WAL", -1, &journal_mode, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(journal_mode) == SQLITE_ROW)
+                connection.wal = strcmp(reinterpret_cast<const char *>(sqlite3_column_text(journal_mode, 0)), "wal") == 0;
+            sqlite3_finalize(journal_mode);
+        }
+        sqlite3_exec(db, fmt::format("PRAGMA mmap_size={}", SQLITE_MMAP_SIZE).c_str(), nullptr, nullptr, nullptr);
+    }
+
+    const std::lock_guard<std::mutex> lock(sqlite_state.mutex);
+    const uint32_t handle = sqlite_state.next_handle++;
+    sqlite_state.connections.emplace(handle, connection);
+    *db_handle.get(emuenv.mem) = handle;
+    return ret;
+}
+
+static int close_database(EmuEnvState &emuenv, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    if (!connection)
+        return (db == 0) ? SQLITE_OK : SQLITE_MISUSE;
+
+    // the console has no shared memory for the log, so the file is put back in rollback journal mode
+    // by the last connection to keep the savedata readable by it
+    if (connection->wal && !sqlite3_next_stmt(connection->db, nullptr))
+        sqlite3_exec(connection->db, "PRAGMA journal_mode=DELETE", nullptr, nullptr, nullptr);
+
+    const int ret = sqlite3_close(connection->db);
+    if (ret != SQLITE_OK)
+        return ret;
+
+    if (connection->errmsg)
+        free(emuenv.mem, connection->errmsg);
+    const std::lock_guard<std::mutex> lock(sqlite_state.mutex);
+    sqlite_state.connections.erase(db);
+    return SQLITE_OK;
+}
+
+EXPORT(int, sqlite3_bind_blob, uint32_t stmt, int index, Ptr<const void> value, int size, Address destructor) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return SQLITE_MISUSE;
+    const int ret = sqlite3_bind_blob(statement->stmt, index, value.get(emuenv.mem), size, SQLITE_TRANSIENT);
+    call_guest_destructor(emuenv, thread_id, destructor, value.address());
+    return ret;
+}
+
+EXPORT(int, sqlite3_bind_int, uint32_t stmt, int index, int value) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_bind_int(statement->stmt, index, value) : SQLITE_MISUSE;
+}
+
+EXPORT(int, sqlite3_bind_int64, uint32_t stmt, int index, int64_t value) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_bind_int64(statement->stmt, index, value) : SQLITE_MISUSE;
+}
+
+EXPORT(int, sqlite3_bind_null, uint32_t stmt, int index) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_bind_null(statement->stmt, index) : SQLITE_MISUSE;
+}
+
+EXPORT(int, sqlite3_bind_parameter_count, uint32_t stmt) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_bind_parameter_count(statement->stmt) : 0;
+}
+
+EXPORT(int, sqlite3_bind_parameter_index, uint32_t stmt, const char *name) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_bind_parameter_index(statement->stmt, name) : 0;
+}
+
+EXPORT(int, sqlite3_bind_text, uint32_t stmt, int index, Ptr<const char> value, int size, Address destructor) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return SQLITE_MISUSE;
+    const int ret = sqlite3_bind_text(statement->stmt, index, value.get(emuenv.mem), size, SQLITE_TRANSIENT);
+    call_guest_destructor(emuenv, thread_id, destructor, value.address());
+    return ret;
+}
+
+EXPORT(int, sqlite3_bind_zeroblob, uint32_t stmt, int index, int size) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_bind_zeroblob(statement->stmt, index, size) : SQLITE_MISUSE;
+}
+
+EXPORT(int, sqlite3_busy_timeout, uint32_t db, int ms) {
+    SqliteConnection *connection = find_connection(db);
+    return connection ? sqlite3_busy_timeout(connection->db, ms) : SQLITE_MISUSE;
+}
+
+EXPORT(int, sqlite3_changes, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    return connection ? sqlite3_changes(connection->db) : 0;
+}
+
+EXPORT(int, sqlite3_clear_bindings, uint32_t stmt) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_clear_bindings(statement->stmt) : SQLITE_MISUSE;
+}
+
+EXPORT(int, sqlite3_close, uint32_t db) {
+    return close_database(emuenv, db);
+}
+
+EXPORT(Ptr<const void>, sqlite3_column_blob, uint32_t stmt, int column) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return Ptr<const void>();
+    const auto it = statement->blobs.find(column);
+    if (it != statement->blobs.end())
+        return Ptr<const void>(it->second);
+
+    const void *blob = sqlite3_column_blob(statement->stmt, column);
+    if (!blob)
+        return Ptr<const void>();
+    const Address address = copy_to_guest(emuenv.mem, blob, sqlite3_column_bytes(statement->stmt, column), "sqlite3_column_blob");
+    statement->blobs.emplace(column, address);
+    return Ptr<const void>(address);
+}
+
+EXPORT(int, sqlite3_column_bytes, uint32_t stmt, int column) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_column_bytes(statement->stmt, column) : 0;
+}
+
+EXPORT(int, sqlite3_column_count, uint32_t stmt) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_column_count(statement->stmt) : 0;
+}
+
+EXPORT(int, sqlite3_column_int, uint32_t stmt, int column) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_column_int(statement->stmt, column) : 0;
+}
+
+EXPORT(int64_t, sqlite3_column_int64, uint32_t stmt, int column) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_column_int64(statement->stmt, column) : 0;
+}
+
+EXPORT(Ptr<const char>, sqlite3_column_name, uint32_t stmt, int column) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return Ptr<const char>();
+    const auto it = statement->names.find(column);
+    if (it != statement->names.end())
+        return Ptr<const char>(it->second);
+
+    const char *name = sqlite3_column_name(statement->stmt, column);
+    if (!name)
+        return Ptr<const char>();
+    const Address address = copy_to_guest(emuenv.mem, name, static_cast<uint32_t>(strlen(name)), "sqlite3_column_name");
+    statement->names.emplace(column, address);
+    return Ptr<const char>(address);
+}
+
+EXPORT(Ptr<const char>, sqlite3_column_text, uint32_t stmt, int column) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return Ptr<const char>();
+    const auto it = statement->texts.find(column);
+    if (it != statement->texts.end())
+        return Ptr<const char>(it->second);
+
+    const unsigned char *text = sqlite3_column_text(statement->stmt, column);
+    if (!text)
+        return Ptr<const char>();
+    const Address address = copy_to_guest(emuenv.mem, text, sqlite3_column_bytes(statement->stmt, column), "sqlite3_column_text");
+    statement->texts.emplace(column, address);
+    return Ptr<const char>(address);
+}
+
+EXPORT(int, sqlite3_column_type, uint32_t stmt, int column) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_column_type(statement->stmt, column) : SQLITE_NULL;
+}
+
+EXPORT(int, sqlite3_data_count, uint32_t stmt) {
+    SqliteStatement *statement = find_statement(stmt);
+    return statement ? sqlite3_data_count(statement->stmt) : 0;
+}
+
+EXPORT(int, sqlite3_errcode, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    return connection ? sqlite3_errcode(connection->db) : SQLITE_MISUSE;
+}
+
+EXPORT(Ptr<const char>, sqlite3_errmsg, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    if (!connection)
+        return Ptr<const char>();
+    if (connection->errmsg)
+        free(emuenv.mem, connection->errmsg);
+    const char *errmsg = sqlite3_errmsg(connection->db);
+    connection->errmsg = copy_to_guest(emuenv.mem, errmsg, static_cast<uint32_t>(strlen(errmsg)), "sqlite3_errmsg");
+    return Ptr<const char>(connection->errmsg);
+}
+
+// The rows are given to the guest callback as arrays of guest strings, like sqlite3_exec does on the host
+static int exec_with_callback(EmuEnvState &emuenv, SceUID thread_id, sqlite3 *db, const char *sql, Address callback, Address arg) {
+    const ThreadStatePtr thread = emuenv.kernel.get_thread(thread_id);
+    int ret = SQLITE_OK;
+    while ((ret == SQLITE_OK) && sql && sql[0]) {
+        sqlite3_stmt *stmt = nullptr;
+        ret = sqlite3_prepare_v2(db, sql, -1, &stmt, &sql);
+        if ((ret != SQLITE_OK) || !stmt)
+            break;
+
+        const int column_count = sqlite3_column_count(stmt);
+        int step = SQLITE_ROW;
+        while ((step = sqlite3_step(stmt)) == SQLITE_ROW) {
+            // names then values, all freed once the callback returns
+            std::vector<Address> strings(column_count * 2);
+            for (int i = 0; i < column_count; i++) {
+                const char *name = sqlite3_column_name(stmt, i);
+                strings[i] = copy_to_guest(emuenv.mem, name, static_cast<uint32_t>(strlen(name)), "sqlite3_exec");
+                const unsigned char *text = sqlite3_column_text(stmt, i);
+                strings[column_count + i] = text ? copy_to_guest(emuenv.mem, text, sqlite3_column_bytes(stmt, i), "sqlite3_exec") : 0;
+            }
+            const Address arrays = copy_to_guest(emuenv.mem, strings.data(), static_cast<uint32_t>(strings.size() * sizeof(Address)), "sqlite3_exec");
+
+            const uint32_t aborted = thread->run_callback(callback, { arg, static_cast<uint32_t>(column_count), static_cast<Address>(arrays + column_count * sizeof(Address)), arrays });
+
+            for (const Address string : strings) {
+                if (string)
+                    free(emuenv.mem, string);
+            }
+            free(emuenv.mem, arrays);
+            if (aborted) {
+                step = SQLITE_ABORT;
+                break;
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (step == SQLITE_ABORT)
+            ret = SQLITE_ABORT;
+        else if (step != SQLITE_DONE)
+            ret = sqlite3_errcode(db);
+    }
+    return ret;
+}
+
+EXPORT(int, sqlite3_exec, uint32_t db, const char *sql, Address callback, Address arg, Ptr<Ptr<char>> errmsg) {
+    SqliteConnection *connection = find_connection(db);
+    if (!connection)
+        return SQLITE_MISUSE;
+
+    int ret;
+    if (callback) {
+        ret = exec_with_callback(emuenv, thread_id, connection->db, sql, callback, arg);
+    } else {
+        ret = sqlite3_exec(connection->db, sql, nullptr, nullptr, nullptr);
+    }
+
+    // freed by the guest with sqlite3_free
+    if (errmsg) {
+        Address message = 0;
+        if (ret != SQLITE_OK) {
+            const char *host_message = (ret == SQLITE_ABORT) ? "query aborted" : sqlite3_errmsg(connection->db);
+            message = copy_to_guest(emuenv.mem, host_message, static_cast<uint32_t>(strlen(host_message)), "sqlite3_malloc");
+        }
+        *errmsg.get(emuenv.mem) = Ptr<char>(message);
+    }
+    return ret;
+}
+
+EXPORT(int, sqlite3_extended_errcode, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    return connection ? sqlite3_extended_errcode(connection->db) : SQLITE_MISUSE;
+}
+
+EXPORT(int, sqlite3_finalize, uint32_t stmt) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return SQLITE_OK;
+    const int ret = sqlite3_finalize(statement->stmt);
+    free_row(emuenv.mem, *statement);
+    free_guest_copies(emuenv.mem, statement->names);
+    const std::lock_guard<std::mutex> lock(sqlite_state.mutex);
+    sqlite_state.statements.erase(stmt);
+    return ret;
+}
+
+EXPORT(void, sqlite3_free, Address ptr) {
+    if (ptr)
+        free(emuenv.mem, ptr);
+}
+
+EXPORT(int, sqlite3_get_autocommit, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    return connection ? sqlite3_get_autocommit(connection->db) : 0;
+}
+
+EXPORT(int, sqlite3_initialize) {
+    return sqlite3_initialize();
+}
+
+EXPORT(int64_t, sqlite3_last_insert_rowid, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    return connection ? sqlite3_last_insert_rowid(connection->db) : 0;
+}
+
+EXPORT(int, sqlite3_libversion_number) {
+    return sqlite3_libversion_number();
+}
+
+EXPORT(Address, sqlite3_malloc, int size) {
+    return (size > 0) ? alloc(emuenv.mem, size, "sqlite3_malloc") : 0;
+}
+
+EXPORT(int, sqlite3_open, const char *filename, Ptr<uint32_t> db) {
+    return open_database(emuenv, filename, db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+}
+
+EXPORT(int, sqlite3_open_v2, const char *filename, Ptr<uint32_t> db, int flags, const char *vfs) {
+    return open_database(emuenv, filename, db, flags);
+}
+
+static int prepare_statement(EmuEnvState &emuenv, uint32_t db, Ptr<const char> sql, int size, Ptr<uint32_t> stmt, Ptr<Ptr<const char>> tail) {
+    SqliteConnection *connection = find_connection(db);
+    if (!connection || !stmt)
+        return SQLITE_MISUSE;
+
+    const char *const host_sql = sql.get(emuenv.mem);
+    const char *host_tail = nullptr;
+    sqlite3_stmt *host_stmt = nullptr;
+    const int ret = sqlite3_prepare_v2(connection->db, host_sql, size, &host_stmt, &host_tail);
+    if (tail)
+        *tail.get(emuenv.mem) = host_tail ? Ptr<const char>(sql.address() + static_cast<Address>(host_tail - host_sql)) : Ptr<const char>();
+
+    uint32_t handle = 0;
+    if (host_stmt) {
+        const std::lock_guard<std::mutex> lock(sqlite_state.mutex);
+        handle = sqlite_state.next_handle++;
+        SqliteStatement statement;
+        statement.stmt = host_stmt;
+        statement.db = db;
+        sqlite_state.statements.emplace(handle, std::move(statement));
+    }
+    *stmt.get(emuenv.mem) = handle;
+    return ret;
+}
+
+EXPORT(int, sqlite3_prepare, uint32_t db, Ptr<const char> sql, int size, Ptr<uint32_t> stmt, Ptr<Ptr<const char>> tail) {
+    return prepare_statement(emuenv, db, sql, size, stmt, tail);
+}
+
+EXPORT(int, sqlite3_prepare_v2, uint32_t db, Ptr<const char> sql, int size, Ptr<uint32_t> stmt, Ptr<Ptr<const char>> tail) {
+    return prepare_statement(emuenv, db, sql, size, stmt, tail);
+}
+
+EXPORT(int, sqlite3_reset, uint32_t stmt) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return SQLITE_MISUSE;
+    free_row(emuenv.mem, *statement);
+    return sqlite3_reset(statement->stmt);
+}
+
+EXPORT(int, sqlite3_shutdown) {
+    return SQLITE_OK;
+}
+
+EXPORT(int, sqlite3_step, uint32_t stmt) {
+    SqliteStatement *statement = find_statement(stmt);
+    if (!statement)
+        return SQLITE_MISUSE;
+    free_row(emuenv.mem, *statement);
+    return sqlite3_step(statement->stmt);
+}
+
+EXPORT(int, sqlite3_threadsafe) {
+    return sqlite3_threadsafe();
+}
+
+EXPORT(int, sqlite3_total_changes, uint32_t db) {
+    SqliteConnection *connection = find_connection(db);
+    return connection ? sqlite3_total_changes(connection->db) : 0;
+}
+
+#else
+
+EXPORT(int, sqlite3_bind_blob) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_bind_int) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_bind_int64) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_bind_null) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_bind_parameter_count) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_bind_parameter_index) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_bind_text) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_bind_zeroblob) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_busy_timeout) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_changes) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_clear_bindings) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_close) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_blob) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_bytes) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_count) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_int) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_int64) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_name) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_text) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_column_type) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_data_count) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_errcode) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_errmsg) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_exec) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_extended_errcode) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_finalize) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_free) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_get_autocommit) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_initialize) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_last_insert_rowid) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_libversion_number) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_malloc) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_open) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_open_v2) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_prepare) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_prepare_v2) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_reset) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_shutdown) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_step) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_threadsafe) {
+    return UNIMPLEMENTED();
+}
+
+EXPORT(int, sqlite3_total_changes) {
+    return UNIMPLEMENTED();
+}
+
+#endif
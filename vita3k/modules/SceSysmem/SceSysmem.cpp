@@ -21,12 +21,22 @@
 
 #include <kernel/state.h>
 #include <kernel/types.h>
+#include <mem/state.h>
 
 #include <util/align.h>
 
 #include <util/tracy.h>
 TRACY_MODULE_NAME(SceSysmem);
 
+// Tells which allocations hold the memory when a guest allocation fails
+static void log_memory_usage(MemState &mem, SceSize size) {
+    constexpr size_t TOP_COUNT = 8;
+    LOG_ERROR("Out of memory allocating {} bytes, free: {} bytes, largest free block: {} bytes", size, mem_available(mem), mem_largest_free_block(mem));
+    const auto usage = mem_usage_by_name(mem);
+    for (size_t i = 0; i < std::min(usage.size(), TOP_COUNT); i++)
+        LOG_ERROR("  {}: {} bytes in {} block(s), peak {} bytes", usage[i].first, usage[i].second.allocated, usage[i].second.blocks, usage[i].second.peak);
+}
+
 template <>
 std::string to_debug_str<SceKernelMemBlockType>(const MemState &mem, SceKernelMemBlockType type) {
     switch (type) {
@@ -143,6 +153,7 @@ EXPORT(SceUID, sceKernelAllocMemBlock, const char *pName, SceKernelMemBlockType
     Ptr<void> address = Ptr<void>(alloc_aligned(mem, size, pName, alignment, start_address));
 
     if (!address) {
+        log_memory_usage(mem, size);
         return RET_ERROR(SCE_KERNEL_ERROR_NO_MEMORY);
     }
 
@@ -173,6 +184,7 @@ EXPORT(int, sceKernelAllocMemBlockForVM, const char *pName, SceSize size) {
 
     const Ptr<void> address(alloc(mem, size, pName));
     if (!address) {
+        log_memory_usage(mem, size);
         return RET_ERROR(SCE_KERNEL_ERROR_NO_MEMORY);
     }
 
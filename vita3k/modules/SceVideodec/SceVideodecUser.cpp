@@ -158,7 +158,7 @@ EXPORT(int, sceAvcdecCreateDecoder, uint32_t codec_type, SceAvcdecCtrl *decoder,
     SceUID handle = emuenv.kernel.get_next_uid();
     decoder->handle = handle;
 
-    state->decoders[handle] = std::make_shared<H264DecoderState>(query->horizontal, query->vertical);
+    state->decoders[handle] = std::make_shared<H264DecoderState>(query->horizontal, query->vertical, emuenv.cfg.video_decoder_hwaccel);
 
     return 0;
 }
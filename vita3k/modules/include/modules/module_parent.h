@@ -27,6 +27,7 @@ struct KernelState;
 
 void init_libraries(EmuEnvState &emuenv);
 void call_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t nid, SceUID thread_id);
+bool call_hle_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t import_index, SceUID thread_id, bool nonblocking_only);
 
 /**
  * \brief Loads a dynamic module into memory if it wasn't already loaded. If it was, find it and return it.
@@ -25,6 +25,7 @@
 #include <io/device.h>
 #include <io/state.h>
 #include <io/vfs.h>
+#include <kernel/import_profiler.h>
 #include <kernel/load_self.h>
 #include <kernel/state.h>
 #include <module/load_module.h>
@@ -44,14 +45,71 @@ static constexpr bool LOG_UNK_NIDS_ALWAYS = false;
 #undef LIBRARY
 
 #define VAR_NID(name, nid) extern const ImportVarFactory import_##name;
-#define NID(name, nid) extern const ImportFn import_##name;
+#define NID(name, nid) extern const HleExport import_##name;
 #include <nids/nids.inc>
 #undef NID
 #undef VAR_NID
 
 struct EmuEnvState;
 
-static ImportFn resolve_import(uint32_t nid) {
+/**
+ * \brief Replace a firmware module with its inflated copy from the cache directory, creating it if needed.
+ *
+ * Cached images are named after the module and the size and modification time of the firmware file,
+ * so reinstalling the firmware invalidates them without having to hash the module on every boot.
+ */
+static bool read_cached_module(EmuEnvState &emuenv, const fs::path &host_module_path, vfs::FileBuffer &module_buffer, fs::path &image_path) {
+    boost::system::error_code error;
+    const uint64_t file_size = fs::file_size(host_module_path, error);
+    if (error)
+        return false;
+    const std::time_t write_time = fs::last_write_time(host_module_path, error);
+    if (error)
+        return false;
+
+    const uint64_t key = file_size ^ (static_cast<uint64_t>(write_time) * 0x9E3779B97F4A7C15ULL);
+    const fs::path cache_dir = emuenv.cache_path / "modules";
+    const fs::path cache_file = cache_dir / fmt::format("{}-{:016X}.self", host_module_path.stem().string(), key);
+
+    if (fs::exists(cache_file)) {
+        fs::ifstream f{ cache_file, fs::ifstream::binary };
+        module_buffer.resize(fs::file_size(cache_file));
+        if (f.read(reinterpret_cast<char *>(module_buffer.data()), module_buffer.size())) {
+            image_path = cache_file;
+            return true;
+        }
+        module_buffer.clear();
+    }
+
+    vfs::FileBuffer source;
+    {
+        fs::ifstream f{ host_module_path, fs::ifstream::binary };
+        source.resize(file_size);
+        if (!f.read(reinterpret_cast<char *>(source.data()), source.size()))
+            return false;
+    }
+    if (!inflate_self(source.data(), source.size(), module_buffer)) {
+        module_buffer.clear();
+        return false;
+    }
+
+    fs::create_directories(cache_dir, error);
+    // write to a temporary file first so another instance never sees a partial image
+    const fs::path temp_file = fs::path(cache_file).replace_extension(".tmp");
+    {
+        fs::ofstream out{ temp_file, fs::ofstream::binary };
+        out.write(reinterpret_cast<const char *>(module_buffer.data()), module_buffer.size());
+    }
+    fs::rename(temp_file, cache_file, error);
+    if (error)
+        LOG_WARN("Failed to write module cache {}: {}", cache_file.string(), error.message());
+    else
+        image_path = cache_file;
+
+    return true;
+}
+
+static HleExport resolve_import(uint32_t nid) {
     switch (nid) {
 #define VAR_NID(name, nid)
 #define NID(name, nid) \
@@ -62,7 +120,7 @@ static ImportFn resolve_import(uint32_t nid) {
 #undef VAR_NID
     }
 
-    return ImportFn();
+    return HleExport();
 }
 
 const std::array<VarExport, var_exports_size> &get_var_exports() {
@@ -97,7 +155,52 @@ Address resolve_export(KernelState &kernel, uint32_t nid) {
     return export_address->second;
 }
 
+struct HleImport {
+    uint32_t nid;
+    ImportFn fn;
+    bool nonblocking;
+    // Value of KernelState::export_nids_generation when this NID was last checked to have no LLE export
+    std::atomic<uint32_t> export_nids_generation;
+};
+
+// Mirrors KernelState::hle_import_nids, filled by load_module right after load_self binds new imports
+static std::vector<std::unique_ptr<HleImport>> hle_imports;
+static std::mutex hle_imports_mutex;
+
+static void bind_hle_imports(KernelState &kernel) {
+    const std::lock_guard<std::mutex> guard(hle_imports_mutex);
+    const std::lock_guard<std::mutex> nids_guard(kernel.export_nids_mutex);
+    // Never reallocated so call_hle_import can index it without locking
+    hle_imports.reserve(MAX_HLE_IMPORTS);
+    for (size_t i = hle_imports.size(); i < kernel.hle_import_nids.size(); i++) {
+        auto import = std::make_unique<HleImport>();
+        import->nid = kernel.hle_import_nids[i];
+        const HleExport hle_export = resolve_import(import->nid);
+        import->fn = hle_export.fn;
+        import->nonblocking = hle_export.nonblocking;
+        import->export_nids_generation = UINT32_MAX;
+        hle_imports.push_back(std::move(import));
+    }
+}
+
+static void call_hle_fn(ImportFn fn, uint32_t nid, EmuEnvState &emuenv, CPUState &cpu, SceUID thread_id) {
+    if (!is_import_profiling()) {
+        fn(emuenv, cpu, thread_id);
+        return;
+    }
+
+    // the host time includes the time the guest thread was blocked in the import
+    const auto start = ImportProfileClock::now();
+    fn(emuenv, cpu, thread_id);
+    record_import_call(nid, ImportProfileClock::now() - start);
+}
+
 static void log_import_call(char emulation_level, uint32_t nid, SceUID thread_id, const std::unordered_set<uint32_t> &nid_blacklist, Address lr) {
+    if (logging::is_binary_log_open()) {
+        const auto category = (emulation_level == 'H') ? logging::BinaryLogCategory::HleImportCall : logging::BinaryLogCategory::LleImportCall;
+        logging::log_binary(category, thread_id, nid, lr);
+        return;
+    }
     if (!nid_blacklist.contains(nid)) {
         const char *const name = import_name(nid);
         LOG_TRACE("[{}LE] TID: {:<3} FUNC: {} {} at {}", emulation_level, thread_id, log_hex(nid), name, log_hex(lr));
@@ -118,16 +221,16 @@ void call_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t nid, SceUID thread
             auto lr = read_lr(cpu);
             log_import_call('H', nid, thread_id, hle_nid_blacklist, lr);
         }
-        const ImportFn fn = resolve_import(nid);
+        const ImportFn fn = resolve_import(nid).fn;
         if (fn) {
-            fn(emuenv, cpu, thread_id);
+            call_hle_fn(fn, nid, emuenv, cpu, thread_id);
         } else {
-            const ThreadStatePtr thread = emuenv.kernel.get_thread(thread_id);
             // make the function return 0
-            write_reg(*thread->cpu, 0, 0);
+            write_reg(cpu, 0, 0);
 
             if (emuenv.missing_nids.count(nid) == 0 || LOG_UNK_NIDS_ALWAYS) {
-                LOG_ERROR("Import function for NID {} not found (thread name: {}, thread ID: {})", log_hex(nid), thread->name, thread_id);
+                const ThreadState *thread = get_thread_state(cpu);
+                LOG_ERROR("Import function for NID {} not found (thread name: {}, thread ID: {})", log_hex(nid), thread ? thread->name : "", thread_id);
 
                 if (!LOG_UNK_NIDS_ALWAYS)
                     emuenv.missing_nids.insert(nid);
@@ -161,6 +264,38 @@ void call_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t nid, SceUID thread
     }
 }
 
+bool call_hle_import(EmuEnvState &emuenv, CPUState &cpu, uint32_t import_index, SceUID thread_id, bool nonblocking_only) {
+    if (import_index >= hle_imports.size()) {
+        if (nonblocking_only)
+            return false;
+        LOG_ERROR("HLE import index {} is not bound (thread ID: {})", import_index, thread_id);
+        write_reg(cpu, 0, 0);
+        return true;
+    }
+
+    HleImport &import = *hle_imports[import_index];
+    const uint32_t export_nids_generation = emuenv.kernel.export_nids_generation;
+
+    // Fast path, only valid while no module exporting this NID may have been loaded since the last check
+    if (import.fn && !emuenv.kernel.debugger.watch_import_calls && import.export_nids_generation == export_nids_generation) {
+        if (nonblocking_only && !import.nonblocking)
+            return false;
+        call_hle_fn(import.fn, import.nid, emuenv, cpu, thread_id);
+        return true;
+    }
+
+    // The slow path may patch the guest code, it is only taken once the cpu has stopped
+    if (nonblocking_only)
+        return false;
+
+    // Slow path: handles tracing, LLE exports and unimplemented functions
+    const bool has_export = resolve_export(emuenv.kernel, import.nid) != 0;
+    call_import(emuenv, cpu, import.nid, thread_id);
+    if (!has_export)
+        import.export_nids_generation = export_nids_generation;
+    return true;
+}
+
 SceUID load_module(EmuEnvState &emuenv, const std::string &module_path) {
     // Check if module is already loaded
     const auto &loaded_modules = emuenv.kernel.loaded_modules;
@@ -173,19 +308,28 @@ SceUID load_module(EmuEnvState &emuenv, const std::string &module_path) {
     }
     LOG_INFO("Loading module \"{}\"", module_path);
     vfs::FileBuffer module_buffer;
+    // host file with the same content as module_buffer, load_self can map the segments from it
+    fs::path image_path;
     bool res;
     VitaIoDevice device = device::get_device(module_path);
     auto translated_module_path = translate_path(module_path.c_str(), device, emuenv.io.device_paths);
-    if (device == VitaIoDevice::app0)
+    if (device == VitaIoDevice::app0) {
         res = vfs::read_app_file(module_buffer, emuenv.pref_path.wstring(), emuenv.io.app_path, translated_module_path);
-    else
+        image_path = device::construct_emulated_path(VitaIoDevice::ux0, fs::path("app") / emuenv.io.app_path / translated_module_path, emuenv.pref_path.wstring());
+    } else if (device == VitaIoDevice::vs0 && emuenv.cfg.module_image_cache
+        && read_cached_module(emuenv, device::construct_emulated_path(device, translated_module_path, emuenv.pref_path.wstring()), module_buffer, image_path)) {
+        res = true;
+    } else {
         res = vfs::read_file(device, module_buffer, emuenv.pref_path.wstring(), translated_module_path);
+        image_path = device::construct_emulated_path(device, translated_module_path, emuenv.pref_path.wstring());
+    }
     if (!res) {
         LOG_ERROR("Failed to read module file {}", module_path);
         return SCE_ERROR_ERRNO_ENOENT;
     }
-    SceUID module_id = load_self(emuenv.kernel, emuenv.mem, module_buffer.data(), module_path, emuenv.log_path.string());
+    SceUID module_id = load_self(emuenv.kernel, emuenv.mem, module_buffer.data(), module_path, emuenv.log_path.string(), image_path.string());
     if (module_id >= 0) {
+        bind_hle_imports(emuenv.kernel);
         const auto module = emuenv.kernel.loaded_modules[module_id];
         LOG_INFO("Module {} (at \"{}\") loaded", module->module_name, module_path);
     } else {
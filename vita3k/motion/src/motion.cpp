@@ -65,6 +65,10 @@ void refresh_motion(MotionState &state, CtrlState &ctrl_state) {
     if (!ctrl_state.has_motion_support)
         return;
 
+    // the sensors are updated with the recorded data instead
+    if (ctrl_state.input_record.mode == InputRecordMode::Replay)
+        return;
+
     // make sure to use the data from only one accelerometer and gyroscope
     bool found_gyro = false;
     bool found_accel = false;
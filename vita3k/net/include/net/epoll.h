@@ -2,6 +2,9 @@
 
 #include <net/socket.h>
 
+#include <mutex>
+#include <vector>
+
 struct Epoll;
 
 typedef std::shared_ptr<Epoll> EpollPtr;
@@ -12,8 +15,23 @@ struct EpollSocket {
     abs_socket sock;
 };
 
+// The sockets are registered once to the readiness API of the host (epoll on Linux, kqueue on macOS and BSD,
+// WSAPoll on Windows) so waiting does not depend on the number of registered sockets
 struct Epoll {
+    std::mutex mutex;
     std::map<int, EpollSocket> eventEntries;
+#ifdef _WIN32
+    // poll descriptors of the registered sockets, with the id of each socket at the same index
+    std::vector<WSAPOLLFD> pollFds;
+    std::vector<int> pollIds;
+#else
+    int hostFd = -1;
+#endif
+
+    Epoll();
+    ~Epoll();
+    Epoll(const Epoll &) = delete;
+    Epoll &operator=(const Epoll &) = delete;
 
     int add(int id, abs_socket sock, SceNetEpollEvent *ev);
     int del(int id, abs_socket sock, SceNetEpollEvent *ev);
@@ -0,0 +1,101 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <net/reactor.h>
+#include <net/socket.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// udp port used by the P2P sockets bound without a port
+constexpr uint16_t P2P_DEFAULT_PORT = 3658;
+
+struct P2PDatagram {
+    sockaddr_in addr;
+    // virtual port of the sending socket
+    uint16_t vport;
+    std::vector<char> data;
+};
+
+// The P2P sockets bound to the same udp port share one host socket. Each datagram starts with the virtual ports
+// of its source and destination so it can be given to the right socket. Sends are queued and flushed together
+// on the reactor thread, and receives read all the datagrams available at once, with sendmmsg/recvmmsg where available.
+class P2PTransport : public std::enable_shared_from_this<P2PTransport> {
+public:
+    P2PTransport(abs_socket sock, uint16_t port, SocketReactor &reactor);
+    ~P2PTransport();
+    P2PTransport(const P2PTransport &) = delete;
+    P2PTransport &operator=(const P2PTransport &) = delete;
+
+    abs_socket get_socket() const {
+        return sock;
+    }
+    uint16_t get_port() const {
+        return port;
+    }
+
+    // a virtual port of 0 is replaced by a free one, returns false if the virtual port is already used
+    bool bind_vport(uint16_t &vport);
+    void unbind_vport(uint16_t vport);
+
+    int send(uint16_t vport, const SceNetSockaddrIn &to, const void *data, unsigned int len);
+    int receive(uint16_t vport, void *buf, unsigned int len, SceNetSockaddrIn *from);
+    void flush();
+
+private:
+    struct PendingSend {
+        sockaddr_in addr;
+        std::vector<char> packet;
+    };
+
+    void flush_locked();
+    void schedule_flush();
+    void receive_batch();
+
+    abs_socket sock;
+    uint16_t port;
+    SocketReactor &reactor;
+
+    std::mutex mutex;
+    std::map<uint16_t, std::deque<P2PDatagram>> queues;
+    std::vector<PendingSend> pending;
+    bool flush_scheduled = false;
+    // receive buffers, allocated on the first receive
+    std::vector<std::vector<char>> buffers;
+};
+
+typedef std::shared_ptr<P2PTransport> P2PTransportPtr;
+
+// Transports of the udp ports used by P2P sockets, a transport lives as long as a socket is bound to it
+struct P2PTransports {
+    explicit P2PTransports(SocketReactor &reactor)
+        : reactor(reactor) {}
+
+    // Returns the transport of the port, creating its host socket if needed
+    P2PTransportPtr get(uint16_t port, int &error);
+
+private:
+    SocketReactor &reactor;
+    std::mutex mutex;
+    std::map<uint16_t, std::weak_ptr<P2PTransport>> transports;
+};
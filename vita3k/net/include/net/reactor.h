@@ -0,0 +1,66 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <net/socket.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// Called once, with true if the socket is ready or its waits were cancelled, and false on timeout or shutdown
+typedef std::function<void(bool)> SocketReadyCallback;
+
+// A single host thread waits for the readiness of the sockets some guest thread is waiting on,
+// so the host sockets can stay non-blocking and an idle socket does not hold any host thread
+class SocketReactor {
+public:
+    SocketReactor() = default;
+    ~SocketReactor();
+    SocketReactor(const SocketReactor &) = delete;
+    SocketReactor &operator=(const SocketReactor &) = delete;
+
+    // events are SCE_NET_EPOLLIN and/or SCE_NET_EPOLLOUT, a negative timeout waits until the socket is ready
+    void wait(abs_socket sock, unsigned int events, int timeout_microseconds, SocketReadyCallback callback);
+    // cancels all the waits on a socket once it is closed, so their calls fail instead of waiting forever
+    void cancel(abs_socket sock);
+
+private:
+    struct Waiter {
+        abs_socket sock;
+        unsigned int events;
+        bool has_deadline;
+        std::chrono::steady_clock::time_point deadline;
+        SocketReadyCallback callback;
+    };
+
+    void start();
+    void notify();
+    void run();
+
+    std::mutex mutex;
+    // the waiters are identified so they can be matched again once the poll they were part of is over
+    std::map<uint64_t, Waiter> waiters;
+    uint64_t next_waiter_id = 0;
+    std::thread thread;
+    bool stopping = false;
+    // loopback udp socket connected to itself, a datagram sent to it interrupts the poll
+    abs_socket wakeup_sock = static_cast<abs_socket>(-1);
+};
@@ -20,6 +20,7 @@
 #include <net/types.h>
 
 #include <map>
+#include <memory>
 
 #ifdef WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -42,15 +43,39 @@ typedef int socklen_t;
 typedef int abs_socket;
 #endif
 
+constexpr abs_socket INVALID_HOST_SOCKET = static_cast<abs_socket>(-1);
+
+// Translates a negative return value of a host socket call to the SceNet error of the last failed call
+int translate_return_value(int retval);
+
 struct Socket;
 
 typedef std::shared_ptr<Socket> SocketPtr;
 
 struct Socket {
+    int sockopt_so_nbio = 0;
+    // in microseconds, 0 waits until the socket is ready
+    int sockopt_so_sndtimeo = 0;
+    int sockopt_so_rcvtimeo = 0;
+
     explicit Socket(int domain, int type, int protocol){};
 
     virtual ~Socket() = default;
 
+    // whether a call with these flags has to wait until the socket is ready
+    bool is_blocking(int flags) const {
+        return (sockopt_so_nbio == 0) && !(flags & SCE_NET_MSG_DONTWAIT);
+    }
+    // timeout in microseconds of a wait for these events, negative if it waits until the socket is ready
+    int get_timeout(unsigned int events) const {
+        const int timeout = (events & SCE_NET_EPOLLOUT) ? sockopt_so_sndtimeo : sockopt_so_rcvtimeo;
+        return (timeout > 0) ? timeout : -1;
+    }
+    // host socket whose readiness a blocking call waits for before trying again
+    virtual abs_socket get_wait_socket() const {
+        return INVALID_HOST_SOCKET;
+    }
+
     virtual int close() = 0;
     virtual int bind(const SceNetSockaddr *addr, unsigned int addrlen) = 0;
     virtual int send_packet(const void *msg, unsigned int len, int flags, const SceNetSockaddr *to, unsigned int tolen) = 0;
@@ -64,6 +89,7 @@ struct Socket {
 };
 
 // udp, tcp
+// The host socket is always non-blocking, the blocking calls of the guest are done by waiting for the socket to be ready
 struct PosixSocket : public Socket {
     abs_socket sock;
 
@@ -72,18 +98,30 @@ struct PosixSocket : public Socket {
     int sockopt_so_usecrypto = 0;
     int sockopt_so_usesignature = 0;
     int sockopt_so_tppolicy = 0;
-    int sockopt_so_nbio = 0;
     int sockopt_ip_ttlchk = 0;
     int sockopt_ip_maxttl = 0;
     int sockopt_tcp_mss_to_advertise = 0;
 
     explicit PosixSocket(int domain, int type, int protocol)
         : Socket(domain, type, protocol)
-        , sock(socket(domain, type, protocol)){};
+        , sock(socket(domain, type, protocol)) {
+        set_host_non_blocking();
+    };
 
     explicit PosixSocket(abs_socket sock)
         : Socket(0, 0, 0)
-        , sock(sock){};
+        , sock(sock) {
+        set_host_non_blocking();
+    };
+
+    void set_host_non_blocking();
+    abs_socket get_wait_socket() const override {
+        return sock;
+    }
+    // whether the last failed call on this thread failed only because the socket was not ready
+    static bool last_call_would_block();
+    // result of a non-blocking connect once the socket is ready for writing
+    int get_connect_result();
 
     int close() override;
     int bind(const SceNetSockaddr *addr, unsigned int addrlen) override;
@@ -97,9 +135,24 @@ struct PosixSocket : public Socket {
     int get_socket_address(SceNetSockaddr *name, unsigned int *namelen) override;
 };
 
+class P2PTransport;
+struct P2PTransports;
+
+// Datagram sockets addressed by udp port and virtual port, sent over the transport of their udp port
 struct P2PSocket : public Socket {
-    explicit P2PSocket(int domain, int type, int protocol)
-        : Socket(domain, type, protocol){};
+    P2PTransports &transports;
+    std::shared_ptr<P2PTransport> transport;
+    uint16_t vport = 0;
+    // destination of the sends without address, set by connect
+    bool has_peer = false;
+    SceNetSockaddrIn peer{};
+
+    explicit P2PSocket(int domain, int type, int protocol, P2PTransports &transports)
+        : Socket(domain, type, protocol)
+        , transports(transports){};
+    ~P2PSocket() override;
+
+    abs_socket get_wait_socket() const override;
 
     int close() override;
     int bind(const SceNetSockaddr *addr, unsigned int addrlen) override;
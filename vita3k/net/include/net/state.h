@@ -18,6 +18,8 @@
 #pragma once
 
 #include <net/epoll.h>
+#include <net/p2p.h>
+#include <net/reactor.h>
 #include <net/socket.h>
 #include <net/types.h>
 
@@ -36,6 +38,8 @@ struct NetState {
     NetEpolls epolls;
     int state = -1;
     int resolver_id = 0;
+    SocketReactor reactor;
+    P2PTransports p2p{ reactor };
 };
 
 struct NetCtlState {
@@ -79,6 +79,10 @@ enum SceNetSocketOption : uint32_t {
     SCE_NET_SO_NAME = 0x1102
 };
 
+enum SceNetMsgFlag : uint32_t {
+    SCE_NET_MSG_DONTWAIT = 0x80
+};
+
 enum SceNetKernelErrorCode {
     SCE_NET_EPERM = 1,
     SCE_NET_ENOENT = 2,
@@ -1,89 +1,332 @@
 #include <net/epoll.h>
 
+#include <util/log.h>
+
+#ifdef _WIN32
+#include <chrono>
+#include <thread>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#define USE_KQUEUE
+#include <sys/event.h>
+#include <sys/time.h>
+#else
+#include <sys/epoll.h>
+#endif
+
+#ifdef _WIN32
+
+Epoll::Epoll() = default;
+
+Epoll::~Epoll() = default;
+
+static SHORT to_host_events(unsigned int events) {
+    SHORT hostEvents = 0;
+    if (events & SCE_NET_EPOLLIN)
+        hostEvents |= POLLRDNORM;
+    if (events & SCE_NET_EPOLLOUT)
+        hostEvents |= POLLWRNORM;
+    // errors are always reported by WSAPoll
+    return hostEvents;
+}
+
+static unsigned int from_host_events(SHORT hostEvents) {
+    unsigned int events = 0;
+    if (hostEvents & (POLLRDNORM | POLLHUP))
+        events |= SCE_NET_EPOLLIN;
+    if (hostEvents & POLLWRNORM)
+        events |= SCE_NET_EPOLLOUT;
+    if (hostEvents & (POLLERR | POLLHUP | POLLNVAL))
+        events |= SCE_NET_EPOLLERR;
+    return events;
+}
+
+static bool register_socket(Epoll &epoll, int id, const EpollSocket &entry) {
+    epoll.pollFds.push_back({ entry.sock, to_host_events(entry.events), 0 });
+    epoll.pollIds.push_back(id);
+    return true;
+}
+
+static bool modify_socket(Epoll &epoll, int id, const EpollSocket &entry, unsigned int oldEvents) {
+    for (size_t i = 0; i < epoll.pollIds.size(); i++) {
+        if (epoll.pollIds[i] == id)
+            epoll.pollFds[i].events = to_host_events(entry.events);
+    }
+    return true;
+}
+
+static void unregister_socket(Epoll &epoll, int id, const EpollSocket &entry) {
+    for (size_t i = 0; i < epoll.pollIds.size(); i++) {
+        if (epoll.pollIds[i] != id)
+            continue;
+        epoll.pollFds[i] = epoll.pollFds.back();
+        epoll.pollIds[i] = epoll.pollIds.back();
+        epoll.pollFds.pop_back();
+        epoll.pollIds.pop_back();
+        return;
+    }
+}
+
+#elif defined(USE_KQUEUE)
+
+Epoll::Epoll() {
+    hostFd = kqueue();
+    if (hostFd < 0)
+        LOG_ERROR("Failed to create kqueue, errno: {}", errno);
+}
+
+Epoll::~Epoll() {
+    if (hostFd >= 0)
+        ::close(hostFd);
+}
+
+// read and write readiness are separate filters, only the filters whose state changes are updated
+static bool update_filters(Epoll &epoll, int id, abs_socket sock, unsigned int oldEvents, unsigned int newEvents) {
+    struct kevent changes[2];
+    int changeCount = 0;
+    const auto update = [&](int16_t filter, unsigned int event) {
+        if ((oldEvents & event) == (newEvents & event))
+            return;
+        const uint16_t flags = (newEvents & event) ? EV_ADD : EV_DELETE;
+        EV_SET(&changes[changeCount++], sock, filter, flags, 0, 0, reinterpret_cast<void *>(static_cast<intptr_t>(id)));
+    };
+    update(EVFILT_READ, SCE_NET_EPOLLIN);
+    update(EVFILT_WRITE, SCE_NET_EPOLLOUT);
+
+    if (changeCount == 0)
+        return true;
+    // a closed socket has already lost its filters, it can be ignored when deleting them
+    return (kevent(epoll.hostFd, changes, changeCount, nullptr, 0, nullptr) == 0) || (newEvents == 0);
+}
+
+static bool register_socket(Epoll &epoll, int id, const EpollSocket &entry) {
+    return update_filters(epoll, id, entry.sock, 0, entry.events);
+}
+
+static bool modify_socket(Epoll &epoll, int id, const EpollSocket &entry, unsigned int oldEvents) {
+    return update_filters(epoll, id, entry.sock, oldEvents, entry.events);
+}
+
+static void unregister_socket(Epoll &epoll, int id, const EpollSocket &entry) {
+    update_filters(epoll, id, entry.sock, entry.events, 0);
+}
+
+#else
+
+Epoll::Epoll() {
+    hostFd = epoll_create1(EPOLL_CLOEXEC);
+    if (hostFd < 0)
+        LOG_ERROR("Failed to create epoll instance, errno: {}", errno);
+}
+
+Epoll::~Epoll() {
+    if (hostFd >= 0)
+        ::close(hostFd);
+}
+
+static uint32_t to_host_events(unsigned int events) {
+    uint32_t hostEvents = 0;
+    if (events & SCE_NET_EPOLLIN)
+        hostEvents |= EPOLLIN;
+    if (events & SCE_NET_EPOLLOUT)
+        hostEvents |= EPOLLOUT;
+    // errors and hangups are always reported, out of band data is reported as an error like it was with select
+    if (events & SCE_NET_EPOLLERR)
+        hostEvents |= EPOLLPRI;
+    return hostEvents;
+}
+
+static unsigned int from_host_events(uint32_t hostEvents) {
+    unsigned int events = 0;
+    if (hostEvents & (EPOLLIN | EPOLLHUP))
+        events |= SCE_NET_EPOLLIN;
+    if (hostEvents & EPOLLOUT)
+        events |= SCE_NET_EPOLLOUT;
+    if (hostEvents & (EPOLLERR | EPOLLPRI))
+        events |= SCE_NET_EPOLLERR;
+    return events;
+}
+
+static bool control_socket(Epoll &epoll, int op, int id, const EpollSocket &entry) {
+    epoll_event event{};
+    event.events = to_host_events(entry.events);
+    event.data.fd = id;
+    return epoll_ctl(epoll.hostFd, op, entry.sock, &event) == 0;
+}
+
+static bool register_socket(Epoll &epoll, int id, const EpollSocket &entry) {
+    return control_socket(epoll, EPOLL_CTL_ADD, id, entry);
+}
+
+static bool modify_socket(Epoll &epoll, int id, const EpollSocket &entry, unsigned int oldEvents) {
+    return control_socket(epoll, EPOLL_CTL_MOD, id, entry);
+}
+
+static void unregister_socket(Epoll &epoll, int id, const EpollSocket &entry) {
+    // a closed socket has already been removed from the epoll instance
+    control_socket(epoll, EPOLL_CTL_DEL, id, entry);
+}
+
+#endif
+
 int Epoll::add(int id, abs_socket sock, SceNetEpollEvent *ev) {
-    if (!eventEntries.try_emplace(id, EpollSocket{ ev->events, ev->data, sock }).second) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto [it, inserted] = eventEntries.try_emplace(id, EpollSocket{ ev->events, ev->data, sock });
+    if (!inserted) {
         return SCE_NET_ERROR_EEXIST;
     }
 
+    if (!register_socket(*this, id, it->second)) {
+        eventEntries.erase(it);
+        return SCE_NET_ERROR_EBADF;
+    }
+
     return 0;
 }
 
 int Epoll::del(int id, abs_socket sock, SceNetEpollEvent *ev) {
-    if (eventEntries.erase(id) == 0) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto it = eventEntries.find(id);
+    if (it == eventEntries.end()) {
         return SCE_NET_ERROR_ENOENT;
     }
 
+    unregister_socket(*this, id, it->second);
+    eventEntries.erase(it);
     return 0;
 }
 
 int Epoll::mod(int id, abs_socket sock, SceNetEpollEvent *ev) {
+    const std::lock_guard<std::mutex> lock(mutex);
     auto it = eventEntries.find(id);
     if (it == eventEntries.end()) {
         return SCE_NET_ERROR_ENOENT;
     }
 
+    const unsigned int oldEvents = it->second.events;
     it->second.events = ev->events;
     it->second.data = ev->data;
+    if (!modify_socket(*this, id, it->second, oldEvents)) {
+        return SCE_NET_ERROR_EBADF;
+    }
+
     return 0;
 }
 
-static void add_event_fd_set(fd_set *set, int *maxFd, abs_socket sock) {
-    FD_SET(sock, set);
-#ifndef _WIN32
-    if (sock > *maxFd) {
-        *maxFd = sock;
+// the timeout is in microseconds, a negative timeout waits until an event happens
+int Epoll::wait(SceNetEpollEvent *events, int maxevents, int timeout_microseconds) {
+    if (maxevents <= 0) {
+        return SCE_NET_ERROR_EINVAL;
     }
-#endif
-}
 
-int Epoll::wait(SceNetEpollEvent *events, int maxevents, int timeout_microseconds) {
-    fd_set readFds, writeFds, exceptFds;
-    FD_ZERO(&readFds);
-    FD_ZERO(&writeFds);
-    FD_ZERO(&exceptFds);
-    int maxFd = 0;
-
-    for (auto &pair : eventEntries) {
-        if (pair.second.events & SCE_NET_EPOLLIN) {
-            add_event_fd_set(&readFds, &maxFd, pair.second.sock);
-        }
-        if (pair.second.events & SCE_NET_EPOLLOUT) {
-            add_event_fd_set(&writeFds, &maxFd, pair.second.sock);
-        }
-        if (pair.second.events & SCE_NET_EPOLLERR) {
-            add_event_fd_set(&exceptFds, &maxFd, pair.second.sock);
-        }
+    // the registrations can change while waiting, so the host events are only matched to them once the wait is over
+#ifdef _WIN32
+    std::vector<WSAPOLLFD> fds;
+    std::vector<int> ids;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        fds = pollFds;
+        ids = pollIds;
     }
 
-    timeval timeout;
-    timeout.tv_sec = timeout_microseconds / 1000000;
-    timeout.tv_usec = timeout_microseconds % 1000000;
-    auto ret = select(maxFd + 1, &readFds, &writeFds, &exceptFds, &timeout);
+    if (fds.empty()) {
+        // WSAPoll fails without any socket
+        if (timeout_microseconds > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(timeout_microseconds));
+        return 0;
+    }
+
+    const int timeout_ms = (timeout_microseconds < 0) ? -1 : (timeout_microseconds + 999) / 1000;
+    const int ret = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeout_ms);
     if (ret < 0) {
         // TODO: translate error code
         return -1;
     }
 
+    const std::lock_guard<std::mutex> lock(mutex);
     int eventCount = 0;
-    for (auto &pair : eventEntries) {
-        unsigned int eventTypes = 0;
-        if (FD_ISSET(pair.second.sock, &readFds)) {
-            eventTypes |= SCE_NET_EPOLLIN;
-        }
-        if (FD_ISSET(pair.second.sock, &writeFds)) {
-            eventTypes |= SCE_NET_EPOLLOUT;
-        }
-        if (FD_ISSET(pair.second.sock, &exceptFds)) {
+    for (size_t i = 0; (i < fds.size()) && (eventCount < maxevents); i++) {
+        if (fds[i].revents == 0)
+            continue;
+        const auto it = eventEntries.find(ids[i]);
+        if (it == eventEntries.end())
+            continue;
+        const unsigned int eventTypes = from_host_events(fds[i].revents) & (it->second.events | SCE_NET_EPOLLERR);
+        if (eventTypes == 0)
+            continue;
+
+        events[eventCount].events = eventTypes;
+        events[eventCount].data = it->second.data;
+        eventCount++;
+    }
+
+    return eventCount;
+#elif defined(USE_KQUEUE)
+    // each socket can be reported once by each of its filters
+    std::vector<struct kevent> hostEvents(static_cast<size_t>(maxevents) * 2);
+    timespec timeout;
+    timeout.tv_sec = timeout_microseconds / 1000000;
+    timeout.tv_nsec = (timeout_microseconds % 1000000) * 1000;
+    const int ret = kevent(hostFd, nullptr, 0, hostEvents.data(), static_cast<int>(hostEvents.size()), (timeout_microseconds < 0) ? nullptr : &timeout);
+    if (ret < 0) {
+        // TODO: translate error code
+        return -1;
+    }
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    std::vector<int> eventIds;
+    for (int i = 0; i < ret; i++) {
+        const int id = static_cast<int>(reinterpret_cast<intptr_t>(hostEvents[i].udata));
+        const auto it = eventEntries.find(id);
+        if (it == eventEntries.end())
+            continue;
+
+        unsigned int eventTypes = (hostEvents[i].filter == EVFILT_READ) ? SCE_NET_EPOLLIN : SCE_NET_EPOLLOUT;
+        // the error of the socket is given with the end of file
+        if ((hostEvents[i].flags & EV_EOF) && (hostEvents[i].fflags != 0))
             eventTypes |= SCE_NET_EPOLLERR;
+        eventTypes &= it->second.events | SCE_NET_EPOLLERR;
+        if (eventTypes == 0)
+            continue;
+
+        // merge the read and write events of the same socket
+        size_t index = 0;
+        while ((index < eventIds.size()) && (eventIds[index] != id))
+            index++;
+        if (index == eventIds.size()) {
+            if (eventIds.size() == static_cast<size_t>(maxevents))
+                continue;
+            eventIds.push_back(id);
+            events[index].events = 0;
+            events[index].data = it->second.data;
         }
+        events[index].events |= eventTypes;
+    }
 
-        if (eventTypes != 0 && eventCount < maxevents) {
-            auto i = eventCount++;
+    return static_cast<int>(eventIds.size());
+#else
+    std::vector<epoll_event> hostEvents(maxevents);
+    const int timeout_ms = (timeout_microseconds < 0) ? -1 : (timeout_microseconds + 999) / 1000;
+    const int ret = epoll_wait(hostFd, hostEvents.data(), maxevents, timeout_ms);
+    if (ret < 0) {
+        // TODO: translate error code
+        return -1;
+    }
 
-            events[i].events = eventTypes;
-            events[i].data = pair.second.data;
-        }
+    const std::lock_guard<std::mutex> lock(mutex);
+    int eventCount = 0;
+    for (int i = 0; i < ret; i++) {
+        const auto it = eventEntries.find(hostEvents[i].data.fd);
+        if (it == eventEntries.end())
+            continue;
+        const unsigned int eventTypes = from_host_events(hostEvents[i].events) & (it->second.events | SCE_NET_EPOLLERR);
+        if (eventTypes == 0)
+            continue;
+
+        events[eventCount].events = eventTypes;
+        events[eventCount].data = it->second.data;
+        eventCount++;
     }
 
     return eventCount;
+#endif
 }
@@ -15,9 +15,25 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <net/p2p.h>
 #include <net/socket.h>
 
+#include <algorithm>
+#include <cstring>
+
+P2PSocket::~P2PSocket() {
+    close();
+}
+
+abs_socket P2PSocket::get_wait_socket() const {
+    return transport ? transport->get_socket() : INVALID_HOST_SOCKET;
+}
+
 int P2PSocket::close() {
+    if (transport) {
+        transport->unbind_vport(vport);
+        transport.reset();
+    }
     return 0;
 }
 
@@ -30,29 +46,121 @@ SocketPtr P2PSocket::accept(SceNetSockaddr *addr, unsigned int *addrlen) {
 }
 
 int P2PSocket::connect(const SceNetSockaddr *addr, unsigned int namelen) {
+    if (addr == nullptr || namelen < sizeof(SceNetSockaddrIn)) {
+        return SCE_NET_ERROR_EINVAL;
+    }
+    memcpy(&peer, addr, sizeof(peer));
+    has_peer = true;
     return 0;
 }
 
+#define CASE_P2P_SOCKOPT(opt, value)     \
+    case opt:                            \
+        if (optlen != sizeof(value)) {   \
+            return SCE_NET_ERROR_EFAULT; \
+        }                                \
+        memcpy(&value, optval, optlen);  \
+        return 0;
+
 int P2PSocket::set_socket_options(int level, int optname, const void *optval, unsigned int optlen) {
+    if (level == SCE_NET_SOL_SOCKET) {
+        switch (optname) {
+            CASE_P2P_SOCKOPT(SCE_NET_SO_NBIO, sockopt_so_nbio);
+            CASE_P2P_SOCKOPT(SCE_NET_SO_SNDTIMEO, sockopt_so_sndtimeo);
+            CASE_P2P_SOCKOPT(SCE_NET_SO_RCVTIMEO, sockopt_so_rcvtimeo);
+        }
+    }
     return 0;
 }
 
+#define CASE_P2P_GETSOCKOPT(opt, value)        \
+    case opt:                                  \
+        if (*optlen < sizeof(value)) {         \
+            *optlen = sizeof(value);           \
+            return SCE_NET_ERROR_EFAULT;       \
+        }                                      \
+        *optlen = sizeof(value);               \
+        memcpy(optval, &value, sizeof(value)); \
+        return 0;
+
 int P2PSocket::get_socket_options(int level, int optname, void *optval, unsigned int *optlen) {
+    if (level == SCE_NET_SOL_SOCKET) {
+        switch (optname) {
+            CASE_P2P_GETSOCKOPT(SCE_NET_SO_NBIO, sockopt_so_nbio);
+            CASE_P2P_GETSOCKOPT(SCE_NET_SO_SNDTIMEO, sockopt_so_sndtimeo);
+            CASE_P2P_GETSOCKOPT(SCE_NET_SO_RCVTIMEO, sockopt_so_rcvtimeo);
+        }
+    }
     return 0;
 }
 
 int P2PSocket::recv_packet(void *buf, unsigned int len, int flags, SceNetSockaddr *from, unsigned int *fromlen) {
-    return SCE_NET_ERROR_EAGAIN;
+    if (!transport) {
+        // nothing can be received before the socket is bound
+        return SCE_NET_ERROR_EAGAIN;
+    }
+    const int res = transport->receive(vport, buf, len, reinterpret_cast<SceNetSockaddrIn *>(from));
+    if (res >= 0 && from != nullptr && fromlen != nullptr) {
+        *fromlen = sizeof(SceNetSockaddrIn);
+    }
+    return res;
 }
 
 int P2PSocket::send_packet(const void *msg, unsigned int len, int flags, const SceNetSockaddr *to, unsigned int tolen) {
-    return 0;
+    if (to == nullptr && !has_peer) {
+        return SCE_NET_ERROR_ENOTCONN;
+    }
+    if (!transport) {
+        // like udp, sending binds the socket to a free virtual port of the default port
+        SceNetSockaddrIn addr{};
+        addr.sin_len = sizeof(addr);
+        addr.sin_family = AF_INET;
+        const int res = bind(reinterpret_cast<const SceNetSockaddr *>(&addr), sizeof(addr));
+        if (res < 0) {
+            return res;
+        }
+    }
+    const SceNetSockaddrIn &to_in = to ? *reinterpret_cast<const SceNetSockaddrIn *>(to) : peer;
+    return transport->send(vport, to_in, msg, len);
 }
 
 int P2PSocket::bind(const SceNetSockaddr *addr, unsigned int addrlen) {
+    if (addr == nullptr || addrlen < sizeof(SceNetSockaddrIn)) {
+        return SCE_NET_ERROR_EINVAL;
+    }
+    if (transport) {
+        return SCE_NET_ERROR_EINVAL;
+    }
+
+    const SceNetSockaddrIn *addr_in = reinterpret_cast<const SceNetSockaddrIn *>(addr);
+    const uint16_t port = addr_in->sin_port ? ntohs(addr_in->sin_port) : P2P_DEFAULT_PORT;
+    int error = 0;
+    auto new_transport = transports.get(port, error);
+    if (!new_transport) {
+        return error;
+    }
+
+    uint16_t new_vport = ntohs(addr_in->sin_vport);
+    if (!new_transport->bind_vport(new_vport)) {
+        return SCE_NET_ERROR_EADDRINUSE;
+    }
+    transport = std::move(new_transport);
+    vport = new_vport;
     return 0;
 }
 
 int P2PSocket::get_socket_address(SceNetSockaddr *name, unsigned int *namelen) {
+    if (name == nullptr || namelen == nullptr) {
+        return SCE_NET_ERROR_EINVAL;
+    }
+    SceNetSockaddrIn addr{};
+    addr.sin_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    if (transport) {
+        addr.sin_port = htons(transport->get_port());
+        addr.sin_vport = htons(vport);
+    }
+    memcpy(name, &addr, std::min<unsigned int>(*namelen, sizeof(addr)));
+    *namelen = sizeof(addr);
     return 0;
 }
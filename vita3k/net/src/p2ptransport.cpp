@@ -0,0 +1,292 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <net/p2p.h>
+
+#include <util/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef WIN32
+#include <mstcpip.h>
+#endif
+
+// virtual port of the source then of the destination, in network byte order
+constexpr size_t P2P_HEADER_SIZE = 4;
+// number of datagrams sent or received by a single host call
+constexpr size_t P2P_BATCH_SIZE = 32;
+// batches received at once at most, so a flood does not keep the guest thread in the transport
+constexpr size_t P2P_MAX_RECEIVE_BATCHES = 8;
+constexpr size_t P2P_MAX_DATAGRAM_SIZE = 65535;
+// datagrams kept for a virtual port until they are read, newer ones are dropped like with a full receive buffer
+constexpr size_t P2P_QUEUE_LIMIT = 256;
+// free virtual ports are looked for from this one
+constexpr uint32_t P2P_EPHEMERAL_VPORT = 0xC000;
+
+static void close_socket(abs_socket sock) {
+#ifdef WIN32
+    closesocket(sock);
+#else
+    ::close(sock);
+#endif
+}
+
+P2PTransport::P2PTransport(abs_socket sock, uint16_t port, SocketReactor &reactor)
+    : sock(sock)
+    , port(port)
+    , reactor(reactor) {}
+
+// a flush still scheduled on the reactor only holds a weak reference to the transport
+P2PTransport::~P2PTransport() {
+    flush_locked();
+    close_socket(sock);
+}
+
+bool P2PTransport::bind_vport(uint16_t &vport) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (vport == 0) {
+        for (uint32_t candidate = P2P_EPHEMERAL_VPORT; candidate <= UINT16_MAX; candidate++) {
+            if (!queues.contains(static_cast<uint16_t>(candidate))) {
+                vport = static_cast<uint16_t>(candidate);
+                break;
+            }
+        }
+        if (vport == 0)
+            return false;
+    }
+    return queues.try_emplace(vport).second;
+}
+
+void P2PTransport::unbind_vport(uint16_t vport) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    queues.erase(vport);
+}
+
+int P2PTransport::send(uint16_t vport, const SceNetSockaddrIn &to, const void *data, unsigned int len) {
+    if (len > P2P_MAX_DATAGRAM_SIZE - P2P_HEADER_SIZE)
+        return SCE_NET_ERROR_EMSGSIZE;
+
+    PendingSend send;
+    memset(&send.addr, 0, sizeof(send.addr));
+    send.addr.sin_family = AF_INET;
+    send.addr.sin_port = to.sin_port ? to.sin_port : htons(P2P_DEFAULT_PORT);
+    memcpy(&send.addr.sin_addr, &to.sin_addr, sizeof(to.sin_addr));
+
+    const uint16_t header[2] = { htons(vport), to.sin_vport };
+    send.packet.resize(P2P_HEADER_SIZE + len);
+    memcpy(send.packet.data(), header, P2P_HEADER_SIZE);
+    memcpy(send.packet.data() + P2P_HEADER_SIZE, data, len);
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(std::move(send));
+    if (pending.size() >= P2P_BATCH_SIZE)
+        flush_locked();
+    if (!pending.empty())
+        schedule_flush();
+    return static_cast<int>(len);
+}
+
+// the datagrams sent until the reactor thread gets to the flush are sent together
+void P2PTransport::schedule_flush() {
+    if (flush_scheduled)
+        return;
+    flush_scheduled = true;
+    const std::weak_ptr<P2PTransport> weak_transport = weak_from_this();
+    reactor.wait(sock, SCE_NET_EPOLLOUT, -1, [weak_transport](bool) {
+        if (const auto transport = weak_transport.lock())
+            transport->flush();
+    });
+}
+
+void P2PTransport::flush() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    flush_scheduled = false;
+    flush_locked();
+    // the send buffer of the host socket is full, the rest is sent once it can take more
+    if (!pending.empty())
+        schedule_flush();
+}
+
+void P2PTransport::flush_locked() {
+    size_t sent = 0;
+    while (sent < pending.size()) {
+#ifdef __linux__
+        mmsghdr msgs[P2P_BATCH_SIZE];
+        iovec iovs[P2P_BATCH_SIZE];
+        const size_t count = std::min(P2P_BATCH_SIZE, pending.size() - sent);
+        for (size_t i = 0; i < count; i++) {
+            PendingSend &send = pending[sent + i];
+            iovs[i].iov_base = send.packet.data();
+            iovs[i].iov_len = send.packet.size();
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &send.addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(send.addr);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int ret = sendmmsg(sock, msgs, static_cast<unsigned int>(count), 0);
+        if (ret > 0) {
+            sent += ret;
+            continue;
+        }
+#else
+        const PendingSend &send = pending[sent];
+        if (sendto(sock, send.packet.data(), static_cast<int>(send.packet.size()), 0, reinterpret_cast<const sockaddr *>(&send.addr), sizeof(send.addr)) >= 0) {
+            sent++;
+            continue;
+        }
+#endif
+        if (PosixSocket::last_call_would_block())
+            break;
+        // like with udp, a datagram which can not be sent is lost
+        LOG_WARN("Failed to send P2P datagram on port {}: {}", port, log_hex(translate_return_value(-1)));
+        sent++;
+    }
+    pending.erase(pending.begin(), pending.begin() + sent);
+}
+
+void P2PTransport::receive_batch() {
+    if (buffers.empty())
+        buffers.assign(P2P_BATCH_SIZE, std::vector<char>(P2P_MAX_DATAGRAM_SIZE));
+
+    sockaddr_in addrs[P2P_BATCH_SIZE];
+    size_t sizes[P2P_BATCH_SIZE];
+    for (size_t batch = 0; batch < P2P_MAX_RECEIVE_BATCHES; batch++) {
+        size_t count = 0;
+#ifdef __linux__
+        mmsghdr msgs[P2P_BATCH_SIZE];
+        iovec iovs[P2P_BATCH_SIZE];
+        for (size_t i = 0; i < P2P_BATCH_SIZE; i++) {
+            iovs[i].iov_base = buffers[i].data();
+            iovs[i].iov_len = buffers[i].size();
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int ret = recvmmsg(sock, msgs, P2P_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (ret > 0) {
+            count = ret;
+            for (size_t i = 0; i < count; i++)
+                sizes[i] = msgs[i].msg_len;
+        }
+#else
+        for (; count < P2P_BATCH_SIZE; count++) {
+            socklen_t addrlen = sizeof(addrs[count]);
+            const int ret = recvfrom(sock, buffers[count].data(), static_cast<int>(buffers[count].size()), 0, reinterpret_cast<sockaddr *>(&addrs[count]), &addrlen);
+            if (ret < 0)
+                break;
+            sizes[count] = ret;
+        }
+#endif
+
+        for (size_t i = 0; i < count; i++) {
+            if (sizes[i] < P2P_HEADER_SIZE)
+                continue;
+            uint16_t header[2];
+            memcpy(header, buffers[i].data(), P2P_HEADER_SIZE);
+            const auto queue = queues.find(ntohs(header[1]));
+            if ((queue == queues.end()) || (queue->second.size() >= P2P_QUEUE_LIMIT))
+                continue;
+
+            P2PDatagram &datagram = queue->second.emplace_back();
+            datagram.addr = addrs[i];
+            datagram.vport = ntohs(header[0]);
+            datagram.data.assign(buffers[i].begin() + P2P_HEADER_SIZE, buffers[i].begin() + sizes[i]);
+        }
+
+        if (count < P2P_BATCH_SIZE)
+            break;
+    }
+}
+
+int P2PTransport::receive(uint16_t vport, void *buf, unsigned int len, SceNetSockaddrIn *from) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto queue = queues.find(vport);
+    if (queue == queues.end())
+        return SCE_NET_ERROR_EBADF;
+
+    // a guest receiving is the natural end of its tick, what it sent can go now
+    if (!pending.empty())
+        flush_locked();
+    if (queue->second.empty())
+        receive_batch();
+    if (queue->second.empty())
+        return SCE_NET_ERROR_EWOULDBLOCK;
+
+    const P2PDatagram &datagram = queue->second.front();
+    const unsigned int size = std::min<unsigned int>(len, static_cast<unsigned int>(datagram.data.size()));
+    memcpy(buf, datagram.data.data(), size);
+    if (from) {
+        memset(from, 0, sizeof(*from));
+        from->sin_len = sizeof(*from);
+        from->sin_family = AF_INET;
+        from->sin_port = datagram.addr.sin_port;
+        memcpy(&from->sin_addr, &datagram.addr.sin_addr, sizeof(from->sin_addr));
+        from->sin_vport = htons(datagram.vport);
+    }
+    queue->second.pop_front();
+    return static_cast<int>(size);
+}
+
+P2PTransportPtr P2PTransports::get(uint16_t port, int &error) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto it = transports.find(port);
+    if (it != transports.end()) {
+        if (auto transport = it->second.lock())
+            return transport;
+        transports.erase(it);
+    }
+
+    const abs_socket sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_HOST_SOCKET) {
+        error = translate_return_value(-1);
+        return nullptr;
+    }
+
+    // adhoc games find each other with broadcasts
+    const int broadcast = 1;
+    setsockopt(sock, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char *>(&broadcast), sizeof(broadcast));
+#ifdef WIN32
+    // an icmp port unreachable would otherwise make the next receive fail
+    BOOL report_connection_reset = FALSE;
+    DWORD bytes_returned = 0;
+    WSAIoctl(sock, SIO_UDP_CONNRESET, &report_connection_reset, sizeof(report_connection_reset), nullptr, 0, &bytes_returned, nullptr, nullptr);
+    u_long non_blocking = 1;
+    ioctlsocket(sock, FIONBIO, &non_blocking);
+#else
+    int non_blocking = 1;
+    ioctl(sock, FIONBIO, &non_blocking);
+#endif
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) {
+        error = translate_return_value(-1);
+        LOG_ERROR("Failed to bind P2P transport on udp port {}: {}", port, log_hex(error));
+        close_socket(sock);
+        return nullptr;
+    }
+
+    auto transport = std::make_shared<P2PTransport>(sock, port, reactor);
+    transports.emplace(port, transport);
+    return transport;
+}
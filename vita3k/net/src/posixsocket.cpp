@@ -17,6 +17,7 @@
 
 #include <cstring>
 #include <net/socket.h>
+#include <util/log.h>
 
 // NOTE: This should be SCE_NET_##errname but it causes vitaQuake to softlock in online games
 #ifdef WIN32
@@ -29,7 +30,7 @@
         return SCE_NET_ERROR_##errname;
 #endif
 
-static int translate_return_value(int retval) {
+int translate_return_value(int retval) {
     if (retval < 0) {
 #ifdef WIN32
         switch (WSAGetLastError()) {
@@ -120,6 +121,40 @@ static int translate_return_value(int retval) {
     return retval;
 }
 
+void PosixSocket::set_host_non_blocking() {
+#ifdef WIN32
+    u_long non_blocking = 1;
+    if (ioctlsocket(sock, FIONBIO, &non_blocking) != 0)
+#else
+    int non_blocking = 1;
+    if (ioctl(sock, FIONBIO, &non_blocking) != 0)
+#endif
+        LOG_ERROR("Failed to make host socket {} non-blocking", sock);
+}
+
+bool PosixSocket::last_call_would_block() {
+#ifdef WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return (errno == EWOULDBLOCK) || (errno == EAGAIN);
+#endif
+}
+
+int PosixSocket::get_connect_result() {
+    int error = 0;
+    socklen_t optlen = sizeof(error);
+    if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (char *)&error, &optlen) < 0)
+        return translate_return_value(-1);
+    if (error == 0)
+        return 0;
+#ifdef WIN32
+    WSASetLastError(error);
+#else
+    errno = error;
+#endif
+    return translate_return_value(-1);
+}
+
 static void convertSceSockaddrToPosix(const struct SceNetSockaddr *src, struct sockaddr *dst) {
     if (src == nullptr || dst == nullptr)
         return;
@@ -226,8 +261,6 @@ int PosixSocket::set_socket_options(int level, int optname, const void *optval,
             CASE_SETSOCKOPT(SO_RCVBUF);
             CASE_SETSOCKOPT(SO_SNDLOWAT);
             CASE_SETSOCKOPT(SO_RCVLOWAT);
-            CASE_SETSOCKOPT(SO_SNDTIMEO);
-            CASE_SETSOCKOPT(SO_RCVTIMEO);
             CASE_SETSOCKOPT(SO_ERROR);
             CASE_SETSOCKOPT(SO_TYPE);
             CASE_SETSOCKOPT_VALUE(SCE_NET_SO_REUSEPORT, &sockopt_so_reuseport);
@@ -235,20 +268,12 @@ int PosixSocket::set_socket_options(int level, int optname, const void *optval,
             CASE_SETSOCKOPT_VALUE(SCE_NET_SO_USECRYPTO, &sockopt_so_usecrypto);
             CASE_SETSOCKOPT_VALUE(SCE_NET_SO_USESIGNATURE, &sockopt_so_usesignature);
             CASE_SETSOCKOPT_VALUE(SCE_NET_SO_TPPOLICY, &sockopt_so_tppolicy);
+            // the host socket never blocks, the guest timeouts are applied when waiting for the socket
+            CASE_SETSOCKOPT_VALUE(SCE_NET_SO_SNDTIMEO, &sockopt_so_sndtimeo);
+            CASE_SETSOCKOPT_VALUE(SCE_NET_SO_RCVTIMEO, &sockopt_so_rcvtimeo);
+            CASE_SETSOCKOPT_VALUE(SCE_NET_SO_NBIO, &sockopt_so_nbio);
         case SCE_NET_SO_NAME:
             return SCE_NET_ERROR_EINVAL; // don't support set for name
-        case SCE_NET_SO_NBIO: {
-            if (optlen != sizeof(sockopt_so_nbio)) {
-                return SCE_NET_ERROR_EFAULT;
-            }
-            memcpy(&sockopt_so_nbio, optval, optlen);
-#ifdef WIN32
-            static_assert(sizeof(u_long) == sizeof(sockopt_so_nbio), "type used for ioctlsocket value does not have the expected size");
-            return translate_return_value(ioctlsocket(sock, FIONBIO, (u_long *)&sockopt_so_nbio));
-#else
-            return translate_return_value(ioctl(sock, FIONBIO, &sockopt_so_nbio));
-#endif
-        }
         }
     } else if (level == IPPROTO_IP) {
         switch (optname) {
@@ -304,11 +329,11 @@ int PosixSocket::get_socket_options(int level, int optname, void *optval, unsign
             CASE_GETSOCKOPT(SO_RCVBUF);
             CASE_GETSOCKOPT(SO_SNDLOWAT);
             CASE_GETSOCKOPT(SO_RCVLOWAT);
-            CASE_GETSOCKOPT(SO_SNDTIMEO);
-            CASE_GETSOCKOPT(SO_RCVTIMEO);
             CASE_GETSOCKOPT(SO_ERROR);
             CASE_GETSOCKOPT(SO_TYPE);
             CASE_GETSOCKOPT_VALUE(SCE_NET_SO_NBIO, sockopt_so_nbio);
+            CASE_GETSOCKOPT_VALUE(SCE_NET_SO_SNDTIMEO, sockopt_so_sndtimeo);
+            CASE_GETSOCKOPT_VALUE(SCE_NET_SO_RCVTIMEO, sockopt_so_rcvtimeo);
             CASE_GETSOCKOPT_VALUE(SCE_NET_SO_REUSEPORT, sockopt_so_reuseport);
             CASE_GETSOCKOPT_VALUE(SCE_NET_SO_ONESBCAST, sockopt_so_onesbcast);
             CASE_GETSOCKOPT_VALUE(SCE_NET_SO_USECRYPTO, sockopt_so_usecrypto);
@@ -340,6 +365,8 @@ int PosixSocket::get_socket_options(int level, int optname, void *optval, unsign
 }
 
 int PosixSocket::recv_packet(void *buf, unsigned int len, int flags, SceNetSockaddr *from, unsigned int *fromlen) {
+    // waiting is done by the caller, the host call must never block
+    flags &= ~SCE_NET_MSG_DONTWAIT;
     if (from != nullptr) {
         struct sockaddr addr;
         int res = recvfrom(sock, (char *)buf, len, flags, &addr, (socklen_t *)fromlen);
@@ -353,6 +380,7 @@ int PosixSocket::recv_packet(void *buf, unsigned int len, int flags, SceNetSocka
 }
 
 int PosixSocket::send_packet(const void *msg, unsigned int len, int flags, const SceNetSockaddr *to, unsigned int tolen) {
+    flags &= ~SCE_NET_MSG_DONTWAIT;
     if (to != nullptr) {
         struct sockaddr addr;
         convertSceSockaddrToPosix((SceNetSockaddr *)to, &addr);
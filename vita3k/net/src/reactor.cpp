@@ -0,0 +1,236 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <net/reactor.h>
+
+#include <util/log.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollFd;
+#else
+#include <poll.h>
+typedef pollfd PollFd;
+#endif
+
+// without a wakeup socket, the new waiters are only seen once the current poll times out
+constexpr int NO_WAKEUP_POLL_TIMEOUT_MS = 10;
+
+static void close_socket(abs_socket sock) {
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    ::close(sock);
+#endif
+}
+
+static int poll_sockets(std::vector<PollFd> &fds, int timeout_ms) {
+#ifdef _WIN32
+    return WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeout_ms);
+#else
+    return poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms);
+#endif
+}
+
+static abs_socket create_wakeup_socket() {
+    abs_socket sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_HOST_SOCKET)
+        return INVALID_HOST_SOCKET;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrlen = sizeof(addr);
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    const bool non_blocking_set = ioctlsocket(sock, FIONBIO, &non_blocking) == 0;
+#else
+    int non_blocking = 1;
+    const bool non_blocking_set = ioctl(sock, FIONBIO, &non_blocking) == 0;
+#endif
+    if (!non_blocking_set
+        || (bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        || (getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &addrlen) < 0)
+        || (::connect(sock, reinterpret_cast<sockaddr *>(&addr), addrlen) < 0)) {
+        close_socket(sock);
+        return INVALID_HOST_SOCKET;
+    }
+
+    return sock;
+}
+
+SocketReactor::~SocketReactor() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable())
+            return;
+        stopping = true;
+        notify();
+    }
+    thread.join();
+    if (wakeup_sock != INVALID_HOST_SOCKET)
+        close_socket(wakeup_sock);
+}
+
+// the thread is only started once a guest thread has to wait on a socket
+void SocketReactor::start() {
+    if (thread.joinable())
+        return;
+
+    wakeup_sock = create_wakeup_socket();
+    if (wakeup_sock == INVALID_HOST_SOCKET)
+        LOG_ERROR("Failed to create the wakeup socket of the socket reactor, new waits will be delayed");
+    thread = std::thread(&SocketReactor::run, this);
+}
+
+void SocketReactor::notify() {
+    if (wakeup_sock == INVALID_HOST_SOCKET)
+        return;
+    const char byte = 0;
+    send(wakeup_sock, &byte, sizeof(byte), 0);
+}
+
+void SocketReactor::wait(abs_socket sock, unsigned int events, int timeout_microseconds, SocketReadyCallback callback) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    start();
+    Waiter waiter{ sock, events, timeout_microseconds >= 0, {}, std::move(callback) };
+    if (waiter.has_deadline)
+        waiter.deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_microseconds);
+    waiters.emplace(next_waiter_id++, std::move(waiter));
+    notify();
+}
+
+void SocketReactor::cancel(abs_socket sock) {
+    std::vector<SocketReadyCallback> cancelled;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = waiters.begin(); it != waiters.end();) {
+            if (it->second.sock == sock) {
+                cancelled.push_back(std::move(it->second.callback));
+                it = waiters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!cancelled.empty())
+            notify();
+    }
+
+    for (const auto &callback : cancelled)
+        callback(true);
+}
+
+void SocketReactor::run() {
+    std::vector<PollFd> fds;
+    std::vector<uint64_t> ids;
+    std::vector<std::pair<SocketReadyCallback, bool>> finished;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        fds.clear();
+        ids.clear();
+        if (wakeup_sock != INVALID_HOST_SOCKET)
+            fds.push_back({ wakeup_sock, POLLIN, 0 });
+
+        int timeout_ms = (wakeup_sock == INVALID_HOST_SOCKET) ? NO_WAKEUP_POLL_TIMEOUT_MS : -1;
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto &[id, waiter] : waiters) {
+            short events = 0;
+            if (waiter.events & SCE_NET_EPOLLIN)
+                events |= POLLIN;
+            if (waiter.events & SCE_NET_EPOLLOUT)
+                events |= POLLOUT;
+            fds.push_back({ waiter.sock, events, 0 });
+            ids.push_back(id);
+
+            if (waiter.has_deadline) {
+                // rounded up so the poll does not return just before the deadline
+                const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(waiter.deadline - now).count();
+                const int waiter_timeout = static_cast<int>(std::max<decltype(remaining)>(remaining, 0));
+                timeout_ms = (timeout_ms < 0) ? waiter_timeout : std::min(timeout_ms, waiter_timeout);
+            }
+        }
+
+        lock.unlock();
+        int ret = 0;
+        if (fds.empty()) {
+            // WSAPoll fails without any socket
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        } else {
+            ret = poll_sockets(fds, timeout_ms);
+        }
+        lock.lock();
+
+        if (ret < 0) {
+            LOG_ERROR("Socket reactor poll failed");
+            // a bad socket fails the whole poll on some hosts, wake its waiters so their call reports the error
+            for (auto &[id, waiter] : waiters)
+                finished.emplace_back(std::move(waiter.callback), true);
+            waiters.clear();
+        } else {
+            size_t first_waiter = 0;
+            if (wakeup_sock != INVALID_HOST_SOCKET) {
+                char buffer[64];
+                if (fds[0].revents != 0) {
+                    while (recv(wakeup_sock, buffer, sizeof(buffer), 0) > 0) {
+                    }
+                }
+                first_waiter = 1;
+            }
+
+            // waiters added or cancelled during the poll have no result or are already gone
+            for (size_t i = first_waiter; i < fds.size(); i++) {
+                if (fds[i].revents == 0)
+                    continue;
+                const auto it = waiters.find(ids[i - first_waiter]);
+                if (it == waiters.end())
+                    continue;
+                finished.emplace_back(std::move(it->second.callback), true);
+                waiters.erase(it);
+            }
+
+            const auto after = std::chrono::steady_clock::now();
+            for (auto it = waiters.begin(); it != waiters.end();) {
+                if (it->second.has_deadline && (it->second.deadline <= after)) {
+                    finished.emplace_back(std::move(it->second.callback), false);
+                    it = waiters.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        if (finished.empty())
+            continue;
+        lock.unlock();
+        for (const auto &[callback, ready] : finished)
+            callback(ready);
+        finished.clear();
+        lock.lock();
+    }
+
+    // the remaining waiters are released when the emulator stops
+    for (auto &[id, waiter] : waiters)
+        finished.emplace_back(std::move(waiter.callback), false);
+    waiters.clear();
+    lock.unlock();
+    for (const auto &[callback, ready] : finished)
+        callback(ready);
+}
@@ -0,0 +1,131 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Compares the vectorized NGS mixing kernels with their scalar versions and reports JSON on stdout.
+// Usage: ngs-benchmark [iterations] [granularity]
+
+#include <ngs/mix.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// the vectorized mix does not add the products in the same order as the scalar one
+static constexpr float MAX_MIX_ERROR = 1e-6f;
+
+struct KernelResult {
+    double basic_us = 0;
+    double simd_us = 0;
+    double max_error = 0;
+};
+
+template <typename F>
+static double time_us(uint32_t iterations, F &&func) {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    for (uint32_t i = 0; i < iterations; i++)
+        func();
+    return std::chrono::duration<double, std::micro>(clock::now() - start).count() / iterations;
+}
+
+static KernelResult run_mix(const std::vector<float> &src, uint32_t nb_frames, uint32_t iterations) {
+    // a patch volume matrix with some cross feed and a gain high enough to reach the clamp
+    const float matrix[2][2] = { { 0.8f, 0.3f }, { 0.25f, 1.2f } };
+    std::vector<float> basic(nb_frames * 2, 0.0f);
+    std::vector<float> simd(nb_frames * 2, 0.0f);
+
+    KernelResult result;
+    result.basic_us = time_us(iterations, [&] { ngs::mix_stereo_basic(basic.data(), src.data(), nb_frames, matrix); });
+    result.simd_us = time_us(iterations, [&] { ngs::mix_stereo(simd.data(), src.data(), nb_frames, matrix); });
+
+    // compare a single mix into the same destination, the rounding differences would add up over the iterations
+    std::reverse_copy(src.begin(), src.end(), basic.begin());
+    std::reverse_copy(src.begin(), src.end(), simd.begin());
+    ngs::mix_stereo_basic(basic.data(), src.data(), nb_frames, matrix);
+    ngs::mix_stereo(simd.data(), src.data(), nb_frames, matrix);
+    for (size_t i = 0; i < basic.size(); i++)
+        result.max_error = std::max<double>(result.max_error, std::abs(basic[i] - simd[i]));
+    return result;
+}
+
+static KernelResult run_mix_mono(const std::vector<float> &src, uint32_t nb_frames, uint32_t iterations) {
+    std::vector<float> basic(nb_frames * 2, 0.0f);
+    std::vector<float> simd(nb_frames * 2, 0.0f);
+
+    KernelResult result;
+    result.basic_us = time_us(iterations, [&] { ngs::mix_mono_to_stereo_basic(basic.data(), src.data(), nb_frames, 0.7f, 0.4f); });
+    result.simd_us = time_us(iterations, [&] { ngs::mix_mono_to_stereo(simd.data(), src.data(), nb_frames, 0.7f, 0.4f); });
+
+    std::fill(basic.begin(), basic.end(), 0.0f);
+    std::fill(simd.begin(), simd.end(), 0.0f);
+    ngs::mix_mono_to_stereo_basic(basic.data(), src.data(), nb_frames, 0.7f, 0.4f);
+    ngs::mix_mono_to_stereo(simd.data(), src.data(), nb_frames, 0.7f, 0.4f);
+    for (size_t i = 0; i < basic.size(); i++)
+        result.max_error = std::max<double>(result.max_error, std::abs(basic[i] - simd[i]));
+    return result;
+}
+
+static KernelResult run_convert(const std::vector<float> &src, uint32_t iterations) {
+    std::vector<int16_t> basic(src.size());
+    std::vector<int16_t> simd(src.size());
+
+    KernelResult result;
+    result.basic_us = time_us(iterations, [&] { ngs::convert_f32_to_s16_basic(basic.data(), src.data(), src.size()); });
+    result.simd_us = time_us(iterations, [&] { ngs::convert_f32_to_s16(simd.data(), src.data(), src.size()); });
+
+    for (size_t i = 0; i < basic.size(); i++)
+        result.max_error = std::max<double>(result.max_error, std::abs(basic[i] - simd[i]));
+    return result;
+}
+
+static std::string to_json(const char *name, const KernelResult &result) {
+    return fmt::format(R"({{"kernel":"{}","basic_us":{:.3f},"simd_us":{:.3f},"speedup":{:.2f},"max_error":{}}})",
+        name, result.basic_us, result.simd_us, result.simd_us > 0 ? result.basic_us / result.simd_us : 0.0, result.max_error);
+}
+
+int main(int argc, char *argv[]) {
+    const uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 10000;
+    // 512 is the granularity most games use, an odd one also runs the scalar tails
+    const uint32_t granularity = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 512;
+    if (iterations == 0 || granularity == 0) {
+        fmt::print(stderr, "Usage: ngs-benchmark [iterations] [granularity]\n");
+        return 1;
+    }
+
+    // samples slightly out of [-1, 1] like the ones a patch can deliver
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+    std::vector<float> src(granularity * 2);
+    std::generate(src.begin(), src.end(), [&] { return dist(rng); });
+
+    const KernelResult mix = run_mix(src, granularity, iterations);
+    const KernelResult mix_mono = run_mix_mono(src, granularity, iterations);
+    const KernelResult convert = run_convert(src, iterations);
+    // the conversion truncates exactly like the scalar version
+    const bool success = mix.max_error <= MAX_MIX_ERROR && mix_mono.max_error <= MAX_MIX_ERROR && convert.max_error == 0;
+
+    fmt::print(R"({{"iterations":{},"granularity":{},"success":{},"kernels":[{},{},{}]}})"
+               "\n",
+        iterations, granularity, success, to_json("mix_stereo", mix), to_json("mix_mono_to_stereo", mix_mono), to_json("convert_f32_to_s16", convert));
+    return success ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ngs {
+// Add the interleaved stereo frames of src to dest through a 2x2 volume matrix (matrix[source channel][dest channel]),
+// the result is clamped to [-1, 1]
+void mix_stereo(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]);
+// Add the mono samples of src to the interleaved stereo frames of dest with the given volumes, without clamping
+void mix_mono_to_stereo(float *dest, const float *src, size_t nb_frames, float left, float right);
+// Convert floats in [-1, 1] to s16
+void convert_f32_to_s16(int16_t *dest, const float *src, size_t count);
+
+// scalar versions, used for the tails and by the benchmark as a reference
+void mix_stereo_basic(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]);
+void mix_mono_to_stereo_basic(float *dest, const float *src, size_t nb_frames, float left, float right);
+void convert_f32_to_s16_basic(int16_t *dest, const float *src, size_t count);
+} // namespace ngs
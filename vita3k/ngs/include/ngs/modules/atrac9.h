@@ -82,17 +82,21 @@ private:
     std::vector<uint8_t> temp_buffer;
     SceNgsAT9States *last_state = nullptr;
 
-    static SwrContext *swr_mono_to_stereo;
-    static SwrContext *swr_stereo;
+    // owned by the module so racks can be processed on different threads
+    SwrContext *swr_mono_to_stereo = nullptr;
+    SwrContext *swr_stereo = nullptr;
 
     // return false if data could not be decoded (error or no more data available)
     bool decode_more_data(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, const SceNgsAT9Params *params, SceNgsAT9States *state, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock);
 
 public:
+    ~Atrac9Module() override;
+
     bool process(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) override;
     uint32_t module_id() const override { return 0x5CAA; }
     void on_state_change(const MemState &mem, ModuleData &v, const VoiceState previous) override;
     void on_param_change(const MemState &mem, ModuleData &data) override;
+    bool needs_guest_thread(const MemState &mem, ModuleData &data) override;
 
     static constexpr uint32_t get_max_parameter_size() {
         return sizeof(SceNgsAT9Params);
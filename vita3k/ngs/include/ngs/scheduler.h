@@ -20,10 +20,13 @@
 #include <util/types.h>
 
 #include <mem/ptr.h>
+#include <threads/queue.h>
 
 #include <thread>
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <optional>
 #include <queue>
 #include <vector>
@@ -59,6 +62,28 @@ struct OperationPending {
     };
 };
 
+struct VoiceProcessResult {
+    bool finished = false;
+    uint32_t finished_module = 0;
+};
+
+// voices of the same level of the patch graph, processed by the update thread and the workers together
+struct VoiceBatch {
+    KernelState *kern;
+    const MemState *mem;
+    SceUID thread_id;
+
+    // the voices are grouped by rack, each group is processed in order by a single thread
+    std::vector<Voice *> voices;
+    std::vector<size_t> group_ends;
+    std::vector<VoiceProcessResult> results;
+    // next group to process
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> done = 0;
+
+    void work();
+};
+
 struct VoiceScheduler {
     std::vector<Voice *> queue;
     std::queue<OperationPending> operations_pending;
@@ -67,7 +92,15 @@ struct VoiceScheduler {
     std::condition_variable_any condvar;
     bool is_updating = false;
 
+    ~VoiceScheduler();
+
 protected:
+    Queue<std::shared_ptr<VoiceBatch>> batch_queue;
+    std::vector<std::thread> workers;
+
+    void worker_thread();
+    void run_batch(const std::shared_ptr<VoiceBatch> &batch);
+
     void deque_insert(const MemState &mem, Voice *voice);
 
     bool resort_to_respect_dependencies(const MemState &mem, Voice *source);
@@ -119,6 +119,8 @@ public:
     virtual uint32_t get_buffer_parameter_size() const = 0;
     virtual void on_state_change(const MemState &mem, ModuleData &v, const VoiceState previous) {}
     virtual void on_param_change(const MemState &mem, ModuleData &data) {}
+    // can the next process call need to run a guest callback which must be answered before it goes on
+    virtual bool needs_guest_thread(const MemState &mem, ModuleData &data) { return static_cast<bool>(data.callback); }
 };
 
 static constexpr uint32_t MAX_VOICE_OUTPUT = 4;
@@ -146,6 +148,15 @@ struct VoiceInputManager {
     int32_t receive(Patch *patch, const VoiceProduct &data);
 };
 
+struct DeferredCallback {
+    Ptr<void> callback;
+    Ptr<void> user_data;
+    uint32_t module_id;
+    uint32_t reason;
+    uint32_t reason2;
+    Address reason_ptr;
+};
+
 struct Voice {
     Rack *rack;
 
@@ -168,9 +179,15 @@ struct Voice {
     Ptr<void> finished_callback;
     Ptr<void> finished_callback_user_data;
 
+    // set while the voice is processed outside of the guest thread, the callbacks are then run once it is done
+    bool defer_callbacks = false;
+    std::vector<DeferredCallback> deferred_callbacks;
+
     void init(Rack *mama);
 
     ModuleData *module_storage(const uint32_t index);
+    // host memory used by the buffers of the modules and the inputs
+    size_t get_host_buffers_size() const;
 
     bool remove_patch(const MemState &mem, const Ptr<Patch> patch);
     Ptr<Patch> patch(const MemState &mem, const int32_t index, int32_t subindex, int32_t dest_index, Voice *dest);
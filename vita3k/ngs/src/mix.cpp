@@ -0,0 +1,229 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <ngs/mix.h>
+
+#include <util/instrset_detect.h>
+
+#include <algorithm>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#define NGS_SIMD_X64
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((__target__("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_AVX2
+#include <intrin.h>
+#endif
+#endif
+
+namespace ngs {
+void mix_stereo_basic(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]) {
+    for (size_t k = 0; k < nb_frames; k++) {
+        dest[k * 2] = std::clamp(dest[k * 2] + src[k * 2] * matrix[0][0] + src[k * 2 + 1] * matrix[1][0], -1.0f, 1.0f);
+        dest[k * 2 + 1] = std::clamp(dest[k * 2 + 1] + src[k * 2] * matrix[0][1] + src[k * 2 + 1] * matrix[1][1], -1.0f, 1.0f);
+    }
+}
+
+void mix_mono_to_stereo_basic(float *dest, const float *src, size_t nb_frames, float left, float right) {
+    for (size_t k = 0; k < nb_frames; k++) {
+        dest[k * 2] += src[k] * left;
+        dest[k * 2 + 1] += src[k] * right;
+    }
+}
+
+void convert_f32_to_s16_basic(int16_t *dest, const float *src, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        dest[i] = static_cast<int16_t>(std::clamp(src[i] * 32768.0f, -32768.0f, 32767.0f));
+}
+
+// each vector holds whole L R frames: the source is multiplied by the matrix diagonal (L * m00, R * m11)
+// and its channel swapped copy by the other coefficients (R * m10, L * m01)
+#if defined(__aarch64__)
+static void mix_stereo_neon(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]) {
+    const float32x4_t direct = { matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1] };
+    const float32x4_t crossed = { matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1] };
+    const float32x4_t min_value = vdupq_n_f32(-1.0f);
+    const float32x4_t max_value = vdupq_n_f32(1.0f);
+
+    size_t k = 0;
+    for (; k + 2 <= nb_frames; k += 2) {
+        const float32x4_t value = vld1q_f32(src + k * 2);
+        const float32x4_t mixed = vmlaq_f32(vmlaq_f32(vld1q_f32(dest + k * 2), value, direct), vrev64q_f32(value), crossed);
+        vst1q_f32(dest + k * 2, vminq_f32(vmaxq_f32(mixed, min_value), max_value));
+    }
+    mix_stereo_basic(dest + k * 2, src + k * 2, nb_frames - k, matrix);
+}
+
+// the mono samples are duplicated to L L R R frames by a zip with themselves
+static void mix_mono_to_stereo_neon(float *dest, const float *src, size_t nb_frames, float left, float right) {
+    const float32x4_t volume = { left, right, left, right };
+
+    size_t k = 0;
+    for (; k + 4 <= nb_frames; k += 4) {
+        const float32x4_t value = vld1q_f32(src + k);
+        const float32x4x2_t frames = vzipq_f32(value, value);
+        vst1q_f32(dest + k * 2, vmlaq_f32(vld1q_f32(dest + k * 2), frames.val[0], volume));
+        vst1q_f32(dest + k * 2 + 4, vmlaq_f32(vld1q_f32(dest + k * 2 + 4), frames.val[1], volume));
+    }
+    mix_mono_to_stereo_basic(dest + k * 2, src + k, nb_frames - k, left, right);
+}
+
+static void convert_f32_to_s16_neon(int16_t *dest, const float *src, size_t count) {
+    const float32x4_t scale = vdupq_n_f32(32768.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // the saturating narrow does the clamp
+        const int32x4_t low = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i), scale));
+        const int32x4_t high = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), scale));
+        vst1q_s16(dest + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+    }
+    convert_f32_to_s16_basic(dest + i, src + i, count - i);
+}
+#elif defined(NGS_SIMD_X64)
+static void mix_stereo_sse2(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]) {
+    const __m128 direct = _mm_setr_ps(matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1]);
+    const __m128 crossed = _mm_setr_ps(matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1]);
+    const __m128 min_value = _mm_set1_ps(-1.0f);
+    const __m128 max_value = _mm_set1_ps(1.0f);
+
+    size_t k = 0;
+    for (; k + 2 <= nb_frames; k += 2) {
+        const __m128 value = _mm_loadu_ps(src + k * 2);
+        const __m128 swapped = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+        const __m128 mixed = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(dest + k * 2), _mm_mul_ps(value, direct)), _mm_mul_ps(swapped, crossed));
+        _mm_storeu_ps(dest + k * 2, _mm_min_ps(_mm_max_ps(mixed, min_value), max_value));
+    }
+    mix_stereo_basic(dest + k * 2, src + k * 2, nb_frames - k, matrix);
+}
+
+static void TARGET_AVX2 mix_stereo_avx2(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]) {
+    const __m256 direct = _mm256_setr_ps(matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1], matrix[0][0], matrix[1][1]);
+    const __m256 crossed = _mm256_setr_ps(matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1], matrix[1][0], matrix[0][1]);
+    const __m256 min_value = _mm256_set1_ps(-1.0f);
+    const __m256 max_value = _mm256_set1_ps(1.0f);
+
+    size_t k = 0;
+    for (; k + 4 <= nb_frames; k += 4) {
+        const __m256 value = _mm256_loadu_ps(src + k * 2);
+        const __m256 swapped = _mm256_permute_ps(value, _MM_SHUFFLE(2, 3, 0, 1));
+        const __m256 mixed = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(dest + k * 2), _mm256_mul_ps(value, direct)), _mm256_mul_ps(swapped, crossed));
+        _mm256_storeu_ps(dest + k * 2, _mm256_min_ps(_mm256_max_ps(mixed, min_value), max_value));
+    }
+    mix_stereo_basic(dest + k * 2, src + k * 2, nb_frames - k, matrix);
+}
+
+static void mix_mono_to_stereo_sse2(float *dest, const float *src, size_t nb_frames, float left, float right) {
+    const __m128 volume = _mm_setr_ps(left, right, left, right);
+
+    size_t k = 0;
+    for (; k + 4 <= nb_frames; k += 4) {
+        const __m128 value = _mm_loadu_ps(src + k);
+        _mm_storeu_ps(dest + k * 2, _mm_add_ps(_mm_loadu_ps(dest + k * 2), _mm_mul_ps(_mm_unpacklo_ps(value, value), volume)));
+        _mm_storeu_ps(dest + k * 2 + 4, _mm_add_ps(_mm_loadu_ps(dest + k * 2 + 4), _mm_mul_ps(_mm_unpackhi_ps(value, value), volume)));
+    }
+    mix_mono_to_stereo_basic(dest + k * 2, src + k, nb_frames - k, left, right);
+}
+
+static void TARGET_AVX2 mix_mono_to_stereo_avx2(float *dest, const float *src, size_t nb_frames, float left, float right) {
+    const __m256 volume = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    // duplicates each sample inside its lane (s0 s0 s1 s1 | s2 s2 s3 s3 once the halves are placed)
+    const __m256i duplicate = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+    size_t k = 0;
+    for (; k + 8 <= nb_frames; k += 8) {
+        const __m256 low = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + k)), duplicate);
+        const __m256 high = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + k + 4)), duplicate);
+        _mm256_storeu_ps(dest + k * 2, _mm256_add_ps(_mm256_loadu_ps(dest + k * 2), _mm256_mul_ps(low, volume)));
+        _mm256_storeu_ps(dest + k * 2 + 8, _mm256_add_ps(_mm256_loadu_ps(dest + k * 2 + 8), _mm256_mul_ps(high, volume)));
+    }
+    mix_mono_to_stereo_basic(dest + k * 2, src + k, nb_frames - k, left, right);
+}
+
+static void convert_f32_to_s16_sse2(int16_t *dest, const float *src, size_t count) {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    // clamp before the conversion, out of range floats would become INT32_MIN
+    const __m128 min_value = _mm_set1_ps(-32768.0f);
+    const __m128 max_value = _mm_set1_ps(32767.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i low = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), min_value), max_value));
+        const __m128i high = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), min_value), max_value));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_packs_epi32(low, high));
+    }
+    convert_f32_to_s16_basic(dest + i, src + i, count - i);
+}
+#endif
+
+using MixStereoFunc = void (*)(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]);
+using MixMonoToStereoFunc = void (*)(float *dest, const float *src, size_t nb_frames, float left, float right);
+using ConvertF32ToS16Func = void (*)(int16_t *dest, const float *src, size_t count);
+
+static MixStereoFunc select_mix_stereo() {
+#if defined(__aarch64__)
+    return mix_stereo_neon;
+#elif defined(NGS_SIMD_X64)
+    if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2)
+        return mix_stereo_avx2;
+    return mix_stereo_sse2;
+#else
+    return mix_stereo_basic;
+#endif
+}
+
+static MixMonoToStereoFunc select_mix_mono_to_stereo() {
+#if defined(__aarch64__)
+    return mix_mono_to_stereo_neon;
+#elif defined(NGS_SIMD_X64)
+    if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2)
+        return mix_mono_to_stereo_avx2;
+    return mix_mono_to_stereo_sse2;
+#else
+    return mix_mono_to_stereo_basic;
+#endif
+}
+
+static ConvertF32ToS16Func select_convert_f32_to_s16() {
+#if defined(__aarch64__)
+    return convert_f32_to_s16_neon;
+#elif defined(NGS_SIMD_X64)
+    return convert_f32_to_s16_sse2;
+#else
+    return convert_f32_to_s16_basic;
+#endif
+}
+
+void mix_stereo(float *dest, const float *src, size_t nb_frames, const float matrix[2][2]) {
+    static const MixStereoFunc mix_impl = select_mix_stereo();
+    mix_impl(dest, src, nb_frames, matrix);
+}
+
+void mix_mono_to_stereo(float *dest, const float *src, size_t nb_frames, float left, float right) {
+    static const MixMonoToStereoFunc mix_impl = select_mix_mono_to_stereo();
+    mix_impl(dest, src, nb_frames, left, right);
+}
+
+void convert_f32_to_s16(int16_t *dest, const float *src, size_t count) {
+    static const ConvertF32ToS16Func convert_impl = select_convert_f32_to_s16();
+    convert_impl(dest, src, count);
+}
+} // namespace ngs
@@ -25,8 +25,10 @@ extern "C" {
 
 namespace ngs {
 
-SwrContext *Atrac9Module::swr_mono_to_stereo = nullptr;
-SwrContext *Atrac9Module::swr_stereo = nullptr;
+Atrac9Module::~Atrac9Module() {
+    swr_free(&swr_mono_to_stereo);
+    swr_free(&swr_stereo);
+}
 
 void Atrac9Module::on_state_change(const MemState &mem, ModuleData &data, const VoiceState previous) {
     SceNgsAT9States *state = data.get_state<SceNgsAT9States>();
@@ -58,6 +60,39 @@ void Atrac9Module::on_param_change(const MemState &mem, ModuleData &data) {
     }
 }
 
+bool Atrac9Module::needs_guest_thread(const MemState &mem, ModuleData &data) {
+    if (!data.callback)
+        return false;
+
+    const SceNgsAT9Params *params = data.get_parameters<SceNgsAT9Params>(mem);
+    const SceNgsAT9States *state = data.get_state<SceNgsAT9States>();
+    if (!params || !state || state->current_buffer == -1 || !params->buffer_params[state->current_buffer].buffer)
+        return false;
+
+    // only the end of a buffer (end of data, loop or buffer swap) waits for the callback,
+    // keep the cases where the amount of data decoded is not easily known on the update thread
+    const SceNgsAT9BufferParams &bufparam = params->buffer_params[state->current_buffer];
+    const int32_t sample_rate = data.parent->rack->system->sample_rate;
+    if (!decoder || params->config_data != last_config || !temp_buffer.empty()
+        || state->current_byte_position_in_buffer <= 0
+        || params->playback_scalar != 1 || static_cast<int>(round(params->playback_frequency)) != sample_rate)
+        return true;
+
+    const int32_t superframe_size = decoder->get(DecoderQuery::AT9_SUPERFRAME_SIZE);
+    const int32_t samples_per_superframe = decoder->get(DecoderQuery::AT9_SAMPLE_PER_SUPERFRAME);
+    const int32_t sample_index = (state->current_byte_position_in_buffer / superframe_size) * samples_per_superframe;
+    if (bufparam.samples_discard_start_off > sample_index)
+        return true;
+
+    // the last superframe can be shortened by the discarded samples, leave one more as a margin
+    const int32_t samples_needed = data.parent->rack->system->granularity - static_cast<int32_t>(state->decoded_samples_pending);
+    int32_t superframes_needed = (std::max(samples_needed, 0) + samples_per_superframe - 1) / samples_per_superframe + 1;
+    if (bufparam.samples_discard_end_off > 0)
+        superframes_needed += (bufparam.samples_discard_end_off + samples_per_superframe - 1) / samples_per_superframe;
+
+    return state->current_byte_position_in_buffer + superframes_needed * superframe_size > bufparam.bytes_count;
+}
+
 bool Atrac9Module::decode_more_data(KernelState &kern, const MemState &mem, const SceUID thread_id, ModuleData &data, const SceNgsAT9Params *params, SceNgsAT9States *state, std::unique_lock<std::recursive_mutex> &scheduler_lock, std::unique_lock<std::mutex> &voice_lock) {
     int current_buffer = state->current_buffer;
     const SceNgsAT9BufferParams &bufparam = params->buffer_params[current_buffer];
@@ -15,6 +15,7 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <ngs/mix.h>
 #include <ngs/modules/output.h>
 #include <util/log.h>
 
@@ -28,19 +29,18 @@ bool OutputModule::process(KernelState &kern, const MemState &mem, const SceUID
         data.voice_state_data.resize(data.parent->rack->system->granularity * sizeof(std::uint16_t) * 2);
     }
 
-    std::fill(data.voice_state_data.begin(), data.voice_state_data.end(), 0);
-
     if (data.parent->inputs.inputs.empty()) {
+        std::fill(data.voice_state_data.begin(), data.voice_state_data.end(), 0);
         return false;
     }
 
+    // the conversion overwrites the whole state data, it does not need to be cleared first
+
     int16_t *dest_data = reinterpret_cast<std::int16_t *>(data.voice_state_data.data());
     float *source_data = reinterpret_cast<float *>(data.parent->inputs.inputs[0].data());
 
     // Convert FLTP to S16
-    for (int i = 0; i < data.parent->rack->system->granularity * 2; i++) {
-        dest_data[i] = static_cast<std::int16_t>(std::clamp(source_data[i] * 32768.0f, -32768.0f, 32767.0f));
-    }
+    convert_f32_to_s16(dest_data, source_data, data.parent->rack->system->granularity * 2);
 
     return false;
 }
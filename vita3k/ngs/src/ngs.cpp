@@ -17,8 +17,10 @@
 
 #include <kernel/state.h>
 
+#include <ngs/mix.h>
 #include <ngs/state.h>
 #include <ngs/system.h>
+#include <util/alloc_tracker.h>
 #include <util/lock_and_find.h>
 
 #include <util/log.h>
@@ -85,12 +87,7 @@ int32_t VoiceInputManager::receive(ngs::Patch *patch, const VoiceProduct &produc
 
     // Try mixing, also with the use of this volume matrix
     // Dest is our voice to receive this data.
-    for (int32_t k = 0; k < patch->dest->rack->system->granularity; k++) {
-        dest_buffer[k * 2] = std::clamp(dest_buffer[k * 2] + data_to_mix_in[k * 2] * volume_matrix[0][0]
-                + data_to_mix_in[k * 2 + 1] * volume_matrix[1][0],
-            -1.0f, 1.0f);
-        dest_buffer[k * 2 + 1] = std::clamp(dest_buffer[k * 2 + 1] + data_to_mix_in[k * 2] * volume_matrix[0][1] + data_to_mix_in[k * 2 + 1] * volume_matrix[1][1], -1.0f, 1.0f);
-    }
+    mix_stereo(dest_buffer, data_to_mix_in, patch->dest->rack->system->granularity, volume_matrix);
 
     return 0;
 }
@@ -164,6 +161,16 @@ void Voice::init(Rack *mama) {
     voice_mutex = std::make_unique<std::mutex>();
 }
 
+size_t Voice::get_host_buffers_size() const {
+    size_t size = 0;
+    for (const ModuleData &data : datas)
+        size += data.voice_state_data.capacity() + data.extra_storage.capacity() + data.last_info.capacity();
+    for (const VoiceInputManager::PCMInput &input : inputs.inputs)
+        size += input.capacity();
+
+    return size;
+}
+
 Ptr<Patch> Voice::patch(const MemState &mem, const int32_t index, int32_t subindex, int32_t dest_index, Voice *dest) {
     const std::lock_guard<std::mutex> guard(*voice_mutex);
 
@@ -327,6 +334,11 @@ void Voice::invoke_callback(KernelState &kernel, const MemState &mem, const SceU
         return;
     }
 
+    if (defer_callbacks) {
+        deferred_callbacks.push_back({ callback, user_data, module_id, reason1, reason2, reason_ptr });
+        return;
+    }
+
     const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
     const Address callback_info_addr = stack_alloc(*thread->cpu, sizeof(SceNgsCallbackInfo));
 
@@ -456,6 +468,7 @@ void release_rack(State &ngs, const MemState &mem, System *system, Rack *rack) {
     // remove all queued voices
     for (const auto &voice : rack->voices) {
         system->voice_scheduler.deque_voice(voice.get(mem));
+        TRACK_HOST_FREE(voice.get(mem));
         voice.get(mem)->~Voice();
         // no need to free the voice from the rack
     }
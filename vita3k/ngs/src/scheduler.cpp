@@ -20,11 +20,99 @@
 
 #include <kernel/state.h>
 
+#include <util/alloc_tracker.h>
+#include <util/log.h>
+
 #include <algorithm>
 #include <cstring>
+#include <unordered_map>
 
 namespace ngs {
 
+// below this amount of voices in a level, waking up the workers costs more than it saves
+static constexpr size_t MIN_PARALLEL_VOICES = 4;
+
+static VoiceProcessResult process_voice(KernelState &kern, const MemState &mem, const SceUID thread_id, Voice *voice, std::unique_lock<std::recursive_mutex> &scheduler_lock) {
+    // Modify the state, in peace....
+    std::unique_lock<std::mutex> voice_lock(*voice->voice_mutex);
+    memset(voice->products, 0, sizeof(voice->products));
+
+    VoiceProcessResult result;
+    for (size_t i = 0; i < voice->rack->modules.size(); i++) {
+        if (voice->rack->modules[i]) {
+            if (voice->rack->modules[i]->process(kern, mem, thread_id, voice->datas[i], scheduler_lock, voice_lock)) {
+                result.finished = true;
+                result.finished_module = voice->rack->modules[i]->module_id();
+            }
+        }
+    }
+    TRACK_HOST_ALLOC(NgsBuffers, voice, voice->get_host_buffers_size());
+
+    return result;
+}
+
+// modules only run guest code through their callbacks, a voice can be processed on any thread
+// if none of its modules may have to wait for one during this update
+static bool can_process_in_parallel(const MemState &mem, Voice *voice) {
+    const std::lock_guard<std::mutex> voice_lock(*voice->voice_mutex);
+    for (size_t i = 0; i < voice->rack->modules.size(); i++) {
+        if (voice->rack->modules[i] && voice->rack->modules[i]->needs_guest_thread(mem, voice->datas[i]))
+            return false;
+    }
+
+    return true;
+}
+
+void VoiceBatch::work() {
+    // the modules of these voices do not need the scheduler to be unlocked, give them a lock of their own
+    std::recursive_mutex batch_mutex;
+    std::unique_lock<std::recursive_mutex> batch_lock(batch_mutex);
+
+    for (size_t group = next.fetch_add(1, std::memory_order_relaxed); group < group_ends.size(); group = next.fetch_add(1, std::memory_order_relaxed)) {
+        for (size_t i = group == 0 ? 0 : group_ends[group - 1]; i < group_ends[group]; i++) {
+            // the callbacks which do not need an answer (like decode errors) are run by the update thread afterwards
+            voices[i]->defer_callbacks = true;
+            results[i] = process_voice(*kern, *mem, thread_id, voices[i], batch_lock);
+            voices[i]->defer_callbacks = false;
+            done.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+VoiceScheduler::~VoiceScheduler() {
+    batch_queue.abort();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void VoiceScheduler::worker_thread() {
+    while (true) {
+        // only returns nothing once the queue is aborted
+        const std::unique_ptr<std::shared_ptr<VoiceBatch>> batch = batch_queue.pop();
+        if (!batch)
+            break;
+
+        (*batch)->work();
+    }
+}
+
+void VoiceScheduler::run_batch(const std::shared_ptr<VoiceBatch> &batch) {
+    if (workers.empty()) {
+        const int nb_workers = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 4, 1, 4);
+        LOG_INFO("Processing NGS voices with {} more threads", nb_workers);
+        for (int i = 0; i < nb_workers; i++)
+            workers.emplace_back(&VoiceScheduler::worker_thread, this);
+    }
+
+    const size_t nb_helpers = std::min(workers.size(), batch->group_ends.size() - 1);
+    for (size_t i = 0; i < nb_helpers; i++)
+        batch_queue.push(batch);
+
+    batch->work();
+    while (batch->done.load(std::memory_order_acquire) < batch->voices.size())
+        std::this_thread::yield();
+}
+
 bool VoiceScheduler::deque_voice(Voice *voice) {
     const std::lock_guard<std::recursive_mutex> guard(mutex);
 
@@ -135,43 +223,108 @@ void VoiceScheduler::update(KernelState &kern, const MemState &mem, const SceUID
         voice->inputs.reset_inputs();
     }
 
+    // the queue is sorted so the sources of a voice are before it, a voice is one level above its deepest source
+    // voices of the same level do not depend on each other and only read the data delivered by the previous levels
+    std::unordered_map<Voice *, uint32_t> voice_levels;
+    voice_levels.reserve(queue_copy.size());
+    for (ngs::Voice *voice : queue_copy)
+        voice_levels.emplace(voice, 0);
+
+    std::vector<std::vector<Voice *>> levels;
     for (ngs::Voice *voice : queue_copy) {
-        // Modify the state, in peace....
-        std::unique_lock<std::mutex> voice_lock(*voice->voice_mutex);
-        memset(voice->products, 0, sizeof(voice->products));
-
-        bool finished = false;
-        uint32_t finished_module = 0;
-
-        for (size_t i = 0; i < voice->rack->modules.size(); i++) {
-            if (voice->rack->modules[i]) {
-                if (voice->rack->modules[i]->process(kern, mem, thread_id, voice->datas[i], scheduler_lock, voice_lock)) {
-                    finished = true;
-                    finished_module = voice->rack->modules[i]->module_id();
-                }
+        const uint32_t level = voice_levels[voice];
+        if (level >= levels.size())
+            levels.resize(level + 1);
+        levels[level].push_back(voice);
+
+        for (const auto &patches : voice->patches) {
+            for (const auto &patch : patches) {
+                if (!patch || patch.get(mem)->output_sub_index == -1)
+                    continue;
+
+                const auto dest = voice_levels.find(patch.get(mem)->dest);
+                if (dest != voice_levels.end())
+                    dest->second = std::max(dest->second, level + 1);
             }
         }
-        if (finished) {
-            voice->is_keyed_off = true;
-            voice->transition(mem, VOICE_STATE_FINALIZING);
-            if (voice->finished_callback) {
+    }
+
+    std::vector<VoiceProcessResult> results;
+    for (const std::vector<Voice *> &level : levels) {
+        results.assign(level.size(), {});
+
+        // voices which may wait for a callback are processed on this thread, the other ones can be processed by the workers
+        std::vector<size_t> batch_indices;
+        for (size_t i = 0; i < level.size(); i++) {
+            if (can_process_in_parallel(mem, level[i]))
+                batch_indices.push_back(i);
+            else
+                results[i] = process_voice(kern, mem, thread_id, level[i], scheduler_lock);
+        }
+
+        // the voices of a rack share its modules (and their decoder), so a rack is processed by a single thread
+        std::vector<size_t> rack_order = batch_indices;
+        std::stable_sort(rack_order.begin(), rack_order.end(), [&](size_t a, size_t b) { return level[a]->rack < level[b]->rack; });
+        auto batch = std::make_shared<VoiceBatch>();
+        for (size_t i = 0; i < rack_order.size(); i++) {
+            if (i > 0 && level[rack_order[i]]->rack != level[rack_order[i - 1]]->rack)
+                batch->group_ends.push_back(i);
+            batch->voices.push_back(level[rack_order[i]]);
+        }
+        if (!rack_order.empty())
+            batch->group_ends.push_back(rack_order.size());
+
+        if (batch->voices.size() >= MIN_PARALLEL_VOICES && batch->group_ends.size() > 1) {
+            batch->kern = &kern;
+            batch->mem = &mem;
+            batch->thread_id = thread_id;
+            batch->results.resize(batch->voices.size());
+            run_batch(batch);
+            for (size_t i = 0; i < rack_order.size(); i++)
+                results[rack_order[i]] = batch->results[i];
+        } else {
+            for (size_t i = 0; i < batch_indices.size(); i++)
+                results[batch_indices[i]] = process_voice(kern, mem, thread_id, level[batch_indices[i]], scheduler_lock);
+        }
+
+        // callbacks and deliveries are done in the queue order on this thread once the whole level is processed
+        for (size_t i = 0; i < level.size(); i++) {
+            ngs::Voice *voice = level[i];
+            std::unique_lock<std::mutex> voice_lock(*voice->voice_mutex);
+
+            if (!voice->deferred_callbacks.empty()) {
+                const std::vector<DeferredCallback> callbacks = std::move(voice->deferred_callbacks);
+                voice->deferred_callbacks.clear();
                 voice_lock.unlock();
                 scheduler_lock.unlock();
-                voice->invoke_callback(kern, mem, thread_id, voice->finished_callback, voice->finished_callback_user_data, finished_module);
+                for (const DeferredCallback &callback : callbacks)
+                    voice->invoke_callback(kern, mem, thread_id, callback.callback, callback.user_data, callback.module_id, callback.reason, callback.reason2, callback.reason_ptr);
                 scheduler_lock.lock();
                 voice_lock.lock();
             }
-            voice->is_keyed_off = false;
 
-            stop(mem, voice);
-        }
+            if (results[i].finished) {
+                voice->is_keyed_off = true;
+                voice->transition(mem, VOICE_STATE_FINALIZING);
+                if (voice->finished_callback) {
+                    voice_lock.unlock();
+                    scheduler_lock.unlock();
+                    voice->invoke_callback(kern, mem, thread_id, voice->finished_callback, voice->finished_callback_user_data, results[i].finished_module);
+                    scheduler_lock.lock();
+                    voice_lock.lock();
+                }
+                voice->is_keyed_off = false;
 
-        for (size_t i = 0; i < voice->rack->vdef->output_count; i++) {
-            if (voice->products[i].data)
-                deliver_data(mem, queue_copy, voice, static_cast<uint8_t>(i), voice->products[i]);
-        }
+                stop(mem, voice);
+            }
 
-        voice->frame_count++;
+            for (size_t j = 0; j < voice->rack->vdef->output_count; j++) {
+                if (voice->products[j].data)
+                    deliver_data(mem, queue_copy, voice, static_cast<uint8_t>(j), voice->products[j]);
+            }
+
+            voice->frame_count++;
+        }
     }
 
     while (!operations_pending.empty()) {
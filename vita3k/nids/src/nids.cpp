@@ -17,24 +17,64 @@
 
 #include <nids/functions.h>
 
+#include <array>
+#include <bit>
+#include <iterator>
+
 #define VAR_NID(name, nid) extern const char name_##name[] = #name;
 #define NID(name, nid) extern const char name_##name[] = #name;
 #include <nids/nids.inc>
 #undef NID
 #undef VAR_NID
 
-const char *import_name(uint32_t nid) {
-    switch (nid) {
-#define VAR_NID(name, nid) \
-    case nid:              \
-        return name_##name;
-#define NID(name, nid) \
-    case nid:          \
-        return name_##name;
+struct NidName {
+    uint32_t nid;
+    const char *name;
+};
+
+static constexpr NidName nid_names[] = {
+#define VAR_NID(name, nid) { nid, name_##name },
+#define NID(name, nid) { nid, name_##name },
 #include <nids/nids.inc>
 #undef NID
 #undef VAR_NID
-    default:
-        return "UNRECOGNISED";
+};
+
+// Open addressing hash table built at compile time, at most half full so a lookup only probes a few slots
+static constexpr size_t NID_TABLE_SIZE = std::bit_ceil(std::size(nid_names) * 2);
+static constexpr uint32_t NID_TABLE_BITS = std::countr_zero(NID_TABLE_SIZE);
+static_assert(std::size(nid_names) < UINT16_MAX, "the indexes of the nid table do not fit in 16 bits");
+
+struct NidTable {
+    std::array<uint32_t, NID_TABLE_SIZE> nids;
+    // index in nid_names + 1, 0 for an empty slot
+    std::array<uint16_t, NID_TABLE_SIZE> indexes;
+};
+
+static constexpr uint32_t nid_slot(uint32_t nid) {
+    return (nid * 0x9E3779B1U) >> (32 - NID_TABLE_BITS);
+}
+
+static constexpr NidTable make_nid_table() {
+    NidTable table{};
+    for (size_t i = 0; i < std::size(nid_names); i++) {
+        uint32_t slot = nid_slot(nid_names[i].nid);
+        while (table.indexes[slot] != 0)
+            slot = (slot + 1) & (NID_TABLE_SIZE - 1);
+        table.nids[slot] = nid_names[i].nid;
+        table.indexes[slot] = static_cast<uint16_t>(i + 1);
+    }
+    return table;
+}
+
+static constexpr NidTable nid_table = make_nid_table();
+
+const char *import_name(uint32_t nid) {
+    for (uint32_t slot = nid_slot(nid);; slot = (slot + 1) & (NID_TABLE_SIZE - 1)) {
+        const uint16_t index = nid_table.indexes[slot];
+        if (index == 0)
+            return "UNRECOGNISED";
+        if (nid_table.nids[slot] == nid)
+            return nid_names[index - 1].name;
     }
 }
@@ -163,11 +163,11 @@ bool Context::init_info_from_trp() {
 static constexpr std::uint32_t TROPHY_USR_MAGIC = 0x12D5819A;
 
 void Context::save_trophy_progress_file() {
-    // Open the file
-    const SceUID output = open_file(*io, trophy_progress_output_file_path.c_str(), SCE_O_WRONLY | SCE_O_CREAT, pref_path, "save_trophy_progress");
-
-    auto write_stuff = [&](const void *data, std::uint32_t amount) -> int {
-        return write_file(output, data, amount, *io, "save_trophy_progress_file");
+    // the file is written by the io worker, several unlocks in a row are written once
+    std::vector<std::uint8_t> output;
+    auto write_stuff = [&](const void *data, std::uint32_t amount) {
+        const auto bytes = static_cast<const std::uint8_t *>(data);
+        output.insert(output.end(), bytes, bytes + amount);
     };
 
     write_stuff(&TROPHY_USR_MAGIC, 4);
@@ -181,7 +181,7 @@ void Context::save_trophy_progress_file() {
     write_stuff(unlock_timestamps.data(), (std::uint32_t)unlock_timestamps.size() * 8);
     write_stuff(trophy_kinds.data(), (std::uint32_t)trophy_kinds.size() * 4);
 
-    close_file(*io, output, "save_trophy_progress_file");
+    write_file_deferred(*io, trophy_progress_output_file_path.c_str(), output.data(), static_cast<SceSize>(output.size()), pref_path, "save_trophy_progress_file");
 }
 
 bool Context::load_trophy_progress_file(const SceUID &progress_input_file) {
@@ -25,6 +25,7 @@
 #include <packages/functions.h>
 #include <util/log.h>
 
+#include <istream>
 #include <map>
 
 // Credits to TeamMolecule for their original work on this https://github.com/TeamMolecule/sceutils
@@ -655,10 +656,15 @@ public:
 
 void register_keys(KeyStore &SCE_KEYS, int type);
 void extract_fat(const std::wstring &partition_path, const std::string &partition, const std::wstring &pref_path);
+void extract_fat(const std::vector<uint8_t> &image, const std::string &partition, const std::wstring &pref_path);
+// Inflates a segment into a preallocated destination, fails if the data does not fit in dest_size bytes
+bool decompress_segment(const uint8_t *compressed, size_t compressed_size, uint8_t *dest, size_t dest_size, size_t *decompressed_size = nullptr);
 std::string decompress_segments(const std::vector<uint8_t> &decrypted_data, const uint64_t &size);
 void self2elf(const fs::path &infile, const fs::path &outfile, KeyStore &SCE_KEYS, unsigned char *klictxt, uint64_t *authid);
 void make_fself(const fs::path &input_file, const fs::path &output_file, uint64_t authid);
-std::tuple<uint64_t, SelfType> get_key_type(std::ifstream &file, const SceHeader &sce_hdr);
-std::vector<SceSegment> get_segments(std::ifstream &file, const SceHeader &sce_hdr, KeyStore &SCE_KEYS, uint64_t sysver = -1, SelfType self_type = static_cast<SelfType>(0), int keytype = 0, unsigned char *klictxt = 0);
+std::tuple<uint64_t, SelfType> get_key_type(std::istream &file, const SceHeader &sce_hdr);
+std::vector<SceSegment> get_segments(std::istream &file, const SceHeader &sce_hdr, KeyStore &SCE_KEYS, uint64_t sysver = -1, SelfType self_type = static_cast<SelfType>(0), int keytype = 0, unsigned char *klictxt = 0);
 void decrypt_fself(const fs::path &file_path, KeyStore &SCE_KEYS, unsigned char *klictxt);
+// Decrypts the files on several threads, when cache_path is set the results are cached by hash of the encrypted file
+void decrypt_fselfs(const std::vector<fs::path> &files, KeyStore &SCE_KEYS, unsigned char *klictxt, const fs::path &cache_path = {});
 bool is_self(const fs::path &file_path);
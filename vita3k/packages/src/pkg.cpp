@@ -40,6 +40,13 @@
 #include <util/log.h>
 #include <util/string_utils.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 // Credits to mmozeiko https://github.com/mmozeiko/pkg2zip
 
 static void ctr_add(uint8_t *counter, uint64_t n) {
@@ -51,28 +58,162 @@ static void ctr_add(uint8_t *counter, uint64_t n) {
 }
 
 static void aes128_ctr_xor(aes_context *ctx, const uint8_t *iv, uint64_t block, uint8_t *input, size_t size) {
-    uint8_t tmp[16];
+    uint8_t stream_block[16];
     uint8_t counter[16];
     for (uint32_t i = 0; i < 16; i++) {
         counter[i] = iv[i];
     }
     ctr_add(counter, block);
 
-    while (size >= 16) {
-        aes_crypt_ecb(ctx, AES_ENCRYPT, counter, tmp);
-        for (uint32_t i = 0; i < 16; i++) {
-            *input++ ^= tmp[i];
+    // aes_crypt_ctr increments the counter the same way and encrypts several blocks at once with AES-NI
+    size_t nc_off = 0;
+    aes_crypt_ctr(ctx, size, &nc_off, counter, stream_block, input, input);
+}
+
+// A file of the package to extract, data_offset is relative to the data section
+struct PkgFileJob {
+    std::string path;
+    uint64_t data_offset;
+    uint64_t data_size;
+};
+
+// Part of a file read by the install thread, decrypted by any worker and written in order by the writer
+struct PkgChunk {
+    const PkgFileJob *file;
+    uint64_t offset;
+    std::vector<uint8_t> data;
+    bool is_first;
+    bool is_last;
+    bool decrypted = false;
+};
+
+constexpr size_t PKG_CHUNK_SIZE = 1024 * 1024;
+// bounds the memory used by the chunks read ahead of the writer
+constexpr size_t PKG_MAX_CHUNKS = 16;
+
+/**
+ * \brief Extract and decrypt the files of a package.
+ *
+ * Reading, decrypting and writing are pipelined: the calling thread reads the chunks, CTR mode lets the workers
+ * decrypt them independently from their offset, and a writer thread writes them back in the reading order.
+ */
+static bool extract_pkg_files(fs::ifstream &infile, uint64_t data_offset, aes_context &aes_ctx, const uint8_t *iv, const std::vector<PkgFileJob> &files, uint64_t total_size, const std::function<void(float)> &progress_callback) {
+    std::mutex mutex;
+    std::condition_variable chunk_ready;
+    std::condition_variable chunk_decrypted;
+    std::condition_variable chunk_written;
+    // chunks in reading order, until they are written
+    std::deque<std::shared_ptr<PkgChunk>> in_flight;
+    std::deque<std::shared_ptr<PkgChunk>> to_decrypt;
+    bool reading_done = false;
+    bool failed = false;
+    std::atomic<uint64_t> written_size = 0;
+
+    const auto decrypt_worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            chunk_ready.wait(lock, [&] { return !to_decrypt.empty() || reading_done || failed; });
+            if (to_decrypt.empty())
+                return;
+
+            const std::shared_ptr<PkgChunk> chunk = std::move(to_decrypt.front());
+            to_decrypt.pop_front();
+            lock.unlock();
+            aes128_ctr_xor(&aes_ctx, iv, chunk->offset / 16, chunk->data.data(), chunk->data.size());
+            lock.lock();
+            chunk->decrypted = true;
+            chunk_decrypted.notify_all();
+        }
+    };
+
+    const auto writer = [&]() {
+        std::ofstream outfile;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            chunk_decrypted.wait(lock, [&] { return failed || (in_flight.empty() ? reading_done : in_flight.front()->decrypted); });
+            if (failed || in_flight.empty())
+                return;
+
+            const std::shared_ptr<PkgChunk> chunk = in_flight.front();
+            lock.unlock();
+            if (chunk->is_first)
+                outfile.open(chunk->file->path, std::ios::binary);
+            outfile.write(reinterpret_cast<const char *>(chunk->data.data()), chunk->data.size());
+            const bool write_failed = !outfile;
+            if (chunk->is_last)
+                outfile.close();
+            written_size += chunk->data.size();
+            lock.lock();
+
+            if (write_failed) {
+                LOG_ERROR("Failed to write {}", chunk->file->path);
+                failed = true;
+                chunk_ready.notify_all();
+            }
+            in_flight.pop_front();
+            chunk_written.notify_all();
         }
-        ctr_add(counter, 1);
-        size -= 16;
+    };
+
+    const uint32_t nb_workers = std::clamp(std::thread::hardware_concurrency(), 2U, 10U) - 1;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < nb_workers; i++)
+        threads.emplace_back(decrypt_worker);
+    threads.emplace_back(writer);
+
+    for (const PkgFileJob &file : files) {
+        uint64_t offset = file.data_offset;
+        uint64_t remaining = file.data_size;
+        bool is_first = true;
+        // empty files still need a chunk to be created
+        do {
+            auto chunk = std::make_shared<PkgChunk>();
+            const uint64_t size = std::min<uint64_t>(remaining, PKG_CHUNK_SIZE);
+            chunk->file = &file;
+            chunk->offset = offset;
+            chunk->data.resize(size);
+            chunk->is_first = is_first;
+            chunk->is_last = size == remaining;
+
+            infile.seekg(data_offset + offset);
+            infile.read(reinterpret_cast<char *>(chunk->data.data()), size);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!infile) {
+                LOG_ERROR("Failed to read {} from the pkg file", file.path);
+                failed = true;
+            }
+            chunk_written.wait(lock, [&] { return failed || in_flight.size() < PKG_MAX_CHUNKS; });
+            if (failed)
+                break;
+            in_flight.push_back(chunk);
+            to_decrypt.push_back(std::move(chunk));
+            chunk_ready.notify_one();
+            lock.unlock();
+
+            if (total_size != 0)
+                progress_callback(static_cast<float>(written_size) / total_size * 100.f * 0.6f);
+
+            offset += size;
+            remaining -= size;
+            is_first = false;
+        } while (remaining != 0);
+
+        if (failed)
+            break;
     }
 
-    if (size != 0) {
-        aes_crypt_ecb(ctx, AES_ENCRYPT, counter, tmp);
-        for (size_t i = 0; i < size; i++) {
-            *input++ ^= tmp[i];
-        }
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        reading_done = true;
     }
+    chunk_ready.notify_all();
+    chunk_decrypted.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    progress_callback(60.f);
+    return !failed;
 }
 
 bool decrypt_install_nonpdrm(EmuEnvState &emuenv, std::string &drmlicpath, const std::string &title_path) {
@@ -96,16 +237,13 @@ bool decrypt_install_nonpdrm(EmuEnvState &emuenv, std::string &drmlicpath, const
     register_keys(SCE_KEYS, 1);
     std::vector<uint8_t> temp_klicensee = get_temp_klicensee(zRIF);
 
+    std::vector<fs::path> selfs;
     for (const auto &file : fs::recursive_directory_iterator(title_id_src)) {
-        if ((file.path().extension() == ".suprx") || (file.path().extension() == ".self") || (file.path().filename() == "eboot.bin")) {
-            uint64_t authid = 0x2F00000000000001ULL;
-            self2elf(file.path().string(), file.path().string() + "elf", SCE_KEYS, temp_klicensee.data(), &authid);
-            fs::rename(file.path().string() + "elf", file.path().string());
-            make_fself(file.path().string(), file.path().string() + "fself", authid);
-            fs::rename(file.path().string() + "fself", file.path().string());
-            LOG_INFO("Decrypted {} with klicensee {}", file.path().string(), byte_array_to_string(temp_klicensee.data(), 16));
-        }
+        if ((file.path().extension() == ".suprx") || (file.path().extension() == ".self") || (file.path().filename() == "eboot.bin"))
+            selfs.push_back(file.path());
     }
+    decrypt_fselfs(selfs, SCE_KEYS, temp_klicensee.data(), emuenv.cache_path / "fself");
+    LOG_INFO("Decrypted {} executables with klicensee {}", selfs.size(), byte_array_to_string(temp_klicensee.data(), 16));
 
     return true;
 }
@@ -249,21 +387,23 @@ bool install_pkg(const std::string &pkg, EmuEnvState &emuenv, std::string &p_zRI
         break;
     }
 
+    // read the entry table first, it is small and gives the total size for the progress
+    std::vector<PkgFileJob> files;
+    uint64_t total_size = 0;
+    const auto data_offset = byte_swap(pkg_header.data_offset);
     for (uint32_t i = 0; i < byte_swap(pkg_header.file_count); i++) {
         PkgEntry entry;
         uint64_t file_offset = items_offset + i * 32;
-        infile.seekg(byte_swap(pkg_header.data_offset) + file_offset, std::ios_base::beg);
+        infile.seekg(data_offset + file_offset, std::ios_base::beg);
         infile.read(reinterpret_cast<char *>(&entry), sizeof(PkgEntry));
         aes128_ctr_xor(&aes_ctx, pkg_header.pkg_data_iv, file_offset / 16, reinterpret_cast<unsigned char *>(&entry), sizeof(PkgEntry));
 
-        if (fs::file_size(pkg_path) < byte_swap(pkg_header.data_offset) + byte_swap(entry.name_offset) + byte_swap(entry.name_size) || fs::file_size(pkg_path) < byte_swap(pkg_header.data_offset) + byte_swap(entry.data_offset) + byte_swap(entry.data_size)) {
+        if (fs::file_size(pkg_path) < data_offset + byte_swap(entry.name_offset) + byte_swap(entry.name_size) || fs::file_size(pkg_path) < data_offset + byte_swap(entry.data_offset) + byte_swap(entry.data_size)) {
             LOG_ERROR("The pkg file size is too small, possibly corrupted");
             return false;
         }
-        const auto file_count = (float)byte_swap(pkg_header.file_count);
-        progress_callback(i / file_count * 100.f * 0.6f);
         std::vector<unsigned char> name(byte_swap(entry.name_size));
-        infile.seekg(byte_swap(pkg_header.data_offset) + byte_swap(entry.name_offset));
+        infile.seekg(data_offset + byte_swap(entry.name_offset));
         infile.read((char *)&name[0], byte_swap(entry.name_size));
         aes128_ctr_xor(&aes_ctx, pkg_header.pkg_data_iv, byte_swap(entry.name_offset) / 16, &name[0], byte_swap(entry.name_size));
 
@@ -273,25 +413,13 @@ bool install_pkg(const std::string &pkg, EmuEnvState &emuenv, std::string &p_zRI
         if ((byte_swap(entry.type) & 0xFF) == 4 || (byte_swap(entry.type) & 0xFF) == 18) { // Directory
             fs::create_directories(path.string() + "/" + string_name);
         } else { // File
-            std::ofstream outfile(path.string() + "/" + string_name, std::ios::binary);
-
-            auto offset = byte_swap(entry.data_offset);
-            auto data_size = byte_swap(entry.data_size);
-            while (data_size != 0) {
-                unsigned char buffer[0x10000];
-                auto size = data_size < sizeof(buffer) ? data_size : sizeof(buffer);
-                infile.seekg(byte_swap(pkg_header.data_offset) + offset);
-                infile.read((char *)buffer, size);
-
-                aes128_ctr_xor(&aes_ctx, pkg_header.pkg_data_iv, offset / 16, buffer, size);
-
-                outfile.write((char *)buffer, size);
-                offset += size;
-                data_size -= size;
-            }
-            outfile.close();
+            files.push_back({ path.string() + "/" + string_name, byte_swap(entry.data_offset), byte_swap(entry.data_size) });
+            total_size += byte_swap(entry.data_size);
         }
     }
+
+    if (!extract_pkg_files(infile, data_offset, aes_ctx, pkg_header.pkg_data_iv, files, total_size, progress_callback))
+        return false;
     infile.close();
 
     std::string title_id_src = path.string();
@@ -315,11 +443,14 @@ bool install_pkg(const std::string &pkg, EmuEnvState &emuenv, std::string &p_zRI
         fs::remove_all(fs::path(title_id_src));
         fs::rename(fs::path(title_id_dst), fs::path(title_id_src));
 
-        for (const auto &file : fs::recursive_directory_iterator(title_id_src)) {
-            if (is_self(file.path())) {
-                decrypt_fself(file.path(), SCE_KEYS, temp_klicensee.data());
-                LOG_INFO("Decrypted {} with klicensee {}", file.path().string(), byte_array_to_string(temp_klicensee.data(), 16));
+        {
+            std::vector<fs::path> selfs;
+            for (const auto &file : fs::recursive_directory_iterator(title_id_src)) {
+                if (is_self(file.path()))
+                    selfs.push_back(file.path());
             }
+            decrypt_fselfs(selfs, SCE_KEYS, temp_klicensee.data(), emuenv.cache_path / "fself");
+            LOG_INFO("Decrypted {} executables with klicensee {}", selfs.size(), byte_array_to_string(temp_klicensee.data(), 16));
         }
         break;
     case PkgType::PKG_TYPE_VITA_DLC:
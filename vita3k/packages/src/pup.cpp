@@ -31,7 +31,10 @@
 #include <fmt/xchar.h>
 
 #include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <streambuf>
+#include <thread>
 
 // Credits to TeamMolecule for their original work on this https://github.com/TeamMolecule/sceutils
 
@@ -105,7 +108,30 @@ static std::string make_filename(unsigned char *hdr, int64_t filetype) {
     return fmt::format("unknown-0x{:X}.pkg", filetype);
 }
 
-static void extract_pup_files(const std::wstring &pup, const std::wstring &output) {
+// A file of the PUP, only the firmware packages are kept in memory to be decrypted
+struct PupFile {
+    std::string filename;
+    uint64_t offset;
+    uint64_t length;
+    std::vector<uint8_t> data;
+};
+
+// The FAT images of the firmware, each one is made of the packages with its prefix
+static const char *FIRMWARE_IMAGES[] = { "os0", "sa0", "vs0" };
+
+static bool is_firmware_package(const std::string &filename) {
+    return std::any_of(std::begin(FIRMWARE_IMAGES), std::end(FIRMWARE_IMAGES), [&](const char *image) {
+        return filename.starts_with(fmt::format("{}-", image));
+    });
+}
+
+/**
+ * \brief Read the file table of the PUP.
+ *
+ * The metadata files (version.txt, license.xml...) are written to output, the other files are
+ * only recorded and later read straight from the PUP.
+ */
+static std::vector<PupFile> extract_pup_files(const std::wstring &pup, const std::wstring &output) {
     constexpr int SCEUF_HEADER_SIZE = 0x80;
     constexpr int SCEUF_FILEREC_SIZE = 0x20;
     fs::ifstream infile(pup, std::ios::binary);
@@ -114,7 +140,7 @@ static void extract_pup_files(const std::wstring &pup, const std::wstring &outpu
 
     if (strncmp(header, "SCEUF", 5) != 0) {
         LOG_ERROR("Invalid PUP");
-        return;
+        return {};
     }
 
     uint32_t cnt = 0;
@@ -131,6 +157,7 @@ static void extract_pup_files(const std::wstring &pup, const std::wstring &outpu
     LOG_INFO("Build Number: {:0}", build_number);
     LOG_INFO("Number Of Files: {}", cnt);
 
+    std::vector<PupFile> files;
     for (uint32_t x = 0; x < cnt; x++) {
         infile.seekg(SCEUF_HEADER_SIZE + x * SCEUF_FILEREC_SIZE);
         char rec[SCEUF_FILEREC_SIZE];
@@ -146,28 +173,52 @@ static void extract_pup_files(const std::wstring &pup, const std::wstring &outpu
         memcpy(&length, &rec[16], 8);
         memcpy(&flags, &rec[24], 8);
 
-        std::string filename = "";
         if (PUP_TYPES.count(filetype)) {
-            filename = PUP_TYPES.at(filetype);
+            const std::string &filename = PUP_TYPES.at(filetype);
+            fs::ofstream outfile(fmt::format(L"{}/{}", output, string_utils::utf_to_wide(filename)), std::ios::binary);
+            infile.seekg(offset);
+            std::vector<char> buffer(length);
+            infile.read(&buffer[0], length);
+            outfile.write(&buffer[0], length);
+            outfile.close();
         } else {
             infile.seekg(offset);
             char hdr[HEADER_LENGTH];
             infile.read(hdr, HEADER_LENGTH);
-            filename = make_filename((unsigned char *)hdr, filetype);
+            files.push_back({ make_filename((unsigned char *)hdr, filetype), offset, length, {} });
         }
-
-        fs::ofstream outfile(fmt::format(L"{}/{}", output, string_utils::utf_to_wide(filename)), std::ios::binary);
-        infile.seekg(offset);
-        std::vector<char> buffer(length);
-        infile.read(&buffer[0], length);
-        outfile.write(&buffer[0], length);
-
-        outfile.close();
     }
     infile.close();
+
+    return files;
 }
 
-static void decrypt_segments(std::ifstream &infile, const std::wstring &outdir, const std::wstring &filename, KeyStore &SCE_KEYS) {
+// Read only stream over a package in memory, for get_key_type and get_segments
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(std::vector<char> &data) {
+        setg(data.data(), data.data(), data.data() + data.size());
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        const off_type base = dir == std::ios_base::beg ? 0 : (dir == std::ios_base::cur ? gptr() - eback() : egptr() - eback());
+        const off_type target = base + off;
+        if (target < 0 || target > egptr() - eback())
+            return pos_type(off_type(-1));
+        setg(eback(), eback() + target, egptr());
+        return pos_type(target);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+static std::vector<uint8_t> decrypt_segments(std::vector<char> &package, KeyStore &SCE_KEYS) {
+    MemoryStreamBuf buffer(package);
+    std::istream infile(&buffer);
+
     char sceheaderbuffer[SceHeader::Size];
     infile.read(sceheaderbuffer, SceHeader::Size);
     const SceHeader sce_hdr = SceHeader(sceheaderbuffer);
@@ -175,69 +226,91 @@ static void decrypt_segments(std::ifstream &infile, const std::wstring &outdir,
     const auto sysver = std::get<0>(get_key_type(infile, sce_hdr));
     const SelfType selftype = std::get<1>(get_key_type(infile, sce_hdr));
 
+    // like the .seg02 files written before, a package gives the data of its last segment
+    std::vector<uint8_t> output;
     const auto scesegs = get_segments(infile, sce_hdr, SCE_KEYS, sysver, selftype);
     for (const auto &sceseg : scesegs) {
-        fs::ofstream outfile(fmt::format(L"{}/{}.seg02", outdir, filename), std::ios::binary);
-        infile.seekg(sceseg.offset);
-        std::vector<unsigned char> encrypted_data(sceseg.size);
-        infile.read((char *)&encrypted_data[0], sceseg.size);
+        if (sceseg.offset + sceseg.size > package.size()) {
+            LOG_ERROR("Segment out of the package bounds");
+            continue;
+        }
         aes_context aes_ctx;
         aes_setkey_enc(&aes_ctx, (unsigned char *)sceseg.key.c_str(), 128);
         size_t ctr_nc_off = 0;
         unsigned char ctr_stream_block[0x10];
         std::vector<unsigned char> decrypted_data(sceseg.size);
-        aes_crypt_ctr(&aes_ctx, sceseg.size, &ctr_nc_off, (unsigned char *)sceseg.iv.c_str(), ctr_stream_block, &encrypted_data[0], &decrypted_data[0]);
+        std::string iv = sceseg.iv;
+        aes_crypt_ctr(&aes_ctx, sceseg.size, &ctr_nc_off, (unsigned char *)iv.data(), ctr_stream_block, (unsigned char *)&package[sceseg.offset], &decrypted_data[0]);
         if (sceseg.compressed) {
             const std::string decompressed_data = decompress_segments(decrypted_data, sceseg.size);
-            outfile.write(decompressed_data.c_str(), decompressed_data.size());
+            output.assign(decompressed_data.begin(), decompressed_data.end());
         } else {
-            outfile.write((char *)&decrypted_data[0], sceseg.size);
-        }
-        outfile.close();
-    }
-};
-
-static void join_files(const std::wstring &path, const std::string &filename, const std::wstring &output) {
-    std::vector<std::string> files;
-
-    for (auto &p : fs::directory_iterator(path)) {
-        if (p.path().filename().string().substr(0, 4) == filename) {
-            files.push_back(p.path().string());
+            output = std::move(decrypted_data);
         }
     }
 
-    std::sort(files.begin(), files.end());
-
-    fs::ofstream fileout(output, std::ios::binary);
-    for (const auto &file : files) {
-        fs::ifstream filein(file, std::ios::binary);
-        std::vector<char> buffer(fs::file_size(file));
-        filein.read(&buffer[0], fs::file_size(file));
-        fileout.write(&buffer[0], fs::file_size(file));
-        filein.close();
-        fs::remove(file);
-    }
-    fileout.close();
+    return output;
 }
 
-static void decrypt_pup_packages(const std::wstring &src, const std::wstring &dest, KeyStore &SCE_KEYS) {
-    std::vector<std::wstring> pkgfiles;
+// Run job(i) for i in [0, count) on up to max_threads threads
+template <typename Job>
+static void parallel_for(size_t count, size_t max_threads, const Job &job) {
+    std::atomic<size_t> next = 0;
+    const auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++)
+            job(i);
+    };
+
+    const size_t num_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(std::min(count, max_threads), 1));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+}
 
-    for (const auto &p : fs::directory_iterator(src)) {
-        if (p.path().filename().extension().string() == ".pkg")
-            pkgfiles.push_back(p.path().filename().generic_wstring());
+/**
+ * \brief Decrypt the firmware packages on several threads and join them into their FAT image.
+ *
+ * Each worker reads its package from the PUP, decrypts and inflates it in memory, so nothing
+ * goes through temporary files.
+ */
+static std::map<std::string, std::vector<uint8_t>> decrypt_pup_packages(const std::wstring &pup, std::vector<PupFile> &files, KeyStore &SCE_KEYS) {
+    std::vector<PupFile *> packages;
+    for (auto &file : files) {
+        if (is_firmware_package(file.filename))
+            packages.push_back(&file);
     }
 
-    for (const auto &filename : pkgfiles) {
-        const std::wstring &filepath = fmt::format(L"{}/{}", src, filename);
-        fs::ifstream infile(filepath, std::ios::binary);
-        decrypt_segments(infile, dest, filename, SCE_KEYS);
-        infile.close();
+    parallel_for(packages.size(), 8, [&](size_t i) {
+        PupFile &file = *packages[i];
+        fs::ifstream infile(pup, std::ios::binary);
+        infile.seekg(file.offset);
+        std::vector<char> package(file.length);
+        infile.read(package.data(), file.length);
+        if (!infile) {
+            LOG_ERROR("Failed to read {} from the PUP", file.filename);
+            return;
+        }
+        file.data = decrypt_segments(package, SCE_KEYS);
+    });
+
+    // the packages of an image are numbered in order, os0-00.pkg, os0-01.pkg...
+    std::sort(packages.begin(), packages.end(), [](const PupFile *a, const PupFile *b) { return a->filename < b->filename; });
+
+    std::map<std::string, std::vector<uint8_t>> images;
+    for (const char *image : FIRMWARE_IMAGES) {
+        auto &data = images[image];
+        for (PupFile *file : packages) {
+            if (file->filename.starts_with(fmt::format("{}-", image))) {
+                data.insert(data.end(), file->data.begin(), file->data.end());
+                file->data = {};
+            }
+        }
     }
 
-    join_files(dest, "os0-", dest + L"/os0.img");
-    join_files(dest, "vs0-", dest + L"/vs0.img");
-    join_files(dest, "sa0-", dest + L"/sa0.img");
+    return images;
 }
 
 void install_pup(const std::wstring &pref_path, const std::string &pup_path, const std::function<void(uint32_t)> &progress_callback) {
@@ -253,39 +326,33 @@ void install_pup(const std::wstring &pref_path, const std::string &pup_path, con
     fs::create_directory(pup_dest);
     progress_callback(10);
 
-    extract_pup_files(string_utils::utf_to_wide(pup_path), pup_dest);
-
-    const auto pup_dec = fmt::format(L"{}/PUP_dec", pref_path + L"/PUP_DEC");
-    fs::create_directory(pup_dec);
+    const std::wstring pup = string_utils::utf_to_wide(pup_path);
+    std::vector<PupFile> files = extract_pup_files(pup, pup_dest);
 
     KeyStore SCE_KEYS;
     register_keys(SCE_KEYS, 0);
 
     progress_callback(30);
-    decrypt_pup_packages(pup_dest, pup_dec, SCE_KEYS);
+    const auto images = decrypt_pup_packages(pup, files, SCE_KEYS);
 
+    // the images are independent, extract them and decrypt their modules in parallel
     progress_callback(70);
-    if (fs::file_size(pup_dec + L"/os0.img") > 0) {
-        extract_fat(pup_dec, "os0.img", pref_path);
-        for (const auto &file : fs::recursive_directory_iterator(pref_path + L"/os0")) {
-            if (fs::is_regular_file(file.path())) {
-                if (is_self(file.path())) {
-                    decrypt_fself(file.path(), SCE_KEYS, 0);
-                }
-            }
+    parallel_for(std::size(FIRMWARE_IMAGES), std::size(FIRMWARE_IMAGES), [&](size_t i) {
+        const std::string image = FIRMWARE_IMAGES[i];
+        const std::vector<uint8_t> &data = images.at(image);
+        if (data.empty())
+            return;
+
+        extract_fat(data, image + ".img", pref_path);
+        if (image == "sa0")
+            return;
+
+        std::vector<fs::path> selfs;
+        for (const auto &file : fs::recursive_directory_iterator(pref_path + L"/" + string_utils::utf_to_wide(image))) {
+            if (fs::is_regular_file(file.path()) && is_self(file.path()))
+                selfs.push_back(file.path());
         }
-    }
-    if (fs::file_size(pup_dec + L"/sa0.img") > 0)
-        extract_fat(pup_dec, "sa0.img", pref_path);
-    if (fs::file_size(pup_dec + L"/vs0.img") > 0) {
-        extract_fat(pup_dec, "vs0.img", pref_path);
-        for (const auto &file : fs::recursive_directory_iterator(pref_path + L"/vs0")) {
-            if (fs::is_regular_file(file.path())) {
-                if (is_self(file.path())) {
-                    decrypt_fself(file.path(), SCE_KEYS, 0);
-                }
-            }
-        }
-    }
+        decrypt_fselfs(selfs, SCE_KEYS, 0);
+    });
     progress_callback(100);
 }
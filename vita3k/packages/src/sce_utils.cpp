@@ -21,6 +21,7 @@
  */
 
 #include <crypto/aes.h>
+#include <crypto/hash.h>
 #include <fat16/fat16.h>
 #include <miniz.h>
 #include <packages/sce_types.h>
@@ -28,7 +29,10 @@
 
 #include <self.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <thread>
 
 // Credits to TeamMolecule for their original work on this https://github.com/TeamMolecule/sceutils
 
@@ -682,43 +686,84 @@ void extract_fat(const std::wstring &partition_path, const std::string &partitio
     fclose(f);
 }
 
-std::string decompress_segments(const std::vector<uint8_t> &decrypted_data, const uint64_t &size) {
-    mz_stream stream;
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-    stream.avail_in = 0;
-    stream.next_in = Z_NULL;
+void extract_fat(const std::vector<uint8_t> &image, const std::string &partition, const std::wstring &pref_path) {
+    struct ImageCursor {
+        const std::vector<uint8_t> &image;
+        size_t pos;
+    } cursor{ image, 0 };
+
+    Fat16::Image img(
+        &cursor,
+        // Read hook
+        [](void *userdata, void *buffer, std::uint32_t size) -> std::uint32_t {
+            ImageCursor &cursor = *static_cast<ImageCursor *>(userdata);
+            const size_t count = std::min<size_t>(size, cursor.image.size() - std::min(cursor.pos, cursor.image.size()));
+            memcpy(buffer, cursor.image.data() + cursor.pos, count);
+            cursor.pos += count;
+            return static_cast<std::uint32_t>(count);
+        },
+        // Seek hook
+        [](void *userdata, std::uint32_t offset, int mode) -> std::uint32_t {
+            ImageCursor &cursor = *static_cast<ImageCursor *>(userdata);
+            const size_t base = mode == Fat16::IMAGE_SEEK_MODE_BEG ? 0 : (mode == Fat16::IMAGE_SEEK_MODE_CUR ? cursor.pos : cursor.image.size());
+            cursor.pos = base + static_cast<int32_t>(offset);
+
+            return static_cast<std::uint32_t>(cursor.pos);
+        });
+
+    Fat16::Entry first;
+    traverse_directory(img, first, pref_path + std::wstring{ fs::path::preferred_separator } + string_utils::utf_to_wide(partition.substr(0, 3)));
+}
+
+// Inflates the whole segment in one call, returns MZ_STREAM_END on success and MZ_BUF_ERROR if dest is too small
+static int inflate_segment(const uint8_t *compressed, size_t compressed_size, uint8_t *dest, size_t dest_size, size_t &decompressed_size) {
+    mz_stream stream = {};
     if (mz_inflateInit(&stream) != MZ_OK) {
         LOG_ERROR("inflateInit failed while decompressing");
-        return "";
+        return MZ_STREAM_ERROR;
     }
 
-    const std::string compressed_data((char *)&decrypted_data[0], size);
-    stream.next_in = (Bytef *)compressed_data.data();
-    stream.avail_in = compressed_data.size();
-
-    int ret = 0;
-    char outbuffer[4096];
-    std::string decompressed_data;
+    // MZ_FINISH on the first call makes miniz inflate straight into dest without going through its window
+    stream.next_in = compressed;
+    stream.avail_in = static_cast<unsigned int>(compressed_size);
+    stream.next_out = dest;
+    stream.avail_out = static_cast<unsigned int>(dest_size);
+    const int ret = mz_inflate(&stream, MZ_FINISH);
+    decompressed_size = stream.total_out;
+    mz_inflateEnd(&stream);
 
-    do {
-        stream.next_out = reinterpret_cast<Bytef *>(outbuffer);
-        stream.avail_out = sizeof(outbuffer);
+    return ret;
+}
 
-        ret = mz_inflate(&stream, 0);
+bool decompress_segment(const uint8_t *compressed, size_t compressed_size, uint8_t *dest, size_t dest_size, size_t *decompressed_size) {
+    size_t size = 0;
+    const int ret = inflate_segment(compressed, compressed_size, dest, dest_size, size);
+    if (decompressed_size)
+        *decompressed_size = size;
 
-        if (decompressed_data.size() < stream.total_out) {
-            decompressed_data.append(outbuffer, stream.total_out - decompressed_data.size());
-        }
-    } while (ret == MZ_OK);
+    if (ret != MZ_STREAM_END) {
+        LOG_ERROR("Exception during zlib decompression: ({}) {}", ret, ret == MZ_BUF_ERROR ? "destination too small" : "invalid data");
+        return false;
+    }
+    return true;
+}
 
-    mz_inflateEnd(&stream);
+std::string decompress_segments(const std::vector<uint8_t> &decrypted_data, const uint64_t &size) {
+    // the decompressed size is not known here, start from an estimate and retry with a bigger buffer if it does not fit
+    // deflate cannot compress more than 1032:1, which bounds the retries
+    const size_t max_size = std::max<size_t>(size * 1032, 0x10000);
+    std::string decompressed_data(std::max<size_t>(size * 4, 0x10000), '\0');
+    size_t decompressed_size = 0;
+    int ret;
+    while ((ret = inflate_segment(decrypted_data.data(), size, reinterpret_cast<uint8_t *>(decompressed_data.data()), decompressed_data.size(), decompressed_size)) == MZ_BUF_ERROR
+        && decompressed_data.size() < max_size)
+        decompressed_data.resize(std::min(decompressed_data.size() * 2, max_size));
 
     if (ret != MZ_STREAM_END) {
-        LOG_ERROR("Exception during zlib decompression: ({}) {}", ret, stream.msg);
+        LOG_ERROR("Exception during zlib decompression: ({}) invalid data", ret);
         return "";
     }
+    decompressed_data.resize(decompressed_size);
     return decompressed_data;
 }
 
@@ -851,10 +896,13 @@ void self2elf(const fs::path &infile, const fs::path &outfile, KeyStore &SCE_KEY
         }
 
         if (segment_infos[idx].compressed == SecureBool::YES) {
-            const std::string decompressed_data = decompress_segments(decrypted_data, segment_infos[idx].size);
+            // the program header gives the decompressed size, inflate into a buffer of that size
+            std::vector<uint8_t> decompressed_data(elf_phdrs[idx].p_filesz);
+            size_t decompressed_size = 0;
+            decompress_segment(decrypted_data.data(), segment_infos[idx].size, decompressed_data.data(), decompressed_data.size(), &decompressed_size);
             segment_infos[idx].compressed = SecureBool::NO;
-            fileout.write(decompressed_data.c_str(), decompressed_data.length());
-            at += decompressed_data.length();
+            fileout.write(reinterpret_cast<const char *>(decompressed_data.data()), decompressed_size);
+            at += decompressed_size;
         } else {
             fileout.write((char *)&decrypted_data[0], segment_infos[idx].size);
             at += segment_infos[idx].size;
@@ -983,7 +1031,7 @@ void make_fself(const fs::path &input_file, const fs::path &output_file, uint64_
     fileout.close();
 }
 
-std::vector<SceSegment> get_segments(std::ifstream &file, const SceHeader &sce_hdr, KeyStore &SCE_KEYS, const uint64_t sysver, const SelfType self_type, int keytype, unsigned char *klictxt) {
+std::vector<SceSegment> get_segments(std::istream &file, const SceHeader &sce_hdr, KeyStore &SCE_KEYS, const uint64_t sysver, const SelfType self_type, int keytype, unsigned char *klictxt) {
     file.seekg(sce_hdr.metadata_offset + 48);
     std::vector<char> dat(sce_hdr.header_length - sce_hdr.metadata_offset - 48);
     file.read(&dat[0], sce_hdr.header_length - sce_hdr.metadata_offset - 48);
@@ -1057,7 +1105,7 @@ std::vector<SceSegment> get_segments(std::ifstream &file, const SceHeader &sce_h
     return segs;
 }
 
-std::tuple<uint64_t, SelfType> get_key_type(std::ifstream &file, const SceHeader &sce_hdr) {
+std::tuple<uint64_t, SelfType> get_key_type(std::istream &file, const SceHeader &sce_hdr) {
     if (sce_hdr.sce_type == SceType::SELF) {
         file.seekg(32);
         char selfheaderbuffer[SelfHeader::Size];
@@ -1101,6 +1149,58 @@ void decrypt_fself(const fs::path &file_path, KeyStore &SCE_KEYS, unsigned char
     fs::rename(np, file_path);
 }
 
+// Key of a decrypted SELF in the cache, the hash of the encrypted file and of the klicensee used
+static std::string get_fself_cache_key(const fs::path &file_path, const unsigned char *klictxt) {
+    fs::ifstream file(file_path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (klictxt)
+        data.insert(data.end(), klictxt, klictxt + 16);
+    const std::string hash = hex_string(sha256(data.data(), data.size()));
+    return hash.c_str();
+}
+
+void decrypt_fselfs(const std::vector<fs::path> &files, KeyStore &SCE_KEYS, unsigned char *klictxt, const fs::path &cache_path) {
+    if (!cache_path.empty())
+        fs::create_directories(cache_path);
+
+    std::atomic<size_t> next = 0;
+    const auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            const fs::path &file_path = files[i];
+            if (cache_path.empty()) {
+                decrypt_fself(file_path, SCE_KEYS, klictxt);
+                continue;
+            }
+
+            // the same executable is often installed again (reinstall, patch over an unchanged module)
+            const fs::path cached = cache_path / (get_fself_cache_key(file_path, klictxt) + ".self");
+            boost::system::error_code ec;
+            if (fs::exists(cached)) {
+                fs::copy_file(cached, file_path, fs::copy_options::overwrite_existing, ec);
+                if (!ec) {
+                    LOG_INFO("Decrypted {} from the cache", file_path.string());
+                    continue;
+                }
+            }
+
+            // identical files of the title may be decrypted at the same time, publish the cache entry with a rename
+            decrypt_fself(file_path, SCE_KEYS, klictxt);
+            const fs::path temp = cached.string() + "." + std::to_string(i) + ".tmp";
+            fs::copy_file(file_path, temp, fs::copy_options::overwrite_existing, ec);
+            if (!ec)
+                fs::rename(temp, cached, ec);
+        }
+    };
+
+    const size_t num_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(std::min<size_t>(files.size(), 8), 1));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+}
+
 bool is_self(const fs::path &file_path) {
     const auto extension = file_path.filename().extension();
     const auto is_self = ((extension == ".suprx") || (extension == ".skprx") || (extension == ".self"));
@@ -25,6 +25,8 @@
 namespace regmgr {
 
 void init_regmgr(RegMgrState &regmgr, const std::wstring &pref_path);
+// Writes the pending changes of the registry to system.dreg and stops the flush thread
+void flush_regmgr(RegMgrState &regmgr);
 
 // Getters and setters for binary values
 void get_bin_value(RegMgrState &regmgr, const std::string &category, const std::string &name, void *buf, uint32_t bufSize);
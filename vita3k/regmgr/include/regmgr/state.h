@@ -17,9 +17,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <map>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 struct RegMgrState {
@@ -27,4 +30,16 @@ struct RegMgrState {
     std::wstring system_dreg_path;
 
     std::map<std::string, std::map<std::string, std::vector<char>>> system_dreg;
+
+    // the values are set in memory, system.dreg is written by the flush thread once they stop changing
+    bool dirty = false;
+    std::chrono::steady_clock::time_point first_change;
+    std::chrono::steady_clock::time_point last_change;
+    std::thread flush_thread;
+    std::condition_variable flush_cond;
+    bool stop_flush = false;
+
+    RegMgrState() = default;
+    // writes the pending changes
+    ~RegMgrState();
 };
@@ -309,6 +309,62 @@ static void init_system_dreg(RegMgrState &regmgr) {
     save_system_dreg(regmgr);
 }
 
+// a change is written once no other one is done during FLUSH_DELAY, but never later than MAX_FLUSH_DELAY after it
+static constexpr auto FLUSH_DELAY = std::chrono::seconds(1);
+static constexpr auto MAX_FLUSH_DELAY = std::chrono::seconds(5);
+
+static void flush_thread_main(RegMgrState &regmgr) {
+    std::unique_lock<std::mutex> lock(regmgr.mutex);
+    while (true) {
+        regmgr.flush_cond.wait(lock, [&] { return regmgr.stop_flush || regmgr.dirty; });
+        if (regmgr.stop_flush)
+            return;
+
+        const auto deadline = std::min(regmgr.last_change + FLUSH_DELAY, regmgr.first_change + MAX_FLUSH_DELAY);
+        if (regmgr.flush_cond.wait_until(lock, deadline, [&] { return regmgr.stop_flush; }))
+            return;
+        // a later change postponed the write
+        if (std::chrono::steady_clock::now() < std::min(regmgr.last_change + FLUSH_DELAY, regmgr.first_change + MAX_FLUSH_DELAY))
+            continue;
+
+        save_system_dreg(regmgr);
+        regmgr.dirty = false;
+    }
+}
+
+// must be called with the mutex locked
+static void mark_dirty(RegMgrState &regmgr) {
+    const auto now = std::chrono::steady_clock::now();
+    if (!regmgr.dirty)
+        regmgr.first_change = now;
+    regmgr.last_change = now;
+    regmgr.dirty = true;
+
+    if (!regmgr.flush_thread.joinable()) {
+        regmgr.stop_flush = false;
+        regmgr.flush_thread = std::thread(flush_thread_main, std::ref(regmgr));
+    }
+    regmgr.flush_cond.notify_one();
+}
+
+void flush_regmgr(RegMgrState &regmgr) {
+    std::thread flush_thread;
+    {
+        const std::lock_guard<std::mutex> lock(regmgr.mutex);
+        regmgr.stop_flush = true;
+        flush_thread = std::move(regmgr.flush_thread);
+    }
+    regmgr.flush_cond.notify_one();
+    if (flush_thread.joinable())
+        flush_thread.join();
+
+    const std::lock_guard<std::mutex> lock(regmgr.mutex);
+    if (regmgr.dirty) {
+        save_system_dreg(regmgr);
+        regmgr.dirty = false;
+    }
+}
+
 static bool reg_category_or_name_is_empty(const std::string &category, const std::string &name) {
     return reg_template.empty() || category.empty() || name.empty();
 }
@@ -337,7 +393,7 @@ static std::string set_default_value(RegMgrState &regmgr, const std::string &cat
 
     LOG_INFO("Successfully set default value for {}{}", category, name);
 
-    save_system_dreg(regmgr);
+    mark_dirty(regmgr);
 
     return std::string(reg->init_value.begin(), reg->init_value.end());
 }
@@ -361,7 +417,7 @@ void set_bin_value(RegMgrState &regmgr, const std::string &category, const std::
     const char *data = reinterpret_cast<const char *>(buf);
     regmgr.system_dreg[fix_category(category)][name].assign(data, data + bufSize);
 
-    save_system_dreg(regmgr);
+    mark_dirty(regmgr);
 }
 
 int32_t get_int_value(RegMgrState &regmgr, const std::string &category, const std::string &name) {
@@ -383,7 +439,7 @@ void set_int_value(RegMgrState &regmgr, const std::string &category, const std::
 
     *reinterpret_cast<int32_t *>(regmgr.system_dreg[fix_category(category)][name].data()) = byte_swap(value);
 
-    save_system_dreg(regmgr);
+    mark_dirty(regmgr);
 }
 
 std::string get_str_value(RegMgrState &regmgr, const std::string &category, const std::string &name) {
@@ -403,10 +459,13 @@ void set_str_value(RegMgrState &regmgr, const std::string &category, const std::
     std::lock_guard<std::mutex> lock(regmgr.mutex);
     regmgr.system_dreg[fix_category(category)][name].assign(value, value + bufSize);
 
-    save_system_dreg(regmgr);
+    mark_dirty(regmgr);
 }
 
 void init_regmgr(RegMgrState &regmgr, const std::wstring &pref_path) {
+    // the changes made to the registry of the previous path are written first
+    flush_regmgr(regmgr);
+
     // Load the registry template
     const auto reg = decryptRegistryFile(fs::path(pref_path) / "os0/kd/registry.db0");
     if (reg.empty()) {
@@ -560,3 +619,7 @@ std::pair<std::string, std::string> get_category_and_name_by_id(const int id, co
 }
 
 } // namespace regmgr
+
+RegMgrState::~RegMgrState() {
+    regmgr::flush_regmgr(*this);
+}
@@ -0,0 +1,153 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <gxm/types.h>
+#include <mem/util.h>
+#include <renderer/commands.h>
+#include <util/fs.h>
+
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+struct Config;
+struct DisplayState;
+struct FeatureState;
+struct MemState;
+
+namespace renderer {
+
+struct Context;
+struct RenderTarget;
+struct State;
+
+enum class CaptureRecord : uint8_t;
+
+/**
+ * \brief Records the commands processed by the renderer for a number of frames.
+ *
+ * The capture starts with a snapshot of the guest memory and the objects the renderer already holds (contexts,
+ * render targets, mapped memory), then every command is written with the host objects it points to. The ranges of
+ * guest memory read by the draws (uniform buffers, vertex streams and indices) are written again whenever their
+ * content changes, so the frames can be replayed by CaptureReplay without the game.
+ */
+class CommandCapture {
+public:
+    // Starts the capture at the next frame, can be called from any thread
+    void request(const fs::path &path, uint32_t frame_count);
+    bool is_capturing() const {
+        return capturing;
+    }
+
+    // Called by the renderer thread around each processed command, before_command only while capturing
+    void before_command(State &state, MemState &mem, Command &cmd, Context *context);
+    void after_command(State &state, MemState &mem, Command &cmd, Context *context);
+
+private:
+    void begin(State &state, MemState &mem);
+    void end();
+    uint32_t get_context_id(Context *context) const;
+    uint32_t get_render_target_id(RenderTarget *render_target) const;
+    void write_command(const Command &cmd, Context *context, const void *extra = nullptr, uint32_t extra_size = 0);
+    void write_memory(MemState &mem, Address address, uint32_t size);
+    void write_program(MemState &mem, Address address, bool is_fragment);
+    void write_context_state(MemState &mem, Context *context);
+
+    // objects held by the renderer, tracked even when nothing is captured
+    std::map<Context *, uint32_t> contexts;
+    std::map<RenderTarget *, std::pair<uint32_t, SceGxmRenderTargetParams>> render_targets;
+    std::map<Address, uint32_t> mapped_memories;
+    uint32_t next_id = 1;
+    // params of the render target being created, copied before the command is completed
+    std::unique_ptr<SceGxmRenderTargetParams> pending_params;
+
+    std::mutex request_mutex;
+    std::atomic<bool> requested = false;
+    fs::path requested_path;
+    uint32_t requested_frames = 0;
+
+    std::atomic<bool> capturing = false;
+    std::ofstream file;
+    std::vector<char> file_buffer;
+    fs::path path;
+    std::streampos frame_count_position;
+    uint32_t frames_left = 0;
+    uint32_t frames_captured = 0;
+    std::set<Address> written_programs;
+    // last content written for each range of memory, only the ranges which changed are written again
+    std::map<Address, std::vector<uint8_t>> written_memory;
+};
+
+/**
+ * \brief Feeds the frames recorded by CommandCapture to the renderer.
+ *
+ * The memory of the capture is restored into the guest memory, which must be initialized and free of the game.
+ */
+class CaptureReplay {
+public:
+    // Restores the memory of the capture and creates again the objects the renderer held when it started
+    bool open(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display, const fs::path &path);
+    // Processes all the commands of the next frame and sets it as the frame to display,
+    // returns false once every frame was replayed
+    bool replay_frame(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display);
+    // Destroys the objects created for the replay
+    void close(State &state, const FeatureState &features, MemState &mem, Config &config);
+
+    uint32_t get_frame_count() const {
+        return frame_count;
+    }
+
+    CaptureReplay() = default;
+    CaptureReplay(const CaptureReplay &) = delete;
+    CaptureReplay &operator=(const CaptureReplay &) = delete;
+
+private:
+    // Returns the record which ended the frame, CaptureRecord::End on error
+    CaptureRecord read_records(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display);
+    bool read_command(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display);
+    bool read_program(State &state, MemState &mem);
+    bool read_context_state(State &state, MemState &mem);
+    void process(State &state, const FeatureState &features, MemState &mem, Config &config, Command *cmd, Context *context);
+    void flush(State &state, const FeatureState &features, MemState &mem, Config &config);
+
+    std::ifstream file;
+    std::vector<char> file_buffer;
+    std::string title_id;
+    std::string self_name;
+    uint32_t frame_count = 0;
+
+    std::map<uint32_t, std::unique_ptr<Context>> contexts;
+    std::map<uint32_t, std::unique_ptr<RenderTarget>> render_targets;
+    std::map<uint32_t, SceGxmRenderTargetParams> render_target_params;
+    // programs built again in the guest memory, over the ones of the game which point to its host objects
+    std::vector<Address> fragment_programs;
+    std::vector<Address> vertex_programs;
+
+    // commands of the same context are processed together, like in a command list of the game
+    CommandList pending{};
+    // the commands are never waited for
+    int status = 0;
+};
+
+} // namespace renderer
@@ -20,6 +20,8 @@
 #include <cassert>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <dlmalloc.h>
@@ -49,6 +51,11 @@ enum class CommandOpcode : std::uint8_t {
      */
     Draw,
 
+    /**
+     * Do draw, with the vertex streams it uses packed in the same record.
+     */
+    DrawPacked,
+
     /**
      * Transfer functions
      */
@@ -98,7 +105,9 @@ constexpr std::size_t MAX_COMMAND_DATA_SIZE = 0x20;
 struct Command {
     enum {
         FLAG_FROM_HOST = 1 << 0,
-        FLAG_NO_FREE = 1 << 1
+        FLAG_NO_FREE = 1 << 1,
+        // Only holds the tail of the data of the command before it, it is never dispatched by itself
+        FLAG_PAYLOAD = 1 << 2
     };
 
     CommandOpcode opcode;
@@ -110,7 +119,40 @@ struct Command {
     Command *next = nullptr;
 };
 
-using CommandPool = std::vector<Command>;
+/**
+ * \brief Recycles host-allocated commands in bulk.
+ *
+ * Commands are carved out of blocks, the producer refills its free list once per batch of commands and the
+ * renderer thread gives released commands back once per processed command list, so neither side goes
+ * through the heap for every command.
+ */
+class CommandArena {
+public:
+    Command *allocate();
+    // The command is only reused after the next flush_released()
+    void release(Command *cmd);
+    void flush_released();
+
+    CommandArena() = default;
+    CommandArena(const CommandArena &) = delete;
+    CommandArena &operator=(const CommandArena &) = delete;
+
+private:
+    static constexpr std::size_t BLOCK_SIZE = 256;
+
+    // taken by producers only
+    std::mutex alloc_mutex;
+    std::vector<Command *> local_free;
+
+    // taken by the renderer thread only, except when a command could not be built
+    std::mutex release_mutex;
+    std::vector<Command *> released;
+
+    // where both sides exchange commands
+    std::mutex shared_mutex;
+    std::vector<Command *> shared_free;
+    std::vector<std::unique_ptr<Command[]>> blocks;
+};
 
 // It's to split a command list easier when ExecuteCommandList is used.
 struct CommandList {
@@ -154,6 +196,35 @@ struct CommandHelper {
         return *data;
     }
 
+    // Variable-length records carry on in FLAG_PAYLOAD commands allocated right after the first one
+    template <typename T>
+    bool push_packed(T &val, const CommandAllocFunc &alloc_func) {
+        if (point + sizeof(T) > MAX_COMMAND_DATA_SIZE) {
+            Command *payload = alloc_func();
+            payload->opcode = cmd->opcode;
+            payload->flags |= Command::FLAG_PAYLOAD;
+            payload->status = nullptr;
+            payload->next = nullptr;
+
+            cmd->next = payload;
+            cmd = payload;
+            point = 0;
+        }
+
+        return push(val);
+    }
+
+    template <typename T>
+    T pop_packed() {
+        if (point + sizeof(T) > MAX_COMMAND_DATA_SIZE) {
+            assert(cmd->next && (cmd->next->flags & Command::FLAG_PAYLOAD));
+            cmd = cmd->next;
+            point = 0;
+        }
+
+        return pop<T>();
+    }
+
     void complete(const int code) {
         *cmd->status = code;
     }
@@ -173,7 +244,7 @@ bool do_command_push_data(CommandHelper &helper, Head arg1, Args... args2) {
 }
 
 template <typename... Args>
-Command *make_command(CommandAllocFunc alloc_func, CommandFreeFunc free_func, const CommandOpcode opcode, int *status, Args... arguments) {
+Command *make_command(const CommandAllocFunc &alloc_func, const CommandFreeFunc &free_func, const CommandOpcode opcode, int *status, Args... arguments) {
     Command *new_command = alloc_func();
 
     new_command->opcode = opcode;
@@ -64,6 +64,7 @@ COMMAND(handle_sync_surface_data);
 COMMAND(handle_mid_scene_flush);
 
 COMMAND(handle_draw);
+COMMAND(handle_draw_packed);
 
 COMMAND(handle_transfer_copy);
 COMMAND(handle_transfer_downscale);
@@ -51,11 +51,21 @@ bool wishlist(SceGxmSyncObject *sync_object, const uint32_t timestamp, const int
  */
 void subject_done(SceGxmSyncObject *sync_object, const uint32_t timestamp);
 
+/**
+ * \brief Write the notification value then wake up the threads waiting on its address.
+ */
+void signal_notification(State &state, const MemState &mem, const SceGxmNotification &notification);
+
+/**
+ * \brief Wait until the notification address holds the notification value.
+ */
+void wait_notification(State &state, const MemState &mem, const SceGxmNotification &notification);
+
 int wait_for_status(State &state, int *status, int signal, bool wake_on_equal);
 void reset_command_list(CommandList &command_list);
 void submit_command_list(State &state, renderer::Context *context, CommandList &command_list);
 bool is_cmd_ready(MemState &mem, CommandList &command_list);
-void process_batch(State &state, MemState &mem, Config &config, CommandList &command_list);
+void process_batch(State &state, const FeatureState &features, MemState &mem, Config &config, CommandList &command_list);
 void process_batches(State &state, const FeatureState &features, MemState &mem, Config &config);
 bool init(SDL_Window *window, std::unique_ptr<State> &state, Backend backend, const Config &config, const Root &root_paths);
 
@@ -81,6 +91,9 @@ void set_visibility_index(State &state, Context *ctx, bool enable, uint32_t inde
 void set_context(State &state, Context *ctx, RenderTarget *target, SceGxmColorSurface *color_surface, SceGxmDepthStencilSurface *depth_stencil_surface);
 void set_vertex_stream(State &state, Context *ctx, const std::size_t index, const std::size_t data_len, const Ptr<const void> stream);
 void draw(State &state, Context *ctx, SceGxmPrimitiveType prim_type, SceGxmIndexFormat index_type, Ptr<const void> index_data, const std::uint32_t index_count, const std::uint32_t instance_count);
+// Same as set_vertex_stream for every stream in stream_mask followed by draw, but recorded as a single command
+void draw_packed(State &state, Context *ctx, SceGxmPrimitiveType prim_type, SceGxmIndexFormat index_type, Ptr<const void> index_data, const std::uint32_t index_count, const std::uint32_t instance_count,
+    const std::uint16_t stream_mask, const GXMStreamInfo *streams);
 void transfer_copy(State &state, uint32_t colorKeyValue, uint32_t colorKeyMask, SceGxmTransferColorKeyMode colorKeyMode, const SceGxmTransferImage *images, SceGxmTransferType srcType, SceGxmTransferType destType);
 void transfer_downscale(State &state, const SceGxmTransferImage *src, const SceGxmTransferImage *dest);
 void transfer_fill(State &state, uint32_t fillColor, const SceGxmTransferImage *dest);
@@ -32,6 +32,8 @@ public:
 
     void insert();
     bool wait_for_signal();
+    // return true once the commands before the fence are done, without waiting for them
+    bool poll();
 
     bool empty() const {
         return !sync_;
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <renderer/gl/fence.h>
 #include <renderer/gl/screen_render.h>
 #include <renderer/gl/surface_cache.h>
 #include <renderer/state.h>
@@ -38,14 +39,39 @@ struct GLState : public renderer::State {
     ShaderCache fragment_shader_cache;
     ShaderCache vertex_shader_cache;
     ProgramCache program_cache;
+    // programs still being compiled, the draws using them are skipped until they are done
+    PendingPrograms pending_programs;
 
     GLTextureCache texture_cache;
     GLSurfaceCache surface_cache;
 
     ScreenRenderer screen_renderer;
 
+    // the back buffer is read to this pixel pack buffer for a screenshot, it is given to the screenshot writer
+    // once its fence is signaled, so the renderer never waits for the readback
+    GLObjectArray<1> screenshot_buffer;
+    GLsizeiptr screenshot_buffer_size = 0;
+    Fence screenshot_fence;
+    uint32_t screenshot_width = 0;
+    uint32_t screenshot_height = 0;
+    bool screenshot_pending = false;
+
+    // last program and mask texture bound when drawing, used to skip redundant binds
+    // the screen renderer restores the program it changes
+    GLuint bound_program = 0;
+    GLuint bound_mask_texture = 0;
+
+    // vendor, renderer and version of the driver, program binaries are only reused on the same one
+    // empty if the driver does not support any program binary format
+    std::string program_binary_driver;
+
+    // support for GL_KHR_parallel_shader_compile, the shaders can then be compiled without waiting for them
+    bool support_parallel_compile = false;
+    bool use_async_compilation = false;
+
     bool init(const fs::path &static_assets, const bool hashless_texture_cache) override;
     void late_init(const Config &cfg, const std::string_view game_id, MemState &mem) override;
+    uint32_t get_features_mask() override;
 
     TextureCache *get_texture_cache() override {
         return &texture_cache;
@@ -59,8 +85,13 @@ struct GLState : public renderer::State {
     int get_max_anisotropic_filtering() override;
     void set_anisotropic_filtering(int anisotropic_filtering) override;
 
+    void set_async_compilation(bool enable) override;
     void precompile_shader(const ShadersHash &hash) override;
     void preclose_action() override;
+
+private:
+    void read_screenshot(SDL_Window *window);
+    void submit_screenshot();
 };
 
 } // namespace renderer::gl
@@ -81,6 +81,8 @@ private:
     static constexpr std::uint32_t MAX_CACHE_SIZE_PER_CONTAINER = 20;
 
     std::map<std::uint64_t, std::unique_ptr<GLColorSurfaceCacheInfo>, std::greater<std::uint64_t>> color_surface_textures;
+    // range covered by each surface of color_surface_textures
+    SurfaceIntervalTree<GLColorSurfaceCacheInfo *> color_surface_ranges;
     std::array<GLDepthStencilSurfaceCacheInfo, MAX_CACHE_SIZE_PER_CONTAINER> depth_stencil_textures;
     std::unordered_map<std::uint64_t, GLObjectArray<1>> framebuffer_array;
 
@@ -93,6 +95,7 @@ private:
     const GLRenderTarget *target = nullptr;
 
 private:
+    void erase_color_surface(std::uint64_t key);
     void do_typeless_copy(const GLuint dest_texture, const GLuint source_texture, const GLenum dest_internal,
         const GLenum dest_upload_format, const GLenum dest_type, const GLenum source_format, const GLenum source_type,
         const int offset_x, const int offset_y, const int width, const int height, const int dest_width, const int dest_height, const std::size_t total_source_size);
@@ -100,6 +103,10 @@ private:
 public:
     explicit GLSurfaceCache();
 
+    // modified when retrieving the framebuffer, estimates if it is safe to skip the draws whose program is still compiling
+    // (i.e that it does not causes permanent graphical issues)
+    bool can_use_deferred_compilation = false;
+
     GLuint retrieve_color_surface_texture_handle(const State &state, std::uint16_t width, std::uint16_t height, const std::uint16_t pixel_stride,
         const SceGxmColorBaseFormat color_format, Ptr<void> address, SurfaceTextureRetrievePurpose purpose, std::uint32_t &swizzle,
         std::uint16_t *stored_height = nullptr, std::uint16_t *stored_width = nullptr);
@@ -50,6 +50,16 @@ inline bool operator==(const ExcludedUniform &lhs, const ExcludedUniform &rhs) {
 
 typedef std::map<Sha256Hash, SharedGLObject> ShaderCache;
 typedef std::map<ProgramHashes, SharedGLObject> ProgramCache;
+
+// program linked by the driver while the emulation goes on (GL_KHR_parallel_shader_compile)
+struct PendingProgram {
+    SharedGLObject program;
+    SharedGLObject fragment_shader;
+    SharedGLObject vertex_shader;
+    // the program binary is saved once the link is done
+    bool save_binary;
+};
+typedef std::map<ProgramHashes, PendingProgram> PendingPrograms;
 typedef std::vector<ExcludedUniform> ExcludedUniforms; // vector instead of unordered_set since it's much faster for few elements
 typedef std::map<GLuint, GLenum> UniformTypes;
 
@@ -60,7 +70,10 @@ public:
     bool init(const bool hashless_texture_cache, const fs::path &texture_folder, const std::string_view game_id);
     void select(size_t index, const SceGxmTexture &texture) override;
     void configure_texture(const SceGxmTexture &texture) override;
-    void upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride) override;
+    void upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t row_offset) override;
+    void release_texture(size_t index) override;
+    bool supports_mipmap_generation(const SceGxmTexture &texture) const override;
+    void upload_done() override;
 
     void import_configure_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, bool is_srgb, uint16_t nb_components, uint16_t mipcount, bool swap_rb) override;
 };
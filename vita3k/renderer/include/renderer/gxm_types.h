@@ -339,6 +339,8 @@ struct SceGxmPrecomputedDraw {
 
     Ptr<StreamData> stream_data;
     uint16_t stream_count;
+    // streams read by the attributes of the program, computed once as the program of a precomputed draw can't change
+    uint16_t stream_used;
 
     SceGxmIndexFormat index_format;
     Ptr<const void> index_data;
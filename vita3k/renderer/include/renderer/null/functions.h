@@ -0,0 +1,38 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <renderer/null/state.h>
+
+#include <memory>
+
+struct Config;
+struct MemState;
+struct FeatureState;
+struct SDL_Window;
+
+namespace renderer::null {
+
+bool create(SDL_Window *window, std::unique_ptr<renderer::State> &state, const Config &config);
+bool create(std::unique_ptr<Context> &context);
+bool create(std::unique_ptr<RenderTarget> &rt);
+bool create(std::unique_ptr<FragmentProgram> &fp);
+bool create(std::unique_ptr<VertexProgram> &vp);
+void draw(NullState &state, Context &context, const FeatureState &features, MemState &mem, const char *cache_path, const char *title_id, const char *self_name, const Config &config);
+
+} // namespace renderer::null
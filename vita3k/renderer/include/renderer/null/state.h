@@ -0,0 +1,65 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <renderer/state.h>
+#include <renderer/texture_cache.h>
+#include <renderer/types.h>
+
+#include <set>
+
+namespace renderer::null {
+
+// Only keeps the statistics of the cache, nothing is uploaded
+class NullTextureCache : public TextureCache {
+public:
+    void select(size_t index, const SceGxmTexture &texture) override {}
+    void configure_texture(const SceGxmTexture &texture) override {}
+    void upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t row_offset) override {}
+    void import_configure_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, bool is_srgb, uint16_t nb_components, uint16_t mipcount, bool swap_rb) override {}
+};
+
+// Renderer which consumes the commands without any GPU work, used to measure the emulation speed on its own
+// The notifications and sync objects are signaled as soon as the commands reach them
+struct NullState : public renderer::State {
+    NullTextureCache texture_cache;
+
+    // translate the shaders of the drawn programs to SPIR-V, to keep this part of the CPU cost of the real renderers
+    bool translate_shaders = false;
+    std::set<Sha256Hash> translated_programs;
+
+    bool init(const fs::path &static_assets, const bool hashless_texture_cache) override;
+    void late_init(const Config &cfg, const std::string_view game_id, MemState &mem) override;
+
+    TextureCache *get_texture_cache() override {
+        return &texture_cache;
+    }
+
+    void render_frame(const SceFVector2 &viewport_pos, const SceFVector2 &viewport_size, DisplayState &display,
+        const GxmState &gxm, MemState &mem) override;
+    void swap_window(SDL_Window *window) override;
+    int get_supported_filters() override;
+    void set_screen_filter(const std::string_view &filter) override;
+    int get_max_anisotropic_filtering() override;
+    void set_anisotropic_filtering(int anisotropic_filtering) override;
+
+    void precompile_shader(const ShadersHash &hash) override;
+    void preclose_action() override;
+};
+
+} // namespace renderer::null
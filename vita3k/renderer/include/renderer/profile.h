@@ -14,7 +14,6 @@
 // You should have received a copy of the GNU General Public License along
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
-
 #pragma once
 
 #ifdef TRACY_ENABLE
@@ -27,3 +26,79 @@
 #define R_PROFILE(name)
 
 #endif // TRACY_ENABLE
+
+#ifdef RENDERER_FRAME_TIMERS
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace renderer {
+
+// Parts of the renderer the time spent by the cpu on each frame is split into
+enum class FrameTimer : uint8_t {
+    CommandDecode,
+    TextureCache,
+    SurfaceCache,
+    Pipeline,
+    Descriptors,
+    Submit,
+    Count
+};
+
+struct FrameTimers {
+    // set by the performance overlay, the timers cost a single load while it is not shown
+    std::atomic<bool> enabled = false;
+    // time in ns accumulated since the start, the time of a nested timer is only counted in its own category
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(FrameTimer::Count)> total_ns = {};
+};
+
+inline FrameTimers frame_timers;
+
+class ScopedFrameTimer {
+public:
+    explicit ScopedFrameTimer(FrameTimer timer)
+        : timer(timer) {
+        if (!frame_timers.enabled.load(std::memory_order_relaxed))
+            return;
+        parent = current;
+        current = this;
+        active = true;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedFrameTimer() {
+        if (!active)
+            return;
+        const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        frame_timers.total_ns[static_cast<size_t>(timer)].fetch_add(elapsed > nested_ns ? elapsed - nested_ns : 0, std::memory_order_relaxed);
+        if (parent)
+            parent->nested_ns += elapsed;
+        current = parent;
+    }
+
+    ScopedFrameTimer(const ScopedFrameTimer &) = delete;
+    ScopedFrameTimer &operator=(const ScopedFrameTimer &) = delete;
+
+private:
+    // innermost timer of the thread
+    static inline thread_local ScopedFrameTimer *current = nullptr;
+
+    FrameTimer timer;
+    bool active = false;
+    ScopedFrameTimer *parent = nullptr;
+    uint64_t nested_ns = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace renderer
+
+// Counts the time until the end of the scope in a category of the frame breakdown of the performance overlay
+#define R_FRAME_TIMER(timer) const renderer::ScopedFrameTimer ___frame_timer(renderer::FrameTimer::timer)
+
+#else
+
+#define R_FRAME_TIMER(timer)
+
+#endif // RENDERER_FRAME_TIMERS
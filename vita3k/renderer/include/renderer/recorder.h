@@ -0,0 +1,137 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#pragma once
+
+#include <util/fs.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct AVStream;
+struct SwrContext;
+struct SwsContext;
+
+namespace renderer {
+
+enum class RecorderPixelOrder {
+    RGBA,
+    BGRA,
+};
+
+/**
+ * \brief Records the presented frames and the mixed audio to a video file.
+ *
+ * The frames are copied by the GPU to host memory. The encoder reads them in place, and they are released once it
+ * is done with them. The encoding and the muxing are done on a thread of the recorder, with a hardware encoder
+ * (NVENC, AMF, QSV or VideoToolbox) when one can be opened.
+ */
+class GameplayRecorder {
+public:
+    /**
+     * @param encoder FFmpeg name of the video encoder, "Auto" to use the first hardware encoder available
+     * and fall back to a software one
+     */
+    bool start(const fs::path &path, uint32_t sample_rate, const std::string &encoder, uint32_t bitrate_kbps);
+    // Encodes the frames which are waiting and closes the file, every frame is released once it returns
+    void stop();
+    bool is_recording() const {
+        return recording;
+    }
+
+    /**
+     * \brief Gives a frame to encode, called by the renderer.
+     *
+     * The pixels must stay valid until release is called by the encoding thread.
+     * @return false if the frame is not taken, release is then never called
+     */
+    bool push_frame(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, RecorderPixelOrder order, std::function<void()> release);
+    // Gives stereo s16 samples, called by the host audio callback
+    void push_audio(const int16_t *samples, size_t nb_frames);
+
+    GameplayRecorder() = default;
+    GameplayRecorder(const GameplayRecorder &) = delete;
+    GameplayRecorder &operator=(const GameplayRecorder &) = delete;
+    ~GameplayRecorder();
+
+private:
+    struct PendingFrame {
+        const uint8_t *pixels;
+        uint32_t width;
+        uint32_t height;
+        uint32_t pitch;
+        RecorderPixelOrder order;
+        int64_t timestamp_ms;
+        std::function<void()> release;
+    };
+
+    void encode_thread_main();
+    bool open_video(const PendingFrame &frame);
+    bool open_audio();
+    void encode_video(PendingFrame &frame);
+    void encode_audio(bool flush);
+    void write_packets(AVCodecContext *context, AVStream *stream);
+    void close();
+
+    std::atomic<bool> recording = false;
+    std::thread encode_thread;
+    // protects everything given to the encoding thread
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stop_requested = false;
+    std::deque<PendingFrame> frames;
+    std::vector<int16_t> audio_samples;
+    std::chrono::steady_clock::time_point start_time;
+
+    // only used by the encoding thread
+    fs::path path;
+    std::string encoder_name;
+    uint32_t bitrate_kbps = 0;
+    uint32_t sample_rate = 0;
+    AVFormatContext *format{};
+    AVCodecContext *video_context{};
+    AVCodecContext *audio_context{};
+    AVStream *video_stream{};
+    AVStream *audio_stream{};
+    AVFrame *converted_frame{};
+    AVFrame *audio_frame{};
+    AVPacket *packet{};
+    SwsContext *sws{};
+    SwrContext *swr{};
+    bool header_written = false;
+    // no video encoder could be opened, the frames are only released
+    bool video_failed = false;
+    int64_t last_video_pts = -1;
+    int64_t audio_pts = 0;
+    // samples moved from audio_samples which were not encoded yet
+    std::vector<int16_t> audio_encoding;
+};
+
+} // namespace renderer
@@ -0,0 +1,86 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <renderer/recorder.h>
+
+#include <util/fs.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace renderer {
+
+/**
+ * \brief Saves a presented frame to a PNG file without blocking the renderer.
+ *
+ * The renderer reads the frame back to host memory with a fence, so it only gets it once the GPU is done with it.
+ * The PNG is then encoded on a thread of the writer and the frame is released.
+ */
+class ScreenshotWriter {
+public:
+    // The next frame read back by the renderer is saved to path, can be called from any thread
+    void request(const fs::path &path);
+    bool is_requested() const {
+        return requested;
+    }
+
+    /**
+     * \brief Gives the frame of the request, called by the renderer.
+     *
+     * The pixels must stay valid until release is called by the writer thread.
+     * @return false if no screenshot was requested, release is then never called
+     */
+    bool push_frame(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, RecorderPixelOrder order, std::function<void()> release);
+    // Saves the screenshots which are waiting, every frame is released once it returns
+    void stop();
+
+    ScreenshotWriter() = default;
+    ScreenshotWriter(const ScreenshotWriter &) = delete;
+    ScreenshotWriter &operator=(const ScreenshotWriter &) = delete;
+    ~ScreenshotWriter();
+
+private:
+    struct PendingScreenshot {
+        fs::path path;
+        const uint8_t *pixels;
+        uint32_t width;
+        uint32_t height;
+        uint32_t pitch;
+        RecorderPixelOrder order;
+        std::function<void()> release;
+    };
+
+    void writer_thread_main();
+
+    std::atomic<bool> requested = false;
+    std::thread writer_thread;
+    // protects everything given to the writer thread
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stop_requested = false;
+    fs::path requested_path;
+    std::deque<PendingScreenshot> screenshots;
+};
+
+} // namespace renderer
@@ -0,0 +1,86 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/fs.h>
+#include <util/mapped_file.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer {
+
+// A shader pack holds all the shaders generated for a title in a single append-only file.
+// Layout: ShaderPackHeader, then for each shader a ShaderPackRecord followed by its name and content.
+// The index is rebuilt from the records when the file is opened, a later record replaces an earlier one with the same name.
+// All values are little-endian.
+static constexpr char ShaderPackMagic[8] = { 'V', '3', 'K', 'S', 'H', 'P', 'A', 'K' };
+static constexpr uint32_t ShaderPackVersion = 1;
+static constexpr const char *ShaderPackFileName = "shaders.v3kcache";
+
+struct ShaderPackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+static_assert(sizeof(ShaderPackHeader) == 16);
+
+struct ShaderPackRecord {
+    uint32_t name_size;
+    uint32_t data_size;
+};
+static_assert(sizeof(ShaderPackRecord) == 8);
+
+class ShaderPack {
+public:
+    // open the pack of folder, or create it, and move the loose shader files of folder into it
+    // does nothing if the pack of this folder is already open
+    bool open(const fs::path &folder);
+    void close();
+
+    // name is the file name the shader would have in the loose layout
+    // data stays valid until the pack is closed, return false if the shader is not in the pack
+    bool find(const std::string &name, const uint8_t *&data, size_t &size);
+    // return false if the pack is not open or the shader could not be written
+    bool write(const std::string &name, const void *data, size_t size);
+
+private:
+    struct Entry {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    std::mutex mutex;
+    fs::path folder;
+    MappedFile file;
+    fs::ofstream append_stream;
+    std::unordered_map<std::string, Entry> index;
+    // content of the shaders written since the file was mapped
+    std::vector<std::unique_ptr<uint8_t[]>> appended;
+
+    // fill the index from the mapped file, return the size up to the end of the last complete record (0 if it is not a pack)
+    uint64_t read_index();
+    bool append(const std::string &name, const void *data, size_t size);
+    void migrate_loose_files();
+};
+
+} // namespace renderer
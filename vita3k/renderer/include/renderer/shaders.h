@@ -41,4 +41,12 @@ std::string load_glsl_shader(const SceGxmProgram &program, const FeatureState &f
 std::vector<uint32_t> load_spirv_shader(const SceGxmProgram &program, const FeatureState &features, bool is_vulkan, const shader::Hints &hints, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, const std::string &shader_version, bool shader_cache);
 std::string pre_load_shader_glsl(const char *hash_text, const char *shader_type_str, const char *cache_path, const char *title_id, const char *self_name);
 std::vector<uint32_t> pre_load_shader_spirv(const char *hash_text, const char *shader_type_str, const char *cache_path, const char *title_id, const char *self_name);
+
+// Translate the shader of program on a worker thread, the next load of this shader waits for it instead of translating it.
+// Only done for the programs whose translation does not depend on the draw state, attributes can be null if the program keeps its symbols.
+void translate_shader_async(State &renderer, const SceGxmProgram &program, const std::vector<SceGxmVertexAttribute> *attributes, bool shader_cache, bool spirv);
+
+// Other blobs stored next to the shaders in the shader pack (driver program binaries for example).
+bool load_shader_blob(const std::string &name, const char *cache_path, const char *title_id, const char *self_name, std::vector<uint8_t> &blob);
+bool save_shader_blob(const std::string &name, const void *data, size_t size, const char *cache_path, const char *title_id, const char *self_name);
 } // namespace renderer
\ No newline at end of file
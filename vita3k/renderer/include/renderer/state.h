@@ -18,13 +18,20 @@
 #pragma once
 
 #include <features/state.h>
+#include <renderer/capture.h>
+#include <renderer/recorder.h>
+#include <renderer/screenshot.h>
 #include <renderer/commands.h>
 #include <renderer/types.h>
 #include <threads/queue.h>
+#include <threads/spsc_queue.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 struct SDL_Cursor;
 struct SDL_Window;
@@ -61,12 +68,13 @@ struct State {
     Context *context;
 
     GXPPtrMap gxp_ptr_map;
-    Queue<CommandList> command_buffer_queue;
+    SPSCQueue<CommandList, 32> command_buffer_queue;
     std::condition_variable command_finish_one;
     std::mutex command_finish_one_mutex;
 
-    std::condition_variable notification_ready;
     std::mutex notification_mutex;
+    // threads waiting in sceGxmNotificationWait, keyed by notification address, protected by notification_mutex
+    std::unordered_map<Address, std::vector<std::condition_variable *>> notification_waiters;
 
     std::vector<ShadersHash> shaders_cache_hashs;
     std::string shader_version;
@@ -75,12 +83,30 @@ struct State {
 
     // on Vulkan, this is actually the number of pipelines compiled
     uint32_t shaders_count_compiled = 0;
-    uint32_t programs_count_pre_compiled = 0;
+    // also increased by the warm-up threads
+    std::atomic<uint32_t> programs_count_pre_compiled = 0;
 
-    bool should_display;
+    // total number of pipeline lookups and compilations, only counted by the Vulkan renderer
+    std::atomic<uint64_t> pipeline_lookups = 0;
+    std::atomic<uint64_t> pipeline_compiles = 0;
+
+    // gpu time (in ms) of the scenes of the last measured frame, only measured by the Vulkan renderer
+    std::atomic<float> gpu_frame_time = 0.0f;
+    std::atomic<float> gpu_max_scene_time = 0.0f;
+    std::atomic<uint32_t> gpu_scene_count = 0;
+
+    // set by the display queue thread (or the renderer for predicted frames) once the next frame can be presented
+    std::atomic<bool> should_display = false;
 
     bool need_page_table = false;
 
+    // only used by the renderer thread, except CommandCapture::request
+    CommandCapture capture;
+    // fed with the presented frames by the Vulkan renderer
+    GameplayRecorder recorder;
+    // fed with the presented frame read back by the renderer once one is requested
+    ScreenshotWriter screenshot;
+
     virtual bool init(const fs::path &static_assets, const bool hashless_texture_cache) = 0;
     virtual void late_init(const Config &cfg, const std::string_view game_id, MemState &mem) = 0;
 
@@ -115,6 +141,11 @@ struct State {
     }
 
     virtual void precompile_shader(const ShadersHash &hash) = 0;
+    // precompile the shaders and pipelines from the cache on worker threads
+    // return the number of tasks started, or 0 if the backend only supports precompile_shader
+    virtual uint32_t start_shader_warmup() {
+        return 0;
+    }
     virtual void preclose_action() = 0;
 
     virtual ~State() = default;
@@ -17,7 +17,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include <gxm/types.h>
 #include <mem/ptr.h>
@@ -34,5 +39,147 @@ enum SurfaceTextureRetrievePurpose {
     WRITING,
 };
 
+// Interval tree over the guest memory ranges [begin, end) of the surfaces, ranges can overlap.
+// The intervals are kept sorted by begin in an array, seen as an implicit balanced binary search tree
+// (the root of [lo, hi) is at (lo + hi) / 2) augmented with the largest end of each subtree.
+// Updates rebuild the tree in O(n), they only happen when a surface is created or destroyed,
+// lookups are O(log n + k) with k the number of intervals containing the address.
+template <typename T>
+class SurfaceIntervalTree {
+public:
+    struct Interval {
+        uint64_t begin;
+        uint64_t end;
+        T value;
+    };
+
+    void insert(uint64_t begin, uint64_t end, T value) {
+        auto it = std::upper_bound(intervals.begin(), intervals.end(), begin, [](uint64_t begin, const Interval &interval) {
+            return begin < interval.begin;
+        });
+        intervals.insert(it, { begin, end, value });
+        rebuild();
+    }
+
+    // remove the interval starting at begin holding value, return false if there is none
+    bool erase(uint64_t begin, T value) {
+        auto it = std::find_if(lower_bound(begin), intervals.cend(), [&](const Interval &interval) {
+            return interval.begin != begin || interval.value == value;
+        });
+        if (it == intervals.end() || it->begin != begin)
+            return false;
+
+        intervals.erase(it);
+        rebuild();
+        return true;
+    }
+
+    // among the intervals containing address, the one starting the closest to it, nullptr if there is none
+    const Interval *find_containing(uint64_t address) const {
+        return find_containing(address, 0, intervals.size());
+    }
+
+private:
+    std::vector<Interval> intervals;
+    // max_end[i] is the largest end in the subtree whose root is intervals[i]
+    std::vector<uint64_t> max_end;
+
+    typename std::vector<Interval>::const_iterator lower_bound(uint64_t begin) const {
+        return std::lower_bound(intervals.begin(), intervals.end(), begin, [](const Interval &interval, uint64_t begin) {
+            return interval.begin < begin;
+        });
+    }
+
+    void rebuild() {
+        max_end.resize(intervals.size());
+        rebuild(0, intervals.size());
+    }
+
+    uint64_t rebuild(size_t lo, size_t hi) {
+        if (lo >= hi)
+            return 0;
+
+        const size_t mid = (lo + hi) / 2;
+        max_end[mid] = std::max({ intervals[mid].end, rebuild(lo, mid), rebuild(mid + 1, hi) });
+        return max_end[mid];
+    }
+
+    const Interval *find_containing(uint64_t address, size_t lo, size_t hi) const {
+        if (lo >= hi)
+            return nullptr;
+
+        const size_t mid = (lo + hi) / 2;
+        // nothing in this subtree goes past address
+        if (max_end[mid] <= address)
+            return nullptr;
+
+        if (intervals[mid].begin <= address) {
+            // the right subtree has the intervals starting the closest to address
+            if (const Interval *found = find_containing(address, mid + 1, hi))
+                return found;
+            if (intervals[mid].end > address)
+                return &intervals[mid];
+        }
+
+        return find_containing(address, lo, mid);
+    }
+};
+
+enum class SurfaceSyncAction {
+    // the surface can be used as it is, the guest did not touch it or already has its content
+    Reuse,
+    // the guest wrote to the memory of the surface, this content must be copied to the surface before the GPU uses it
+    Upload,
+    // the guest accessed the surface, the content rendered by the GPU must be copied to its memory
+    Readback,
+};
+
+// guest accesses to a surface since its memory trap was last armed, set by the trap
+struct SurfaceGuestAccess {
+    std::atomic<bool> accessed = false;
+    std::atomic<bool> written = false;
+    // cleared by the trap once it is hit, it must then be armed again to see the next accesses
+    std::atomic<bool> armed = false;
+};
+
+// Tracks, for each render target in guest memory, which of the GPU or the guest wrote to it last.
+// The GPU writes are recorded per scene with a fence increasing in submission order, the guest accesses
+// are caught by a memory trap on the pages of the surface. This is used to only copy a surface between the GPU
+// and the guest memory when the other side can see the difference.
+class SurfaceSyncTracker {
+public:
+    struct TrackedSurface {
+        uint32_t size = 0;
+        // fence of the last scene rendering to the surface, 0 if it was never rendered to
+        uint64_t gpu_fence = 0;
+        // fence of the content last copied between the surface and the guest memory
+        uint64_t synced_fence = 0;
+        // without trap, the guest is assumed to access the surface after each scene
+        bool has_trap = false;
+        std::shared_ptr<SurfaceGuestAccess> access;
+    };
+
+    // the returned state must be updated by the memory trap of the surface if has_trap is set
+    std::shared_ptr<SurfaceGuestAccess> track(Address addr, uint32_t size, bool has_trap);
+    // only stop tracking the surface at addr if it still uses access
+    void untrack(Address addr, const SurfaceGuestAccess *access);
+
+    // a scene rendering to the surface at addr was recorded, return its fence
+    uint64_t record_gpu_write(Address addr);
+    // what must be done before the GPU renders to the surface at addr
+    SurfaceSyncAction before_gpu_use(Address addr) const;
+    // what must be done once the last recorded scene rendering to the surface at addr is done
+    SurfaceSyncAction after_gpu_write(Address addr) const;
+    // the surface and its guest memory now have the same content
+    // return true if the memory trap must be armed again, access->armed is then already set
+    bool mark_synced(Address addr);
+
+    const TrackedSurface *find(Address addr) const;
+
+private:
+    std::map<Address, TrackedSurface> surfaces;
+    uint64_t last_fence = 0;
+};
+
 class SurfaceCache {};
 } // namespace renderer
@@ -18,33 +18,115 @@
 #pragma once
 
 #include <gxm/types.h>
+#include <mem/util.h>
+#include <threads/queue.h>
 #include <util/containers.h>
 #include <util/fs.h>
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
 
 namespace ddspp {
 struct Descriptor;
 }
 
 struct MemState;
+class MappedFile;
+
+namespace renderer {
+class TextureDiskCache;
+class TexturePack;
+}
 
 enum SceGxmTextureBaseFormat : uint32_t;
 
 namespace renderer {
 enum class Backend : uint32_t;
-static constexpr size_t TextureCacheSize = 1024;
+// maximum number of textures in the cache, the memory budget usually evicts textures before it is reached
+static constexpr size_t TextureCacheSize = 4096;
+// fragment and vertex texture units, each with a few descriptors bound last in front of texture_lookup
+static constexpr size_t TextureBindCacheUnits = SCE_GXM_MAX_TEXTURE_UNITS * 2;
+static constexpr size_t TextureBindCacheWays = 4;
 
 typedef std::array<uint32_t, 4> TextureGxmDataRepr;
+
+// called for each mip (and face) of a decoded texture, with the same parameters as upload_texture_impl
+// memory_height is the number of rows of pixels, including the padding of the guest layout
+using TextureDecodedFunc = std::function<void(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height)>;
+
+struct DecodedTextureMip {
+    SceGxmTextureBaseFormat base_format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_index;
+    int face;
+    uint32_t pixels_per_stride;
+    std::vector<uint8_t> pixels;
+};
+
+// texture decoded by a worker thread, the renderer uploads it once done is set
+struct TextureDecodeRequest {
+    SceGxmTexture texture;
+    std::vector<DecodedTextureMip> mips;
+    std::atomic<bool> done = false;
+};
+
+struct AvailableTexture {
+    bool is_dds;
+    std::shared_ptr<fs::path> folder_path;
+    // dds file mapped in memory by the pre-warm step
+    std::shared_ptr<MappedFile> mapped_file;
+    // set if the dds file is in a texture pack instead of folder_path
+    std::shared_ptr<TexturePack> pack;
+};
+
+// replacement texture read, and decoded for png files, by the import thread
+struct TextureImportRequest {
+    uint64_t hash;
+    AvailableTexture texture;
+    // number of components png files are decoded to
+    int nb_comp;
+    // content of the dds file or pixels of the png file
+    std::vector<uint8_t> data;
+    // used instead of data when the dds file can be read from a mapping
+    const uint8_t *mapped_content = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    int nb_channels = 0;
+    bool success = false;
+    std::atomic<bool> done = false;
+
+    const uint8_t *content() const;
+};
+
 struct TextureCacheInfo {
     uint64_t hash = 0;
     SceGxmTexture texture;
     int index = 0;
     uint32_t texture_size = 0;
+    // estimated host memory used by the texture, counted in the memory budget
+    uint32_t memory_size = 0;
     bool use_hash = false;
     bool dirty = false;
+    // range watched for guest writes when the memory uses write watch instead of protection
+    Address watch_begin = 0;
+    uint32_t watch_size = 0;
+    // the texture can be updated by only uploading the rows which changed
+    bool can_upload_rows = false;
+    // guest range known to have changed since the last upload, empty when unknown
+    Address dirty_begin = 0;
+    Address dirty_end = 0;
+    // hash of each page of the first mip, only used by textures with can_upload_rows
+    std::vector<uint64_t> page_hashes;
+    // decode still running or not uploaded yet, the texture keeps its previous content until then
+    std::shared_ptr<TextureDecodeRequest> pending_decode;
+    // replacement texture still being loaded, the original texture is used until then
+    std::shared_ptr<TextureImportRequest> pending_import;
     // used for texture importation
     bool is_imported = false;
     bool is_srgb = false;
@@ -54,31 +136,45 @@ struct TextureCacheInfo {
     SceGxmTextureBaseFormat format;
 };
 
+// cumulative counters, read by the performance overlay from the gui thread
+struct TextureCacheStats {
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> evictions = 0;
+    std::atomic<uint64_t> memory_used = 0;
+    std::atomic<uint64_t> memory_budget = 0;
+};
+
+// descriptor bound last to a slot of a texture unit, info is nullptr if the slot is empty
+struct TextureBindCacheEntry {
+    TextureGxmDataRepr texture{};
+    TextureCacheInfo *info = nullptr;
+    // scene in which the content of the texture was last checked
+    uint32_t scene = 0;
+};
+
 struct SamplerCacheInfo {
     // compact representation of the sampler state
     uint32_t value = 0;
     int index = 0;
 };
 
-struct AvailableTexture {
-    bool is_dds;
-    std::shared_ptr<fs::path> folder_path;
-};
-
 class TextureCache {
 protected:
     // current texture info the cache is looking at
     TextureCacheInfo *current_info = nullptr;
+    // palette of the texture being uploaded with its guest layout, nullptr if it is not paletted
+    const uint32_t *current_palette = nullptr;
 
     // are we in the process of exporting a texture
     bool exporting_texture = false;
     // are we in the process of importing a texture
     bool importing_texture = false;
 
-    // dds/png raw file
-    std::vector<uint8_t> imported_texture_raw_data;
+    // replacement texture being imported
+    std::shared_ptr<TextureImportRequest> import_request;
     // pointer to the decoded content
-    uint8_t *imported_texture_decoded = nullptr;
+    const uint8_t *imported_texture_decoded = nullptr;
     // Info about the texture currently loading
     AvailableTexture loading_texture;
     // contain the decrypted header when loading dds
@@ -93,12 +189,64 @@ protected:
     bool save_as_png = true;
     bool export_textures = false;
 
+    // set while only some rows of the texture are uploaded, the other ones must be kept
+    bool partial_upload = false;
+    // set while only the base level of the texture is uploaded, upload_done must generate the other mips
+    bool generate_mips = false;
+    // for each texture with mips checked once, are its mips a box filter of the base level
+    unordered_map_fast<TextureGxmDataRepr, bool> box_filtered_mips;
+
+    // decoded textures kept across sessions, nullptr when it is not used
+    std::unique_ptr<TextureDiskCache> disk_cache;
+    void decode_texture_impl(const SceGxmTexture &gxm_texture, const MemState &mem, const TextureDecodedFunc &on_decoded, bool keep_guest_layout, bool base_level_only) const;
+
+    Queue<std::shared_ptr<TextureDecodeRequest>> decode_queue;
+    std::vector<std::thread> decode_workers;
+
+    void decode_worker(const MemState &mem);
+    void queue_texture_decode(TextureCacheInfo &info, const SceGxmTexture &gxm_texture);
+    void upload_decoded_texture(const TextureDecodeRequest &request);
+
+    Queue<std::shared_ptr<TextureImportRequest>> import_queue;
+    std::thread import_thread;
+
+    void import_worker();
+    // return true once the replacement texture of info is loaded, start loading it otherwise
+    bool is_import_ready(TextureCacheInfo &info, const AvailableTexture &texture);
+
+    // host memory used by all the textures in the cache
+    uint64_t memory_used = 0;
+    // 0 if only the number of slots limits the cache
+    uint64_t memory_budget = 0;
+
+    // direct-mapped by data address, avoids masking and looking up the descriptors bound again by the next draws
+    std::array<std::array<TextureBindCacheEntry, TextureBindCacheWays>, TextureBindCacheUnits> bind_cache{};
+    // incremented at each scene, the content of a texture only needs to be checked once per scene
+    uint32_t scene_index = 1;
+
+    // remove the texture from the cache and give its memory back
+    void free_texture(TextureCacheInfo &info);
+    // free the least recently used textures until new_size more bytes fit in the budget, keep is never freed
+    void evict_textures(const TextureCacheInfo &keep, uint64_t new_size);
+
 public:
     Backend backend;
     bool use_protect = false;
     // use a separate sampler cache
     bool use_sampler_cache = false;
     int anisotropic_filtering = 1;
+    // decode swizzled, tiled and converted textures on worker threads
+    bool use_async_decode = false;
+    // let the backend linearize and decompress the textures it supports on the GPU
+    bool use_gpu_decode = false;
+    // read and decode replacement textures on a separate thread
+    bool use_async_import = false;
+    // only upload the base level of the textures whose mips are a box filter of it, the backend generates the other mips
+    bool use_mipmap_generation = false;
+    // map all the dds replacement textures in memory when looking for them
+    bool prewarm_imports = false;
+
+    TextureCacheStats stats;
 
     // used to quicky get the info from a hash of a gxm_texture
     unordered_map_fast<TextureGxmDataRepr, TextureCacheInfo *> texture_lookup;
@@ -119,24 +267,68 @@ public:
     // hash of the textures that have already been exported
     unordered_set_fast<uint64_t> exported_textures_hash;
 
+    ~TextureCache();
+
     bool init(const bool hashless_texture_cache, const fs::path &texture_folder, const std::string_view game_id, const size_t sampler_cache_size = 0);
+    // enables use_async_decode, mem must outlive the texture cache
+    void start_decode_workers(const MemState &mem);
     void set_replacement_state(bool import_textures, bool export_textures, bool export_as_png);
+    // enables use_async_import
+    void start_import_worker();
+    // budget in bytes, 0 to disable it
+    void set_memory_budget(uint64_t budget);
+    // keep the textures which are expensive to decode in a cache file of folder, they are read from it by the next sessions
+    void open_disk_cache(const fs::path &folder);
 
     virtual void select(size_t index, const SceGxmTexture &texture) = 0;
     virtual void configure_texture(const SceGxmTexture &texture) = 0;
-    virtual void upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride) = 0;
+    // the rows uploaded start at row_offset in the texture, pixels points to the first of them
+    virtual void upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t row_offset) = 0;
     virtual void upload_done() {}
+    // give a defined content to a newly configured texture whose decode is still pending
+    virtual void upload_placeholder(const SceGxmTexture &texture) {}
+    // textures for which upload_guest_layout_impl is used when use_gpu_decode is set
+    virtual bool supports_gpu_decode(const SceGxmTexture &texture) const {
+        return false;
+    }
+    // same as upload_texture_impl, but pixels are still swizzled, tiled or compressed as in the guest memory
+    virtual void upload_guest_layout_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height) {}
+    bool uses_gpu_decode(const SceGxmTexture &texture) const {
+        return use_gpu_decode && !export_textures && supports_gpu_decode(texture);
+    }
+    // can the backend generate the mips of the texture from its base level in upload_done
+    virtual bool supports_mipmap_generation(const SceGxmTexture &texture) const {
+        return false;
+    }
 
     virtual void configure_sampler(size_t index, const SceGxmTexture &texture) {}
+    // called when the texture at index is evicted, the backend can free its memory
+    virtual void release_texture(size_t index) {}
 
     void upload_texture(const SceGxmTexture &gxm_texture, MemState &mem);
-    void cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemState &mem);
+    // only reads the guest memory, can be called from any thread
+    // with keep_guest_layout, the mips are given as they are stored in the guest memory
+    // with base_level_only, the other mips are skipped without being decoded
+    // the mips can come from the disk cache instead of the guest memory
+    void decode_texture(const SceGxmTexture &gxm_texture, const MemState &mem, const TextureDecodedFunc &on_decoded, bool keep_guest_layout = false, bool base_level_only = false) const;
+    // upload the rows of the first mip containing the guest range [dirty_begin, dirty_end)
+    void upload_texture_rows(const SceGxmTexture &gxm_texture, Address dirty_begin, Address dirty_end, MemState &mem);
+    // unit is the fragment texture unit, or SCE_GXM_MAX_TEXTURE_UNITS + the vertex texture unit
+    void cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemState &mem, size_t unit);
+    // must be called at scene boundaries, textures bound during the new scene will have their content checked again
+    void begin_scene() {
+        scene_index++;
+    }
+    // must be called at scene boundaries when mem.use_write_watch is set
+    void refresh_dirty_textures(MemState &mem);
 
     // is called by cache_and_bind_texture if use_sampler_cache is set to true
     int cache_and_bind_sampler(const SceGxmTexture &gxm_texture);
 
     // look at the texture folder and update the available imported / exported hashes
     void refresh_available_textures();
+    // put the textures exported as dds in a texture pack in the import folder, return false on failure
+    bool pack_exported_textures();
 
     // functions used for texture exportation
     void export_select(const SceGxmTexture &texture);
@@ -0,0 +1,107 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#pragma once
+
+#include <renderer/texture_cache.h>
+
+#include <util/fs.h>
+#include <util/mapped_file.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace renderer {
+
+// The texture disk cache keeps the result of expensive texture decodes (pvrtc) across sessions in a single append-only file.
+// Layout: TextureDiskCacheHeader, then for each texture a TextureDiskCacheRecord, its mip_count TextureDiskCacheMip
+// and the pixels of its mips, each padded to TextureDiskCacheAlignment bytes.
+// The index is rebuilt from the records when the file is opened, textures written afterward are only found by the next session.
+// All values are little-endian.
+static constexpr char TextureDiskCacheMagic[8] = { 'V', '3', 'K', 'D', 'T', 'E', 'X', 'C' };
+static constexpr uint32_t TextureDiskCacheVersion = 1;
+static constexpr const char *TextureDiskCacheFileName = "decoded.v3kcache";
+static constexpr uint64_t TextureDiskCacheAlignment = 16;
+
+struct TextureDiskCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+static_assert(sizeof(TextureDiskCacheHeader) == 16);
+
+struct TextureDiskCacheRecord {
+    uint64_t hash;
+    uint32_t mip_count;
+    // size of everything following the record, including the padding
+    uint32_t data_size;
+};
+static_assert(sizeof(TextureDiskCacheRecord) == 16);
+
+struct TextureDiskCacheMip {
+    uint32_t base_format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_index;
+    int32_t face;
+    uint32_t pixels_per_stride;
+    // size of the pixels, without the padding
+    uint32_t size;
+    uint32_t reserved;
+};
+static_assert(sizeof(TextureDiskCacheMip) == 32);
+
+class TextureDiskCache {
+public:
+    // open the cache of folder, or create it, return false if it can't be used
+    bool open(const fs::path &folder);
+    void close();
+
+    bool is_open() const {
+        return append_stream.is_open();
+    }
+
+    // call on_decoded for each mip of the texture with its pixels read from the mapped file
+    // return false if the texture is not in the cache
+    bool read(uint64_t hash, const TextureDecodedFunc &on_decoded, bool base_level_only) const;
+    // can be called from any thread, return false if the texture could not be written
+    bool write(uint64_t hash, const std::vector<DecodedTextureMip> &mips);
+
+private:
+    struct Entry {
+        const TextureDiskCacheMip *mips;
+        uint32_t mip_count;
+    };
+
+    std::mutex mutex;
+    MappedFile file;
+    fs::ofstream append_stream;
+    // only modified by open and close, so it can be read without the mutex
+    std::unordered_map<uint64_t, Entry> index;
+    // textures written since the file was mapped
+    std::unordered_set<uint64_t> written;
+    uint64_t file_size = 0;
+
+    // fill the index from the mapped file, return the size up to the end of the last complete record (0 if it is not a cache)
+    uint64_t read_index();
+};
+
+} // namespace renderer
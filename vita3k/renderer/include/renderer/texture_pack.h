@@ -0,0 +1,81 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/fs.h>
+#include <util/mapped_file.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace renderer {
+
+// A texture pack holds many dds replacement textures in a single file, it is used from the import folder.
+// Layout: TexturePackHeader, entry_count TexturePackEntry sorted by hash, then the payloads.
+// All values are little-endian.
+static constexpr char TexturePackMagic[8] = { 'V', '3', 'K', 'T', 'P', 'A', 'C', 'K' };
+static constexpr uint32_t TexturePackVersion = 1;
+static constexpr const char *TexturePackExtension = ".v3kpack";
+
+struct TexturePackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+};
+static_assert(sizeof(TexturePackHeader) == 16);
+
+struct TexturePackEntry {
+    uint64_t hash;
+    // offset of the payload from the beginning of the file
+    uint64_t offset;
+    // size of the payload in the file
+    uint32_t size;
+    // size of the dds file, the payload is compressed with deflate when it is different from size
+    uint32_t uncompressed_size;
+};
+static_assert(sizeof(TexturePackEntry) == 24);
+
+class TexturePack {
+public:
+    // return false if the file is not a valid texture pack
+    bool open(const fs::path &path);
+
+    uint32_t entry_count() const {
+        return count;
+    }
+    const TexturePackEntry &get_entry(uint32_t index) const {
+        return entries[index];
+    }
+
+    // nullptr if the texture is not in the pack
+    const TexturePackEntry *find(uint64_t hash) const;
+    // return the dds file of the entry, it is decompressed in buffer if needed
+    // nullptr if the entry is corrupted
+    const uint8_t *get_content(const TexturePackEntry &entry, std::vector<uint8_t> &buffer) const;
+
+private:
+    MappedFile file;
+    const TexturePackEntry *entries = nullptr;
+    uint32_t count = 0;
+};
+
+// put all the dds files of folder in a new texture pack, the payloads are compressed when it makes them smaller
+// return the number of textures in the pack or -1 if it could not be written
+int create_texture_pack(const fs::path &folder, const fs::path &pack_path, bool use_compression);
+
+} // namespace renderer
@@ -60,7 +60,9 @@ struct CommandBuffer;
 
 enum class Backend : uint32_t {
     OpenGL,
-    Vulkan
+    Vulkan,
+    // no rendering, for headless runs and benchmarks
+    Null
 };
 
 enum class GXMState : std::uint16_t {
@@ -201,6 +203,9 @@ struct ShaderProgram {
 };
 
 struct FragmentProgram : ShaderProgram {
+    // kept to create the program again when a capture is replayed
+    bool has_blend = false;
+    SceGxmBlendInfo blend;
 };
 
 struct VertexProgram : ShaderProgram {
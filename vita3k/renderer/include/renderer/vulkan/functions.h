@@ -36,6 +36,8 @@ void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format
     Ptr<void> indices, size_t count, uint32_t instance_count, MemState &mem, const Config &config);
 
 void mid_scene_flush(VKContext &context, const SceGxmNotification notification);
+// copy (or downscale) between two color surfaces of the surface cache on the GPU, return false if the transfer must be done in memory
+bool transfer_surface(VKState &state, const SceGxmTransferImage &src, const SceGxmTransferImage &dest, const SceGxmTransferType src_type, const SceGxmTransferType dest_type, const bool downscale);
 void new_frame(VKContext &context);
 void signal_sync_object(VKState &state, SceGxmSyncObject *sync_object, uint32_t timestamp);
 
@@ -18,9 +18,13 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <deque>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <set>
+#include <vector>
 
 #include <blockingconcurrentqueue.h>
 #include <util/containers.h>
@@ -42,6 +46,7 @@ struct Hints;
 namespace renderer {
 
 struct GxmRecordState;
+struct ShadersHash;
 
 namespace vulkan {
 struct VKState;
@@ -50,6 +55,30 @@ struct CompileRequest;
 
 using PipelineCompileQueue = moodycamel::BlockingConcurrentQueue<CompileRequest *>;
 
+// everything needed to build a pipeline once its shaders are known, without looking at the guest programs
+// these are saved to disk so that complete pipelines can be built again at boot
+struct PipelineDescription {
+    // key of the pipeline in the pipelines map
+    uint64_t key;
+    Sha256Hash vertex_hash;
+    Sha256Hash fragment_hash;
+    SceGxmPrimitiveType type;
+    // render passes with the same format are compatible, so this is enough to get one
+    vk::Format color_format;
+    bool use_shader_interlock;
+    bool is_fragment_disabled;
+    bool frag_has_no_output;
+    uint16_t vertex_texture_count;
+    uint16_t fragment_texture_count;
+    vk::PipelineColorBlendAttachmentState blending;
+    std::vector<vk::VertexInputBindingDescription> bindings;
+    std::vector<vk::VertexInputAttributeDescription> attributes;
+    // the content of the record useful for the pipeline creation
+    std::vector<uint8_t> record_data;
+    // frame at which the pipeline was first used, the warm-up builds the pipelines in this order
+    uint64_t first_use_frame = 0;
+};
+
 class PipelineCache {
 private:
     VKState &state;
@@ -79,10 +108,23 @@ private:
     std::mutex shaders_mutex;
     // because of multithreading, we want the pointers to remain stable
     unordered_map_stable<Sha256Hash, vk::ShaderModule> shaders;
-    unordered_map_stable<uint64_t, vk::Pipeline> pipelines;
+    // only the render thread looks up or inserts pipelines, the compile threads
+    // publish their result through the atomic slot so no lock is needed on either side
+    unordered_map_stable<uint64_t, std::atomic<vk::Pipeline>> pipelines;
+
+    // descriptions of all the pipelines built, protected by descriptions_mutex
+    // a deque so the warm-up requests still being built can keep pointers to them while new pipelines are described
+    std::mutex descriptions_mutex;
+    std::deque<PipelineDescription> pipeline_descriptions;
+    unordered_set_fast<uint64_t> described_pipelines;
+
+    // parts of pipelines built with VK_EXT_graphics_pipeline_library, only accessed by the render thread
+    unordered_map_fast<uint64_t, vk::Pipeline> pipeline_libraries;
 
     vk::PipelineShaderStageCreateInfo retrieve_shader(const SceGxmProgram *program, const Sha256Hash &hash, bool is_vertex, bool maskupdate, MemState &mem, const shader::Hints &hints);
     vk::PipelineVertexInputStateCreateInfo get_vertex_input_state(const SceGxmVertexProgram &vertex_program, MemState &mem);
+    // bit mask of the dynamic states used, pipeline keys computed with another mask are different
+    uint32_t get_dynamic_state_mask() const;
 
     // queue containing request sent by the main thread to the compile threads
     PipelineCompileQueue pipeline_compile_queue;
@@ -91,7 +133,22 @@ private:
     // each pipeline compiler thread uses this function as its entrypoint
     void compiler_thread(MemState &mem);
 
-    vk::Pipeline compile_pipeline(SceGxmPrimitiveType type, vk::RenderPass render_pass, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, const shader::Hints &hints, MemState &mem);
+    PipelineDescription describe_pipeline(uint64_t key, SceGxmPrimitiveType type, vk::Format color_format, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, MemState &mem);
+    vk::Pipeline compile_pipeline(uint64_t key, SceGxmPrimitiveType type, vk::RenderPass render_pass, vk::Format color_format, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, const shader::Hints &hints, uint64_t first_use_frame, MemState &mem);
+    // if library_parts is not empty, only build a pipeline library containing these parts
+    vk::Pipeline build_pipeline(const PipelineDescription &description, const vk::PipelineShaderStageCreateInfo *shader_stages, vk::RenderPass render_pass, vk::GraphicsPipelineLibraryFlagsEXT library_parts = {});
+
+    uint64_t get_library_key(const PipelineDescription &description, vk::GraphicsPipelineLibraryFlagBitsEXT part, vk::RenderPass render_pass) const;
+    vk::Pipeline retrieve_pipeline_library(const PipelineDescription &description, vk::GraphicsPipelineLibraryFlagBitsEXT part, const vk::PipelineShaderStageCreateInfo *shader_stages, vk::RenderPass render_pass);
+    // return false if the shader module has not been compiled yet
+    bool find_shader_stage(const Sha256Hash &hash, bool is_vertex, vk::PipelineShaderStageCreateInfo &shader_stage);
+    // quickly link a pipeline from its parts, return nullptr if its shaders are not compiled yet
+    vk::Pipeline link_pipeline(uint64_t key, SceGxmPrimitiveType type, vk::RenderPass render_pass, vk::Format color_format, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, MemState &mem);
+    // build a pipeline from its description during the warm-up and store it in its slot
+    void warmup_pipeline(const PipelineDescription &description, vk::RenderPass render_pass, std::atomic<vk::Pipeline> *pipeline);
+
+    void read_pipeline_descriptions();
+    void save_pipeline_descriptions();
 
 public:
     // if not 0, next time the pipeline cache should be saved (in seconds since epoch)
@@ -101,6 +158,22 @@ public:
     // (i.e that it does not causes permanent graphical issues)
     bool can_use_deferred_compilation;
 
+    // set when creating the device, the states supported are set when drawing instead of being part of the pipeline
+    // VK_EXT_extended_dynamic_state: cull mode, topology, depth and stencil tests
+    bool support_dynamic_state = false;
+    // VK_EXT_extended_dynamic_state3
+    bool support_dynamic_polygon_mode = false;
+    bool support_dynamic_blending = false;
+    // the topology can be changed to one of another class (like points to triangles)
+    bool support_unrestricted_topology = false;
+    // VK_EXT_vertex_input_dynamic_state
+    bool support_dynamic_vertex_input = false;
+    // VK_EXT_graphics_pipeline_library with fast linking, used to get a pipeline while the complete one is compiled
+    bool support_pipeline_library = false;
+    // VK_EXT_rasterization_order_attachment_access (or the ARM one), the color attachment reads with a subpass input
+    // are then ordered with the writes of the previous fragments, no barrier is needed between draws doing framebuffer fetch
+    bool support_rasterization_order = false;
+
     vk::DescriptorSetLayout uniforms_layout;
     // used for the mask, color attachment
     vk::DescriptorSetLayout attachments_layout;
@@ -119,9 +192,16 @@ public:
 
     vk::RenderPass retrieve_render_pass(vk::Format format, bool force_load, bool force_store, bool no_color = false);
     vk::Pipeline retrieve_pipeline(VKContext &context, SceGxmPrimitiveType &type, bool consider_for_async, MemState &mem);
+    // set the state which is not part of the pipeline when using dynamic state, must be called after each pipeline refresh
+    void set_dynamic_state(VKContext &context, SceGxmPrimitiveType type, MemState &mem);
 
     vk::ShaderModule precompile_shader(const Sha256Hash &hash, bool search_first = true);
 
+    // load all shaders and build all known pipelines on the compile threads, in the order they were first used
+    // return the number of tasks to wait for before booting, state.programs_count_pre_compiled is increased each time one is done
+    // the other tasks are done in the background
+    uint32_t start_warmup(const std::vector<ShadersHash> &shaders_hashs);
+
     void set_async_compilation(bool enable);
 };
 } // namespace vulkan
@@ -21,7 +21,10 @@
 
 #include "screen_filters.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 struct SDL_Window;
 
@@ -58,11 +61,33 @@ public:
     std::vector<vk::Semaphore> image_acquired_semaphores;
     std::vector<vk::Semaphore> image_ready_semaphores;
 
+    // copy of the guest framebuffer when it is not a cached surface, one for each swapchain image
     std::vector<vkutil::Image> vita_surface;
+    // hash of each band of rows of each vita_surface, empty when its content is undefined
+    std::vector<std::vector<uint64_t>> vita_surface_band_hashes;
+    // the staging buffer has a part for each swapchain image, so a frame still in flight keeps its content
     vma::Allocation vita_surface_staging_alloc;
     vma::AllocationInfo vita_surface_staging_info;
     vk::Buffer vita_surface_staging;
 
+    // copy of the presented image given to the gameplay recorder and the screenshot writer, one for each swapchain image
+    // the copy is done with the commands of its image, so it is complete once the fence of the image is signaled
+    struct RecordSlot {
+        vk::Buffer buffer;
+        vma::Allocation allocation;
+        vma::AllocationInfo allocation_info;
+        vk::DeviceSize size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // the copy was submitted and not given to the recorder yet
+        bool pending = false;
+        // number of consumers (recorder and screenshot writer) which have not released the frame yet
+        std::atomic<uint32_t> users = 0;
+    };
+    std::vector<std::unique_ptr<RecordSlot>> record_slots;
+    // the swapchain images can be copied from
+    bool support_record = false;
+
     vk::CommandBuffer current_cmd_buffer;
 
     // these are used by the gui
@@ -72,6 +97,12 @@ public:
     // set to true after a window resize, in this case the pipeline needs to be rebuilt
     bool need_rebuild = false;
 
+    bool support_present_wait = false;
+    // low latency mode: wait for the previous frame to be displayed before starting the next one
+    bool use_present_wait = false;
+    // id of the last presented frame, reset with the swapchain
+    uint64_t present_id = 0;
+
     ScreenRenderer(VKState &state);
 
     bool create(SDL_Window *window);
@@ -83,6 +114,9 @@ public:
     void render(vk::ImageView image_view, vk::ImageLayout layout, const Viewport &viewport);
     void swap_window();
     void set_filter(const std::string_view &filter);
+    // update the vita surface of the current swapchain image with the guest framebuffer, only the rows which changed since
+    // this image was last used are uploaded, return its view
+    vk::ImageView upload_vita_surface(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch);
 
 private:
     void create_render_pass();
@@ -93,5 +127,10 @@ private:
     void copy_to_vao(const void *data);
     void create_surface_image();
     void destroy_swapchain();
+    // copy the image which is going to be presented for the recorder and the screenshot writer
+    void record_frame();
+    // give the copy done the last time the current swapchain image was used to the recorder and the screenshot writer
+    void submit_recorded_frame();
+    void destroy_record_slots();
 };
 } // namespace renderer::vulkan
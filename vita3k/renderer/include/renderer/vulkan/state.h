@@ -62,6 +62,13 @@ struct VKState : public renderer::State {
     std::vector<vk::QueueFamilyProperties> physical_device_queue_families;
 
     vma::Allocator allocator;
+    // pools of the texture cache and surface cache images, by size class, so that their churn does not fragment
+    // the memory of the other allocations. Images larger than the largest class get their own allocation
+    vma::Pool small_texture_pool;
+    vma::Pool large_texture_pool;
+    vma::Pool surface_pool;
+    // heap of the memory type used by the texture pools
+    uint32_t texture_heap_index = 0;
 
     uint32_t general_family_index = 0;
     uint32_t transfer_family_index = 0;
@@ -96,6 +103,33 @@ struct VKState : public renderer::State {
     bool support_fsr = false;
     // support for the VK_KHR_uniform_buffer_standard_layout extension, needed for memory mapping and texture viewport
     bool support_standard_layout = false;
+    // support for the VK_KHR_push_descriptor extension, fragment textures are then pushed instead of using descriptor sets
+    bool support_push_descriptor = false;
+    // timestamp queries are supported by the general queue, used to measure the gpu time of each scene
+    bool support_timestamps = false;
+    // a memory type is lazily allocated (tile-based GPUs), transient attachments then use no memory
+    bool support_lazy_memory = false;
+    // support for the VK_EXT_memory_budget extension, the texture cache budget then follows the budget of the heap
+    bool support_memory_budget = false;
+    // texture cache budget chosen at boot, 0 if it was set by the user and must not follow the heap budget
+    uint64_t auto_texture_budget = 0;
+    uint32_t budget_frame_index = 0;
+    // number of nanoseconds for a timestamp increment
+    float timestamp_period = 0.0f;
+    uint64_t timestamp_mask = 0;
+    // support for the VK_KHR_timeline_semaphore extension, the gpu progress is then tracked with it instead of fences
+    bool support_timeline_semaphore = false;
+    // signaled by every submission of the gxm contexts on the general queue with an increasing value
+    vk::Semaphore gpu_timeline;
+    // value signaled by the last submission, only modified by the renderer thread
+    uint64_t gpu_timeline_value = 0;
+    // the device has a dedicated transfer queue and timeline semaphores, new textures are then uploaded with it
+    bool use_transfer_queue = false;
+    // signaled by every submission on the transfer queue, the next general submission waits for it
+    vk::Semaphore transfer_timeline;
+    uint64_t transfer_timeline_value = 0;
+    // transfer commands being recorded, submitted right before the next general submission
+    vk::CommandBuffer transfer_cmd;
 
     VKState(int gpu_idx);
 
@@ -104,6 +138,24 @@ struct VKState : public renderer::State {
     void late_init(const Config &cfg, const std::string_view game_id, MemState &mem) override;
     void cleanup();
 
+    // submit to the general queue, signaling the next value of the gpu timeline if it is supported
+    void submit_general(vk::SubmitInfo &submit_info, vk::Fence fence);
+    // return the transfer command buffer being recorded, begin one if there is none
+    vk::CommandBuffer get_transfer_cmd();
+    // wait for the gpu timeline to reach this value
+    bool wait_gpu_timeline(uint64_t value);
+    // last value reached by the gpu timeline, does not wait
+    uint64_t get_gpu_timeline_progress();
+
+    // allocation info of a texture cache image, in the pool of its size class
+    vma::AllocationCreateInfo get_texture_alloc_info(const vk::ImageCreateInfo &image_info) const;
+    // allocation info of a color surface of the surface cache
+    vma::AllocationCreateInfo get_surface_alloc_info(uint32_t width, uint32_t height) const;
+    // lower the automatic texture cache budget when the heap budget is running out, called once per frame
+    void update_memory_budget();
+    // compact the texture pools, the gpu must be idle and no scene must be recording
+    void defragment_memory();
+
     TextureCache *get_texture_cache() override {
         return &texture_cache;
     }
@@ -127,6 +179,7 @@ struct VKState : public renderer::State {
     std::vector<std::string> get_gpu_list() override;
 
     void precompile_shader(const ShadersHash &hash) override;
+    uint32_t start_shader_warmup() override;
     void preclose_action() override;
 
     inline FrameObject &frame() {
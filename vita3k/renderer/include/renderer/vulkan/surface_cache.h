@@ -22,12 +22,17 @@
 #include <util/containers.h>
 #include <vkutil/objects.h>
 
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 
 struct SwsContext;
 
 namespace renderer::vulkan {
 
+struct PostSurfaceSyncRequest;
 struct VKRenderTarget;
 struct VKState;
 struct Viewport;
@@ -49,6 +54,32 @@ struct SurfaceCacheInfo {
     SurfaceTiling tiling;
 };
 
+// state of an asynchronous surface sync, shared with the memory trap
+// the surface is copied to a staging buffer at the end of the scene and
+// this copy is only written to the guest memory when the guest accesses it
+struct SurfaceReadback {
+    std::mutex mutex;
+    // notified by the wait thread each time a copy to the staging buffer is done
+    std::condition_variable copy_done_cond;
+    uint64_t copies_requested = 0;
+    uint64_t copies_done = 0;
+
+    // persistently mapped buffer the surface is copied to
+    vkutil::Buffer staging_buffer;
+
+    // the staging buffer contains data that was not written to the guest memory yet
+    bool pending = false;
+    // the memory trap of this readback is set
+    bool is_protected = false;
+
+    // copy of the surface properties used for the write back, the surface can be destroyed before it happens
+    Ptr<void> data;
+    uint32_t size = 0;
+    uint32_t nb_pixels = 0;
+    vk::Format format;
+    vk::ComponentSwizzle swizzle_r;
+};
+
 struct Framebuffer {
     // standard framebuffer, used most of the time
     vk::Framebuffer standard;
@@ -70,6 +101,13 @@ struct CastedTexture {
     SceGxmColorBaseFormat format;
 };
 
+// view of a surface with another format of the same texel size, used instead of a copy
+struct CastedView {
+    vk::Format format;
+    vk::ComponentMapping swizzle;
+    vk::ImageView view;
+};
+
 struct ColorSurfaceCacheInfo : public SurfaceCacheInfo {
     uint16_t width;
     uint16_t height;
@@ -84,6 +122,9 @@ struct ColorSurfaceCacheInfo : public SurfaceCacheInfo {
 
     Ptr<void> data;
     std::vector<CastedTexture> casted_textures;
+    std::vector<CastedView> casted_views;
+    // formats this surface can be viewed with (including its own), empty if it can't be sampled with another format
+    std::vector<vk::Format> view_formats;
     // use a unique_ptr for the following objects as they may not be used
 
     // same image with a different view(swizzle) used for sampling
@@ -95,8 +136,11 @@ struct ColorSurfaceCacheInfo : public SurfaceCacheInfo {
     // only used for 3-component rgb textures which can't be copied directly
     std::unique_ptr<vkutil::Buffer> copy_buffer;
 
-    // pointer shared with the memory trap indicating if this surface sync is needed
-    std::shared_ptr<bool> need_surface_sync;
+    // guest accesses seen by the memory trap, nullptr if the surface is not synced with its memory
+    std::shared_ptr<SurfaceGuestAccess> guest_access;
+
+    // only used with asynchronous surface sync
+    std::shared_ptr<SurfaceReadback> readback;
 
     // pointer to decoder used for surface sync (if necessary)
     SwsContext *sws_context = nullptr;
@@ -123,6 +167,8 @@ struct DepthStencilSurfaceCacheInfo : public SurfaceCacheInfo {
     // stride in samples
     uint32_t stride_samples;
     SceGxmMultisampleMode multisample_mode;
+    // the surface was never loaded nor stored, it is kept in tile memory and can not be sampled
+    bool is_transient = false;
 
     // used when reading from this depth stencil in a shader with texture viewport enabled
     vk::ImageView depth_view = nullptr;
@@ -152,7 +198,7 @@ private:
     // only have 20 color surfaces and 20 depth surfaces allocated at most at a given time
     static constexpr uint32_t max_surfaces_allowed = 20;
 
-    std::map<Address, ColorSurfaceCacheInfo *> color_address_lookup;
+    SurfaceIntervalTree<ColorSurfaceCacheInfo *> color_address_lookup;
 
     std::map<Address, DepthStencilSurfaceCacheInfo *> depth_address_lookup;
     std::map<Address, DepthStencilSurfaceCacheInfo *> stencil_address_lookup;
@@ -163,15 +209,29 @@ private:
 
     std::map<std::pair<vk::ImageView, vk::ImageView>, Framebuffer> framebuffer_array;
 
+    // depth-stencils of the render targets, by dimensions
+    std::map<std::pair<uint32_t, uint32_t>, std::weak_ptr<vkutil::Image>> transient_ds_lookup;
+
     VKRenderTarget *target = nullptr;
     ColorSurfaceCacheInfo *last_written_surface = nullptr;
 
+    // formats of the same texel size a surface with this format can be viewed with
+    std::map<vk::Format, std::vector<vk::Format>> compatible_view_formats;
+    const std::vector<vk::Format> &get_compatible_view_formats(vk::Format format);
+
     // destroy all framebuffers using view as their color or depth-stencil
     void destroy_framebuffers(vk::ImageView view);
 
     void destroy_surface(ColorSurfaceCacheInfo &info);
     void destroy_surface(DepthStencilSurfaceCacheInfo &info);
 
+    // which of the GPU and the guest wrote last to the linear color surfaces
+    SurfaceSyncTracker sync_tracker;
+    // catch the next guest access to the memory of the surface
+    void arm_sync_trap(MemState &mem, ColorSurfaceCacheInfo &info);
+    // copy the guest memory of the surface to its image, return false if the layouts differ
+    bool upload_surface(ColorSurfaceCacheInfo &info);
+
 public:
     // when creating a mutable image, can we pass as an argument
     // the possible format used for an image view to improve performance ?
@@ -182,10 +242,16 @@ public:
     // It only works with Nvidia drivers on Linux...
     bool can_mprotect_mapped_memory = true;
 
+    // copy synced surfaces to a staging buffer and only write them to the guest memory when it is accessed
+    // requires can_mprotect_mapped_memory
+    bool use_async_surface_sync = false;
+
     explicit VKSurfaceCache(VKState &state);
 
     SurfaceRetrieveResult retrieve_color_surface_for_framebuffer(MemState &mem, SceGxmColorSurface *color);
     std::optional<TextureLookupResult> retrieve_color_surface_as_texture(const SceGxmTexture &texture, const SceGxmColorBaseFormat base_format, TextureViewport *texture_viewport);
+    // the color surface starting at the address of the transfer image with the same layout and pixel size, nullptr if there is none
+    ColorSurfaceCacheInfo *retrieve_color_surface_for_transfer(const SceGxmTransferImage &image, const SceGxmTransferType type);
 
     SurfaceRetrieveResult retrieve_depth_stencil_for_framebuffer(SceGxmDepthStencilSurface *depth_stencil, const uint32_t width, const uint32_t height);
     std::optional<TextureLookupResult> retrieve_depth_stencil_as_texture(const SceGxmTexture &texture, TextureViewport *texture_viewport);
@@ -193,8 +259,9 @@ public:
     Framebuffer &retrieve_framebuffer_handle(MemState &mem, SceGxmColorSurface *color, SceGxmDepthStencilSurface *depth_stencil,
         vk::RenderPass standard_render_pass, vk::RenderPass interlock_render_pass, vk::ImageView &color_view, vk::ImageView &ds_view);
 
-    // If non-null, the return value must be sent as a PostSurfaceSyncRequest
-    ColorSurfaceCacheInfo *perform_surface_sync();
+    // If its cache_info or readback is non-null, the return value must be sent to the wait thread
+    // can_defer must only be set if the request is sent right after the command buffer is submitted
+    PostSurfaceSyncRequest perform_surface_sync(MemState &mem, bool can_defer);
 
     // Called after the render has been done
     void perform_post_surface_sync(const MemState &mem, ColorSurfaceCacheInfo *surface);
@@ -203,6 +270,10 @@ public:
     // (meaning their color or depth-stencil surface is not backed by memory)
     void destroy_associated_framebuffers(const VKRenderTarget *render_target);
 
+    // depth-stencil whose content never outlives a render pass, so it is shared by all the render targets with the same dimensions
+    // it uses no memory on GPUs with lazily allocated memory
+    std::shared_ptr<vkutil::Image> retrieve_transient_depth_stencil(uint32_t width, uint32_t height);
+
     // Return the image along with the viewport to be displayed on the screen
     // Viewport should already have its fields width and height filled
     vk::ImageView sourcing_color_surface_for_presentation(Ptr<const void> address, uint32_t pitch, Viewport &viewport);
@@ -21,8 +21,12 @@
 #include <renderer/types.h>
 
 #include <threads/queue.h>
+#include <util/containers.h>
 #include <vkutil/objects.h>
 
+#include <atomic>
+#include <memory>
+
 struct MemState;
 
 namespace renderer::vulkan {
@@ -32,6 +36,8 @@ struct VKRenderTarget;
 
 constexpr int MAX_FRAMES_RENDERING = 3;
 constexpr int NB_TEXTURE_STAGING_BUFFERS = 16;
+// maximum number of recordings per frame whose gpu time is measured
+constexpr uint32_t MAX_SCENE_TIMESTAMPS = 256;
 
 struct TextureStagingBuffer {
     vkutil::Buffer buffer;
@@ -39,10 +45,45 @@ struct TextureStagingBuffer {
     uint64_t scene_timestamp = ~0;
     uint64_t frame_timestamp = ~0;
     vk::Fence waiting_fence;
+    // used instead of waiting_fence with timeline semaphores
+    uint64_t waiting_timeline_value = 0;
+};
+
+struct UniformBlockUpload {
+    const uint8_t *data;
+    uint32_t size;
+    // offset in the uniform storage of the program, in bytes
+    uint32_t offset;
+};
+
+// uniform blocks of a shader stage, copied to the uniform ring buffer when drawing
+struct UniformStorage {
+    std::array<UniformBlockUpload, SCE_GXM_REAL_MAX_UNIFORM_BUFFER> blocks;
+    // bitmask of the blocks set since the last draw
+    uint32_t blocks_set = 0;
+    uint32_t storage_size = 0;
+
+    // ring buffer offset of each storage content uploaded during this scene
+    // a lot of draws (especially for UIs) use the exact same uniforms, these are only uploaded once
+    unordered_map_fast<uint64_t, uint32_t> uploaded;
+    uint64_t uploaded_scene = 0;
+};
+
+// copy of a guest vertex stream in GPU memory, used as long as the game does not write to it
+struct CachedVertexStream {
+    vkutil::Buffer buffer;
+    // set by the write protection callback, the stream must then be uploaded again
+    std::atomic<bool> dirty = true;
+    // the stream was written right after being uploaded, it always goes through the ring buffer
+    bool is_dynamic = false;
+    uint64_t upload_frame = 0;
+    uint64_t last_use_frame = 0;
 };
 
 struct TextureCacheEntry {
     vkutil::Image texture;
+    // swizzle of the view, needed to create it again when the texture is moved
+    vk::ComponentMapping swizzle;
     bool is_cube;
     uint16_t mip_count;
     uint32_t memory_needed;
@@ -63,21 +104,54 @@ struct VKTextureCache : public TextureCache {
     const SceGxmTexture *gxm_texture = nullptr;
     vk::CommandBuffer cmd_buffer = nullptr;
     bool is_texture_transfer_ready = false;
+    // the queue of a new texture is chosen when its first command is recorded
+    bool is_initial_transition_pending = false;
+    // the texture being uploaded is on the transfer queue, it must be given to the general queue once done
+    bool is_on_transfer_queue = false;
+
+    // compute pipelines used to linearize and decompress textures when use_gpu_decode is set
+    vk::ShaderModule detile_shader;
+    vk::ShaderModule pvrtc_shader;
+    vk::ShaderModule yuv420_shader;
+    vk::ShaderModule palette_shader;
+    vk::DescriptorSetLayout decode_descriptor_set_layout;
+    vk::DescriptorPool decode_descriptor_pool;
+    // one for each staging buffer, both bindings point to it
+    std::array<vk::DescriptorSet, NB_TEXTURE_STAGING_BUFFERS> decode_descriptor_sets;
+    vk::PipelineLayout decode_pipeline_layout;
+    vk::Pipeline detile_pipeline;
+    vk::Pipeline pvrtc_pipeline;
+    vk::Pipeline yuv420_pipeline;
+    vk::Pipeline palette_pipeline;
+    // alignment of the guest and decoded data in the staging buffer
+    uint32_t decode_alignment = 16;
 
     VKTextureCache(VKState &state);
     // get an available staging buffer, wait for one if all are busy
     void prepare_staging_buffer(bool is_configure = false);
+    // record the initial transition of a new texture, on the transfer queue if it is used and only copies are done
+    void select_upload_queue(bool copy_only);
 
     bool init(const bool hashless_texture_cache, const fs::path &texture_folder, const std::string_view game_id);
+    // return false if the compute shaders could not be loaded
+    bool init_gpu_decode();
     void select(size_t index, const SceGxmTexture &texture) override;
     void configure_texture(const SceGxmTexture &texture) override;
-    void upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride) override;
+    void upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t row_offset) override;
     void upload_done() override;
+    void upload_placeholder(const SceGxmTexture &texture) override;
+    bool supports_gpu_decode(const SceGxmTexture &texture) const override;
+    bool supports_mipmap_generation(const SceGxmTexture &texture) const override;
+    void upload_guest_layout_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height) override;
 
     void configure_sampler(size_t index, const SceGxmTexture &texture) override;
+    void release_texture(size_t index) override;
 
     void import_configure_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, bool is_srgb, uint16_t nb_components, uint16_t mipcount, bool swap_rb) override;
 
+    // move the textures of the pool to fill the holes left by the evicted ones, the gpu must be idle
+    void defragment(vma::Pool pool);
+
     vk::Sampler get_retrieved_sampler() const {
         return samplers[last_bound_sampler_index];
     }
@@ -88,13 +162,24 @@ struct FrameDescriptor {
     int descriptors_idx = 0;
 };
 
+// visibility results copied to a readback buffer, written to the guest memory once the frame is done
+struct VisibilityReadback {
+    Address address;
+    const uint32_t *results;
+    uint32_t count;
+};
+
 struct FrameObject {
     vk::CommandPool render_pool;
     // we need to have a specific prerender pool because prerender command buffer
     // can be reset if we use too many new textures at once
     vk::CommandPool prerender_pool;
+    // only used with a dedicated transfer queue
+    vk::CommandPool transfer_pool;
 
     std::vector<vk::Fence> rendered_fences;
+    // with timeline semaphores, gpu timeline value of the last submission of the frame, 0 if nothing was submitted
+    uint64_t timeline_value = 0;
     // equals to context.frame_timestamp when the frame object is used
     uint64_t frame_timestamp;
 
@@ -108,6 +193,14 @@ struct FrameObject {
 
     // destroy gpu objects MAX_FRAMES_RENDERING frames later to make sure they are no longer being used
     vkutil::DestroyQueue destroy_queue;
+
+    // timestamps written at the beginning and the end of each recording, read back when the frame object is reused
+    vk::QueryPool timestamp_pool;
+    // gxm scene of each timestamp pair, a scene is split in multiple recordings by mid-scene flushes
+    std::vector<uint64_t> timestamp_scenes;
+
+    // only used without memory mapping
+    std::vector<VisibilityReadback> visibility_readbacks;
 };
 
 struct MappedMemoryBuffer {
@@ -124,6 +217,7 @@ struct MappedMemory {
 };
 
 struct ColorSurfaceCacheInfo;
+struct SurfaceReadback;
 
 // Use vulkan queries to implement visibility buffer
 struct VisibilityBuffer {
@@ -133,10 +227,14 @@ struct VisibilityBuffer {
     uint32_t size;
     vk::QueryPool query_pool;
     std::vector<bool> queries_used; // the queries that were used in the current scene
+    // only used without memory mapping, has a part for each frame in flight the results are copied to before the guest memory
+    vkutil::Buffer readback_buffer;
 };
 
 struct FenceWaitRequest {
+    // null if timeline semaphores are used
     vk::Fence fence;
+    uint64_t timeline_value;
 };
 
 // request to trigger a notification after the previous fences have been waited for
@@ -154,7 +252,10 @@ struct SyncSignalRequest {
 };
 
 struct PostSurfaceSyncRequest {
-    ColorSurfaceCacheInfo *cache_info;
+    ColorSurfaceCacheInfo *cache_info = nullptr;
+    // set instead of cache_info for asynchronous surface sync, the guest memory is written on access
+    std::shared_ptr<SurfaceReadback> readback;
+    uint64_t readback_copy = 0;
 };
 
 // A parallel thread is handling these request and telling other waiting threads
@@ -176,6 +277,8 @@ struct VKContext : public renderer::Context {
 
     uint64_t frame_timestamp = 1;
     uint64_t scene_timestamp = 1;
+    // unlike scene_timestamp, only increased once per gxm scene
+    uint64_t gxm_scene_timestamp = 0;
     std::vector<vk::CommandBuffer> cmdbuffers_to_submit = {};
 
     vkutil::HostRingBuffer vertex_stream_ring_buffer;
@@ -188,8 +291,14 @@ struct VKContext : public renderer::Context {
     vk::DescriptorImageInfo vertex_textures[SCE_GXM_MAX_TEXTURE_UNITS] = {};
     vk::DescriptorImageInfo fragment_textures[SCE_GXM_MAX_TEXTURE_UNITS] = {};
 
-    bool vertex_uniform_storage_allocated = false;
-    bool fragment_uniform_storage_allocated = false;
+    UniformStorage vertex_uniform_storage;
+    UniformStorage fragment_uniform_storage;
+
+    // only used without memory mapping, the key is the guest address and size of the stream
+    unordered_map_fast<uint64_t, std::shared_ptr<CachedVertexStream>> vertex_stream_cache;
+    uint64_t vertex_stream_cache_eviction_frame = 0;
+    // streams with a stride which is not a multiple of 4 are copied here first (macOS only)
+    std::vector<uint8_t> restride_buffer;
 
     vk::Buffer vertex_stream_buffers[SCE_GXM_MAX_VERTEX_STREAMS];
     vk::DeviceSize vertex_stream_offsets[SCE_GXM_MAX_VERTEX_STREAMS] = {};
@@ -244,6 +353,8 @@ struct VKContext : public renderer::Context {
     vk::ImageView current_ds_view;
 
     bool is_recording = false;
+    // first timestamp query of the current recording, -1 if it is not measured
+    int timestamp_query_idx = -1;
     bool in_renderpass = false;
     bool refresh_pipeline = false;
     bool is_first_scene_draw = false;
@@ -253,6 +364,18 @@ struct VKContext : public renderer::Context {
     vk::CommandBuffer prerender_cmd{};
     // next fence to be used to wait for the current scene
     vk::Fence next_fence{};
+
+    // the scene has ended but its render pass is kept open until the next scene is known
+    // if the next one uses the same surfaces, both scenes are rendered in the same render pass
+    bool is_scene_end_pending = false;
+    SceGxmNotification pending_notifications[2] = {};
+    SceGxmColorSurface pending_color_surface;
+    SceGxmDepthStencilSurface pending_ds_surface;
+    // the depth-stencil is stored by current_render_pass, and by the render pass being recorded
+    bool current_ds_store = false;
+    bool is_ds_stored = false;
+    // set_context doubled the size of the render target to emulate MSAA without downscale
+    bool is_msaa_upscaled = false;
     VKRenderTarget *cmd_target = nullptr;
 
     // used for macroblock sync emulation
@@ -280,6 +403,12 @@ struct VKContext : public renderer::Context {
     void start_render_pass(bool create_descriptor_set = true);
     void stop_render_pass();
     void stop_recording(const SceGxmNotification &notif1, const SceGxmNotification &notif2, bool submit = true);
+    // end of a gxm scene, the submission may be deferred until the next scene is set
+    void end_scene(const SceGxmNotification &notif1, const SceGxmNotification &notif2);
+    // submit the scene whose end was deferred, if any
+    void submit_pending_scene();
+    // log the largest usage of each ring buffer, to tune their default size
+    void log_ring_buffer_usage() const;
 
     // check (when the render target has macroblock set) if we are drawing to another block
     void check_for_macroblock_change(bool is_draw);
@@ -292,7 +421,9 @@ struct VKRenderTarget : public renderer::RenderTarget {
     uint16_t width;
     uint16_t height;
     vkutil::Image color;
-    vkutil::Image depthstencil;
+    // used when the depth-stencil is not backed by memory, shared with the render targets of the same size
+    // unless shader interlock is used as its content must then outlive the render pass
+    std::shared_ptr<vkutil::Image> depthstencil;
 
     uint64_t last_used_frame = 0;
 
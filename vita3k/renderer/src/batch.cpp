@@ -18,6 +18,7 @@
 #include <renderer/commands.h>
 #include <renderer/driver_functions.h>
 #include <renderer/functions.h>
+#include <renderer/profile.h>
 #include <renderer/state.h>
 #include <renderer/types.h>
 
@@ -31,12 +32,46 @@
 struct FeatureState;
 
 namespace renderer {
+static CommandArena host_command_arena;
+
+Command *CommandArena::allocate() {
+    const std::lock_guard<std::mutex> alloc_guard(alloc_mutex);
+    if (local_free.empty()) {
+        const std::lock_guard<std::mutex> shared_guard(shared_mutex);
+        if (shared_free.empty()) {
+            Command *block = blocks.emplace_back(std::make_unique<Command[]>(BLOCK_SIZE)).get();
+            for (std::size_t i = 0; i < BLOCK_SIZE; i++)
+                shared_free.push_back(&block[i]);
+        }
+        std::swap(local_free, shared_free);
+    }
+
+    Command *cmd = local_free.back();
+    local_free.pop_back();
+    return new (cmd) Command;
+}
+
+void CommandArena::release(Command *cmd) {
+    const std::lock_guard<std::mutex> guard(release_mutex);
+    released.push_back(cmd);
+}
+
+void CommandArena::flush_released() {
+    const std::lock_guard<std::mutex> release_guard(release_mutex);
+    if (released.empty())
+        return;
+
+    const std::lock_guard<std::mutex> shared_guard(shared_mutex);
+    shared_free.insert(shared_free.end(), released.begin(), released.end());
+    released.clear();
+}
+
 Command *generic_command_allocate() {
-    return new Command;
+    return host_command_arena.allocate();
 }
 
 void generic_command_free(Command *cmd) {
-    delete cmd;
+    host_command_arena.release(cmd);
 }
 
 void complete_command(State &state, CommandHelper &helper, const int code) {
@@ -45,6 +80,12 @@ void complete_command(State &state, CommandHelper &helper, const int code) {
     state.command_finish_one.notify_all();
 }
 
+// a scene whose end is deferred must be submitted before anything but the beginning of the next scene is done
+static void submit_pending_scene(State &state) {
+    if (state.current_backend == Backend::Vulkan && state.context)
+        reinterpret_cast<vulkan::VKContext *>(state.context)->submit_pending_scene();
+}
+
 bool is_cmd_ready(MemState &mem, CommandList &command_list) {
     // we check if the cmd starts with a WaitSyncObject and if this is the case if it is ready
     if (!command_list.first || command_list.first->opcode != CommandOpcode::WaitSyncObject)
@@ -67,6 +108,7 @@ bool wait_cmd(MemState &mem, CommandList &command_list) {
 }
 
 void process_batch(renderer::State &state, const FeatureState &features, MemState &mem, Config &config, CommandList &command_list) {
+    R_FRAME_TIMER(CommandDecode);
     using CommandHandlerFunc = decltype(cmd_handle_set_context);
 
     const static std::map<CommandOpcode, CommandHandlerFunc *> handlers = {
@@ -78,6 +120,7 @@ void process_batch(renderer::State &state, const FeatureState &features, MemStat
         { CommandOpcode::MemoryMap, cmd_handle_memory_map },
         { CommandOpcode::MemoryUnmap, cmd_handle_memory_unmap },
         { CommandOpcode::Draw, cmd_handle_draw },
+        { CommandOpcode::DrawPacked, cmd_handle_draw_packed },
         { CommandOpcode::TransferCopy, cmd_handle_transfer_copy },
         { CommandOpcode::TransferDownscale, cmd_handle_transfer_downscale },
         { CommandOpcode::TransferFill, cmd_handle_transfer_fill },
@@ -100,12 +143,19 @@ void process_batch(renderer::State &state, const FeatureState &features, MemStat
         }
 
         auto handler = handlers.find(cmd->opcode);
-        if (handler == handlers.end()) {
+        state.capture.before_command(state, mem, *cmd, command_list.context);
+        if (cmd->opcode != CommandOpcode::SetContext && !(cmd->flags & Command::FLAG_PAYLOAD))
+            submit_pending_scene(state);
+
+        if (cmd->flags & Command::FLAG_PAYLOAD) {
+            // already read by the command it belongs to
+        } else if (handler == handlers.end()) {
             LOG_ERROR("Unimplemented command opcode {}", static_cast<int>(cmd->opcode));
         } else {
             CommandHelper helper(cmd);
             handler->second(state, mem, config, helper, features, command_list.context, state.cache_path.c_str(), state.title_id, state.self_name);
         }
+        state.capture.after_command(state, mem, *cmd, command_list.context);
 
         Command *last_cmd = cmd;
         cmd = cmd->next;
@@ -116,14 +166,19 @@ void process_batch(renderer::State &state, const FeatureState &features, MemStat
             generic_command_free(last_cmd);
         }
     } while (true);
+
+    host_command_arena.flush_released();
 }
 
 void process_batches(renderer::State &state, const FeatureState &features, MemState &mem, Config &config) {
     while (!state.should_display) {
         // Try to wait for a batch (about 2 or 3ms, game should be fast for this)
-        auto cmd_list = state.command_buffer_queue.top(3);
+        CommandList *cmd_list = state.command_buffer_queue.front(3);
 
         if (!cmd_list || !is_cmd_ready(mem, *cmd_list)) {
+            // the next scene is not there yet, the GPU should not wait for it
+            submit_pending_scene(state);
+
             // beginning of the game or homebrew not using gxm
             if (state.context == nullptr)
                 return;
@@ -137,9 +192,14 @@ void process_batches(renderer::State &state, const FeatureState &features, MemSt
                 continue;
         }
 
+        // the slot can be reused by the producer as soon as it is popped
+        CommandList command_list = *cmd_list;
         state.command_buffer_queue.pop();
-        process_batch(state, features, mem, config, *cmd_list);
+        process_batch(state, features, mem, config, command_list);
     }
+
+    // the frame is about to be displayed
+    submit_pending_scene(state);
 }
 
 void reset_command_list(CommandList &command_list) {
@@ -0,0 +1,873 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/capture.h>
+
+#include <renderer/functions.h>
+#include <renderer/state.h>
+#include <renderer/types.h>
+
+#include <renderer/gl/functions.h>
+#include <renderer/vulkan/functions.h>
+#include <renderer/vulkan/types.h>
+
+#include <display/state.h>
+#include <mem/functions.h>
+#include <util/log.h>
+
+#include <cstring>
+#include <type_traits>
+
+namespace renderer {
+
+// Layout of a capture: magic, version, title id, self name, number of frames, the memory snapshot,
+// then the records until CaptureRecord::End
+constexpr char CAPTURE_MAGIC[4] = { 'V', '3', 'K', 'G' };
+constexpr uint32_t CAPTURE_VERSION = 1;
+constexpr size_t CAPTURE_BUFFER_SIZE = 4 * 1024 * 1024;
+// the ranges read by a draw larger than this are left to the memory snapshot
+constexpr uint32_t CAPTURE_MAX_RANGE_SIZE = 16 * 1024 * 1024;
+
+enum class CaptureRecord : uint8_t {
+    // opcode, flags, context id, data of the command, then the host objects it points to
+    Command,
+    // address, size and content of a range of guest memory read by the next commands
+    Memory,
+    // a fragment or vertex program used by the next commands
+    Program,
+    // the state of a context when the capture started
+    ContextState,
+    // the objects held by the renderer were all created again
+    SetupEnd,
+    // a frame was sent to the display, with the frame to show
+    FrameEnd,
+    End
+};
+
+static_assert(std::is_trivially_copyable_v<GxmRecordState>, "The record state is written as is");
+
+template <typename T>
+static void write_value(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_value(std::istream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+static void write_string(std::ostream &out, const std::string &str) {
+    write_value(out, static_cast<uint32_t>(str.size()));
+    out.write(str.data(), str.size());
+}
+
+static bool read_string(std::istream &in, std::string &str) {
+    uint32_t size = 0;
+    if (!read_value(in, size) || (size > 1024))
+        return false;
+    str.resize(size);
+    return static_cast<bool>(in.read(str.data(), size));
+}
+
+template <typename T>
+static void append_value(std::vector<uint8_t> &buffer, const T &value) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static T read_data(const Command &cmd, size_t offset) {
+    T value;
+    memcpy(&value, cmd.data + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+static void write_data(Command &cmd, size_t offset, const T &value) {
+    memcpy(cmd.data + offset, &value, sizeof(T));
+}
+
+// Reads the host objects written after a command
+class ExtraReader {
+public:
+    explicit ExtraReader(const std::vector<uint8_t> &extra)
+        : extra(extra) {}
+
+    template <typename T>
+    bool read(T &value) {
+        if (offset + sizeof(T) > extra.size())
+            return false;
+        memcpy(&value, extra.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+private:
+    const std::vector<uint8_t> &extra;
+    size_t offset = 0;
+};
+
+// offsets of the host pointers in the data of the commands, in the order the arguments are pushed
+constexpr size_t TRANSFER_COPY_IMAGES_OFFSET = 2 * sizeof(uint32_t) + sizeof(SceGxmTransferColorKeyMode);
+constexpr size_t TRANSFER_FILL_DEST_OFFSET = sizeof(uint32_t);
+constexpr size_t DRAW_PACKED_STREAMS_OFFSET = sizeof(SceGxmPrimitiveType) + sizeof(SceGxmIndexFormat) + sizeof(Ptr<const void>) + 2 * sizeof(uint32_t) + sizeof(uint16_t);
+
+void CommandCapture::request(const fs::path &path, uint32_t frame_count) {
+    if (capturing) {
+        LOG_WARN("A GPU capture is already running");
+        return;
+    }
+
+    const std::lock_guard<std::mutex> lock(request_mutex);
+    requested_path = path;
+    requested_frames = std::max(frame_count, 1u);
+    requested = true;
+}
+
+uint32_t CommandCapture::get_context_id(Context *context) const {
+    const auto it = contexts.find(context);
+    return (it != contexts.end()) ? it->second : 0;
+}
+
+uint32_t CommandCapture::get_render_target_id(RenderTarget *render_target) const {
+    const auto it = render_targets.find(render_target);
+    return (it != render_targets.end()) ? it->second.first : 0;
+}
+
+void CommandCapture::write_command(const Command &cmd, Context *context, const void *extra, uint32_t extra_size) {
+    write_value(file, CaptureRecord::Command);
+    write_value(file, cmd.opcode);
+    write_value(file, cmd.flags);
+    write_value(file, get_context_id(context));
+    file.write(reinterpret_cast<const char *>(cmd.data), sizeof(cmd.data));
+    write_value(file, extra_size);
+    if (extra_size > 0)
+        file.write(reinterpret_cast<const char *>(extra), extra_size);
+}
+
+void CommandCapture::write_memory(MemState &mem, Address address, uint32_t size) {
+    if (!address || (size == 0) || (size > CAPTURE_MAX_RANGE_SIZE) || !is_valid_addr_range(mem, address, address + size))
+        return;
+
+    const uint8_t *data = Ptr<uint8_t>(address).get(mem);
+    std::vector<uint8_t> &written = written_memory[address];
+    if ((written.size() == size) && (memcmp(written.data(), data, size) == 0))
+        return;
+    written.assign(data, data + size);
+
+    write_value(file, CaptureRecord::Memory);
+    write_value(file, address);
+    write_value(file, size);
+    file.write(reinterpret_cast<const char *>(data), size);
+}
+
+// The programs in guest memory point to host objects, they are written with what is needed to create them again
+void CommandCapture::write_program(MemState &mem, Address address, bool is_fragment) {
+    if (!address || !written_programs.insert(address).second)
+        return;
+
+    Address program_address;
+    if (is_fragment) {
+        const SceGxmFragmentProgram *program = Ptr<SceGxmFragmentProgram>(address).get(mem);
+        const FragmentProgram *renderer_data = program->renderer_data.get();
+        program_address = program->program.address();
+        write_memory(mem, program_address, program->program.get(mem)->size);
+
+        write_value(file, CaptureRecord::Program);
+        write_value(file, address);
+        write_value(file, static_cast<uint8_t>(true));
+        write_value(file, program_address);
+        write_value(file, static_cast<uint8_t>(program->is_maskupdate));
+        write_value(file, static_cast<uint8_t>(renderer_data && renderer_data->has_blend));
+        write_value(file, renderer_data ? renderer_data->blend : SceGxmBlendInfo{});
+    } else {
+        const SceGxmVertexProgram *program = Ptr<SceGxmVertexProgram>(address).get(mem);
+        program_address = program->program.address();
+        write_memory(mem, program_address, program->program.get(mem)->size);
+
+        write_value(file, CaptureRecord::Program);
+        write_value(file, address);
+        write_value(file, static_cast<uint8_t>(false));
+        write_value(file, program_address);
+        write_value(file, program->key_hash);
+        write_value(file, static_cast<uint32_t>(program->streams.size()));
+        file.write(reinterpret_cast<const char *>(program->streams.data()), program->streams.size() * sizeof(SceGxmVertexStream));
+        write_value(file, static_cast<uint32_t>(program->attributes.size()));
+        file.write(reinterpret_cast<const char *>(program->attributes.data()), program->attributes.size() * sizeof(SceGxmVertexAttribute));
+    }
+}
+
+void CommandCapture::write_context_state(MemState &mem, Context *context) {
+    write_program(mem, context->record.fragment_program.address(), true);
+    write_program(mem, context->record.vertex_program.address(), false);
+
+    write_value(file, CaptureRecord::ContextState);
+    write_value(file, get_context_id(context));
+    write_value(file, get_render_target_id(context->current_render_target));
+    write_value(file, context->record);
+}
+
+void CommandCapture::begin(State &state, MemState &mem) {
+    {
+        const std::lock_guard<std::mutex> lock(request_mutex);
+        path = requested_path;
+        frames_left = requested_frames;
+        requested = false;
+    }
+
+    fs::create_directories(path.parent_path());
+    file_buffer.resize(CAPTURE_BUFFER_SIZE);
+    file.rdbuf()->pubsetbuf(file_buffer.data(), file_buffer.size());
+    file.open(path.string(), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to create the GPU capture {}", path.string());
+        return;
+    }
+
+    file.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    write_value(file, CAPTURE_VERSION);
+    write_string(file, state.title_id ? state.title_id : "");
+    write_string(file, state.self_name ? state.self_name : "");
+    // written again once the capture is over
+    frame_count_position = file.tellp();
+    write_value(file, frames_left);
+    if (!save_snapshot(mem, file)) {
+        file.close();
+        LOG_ERROR("Failed to write the memory of the GPU capture {}", path.string());
+        return;
+    }
+
+    // the objects held by the renderer are created again by the replay, with the same commands
+    for (const auto &[address, size] : mapped_memories) {
+        Command cmd{};
+        cmd.opcode = CommandOpcode::MemoryMap;
+        write_data(cmd, 0, Ptr<void>(address));
+        write_data(cmd, sizeof(Ptr<void>), size);
+        write_command(cmd, nullptr);
+    }
+    for (const auto &[_, render_target] : render_targets) {
+        Command cmd{};
+        cmd.opcode = CommandOpcode::CreateRenderTarget;
+        std::vector<uint8_t> extra;
+        append_value(extra, render_target.first);
+        append_value(extra, render_target.second);
+        write_command(cmd, nullptr, extra.data(), static_cast<uint32_t>(extra.size()));
+    }
+    for (const auto &[context, id] : contexts) {
+        Command cmd{};
+        cmd.opcode = CommandOpcode::CreateContext;
+        write_command(cmd, nullptr, &id, sizeof(id));
+    }
+    for (const auto &[context, _] : contexts)
+        write_context_state(mem, context);
+    write_value(file, CaptureRecord::SetupEnd);
+
+    frames_captured = 0;
+    capturing = true;
+    LOG_INFO("GPU capture of {} frames started to {}", frames_left, path.string());
+}
+
+void CommandCapture::end() {
+    write_value(file, CaptureRecord::End);
+    file.seekp(frame_count_position);
+    write_value(file, frames_captured);
+    file.close();
+
+    capturing = false;
+    written_programs.clear();
+    written_memory.clear();
+    LOG_INFO("GPU capture of {} frames written to {}", frames_captured, path.string());
+}
+
+void CommandCapture::before_command(State &state, MemState &mem, Command &cmd, Context *context) {
+    if (cmd.flags & Command::FLAG_PAYLOAD) {
+        if (capturing)
+            write_command(cmd, context);
+        return;
+    }
+
+    // the objects are forgotten before the command destroys them
+    switch (cmd.opcode) {
+    case CommandOpcode::CreateRenderTarget:
+        // the caller can free the params as soon as the command is completed
+        pending_params = std::make_unique<SceGxmRenderTargetParams>(*read_data<SceGxmRenderTargetParams *>(cmd, sizeof(std::unique_ptr<RenderTarget> *)));
+        return;
+    case CommandOpcode::CreateContext:
+    case CommandOpcode::MemoryMap:
+        // written once the object exists
+        return;
+    case CommandOpcode::DestroyContext: {
+        Context *destroyed = read_data<std::unique_ptr<Context> *>(cmd, 0)->get();
+        const uint32_t id = get_context_id(destroyed);
+        if (capturing)
+            write_command(cmd, nullptr, &id, sizeof(id));
+        contexts.erase(destroyed);
+        return;
+    }
+    case CommandOpcode::DestroyRenderTarget: {
+        RenderTarget *destroyed = read_data<std::unique_ptr<RenderTarget> *>(cmd, 0)->get();
+        const uint32_t id = get_render_target_id(destroyed);
+        if (capturing)
+            write_command(cmd, nullptr, &id, sizeof(id));
+        render_targets.erase(destroyed);
+        return;
+    }
+    case CommandOpcode::MemoryUnmap:
+        if (capturing)
+            write_command(cmd, context);
+        mapped_memories.erase(read_data<Ptr<void>>(cmd, 0).address());
+        return;
+    default:
+        break;
+    }
+
+    if (!capturing)
+        return;
+
+    CommandHelper helper(&cmd);
+    std::vector<uint8_t> extra;
+    switch (cmd.opcode) {
+    case CommandOpcode::SetState: {
+        const GXMState gxm_state = helper.pop<GXMState>();
+        if (gxm_state == GXMState::Program) {
+            const Ptr<void> program = helper.pop<Ptr<void>>();
+            const bool is_fragment = helper.pop<bool>();
+            write_program(mem, program.address(), is_fragment);
+        } else if (gxm_state == GXMState::UniformBuffer) {
+            const Ptr<uint8_t> data = helper.pop<Ptr<uint8_t>>();
+            helper.pop<bool>();
+            helper.pop<int>();
+            const uint32_t size = helper.pop<uint32_t>();
+            write_memory(mem, data.address(), size);
+        } else if (gxm_state == GXMState::VertexStream) {
+            const Ptr<const uint8_t> data = helper.pop<Ptr<const uint8_t>>();
+            helper.pop<std::size_t>();
+            const std::size_t size = helper.pop<std::size_t>();
+            write_memory(mem, data.address(), static_cast<uint32_t>(size));
+        }
+        break;
+    }
+    case CommandOpcode::Draw:
+    case CommandOpcode::DrawPacked: {
+        helper.pop<SceGxmPrimitiveType>();
+        const SceGxmIndexFormat format = helper.pop<SceGxmIndexFormat>();
+        const Ptr<const void> indices = helper.pop<Ptr<const void>>();
+        const uint32_t count = helper.pop<uint32_t>();
+        write_memory(mem, indices.address(), count * ((format == SCE_GXM_INDEX_FORMAT_U16) ? 2 : 4));
+
+        if (cmd.opcode == CommandOpcode::DrawPacked) {
+            helper.pop<uint32_t>();
+            const std::uint16_t stream_mask = helper.pop<std::uint16_t>();
+            for (std::uint16_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; stream_index++) {
+                if (!(stream_mask & (1 << stream_index)))
+                    continue;
+                const Ptr<const uint8_t> data = helper.pop_packed<Ptr<const uint8_t>>();
+                const uint32_t size = helper.pop_packed<uint32_t>();
+                write_memory(mem, data.address(), size);
+            }
+        }
+        break;
+    }
+    case CommandOpcode::SetContext: {
+        RenderTarget *render_target = helper.pop<RenderTarget *>();
+        const SceGxmColorSurface *color_surface = helper.pop<SceGxmColorSurface *>();
+        const SceGxmDepthStencilSurface *depth_stencil_surface = helper.pop<SceGxmDepthStencilSurface *>();
+        append_value(extra, get_render_target_id(render_target));
+        append_value(extra, static_cast<uint8_t>(color_surface != nullptr));
+        append_value(extra, color_surface ? *color_surface : SceGxmColorSurface{});
+        append_value(extra, static_cast<uint8_t>(depth_stencil_surface != nullptr));
+        append_value(extra, depth_stencil_surface ? *depth_stencil_surface : SceGxmDepthStencilSurface{});
+        break;
+    }
+    case CommandOpcode::TransferCopy: {
+        const SceGxmTransferImage *images = read_data<SceGxmTransferImage *>(cmd, TRANSFER_COPY_IMAGES_OFFSET);
+        append_value(extra, images[0]);
+        append_value(extra, images[1]);
+        break;
+    }
+    case CommandOpcode::TransferDownscale:
+        append_value(extra, *read_data<SceGxmTransferImage *>(cmd, 0));
+        append_value(extra, *read_data<SceGxmTransferImage *>(cmd, sizeof(SceGxmTransferImage *)));
+        break;
+    case CommandOpcode::TransferFill:
+        append_value(extra, *read_data<SceGxmTransferImage *>(cmd, TRANSFER_FILL_DEST_OFFSET));
+        break;
+    case CommandOpcode::NewFrame: {
+        const DisplayFrameInfo *next_frame = read_data<DisplayFrameInfo *>(cmd, 0);
+        append_value(extra, static_cast<uint8_t>(next_frame != nullptr));
+        append_value(extra, next_frame ? *next_frame : DisplayFrameInfo{});
+        break;
+    }
+    default:
+        break;
+    }
+
+    write_command(cmd, context, extra.data(), static_cast<uint32_t>(extra.size()));
+}
+
+void CommandCapture::after_command(State &state, MemState &mem, Command &cmd, Context *context) {
+    if (cmd.flags & Command::FLAG_PAYLOAD)
+        return;
+
+    switch (cmd.opcode) {
+    case CommandOpcode::CreateContext: {
+        Context *created = read_data<std::unique_ptr<Context> *>(cmd, 0)->get();
+        if (!created)
+            return;
+        const uint32_t id = next_id++;
+        contexts[created] = id;
+        if (capturing)
+            write_command(cmd, nullptr, &id, sizeof(id));
+        return;
+    }
+    case CommandOpcode::CreateRenderTarget: {
+        RenderTarget *created = read_data<std::unique_ptr<RenderTarget> *>(cmd, 0)->get();
+        if (!created || !pending_params)
+            return;
+        const uint32_t id = next_id++;
+        render_targets[created] = { id, *pending_params };
+        pending_params.reset();
+        if (capturing) {
+            std::vector<uint8_t> extra;
+            append_value(extra, id);
+            append_value(extra, render_targets[created].second);
+            write_command(cmd, nullptr, extra.data(), static_cast<uint32_t>(extra.size()));
+        }
+        return;
+    }
+    case CommandOpcode::MemoryMap: {
+        CommandHelper helper(&cmd);
+        const Ptr<void> address = helper.pop<Ptr<void>>();
+        mapped_memories[address.address()] = helper.pop<uint32_t>();
+        if (capturing)
+            write_command(cmd, context);
+        return;
+    }
+    case CommandOpcode::NewFrame:
+        break;
+    default:
+        return;
+    }
+
+    if (capturing) {
+        // the frame shown by the replay is the one which was about to be displayed
+        DisplayState *display = read_data<DisplayState *>(cmd, sizeof(DisplayFrameInfo *));
+        DisplayFrameInfo frame;
+        {
+            const std::lock_guard<std::mutex> guard(display->display_info_mutex);
+            frame = display->next_rendered_frame;
+        }
+        write_value(file, CaptureRecord::FrameEnd);
+        write_value(file, frame);
+        frames_captured++;
+        if (--frames_left == 0)
+            end();
+    } else if (requested) {
+        // captures start on a frame boundary
+        begin(state, mem);
+    }
+}
+
+bool CaptureReplay::open(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display, const fs::path &path) {
+    file_buffer.resize(CAPTURE_BUFFER_SIZE);
+    file.rdbuf()->pubsetbuf(file_buffer.data(), file_buffer.size());
+    file.open(path.string(), std::ios::binary);
+
+    char magic[sizeof(CAPTURE_MAGIC)];
+    uint32_t version = 0;
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0
+        || !read_value(file, version) || (version != CAPTURE_VERSION)
+        || !read_string(file, title_id) || !read_string(file, self_name) || !read_value(file, frame_count)) {
+        LOG_ERROR("{} is not a valid GPU capture", path.string());
+        return false;
+    }
+
+    // the shaders are looked up in the cache of the captured app
+    state.title_id = title_id.c_str();
+    state.self_name = self_name.c_str();
+
+    if (!load_snapshot(mem, file))
+        return false;
+
+    if (read_records(state, features, mem, config, display) != CaptureRecord::SetupEnd) {
+        LOG_ERROR("{} is not a valid GPU capture", path.string());
+        return false;
+    }
+
+    LOG_INFO("GPU capture of {} frames of {} opened", frame_count, title_id);
+    return true;
+}
+
+bool CaptureReplay::replay_frame(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display) {
+    return read_records(state, features, mem, config, display) == CaptureRecord::FrameEnd;
+}
+
+void CaptureReplay::flush(State &state, const FeatureState &features, MemState &mem, Config &config) {
+    if (!pending.first)
+        return;
+
+    process_batch(state, features, mem, config, pending);
+    pending = {};
+}
+
+void CaptureReplay::process(State &state, const FeatureState &features, MemState &mem, Config &config, Command *cmd, Context *context) {
+    if (!(cmd->flags & Command::FLAG_PAYLOAD) && pending.first && (pending.context != context))
+        flush(state, features, mem, config);
+
+    if (!pending.first) {
+        pending.first = cmd;
+        pending.context = context;
+    } else {
+        pending.last->next = cmd;
+    }
+    pending.last = cmd;
+}
+
+CaptureRecord CaptureReplay::read_records(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display) {
+    CaptureRecord record;
+    while (read_value(file, record)) {
+        switch (record) {
+        case CaptureRecord::Command:
+            if (!read_command(state, features, mem, config, display))
+                return CaptureRecord::End;
+            break;
+
+        case CaptureRecord::Memory: {
+            flush(state, features, mem, config);
+            Address address = 0;
+            uint32_t size = 0;
+            if (!read_value(file, address) || !read_value(file, size) || (size > CAPTURE_MAX_RANGE_SIZE))
+                return CaptureRecord::End;
+            if (is_valid_addr_range(mem, address, address + size))
+                file.read(reinterpret_cast<char *>(Ptr<uint8_t>(address).get(mem)), size);
+            else
+                file.seekg(size, std::ios::cur);
+            break;
+        }
+
+        case CaptureRecord::Program:
+            flush(state, features, mem, config);
+            if (!read_program(state, mem))
+                return CaptureRecord::End;
+            break;
+
+        case CaptureRecord::ContextState:
+            flush(state, features, mem, config);
+            if (!read_context_state(state, mem))
+                return CaptureRecord::End;
+            break;
+
+        case CaptureRecord::SetupEnd:
+            flush(state, features, mem, config);
+            return record;
+
+        case CaptureRecord::FrameEnd: {
+            flush(state, features, mem, config);
+            DisplayFrameInfo frame;
+            if (!read_value(file, frame))
+                return CaptureRecord::End;
+            const std::lock_guard<std::mutex> guard(display.display_info_mutex);
+            display.next_rendered_frame = frame;
+            return record;
+        }
+
+        case CaptureRecord::End:
+            flush(state, features, mem, config);
+            return record;
+
+        default:
+            LOG_ERROR("Unknown GPU capture record {}", static_cast<int>(record));
+            return CaptureRecord::End;
+        }
+
+        if (!file)
+            break;
+    }
+
+    // the app may have been closed in the middle of the capture
+    flush(state, features, mem, config);
+    return CaptureRecord::End;
+}
+
+bool CaptureReplay::read_command(State &state, const FeatureState &features, MemState &mem, Config &config, DisplayState &display) {
+    CommandOpcode opcode;
+    uint8_t flags = 0;
+    uint32_t context_id = 0;
+    uint8_t data[MAX_COMMAND_DATA_SIZE];
+    uint32_t extra_size = 0;
+    if (!read_value(file, opcode) || !read_value(file, flags) || !read_value(file, context_id)
+        || !file.read(reinterpret_cast<char *>(data), sizeof(data)) || !read_value(file, extra_size) || (extra_size > 1024))
+        return false;
+    std::vector<uint8_t> extra(extra_size);
+    if (!file.read(reinterpret_cast<char *>(extra.data()), extra_size))
+        return false;
+
+    Context *context = nullptr;
+    if (context_id != 0) {
+        const auto it = contexts.find(context_id);
+        if ((it == contexts.end()) || !it->second) {
+            LOG_WARN("Command {} of the GPU capture uses an unknown context", static_cast<int>(opcode));
+            return true;
+        }
+        context = it->second.get();
+    }
+
+    // all the commands were already waited for by the game, they are processed in order
+    if ((opcode == CommandOpcode::WaitSyncObject) && !(flags & Command::FLAG_PAYLOAD))
+        return true;
+
+    Command *cmd = generic_command_allocate();
+    cmd->opcode = opcode;
+    cmd->flags = flags;
+    cmd->status = &status;
+    cmd->next = nullptr;
+    memcpy(cmd->data, data, sizeof(data));
+
+    if (flags & Command::FLAG_PAYLOAD) {
+        process(state, features, mem, config, cmd, context);
+        return true;
+    }
+
+    // the host objects pointed to by the command are created again, the handlers free them like the ones of the game
+    ExtraReader reader(extra);
+    uint32_t id = 0;
+    bool valid = true;
+    switch (opcode) {
+    case CommandOpcode::SetContext: {
+        uint8_t has_color_surface = 0;
+        uint8_t has_depth_stencil_surface = 0;
+        SceGxmColorSurface color_surface;
+        SceGxmDepthStencilSurface depth_stencil_surface;
+        valid = reader.read(id) && reader.read(has_color_surface) && reader.read(color_surface)
+            && reader.read(has_depth_stencil_surface) && reader.read(depth_stencil_surface);
+        if (!valid)
+            break;
+        const auto render_target = render_targets.find(id);
+        write_data(*cmd, 0, (render_target != render_targets.end()) ? render_target->second.get() : nullptr);
+        write_data(*cmd, sizeof(RenderTarget *), has_color_surface ? new SceGxmColorSurface(color_surface) : nullptr);
+        write_data(*cmd, sizeof(RenderTarget *) + sizeof(SceGxmColorSurface *), has_depth_stencil_surface ? new SceGxmDepthStencilSurface(depth_stencil_surface) : nullptr);
+        break;
+    }
+    case CommandOpcode::TransferCopy: {
+        SceGxmTransferImage *images = new SceGxmTransferImage[2];
+        valid = reader.read(images[0]) && reader.read(images[1]);
+        if (valid)
+            write_data(*cmd, TRANSFER_COPY_IMAGES_OFFSET, images);
+        else
+            delete[] images;
+        break;
+    }
+    case CommandOpcode::TransferDownscale: {
+        SceGxmTransferImage src;
+        SceGxmTransferImage dest;
+        valid = reader.read(src) && reader.read(dest);
+        if (valid) {
+            write_data(*cmd, 0, new SceGxmTransferImage(src));
+            write_data(*cmd, sizeof(SceGxmTransferImage *), new SceGxmTransferImage(dest));
+        }
+        break;
+    }
+    case CommandOpcode::TransferFill: {
+        SceGxmTransferImage dest;
+        valid = reader.read(dest);
+        if (valid)
+            write_data(*cmd, TRANSFER_FILL_DEST_OFFSET, new SceGxmTransferImage(dest));
+        break;
+    }
+    case CommandOpcode::NewFrame: {
+        uint8_t has_frame = 0;
+        DisplayFrameInfo frame;
+        valid = reader.read(has_frame) && reader.read(frame);
+        if (valid) {
+            write_data(*cmd, 0, has_frame ? new DisplayFrameInfo(frame) : nullptr);
+            write_data(*cmd, sizeof(DisplayFrameInfo *), &display);
+        }
+        break;
+    }
+    case CommandOpcode::CreateContext:
+    case CommandOpcode::DestroyContext:
+        valid = reader.read(id);
+        if (valid)
+            write_data(*cmd, 0, &contexts[id]);
+        break;
+    case CommandOpcode::CreateRenderTarget:
+        valid = reader.read(id) && reader.read(render_target_params[id]);
+        if (valid) {
+            write_data(*cmd, 0, &render_targets[id]);
+            write_data(*cmd, sizeof(std::unique_ptr<RenderTarget> *), &render_target_params[id]);
+        }
+        break;
+    case CommandOpcode::DestroyRenderTarget:
+        valid = reader.read(id);
+        if (valid)
+            write_data(*cmd, 0, &render_targets[id]);
+        break;
+    default:
+        break;
+    }
+
+    if (!valid) {
+        generic_command_free(cmd);
+        return false;
+    }
+
+    process(state, features, mem, config, cmd, context);
+
+    // the objects are created and destroyed right away, the next commands may use them
+    switch (opcode) {
+    case CommandOpcode::CreateContext: {
+        flush(state, features, mem, config);
+        std::unique_ptr<Context> &created = contexts[id];
+        if (created) {
+            created->alloc_func = generic_command_allocate;
+            created->free_func = generic_command_free;
+        }
+        break;
+    }
+    case CommandOpcode::CreateRenderTarget:
+        flush(state, features, mem, config);
+        break;
+    case CommandOpcode::DestroyContext:
+        flush(state, features, mem, config);
+        contexts.erase(id);
+        break;
+    case CommandOpcode::DestroyRenderTarget:
+        flush(state, features, mem, config);
+        render_targets.erase(id);
+        render_target_params.erase(id);
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+bool CaptureReplay::read_program(State &state, MemState &mem) {
+    Address address = 0;
+    uint8_t is_fragment = 0;
+    Address program_address = 0;
+    if (!read_value(file, address) || !read_value(file, is_fragment) || !read_value(file, program_address))
+        return false;
+
+    const bool valid_program = is_valid_addr_range(mem, program_address, program_address + sizeof(SceGxmProgram));
+    if (is_fragment) {
+        uint8_t is_maskupdate = 0;
+        uint8_t has_blend = 0;
+        SceGxmBlendInfo blend;
+        if (!read_value(file, is_maskupdate) || !read_value(file, has_blend) || !read_value(file, blend))
+            return false;
+        if (!valid_program || !is_valid_addr_range(mem, address, address + sizeof(SceGxmFragmentProgram)))
+            return true;
+
+        // the memory still holds the host objects of the game, they must not be destroyed
+        SceGxmFragmentProgram *program = new (Ptr<SceGxmFragmentProgram>(address).get(mem)) SceGxmFragmentProgram();
+        program->program = Ptr<const SceGxmProgram>(program_address);
+        program->is_maskupdate = is_maskupdate;
+        create(program->renderer_data, state, *program->program.get(mem), has_blend ? &blend : nullptr, state.gxp_ptr_map, state.cache_path.c_str(), state.title_id);
+        fragment_programs.push_back(address);
+    } else {
+        uint64_t key_hash = 0;
+        uint32_t stream_count = 0;
+        uint32_t attribute_count = 0;
+        std::vector<SceGxmVertexStream> streams;
+        std::vector<SceGxmVertexAttribute> attributes;
+        if (!read_value(file, key_hash) || !read_value(file, stream_count) || (stream_count > SCE_GXM_MAX_VERTEX_STREAMS))
+            return false;
+        streams.resize(stream_count);
+        if (!file.read(reinterpret_cast<char *>(streams.data()), stream_count * sizeof(SceGxmVertexStream))
+            || !read_value(file, attribute_count) || (attribute_count > SCE_GXM_MAX_VERTEX_ATTRIBUTES))
+            return false;
+        attributes.resize(attribute_count);
+        if (!file.read(reinterpret_cast<char *>(attributes.data()), attribute_count * sizeof(SceGxmVertexAttribute)))
+            return false;
+        if (!valid_program || !is_valid_addr_range(mem, address, address + sizeof(SceGxmVertexProgram)))
+            return true;
+
+        SceGxmVertexProgram *program = new (Ptr<SceGxmVertexProgram>(address).get(mem)) SceGxmVertexProgram();
+        program->program = Ptr<const SceGxmProgram>(program_address);
+        program->key_hash = key_hash;
+        program->streams = std::move(streams);
+        program->attributes = std::move(attributes);
+        create(program->renderer_data, state, *program->program.get(mem), state.gxp_ptr_map, program->attributes, state.cache_path.c_str(), state.title_id);
+        vertex_programs.push_back(address);
+    }
+
+    return true;
+}
+
+bool CaptureReplay::read_context_state(State &state, MemState &mem) {
+    uint32_t context_id = 0;
+    uint32_t render_target_id = 0;
+    GxmRecordState record;
+    if (!read_value(file, context_id) || !read_value(file, render_target_id) || !read_value(file, record))
+        return false;
+
+    const auto context = contexts.find(context_id);
+    if ((context == contexts.end()) || !context->second)
+        return true;
+
+    const auto render_target = render_targets.find(render_target_id);
+    context->second->record = record;
+    context->second->current_render_target = (render_target != render_targets.end()) ? render_target->second.get() : nullptr;
+
+    // derived state the set state commands would have updated
+    switch (state.current_backend) {
+    case Backend::OpenGL:
+        if (record.fragment_program)
+            gl::sync_blending(context->second->record, mem);
+        break;
+
+    case Backend::Vulkan:
+        vulkan::refresh_pipeline(*reinterpret_cast<vulkan::VKContext *>(context->second.get()));
+        break;
+
+    case Backend::Null:
+        break;
+
+    default:
+        REPORT_MISSING(state.current_backend);
+        break;
+    }
+
+    return true;
+}
+
+void CaptureReplay::close(State &state, const FeatureState &features, MemState &mem, Config &config) {
+    flush(state, features, mem, config);
+
+    // destroyed with the same commands as the ones of the game
+    for (auto &[_, render_target] : render_targets)
+        process(state, features, mem, config, make_command(generic_command_allocate, generic_command_free, CommandOpcode::DestroyRenderTarget, &status, &render_target), nullptr);
+    for (auto &[_, context] : contexts)
+        process(state, features, mem, config, make_command(generic_command_allocate, generic_command_free, CommandOpcode::DestroyContext, &status, &context), nullptr);
+    flush(state, features, mem, config);
+    render_targets.clear();
+    render_target_params.clear();
+    contexts.clear();
+
+    for (const Address address : fragment_programs)
+        Ptr<SceGxmFragmentProgram>(address).get(mem)->~SceGxmFragmentProgram();
+    for (const Address address : vertex_programs)
+        Ptr<SceGxmVertexProgram>(address).get(mem)->~SceGxmVertexProgram();
+    fragment_programs.clear();
+    vertex_programs.clear();
+
+    file.close();
+}
+
+} // namespace renderer
@@ -23,6 +23,7 @@
 #include <renderer/types.h>
 
 #include <renderer/gl/functions.h>
+#include <renderer/null/functions.h>
 #include <renderer/vulkan/functions.h>
 #include <renderer/vulkan/state.h>
 
@@ -68,6 +69,11 @@ COMMAND(handle_create_context) {
         break;
     }
 
+    case Backend::Null: {
+        result = null::create(*ctx);
+        break;
+    }
+
     default: {
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -111,6 +117,10 @@ COMMAND(handle_create_render_target) {
         result = vulkan::create(dynamic_cast<vulkan::VKState &>(renderer), *render_target, *params, features);
         break;
 
+    case Backend::Null:
+        result = null::create(*render_target);
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -136,6 +146,7 @@ COMMAND(handle_destroy_render_target) {
 
     switch (renderer.current_backend) {
     case Backend::OpenGL:
+    case Backend::Null:
         // nothing to do
         break;
 
@@ -188,11 +199,19 @@ bool create(std::unique_ptr<FragmentProgram> &fp, State &state, const SceGxmProg
         vulkan::create(fp, dynamic_cast<vulkan::VKState &>(state), program, blend);
         break;
 
+    case Backend::Null:
+        null::create(fp);
+        break;
+
     default:
         REPORT_MISSING(state.current_backend);
         return false;
     }
 
+    fp->has_blend = blend != nullptr;
+    if (blend)
+        fp->blend = *blend;
+
     // Try to hash this shader
     fp->hash = sha256(&program, program.size);
     gxp_ptr_map.emplace(fp->hash, &program);
@@ -215,6 +234,10 @@ bool create(std::unique_ptr<VertexProgram> &vp, State &state, const SceGxmProgra
         vulkan::create(vp, dynamic_cast<vulkan::VKState &>(state), program);
         break;
 
+    case Backend::Null:
+        null::create(vp);
+        break;
+
     default:
         REPORT_MISSING(state.current_backend);
         return false;
@@ -275,6 +298,16 @@ bool init(SDL_Window *window, std::unique_ptr<State> &state, Backend backend, co
             return false;
         break;
 
+    case Backend::Null:
+        state = std::make_unique<null::NullState>();
+        state->cache_path = root_paths.get_cache_path_string();
+        state->log_path = root_paths.get_log_path_string();
+        state->shared_path = root_paths.get_shared_path_string();
+        state->static_assets = root_paths.get_static_assets_path();
+        if (!null::create(window, state, config))
+            return false;
+        break;
+
     default:
         LOG_ERROR("Cannot create a renderer with unsupported backend {}.", static_cast<int>(backend));
         return false;
@@ -283,7 +316,7 @@ bool init(SDL_Window *window, std::unique_ptr<State> &state, Backend backend, co
     state->current_backend = backend;
 
     // Can change this
-    state->command_buffer_queue.maxPendingCount_ = 30;
+    state->command_buffer_queue.max_pending = 30;
 
     return true;
 }
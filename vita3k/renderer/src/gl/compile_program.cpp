@@ -23,15 +23,43 @@
 #include <renderer/gl/types.h>
 
 #include <gxm/types.h>
+#include <util/alloc_tracker.h>
 #include <util/log.h>
 
 #include <shader/spirv_recompiler.h>
 
 #include <gxm/functions.h>
+#include <cstring>
 #include <vector>
 
+// not part of the glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace renderer::gl {
-static SharedGLObject compile_glsl(GLenum type, const std::string &source) {
+// waits for the compilation of the shader to be done and logs its errors
+static bool check_shader(const GLObject &shader) {
+    GLint log_length = 0;
+    glGetShaderiv(shader.get(), GL_INFO_LOG_LENGTH, &log_length);
+
+    // Intel driver returns an info log length of at least 1 even if it is empty.
+    if (log_length > 1) {
+        std::vector<GLchar> log;
+        log.resize(log_length);
+        glGetShaderInfoLog(shader.get(), log_length, nullptr, log.data());
+
+        LOG_ERROR("{}", log.data());
+    }
+
+    GLint is_compiled = GL_FALSE;
+    glGetShaderiv(shader.get(), GL_COMPILE_STATUS, &is_compiled);
+    assert(is_compiled != GL_FALSE);
+    return is_compiled != GL_FALSE;
+}
+
+// without wait, the compilation is only checked when the program using the shader is linked
+static SharedGLObject compile_glsl(GLenum type, const std::string &source, bool wait = true) {
     R_PROFILE(__func__);
 
     const SharedGLObject shader = std::make_shared<GLObject>();
@@ -45,29 +73,16 @@ static SharedGLObject compile_glsl(GLenum type, const std::string &source) {
 
     glCompileShader(shader->get());
 
-    GLint log_length = 0;
-    glGetShaderiv(shader->get(), GL_INFO_LOG_LENGTH, &log_length);
-
-    // Intel driver returns an info log length of at least 1 even if it is empty.
-    if (log_length > 1) {
-        std::vector<GLchar> log;
-        log.resize(log_length);
-        glGetShaderInfoLog(shader->get(), log_length, nullptr, log.data());
-
-        LOG_ERROR("{}", log.data());
-    }
-
-    GLint is_compiled = GL_FALSE;
-    glGetShaderiv(shader->get(), GL_COMPILE_STATUS, &is_compiled);
-    assert(is_compiled != GL_FALSE);
-    if (!is_compiled) {
+    if (wait && !check_shader(*shader)) {
         return SharedGLObject();
     }
 
+    // the driver keeps its own copy of the source
+    TRACK_HOST_ALLOC(ShaderCache, shader.get(), source.size());
     return shader;
 }
 
-static SharedGLObject compile_spirv(GLenum type, const std::vector<std::uint32_t> &source) {
+static SharedGLObject compile_spirv(GLenum type, const std::vector<std::uint32_t> &source, bool wait = true) {
     R_PROFILE(__func__);
 
     const SharedGLObject shader = std::make_shared<GLObject>();
@@ -84,25 +99,11 @@ static SharedGLObject compile_spirv(GLenum type, const std::vector<std::uint32_t
     glShaderBinary(1, need_compile, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, source_glchar, length);
     glSpecializeShaderARB(need_compile[0], shader_entry, 0, nullptr, nullptr);
 
-    GLint log_length = 0;
-    glGetShaderiv(shader->get(), GL_INFO_LOG_LENGTH, &log_length);
-
-    // Intel driver returns an info log length of at least 1 even if it is empty.
-    if (log_length > 1) {
-        std::vector<GLchar> log;
-        log.resize(log_length);
-        glGetShaderInfoLog(shader->get(), log_length, nullptr, log.data());
-
-        LOG_ERROR("{}", log.data());
-    }
-
-    GLint is_compiled = GL_FALSE;
-    glGetShaderiv(shader->get(), GL_COMPILE_STATUS, &is_compiled);
-    assert(is_compiled != GL_FALSE);
-    if (!is_compiled) {
+    if (wait && !check_shader(*shader)) {
         return SharedGLObject();
     }
 
+    TRACK_HOST_ALLOC(ShaderCache, shader.get(), length);
     return shader;
 }
 
@@ -116,7 +117,8 @@ static std::string convert_hash_to_hex(const Sha256Hash &hash) {
     return ss.str();
 }
 
-static SharedGLObject compile_program(ProgramCache &program_cache, const SharedGLObject frag_shader, const SharedGLObject vert_shader, const ProgramHashes &hashes) {
+// with GL_KHR_parallel_shader_compile, the link may still be going on once this returns
+static SharedGLObject link_program(const SharedGLObject frag_shader, const SharedGLObject vert_shader) {
     const SharedGLObject program = std::make_shared<GLObject>();
     if (!program->init(glCreateProgram(), glDeleteProgram)) {
         return SharedGLObject();
@@ -124,8 +126,14 @@ static SharedGLObject compile_program(ProgramCache &program_cache, const SharedG
 
     glAttachShader(program->get(), frag_shader->get());
     glAttachShader(program->get(), vert_shader->get());
+    glProgramParameteri(program->get(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program->get());
 
+    return program;
+}
+
+// waits for the link to be done and adds the program to the cache if it succeeded
+static SharedGLObject finish_program(ProgramCache &program_cache, const SharedGLObject program, const SharedGLObject frag_shader, const SharedGLObject vert_shader, const ProgramHashes &hashes) {
     GLint log_length = 0;
     glGetProgramiv(program->get(), GL_INFO_LOG_LENGTH, &log_length);
 
@@ -153,6 +161,89 @@ static SharedGLObject compile_program(ProgramCache &program_cache, const SharedG
     return program;
 }
 
+static SharedGLObject compile_program(ProgramCache &program_cache, const SharedGLObject frag_shader, const SharedGLObject vert_shader, const ProgramHashes &hashes) {
+    const SharedGLObject program = link_program(frag_shader, vert_shader);
+    if (!program) {
+        return SharedGLObject();
+    }
+
+    return finish_program(program_cache, program, frag_shader, vert_shader, hashes);
+}
+
+// name of the program binary of this shader pair in the shader pack
+static std::string get_program_binary_name(const std::string &shader_version, const ProgramHashes &hashes) {
+    return fmt::format("{}-{}-{}.glprog", shader_version, convert_hash_to_hex(std::get<0>(hashes)), convert_hash_to_hex(std::get<1>(hashes)));
+}
+
+// a program binary is stored as: driver string size (u32), driver string, binary format (u32), binary
+static SharedGLObject load_program_binary(GLState &renderer, const ProgramHashes &hashes, const char *cache_path, const char *title_id, const char *self_name) {
+    if (renderer.program_binary_driver.empty())
+        return SharedGLObject();
+
+    std::vector<uint8_t> blob;
+    if (!load_shader_blob(get_program_binary_name(renderer.shader_version, hashes), cache_path, title_id, self_name, blob))
+        return SharedGLObject();
+
+    const std::string &driver = renderer.program_binary_driver;
+    uint32_t driver_size = 0;
+    GLenum format = 0;
+    const size_t header_size = sizeof(uint32_t) + driver.size() + sizeof(uint32_t);
+    if (blob.size() <= header_size)
+        return SharedGLObject();
+
+    memcpy(&driver_size, blob.data(), sizeof(uint32_t));
+    // the binary was made by another driver, it will be replaced once the program is linked again
+    if (driver_size != driver.size() || memcmp(blob.data() + sizeof(uint32_t), driver.data(), driver.size()) != 0)
+        return SharedGLObject();
+    memcpy(&format, blob.data() + sizeof(uint32_t) + driver.size(), sizeof(uint32_t));
+
+    const SharedGLObject program = std::make_shared<GLObject>();
+    if (!program->init(glCreateProgram(), glDeleteProgram)) {
+        return SharedGLObject();
+    }
+
+    glProgramBinary(program->get(), format, blob.data() + header_size, static_cast<GLsizei>(blob.size() - header_size));
+
+    // the driver is allowed to reject any binary, the program is then compiled from its shaders
+    GLint is_linked = GL_FALSE;
+    glGetProgramiv(program->get(), GL_LINK_STATUS, &is_linked);
+    if (is_linked == GL_FALSE) {
+        LOG_WARN("Program binary rejected by the driver, compiling it from its shaders");
+        return SharedGLObject();
+    }
+
+    renderer.program_cache.emplace(hashes, program);
+
+    return program;
+}
+
+static void save_program_binary(GLState &renderer, const GLObject &program, const ProgramHashes &hashes, const char *cache_path, const char *title_id, const char *self_name) {
+    if (renderer.program_binary_driver.empty())
+        return;
+
+    GLint binary_size = 0;
+    glGetProgramiv(program.get(), GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (binary_size <= 0)
+        return;
+
+    const std::string &driver = renderer.program_binary_driver;
+    const uint32_t driver_size = static_cast<uint32_t>(driver.size());
+    const size_t header_size = sizeof(uint32_t) + driver.size() + sizeof(uint32_t);
+    std::vector<uint8_t> blob(header_size + binary_size);
+
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program.get(), binary_size, &written, &format, blob.data() + header_size);
+    if (written <= 0)
+        return;
+
+    memcpy(blob.data(), &driver_size, sizeof(uint32_t));
+    memcpy(blob.data() + sizeof(uint32_t), driver.data(), driver.size());
+    memcpy(blob.data() + sizeof(uint32_t) + driver.size(), &format, sizeof(uint32_t));
+
+    save_shader_blob(get_program_binary_name(renderer.shader_version, hashes), blob.data(), header_size + written, cache_path, title_id, self_name);
+}
+
 static SharedGLObject compile_shader(const char *cache_path, const char *title_id, const char *self_name, const std::string &shader_version, const std::string &hash_hex,
     const char *type_str, const GLenum type, ShaderCache &cache, const Sha256Hash &hash) {
     // Set Shader version with hash
@@ -190,6 +281,15 @@ static std::vector<ShadersHash>::iterator get_shaders_hash_index(std::vector<Sha
 void pre_compile_program(GLState &renderer, const char *cache_path, const char *title_id, const char *self_name, const ShadersHash &hash) {
     const auto shader_path{ fs::path(cache_path) / "shaders" / title_id / self_name };
     if (fs::exists(shader_path) && !fs::is_empty(shader_path)) {
+        const ProgramHashes hashes(hash.frag, hash.vert);
+
+        // Linking the program binary of the previous run skips the shader compilation
+        if (load_program_binary(renderer, hashes, cache_path, title_id, self_name)) {
+            renderer.programs_count_pre_compiled++;
+            LOG_INFO("Program Loaded {}/{}", renderer.programs_count_pre_compiled.load(), renderer.shaders_cache_hashs.size());
+            return;
+        }
+
         // Compile Fragment Shader
         const auto frag_hash_hex = convert_hash_to_hex(hash.frag);
         const SharedGLObject frag_shader = compile_shader(cache_path, title_id, self_name, renderer.shader_version,
@@ -207,24 +307,25 @@ void pre_compile_program(GLState &renderer, const char *cache_path, const char *
         }
 
         // Compile Program
-        const ProgramHashes hashes(hash.frag, hash.vert);
-        compile_program(renderer.program_cache, frag_shader, vert_shader, hashes);
+        const SharedGLObject program = compile_program(renderer.program_cache, frag_shader, vert_shader, hashes);
+        if (program)
+            save_program_binary(renderer, *program, hashes, cache_path, title_id, self_name);
         renderer.programs_count_pre_compiled++;
-        LOG_INFO("Program Compiled {}/{}", renderer.programs_count_pre_compiled, renderer.shaders_cache_hashs.size());
+        LOG_INFO("Program Compiled {}/{}", renderer.programs_count_pre_compiled.load(), renderer.shaders_cache_hashs.size());
     }
 }
 
 static SharedGLObject get_or_compile_shader(const SceGxmProgram *program, const FeatureState &features, const Sha256Hash &hash,
-    ShaderCache &cache, const GLenum type, const shader::Hints &hints, bool shader_cache, bool spirv, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, const std::string &shader_version, uint32_t &shaders_count_compiled) {
+    ShaderCache &cache, const GLenum type, const shader::Hints &hints, bool shader_cache, bool spirv, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, const std::string &shader_version, uint32_t &shaders_count_compiled, bool wait) {
     const auto cached = cache.find(hash);
     if (cached == cache.end()) {
         SharedGLObject obj = nullptr;
 
         // Need to compile new one and add it to cache
         if (features.spirv_shader && spirv) {
-            obj = compile_spirv(type, load_spirv_shader(*program, features, false, hints, maskupdate, cache_path, title_id, self_name, shader_version + "spv", shader_cache));
+            obj = compile_spirv(type, load_spirv_shader(*program, features, false, hints, maskupdate, cache_path, title_id, self_name, shader_version + "spv", shader_cache), wait);
         } else {
-            obj = compile_glsl(type, load_glsl_shader(*program, features, hints, maskupdate, cache_path, title_id, self_name, shader_version, shader_cache));
+            obj = compile_glsl(type, load_glsl_shader(*program, features, hints, maskupdate, cache_path, title_id, self_name, shader_version, shader_cache), wait);
         }
 
         cache.emplace(hash, obj);
@@ -238,8 +339,9 @@ static SharedGLObject get_or_compile_shader(const SceGxmProgram *program, const
 }
 
 SharedGLObject compile_program(GLState &renderer, GLContext &context, const GxmRecordState &state, const FeatureState &features, const MemState &mem,
-    bool shader_cache, bool spirv, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name) {
+    bool shader_cache, bool spirv, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, bool consider_for_async) {
     R_PROFILE(__func__);
+    R_FRAME_TIMER(Pipeline);
 
     assert(state.fragment_program);
     assert(state.vertex_program);
@@ -261,6 +363,38 @@ SharedGLObject compile_program(GLState &renderer, GLContext &context, const GxmR
         return cached->second;
     }
 
+    // the draws using this program are skipped until it is compiled, like with the asynchronous pipeline compilation of vulkan
+    const bool compile_async = consider_for_async && renderer.use_async_compilation && renderer.surface_cache.can_use_deferred_compilation;
+
+    const auto pending = renderer.pending_programs.find(hashes);
+    if (pending != renderer.pending_programs.end()) {
+        if (compile_async) {
+            GLint is_done = GL_FALSE;
+            glGetProgramiv(pending->second.program->get(), GL_COMPLETION_STATUS_KHR, &is_done);
+            if (!is_done)
+                return SharedGLObject();
+        }
+
+        // the shaders were not checked when they were compiled
+        const PendingProgram pending_program = std::move(pending->second);
+        renderer.pending_programs.erase(pending);
+        if (!check_shader(*pending_program.fragment_shader) || !check_shader(*pending_program.vertex_shader))
+            return SharedGLObject();
+
+        const SharedGLObject program = finish_program(renderer.program_cache, pending_program.program, pending_program.fragment_shader, pending_program.vertex_shader, hashes);
+        if (program && pending_program.save_binary)
+            save_program_binary(renderer, *program, hashes, cache_path, title_id, self_name);
+
+        return program;
+    }
+
+    // program binaries are only kept for the glsl shaders, which are the ones the shader cache keeps
+    const bool use_program_binary = shader_cache && !(features.spirv_shader && spirv);
+    if (use_program_binary) {
+        if (const SharedGLObject program = load_program_binary(renderer, hashes, cache_path, title_id, self_name))
+            return program;
+    }
+
     // No... It doesn't exist. Now we try to find each object. If it doesn't exist then we can kind
     // of compile it again.
 
@@ -269,7 +403,7 @@ SharedGLObject compile_program(GLState &renderer, GLContext &context, const GxmR
     context.shader_hints.attributes = &vertex_program_gxm.attributes;
 
     const SharedGLObject fragment_shader = get_or_compile_shader(fragment_program_gxm.program.get(mem), features, fragment_program.hash, renderer.fragment_shader_cache,
-        GL_FRAGMENT_SHADER, context.shader_hints, shader_cache, spirv, maskupdate, cache_path, title_id, self_name, renderer.shader_version, renderer.shaders_count_compiled);
+        GL_FRAGMENT_SHADER, context.shader_hints, shader_cache, spirv, maskupdate, cache_path, title_id, self_name, renderer.shader_version, renderer.shaders_count_compiled, !compile_async);
 
     if (!fragment_shader) {
         LOG_CRITICAL("Error in get/compile fragment vertex shader:\n{}", hex_string(fragment_program.hash));
@@ -277,14 +411,24 @@ SharedGLObject compile_program(GLState &renderer, GLContext &context, const GxmR
     }
 
     const SharedGLObject vertex_shader = get_or_compile_shader(vertex_program_gxm.program.get(mem), features, vertex_program.hash, renderer.vertex_shader_cache,
-        GL_VERTEX_SHADER, context.shader_hints, shader_cache, spirv, maskupdate, cache_path, title_id, self_name, renderer.shader_version, renderer.shaders_count_compiled);
+        GL_VERTEX_SHADER, context.shader_hints, shader_cache, spirv, maskupdate, cache_path, title_id, self_name, renderer.shader_version, renderer.shaders_count_compiled, !compile_async);
 
     if (!vertex_shader) {
         LOG_CRITICAL("Error in get/compiled vertex shader:\n{}", hex_string(vertex_program.hash));
         return SharedGLObject();
     }
 
-    const SharedGLObject program = compile_program(renderer.program_cache, fragment_shader, vertex_shader, hashes);
+    SharedGLObject program;
+    if (compile_async) {
+        // the completion is polled by the next draws using this program
+        const SharedGLObject linking_program = link_program(fragment_shader, vertex_shader);
+        if (linking_program)
+            renderer.pending_programs.emplace(hashes, PendingProgram{ linking_program, fragment_shader, vertex_shader, use_program_binary });
+    } else {
+        program = compile_program(renderer.program_cache, fragment_shader, vertex_shader, hashes);
+        if (program && use_program_binary)
+            save_program_binary(renderer, *program, hashes, cache_path, title_id, self_name);
+    }
 
     // Save shader cache haches
     const auto shader_cache_hash_index = get_shaders_hash_index(renderer.shaders_cache_hashs, fragment_program.hash, vertex_program.hash);
@@ -70,10 +70,20 @@ void draw(GLState &renderer, GLContext &context, const FeatureState &features, S
     // Trying to cache: the last time vs this time shader pair. Does it different somehow?
     // If it's different, we need to switch. Else just stick to it.
     if (context.record.vertex_program.get(mem)->renderer_data->hash != context.last_draw_vertex_program_hash || context.record.fragment_program.get(mem)->renderer_data->hash != context.last_draw_fragment_program_hash) {
-        // Need to recompile!
-        SharedGLObject program = gl::compile_program(renderer, context, context.record, features, mem, config.shader_cache, config.spirv_shader, gxm_fragment_program.is_maskupdate, cache_path, title_id, self_name);
+        // We don't want to defer cases where we draw a whole quad over the screen as these draws could be necessary
+        // to be able to see anything
+        const bool can_be_whole_quad = instance_count == 1 && (count == 4 || count == 6);
 
-        LOG_ERROR_IF(!program, "Fail to get program!");
+        // Need to recompile!
+        SharedGLObject program = gl::compile_program(renderer, context, context.record, features, mem, config.shader_cache, config.spirv_shader, gxm_fragment_program.is_maskupdate, cache_path, title_id, self_name, !can_be_whole_quad);
+
+        if (!program) {
+            // can happen with asynchronous shader compilation, the draw is skipped until the program is ready
+            const ProgramHashes hashes(context.record.fragment_program.get(mem)->renderer_data->hash, context.record.vertex_program.get(mem)->renderer_data->hash);
+            if (renderer.pending_programs.contains(hashes))
+                return;
+            LOG_ERROR("Fail to get program!");
+        }
 
         // Use it
         program_id = program ? (*program).get() : 0;
@@ -96,7 +106,10 @@ void draw(GLState &renderer, GLContext &context, const FeatureState &features, S
         glGetIntegerv(GL_CURRENT_PROGRAM, reinterpret_cast<GLint *>(&program_id));
     }
 
-    glUseProgram(program_id);
+    if (program_id != renderer.bound_program) {
+        glUseProgram(program_id);
+        renderer.bound_program = program_id;
+    }
 
     const bool use_raw_image = renderer.features.preserve_f16_nan_as_u16 && color::is_write_surface_stored_rawly(gxm::get_base_format(context.record.color_surface.colorFormat));
 
@@ -112,7 +125,10 @@ void draw(GLState &renderer, GLContext &context, const FeatureState &features, S
             glBindImageTexture(shader::COLOR_ATTACHMENT_TEXTURE_SLOT_IMAGE, context.current_color_attachment, 0, GL_FALSE, 0, GL_READ_WRITE, surface_format);
         }
     }
-    glBindImageTexture(shader::MASK_TEXTURE_SLOT_IMAGE, context.render_target->masktexture[0], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+    if (context.render_target->masktexture[0] != renderer.bound_mask_texture) {
+        glBindImageTexture(shader::MASK_TEXTURE_SLOT_IMAGE, context.render_target->masktexture[0], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+        renderer.bound_mask_texture = context.render_target->masktexture[0];
+    }
 
     shader::RenderVertUniformBlock &vert_ublock = context.current_vert_render_info;
     vert_ublock.viewport_flip = context.record.viewport_flip;
@@ -186,7 +202,6 @@ void draw(GLState &renderer, GLContext &context, const FeatureState &features, S
     }
 
     std::memcpy(index_gpu_ptr.first, indices, index_buffer_size);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, context.index_stream_ring_buffer.handle());
 
     if (fragment_program_gxp.is_native_color()) {
         if (features.should_use_shader_interlock() && !config.spirv_shader) {
@@ -43,6 +43,7 @@ void Fence::insert() {
     }
 
     sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    signaled_ = false;
     if (!sync_) {
         LOG_ERROR("Unable to create fence sync object!");
     }
@@ -102,4 +103,20 @@ bool Fence::wait_for_signal() {
     return signaled_;
 }
 
+bool Fence::poll() {
+    if (!sync_)
+        return true;
+
+    const GLenum result = glClientWaitSync(sync_, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+        return false;
+    if (result == GL_WAIT_FAILED)
+        LOG_ERROR("Failed to poll the sync object");
+
+    glDeleteSync(sync_);
+    sync_ = nullptr;
+    signaled_ = true;
+    return true;
+}
+
 } // namespace renderer::gl
@@ -32,14 +32,20 @@
 
 #include <gxm/functions.h>
 #include <gxm/types.h>
+#include <mem/util.h>
 #include <util/log.h>
 
 #include <SDL.h>
 #include <SDL_video.h>
 
 #include <array>
+#include <cstring>
+#include <memory>
 #include <sstream>
 
+// not part of the glad loader, the function is loaded when the extension is found
+typedef void(GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
 namespace renderer::gl {
 
 GLContext::GLContext()
@@ -108,6 +114,8 @@ static GLenum translate_blend_factor(SceGxmBlendFactor src) {
 void bind_fundamental(GLContext &context) {
     // Bind the vertex array and element buffer.
     glBindVertexArray(context.vertex_array[0]);
+    // the element buffer binding is part of the vertex array state, no need to bind it for each draw
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, context.index_stream_ring_buffer.handle());
 }
 
 static void after_callback(void *ret, const char *name, GLADapiproc apiproc, int len_args, ...) {
@@ -232,6 +240,10 @@ bool create(SDL_Window *window, std::unique_ptr<State> &state, const Config &con
         { "GL_EXT_shader_image_load_formatted", &gl_state.features.support_unknown_format }
     };
 
+    bool support_parallel_compile_arb = false;
+    check_extensions.emplace("GL_KHR_parallel_shader_compile", &gl_state.support_parallel_compile);
+    check_extensions.emplace("GL_ARB_parallel_shader_compile", &support_parallel_compile_arb);
+
     for (int i = 0; i < total_extensions; i++) {
         const std::string extension = reinterpret_cast<const GLchar *>(glGetStringi(GL_EXTENSIONS, i));
         auto find_result = check_extensions.find(extension);
@@ -242,6 +254,20 @@ bool create(SDL_Window *window, std::unique_ptr<State> &state, const Config &con
         }
     }
 
+    // both extensions are the same, only the suffix of the function changes
+    const char *max_compile_threads_name = nullptr;
+    if (gl_state.support_parallel_compile)
+        max_compile_threads_name = "glMaxShaderCompilerThreadsKHR";
+    else if (support_parallel_compile_arb)
+        max_compile_threads_name = "glMaxShaderCompilerThreadsARB";
+    if (max_compile_threads_name) {
+        const auto max_compile_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(SDL_GL_GetProcAddress(max_compile_threads_name));
+        gl_state.support_parallel_compile = max_compile_threads != nullptr;
+        // some drivers only compile in parallel once a number of threads is given, let them choose it
+        if (max_compile_threads)
+            max_compile_threads(0xFFFFFFFF);
+    }
+
     if (gl_state.features.direct_fragcolor) {
         LOG_INFO("Your GPU supports direct access to last fragment color. Your performance with programmable blending games will be optimized.");
     } else if (gl_state.features.support_shader_interlock) {
@@ -257,6 +283,14 @@ bool create(SDL_Window *window, std::unique_ptr<State> &state, const Config &con
     // always enabled in the opengl renderer
     gl_state.features.use_mask_bit = true;
 
+    GLint program_binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &program_binary_formats);
+    if (program_binary_formats > 0) {
+        const auto vendor = reinterpret_cast<const char *>(glGetString(GL_VENDOR));
+        const auto driver_version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+        gl_state.program_binary_driver = fmt::format("{}/{}/{}", vendor, gpu_name, driver_version);
+    }
+
     return gl_state.init(gl_state.static_assets, hashless_texture_cache);
 }
 
@@ -273,7 +307,24 @@ bool GLState::init(const fs::path &static_assets, const bool hashless_texture_ca
 
 void GLState::late_init(const Config &cfg, const std::string_view game_id, MemState &mem) {
     const fs::path texture_folder = fs::path(shared_path) / "textures";
+    texture_cache.prewarm_imports = cfg.prewarm_texture_import;
     texture_cache.init(cfg.hashless_texture_cache, texture_folder, game_id);
+    features.optimize_spirv = cfg.optimize_shaders;
+    // the heap sizes can't be queried with OpenGL, only use a budget when one is given
+    if (cfg.texture_cache_budget > 0)
+        texture_cache.set_memory_budget(static_cast<uint64_t>(cfg.texture_cache_budget) * MiB(1));
+    texture_cache.use_mipmap_generation = cfg.gpu_mipmap_generation;
+    if (cfg.texture_disk_cache)
+        texture_cache.open_disk_cache(fs::path(cache_path) / "textures" / std::string(game_id));
+    if (cfg.async_texture_decode)
+        texture_cache.start_decode_workers(mem);
+    if (cfg.async_texture_import)
+        texture_cache.start_import_worker();
+}
+
+uint32_t GLState::get_features_mask() {
+    // the shader cache is rebuilt when the shader optimization is toggled
+    return features.optimize_spirv ? 1 : 0;
 }
 
 bool create(std::unique_ptr<Context> &context) {
@@ -365,6 +416,8 @@ void set_context(GLState &state, GLContext &context, const MemState &mem, const
     R_PROFILE(__func__);
 
     bind_fundamental(context);
+    // the render target (and its mask texture) may have been destroyed since the last scene
+    state.bound_mask_texture = 0;
 
     if (rt) {
         context.render_target = rt;
@@ -649,6 +702,7 @@ void get_surface_data(GLState &renderer, GLContext &context, uint32_t *pixels, S
 
 void GLState::render_frame(const SceFVector2 &viewport_pos, const SceFVector2 &viewport_size, DisplayState &display,
     const GxmState &gxm, MemState &mem) {
+    R_FRAME_TIMER(Submit);
     should_display = false;
 
     DisplayFrameInfo frame;
@@ -713,7 +767,71 @@ void GLState::render_frame(const SceFVector2 &viewport_pos, const SceFVector2 &v
     screen_renderer.render(viewport_pos, viewport_size, need_uv ? uvs : nullptr, static_cast<GLuint>(surface_handle), texture_size);
 }
 
+void GLState::read_screenshot(SDL_Window *window) {
+    int width = 0, height = 0;
+    SDL_GL_GetDrawableSize(window, &width, &height);
+    if (width <= 0 || height <= 0)
+        return;
+
+    if (!screenshot_buffer[0] && !screenshot_buffer.init(reinterpret_cast<renderer::Generator *>(glGenBuffers), reinterpret_cast<renderer::Deleter *>(glDeleteBuffers))) {
+        LOG_ERROR("Failed to create the screenshot buffer");
+        return;
+    }
+
+    const GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, screenshot_buffer[0]);
+    if (size > screenshot_buffer_size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        screenshot_buffer_size = size;
+    }
+
+    GLint last_framebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &last_framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, last_framebuffer);
+
+    screenshot_fence.insert();
+    screenshot_width = width;
+    screenshot_height = height;
+    screenshot_pending = true;
+}
+
+void GLState::submit_screenshot() {
+    if (!screenshot_fence.poll())
+        return;
+    screenshot_pending = false;
+
+    // the buffer is reused by the next screenshot, the rows are copied bottom up to an owned buffer
+    const size_t row_size = static_cast<size_t>(screenshot_width) * 4;
+    auto pixels = std::make_shared<std::vector<uint8_t>>(row_size * screenshot_height);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, screenshot_buffer[0]);
+    const uint8_t *mapped = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_size * screenshot_height, GL_MAP_READ_BIT));
+    if (mapped) {
+        for (uint32_t y = 0; y < screenshot_height; y++)
+            memcpy(pixels->data() + y * row_size, mapped + (screenshot_height - 1 - y) * row_size, row_size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!mapped) {
+        LOG_ERROR("Failed to map the screenshot buffer");
+        return;
+    }
+
+    screenshot.push_frame(pixels->data(), screenshot_width, screenshot_height, row_size, RecorderPixelOrder::RGBA, [pixels]() mutable { pixels.reset(); });
+}
+
 void GLState::swap_window(SDL_Window *window) {
+    R_FRAME_TIMER(Submit);
+    // the readback of the previous screenshot is given to the writer once it is done
+    if (screenshot_pending)
+        submit_screenshot();
+    else if (screenshot.is_requested())
+        read_screenshot(window);
+
     SDL_GL_SwapWindow(window);
 }
 
@@ -738,6 +856,12 @@ void GLState::set_anisotropic_filtering(int anisotropic_filtering) {
     texture_cache.anisotropic_filtering = anisotropic_filtering;
 }
 
+void GLState::set_async_compilation(bool enable) {
+    use_async_compilation = enable && support_parallel_compile;
+    if (enable && !support_parallel_compile)
+        LOG_WARN_ONCE("Asynchronous shader compilation needs GL_KHR_parallel_shader_compile, the shaders are compiled synchronously");
+}
+
 void GLState::precompile_shader(const ShadersHash &hash) {
     pre_compile_program(*this, cache_path.c_str(), title_id, self_name, hash);
 }
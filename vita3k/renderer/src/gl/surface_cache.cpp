@@ -19,6 +19,7 @@
 #include <renderer/gl/functions.h>
 #include <renderer/gl/surface_cache.h>
 #include <renderer/gl/types.h>
+#include <renderer/profile.h>
 #include <util/log.h>
 
 #include <chrono>
@@ -57,9 +58,19 @@ void GLSurfaceCache::do_typeless_copy(const GLuint dest_texture, const GLuint so
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
 }
 
+void GLSurfaceCache::erase_color_surface(std::uint64_t key) {
+    auto ite = color_surface_textures.find(key);
+    if (ite == color_surface_textures.end())
+        return;
+
+    color_surface_ranges.erase(key, ite->second.get());
+    color_surface_textures.erase(ite);
+}
+
 GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state, std::uint16_t width, std::uint16_t height, const std::uint16_t pixel_stride,
     const SceGxmColorBaseFormat base_format, Ptr<void> address, SurfaceTextureRetrievePurpose purpose, std::uint32_t &swizzle,
     std::uint16_t *stored_height, std::uint16_t *stored_width) {
+    R_FRAME_TIMER(SurfaceCache);
     // Create the key to access the cache struct
     const std::uint64_t key = address.address();
 
@@ -69,15 +80,12 @@ GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state,
     width *= state.res_multiplier;
     height *= state.res_multiplier;
 
-    // Of course, this works under the assumption that range must be unique :D
-    auto ite = color_surface_textures.lower_bound(key);
+    // the innermost surface containing the address, even if other surfaces overlap it
+    const auto *surface_range = color_surface_ranges.find_containing(key);
+    auto ite = surface_range ? color_surface_textures.find(surface_range->begin) : color_surface_textures.end();
     bool invalidated = false;
 
-    bool overlap = false;
-    if (ite != color_surface_textures.end()) {
-        // if the surface found does not overlap the surface we want, it's useless to look at it
-        overlap = (ite->first + ite->second->total_bytes) > key;
-    }
+    const bool overlap = ite != color_surface_textures.end();
 
     if (!overlap && purpose != SurfaceTextureRetrievePurpose::WRITING) {
         // not part of a surface, let the texture cache handle it
@@ -138,7 +146,7 @@ GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state,
                 }
             }
             // Clear out. We will recreate later
-            color_surface_textures.erase(ite);
+            erase_color_surface(ite->first);
             invalidated = true;
         } else if (surface_stat_changed) {
             // Remake locally to avoid making changes to framebuffer array
@@ -152,6 +160,8 @@ GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state,
             info.format = base_format;
             info.total_bytes = total_surface_size;
             info.flags = 0;
+            color_surface_ranges.erase(key, &info);
+            color_surface_ranges.insert(key, key + info.total_bytes, &info);
 
             bool store_rawly = false;
 
@@ -406,6 +416,10 @@ GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state,
         }
     }
 
+    // it's not impossible that this surface will be rendered once and only used after, so do not skip any draw on it
+    if (purpose == SurfaceTextureRetrievePurpose::WRITING)
+        can_use_deferred_compilation = false;
+
     std::unique_ptr<GLColorSurfaceCacheInfo> info_added = std::make_unique<GLColorSurfaceCacheInfo>();
 
     info_added->width = width;
@@ -421,7 +435,7 @@ GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state,
 
     if (!info_added->gl_texture.init(reinterpret_cast<renderer::Generator *>(glGenTextures), reinterpret_cast<renderer::Deleter *>(glDeleteTextures))) {
         LOG_ERROR("Failed to initialise color surface texture!");
-        color_surface_textures.erase(key);
+        erase_color_surface(key);
 
         return 0;
     }
@@ -451,7 +465,9 @@ GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state,
     if (color_surface_textures.count(key) > 0) {
         LOG_WARN_ONCE("Two different surfaces have the same base adress, this is not handled, an openGL error will happen.");
     }
-    color_surface_textures.emplace(key, std::move(info_added));
+    GLColorSurfaceCacheInfo *info_added_ptr = info_added.get();
+    if (color_surface_textures.emplace(key, std::move(info_added)).second)
+        color_surface_ranges.insert(key, key + info_added_ptr->total_bytes, info_added_ptr);
 
     // Now that everything goes well, we can start rearranging
     if (last_use_color_surface_index.size() >= MAX_CACHE_SIZE_PER_CONTAINER) {
@@ -469,7 +485,7 @@ GLuint GLSurfaceCache::retrieve_color_surface_texture_handle(const State &state,
         }
 
         last_use_color_surface_index.erase(last_use_color_surface_index.begin());
-        color_surface_textures.erase(first_key);
+        erase_color_surface(first_key);
     }
 
     last_use_color_surface_index.push_back(key);
@@ -516,6 +532,7 @@ GLuint GLSurfaceCache::retrieve_ping_pong_color_surface_texture_handle(Ptr<void>
 }
 
 GLuint GLSurfaceCache::retrieve_depth_stencil_texture_handle(const State &state, const MemState &mem, const SceGxmDepthStencilSurface &surface, std::int32_t force_width, std::int32_t force_height, const bool is_reading) {
+    R_FRAME_TIMER(SurfaceCache);
     if (!target) {
         LOG_ERROR("Unable to retrieve Depth Stencil texture with no active render target!");
         return 0;
@@ -632,6 +649,7 @@ GLuint GLSurfaceCache::retrieve_depth_stencil_texture_handle(const State &state,
 
 GLuint GLSurfaceCache::retrieve_framebuffer_handle(const State &state, const MemState &mem, SceGxmColorSurface *color, SceGxmDepthStencilSurface *depth_stencil,
     GLuint *color_texture_handle, GLuint *ds_texture_handle, std::uint16_t *stored_height) {
+    R_FRAME_TIMER(SurfaceCache);
     if (!target) {
         LOG_ERROR("Unable to retrieve framebuffer with no active render target!");
         return 0;
@@ -645,6 +663,9 @@ GLuint GLSurfaceCache::retrieve_framebuffer_handle(const State &state, const Mem
     GLuint color_handle = 0;
     GLuint ds_handle = 0;
 
+    // might get modified by retrieve_color_surface_texture_handle
+    can_use_deferred_compilation = true;
+
     if (color) {
         std::uint32_t swizzle_set = color->colorFormat & SCE_GXM_COLOR_SWIZZLE_MASK;
         color_handle = static_cast<GLuint>(retrieve_color_surface_texture_handle(state, color->width,
@@ -714,10 +735,11 @@ GLuint GLSurfaceCache::retrieve_framebuffer_handle(const State &state, const Mem
 }
 
 GLuint GLSurfaceCache::sourcing_color_surface_for_presentation(Ptr<const void> address, uint32_t width, uint32_t height, const std::uint32_t pitch, float *uvs, const int res_multiplier, SceFVector2 &texture_size) {
-    auto ite = color_surface_textures.lower_bound(address.address());
-    if (ite == color_surface_textures.end()) {
+    const auto *surface_range = color_surface_ranges.find_containing(address.address());
+    if (surface_range == nullptr) {
         return 0;
     }
+    auto ite = color_surface_textures.find(surface_range->begin);
 
     width *= res_multiplier;
     height *= res_multiplier;
@@ -395,7 +395,7 @@ void sync_texture(GLState &state, GLContext &context, MemState &mem, std::size_t
         }
     } else {
         if (config.texture_cache) {
-            state.texture_cache.cache_and_bind_texture(texture, mem);
+            state.texture_cache.cache_and_bind_texture(texture, mem, index);
         } else {
             texture::bind_texture_without_cache(state.texture_cache, texture, mem);
         }
@@ -67,6 +67,11 @@ void GLTextureCache::select(size_t index, const SceGxmTexture &texture) {
     glBindTexture(get_gl_texture_type(texture), gl_texture);
 }
 
+void GLTextureCache::release_texture(size_t index) {
+    // a new name has no storage, which frees the memory of the previous texture
+    textures.regenerate(index);
+}
+
 void GLTextureCache::configure_texture(const SceGxmTexture &gxm_texture) {
     R_PROFILE(__func__);
 
@@ -136,7 +141,7 @@ void GLTextureCache::configure_texture(const SceGxmTexture &gxm_texture) {
     }
 }
 
-void GLTextureCache::upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride) {
+void GLTextureCache::upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t row_offset) {
     R_PROFILE(__func__);
 
     GLenum upload_type = GL_TEXTURE_2D;
@@ -156,7 +161,7 @@ void GLTextureCache::upload_texture_impl(SceGxmTextureBaseFormat base_format, ui
 
         const GLenum format = translate_format(base_format);
         size_t compressed_size = renderer::texture::get_compressed_size(base_format, pixels_per_stride, height);
-        glCompressedTexSubImage2D(upload_type, mip_index, 0, 0, width, height, format, static_cast<GLsizei>(compressed_size), pixels);
+        glCompressedTexSubImage2D(upload_type, mip_index, 0, row_offset, width, height, format, static_cast<GLsizei>(compressed_size), pixels);
 
         glPixelStorei(GL_UNPACK_COMPRESSED_BLOCK_SIZE, 0);
         glPixelStorei(GL_UNPACK_COMPRESSED_BLOCK_WIDTH, 0);
@@ -167,12 +172,23 @@ void GLTextureCache::upload_texture_impl(SceGxmTextureBaseFormat base_format, ui
 
         const GLenum format = translate_format(base_format);
         const GLenum type = translate_type(base_format);
-        glTexSubImage2D(upload_type, mip_index, 0, 0, width, height, format, type, pixels);
+        glTexSubImage2D(upload_type, mip_index, 0, row_offset, width, height, format, type, pixels);
 
         glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     }
 }
 
+bool GLTextureCache::supports_mipmap_generation(const SceGxmTexture &texture) const {
+    // compressed formats can't be rendered to by the driver
+    return !gxm::is_bcn_format(gxm::get_base_format(gxm::get_format(texture)));
+}
+
+void GLTextureCache::upload_done() {
+    if (generate_mips)
+        glGenerateMipmap(get_gl_texture_type(current_info->texture));
+    generate_mips = false;
+}
+
 void GLTextureCache::import_configure_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, bool is_srgb, uint16_t nb_components, uint16_t mipcount, bool swap_rb) {
     SceGxmTexture &gxm_texture = current_info->texture;
     GLint default_swizzle[] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
@@ -0,0 +1,127 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/null/functions.h>
+#include <renderer/null/state.h>
+
+#include <renderer/shaders.h>
+#include <shader/spirv_recompiler.h>
+
+#include <config/state.h>
+#include <display/state.h>
+#include <gxm/types.h>
+#include <util/log.h>
+
+namespace renderer::null {
+
+bool create(SDL_Window *window, std::unique_ptr<renderer::State> &state, const Config &config) {
+    auto &null_state = dynamic_cast<NullState &>(*state);
+    null_state.translate_shaders = config.null_renderer_shaders;
+
+    LOG_INFO("Null renderer, nothing will be displayed. Shader translation {}", null_state.translate_shaders ? "enabled" : "disabled");
+
+    return null_state.init(state->static_assets, config.hashless_texture_cache);
+}
+
+bool create(std::unique_ptr<Context> &context) {
+    context = std::make_unique<Context>();
+    return true;
+}
+
+bool create(std::unique_ptr<RenderTarget> &rt) {
+    rt = std::make_unique<RenderTarget>();
+    return true;
+}
+
+bool create(std::unique_ptr<FragmentProgram> &fp) {
+    fp = std::make_unique<FragmentProgram>();
+    return true;
+}
+
+bool create(std::unique_ptr<VertexProgram> &vp) {
+    vp = std::make_unique<VertexProgram>();
+    return true;
+}
+
+static void translate_program(NullState &state, const SceGxmProgram &program, const Sha256Hash &hash, const FeatureState &features, const shader::Hints &hints, bool maskupdate,
+    const char *cache_path, const char *title_id, const char *self_name, const Config &config) {
+    if (!state.translated_programs.insert(hash).second)
+        return;
+
+    // the result is dropped, only the translation is measured
+    load_spirv_shader(program, features, true, hints, maskupdate, cache_path, title_id, self_name, state.shader_version, config.shader_cache);
+    state.shaders_count_compiled++;
+}
+
+void draw(NullState &state, Context &context, const FeatureState &features, MemState &mem, const char *cache_path, const char *title_id, const char *self_name, const Config &config) {
+    if (!state.translate_shaders)
+        return;
+
+    const GxmRecordState &record = context.record;
+    const SceGxmFragmentProgram *fragment_program_gxm = record.fragment_program.get(mem);
+    const SceGxmVertexProgram *vertex_program_gxm = record.vertex_program.get(mem);
+    if (!fragment_program_gxm || !vertex_program_gxm)
+        return;
+
+    // each program is only translated once, with the hints of its first draw
+    context.shader_hints.color_format = record.color_surface.colorFormat;
+    context.shader_hints.attributes = &vertex_program_gxm->attributes;
+
+    translate_program(state, *fragment_program_gxm->program.get(mem), record.fragment_program_hash, features, context.shader_hints, record.is_maskupdate, cache_path, title_id, self_name, config);
+    translate_program(state, *vertex_program_gxm->program.get(mem), record.vertex_program_hash, features, context.shader_hints, false, cache_path, title_id, self_name, config);
+}
+
+bool NullState::init(const fs::path &static_assets, const bool hashless_texture_cache) {
+    // the shaders are translated like the ones of the Vulkan renderer
+    shader_version = fmt::format("vk{}", shader::CURRENT_VERSION);
+    return true;
+}
+
+void NullState::late_init(const Config &cfg, const std::string_view game_id, MemState &mem) {
+    features.optimize_spirv = cfg.optimize_shaders;
+}
+
+void NullState::render_frame(const SceFVector2 &viewport_pos, const SceFVector2 &viewport_size, DisplayState &display,
+    const GxmState &gxm, MemState &mem) {
+    // the frame is consumed like it was presented
+    should_display = false;
+}
+
+void NullState::swap_window(SDL_Window *window) {
+}
+
+int NullState::get_supported_filters() {
+    return static_cast<int>(Filter::NEAREST);
+}
+
+void NullState::set_screen_filter(const std::string_view &filter) {
+}
+
+int NullState::get_max_anisotropic_filtering() {
+    return 1;
+}
+
+void NullState::set_anisotropic_filtering(int anisotropic_filtering) {
+}
+
+void NullState::precompile_shader(const ShadersHash &hash) {
+}
+
+void NullState::preclose_action() {
+}
+
+} // namespace renderer::null
@@ -0,0 +1,397 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <renderer/recorder.h>
+
+#include <util/log.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
+}
+
+namespace renderer {
+
+// frames given by the renderer which can wait for the encoder, the next ones are dropped
+static constexpr size_t MAX_PENDING_FRAMES = 8;
+// seconds of audio kept while waiting for the first frame
+static constexpr uint32_t MAX_AUDIO_SECONDS = 10;
+static constexpr int64_t AUDIO_BITRATE = 160000;
+
+static std::vector<std::string> get_encoder_candidates(const std::string &encoder) {
+    if (encoder != "Auto")
+        return { encoder };
+
+#ifdef _WIN32
+    return { "h264_nvenc", "h264_amf", "h264_qsv", "libx264", "libopenh264", "mpeg4" };
+#elif defined(__APPLE__)
+    return { "h264_videotoolbox", "libx264", "libopenh264", "mpeg4" };
+#else
+    return { "h264_nvenc", "h264_qsv", "libx264", "libopenh264", "mpeg4" };
+#endif
+}
+
+// the format of the frames if the encoder takes it, so they can be encoded without being converted
+static AVPixelFormat choose_pixel_format(const AVCodec *codec, AVPixelFormat frame_format) {
+    if (!codec->pix_fmts)
+        return AV_PIX_FMT_YUV420P;
+
+    AVPixelFormat fallback = AV_PIX_FMT_NONE;
+    for (const AVPixelFormat *format = codec->pix_fmts; *format != AV_PIX_FMT_NONE; format++) {
+        // the formats of the frames of the hardware APIs can not be filled from host memory
+        if (av_pix_fmt_desc_get(*format)->flags & AV_PIX_FMT_FLAG_HWACCEL)
+            continue;
+        if (*format == frame_format)
+            return *format;
+        if (fallback == AV_PIX_FMT_NONE || *format == AV_PIX_FMT_NV12)
+            fallback = *format;
+    }
+
+    return (fallback == AV_PIX_FMT_NONE) ? AV_PIX_FMT_YUV420P : fallback;
+}
+
+static AVPixelFormat get_frame_format(RecorderPixelOrder order) {
+    // the alpha of the presented image is meaningless
+    return (order == RecorderPixelOrder::BGRA) ? AV_PIX_FMT_BGR0 : AV_PIX_FMT_RGB0;
+}
+
+GameplayRecorder::~GameplayRecorder() {
+    stop();
+}
+
+bool GameplayRecorder::start(const fs::path &path, uint32_t sample_rate, const std::string &encoder, uint32_t bitrate_kbps) {
+    if (recording)
+        return false;
+
+    this->path = path;
+    this->sample_rate = sample_rate;
+    this->bitrate_kbps = bitrate_kbps;
+    encoder_name = encoder;
+    stop_requested = false;
+    frames.clear();
+    audio_samples.clear();
+    audio_encoding.clear();
+    header_written = false;
+    video_failed = false;
+    last_video_pts = -1;
+    audio_pts = 0;
+
+    if (avformat_alloc_output_context2(&format, nullptr, nullptr, path.string().c_str()) < 0 || !format) {
+        LOG_ERROR("Could not create the recording {}", path.string());
+        return false;
+    }
+    packet = av_packet_alloc();
+
+    if (sample_rate != 0 && !open_audio())
+        LOG_WARN("The gameplay is recorded without audio");
+
+    start_time = std::chrono::steady_clock::now();
+    recording = true;
+    encode_thread = std::thread(&GameplayRecorder::encode_thread_main, this);
+
+    LOG_INFO("Recording the gameplay to {}", path.string());
+    return true;
+}
+
+void GameplayRecorder::stop() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!recording)
+            return;
+        recording = false;
+        stop_requested = true;
+    }
+    cond.notify_one();
+    encode_thread.join();
+}
+
+bool GameplayRecorder::push_frame(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, RecorderPixelOrder order, std::function<void()> release) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (!recording || frames.size() >= MAX_PENDING_FRAMES)
+        return false;
+
+    const int64_t timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    frames.push_back({ pixels, width, height, pitch, order, timestamp_ms, std::move(release) });
+    cond.notify_one();
+    return true;
+}
+
+void GameplayRecorder::push_audio(const int16_t *samples, size_t nb_frames) {
+    if (!recording)
+        return;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (audio_samples.size() < static_cast<size_t>(MAX_AUDIO_SECONDS) * sample_rate * 2)
+        audio_samples.insert(audio_samples.end(), samples, samples + nb_frames * 2);
+}
+
+void GameplayRecorder::encode_thread_main() {
+    std::deque<PendingFrame> to_encode;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [&]() { return stop_requested || !frames.empty(); });
+        const bool stopping = stop_requested;
+        std::swap(to_encode, frames);
+        audio_encoding.insert(audio_encoding.end(), audio_samples.begin(), audio_samples.end());
+        audio_samples.clear();
+        lock.unlock();
+
+        for (PendingFrame &frame : to_encode)
+            encode_video(frame);
+        to_encode.clear();
+        encode_audio(false);
+
+        lock.lock();
+        if (stopping && frames.empty())
+            break;
+    }
+    lock.unlock();
+
+    close();
+}
+
+bool GameplayRecorder::open_audio() {
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!codec)
+        return false;
+
+    audio_context = avcodec_alloc_context3(codec);
+    audio_context->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    audio_context->sample_rate = sample_rate;
+    audio_context->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+    audio_context->bit_rate = AUDIO_BITRATE;
+    audio_context->time_base = { 1, static_cast<int>(sample_rate) };
+    if (format->oformat->flags & AVFMT_GLOBALHEADER)
+        audio_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    int error = avcodec_open2(audio_context, codec, nullptr);
+    if (error < 0) {
+        LOG_WARN("Could not open the audio encoder: {}", error);
+        avcodec_free_context(&audio_context);
+        return false;
+    }
+
+    audio_stream = avformat_new_stream(format, nullptr);
+    audio_stream->time_base = audio_context->time_base;
+    avcodec_parameters_from_context(audio_stream->codecpar, audio_context);
+
+    audio_frame = av_frame_alloc();
+    audio_frame->format = audio_context->sample_fmt;
+    audio_frame->nb_samples = audio_context->frame_size;
+    audio_frame->sample_rate = audio_context->sample_rate;
+    av_channel_layout_copy(&audio_frame->ch_layout, &audio_context->ch_layout);
+    av_frame_get_buffer(audio_frame, 0);
+
+    // the mixed audio is interleaved s16
+    swr_alloc_set_opts2(&swr,
+        &audio_context->ch_layout, AV_SAMPLE_FMT_FLTP, sample_rate,
+        &audio_context->ch_layout, AV_SAMPLE_FMT_S16, sample_rate,
+        0, nullptr);
+    swr_init(swr);
+
+    return true;
+}
+
+bool GameplayRecorder::open_video(const PendingFrame &frame) {
+    const AVPixelFormat frame_format = get_frame_format(frame.order);
+    const AVCodec *codec = nullptr;
+    for (const std::string &name : get_encoder_candidates(encoder_name)) {
+        codec = avcodec_find_encoder_by_name(name.c_str());
+        if (!codec)
+            continue;
+
+        video_context = avcodec_alloc_context3(codec);
+        // most encoders only take even sizes
+        video_context->width = frame.width & ~1;
+        video_context->height = frame.height & ~1;
+        video_context->pix_fmt = choose_pixel_format(codec, frame_format);
+        // the frames are timed when they are presented, the frame rate is only a hint
+        video_context->time_base = { 1, 1000 };
+        video_context->framerate = { 60, 1 };
+        video_context->bit_rate = static_cast<int64_t>(bitrate_kbps) * 1000;
+        video_context->gop_size = 120;
+        video_context->max_b_frames = 0;
+        if (format->oformat->flags & AVFMT_GLOBALHEADER)
+            video_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        if (name == "libx264")
+            av_opt_set(video_context->priv_data, "preset", "veryfast", 0);
+
+        if (avcodec_open2(video_context, codec, nullptr) >= 0)
+            break;
+
+        LOG_INFO("Could not open the {} video encoder", name);
+        avcodec_free_context(&video_context);
+    }
+
+    if (!video_context) {
+        LOG_ERROR("No video encoder could be opened for the recording");
+        return false;
+    }
+
+    video_stream = avformat_new_stream(format, nullptr);
+    video_stream->time_base = video_context->time_base;
+    avcodec_parameters_from_context(video_stream->codecpar, video_context);
+
+    converted_frame = av_frame_alloc();
+    converted_frame->format = video_context->pix_fmt;
+    converted_frame->width = video_context->width;
+    converted_frame->height = video_context->height;
+    av_frame_get_buffer(converted_frame, 0);
+
+    // the header can only be written once every stream is known
+    if (!(format->oformat->flags & AVFMT_NOFILE) && avio_open(&format->pb, path.string().c_str(), AVIO_FLAG_WRITE) < 0) {
+        LOG_ERROR("Could not open {} for writing", path.string());
+        return false;
+    }
+    if (avformat_write_header(format, nullptr) < 0) {
+        LOG_ERROR("Could not write the header of {}", path.string());
+        return false;
+    }
+    header_written = true;
+
+    LOG_INFO("Recording {}x{} with the {} video encoder", video_context->width, video_context->height, codec->name);
+    return true;
+}
+
+void GameplayRecorder::encode_video(PendingFrame &frame) {
+    if (!video_failed && !header_written && !open_video(frame))
+        video_failed = true;
+    if (video_failed) {
+        frame.release();
+        return;
+    }
+
+    // the timestamps are in milliseconds, two frames presented in the same millisecond must still be ordered
+    const int64_t pts = std::max(frame.timestamp_ms, last_video_pts + 1);
+    last_video_pts = pts;
+
+    const AVPixelFormat frame_format = get_frame_format(frame.order);
+    if (frame_format == video_context->pix_fmt && static_cast<int>(frame.width) == video_context->width && static_cast<int>(frame.height) == video_context->height) {
+        // the encoder reads the frame in place, it is released when the encoder drops its last reference to it
+        AVFrame *av_frame = av_frame_alloc();
+        auto *release = new std::function<void()>(std::move(frame.release));
+        av_frame->buf[0] = av_buffer_create(
+            const_cast<uint8_t *>(frame.pixels), frame.pitch * frame.height,
+            [](void *opaque, uint8_t *) {
+                auto *release = static_cast<std::function<void()> *>(opaque);
+                (*release)();
+                delete release;
+            },
+            release, AV_BUFFER_FLAG_READONLY);
+        av_frame->data[0] = av_frame->buf[0]->data;
+        av_frame->linesize[0] = frame.pitch;
+        av_frame->format = frame_format;
+        av_frame->width = frame.width;
+        av_frame->height = frame.height;
+        av_frame->pts = pts;
+        const int error = avcodec_send_frame(video_context, av_frame);
+        av_frame_free(&av_frame);
+        if (error < 0)
+            LOG_WARN_ONCE("Could not encode a recorded frame: {}", error);
+    } else {
+        // the size changed or the encoder takes another format
+        sws = sws_getCachedContext(sws, frame.width, frame.height, frame_format,
+            video_context->width, video_context->height, video_context->pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        av_frame_make_writable(converted_frame);
+        const int pitch = static_cast<int>(frame.pitch);
+        sws_scale(sws, &frame.pixels, &pitch, 0, frame.height, converted_frame->data, converted_frame->linesize);
+        frame.release();
+
+        converted_frame->pts = pts;
+        const int error = avcodec_send_frame(video_context, converted_frame);
+        if (error < 0)
+            LOG_WARN_ONCE("Could not encode a recorded frame: {}", error);
+    }
+
+    write_packets(video_context, video_stream);
+}
+
+void GameplayRecorder::encode_audio(bool flush) {
+    if (!audio_context)
+        return;
+
+    const size_t frame_samples = static_cast<size_t>(audio_context->frame_size) * 2;
+    if (!header_written) {
+        // only keep the last seconds while waiting for the first frame, the skipped audio still counts in the timestamps
+        const size_t max_samples = static_cast<size_t>(MAX_AUDIO_SECONDS) * sample_rate * 2;
+        if (audio_encoding.size() > max_samples) {
+            const size_t skipped = (audio_encoding.size() - max_samples) / frame_samples * frame_samples;
+            audio_encoding.erase(audio_encoding.begin(), audio_encoding.begin() + skipped);
+            audio_pts += skipped / 2;
+        }
+        return;
+    }
+
+    size_t position = 0;
+    for (; position + frame_samples <= audio_encoding.size(); position += frame_samples) {
+        av_frame_make_writable(audio_frame);
+        const uint8_t *input = reinterpret_cast<const uint8_t *>(&audio_encoding[position]);
+        swr_convert(swr, audio_frame->data, audio_context->frame_size, &input, audio_context->frame_size);
+        audio_frame->pts = audio_pts;
+        audio_pts += audio_context->frame_size;
+        avcodec_send_frame(audio_context, audio_frame);
+        write_packets(audio_context, audio_stream);
+    }
+    audio_encoding.erase(audio_encoding.begin(), audio_encoding.begin() + position);
+
+    if (flush) {
+        avcodec_send_frame(audio_context, nullptr);
+        write_packets(audio_context, audio_stream);
+    }
+}
+
+void GameplayRecorder::write_packets(AVCodecContext *context, AVStream *stream) {
+    while (avcodec_receive_packet(context, packet) >= 0) {
+        av_packet_rescale_ts(packet, context->time_base, stream->time_base);
+        packet->stream_index = stream->index;
+        av_interleaved_write_frame(format, packet);
+    }
+}
+
+void GameplayRecorder::close() {
+    if (header_written) {
+        avcodec_send_frame(video_context, nullptr);
+        write_packets(video_context, video_stream);
+        encode_audio(true);
+        av_write_trailer(format);
+        LOG_INFO("Gameplay recording saved to {}", path.string());
+    } else {
+        LOG_WARN("No frame was recorded to {}", path.string());
+    }
+
+    if (format->pb)
+        avio_closep(&format->pb);
+    avformat_free_context(format);
+    format = nullptr;
+    video_stream = nullptr;
+    audio_stream = nullptr;
+    avcodec_free_context(&video_context);
+    avcodec_free_context(&audio_context);
+    av_frame_free(&converted_frame);
+    av_frame_free(&audio_frame);
+    av_packet_free(&packet);
+    sws_freeContext(sws);
+    sws = nullptr;
+    swr_free(&swr);
+}
+
+} // namespace renderer
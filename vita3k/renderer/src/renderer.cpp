@@ -97,6 +97,36 @@ void draw(State &state, Context *ctx, SceGxmPrimitiveType prim_type, SceGxmIndex
     renderer::add_command(ctx, renderer::CommandOpcode::Draw, nullptr, prim_type, index_type, index_data, index_count, instance_count);
 }
 
+void draw_packed(State &state, Context *ctx, SceGxmPrimitiveType prim_type, SceGxmIndexFormat index_type, Ptr<const void> index_data, const std::uint32_t index_count, const std::uint32_t instance_count,
+    const std::uint16_t stream_mask, const GXMStreamInfo *streams) {
+    if (!ctx)
+        return;
+
+    Command *cmd = make_command(ctx->alloc_func, ctx->free_func, CommandOpcode::DrawPacked, nullptr, prim_type, index_type, index_data, index_count, instance_count, stream_mask);
+    if (!cmd)
+        return;
+
+    // each used stream takes 8 bytes, the ones that do not fit anymore go in payload commands linked after this one
+    CommandHelper helper(cmd);
+    helper.point = sizeof(prim_type) + sizeof(index_type) + sizeof(index_data) + sizeof(index_count) + sizeof(instance_count) + sizeof(stream_mask);
+    for (std::uint16_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; stream_index++) {
+        if (!(stream_mask & (1 << stream_index)))
+            continue;
+
+        Ptr<const uint8_t> data = streams[stream_index].data;
+        std::uint32_t size = static_cast<std::uint32_t>(streams[stream_index].size);
+        helper.push_packed(data, ctx->alloc_func);
+        helper.push_packed(size, ctx->alloc_func);
+    }
+
+    if (!ctx->command_list.first) {
+        ctx->command_list.first = cmd;
+    } else {
+        ctx->command_list.last->next = cmd;
+    }
+    ctx->command_list.last = helper.cmd;
+}
+
 void transfer_copy(State &state, uint32_t colorKeyValue, uint32_t colorKeyMask, SceGxmTransferColorKeyMode colorKeyMode, const SceGxmTransferImage *images, SceGxmTransferType srcType, SceGxmTransferType destType) {
     renderer::send_single_command(state, nullptr, renderer::CommandOpcode::TransferCopy, false, colorKeyValue, colorKeyMask, colorKeyMode, images, srcType, destType);
 }
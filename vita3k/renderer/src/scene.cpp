@@ -20,14 +20,18 @@
 #include <renderer/commands.h>
 #include <renderer/driver_functions.h>
 #include <renderer/state.h>
+#include <renderer/texture_cache.h>
 #include <renderer/types.h>
 
 #include <renderer/gl/functions.h>
 #include <renderer/gl/types.h>
 
+#include <renderer/null/functions.h>
+
 #include <renderer/vulkan/functions.h>
 
 #include <config/state.h>
+#include <mem/state.h>
 #include <renderer/functions.h>
 #include <util/log.h>
 #include <util/tracy.h>
@@ -68,6 +72,10 @@ COMMAND(handle_set_context) {
     if (depth_stencil_surface)
         delete depth_stencil_surface;
 
+    renderer.get_texture_cache()->begin_scene();
+    if (mem.use_write_watch)
+        renderer.get_texture_cache()->refresh_dirty_textures(mem);
+
     switch (renderer.current_backend) {
     case Backend::OpenGL:
         gl::set_context(dynamic_cast<gl::GLState &>(renderer), *reinterpret_cast<gl::GLContext *>(render_context), mem, reinterpret_cast<const gl::GLRenderTarget *>(rt), features);
@@ -77,6 +85,9 @@ COMMAND(handle_set_context) {
         vulkan::set_context(*reinterpret_cast<vulkan::VKContext *>(render_context), mem, reinterpret_cast<vulkan::VKRenderTarget *>(rt), features);
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -99,16 +110,10 @@ COMMAND(handle_sync_surface_data) {
 
         were_notifications_signaled = true;
         // signal the notification now
-        std::unique_lock<std::mutex> lock(renderer.notification_mutex);
-
         if (vertex_notification.address)
-            *vertex_notification.address.get(mem) = vertex_notification.value;
+            signal_notification(renderer, mem, vertex_notification);
         if (fragment_notification.address)
-            *fragment_notification.address.get(mem) = fragment_notification.value;
-
-        // unlocking before a notify should be faster
-        lock.unlock();
-        renderer.notification_ready.notify_all();
+            signal_notification(renderer, mem, fragment_notification);
     };
 
     if (renderer.disable_surface_sync)
@@ -118,8 +123,13 @@ COMMAND(handle_sync_surface_data) {
     if (renderer.current_backend == Backend::Vulkan) {
         // TODO: put this in a function
         vulkan::VKContext *context = reinterpret_cast<vulkan::VKContext *>(renderer.context);
-        if (context->is_recording)
-            context->stop_recording(vertex_notification, fragment_notification);
+        if (context->is_recording) {
+            if (helper.cmd->status)
+                // someone is waiting for this scene
+                context->stop_recording(vertex_notification, fragment_notification);
+            else
+                context->end_scene(vertex_notification, fragment_notification);
+        }
     }
 
     SceGxmColorSurface *surface = &render_context->record.color_surface;
@@ -132,7 +142,8 @@ COMMAND(handle_sync_surface_data) {
         }
     }
 
-    if (renderer.disable_surface_sync || renderer.current_backend == Backend::Vulkan) {
+    // the null renderer has nothing to copy back
+    if (renderer.disable_surface_sync || renderer.current_backend != Backend::OpenGL) {
         if (helper.cmd->status) {
             complete_command(renderer, helper, 0);
         }
@@ -213,14 +224,8 @@ COMMAND(handle_mid_scene_flush) {
     }
 }
 
-COMMAND(handle_draw) {
-    TRACY_FUNC_COMMANDS(handle_draw);
-    SceGxmPrimitiveType type = helper.pop<SceGxmPrimitiveType>();
-    SceGxmIndexFormat format = helper.pop<SceGxmIndexFormat>();
-    Ptr<const void> indicies = helper.pop<Ptr<const void>>();
-    const std::uint32_t count = helper.pop<const std::uint32_t>();
-    const std::uint32_t instance_count = helper.pop<const std::uint32_t>();
-
+static void dispatch_draw(State &renderer, MemState &mem, Config &config, const FeatureState &features, Context *render_context, const char *cache_path, const char *title_id, const char *self_name,
+    SceGxmPrimitiveType type, SceGxmIndexFormat format, Ptr<const void> indicies, const std::uint32_t count, const std::uint32_t instance_count) {
     switch (renderer.current_backend) {
     case Backend::OpenGL:
         gl::draw(dynamic_cast<gl::GLState &>(renderer), *reinterpret_cast<gl::GLContext *>(render_context),
@@ -232,12 +237,48 @@ COMMAND(handle_draw) {
             count, instance_count, mem, config);
         break;
 
+    case Backend::Null:
+        null::draw(dynamic_cast<null::NullState &>(renderer), *render_context, features, mem, cache_path, title_id, self_name, config);
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
     }
 }
 
+COMMAND(handle_draw) {
+    TRACY_FUNC_COMMANDS(handle_draw);
+    SceGxmPrimitiveType type = helper.pop<SceGxmPrimitiveType>();
+    SceGxmIndexFormat format = helper.pop<SceGxmIndexFormat>();
+    Ptr<const void> indicies = helper.pop<Ptr<const void>>();
+    const std::uint32_t count = helper.pop<const std::uint32_t>();
+    const std::uint32_t instance_count = helper.pop<const std::uint32_t>();
+
+    dispatch_draw(renderer, mem, config, features, render_context, cache_path, title_id, self_name, type, format, indicies, count, instance_count);
+}
+
+COMMAND(handle_draw_packed) {
+    TRACY_FUNC_COMMANDS(handle_draw_packed);
+    SceGxmPrimitiveType type = helper.pop<SceGxmPrimitiveType>();
+    SceGxmIndexFormat format = helper.pop<SceGxmIndexFormat>();
+    Ptr<const void> indicies = helper.pop<Ptr<const void>>();
+    const std::uint32_t count = helper.pop<const std::uint32_t>();
+    const std::uint32_t instance_count = helper.pop<const std::uint32_t>();
+    const std::uint16_t stream_mask = helper.pop<std::uint16_t>();
+
+    for (std::uint16_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; stream_index++) {
+        if (!(stream_mask & (1 << stream_index)))
+            continue;
+
+        GXMStreamInfo &info = render_context->record.vertex_streams[stream_index];
+        info.data = helper.pop_packed<Ptr<const uint8_t>>();
+        info.size = helper.pop_packed<std::uint32_t>();
+    }
+
+    dispatch_draw(renderer, mem, config, features, render_context, cache_path, title_id, self_name, type, format, indicies, count, instance_count);
+}
+
 COMMAND(handle_transfer_copy) {
     TRACY_FUNC_COMMANDS(handle_transfer_copy);
     const uint32_t colorKeyValue = helper.pop<uint32_t>();
@@ -249,6 +290,13 @@ COMMAND(handle_transfer_copy) {
     const SceGxmTransferType src_type = helper.pop<SceGxmTransferType>();
     const SceGxmTransferType dst_type = helper.pop<SceGxmTransferType>();
 
+    // copying a render target to another one is done on the GPU, the memory of the source may not be synced
+    if (renderer.current_backend == Backend::Vulkan && colorKeyMode == SCE_GXM_TRANSFER_COLORKEY_NONE
+        && vulkan::transfer_surface(dynamic_cast<vulkan::VKState &>(renderer), *src, *dest, src_type, dst_type, false)) {
+        delete[] images;
+        return;
+    }
+
     const auto src_is_linear = src_type == SCE_GXM_TRANSFER_LINEAR;
     const auto dest_is_swizzled = dst_type == SCE_GXM_TRANSFER_SWIZZLED;
 
@@ -359,6 +407,13 @@ COMMAND(handle_transfer_downscale) {
     const SceGxmTransferImage *src = helper.pop<SceGxmTransferImage *>();
     const SceGxmTransferImage *dest = helper.pop<SceGxmTransferImage *>();
 
+    if (renderer.current_backend == Backend::Vulkan
+        && vulkan::transfer_surface(dynamic_cast<vulkan::VKState &>(renderer), *src, *dest, SCE_GXM_TRANSFER_LINEAR, SCE_GXM_TRANSFER_LINEAR, true)) {
+        delete src;
+        delete dest;
+        return;
+    }
+
     const auto src_bpp = gxm::get_bits_per_pixel(src->format);
     const auto dest_bpp = gxm::get_bits_per_pixel(dest->format);
     const uint32_t src_bytes_per_pixel = (src_bpp + 7) >> 3;
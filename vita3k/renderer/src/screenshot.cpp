@@ -0,0 +1,103 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/screenshot.h>
+
+#include <util/log.h>
+
+#include <stb_image_write.h>
+
+#include <vector>
+
+namespace renderer {
+
+void ScreenshotWriter::request(const fs::path &path) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    requested_path = path;
+    requested = true;
+    if (!writer_thread.joinable())
+        writer_thread = std::thread(&ScreenshotWriter::writer_thread_main, this);
+}
+
+bool ScreenshotWriter::push_frame(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, RecorderPixelOrder order, std::function<void()> release) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (!requested)
+        return false;
+
+    requested = false;
+    screenshots.push_back({ std::move(requested_path), pixels, width, height, pitch, order, std::move(release) });
+    cond.notify_one();
+    return true;
+}
+
+ScreenshotWriter::~ScreenshotWriter() {
+    stop();
+}
+
+void ScreenshotWriter::stop() {
+    if (!writer_thread.joinable())
+        return;
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop_requested = true;
+    }
+    cond.notify_one();
+    writer_thread.join();
+    stop_requested = false;
+    requested = false;
+}
+
+void ScreenshotWriter::writer_thread_main() {
+    std::vector<uint8_t> rgba;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [this] { return stop_requested || !screenshots.empty(); });
+        if (screenshots.empty())
+            return;
+
+        PendingScreenshot screenshot = std::move(screenshots.front());
+        screenshots.pop_front();
+        lock.unlock();
+
+        // the presented image can have any alpha, the frame is converted to opaque RGBA so it can be released right away
+        const size_t row_size = static_cast<size_t>(screenshot.width) * 4;
+        rgba.resize(row_size * screenshot.height);
+        const bool swap_red_blue = screenshot.order == RecorderPixelOrder::BGRA;
+        for (uint32_t y = 0; y < screenshot.height; y++) {
+            const uint8_t *src = screenshot.pixels + static_cast<size_t>(y) * screenshot.pitch;
+            uint8_t *dst = rgba.data() + y * row_size;
+            for (uint32_t x = 0; x < screenshot.width; x++, src += 4, dst += 4) {
+                dst[0] = swap_red_blue ? src[2] : src[0];
+                dst[1] = src[1];
+                dst[2] = swap_red_blue ? src[0] : src[2];
+                dst[3] = 0xFF;
+            }
+        }
+        screenshot.release();
+
+        fs::create_directories(screenshot.path.parent_path());
+        if (stbi_write_png(screenshot.path.string().c_str(), screenshot.width, screenshot.height, 4, rgba.data(), static_cast<int>(row_size)))
+            LOG_INFO("Screenshot saved to {}", screenshot.path.string());
+        else
+            LOG_ERROR("Failed to save the screenshot {}", screenshot.path.string());
+
+        lock.lock();
+    }
+}
+
+} // namespace renderer
@@ -0,0 +1,192 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/shader_pack.h>
+
+#include <util/log.h>
+
+#include <cstring>
+
+namespace renderer {
+
+uint64_t ShaderPack::read_index() {
+    ShaderPackHeader header;
+    if (file.size() < sizeof(header))
+        return 0;
+
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, ShaderPackMagic, sizeof(ShaderPackMagic)) != 0 || header.version != ShaderPackVersion)
+        return 0;
+
+    uint64_t offset = sizeof(header);
+    while (offset + sizeof(ShaderPackRecord) <= file.size()) {
+        ShaderPackRecord record;
+        memcpy(&record, file.data() + offset, sizeof(record));
+        const uint64_t record_end = offset + sizeof(record) + record.name_size + record.data_size;
+        if (record_end > file.size())
+            break;
+
+        const uint8_t *name = file.data() + offset + sizeof(record);
+        index[std::string(reinterpret_cast<const char *>(name), record.name_size)] = { name + record.name_size, record.data_size };
+        offset = record_end;
+    }
+
+    return offset;
+}
+
+bool ShaderPack::open(const fs::path &new_folder) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (append_stream.is_open() && folder == new_folder)
+        return true;
+
+    append_stream.close();
+    file.close();
+    index.clear();
+    appended.clear();
+    folder.clear();
+
+    const fs::path path = new_folder / ShaderPackFileName;
+    try {
+        fs::create_directories(new_folder);
+
+        const uint64_t valid_size = file.open(path) ? read_index() : 0;
+        if (valid_size == 0) {
+            if (file.is_open())
+                LOG_WARN("Shader pack {} is invalid or outdated, recreating it", path.string());
+            file.close();
+            index.clear();
+
+            fs::ofstream new_file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            ShaderPackHeader header{};
+            memcpy(header.magic, ShaderPackMagic, sizeof(ShaderPackMagic));
+            header.version = ShaderPackVersion;
+            new_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        } else if (valid_size < file.size()) {
+            // the last shader was not completely written, cut it so that the next appended ones can be read
+            LOG_WARN("Shader pack {} ends with an incomplete shader, dropping it", path.string());
+            file.close();
+            index.clear();
+            fs::resize_file(path, valid_size);
+            file.open(path);
+            read_index();
+        }
+    } catch (std::exception &e) {
+        LOG_ERROR("Failed to open shader pack {}: {}", path.string(), e.what());
+        file.close();
+        index.clear();
+        return false;
+    }
+
+    append_stream.open(path, std::ios::out | std::ios::binary | std::ios::app);
+    if (!append_stream.is_open()) {
+        LOG_ERROR("Failed to open shader pack {} for writing", path.string());
+        file.close();
+        index.clear();
+        return false;
+    }
+
+    folder = new_folder;
+    migrate_loose_files();
+    LOG_INFO("Shader pack loaded with {} shaders", index.size());
+
+    return true;
+}
+
+void ShaderPack::close() {
+    std::lock_guard<std::mutex> guard(mutex);
+    append_stream.close();
+    file.close();
+    index.clear();
+    appended.clear();
+    folder.clear();
+}
+
+bool ShaderPack::find(const std::string &name, const uint8_t *&data, size_t &size) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = index.find(name);
+    if (it == index.end() || it->second.size == 0)
+        return false;
+
+    data = it->second.data;
+    size = it->second.size;
+    return true;
+}
+
+bool ShaderPack::write(const std::string &name, const void *data, size_t size) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!append_stream.is_open())
+        return false;
+
+    return append(name, data, size);
+}
+
+bool ShaderPack::append(const std::string &name, const void *data, size_t size) {
+    const ShaderPackRecord record{
+        .name_size = static_cast<uint32_t>(name.size()),
+        .data_size = static_cast<uint32_t>(size)
+    };
+    append_stream.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    append_stream.write(name.data(), name.size());
+    append_stream.write(reinterpret_cast<const char *>(data), size);
+    // the record must be complete on the disk even if we crash later
+    append_stream.flush();
+    if (!append_stream) {
+        LOG_ERROR("Failed to write shader {} to the shader pack", name);
+        append_stream.clear();
+        return false;
+    }
+
+    // the new content is not in the mapping, keep a copy of it
+    std::unique_ptr<uint8_t[]> content = std::make_unique<uint8_t[]>(size);
+    memcpy(content.get(), data, size);
+    index[name] = { content.get(), size };
+    appended.push_back(std::move(content));
+
+    return true;
+}
+
+void ShaderPack::migrate_loose_files() {
+    uint32_t nb_migrated = 0;
+    for (const auto &entry : fs::directory_iterator(folder)) {
+        if (!fs::is_regular_file(entry.path()))
+            continue;
+
+        // glsl shaders use the vert and frag extensions, spir-v ones use spv or spv.txt
+        const fs::path extension = entry.path().extension();
+        if (extension != ".spv" && extension != ".vert" && extension != ".frag" && extension != ".txt")
+            continue;
+
+        fs::ifstream loose_file(entry.path(), std::ios::in | std::ios::binary);
+        if (!loose_file.is_open())
+            continue;
+
+        std::vector<char> content{ std::istreambuf_iterator<char>(loose_file), std::istreambuf_iterator<char>() };
+        loose_file.close();
+
+        const std::string name = entry.path().filename().string();
+        if (!index.contains(name) && !append(name, content.data(), content.size()))
+            break;
+
+        fs::remove(entry.path());
+        nb_migrated++;
+    }
+
+    if (nb_migrated > 0)
+        LOG_INFO("Moved {} shaders to the shader pack", nb_migrated);
+}
+
+} // namespace renderer
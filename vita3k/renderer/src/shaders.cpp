@@ -18,6 +18,7 @@
 #include <renderer/shaders.h>
 
 #include <renderer/profile.h>
+#include <renderer/shader_pack.h>
 
 #include <renderer/vulkan/state.h>
 
@@ -25,14 +26,72 @@
 #include <renderer/state.h>
 #include <renderer/types.h>
 #include <shader/spirv_recompiler.h>
+#include <shader/usse_program_analyzer.h>
 #include <util/fs.h>
 #include <util/log.h>
 
+#include <gxm/functions.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 namespace renderer {
 
+// the packed shader cache of the running title
+static ShaderPack shader_pack;
+
+static ShaderPack *get_shader_pack(const char *cache_path, const char *title_id, const char *self_name) {
+    if (!shader_pack.open(fs::path(cache_path) / "shaders" / title_id / self_name))
+        return nullptr;
+
+    return &shader_pack;
+}
+
+// the shaders generated by all titles, keyed like the pack of the title by shader version and program hash
+// opened for the backend and the features of the renderer, a new title finds there the shaders of the engines already used by another one
+static ShaderPack shared_shader_pack;
+
+static void open_shared_shader_pack(State &renderer) {
+    const fs::path shared_path = fs::path(renderer.cache_path) / "shaders" / "shared";
+    const std::string version_prefix = fmt::format("v{}-", shader::CURRENT_VERSION);
+    const std::string folder = fmt::format("{}{}-{:08x}", version_prefix, (renderer.current_backend == Backend::OpenGL) ? "gl" : "vk", renderer.get_features_mask());
+
+    try {
+        // the stores of the other shader versions can't be used anymore
+        if (fs::exists(shared_path)) {
+            for (const auto &entry : fs::directory_iterator(shared_path)) {
+                if (fs::is_directory(entry.path()) && !entry.path().filename().string().starts_with(version_prefix))
+                    fs::remove_all(entry.path());
+            }
+        }
+    } catch (std::exception &e) {
+        LOG_WARN("Failed to clean the shared shader cache: {}", e.what());
+    }
+
+    if (!shared_shader_pack.open(shared_path / folder))
+        LOG_WARN("Failed to open the shared shader cache, shaders will only be cached for this title");
+}
+
+// store a generated shader in the shared pack, or in the pack of the title if the shared one is not available
+static bool write_generated_shader(ShaderPack *pack, const std::string &name, const void *data, size_t size) {
+    return shared_shader_pack.write(name, data, size) || (pack && pack->write(name, data, size));
+}
+
+// name of the shader file in the loose layout, also used as its name in the shader pack
+static std::string get_shader_file_name(const char *hash, const char *extension) {
+    return fs::path(hash).replace_extension(extension).string();
+}
+
 bool get_shaders_cache_hashs(State &renderer) {
+    // the shared shaders are also used by the titles running for the first time
+    open_shared_shader_pack(renderer);
+
     const auto shaders_path{ fs::path(renderer.cache_path) / "shaders" / renderer.title_id / renderer.self_name };
     const std::string hash_file_name = fmt::format("hashs-{}.dat", (renderer.current_backend == Backend::OpenGL) ? "gl" : "vk");
 
@@ -52,6 +111,7 @@ bool get_shaders_cache_hashs(State &renderer) {
     shaders_hashs.read((char *)&features_mask, sizeof(uint32_t));
     if (versionInFile != shader::CURRENT_VERSION || features_mask != renderer.get_features_mask()) {
         shaders_hashs.close();
+        shader_pack.close();
         fs::remove_all(shaders_path);
         fs::remove_all(fs::path(renderer.log_path) / "shaderlog" / renderer.title_id / renderer.self_name);
         if (versionInFile != shader::CURRENT_VERSION)
@@ -61,6 +121,9 @@ bool get_shaders_cache_hashs(State &renderer) {
         return false;
     }
 
+    // map the shader pack now, this also moves the shaders of the loose layout into it
+    get_shader_pack(renderer.cache_path.c_str(), renderer.title_id, renderer.self_name);
+
     if (renderer.current_backend == Backend::Vulkan) {
         // Read the pipeline cache
         dynamic_cast<vulkan::VKState &>(renderer).pipeline_cache.read_pipeline_cache();
@@ -120,6 +183,21 @@ void save_shaders_cache_hashs(State &renderer, std::vector<ShadersHash> &shaders
 }
 
 static bool load_shader(const char *hash, const char *extension, const char *cache_path, const char *title_id, const char *self_name, char **destination, std::size_t &size_read) {
+    if (ShaderPack *pack = get_shader_pack(cache_path, title_id, self_name)) {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        // the title keeps the shaders it generated before the shared pack existed
+        const std::string name = get_shader_file_name(hash, extension);
+        if (!pack->find(name, data, size) && !shared_shader_pack.find(name, data, size))
+            return false;
+
+        size_read = size;
+        if (destination != nullptr)
+            memcpy(*destination, data, size);
+        return true;
+    }
+
+    // the shader pack could not be opened, fallback to the loose layout
     const auto shader_path = fs_utils::construct_file_name(cache_path, (fs::path("shaders") / title_id / self_name).string().c_str(), hash, extension);
     fs::ifstream is(shader_path, fs::ifstream::binary);
     if (!is) {
@@ -162,7 +240,7 @@ R load_shader_generic(const char *hash_text, const char *cache_path, const char
     return source;
 }
 
-shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, const char *shader_type_str, const std::string &shader_version, bool shader_cache) {
+static shader::GeneratedShader translate_shader(shader::Target target, const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, const char *shader_type_str, const std::string &shader_version, bool shader_cache) {
     // TODO: no need to recompute the hash here
     const std::string hash_text = hex_string(get_shader_hash(program));
     // Set Shader Hash with Version
@@ -217,9 +295,13 @@ shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmP
     if (!fs::exists(cache_path / shaders_cache_path))
         fs::create_directories(cache_path / shaders_cache_path);
 
+    ShaderPack *pack = get_shader_pack(cache_path, title_id, self_name);
+    const std::string shader_file_name = get_shader_file_name(hash_hex_ver.c_str(), target == shader::Target::GLSLOpenGL ? shader_type_str : "spv");
     if (target == shader::Target::GLSLOpenGL) {
         shader_cache_path.replace_extension(shader_type_str);
-        if (fs::exists(shader_cache_path)) {
+        if (write_generated_shader(pack, shader_file_name, source.glsl.data(), source.glsl.size())) {
+            fs::remove(shader_cache_path);
+        } else if (fs::exists(shader_cache_path)) {
             try {
                 const auto shader_dst_path = fs_utils::construct_file_name(cache_path, shaders_cache_path, hash_hex_ver.c_str(), shader_type_str);
                 fs::copy_file(shader_cache_path, shader_dst_path, fs::copy_options::overwrite_existing);
@@ -228,7 +310,7 @@ shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmP
                 LOG_ERROR("Failed to moved shaders file: \n{}", e.what());
             }
         }
-    } else {
+    } else if (!write_generated_shader(pack, shader_file_name, source.spirv.data(), sizeof(uint32_t) * source.spirv.size())) {
         const auto shader_dst_path = fs_utils::construct_file_name(cache_path, shaders_cache_path, hash_hex_ver.c_str(), "spv");
         fs::ofstream of{ shader_dst_path, fs::ofstream::binary };
         if (!of.fail()) {
@@ -240,6 +322,129 @@ shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmP
     return source;
 }
 
+// shaders translated in the background, keyed by shader version, hash and type
+// a taken shader leaves an empty future behind so it is not translated again
+static std::mutex translation_mutex;
+static std::map<std::string, std::shared_future<shader::GeneratedShader>> translation_jobs;
+static std::deque<std::packaged_task<shader::GeneratedShader()>> translation_queue;
+static std::condition_variable translation_cond;
+static bool translation_workers_started = false;
+
+static void translation_worker() {
+    while (true) {
+        std::packaged_task<shader::GeneratedShader()> task;
+        {
+            std::unique_lock<std::mutex> lock(translation_mutex);
+            translation_cond.wait(lock, [] { return !translation_queue.empty(); });
+            task = std::move(translation_queue.front());
+            translation_queue.pop_front();
+        }
+        task();
+    }
+}
+
+static std::string get_translation_key(const std::string &hash_hex_ver, const char *shader_type_str) {
+    return hash_hex_ver + "." + shader_type_str;
+}
+
+// wait for the shader if it is being translated in the background, return false if it is not
+static bool take_translated_shader(const std::string &key, shader::GeneratedShader &shader) {
+    std::shared_future<shader::GeneratedShader> result;
+    {
+        std::lock_guard<std::mutex> guard(translation_mutex);
+        auto it = translation_jobs.find(key);
+        if (it == translation_jobs.end() || !it->second.valid())
+            return false;
+
+        result = std::move(it->second);
+    }
+
+    shader = result.get();
+    return true;
+}
+
+shader::GeneratedShader load_shader_generic(shader::Target target, const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, const char *shader_type_str, const std::string &shader_version, bool shader_cache) {
+    const std::string hash_hex_ver = shader_version + "-" + hex_string(get_shader_hash(program));
+    shader::GeneratedShader shader;
+    if (take_translated_shader(get_translation_key(hash_hex_ver, shader_type_str), shader))
+        return shader;
+
+    return translate_shader(target, program, features, hints, maskupdate, cache_path, title_id, self_name, shader_type_str, shader_version, shader_cache);
+}
+
+void translate_shader_async(State &renderer, const SceGxmProgram &program, const std::vector<SceGxmVertexAttribute> *attributes, bool shader_cache, bool spirv) {
+    // the texture formats and the color surface hints are only known when drawing
+    if (!program.is_vertex() || gxp::get_textures_used(program).any())
+        return;
+
+    // a shader without its symbols needs the attributes given when creating the vertex program
+    if (!attributes && program.primary_reg_count != 0) {
+        shader::usse::AttributeInformationMap attribute_infos;
+        shader::usse::get_attribute_informations(program, attribute_infos);
+        if (attribute_infos.empty())
+            return;
+    }
+
+    // same target and version as the shaders loaded when drawing
+    shader::Target target;
+    std::string shader_version;
+    const char *shader_type_str;
+    if (renderer.current_backend == Backend::Vulkan) {
+        target = shader::Target::SpirVVulkan;
+        shader_version = fmt::format("vk{}", shader::CURRENT_VERSION);
+        shader_type_str = "vert.spv.txt";
+        // the vulkan renderer always uses the shader cache
+        shader_cache = true;
+    } else if (renderer.features.spirv_shader && spirv) {
+        target = shader::Target::SpirVOpenGL;
+        shader_version = renderer.shader_version + "spv";
+        shader_type_str = "vert.spv.txt";
+    } else {
+        target = shader::Target::GLSLOpenGL;
+        shader_version = renderer.shader_version;
+        shader_type_str = "vert";
+    }
+
+    const std::string key = get_translation_key(shader_version + "-" + hex_string(get_shader_hash(program)), shader_type_str);
+    {
+        std::lock_guard<std::mutex> guard(translation_mutex);
+        if (translation_jobs.contains(key))
+            return;
+    }
+
+    // the program and the attributes may be released before the translation is done, use copies
+    std::vector<uint8_t> program_copy(reinterpret_cast<const uint8_t *>(&program), reinterpret_cast<const uint8_t *>(&program) + program.size);
+    std::vector<SceGxmVertexAttribute> attributes_copy;
+    if (attributes)
+        attributes_copy = *attributes;
+
+    std::packaged_task<shader::GeneratedShader()> task(
+        [=, has_attributes = attributes != nullptr, program_copy = std::move(program_copy), attributes_copy = std::move(attributes_copy), features = renderer.features,
+            cache_path = renderer.cache_path, title_id = std::string(renderer.title_id), self_name = std::string(renderer.self_name)]() {
+            shader::Hints hints{};
+            hints.attributes = has_attributes ? &attributes_copy : nullptr;
+            const SceGxmProgram &program_gxp = *reinterpret_cast<const SceGxmProgram *>(program_copy.data());
+            return translate_shader(target, program_gxp, features, hints, false, cache_path.c_str(), title_id.c_str(), self_name.c_str(), shader_type_str, shader_version, shader_cache);
+        });
+
+    {
+        std::lock_guard<std::mutex> guard(translation_mutex);
+        if (translation_jobs.contains(key))
+            return;
+
+        if (!translation_workers_started) {
+            const uint32_t nb_workers = std::clamp(std::thread::hardware_concurrency() / 4, 1U, 4U);
+            for (uint32_t i = 0; i < nb_workers; i++)
+                std::thread(translation_worker).detach();
+            translation_workers_started = true;
+        }
+
+        translation_jobs.emplace(key, task.get_future().share());
+        translation_queue.push_back(std::move(task));
+    }
+    translation_cond.notify_one();
+}
+
 std::string load_glsl_shader(const SceGxmProgram &program, const FeatureState &features, const shader::Hints &hints, bool maskupdate, const char *cache_path, const char *title_id, const char *self_name, const std::string &shader_version, bool shader_cache) {
     SceGxmProgramType program_type = program.get_type();
 
@@ -269,4 +474,20 @@ std::vector<uint32_t> pre_load_shader_spirv(const char *hash_text, const char *s
     return load_shader_generic<std::vector<uint32_t>>(hash_text, cache_path, title_id, self_name, shader_type_str);
 }
 
+bool load_shader_blob(const std::string &name, const char *cache_path, const char *title_id, const char *self_name, std::vector<uint8_t> &blob) {
+    ShaderPack *pack = get_shader_pack(cache_path, title_id, self_name);
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if (!pack || !pack->find(name, data, size))
+        return false;
+
+    blob.assign(data, data + size);
+    return true;
+}
+
+bool save_shader_blob(const std::string &name, const void *data, size_t size, const char *cache_path, const char *title_id, const char *self_name) {
+    ShaderPack *pack = get_shader_pack(cache_path, title_id, self_name);
+    return pack && pack->write(name, data, size);
+}
+
 } // namespace renderer
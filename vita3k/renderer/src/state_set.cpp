@@ -69,6 +69,9 @@ COMMAND_SET_STATE(region_clip) {
         vulkan::sync_clipping(*reinterpret_cast<vulkan::VKContext *>(render_context));
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -92,6 +95,7 @@ COMMAND_SET_STATE(program) {
             break;
 
         case Backend::Vulkan:
+        case Backend::Null:
             break;
 
         default:
@@ -128,6 +132,9 @@ COMMAND_SET_STATE(uniform_buffer) {
         vulkan::set_uniform_buffer(*reinterpret_cast<vulkan::VKContext *>(render_context), mem, program, is_vertex, block_num, size, data);
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         return;
@@ -185,6 +192,9 @@ COMMAND_SET_STATE(viewport) {
             vulkan::sync_viewport_real(*reinterpret_cast<vulkan::VKContext *>(render_context), xOffset, yOffset, zOffset, xScale, yScale, zScale);
             break;
 
+        case Backend::Null:
+            break;
+
         default:
             REPORT_MISSING(renderer.current_backend);
             break;
@@ -206,6 +216,9 @@ COMMAND_SET_STATE(viewport) {
             vulkan::sync_viewport_flat(*reinterpret_cast<vulkan::VKContext *>(render_context));
             break;
 
+        case Backend::Null:
+            break;
+
         default:
             REPORT_MISSING(renderer.current_backend);
             break;
@@ -225,6 +238,9 @@ COMMAND_SET_STATE(viewport) {
             vulkan::sync_clipping(*reinterpret_cast<vulkan::VKContext *>(render_context));
             break;
 
+        case Backend::Null:
+            break;
+
         default:
             REPORT_MISSING(renderer.current_backend);
             break;
@@ -252,6 +268,9 @@ COMMAND_SET_STATE(depth_bias) {
             vulkan::sync_depth_bias(*reinterpret_cast<vulkan::VKContext *>(render_context));
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -278,6 +297,9 @@ COMMAND_SET_STATE(depth_func) {
         vulkan::refresh_pipeline(*reinterpret_cast<vulkan::VKContext *>(render_context));
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -303,6 +325,9 @@ COMMAND_SET_STATE(depth_write_enable) {
         vulkan::refresh_pipeline(*reinterpret_cast<vulkan::VKContext *>(render_context));
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -327,6 +352,9 @@ COMMAND_SET_STATE(polygon_mode) {
         vulkan::refresh_pipeline(*reinterpret_cast<vulkan::VKContext *>(render_context));
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -349,6 +377,9 @@ COMMAND_SET_STATE(point_line_width) {
         vulkan::sync_point_line_width(*reinterpret_cast<vulkan::VKContext *>(render_context), is_front);
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -390,6 +421,9 @@ COMMAND_SET_STATE(stencil_func) {
         vulkan::sync_stencil_func(dynamic_cast<vulkan::VKContext &>(*render_context), !is_front);
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -415,6 +449,9 @@ COMMAND_SET_STATE(stencil_ref) {
         vulkan::sync_stencil_func(dynamic_cast<vulkan::VKContext &>(*render_context), !is_front);
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -437,6 +474,9 @@ COMMAND_SET_STATE(texture) {
             config, title_id);
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -460,6 +500,9 @@ COMMAND_SET_STATE(two_sided) {
         vulkan::sync_stencil_func(dynamic_cast<vulkan::VKContext &>(*render_context), true);
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -479,6 +522,9 @@ COMMAND_SET_STATE(cull_mode) {
         vulkan::refresh_pipeline(*reinterpret_cast<vulkan::VKContext *>(render_context));
         break;
 
+    case Backend::Null:
+        break;
+
     default:
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -0,0 +1,89 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <renderer/surface_cache.h>
+
+namespace renderer {
+
+std::shared_ptr<SurfaceGuestAccess> SurfaceSyncTracker::track(Address addr, uint32_t size, bool has_trap) {
+    TrackedSurface &surface = surfaces[addr];
+    surface.size = size;
+    surface.gpu_fence = 0;
+    surface.synced_fence = 0;
+    surface.has_trap = has_trap;
+    surface.access = std::make_shared<SurfaceGuestAccess>();
+    // the trap is armed by the caller right away
+    surface.access->accessed = !has_trap;
+    surface.access->armed = has_trap;
+    return surface.access;
+}
+
+void SurfaceSyncTracker::untrack(Address addr, const SurfaceGuestAccess *access) {
+    const auto it = surfaces.find(addr);
+    if (it != surfaces.end() && it->second.access.get() == access)
+        surfaces.erase(it);
+}
+
+uint64_t SurfaceSyncTracker::record_gpu_write(Address addr) {
+    const auto it = surfaces.find(addr);
+    if (it == surfaces.end())
+        return 0;
+
+    it->second.gpu_fence = ++last_fence;
+    return it->second.gpu_fence;
+}
+
+SurfaceSyncAction SurfaceSyncTracker::before_gpu_use(Address addr) const {
+    const TrackedSurface *surface = find(addr);
+    if (!surface || !surface->access->written)
+        return SurfaceSyncAction::Reuse;
+
+    return SurfaceSyncAction::Upload;
+}
+
+SurfaceSyncAction SurfaceSyncTracker::after_gpu_write(Address addr) const {
+    const TrackedSurface *surface = find(addr);
+    // nothing new to copy, or the guest did not look at the surface since it was last synced
+    if (!surface || surface->gpu_fence <= surface->synced_fence || !surface->access->accessed)
+        return SurfaceSyncAction::Reuse;
+
+    return SurfaceSyncAction::Readback;
+}
+
+bool SurfaceSyncTracker::mark_synced(Address addr) {
+    const auto it = surfaces.find(addr);
+    if (it == surfaces.end())
+        return false;
+
+    TrackedSurface &surface = it->second;
+    surface.synced_fence = surface.gpu_fence;
+    surface.access->written = false;
+    if (!surface.has_trap)
+        return false;
+
+    surface.access->accessed = false;
+    // the trap is still armed if it was not hit since it was last armed
+    return !surface.access->armed.exchange(true);
+}
+
+const SurfaceSyncTracker::TrackedSurface *SurfaceSyncTracker::find(Address addr) const {
+    const auto it = surfaces.find(addr);
+    return (it == surfaces.end()) ? nullptr : &it->second;
+}
+
+} // namespace renderer
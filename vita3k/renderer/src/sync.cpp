@@ -15,6 +15,7 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include <algorithm>
 #include <chrono>
 #include <display/functions.h>
 #include <gxm/types.h>
@@ -65,13 +66,7 @@ COMMAND(handle_notification) {
     TRACY_FUNC_COMMANDS(handle_notification);
     SceGxmNotification notif = helper.pop<SceGxmNotification>();
 
-    {
-        std::unique_lock<std::mutex> lock(renderer.notification_mutex);
-        uint32_t *val = notif.address.get(mem);
-        if (val) // Ratchet and clank Trilogy request this
-            *val = notif.value;
-    }
-    renderer.notification_ready.notify_all();
+    signal_notification(renderer, mem, notif);
 }
 
 COMMAND(new_frame) {
@@ -99,6 +94,41 @@ void finish(State &state, Context *context) {
     renderer::send_single_command(state, context, renderer::CommandOpcode::Nop, true, 1);
 }
 
+void signal_notification(State &state, const MemState &mem, const SceGxmNotification &notification) {
+    std::lock_guard<std::mutex> lock(state.notification_mutex);
+    uint32_t *val = notification.address.get(mem);
+    if (!val) // Ratchet and clank Trilogy request this
+        return;
+    *val = notification.value;
+
+    // only wake up the threads waiting on this notification
+    auto it = state.notification_waiters.find(notification.address.address());
+    if (it != state.notification_waiters.end()) {
+        for (std::condition_variable *waiter : it->second)
+            waiter->notify_one();
+    }
+}
+
+void wait_notification(State &state, const MemState &mem, const SceGxmNotification &notification) {
+    const Address address = notification.address.address();
+    volatile uint32_t *value = notification.address.get(mem);
+    const uint32_t target_value = notification.value;
+
+    std::unique_lock<std::mutex> lock(state.notification_mutex);
+    if (*value == target_value)
+        return;
+
+    std::condition_variable cond;
+    state.notification_waiters[address].push_back(&cond);
+    cond.wait(lock, [&]() { return *value == target_value; });
+
+    // the map may have been modified while waiting
+    auto &waiters = state.notification_waiters[address];
+    waiters.erase(std::find(waiters.begin(), waiters.end(), &cond));
+    if (waiters.empty())
+        state.notification_waiters.erase(address);
+}
+
 int wait_for_status(State &state, int *status, int signal, bool wake_on_equal) {
     std::unique_lock<std::mutex> lock(state.command_finish_one_mutex);
     const bool wake_on_unequal = !wake_on_equal;
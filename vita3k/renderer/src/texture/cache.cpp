@@ -19,6 +19,7 @@
 
 #include <renderer/profile.h>
 #include <renderer/texture_cache.h>
+#include <renderer/texture_disk_cache.h>
 
 #include <gxm/functions.h>
 #include <mem/ptr.h>
@@ -71,6 +72,106 @@ uint64_t hash_texture_data(const SceGxmTexture &texture, uint32_t texture_size,
     }
 }
 
+// hash of the whole guest content of the texture and of the parameters its decoded content depends on
+static uint64_t hash_decoded_texture(const SceGxmTexture &texture, Backend backend, const MemState &mem) {
+    const struct {
+        uint32_t base_format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mip_count;
+        uint32_t texture_type;
+        uint32_t backend;
+    } parameters = {
+        static_cast<uint32_t>(gxm::get_base_format(gxm::get_format(texture))),
+        gxm::get_width(texture),
+        gxm::get_height(texture),
+        texture.mip_count,
+        static_cast<uint32_t>(texture.texture_type()),
+        static_cast<uint32_t>(backend),
+    };
+    return XXH3_64bits_withSeed(Ptr<const uint8_t>(texture.data_addr << 2).get(mem), gxm::texture_size_full(texture), hash_data(&parameters, sizeof(parameters)));
+}
+
+// size of the pixels given by decode_texture for a mip
+static size_t get_decoded_size(SceGxmTextureBaseFormat base_format, uint32_t pixels_per_stride, uint32_t height) {
+    if (gxm::is_bcn_format(base_format))
+        return get_compressed_size(base_format, pixels_per_stride, height);
+
+    return static_cast<size_t>(pixels_per_stride) * height * ((gxm::bits_per_pixel(base_format) + 7) >> 3);
+}
+
+// does upload_texture need to convert or linearize the texture before sending it
+static bool needs_cpu_decode(const SceGxmTexture &texture) {
+    const SceGxmTextureType texture_type = texture.texture_type();
+    if (texture_type != SCE_GXM_TEXTURE_LINEAR && texture_type != SCE_GXM_TEXTURE_LINEAR_STRIDED)
+        return true;
+
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(texture));
+    switch (base_format) {
+    case SCE_GXM_TEXTURE_BASE_FORMAT_P4:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_P8:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_U8U3U3U2:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_SE5M9M9M9:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_U2F10F10F10:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_X8U24:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_F32M:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P2:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_YUV422:
+        return true;
+    default:
+        return gxm::is_pvrt_format(base_format);
+    }
+}
+
+// linear textures with a single mip and a format which is uploaded as is can be partially updated
+static bool supports_row_upload(const SceGxmTexture &texture) {
+    if (needs_cpu_decode(texture) || texture.true_mip_count() > 1)
+        return false;
+
+    return !gxm::is_block_compressed_format(gxm::get_base_format(gxm::get_format(texture)));
+}
+
+// the decoded size of SE5M9M9M9 on OpenGL does not match its format
+static bool supports_async_decode(const SceGxmTexture &texture) {
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(texture));
+    return needs_cpu_decode(texture) && base_format != SCE_GXM_TEXTURE_BASE_FORMAT_SE5M9M9M9 && base_format != SCE_GXM_TEXTURE_BASE_FORMAT_YUV422;
+}
+
+static void add_dirty_range(TextureCacheInfo &info, Address begin, Address end) {
+    if (info.dirty_begin == info.dirty_end) {
+        info.dirty_begin = begin;
+        info.dirty_end = end;
+    } else {
+        info.dirty_begin = std::min(info.dirty_begin, begin);
+        info.dirty_end = std::max(info.dirty_end, end);
+    }
+}
+
+// hash the first mip page by page, pages whose hash changed since the last call are added to the dirty range
+static uint64_t hash_texture_pages(const SceGxmTexture &texture, TextureCacheInfo &info, const MemState &mem) {
+    const Address texture_begin = texture.data_addr << 2;
+    if (texture_begin == 0)
+        return 0;
+
+    const uint8_t *data = Ptr<const uint8_t>(texture_begin).get(mem);
+    const uint32_t page_count = (info.texture_size + mem.page_size - 1) / mem.page_size;
+    const bool first_hash = info.page_hashes.size() != page_count;
+    info.page_hashes.resize(page_count);
+
+    for (uint32_t page = 0; page < page_count; page++) {
+        const uint32_t offset = page * mem.page_size;
+        const uint32_t size = std::min(mem.page_size, info.texture_size - offset);
+        const uint64_t page_hash = hash_data(data + offset, size);
+        if (!first_hash && page_hash != info.page_hashes[page])
+            add_dirty_range(info, texture_begin + offset, texture_begin + offset + size);
+
+        info.page_hashes[page] = page_hash;
+    }
+
+    return hash_data(info.page_hashes.data(), page_count * sizeof(uint64_t));
+}
+
 // Function to hash an arbitrary swizzled texture in the most optimized way possible
 // this is a recursive function which calls itself on the 4 higher block making the sizzle
 // once a block entirely in the swizzle is found, it stops and hash it
@@ -289,6 +390,32 @@ uint16_t get_upload_mip(const uint16_t true_mip, const uint16_t width, const uin
     uint16_t max_mip_text = std::bit_width(std::min(width, height));
     return std::min(true_mip, max_mip_text);
 }
+
+// estimate of the host memory used by the texture once uploaded
+static uint32_t get_host_texture_size(const SceGxmTexture &gxm_texture) {
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(gxm_texture));
+    const uint32_t width = gxm::get_width(gxm_texture);
+    const uint32_t height = gxm::get_height(gxm_texture);
+
+    uint64_t size;
+    if (gxm::is_bcn_format(base_format))
+        size = get_compressed_size(base_format, width, height);
+    else {
+        uint32_t bpp = gxm::bits_per_pixel(base_format);
+        // pvrt textures are decompressed and 24-bit textures get an alpha channel
+        if (gxm::is_block_compressed_format(base_format) || bpp == 24)
+            bpp = 32;
+        size = static_cast<uint64_t>(width) * height * bpp / 8;
+    }
+
+    if (get_upload_mip(gxm_texture.true_mip_count(), width, height) > 1)
+        // the mips take a third of the base memory
+        size += size / 3;
+    if (gxm_texture.texture_type() == SCE_GXM_TEXTURE_CUBE || gxm_texture.texture_type() == SCE_GXM_TEXTURE_CUBE_ARBITRARY)
+        size *= 6;
+
+    return static_cast<uint32_t>(std::min<uint64_t>(size, UINT32_MAX));
+}
 } // namespace texture
 
 using namespace texture;
@@ -323,9 +450,161 @@ bool TextureCache::init(const bool hashless_texture_cache, const fs::path &textu
     return true;
 }
 
+void TextureCache::set_memory_budget(uint64_t budget) {
+    memory_budget = budget;
+    stats.memory_budget = budget;
+}
+
+void TextureCache::open_disk_cache(const fs::path &folder) {
+    if (!disk_cache)
+        disk_cache = std::make_unique<TextureDiskCache>();
+    if (!disk_cache->open(folder))
+        disk_cache.reset();
+}
+
+void TextureCache::free_texture(TextureCacheInfo &info) {
+    for (auto &unit : bind_cache) {
+        for (TextureBindCacheEntry &entry : unit) {
+            if (entry.info == &info)
+                entry.info = nullptr;
+        }
+    }
+    texture_lookup.erase(std::bit_cast<TextureGxmDataRepr>(info.texture));
+    memory_used -= info.memory_size;
+    info.memory_size = 0;
+    info.texture_size = 0;
+    info.page_hashes.clear();
+    info.pending_decode.reset();
+    info.pending_import.reset();
+    stats.evictions++;
+}
+
+void TextureCache::evict_textures(const TextureCacheInfo &keep, uint64_t new_size) {
+    if (memory_budget == 0)
+        return;
+
+    // start from the least recently used texture and go towards the most recently used one
+    lru::Item<TextureCacheInfo> *item = texture_queue.head->prev;
+    for (size_t i = 0; i < TextureCacheSize && memory_used + new_size > memory_budget; i++) {
+        lru::Item<TextureCacheInfo> *next = item->prev;
+        TextureCacheInfo &info = item->content;
+        if (&info != &keep && info.texture_size > 0) {
+            free_texture(info);
+            release_texture(info.index);
+            // the slot can be used right away by the next texture
+            texture_queue.set_as_lru(&info);
+        }
+        item = next;
+    }
+}
+
+// are the pixels of the second mip, up to a rounding error, the average of 2x2 pixels of the first one
+// both mips are in the u8u8u8u8 format
+static bool is_box_filtered_mip(const uint8_t *base, uint32_t base_stride, const uint8_t *mip, uint32_t mip_width, uint32_t mip_height, uint32_t mip_stride) {
+    constexpr int tolerance = 2;
+    for (uint32_t y = 0; y < mip_height; y++) {
+        const uint8_t *row0 = base + (2 * y) * base_stride * 4;
+        const uint8_t *row1 = row0 + base_stride * 4;
+        const uint8_t *mip_row = mip + y * mip_stride * 4;
+        for (uint32_t x = 0; x < mip_width * 4; x++) {
+            const uint32_t channel = x % 4;
+            const uint32_t base_x = (x - channel) * 2 + channel;
+            const int average = (row0[base_x] + row0[base_x + 4] + row1[base_x] + row1[base_x + 4] + 2) / 4;
+            if (std::abs(average - mip_row[x]) > tolerance)
+                return false;
+        }
+    }
+    return true;
+}
+
 void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &mem) {
     R_PROFILE(__func__);
 
+    if (uses_gpu_decode(gxm_texture)) {
+        const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(gxm_texture));
+        const bool is_paletted = (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P4 || base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8);
+        current_palette = is_paletted ? get_texture_palette(gxm_texture, mem) : nullptr;
+        decode_texture(
+            gxm_texture, mem, [&](SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height) {
+                upload_guest_layout_impl(base_format, width, height, mip_index, pixels, face, pixels_per_stride, memory_height);
+            },
+            true);
+        return;
+    }
+
+    // the mips of a texture are checked the first time it is uploaded, then only its base level is uploaded if they are a box filter
+    bool check_mips = false;
+    if (use_mipmap_generation && !export_textures && supports_mipmap_generation(gxm_texture)
+        && get_upload_mip(gxm_texture.true_mip_count(), gxm::get_width(gxm_texture), gxm::get_height(gxm_texture)) > 1) {
+        const auto it = box_filtered_mips.find(std::bit_cast<TextureGxmDataRepr>(gxm_texture));
+        if (it == box_filtered_mips.end())
+            check_mips = true;
+        else
+            generate_mips = it->second;
+    }
+
+    // copy of the base level of the first face while checking the mips
+    std::vector<uint8_t> base_level;
+    uint32_t base_stride = 0;
+    bool is_box_filtered = check_mips;
+    bool is_mip_checked = false;
+    decode_texture(
+        gxm_texture, mem, [&](SceGxmTextureBaseFormat upload_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height) {
+            if (is_box_filtered && face <= 1 && mip_index <= 1) {
+                if (upload_format != SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8 || (mip_index == 0 && (width % 2 != 0 || height % 2 != 0))) {
+                    is_box_filtered = false;
+                } else if (mip_index == 0) {
+                    const uint8_t *pixel_bytes = static_cast<const uint8_t *>(pixels);
+                    base_level.assign(pixel_bytes, pixel_bytes + static_cast<size_t>(pixels_per_stride) * height * 4);
+                    base_stride = pixels_per_stride;
+                } else {
+                    is_box_filtered = is_box_filtered_mip(base_level.data(), base_stride, static_cast<const uint8_t *>(pixels), width, height, pixels_per_stride);
+                    is_mip_checked = true;
+                }
+            }
+
+            upload_texture_impl(upload_format, width, height, mip_index, pixels, face, pixels_per_stride, 0);
+            if (export_textures)
+                export_texture_impl(upload_format, width, height, mip_index, pixels, face, pixels_per_stride);
+        },
+        false, generate_mips);
+
+    if (check_mips)
+        box_filtered_mips[std::bit_cast<TextureGxmDataRepr>(gxm_texture)] = is_box_filtered && is_mip_checked;
+}
+
+void TextureCache::decode_texture(const SceGxmTexture &gxm_texture, const MemState &mem, const TextureDecodedFunc &on_decoded, bool keep_guest_layout, bool base_level_only) const {
+    // only the pvrtc decode is slow enough to be worth reading the texture from the disk
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(gxm_texture));
+    if (!disk_cache || keep_guest_layout || !gxm::is_pvrt_format(base_format) || gxm_texture.data_addr == 0) {
+        decode_texture_impl(gxm_texture, mem, on_decoded, keep_guest_layout, base_level_only);
+        return;
+    }
+
+    const uint64_t hash = hash_decoded_texture(gxm_texture, backend, mem);
+    if (disk_cache->read(hash, on_decoded, base_level_only))
+        return;
+
+    // the disk cache only holds complete textures
+    if (base_level_only) {
+        decode_texture_impl(gxm_texture, mem, on_decoded, false, true);
+        return;
+    }
+
+    std::vector<DecodedTextureMip> mips;
+    decode_texture_impl(
+        gxm_texture, mem, [&](SceGxmTextureBaseFormat upload_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height) {
+            const uint8_t *pixel_bytes = static_cast<const uint8_t *>(pixels);
+            const size_t size = get_decoded_size(upload_format, pixels_per_stride, height);
+            mips.push_back({ upload_format, width, height, mip_index, face, pixels_per_stride, std::vector<uint8_t>(pixel_bytes, pixel_bytes + size) });
+            on_decoded(upload_format, width, height, mip_index, pixels, face, pixels_per_stride, memory_height);
+        },
+        false, false);
+    if (!mips.empty())
+        disk_cache->write(hash, mips);
+}
+
+void TextureCache::decode_texture_impl(const SceGxmTexture &gxm_texture, const MemState &mem, const TextureDecodedFunc &on_decoded, bool keep_guest_layout, bool base_level_only) const {
     bool is_vulkan = (backend == renderer::Backend::Vulkan);
 
     const SceGxmTextureFormat fmt = gxm::get_format(gxm_texture);
@@ -419,6 +698,7 @@ void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &me
 
     while (face_uploaded_count < face_total_count && org_width > 0 && org_height > 0) {
         pixels = texture_data;
+        const bool skip_mip = base_level_only && mip_index > 0;
 
         SceGxmTextureBaseFormat upload_format = base_format;
         uint32_t memory_height = height;
@@ -442,118 +722,120 @@ void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &me
         pixels_per_stride = align(pixels_per_stride, align_width);
         memory_height = align(memory_height, align_height);
 
-        // perform all needed conversions (formats not supported by modern GPUs)
-        switch (base_format) {
-        case SCE_GXM_TEXTURE_BASE_FORMAT_P4:
-        case SCE_GXM_TEXTURE_BASE_FORMAT_P8:
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
-            if (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
-                palette_texture_to_rgba_8(reinterpret_cast<uint32_t *>(texture_data_decompressed.data()),
-                    reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height, get_texture_palette(gxm_texture, mem));
-            } else {
-                palette_texture_to_rgba_4(reinterpret_cast<uint32_t *>(texture_data_decompressed.data()),
-                    reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height, get_texture_palette(gxm_texture, mem));
-            }
-            pixels = texture_data_decompressed.data();
-            bytes_per_pixel = 4;
-            bpp = 32;
-            upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
-            break;
-        case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP:
-        case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP:
-        case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP:
-        case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP:
-            if (!is_swizzled)
-                LOG_ERROR_ONCE("Unhandled non-swizzled PVRT format, please report it to the developers");
-
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
-            // this actually also unswizzles the texture
-            decompress_compressed_texture(base_format, texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
-            bytes_per_pixel = 4;
-            bpp = 32;
-            upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
-            pixels = texture_data_decompressed.data();
-            break;
-        case SCE_GXM_TEXTURE_BASE_FORMAT_U8U3U3U2:
-            // Convert U8U3U3U2 to U8U8U8U8
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
-            convert_U8U3U3U2_to_U8U8U8U8(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
-            pixels = texture_data_decompressed.data();
-            upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
-            bpp = 32;
-            break;
-        case SCE_GXM_TEXTURE_BASE_FORMAT_SE5M9M9M9:
-            // this format is supported on all GPUs with vulkan
-            if (is_vulkan)
+        // the backend linearizes and decompresses the texture itself when keeping the guest layout
+        if (!keep_guest_layout && !skip_mip) {
+            // perform all needed conversions (formats not supported by modern GPUs)
+            switch (base_format) {
+            case SCE_GXM_TEXTURE_BASE_FORMAT_P4:
+            case SCE_GXM_TEXTURE_BASE_FORMAT_P8:
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
+                if (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
+                    palette_texture_to_rgba_8(reinterpret_cast<uint32_t *>(texture_data_decompressed.data()),
+                        reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height, get_texture_palette(gxm_texture, mem));
+                } else {
+                    palette_texture_to_rgba_4(reinterpret_cast<uint32_t *>(texture_data_decompressed.data()),
+                        reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height, get_texture_palette(gxm_texture, mem));
+                }
+                pixels = texture_data_decompressed.data();
+                bytes_per_pixel = 4;
+                bpp = 32;
+                upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
                 break;
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 6);
-            decompress_packed_float_e5m9m9m9(base_format, texture_data_decompressed.data(), pixels, width, memory_height);
-            pixels = texture_data_decompressed.data();
-            break;
-        case SCE_GXM_TEXTURE_BASE_FORMAT_U2F10F10F10:
-            // don't change what openGL is doing (which is completely wrong)
-            if (!is_vulkan)
+            case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP:
+            case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP:
+            case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP:
+            case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP:
+                if (!is_swizzled)
+                    LOG_ERROR_ONCE("Unhandled non-swizzled PVRT format, please report it to the developers");
+
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
+                // this actually also unswizzles the texture
+                decompress_compressed_texture(base_format, texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
+                bytes_per_pixel = 4;
+                bpp = 32;
+                upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
+                pixels = texture_data_decompressed.data();
                 break;
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 8);
-            convert_u2f10f10f10_to_f16f16f16f16(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height, fmt);
-            pixels = texture_data_decompressed.data();
-            upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_F16F16F16F16;
-            break;
-        case SCE_GXM_TEXTURE_BASE_FORMAT_X8U24:
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
-            if (is_vulkan) {
-                // d24_u8 or x8_d24 is not supported on all GPUs (thanks AMD)
-                convert_x8u24_to_f32(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height, fmt);
+            case SCE_GXM_TEXTURE_BASE_FORMAT_U8U3U3U2:
+                // Convert U8U3U3U2 to U8U8U8U8
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
+                convert_U8U3U3U2_to_U8U8U8U8(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
+                pixels = texture_data_decompressed.data();
+                upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
+                bpp = 32;
+                break;
+            case SCE_GXM_TEXTURE_BASE_FORMAT_SE5M9M9M9:
+                // this format is supported on all GPUs with vulkan
+                if (is_vulkan)
+                    break;
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 6);
+                decompress_packed_float_e5m9m9m9(base_format, texture_data_decompressed.data(), pixels, width, memory_height);
+                pixels = texture_data_decompressed.data();
+                break;
+            case SCE_GXM_TEXTURE_BASE_FORMAT_U2F10F10F10:
+                // don't change what openGL is doing (which is completely wrong)
+                if (!is_vulkan)
+                    break;
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 8);
+                convert_u2f10f10f10_to_f16f16f16f16(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height, fmt);
+                pixels = texture_data_decompressed.data();
+                upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_F16F16F16F16;
+                break;
+            case SCE_GXM_TEXTURE_BASE_FORMAT_X8U24:
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
+                if (is_vulkan) {
+                    // d24_u8 or x8_d24 is not supported on all GPUs (thanks AMD)
+                    convert_x8u24_to_f32(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height, fmt);
+                    upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_F32;
+                } else {
+                    // X8 = [24-31], D24 = [0-23], technically this is GL_UNSIGNED_INT_24_8_REV which does not exist
+                    // TODO: Requires shader to convert the normalized value read by GL to unsigned int. Just multiply by 2^24-1 when reading and you're done.
+                    // TODO: this is wrong, the depth is in the upper or lower 24 bits according to the swizzle
+                    convert_x8u24_to_u24x8(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
+                }
+                pixels = texture_data_decompressed.data();
+                break;
+            case SCE_GXM_TEXTURE_BASE_FORMAT_F32M:
+                // Convert F32M to F32
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
+                convert_f32m_to_f32(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
+                pixels = texture_data_decompressed.data();
                 upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_F32;
-            } else {
-                // X8 = [24-31], D24 = [0-23], technically this is GL_UNSIGNED_INT_24_8_REV which does not exist
-                // TODO: Requires shader to convert the normalized value read by GL to unsigned int. Just multiply by 2^24-1 when reading and you're done.
-                // TODO: this is wrong, the depth is in the upper or lower 24 bits according to the swizzle
-                convert_x8u24_to_u24x8(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
+                break;
+            case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P2:
+            case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3:
+                texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
+                yuv420_texture_to_rgb(texture_data_decompressed.data(),
+                    reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height, layout_width, layout_height,
+                    base_format == SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3);
+                pixels = texture_data_decompressed.data();
+                bpp = 32;
+                upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
+                break;
+            default:
+                break;
             }
-            pixels = texture_data_decompressed.data();
-            break;
-        case SCE_GXM_TEXTURE_BASE_FORMAT_F32M:
-            // Convert F32M to F32
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
-            convert_f32m_to_f32(texture_data_decompressed.data(), pixels, pixels_per_stride, memory_height);
-            pixels = texture_data_decompressed.data();
-            upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_F32;
-            break;
-        case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P2:
-        case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3:
-            texture_data_decompressed.resize(pixels_per_stride * memory_height * 4);
-            yuv420_texture_to_rgb(texture_data_decompressed.data(),
-                reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height, layout_width, layout_height,
-                base_format == SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3);
-            pixels = texture_data_decompressed.data();
-            bpp = 32;
-            upload_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8;
-            break;
-        default:
-            break;
-        }
 
-        if (texture_type != SCE_GXM_TEXTURE_LINEAR && texture_type != SCE_GXM_TEXTURE_LINEAR_STRIDED && !gxm::is_pvrt_format(base_format)) {
-            // Convert data to linear layout
-            texture_pixels_lineared.resize(pixels_per_stride * memory_height * bytes_per_pixel);
-
-            if (is_swizzled && gxm::is_bcn_format(base_format))
-                // just unswizzle the blocks
-                resolve_z_order_compressed_texture(base_format, texture_pixels_lineared.data(), pixels, pixels_per_stride, memory_height);
-            else if (is_swizzled)
-                swizzled_texture_to_linear_texture(texture_pixels_lineared.data(), reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height,
-                    static_cast<std::uint8_t>(bpp));
-            else
-                tiled_texture_to_linear_texture(texture_pixels_lineared.data(), reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height,
-                    static_cast<std::uint8_t>(bpp));
-
-            pixels = texture_pixels_lineared.data();
+            if (texture_type != SCE_GXM_TEXTURE_LINEAR && texture_type != SCE_GXM_TEXTURE_LINEAR_STRIDED && !gxm::is_pvrt_format(base_format)) {
+                // Convert data to linear layout
+                texture_pixels_lineared.resize(pixels_per_stride * memory_height * bytes_per_pixel);
+
+                if (is_swizzled && gxm::is_bcn_format(base_format))
+                    // just unswizzle the blocks
+                    resolve_z_order_compressed_texture(base_format, texture_pixels_lineared.data(), pixels, pixels_per_stride, memory_height);
+                else if (is_swizzled)
+                    swizzled_texture_to_linear_texture(texture_pixels_lineared.data(), reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height,
+                        static_cast<std::uint8_t>(bpp));
+                else
+                    tiled_texture_to_linear_texture(texture_pixels_lineared.data(), reinterpret_cast<const uint8_t *>(pixels), pixels_per_stride, memory_height,
+                        static_cast<std::uint8_t>(bpp));
+
+                pixels = texture_pixels_lineared.data();
+            }
         }
 
-        upload_texture_impl(upload_format, width, height, mip_index, pixels, upload_type, pixels_per_stride);
-        if (export_textures)
-            export_texture_impl(upload_format, width, height, mip_index, pixels, upload_type, pixels_per_stride);
+        if (!skip_mip)
+            on_decoded(upload_format, width, height, mip_index, pixels, upload_type, pixels_per_stride, memory_height);
 
         const uint32_t nb_pixels = align(layout_width, align_width) * align(layout_height, align_height);
         const uint32_t mip_size = (nb_pixels >> block_shift) * block_size;
@@ -597,6 +879,87 @@ void TextureCache::upload_texture(const SceGxmTexture &gxm_texture, MemState &me
     }
 }
 
+void TextureCache::upload_texture_rows(const SceGxmTexture &gxm_texture, Address dirty_begin, Address dirty_end, MemState &mem) {
+    R_PROFILE(__func__);
+
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(gxm_texture));
+    const uint32_t width = gxm::get_width(gxm_texture);
+    const uint32_t height = gxm::get_height(gxm_texture);
+    const uint32_t bytes_per_pixel = gxm::bits_per_pixel(base_format) >> 3;
+
+    // same layout as the one used by upload_texture
+    uint32_t pixels_per_stride;
+    if (gxm_texture.texture_type() == SCE_GXM_TEXTURE_LINEAR_STRIDED)
+        pixels_per_stride = gxm::get_stride_in_bytes(gxm_texture) / bytes_per_pixel;
+    else
+        pixels_per_stride = align(width, 8);
+    const uint32_t stride_in_bytes = pixels_per_stride * bytes_per_pixel;
+
+    const Address texture_begin = gxm_texture.data_addr << 2;
+    const uint32_t row_begin = (std::max(dirty_begin, texture_begin) - texture_begin) / stride_in_bytes;
+    const uint32_t row_end = std::min(height, (dirty_end - texture_begin + stride_in_bytes - 1) / stride_in_bytes);
+    if (row_begin >= row_end)
+        return;
+
+    const uint8_t *pixels = Ptr<const uint8_t>(texture_begin).get(mem) + row_begin * stride_in_bytes;
+
+    partial_upload = true;
+    upload_texture_impl(base_format, width, row_end - row_begin, 0, pixels, 0, pixels_per_stride, row_begin);
+    partial_upload = false;
+}
+
+TextureCache::~TextureCache() {
+    decode_queue.abort();
+    for (std::thread &worker : decode_workers)
+        worker.join();
+
+    import_queue.abort();
+    if (import_thread.joinable())
+        import_thread.join();
+}
+
+void TextureCache::start_decode_workers(const MemState &mem) {
+    use_async_decode = true;
+    if (!decode_workers.empty())
+        return;
+
+    const int nb_workers = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 4, 1, 4);
+    LOG_INFO("Decoding textures asynchronously with {} threads", nb_workers);
+    for (int i = 0; i < nb_workers; i++)
+        decode_workers.emplace_back(&TextureCache::decode_worker, this, std::cref(mem));
+}
+
+void TextureCache::decode_worker(const MemState &mem) {
+    while (true) {
+        // only returns nothing once the queue is aborted
+        const std::unique_ptr<std::shared_ptr<TextureDecodeRequest>> item = decode_queue.pop();
+        if (!item)
+            break;
+
+        TextureDecodeRequest &request = **item;
+        decode_texture(request.texture, mem, [&](SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height, uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height) {
+            const size_t size = get_decoded_size(base_format, pixels_per_stride, height);
+            const uint8_t *pixel_bytes = static_cast<const uint8_t *>(pixels);
+            request.mips.push_back({ base_format, width, height, mip_index, face, pixels_per_stride, std::vector<uint8_t>(pixel_bytes, pixel_bytes + size) });
+        });
+        request.done.store(true, std::memory_order_release);
+    }
+}
+
+void TextureCache::queue_texture_decode(TextureCacheInfo &info, const SceGxmTexture &gxm_texture) {
+    // a previous request still running is simply dropped once it is done
+    info.pending_decode = std::make_shared<TextureDecodeRequest>();
+    info.pending_decode->texture = gxm_texture;
+    decode_queue.push(info.pending_decode);
+}
+
+void TextureCache::upload_decoded_texture(const TextureDecodeRequest &request) {
+    R_PROFILE(__func__);
+
+    for (const DecodedTextureMip &mip : request.mips)
+        upload_texture_impl(mip.base_format, mip.width, mip.height, mip.mip_index, mip.pixels.data(), mip.face, mip.pixels_per_stride, 0);
+}
+
 // remove everything related to the sampler state
 static constexpr TextureGxmDataRepr default_texture_mask = {
     0x981E0000,
@@ -611,26 +974,40 @@ static constexpr TextureGxmDataRepr strided_texture_mask = {
     0xF3FFFFFF
 };
 
-void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemState &mem) {
+void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemState &mem, size_t unit) {
     R_PROFILE(__func__);
+    R_FRAME_TIMER(TextureCache);
 
     size_t index = 0;
     bool configure = false;
     bool upload = false;
 
-    // Try to find GXM texture in cache.
+    // Try to find GXM texture in cache, first in the descriptors last bound to this unit.
     int cached_gxm_texture_index = -1;
-    TextureGxmDataRepr texture_repr = std::bit_cast<TextureGxmDataRepr>(gxm_texture);
-    if (use_sampler_cache) {
-        // remove the sampler state from the representation
-        const TextureGxmDataRepr &mask = (gxm_texture.texture_type() == SCE_GXM_TEXTURE_LINEAR_STRIDED) ? strided_texture_mask : default_texture_mask;
-        for (int i = 0; i < 4; i++)
-            texture_repr[i] &= mask[i];
+    TextureCacheInfo *cached_info = nullptr;
+    // the content was already checked during this scene, it does not need to be hashed again
+    bool checked_in_scene = false;
+    const TextureGxmDataRepr bound_repr = std::bit_cast<TextureGxmDataRepr>(gxm_texture);
+    const uint32_t bind_slot = (gxm_texture.data_addr ^ (gxm_texture.data_addr >> 10)) % TextureBindCacheWays;
+    TextureBindCacheEntry &bind_entry = bind_cache[unit][bind_slot];
+    TextureGxmDataRepr texture_repr = bound_repr;
+    if (bind_entry.info && bind_entry.texture == bound_repr) {
+        cached_info = bind_entry.info;
+        checked_in_scene = bind_entry.scene == scene_index;
+    } else {
+        if (use_sampler_cache) {
+            // remove the sampler state from the representation
+            const TextureGxmDataRepr &mask = (gxm_texture.texture_type() == SCE_GXM_TEXTURE_LINEAR_STRIDED) ? strided_texture_mask : default_texture_mask;
+            for (int i = 0; i < 4; i++)
+                texture_repr[i] &= mask[i];
+        }
+        auto gxm_it = texture_lookup.find(texture_repr);
+        if (gxm_it != texture_lookup.end())
+            // we found the texture in the cache
+            cached_info = gxm_it->second;
     }
-    auto gxm_it = texture_lookup.find(texture_repr);
-    if (gxm_it != texture_lookup.end())
-        // we found the texture in the cache
-        cached_gxm_texture_index = gxm_it->second->index;
+    if (cached_info)
+        cached_gxm_texture_index = cached_info->index;
 
     Address range_protect_begin = 0;
     Address range_protect_end = 0;
@@ -644,10 +1021,18 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
         if (info->texture_size > 0) {
             // Cache is full.
             LOG_WARN_ONCE("Texture cache is full. Starting to replace textures");
-            texture_lookup.erase(std::bit_cast<TextureGxmDataRepr>(info->texture));
+            // the backend reuses the slot, no need to release it
+            free_texture(*info);
         }
+        stats.misses++;
         texture_lookup[texture_repr] = info;
 
+        const uint32_t memory_size = get_host_texture_size(gxm_texture);
+        evict_textures(*info, memory_size);
+        info->memory_size = memory_size;
+        memory_used += memory_size;
+        stats.memory_used = memory_used;
+
         configure = true;
         upload = true;
         // only hash the first mips, assume no game would modify other mips (and faces) without modifying the first one
@@ -655,6 +1040,12 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
         // use the texture_repr representation, it contains everything we need and we can use it to erase the key
         // from texture_lookup later
         info->texture = std::bit_cast<SceGxmTexture>(texture_repr);
+        info->can_upload_rows = supports_row_upload(gxm_texture);
+        info->dirty_begin = 0;
+        info->dirty_end = 0;
+        info->page_hashes.clear();
+        info->pending_decode.reset();
+        info->pending_import.reset();
 
         // To prevent protecting too commonly accessed data that belongs to the page where the texture also resides
         // (for example, uniform buffer value and texture data got mixed, so page faults are triggered too many, it's not always good).
@@ -674,19 +1065,27 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
         if (info->use_hash) {
             if (import_textures || export_textures)
                 info->hash = hash_texture_nostride(gxm_texture, mem);
+            else if (info->can_upload_rows)
+                info->hash = hash_texture_pages(gxm_texture, *info, mem) ^ 1;
             else
                 // the xor 1 is to make sure it won't be the same as hash_texture_nostride
                 info->hash = hash_texture_data(gxm_texture, info->texture_size, mem) ^ 1;
         }
     } else {
         // Texture is cached.
+        stats.hits++;
         index = cached_gxm_texture_index;
-        info = gxm_it->second;
+        info = cached_info;
         configure = false;
-        if (info->use_hash) {
+        if (info->use_hash && checked_in_scene) {
+            // bound again by a later draw of the same scene, the guest can't have changed its content in between
+            upload = false;
+        } else if (info->use_hash) {
             const uint64_t previous_hash = info->hash;
             if (import_textures || export_textures)
                 info->hash = hash_texture_nostride(gxm_texture, mem);
+            else if (info->can_upload_rows)
+                info->hash = hash_texture_pages(gxm_texture, *info, mem) ^ 1;
             else
                 info->hash = hash_texture_data(gxm_texture, info->texture_size, mem) ^ 1;
 
@@ -696,6 +1095,13 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
         }
     }
     current_info = info;
+    bind_entry.texture = bound_repr;
+    bind_entry.info = info;
+    bind_entry.scene = scene_index;
+
+    if (!upload && info->pending_import && info->pending_import->done.load(std::memory_order_acquire))
+        // the replacement texture finished loading since the texture was last uploaded
+        upload = true;
 
     if (gxm_texture.data_addr == 0) {
         upload = false;
@@ -711,7 +1117,8 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
     bool previous_configure = configure;
     if (upload && import_textures) {
         auto it = available_textures_hash.find(info->hash);
-        if (it != available_textures_hash.end()) {
+        // when imported asynchronously, the original texture is used until the replacement is loaded
+        if (it != available_textures_hash.end() && (!use_async_import || is_import_ready(*info, it->second))) {
             importing_texture = true;
             loading_texture = it->second;
             // always configure for replacement texture (although it may have no effect)
@@ -720,17 +1127,28 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
             configure = true;
         }
     }
+    if (!importing_texture && info->pending_import && info->pending_import->done.load(std::memory_order_acquire))
+        // the texture is not imported anymore, don't keep forcing its upload
+        info->pending_import.reset();
 
     if (upload && !importing_texture && info->is_imported)
         configure = true;
 
+    // decode done by a worker thread since the texture was last bound
+    const bool decode_ready = info->pending_decode && info->pending_decode->done.load(std::memory_order_acquire);
+    const bool decode_async = upload && use_async_decode && !importing_texture && !export_textures && supports_async_decode(gxm_texture) && !uses_gpu_decode(gxm_texture);
+
     select(index, gxm_texture);
 
     if (configure) {
         bool need_configure = true;
 
-        if (importing_texture)
+        if (importing_texture) {
             need_configure = !import_configure_texture();
+            if (need_configure)
+                // the replacement texture can't be used
+                import_done();
+        }
 
         if (need_configure) {
             configure_texture(gxm_texture);
@@ -744,25 +1162,48 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
 
         if (importing_texture)
             import_upload_texture();
+        else if (decode_async) {
+            if (configure)
+                upload_placeholder(gxm_texture);
+            queue_texture_decode(*info, gxm_texture);
+        } else if (!configure && !export_textures && info->can_upload_rows && info->dirty_begin < info->dirty_end)
+            // only the rows which were touched need to be sent again
+            upload_texture_rows(gxm_texture, info->dirty_begin, info->dirty_end, mem);
         else
             upload_texture(gxm_texture, mem);
+        if (!decode_async)
+            // a decode still running would now overwrite newer content
+            info->pending_decode.reset();
+        info->dirty_begin = 0;
+        info->dirty_end = 0;
 
         if (!info->use_hash) {
             info->dirty = false;
-            add_protect(mem, range_protect_begin, range_protect_end - range_protect_begin, MemPerm::ReadOnly, [info, gxm_texture](Address, bool) {
-                if (memcmp(&info->texture, &gxm_texture, sizeof(SceGxmTexture)) == 0) {
-                    info->dirty = true;
-                }
+            if (mem.use_write_watch) {
+                info->watch_begin = range_protect_begin;
+                info->watch_size = range_protect_end - range_protect_begin;
+            } else {
+                add_protect(mem, range_protect_begin, range_protect_end - range_protect_begin, MemPerm::ReadOnly, [info, gxm_texture](Address, bool) {
+                    if (memcmp(&info->texture, &gxm_texture, sizeof(SceGxmTexture)) == 0) {
+                        info->dirty = true;
+                    }
 
-                return true;
-            });
+                    return true;
+                });
+            }
         }
 
-        upload_done();
+        // nothing was sent to the texture yet when its decode was only queued
+        if (!decode_async || configure)
+            upload_done();
         if (export_textures && !importing_texture)
             export_done();
         if (importing_texture)
             import_done();
+    } else if (decode_ready) {
+        upload_decoded_texture(*info->pending_decode);
+        upload_done();
+        info->pending_decode.reset();
     }
     importing_texture = false;
 
@@ -774,7 +1215,32 @@ void TextureCache::cache_and_bind_texture(const SceGxmTexture &gxm_texture, MemS
         cache_and_bind_sampler(gxm_texture);
 }
 
+void TextureCache::refresh_dirty_textures(MemState &mem) {
+    R_PROFILE(__func__);
+    R_FRAME_TIMER(TextureCache);
+
+    if (!use_protect)
+        return;
+
+    for (const auto &[_, info] : texture_lookup) {
+        if (!info->use_hash && !info->dirty && info->watch_size > 0 && was_written(mem, info->watch_begin, info->watch_size)) {
+            info->dirty = true;
+            if (!info->can_upload_rows)
+                continue;
+
+            // find back which pages were written to
+            for (Address page = info->watch_begin; page < info->watch_begin + info->watch_size; page += mem.page_size) {
+                if (was_written(mem, page, mem.page_size))
+                    add_dirty_range(*info, page, page + mem.page_size);
+            }
+        }
+    }
+    // writes done from now on will be seen at the next scene boundary
+    reset_write_watch(mem);
+}
+
 int TextureCache::cache_and_bind_sampler(const SceGxmTexture &gxm_texture) {
+    R_FRAME_TIMER(TextureCache);
     uint32_t compact_repr = 0;
     if (gxm_texture.texture_type() != SCE_GXM_TEXTURE_LINEAR_STRIDED) {
         compact_repr = 0b01
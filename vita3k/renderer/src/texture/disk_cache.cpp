@@ -0,0 +1,191 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <renderer/texture_disk_cache.h>
+
+#include <util/align.h>
+#include <util/log.h>
+
+#include <cstring>
+
+namespace renderer {
+
+// textures stop being added past this size, the file is recreated when its version changes
+static constexpr uint64_t MAX_FILE_SIZE = 2ULL * 1024 * 1024 * 1024;
+
+uint64_t TextureDiskCache::read_index() {
+    TextureDiskCacheHeader header;
+    if (file.size() < sizeof(header))
+        return 0;
+
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, TextureDiskCacheMagic, sizeof(TextureDiskCacheMagic)) != 0 || header.version != TextureDiskCacheVersion)
+        return 0;
+
+    uint64_t offset = sizeof(header);
+    while (offset + sizeof(TextureDiskCacheRecord) <= file.size()) {
+        TextureDiskCacheRecord record;
+        memcpy(&record, file.data() + offset, sizeof(record));
+        const uint64_t record_end = offset + sizeof(record) + record.data_size;
+        const uint64_t mips_size = static_cast<uint64_t>(record.mip_count) * sizeof(TextureDiskCacheMip);
+        if (record_end > file.size() || mips_size > record.data_size)
+            break;
+
+        // the pixels of each mip must be inside the record
+        const TextureDiskCacheMip *mips = reinterpret_cast<const TextureDiskCacheMip *>(file.data() + offset + sizeof(record));
+        uint64_t pixels_size = 0;
+        for (uint32_t i = 0; i < record.mip_count; i++)
+            pixels_size += align(static_cast<uint64_t>(mips[i].size), TextureDiskCacheAlignment);
+        if (mips_size + pixels_size != record.data_size)
+            break;
+
+        index[record.hash] = { mips, record.mip_count };
+        offset = record_end;
+    }
+
+    return offset;
+}
+
+bool TextureDiskCache::open(const fs::path &folder) {
+    std::lock_guard<std::mutex> guard(mutex);
+    append_stream.close();
+    file.close();
+    index.clear();
+    written.clear();
+
+    const fs::path path = folder / TextureDiskCacheFileName;
+    try {
+        fs::create_directories(folder);
+
+        file_size = file.open(path) ? read_index() : 0;
+        if (file_size == 0) {
+            if (file.is_open())
+                LOG_WARN("Texture disk cache {} is invalid or outdated, recreating it", path.string());
+            file.close();
+            index.clear();
+
+            fs::ofstream new_file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            TextureDiskCacheHeader header{};
+            memcpy(header.magic, TextureDiskCacheMagic, sizeof(TextureDiskCacheMagic));
+            header.version = TextureDiskCacheVersion;
+            new_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file_size = sizeof(header);
+        } else if (file_size < file.size()) {
+            // the last texture was not completely written, cut it so that the next appended ones can be read
+            LOG_WARN("Texture disk cache {} ends with an incomplete texture, dropping it", path.string());
+            file.close();
+            index.clear();
+            fs::resize_file(path, file_size);
+            file.open(path);
+            read_index();
+        }
+    } catch (std::exception &e) {
+        LOG_ERROR("Failed to open texture disk cache {}: {}", path.string(), e.what());
+        file.close();
+        index.clear();
+        return false;
+    }
+
+    append_stream.open(path, std::ios::out | std::ios::binary | std::ios::app);
+    if (!append_stream.is_open()) {
+        LOG_ERROR("Failed to open texture disk cache {} for writing", path.string());
+        file.close();
+        index.clear();
+        return false;
+    }
+
+    LOG_INFO("Texture disk cache loaded with {} textures ({} MiB)", index.size(), file_size >> 20);
+
+    return true;
+}
+
+void TextureDiskCache::close() {
+    std::lock_guard<std::mutex> guard(mutex);
+    append_stream.close();
+    file.close();
+    index.clear();
+    written.clear();
+    file_size = 0;
+}
+
+bool TextureDiskCache::read(uint64_t hash, const TextureDecodedFunc &on_decoded, bool base_level_only) const {
+    const auto it = index.find(hash);
+    if (it == index.end())
+        return false;
+
+    const TextureDiskCacheMip *mips = it->second.mips;
+    const uint8_t *pixels = reinterpret_cast<const uint8_t *>(mips + it->second.mip_count);
+    for (uint32_t i = 0; i < it->second.mip_count; i++) {
+        const TextureDiskCacheMip &mip = mips[i];
+        if (!base_level_only || mip.mip_index == 0)
+            on_decoded(static_cast<SceGxmTextureBaseFormat>(mip.base_format), mip.width, mip.height, mip.mip_index, pixels, mip.face, mip.pixels_per_stride, mip.height);
+        pixels += align(static_cast<uint64_t>(mip.size), TextureDiskCacheAlignment);
+    }
+
+    return true;
+}
+
+bool TextureDiskCache::write(uint64_t hash, const std::vector<DecodedTextureMip> &mips) {
+    std::vector<TextureDiskCacheMip> mip_records;
+    mip_records.reserve(mips.size());
+    uint64_t data_size = mips.size() * sizeof(TextureDiskCacheMip);
+    for (const DecodedTextureMip &mip : mips) {
+        mip_records.push_back({ static_cast<uint32_t>(mip.base_format), mip.width, mip.height, mip.mip_index, mip.face, mip.pixels_per_stride, static_cast<uint32_t>(mip.pixels.size()), 0 });
+        data_size += align(static_cast<uint64_t>(mip.pixels.size()), TextureDiskCacheAlignment);
+    }
+    if (data_size > UINT32_MAX)
+        return false;
+
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!append_stream.is_open() || index.contains(hash) || written.contains(hash))
+        return false;
+
+    const uint64_t record_size = sizeof(TextureDiskCacheRecord) + data_size;
+    if (file_size + record_size > MAX_FILE_SIZE) {
+        LOG_WARN_ONCE("Texture disk cache is full, new textures are not added to it anymore");
+        return false;
+    }
+
+    const TextureDiskCacheRecord record{
+        .hash = hash,
+        .mip_count = static_cast<uint32_t>(mips.size()),
+        .data_size = static_cast<uint32_t>(data_size)
+    };
+    const char padding[TextureDiskCacheAlignment] = {};
+    append_stream.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    append_stream.write(reinterpret_cast<const char *>(mip_records.data()), mip_records.size() * sizeof(TextureDiskCacheMip));
+    for (const DecodedTextureMip &mip : mips) {
+        append_stream.write(reinterpret_cast<const char *>(mip.pixels.data()), mip.pixels.size());
+        append_stream.write(padding, align(static_cast<uint64_t>(mip.pixels.size()), TextureDiskCacheAlignment) - mip.pixels.size());
+    }
+    // the record must be complete on the disk even if we crash later
+    append_stream.flush();
+    if (!append_stream) {
+        // the following textures would be behind an incomplete one, stop adding them
+        LOG_ERROR("Failed to write texture {:016X} to the texture disk cache", hash);
+        append_stream.close();
+        return false;
+    }
+
+    file_size += record_size;
+    written.insert(hash);
+
+    return true;
+}
+
+} // namespace renderer
@@ -26,8 +26,22 @@
 #include <renderer/pvrt-dec.h>
 #include <shader/spirv_recompiler.h>
 #include <util/align.h>
+#include <util/instrset_detect.h>
 #include <util/log.h>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#define TEXTURE_SIMD_X64
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((__target__("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TARGET_AVX2
+#include <intrin.h>
+#endif
+#endif
+
 namespace renderer::texture {
 
 bool convert_base_texture_format_to_base_color_format(SceGxmTextureBaseFormat format, SceGxmColorBaseFormat &color_format) {
@@ -178,20 +192,63 @@ void convert_x8u24_to_u24x8(void *dest, const void *data, const uint32_t width,
     }
 }
 
+static void convert_x8u24_to_f32_basic(float *dst, const uint32_t *src, const size_t count, const int shift_amount) {
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t d24 = (src[i] >> shift_amount) & ((1U << 24) - 1);
+        dst[i] = static_cast<float>(d24) / ((1U << 24) - 1);
+    }
+}
+
+#if defined(__aarch64__)
+static void convert_x8u24_to_f32_neon(float *dst, const uint32_t *src, const size_t count, const int shift_amount) {
+    const int32x4_t shift = vdupq_n_s32(-shift_amount);
+    const uint32x4_t mask = vdupq_n_u32((1U << 24) - 1);
+    const float32x4_t max_value = vdupq_n_f32(static_cast<float>((1U << 24) - 1));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint32x4_t d24 = vandq_u32(vshlq_u32(vld1q_u32(src + i), shift), mask);
+        // the division (and not a multiplication by the inverse) keeps the result identical to the scalar version
+        vst1q_f32(dst + i, vdivq_f32(vcvtq_f32_u32(d24), max_value));
+    }
+    convert_x8u24_to_f32_basic(dst + i, src + i, count - i, shift_amount);
+}
+#elif defined(TEXTURE_SIMD_X64)
+static void TARGET_AVX2 convert_x8u24_to_f32_avx2(float *dst, const uint32_t *src, const size_t count, const int shift_amount) {
+    const __m128i shift = _mm_cvtsi32_si128(shift_amount);
+    const __m256i mask = _mm256_set1_epi32((1U << 24) - 1);
+    const __m256 max_value = _mm256_set1_ps(static_cast<float>((1U << 24) - 1));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        const __m256i d24 = _mm256_and_si256(_mm256_srl_epi32(value, shift), mask);
+        // the division (and not a multiplication by the inverse) keeps the result identical to the scalar version
+        _mm256_storeu_ps(dst + i, _mm256_div_ps(_mm256_cvtepi32_ps(d24), max_value));
+    }
+    convert_x8u24_to_f32_basic(dst + i, src + i, count - i, shift_amount);
+}
+#endif
+
+using ConvertX8U24Func = void (*)(float *dst, const uint32_t *src, const size_t count, const int shift_amount);
+
+static ConvertX8U24Func select_convert_x8u24_to_f32() {
+#if defined(__aarch64__)
+    return convert_x8u24_to_f32_neon;
+#elif defined(TEXTURE_SIMD_X64)
+    if (util::instrset::instrset_detect() >= util::instrset::instrset_AVX2)
+        return convert_x8u24_to_f32_avx2;
+#endif
+    return convert_x8u24_to_f32_basic;
+}
+
 void convert_x8u24_to_f32(void *dest, const void *data, const uint32_t width, const uint32_t height, const SceGxmTextureFormat format) {
+    static const ConvertX8U24Func convert_impl = select_convert_x8u24_to_f32();
+
     const SceGxmTextureSwizzle2ModeAlt swizzle = static_cast<SceGxmTextureSwizzle2ModeAlt>(format & SCE_GXM_TEXTURE_SWIZZLE_MASK);
     // is the depth in the upper or lower 24 bits of the data?
     int shift_amount = (swizzle == SCE_GXM_TEXTURE_SWIZZLE2_DS) ? 8 : 0;
-    auto dst = static_cast<float *>(dest);
-    auto src = static_cast<const uint32_t *>(data);
-
-    for (uint32_t row = 0; row < height; ++row) {
-        for (uint32_t col = 0; col < width; ++col) {
-            const uint32_t src_value = src[row * width + height];
-            const uint32_t d24 = (src_value >> shift_amount) & ((1U << 24) - 1);
-            dst[row * width + height] = static_cast<float>(d24) / ((1U << 24) - 1);
-        }
-    }
+    convert_impl(static_cast<float *>(dest), static_cast<const uint32_t *>(data), static_cast<size_t>(width) * height, shift_amount);
 }
 
 void convert_U8U3U3U2_to_U8U8U8U8(void *dest, const void *data, const uint32_t width, const uint32_t height) {
@@ -238,6 +295,105 @@ static uint16_t f10_to_f16(const uint16_t f10) {
     return f16;
 }
 
+static void convert_u2f10f10f10_to_f16f16f16f16_basic(std::array<uint16_t, 4> *dst, const uint32_t *src, const size_t count, const bool is_alpha_upper) {
+    for (size_t pixel = 0; pixel < count; pixel++) {
+        uint32_t src_value = src[pixel];
+        int dst_idx;
+        // first get the 2 alpha bits
+        if (is_alpha_upper) {
+            dst[pixel][3] = (src_value >> 30) / 3.0f;
+            dst_idx = 0;
+        } else {
+            dst[pixel][0] = (src_value & 0b11) / 3.0f;
+            dst_idx = 1;
+            src_value >>= 2;
+        }
+
+        // decode the 3 rgb components
+        for (int i = 0; i < 3; i++) {
+            const uint16_t comp = src_value & ((1 << 10) - 1);
+            src_value >>= 10;
+            dst[pixel][dst_idx++] = f10_to_f16(comp);
+        }
+    }
+}
+
+#if defined(__aarch64__)
+static uint16x4_t f10_to_f16_neon(const uint32x4_t f10) {
+    const uint32x4_t mask = vdupq_n_u32(0b11111);
+    const uint32x4_t exponent = vandq_u32(vshrq_n_u32(f10, 5), mask);
+    const uint32x4_t mantissa = vandq_u32(f10, mask);
+    return vmovn_u32(vorrq_u32(vshlq_n_u32(exponent, 10), vshlq_n_u32(mantissa, 5)));
+}
+
+static void convert_u2f10f10f10_to_f16f16f16f16_simd(std::array<uint16_t, 4> *dst, const uint32_t *src, const size_t count, const bool is_alpha_upper) {
+    const int alpha_shift = is_alpha_upper ? 30 : 0;
+    const int rgb_shift = is_alpha_upper ? 0 : 2;
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x4_t channels[2][4];
+        for (int half = 0; half < 2; half++) {
+            const uint32x4_t value = vld1q_u32(src + i + half * 4);
+            const uint32x4_t rgb = vshlq_u32(value, vdupq_n_s32(-rgb_shift));
+            const uint32x4_t alpha_bits = vshlq_u32(value, vdupq_n_s32(-alpha_shift));
+            // same as the truncation of alpha / 3.0f
+            const uint32x4_t alpha = vandq_u32(vandq_u32(alpha_bits, vshrq_n_u32(alpha_bits, 1)), vdupq_n_u32(1));
+
+            const int first = is_alpha_upper ? 0 : 1;
+            channels[half][first] = f10_to_f16_neon(rgb);
+            channels[half][first + 1] = f10_to_f16_neon(vshrq_n_u32(rgb, 10));
+            channels[half][first + 2] = f10_to_f16_neon(vshrq_n_u32(rgb, 20));
+            channels[half][is_alpha_upper ? 3 : 0] = vmovn_u32(alpha);
+        }
+
+        uint16x8x4_t pixels;
+        for (int c = 0; c < 4; c++)
+            pixels.val[c] = vcombine_u16(channels[0][c], channels[1][c]);
+        vst4q_u16(dst[i].data(), pixels);
+    }
+    convert_u2f10f10f10_to_f16f16f16f16_basic(dst + i, src + i, count - i, is_alpha_upper);
+}
+#elif defined(TEXTURE_SIMD_X64)
+static __m128i f10_to_f16_sse2(const __m128i f10) {
+    const __m128i mask = _mm_set1_epi32(0b11111);
+    const __m128i exponent = _mm_and_si128(_mm_srli_epi32(f10, 5), mask);
+    const __m128i mantissa = _mm_and_si128(f10, mask);
+    return _mm_or_si128(_mm_slli_epi32(exponent, 10), _mm_slli_epi32(mantissa, 5));
+}
+
+static void convert_u2f10f10f10_to_f16f16f16f16_simd(std::array<uint16_t, 4> *dst, const uint32_t *src, const size_t count, const bool is_alpha_upper) {
+    const __m128i alpha_shift = _mm_cvtsi32_si128(is_alpha_upper ? 30 : 0);
+    const __m128i rgb_shift = _mm_cvtsi32_si128(is_alpha_upper ? 0 : 2);
+    const __m128i one = _mm_set1_epi32(1);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i rgb = _mm_srl_epi32(value, rgb_shift);
+        const __m128i alpha_bits = _mm_srl_epi32(value, alpha_shift);
+        // same as the truncation of alpha / 3.0f
+        const __m128i alpha = _mm_and_si128(_mm_and_si128(alpha_bits, _mm_srli_epi32(alpha_bits, 1)), one);
+
+        __m128i channels[4];
+        const int first = is_alpha_upper ? 0 : 1;
+        channels[first] = f10_to_f16_sse2(rgb);
+        channels[first + 1] = f10_to_f16_sse2(_mm_srli_epi32(rgb, 10));
+        channels[first + 2] = f10_to_f16_sse2(_mm_srli_epi32(rgb, 20));
+        channels[is_alpha_upper ? 3 : 0] = alpha;
+
+        // all values fit in 15 bits, signed saturation does not change them
+        const __m128i channels_01 = _mm_packs_epi32(channels[0], channels[1]);
+        const __m128i channels_23 = _mm_packs_epi32(channels[2], channels[3]);
+        const __m128i channels_02 = _mm_unpacklo_epi16(channels_01, channels_23);
+        const __m128i channels_13 = _mm_unpackhi_epi16(channels_01, channels_23);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi16(channels_02, channels_13));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 2), _mm_unpackhi_epi16(channels_02, channels_13));
+    }
+    convert_u2f10f10f10_to_f16f16f16f16_basic(dst + i, src + i, count - i, is_alpha_upper);
+}
+#endif
+
 void convert_u2f10f10f10_to_f16f16f16f16(void *dest, const void *data, const uint32_t width, const uint32_t height, const SceGxmTextureFormat format) {
     auto dst = static_cast<std::array<uint16_t, 4> *>(dest);
     auto src = static_cast<const uint32_t *>(data);
@@ -248,28 +404,13 @@ void convert_u2f10f10f10_to_f16f16f16f16(void *dest, const void *data, const uin
         || format == SCE_GXM_TEXTURE_FORMAT_X2F10F10F10_1BGR
         || format == SCE_GXM_TEXTURE_FORMAT_X2F10F10F10_1RGB);
 
-    for (uint32_t row = 0; row < height; ++row) {
-        for (uint32_t col = 0; col < width; ++col) {
-            uint32_t src_value = src[row * width + height];
-            int dst_idx;
-            // first get the 2 alpha bits
-            if (is_alpha_upper) {
-                dst[row * width + height][3] = (src_value >> 30) / 3.0f;
-                dst_idx = 0;
-            } else {
-                dst[row * width + height][0] = (src_value & 0b11) / 3.0f;
-                dst_idx = 1;
-                src_value >>= 2;
-            }
-
-            // decode the 3 rgb components
-            for (int i = 0; i < 3; i++) {
-                const uint16_t comp = src_value & ((1 << 10) - 1);
-                src_value >>= 10;
-                dst[row * width + height][dst_idx++] = f10_to_f16(comp);
-            }
-        }
-    }
+    const size_t count = static_cast<size_t>(width) * height;
+#if defined(__aarch64__) || defined(TEXTURE_SIMD_X64)
+    // SSE2 and NEON are always available
+    convert_u2f10f10f10_to_f16f16f16f16_simd(dst, src, count, is_alpha_upper);
+#else
+    convert_u2f10f10f10_to_f16f16f16f16_basic(dst, src, count, is_alpha_upper);
+#endif
 }
 
 // Based on this: http://xen.firefly.nu/up/rearrange.c.html
@@ -321,6 +462,77 @@ uint32_t encode_morton(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
     return result;
 }
 
+// position in a 4x4 block of each of its 16 swizzled pixels
+static constexpr uint8_t swizzled_block_x[16] = { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3 };
+static constexpr uint8_t swizzled_block_y[16] = { 0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 0, 1, 2, 3, 2, 3 };
+
+static void copy_swizzled_block_basic(uint8_t *dest, const uint8_t *src, const uint32_t dest_stride, const uint32_t bytes_per_pixel) {
+    for (int i = 0; i < 16; i++)
+        memcpy(dest + swizzled_block_y[i] * dest_stride + swizzled_block_x[i] * bytes_per_pixel, src + i * bytes_per_pixel, bytes_per_pixel);
+}
+
+// row y of the block is made of the pixels (y & 1) + 4 * (y >> 1) + { 0, 2, 8, 10 }
+static void copy_swizzled_block_32(uint8_t *dest, const uint8_t *src, const uint32_t dest_stride) {
+#if defined(__aarch64__)
+    const uint32_t *pixels = reinterpret_cast<const uint32_t *>(src);
+    const uint32x4_t p0 = vld1q_u32(pixels);
+    const uint32x4_t p4 = vld1q_u32(pixels + 4);
+    const uint32x4_t p8 = vld1q_u32(pixels + 8);
+    const uint32x4_t p12 = vld1q_u32(pixels + 12);
+    vst1q_u32(reinterpret_cast<uint32_t *>(dest), vuzp1q_u32(p0, p8));
+    vst1q_u32(reinterpret_cast<uint32_t *>(dest + dest_stride), vuzp2q_u32(p0, p8));
+    vst1q_u32(reinterpret_cast<uint32_t *>(dest + 2 * dest_stride), vuzp1q_u32(p4, p12));
+    vst1q_u32(reinterpret_cast<uint32_t *>(dest + 3 * dest_stride), vuzp2q_u32(p4, p12));
+#elif defined(TEXTURE_SIMD_X64)
+    const __m128 p0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+    const __m128 p4 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16)));
+    const __m128 p8 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32)));
+    const __m128 p12 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_castps_si128(_mm_shuffle_ps(p0, p8, _MM_SHUFFLE(2, 0, 2, 0))));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + dest_stride), _mm_castps_si128(_mm_shuffle_ps(p0, p8, _MM_SHUFFLE(3, 1, 3, 1))));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 2 * dest_stride), _mm_castps_si128(_mm_shuffle_ps(p4, p12, _MM_SHUFFLE(2, 0, 2, 0))));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 3 * dest_stride), _mm_castps_si128(_mm_shuffle_ps(p4, p12, _MM_SHUFFLE(3, 1, 3, 1))));
+#else
+    copy_swizzled_block_basic(dest, src, dest_stride, 4);
+#endif
+}
+
+static void copy_swizzled_block_64(uint8_t *dest, const uint8_t *src, const uint32_t dest_stride) {
+#if defined(__aarch64__)
+    const uint64_t *pixels = reinterpret_cast<const uint64_t *>(src);
+    for (int half = 0; half < 2; half++) {
+        // pixels 0-7 fill the first two rows, pixels 8-15 the last two
+        const uint64_t *rows = pixels + 4 * half;
+        const uint64x2_t left_low = vld1q_u64(rows);
+        const uint64x2_t right_low = vld1q_u64(rows + 8);
+        const uint64x2_t left_high = vld1q_u64(rows + 2);
+        const uint64x2_t right_high = vld1q_u64(rows + 10);
+        uint8_t *row_dest = dest + 2 * half * dest_stride;
+        vst1q_u64(reinterpret_cast<uint64_t *>(row_dest), vzip1q_u64(left_low, left_high));
+        vst1q_u64(reinterpret_cast<uint64_t *>(row_dest + 16), vzip1q_u64(right_low, right_high));
+        vst1q_u64(reinterpret_cast<uint64_t *>(row_dest + dest_stride), vzip2q_u64(left_low, left_high));
+        vst1q_u64(reinterpret_cast<uint64_t *>(row_dest + dest_stride + 16), vzip2q_u64(right_low, right_high));
+    }
+#elif defined(TEXTURE_SIMD_X64)
+    const __m128i *pixels = reinterpret_cast<const __m128i *>(src);
+    for (int half = 0; half < 2; half++) {
+        // pixels 0-7 fill the first two rows, pixels 8-15 the last two
+        const __m128i *rows = pixels + 2 * half;
+        const __m128i left_low = _mm_loadu_si128(rows);
+        const __m128i left_high = _mm_loadu_si128(rows + 1);
+        const __m128i right_low = _mm_loadu_si128(rows + 4);
+        const __m128i right_high = _mm_loadu_si128(rows + 5);
+        uint8_t *row_dest = dest + 2 * half * dest_stride;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row_dest), _mm_unpacklo_epi64(left_low, left_high));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row_dest + 16), _mm_unpacklo_epi64(right_low, right_high));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row_dest + dest_stride), _mm_unpackhi_epi64(left_low, left_high));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row_dest + dest_stride + 16), _mm_unpackhi_epi64(right_low, right_high));
+    }
+#else
+    copy_swizzled_block_basic(dest, src, dest_stride, 8);
+#endif
+}
+
 void swizzled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
     if (bits_per_pixel % 8 != 0) {
         // Don't support yet
@@ -331,7 +543,11 @@ void swizzled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint1
     uint32_t min = std::min(width, height);
     uint32_t k = std::bit_width(min) - 1;
 
-    for (uint32_t i = 0; i < width * static_cast<uint32_t>(height); i++) {
+    // 16 consecutive swizzled pixels always make a 4x4 block, copy them all at once
+    const uint32_t pixels_per_step = (min >= 4) ? 16 : 1;
+    const uint32_t dest_stride = width * bytes_per_pixel;
+
+    for (uint32_t i = 0; i < width * static_cast<uint32_t>(height); i += pixels_per_step) {
         uint32_t x = decode_morton2_x(i) & (min - 1);
         uint32_t y = decode_morton2_y(i) & (min - 1);
         uint32_t upper_bits = (i >> (2 * k)) << k;
@@ -341,7 +557,16 @@ void swizzled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint1
             y |= upper_bits;
         }
 
-        memcpy(dest + (y * width + x) * bytes_per_pixel, src + i * bytes_per_pixel, bytes_per_pixel);
+        uint8_t *block_dest = dest + (y * width + x) * bytes_per_pixel;
+        const uint8_t *block_src = src + i * bytes_per_pixel;
+        if (pixels_per_step == 1)
+            memcpy(block_dest, block_src, bytes_per_pixel);
+        else if (bytes_per_pixel == 4)
+            copy_swizzled_block_32(block_dest, block_src, dest_stride);
+        else if (bytes_per_pixel == 8)
+            copy_swizzled_block_64(block_dest, block_src, dest_stride);
+        else
+            copy_swizzled_block_basic(block_dest, block_src, dest_stride, bytes_per_pixel);
     }
 }
 
@@ -356,15 +581,17 @@ void tiled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t
     const uint32_t width_in_tiles = (width + 31) >> 5;
 
     for (uint16_t y = 0; y < height; y++) {
-        for (uint16_t x = 0; x < width; x++) {
+        // each tile row (up to 32 texels) is contiguous in memory
+        for (uint32_t x = 0; x < width; x += 32) {
             // Calculate texel address in tile
-            const uint32_t texel_offset_in_tile = (x & 0b11111) | ((y & 0b11111) << 5);
+            const uint32_t texel_offset_in_tile = (y & 0b11111) << 5;
             const uint32_t tile_address = (x >> 5) + width_in_tiles * (y >> 5);
 
             const uint32_t offset = ((tile_address << 10) | (texel_offset_in_tile)) * bpp;
+            const uint32_t texels_in_row = std::min<uint32_t>(32, width - x);
 
             // Make scanline
-            memcpy(dest + ((y * width) + x) * bpp, src + offset, bpp);
+            memcpy(dest + ((y * width) + x) * bpp, src + offset, texels_in_row * bpp);
         }
     }
 }
@@ -0,0 +1,217 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/texture_pack.h>
+
+#include <util/align.h>
+#include <util/log.h>
+
+#include <ddspp.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace renderer {
+
+// alignment of the payloads in the file
+static constexpr uint64_t PAYLOAD_ALIGNMENT = 16;
+
+bool TexturePack::open(const fs::path &path) {
+    if (!file.open(path)) {
+        LOG_ERROR("Failed to open texture pack {}", path.string());
+        return false;
+    }
+
+    TexturePackHeader header;
+    if (file.size() < sizeof(header)) {
+        LOG_ERROR("Texture pack {} is too small", path.string());
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (memcmp(header.magic, TexturePackMagic, sizeof(TexturePackMagic)) != 0) {
+        LOG_ERROR("{} is not a texture pack", path.string());
+        return false;
+    }
+    if (header.version != TexturePackVersion) {
+        LOG_ERROR("Texture pack {} has version {}, expected {}", path.string(), header.version, TexturePackVersion);
+        return false;
+    }
+    if (sizeof(header) + static_cast<uint64_t>(header.entry_count) * sizeof(TexturePackEntry) > file.size()) {
+        LOG_ERROR("Texture pack {} is truncated", path.string());
+        return false;
+    }
+
+    entries = reinterpret_cast<const TexturePackEntry *>(file.data() + sizeof(header));
+    count = header.entry_count;
+
+    // find relies on the index being sorted
+    for (uint32_t i = 1; i < count; i++) {
+        if (entries[i - 1].hash >= entries[i].hash) {
+            LOG_ERROR("Texture pack {} has an unsorted index", path.string());
+            entries = nullptr;
+            count = 0;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const TexturePackEntry *TexturePack::find(uint64_t hash) const {
+    const TexturePackEntry *end = entries + count;
+    const TexturePackEntry *it = std::lower_bound(entries, end, hash, [](const TexturePackEntry &entry, uint64_t hash) {
+        return entry.hash < hash;
+    });
+
+    if (it == end || it->hash != hash)
+        return nullptr;
+
+    return it;
+}
+
+const uint8_t *TexturePack::get_content(const TexturePackEntry &entry, std::vector<uint8_t> &buffer) const {
+    if (entry.offset > file.size() || entry.size > file.size() - entry.offset) {
+        LOG_ERROR("Texture {:016X} is outside of its texture pack", entry.hash);
+        return nullptr;
+    }
+
+    const uint8_t *payload = file.data() + entry.offset;
+    if (entry.size == entry.uncompressed_size)
+        return payload;
+
+    buffer.resize(entry.uncompressed_size);
+    mz_ulong dest_bytes = entry.uncompressed_size;
+    if (mz_uncompress(buffer.data(), &dest_bytes, payload, entry.size) != MZ_OK || dest_bytes != entry.uncompressed_size) {
+        LOG_ERROR("Failed to decompress texture {:016X}", entry.hash);
+        return nullptr;
+    }
+
+    return buffer.data();
+}
+
+int create_texture_pack(const fs::path &folder, const fs::path &pack_path, bool use_compression) {
+    if (!fs::exists(folder)) {
+        LOG_ERROR("Folder {} does not exist", folder.string());
+        return -1;
+    }
+
+    std::vector<std::pair<uint64_t, fs::path>> textures;
+    for (const auto &file_entry : fs::directory_iterator(folder)) {
+        const fs::path &file = file_entry.path();
+        if (!fs::is_regular_file(file) || file.extension() != ".dds")
+            continue;
+
+        uint64_t hash;
+        if (sscanf(file.filename().string().c_str(), "%llX", &hash) != 1)
+            continue;
+
+        textures.emplace_back(hash, file);
+    }
+    std::sort(textures.begin(), textures.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+    // the same hash can't be in the index twice
+    textures.erase(std::unique(textures.begin(), textures.end(), [](const auto &a, const auto &b) {
+        return a.first == b.first;
+    }),
+        textures.end());
+
+    // a previous version of the pack may still be mapped, replace it only once the new one is complete
+    fs::path temp_path = pack_path;
+    temp_path += ".tmp";
+    fs::ofstream output(temp_path, std::ios::binary);
+    if (!output) {
+        LOG_ERROR("Failed to create texture pack {}", pack_path.string());
+        return -1;
+    }
+
+    // the index is written once all the payloads are, its space is reserved even for the textures which get skipped
+    std::vector<TexturePackEntry> entries;
+    entries.reserve(textures.size());
+    uint64_t offset = align(sizeof(TexturePackHeader) + textures.size() * sizeof(TexturePackEntry), PAYLOAD_ALIGNMENT);
+    output.seekp(offset);
+
+    std::vector<uint8_t> dds_data;
+    std::vector<uint8_t> compressed;
+    for (const auto &[hash, path] : textures) {
+        fs::ifstream file(path, std::ios::binary | std::ios::ate);
+        const size_t file_size = file.tellg();
+        if (file_size < ddspp::MAX_HEADER_SIZE || file_size > UINT32_MAX) {
+            LOG_WARN("Skipping texture {} with an invalid size", path.string());
+            continue;
+        }
+
+        dds_data.resize(file_size);
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(dds_data.data()), file_size);
+        if (file.gcount() != file_size) {
+            LOG_ERROR("Failed to read {}", path.string());
+            continue;
+        }
+
+        const uint8_t *payload = dds_data.data();
+        uint32_t payload_size = static_cast<uint32_t>(file_size);
+        if (use_compression) {
+            mz_ulong compressed_size = mz_compressBound(static_cast<mz_ulong>(file_size));
+            compressed.resize(compressed_size);
+            // bcn payloads hardly compress, keep them as they are so they can be used from the mapped file
+            if (mz_compress2(compressed.data(), &compressed_size, dds_data.data(), static_cast<mz_ulong>(file_size), MZ_BEST_COMPRESSION) == MZ_OK
+                && compressed_size < file_size - file_size / 8) {
+                payload = compressed.data();
+                payload_size = static_cast<uint32_t>(compressed_size);
+            }
+        }
+
+        output.write(reinterpret_cast<const char *>(payload), payload_size);
+        entries.push_back({ hash, offset, payload_size, static_cast<uint32_t>(file_size) });
+
+        const uint64_t next_offset = align(offset + payload_size, PAYLOAD_ALIGNMENT);
+        const char padding[PAYLOAD_ALIGNMENT] = {};
+        output.write(padding, next_offset - offset - payload_size);
+        offset = next_offset;
+    }
+
+    TexturePackHeader header;
+    memcpy(header.magic, TexturePackMagic, sizeof(TexturePackMagic));
+    header.version = TexturePackVersion;
+    header.entry_count = static_cast<uint32_t>(entries.size());
+
+    output.seekp(0);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(TexturePackEntry));
+    output.close();
+    if (output.fail()) {
+        LOG_ERROR("Failed to write texture pack {}", pack_path.string());
+        fs::remove(temp_path);
+        return -1;
+    }
+
+    boost::system::error_code error;
+    fs::rename(temp_path, pack_path, error);
+    if (error) {
+        LOG_ERROR("Failed to replace texture pack {}: {}", pack_path.string(), error.message());
+        fs::remove(temp_path);
+        return -1;
+    }
+
+    LOG_INFO("Created texture pack {} with {} textures", pack_path.string(), entries.size());
+    return static_cast<int>(entries.size());
+}
+
+} // namespace renderer
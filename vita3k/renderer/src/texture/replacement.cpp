@@ -17,10 +17,12 @@
 
 #include "renderer/functions.h"
 #include "renderer/texture_cache.h"
+#include "renderer/texture_pack.h"
 
 #include "gxm/functions.h"
 #include "util/float_to_half.h"
 #include "util/log.h"
+#include "util/mapped_file.h"
 
 #include <ddspp.h>
 #include <fmt/format.h>
@@ -433,19 +435,134 @@ void TextureCache::export_done() {
     exporting_texture = false;
 }
 
-bool TextureCache::import_configure_texture() {
-    uint64_t hash = current_info->hash;
-    const std::string file_name = fmt::format("{:016X}.{}", hash, loading_texture.is_dds ? "dds" : "png");
-    fs::path import_name = *loading_texture.folder_path / file_name;
+const uint8_t *TextureImportRequest::content() const {
+    return mapped_content ? mapped_content : data.data();
+}
+
+// number of components the replacement texture is uploaded with
+static uint32_t get_import_nb_comp(const SceGxmTexture &gxm_texture) {
+    const uint32_t nb_comp = gxm::get_num_components(gxm::get_base_format(gxm::get_format(gxm_texture)));
+    // rgb8 textures are not that much supported on modern gpus, upload them as 4 component
+    return nb_comp == 3 ? 4 : nb_comp;
+}
+
+// read the replacement texture file and decode it if it is a png, can be called from any thread
+static void load_replacement_texture(TextureImportRequest &request) {
+    const std::string file_name = fmt::format("{:016X}.{}", request.hash, request.texture.is_dds ? "dds" : "png");
 
+    // read every page of a mapping now, the render thread would otherwise wait for the disk when uploading
+    const auto touch_pages = [](const uint8_t *data, size_t size) {
+        uint8_t checksum = 0;
+        for (size_t offset = 0; offset < size; offset += 4096)
+            checksum ^= *reinterpret_cast<const volatile uint8_t *>(data + offset);
+        (void)checksum;
+    };
+
+    if (request.texture.pack) {
+        const TexturePackEntry *entry = request.texture.pack->find(request.hash);
+        if (entry == nullptr) {
+            LOG_ERROR("Texture {} was listed as available but is not in its texture pack", file_name);
+            return;
+        }
+
+        const uint8_t *content = request.texture.pack->get_content(*entry, request.data);
+        if (content == nullptr)
+            return;
+
+        if (request.data.empty()) {
+            request.mapped_content = content;
+            touch_pages(content, entry->size);
+        }
+        request.success = true;
+        return;
+    }
+
+    if (request.texture.mapped_file) {
+        const MappedFile &file = *request.texture.mapped_file;
+        request.mapped_content = file.data();
+        touch_pages(file.data(), file.size());
+
+        request.success = true;
+        return;
+    }
+
+    const fs::path import_name = *request.texture.folder_path / file_name;
     if (!fs::exists(import_name)) {
         LOG_ERROR("Texture {} was listed as available but was not found", file_name);
-        return false;
+        return;
+    }
+
+    if (request.texture.is_dds) {
+        fs::ifstream file(import_name, std::ios_base::binary | std::ios_base::ate);
+        const size_t file_size = file.tellg();
+        request.data.resize(std::max<size_t>(ddspp::MAX_HEADER_SIZE, file_size));
+
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(request.data.data()), file_size);
+        if (file.gcount() != file_size) {
+            LOG_ERROR("Failed to read {}", file_name);
+            return;
+        }
+    } else {
+        int width, height;
+        uint8_t *pixels = stbi_load(import_name.generic_string().c_str(), &width, &height, &request.nb_channels, request.nb_comp);
+        if (pixels == nullptr) {
+            LOG_ERROR("Failed to decode {}", file_name);
+            return;
+        }
+
+        request.width = width;
+        request.height = height;
+        request.data.assign(pixels, pixels + static_cast<size_t>(width) * height * request.nb_comp);
+        stbi_image_free(pixels);
+    }
+
+    request.success = true;
+}
+
+void TextureCache::start_import_worker() {
+    use_async_import = true;
+    if (!import_thread.joinable())
+        import_thread = std::thread(&TextureCache::import_worker, this);
+}
+
+void TextureCache::import_worker() {
+    while (true) {
+        // only returns nothing once the queue is aborted
+        const std::unique_ptr<std::shared_ptr<TextureImportRequest>> item = import_queue.pop();
+        if (!item)
+            break;
+
+        TextureImportRequest &request = **item;
+        load_replacement_texture(request);
+        request.done.store(true, std::memory_order_release);
     }
+}
+
+bool TextureCache::is_import_ready(TextureCacheInfo &info, const AvailableTexture &texture) {
+    if (info.pending_import && info.pending_import->hash == info.hash) {
+        if (!info.pending_import->done.load(std::memory_order_acquire))
+            return false;
+
+        import_request = std::move(info.pending_import);
+        return true;
+    }
+
+    // a previous request for another content is simply dropped once it is done
+    info.pending_import = std::make_shared<TextureImportRequest>();
+    info.pending_import->hash = info.hash;
+    info.pending_import->texture = texture;
+    info.pending_import->nb_comp = get_import_nb_comp(info.texture);
+    import_queue.push(info.pending_import);
+    return false;
+}
+
+bool TextureCache::import_configure_texture() {
+    uint64_t hash = current_info->hash;
+    const std::string file_name = fmt::format("{:016X}.{}", hash, loading_texture.is_dds ? "dds" : "png");
 
     SceGxmTexture &gxm_texture = current_info->texture;
-    const SceGxmTextureBaseFormat format = gxm::get_base_format(gxm::get_format(gxm_texture));
-    uint32_t nb_comp = gxm::get_num_components(format);
+    const uint32_t nb_comp = get_import_nb_comp(gxm_texture);
 
     const bool is_cube = gxm_texture.texture_type() == SCE_GXM_TEXTURE_CUBE || gxm_texture.texture_type() == SCE_GXM_TEXTURE_CUBE_ARBITRARY;
     if (is_cube && !loading_texture.is_dds) {
@@ -453,11 +570,17 @@ bool TextureCache::import_configure_texture() {
         return false;
     }
 
-    // with 3-component or 4-component textures with a specific swizzle, upload them as 4 component
-    // (rgb8 textures are not that much supported on modern gpus)
-    bool alpha_is_1 = (nb_comp == 3) || (nb_comp == 4 && (gxm_texture.swizzle_format & 0b100));
-    if (nb_comp == 3)
-        nb_comp = 4;
+    if (!import_request || import_request->hash != hash) {
+        // the texture was not loaded by the import thread, do it now
+        import_request = std::make_shared<TextureImportRequest>();
+        import_request->hash = hash;
+        import_request->texture = loading_texture;
+        import_request->nb_comp = nb_comp;
+        load_replacement_texture(*import_request);
+    }
+    const TextureImportRequest &request = *import_request;
+    if (!request.success)
+        return false;
 
     uint32_t width, height;
     uint16_t mipcount = 1;
@@ -468,19 +591,7 @@ bool TextureCache::import_configure_texture() {
         if (dds_descriptor == nullptr)
             dds_descriptor = new ddspp::Descriptor;
 
-        fs::ifstream file(import_name, std::ios_base::binary | std::ios_base::ate);
-        const size_t file_size = file.tellg();
-        imported_texture_raw_data.resize(std::max<size_t>(ddspp::MAX_HEADER_SIZE, file_size));
-
-        file.seekg(0);
-        file.read(reinterpret_cast<char *>(imported_texture_raw_data.data()), file_size);
-        if (file.gcount() != file_size) {
-            LOG_ERROR("Failed to read {}", file_name);
-            return false;
-        }
-        file.close();
-
-        if (ddspp::decode_header(imported_texture_raw_data.data(), *dds_descriptor) != ddspp::Success) {
+        if (ddspp::decode_header(const_cast<uint8_t *>(request.content()), *dds_descriptor) != ddspp::Success) {
             LOG_ERROR("Failed to decode file {} header", file_name);
             return false;
         }
@@ -504,20 +615,16 @@ bool TextureCache::import_configure_texture() {
         is_srgb = ddspp::is_srgb(dds_descriptor->format);
         swap_rb = dds_swap_rb(dds_descriptor->format);
 
-        imported_texture_decoded = imported_texture_raw_data.data() + dds_descriptor->headerSize;
+        imported_texture_decoded = request.content() + dds_descriptor->headerSize;
     } else {
-        int nb_channels;
-        imported_texture_decoded = stbi_load(import_name.generic_string().c_str(), reinterpret_cast<int *>(&width), reinterpret_cast<int *>(&height), &nb_channels, nb_comp);
-        if (imported_texture_decoded == nullptr) {
-            LOG_ERROR("Failed to decode {}", file_name);
+        if (nb_comp >= 3 && request.nb_channels <= 2) {
+            LOG_ERROR("Texture {} has {} channels, expected {}", file_name, request.nb_channels, nb_comp);
             return false;
         }
 
-        if (nb_comp >= 3 && nb_channels <= 2) {
-            LOG_ERROR("Texture {} has {} channels, expected {}", file_name, nb_channels, nb_comp);
-            stbi_image_free(imported_texture_decoded);
-            return false;
-        }
+        width = request.width;
+        height = request.height;
+        imported_texture_decoded = request.content();
 
         if (nb_comp == 1)
             base_format = SCE_GXM_TEXTURE_BASE_FORMAT_U8;
@@ -565,7 +672,7 @@ void TextureCache::import_upload_texture() {
             for (uint32_t mip = 0; mip < mipcount; mip++) {
                 const uint8_t *mip_data = imported_texture_decoded + ddspp::get_offset(*dds_descriptor, mip, face);
                 // dds textures are tightly packed (up to the block size)
-                upload_texture_impl(current_info->format, width, height, mip, mip_data, is_cube + face, align(width, block_width));
+                upload_texture_impl(current_info->format, width, height, mip, mip_data, is_cube + face, align(width, block_width), 0);
 
                 // on to the next mip
                 width /= 2;
@@ -574,20 +681,29 @@ void TextureCache::import_upload_texture() {
         }
     } else {
         // just upload the first mip and we are done (png does not support multiple mips / cubemaps)
-        upload_texture_impl(current_info->format, current_info->width, current_info->height, 0, imported_texture_decoded, 0, current_info->width);
+        upload_texture_impl(current_info->format, current_info->width, current_info->height, 0, imported_texture_decoded, 0, current_info->width, 0);
     }
 }
 
 void TextureCache::import_done() {
-    if (loading_texture.is_dds) {
-        imported_texture_raw_data.clear();
-        imported_texture_decoded = nullptr;
-    } else {
-        if (imported_texture_decoded) {
-            stbi_image_free(imported_texture_decoded);
-            imported_texture_decoded = nullptr;
-        }
-    }
+    import_request.reset();
+    imported_texture_decoded = nullptr;
+}
+
+bool TextureCache::pack_exported_textures() {
+    if (export_folder.empty() || import_folder.empty())
+        return false;
+
+    if (!fs::exists(import_folder))
+        fs::create_directories(import_folder);
+
+    fs::path pack_path = import_folder / "exported";
+    pack_path += TexturePackExtension;
+    if (create_texture_pack(export_folder, pack_path, true) < 0)
+        return false;
+
+    refresh_available_textures();
+    return true;
 }
 
 void TextureCache::refresh_available_textures() {
@@ -653,8 +769,42 @@ void TextureCache::refresh_available_textures() {
             }
         });
 
+        // loose files have the priority over the ones in texture packs
+        for (const auto &file_entry : fs::recursive_directory_iterator(import_folder)) {
+            const fs::path &file = file_entry.path();
+            if (!fs::is_regular_file(file) || file.extension() != TexturePackExtension)
+                continue;
+
+            auto pack = std::make_shared<TexturePack>();
+            if (!pack->open(file))
+                continue;
+
+            for (uint32_t i = 0; i < pack->entry_count(); i++)
+                available_textures_hash.try_emplace(pack->get_entry(i).hash, AvailableTexture{ true, nullptr, nullptr, pack });
+        }
+
         if (!available_textures_hash.empty())
             LOG_INFO("Found {} textures ready to be imported", available_textures_hash.size());
+
+        if (prewarm_imports) {
+            // map the dds files now so that importing them later does not need to open them
+            size_t nb_mapped = 0;
+            for (auto &[hash, texture] : available_textures_hash) {
+                // texture packs are always mapped
+                if (!texture.is_dds || texture.pack)
+                    continue;
+
+                auto mapped_file = std::make_shared<MappedFile>();
+                if (!mapped_file->open(*texture.folder_path / fmt::format("{:016X}.dds", hash)) || mapped_file->size() < ddspp::MAX_HEADER_SIZE)
+                    continue;
+
+                texture.mapped_file = std::move(mapped_file);
+                nb_mapped++;
+            }
+
+            if (nb_mapped > 0)
+                LOG_INFO("Mapped {} dds replacement textures in memory", nb_mapped);
+        }
     }
 }
 
@@ -18,6 +18,7 @@
 #include <renderer/vulkan/types.h>
 
 #include <renderer/vulkan/functions.h>
+#include <renderer/profile.h>
 #include <renderer/vulkan/gxm_to_vulkan.h>
 #include <renderer/vulkan/state.h>
 
@@ -27,14 +28,24 @@
 #include <util/log.h>
 #include <util/overloaded.h>
 
+#ifdef TRACY_ENABLE
+#include <tracy/TracyC.h>
+#endif
+
 namespace renderer::vulkan {
 
 void VKContext::wait_thread_function(const MemState &mem) {
     // try to wait for multiple fences at the same time if possible
     std::vector<vk::Fence> fences;
+    // with timeline semaphores, only the last value needs to be waited for
+    uint64_t timeline_value = 0;
+    uint64_t timeline_value_waited = 0;
 
     auto wait_for_fences = [&]() {
-        if (!fences.empty()) {
+        if (state.support_timeline_semaphore) {
+            if (timeline_value > timeline_value_waited && state.wait_gpu_timeline(timeline_value))
+                timeline_value_waited = timeline_value;
+        } else if (!fences.empty()) {
             auto result = state.device.waitForFences(fences, VK_TRUE, std::numeric_limits<uint64_t>::max());
             if (result != vk::Result::eSuccess) {
                 LOG_ERROR("Could not wait for fences.");
@@ -54,23 +65,19 @@ void VKContext::wait_thread_function(const MemState &mem) {
 
         std::visit(overloaded{
                        [&](FenceWaitRequest &request) {
-                           fences.push_back(request.fence);
+                           if (request.fence)
+                               fences.push_back(request.fence);
+                           timeline_value = std::max(timeline_value, request.timeline_value);
                        },
                        [&](NotificationRequest &request) {
                            if (request.notifications[0].address || request.notifications[1].address) {
                                wait_for_fences();
 
                                // same as in handle_sync_surface_data
-                               std::unique_lock<std::mutex> lock(state.notification_mutex);
-
-                               if (request.notifications[0].address)
-                                   *request.notifications[0].address.get(mem) = request.notifications[0].value;
-                               if (request.notifications[1].address)
-                                   *request.notifications[1].address.get(mem) = request.notifications[1].value;
-
-                               // unlocking before a notify should be faster
-                               lock.unlock();
-                               state.notification_ready.notify_all();
+                               for (const SceGxmNotification &notification : request.notifications) {
+                                   if (notification.address)
+                                       signal_notification(state, mem, notification);
+                               }
                            }
                        },
                        [&](FrameDoneRequest &request) {
@@ -86,7 +93,15 @@ void VKContext::wait_thread_function(const MemState &mem) {
                        [&](PostSurfaceSyncRequest &request) {
                            wait_for_fences();
 
-                           state.surface_cache.perform_post_surface_sync(mem, request.cache_info);
+                           if (request.readback) {
+                               // the staging buffer is ready, the guest memory is only written when it gets accessed
+                               std::unique_lock<std::mutex> lock(request.readback->mutex);
+                               request.readback->copies_done = std::max(request.readback->copies_done, request.readback_copy);
+                               lock.unlock();
+                               request.readback->copy_done_cond.notify_all();
+                           } else {
+                               state.surface_cache.perform_post_surface_sync(mem, request.cache_info);
+                           }
                        },
                        [&](SyncSignalRequest &request) {
                            wait_for_fences();
@@ -97,9 +112,41 @@ void VKContext::wait_thread_function(const MemState &mem) {
     }
 }
 
+// can the scene ended last be continued in the same render pass by the one being set
+static bool can_merge_scene(const VKContext &context, const VKRenderTarget *rt) {
+    if (rt != context.render_target)
+        return false;
+
+    const SceGxmColorSurface &color = context.record.color_surface;
+    const SceGxmColorSurface &pending_color = context.pending_color_surface;
+    if (color.data != pending_color.data || color.colorFormat != pending_color.colorFormat
+        || color.width != pending_color.width || color.height != pending_color.height
+        || color.strideInPixels != pending_color.strideInPixels || color.surfaceType != pending_color.surfaceType
+        || color.downscale != pending_color.downscale || color.gamma != pending_color.gamma)
+        return false;
+
+    const SceGxmDepthStencilSurface &ds = context.record.depth_stencil_surface;
+    const SceGxmDepthStencilSurface &pending_ds = context.pending_ds_surface;
+    if (ds.depth_data != pending_ds.depth_data || ds.stencil_data != pending_ds.stencil_data
+        || ds.get_type() != pending_ds.get_type() || ds.get_stride() != pending_ds.get_stride())
+        return false;
+
+    // the merged render pass must store the depth-stencil if the new scene does
+    const bool has_ds_memory = ds.depth_data.address() != 0 || ds.stencil_data.address() != 0;
+    return !(has_ds_memory && ds.force_store) || context.is_ds_stored;
+}
+
 void set_context(VKContext &context, MemState &mem, VKRenderTarget *rt, const FeatureState &features) {
+    if (context.is_scene_end_pending && !can_merge_scene(context, rt))
+        context.submit_pending_scene();
+    const bool merge_scene = context.is_scene_end_pending;
+    context.is_scene_end_pending = false;
+
     context.render_target = rt;
-    context.scene_timestamp++;
+    // scene_timestamp identifies the recording, which goes on when merging
+    if (!merge_scene)
+        context.scene_timestamp++;
+    context.gxm_scene_timestamp++;
     context.state.texture_cache.current_scene_timestamp = context.scene_timestamp;
 
     SceGxmColorSurface *color_surface_fin = &context.record.color_surface;
@@ -128,6 +175,7 @@ void set_context(VKContext &context, MemState &mem, VKRenderTarget *rt, const Fe
         // using MSAA without downscaling, emulate this as best as we can by multiplying the width and height of the render target by 2
         rt->width *= 2;
         rt->height *= 2;
+        context.is_msaa_upscaled = true;
     }
 
     SceGxmDepthStencilSurface *ds_surface_fin = &context.record.depth_stencil_surface;
@@ -138,7 +186,8 @@ void set_context(VKContext &context, MemState &mem, VKRenderTarget *rt, const Fe
     VKState &state = context.state;
     state.surface_cache.set_render_target(rt);
 
-    context.start_recording();
+    if (!merge_scene)
+        context.start_recording();
 
     bool force_load = context.record.depth_stencil_surface.force_load;
     bool force_store = context.record.depth_stencil_surface.force_store;
@@ -151,6 +200,7 @@ void set_context(VKContext &context, MemState &mem, VKRenderTarget *rt, const Fe
         // we must always store the depth stencil
         force_store = true;
     context.current_render_pass = context.state.pipeline_cache.retrieve_render_pass(vk_format, force_load, force_store);
+    context.current_ds_store = force_store;
     if (context.state.features.support_shader_interlock)
         // also retrieve / create the shader interlock pass
         context.current_shader_interlock_pass = context.state.pipeline_cache.retrieve_render_pass(vk_format, true, true, true);
@@ -160,6 +210,22 @@ void set_context(VKContext &context, MemState &mem, VKRenderTarget *rt, const Fe
     context.current_shader_interlock_framebuffer = framebuffer.shader_interlock;
     context.current_color_base_image = framebuffer.base_image;
 
+    if (merge_scene && context.in_renderpass && !force_load) {
+        // the render pass of the previous scene is still open, clear the depth-stencil as its load operation would have
+        const vk::ClearAttachment clear_attachment{
+            .aspectMask = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil,
+            .clearValue = vk::ClearValue{ .depthStencil = vk::ClearDepthStencilValue{
+                                              .depth = context.record.depth_stencil_surface.background_depth,
+                                              .stencil = context.record.depth_stencil_surface.stencil } }
+        };
+        const vk::ClearRect clear_rect{
+            .rect = context.curr_renderpass_info.renderArea,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        };
+        context.render_cmd.clearAttachments(clear_attachment, clear_rect);
+    }
+
     // make sure we are not keeping any texture from the previous pass
     // (textures can be still bound even though they are not used)
     context.last_vert_texture_count = ~0;
@@ -229,6 +295,15 @@ void VKContext::start_recording() {
 
     is_recording = true;
 
+    FrameObject &frame = state.frame();
+    if (state.support_timestamps && frame.timestamp_scenes.size() < MAX_SCENE_TIMESTAMPS) {
+        timestamp_query_idx = static_cast<int>(frame.timestamp_scenes.size() * 2);
+        frame.timestamp_scenes.push_back(gxm_scene_timestamp);
+        // the prerender cmd is always submitted before the render cmd
+        prerender_cmd.resetQueryPool(frame.timestamp_pool, timestamp_query_idx, 2);
+        render_cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.timestamp_pool, timestamp_query_idx);
+    }
+
     // set all the dynamic state here
     render_cmd.setViewport(0, viewport);
     render_cmd.setScissor(0, scissor);
@@ -296,6 +371,7 @@ void VKContext::start_render_pass(bool create_descriptor_set) {
         .renderPass = current_render_pass,
         .framebuffer = current_framebuffer
     };
+    is_ds_stored = current_ds_store;
 
     if (render_target->has_macroblock_sync && !ignore_macroblock) {
         // set the render area to the correct macroblock
@@ -371,6 +447,7 @@ void VKContext::stop_render_pass() {
 }
 
 void VKContext::stop_recording(const SceGxmNotification &notif1, const SceGxmNotification &notif2, bool submit) {
+    R_FRAME_TIMER(Submit);
     if (!is_recording) {
         LOG_ERROR("Stopping recording while not recording");
         return;
@@ -401,23 +478,47 @@ void VKContext::stop_recording(const SceGxmNotification &notif1, const SceGxmNot
             }
         }
 
+        // without memory mapping, the results are written to the guest memory once the frame is done, so nothing waits for them
+        const bool use_readback = !current_visibility_buffer->gpu_buffer;
+        const uint32_t readback_offset = state.current_frame_idx * current_visibility_buffer->size;
+        const uint32_t *readback_results = static_cast<const uint32_t *>(current_visibility_buffer->readback_buffer.mapped_data) + readback_offset;
         for (auto &range : ranges) {
             // reset before the beginning of the render pass
             prerender_cmd.resetQueryPool(current_visibility_buffer->query_pool, range.offset, range.size);
 
             // wait for the range at the end
             // TODO: this will be wrong with upscaling enabled and precise mode set
-            render_cmd.copyQueryPoolResults(current_visibility_buffer->query_pool, range.offset, range.size,
-                current_visibility_buffer->gpu_buffer, current_visibility_buffer->buffer_offset + range.offset * sizeof(uint32_t),
-                sizeof(uint32_t), vk::QueryResultFlagBits::eWait);
+            if (use_readback) {
+                render_cmd.copyQueryPoolResults(current_visibility_buffer->query_pool, range.offset, range.size,
+                    current_visibility_buffer->readback_buffer.buffer, (readback_offset + range.offset) * sizeof(uint32_t),
+                    sizeof(uint32_t), vk::QueryResultFlagBits::eWait);
+                state.frame().visibility_readbacks.push_back({ current_visibility_buffer->address + range.offset * static_cast<uint32_t>(sizeof(uint32_t)),
+                    readback_results + range.offset, range.size });
+            } else {
+                render_cmd.copyQueryPoolResults(current_visibility_buffer->query_pool, range.offset, range.size,
+                    current_visibility_buffer->gpu_buffer, current_visibility_buffer->buffer_offset + range.offset * sizeof(uint32_t),
+                    sizeof(uint32_t), vk::QueryResultFlagBits::eWait);
+            }
+        }
+        if (use_readback) {
+            const vk::MemoryBarrier barrier{
+                .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .dstAccessMask = vk::AccessFlagBits::eHostRead
+            };
+            render_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, barrier, {}, {});
         }
         visibility_max_used_idx = -1;
         current_visibility_buffer->queries_used.assign(current_visibility_buffer->size, false);
     }
 
-    ColorSurfaceCacheInfo *surface_info = nullptr;
+    PostSurfaceSyncRequest surface_sync_request{};
     if (state.features.support_memory_mapping && !state.disable_surface_sync)
-        surface_info = state.surface_cache.perform_surface_sync();
+        surface_sync_request = state.surface_cache.perform_surface_sync(mem, submit);
+
+    if (timestamp_query_idx != -1) {
+        render_cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, state.frame().timestamp_pool, timestamp_query_idx + 1);
+        timestamp_query_idx = -1;
+    }
 
     prerender_cmd.end();
     render_cmd.end();
@@ -433,28 +534,35 @@ void VKContext::stop_recording(const SceGxmNotification &notif1, const SceGxmNot
     if (!submit)
         return;
 
-    if (render_target->multisample_mode && !record.color_surface.downscale) {
+    if (is_msaa_upscaled) {
         // revert changes made in set_context
         render_target->width /= 2;
         render_target->height /= 2;
+        is_msaa_upscaled = false;
     }
 
     vk::Fence fence = next_fence;
     next_fence = nullptr;
+    if (state.support_timeline_semaphore)
+        // the gpu timeline is used instead
+        fence = nullptr;
 
     vk::SubmitInfo submit_info{};
     submit_info.setCommandBuffers(cmdbuffers_to_submit);
 
-    state.general_queue.submit(submit_info, fence);
+    state.submit_general(submit_info, fence);
     cmdbuffers_to_submit.clear();
-    state.frame().rendered_fences.push_back(fence);
+    if (fence)
+        state.frame().rendered_fences.push_back(fence);
+    else
+        state.frame().timeline_value = state.gpu_timeline_value;
 
     if (state.features.support_memory_mapping) {
         // send it to the wait queue
-        state.request_queue.push(FenceWaitRequest{ fence });
+        state.request_queue.push(FenceWaitRequest{ fence, state.gpu_timeline_value });
 
-        if (surface_info) {
-            state.request_queue.push(PostSurfaceSyncRequest{ surface_info });
+        if (surface_sync_request.cache_info || surface_sync_request.readback) {
+            state.request_queue.push(std::move(surface_sync_request));
         }
 
         // the notification must be the last thing sent
@@ -465,6 +573,44 @@ void VKContext::stop_recording(const SceGxmNotification &notif1, const SceGxmNot
     }
 }
 
+void VKContext::end_scene(const SceGxmNotification &notif1, const SceGxmNotification &notif2) {
+    // the macroblock and MSAA emulations and shader interlock rely on the render pass ending with the scene
+    const bool can_defer = in_renderpass && !render_target->has_macroblock_sync && !is_msaa_upscaled
+        && !state.features.support_shader_interlock;
+    if (!can_defer) {
+        stop_recording(notif1, notif2);
+        return;
+    }
+
+    is_scene_end_pending = true;
+    pending_notifications[0] = notif1;
+    pending_notifications[1] = notif2;
+    pending_color_surface = record.color_surface;
+    pending_ds_surface = record.depth_stencil_surface;
+}
+
+void VKContext::log_ring_buffer_usage() const {
+    const std::pair<const char *, const vkutil::HostRingBuffer *> ring_buffers[] = {
+        { "vertex stream", &vertex_stream_ring_buffer },
+        { "index stream", &index_stream_ring_buffer },
+        { "vertex uniform stream", &vertex_uniform_stream_ring_buffer },
+        { "fragment uniform stream", &fragment_uniform_stream_ring_buffer },
+        { "vertex info uniform", &vertex_info_uniform_buffer },
+        { "fragment info uniform", &fragment_info_uniform_buffer },
+    };
+    for (const auto &[name, ring_buffer] : ring_buffers)
+        LOG_INFO("Ring buffer {}: at most {} KiB used by the frames rendering, capacity of {} KiB", name,
+            ring_buffer->get_high_water_mark() / KiB(1), ring_buffer->get_capacity() / KiB(1));
+}
+
+void VKContext::submit_pending_scene() {
+    if (!is_scene_end_pending)
+        return;
+
+    is_scene_end_pending = false;
+    stop_recording(pending_notifications[0], pending_notifications[1]);
+}
+
 void VKContext::check_for_macroblock_change(bool is_draw) {
     if (!render_target->has_macroblock_sync)
         return;
@@ -476,6 +622,7 @@ void VKContext::check_for_macroblock_change(bool is_draw) {
         ignore_macroblock = true;
         // in this case we must load and store the depth stencil each time
         current_render_pass = state.pipeline_cache.retrieve_render_pass(current_color_format, true, true);
+        current_ds_store = true;
     }
 
     // use the scissor to know in which macroblock we are
@@ -501,6 +648,112 @@ void VKContext::check_for_macroblock_change(bool is_draw) {
     }
 }
 
+#ifdef TRACY_ENABLE
+// the zones are emitted when the timestamps are read back, a few frames after the scenes were recorded
+// so the gpu timeline is only roughly aligned with the cpu one
+static void emit_tracy_scene_zones(const VKState &state, const std::vector<uint64_t> &timestamps) {
+    constexpr uint8_t tracy_gpu_context = 0;
+    // tracy::GpuContextType::Vulkan
+    constexpr uint8_t tracy_vulkan_context_type = 2;
+    static const ___tracy_source_location_data scene_location = { "GXM scene", __FUNCTION__, __FILE__, __LINE__, 0 };
+    static bool context_created = false;
+    static uint16_t next_query_id = 0;
+
+    if (!context_created) {
+        ___tracy_emit_gpu_new_context({ .gpuTime = static_cast<int64_t>(timestamps[0]),
+            .period = state.timestamp_period,
+            .context = tracy_gpu_context,
+            .flags = 0,
+            .type = tracy_vulkan_context_type });
+        context_created = true;
+    }
+
+    for (size_t i = 0; i < timestamps.size(); i += 2) {
+        const uint16_t begin_id = next_query_id++;
+        const uint16_t end_id = next_query_id++;
+        ___tracy_emit_gpu_zone_begin_serial({ .srcloc = reinterpret_cast<uint64_t>(&scene_location), .queryId = begin_id, .context = tracy_gpu_context });
+        ___tracy_emit_gpu_zone_end_serial({ .queryId = end_id, .context = tracy_gpu_context });
+        ___tracy_emit_gpu_time_serial({ .gpuTime = static_cast<int64_t>(timestamps[i]), .queryId = begin_id, .context = tracy_gpu_context });
+        ___tracy_emit_gpu_time_serial({ .gpuTime = static_cast<int64_t>(timestamps[i + 1]), .queryId = end_id, .context = tracy_gpu_context });
+    }
+}
+#endif
+
+// number of measured frames averaged before checking the resolution multiplier against the gpu time
+static constexpr int RESOLUTION_CHECK_FRAMES = 600;
+// gpu time available for a frame at 60 fps, in ms
+static constexpr float GPU_FRAME_BUDGET = 1000.0f / 60.0f;
+static constexpr int MAX_RES_MULTIPLIER = 8;
+
+// render targets and surfaces are allocated at the resolution multiplier when the app creates them,
+// so it can't be changed while the app is running, only suggest a better value once per session
+static void check_resolution_budget(const VKState &state, float frame_time) {
+    static float total_time = 0.0f;
+    static int frame_count = 0;
+    static bool suggested = false;
+
+    if (suggested)
+        return;
+
+    total_time += frame_time;
+    if (++frame_count < RESOLUTION_CHECK_FRAMES)
+        return;
+
+    const float average_time = total_time / frame_count;
+    total_time = 0.0f;
+    frame_count = 0;
+
+    const int multiplier = state.res_multiplier;
+    // the gpu time is roughly proportional to the number of pixels
+    const float higher_time = average_time * (multiplier + 1) * (multiplier + 1) / (multiplier * multiplier);
+    if (multiplier > 1 && average_time > GPU_FRAME_BUDGET * 0.9f) {
+        LOG_WARN("The GPU needs {:.1f} ms per frame at {}x resolution, lowering the resolution multiplier should help reaching 60 fps", average_time, multiplier);
+        suggested = true;
+    } else if (multiplier < MAX_RES_MULTIPLIER && higher_time < GPU_FRAME_BUDGET * 0.5f) {
+        LOG_INFO("The GPU only needs {:.1f} ms per frame at {}x resolution, a {}x resolution multiplier should still run at full speed", average_time, multiplier, multiplier + 1);
+        suggested = true;
+    }
+}
+
+// read back the timestamps of the last use of this frame object, its fences must have been waited for
+static void resolve_scene_timestamps(VKState &state, FrameObject &frame) {
+    const uint32_t query_count = static_cast<uint32_t>(frame.timestamp_scenes.size() * 2);
+    auto [result, timestamps] = state.device.getQueryPoolResults<uint64_t>(frame.timestamp_pool, 0, query_count,
+        query_count * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    // the timestamps are not available if some of the recordings were never submitted
+    if (result != vk::Result::eSuccess)
+        return;
+
+    const float ms_per_tick = state.timestamp_period / 1000000.0f;
+    float frame_time = 0.0f;
+    float scene_time = 0.0f;
+    float max_scene_time = 0.0f;
+    uint32_t scene_count = 0;
+    for (size_t i = 0; i < frame.timestamp_scenes.size(); i++) {
+        const uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & state.timestamp_mask;
+        const float time = static_cast<float>(ticks) * ms_per_tick;
+
+        // the recordings of a scene split by mid-scene flushes are added together
+        if (i == 0 || frame.timestamp_scenes[i] != frame.timestamp_scenes[i - 1]) {
+            scene_count++;
+            scene_time = 0.0f;
+        }
+        scene_time += time;
+        frame_time += time;
+        max_scene_time = std::max(max_scene_time, scene_time);
+    }
+
+    state.gpu_frame_time = frame_time;
+    state.gpu_max_scene_time = max_scene_time;
+    state.gpu_scene_count = scene_count;
+
+    check_resolution_budget(state, frame_time);
+
+#ifdef TRACY_ENABLE
+    emit_tracy_scene_zones(state, timestamps);
+#endif
+}
+
 void new_frame(VKContext &context) {
     if (context.state.features.support_memory_mapping) {
         FrameDoneRequest request = { context.frame_timestamp };
@@ -514,7 +767,7 @@ void new_frame(VKContext &context) {
     FrameObject &frame = context.state.frame();
 
     // wait on all fences still present to make sure
-    if (!frame.rendered_fences.empty()) {
+    if (!frame.rendered_fences.empty() || frame.timeline_value != 0) {
         // wait for the fences, then reset them
 
         if (context.state.features.support_memory_mapping) {
@@ -527,6 +780,11 @@ void new_frame(VKContext &context) {
             context.new_frame_condv.wait(lock, [&]() {
                 return context.last_frame_waited >= previous_frame_timestamp;
             });
+        } else if (context.state.support_timeline_semaphore) {
+            if (!context.state.wait_gpu_timeline(frame.timeline_value)) {
+                assert(false);
+                return;
+            }
         } else {
             auto result = device.waitForFences(frame.rendered_fences, VK_TRUE, std::numeric_limits<uint64_t>::max());
             if (result != vk::Result::eSuccess) {
@@ -537,12 +795,34 @@ void new_frame(VKContext &context) {
         }
 
         // reset the fences in both case (the wait thread does not do that as they can still be used)
-        device.resetFences(frame.rendered_fences);
+        if (!frame.rendered_fences.empty())
+            device.resetFences(frame.rendered_fences);
         frame.rendered_fences.clear();
+        frame.timeline_value = 0;
+    }
+
+    // the visibility results of the frame waited for are ready
+    for (const VisibilityReadback &readback : frame.visibility_readbacks) {
+        if (uint32_t *results = Ptr<uint32_t>(readback.address).get(context.mem))
+            memcpy(results, readback.results, readback.count * sizeof(uint32_t));
+    }
+    frame.visibility_readbacks.clear();
+
+    // the data of the frame waited for is no longer needed
+    for (vkutil::HostRingBuffer *ring_buffer : { &context.vertex_stream_ring_buffer, &context.index_stream_ring_buffer,
+             &context.vertex_uniform_stream_ring_buffer, &context.fragment_uniform_stream_ring_buffer,
+             &context.vertex_info_uniform_buffer, &context.fragment_info_uniform_buffer })
+        ring_buffer->new_frame();
+
+    if (!frame.timestamp_scenes.empty()) {
+        resolve_scene_timestamps(context.state, frame);
+        frame.timestamp_scenes.clear();
     }
 
     device.resetCommandPool(frame.prerender_pool);
     device.resetCommandPool(frame.render_pool);
+    if (frame.transfer_pool)
+        device.resetCommandPool(frame.transfer_pool);
 
     // set the position in the used descriptor queue back to the beginning
     for (int i = 0; i < 16; i++) {
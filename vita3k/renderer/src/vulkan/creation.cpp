@@ -34,15 +34,21 @@ namespace renderer::vulkan {
 VKContext::VKContext(VKState &state, MemState &mem)
     : state(state)
     , mem(mem)
-    , vertex_stream_ring_buffer(vk::BufferUsageFlagBits::eVertexBuffer, MiB(/*128*/ 64))
-    , index_stream_ring_buffer(vk::BufferUsageFlagBits::eIndexBuffer, MiB(64))
-    , vertex_uniform_stream_ring_buffer(vk::BufferUsageFlagBits::eStorageBuffer, MiB(/*256*/ 64))
-    , fragment_uniform_stream_ring_buffer(vk::BufferUsageFlagBits::eStorageBuffer, MiB(/*256*/ 64))
-    , vertex_info_uniform_buffer(vk::BufferUsageFlagBits::eUniformBuffer, MiB(16))
-    , fragment_info_uniform_buffer(vk::BufferUsageFlagBits::eUniformBuffer, MiB(32)) {
+    // it is also the staging buffer of the cached vertex streams
+    , vertex_stream_ring_buffer(vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc, MiB(/*128*/ 64), MAX_FRAMES_RENDERING)
+    , index_stream_ring_buffer(vk::BufferUsageFlagBits::eIndexBuffer, MiB(64), MAX_FRAMES_RENDERING)
+    , vertex_uniform_stream_ring_buffer(vk::BufferUsageFlagBits::eStorageBuffer, MiB(/*256*/ 64), MAX_FRAMES_RENDERING)
+    , fragment_uniform_stream_ring_buffer(vk::BufferUsageFlagBits::eStorageBuffer, MiB(/*256*/ 64), MAX_FRAMES_RENDERING)
+    , vertex_info_uniform_buffer(vk::BufferUsageFlagBits::eUniformBuffer, MiB(16), MAX_FRAMES_RENDERING)
+    , fragment_info_uniform_buffer(vk::BufferUsageFlagBits::eUniformBuffer, MiB(32), MAX_FRAMES_RENDERING) {
     memset(&prev_vert_ublock, 0, sizeof(shader::RenderVertUniformBlock));
     memset(&prev_frag_ublock, 0, sizeof(shader::RenderFragUniformBlock));
 
+    // the vertex and index buffers are bound again after each allocation, they can chain more buffers
+    // the uniform buffers are referenced by a descriptor set written once, they always wrap around
+    vertex_stream_ring_buffer.can_grow = true;
+    index_stream_ring_buffer.can_grow = true;
+
     // specify the alignement
     // for the index buffer, we only have 16 or 32bit types
     index_stream_ring_buffer.alignment = sizeof(uint32_t);
@@ -153,8 +159,7 @@ VKContext::VKContext(VKState &state, MemState &mem)
 }
 
 VKRenderTarget::VKRenderTarget(VKState &state, const SceGxmRenderTargetParams &params)
-    : color(params.width * state.res_multiplier, params.height * state.res_multiplier, vk::Format::eR8G8B8A8Unorm)
-    , depthstencil(params.width * state.res_multiplier, params.height * state.res_multiplier, vk::Format::eD32SfloatS8Uint) {
+    : color(params.width * state.res_multiplier, params.height * state.res_multiplier, vk::Format::eR8G8B8A8Unorm) {
     width = params.width * state.res_multiplier;
     height = params.height * state.res_multiplier;
 
@@ -162,13 +167,23 @@ VKRenderTarget::VKRenderTarget(VKState &state, const SceGxmRenderTargetParams &p
     if (state.features.support_shader_interlock)
         color_usage |= vk::ImageUsageFlagBits::eStorage;
     color.init_image(color_usage);
+
+    uint32_t ds_width = width;
+    uint32_t ds_height = height;
     if (params.multisampleMode == SCE_GXM_MULTISAMPLE_4X) {
         // the depth buffer may need to be 4x bigger if we use a texture without downscale
-        depthstencil.width *= 2;
-        depthstencil.height *= 2;
+        ds_width *= 2;
+        ds_height *= 2;
     }
 
-    depthstencil.init_image(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc);
+    // without shader interlock the depth-stencil is always cleared at the beginning of the render pass and never stored
+    const bool is_transient = !state.features.support_shader_interlock;
+    if (is_transient) {
+        depthstencil = state.surface_cache.retrieve_transient_depth_stencil(ds_width, ds_height);
+    } else {
+        depthstencil = std::make_shared<vkutil::Image>(ds_width, ds_height, vk::Format::eD32SfloatS8Uint);
+        depthstencil->init_image(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc);
+    }
 
     // transition images to their right state
     vk::CommandBuffer cmd_buffer = vkutil::create_single_time_command(state.device, state.general_command_pool);
@@ -180,15 +195,15 @@ VKRenderTarget::VKRenderTarget(VKState &state, const SceGxmRenderTargetParams &p
         cmd_buffer.clearColorImage(color.image, vk::ImageLayout::eTransferDstOptimal, clear_color, vkutil::color_subresource_range);
         color.transition_to(cmd_buffer, vkutil::ImageLayout::ColorAttachmentReadWrite);
     }
-    // depth stencil
-    {
-        depthstencil.transition_to(cmd_buffer, vkutil::ImageLayout::TransferDst, vkutil::ds_subresource_range);
+    // depth stencil, a transient one can not be cleared outside of a render pass
+    if (!is_transient) {
+        depthstencil->transition_to(cmd_buffer, vkutil::ImageLayout::TransferDst, vkutil::ds_subresource_range);
         vk::ClearDepthStencilValue clear_value{
             .depth = 1.0,
             .stencil = 0
         };
-        cmd_buffer.clearDepthStencilImage(depthstencil.image, vk::ImageLayout::eTransferDstOptimal, clear_value, vkutil::ds_subresource_range);
-        depthstencil.transition_to(cmd_buffer, vkutil::ImageLayout::DepthStencilAttachment, vkutil::ds_subresource_range);
+        cmd_buffer.clearDepthStencilImage(depthstencil->image, vk::ImageLayout::eTransferDstOptimal, clear_value, vkutil::ds_subresource_range);
+        depthstencil->transition_to(cmd_buffer, vkutil::ImageLayout::DepthStencilAttachment, vkutil::ds_subresource_range);
     }
     vkutil::end_single_time_command(state.device, state.general_queue, state.general_command_pool, cmd_buffer);
 
@@ -235,7 +250,10 @@ void destroy(VKState &state, std::unique_ptr<RenderTarget> &rt) {
     // deferred destroy everything in case some object is still being used
     FrameObject &frame = state.frame();
     frame.destroy_queue.add_image(render_target.color);
-    frame.destroy_queue.add_image(render_target.depthstencil);
+    // the depth-stencil may still be used by other render targets
+    if (render_target.depthstencil.use_count() == 1)
+        frame.destroy_queue.add_image(*render_target.depthstencil);
+    render_target.depthstencil.reset();
 
     for (auto fence : render_target.fences)
         frame.destroy_queue.add(fence);
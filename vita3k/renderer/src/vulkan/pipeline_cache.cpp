@@ -17,6 +17,7 @@
 
 #include <renderer/vulkan/pipeline_cache.h>
 
+#include <renderer/profile.h>
 #include <renderer/vulkan/gxm_to_vulkan.h>
 #include <renderer/vulkan/state.h>
 #include <renderer/vulkan/types.h>
@@ -28,11 +29,15 @@
 #include <shader/spirv_recompiler.h>
 
 #include <util/align.h>
+#include <util/alloc_tracker.h>
 #include <util/fs.h>
 #include <util/log.h>
 
 #include <SDL.h>
 
+#include <algorithm>
+#include <optional>
+
 // don't use the dispatch version, because we always hash a small amount
 // with a known size
 #define XXH_INLINE_ALL
@@ -46,11 +51,20 @@ constexpr size_t record_pipeline_len = offsetof(GxmRecordState, vertex_streams);
 // structure containing everything needed to compile a pipeline
 struct CompileRequest {
     // iterator to the pipeline location
-    vk::Pipeline *pipeline;
+    std::atomic<vk::Pipeline> *pipeline;
+
+    // only set for warm-up requests, in which case only pipeline and render_pass are also used
+    // if pipeline is null, this only loads the shaders of warmup_shaders
+    // the shaders are copied, the shaders hash list can grow while the warm-up goes on in the background
+    const PipelineDescription *warmup_description = nullptr;
+    std::optional<ShadersHash> warmup_shaders;
 
     // this is everything we need to compile the shader on another thread (as the original data will change)
+    uint64_t key;
     SceGxmPrimitiveType type;
     vk::RenderPass render_pass;
+    vk::Format color_format;
+    uint64_t first_use_frame;
     SceGxmVertexProgram *vertex_program_gxm;
     SceGxmFragmentProgram *fragment_program_gxm;
     shader::Hints hints;
@@ -172,7 +186,9 @@ void PipelineCache::init() {
             layout_bindings[i].stageFlags = vk::ShaderStageFlagBits::eFragment;
         }
         for (uint32_t i = 1; i <= 16; i++) {
+            // only one set of a pipeline layout can be pushed, fragment textures change the most often
             vk::DescriptorSetLayoutCreateInfo descriptor_info{
+                .flags = state.support_push_descriptor ? vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR : vk::DescriptorSetLayoutCreateFlags(),
                 .bindingCount = i,
                 .pBindings = layout_bindings.data()
             };
@@ -259,7 +275,141 @@ void PipelineCache::set_async_compilation(bool enable) {
 // magic number put at the beginning of the pipeline cache file
 constexpr uint32_t pipeline_cache_magic = 0xBEEF4321;
 
+// magic number put at the beginning of the pipeline descriptions file
+constexpr uint32_t pipeline_descriptions_magic = 0xBEEF4324;
+// descriptions saved before the frame of first use was added, they are all built before booting
+constexpr uint32_t pipeline_descriptions_magic_no_frame = 0xBEEF4323;
+
+// the pipelines first used during this number of frames are built before booting, the others in the background
+constexpr uint64_t warmup_boot_frames = 60 * 60;
+
+uint32_t PipelineCache::get_dynamic_state_mask() const {
+    return static_cast<uint32_t>(support_dynamic_state)
+        | (static_cast<uint32_t>(support_dynamic_polygon_mode) << 1)
+        | (static_cast<uint32_t>(support_dynamic_blending) << 2)
+        | (static_cast<uint32_t>(support_unrestricted_topology) << 3)
+        | (static_cast<uint32_t>(support_dynamic_vertex_input) << 4);
+}
+
+void PipelineCache::read_pipeline_descriptions() {
+    const auto shaders_path{ fs::path(state.cache_path) / "shaders" / state.title_id / state.self_name };
+    const fs::path path = shaders_path / fmt::format("pipelines-vk{}.dat", shader::CURRENT_VERSION);
+
+    fs::ifstream descriptions_file(path, std::ios::in | std::ios::binary);
+    if (!descriptions_file.is_open())
+        return;
+
+    auto read_value = [&]<typename T>(T &val) {
+        descriptions_file.read(reinterpret_cast<char *>(&val), sizeof(T));
+    };
+    auto read_vector = [&]<typename T>(std::vector<T> &vec) {
+        uint32_t size = 0;
+        read_value(size);
+        // there are at most 16 streams and 16 attributes, anything bigger means the file is corrupted
+        if (size > 16) {
+            descriptions_file.setstate(std::ios::failbit);
+            return;
+        }
+        vec.resize(size);
+        descriptions_file.read(reinterpret_cast<char *>(vec.data()), size * sizeof(T));
+    };
+
+    uint32_t magic_number = 0;
+    uint32_t record_len = 0;
+    uint32_t dynamic_state_mask = 0;
+    uint64_t nb_descriptions = 0;
+    read_value(magic_number);
+    read_value(record_len);
+    read_value(dynamic_state_mask);
+    read_value(nb_descriptions);
+    // the keys depend on the dynamic states used, they would never be looked up
+    const bool has_first_use_frame = magic_number == pipeline_descriptions_magic;
+    if (!descriptions_file || (!has_first_use_frame && magic_number != pipeline_descriptions_magic_no_frame) || record_len != record_pipeline_len || dynamic_state_mask != get_dynamic_state_mask()) {
+        LOG_WARN("Pipeline descriptions are corrupted or outdated, ignoring them.");
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(descriptions_mutex);
+    pipeline_descriptions.clear();
+    described_pipelines.clear();
+    for (uint64_t i = 0; i < nb_descriptions; i++) {
+        PipelineDescription description;
+        read_value(description.key);
+        read_value(description.vertex_hash);
+        read_value(description.fragment_hash);
+        read_value(description.type);
+        read_value(description.color_format);
+        read_value(description.use_shader_interlock);
+        read_value(description.is_fragment_disabled);
+        read_value(description.frag_has_no_output);
+        read_value(description.vertex_texture_count);
+        read_value(description.fragment_texture_count);
+        read_value(description.blending);
+        read_vector(description.bindings);
+        read_vector(description.attributes);
+        description.record_data.resize(record_pipeline_len);
+        descriptions_file.read(reinterpret_cast<char *>(description.record_data.data()), record_pipeline_len);
+        if (has_first_use_frame)
+            read_value(description.first_use_frame);
+
+        if (!descriptions_file || description.vertex_texture_count > 16 || description.fragment_texture_count > 16) {
+            LOG_WARN("Pipeline descriptions are corrupted, only {} out of {} could be read.", i, nb_descriptions);
+            break;
+        }
+
+        if (described_pipelines.insert(description.key).second)
+            pipeline_descriptions.push_back(std::move(description));
+    }
+
+    LOG_INFO("Found {} pipeline descriptions", pipeline_descriptions.size());
+}
+
+void PipelineCache::save_pipeline_descriptions() {
+    const auto shaders_path{ fs::path(state.cache_path) / "shaders" / state.title_id / state.self_name };
+    const fs::path path = shaders_path / fmt::format("pipelines-vk{}.dat", shader::CURRENT_VERSION);
+
+    std::lock_guard<std::mutex> guard(descriptions_mutex);
+    if (pipeline_descriptions.empty())
+        return;
+
+    fs::ofstream descriptions_file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!descriptions_file.is_open())
+        return;
+
+    auto write_value = [&]<typename T>(const T &val) {
+        descriptions_file.write(reinterpret_cast<const char *>(&val), sizeof(T));
+    };
+    auto write_vector = [&]<typename T>(const std::vector<T> &vec) {
+        write_value(static_cast<uint32_t>(vec.size()));
+        descriptions_file.write(reinterpret_cast<const char *>(vec.data()), vec.size() * sizeof(T));
+    };
+
+    write_value(pipeline_descriptions_magic);
+    write_value(static_cast<uint32_t>(record_pipeline_len));
+    write_value(get_dynamic_state_mask());
+    write_value(static_cast<uint64_t>(pipeline_descriptions.size()));
+    for (const PipelineDescription &description : pipeline_descriptions) {
+        write_value(description.key);
+        write_value(description.vertex_hash);
+        write_value(description.fragment_hash);
+        write_value(description.type);
+        write_value(description.color_format);
+        write_value(description.use_shader_interlock);
+        write_value(description.is_fragment_disabled);
+        write_value(description.frag_has_no_output);
+        write_value(description.vertex_texture_count);
+        write_value(description.fragment_texture_count);
+        write_value(description.blending);
+        write_vector(description.bindings);
+        write_vector(description.attributes);
+        descriptions_file.write(reinterpret_cast<const char *>(description.record_data.data()), record_pipeline_len);
+        write_value(description.first_use_frame);
+    }
+}
+
 void PipelineCache::read_pipeline_cache() {
+    read_pipeline_descriptions();
+
     const auto shaders_path{ fs::path(state.cache_path) / "shaders" / state.title_id / state.self_name };
     const std::string pipeline_cache_name = fmt::format("pipeline-cache-vk{}.dat", shader::CURRENT_VERSION);
     const fs::path path = shaders_path / pipeline_cache_name;
@@ -298,7 +448,7 @@ void PipelineCache::read_pipeline_cache() {
     for (size_t i = 0; i < nb_hashes; i++) {
         uint64_t hash;
         read_integer(hash);
-        pipelines[hash] = nullptr;
+        pipelines[hash].store(nullptr, std::memory_order_relaxed);
     }
 
     std::vector<char> pipeline_data(pipeline_size);
@@ -353,6 +503,8 @@ void PipelineCache::save_pipeline_cache() {
     // then save the cache
     pipeline_cache_file.write(reinterpret_cast<const char *>(pipeline_data.data()), pipeline_data.size());
     pipeline_cache_file.close();
+
+    save_pipeline_descriptions();
     LOG_INFO("Pipeline cache saved");
 }
 
@@ -411,6 +563,8 @@ vk::PipelineShaderStageCreateInfo PipelineCache::retrieve_shader(const SceGxmPro
     };
 
     *shader_module = state.device.createShaderModule(shader_info);
+    // the driver keeps its own copy of the code for each module
+    TRACK_HOST_ALLOC(ShaderCache, std::bit_cast<void *>(*shader_module), shader_info.codeSize);
     {
         std::lock_guard<std::mutex> guard(shaders_mutex);
         // Save shader cache haches
@@ -457,6 +611,9 @@ vk::RenderPass PipelineCache::retrieve_render_pass(vk::Format format, bool force
     if (!no_color) {
         subpass.setColorAttachments(color_ref);
         subpass.setInputAttachments(color_ref);
+        // reading the color attachment as a subpass input sees the writes of the previous fragments
+        if (support_rasterization_order)
+            subpass.flags = vk::SubpassDescriptionFlagBits::eRasterizationOrderAttachmentColorAccessEXT;
     }
 
     vk::AttachmentDescription color_attachment{
@@ -679,8 +836,27 @@ void PipelineCache::compiler_thread(MemState &mem) {
             // use this as an instruction to stop the thread
             break;
 
-        vk::Pipeline pipeline = compile_pipeline(request->type, request->render_pass, *request->vertex_program_gxm, *request->fragment_program_gxm, *request->get_record(), request->hints, mem);
-        *request->pipeline = pipeline;
+        if (request->warmup_shaders || request->warmup_description) {
+            const Sha256Hash empty_hash{};
+            if (request->warmup_description) {
+                warmup_pipeline(*request->warmup_description, request->render_pass, request->pipeline);
+                request->pipeline->notify_all();
+            } else {
+                if (request->warmup_shaders->vert != empty_hash)
+                    precompile_shader(request->warmup_shaders->vert);
+                if (request->warmup_shaders->frag != empty_hash)
+                    precompile_shader(request->warmup_shaders->frag);
+            }
+
+            state.programs_count_pre_compiled.fetch_add(1, std::memory_order_release);
+            delete request;
+            continue;
+        }
+
+        vk::Pipeline pipeline = compile_pipeline(request->key, request->type, request->render_pass, request->color_format, *request->vertex_program_gxm, *request->fragment_program_gxm, *request->get_record(), request->hints, request->first_use_frame, mem);
+        // the render thread may be looking at this slot at the same time, or waiting for it
+        request->pipeline->store(pipeline, std::memory_order_release);
+        request->pipeline->notify_all();
 
         request->vertex_program_gxm->compile_threads_on.fetch_sub(1, std::memory_order_release);
         request->fragment_program_gxm->compile_threads_on.fetch_sub(1, std::memory_order_release);
@@ -689,11 +865,24 @@ void PipelineCache::compiler_thread(MemState &mem) {
         next_pipeline_cache_save = time_s + pipeline_cache_save_delay;
 
         state.shaders_count_compiled++;
+        state.pipeline_compiles.fetch_add(1, std::memory_order_relaxed);
 
         delete request;
     }
 }
 
+// primitive topologies of the same class can be switched to when using dynamic state
+static uint32_t get_topology_class(SceGxmPrimitiveType type) {
+    switch (type) {
+    case SCE_GXM_PRIMITIVE_POINTS:
+        return 1;
+    case SCE_GXM_PRIMITIVE_LINES:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
 static vk::StencilOpState convert_op_state(const GxmStencilStateOp &state) {
     return vk::StencilOpState{
         .failOp = translate_stencil_op(state.stencil_fail),
@@ -703,31 +892,111 @@ static vk::StencilOpState convert_op_state(const GxmStencilStateOp &state) {
     };
 }
 
-vk::Pipeline PipelineCache::compile_pipeline(SceGxmPrimitiveType type, vk::RenderPass render_pass, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, const shader::Hints &hints, MemState &mem) {
+PipelineDescription PipelineCache::describe_pipeline(uint64_t key, SceGxmPrimitiveType type, vk::Format color_format, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, MemState &mem) {
     const VertexProgram &vertex_program = *reinterpret_cast<VertexProgram *>(
         vertex_program_gxm.renderer_data.get());
     const SceGxmProgram *gxm_fragment_shader = fragment_program_gxm.program.get(mem);
     const VKFragmentProgram &fragment_program = *reinterpret_cast<VKFragmentProgram *>(
         fragment_program_gxm.renderer_data.get());
 
+    PipelineDescription description{
+        .key = key,
+        .vertex_hash = vertex_program.hash,
+        .fragment_hash = fragment_program.hash,
+        .type = type,
+        .color_format = color_format,
+        .use_shader_interlock = state.features.support_shader_interlock && gxm_fragment_shader->is_frag_color_used(),
+        // disable the fragment shader if gxm asks us to
+        .is_fragment_disabled = record.front_side_fragment_program_mode == SCE_GXM_FRAGMENT_PROGRAM_DISABLED || gxm_fragment_shader->has_no_effect(),
+        .frag_has_no_output = static_cast<bool>(gxm_fragment_shader->program_flags & SCE_GXM_PROGRAM_FLAG_OUTPUT_UNDEFINED),
+        .vertex_texture_count = vertex_program.texture_count,
+        .fragment_texture_count = fragment_program.texture_count,
+        .blending = fragment_program.blending
+    };
+
     // the vertex input state must be computed before shader are retrieved in case symbols are stripped
     const vk::PipelineVertexInputStateCreateInfo vertex_input = get_vertex_input_state(vertex_program_gxm, mem);
+    description.bindings.assign(vertex_input.pVertexBindingDescriptions, vertex_input.pVertexBindingDescriptions + vertex_input.vertexBindingDescriptionCount);
+    description.attributes.assign(vertex_input.pVertexAttributeDescriptions, vertex_input.pVertexAttributeDescriptions + vertex_input.vertexAttributeDescriptionCount);
+
+    const uint8_t *record_data = reinterpret_cast<const uint8_t *>(&record);
+    description.record_data.assign(record_data, record_data + record_pipeline_len);
+
+    return description;
+}
+
+vk::Pipeline PipelineCache::compile_pipeline(uint64_t key, SceGxmPrimitiveType type, vk::RenderPass render_pass, vk::Format color_format, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, const shader::Hints &hints, uint64_t first_use_frame, MemState &mem) {
+    const VertexProgram &vertex_program = *reinterpret_cast<VertexProgram *>(
+        vertex_program_gxm.renderer_data.get());
+    const SceGxmProgram *gxm_fragment_shader = fragment_program_gxm.program.get(mem);
+    const VKFragmentProgram &fragment_program = *reinterpret_cast<VKFragmentProgram *>(
+        fragment_program_gxm.renderer_data.get());
+
+    // describe it first, retrieving the shaders may strip the symbols used for the vertex input state
+    PipelineDescription description = describe_pipeline(key, type, color_format, vertex_program_gxm, fragment_program_gxm, record, mem);
+    description.first_use_frame = first_use_frame;
 
     const vk::PipelineShaderStageCreateInfo vertex_shader = retrieve_shader(vertex_program_gxm.program.get(mem), vertex_program.hash, true, fragment_program_gxm.is_maskupdate, mem, hints);
     const vk::PipelineShaderStageCreateInfo fragment_shader = retrieve_shader(gxm_fragment_shader, fragment_program.hash, false, fragment_program_gxm.is_maskupdate, mem, hints);
     const vk::PipelineShaderStageCreateInfo shader_stages[] = { vertex_shader, fragment_shader };
-    // disable the fragment shader if gxm asks us to
-    const bool is_fragment_disabled = record.front_side_fragment_program_mode == SCE_GXM_FRAGMENT_PROGRAM_DISABLED || gxm_fragment_shader->has_no_effect();
-    const uint32_t shader_stage_count = is_fragment_disabled ? 1U : 2U;
+
+    const vk::Pipeline pipeline = build_pipeline(description, shader_stages, render_pass);
+    if (pipeline) {
+        // remember it so that it can be built at boot next time
+        std::lock_guard<std::mutex> guard(descriptions_mutex);
+        if (described_pipelines.insert(key).second)
+            pipeline_descriptions.push_back(std::move(description));
+    }
+
+    return pipeline;
+}
+
+vk::Pipeline PipelineCache::build_pipeline(const PipelineDescription &description, const vk::PipelineShaderStageCreateInfo *shader_stages, vk::RenderPass render_pass, vk::GraphicsPipelineLibraryFlagsEXT library_parts) {
+    const GxmRecordState &record = *reinterpret_cast<const GxmRecordState *>(description.record_data.data());
+
+    vk::PipelineVertexInputStateCreateInfo vertex_input{};
+    vertex_input.setVertexBindingDescriptions(description.bindings);
+    vertex_input.setVertexAttributeDescriptions(description.attributes);
+
+    uint32_t shader_stage_count = description.is_fragment_disabled ? 1U : 2U;
+    if (library_parts) {
+        // a library only contains the shader of its part, the state of the other parts is ignored
+        if (library_parts & vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders) {
+            shader_stage_count = 1;
+        } else if (library_parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader) {
+            shader_stage_count = description.is_fragment_disabled ? 0U : 1U;
+            shader_stages++;
+        } else {
+            shader_stage_count = 0;
+        }
+    }
+
+    // the texture viewport of the shaders is enabled with the specialization constant 0
+    const vk::Bool32 use_texture_viewport = state.features.use_texture_viewport;
+    const vk::SpecializationMapEntry specialization_entry{
+        .constantID = 0,
+        .offset = 0,
+        .size = sizeof(vk::Bool32)
+    };
+    const vk::SpecializationInfo specialization_info{
+        .mapEntryCount = 1,
+        .pMapEntries = &specialization_entry,
+        .dataSize = sizeof(vk::Bool32),
+        .pData = &use_texture_viewport
+    };
+    std::array<vk::PipelineShaderStageCreateInfo, 2> specialized_stages;
+    for (uint32_t i = 0; i < shader_stage_count; i++) {
+        specialized_stages[i] = shader_stages[i];
+        if (state.features.spec_texture_viewport)
+            specialized_stages[i].pSpecializationInfo = &specialization_info;
+    }
 
     const vk::PipelineInputAssemblyStateCreateInfo input_assembly{
-        .topology = translate_primitive(type)
+        .topology = translate_primitive(description.type)
     };
 
     const bool two_sided = (record.two_sided == SCE_GXM_TWO_SIDED_ENABLED);
 
-    const bool use_shader_interlock = state.features.support_shader_interlock && gxm_fragment_shader->is_frag_color_used();
-
     const vk::PipelineRasterizationStateCreateInfo rasterizer{
         .depthClampEnable = state.physical_device_features.depthClamp,
         .polygonMode = translate_polygon_mode(record.front_polygon_mode),
@@ -752,8 +1021,7 @@ vk::Pipeline PipelineCache::compile_pipeline(SceGxmPrimitiveType type, vk::Rende
     };
 
     vk::PipelineColorBlendStateCreateInfo color_blending{};
-    const bool frag_has_no_output = static_cast<bool>(gxm_fragment_shader->program_flags & SCE_GXM_PROGRAM_FLAG_OUTPUT_UNDEFINED);
-    if (is_fragment_disabled || frag_has_no_output || use_shader_interlock) {
+    if (description.is_fragment_disabled || description.frag_has_no_output || description.use_shader_interlock) {
         // The write mask must be empty as the lack of a fragment shader results in undefined values
         static const vk::PipelineColorBlendAttachmentState blending = {
             .blendEnable = VK_FALSE,
@@ -761,15 +1029,17 @@ vk::Pipeline PipelineCache::compile_pipeline(SceGxmPrimitiveType type, vk::Rende
         };
         color_blending.setAttachments(blending);
     } else {
-        const vk::PipelineColorBlendAttachmentState &blending = fragment_program.blending;
-        color_blending.setAttachments(blending);
+        color_blending.setAttachments(description.blending);
+        // must match the subpass flag of the render pass
+        if (support_rasterization_order)
+            color_blending.flags = vk::PipelineColorBlendStateCreateFlagBits::eRasterizationOrderAttachmentAccessEXT;
     }
 
-    vk::PipelineLayout pipeline_layout = pipeline_layouts[vertex_program.texture_count][fragment_program.texture_count];
+    vk::PipelineLayout pipeline_layout = pipeline_layouts[description.vertex_texture_count][description.fragment_texture_count];
 
     // all of these can be changed at any time using the vita graphics api (like opengl)
     // Because each one can take a lot of different values, it's better to set them as dynamic
-    static vk::DynamicState dynamic_states[] = {
+    std::vector<vk::DynamicState> dynamic_states = {
         vk::DynamicState::eViewport,
         vk::DynamicState::eScissor,
         vk::DynamicState::eLineWidth,
@@ -778,6 +1048,31 @@ vk::Pipeline PipelineCache::compile_pipeline(SceGxmPrimitiveType type, vk::Rende
         vk::DynamicState::eStencilWriteMask,
         vk::DynamicState::eDepthBias
     };
+    // the values given above for these states are then ignored, they are set by set_dynamic_state
+    static constexpr vk::DynamicState extended_dynamic_states[] = {
+        vk::DynamicState::eCullModeEXT,
+        vk::DynamicState::eFrontFaceEXT,
+        vk::DynamicState::ePrimitiveTopologyEXT,
+        vk::DynamicState::eDepthTestEnableEXT,
+        vk::DynamicState::eDepthWriteEnableEXT,
+        vk::DynamicState::eDepthCompareOpEXT,
+        vk::DynamicState::eStencilTestEnableEXT,
+        vk::DynamicState::eStencilOpEXT
+    };
+    static constexpr vk::DynamicState blending_dynamic_states[] = {
+        vk::DynamicState::eColorBlendEnableEXT,
+        vk::DynamicState::eColorBlendEquationEXT,
+        vk::DynamicState::eColorWriteMaskEXT
+    };
+    if (support_dynamic_state)
+        dynamic_states.insert(dynamic_states.end(), std::begin(extended_dynamic_states), std::end(extended_dynamic_states));
+    if (support_dynamic_polygon_mode)
+        dynamic_states.push_back(vk::DynamicState::ePolygonModeEXT);
+    // the shader interlock render pass has no color attachment, so there is no blending state to set
+    if (support_dynamic_blending && !description.use_shader_interlock)
+        dynamic_states.insert(dynamic_states.end(), std::begin(blending_dynamic_states), std::end(blending_dynamic_states));
+    if (support_dynamic_vertex_input)
+        dynamic_states.push_back(vk::DynamicState::eVertexInputEXT);
     vk::PipelineDynamicStateCreateInfo dynamic_info{};
     dynamic_info.setDynamicStates(dynamic_states);
 
@@ -787,10 +1082,16 @@ vk::Pipeline PipelineCache::compile_pipeline(SceGxmPrimitiveType type, vk::Rende
         .scissorCount = 1
     };
 
+    const vk::GraphicsPipelineLibraryCreateInfoEXT library_info{
+        .flags = library_parts
+    };
+
     vk::GraphicsPipelineCreateInfo pipeline_info{
+        .pNext = library_parts ? &library_info : nullptr,
+        .flags = library_parts ? vk::PipelineCreateFlagBits::eLibraryKHR : vk::PipelineCreateFlags(),
         .stageCount = shader_stage_count,
-        .pStages = shader_stages,
-        .pVertexInputState = &vertex_input,
+        .pStages = specialized_stages.data(),
+        .pVertexInputState = support_dynamic_vertex_input ? nullptr : &vertex_input,
         .pInputAssemblyState = &input_assembly,
         .pViewportState = &viewport,
         .pRasterizationState = &rasterizer,
@@ -812,42 +1113,199 @@ vk::Pipeline PipelineCache::compile_pipeline(SceGxmPrimitiveType type, vk::Rende
     return result.value;
 }
 
+uint64_t PipelineCache::get_library_key(const PipelineDescription &description, vk::GraphicsPipelineLibraryFlagBitsEXT part, vk::RenderPass render_pass) const {
+    const GxmRecordState &record = *reinterpret_cast<const GxmRecordState *>(description.record_data.data());
+
+    uint64_t key = static_cast<uint64_t>(part);
+    auto add = [&](const void *data, size_t size) {
+        key = XXH3_64bits_withSeed(data, size, key);
+    };
+    const VkRenderPass vk_render_pass = render_pass;
+
+    // the states which can be set when drawing, they are the same for the pre-rasterization and fragment shader parts
+    constexpr size_t dynamic_begin = offsetof(GxmRecordState, cull_mode);
+    constexpr size_t dynamic_end = offsetof(GxmRecordState, front_side_fragment_program_mode);
+    const uint8_t *record_data = description.record_data.data();
+
+    switch (part) {
+    case vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface: {
+        if (!support_dynamic_vertex_input) {
+            add(description.bindings.data(), description.bindings.size() * sizeof(vk::VertexInputBindingDescription));
+            add(description.attributes.data(), description.attributes.size() * sizeof(vk::VertexInputAttributeDescription));
+        }
+        const uint32_t topology = support_dynamic_state ? get_topology_class(description.type) : static_cast<uint32_t>(description.type);
+        add(&topology, sizeof(topology));
+        break;
+    }
+    case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+        add(&description.vertex_hash, sizeof(Sha256Hash));
+        add(&description.vertex_texture_count, sizeof(uint16_t));
+        add(&description.fragment_texture_count, sizeof(uint16_t));
+        add(&vk_render_pass, sizeof(VkRenderPass));
+        if (!support_dynamic_state)
+            add(record_data + dynamic_begin, dynamic_end - dynamic_begin);
+        else if (!support_dynamic_polygon_mode)
+            add(&record.front_polygon_mode, sizeof(SceGxmPolygonMode));
+        break;
+    case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+        add(&description.fragment_hash, sizeof(Sha256Hash));
+        add(&description.is_fragment_disabled, sizeof(bool));
+        add(&description.vertex_texture_count, sizeof(uint16_t));
+        add(&description.fragment_texture_count, sizeof(uint16_t));
+        add(&vk_render_pass, sizeof(VkRenderPass));
+        if (!support_dynamic_state)
+            add(record_data + dynamic_begin, dynamic_end - dynamic_begin);
+        break;
+    default: {
+        // fragment output interface
+        const bool no_color_write = description.is_fragment_disabled || description.frag_has_no_output || description.use_shader_interlock;
+        add(&no_color_write, sizeof(bool));
+        add(&description.use_shader_interlock, sizeof(bool));
+        add(&vk_render_pass, sizeof(VkRenderPass));
+        if (!support_dynamic_blending)
+            add(&description.blending, sizeof(vk::PipelineColorBlendAttachmentState));
+        break;
+    }
+    }
+
+    return key;
+}
+
+vk::Pipeline PipelineCache::retrieve_pipeline_library(const PipelineDescription &description, vk::GraphicsPipelineLibraryFlagBitsEXT part, const vk::PipelineShaderStageCreateInfo *shader_stages, vk::RenderPass render_pass) {
+    const uint64_t key = get_library_key(description, part, render_pass);
+    auto it = pipeline_libraries.find(key);
+    if (it != pipeline_libraries.end())
+        return it->second;
+
+    const vk::Pipeline library = build_pipeline(description, shader_stages, render_pass, part);
+    if (library)
+        pipeline_libraries[key] = library;
+
+    return library;
+}
+
+bool PipelineCache::find_shader_stage(const Sha256Hash &hash, bool is_vertex, vk::PipelineShaderStageCreateInfo &shader_stage) {
+    const vk::ShaderModule shader_compiling = std::bit_cast<vk::ShaderModule>(~0ULL);
+
+    std::lock_guard<std::mutex> guard(shaders_mutex);
+    auto it = shaders.find(hash);
+    if (it == shaders.end() || it->second == nullptr || it->second == shader_compiling)
+        return false;
+
+    shader_stage = vk::PipelineShaderStageCreateInfo{
+        .stage = is_vertex ? vk::ShaderStageFlagBits::eVertex : vk::ShaderStageFlagBits::eFragment,
+        .module = it->second,
+        .pName = is_vertex ? "main_vs" : "main_fs"
+    };
+    return true;
+}
+
+vk::Pipeline PipelineCache::link_pipeline(uint64_t key, SceGxmPrimitiveType type, vk::RenderPass render_pass, vk::Format color_format, const SceGxmVertexProgram &vertex_program_gxm, const SceGxmFragmentProgram &fragment_program_gxm, const GxmRecordState &record, MemState &mem) {
+    const VertexProgram &vertex_program = *reinterpret_cast<VertexProgram *>(
+        vertex_program_gxm.renderer_data.get());
+    const VKFragmentProgram &fragment_program = *reinterpret_cast<VKFragmentProgram *>(
+        fragment_program_gxm.renderer_data.get());
+
+    // generating the shaders takes too long to be done here, leave this pipeline to the compile threads
+    vk::PipelineShaderStageCreateInfo shader_stages[2];
+    if (!find_shader_stage(vertex_program.hash, true, shader_stages[0]) || !find_shader_stage(fragment_program.hash, false, shader_stages[1]))
+        return nullptr;
+
+    const PipelineDescription description = describe_pipeline(key, type, color_format, vertex_program_gxm, fragment_program_gxm, record, mem);
+
+    static constexpr vk::GraphicsPipelineLibraryFlagBitsEXT parts[] = {
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface
+    };
+    std::array<vk::Pipeline, std::size(parts)> libraries;
+    for (size_t i = 0; i < std::size(parts); i++) {
+        libraries[i] = retrieve_pipeline_library(description, parts[i], shader_stages, render_pass);
+        if (!libraries[i])
+            return nullptr;
+    }
+
+    vk::PipelineLibraryCreateInfoKHR library_info{};
+    library_info.setLibraries(libraries);
+    // no link time optimization, this pipeline is only used until the complete one is compiled
+    const vk::GraphicsPipelineCreateInfo pipeline_info{
+        .pNext = &library_info,
+        .layout = pipeline_layouts[description.vertex_texture_count][description.fragment_texture_count],
+        .renderPass = render_pass,
+        .subpass = 0
+    };
+
+    const auto result = state.device.createGraphicsPipeline(pipeline_cache, pipeline_info);
+    if (result.result != vk::Result::eSuccess) {
+        LOG_ERROR("Failed to link pipeline.");
+        return nullptr;
+    }
+
+    return result.value;
+}
+
 vk::Pipeline PipelineCache::retrieve_pipeline(VKContext &context, SceGxmPrimitiveType &type, bool consider_for_async, MemState &mem) {
+    R_FRAME_TIMER(Pipeline);
     const GxmRecordState &record = context.record;
-    // get the hash of the current context
-    uint64_t key = XXH3_64bits(&record, record_pipeline_len);
-
-    // add the hash of the blending
     SceGxmFragmentProgram &fragment_program_gxm = *record.fragment_program.get(mem);
     const VKFragmentProgram &fragment_program = *reinterpret_cast<VKFragmentProgram *>(
         fragment_program_gxm.renderer_data.get());
-    key ^= fragment_program.blending_hash;
-
-    // add the hash of the attribute and stream layout
     SceGxmVertexProgram &vertex_program_gxm = *record.vertex_program.get(mem);
-    key ^= vertex_program_gxm.key_hash;
 
-    // and also add the primitive type
-    key ^= static_cast<uint64_t>(type);
+    uint64_t key;
+    if (support_dynamic_state) {
+        // the states from cull_mode to back_depth_write_mode are set when drawing, only hash the rest
+        constexpr size_t dynamic_begin = offsetof(GxmRecordState, cull_mode);
+        constexpr size_t dynamic_end = offsetof(GxmRecordState, front_side_fragment_program_mode);
+        key = XXH3_64bits(&record, dynamic_begin);
+        key ^= XXH3_64bits(reinterpret_cast<const uint8_t *>(&record) + dynamic_end, record_pipeline_len - dynamic_end);
+        if (!support_dynamic_polygon_mode)
+            key ^= XXH3_64bits(&record.front_polygon_mode, sizeof(SceGxmPolygonMode));
+
+        // the topology can only be changed to one of the same class
+        if (!support_unrestricted_topology)
+            key ^= static_cast<uint64_t>(get_topology_class(type));
+    } else {
+        // get the hash of the current context
+        key = XXH3_64bits(&record, record_pipeline_len);
+
+        // and also add the primitive type
+        key ^= static_cast<uint64_t>(type);
+    }
+
+    // add the hash of the blending
+    if (!support_dynamic_blending)
+        key ^= fragment_program.blending_hash;
+
+    // add the hash of the attribute and stream layout
+    if (!support_dynamic_vertex_input)
+        key ^= vertex_program_gxm.key_hash;
 
     // can't use constexpr because of apple clang...
     const vk::Pipeline pipeline_compiling = std::bit_cast<vk::Pipeline, uint64_t>(~0ULL);
     // if the pipeline is in the pipeline cache, we can expect its creation time to be almost instantaneous
     bool already_in_cache = false;
 
+    state.pipeline_lookups.fetch_add(1, std::memory_order_relaxed);
+
     auto it = pipelines.find(key);
     if (it != pipelines.end()) {
-        if (it->second != nullptr) {
-            if (it->second == pipeline_compiling)
-                // pipeline is still compiling
+        const vk::Pipeline pipeline = it->second.load(std::memory_order_acquire);
+        if (pipeline != nullptr) {
+            if (pipeline != pipeline_compiling)
+                return pipeline;
+
+            // pipeline is still compiling (asynchronously or by the warm-up), only skip the draw if it is safe
+            if (consider_for_async && use_async_compilation && can_use_deferred_compilation)
                 return nullptr;
-            else
-                return it->second;
+            it->second.wait(pipeline_compiling, std::memory_order_acquire);
+            return it->second.load(std::memory_order_acquire);
         }
         already_in_cache = true;
     } else {
         // the pipeline hash was not in the cache;
-        it = pipelines.insert({ key, pipeline_compiling }).first;
+        it = pipelines.try_emplace(key, pipeline_compiling).first;
     }
 
     // get the correct renderpass here
@@ -865,14 +1323,23 @@ vk::Pipeline PipelineCache::retrieve_pipeline(VKContext &context, SceGxmPrimitiv
         CompileRequest *request = new CompileRequest;
         *request = {
             .pipeline = &it->second,
+            .key = key,
             .type = type,
             .render_pass = render_pass,
+            .color_format = context.current_color_format,
+            .first_use_frame = context.frame_timestamp,
             .vertex_program_gxm = &vertex_program_gxm,
             .fragment_program_gxm = &fragment_program_gxm,
             .hints = context.shader_hints
         };
         memcpy(request->record_data, &record, record_pipeline_len);
-        it->second = pipeline_compiling;
+
+        // use a pipeline linked from already compiled parts until the complete one is ready
+        // this must be stored before the request is sent, the compile thread overwrites it
+        vk::Pipeline linked_pipeline = nullptr;
+        if (support_pipeline_library)
+            linked_pipeline = link_pipeline(key, type, render_pass, context.current_color_format, vertex_program_gxm, fragment_program_gxm, record, mem);
+        it->second.store(linked_pipeline ? linked_pipeline : pipeline_compiling, std::memory_order_relaxed);
 
         // we must not delete these programs until the worker is done
         vertex_program_gxm.compile_threads_on.fetch_add(1, std::memory_order_relaxed);
@@ -880,25 +1347,111 @@ vk::Pipeline PipelineCache::retrieve_pipeline(VKContext &context, SceGxmPrimitiv
 
         pipeline_compile_queue.enqueue(pipeline_compile_queue_token, request);
 
-        return nullptr;
+        return linked_pipeline;
     } else {
         // can't wait, compile it right now
-        vk::Pipeline result = compile_pipeline(type, render_pass, vertex_program_gxm, fragment_program_gxm, record, context.shader_hints, mem);
+        vk::Pipeline result = compile_pipeline(key, type, render_pass, context.current_color_format, vertex_program_gxm, fragment_program_gxm, record, context.shader_hints, context.frame_timestamp, mem);
 
         const auto time_s = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
         next_pipeline_cache_save = time_s + pipeline_cache_save_delay;
 
         state.shaders_count_compiled++;
+        state.pipeline_compiles.fetch_add(1, std::memory_order_relaxed);
 
-        it->second = result;
+        it->second.store(result, std::memory_order_relaxed);
 
         return result;
     }
 }
 
+void PipelineCache::set_dynamic_state(VKContext &context, SceGxmPrimitiveType type, MemState &mem) {
+    if (!support_dynamic_state)
+        return;
+
+    const GxmRecordState &record = context.record;
+    vk::CommandBuffer cmd = context.render_cmd;
+
+    cmd.setCullModeEXT(translate_cull_mode(record.cull_mode));
+    // front face is always counter clockwise
+    cmd.setFrontFaceEXT(vk::FrontFace::eCounterClockwise);
+    cmd.setPrimitiveTopologyEXT(translate_primitive(type));
+
+    // depth and stencil tests are always enabled, see build_pipeline
+    const bool two_sided = (record.two_sided == SCE_GXM_TWO_SIDED_ENABLED);
+    cmd.setDepthTestEnableEXT(VK_TRUE);
+    cmd.setDepthWriteEnableEXT(record.front_depth_write_mode == SCE_GXM_DEPTH_WRITE_ENABLED);
+    cmd.setDepthCompareOpEXT(translate_depth_func(record.front_depth_func));
+    cmd.setStencilTestEnableEXT(VK_TRUE);
+    const vk::StencilOpState front = convert_op_state(record.front_stencil_state_op);
+    const vk::StencilOpState back = convert_op_state(two_sided ? record.back_stencil_state_op : record.front_stencil_state_op);
+    cmd.setStencilOpEXT(vk::StencilFaceFlagBits::eFront, front.failOp, front.passOp, front.depthFailOp, front.compareOp);
+    cmd.setStencilOpEXT(vk::StencilFaceFlagBits::eBack, back.failOp, back.passOp, back.depthFailOp, back.compareOp);
+
+    if (support_dynamic_polygon_mode)
+        cmd.setPolygonModeEXT(translate_polygon_mode(record.front_polygon_mode));
+
+    if (support_dynamic_blending) {
+        const SceGxmFragmentProgram &fragment_program_gxm = *record.fragment_program.get(mem);
+        const SceGxmProgram *gxm_fragment_shader = fragment_program_gxm.program.get(mem);
+        const VKFragmentProgram &fragment_program = *reinterpret_cast<VKFragmentProgram *>(
+            fragment_program_gxm.renderer_data.get());
+        const vk::PipelineColorBlendAttachmentState &blending = fragment_program.blending;
+
+        // same conditions as in build_pipeline
+        const bool use_shader_interlock = state.features.support_shader_interlock && gxm_fragment_shader->is_frag_color_used();
+        const bool is_fragment_disabled = record.front_side_fragment_program_mode == SCE_GXM_FRAGMENT_PROGRAM_DISABLED || gxm_fragment_shader->has_no_effect();
+        const bool frag_has_no_output = static_cast<bool>(gxm_fragment_shader->program_flags & SCE_GXM_PROGRAM_FLAG_OUTPUT_UNDEFINED);
+        const bool no_color_write = is_fragment_disabled || frag_has_no_output || use_shader_interlock;
+
+        // the shader interlock render pass has no color attachment
+        if (!use_shader_interlock) {
+            const vk::Bool32 blend_enable = no_color_write ? VK_FALSE : blending.blendEnable;
+            const vk::ColorComponentFlags write_mask = no_color_write ? vk::ColorComponentFlags() : blending.colorWriteMask;
+            const vk::ColorBlendEquationEXT equation{
+                .srcColorBlendFactor = blending.srcColorBlendFactor,
+                .dstColorBlendFactor = blending.dstColorBlendFactor,
+                .colorBlendOp = blending.colorBlendOp,
+                .srcAlphaBlendFactor = blending.srcAlphaBlendFactor,
+                .dstAlphaBlendFactor = blending.dstAlphaBlendFactor,
+                .alphaBlendOp = blending.alphaBlendOp
+            };
+            cmd.setColorBlendEnableEXT(0, blend_enable);
+            cmd.setColorBlendEquationEXT(0, equation);
+            cmd.setColorWriteMaskEXT(0, write_mask);
+        }
+    }
+
+    if (support_dynamic_vertex_input) {
+        const vk::PipelineVertexInputStateCreateInfo vertex_input = get_vertex_input_state(*record.vertex_program.get(mem), mem);
+
+        static thread_local std::vector<vk::VertexInputBindingDescription2EXT> bindings;
+        static thread_local std::vector<vk::VertexInputAttributeDescription2EXT> attributes;
+        bindings.clear();
+        attributes.clear();
+        for (uint32_t i = 0; i < vertex_input.vertexBindingDescriptionCount; i++) {
+            const vk::VertexInputBindingDescription &binding = vertex_input.pVertexBindingDescriptions[i];
+            bindings.push_back(vk::VertexInputBindingDescription2EXT{
+                .binding = binding.binding,
+                .stride = binding.stride,
+                .inputRate = binding.inputRate,
+                .divisor = 1 });
+        }
+        for (uint32_t i = 0; i < vertex_input.vertexAttributeDescriptionCount; i++) {
+            const vk::VertexInputAttributeDescription &attribute = vertex_input.pVertexAttributeDescriptions[i];
+            attributes.push_back(vk::VertexInputAttributeDescription2EXT{
+                .location = attribute.location,
+                .binding = attribute.binding,
+                .format = attribute.format,
+                .offset = attribute.offset });
+        }
+        cmd.setVertexInputEXT(bindings, attributes);
+    }
+}
+
 vk::ShaderModule PipelineCache::precompile_shader(const Sha256Hash &hash, bool search_first) {
     if (search_first) {
-        // happens while loading the thread, no parallel access so no need for a mutex
+        // happens while loading, but the warm-up does it on multiple threads
+        std::lock_guard<std::mutex> guard(shaders_mutex);
         auto it = shaders.find(hash);
         if (it != shaders.end())
             return it->second;
@@ -926,9 +1479,119 @@ vk::ShaderModule PipelineCache::precompile_shader(const Sha256Hash &hash, bool s
     vk::ShaderModule shader = state.device.createShaderModule(shader_info);
     {
         std::lock_guard<std::mutex> guard(shaders_mutex);
-        shaders[hash] = shader;
+        if (search_first) {
+            // another warm-up thread may have loaded the same shader in the meantime
+            const auto [it, inserted] = shaders.try_emplace(hash, shader);
+            if (!inserted) {
+                state.device.destroyShaderModule(shader);
+                return it->second;
+            }
+        } else {
+            shaders[hash] = shader;
+        }
     }
 
     return shader;
 }
+
+void PipelineCache::warmup_pipeline(const PipelineDescription &description, vk::RenderPass render_pass, std::atomic<vk::Pipeline> *pipeline) {
+    const vk::ShaderModule vertex_module = precompile_shader(description.vertex_hash);
+    const vk::ShaderModule fragment_module = description.is_fragment_disabled ? vk::ShaderModule() : precompile_shader(description.fragment_hash);
+
+    // if a shader is not on the disk anymore, the pipeline will be compiled the first time it is used
+    vk::Pipeline result = nullptr;
+    if (vertex_module && (fragment_module || description.is_fragment_disabled)) {
+        const vk::PipelineShaderStageCreateInfo shader_stages[] = {
+            vk::PipelineShaderStageCreateInfo{
+                .stage = vk::ShaderStageFlagBits::eVertex,
+                .module = vertex_module,
+                .pName = "main_vs" },
+            vk::PipelineShaderStageCreateInfo{
+                .stage = vk::ShaderStageFlagBits::eFragment,
+                .module = fragment_module,
+                .pName = "main_fs" }
+        };
+        result = build_pipeline(description, shader_stages, render_pass);
+    }
+
+    pipeline->store(result, std::memory_order_release);
+}
+
+uint32_t PipelineCache::start_warmup(const std::vector<ShadersHash> &shaders_hashs) {
+    if (nb_worker_threads == 0)
+        return 0;
+
+    // can't use constexpr because of apple clang...
+    const vk::Pipeline pipeline_compiling = std::bit_cast<vk::Pipeline, uint64_t>(~0ULL);
+
+    // without async compilation the compile threads are not running, launch them only for the warm-up
+    const bool launch_threads = !use_async_compilation;
+    if (launch_threads) {
+        for (int i = 0; i < nb_worker_threads; i++) {
+            std::thread thread(&PipelineCache::compiler_thread, this, std::ref(*state.mem));
+            thread.detach();
+        }
+    }
+
+    uint32_t nb_pipelines = 0;
+    uint32_t nb_boot_tasks = 0;
+    {
+        std::lock_guard<std::mutex> guard(descriptions_mutex);
+        // the pipelines needed by the first frames are built first
+        std::vector<const PipelineDescription *> ordered_descriptions;
+        for (const PipelineDescription &description : pipeline_descriptions)
+            ordered_descriptions.push_back(&description);
+        std::stable_sort(ordered_descriptions.begin(), ordered_descriptions.end(), [](const PipelineDescription *a, const PipelineDescription *b) {
+            return a->first_use_frame < b->first_use_frame;
+        });
+
+        for (const PipelineDescription *description_ptr : ordered_descriptions) {
+            const PipelineDescription &description = *description_ptr;
+            std::atomic<vk::Pipeline> &pipeline = pipelines[description.key];
+            if (pipeline.load(std::memory_order_relaxed) != nullptr)
+                continue;
+
+            // render passes are not created in a thread safe way, so do it here
+            // the load and store operations don't matter for the render pass compatibility
+            const vk::RenderPass render_pass = description.use_shader_interlock
+                ? retrieve_render_pass(description.color_format, true, true, true)
+                : retrieve_render_pass(description.color_format, false, false);
+
+            pipeline.store(pipeline_compiling, std::memory_order_relaxed);
+            CompileRequest *request = new CompileRequest{
+                .pipeline = &pipeline,
+                .warmup_description = &description,
+                .render_pass = render_pass
+            };
+            pipeline_compile_queue.enqueue(pipeline_compile_queue_token, request);
+            nb_pipelines++;
+            if (description.first_use_frame <= warmup_boot_frames)
+                nb_boot_tasks = nb_pipelines;
+        }
+    }
+
+    // the shaders of the pipelines are already loaded by now, this is only useful for the pipelines never built
+    for (const ShadersHash &hash : shaders_hashs) {
+        CompileRequest *request = new CompileRequest{
+            .pipeline = nullptr,
+            .warmup_shaders = hash
+        };
+        pipeline_compile_queue.enqueue(pipeline_compile_queue_token, request);
+    }
+
+    if (launch_threads) {
+        // the threads exit once all the requests before these are done
+        for (int i = 0; i < nb_worker_threads; i++)
+            pipeline_compile_queue.enqueue(pipeline_compile_queue_token, nullptr);
+    }
+
+    LOG_INFO("Warming up {} shader programs and {} pipelines on {} threads, {} pipelines before booting", shaders_hashs.size(), nb_pipelines, nb_worker_threads, nb_boot_tasks);
+
+    // with no pipeline description, the shaders are all loaded before booting like before
+    if (nb_pipelines == 0)
+        return static_cast<uint32_t>(shaders_hashs.size());
+
+    // 0 would mean the warm-up is not done on the compile threads
+    return std::max(nb_boot_tasks, 1U);
+}
 } // namespace renderer::vulkan
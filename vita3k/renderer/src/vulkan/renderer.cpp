@@ -16,6 +16,7 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include <renderer/functions.h>
+#include <renderer/profile.h>
 #include <renderer/types.h>
 #include <renderer/vulkan/functions.h>
 #include <renderer/vulkan/state.h>
@@ -23,6 +24,7 @@
 #include <config/state.h>
 #include <config/version.h>
 #include <display/state.h>
+#include <mem/util.h>
 #include <shader/spirv_recompiler.h>
 #include <util/align.h>
 #include <util/float_to_half.h>
@@ -122,12 +124,13 @@ static bool select_queues(VKState &vk_state,
             };
             queue_infos.emplace_back(std::move(queue_create_info));
             vk_state.general_family_index = i;
-            vk_state.transfer_family_index = i;
+            if (!found_transfer)
+                vk_state.transfer_family_index = i;
             found_graphics = true;
-            found_transfer = true;
-        }
-        // for now use the same queue for graphics and transfer, to be improved on later
-        /* else if (!found_transfer && queue_family.queueFlags & vk::QueueFlagBits::eTransfer) {
+        } else if (!found_transfer && (queue_family.queueFlags & vk::QueueFlagBits::eTransfer)
+            && !(queue_family.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))
+            && queue_family.minImageTransferGranularity == vk::Extent3D{ 1, 1, 1 }) {
+            // dedicated transfer queue (DMA engine), whole images can be copied with it
             vk::DeviceQueueCreateInfo queue_create_info{
                 .queueFamilyIndex = i,
                 .queueCount = queue_family.queueCount,
@@ -137,13 +140,13 @@ static bool select_queues(VKState &vk_state,
             vk_state.transfer_family_index = i;
             found_transfer = true;
         }
-        */
 
         if (found_graphics && found_transfer)
             break;
     }
 
-    return found_graphics && found_transfer;
+    // without a dedicated transfer queue, the general queue is used for the transfers
+    return found_graphics;
 }
 
 // Adapted from https://github.com/SaschaWillems/vulkan.gpuinfo.org/blob/master/includes/functions.php
@@ -168,6 +171,51 @@ bool create(SDL_Window *window, std::unique_ptr<renderer::State> &state, const C
     return vk_state.create(window, state, config);
 }
 
+// size classes of the image pools, an image goes in the first class it fits in
+static constexpr vk::DeviceSize small_texture_max_size = MiB(1);
+static constexpr vk::DeviceSize small_texture_block_size = MiB(32);
+static constexpr vk::DeviceSize large_texture_max_size = MiB(16);
+static constexpr vk::DeviceSize large_texture_block_size = MiB(128);
+static constexpr vk::DeviceSize surface_max_size = MiB(32);
+static constexpr vk::DeviceSize surface_block_size = MiB(128);
+
+// the memory type of each pool is the one of a typical image it holds
+static void create_image_pools(VKState &state) {
+    vk::ImageCreateInfo image_info{
+        .imageType = vk::ImageType::e2D,
+        .format = vk::Format::eR8G8B8A8Unorm,
+        .extent = vk::Extent3D{ 256, 256, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined,
+    };
+
+    try {
+        const uint32_t texture_memory_type = state.allocator.findMemoryTypeIndexForImageInfo(image_info, vkutil::vma_auto_alloc);
+        state.texture_heap_index = state.physical_device_memory.memoryTypes[texture_memory_type].heapIndex;
+        state.small_texture_pool = state.allocator.createPool(vma::PoolCreateInfo{
+            .memoryTypeIndex = texture_memory_type,
+            .blockSize = small_texture_block_size });
+        state.large_texture_pool = state.allocator.createPool(vma::PoolCreateInfo{
+            .memoryTypeIndex = texture_memory_type,
+            .blockSize = large_texture_block_size });
+
+        image_info.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled
+            | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+        const uint32_t surface_memory_type = state.allocator.findMemoryTypeIndexForImageInfo(image_info, vkutil::vma_auto_alloc);
+        state.surface_pool = state.allocator.createPool(vma::PoolCreateInfo{
+            .memoryTypeIndex = surface_memory_type,
+            .blockSize = surface_block_size });
+    } catch (vk::SystemError &err) {
+        // the images are then allocated without pools
+        LOG_WARN("Failed to create the image pools: {}", err.what());
+    }
+}
+
 VKState::VKState(int gpu_idx)
     : gpu_idx(gpu_idx)
     , surface_cache(*this)
@@ -372,10 +420,21 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
         bool support_buffer_device_address = false;
         bool support_external_memory = false;
         bool support_shader_interlock = false;
+        bool support_rasterization_order = false;
+        bool support_rasterization_order_arm = false;
+        bool support_dynamic_state = false;
+        bool support_dynamic_state3 = false;
+        bool support_dynamic_vertex_input = false;
+        bool support_pipeline_library = false;
+        bool support_present_id = false;
+        bool support_present_wait = false;
+        bool support_library_extension = false;
         const std::map<std::string_view, bool *> optional_extensions = {
             { VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME, &temp_bool },
             // can be used by vma to improve performance
             { VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME, &support_dedicated_allocations },
+            // used by vma to know how much memory the heaps have left
+            { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, &support_memory_budget },
             // used to tell the driver this application is high priority
             { VK_EXT_GLOBAL_PRIORITY_EXTENSION_NAME, &support_global_priority },
             // can be used to specify which format will be used by mutable images
@@ -390,8 +449,25 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
             { VK_KHR_UNIFORM_BUFFER_STANDARD_LAYOUT_EXTENSION_NAME, &support_standard_layout },
             // needed for FSR
             { VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME, &support_fsr },
+            // used to avoid allocating and writing a descriptor set each time the fragment textures change
+            { VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME, &support_push_descriptor },
             // used for accurate programmable blending on desktop GPUs
             { VK_EXT_FRAGMENT_SHADER_INTERLOCK_EXTENSION_NAME, &support_shader_interlock },
+            // used for programmable blending with subpass inputs without a barrier between draws (mostly mobile and AMD GPUs)
+            { VK_EXT_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_EXTENSION_NAME, &support_rasterization_order },
+            { VK_ARM_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_EXTENSION_NAME, &support_rasterization_order_arm },
+            // used to set most of the pipeline state when drawing, reducing the number of pipelines to compile
+            { VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME, &support_dynamic_state },
+            { VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME, &support_dynamic_state3 },
+            { VK_EXT_VERTEX_INPUT_DYNAMIC_STATE_EXTENSION_NAME, &support_dynamic_vertex_input },
+            // used to link a pipeline quickly from precompiled parts while waiting for the complete one
+            { VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, &support_library_extension },
+            { VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME, &support_pipeline_library },
+            // used to track the gpu progress with a single counter instead of fences
+            { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, &support_timeline_semaphore },
+            // used by the low latency mode to wait for the previous frame to be displayed
+            { VK_KHR_PRESENT_ID_EXTENSION_NAME, &support_present_id },
+            { VK_KHR_PRESENT_WAIT_EXTENSION_NAME, &support_present_wait },
 #ifdef __APPLE__
             // Needed to create the MoltenVK device
             { VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME, &temp_bool },
@@ -458,6 +534,12 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
             }
         }
 
+        if (support_push_descriptor) {
+            // we need to push at most 16 textures, the spec guarantees at least 32
+            auto props = physical_device.getProperties2KHR<vk::PhysicalDeviceProperties2, vk::PhysicalDevicePushDescriptorPropertiesKHR>();
+            support_push_descriptor = props.get<vk::PhysicalDevicePushDescriptorPropertiesKHR>().maxPushDescriptors >= SCE_GXM_MAX_TEXTURE_UNITS;
+        }
+
         support_fsr &= static_cast<bool>(physical_device_features.shaderInt16);
         if (support_fsr) {
             // double check for FP16 support
@@ -472,11 +554,83 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
             features.support_shader_interlock = support_shader_interlock;
         }
 
+        if (support_rasterization_order && support_rasterization_order_arm) {
+            // the ARM extension is the same as the EXT one, only enable one of them
+            std::erase(device_extensions, std::string_view(VK_ARM_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_EXTENSION_NAME));
+        }
+        support_rasterization_order |= support_rasterization_order_arm;
+        if (support_rasterization_order) {
+            auto props = physical_device.getFeatures2KHR<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceRasterizationOrderAttachmentAccessFeaturesEXT>();
+            support_rasterization_order = static_cast<bool>(props.get<vk::PhysicalDeviceRasterizationOrderAttachmentAccessFeaturesEXT>().rasterizationOrderColorAttachmentAccess);
+            pipeline_cache.support_rasterization_order = support_rasterization_order;
+        }
+
+        vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT dynamic_state3_features{};
+        if (support_dynamic_state) {
+            auto props = physical_device.getFeatures2KHR<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
+            support_dynamic_state = static_cast<bool>(props.get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState);
+        }
+        // the other dynamic states are only used along the base one
+        support_dynamic_state3 &= support_dynamic_state;
+        support_dynamic_vertex_input &= support_dynamic_state;
+        if (support_dynamic_state3) {
+            auto props = physical_device.getFeatures2KHR<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+            const vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT &supported = props.get<vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+            // polygon mode is only useful if non-solid fill modes can be used
+            pipeline_cache.support_dynamic_polygon_mode = static_cast<bool>(supported.extendedDynamicState3PolygonMode && physical_device_features.fillModeNonSolid);
+            pipeline_cache.support_dynamic_blending = static_cast<bool>(supported.extendedDynamicState3ColorBlendEnable && supported.extendedDynamicState3ColorBlendEquation && supported.extendedDynamicState3ColorWriteMask);
+            dynamic_state3_features.extendedDynamicState3PolygonMode = pipeline_cache.support_dynamic_polygon_mode;
+            dynamic_state3_features.extendedDynamicState3ColorBlendEnable = pipeline_cache.support_dynamic_blending;
+            dynamic_state3_features.extendedDynamicState3ColorBlendEquation = pipeline_cache.support_dynamic_blending;
+            dynamic_state3_features.extendedDynamicState3ColorWriteMask = pipeline_cache.support_dynamic_blending;
+
+            auto dynamic_props = physical_device.getProperties2KHR<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceExtendedDynamicState3PropertiesEXT>();
+            pipeline_cache.support_unrestricted_topology = static_cast<bool>(dynamic_props.get<vk::PhysicalDeviceExtendedDynamicState3PropertiesEXT>().dynamicPrimitiveTopologyUnrestricted);
+        }
+        if (support_dynamic_vertex_input) {
+            auto props = physical_device.getFeatures2KHR<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVertexInputDynamicStateFeaturesEXT>();
+            support_dynamic_vertex_input = static_cast<bool>(props.get<vk::PhysicalDeviceVertexInputDynamicStateFeaturesEXT>().vertexInputDynamicState);
+        }
+        support_pipeline_library &= support_library_extension;
+        if (support_pipeline_library) {
+            auto props = physical_device.getFeatures2KHR<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+            support_pipeline_library = static_cast<bool>(props.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>().graphicsPipelineLibrary);
+        }
+        if (support_pipeline_library) {
+            // linking is only worth it if it is fast
+            auto library_props = physical_device.getProperties2KHR<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT>();
+            pipeline_cache.support_pipeline_library = static_cast<bool>(library_props.get<vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT>().graphicsPipelineLibraryFastLinking);
+            if (pipeline_cache.support_pipeline_library)
+                LOG_INFO("Using graphics pipeline libraries");
+        }
+        if (support_timeline_semaphore) {
+            auto props = physical_device.getFeatures2KHR<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+            support_timeline_semaphore = static_cast<bool>(props.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>().timelineSemaphore);
+        }
+        support_present_wait &= support_present_id;
+        if (support_present_wait) {
+            auto props = physical_device.getFeatures2KHR<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR>();
+            support_present_wait = props.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId && props.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+        }
+        screen_renderer.support_present_wait = support_present_wait;
+        pipeline_cache.support_dynamic_state = support_dynamic_state;
+        pipeline_cache.support_dynamic_vertex_input = support_dynamic_vertex_input;
+        if (support_dynamic_state)
+            LOG_INFO("Using extended dynamic state (polygon mode: {}, blending: {}, vertex input: {})", pipeline_cache.support_dynamic_polygon_mode, pipeline_cache.support_dynamic_blending, support_dynamic_vertex_input);
+
         vk::StructureChain<vk::DeviceCreateInfo,
             vk::PhysicalDeviceBufferDeviceAddressFeatures,
             vk::PhysicalDeviceUniformBufferStandardLayoutFeatures,
             vk::PhysicalDeviceShaderFloat16Int8Features,
-            vk::PhysicalDeviceFragmentShaderInterlockFeaturesEXT>
+            vk::PhysicalDeviceFragmentShaderInterlockFeaturesEXT,
+            vk::PhysicalDeviceRasterizationOrderAttachmentAccessFeaturesEXT,
+            vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
+            vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT,
+            vk::PhysicalDeviceVertexInputDynamicStateFeaturesEXT,
+            vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT,
+            vk::PhysicalDevicePresentIdFeaturesKHR,
+            vk::PhysicalDevicePresentWaitFeaturesKHR,
+            vk::PhysicalDeviceTimelineSemaphoreFeatures>
             device_info{
                 vk::DeviceCreateInfo{
                     .pEnabledFeatures = &enabled_features },
@@ -488,7 +642,22 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
                     // FSR uses float16
                     .shaderFloat16 = VK_TRUE },
                 vk::PhysicalDeviceFragmentShaderInterlockFeaturesEXT{
-                    .fragmentShaderSampleInterlock = VK_TRUE }
+                    .fragmentShaderSampleInterlock = VK_TRUE },
+                vk::PhysicalDeviceRasterizationOrderAttachmentAccessFeaturesEXT{
+                    .rasterizationOrderColorAttachmentAccess = VK_TRUE },
+                vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT{
+                    .extendedDynamicState = VK_TRUE },
+                dynamic_state3_features,
+                vk::PhysicalDeviceVertexInputDynamicStateFeaturesEXT{
+                    .vertexInputDynamicState = VK_TRUE },
+                vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT{
+                    .graphicsPipelineLibrary = VK_TRUE },
+                vk::PhysicalDevicePresentIdFeaturesKHR{
+                    .presentId = VK_TRUE },
+                vk::PhysicalDevicePresentWaitFeaturesKHR{
+                    .presentWait = VK_TRUE },
+                vk::PhysicalDeviceTimelineSemaphoreFeatures{
+                    .timelineSemaphore = VK_TRUE }
             };
         device_info.get().setQueueCreateInfos(queue_infos);
         device_info.get().setPEnabledExtensionNames(device_extensions);
@@ -505,6 +674,29 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
         if (!support_shader_interlock)
             device_info.unlink<vk::PhysicalDeviceFragmentShaderInterlockFeaturesEXT>();
 
+        if (!support_rasterization_order)
+            device_info.unlink<vk::PhysicalDeviceRasterizationOrderAttachmentAccessFeaturesEXT>();
+
+        if (!support_dynamic_state)
+            device_info.unlink<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
+
+        if (!support_dynamic_state3)
+            device_info.unlink<vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+
+        if (!support_dynamic_vertex_input)
+            device_info.unlink<vk::PhysicalDeviceVertexInputDynamicStateFeaturesEXT>();
+
+        if (!support_pipeline_library)
+            device_info.unlink<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+
+        if (!support_present_wait) {
+            device_info.unlink<vk::PhysicalDevicePresentIdFeaturesKHR>();
+            device_info.unlink<vk::PhysicalDevicePresentWaitFeaturesKHR>();
+        }
+
+        if (!support_timeline_semaphore)
+            device_info.unlink<vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+
         try {
             device = physical_device.createDevice(device_info.get());
         } catch (vk::NotPermittedKHRError &) {
@@ -523,6 +715,18 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
     general_queue = device.getQueue(general_family_index, 0);
     transfer_queue = device.getQueue(transfer_family_index, 0);
 
+    {
+        const uint32_t valid_bits = physical_device_queue_families[general_family_index].timestampValidBits;
+        timestamp_period = physical_device_properties.limits.timestampPeriod;
+        support_timestamps = valid_bits > 0 && timestamp_period > 0.0f;
+        timestamp_mask = valid_bits >= 64 ? ~0ULL : ((1ULL << valid_bits) - 1);
+    }
+
+    for (uint32_t i = 0; i < physical_device_memory.memoryTypeCount; i++) {
+        if (physical_device_memory.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated)
+            support_lazy_memory = true;
+    }
+
     // Create Command Pools
     {
         vk::CommandPoolCreateInfo general_pool_info{
@@ -562,8 +766,13 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
         if (features.support_memory_mapping)
             allocator_info.flags |= vma::AllocatorCreateFlagBits::eBufferDeviceAddress;
 
+        if (support_memory_budget)
+            allocator_info.flags |= vma::AllocatorCreateFlagBits::eExtMemoryBudget;
+
         allocator = vma::createAllocator(allocator_info);
         vkutil::init(allocator);
+
+        create_image_pools(*this);
     }
 
     // create the default image and buffer
@@ -599,6 +808,23 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
         default_image.sampler = device.createSampler(sampler_info);
     }
 
+    if (support_timeline_semaphore) {
+        vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> semaphore_info{
+            {},
+            vk::SemaphoreTypeCreateInfo{
+                .semaphoreType = vk::SemaphoreType::eTimeline,
+                .initialValue = 0 }
+        };
+        gpu_timeline = device.createSemaphore(semaphore_info.get());
+        LOG_INFO("Using a timeline semaphore to track the GPU progress");
+
+        use_transfer_queue = (transfer_family_index != general_family_index);
+        if (use_transfer_queue) {
+            transfer_timeline = device.createSemaphore(semaphore_info.get());
+            LOG_INFO("Using a dedicated transfer queue for the texture uploads");
+        }
+    }
+
     // create the frame objects
     for (int i = 0; i < MAX_FRAMES_RENDERING; i++) {
         FrameObject &frame = frames[i];
@@ -611,7 +837,23 @@ bool VKState::create(SDL_Window *window, std::unique_ptr<renderer::State> &state
         pool_info.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
         frame.prerender_pool = device.createCommandPool(pool_info);
 
+        if (use_transfer_queue) {
+            const vk::CommandPoolCreateInfo transfer_pool_info{
+                .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                .queueFamilyIndex = transfer_family_index
+            };
+            frame.transfer_pool = device.createCommandPool(transfer_pool_info);
+        }
+
         frame.destroy_queue.init(device);
+
+        if (support_timestamps) {
+            vk::QueryPoolCreateInfo query_pool_info{
+                .queryType = vk::QueryType::eTimestamp,
+                .queryCount = MAX_SCENE_TIMESTAMPS * 2
+            };
+            frame.timestamp_pool = device.createQueryPool(query_pool_info);
+        }
     }
 
     if (!screen_renderer.setup())
@@ -633,7 +875,12 @@ void VKState::late_init(const Config &cfg, const std::string_view game_id, MemSt
     bool use_high_accuracy = cfg.current_config.high_accuracy;
 
     // shader interlock is more accurate but slower
-    if (features.support_shader_interlock && use_high_accuracy) {
+    // with rasterization order attachment access, subpass inputs are as accurate and faster, so they are always used
+    if (pipeline_cache.support_rasterization_order) {
+        LOG_INFO("Using rasterization order attachment access for framebuffer fetch emulation");
+        features.direct_fragcolor = true;
+        features.support_shader_interlock = false;
+    } else if (features.support_shader_interlock && use_high_accuracy) {
         LOG_INFO("Using shader interlock for accurate framebuffer fetch emulation");
     } else {
         // We use subpass input to get something similar to direct fragcolor access (there is no difference for the shader)
@@ -646,11 +893,45 @@ void VKState::late_init(const Config &cfg, const std::string_view game_id, MemSt
         LOG_INFO("The Vulkan renderer is using texture viewport for better performance");
         features.use_texture_viewport = true;
     }
+    // the shaders contain the texture viewport code in both cases, it is enabled when building the pipelines
+    features.spec_texture_viewport = support_standard_layout;
+
+    features.optimize_spirv = cfg.optimize_shaders;
 
     pipeline_cache.init();
 
+    surface_cache.use_async_surface_sync = cfg.async_surface_sync && surface_cache.can_mprotect_mapped_memory;
+
+    screen_renderer.use_present_wait = cfg.low_latency && screen_renderer.support_present_wait;
+    if (cfg.low_latency && !screen_renderer.use_present_wait)
+        LOG_WARN("Low latency mode is enabled but VK_KHR_present_wait is not supported");
+
     const fs::path texture_folder = fs::path(shared_path) / "textures";
+    texture_cache.prewarm_imports = cfg.prewarm_texture_import;
     texture_cache.init(false, texture_folder, game_id);
+    if (cfg.texture_cache_budget > 0) {
+        texture_cache.set_memory_budget(static_cast<uint64_t>(cfg.texture_cache_budget) * MiB(1));
+        auto_texture_budget = 0;
+    } else {
+        // by default, let the textures use half of the largest device local heap
+        vk::DeviceSize heap_size = 0;
+        for (uint32_t i = 0; i < physical_device_memory.memoryHeapCount; i++) {
+            const vk::MemoryHeap &heap = physical_device_memory.memoryHeaps[i];
+            if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+                heap_size = std::max(heap_size, heap.size);
+        }
+        auto_texture_budget = heap_size / 2;
+        texture_cache.set_memory_budget(auto_texture_budget);
+    }
+    if (cfg.gpu_texture_decode)
+        texture_cache.use_gpu_decode = texture_cache.init_gpu_decode();
+    texture_cache.use_mipmap_generation = cfg.gpu_mipmap_generation;
+    if (cfg.texture_disk_cache)
+        texture_cache.open_disk_cache(fs::path(cache_path) / "textures" / std::string(game_id));
+    if (cfg.async_texture_decode)
+        texture_cache.start_decode_workers(mem);
+    if (cfg.async_texture_import)
+        texture_cache.start_import_worker();
 }
 
 void VKState::cleanup() {
@@ -658,17 +939,154 @@ void VKState::cleanup() {
 
     screen_renderer.cleanup();
 
+    for (vma::Pool pool : { small_texture_pool, large_texture_pool, surface_pool }) {
+        if (pool)
+            allocator.destroyPool(pool);
+    }
     allocator.destroy();
 
     device.destroy(general_command_pool);
     device.destroy(transfer_command_pool);
+    if (gpu_timeline)
+        device.destroy(gpu_timeline);
+    if (transfer_timeline)
+        device.destroy(transfer_timeline);
 
     device.destroy();
     instance.destroy();
 }
 
+void VKState::submit_general(vk::SubmitInfo &submit_info, vk::Fence fence) {
+    if (!support_timeline_semaphore) {
+        general_queue.submit(submit_info, fence);
+        return;
+    }
+
+    // the uploads recorded on the transfer queue must be done before the commands using them
+    const vk::PipelineStageFlags transfer_wait_stage = vk::PipelineStageFlagBits::eTransfer;
+    if (transfer_cmd) {
+        assert(submit_info.waitSemaphoreCount == 0);
+        transfer_cmd.end();
+
+        transfer_timeline_value++;
+        const vk::TimelineSemaphoreSubmitInfo transfer_timeline_info{
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &transfer_timeline_value
+        };
+        vk::SubmitInfo transfer_submit_info{
+            .pNext = &transfer_timeline_info
+        };
+        transfer_submit_info.setCommandBuffers(transfer_cmd);
+        transfer_submit_info.setSignalSemaphores(transfer_timeline);
+        transfer_queue.submit(transfer_submit_info);
+        transfer_cmd = nullptr;
+
+        submit_info.setWaitSemaphores(transfer_timeline);
+        submit_info.setWaitDstStageMask(transfer_wait_stage);
+    }
+
+    gpu_timeline_value++;
+    vk::TimelineSemaphoreSubmitInfo timeline_info{
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &gpu_timeline_value
+    };
+    if (submit_info.waitSemaphoreCount > 0)
+        timeline_info.setWaitSemaphoreValues(transfer_timeline_value);
+    submit_info.pNext = &timeline_info;
+    submit_info.setSignalSemaphores(gpu_timeline);
+    general_queue.submit(submit_info, fence);
+}
+
+vk::CommandBuffer VKState::get_transfer_cmd() {
+    assert(use_transfer_queue);
+    if (transfer_cmd)
+        return transfer_cmd;
+
+    const vk::CommandBufferAllocateInfo cmd_buffer_info{
+        .commandPool = frame().transfer_pool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = 1
+    };
+    transfer_cmd = device.allocateCommandBuffers(cmd_buffer_info)[0];
+
+    const vk::CommandBufferBeginInfo begin_info{
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+    };
+    transfer_cmd.begin(begin_info);
+    return transfer_cmd;
+}
+
+bool VKState::wait_gpu_timeline(uint64_t value) {
+    const vk::SemaphoreWaitInfo wait_info{
+        .semaphoreCount = 1,
+        .pSemaphores = &gpu_timeline,
+        .pValues = &value
+    };
+    const vk::Result result = device.waitSemaphoresKHR(wait_info, std::numeric_limits<uint64_t>::max());
+    if (result != vk::Result::eSuccess) {
+        LOG_ERROR("Could not wait for the GPU timeline.");
+        return false;
+    }
+    return true;
+}
+
+uint64_t VKState::get_gpu_timeline_progress() {
+    return device.getSemaphoreCounterValueKHR(gpu_timeline);
+}
+
+vma::AllocationCreateInfo VKState::get_texture_alloc_info(const vk::ImageCreateInfo &image_info) const {
+    // upper bound, 4 bytes per texel (compressed formats use less) and mips adding half of the base level
+    vk::DeviceSize size = static_cast<vk::DeviceSize>(image_info.extent.width) * image_info.extent.height * 4 * image_info.arrayLayers;
+    if (image_info.mipLevels > 1)
+        size += size / 2;
+
+    vma::AllocationCreateInfo alloc_info = vkutil::vma_auto_alloc;
+    if (size <= small_texture_max_size)
+        alloc_info.pool = small_texture_pool;
+    else if (size <= large_texture_max_size)
+        alloc_info.pool = large_texture_pool;
+    return alloc_info;
+}
+
+vma::AllocationCreateInfo VKState::get_surface_alloc_info(uint32_t width, uint32_t height) const {
+    vma::AllocationCreateInfo alloc_info = vkutil::vma_auto_alloc;
+    if (static_cast<vk::DeviceSize>(width) * height * 4 <= surface_max_size)
+        alloc_info.pool = surface_pool;
+    return alloc_info;
+}
+
+void VKState::update_memory_budget() {
+    if (!support_memory_budget || auto_texture_budget == 0)
+        return;
+
+    // the heap budgets are fetched again by vma when the frame index changes
+    allocator.setCurrentFrameIndex(++budget_frame_index);
+    std::array<vma::Budget, VK_MAX_MEMORY_HEAPS> budgets;
+    allocator.getHeapBudgets(budgets.data());
+    const vma::Budget &budget = budgets[texture_heap_index];
+
+    // what is left of the heap can be used by the textures, except for a margin kept for the surfaces and other allocations
+    constexpr uint64_t margin = MiB(256);
+    constexpr uint64_t min_budget = MiB(128);
+    const uint64_t available = (budget.budget > budget.usage + margin) ? budget.budget - budget.usage - margin : 0;
+    const uint64_t texture_budget = std::clamp(texture_cache.stats.memory_used + available, min_budget, auto_texture_budget);
+    if (texture_budget != texture_cache.stats.memory_budget)
+        texture_cache.set_memory_budget(texture_budget);
+}
+
+void VKState::defragment_memory() {
+    if (context && reinterpret_cast<VKContext *>(context)->is_recording)
+        return;
+
+    for (vma::Pool pool : { small_texture_pool, large_texture_pool }) {
+        if (pool)
+            texture_cache.defragment(pool);
+    }
+}
+
 void VKState::render_frame(const SceFVector2 &viewport_pos, const SceFVector2 &viewport_size, DisplayState &display,
     const GxmState &gxm, MemState &mem) {
+    R_FRAME_TIMER(Submit);
     // we are displaying this frame, wait for a new one
     should_display = false;
 
@@ -694,34 +1112,8 @@ void VKState::render_frame(const SceFVector2 &viewport_pos, const SceFVector2 &v
         frame.base, frame.pitch, viewport);
 
     if (!surface_handle) {
-        vkutil::Image &vita_surface = screen_renderer.vita_surface[screen_renderer.swapchain_image_idx];
-        if (frame.image_size.x != vita_surface.width || frame.image_size.y != vita_surface.height) {
-            // re-create the image
-            vita_surface.destroy();
-            vita_surface = vkutil::Image(frame.image_size.x, frame.image_size.y, vk::Format::eR8G8B8A8Unorm);
-            vita_surface.init_image(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
-        }
-
-        // copy surface to staging buffer
-        const vk::DeviceSize texture_data_size = frame.pitch * frame.image_size.y * 4;
-        memcpy(screen_renderer.vita_surface_staging_info.pMappedData, frame.base.get(mem), texture_data_size);
-
-        // copy staging buffer to image
-        auto &cmd_buffer = screen_renderer.current_cmd_buffer;
-        vita_surface.transition_to_discard(cmd_buffer, vkutil::ImageLayout::TransferDst);
-        vk::BufferImageCopy region{
-            .bufferOffset = 0,
-            .bufferRowLength = frame.pitch,
-            .bufferImageHeight = static_cast<uint32_t>(frame.image_size.y),
-            .imageSubresource = vkutil::color_subresource_layer,
-            .imageOffset = { 0, 0, 0 },
-            .imageExtent = { static_cast<uint32_t>(frame.image_size.x), static_cast<uint32_t>(frame.image_size.y), 1 }
-        };
-        cmd_buffer.copyBufferToImage(screen_renderer.vita_surface_staging, vita_surface.image, vk::ImageLayout::eTransferDstOptimal, region);
-
-        vita_surface.transition_to(cmd_buffer, vkutil::ImageLayout::SampledImage);
-
-        surface_handle = vita_surface.view;
+        // the framebuffer is only in the guest memory, upload the rows which changed
+        surface_handle = screen_renderer.upload_vita_surface(static_cast<const uint8_t *>(frame.base.get(mem)), frame.image_size.x, frame.image_size.y, frame.pitch);
         viewport = {
             .offset_x = 0,
             .offset_y = 0,
@@ -734,9 +1126,12 @@ void VKState::render_frame(const SceFVector2 &viewport_pos, const SceFVector2 &v
     }
 
     screen_renderer.render(surface_handle, layout, viewport);
+
+    update_memory_budget();
 }
 
 void VKState::swap_window(SDL_Window *window) {
+    R_FRAME_TIMER(Submit);
     screen_renderer.swap_window();
 
     // look once a frame if we need to save the pipeline cache
@@ -754,6 +1149,8 @@ uint32_t VKState::get_features_mask() {
             bool use_shader_interlock : 1;
             bool use_texture_viewport : 1;
             bool use_memory_mapping : 1;
+            bool optimize_spirv : 1;
+            bool spec_texture_viewport : 1;
         };
         uint32_t value;
     } features_mask;
@@ -761,8 +1158,11 @@ uint32_t VKState::get_features_mask() {
 
     features_mask.value = 0;
     features_mask.use_shader_interlock = features.support_shader_interlock;
-    features_mask.use_texture_viewport = features.use_texture_viewport;
+    // with a specialization constant, the same shaders are used with and without texture viewport
+    features_mask.use_texture_viewport = features.use_texture_viewport && !features.spec_texture_viewport;
+    features_mask.spec_texture_viewport = features.spec_texture_viewport;
     features_mask.use_memory_mapping = features.support_memory_mapping;
+    features_mask.optimize_spirv = features.optimize_spirv;
 
     return features_mask.value;
 }
@@ -787,7 +1187,7 @@ bool VKState::map_memory(MemState &mem, Ptr<void> address, uint32_t size) {
     assert(features.support_memory_mapping);
     // the adress should be 4K aligned
     assert((address.address() & 4095) == 0);
-    constexpr vk::BufferUsageFlags mapped_memory_flags = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst;
+    constexpr vk::BufferUsageFlags mapped_memory_flags = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
 
     if (mem.use_page_table) {
         // add 4 KiB because we can as an easy way to prevent crashes due to memory accesses right after the memory boundary
@@ -889,6 +1289,9 @@ void VKState::unmap_memory(MemState &mem, Ptr<void> address) {
     // we need to wait in case the buffer is being used
     device.waitIdle();
 
+    // memory is usually unmapped between two levels, a good time to compact the texture memory
+    defragment_memory();
+
     if (!mem.use_page_table) {
         device.destroyBuffer(ite->second.buffer);
         device.freeMemory(std::get<vk::DeviceMemory>(ite->second.buffer_impl));
@@ -901,8 +1304,8 @@ void VKState::unmap_memory(MemState &mem, Ptr<void> address) {
 std::tuple<vk::Buffer, uint32_t> VKState::get_matching_mapping(const Ptr<void> address) {
     auto mapped_memory = mapped_memories.lower_bound(address.address());
     if (mapped_memory == mapped_memories.end()
-        || mapped_memory->first + mapped_memory->second.size < address.address()) {
-        LOG_ERROR("Could not find matching mapped buffer for vertex stream");
+        || mapped_memory->first + mapped_memory->second.size <= address.address()) {
+        LOG_ERROR_ONCE("Could not find matching mapped buffer for address 0x{:X}", address.address());
         return { nullptr, 0 };
     }
 
@@ -912,8 +1315,8 @@ std::tuple<vk::Buffer, uint32_t> VKState::get_matching_mapping(const Ptr<void> a
 uint64_t VKState::get_matching_device_address(const Address address) {
     auto mapped_memory = mapped_memories.lower_bound(address);
     if (mapped_memory == mapped_memories.end()
-        || mapped_memory->first + mapped_memory->second.size < address) {
-        LOG_ERROR("Could not find matching mapped buffer for vertex stream");
+        || mapped_memory->first + mapped_memory->second.size <= address) {
+        LOG_ERROR_ONCE("Could not find matching mapped buffer for address 0x{:X}", address);
         return 0;
     }
 
@@ -954,7 +1357,11 @@ void VKState::precompile_shader(const ShadersHash &hash) {
     }
 
     programs_count_pre_compiled++;
-    LOG_INFO("Program Compiled {}/{}", programs_count_pre_compiled, shaders_cache_hashs.size());
+    LOG_INFO("Program Compiled {}/{}", programs_count_pre_compiled.load(), shaders_cache_hashs.size());
+}
+
+uint32_t VKState::start_shader_warmup() {
+    return pipeline_cache.start_warmup(shaders_cache_hashs);
 }
 
 void VKState::preclose_action() {
@@ -963,5 +1370,8 @@ void VKState::preclose_action() {
         return;
 
     pipeline_cache.save_pipeline_cache();
+
+    if (context)
+        reinterpret_cast<VKContext *>(context)->log_ring_buffer_usage();
 }
 } // namespace renderer::vulkan
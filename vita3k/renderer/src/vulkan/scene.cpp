@@ -18,6 +18,8 @@
 #include <renderer/vulkan/functions.h>
 
 #include <gxm/functions.h>
+#include <mem/functions.h>
+#include <renderer/profile.h>
 #include <renderer/vulkan/gxm_to_vulkan.h>
 
 #include <config/state.h>
@@ -26,6 +28,8 @@
 #include <util/align.h>
 #include <util/log.h>
 
+#include <xxhash.h>
+
 namespace renderer::vulkan {
 
 void set_uniform_buffer(VKContext &context, const MemState &mem, const ShaderProgram *program, const bool vertex_shader, const int block_num, const int size, Ptr<uint8_t> data) {
@@ -45,24 +49,60 @@ void set_uniform_buffer(VKContext &context, const MemState &mem, const ShaderPro
         const uint32_t data_size_upload = std::min<uint32_t>(size, program->uniform_buffer_sizes.at(block_num) * 4);
         const uint32_t offset_start_upload = offset * 4;
 
-        if (vertex_shader) {
-            if (!context.vertex_uniform_storage_allocated) {
-                // Allocate a region for it. Don't worry though, when the shader program is changed
-                context.vertex_uniform_stream_ring_buffer.allocate(program->max_total_uniform_buffer_storage * 4);
-                context.vertex_uniform_storage_allocated = true;
-            }
+        // the copy is done when drawing, once we know if the same content was already uploaded
+        UniformStorage &storage = vertex_shader ? context.vertex_uniform_storage : context.fragment_uniform_storage;
+        if (storage.blocks_set == 0)
+            storage.storage_size = program->max_total_uniform_buffer_storage * 4;
+        storage.blocks[block_num] = UniformBlockUpload{
+            .data = data.get(mem),
+            .size = data_size_upload,
+            .offset = offset_start_upload
+        };
+        storage.blocks_set |= 1U << block_num;
+    }
+}
 
-            context.vertex_uniform_stream_ring_buffer.copy(context.prerender_cmd, data_size_upload, data.get(mem), offset_start_upload);
-        } else {
-            if (!context.fragment_uniform_storage_allocated) {
-                // Allocate a region for it. Don't worry though, when the shader program is changed
-                context.fragment_uniform_stream_ring_buffer.allocate(program->max_total_uniform_buffer_storage * 4);
-                context.fragment_uniform_storage_allocated = true;
-            }
+static void upload_uniform_storage(VKContext &context, UniformStorage &storage, vkutil::HostRingBuffer &ring_buffer) {
+    if (storage.blocks_set == 0)
+        return;
 
-            context.fragment_uniform_stream_ring_buffer.copy(context.prerender_cmd, data_size_upload, data.get(mem), offset_start_upload);
+    if (storage.uploaded_scene != context.scene_timestamp) {
+        storage.uploaded.clear();
+        storage.uploaded_scene = context.scene_timestamp;
+    }
+
+    // the key contains the address, size and content of each block
+    uint64_t key = storage.storage_size;
+    for (uint32_t block_num = 0; block_num < storage.blocks.size(); block_num++) {
+        if (!(storage.blocks_set & (1U << block_num)))
+            continue;
+
+        const UniformBlockUpload &block = storage.blocks[block_num];
+        const uint64_t layout[] = { reinterpret_cast<uintptr_t>(block.data), (static_cast<uint64_t>(block.offset) << 32) | block.size };
+        key = XXH3_64bits_withSeed(layout, sizeof(layout), key);
+        key = XXH3_64bits_withSeed(block.data, block.size, key);
+    }
+
+    auto it = storage.uploaded.find(key);
+    if (it != storage.uploaded.end()) {
+        ring_buffer.data_offset = it->second;
+    } else {
+        const uint32_t previous_offset = ring_buffer.data_offset;
+        ring_buffer.allocate(storage.storage_size);
+        // the ring buffer wrapped around, the previous uploads may be overwritten
+        if (ring_buffer.data_offset < previous_offset)
+            storage.uploaded.clear();
+
+        for (uint32_t block_num = 0; block_num < storage.blocks.size(); block_num++) {
+            if (storage.blocks_set & (1U << block_num)) {
+                const UniformBlockUpload &block = storage.blocks[block_num];
+                ring_buffer.copy(context.prerender_cmd, block.size, block.data, block.offset);
+            }
         }
+        storage.uploaded[key] = ring_buffer.data_offset;
     }
+
+    storage.blocks_set = 0;
 }
 
 void mid_scene_flush(VKContext &context, const SceGxmNotification notification) {
@@ -96,22 +136,118 @@ void mid_scene_flush(VKContext &context, const SceGxmNotification notification)
     }
 }
 
+bool transfer_surface(VKState &state, const SceGxmTransferImage &src, const SceGxmTransferImage &dest, const SceGxmTransferType src_type, const SceGxmTransferType dest_type, const bool downscale) {
+    VKContext *context = reinterpret_cast<VKContext *>(state.context);
+    // the copy is submitted on its own, it can't be ordered with a scene still being recorded or not submitted yet
+    if (!context || context->is_recording || !context->cmdbuffers_to_submit.empty())
+        return false;
+
+    ColorSurfaceCacheInfo *src_surface = state.surface_cache.retrieve_color_surface_for_transfer(src, src_type);
+    if (!src_surface)
+        return false;
+    ColorSurfaceCacheInfo *dest_surface = state.surface_cache.retrieve_color_surface_for_transfer(dest, dest_type);
+    if (!dest_surface || dest_surface == src_surface)
+        return false;
+
+    // both surfaces must store their pixels the same way for the copy to give the same result as in memory
+    if (src_surface->format != dest_surface->format || src_surface->swizzle != dest_surface->swizzle)
+        return false;
+    if (src_surface->texture.layout != vkutil::ImageLayout::ColorAttachmentReadWrite || dest_surface->texture.layout != vkutil::ImageLayout::ColorAttachmentReadWrite)
+        return false;
+
+    const int32_t res = static_cast<int32_t>(state.res_multiplier);
+    const int32_t dest_width = downscale ? src.width / 2 : src.width;
+    const int32_t dest_height = downscale ? src.height / 2 : src.height;
+
+    vk::CommandBuffer cmd_buffer = vkutil::create_single_time_command(state.device, state.general_command_pool);
+
+    // wait for the scenes which rendered to the surfaces
+    const vk::MemoryBarrier before_barrier{
+        .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
+    };
+    cmd_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), before_barrier, {}, {});
+
+    if (downscale) {
+        const vk::ImageBlit blit{
+            .srcSubresource = vkutil::color_subresource_layer,
+            .srcOffsets = std::array<vk::Offset3D, 2>{
+                vk::Offset3D{ static_cast<int32_t>(src.x) * res, static_cast<int32_t>(src.y) * res, 0 },
+                vk::Offset3D{ static_cast<int32_t>(src.x + src.width) * res, static_cast<int32_t>(src.y + src.height) * res, 1 } },
+            .dstSubresource = vkutil::color_subresource_layer,
+            .dstOffsets = std::array<vk::Offset3D, 2>{
+                vk::Offset3D{ static_cast<int32_t>(dest.x) * res, static_cast<int32_t>(dest.y) * res, 0 },
+                vk::Offset3D{ (static_cast<int32_t>(dest.x) + dest_width) * res, (static_cast<int32_t>(dest.y) + dest_height) * res, 1 } }
+        };
+        cmd_buffer.blitImage(src_surface->texture.image, vk::ImageLayout::eGeneral, dest_surface->texture.image, vk::ImageLayout::eGeneral, blit, vk::Filter::eLinear);
+    } else {
+        const vk::ImageCopy image_copy{
+            .srcSubresource = vkutil::color_subresource_layer,
+            .srcOffset = { static_cast<int32_t>(src.x) * res, static_cast<int32_t>(src.y) * res, 0 },
+            .dstSubresource = vkutil::color_subresource_layer,
+            .dstOffset = { static_cast<int32_t>(dest.x) * res, static_cast<int32_t>(dest.y) * res, 0 },
+            .extent = { static_cast<uint32_t>(dest_width * res), static_cast<uint32_t>(dest_height * res), 1 }
+        };
+        cmd_buffer.copyImage(src_surface->texture.image, vk::ImageLayout::eGeneral, dest_surface->texture.image, vk::ImageLayout::eGeneral, image_copy);
+    }
+
+    // make the copy visible to the next scenes
+    const vk::MemoryBarrier after_barrier{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eShaderRead,
+    };
+    cmd_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags(), after_barrier, {}, {});
+
+    vkutil::end_single_time_command(state.device, state.general_queue, state.general_command_pool, cmd_buffer);
+    return true;
+}
+
+// Vulkan allows any stride, but Metal only allows multiples of 4
+// on macOS, the vertex attribute binding strides are aligned to 4 and the streams are restrided
+static bool needs_restride(uint32_t stride) {
 #ifdef __APPLE__
-// restride vertex attribute binding strides to multiple of 4
-// needed for metal because it only allows multiples of 4.
-void restride_stream(const uint8_t *&stream, uint32_t &size, uint32_t stride) {
-    const uint32_t new_stride = align(stride, 4);
-    const uint32_t nb_vertex_input = ((size + stride - 1) / stride);
+    return stride % 4 != 0;
+#else
+    return false;
+#endif
+}
+
+// size of a stream once restrided
+static uint32_t get_restrided_size(uint32_t size, uint32_t stride) {
+    if (!needs_restride(stride))
+        return size;
+
+    const uint32_t nb_vertex_input = (size + stride - 1) / stride;
+    return nb_vertex_input * align(stride, 4);
+}
 
-    uint8_t *new_data = new uint8_t[nb_vertex_input * new_stride];
-    for (uint32_t i = 0; i < nb_vertex_input; i++) {
-        memcpy(new_data + new_stride * i, stream + stride * i, stride);
+// return the data to copy for this stream, restrided in context.restride_buffer if needed
+static const uint8_t *get_stream_data(VKContext &context, const uint8_t *stream, uint32_t size, uint32_t stride) {
+    if (!needs_restride(stride))
+        return stream;
+
+    constexpr uint32_t VECTOR_SIZE = 16;
+    const uint32_t new_stride = align(stride, 4);
+    const uint32_t nb_vertex_input = (size + stride - 1) / stride;
+    // the vector copies can write past the last vertex
+    if (context.restride_buffer.size() < nb_vertex_input * new_stride + VECTOR_SIZE)
+        context.restride_buffer.resize(nb_vertex_input * new_stride + VECTOR_SIZE);
+    uint8_t *new_data = context.restride_buffer.data();
+
+    uint32_t i = 0;
+    if (stride < VECTOR_SIZE) {
+        // a fixed size copy is a single vector load and store, the bytes after the vertex
+        // are overwritten by the next one
+        for (; i < nb_vertex_input && stride * i + VECTOR_SIZE <= size; i++)
+            memcpy(new_data + new_stride * i, stream + stride * i, VECTOR_SIZE);
     }
+    // the last vertex of the stream can be incomplete
+    for (; i < nb_vertex_input; i++)
+        memcpy(new_data + new_stride * i, stream + stride * i, std::min(stride, size - stride * i));
 
-    stream = new_data;
-    size = nb_vertex_input * new_stride;
+    return new_data;
 }
-#endif
 
 // when needed, how many descriptor of the given size we allocate for each frame at once
 static constexpr uint32_t DESCRIPTOR_PACK_SIZE = 64;
@@ -162,6 +298,7 @@ static vk::DescriptorSet retrieve_descriptor(VKContext &context, bool is_vertex,
 }
 
 static void draw_bind_descriptors(VKContext &context, MemState &mem) {
+    R_FRAME_TIMER(Descriptors);
     VKState &state = context.state;
 
     std::array<vk::DescriptorSet, 4> descriptors;
@@ -181,6 +318,12 @@ static void draw_bind_descriptors(VKContext &context, MemState &mem) {
     bool need_vert_descr = (vertex_textures_count != context.last_vert_texture_count);
     bool need_frag_descr = (fragment_texture_count != context.last_frag_texture_count);
 
+    // the fragment textures are pushed directly in the command buffer instead of being written to a descriptor set
+    const bool push_frag_textures = state.support_push_descriptor && fragment_texture_count > 0;
+    // changing the vertex texture set layout makes the pushed set incompatible, it must be pushed again
+    if (push_frag_textures && vertex_textures_count != context.last_vert_texture_count)
+        need_frag_descr = true;
+
     context.last_vert_texture_count = vertex_textures_count;
     context.last_frag_texture_count = fragment_texture_count;
 
@@ -191,7 +334,7 @@ static void draw_bind_descriptors(VKContext &context, MemState &mem) {
         }
         descriptors[2] = context.last_vert_texture_descriptor;
 
-        if (need_frag_descr) {
+        if (need_frag_descr && !push_frag_textures) {
             context.last_frag_texture_descriptor = retrieve_descriptor(context, false, fragment_texture_count);
         }
         descriptors[3] = context.last_frag_texture_descriptor;
@@ -224,14 +367,16 @@ static void draw_bind_descriptors(VKContext &context, MemState &mem) {
     if (need_frag_descr) {
         for (uint32_t i = 0; i < fragment_texture_count; i++) {
             write_descrs[i] = vk::WriteDescriptorSet{
-                .dstSet = descriptors[3],
+                // ignored when pushing the textures
+                .dstSet = push_frag_textures ? vk::DescriptorSet() : descriptors[3],
                 .dstBinding = i,
                 .dstArrayElement = 0,
                 .descriptorType = vk::DescriptorType::eCombinedImageSampler,
             };
             write_descrs[i].setImageInfo(context.fragment_textures[i].sampler ? context.fragment_textures[i] : default_image_info);
         }
-        state.device.updateDescriptorSets(fragment_texture_count, write_descrs.data(), 0, nullptr);
+        if (!push_frag_textures)
+            state.device.updateDescriptorSets(fragment_texture_count, write_descrs.data(), 0, nullptr);
     }
 
     const uint32_t dynamic_offset_count = state.features.support_memory_mapping ? 2U : 4U;
@@ -246,8 +391,101 @@ static void draw_bind_descriptors(VKContext &context, MemState &mem) {
         context.fragment_uniform_stream_ring_buffer.data_offset
     };
 
+    // a pushed set cannot be bound
+    const uint32_t bound_set_count = push_frag_textures ? 3U : 4U;
     context.render_cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0,
-        descriptors.size(), descriptors.data(), dynamic_offset_count, dynamic_offsets);
+        bound_set_count, descriptors.data(), dynamic_offset_count, dynamic_offsets);
+
+    // push after binding the other sets, binding them with the same layout leaves the pushed textures untouched
+    if (push_frag_textures && need_frag_descr)
+        context.render_cmd.pushDescriptorSetKHR(vk::PipelineBindPoint::eGraphics, pipeline_layout, 3, vk::ArrayProxy<const vk::WriteDescriptorSet>(fragment_texture_count, write_descrs.data()));
+}
+
+// streams smaller than this are cheaper to copy for each draw than to protect
+static constexpr uint32_t VERTEX_STREAM_CACHE_MIN_SIZE = 4 * 1024;
+// cached streams which were not used for this number of frames are destroyed
+static constexpr uint64_t VERTEX_STREAM_CACHE_MAX_AGE = 300;
+
+static void evict_cached_vertex_streams(VKContext &context) {
+    std::vector<uint64_t> evicted;
+    for (auto &[key, cached] : context.vertex_stream_cache) {
+        if (cached->last_use_frame + VERTEX_STREAM_CACHE_MAX_AGE < context.frame_timestamp) {
+            // the protection callback may still be called, it only holds a reference to the entry
+            context.state.frame().destroy_queue.add_buffer(cached->buffer);
+            evicted.push_back(key);
+        }
+    }
+
+    for (uint64_t key : evicted)
+        context.vertex_stream_cache.erase(key);
+}
+
+// return the buffer containing a copy of this stream, or nullptr if it must go through the ring buffer
+// guest_size can be different from stream_size if the stream must be restrided
+static vk::Buffer retrieve_cached_vertex_stream(VKContext &context, MemState &mem, Address address, uint32_t guest_size, const uint8_t *guest_stream, uint32_t stride, uint32_t stream_size) {
+    if (context.vertex_stream_cache_eviction_frame != context.frame_timestamp) {
+        context.vertex_stream_cache_eviction_frame = context.frame_timestamp;
+        evict_cached_vertex_streams(context);
+    }
+
+    const uint64_t key = (static_cast<uint64_t>(address) << 32) | guest_size;
+    std::shared_ptr<CachedVertexStream> &cached = context.vertex_stream_cache[key];
+    if (!cached)
+        cached = std::make_shared<CachedVertexStream>();
+
+    cached->last_use_frame = context.frame_timestamp;
+    if (cached->is_dynamic)
+        return nullptr;
+
+    if (!cached->dirty.load(std::memory_order_acquire))
+        return cached->buffer.buffer;
+
+    if (cached->buffer.buffer) {
+        // the previous copy may still be used by the GPU
+        context.state.frame().destroy_queue.add_buffer(cached->buffer);
+
+        if (cached->upload_frame + 1 >= context.frame_timestamp) {
+            // this is not static geometry, caching it only adds protection faults
+            cached->is_dynamic = true;
+            return nullptr;
+        }
+    }
+
+    // protect before reading the stream so that no write is missed
+    cached->dirty = false;
+    const Address protect_begin = align_down(address, mem.page_size);
+    const Address protect_end = align(address + guest_size, mem.page_size);
+    const bool is_protected = add_protect(mem, protect_begin, protect_end - protect_begin, MemPerm::ReadOnly, [cached = cached](Address, bool) {
+        cached->dirty.store(true, std::memory_order_release);
+        return true;
+    });
+    if (!is_protected) {
+        cached->is_dynamic = true;
+        return nullptr;
+    }
+
+    cached->buffer = vkutil::Buffer(stream_size);
+    cached->buffer.init_buffer(vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+    cached->upload_frame = context.frame_timestamp;
+
+    // go through the ring buffer to send the stream to the GPU memory
+    vkutil::HostRingBuffer &staging = context.vertex_stream_ring_buffer;
+    staging.allocate(context.prerender_cmd, stream_size, get_stream_data(context, guest_stream, guest_size, stride));
+    const vk::BufferCopy copy_region{
+        .srcOffset = staging.data_offset,
+        .dstOffset = 0,
+        .size = stream_size
+    };
+    context.prerender_cmd.copyBuffer(staging.handle(), cached->buffer.buffer, copy_region);
+
+    const vk::MemoryBarrier barrier{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead
+    };
+    context.prerender_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput,
+        vk::DependencyFlags(), barrier, {}, {});
+
+    return cached->buffer.buffer;
 }
 
 static void bind_vertex_streams(VKContext &context, MemState &mem) {
@@ -271,27 +509,35 @@ static void bind_vertex_streams(VKContext &context, MemState &mem) {
         if (state.vertex_streams[i].data) {
             if (context.state.features.support_memory_mapping) {
                 auto [buffer, offset] = context.state.get_matching_mapping(state.vertex_streams[i].data.cast<void>());
+                if (!buffer) {
+                    // the stream is not inside a region that was mapped with sceGxmMapMemory,
+                    // bind the default buffer rather than an invalid handle
+                    buffer = context.state.default_buffer.buffer;
+                    offset = 0;
+                }
 
                 context.vertex_stream_offsets[i] = offset;
                 context.vertex_stream_buffers[i] = buffer;
             } else {
                 const uint8_t *stream = state.vertex_streams[i].data.get(mem);
-                uint32_t stream_size = state.vertex_streams[i].size;
-#ifdef __APPLE__
-                // Vulkan allows any stride, but Metal only allows multiples of 4.
-                const bool restride = vertex_program.streams[i].stride % 4 != 0;
-                if (restride) {
-                    restride_stream(stream, stream_size, vertex_program.streams[i].stride);
-                }
-#endif
-                context.vertex_stream_ring_buffer.allocate(context.prerender_cmd, stream_size, stream);
-                context.vertex_stream_offsets[i] = context.vertex_stream_ring_buffer.data_offset;
-
-#ifdef __APPLE__
-                if (restride) {
-                    delete[] stream;
+                const uint32_t guest_size = state.vertex_streams[i].size;
+                const uint32_t stride = vertex_program.streams[i].stride;
+                const uint32_t stream_size = get_restrided_size(guest_size, stride);
+
+                // static geometry is uploaded once to the GPU memory, write protection tells us when it changes
+                // the stream is only restrided when it is copied, not each time the cached copy is used
+                vk::Buffer cached_buffer = nullptr;
+                if (!mem.use_write_watch && stream_size >= VERTEX_STREAM_CACHE_MIN_SIZE)
+                    cached_buffer = retrieve_cached_vertex_stream(context, mem, state.vertex_streams[i].data.address(), guest_size, stream, stride, stream_size);
+
+                if (cached_buffer) {
+                    context.vertex_stream_buffers[i] = cached_buffer;
+                    context.vertex_stream_offsets[i] = 0;
+                } else {
+                    context.vertex_stream_ring_buffer.allocate(context.prerender_cmd, stream_size, get_stream_data(context, stream, guest_size, stride));
+                    context.vertex_stream_buffers[i] = context.vertex_stream_ring_buffer.handle();
+                    context.vertex_stream_offsets[i] = context.vertex_stream_ring_buffer.data_offset;
                 }
-#endif
             }
 
             state.vertex_streams[i].data = nullptr;
@@ -302,6 +548,11 @@ static void bind_vertex_streams(VKContext &context, MemState &mem) {
     context.render_cmd.bindVertexBuffers(0, max_stream_idx, context.vertex_stream_buffers, context.vertex_stream_offsets);
 }
 
+// TODO: recording large scenes on multiple threads (secondary command buffers executed from render_cmd)
+// needs the commands recorded here to be captured first: the pipeline, texture and descriptor lookups
+// and the ring buffer uploads read the guest memory and the caches as they are when the draw is processed,
+// and everything recorded inside the render pass (clears, dynamic state, queries, push descriptors) would
+// have to go through the secondary command buffers too
 void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format,
     Ptr<void> indices, size_t count, uint32_t instance_count, MemState &mem, const Config &config) {
     void *indices_ptr = indices.get(mem);
@@ -323,18 +574,21 @@ void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format
     const SceGxmProgram &fragment_program_gxp = *gxm_fragment_program.program.get(mem);
     if (context.state.features.direct_fragcolor && fragment_program_gxp.is_frag_color_used()) {
         // the fragment shader is using programmable blending with a subpass input
-        vk::ImageMemoryBarrier barrier{
-            .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
-            .dstAccessMask = vk::AccessFlagBits::eInputAttachmentRead,
-            .oldLayout = vk::ImageLayout::eGeneral,
-            .newLayout = vk::ImageLayout::eGeneral,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = context.current_color_base_image->image,
-            .subresourceRange = vkutil::color_subresource_range
-        };
-        context.render_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eFragmentShader,
-            vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
+        // with rasterization order attachment access, the reads are already ordered with the previous color writes
+        if (!context.state.pipeline_cache.support_rasterization_order) {
+            vk::ImageMemoryBarrier barrier{
+                .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+                .dstAccessMask = vk::AccessFlagBits::eInputAttachmentRead,
+                .oldLayout = vk::ImageLayout::eGeneral,
+                .newLayout = vk::ImageLayout::eGeneral,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = context.current_color_base_image->image,
+                .subresourceRange = vkutil::color_subresource_range
+            };
+            context.render_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eFragmentShader,
+                vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
+        }
     } else if (context.state.features.support_shader_interlock
         && fragment_program_gxp.is_frag_color_used() != context.last_draw_was_framebuffer_fetch) {
         // restart the render pass to act as a barrier
@@ -375,6 +629,8 @@ void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format
         // to be able to see anything
         bool can_be_whole_quad = instance_count == 1 && (count == 4 || count == 6);
         vk::Pipeline new_pipeline = context.state.pipeline_cache.retrieve_pipeline(context, type, !can_be_whole_quad, mem);
+        // when using dynamic state, these states are not part of the pipeline anymore
+        context.state.pipeline_cache.set_dynamic_state(context, type, mem);
 
         if (new_pipeline != context.current_pipeline) {
             context.current_pipeline = new_pipeline;
@@ -409,7 +665,7 @@ void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format
         context.curr_frag_ublock.set_buffer_count(frag_render_data->buffer_count);
     }
 
-    if (context.state.features.use_texture_viewport) {
+    if (context.state.features.use_texture_viewport || context.state.features.spec_texture_viewport) {
         context.curr_vert_ublock.set_texture_count(vert_render_data->texture_count);
         context.curr_frag_ublock.set_texture_count(frag_render_data->texture_count);
     }
@@ -446,6 +702,10 @@ void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format
         memcpy(&context.prev_frag_ublock, &frag_ublock, sizeof(frag_ublock));
     }
 
+    // copy the uniform blocks set for this draw, this updates the offsets used by the descriptors
+    upload_uniform_storage(context, context.vertex_uniform_storage, context.vertex_uniform_stream_ring_buffer);
+    upload_uniform_storage(context, context.fragment_uniform_storage, context.fragment_uniform_stream_ring_buffer);
+
     // create, update and bind descriptors (uniforms and textures)
     draw_bind_descriptors(context, mem);
     // bind the vertex streams
@@ -457,6 +717,10 @@ void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format
 
     if (use_memory_mapping) {
         auto [buffer, offset] = context.state.get_matching_mapping(indices);
+        if (!buffer) {
+            // binding a null index buffer is invalid, drop the draw instead
+            return;
+        }
         context.render_cmd.bindIndexBuffer(buffer, offset, index_type);
     } else {
         const size_t index_buffer_size = index_size * count;
@@ -466,9 +730,6 @@ void draw(VKContext &context, SceGxmPrimitiveType type, SceGxmIndexFormat format
     }
 
     context.render_cmd.drawIndexed(count, instance_count, 0, 0, 0);
-
-    context.vertex_uniform_storage_allocated = false;
-    context.fragment_uniform_storage_allocated = false;
 }
 
 } // namespace renderer::vulkan
@@ -19,12 +19,33 @@
 
 #include <SDL_vulkan.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "renderer/vulkan/state.h"
 #include "util/log.h"
 #include "vkutil/vkutil.h"
 
+#ifdef __x86_64__
+#include <xxh_x86dispatch.h>
+#else
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+#endif
+
 namespace renderer::vulkan {
 
+// size of the part of the staging buffer used by each swapchain image, big enough for any framebuffer
+static constexpr vk::DeviceSize VITA_SURFACE_STAGING_SIZE = 1024 * 720 * sizeof(uint32_t);
+// the guest framebuffer is compared with the previous one by bands of this many rows
+static constexpr uint32_t VITA_SURFACE_BAND_HEIGHT = 16;
+
+// the recorded frames are read by the cpu, which can be slow with uncached memory
+static constexpr vma::AllocationCreateInfo record_alloc = {
+    .flags = vma::AllocationCreateFlagBits::eHostAccessRandom | vma::AllocationCreateFlagBits::eMapped,
+    .usage = vma::MemoryUsage::eAuto,
+};
+
 ScreenRenderer::ScreenRenderer(VKState &state)
     : state(state) {
 }
@@ -122,6 +143,10 @@ void ScreenRenderer::create_swapchain() {
         if (surface_capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eStorage)
             // needed for FSR
             surface_usage |= vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eStorage;
+        // needed to record the gameplay
+        support_record = static_cast<bool>(surface_capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc);
+        if (support_record)
+            surface_usage |= vk::ImageUsageFlagBits::eTransferSrc;
 
         vk::SwapchainCreateInfoKHR swapchain_info{
             .surface = surface,
@@ -139,6 +164,7 @@ void ScreenRenderer::create_swapchain() {
         };
 
         swapchain = state.device.createSwapchainKHR(swapchain_info);
+        present_id = 0;
     }
 
     // Get Swapchain Images
@@ -193,6 +219,10 @@ void ScreenRenderer::destroy_swapchain() {
 
 void ScreenRenderer::cleanup() {
     state.device.waitIdle();
+    // the recorder must release the frames before their buffers are destroyed
+    state.recorder.stop();
+    state.screenshot.stop();
+    destroy_record_slots();
     for (vk::Framebuffer fb : swapchain_framebuffers)
         state.device.destroy(fb);
 
@@ -255,6 +285,7 @@ bool ScreenRenderer::acquire_swapchain_image(bool start_render_pass) {
         return false;
     }
     state.device.resetFences(fences[swapchain_image_idx]);
+    submit_recorded_frame();
 
     // begin the render command
     current_cmd_buffer = command_buffers[swapchain_image_idx];
@@ -317,6 +348,8 @@ void ScreenRenderer::swap_window() {
 
     // first submit the command buffer
     current_cmd_buffer.endRenderPass();
+    if (state.recorder.is_recording() || state.screenshot.is_requested())
+        record_frame();
     current_cmd_buffer.end();
     vk::SubmitInfo submit_info{};
     std::array<vk::Semaphore, 1> wait_semaphores = { image_acquired_semaphores[current_frame] };
@@ -336,6 +369,13 @@ void ScreenRenderer::swap_window() {
         .pSwapchains = &swapchain,
         .pImageIndices = &swapchain_image_idx,
     };
+    const uint64_t next_present_id = present_id + 1;
+    const vk::PresentIdKHR present_id_info{
+        .swapchainCount = 1,
+        .pPresentIds = &next_present_id
+    };
+    if (use_present_wait)
+        present_info.pNext = &present_id_info;
     try {
         auto result = state.general_queue.presentKHR(present_info);
         if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
@@ -343,6 +383,16 @@ void ScreenRenderer::swap_window() {
             assert(false);
             return;
         }
+
+        if (use_present_wait) {
+            // wait for the previous frame to be on screen, so that at most one frame is queued
+            // and the next one starts (and reads its inputs) as late as possible
+            // the timeout avoids stalling if the compositor never displays it (window minimized...)
+            constexpr uint64_t present_wait_timeout = 100'000'000;
+            if (present_id > 0 && state.device.waitForPresentKHR(swapchain, present_id, present_wait_timeout) == vk::Result::eTimeout)
+                LOG_WARN_ONCE("Timed out while waiting for a frame to be presented");
+            present_id = next_present_id;
+        }
     } catch (vk::OutOfDateKHRError &) {
         state.device.waitIdle();
         destroy_swapchain();
@@ -449,14 +499,179 @@ void ScreenRenderer::create_render_pass() {
 
 void ScreenRenderer::create_surface_image() {
     vita_surface.resize(swapchain_size);
+    vita_surface_band_hashes.resize(swapchain_size);
 
     vk::BufferCreateInfo buffer_info{
-        // make sure it is big enough
-        .size = 1024 * 720 * sizeof(uint32_t),
+        .size = VITA_SURFACE_STAGING_SIZE * swapchain_size,
         .usage = vk::BufferUsageFlagBits::eTransferSrc,
         .sharingMode = vk::SharingMode::eExclusive
     };
     std::tie(vita_surface_staging, vita_surface_staging_alloc) = state.allocator.createBuffer(buffer_info, vkutil::vma_mapped_alloc, vita_surface_staging_info);
 }
 
-} // namespace renderer::vulkan
\ No newline at end of file
+vk::ImageView ScreenRenderer::upload_vita_surface(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch) {
+    vkutil::Image &surface = vita_surface[swapchain_image_idx];
+    std::vector<uint64_t> &band_hashes = vita_surface_band_hashes[swapchain_image_idx];
+    const uint32_t row_size = pitch * sizeof(uint32_t);
+    if (static_cast<vk::DeviceSize>(row_size) * height > VITA_SURFACE_STAGING_SIZE) {
+        LOG_ERROR_ONCE("Framebuffer of {}x{} with a pitch of {} is too big to be displayed", width, height, pitch);
+        height = VITA_SURFACE_STAGING_SIZE / row_size;
+    }
+    if (width != surface.width || height != surface.height) {
+        // re-create the image
+        surface.destroy();
+        surface = vkutil::Image(width, height, vk::Format::eR8G8B8A8Unorm);
+        surface.init_image(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
+        band_hashes.clear();
+    }
+
+    const uint32_t band_count = (height + VITA_SURFACE_BAND_HEIGHT - 1) / VITA_SURFACE_BAND_HEIGHT;
+    const bool is_new = band_hashes.size() != band_count;
+    band_hashes.resize(band_count);
+
+    // the staging part of this image mirrors the guest layout, only the bands which changed are copied to it
+    const vk::DeviceSize staging_offset = VITA_SURFACE_STAGING_SIZE * swapchain_image_idx;
+    uint8_t *staging = static_cast<uint8_t *>(vita_surface_staging_info.pMappedData) + staging_offset;
+    std::vector<vk::BufferImageCopy> regions;
+    for (uint32_t band = 0; band < band_count; band++) {
+        const uint32_t first_row = band * VITA_SURFACE_BAND_HEIGHT;
+        const uint32_t row_count = std::min(VITA_SURFACE_BAND_HEIGHT, height - first_row);
+        const size_t band_offset = static_cast<size_t>(first_row) * row_size;
+        const size_t band_size = static_cast<size_t>(row_count) * row_size;
+        const uint64_t hash = XXH3_64bits(pixels + band_offset, band_size);
+        if (!is_new && hash == band_hashes[band])
+            continue;
+        band_hashes[band] = hash;
+        memcpy(staging + band_offset, pixels + band_offset, band_size);
+
+        // consecutive dirty bands are uploaded with a single copy
+        if (!regions.empty() && regions.back().imageOffset.y + regions.back().imageExtent.height == first_row) {
+            regions.back().imageExtent.height += row_count;
+            continue;
+        }
+        regions.push_back(vk::BufferImageCopy{
+            .bufferOffset = staging_offset + band_offset,
+            .bufferRowLength = pitch,
+            .bufferImageHeight = 0,
+            .imageSubresource = vkutil::color_subresource_layer,
+            .imageOffset = { 0, static_cast<int32_t>(first_row), 0 },
+            .imageExtent = { width, row_count, 1 } });
+    }
+
+    if (regions.empty())
+        // the image already has the content of this frame
+        return surface.view;
+
+    if (is_new)
+        surface.transition_to_discard(current_cmd_buffer, vkutil::ImageLayout::TransferDst);
+    else
+        surface.transition_to(current_cmd_buffer, vkutil::ImageLayout::TransferDst);
+    current_cmd_buffer.copyBufferToImage(vita_surface_staging, surface.image, vk::ImageLayout::eTransferDstOptimal, regions);
+    surface.transition_to(current_cmd_buffer, vkutil::ImageLayout::SampledImage);
+
+    return surface.view;
+}
+
+void ScreenRenderer::record_frame() {
+    const bool is_bgra = surface_format.format == vk::Format::eB8G8R8A8Unorm;
+    if (!support_record || (!is_bgra && surface_format.format != vk::Format::eR8G8B8A8Unorm)) {
+        LOG_WARN_ONCE("The swapchain images can not be recorded");
+        return;
+    }
+
+    while (record_slots.size() < swapchain_size)
+        record_slots.push_back(std::make_unique<RecordSlot>());
+    RecordSlot &slot = *record_slots[swapchain_image_idx];
+    // the previous frame copied to this slot is still being encoded, skip this one
+    if (slot.users > 0)
+        return;
+
+    const vk::DeviceSize size = static_cast<vk::DeviceSize>(extent.width) * extent.height * sizeof(uint32_t);
+    if (slot.size < size) {
+        if (slot.buffer)
+            state.allocator.destroyBuffer(slot.buffer, slot.allocation);
+        vk::BufferCreateInfo buffer_info{
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferDst,
+            .sharingMode = vk::SharingMode::eExclusive
+        };
+        std::tie(slot.buffer, slot.allocation) = state.allocator.createBuffer(buffer_info, record_alloc, slot.allocation_info);
+        slot.size = size;
+    }
+
+    const vk::Image image = swapchain_images[swapchain_image_idx];
+    vk::ImageMemoryBarrier barrier{
+        .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+        .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+        .oldLayout = vk::ImageLayout::ePresentSrcKHR,
+        .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = vkutil::color_subresource_range
+    };
+    current_cmd_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(), {}, {}, barrier);
+
+    vk::BufferImageCopy region{
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = vkutil::color_subresource_layer,
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { extent.width, extent.height, 1 }
+    };
+    current_cmd_buffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, slot.buffer, region);
+
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    barrier.dstAccessMask = vk::AccessFlags();
+    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+    const vk::BufferMemoryBarrier buffer_barrier{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = slot.buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE
+    };
+    current_cmd_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe | vk::PipelineStageFlagBits::eHost,
+        vk::DependencyFlags(), {}, buffer_barrier, barrier);
+
+    slot.width = extent.width;
+    slot.height = extent.height;
+    slot.pending = true;
+}
+
+void ScreenRenderer::submit_recorded_frame() {
+    if (swapchain_image_idx >= record_slots.size())
+        return;
+
+    RecordSlot &slot = *record_slots[swapchain_image_idx];
+    if (!slot.pending)
+        return;
+    slot.pending = false;
+
+    // the encoder reads the frame straight from the buffer the gpu copied it to
+    state.allocator.invalidateAllocation(slot.allocation, 0, VK_WHOLE_SIZE);
+    const RecorderPixelOrder order = (surface_format.format == vk::Format::eB8G8R8A8Unorm) ? RecorderPixelOrder::BGRA : RecorderPixelOrder::RGBA;
+    const uint8_t *pixels = static_cast<const uint8_t *>(slot.allocation_info.pMappedData);
+    const uint32_t pitch = slot.width * sizeof(uint32_t);
+    const auto release = [&slot]() { slot.users--; };
+    // each consumer which does not take the frame releases it right away
+    slot.users = 2;
+    if (!state.recorder.push_frame(pixels, slot.width, slot.height, pitch, order, release))
+        release();
+    if (!state.screenshot.push_frame(pixels, slot.width, slot.height, pitch, order, release))
+        release();
+}
+
+void ScreenRenderer::destroy_record_slots() {
+    for (const std::unique_ptr<RecordSlot> &slot : record_slots) {
+        if (slot->buffer)
+            state.allocator.destroyBuffer(slot->buffer, slot->allocation);
+    }
+    record_slots.clear();
+}
+} // namespace renderer::vulkan
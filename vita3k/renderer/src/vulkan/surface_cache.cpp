@@ -18,6 +18,7 @@
 #include <renderer/vulkan/surface_cache.h>
 
 #include <gxm/functions.h>
+#include <renderer/profile.h>
 #include <renderer/vulkan/gxm_to_vulkan.h>
 #include <renderer/vulkan/state.h>
 #include <renderer/vulkan/types.h>
@@ -61,10 +62,50 @@ namespace renderer::vulkan {
 
 static constexpr std::uint64_t CASTED_UNUSED_TEXTURE_PURGE_SECS = 40;
 
+static void write_back_surface_readback(MemState &mem, SurfaceReadback &readback);
+
 ColorSurfaceCacheInfo::~ColorSurfaceCacheInfo() {
     sws_freeContext(sws_context);
 }
 
+const std::vector<vk::Format> &VKSurfaceCache::get_compatible_view_formats(vk::Format format) {
+    const auto it = compatible_view_formats.find(format);
+    if (it != compatible_view_formats.end())
+        return it->second;
+
+    // the formats color surfaces can have, see color::translate_format
+    static constexpr vk::Format surface_formats[] = {
+        vk::Format::eR8Unorm, vk::Format::eR8Snorm, vk::Format::eR16Unorm, vk::Format::eR16Snorm, vk::Format::eR16Sfloat, vk::Format::eR32Sfloat,
+        vk::Format::eR8G8Unorm, vk::Format::eR8G8Snorm, vk::Format::eR16G16Unorm, vk::Format::eR16G16Snorm, vk::Format::eR16G16Sfloat, vk::Format::eR32G32Sfloat,
+        vk::Format::eR8G8B8A8Unorm, vk::Format::eR8G8B8A8Srgb, vk::Format::eR8G8B8A8Snorm, vk::Format::eR16G16B16A16Sfloat,
+        vk::Format::eR5G6B5UnormPack16, vk::Format::eB10G11R11UfloatPack32, vk::Format::eE5B9G9R9UfloatPack32,
+        vk::Format::eA1R5G5B5UnormPack16, vk::Format::eR4G4B4A4UnormPack16, vk::Format::eA2R10G10B10UnormPack32
+    };
+    const auto is_rgba8 = [](vk::Format format) {
+        return format == vk::Format::eR8G8B8A8Unorm || format == vk::Format::eR8G8B8A8Srgb;
+    };
+
+    // without VK_KHR_maintenance2, the views have the same usage as the surface
+    vk::FormatFeatureFlags required_features = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eColorAttachment;
+    if (state.features.support_shader_interlock)
+        required_features |= vk::FormatFeatureFlagBits::eStorageImage;
+
+    std::vector<vk::Format> formats = { format };
+    for (const vk::Format view_format : surface_formats) {
+        if (view_format == format || vk::blockSize(view_format) != vk::blockSize(format))
+            continue;
+
+        // the srgb view of rgba8 surfaces was already used before, keep it
+        const bool is_srgb_pair = is_rgba8(format) && is_rgba8(view_format);
+        if (!is_srgb_pair && (state.physical_device.getFormatProperties(view_format).optimalTilingFeatures & required_features) != required_features)
+            continue;
+
+        formats.push_back(view_format);
+    }
+
+    return compatible_view_formats[format] = std::move(formats);
+}
+
 void VKSurfaceCache::destroy_framebuffers(vk::ImageView view) {
     vkutil::DestroyQueue &destroy_queue = state.frame().destroy_queue;
     for (auto it = framebuffer_array.begin(); it != framebuffer_array.end();) {
@@ -88,9 +129,31 @@ void VKSurfaceCache::destroy_surface(ColorSurfaceCacheInfo &info) {
         destroy_queue.add_image(casted.texture);
     }
     info.casted_textures.clear();
+    for (auto &casted_view : info.casted_views)
+        destroy_queue.add(casted_view.view);
+    info.casted_views.clear();
+
+    if (info.readback) {
+        // the memory trap may still be set, make sure it won't write anything
+        std::unique_lock<std::mutex> lock(info.readback->mutex);
+        info.readback->pending = false;
+        info.readback->copies_done = info.readback->copies_requested;
+        destroy_queue.add_buffer(info.readback->staging_buffer);
+        lock.unlock();
+        info.readback->copy_done_cond.notify_all();
+        info.readback.reset();
+    }
 
     destroy_queue.add(info.alternate_view);
 
+    if (info.guest_access) {
+        // the memory trap may still be set, it only updates the shared state
+        sync_tracker.untrack(info.data.address(), info.guest_access.get());
+        info.guest_access.reset();
+    }
+    if (last_written_surface == &info)
+        last_written_surface = nullptr;
+
     destroy_framebuffers(info.texture.view);
     destroy_queue.add_image(info.texture);
 }
@@ -115,6 +178,7 @@ VKSurfaceCache::VKSurfaceCache(VKState &state)
 }
 
 SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(MemState &mem, SceGxmColorSurface *color) {
+    R_FRAME_TIMER(SurfaceCache);
     // Create the key to access the cache struct
     const uint32_t address = color->data.address();
 
@@ -124,18 +188,9 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(Mem
     uint32_t width = original_width * state.res_multiplier;
     uint32_t height = original_height * state.res_multiplier;
 
-    bool overlap = true;
-
-    // Of course, this works under the assumption that range must be unique :D
-    auto ite = color_address_lookup.upper_bound(address);
-    if (ite == color_address_lookup.begin())
-        // no match
-        overlap = false;
-    else
-        ite--;
-    // ite is now the first item with an adress lower or equal to key
-
-    overlap = (overlap && (ite->first + ite->second->total_bytes) > address);
+    // the innermost surface containing the address
+    const auto *surface_range = color_address_lookup.find_containing(address);
+    const bool overlap = surface_range != nullptr;
 
     const SceGxmColorBaseFormat base_format = gxm::get_base_format(color->colorFormat);
     vk::Format vk_format = color::translate_format(base_format);
@@ -163,7 +218,8 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(Mem
     VKContext *context = reinterpret_cast<VKContext *>(state.context);
 
     if (overlap) {
-        ColorSurfaceCacheInfo &info = *ite->second;
+        ColorSurfaceCacheInfo &info = *surface_range->value;
+        const Address surface_address = static_cast<Address>(surface_range->begin);
 
         // There are four situations I think of:
         // 1. Different base address, lookup for write, in this case, if the cached surface range contains the given address, then
@@ -171,24 +227,30 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(Mem
         // 2. Same base address, but width and height change to be larger, or format change if write. Remake a new one for both read and write sitatation.
         // 3. Out of cache range. In write case, create a new one, in read case, lul
         // 4. Read situation with smaller width and height, probably need to extract the needed region out.
-        // 5. the surface is a gbuffer and we are currently trying to read the 2nd component, in this case key == ite->first + 4
-        const bool addr_in_range_of_cache = ((address + total_surface_size) <= (ite->first + info.total_bytes + 4));
-        const bool cache_probably_freed = (ite->first != address) && addr_in_range_of_cache;
+        // 5. the surface is a gbuffer and we are currently trying to read the 2nd component, in this case key == surface_address + 4
+        const bool addr_in_range_of_cache = ((address + total_surface_size) <= (surface_address + info.total_bytes + 4));
+        const bool cache_probably_freed = (surface_address != address) && addr_in_range_of_cache;
         const bool surface_extent_changed = info.height < height || bytes_per_stride != info.stride_bytes || tiling != info.tiling;
         bool surface_stat_changed = false;
 
-        if (ite->first == address)
+        if (surface_address == address)
             surface_stat_changed = surface_extent_changed || info.width < width || base_format != info.format;
 
         const bool invalidated = cache_probably_freed || surface_stat_changed || !addr_in_range_of_cache;
         if (invalidated) {
             destroy_surface(info);
-            color_address_lookup.erase(ite);
+            color_address_lookup.erase(surface_address, &info);
             color_surface_queue.set_as_lru(&info);
         } else {
             color_surface_queue.set_as_mru(&info);
             last_written_surface = &info;
 
+            // the guest wrote to the surface since it was last rendered, the scene must start from this content
+            if (sync_tracker.before_gpu_use(surface_address) == SurfaceSyncAction::Upload && upload_surface(info)) {
+                if (sync_tracker.mark_synced(surface_address))
+                    arm_sync_trap(mem, info);
+            }
+
             // if this surface has not been rendered to for the last 60 frames, consider it is not safe not to render all shaders to it
             constexpr uint64_t big_delay_between_frames = 60;
             state.pipeline_cache.can_use_deferred_compilation = context->frame_timestamp - info.last_frame_rendered < big_delay_between_frames;
@@ -220,12 +282,12 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(Mem
         // deferred destruction of the existing surface
         destroy_surface(info_added);
     if (info_added.data)
-        color_address_lookup.erase(info_added.data.address());
+        color_address_lookup.erase(info_added.data.address(), &info_added);
 
     color_surface_queue.set_as_mru(&info_added);
     info_added.last_frame_rendered = context->frame_timestamp;
 
-    color_address_lookup[address] = &info_added;
+    color_address_lookup.insert(address, static_cast<uint64_t>(address) + total_surface_size, &info_added);
 
     info_added.width = width;
     info_added.height = height;
@@ -246,22 +308,27 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(Mem
     image.layout = vkutil::ImageLayout::Undefined;
 
     // we might have to create a non-srgb/linear view later if this surface is used for presentation
-    const bool need_mutable = (vk_format == vk::Format::eR8G8B8A8Unorm || vk_format == vk::Format::eR8G8B8A8Srgb);
+    const bool need_srgb_view = (vk_format == vk::Format::eR8G8B8A8Unorm || vk_format == vk::Format::eR8G8B8A8Srgb);
+    // when the surface is sampled with another format of the same texel size, a view is used instead of a copy
+    // this is only done with the list of formats, otherwise the driver may disable the compression of the surface
+    info_added.view_formats.clear();
+    if (support_image_format_specifier && get_compatible_view_formats(vk_format).size() > 1)
+        info_added.view_formats = get_compatible_view_formats(vk_format);
+
+    const bool need_mutable = need_srgb_view || !info_added.view_formats.empty();
     const vk::ImageCreateFlags image_create_flags = need_mutable ? vk::ImageCreateFlagBits::eMutableFormat : vk::ImageCreateFlags();
     const void *image_info_pNext = nullptr;
+    vk::ImageFormatListCreateInfoKHR image_info_formats{};
     if (support_image_format_specifier && need_mutable) {
-        static const vk::Format view_formats[] = { vk::Format::eR8G8B8A8Unorm, vk::Format::eR8G8B8A8Srgb };
-        static const vk::ImageFormatListCreateInfoKHR image_info_formats{
-            .viewFormatCount = 2,
-            .pViewFormats = view_formats
-        };
+        image_info_formats.setViewFormats(info_added.view_formats);
         image_info_pNext = &image_info_formats;
     }
 
     vk::ImageUsageFlags surface_usages = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eInputAttachment;
     if (state.features.support_shader_interlock)
         surface_usages |= vk::ImageUsageFlagBits::eStorage;
-    image.init_image(surface_usages, vkutil::default_comp_mapping, image_create_flags, image_info_pNext);
+    image.init_image(surface_usages, vkutil::default_comp_mapping, image_create_flags, image_info_pNext, state.get_surface_alloc_info(image.width, image.height));
+    vkutil::track_allocation(alloc_tracker::Subsystem::SurfaceCache, image.allocation);
 
     // do it in the prerender if we read from this texture in the same scene (although this would be useless)
     vk::CommandBuffer cmd_buffer = context->prerender_cmd;
@@ -273,27 +340,25 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(Mem
     image.transition_to(cmd_buffer, vkutil::ImageLayout::ColorAttachmentReadWrite);
 
     last_written_surface = &info_added;
-    info_added.need_surface_sync.reset();
-    info_added.need_surface_sync = std::make_shared<bool>();
-    *info_added.need_surface_sync = false;
 
     // we only support surface sync of linear surfaces for now
     if (!can_mprotect_mapped_memory) {
         // peform surface sync on everything
         // it is slow but well... we can't mprotect the buffer
-        *info_added.need_surface_sync = color->surfaceType == SCE_GXM_COLOR_SURFACE_LINEAR;
+        if (color->surfaceType == SCE_GXM_COLOR_SURFACE_LINEAR)
+            info_added.guest_access = sync_tracker.track(address, total_surface_size, false);
     } else if (color->surfaceType == SCE_GXM_COLOR_SURFACE_LINEAR && format_support_surface_sync(base_format)) {
-        uint32_t addr_start = align(info_added.data.address(), KiB(4));
-        uint32_t addr_end = align_down(info_added.data.address() + info_added.total_bytes, KiB(4));
-        if (addr_start >= addr_end) {
-            // we still need to protect something, even if it's not completely accurate
-            addr_start = align_down(info_added.data.address(), KiB(4));
-            addr_end = align(info_added.data.address() + info_added.total_bytes, KiB(4));
+        info_added.guest_access = sync_tracker.track(address, total_surface_size, true);
+        arm_sync_trap(mem, info_added);
+
+        // the write back is done when the trap is hit, so the surface must cover its pages entirely
+        const bool is_page_aligned = (address % KiB(4)) == 0 && ((address + total_surface_size) % KiB(4)) == 0;
+        if (use_async_surface_sync && is_page_aligned && !format_need_additional_memory(base_format)) {
+            info_added.readback = std::make_shared<SurfaceReadback>();
+            info_added.readback->data = info_added.data;
+            info_added.readback->size = info_added.total_bytes;
+            info_added.readback->nb_pixels = color->strideInPixels * original_height;
         }
-        add_protect(mem, addr_start, addr_end - addr_start, MemPerm::None, [need_sync = info_added.need_surface_sync](Address addr, bool) {
-            *need_sync = true;
-            return true;
-        });
     }
 
     // it's not impossible that this surface will be rendered once and only used after, so do not skip any shader on it
@@ -302,7 +367,56 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_color_surface_for_framebuffer(Mem
     return { info_added.texture.view, &info_added.texture };
 }
 
+void VKSurfaceCache::arm_sync_trap(MemState &mem, ColorSurfaceCacheInfo &info) {
+    uint32_t addr_start = align(info.data.address(), KiB(4));
+    uint32_t addr_end = align_down(info.data.address() + info.total_bytes, KiB(4));
+    if (addr_start >= addr_end) {
+        // we still need to protect something, even if it's not completely accurate
+        addr_start = align_down(info.data.address(), KiB(4));
+        addr_end = align(info.data.address() + info.total_bytes, KiB(4));
+    }
+    add_protect(mem, addr_start, addr_end - addr_start, MemPerm::None, [access = info.guest_access](Address addr, bool write) {
+        access->accessed = true;
+        if (write)
+            access->written = true;
+        access->armed = false;
+        return true;
+    });
+}
+
+bool VKSurfaceCache::upload_surface(ColorSurfaceCacheInfo &info) {
+    // the guest memory only has the layout of the image without upscaling, swizzle or padding component
+    if (info.width != info.original_width || info.height != info.original_height
+        || info.swizzle.r != vk::ComponentSwizzle::eR || format_need_additional_memory(info.format))
+        return false;
+
+    auto [buffer, offset] = state.get_matching_mapping(info.data);
+    if (!buffer)
+        return false;
+
+    // done before the render pass of the scene
+    VKContext *context = reinterpret_cast<VKContext *>(state.context);
+    vk::CommandBuffer cmd_buffer = context->prerender_cmd;
+    const vkutil::ImageLayout previous_layout = info.texture.layout;
+    info.texture.transition_to(cmd_buffer, vkutil::ImageLayout::TransferDst);
+
+    const uint32_t pixel_stride = (info.stride_bytes * 8) / gxm::bits_per_pixel(info.format);
+    vk::BufferImageCopy copy{
+        .bufferOffset = offset,
+        .bufferRowLength = pixel_stride,
+        .bufferImageHeight = info.original_height,
+        .imageSubresource = vkutil::color_subresource_layer,
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { info.original_width, info.original_height, 1 }
+    };
+    cmd_buffer.copyBufferToImage(info.texture.image, vk::ImageLayout::eTransferDstOptimal, buffer, copy);
+
+    info.texture.transition_to(cmd_buffer, (previous_layout == vkutil::ImageLayout::Undefined) ? vkutil::ImageLayout::ColorAttachmentReadWrite : previous_layout);
+    return true;
+}
+
 std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_texture(const SceGxmTexture &texture, const SceGxmColorBaseFormat base_format, TextureViewport *texture_viewport) {
+    R_FRAME_TIMER(SurfaceCache);
     // Create the key to access the cache struct
     const uint32_t address = (texture.data_addr << 2);
 
@@ -312,21 +426,13 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_tex
     const uint32_t width = original_width * state.res_multiplier;
     const uint32_t height = original_height * state.res_multiplier;
 
-    bool overlap = true;
-    // Of course, this works under the assumption that range must be unique :D
-    auto ite = color_address_lookup.upper_bound(address);
-    if (ite == color_address_lookup.begin())
-        // no match
-        overlap = false;
-    else
-        ite--;
-    // ite is now the first item with an adress lower or equal to key
+    // the innermost surface containing the address, even if other surfaces overlap it
+    const auto *surface_range = color_address_lookup.find_containing(address);
     bool invalidated = false;
 
-    overlap = (overlap && (ite->first + ite->second->total_bytes) > address);
-
-    if (!overlap)
+    if (surface_range == nullptr)
         return std::nullopt;
+    const Address surface_address = static_cast<Address>(surface_range->begin);
 
     const vk::ComponentMapping swizzle = texture::translate_swizzle(gxm::get_format(texture));
     vk::Format vk_format = color::translate_format(base_format);
@@ -368,7 +474,7 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_tex
     }
     uint32_t total_surface_size = stride_bytes * original_height;
 
-    ColorSurfaceCacheInfo &info = *ite->second;
+    ColorSurfaceCacheInfo &info = *surface_range->value;
 
     if ((base_format == SCE_GXM_COLOR_BASE_FORMAT_U8U8U8 || info.format == SCE_GXM_COLOR_BASE_FORMAT_U8U8U8)
         && base_format != info.format)
@@ -381,10 +487,10 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_tex
         return std::nullopt;
 
     // Check if we can use this surface
-    bool addr_in_range_of_cache = ((address + total_surface_size) <= (ite->first + info.total_bytes + 4));
+    bool addr_in_range_of_cache = ((address + total_surface_size) <= (surface_address + info.total_bytes + 4));
     const bool surface_extent_changed = (info.height < height);
 
-    if (ite->first != address && !addr_in_range_of_cache)
+    if (surface_address != address && !addr_in_range_of_cache)
         // persona 4 sample from the top of a texture while the bottom wasn't rendered to, the fact that both the surface and
         // the texture start at the same location should be enough
         return std::nullopt;
@@ -397,7 +503,7 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_tex
 
     // TODO: this is true only for linear textures (and also kind of for tiled textures) (and in this case start_x = 0),
     // for swizzled textures this is different
-    const uint32_t data_delta = address - ite->first;
+    const uint32_t data_delta = address - surface_address;
     uint32_t start_sourced_line = (data_delta / stride_bytes) * state.res_multiplier;
     uint32_t start_x = (data_delta % stride_bytes) / bytes_per_pixel_requested * state.res_multiplier;
 
@@ -448,6 +554,47 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_tex
         };
     }
 
+    // the same texels only interpreted with another format, a view of the surface is enough
+    const bool is_view_compatible = !is_same_image && (bytes_per_pixel_requested == bytes_per_pixel_in_store)
+        && (std::find(info.view_formats.begin(), info.view_formats.end(), vk_format) != info.view_formats.end());
+    const bool is_same_area = (start_sourced_line == 0) && (start_x == 0) && (info.width == width) && (info.height == height);
+    if (is_view_compatible && (is_same_area || state.features.use_texture_viewport)) {
+        if (state.features.use_texture_viewport) {
+            *texture_viewport = {
+                .ratio = {
+                    original_width / static_cast<float>(info.original_width),
+                    original_height / static_cast<float>(info.original_height) },
+                .offset = { start_x / static_cast<float>(info.width), start_sourced_line / static_cast<float>(info.height) }
+            };
+        }
+
+        // Only take into consideration the current swizzle when it makes sense, like for the copies
+        const vk::ComponentMapping resulting_swizzle = (vk::componentCount(info.texture.format) == vk::componentCount(vk_format))
+            ? vkutil::color_to_texture_swizzle(info.swizzle, swizzle)
+            : swizzle;
+
+        auto casted_view = std::find_if(info.casted_views.begin(), info.casted_views.end(), [&](const CastedView &view) {
+            return view.format == vk_format && view.swizzle == resulting_swizzle;
+        });
+        if (casted_view == info.casted_views.end()) {
+            const vk::ImageViewCreateInfo view_info{
+                .image = info.texture.image,
+                .viewType = vk::ImageViewType::e2D,
+                .format = vk_format,
+                .components = resulting_swizzle,
+                .subresourceRange = vkutil::color_subresource_range
+            };
+            info.casted_views.push_back({ vk_format, resulting_swizzle, state.device.createImageView(view_info) });
+            casted_view = std::prev(info.casted_views.end());
+        }
+
+        return TextureLookupResult{
+            casted_view->view,
+            info.texture.layout,
+            vk_format
+        };
+    }
+
     if (is_same_image || (start_sourced_line != 0) || (start_x != 0) || (info.width != width) || (info.height != height) || (info.format != base_format)) {
         const uint64_t scene_timestamp = reinterpret_cast<VKContext *>(state.context)->scene_timestamp;
 
@@ -506,6 +653,7 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_tex
                 resulting_swizzle = swizzle;
 
             casted->texture.init_image(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst, resulting_swizzle);
+            vkutil::track_allocation(alloc_tracker::Subsystem::SurfaceCache, casted->texture.allocation);
             casted->texture.transition_to(cmd_buffer, vkutil::ImageLayout::TransferDst);
         } else {
             casted->texture.transition_to_discard(cmd_buffer, vkutil::ImageLayout::TransferDst);
@@ -603,7 +751,45 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_color_surface_as_tex
     }
 }
 
+ColorSurfaceCacheInfo *VKSurfaceCache::retrieve_color_surface_for_transfer(const SceGxmTransferImage &image, const SceGxmTransferType type) {
+    R_FRAME_TIMER(SurfaceCache);
+    const Address address = image.address.address();
+    const auto *surface_range = color_address_lookup.find_containing(address);
+    if (surface_range == nullptr || surface_range->begin != address)
+        return nullptr;
+
+    ColorSurfaceCacheInfo &info = *surface_range->value;
+
+    SurfaceTiling tiling;
+    switch (type) {
+    case SCE_GXM_TRANSFER_LINEAR:
+        tiling = SurfaceTiling::Linear;
+        break;
+    case SCE_GXM_TRANSFER_TILED:
+        tiling = SurfaceTiling::Tiled;
+        break;
+    default:
+        tiling = SurfaceTiling::Swizzled;
+        break;
+    }
+
+    if (tiling != info.tiling || image.stride <= 0 || static_cast<uint32_t>(image.stride) != info.stride_bytes)
+        return nullptr;
+
+    // the transfer copies raw pixels, it can't be done on the surface if it would reinterpret them
+    const uint32_t transfer_bytes_per_pixel = (gxm::get_bits_per_pixel(image.format) + 7) / 8;
+    if (transfer_bytes_per_pixel != gxm::bits_per_pixel(info.format) / 8)
+        return nullptr;
+
+    if (image.x + image.width > info.original_width || image.y + image.height > info.original_height)
+        return nullptr;
+
+    color_surface_queue.set_as_mru(&info);
+    return &info;
+}
+
 SurfaceRetrieveResult VKSurfaceCache::retrieve_depth_stencil_for_framebuffer(SceGxmDepthStencilSurface *depth_stencil, const uint32_t width, const uint32_t height) {
+    R_FRAME_TIMER(SurfaceCache);
     // when writing we use the render target size which is already upscaled
     int32_t memory_width = width / state.res_multiplier;
     int32_t memory_height = height / state.res_multiplier;
@@ -619,6 +805,10 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_depth_stencil_for_framebuffer(Sce
     const bool is_stencil_only = depth_stencil->depth_data.address() == 0;
     DepthStencilSurfaceCacheInfo *cached_info = nullptr;
 
+    // only worth it if the GPU has tile memory, the surface is remade once it must be loaded or stored
+    const bool is_transient = state.support_lazy_memory && !state.features.support_shader_interlock
+        && !depth_stencil->force_load && !depth_stencil->force_store;
+
     if (!is_stencil_only) {
         auto it = depth_address_lookup.find(depth_stencil->depth_data.address());
         if (it != depth_address_lookup.end())
@@ -636,7 +826,8 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_depth_stencil_for_framebuffer(Sce
         bool need_remake = cached_info->texture.width < width
             || cached_info->texture.height < height
             || cached_info->stride_samples != depth_stencil->get_stride()
-            || cached_info->tiling != tiling;
+            || cached_info->tiling != tiling
+            || (cached_info->is_transient && !is_transient);
 
         if (!need_remake)
             return {
@@ -669,6 +860,7 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_depth_stencil_for_framebuffer(Sce
     cached_info->multisample_mode = target->multisample_mode;
     cached_info->stride_samples = depth_stencil->get_stride();
     cached_info->tiling = tiling;
+    cached_info->is_transient = is_transient;
 
     vkutil::Image &image = cached_info->texture;
 
@@ -680,7 +872,18 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_depth_stencil_for_framebuffer(Sce
     image.height = height;
     image.format = vk::Format::eD32SfloatS8Uint;
     image.layout = vkutil::ImageLayout::Undefined;
+    if (is_transient) {
+        // the render pass clears it, it is never read outside of it
+        image.init_image(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+            vkutil::default_comp_mapping, vk::ImageCreateFlags(), nullptr, vkutil::vma_lazy_alloc);
+        vkutil::track_allocation(alloc_tracker::Subsystem::SurfaceCache, image.allocation);
+        return {
+            image.view,
+            &image
+        };
+    }
     image.init_image(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled);
+    vkutil::track_allocation(alloc_tracker::Subsystem::SurfaceCache, image.allocation);
 
     image.transition_to(cmd_buffer, vkutil::ImageLayout::TransferDst, vkutil::ds_subresource_range);
     vk::ClearDepthStencilValue clear_value{
@@ -697,6 +900,7 @@ SurfaceRetrieveResult VKSurfaceCache::retrieve_depth_stencil_for_framebuffer(Sce
 }
 
 std::optional<TextureLookupResult> VKSurfaceCache::retrieve_depth_stencil_as_texture(const SceGxmTexture &texture, TextureViewport *texture_viewport) {
+    R_FRAME_TIMER(SurfaceCache);
     SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(texture));
     bool can_be_depth = false;
     bool can_be_stencil = false;
@@ -761,7 +965,8 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_depth_stencil_as_tex
             found_info = it->second;
     }
 
-    if (found_info == nullptr)
+    // nothing was ever stored in a transient surface, the texture is read from memory
+    if (found_info == nullptr || found_info->is_transient)
         return std::nullopt;
 
     DepthStencilSurfaceCacheInfo &cached_info = *found_info;
@@ -833,6 +1038,7 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_depth_stencil_as_tex
             .scene_timestamp = 0
         };
         read_only.depth_view.init_image(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
+        vkutil::track_allocation(alloc_tracker::Subsystem::SurfaceCache, read_only.depth_view.allocation);
         // we want a texture view with only the depth or stencil aspect bit
         // TODO: not efficient
         state.device.destroy(read_only.depth_view.view);
@@ -901,6 +1107,7 @@ std::optional<TextureLookupResult> VKSurfaceCache::retrieve_depth_stencil_as_tex
 static Framebuffer empty_framebuffer{};
 Framebuffer &VKSurfaceCache::retrieve_framebuffer_handle(MemState &mem, SceGxmColorSurface *color, SceGxmDepthStencilSurface *depth_stencil,
     vk::RenderPass standard_render_pass, vk::RenderPass interlock_render_pass, vk::ImageView &color_view, vk::ImageView &ds_view) {
+    R_FRAME_TIMER(SurfaceCache);
     if (!target) {
         LOG_ERROR("Unable to retrieve framebuffer with no active render target!");
         return empty_framebuffer;
@@ -927,8 +1134,8 @@ Framebuffer &VKSurfaceCache::retrieve_framebuffer_handle(MemState &mem, SceGxmCo
     if (depth_stencil) {
         ds_result = retrieve_depth_stencil_for_framebuffer(depth_stencil, target->width, target->height);
     } else {
-        ds_result.view = target->depthstencil.view;
-        ds_result.base_image = &target->depthstencil;
+        ds_result.view = target->depthstencil->view;
+        ds_result.base_image = target->depthstencil.get();
     }
 
     color_view = color_result.view;
@@ -968,13 +1175,22 @@ Framebuffer &VKSurfaceCache::retrieve_framebuffer_handle(MemState &mem, SceGxmCo
     return (framebuffer_array[key] = { fb_standard, fb_interlock, color_result.base_image });
 }
 
-ColorSurfaceCacheInfo *VKSurfaceCache::perform_surface_sync() {
+PostSurfaceSyncRequest VKSurfaceCache::perform_surface_sync(MemState &mem, bool can_defer) {
+    R_FRAME_TIMER(SurfaceCache);
     // surface sync is supported only if memory mapping is enabled
     if (!state.features.support_memory_mapping)
-        return nullptr;
+        return {};
 
-    if (last_written_surface == nullptr || !*last_written_surface->need_surface_sync)
-        return nullptr;
+    if (last_written_surface == nullptr || !last_written_surface->guest_access)
+        return {};
+
+    const Address surface_address = last_written_surface->data.address();
+    sync_tracker.record_gpu_write(surface_address);
+    if (sync_tracker.after_gpu_write(surface_address) != SurfaceSyncAction::Readback) {
+        // the guest did not look at the surface since its last readback
+        last_written_surface = nullptr;
+        return {};
+    }
 
     VKContext *context = reinterpret_cast<VKContext *>(state.context);
     vk::CommandBuffer cmd_buffer = context->render_cmd;
@@ -1004,6 +1220,7 @@ ColorSurfaceCacheInfo *VKSurfaceCache::perform_surface_sync() {
             blit_image.height = last_written_surface->original_height;
 
             blit_image.init_image(vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst);
+            vkutil::track_allocation(alloc_tracker::Subsystem::SurfaceCache, blit_image.allocation);
             blit_image.transition_to(cmd_buffer, vkutil::ImageLayout::TransferDst);
         } else {
             blit_image.transition_to_discard(cmd_buffer, vkutil::ImageLayout::TransferDst);
@@ -1023,9 +1240,27 @@ ColorSurfaceCacheInfo *VKSurfaceCache::perform_surface_sync() {
         image_layout = vk::ImageLayout::eTransferSrcOptimal;
     }
 
+    std::shared_ptr<SurfaceReadback> readback = last_written_surface->readback;
+    if (readback && !can_defer) {
+        // the copy below is done directly to the guest memory, the staging buffer content is outdated
+        std::unique_lock<std::mutex> lock(readback->mutex);
+        readback->pending = false;
+        lock.unlock();
+        readback.reset();
+    }
+
     vk::Buffer buffer;
     uint32_t offset;
-    if (format_need_additional_memory(last_written_surface->format)) {
+    if (readback) {
+        vkutil::Buffer &staging_buffer = readback->staging_buffer;
+        if (!staging_buffer.buffer) {
+            staging_buffer.size = readback->size;
+            staging_buffer.init_buffer(vk::BufferUsageFlagBits::eTransferDst, vkutil::vma_mapped_alloc);
+        }
+
+        buffer = staging_buffer.buffer;
+        offset = 0;
+    } else if (format_need_additional_memory(last_written_surface->format)) {
         if (!last_written_surface->copy_buffer)
             last_written_surface->copy_buffer = std::make_unique<vkutil::Buffer>();
 
@@ -1040,6 +1275,8 @@ ColorSurfaceCacheInfo *VKSurfaceCache::perform_surface_sync() {
         offset = 0;
     } else {
         std::tie(buffer, offset) = state.get_matching_mapping(last_written_surface->data);
+        if (!buffer)
+            return {};
     }
     const uint32_t pixel_stride = (last_written_surface->stride_bytes * 8) / gxm::bits_per_pixel(last_written_surface->format);
     vk::BufferImageCopy copy{
@@ -1052,11 +1289,39 @@ ColorSurfaceCacheInfo *VKSurfaceCache::perform_surface_sync() {
     };
     cmd_buffer.copyImageToBuffer(image_to_copy, image_layout, buffer, copy);
 
+    if (readback) {
+        std::unique_lock<std::mutex> lock(readback->mutex);
+        const uint64_t copy_idx = ++readback->copies_requested;
+        readback->pending = true;
+        readback->format = last_written_surface->texture.format;
+        readback->swizzle_r = is_swizzle_identity ? vk::ComponentSwizzle::eR : last_written_surface->swizzle.r;
+        const bool need_protect = !readback->is_protected;
+        readback->is_protected = true;
+        lock.unlock();
+
+        // the trap is only missing if the last copy was written back, so no other trap can be waiting on this readback
+        if (need_protect) {
+            add_protect(mem, readback->data.address(), readback->size, MemPerm::None, [mem = &mem, readback](Address, bool) {
+                write_back_surface_readback(*mem, *readback);
+                return true;
+            });
+        }
+
+        if (sync_tracker.mark_synced(surface_address))
+            arm_sync_trap(mem, *last_written_surface);
+        last_written_surface = nullptr;
+        return { .readback = std::move(readback), .readback_copy = copy_idx };
+    }
+
     const bool need_post_sync = !is_swizzle_identity || format_need_additional_memory(last_written_surface->format);
+    // the post sync writes to the guest memory from the host, the trap would take it for a guest access
+    // so these surfaces keep being read back after each scene
+    if (!need_post_sync && sync_tracker.mark_synced(surface_address))
+        arm_sync_trap(mem, *last_written_surface);
     ColorSurfaceCacheInfo *return_value = need_post_sync ? last_written_surface : nullptr;
     last_written_surface = nullptr;
 
-    return return_value;
+    return { .cache_info = return_value };
 }
 
 template <typename T>
@@ -1091,14 +1356,14 @@ void swizzle_text_T_4(T *pixels, uint32_t nb_pixel) {
 }
 
 template <typename T>
-void swizzle_text_T(T *pixels, uint32_t nb_pixel, ColorSurfaceCacheInfo *surface) {
+void swizzle_text_T(T *pixels, uint32_t nb_pixel, vk::Format format, vk::ComponentSwizzle swizzle_r) {
     // there can only be 2 or 4 component textures here
-    if (vk::componentCount(surface->texture.format) == 2) {
+    if (vk::componentCount(format) == 2) {
         swizzle_text_T_2<T>(pixels, nb_pixel);
     } else {
         // find the swizzle
         // swizzles are inversed
-        switch (surface->swizzle.r) {
+        switch (swizzle_r) {
         case vk::ComponentSwizzle::eB:
             // BGRA
             swizzle_text_T_4<T, 0>(pixels, nb_pixel);
@@ -1115,6 +1380,20 @@ void swizzle_text_T(T *pixels, uint32_t nb_pixel, ColorSurfaceCacheInfo *surface
     }
 }
 
+static void swizzle_surface(uint8_t *pixels, uint32_t nb_pixels, vk::Format format, vk::ComponentSwizzle swizzle_r) {
+    switch (vk::componentBits(format, 0)) {
+    case 8:
+        swizzle_text_T<uint8_t>(pixels, nb_pixels, format, swizzle_r);
+        break;
+    case 16:
+        swizzle_text_T<uint16_t>(reinterpret_cast<uint16_t *>(pixels), nb_pixels, format, swizzle_r);
+        break;
+    case 32:
+        swizzle_text_T<uint32_t>(reinterpret_cast<uint32_t *>(pixels), nb_pixels, format, swizzle_r);
+        break;
+    }
+}
+
 void VKSurfaceCache::perform_post_surface_sync(const MemState &mem, ColorSurfaceCacheInfo *surface) {
     if (surface == nullptr)
         return;
@@ -1138,40 +1417,63 @@ void VKSurfaceCache::perform_post_surface_sync(const MemState &mem, ColorSurface
         return;
     }
 
-    switch (vk::componentBits(surface->texture.format, 0)) {
-    case 8:
-        swizzle_text_T<uint8_t>(pixels, nb_pixels, surface);
-        break;
-    case 16:
-        swizzle_text_T<uint16_t>(reinterpret_cast<uint16_t *>(pixels), nb_pixels, surface);
-        break;
-    case 32:
-        swizzle_text_T<uint32_t>(reinterpret_cast<uint32_t *>(pixels), nb_pixels, surface);
-        break;
+    swizzle_surface(pixels, nb_pixels, surface->texture.format, surface->swizzle.r);
+}
+
+static void write_back_surface_readback(MemState &mem, SurfaceReadback &readback) {
+    // called by the memory trap, the protect mutex is held
+    std::unique_lock<std::mutex> lock(readback.mutex);
+    // the copy may not be done yet, the wait thread does not need the protect mutex so this can't deadlock
+    readback.copy_done_cond.wait(lock, [&]() { return readback.copies_done >= readback.copies_requested; });
+
+    if (readback.pending) {
+        // the pages are made accessible again right after the trap, do it before for the copy
+        unprotect_inner(mem, readback.data.address(), readback.size);
+
+        uint8_t *pixels = readback.data.cast<uint8_t>().get(mem);
+        memcpy(pixels, readback.staging_buffer.mapped_data, readback.size);
+        if (readback.swizzle_r != vk::ComponentSwizzle::eR)
+            swizzle_surface(pixels, readback.nb_pixels, readback.format, readback.swizzle_r);
+
+        readback.pending = false;
     }
+    readback.is_protected = false;
 }
 
 void VKSurfaceCache::destroy_associated_framebuffers(const VKRenderTarget *render_target) {
     destroy_framebuffers(render_target->color.view);
-    destroy_framebuffers(render_target->depthstencil.view);
+    // the other render targets sharing the depth-stencil keep their framebuffers
+    if (render_target->depthstencil.use_count() == 1)
+        destroy_framebuffers(render_target->depthstencil->view);
+}
+
+std::shared_ptr<vkutil::Image> VKSurfaceCache::retrieve_transient_depth_stencil(uint32_t width, uint32_t height) {
+    // forget the depth-stencils whose render targets have all been destroyed
+    std::erase_if(transient_ds_lookup, [](const auto &entry) { return entry.second.expired(); });
+
+    std::weak_ptr<vkutil::Image> &entry = transient_ds_lookup[{ width, height }];
+    if (std::shared_ptr<vkutil::Image> image = entry.lock())
+        return image;
+
+    auto image = std::make_shared<vkutil::Image>(width, height, vk::Format::eD32SfloatS8Uint);
+    image->init_image(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+        vkutil::default_comp_mapping, vk::ImageCreateFlags(), nullptr, vkutil::vma_lazy_alloc);
+    vkutil::track_allocation(alloc_tracker::Subsystem::SurfaceCache, image->allocation);
+    entry = image;
+    return image;
 }
 
 vk::ImageView VKSurfaceCache::sourcing_color_surface_for_presentation(Ptr<const void> address, uint32_t pitch, Viewport &viewport) {
-    // get closest surface with an address below address
-    auto ite = color_address_lookup.upper_bound(address.address());
-    if (ite == color_address_lookup.begin()) {
+    // get the innermost surface containing address
+    const auto *surface_range = color_address_lookup.find_containing(address.address());
+    if (surface_range == nullptr)
         return nullptr;
-    }
-    ite--;
 
-    ColorSurfaceCacheInfo &info = *ite->second;
-    if (info.data.address() + info.total_bytes <= address.address())
-        // they do not overlap
-        return nullptr;
+    ColorSurfaceCacheInfo &info = *surface_range->value;
 
     if (info.stride_bytes == pitch * 4) {
         // In assumption the format is RGBA8
-        const size_t data_delta = address.address() - ite->first;
+        const size_t data_delta = address.address() - surface_range->begin;
         uint32_t limited_height = viewport.height;
         if ((data_delta % (pitch * 4)) == 0) {
             uint32_t start_sourced_line = (data_delta / (pitch * 4)) * state.res_multiplier;
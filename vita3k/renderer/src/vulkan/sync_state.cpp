@@ -220,7 +220,14 @@ void sync_visibility_buffer(VKContext &context, Ptr<uint32_t> buffer, uint32_t s
         context.visibility_buffers[buffer.address()] = { buffer.address(), nullptr, 0, static_cast<uint32_t>(stride / sizeof(uint32_t)), query_pool };
         ite = context.visibility_buffers.find(buffer.address());
 
-        std::tie(ite->second.gpu_buffer, ite->second.buffer_offset) = context.state.get_matching_mapping(buffer.cast<void>());
+        if (context.state.features.support_memory_mapping) {
+            std::tie(ite->second.gpu_buffer, ite->second.buffer_offset) = context.state.get_matching_mapping(buffer.cast<void>());
+        } else {
+            // the results go through a host buffer, there is one copy of them for each frame in flight
+            vkutil::Buffer &readback_buffer = ite->second.readback_buffer;
+            readback_buffer.size = static_cast<vk::DeviceSize>(ite->second.size) * sizeof(uint32_t) * MAX_FRAMES_RENDERING;
+            readback_buffer.init_buffer(vk::BufferUsageFlagBits::eTransferDst, vkutil::vma_mapped_alloc);
+        }
         // the + 1 is to make computing the ranges easier in context.cpp
         ite->second.queries_used.resize(ite->second.size + 1, false);
     }
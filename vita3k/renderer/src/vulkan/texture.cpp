@@ -52,6 +52,42 @@ static bool is_depth_stencil_compatible_format(SceGxmTextureBaseFormat format) {
     }
 }
 
+// push constants of texture_detile.comp
+struct DetileParams {
+    uint32_t width;
+    uint32_t height;
+    uint32_t element_size;
+    uint32_t is_tiled;
+    uint32_t total_words;
+};
+
+// push constants of texture_pvrtc.comp
+struct PVRTCParams {
+    uint32_t width;
+    uint32_t height;
+    uint32_t is_2bpp;
+};
+
+// push constants of texture_yuv420.comp
+struct YUV420Params {
+    uint32_t width;
+    uint32_t height;
+    uint32_t chroma_offset;
+    uint32_t is_p3;
+};
+
+// push constants of texture_palette.comp
+struct PaletteParams {
+    uint32_t width;
+    uint32_t height;
+    uint32_t palette_offset;
+    uint32_t is_p4;
+    uint32_t layout_type;
+};
+
+// maximum number of workgroups along x for a detiling dispatch, the minimum limit is 65535
+constexpr uint32_t MAX_DETILE_GROUPS_X = 32768;
+
 VKTextureCache::VKTextureCache(VKState &state)
     : state(state) {}
 
@@ -103,7 +139,7 @@ void sync_texture(VKContext &context, MemState &mem, std::size_t index, SceGxmTe
         // get the sampler now
         context.state.texture_cache.cache_and_bind_sampler(texture);
     } else {
-        context.state.texture_cache.cache_and_bind_texture(texture, mem);
+        context.state.texture_cache.cache_and_bind_texture(texture, mem, index);
         auto &image = context.state.texture_cache.current_texture->texture;
         lookup_result = TextureLookupResult{
             image.view,
@@ -162,7 +198,10 @@ void VKTextureCache::prepare_staging_buffer(bool is_configure) {
     const bool need_wait = !use_previous_buffer
         && staging_buffer->frame_timestamp != ~0
         && staging_buffer->frame_timestamp > context->frame_timestamp - MAX_FRAMES_RENDERING
-        && staging_buffer->scene_timestamp > last_waited_scene;
+        && staging_buffer->scene_timestamp > last_waited_scene
+        // with timeline semaphores, we can check without waiting if the gpu is already done with it
+        && !(state.support_timeline_semaphore && staging_buffer->scene_timestamp != current_scene_timestamp
+            && state.get_gpu_timeline_progress() >= staging_buffer->waiting_timeline_value);
     const vk::Fence current_fence = context->next_fence;
 
     if (need_wait) {
@@ -175,16 +214,25 @@ void VKTextureCache::prepare_staging_buffer(bool is_configure) {
 
             vk::SubmitInfo submit_info{};
             submit_info.setCommandBuffers(context->cmdbuffers_to_submit);
-            state.general_queue.submit(submit_info, current_fence);
-            context->cmdbuffers_to_submit.clear();
-
-            auto result = state.device.waitForFences(current_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
-            if (result != vk::Result::eSuccess) {
-                LOG_ERROR("Could not wait for fences.");
-                assert(false);
-                return;
+            if (state.support_timeline_semaphore) {
+                state.submit_general(submit_info, nullptr);
+                context->cmdbuffers_to_submit.clear();
+                if (!state.wait_gpu_timeline(state.gpu_timeline_value)) {
+                    assert(false);
+                    return;
+                }
+            } else {
+                state.submit_general(submit_info, current_fence);
+                context->cmdbuffers_to_submit.clear();
+
+                auto result = state.device.waitForFences(current_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+                if (result != vk::Result::eSuccess) {
+                    LOG_ERROR("Could not wait for fences.");
+                    assert(false);
+                    return;
+                }
+                state.device.resetFences(current_fence);
             }
-            state.device.resetFences(current_fence);
 
             // also call begin again on the prerender command
             vk::CommandBufferBeginInfo begin_info{
@@ -197,6 +245,12 @@ void VKTextureCache::prepare_staging_buffer(bool is_configure) {
                 buffer.frame_timestamp = ~0;
                 buffer.scene_timestamp = ~0;
             }
+        } else if (state.support_timeline_semaphore) {
+            if (!state.wait_gpu_timeline(staging_buffer->waiting_timeline_value)) {
+                assert(false);
+                return;
+            }
+            last_waited_scene = staging_buffer->scene_timestamp;
         } else {
             // wait for the fence, but don't reset it
             auto result = state.device.waitForFences(staging_buffer->waiting_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
@@ -215,6 +269,8 @@ void VKTextureCache::prepare_staging_buffer(bool is_configure) {
         staging_buffer->scene_timestamp = current_scene_timestamp;
         staging_buffer->frame_timestamp = context->frame_timestamp;
         staging_buffer->waiting_fence = current_fence;
+        // the next submission is the one using this buffer
+        staging_buffer->waiting_timeline_value = state.gpu_timeline_value + 1;
         staging_buffer->used_so_far = 0;
 
         if (staging_buffer->buffer.size < current_texture->memory_needed) {
@@ -223,7 +279,30 @@ void VKTextureCache::prepare_staging_buffer(bool is_configure) {
             staging_buffer->buffer.destroy();
 
             staging_buffer->buffer.size = current_texture->memory_needed;
-            staging_buffer->buffer.init_buffer(vk::BufferUsageFlagBits::eTransferSrc, vkutil::vma_mapped_alloc);
+            vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferSrc;
+            if (use_gpu_decode)
+                usage |= vk::BufferUsageFlagBits::eStorageBuffer;
+            staging_buffer->buffer.init_buffer(usage, vkutil::vma_mapped_alloc);
+            vkutil::track_allocation(alloc_tracker::Subsystem::TextureStaging, staging_buffer->buffer.allocation);
+
+            if (use_gpu_decode) {
+                // the buffer is not in use, so its descriptor set can be updated right away
+                const vk::DescriptorBufferInfo buffer_info{
+                    .buffer = staging_buffer->buffer.buffer,
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE
+                };
+                std::array<vk::WriteDescriptorSet, 2> writes;
+                for (uint32_t binding = 0; binding < writes.size(); binding++) {
+                    writes[binding] = vk::WriteDescriptorSet{
+                        .dstSet = decode_descriptor_sets[staging_idx],
+                        .dstBinding = binding,
+                        .descriptorType = vk::DescriptorType::eStorageBufferDynamic
+                    };
+                    writes[binding].setBufferInfo(buffer_info);
+                }
+                state.device.updateDescriptorSets(writes, {});
+            }
         }
     }
 
@@ -237,14 +316,40 @@ void VKTextureCache::prepare_staging_buffer(bool is_configure) {
     };
 
     // if this is done during configure, layout is undefined, otherwise it is shader read only
-    if (is_configure)
+    if (is_configure && state.use_transfer_queue)
+        // the queue used depends on the first command recorded
+        is_initial_transition_pending = true;
+    else if (is_configure)
         vkutil::transition_image_layout(cmd_buffer, current_texture->texture.image, vkutil::ImageLayout::Undefined, vkutil::ImageLayout::TransferDst, range);
+    else if (partial_upload)
+        // the rows which are not uploaded must be kept
+        vkutil::transition_image_layout(cmd_buffer, current_texture->texture.image, vkutil::ImageLayout::SampledImage, vkutil::ImageLayout::TransferDst, range);
     else
         vkutil::transition_image_layout_discard(cmd_buffer, current_texture->texture.image, vkutil::ImageLayout::SampledImage, vkutil::ImageLayout::TransferDst, range);
 
     is_texture_transfer_ready = true;
 }
 
+void VKTextureCache::select_upload_queue(bool copy_only) {
+    if (!is_initial_transition_pending)
+        return;
+    is_initial_transition_pending = false;
+
+    // the dedicated transfer queue can only copy, decoding on the GPU, clearing or blitting the mips is done on the general queue
+    is_on_transfer_queue = copy_only && !generate_mips;
+    if (is_on_transfer_queue)
+        cmd_buffer = state.get_transfer_cmd();
+
+    const vk::ImageSubresourceRange range{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = current_texture->mip_count,
+        .baseArrayLayer = 0,
+        .layerCount = current_texture->is_cube ? 6U : 1U
+    };
+    vkutil::transition_image_layout(cmd_buffer, current_texture->texture.image, vkutil::ImageLayout::Undefined, vkutil::ImageLayout::TransferDst, range);
+}
+
 bool VKTextureCache::init(const bool hashless_texture_cache, const fs::path &texture_folder, const std::string_view game_id) {
     // set a limit to the number of samplers which can be allocated at the same time
     const size_t max_sampler_used = std::min(state.physical_device_properties.limits.maxSamplerAllocationCount / 2, 512U);
@@ -257,6 +362,108 @@ bool VKTextureCache::init(const bool hashless_texture_cache, const fs::path &tex
     return true;
 }
 
+bool VKTextureCache::init_gpu_decode() {
+    const fs::path builtin_shaders_path = state.static_assets / "shaders-builtin/vulkan";
+    detile_shader = vkutil::load_shader(state.device, (builtin_shaders_path / "texture_detile.comp.spv").string());
+    pvrtc_shader = vkutil::load_shader(state.device, (builtin_shaders_path / "texture_pvrtc.comp.spv").string());
+    yuv420_shader = vkutil::load_shader(state.device, (builtin_shaders_path / "texture_yuv420.comp.spv").string());
+    palette_shader = vkutil::load_shader(state.device, (builtin_shaders_path / "texture_palette.comp.spv").string());
+    if (!detile_shader || !pvrtc_shader || !yuv420_shader || !palette_shader) {
+        LOG_WARN("Could not load the texture decoding shaders, textures will be decoded on the CPU");
+        return false;
+    }
+
+    std::array<vk::DescriptorSetLayoutBinding, 2> layout_bindings = {
+        // guest data
+        vk::DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eStorageBufferDynamic,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute },
+        // linear data
+        vk::DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eStorageBufferDynamic,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute },
+    };
+    vk::DescriptorSetLayoutCreateInfo layout_create_info{};
+    layout_create_info.setBindings(layout_bindings);
+    decode_descriptor_set_layout = state.device.createDescriptorSetLayout(layout_create_info);
+
+    const vk::DescriptorPoolSize pool_size{
+        .type = vk::DescriptorType::eStorageBufferDynamic,
+        .descriptorCount = NB_TEXTURE_STAGING_BUFFERS * 2
+    };
+    vk::DescriptorPoolCreateInfo pool_info{
+        .maxSets = NB_TEXTURE_STAGING_BUFFERS
+    };
+    pool_info.setPoolSizes(pool_size);
+    decode_descriptor_pool = state.device.createDescriptorPool(pool_info);
+
+    std::array<vk::DescriptorSetLayout, NB_TEXTURE_STAGING_BUFFERS> set_layouts;
+    set_layouts.fill(decode_descriptor_set_layout);
+    vk::DescriptorSetAllocateInfo descr_set_info{
+        .descriptorPool = decode_descriptor_pool
+    };
+    descr_set_info.setSetLayouts(set_layouts);
+    const std::vector<vk::DescriptorSet> sets = state.device.allocateDescriptorSets(descr_set_info);
+    std::copy(sets.begin(), sets.end(), decode_descriptor_sets.begin());
+
+    const vk::PushConstantRange push_constant{
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = static_cast<uint32_t>(std::max({ sizeof(DetileParams), sizeof(PVRTCParams), sizeof(YUV420Params), sizeof(PaletteParams) }))
+    };
+    vk::PipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.setSetLayouts(decode_descriptor_set_layout);
+    pipeline_layout_info.setPushConstantRanges(push_constant);
+    decode_pipeline_layout = state.device.createPipelineLayout(pipeline_layout_info);
+
+    vk::ComputePipelineCreateInfo compute_info{
+        .stage = {
+            .stage = vk::ShaderStageFlagBits::eCompute,
+            .module = detile_shader,
+            .pName = "main" },
+        .layout = decode_pipeline_layout
+    };
+    auto result = state.device.createComputePipeline(nullptr, compute_info);
+    if (result.result != vk::Result::eSuccess) {
+        LOG_ERROR("Failed to create compute pipeline");
+        return false;
+    }
+    detile_pipeline = result.value;
+
+    compute_info.stage.module = pvrtc_shader;
+    result = state.device.createComputePipeline(nullptr, compute_info);
+    if (result.result != vk::Result::eSuccess) {
+        LOG_ERROR("Failed to create compute pipeline");
+        return false;
+    }
+    pvrtc_pipeline = result.value;
+
+    compute_info.stage.module = yuv420_shader;
+    result = state.device.createComputePipeline(nullptr, compute_info);
+    if (result.result != vk::Result::eSuccess) {
+        LOG_ERROR("Failed to create compute pipeline");
+        return false;
+    }
+    yuv420_pipeline = result.value;
+
+    compute_info.stage.module = palette_shader;
+    result = state.device.createComputePipeline(nullptr, compute_info);
+    if (result.result != vk::Result::eSuccess) {
+        LOG_ERROR("Failed to create compute pipeline");
+        return false;
+    }
+    palette_pipeline = result.value;
+
+    decode_alignment = std::max<uint32_t>(decode_alignment, static_cast<uint32_t>(state.physical_device_properties.limits.minStorageBufferOffsetAlignment));
+
+    LOG_INFO("Using compute shaders to linearize and decompress textures");
+    return true;
+}
+
 void VKTextureCache::select(size_t index, const SceGxmTexture &texture) {
     current_texture = &textures[index];
     is_texture_transfer_ready = false;
@@ -329,6 +536,13 @@ void VKTextureCache::configure_texture(const SceGxmTexture &gxm_texture) {
         memory_needed += memory_needed / 2;
     if (is_cube)
         memory_needed *= 6;
+    if (uses_gpu_decode(gxm_texture)) {
+        // both the guest data and the decoded one are in the staging buffer, every mip at an aligned offset
+        memory_needed = memory_needed * 2 + 2 * decode_alignment * mip_count * (is_cube ? 6U : 1U);
+        // the palette is copied after the indices of each mip
+        if (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P4 || base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8)
+            memory_needed += 256 * sizeof(uint32_t) * mip_count * (is_cube ? 6U : 1U);
+    }
     current_texture->memory_needed = align(memory_needed, 16);
     vkutil::Image &image = current_texture->texture;
 
@@ -355,12 +569,15 @@ void VKTextureCache::configure_texture(const SceGxmTexture &gxm_texture) {
         .arrayLayers = is_cube ? 6U : 1U,
         .samples = vk::SampleCountFlagBits::e1,
         .tiling = vk::ImageTiling::eOptimal,
-        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+        // transfer source to be copied when defragmenting
+        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc,
         .sharingMode = vk::SharingMode::eExclusive,
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    std::tie(image.image, image.allocation) = state.allocator.createImage(image_info, vkutil::vma_auto_alloc);
+    std::tie(image.image, image.allocation) = vkutil::create_image(state.allocator, image_info, state.get_texture_alloc_info(image_info));
+    // used to find the texture of the allocation when defragmenting
+    state.allocator.setAllocationUserData(image.allocation, current_texture);
 
     // create image view
     vk::ImageSubresourceRange range{
@@ -379,6 +596,7 @@ void VKTextureCache::configure_texture(const SceGxmTexture &gxm_texture) {
         .subresourceRange = range
     };
     image.view = state.device.createImageView(view_info);
+    current_texture->swizzle = swizzle;
 
     if (!gxm_texture.normalize_mode)
         LOG_ERROR("Unhandled unnormalized texture, please report it to the developers");
@@ -386,6 +604,126 @@ void VKTextureCache::configure_texture(const SceGxmTexture &gxm_texture) {
     prepare_staging_buffer(true);
 }
 
+void VKTextureCache::release_texture(size_t index) {
+    // the image may still be used by a frame being rendered
+    state.frame().destroy_queue.add_image(textures[index].texture);
+}
+
+void VKTextureCache::defragment(vma::Pool pool) {
+    const vma::DefragmentationInfo defrag_info{
+        .flags = vma::DefragmentationFlagBits::eAlgorithmFast,
+        .pool = pool,
+        // the copies of a pass are waited for at once, keep them short
+        .maxBytesPerPass = MiB(64),
+    };
+    vma::DefragmentationContext defrag_context = state.allocator.beginDefragmentation(defrag_info);
+
+    std::vector<std::pair<TextureCacheEntry *, vk::Image>> moved_textures;
+    std::vector<vk::ImageCopy> regions;
+    uint64_t moved_bytes = 0;
+    while (true) {
+        vma::DefragmentationPassMoveInfo pass_info;
+        if (state.allocator.beginDefragmentationPass(defrag_context, &pass_info) == vk::Result::eSuccess)
+            break;
+
+        vk::CommandBuffer cmd = vkutil::create_single_time_command(state.device, state.general_command_pool);
+        for (uint32_t i = 0; i < pass_info.moveCount; i++) {
+            vma::DefragmentationMove &move = pass_info.pMoves[i];
+            auto entry = static_cast<TextureCacheEntry *>(state.allocator.getAllocationInfo(move.srcAllocation).pUserData);
+            // the allocation can also belong to an image in a destroy queue or to a texture waiting for its content
+            if (!entry || entry->texture.allocation != move.srcAllocation || entry->texture.layout != vkutil::ImageLayout::SampledImage) {
+                move.operation = vma::DefragmentationMoveOperation::eIgnore;
+                continue;
+            }
+
+            const vkutil::Image &image = entry->texture;
+            const uint32_t layer_count = entry->is_cube ? 6U : 1U;
+            const vk::ImageCreateInfo image_info{
+                .flags = entry->is_cube ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlags(),
+                .imageType = vk::ImageType::e2D,
+                .format = image.format,
+                .extent = vk::Extent3D{
+                    .width = image.width,
+                    .height = image.height,
+                    .depth = 1 },
+                .mipLevels = entry->mip_count,
+                .arrayLayers = layer_count,
+                .samples = vk::SampleCountFlagBits::e1,
+                .tiling = vk::ImageTiling::eOptimal,
+                .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .initialLayout = vk::ImageLayout::eUndefined,
+            };
+            const vk::Image new_image = state.device.createImage(image_info);
+            state.allocator.bindImageMemory(move.dstTmpAllocation, new_image);
+
+            const vk::ImageSubresourceRange range{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = entry->mip_count,
+                .baseArrayLayer = 0,
+                .layerCount = layer_count
+            };
+            vkutil::transition_image_layout(cmd, image.image, vkutil::ImageLayout::SampledImage, vkutil::ImageLayout::TransferSrc, range);
+            vkutil::transition_image_layout_discard(cmd, new_image, vkutil::ImageLayout::Undefined, vkutil::ImageLayout::TransferDst, range);
+
+            regions.clear();
+            for (uint32_t mip = 0; mip < entry->mip_count; mip++) {
+                const vk::ImageSubresourceLayers layers{
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .mipLevel = mip,
+                    .baseArrayLayer = 0,
+                    .layerCount = layer_count
+                };
+                regions.push_back(vk::ImageCopy{
+                    .srcSubresource = layers,
+                    .dstSubresource = layers,
+                    .extent = vk::Extent3D{
+                        .width = std::max(image.width >> mip, 1U),
+                        .height = std::max(image.height >> mip, 1U),
+                        .depth = 1 } });
+            }
+            cmd.copyImage(image.image, vk::ImageLayout::eTransferSrcOptimal, new_image, vk::ImageLayout::eTransferDstOptimal, regions);
+            vkutil::transition_image_layout(cmd, new_image, vkutil::ImageLayout::TransferDst, vkutil::ImageLayout::SampledImage, range);
+
+            moved_textures.emplace_back(entry, new_image);
+            moved_bytes += state.allocator.getAllocationInfo(move.srcAllocation).size;
+        }
+        // waits for the copies
+        vkutil::end_single_time_command(state.device, state.general_queue, state.general_command_pool, cmd);
+
+        // the old images must be destroyed before their memory is given back
+        for (auto &[entry, new_image] : moved_textures) {
+            vkutil::Image &image = entry->texture;
+            state.device.destroyImageView(image.view);
+            state.device.destroyImage(image.image);
+            image.image = new_image;
+
+            const vk::ImageViewCreateInfo view_info{
+                .image = image.image,
+                .viewType = entry->is_cube ? vk::ImageViewType::eCube : vk::ImageViewType::e2D,
+                .format = image.format,
+                .components = entry->swizzle,
+                .subresourceRange = vk::ImageSubresourceRange{
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .baseMipLevel = 0,
+                    .levelCount = entry->mip_count,
+                    .baseArrayLayer = 0,
+                    .layerCount = entry->is_cube ? 6U : 1U }
+            };
+            image.view = state.device.createImageView(view_info);
+        }
+        moved_textures.clear();
+
+        if (state.allocator.endDefragmentationPass(defrag_context, &pass_info) == vk::Result::eSuccess)
+            break;
+    }
+
+    state.allocator.endDefragmentation(defrag_context, nullptr);
+    if (moved_bytes > 0)
+        LOG_INFO("Texture memory defragmented, {} KiB moved", moved_bytes / KiB(1));
+}
+
 // add an alpha channel to u8u8u8 textures
 static void *add_alpha_channel(const void *pixels, const uint32_t width, const uint32_t height, std::vector<uint8_t> &data) {
     data.resize(width * height * 4);
@@ -409,9 +747,10 @@ static void *add_alpha_channel(const void *pixels, const uint32_t width, const u
 }
 
 void VKTextureCache::upload_texture_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height,
-    uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride) {
+    uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t row_offset) {
     if (!is_texture_transfer_ready)
         prepare_staging_buffer();
+    select_upload_queue(true);
 
     vkutil::Image &image = current_texture->texture;
     TextureStagingBuffer &staging_buffer = staging_buffers[staging_idx];
@@ -459,13 +798,314 @@ void VKTextureCache::upload_texture_impl(SceGxmTextureBaseFormat base_format, ui
         .bufferRowLength = static_cast<uint32_t>(pixels_per_stride),
         .bufferImageHeight = buffer_height,
         .imageSubresource = layer,
-        .imageOffset = { 0, 0, 0 },
+        .imageOffset = { 0, static_cast<int32_t>(row_offset), 0 },
         .imageExtent = { width, height, 1 }
     };
     cmd_buffer.copyBufferToImage(staging_buffer.buffer.buffer, image.image, vk::ImageLayout::eTransferDstOptimal, region);
     staging_buffer.used_so_far += upload_size;
 }
 
+bool VKTextureCache::supports_gpu_decode(const SceGxmTexture &texture) const {
+    const SceGxmTextureType texture_type = texture.texture_type();
+    const bool is_linear = (texture_type == SCE_GXM_TEXTURE_LINEAR || texture_type == SCE_GXM_TEXTURE_LINEAR_STRIDED);
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(texture));
+
+    // video frames are converted to rgba by a compute shader instead of swscale
+    if (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P2 || base_format == SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3)
+        return is_linear && texture.true_mip_count() == 1;
+
+    // paletted textures are expanded and linearized by the same compute shader, whatever their layout
+    if (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P4 || base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8)
+        return true;
+
+    if (is_linear)
+        return false;
+
+    const bool is_tiled = (texture_type == SCE_GXM_TEXTURE_TILED);
+    switch (base_format) {
+    case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC1:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC2:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC3:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC4:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_SBC4:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC5:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_SBC5:
+        return !is_tiled;
+
+    // PVRTC-II and the formats converted before being linearized stay on the CPU
+    case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_U8U3U3U2:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_U2F10F10F10:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_X8U24:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_F32M:
+    case SCE_GXM_TEXTURE_BASE_FORMAT_YUV422:
+        return false;
+
+    default: {
+        if (gxm::is_block_compressed_format(base_format))
+            return false;
+
+        // u8u8u8 textures get an alpha channel in upload_texture_impl
+        const uint32_t bpp = gxm::bits_per_pixel(base_format);
+        return bpp == 8 || bpp == 16 || bpp == 32 || bpp == 64;
+    }
+    }
+}
+
+void VKTextureCache::upload_guest_layout_impl(SceGxmTextureBaseFormat base_format, uint32_t width, uint32_t height,
+    uint32_t mip_index, const void *pixels, int face, uint32_t pixels_per_stride, uint32_t memory_height) {
+    if (!is_texture_transfer_ready)
+        prepare_staging_buffer();
+    select_upload_queue(false);
+
+    vkutil::Image &image = current_texture->texture;
+    TextureStagingBuffer &staging_buffer = staging_buffers[staging_idx];
+
+    if (face > 0)
+        face--;
+
+    const bool is_pvrt = gxm::is_pvrt_format(base_format);
+    const bool is_bcn = gxm::is_bcn_format(base_format);
+    const bool is_2bpp = (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP);
+    const bool is_yuv = (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P2 || base_format == SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3);
+    const bool is_p3 = (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3);
+    const bool is_palette = (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P4 || base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8);
+    const bool is_p4 = (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P4);
+
+    uint32_t guest_size;
+    uint32_t decoded_size;
+    // only used by yuv textures, the chroma planes are after the luma plane of the whole layout
+    uint32_t chroma_offset = 0;
+    // only used by paletted textures, the palette is copied right after the indices
+    uint32_t palette_offset = 0;
+    const uint32_t palette_size = (is_p4 ? 16 : 256) * sizeof(uint32_t);
+    if (is_palette) {
+        if (!current_palette)
+            return;
+        const uint32_t indices_size = is_p4 ? (pixels_per_stride * memory_height + 1) / 2 : pixels_per_stride * memory_height;
+        palette_offset = align(indices_size, 4);
+        guest_size = palette_offset + palette_size;
+        decoded_size = pixels_per_stride * memory_height * 4;
+    } else if (is_yuv) {
+        const SceGxmTexture &texture = current_info->texture;
+        if (texture.mip_count == 0xF && texture.texture_type() == SCE_GXM_TEXTURE_LINEAR)
+            chroma_offset = width * height;
+        else
+            chroma_offset = next_power_of_two(width) * next_power_of_two(height);
+
+        if (is_p3)
+            guest_size = chroma_offset + chroma_offset / 4 + (pixels_per_stride / 2) * (memory_height / 2);
+        else
+            guest_size = chroma_offset + pixels_per_stride * (memory_height / 2);
+        decoded_size = pixels_per_stride * memory_height * 4;
+    } else if (is_pvrt) {
+        // textures smaller than 2x2 words are stored as if they had this size
+        const uint32_t word_width = is_2bpp ? 8 : 4;
+        const uint32_t nb_words = (std::max(pixels_per_stride, word_width * 2) / word_width) * (std::max(memory_height, 8U) / 4);
+        guest_size = nb_words * 8;
+        decoded_size = pixels_per_stride * memory_height * 4;
+    } else if (is_bcn) {
+        guest_size = renderer::texture::get_compressed_size(base_format, pixels_per_stride, memory_height);
+        decoded_size = guest_size;
+    } else {
+        guest_size = pixels_per_stride * memory_height * (gxm::bits_per_pixel(base_format) >> 3);
+        decoded_size = guest_size;
+    }
+
+    const uint32_t guest_offset = align(staging_buffer.used_so_far, decode_alignment);
+    const uint32_t decoded_offset = align(guest_offset + guest_size, decode_alignment);
+    if (decoded_offset + decoded_size > staging_buffer.buffer.size) {
+        LOG_ERROR("Staging buffer size left ({}) is too small for texture size {}!", staging_buffer.buffer.size - staging_buffer.used_so_far, decoded_offset + decoded_size - staging_buffer.used_so_far);
+        return;
+    }
+
+    uint8_t *const guest_data = reinterpret_cast<uint8_t *>(staging_buffer.buffer.mapped_data) + guest_offset;
+    if (is_palette) {
+        memcpy(guest_data, pixels, palette_offset);
+        memcpy(guest_data + palette_offset, current_palette, palette_size);
+    } else {
+        memcpy(guest_data, pixels, guest_size);
+    }
+
+    const std::array<uint32_t, 2> dynamic_offsets = { guest_offset, decoded_offset };
+    cmd_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, decode_pipeline_layout, 0, decode_descriptor_sets[staging_idx], dynamic_offsets);
+
+    if (is_palette) {
+        const SceGxmTextureType texture_type = current_info->texture.texture_type();
+        uint32_t layout_type = 1;
+        if (texture_type == SCE_GXM_TEXTURE_LINEAR || texture_type == SCE_GXM_TEXTURE_LINEAR_STRIDED)
+            layout_type = 0;
+        else if (texture_type == SCE_GXM_TEXTURE_TILED)
+            layout_type = 2;
+        const PaletteParams params{
+            .width = pixels_per_stride,
+            .height = memory_height,
+            .palette_offset = palette_offset,
+            .is_p4 = is_p4,
+            .layout_type = layout_type
+        };
+        cmd_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, palette_pipeline);
+        cmd_buffer.pushConstants(decode_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(params), &params);
+        cmd_buffer.dispatch((pixels_per_stride + 7) / 8, (memory_height + 7) / 8, 1);
+    } else if (is_yuv) {
+        const YUV420Params params{
+            .width = pixels_per_stride,
+            .height = memory_height,
+            .chroma_offset = chroma_offset,
+            .is_p3 = is_p3
+        };
+        cmd_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, yuv420_pipeline);
+        cmd_buffer.pushConstants(decode_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(params), &params);
+        cmd_buffer.dispatch((pixels_per_stride + 7) / 8, (memory_height + 7) / 8, 1);
+    } else if (is_pvrt) {
+        const PVRTCParams params{
+            .width = pixels_per_stride,
+            .height = memory_height,
+            .is_2bpp = is_2bpp
+        };
+        cmd_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, pvrtc_pipeline);
+        cmd_buffer.pushConstants(decode_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(params), &params);
+        cmd_buffer.dispatch((pixels_per_stride + 7) / 8, (memory_height + 7) / 8, 1);
+    } else {
+        // compressed textures are swizzled block by block
+        const uint32_t block_dim = is_bcn ? 4 : 1;
+        const uint32_t element_size = is_bcn ? renderer::texture::get_compressed_size(base_format, 4, 4) : (gxm::bits_per_pixel(base_format) >> 3);
+        const DetileParams params{
+            .width = pixels_per_stride / block_dim,
+            .height = memory_height / block_dim,
+            .element_size = element_size,
+            .is_tiled = current_info->texture.texture_type() == SCE_GXM_TEXTURE_TILED,
+            .total_words = (decoded_size + 3) / 4
+        };
+        const uint32_t nb_groups = (params.total_words + 63) / 64;
+        const uint32_t groups_x = std::min(nb_groups, MAX_DETILE_GROUPS_X);
+        cmd_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, detile_pipeline);
+        cmd_buffer.pushConstants(decode_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(params), &params);
+        cmd_buffer.dispatch(groups_x, (nb_groups + groups_x - 1) / groups_x, 1);
+    }
+
+    // the copy must wait for the compute shader
+    vk::BufferMemoryBarrier barrier{
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = staging_buffer.buffer.buffer,
+        .offset = decoded_offset,
+        .size = decoded_size
+    };
+    cmd_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(), {}, barrier, {});
+
+    vk::ImageSubresourceLayers layer{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .mipLevel = mip_index,
+        .baseArrayLayer = static_cast<uint32_t>(face),
+        .layerCount = 1
+    };
+    vk::BufferImageCopy region{
+        .bufferOffset = decoded_offset,
+        .bufferRowLength = pixels_per_stride,
+        .bufferImageHeight = memory_height,
+        .imageSubresource = layer,
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { width, height, 1 }
+    };
+    cmd_buffer.copyBufferToImage(staging_buffer.buffer.buffer, image.image, vk::ImageLayout::eTransferDstOptimal, region);
+    staging_buffer.used_so_far = decoded_offset + decoded_size;
+}
+
+void VKTextureCache::upload_placeholder(const SceGxmTexture &texture) {
+    // compressed images can not be cleared, they stay undefined until the decode is done
+    if (gxm::is_block_compressed_format(gxm::get_base_format(gxm::get_format(texture))))
+        return;
+
+    if (!is_texture_transfer_ready)
+        prepare_staging_buffer();
+    select_upload_queue(false);
+
+    vk::ImageSubresourceRange range{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = current_texture->mip_count,
+        .baseArrayLayer = 0,
+        .layerCount = current_texture->is_cube ? 6U : 1U
+    };
+    const vk::ClearColorValue transparent_black{ std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f } };
+    cmd_buffer.clearColorImage(current_texture->texture.image, vk::ImageLayout::eTransferDstOptimal, transparent_black, range);
+}
+
+bool VKTextureCache::supports_mipmap_generation(const SceGxmTexture &texture) const {
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(gxm::get_format(texture));
+    if (gxm::is_bcn_format(base_format))
+        return false;
+
+    // the mips are blitted one after the other from the base level
+    constexpr vk::FormatFeatureFlags blit_features = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    const vk::FormatProperties properties = state.physical_device.getFormatProperties(texture::translate_format(base_format));
+    return (properties.optimalTilingFeatures & blit_features) == blit_features;
+}
+
+// each mip is a linear blit of the previous one, which gives a box filter when halving the size
+static void blit_mip_chain(vk::CommandBuffer cmd_buffer, const TextureCacheEntry &texture) {
+    const vkutil::Image &image = texture.texture;
+    const uint32_t layer_count = texture.is_cube ? 6U : 1U;
+    int32_t mip_width = image.width;
+    int32_t mip_height = image.height;
+    for (uint32_t mip = 1; mip < texture.mip_count; mip++) {
+        const vk::ImageSubresourceRange src_range{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = mip - 1,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = layer_count
+        };
+        vkutil::transition_image_layout(cmd_buffer, image.image, vkutil::ImageLayout::TransferDst, vkutil::ImageLayout::TransferSrc, src_range);
+
+        const int32_t next_width = std::max(mip_width / 2, 1);
+        const int32_t next_height = std::max(mip_height / 2, 1);
+        vk::ImageBlit blit{
+            .srcSubresource = vk::ImageSubresourceLayers{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = mip - 1,
+                .baseArrayLayer = 0,
+                .layerCount = layer_count },
+            .dstSubresource = vk::ImageSubresourceLayers{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = mip,
+                .baseArrayLayer = 0,
+                .layerCount = layer_count },
+        };
+        blit.srcOffsets[1] = vk::Offset3D{ mip_width, mip_height, 1 };
+        blit.dstOffsets[1] = vk::Offset3D{ next_width, next_height, 1 };
+        cmd_buffer.blitImage(image.image, vk::ImageLayout::eTransferSrcOptimal, image.image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+        mip_width = next_width;
+        mip_height = next_height;
+    }
+
+    // all the mips but the last one were read from
+    const vk::ImageSubresourceRange read_range{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = texture.mip_count - 1U,
+        .baseArrayLayer = 0,
+        .layerCount = layer_count
+    };
+    vkutil::transition_image_layout(cmd_buffer, image.image, vkutil::ImageLayout::TransferSrc, vkutil::ImageLayout::SampledImage, read_range);
+    const vk::ImageSubresourceRange last_range{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = texture.mip_count - 1U,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = layer_count
+    };
+    vkutil::transition_image_layout(cmd_buffer, image.image, vkutil::ImageLayout::TransferDst, vkutil::ImageLayout::SampledImage, last_range);
+}
+
 void VKTextureCache::upload_done() {
     // transition the texture back to read only
     vk::ImageSubresourceRange range{
@@ -475,7 +1115,32 @@ void VKTextureCache::upload_done() {
         .baseArrayLayer = 0,
         .layerCount = current_texture->is_cube ? 6U : 1U
     };
-    vkutil::transition_image_layout(cmd_buffer, current_texture->texture.image, vkutil::ImageLayout::TransferDst, vkutil::ImageLayout::SampledImage, range);
+    select_upload_queue(false);
+    if (is_on_transfer_queue) {
+        // release the texture on the transfer queue, then acquire it on the general queue before it is sampled
+        vk::ImageMemoryBarrier barrier{
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .srcQueueFamilyIndex = state.transfer_family_index,
+            .dstQueueFamilyIndex = state.general_family_index,
+            .image = current_texture->texture.image,
+            .subresourceRange = range
+        };
+        cmd_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), {}, {}, barrier);
+
+        // the general submission waits for the transfer queue at the transfer stage
+        barrier.srcAccessMask = vk::AccessFlags();
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        VKContext *context = reinterpret_cast<VKContext *>(state.context);
+        context->prerender_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader,
+            vk::DependencyFlags(), {}, {}, barrier);
+        is_on_transfer_queue = false;
+    } else if (generate_mips && current_texture->mip_count > 1)
+        blit_mip_chain(cmd_buffer, *current_texture);
+    else
+        vkutil::transition_image_layout(cmd_buffer, current_texture->texture.image, vkutil::ImageLayout::TransferDst, vkutil::ImageLayout::SampledImage, range);
+    generate_mips = false;
     current_texture->texture.layout = vkutil::ImageLayout::SampledImage;
     // this should not be necessary
     cmd_buffer = nullptr;
@@ -562,12 +1227,15 @@ void VKTextureCache::import_configure_impl(SceGxmTextureBaseFormat base_format,
         .arrayLayers = is_cube ? 6U : 1U,
         .samples = vk::SampleCountFlagBits::e1,
         .tiling = vk::ImageTiling::eOptimal,
-        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+        // transfer source to be copied when defragmenting
+        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc,
         .sharingMode = vk::SharingMode::eExclusive,
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    std::tie(image.image, image.allocation) = state.allocator.createImage(image_info, vkutil::vma_auto_alloc);
+    std::tie(image.image, image.allocation) = vkutil::create_image(state.allocator, image_info, state.get_texture_alloc_info(image_info));
+    // used to find the texture of the allocation when defragmenting
+    state.allocator.setAllocationUserData(image.allocation, current_texture);
 
     // create image view
     vk::ImageSubresourceRange range{
@@ -608,6 +1276,7 @@ void VKTextureCache::import_configure_impl(SceGxmTextureBaseFormat base_format,
         .subresourceRange = range
     };
     image.view = state.device.createImageView(view_info);
+    current_texture->swizzle = swizzle;
 
     prepare_staging_buffer(true);
 }
@@ -0,0 +1,103 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+#include <renderer/surface_cache.h>
+
+#include <gtest/gtest.h>
+
+using namespace renderer;
+
+// what the memory trap of the surface does
+static void guest_access(SurfaceGuestAccess &access, bool write) {
+    access.accessed = true;
+    if (write)
+        access.written = true;
+    access.armed = false;
+}
+
+TEST(surface_sync_tracker, untouched_surface_is_not_read_back) {
+    SurfaceSyncTracker tracker;
+    tracker.track(0x81000000, 0x10000, true);
+
+    tracker.record_gpu_write(0x81000000);
+    EXPECT_EQ(tracker.before_gpu_use(0x81000000), SurfaceSyncAction::Reuse);
+    EXPECT_EQ(tracker.after_gpu_write(0x81000000), SurfaceSyncAction::Reuse);
+}
+
+TEST(surface_sync_tracker, guest_read_is_read_back_once) {
+    SurfaceSyncTracker tracker;
+    const auto access = tracker.track(0x81000000, 0x10000, true);
+
+    tracker.record_gpu_write(0x81000000);
+    guest_access(*access, false);
+    tracker.record_gpu_write(0x81000000);
+    EXPECT_EQ(tracker.after_gpu_write(0x81000000), SurfaceSyncAction::Readback);
+    EXPECT_TRUE(tracker.mark_synced(0x81000000));
+    EXPECT_TRUE(access->armed);
+
+    // the guest did not look at the surface again
+    tracker.record_gpu_write(0x81000000);
+    EXPECT_EQ(tracker.after_gpu_write(0x81000000), SurfaceSyncAction::Reuse);
+}
+
+TEST(surface_sync_tracker, guest_write_is_uploaded) {
+    SurfaceSyncTracker tracker;
+    const auto access = tracker.track(0x81000000, 0x10000, true);
+
+    tracker.record_gpu_write(0x81000000);
+    guest_access(*access, true);
+    EXPECT_EQ(tracker.before_gpu_use(0x81000000), SurfaceSyncAction::Upload);
+    EXPECT_TRUE(tracker.mark_synced(0x81000000));
+    EXPECT_EQ(tracker.before_gpu_use(0x81000000), SurfaceSyncAction::Reuse);
+
+    // the guest already has the content the scene started from
+    tracker.record_gpu_write(0x81000000);
+    EXPECT_EQ(tracker.after_gpu_write(0x81000000), SurfaceSyncAction::Reuse);
+}
+
+TEST(surface_sync_tracker, armed_trap_is_not_armed_again) {
+    SurfaceSyncTracker tracker;
+    const auto access = tracker.track(0x81000000, 0x10000, true);
+
+    tracker.record_gpu_write(0x81000000);
+    EXPECT_FALSE(tracker.mark_synced(0x81000000));
+}
+
+TEST(surface_sync_tracker, surface_without_trap_is_always_read_back) {
+    SurfaceSyncTracker tracker;
+    tracker.track(0x81000000, 0x10000, false);
+
+    for (int i = 0; i < 2; i++) {
+        tracker.record_gpu_write(0x81000000);
+        EXPECT_EQ(tracker.after_gpu_write(0x81000000), SurfaceSyncAction::Readback);
+        EXPECT_FALSE(tracker.mark_synced(0x81000000));
+    }
+    // nothing was rendered since the last readback
+    EXPECT_EQ(tracker.after_gpu_write(0x81000000), SurfaceSyncAction::Reuse);
+}
+
+TEST(surface_sync_tracker, untrack_keeps_newer_surface) {
+    SurfaceSyncTracker tracker;
+    const auto old_access = tracker.track(0x81000000, 0x10000, true);
+    const auto new_access = tracker.track(0x81000000, 0x20000, true);
+
+    tracker.untrack(0x81000000, old_access.get());
+    ASSERT_NE(tracker.find(0x81000000), nullptr);
+    tracker.untrack(0x81000000, new_access.get());
+    EXPECT_EQ(tracker.find(0x81000000), nullptr);
+}
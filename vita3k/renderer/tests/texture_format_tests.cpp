@@ -0,0 +1,154 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/functions.h>
+
+#include <gxm/types.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace renderer::texture;
+
+// straightforward per-pixel versions, the optimized kernels must give the exact same result
+static void reference_swizzled_to_linear(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint32_t bytes_per_pixel) {
+    const uint32_t min = std::min(width, height);
+    const uint32_t k = std::bit_width(min) - 1;
+    for (uint32_t i = 0; i < width * static_cast<uint32_t>(height); i++) {
+        uint32_t x = decode_morton2_x(i) & (min - 1);
+        uint32_t y = decode_morton2_y(i) & (min - 1);
+        const uint32_t upper_bits = (i >> (2 * k)) << k;
+        if (width >= height)
+            x |= upper_bits;
+        else
+            y |= upper_bits;
+
+        memcpy(dest + (y * width + x) * bytes_per_pixel, src + i * bytes_per_pixel, bytes_per_pixel);
+    }
+}
+
+static void reference_tiled_to_linear(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint32_t bytes_per_pixel) {
+    const uint32_t width_in_tiles = (width + 31) >> 5;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const uint32_t texel_offset_in_tile = (x & 0b11111) | ((y & 0b11111) << 5);
+            const uint32_t tile_address = (x >> 5) + width_in_tiles * (y >> 5);
+            memcpy(dest + (y * width + x) * bytes_per_pixel, src + ((tile_address << 10) | texel_offset_in_tile) * bytes_per_pixel, bytes_per_pixel);
+        }
+    }
+}
+
+static std::vector<uint8_t> random_bytes(size_t size, std::mt19937 &rng) {
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t &byte : bytes)
+        byte = static_cast<uint8_t>(rng());
+    return bytes;
+}
+
+static const std::vector<std::pair<uint16_t, uint16_t>> texture_sizes = {
+    { 1, 1 }, { 2, 2 }, { 4, 4 }, { 8, 8 }, { 16, 4 }, { 4, 16 }, { 64, 32 }, { 32, 128 }, { 256, 256 }
+};
+
+TEST(texture_format, swizzled_to_linear_matches_reference) {
+    std::mt19937 rng(42);
+    for (const uint32_t bits_per_pixel : { 8, 16, 24, 32, 64, 128 }) {
+        for (const auto &[width, height] : texture_sizes) {
+            const uint32_t bytes_per_pixel = bits_per_pixel / 8;
+            const std::vector<uint8_t> src = random_bytes(width * height * bytes_per_pixel, rng);
+            std::vector<uint8_t> result(src.size());
+            std::vector<uint8_t> expected(src.size());
+
+            swizzled_texture_to_linear_texture(result.data(), src.data(), width, height, bits_per_pixel);
+            reference_swizzled_to_linear(expected.data(), src.data(), width, height, bytes_per_pixel);
+            ASSERT_EQ(result, expected) << bits_per_pixel << " bpp, " << width << "x" << height;
+        }
+    }
+}
+
+TEST(texture_format, tiled_to_linear_matches_reference) {
+    std::mt19937 rng(42);
+    for (const uint32_t bits_per_pixel : { 8, 16, 32, 64 }) {
+        for (const auto &[width, height] : texture_sizes) {
+            const uint32_t bytes_per_pixel = bits_per_pixel / 8;
+            // tiled textures are stored with 32x32 tiles
+            const std::vector<uint8_t> src = random_bytes(((width + 31) & ~31) * ((height + 31) & ~31) * bytes_per_pixel, rng);
+            std::vector<uint8_t> result(width * height * bytes_per_pixel);
+            std::vector<uint8_t> expected(result.size());
+
+            tiled_texture_to_linear_texture(result.data(), src.data(), width, height, bits_per_pixel);
+            reference_tiled_to_linear(expected.data(), src.data(), width, height, bytes_per_pixel);
+            ASSERT_EQ(result, expected) << bits_per_pixel << " bpp, " << width << "x" << height;
+        }
+    }
+}
+
+TEST(texture_format, x8u24_to_f32_matches_reference) {
+    std::mt19937 rng(42);
+    for (const uint32_t width : { 1, 3, 7, 8, 9, 17, 1000 }) {
+        std::vector<uint32_t> src(width);
+        for (uint32_t &value : src)
+            value = rng();
+        src[0] = 0xFFFFFFFF;
+
+        for (const bool depth_in_low_bits : { false, true }) {
+            const SceGxmTextureFormat format = depth_in_low_bits ? SCE_GXM_TEXTURE_FORMAT_X8U24_SD : SCE_GXM_TEXTURE_FORMAT_U24X8_DS;
+            const uint32_t shift_amount = depth_in_low_bits ? 0 : 8;
+            std::vector<float> result(width);
+            convert_x8u24_to_f32(result.data(), src.data(), width, 1, format);
+
+            for (uint32_t i = 0; i < width; i++) {
+                const float expected = static_cast<float>((src[i] >> shift_amount) & ((1U << 24) - 1)) / ((1U << 24) - 1);
+                ASSERT_EQ(std::bit_cast<uint32_t>(result[i]), std::bit_cast<uint32_t>(expected)) << "pixel " << i;
+            }
+        }
+    }
+}
+
+static uint16_t reference_f10_to_f16(uint32_t f10) {
+    return static_cast<uint16_t>((((f10 >> 5) & 0b11111) << 10) | ((f10 & 0b11111) << 5));
+}
+
+TEST(texture_format, u2f10f10f10_to_f16f16f16f16_matches_reference) {
+    std::mt19937 rng(42);
+    for (const uint32_t width : { 1, 3, 4, 5, 8, 9, 17, 1000 }) {
+        std::vector<uint32_t> src(width);
+        for (uint32_t &value : src)
+            value = rng();
+
+        for (const bool alpha_upper : { false, true }) {
+            const SceGxmTextureFormat format = alpha_upper ? SCE_GXM_TEXTURE_FORMAT_U2F10F10F10_ABGR : SCE_GXM_TEXTURE_FORMAT_F10F10F10U2_BGRA;
+            std::vector<std::array<uint16_t, 4>> result(width);
+            convert_u2f10f10f10_to_f16f16f16f16(result.data(), src.data(), width, 1, format);
+
+            for (uint32_t i = 0; i < width; i++) {
+                const uint32_t alpha_bits = alpha_upper ? (src[i] >> 30) : (src[i] & 0b11);
+                const uint32_t rgb = alpha_upper ? src[i] : (src[i] >> 2);
+                const int first = alpha_upper ? 0 : 1;
+                // the alpha is the truncation of alpha_bits / 3
+                ASSERT_EQ(result[i][alpha_upper ? 3 : 0], alpha_bits == 3 ? 1 : 0) << "pixel " << i;
+                for (int c = 0; c < 3; c++)
+                    ASSERT_EQ(result[i][first + c], reference_f10_to_f16(rgb >> (10 * c))) << "pixel " << i;
+            }
+        }
+    }
+}
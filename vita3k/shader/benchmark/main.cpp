@@ -0,0 +1,195 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Translates every .gxp program of a folder (as dumped in the shaderlog folder) and reports JSON on stdout.
+// The SPIR-V and GLSL outputs can be saved as a baseline and compared with the outputs of a later build.
+// Usage: shader-benchmark <gxp folder> [--baseline <folder>] [--save <folder>]
+
+#include <features/state.h>
+#include <gxm/types.h>
+#include <shader/spirv_recompiler.h>
+#include <util/fs.h>
+#include <util/log.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct ShaderResult {
+    std::string name;
+    bool success = false;
+    double spirv_ms = 0;
+    double glsl_ms = 0;
+    size_t spirv_instructions = 0;
+    size_t glsl_size = 0;
+    // "new" if the shader is not in the baseline, "same" or "changed" otherwise
+    std::string baseline_status;
+    size_t baseline_spirv_instructions = 0;
+};
+
+static std::vector<uint8_t> read_file(const fs::path &path) {
+    fs::ifstream file(path, std::ios::binary);
+    if (!file)
+        return {};
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const fs::path &path, const void *data, size_t size) {
+    fs::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(data), size);
+}
+
+// each instruction has its word count in the upper 16 bits of its first word, after a 5 words header
+static size_t count_spirv_instructions(const std::vector<uint32_t> &spirv) {
+    size_t count = 0;
+    for (size_t i = 5; i < spirv.size(); count++) {
+        const uint32_t word_count = spirv[i] >> 16;
+        if (word_count == 0)
+            break;
+        i += word_count;
+    }
+    return count;
+}
+
+static ShaderResult run_shader(const fs::path &path, const fs::path &baseline, const fs::path &save) {
+    using clock = std::chrono::steady_clock;
+
+    ShaderResult result;
+    result.name = path.stem().string();
+
+    const std::vector<uint8_t> data = read_file(path);
+    const auto program = reinterpret_cast<const SceGxmProgram *>(data.data());
+    if (data.size() < sizeof(SceGxmProgram) || program->size > data.size()) {
+        LOG_ERROR("{} is not a valid gxp program", path.string());
+        return result;
+    }
+
+    FeatureState features;
+    features.support_shader_interlock = true;
+
+    // use the same default hints as convert_gxp_to_glsl_from_filepath
+    shader::Hints hints{
+        .attributes = nullptr,
+        .color_format = SCE_GXM_COLOR_FORMAT_U8U8U8U8_ABGR,
+    };
+    std::fill_n(hints.vertex_textures, SCE_GXM_MAX_TEXTURE_UNITS, SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR);
+    std::fill_n(hints.fragment_textures, SCE_GXM_MAX_TEXTURE_UNITS, SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR);
+
+    // usse to SPIR-V only
+    auto start = clock::now();
+    const shader::GeneratedShader spirv = shader::convert_gxp(*program, result.name, features, shader::Target::SpirVVulkan, hints);
+    result.spirv_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    // usse to SPIR-V then GLSL with SPIRV-Cross
+    start = clock::now();
+    const shader::GeneratedShader glsl = shader::convert_gxp(*program, result.name, features, shader::Target::GLSLOpenGL, hints);
+    result.glsl_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    result.success = !spirv.spirv.empty() && !glsl.glsl.empty();
+    result.spirv_instructions = count_spirv_instructions(spirv.spirv);
+    result.glsl_size = glsl.glsl.size();
+
+    if (!baseline.empty()) {
+        const std::vector<uint8_t> baseline_spirv = read_file(baseline / (result.name + ".spv"));
+        const std::vector<uint8_t> baseline_glsl = read_file(baseline / (result.name + ".glsl"));
+        if (baseline_spirv.empty() && baseline_glsl.empty()) {
+            result.baseline_status = "new";
+        } else {
+            std::vector<uint32_t> baseline_words(baseline_spirv.size() / sizeof(uint32_t));
+            memcpy(baseline_words.data(), baseline_spirv.data(), baseline_words.size() * sizeof(uint32_t));
+            result.baseline_spirv_instructions = count_spirv_instructions(baseline_words);
+
+            const bool same = baseline_words == spirv.spirv && std::equal(baseline_glsl.begin(), baseline_glsl.end(), glsl.glsl.begin(), glsl.glsl.end());
+            result.baseline_status = same ? "same" : "changed";
+        }
+    }
+
+    if (!save.empty()) {
+        write_file(save / (result.name + ".spv"), spirv.spirv.data(), spirv.spirv.size() * sizeof(uint32_t));
+        write_file(save / (result.name + ".glsl"), glsl.glsl.data(), glsl.glsl.size());
+    }
+
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: shader-benchmark <gxp folder> [--baseline <folder>] [--save <folder>]" << std::endl;
+        return 1;
+    }
+
+    const fs::path gxp_folder{ argv[1] };
+    fs::path baseline;
+    fs::path save;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        if (option == "--baseline")
+            baseline = argv[i + 1];
+        else if (option == "--save")
+            save = argv[i + 1];
+    }
+
+    if (!fs::is_directory(gxp_folder)) {
+        std::cerr << "Could not open " << gxp_folder.string() << std::endl;
+        return 1;
+    }
+    if (!save.empty())
+        fs::create_directories(save);
+
+    // sort the programs so two runs can be compared line by line
+    std::vector<fs::path> programs;
+    for (const auto &entry : fs::directory_iterator(gxp_folder)) {
+        if (entry.path().extension() == ".gxp")
+            programs.push_back(entry.path());
+    }
+    std::sort(programs.begin(), programs.end());
+
+    std::string entries;
+    double total_spirv_ms = 0;
+    double total_glsl_ms = 0;
+    size_t total_spirv_instructions = 0;
+    size_t baseline_spirv_instructions = 0;
+    uint32_t nb_failed = 0;
+    uint32_t nb_changed = 0;
+    for (const fs::path &program : programs) {
+        const ShaderResult result = run_shader(program, baseline, save);
+        total_spirv_ms += result.spirv_ms;
+        total_glsl_ms += result.glsl_ms;
+        total_spirv_instructions += result.spirv_instructions;
+        baseline_spirv_instructions += result.baseline_spirv_instructions;
+        nb_failed += result.success ? 0 : 1;
+        nb_changed += result.baseline_status == "changed" ? 1 : 0;
+
+        if (!entries.empty())
+            entries += ',';
+        entries += fmt::format(
+            R"({{"name":"{}","success":{},"spirv_ms":{:.3f},"glsl_ms":{:.3f},"spirv_instructions":{},"glsl_size":{},"baseline":"{}","baseline_spirv_instructions":{}}})",
+            result.name, result.success, result.spirv_ms, result.glsl_ms, result.spirv_instructions, result.glsl_size,
+            result.baseline_status, result.baseline_spirv_instructions);
+    }
+
+    fmt::print(R"({{"programs":{},"failed":{},"changed":{},"total_spirv_ms":{:.3f},"total_glsl_ms":{:.3f},"spirv_instructions":{},"baseline_spirv_instructions":{},"shaders":[{}]}})"
+               "\n",
+        programs.size(), nb_failed, nb_changed, total_spirv_ms, total_glsl_ms, total_spirv_instructions, baseline_spirv_instructions, entries);
+    return nb_failed == 0 ? 0 : 1;
+}
@@ -90,6 +90,8 @@ struct SpirvShaderParameters {
     int buffer_addresses_id;
     int viewport_ratio_id;
     int viewport_offset_id;
+    // bvec2 specialization constant telling if the texture viewport is used, 0 (NoResult) if it is decided when translating
+    spv::Id texture_viewport_enabled_id = 0;
 
     // when using a thread, texture or litteral buffer, if not -1, this fields contain the sa register
     // with the matching address, this assumes of course that this address is not copied somewhere
@@ -24,6 +24,8 @@
 
 #include <gxm/types.h>
 
+#include <bitset>
+
 struct FeatureState;
 
 namespace shader::usse::utils {
@@ -40,6 +42,11 @@ struct SpirvUtilFunctions {
     // this is technically not a function but is the best place to put it
     // buffer_address_vec[0] is for a packed float[] array
     spv::Id buffer_address_vec[5][2] = {};
+
+    // vec4 registers of the sa bank read by the translated code, used to only copy these from the uniform buffers
+    // sa_read_all is set when the bank is read with an index register
+    std::bitset<32> sa_vec4_read;
+    bool sa_read_all = false;
 };
 
 spv::Id finalize(spv::Builder &b, spv::Id first, spv::Id second, const Swizzle4 swizz, spv::Id offset, const Imm4 dest_mask);
@@ -36,6 +36,10 @@
 #include <SPIRV/disassemble.h>
 #include <spirv_glsl.hpp>
 
+#ifdef USE_SPIRV_OPT
+#include <spirv-tools/optimizer.hpp>
+#endif
+
 #include <algorithm>
 #include <fstream>
 #include <functional>
@@ -100,6 +104,13 @@ struct VarToReg {
     bool pa; // otherwise sa
 };
 
+// uniform buffer copied into the sa bank, the copy is generated once the program is translated
+struct UniformBlockCopy {
+    int index_in_container;
+    int start;
+    int vec4_count;
+};
+
 struct TranslationState {
     std::string hash;
     spv::Id last_frag_data_id = spv::NoResult;
@@ -110,6 +121,9 @@ struct TranslationState {
     spv::Id render_info_id = spv::NoResult;
     std::vector<VarToReg> var_to_regs;
     std::vector<spv::Id> interfaces;
+    std::vector<UniformBlockCopy> uniform_block_copies;
+    // entry block of the function doing the uniform block copies, called at the beginning of main
+    spv::Block *uniform_copy_block = nullptr;
     bool is_maskupdate = false;
     bool is_fragment = false;
     bool is_target_glsl = false;
@@ -796,11 +810,11 @@ static void create_fragment_inputs(spv::Builder &b, SpirvShaderParameters &param
     }
 }
 
-// For uniform buffer resigned in registers
-static void copy_uniform_block_to_register(spv::Builder &builder, spv::Id sa_bank, spv::Id block, spv::Id ite, const int start, const int vec4_count) {
+// For uniform buffer resigned in registers, copy the vec4 [first, last) of the block
+static void copy_uniform_block_to_register(spv::Builder &builder, spv::Id sa_bank, spv::Id block, spv::Id ite, const int start, const int first, const int last) {
     int start_in_vec4_granularity = start / 4;
 
-    utils::make_for_loop(builder, ite, builder.makeIntConstant(0), builder.makeIntConstant(vec4_count), [&]() {
+    utils::make_for_loop(builder, ite, builder.makeIntConstant(first), builder.makeIntConstant(last), [&]() {
         spv::Id to_copy = utils::create_access_chain(builder, spv::StorageClassStorageBuffer, block, { builder.createLoad(ite, spv::NoPrecision) });
         to_copy = builder.createLoad(to_copy, spv::NoPrecision);
         const spv::Id ite_loaded = builder.createLoad(ite, spv::NoPrecision);
@@ -835,6 +849,42 @@ static void copy_uniform_block_to_register(spv::Builder &builder, spv::Id sa_ban
     });
 }
 
+// generate the uniform block copies into the sa bank, only the vec4 of the blocks landing in registers read by the program are copied
+static void make_uniform_block_copies(spv::Builder &b, const SpirvShaderParameters &parameters, const utils::SpirvUtilFunctions &utils, TranslationState &translation_state) {
+    if (!translation_state.uniform_copy_block)
+        return;
+
+    spv::Block *last_build_point = b.getBuildPoint();
+    b.setBuildPoint(translation_state.uniform_copy_block);
+
+    const spv::Id ite = b.createVariable(spv::NoPrecision, spv::StorageClassFunction, b.makeIntType(32), "i");
+    const auto is_read = [&](int vec4) {
+        return utils.sa_read_all || (vec4 >= 0 && vec4 < static_cast<int>(utils.sa_vec4_read.size()) && utils.sa_vec4_read[vec4]);
+    };
+
+    for (const UniformBlockCopy &copy : translation_state.uniform_block_copies) {
+        const spv::Id block = utils::create_access_chain(b, spv::StorageClassStorageBuffer, parameters.buffer_container, { b.makeIntConstant(copy.index_in_container) });
+        const int base = copy.start / 4;
+        const bool unaligned = (copy.start % 4) != 0;
+
+        // vec4 i of the block is written to the register base + i, and also to base + i + 1 if the block is not aligned
+        // copy each run of consecutive vec4 needed in one loop
+        int first = -1;
+        for (int i = 0; i <= copy.vec4_count; i++) {
+            const bool needed = i < copy.vec4_count && (is_read(base + i) || (unaligned && is_read(base + i + 1)));
+            if (needed && first == -1) {
+                first = i;
+            } else if (!needed && first != -1) {
+                copy_uniform_block_to_register(b, parameters.uniforms, block, ite, copy.start, first, i);
+                first = -1;
+            }
+        }
+    }
+
+    b.makeReturn(false);
+    b.setBuildPoint(last_build_point);
+}
+
 static SpirvShaderParameters create_parameters(spv::Builder &b, const SceGxmProgram &program, utils::SpirvUtilFunctions &utils,
     const FeatureState &features, TranslationState &translation_state, SceGxmProgramType program_type, NonDependentTextureQueryCallInfos &texture_queries) {
     SpirvShaderParameters spv_params = {};
@@ -865,8 +915,6 @@ static SpirvShaderParameters create_parameters(spv::Builder &b, const SceGxmProg
 
     SamplerMap samplers;
 
-    spv::Id ite_copy = b.createVariable(spv::NoPrecision, spv::StorageClassFunction, i32_type, "i");
-
     using literal_pair = std::pair<std::uint32_t, spv::Id>;
 
     std::vector<literal_pair> literal_pairs;
@@ -964,7 +1012,7 @@ static SpirvShaderParameters create_parameters(spv::Builder &b, const SceGxmProg
     int curr_field_id = 0;
 
     const uint16_t uniform_buffer_count = features.support_memory_mapping ? buffer_count : 0;
-    const uint16_t uniform_texture_count = features.use_texture_viewport ? texture_count : 0;
+    const uint16_t uniform_texture_count = (features.use_texture_viewport || features.spec_texture_viewport) ? texture_count : 0;
 
     if (program_type == SceGxmProgramType::Vertex) {
         // Create the default reg uniform buffer
@@ -1067,6 +1115,14 @@ static SpirvShaderParameters create_parameters(spv::Builder &b, const SceGxmProg
 
     spv_params.render_info_id = translation_state.render_info_id;
 
+    if (features.spec_texture_viewport && uniform_texture_count > 0) {
+        // the value is given when building the pipeline, so the same module is used with and without texture viewport
+        const spv::Id use_texture_viewport = b.makeBoolConstant(false, true);
+        b.addDecoration(use_texture_viewport, spv::DecorationSpecId, 0);
+        b.addName(use_texture_viewport, "use_texture_viewport");
+        spv_params.texture_viewport_enabled_id = b.makeCompositeConstant(b.makeVectorType(b.makeBoolType(), 2), { use_texture_viewport, use_texture_viewport }, true);
+    }
+
     for (const auto &buffer : program_input.uniform_buffers) {
         int host_idx = convert_buffer_idx_to_host(buffer.index);
         if (buffer.reg_block_size > 0) {
@@ -1080,9 +1136,16 @@ static SpirvShaderParameters create_parameters(spv::Builder &b, const SceGxmProg
                 usse::utils::buffer_address_access(b, spv_params, utils, features, dest, 0, b.makeIntConstant(0), sizeof(uint32_t), copy_size, translation_state.is_fragment, host_idx);
             } else {
                 const uint32_t reg_block_size_in_f32v = std::min<uint32_t>(buffer.reg_block_size + 3, REG_SA_COUNT) / 4;
-                const auto spv_buffer = utils::create_access_chain(b, spv::StorageClassStorageBuffer, spv_params.buffer_container,
-                    { b.makeIntConstant(spv_params.buffers.at(host_idx).index_in_container) });
-                copy_uniform_block_to_register(b, spv_params.uniforms, spv_buffer, ite_copy, buffer.reg_start_offset, reg_block_size_in_f32v);
+                if (!translation_state.uniform_copy_block) {
+                    // the registers read are only known once the program is translated, so the copy is done by a function filled later
+                    std::vector<std::vector<spv::Decoration>> decorations;
+                    spv::Block *last_build_point = b.getBuildPoint();
+                    spv::Function *copy_func = b.makeFunctionEntry(spv::NoPrecision, b.makeVoidType(), "copy_uniform_blocks", {}, {},
+                        decorations, &translation_state.uniform_copy_block);
+                    b.setBuildPoint(last_build_point);
+                    b.createFunctionCall(copy_func, {});
+                }
+                translation_state.uniform_block_copies.push_back({ spv_params.buffers.at(host_idx).index_in_container, static_cast<int>(buffer.reg_start_offset), static_cast<int>(reg_block_size_in_f32v) });
             }
         }
     }
@@ -1839,6 +1902,8 @@ static SpirvCode convert_gxp_to_spirv_impl(const SceGxmProgram &program, const s
     }
     b.leaveFunction();
 
+    make_uniform_block_copies(b, parameters, utils, translation_state);
+
     // Add entry point to Builder
     auto entrypoint = b.addEntryPoint(execution_model, spv_func_main, entry_point_name.c_str());
     for (auto &i : translation_state.interfaces) {
@@ -1873,6 +1938,34 @@ static SpirvCode convert_gxp_to_spirv_impl(const SceGxmProgram &program, const s
     return spirv;
 }
 
+#ifdef USE_SPIRV_OPT
+// remove the loads and stores to the register banks which are not needed
+// the unoptimized code is kept if the optimizer fails (for example if the generated code is not valid)
+static void optimize_spirv(SpirvCode &spirv, const std::string &shader_hash) {
+    spvtools::Optimizer optimizer(SPV_ENV_UNIVERSAL_1_5);
+    optimizer.SetMessageConsumer([&](spv_message_level_t level, const char *, const spv_position_t &, const char *message) {
+        if (level <= SPV_MSG_ERROR)
+            LOG_WARN("SPIR-V optimizer error on shader {}: {}", shader_hash, message);
+    });
+
+    // the register banks are private variables shared by the functions, they must all be in main to become function variables
+    optimizer.RegisterPass(spvtools::CreateInlineExhaustivePass());
+    optimizer.RegisterPass(spvtools::CreatePrivateToLocalPass());
+    optimizer.RegisterPass(spvtools::CreateLocalAccessChainConvertPass());
+    optimizer.RegisterPass(spvtools::CreateLocalSingleBlockLoadStoreElimPass());
+    optimizer.RegisterPass(spvtools::CreateLocalSingleStoreElimPass());
+    // mem2reg
+    optimizer.RegisterPass(spvtools::CreateSSARewritePass());
+    optimizer.RegisterPass(spvtools::CreateDeadBranchElimPass());
+    optimizer.RegisterPass(spvtools::CreateBlockMergePass());
+    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass());
+
+    SpirvCode optimized;
+    if (optimizer.Run(spirv.data(), spirv.size(), &optimized))
+        spirv = std::move(optimized);
+}
+#endif
+
 static std::string convert_spirv_to_glsl(const std::string &shader_name, SpirvCode &spirv_binary, const FeatureState &features, TranslationState &translation_state, bool is_frag_color_used) {
     spirv_cross::CompilerGLSL glsl(std::move(spirv_binary));
 
@@ -1966,6 +2059,11 @@ GeneratedShader convert_gxp(const SceGxmProgram &program, const std::string &sha
     GeneratedShader shader{};
     shader.spirv = convert_gxp_to_spirv_impl(program, shader_hash, features, translation_state, force_shader_debug, dumper);
 
+#ifdef USE_SPIRV_OPT
+    if (features.optimize_spirv)
+        optimize_spirv(shader.spirv, shader_hash);
+#endif
+
     if (translation_state.is_target_glsl) {
         // also generate the glsl file
         // this destroys shader.spirv
@@ -87,13 +87,21 @@ spv::Id shader::usse::USSETranslatorVisitor::do_fetch_texture(const spv::Id tex,
 
     // the texture viewport is only useful for surfaces and they are never cubes
     // also for the time being ignore sampleProj ops
-    if (m_features.use_texture_viewport && dim == 2) {
+    if ((m_features.use_texture_viewport || m_features.spec_texture_viewport) && dim == 2) {
         // coord = coord * viewport_ratio + viewport_offset
         spv::Id viewport_ratio = utils::create_access_chain(m_b, spv::StorageClassUniform, m_spirv_params.render_info_id, { m_b.makeIntConstant(m_spirv_params.viewport_ratio_id), m_b.makeIntConstant(texture_index) });
         viewport_ratio = m_b.createLoad(viewport_ratio, spv::NoPrecision);
         spv::Id viewport_offset = utils::create_access_chain(m_b, spv::StorageClassUniform, m_spirv_params.render_info_id, { m_b.makeIntConstant(m_spirv_params.viewport_offset_id), m_b.makeIntConstant(texture_index) });
         viewport_offset = m_b.createLoad(viewport_offset, spv::NoPrecision);
 
+        if (m_spirv_params.texture_viewport_enabled_id != spv::NoResult) {
+            // without texture viewport, the ratio is 1 and the offset is 0 (the driver removes the fma)
+            const spv::Id one = m_b.makeFloatConstant(1.0f);
+            const spv::Id zero = m_b.makeFloatConstant(0.0f);
+            viewport_ratio = m_b.createTriOp(spv::OpSelect, type_f32_v[2], m_spirv_params.texture_viewport_enabled_id, viewport_ratio, m_b.makeCompositeConstant(type_f32_v[2], { one, one }));
+            viewport_offset = m_b.createTriOp(spv::OpSelect, type_f32_v[2], m_spirv_params.texture_viewport_enabled_id, viewport_offset, m_b.makeCompositeConstant(type_f32_v[2], { zero, zero }));
+        }
+
         if (extra1 != spv::NoResult || lod_mode != 4) {
             // only keep the first two coordinates (x,y)
             coord_id = m_b.createOp(spv::OpVectorShuffle, type_f32_v[2], { coord_id, coord_id, 0, 1 });
@@ -25,16 +25,18 @@
 #include <shader/usse_translator_types.h>
 #include <util/log.h>
 
+#include <array>
 #include <map>
-#include <optional>
+#include <vector>
 
 namespace shader::usse {
 
 template <typename Visitor>
 using USSEMatcher = shader::decoder::Matcher<Visitor, uint64_t>;
 
+// return nullptr if no matcher matches the instruction
 template <typename V>
-static std::optional<const USSEMatcher<V>> DecodeUSSE(uint64_t instruction) {
+static const USSEMatcher<V> *DecodeUSSE(uint64_t instruction) {
     static const std::array<USSEMatcher<V>, 35> table = {
 #define INST(fn, name, bitstring) shader::decoder::detail::detail<USSEMatcher<V>>::GetMatcher(fn, name, bitstring)
         // clang-format off
@@ -861,10 +863,27 @@ static std::optional<const USSEMatcher<V>> DecodeUSSE(uint64_t instruction) {
     };
 #undef INST
 
-    const auto matches_instruction = [instruction](const auto &matcher) { return matcher.Matches(instruction); };
+    // the matchers which can match each value of opcode1 (the 5 upper bits), kept in
+    // the table order as the first matcher matching an instruction is the one used
+    static const std::array<std::vector<const USSEMatcher<V> *>, 32> opcode_table = [] {
+        constexpr int opcode_shift = 59;
+        constexpr uint64_t opcode_mask = 0b11111ULL << opcode_shift;
+
+        std::array<std::vector<const USSEMatcher<V> *>, 32> result;
+        for (uint64_t opcode = 0; opcode < result.size(); opcode++) {
+            for (const USSEMatcher<V> &matcher : table) {
+                if (((opcode << opcode_shift) & matcher.GetMask() & opcode_mask) == (matcher.GetExpected() & opcode_mask))
+                    result[opcode].push_back(&matcher);
+            }
+        }
+        return result;
+    }();
 
-    auto iter = std::find_if(table.begin(), table.end(), matches_instruction);
-    return iter != table.end() ? std::optional<const USSEMatcher<V>>(*iter) : std::nullopt;
+    for (const USSEMatcher<V> *matcher : opcode_table[instruction >> 59]) {
+        if (matcher->Matches(instruction))
+            return matcher;
+    }
+    return nullptr;
 }
 
 //
@@ -940,8 +959,8 @@ void USSERecompiler::compile_code_node(const usse::USSECodeNode &code) {
         cur_instr = inst[pc];
 
         // Recompile the instruction, to the current block
-        auto decoder = usse::DecodeUSSE<usse::USSETranslatorVisitor>(cur_instr);
-        if (decoder.has_value())
+        const auto decoder = usse::DecodeUSSE<usse::USSETranslatorVisitor>(cur_instr);
+        if (decoder)
             decoder->call(visitor, cur_instr);
         else
             LOG_DISASM("{:016x}: error: instruction unmatched", cur_instr);
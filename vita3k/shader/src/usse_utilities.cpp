@@ -1129,6 +1129,15 @@ spv::Id load(spv::Builder &b, const SpirvShaderParameters &params, SpirvUtilFunc
         idx_in_arr_2 = b.makeIntConstant((op.num + shift_offset + 3) >> 2);
     }
 
+    if (op.bank == RegisterBank::SECATTR) {
+        if (!b.isConstant(idx_in_arr_1)) {
+            utils.sa_read_all = true;
+        } else {
+            for (int i = (op.num + shift_offset) >> 2; i <= ((op.num + shift_offset + 3) >> 2) && i < static_cast<int>(utils.sa_vec4_read.size()); i++)
+                utils.sa_vec4_read.set(i);
+        }
+    }
+
     std::vector<spv::Id> first_pass_operands;
     std::vector<spv::Id> second_pass_operands;
 
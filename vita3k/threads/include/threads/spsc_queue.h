@@ -0,0 +1,160 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * \brief Bounded queue between one producer and one consumer thread.
+ *
+ * Pushing and popping only touch two indices, the mutex and condition variables are used only to park
+ * a side that has been waiting for more than a few spins, so as long as neither side has to wait they
+ * never contend on a lock. Producers are serialized with their own mutex, which nothing else takes,
+ * so the queue is still safe to push to from more than one thread.
+ */
+template <typename T, size_t Capacity>
+class SPSCQueue {
+    static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+
+public:
+    // Maximum number of items waiting in the queue, at most Capacity
+    size_t max_pending = Capacity;
+
+    /**
+     * \brief Add an item, blocking while max_pending items are already queued.
+     */
+    void push(const T &item) {
+        const std::lock_guard<std::mutex> guard(producer_mutex);
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (!wait_for([&] { return tail - head_.load(std::memory_order_acquire) < max_pending; }, producer_waiting, not_full, -1))
+            return;
+
+        slots[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        wake(consumer_waiting, not_empty);
+    }
+
+    /**
+     * \brief Get the oldest item without removing it.
+     * \param us Microseconds to wait for an item, 0 to wait until there is one or the queue is aborted
+     * \return nullptr if there is no item. The pointer stays valid until pop() is called.
+     */
+    T *front(const int us = 0) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (!wait_for([&] { return tail_.load(std::memory_order_acquire) != head; }, consumer_waiting, not_empty, us == 0 ? -1 : us))
+            return nullptr;
+
+        return &slots[head & (Capacity - 1)];
+    }
+
+    // Remove the oldest item, must only be called after front() returned one
+    void pop() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_seq_cst);
+        wake(producer_waiting, not_full);
+    }
+
+    /**
+     * \brief Block until the consumer has popped every queued item or the queue is aborted.
+     */
+    void wait_empty() {
+        const std::lock_guard<std::mutex> guard(producer_mutex);
+        wait_for([&] { return tail_.load(std::memory_order_relaxed) == head_.load(std::memory_order_acquire); }, producer_waiting, not_full, -1);
+    }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    void abort() {
+        aborted = true;
+        const std::lock_guard<std::mutex> guard(park_mutex);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    // Drop all the items and clear the aborted state, must only be called while no other thread uses the queue
+    void reset() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        aborted = false;
+    }
+
+    SPSCQueue() = default;
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+private:
+    static constexpr int SPIN_COUNT = 64;
+
+    // Spin, then sleep on cond until ready() is true. A negative timeout waits forever.
+    template <typename Pred>
+    bool wait_for(Pred ready, std::atomic<bool> &waiting, std::condition_variable &cond, const int timeout_us) {
+        for (int i = 0; i < SPIN_COUNT; i++) {
+            if (ready())
+                return true;
+            if (aborted)
+                return false;
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(park_mutex);
+        // publish that we are about to sleep before checking one last time, see wake()
+        waiting.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto woken = [&] { return aborted || ready(); };
+        bool res;
+        if (timeout_us < 0) {
+            cond.wait(lock, woken);
+            res = true;
+        } else {
+            res = cond.wait_for(lock, std::chrono::microseconds(timeout_us), woken);
+        }
+        waiting.store(false, std::memory_order_relaxed);
+
+        return res && !aborted;
+    }
+
+    void wake(std::atomic<bool> &waiting, std::condition_variable &cond) {
+        if (waiting.load(std::memory_order_seq_cst)) {
+            const std::lock_guard<std::mutex> guard(park_mutex);
+            cond.notify_one();
+        }
+    }
+
+    std::array<T, Capacity> slots{};
+
+    // keep the indices on separate cache lines, each is written by only one side
+    alignas(64) std::atomic<size_t> head_{ 0 };
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+
+    std::atomic<bool> consumer_waiting{ false };
+    std::atomic<bool> producer_waiting{ false };
+    std::atomic<bool> aborted{ false };
+
+    std::mutex producer_mutex;
+    std::mutex park_mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
@@ -10,3 +10,5 @@ int handle_touch_event(SDL_TouchFingerEvent &finger);
 int toggle_touchscreen();
 int touch_get(const SceUID thread_id, EmuEnvState &emuenv, const SceUInt32 &port, SceTouchData *pData, SceUInt32 count, bool is_peek);
 void touch_set_force_mode(int port, bool mode);
+// data of the given port built at the last vblank, it can be replaced before it is read by the app
+SceTouchData &touch_get_vsync_data(int port);
@@ -321,3 +321,7 @@ int touch_get(const SceUID thread_id, EmuEnvState &emuenv, const SceUInt32 &port
 void touch_set_force_mode(int port, bool mode) {
     forceTouchEnabled[port] = mode;
 }
+
+SceTouchData &touch_get_vsync_data(int port) {
+    return touch_buffers[touch_buffer_idx][port];
+}
@@ -0,0 +1,71 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Host memory held by the subsystems the most likely to grow, attributed to each of them so it can be
+// shown in the performance overlay and, in profiling builds, in the memory view of Tracy
+namespace alloc_tracker {
+
+enum class Subsystem : uint8_t {
+    TextureStaging,
+    SurfaceCache,
+    ShaderCache,
+    NgsBuffers,
+    CodecBuffers,
+    IoCache,
+    Count
+};
+
+struct SubsystemUsage {
+    const char *name;
+    uint64_t bytes;
+    uint64_t allocations;
+};
+
+typedef std::array<SubsystemUsage, static_cast<size_t>(Subsystem::Count)> Usage;
+
+extern std::atomic<bool> enabled;
+
+void set_enabled(bool enable);
+
+// the memory owned by ptr, tracking it again with another size replaces the previous one
+void track(Subsystem subsystem, const void *ptr, uint64_t size);
+// nothing is done if ptr is not tracked
+void untrack(const void *ptr);
+
+Usage get_usage();
+
+} // namespace alloc_tracker
+
+// nothing is looked up when the tracking is disabled
+#define TRACK_HOST_ALLOC(subsystem, ptr, size)                                    \
+    do {                                                                          \
+        if (alloc_tracker::enabled.load(std::memory_order_relaxed))               \
+            alloc_tracker::track(alloc_tracker::Subsystem::subsystem, ptr, size); \
+    } while (0)
+
+#define TRACK_HOST_FREE(ptr)                                        \
+    do {                                                            \
+        if (alloc_tracker::enabled.load(std::memory_order_relaxed)) \
+            alloc_tracker::untrack(ptr);                            \
+    } while (0)
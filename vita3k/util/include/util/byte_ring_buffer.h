@@ -2,9 +2,11 @@
 
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <memory>
 
 #include <cassert>
+#include <cstring>
 
 // Ring buffer for bytes - not multi-thread safe, bring your own locks
 class ByteRingBuffer {
@@ -79,3 +81,70 @@ private:
     std::size_t end = 0;
     std::size_t used = 0;
 };
+
+// Ring buffer for bytes between one producer and one consumer thread, neither side ever locks or allocates
+class SPSCByteRingBuffer {
+public:
+    // the capacity is rounded up to a power of two
+    SPSCByteRingBuffer(std::size_t size)
+        : capacity(std::bit_ceil(size))
+        , buffer(new char[capacity]) {}
+
+    std::size_t Capacity() const { return capacity; }
+    std::size_t Used() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+    std::size_t Free() const { return capacity - Used(); }
+
+    // must only be called by the producer
+    std::size_t Insert(const void *in, std::size_t size) {
+        const std::size_t end = tail.load(std::memory_order_relaxed);
+        const std::size_t insertSize = std::min(size, capacity - (end - head.load(std::memory_order_acquire)));
+        const std::size_t offset = end & (capacity - 1);
+        const std::size_t bufEndInsertSize = std::min(capacity - offset, insertSize);
+
+        memcpy(&buffer[offset], in, bufEndInsertSize);
+        memcpy(&buffer[0], static_cast<const char *>(in) + bufEndInsertSize, insertSize - bufEndInsertSize);
+
+        tail.store(end + insertSize, std::memory_order_release);
+        return insertSize;
+    }
+
+    // must only be called by the consumer
+    std::size_t Remove(void *out, std::size_t size) {
+        const std::size_t start = head.load(std::memory_order_relaxed);
+        const std::size_t extractSize = std::min(size, tail.load(std::memory_order_acquire) - start);
+        const std::size_t offset = start & (capacity - 1);
+        const std::size_t bufTailSize = std::min(capacity - offset, extractSize);
+
+        memcpy(out, &buffer[offset], bufTailSize);
+        memcpy(static_cast<char *>(out) + bufTailSize, &buffer[0], extractSize - bufTailSize);
+
+        head.store(start + extractSize, std::memory_order_release);
+        return extractSize;
+    }
+
+    // must only be called by the consumer, gives the data which can be read in place (at most size bytes)
+    // in two parts as it can wrap around the end of the buffer, the data stays in the buffer until Discard is called
+    std::size_t ReadInPlace(std::size_t size, const char *&first, std::size_t &first_size, const char *&second) const {
+        const std::size_t start = head.load(std::memory_order_relaxed);
+        const std::size_t extractSize = std::min(size, tail.load(std::memory_order_acquire) - start);
+        const std::size_t offset = start & (capacity - 1);
+
+        first = &buffer[offset];
+        first_size = std::min(capacity - offset, extractSize);
+        second = &buffer[0];
+        return extractSize;
+    }
+
+    // must only be called by the consumer
+    void Discard(std::size_t size) {
+        head.store(head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+private:
+    const std::size_t capacity;
+    std::unique_ptr<char[]> buffer;
+
+    // free running positions, each written by only one side
+    alignas(64) std::atomic<std::size_t> head = 0;
+    alignas(64) std::atomic<std::size_t> tail = 0;
+};
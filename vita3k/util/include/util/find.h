@@ -22,11 +22,12 @@
 
 namespace util {
 
-template <typename T, typename Key>
-std::shared_ptr<T> find(Key key, const std::map<Key, std::shared_ptr<T>> &map) {
+// Works with any associative container of shared pointers (std::map, unordered_map_fast...)
+template <typename Map>
+typename Map::mapped_type find(const typename Map::key_type &key, const Map &map) {
     const auto it = map.find(key);
     if (it == map.end()) {
-        return std::shared_ptr<T>();
+        return typename Map::mapped_type();
     }
 
     return it->second;
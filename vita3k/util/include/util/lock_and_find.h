@@ -20,9 +20,16 @@
 #include "find.h"
 
 #include <mutex>
+#include <shared_mutex>
 
-template <typename T, typename Key>
-std::shared_ptr<T> lock_and_find(Key key, const std::map<Key, std::shared_ptr<T>> &map, std::mutex &mutex) {
+template <typename Map>
+typename Map::mapped_type lock_and_find(const typename Map::key_type &key, const Map &map, std::mutex &mutex) {
     const std::lock_guard<std::mutex> lock(mutex);
     return util::find(key, map);
 }
+
+template <typename Map>
+typename Map::mapped_type lock_and_find(const typename Map::key_type &key, const Map &map, std::shared_mutex &mutex) {
+    const std::shared_lock<std::shared_mutex> lock(mutex);
+    return util::find(key, map);
+}
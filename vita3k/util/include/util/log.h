@@ -73,9 +73,33 @@
 
 namespace logging {
 
+// What a thread logging into a full queue does, waiting for the writer thread or losing the message
+enum class OverflowPolicy {
+    Block,
+    Drop,
+};
+
+// Categories of the binary log, whose records are written without being formatted
+enum class BinaryLogCategory : uint32_t {
+    HleImportCall = 1, // values: nid, lr
+    LleImportCall = 2, // values: nid, lr
+};
+
 ExitCode init(const Root &root_paths, bool use_stdout);
 void set_level(spdlog::level::level_enum log_level);
+// The messages are formatted by the thread which logs them and written by a dedicated thread
+void set_overflow_policy(OverflowPolicy policy);
 ExitCode add_sink(const fs::path &log_path);
+// Waits for the messages already logged to be written
+void flush();
+
+// The binary log is a file starting with the "V3KB" magic and a 32 bits version, followed by records of
+// a 64 bits time in nanoseconds since the log was opened, the category, the thread id and two values,
+// all in little endian 32 bits words
+ExitCode open_binary_log(const fs::path &path);
+void close_binary_log();
+bool is_binary_log_open();
+void log_binary(BinaryLogCategory category, uint32_t thread_id, uint32_t value0, uint32_t value1);
 
 } // namespace logging
 
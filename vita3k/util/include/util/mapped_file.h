@@ -0,0 +1,58 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/fs.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only view of a whole file, its content is only read from the disk when accessed
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // return false if the file could not be opened or is empty
+    bool open(const fs::path &path);
+    void close();
+
+    bool is_open() const {
+        return data_ != nullptr;
+    }
+    const uint8_t *data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+
+    // ask the OS to read this range from the disk ahead of time, without waiting for it
+    void prefetch(size_t offset, size_t size) const;
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef WIN32
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+#endif
+};
@@ -0,0 +1,51 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace thread_utils {
+
+// Number of logical cores available on the host
+int get_host_cpu_count();
+
+// Parses a cpu list such as "0-3,6" into the host core indices it names
+std::vector<int> parse_cpu_set(const std::string &str);
+
+// Restricts the calling thread to the given host cores, an empty set removes the restriction
+bool set_current_thread_affinity(const std::vector<int> &cores);
+
+// Handle used to read the cpu time of a thread from another one
+struct ThreadCpuClock {
+    uint64_t native = 0;
+    bool valid = false;
+};
+
+ThreadCpuClock get_current_thread_cpu_clock();
+// The clock must be released by the thread it belongs to, or once it has exited
+void release_thread_cpu_clock(ThreadCpuClock &clock);
+// Time spent running by the thread in user and kernel mode, 0 if it cannot be read
+uint64_t get_thread_cpu_time_ns(const ThreadCpuClock &clock);
+
+// Sleeps with a high resolution timer until shortly before the deadline, then spins until it is reached
+void precise_sleep_until(std::chrono::steady_clock::time_point deadline);
+
+} // namespace thread_utils
@@ -0,0 +1,114 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <util/alloc_tracker.h>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+#include <mutex>
+#include <unordered_map>
+
+namespace alloc_tracker {
+
+// also the names of the memory pools in Tracy, they must stay valid
+static constexpr const char *subsystem_names[] = {
+    "Texture staging",
+    "Surface cache",
+    "Shader cache",
+    "NGS buffers",
+    "Codec buffers",
+    "IO caches"
+};
+static_assert(std::size(subsystem_names) == static_cast<size_t>(Subsystem::Count));
+
+struct Allocation {
+    Subsystem subsystem;
+    uint64_t size;
+};
+
+std::atomic<bool> enabled = false;
+
+static std::mutex mutex;
+static std::unordered_map<const void *, Allocation> allocations;
+static std::array<uint64_t, static_cast<size_t>(Subsystem::Count)> bytes{};
+static std::array<uint64_t, static_cast<size_t>(Subsystem::Count)> counts{};
+
+void set_enabled(bool enable) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    enabled = enable;
+    if (!enable) {
+        // nothing would untrack them anymore
+        allocations.clear();
+        bytes.fill(0);
+        counts.fill(0);
+    }
+}
+
+static void remove(std::unordered_map<const void *, Allocation>::iterator it) {
+    const size_t index = static_cast<size_t>(it->second.subsystem);
+    bytes[index] -= it->second.size;
+    counts[index]--;
+#ifdef TRACY_ENABLE
+    TracyFreeN(it->first, subsystem_names[index]);
+#endif
+    allocations.erase(it);
+}
+
+void track(Subsystem subsystem, const void *ptr, uint64_t size) {
+    if (!ptr)
+        return;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled)
+        return;
+
+    const auto it = allocations.find(ptr);
+    if (it != allocations.end()) {
+        if ((it->second.subsystem == subsystem) && (it->second.size == size))
+            return;
+        remove(it);
+    }
+    if (size == 0)
+        return;
+
+    const size_t index = static_cast<size_t>(subsystem);
+    allocations.emplace(ptr, Allocation{ subsystem, size });
+    bytes[index] += size;
+    counts[index]++;
+#ifdef TRACY_ENABLE
+    TracyAllocN(ptr, size, subsystem_names[index]);
+#endif
+}
+
+void untrack(const void *ptr) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto it = allocations.find(ptr);
+    if (it != allocations.end())
+        remove(it);
+}
+
+Usage get_usage() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    Usage usage;
+    for (size_t i = 0; i < usage.size(); i++)
+        usage[i] = { subsystem_names[i], bytes[i], counts[i] };
+    return usage;
+}
+
+} // namespace alloc_tracker
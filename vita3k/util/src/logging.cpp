@@ -21,20 +21,52 @@
 #include <Windows.h>
 #endif
 
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/msvc_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
 namespace logging {
 
 static const fs::path &LOG_FILE_NAME = "vita3k.log";
 static const char *LOG_PATTERN = "%^[%H:%M:%S.%e] |%L| [%!]: %v%$";
+// Formatted messages waiting for the writer thread
+static constexpr size_t LOG_QUEUE_SIZE = 8192;
 std::vector<spdlog::sink_ptr> sinks;
+static OverflowPolicy overflow_policy = OverflowPolicy::Block;
 
 void register_log_exception_handler();
 
 void flush() {
     spdlog::details::registry::instance().flush_all();
+
+    // the flush of the async logger is only queued, it is waited for so a crash does not lose the last messages
+    const auto pool = spdlog::thread_pool();
+    if (pool) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (pool->queue_size() > 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (const auto &sink : sinks)
+        sink->flush();
+}
+
+// The sinks are only written by the thread of the pool, so the threads logging never wait for the console or the file
+static void make_default_logger() {
+    if (!spdlog::thread_pool())
+        spdlog::init_thread_pool(LOG_QUEUE_SIZE, 1);
+
+    const auto level = spdlog::default_logger() ? spdlog::get_level() : spdlog::level::info;
+    const auto policy = (overflow_policy == OverflowPolicy::Drop) ? spdlog::async_overflow_policy::overrun_oldest : spdlog::async_overflow_policy::block;
+    auto logger = std::make_shared<spdlog::async_logger>("vita3k logger", begin(sinks), end(sinks), spdlog::thread_pool(), policy);
+    logger->set_level(level);
+    spdlog::set_default_logger(std::move(logger));
+    spdlog::set_pattern(LOG_PATTERN);
 }
 
 ExitCode init(const Root &root_paths, bool use_stdout) {
@@ -78,6 +110,15 @@ void set_level(spdlog::level::level_enum log_level) {
     spdlog::set_level(log_level);
 }
 
+void set_overflow_policy(OverflowPolicy policy) {
+    if (overflow_policy == policy)
+        return;
+
+    overflow_policy = policy;
+    if (!sinks.empty())
+        make_default_logger();
+}
+
 ExitCode add_sink(const fs::path &log_path) {
     try {
 #ifdef WIN32
@@ -96,11 +137,154 @@ ExitCode add_sink(const fs::path &log_path) {
     }
 #endif
 
-    spdlog::set_default_logger(std::make_shared<spdlog::logger>("vita3k logger", begin(sinks), end(sinks)));
-    spdlog::set_pattern(LOG_PATTERN);
+    make_default_logger();
     return Success;
 }
 
+// Records of the binary log, the threads logging reserve a slot of the ring without any lock
+// and the writer thread writes the published slots in order by batches
+namespace {
+
+constexpr char BINARY_LOG_MAGIC[4] = { 'V', '3', 'K', 'B' };
+constexpr uint32_t BINARY_LOG_VERSION = 1;
+constexpr size_t BINARY_LOG_RING_SIZE = 1 << 16;
+constexpr size_t BINARY_LOG_BATCH_SIZE = 4096;
+
+struct BinaryLogRecord {
+    uint64_t time;
+    uint32_t category;
+    uint32_t thread_id;
+    uint32_t values[2];
+};
+
+struct BinaryLogSlot {
+    // equal to the position of the slot when it can be written, to the position + 1 once it is published
+    std::atomic<uint64_t> sequence;
+    BinaryLogRecord record;
+};
+
+struct BinaryLog {
+    std::atomic<bool> open = false;
+    std::unique_ptr<BinaryLogSlot[]> slots;
+    std::atomic<uint64_t> write_pos = 0;
+    uint64_t read_pos = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<bool> stop = false;
+    std::chrono::steady_clock::time_point start;
+    std::FILE *file = nullptr;
+    std::thread writer;
+};
+
+BinaryLog binary_log;
+
+} // namespace
+
+static size_t drain_binary_log(std::vector<BinaryLogRecord> &batch) {
+    batch.clear();
+    while (batch.size() < BINARY_LOG_BATCH_SIZE) {
+        BinaryLogSlot &slot = binary_log.slots[binary_log.read_pos & (BINARY_LOG_RING_SIZE - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != binary_log.read_pos + 1)
+            break;
+        batch.push_back(slot.record);
+        slot.sequence.store(binary_log.read_pos + BINARY_LOG_RING_SIZE, std::memory_order_release);
+        binary_log.read_pos++;
+    }
+    if (!batch.empty())
+        std::fwrite(batch.data(), sizeof(BinaryLogRecord), batch.size(), binary_log.file);
+    return batch.size();
+}
+
+static void binary_log_writer() {
+    std::vector<BinaryLogRecord> batch;
+    batch.reserve(BINARY_LOG_BATCH_SIZE);
+    while (!binary_log.stop.load(std::memory_order_acquire)) {
+        if (drain_binary_log(batch) == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    while (drain_binary_log(batch) > 0) {
+    }
+}
+
+ExitCode open_binary_log(const fs::path &path) {
+    close_binary_log();
+
+#ifdef WIN32
+    binary_log.file = _wfopen(path.generic_path().wstring().c_str(), L"wb");
+#else
+    binary_log.file = std::fopen(path.generic_path().string().c_str(), "wb");
+#endif
+    if (!binary_log.file) {
+        LOG_ERROR("Failed to open the binary log {}", path.string());
+        return InitConfigFailed;
+    }
+    std::fwrite(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC), 1, binary_log.file);
+    std::fwrite(&BINARY_LOG_VERSION, sizeof(BINARY_LOG_VERSION), 1, binary_log.file);
+
+    // the ring is kept once allocated, a thread can still be logging into it while the log is closed
+    if (!binary_log.slots)
+        binary_log.slots = std::make_unique<BinaryLogSlot[]>(BINARY_LOG_RING_SIZE);
+    for (size_t i = 0; i < BINARY_LOG_RING_SIZE; i++)
+        binary_log.slots[i].sequence.store(i, std::memory_order_relaxed);
+    binary_log.write_pos = 0;
+    binary_log.read_pos = 0;
+    binary_log.dropped = 0;
+    binary_log.stop = false;
+    binary_log.start = std::chrono::steady_clock::now();
+    binary_log.writer = std::thread(binary_log_writer);
+    binary_log.open.store(true, std::memory_order_release);
+
+    LOG_INFO("Binary log opened at {}", path.string());
+    return Success;
+}
+
+void close_binary_log() {
+    if (!binary_log.open.exchange(false))
+        return;
+
+    // give the threads which were reserving a slot when the log was closed the time to publish it
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    binary_log.stop.store(true, std::memory_order_release);
+    binary_log.writer.join();
+    std::fclose(binary_log.file);
+    binary_log.file = nullptr;
+
+    LOG_INFO_IF(binary_log.dropped > 0, "{} records of the binary log were dropped", binary_log.dropped.load());
+}
+
+bool is_binary_log_open() {
+    return binary_log.open.load(std::memory_order_relaxed);
+}
+
+void log_binary(BinaryLogCategory category, uint32_t thread_id, uint32_t value0, uint32_t value1) {
+    if (!is_binary_log_open())
+        return;
+
+    uint64_t pos = binary_log.write_pos.load(std::memory_order_relaxed);
+    BinaryLogSlot *slot;
+    for (;;) {
+        slot = &binary_log.slots[pos & (BINARY_LOG_RING_SIZE - 1)];
+        const int64_t diff = static_cast<int64_t>(slot->sequence.load(std::memory_order_acquire)) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (binary_log.write_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // the ring is full
+            if (overflow_policy == OverflowPolicy::Drop) {
+                binary_log.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::yield();
+            pos = binary_log.write_pos.load(std::memory_order_relaxed);
+        } else {
+            pos = binary_log.write_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - binary_log.start);
+    slot->record = { static_cast<uint64_t>(time.count()), static_cast<uint32_t>(category), thread_id, { value0, value1 } };
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
 // log exceptions and flush log file on exceptions
 #ifdef WIN32
 static LONG WINAPI exception_handler(PEXCEPTION_POINTERS pExp) noexcept {
@@ -0,0 +1,136 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <util/mapped_file.h>
+
+#include <algorithm>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef WIN32
+bool MappedFile::open(const fs::path &path) {
+    close();
+
+    // shader packs are appended to while they are mapped
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle = file;
+    mapping_handle = mapping;
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    return true;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+    if (offset >= size_)
+        return;
+
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t *>(data_ + offset);
+    range.NumberOfBytes = std::min(size, size_ - offset);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::close() {
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle)
+        CloseHandle(file_handle);
+
+    data_ = nullptr;
+    size_ = 0;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+}
+#else
+bool MappedFile::open(const fs::path &path) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *view = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid once the file descriptor is closed
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(file_stat.st_size);
+    return true;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+    if (offset >= size_)
+        return;
+
+    // madvise needs a page aligned address
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t start = offset & ~(page_size - 1);
+    const size_t end = std::min(offset + size, size_);
+    madvise(const_cast<uint8_t *>(data_ + start), end - start, MADV_WILLNEED);
+}
+
+void MappedFile::close() {
+    if (data_)
+        munmap(const_cast<uint8_t *>(data_), size_);
+
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
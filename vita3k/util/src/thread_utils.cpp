@@ -0,0 +1,201 @@
+// Vita3K emulator project
+// Copyright (C) 2023 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <util/thread_utils.h>
+
+#include <util/log.h>
+#include <util/string_utils.h>
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <pthread.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#if defined(_WIN32) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace thread_utils {
+
+int get_host_cpu_count() {
+    const unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : static_cast<int>(count);
+}
+
+std::vector<int> parse_cpu_set(const std::string &str) {
+    std::vector<int> cores;
+    const int cpu_count = get_host_cpu_count();
+    for (const auto &range : string_utils::split_string(str, ',')) {
+        if (range.empty())
+            continue;
+        int first = 0;
+        int last = 0;
+        try {
+            const auto dash = range.find('-');
+            first = std::stoi(range.substr(0, dash));
+            last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        } catch (const std::exception &) {
+            LOG_WARN("Ignoring invalid host cpu range: {}", range);
+            continue;
+        }
+        for (int core = std::max(first, 0); core <= std::min(last, cpu_count - 1); core++) {
+            if (std::find(cores.begin(), cores.end(), core) == cores.end())
+                cores.push_back(core);
+        }
+    }
+    std::sort(cores.begin(), cores.end());
+    return cores;
+}
+
+bool set_current_thread_affinity(const std::vector<int> &cores) {
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (const int core : cores) {
+        if (core < static_cast<int>(sizeof(DWORD_PTR) * 8))
+            mask |= DWORD_PTR(1) << core;
+    }
+    if (mask == 0) {
+        DWORD_PTR system_mask = 0;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &system_mask))
+            return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (cores.empty()) {
+        for (int core = 0; core < get_host_cpu_count(); core++)
+            CPU_SET(core, &set);
+    } else {
+        for (const int core : cores)
+            CPU_SET(core, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    // macOS does not expose hard thread affinity
+    return cores.empty();
+#endif
+}
+
+ThreadCpuClock get_current_thread_cpu_clock() {
+    ThreadCpuClock clock;
+#ifdef _WIN32
+    // the pseudo handle of GetCurrentThread only means the calling thread, a real one is needed
+    HANDLE handle = nullptr;
+    clock.valid = DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &handle, THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0);
+    clock.native = reinterpret_cast<uint64_t>(handle);
+#elif defined(__APPLE__)
+    clock.native = pthread_mach_thread_np(pthread_self());
+    clock.valid = true;
+#else
+    clockid_t id;
+    clock.valid = pthread_getcpuclockid(pthread_self(), &id) == 0;
+    clock.native = static_cast<uint64_t>(id);
+#endif
+    return clock;
+}
+
+void release_thread_cpu_clock(ThreadCpuClock &clock) {
+#ifdef _WIN32
+    if (clock.valid)
+        CloseHandle(reinterpret_cast<HANDLE>(clock.native));
+#endif
+    clock = {};
+}
+
+uint64_t get_thread_cpu_time_ns(const ThreadCpuClock &clock) {
+    if (!clock.valid)
+        return 0;
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(reinterpret_cast<HANDLE>(clock.native), &creation, &exit, &kernel, &user))
+        return 0;
+    const auto to_100ns = [](const FILETIME &time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (to_100ns(kernel) + to_100ns(user)) * 100;
+#elif defined(__APPLE__)
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+    if (thread_info(static_cast<thread_act_t>(clock.native), THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+    const auto to_ns = [](const time_value_t &time) {
+        return static_cast<uint64_t>(time.seconds) * 1'000'000'000 + static_cast<uint64_t>(time.microseconds) * 1000;
+    };
+    return to_ns(info.user_time) + to_ns(info.system_time);
+#else
+    timespec time;
+    if (clock_gettime(static_cast<clockid_t>(clock.native), &time) != 0)
+        return 0;
+    return static_cast<uint64_t>(time.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(time.tv_nsec);
+#endif
+}
+
+void precise_sleep_until(const std::chrono::steady_clock::time_point deadline) {
+    using namespace std::chrono;
+    // how late the os sleep can wake up, this part is spent spinning instead
+#ifdef _WIN32
+    constexpr auto spin_margin = microseconds(1000);
+#else
+    constexpr auto spin_margin = microseconds(200);
+#endif
+
+    const auto sleep_deadline = deadline - spin_margin;
+    const auto now = steady_clock::now();
+    if (now < sleep_deadline) {
+#ifdef _WIN32
+        // the high resolution timer is only available since Windows 10 1803, fallback to the default sleep otherwise
+        thread_local const HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        LARGE_INTEGER due_time;
+        // negative values are relative, in 100ns units
+        due_time.QuadPart = -static_cast<LONGLONG>(duration_cast<nanoseconds>(sleep_deadline - now).count() / 100);
+        if (timer && SetWaitableTimer(timer, &due_time, 0, nullptr, nullptr, FALSE))
+            WaitForSingleObject(timer, INFINITE);
+        else
+            std::this_thread::sleep_until(sleep_deadline);
+#elif defined(__linux__)
+        // steady_clock is CLOCK_MONOTONIC, so the deadline can be used as an absolute time
+        const auto since_epoch = duration_cast<nanoseconds>(sleep_deadline.time_since_epoch()).count();
+        timespec ts{
+            .tv_sec = static_cast<time_t>(since_epoch / 1000000000),
+            .tv_nsec = static_cast<long>(since_epoch % 1000000000)
+        };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+#else
+        std::this_thread::sleep_until(sleep_deadline);
+#endif
+    }
+
+    while (steady_clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+} // namespace thread_utils
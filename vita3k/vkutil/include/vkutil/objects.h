@@ -17,12 +17,18 @@
 
 #pragma once
 
+#include <util/alloc_tracker.h>
 #include <util/bit_cast.h>
 #include <vkutil/vkutil.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace vkutil {
 
 void init(vma::Allocator vma_allocator);
+// attribute the memory of the allocation to the subsystem, it is untracked when the buffer or image is destroyed
+void track_allocation(alloc_tracker::Subsystem subsystem, vma::Allocation allocation);
 
 struct Image {
     vma::Allocation allocation;
@@ -50,7 +56,7 @@ struct Image {
     Image(const Image &) = delete;
     Image &operator=(Image const &) = delete;
 
-    void init_image(vk::ImageUsageFlags usage, vk::ComponentMapping mapping = default_comp_mapping, const vk::ImageCreateFlags image_create_flags = vk::ImageCreateFlags(), const void *pNext = nullptr);
+    void init_image(vk::ImageUsageFlags usage, vk::ComponentMapping mapping = default_comp_mapping, const vk::ImageCreateFlags image_create_flags = vk::ImageCreateFlags(), const void *pNext = nullptr, const vma::AllocationCreateInfo &alloc_info = vma_auto_alloc);
     // called by ~Image
     void destroy();
 
@@ -88,24 +94,44 @@ struct Buffer {
 
 // structure that holds contiguous data
 // if the end is reached, it starts back at the beginning
+// a growable ring buffer chains another buffer instead when the data at the beginning may still be read by the GPU
 class RingBuffer {
 protected:
-    vkutil::Buffer buffer;
+    // the ring goes through the buffers in order, the one after the current buffer holds the oldest data
+    std::vector<vkutil::Buffer> buffers;
+    uint32_t current_buffer = 0;
     vk::BufferUsageFlags usage;
 
     uint32_t cursor = ~0;
     uint32_t capacity;
+    uint32_t buffer_capacity;
+
+    // bytes used during each of the frames which may still be rendering, the last one is the current frame
+    std::vector<uint64_t> frame_usage;
+    uint64_t in_flight_usage = 0;
+    uint64_t high_water_mark = 0;
+    // number of frames in a row for which all the buffers but one were not needed
+    uint32_t low_usage_frames = 0;
+
+    virtual void init_buffer(vkutil::Buffer &buffer) = 0;
+    // go to the next buffer of the ring, inserting a new one if it may still be in use
+    void next_buffer(const uint32_t data_size);
 
 public:
     // any buffer alignment on vulkan is at most 256 on 99% of instances
     uint32_t alignment = 256;
     uint32_t data_offset = 0;
+    // can only be set if the handle is read again after each allocation
+    bool can_grow = false;
 
-    explicit RingBuffer(vk::BufferUsageFlags usage, const size_t capacity);
-    virtual void create() = 0;
+    explicit RingBuffer(vk::BufferUsageFlags usage, const size_t capacity, const uint32_t frames_in_flight);
+    void create();
 
     // Allocate new data from ring buffer
     void allocate(const uint32_t data_size);
+    // must be called once the oldest frame which may still be rendering is done, the extra buffers
+    // are given back once the usage stays low
+    void new_frame();
     // copy the content to the framebuffer
     // cmd_buffer may not be used
     virtual void copy(vk::CommandBuffer cmd_buffer, const uint32_t size, const void *data, const uint32_t offset = 0) = 0;
@@ -117,7 +143,15 @@ public:
     }
 
     vk::Buffer handle() const {
-        return buffer.buffer;
+        return buffers[current_buffer].buffer;
+    }
+
+    // largest amount of data used by the frames rendering at the same time
+    uint64_t get_high_water_mark() const {
+        return std::max(high_water_mark, in_flight_usage);
+    }
+    uint64_t get_capacity() const {
+        return static_cast<uint64_t>(capacity) * buffers.size();
     }
 };
 
@@ -125,11 +159,13 @@ public:
 // updates are done with updateBuffer, so each data chunk should be small
 // this is used for our uniform buffers
 class LocalRingBuffer : public RingBuffer {
+protected:
+    void init_buffer(vkutil::Buffer &buffer) override;
+
 public:
-    explicit LocalRingBuffer(vk::BufferUsageFlags usage, const size_t capacity)
-        : RingBuffer(usage, capacity) {
+    explicit LocalRingBuffer(vk::BufferUsageFlags usage, const size_t capacity, const uint32_t frames_in_flight)
+        : RingBuffer(usage, capacity, frames_in_flight) {
     }
-    void create() override;
 
     void copy(vk::CommandBuffer cmd_buffer, const uint32_t size, const void *data, const uint32_t offset = 0) override;
 };
@@ -141,11 +177,12 @@ class HostRingBuffer : public RingBuffer {
 protected:
     bool is_coherent;
 
+    void init_buffer(vkutil::Buffer &buffer) override;
+
 public:
-    explicit HostRingBuffer(vk::BufferUsageFlags usage, const size_t capacity)
-        : RingBuffer(usage, capacity) {
+    explicit HostRingBuffer(vk::BufferUsageFlags usage, const size_t capacity, const uint32_t frames_in_flight)
+        : RingBuffer(usage, capacity, frames_in_flight) {
     }
-    void create() override;
 
     void copy(vk::CommandBuffer cmd_buffer, const uint32_t size, const void *data, const uint32_t offset = 0) override;
 };
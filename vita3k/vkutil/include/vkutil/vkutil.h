@@ -91,6 +91,12 @@ static constexpr vma::AllocationCreateInfo vma_mapped_alloc = {
     .usage = vma::MemoryUsage::eAuto,
 };
 
+// for transient attachments, the memory is only committed if the tile memory of the GPU is not enough
+static constexpr vma::AllocationCreateInfo vma_lazy_alloc = {
+    .usage = vma::MemoryUsage::eAuto,
+    .preferredFlags = vk::MemoryPropertyFlagBits::eLazilyAllocated,
+};
+
 static constexpr vma::AllocationCreateInfo vma_host_visible = {
     .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite,
     .usage = vma::MemoryUsage::eAuto,
@@ -103,6 +109,10 @@ void end_single_time_command(vk::Device device, vk::Queue queue, vk::CommandPool
 vk::ShaderModule load_shader(vk::Device device, const std::string &path);
 vk::ShaderModule load_shader(vk::Device device, const void *data, const uint32_t size);
 
+// create the image in the pool of alloc_info, it is allocated outside of the pool if the memory type of the pool
+// does not fit the image or if the image does not fit in a block of the pool
+std::pair<vk::Image, vma::Allocation> create_image(vma::Allocator allocator, const vk::ImageCreateInfo &image_info, const vma::AllocationCreateInfo &alloc_info);
+
 void copy_buffer(vk::Device device, vk::CommandPool cmd_pool, vk::Queue queue, vk::Buffer src, vk::Buffer dst, vk::DeviceSize size);
 
 enum struct ImageLayout {
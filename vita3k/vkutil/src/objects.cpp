@@ -23,6 +23,8 @@
 #include <util/bit_cast.h>
 #include <util/log.h>
 
+#include <algorithm>
+
 namespace vkutil {
 
 static vma::Allocator allocator = nullptr;
@@ -31,6 +33,14 @@ void init(vma::Allocator vma_allocator) {
     allocator = vma_allocator;
 }
 
+void track_allocation(alloc_tracker::Subsystem subsystem, vma::Allocation allocation) {
+    if (!alloc_tracker::enabled.load(std::memory_order_relaxed) || !allocation)
+        return;
+
+    const vma::AllocationInfo info = allocator.getAllocationInfo(allocation);
+    alloc_tracker::track(subsystem, std::bit_cast<void *>(allocation), info.size);
+}
+
 Image::Image() = default;
 
 Image::Image(Image &&other) noexcept {
@@ -69,6 +79,7 @@ void Image::destroy() {
         view = nullptr;
     }
     if (image) {
+        TRACK_HOST_FREE(std::bit_cast<void *>(allocation));
         allocator.destroyImage(image, allocation);
         image = nullptr;
     }
@@ -78,7 +89,7 @@ Image::~Image() {
     destroy();
 }
 
-void Image::init_image(vk::ImageUsageFlags usage, vk::ComponentMapping mapping, const vk::ImageCreateFlags image_create_flags, const void *pNext) {
+void Image::init_image(vk::ImageUsageFlags usage, vk::ComponentMapping mapping, const vk::ImageCreateFlags image_create_flags, const void *pNext, const vma::AllocationCreateInfo &alloc_info) {
     vk::ImageCreateInfo image_info{
         .pNext = pNext,
         .flags = image_create_flags,
@@ -97,7 +108,7 @@ void Image::init_image(vk::ImageUsageFlags usage, vk::ComponentMapping mapping,
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    std::tie(image, allocation) = allocator.createImage(image_info, vma_auto_alloc);
+    std::tie(image, allocation) = create_image(allocator, image_info, alloc_info);
 
     // only create a view if one of these flags is set
     constexpr vk::ImageUsageFlags view_usages = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eStorage;
@@ -152,6 +163,7 @@ void Buffer::destroy() {
         return;
 
     if (buffer) {
+        TRACK_HOST_FREE(std::bit_cast<void *>(allocation));
         allocator.destroyBuffer(buffer, allocation);
         buffer = nullptr;
     }
@@ -172,10 +184,11 @@ void Buffer::init_buffer(vk::BufferUsageFlags usage_flags, const vma::Allocation
     mapped_data = alloc_info.pMappedData;
 }
 
-RingBuffer::RingBuffer(vk::BufferUsageFlags usage, const size_t capacity)
+RingBuffer::RingBuffer(vk::BufferUsageFlags usage, const size_t capacity, const uint32_t frames_in_flight)
     : usage(usage)
-    , capacity(capacity) {
-    uint32_t buffer_capacity = capacity;
+    , capacity(capacity)
+    , frame_usage(frames_in_flight, 0) {
+    buffer_capacity = capacity;
     if (usage & vk::BufferUsageFlagBits::eStorageBuffer)
         // TODO: put max size of a gxm uniform buffer
         buffer_capacity += 500 * 1024;
@@ -186,46 +199,104 @@ RingBuffer::RingBuffer(vk::BufferUsageFlags usage, const size_t capacity)
         // the descriptor set for the uniform buffers specify the max possible size while we only allocate
         // the actual size, this prevents validation errors
         buffer_capacity += 512;
+}
 
-    buffer = Buffer(buffer_capacity);
+void RingBuffer::create() {
+    buffers.emplace_back(buffer_capacity);
+    init_buffer(buffers.back());
+    current_buffer = 0;
+    cursor = 0;
+}
+
+void RingBuffer::next_buffer(const uint32_t data_size) {
+    // going through the whole ring would overwrite data of a frame still rendering
+    if (can_grow && in_flight_usage + data_size > get_capacity()) {
+        Buffer buffer(buffer_capacity);
+        init_buffer(buffer);
+        buffers.insert(buffers.begin() + current_buffer + 1, std::move(buffer));
+        LOG_INFO("Ring buffer grown to {} MiB, {} MiB used by the frames rendering", get_capacity() >> 20, in_flight_usage >> 20);
+    }
+
+    current_buffer = (current_buffer + 1) % buffers.size();
 }
 
 void RingBuffer::allocate(const uint32_t data_size) {
-    if (cursor + data_size > capacity)
-        cursor = 0;
+    uint32_t start = cursor;
+    if (cursor + data_size > capacity) {
+        // the end of the buffer is skipped
+        const uint32_t skipped = (capacity > cursor) ? capacity - cursor : 0;
+        frame_usage.back() += skipped;
+        in_flight_usage += skipped;
+
+        next_buffer(data_size);
+        start = 0;
+    }
 
-    data_offset = cursor;
+    data_offset = start;
 
-    cursor += data_size;
+    cursor = start + data_size;
 
     cursor = align(cursor, alignment);
+
+    frame_usage.back() += cursor - start;
+    in_flight_usage += cursor - start;
 }
 
-void HostRingBuffer::create() {
+void RingBuffer::new_frame() {
+    high_water_mark = std::max(high_water_mark, in_flight_usage);
+
+    // the oldest frame is done
+    in_flight_usage -= frame_usage.front();
+    std::rotate(frame_usage.begin(), frame_usage.begin() + 1, frame_usage.end());
+    frame_usage.back() = 0;
+
+    if (buffers.size() <= 1)
+        return;
+
+    // give a buffer back after some time below half of the capacity without it
+    constexpr uint32_t reclaim_delay = 600;
+    if (in_flight_usage * 2 > get_capacity() - capacity) {
+        low_usage_frames = 0;
+        return;
+    }
+    low_usage_frames++;
+    // the next buffer can only be removed if it holds no data of a frame still rendering
+    if (low_usage_frames < reclaim_delay || in_flight_usage > cursor)
+        return;
+
+    const uint32_t next = (current_buffer + 1) % buffers.size();
+    // a moved buffer is not destroyed when overwritten
+    buffers[next].destroy();
+    buffers.erase(buffers.begin() + next);
+    if (next < current_buffer)
+        current_buffer--;
+    low_usage_frames = 0;
+    LOG_INFO("Ring buffer shrunk to {} MiB", get_capacity() >> 20);
+}
+
+void HostRingBuffer::init_buffer(vkutil::Buffer &buffer) {
     buffer.init_buffer(usage, vma_mapped_alloc);
 
     vk::MemoryPropertyFlags memory_properties = allocator.getAllocationMemoryProperties(buffer.allocation);
     is_coherent = static_cast<bool>(memory_properties & vk::MemoryPropertyFlagBits::eHostCoherent);
-
-    cursor = 0;
 }
 
 void HostRingBuffer::copy(vk::CommandBuffer cmd_buffer, const uint32_t size, const void *data, const uint32_t offset) {
+    const Buffer &buffer = buffers[current_buffer];
     memcpy(reinterpret_cast<uint8_t *>(buffer.mapped_data) + data_offset + offset, data, size);
 
     if (!is_coherent)
         allocator.flushAllocation(buffer.allocation, data_offset + offset, size);
 }
 
-void LocalRingBuffer::create() {
+void LocalRingBuffer::init_buffer(vkutil::Buffer &buffer) {
     // the auto_alloc default behavior should give us memory on the gpu
     // UpdateBuffer needs the buffer to have TransferDst specified
     buffer.init_buffer(usage | vk::BufferUsageFlagBits::eTransferDst);
-    cursor = 0;
 }
 
 void LocalRingBuffer::copy(vk::CommandBuffer cmd_buffer, const uint32_t size, const void *data, const uint32_t offset) {
-    cmd_buffer.updateBuffer(buffer.buffer, data_offset + offset, size, data);
+    cmd_buffer.updateBuffer(buffers[current_buffer].buffer, data_offset + offset, size, data);
 }
 
 void DestroyQueue::init(vk::Device device) {
@@ -284,6 +355,7 @@ void DestroyQueue::destroy_objects() {
             // special case: this is a vma allocation
             auto image = std::bit_cast<vk::Image>(el);
             auto allocation = std::bit_cast<vma::Allocation>(destroy_list[idx++]);
+            TRACK_HOST_FREE(std::bit_cast<void *>(allocation));
             allocator.destroyImage(image, allocation);
             break;
         }
@@ -292,6 +364,7 @@ void DestroyQueue::destroy_objects() {
             // special case: this is a vma allocation
             auto buffer = std::bit_cast<vk::Buffer>(el);
             auto allocation = std::bit_cast<vma::Allocation>(destroy_list[idx++]);
+            TRACK_HOST_FREE(std::bit_cast<void *>(allocation));
             allocator.destroyBuffer(buffer, allocation);
             break;
         }
@@ -50,6 +50,19 @@ void end_single_time_command(vk::Device device, vk::Queue queue, vk::CommandPool
     device.freeCommandBuffers(cmd_pool, cmd_buffer);
 }
 
+std::pair<vk::Image, vma::Allocation> create_image(vma::Allocator allocator, const vk::ImageCreateInfo &image_info, const vma::AllocationCreateInfo &alloc_info) {
+    if (!alloc_info.pool)
+        return allocator.createImage(image_info, alloc_info);
+
+    try {
+        return allocator.createImage(image_info, alloc_info);
+    } catch (vk::SystemError &) {
+        vma::AllocationCreateInfo fallback_info = alloc_info;
+        fallback_info.pool = nullptr;
+        return allocator.createImage(image_info, fallback_info);
+    }
+}
+
 vk::ShaderModule load_shader(vk::Device device, const std::string &path) {
     const auto shader_path = fs::path(path);
     fs::ifstream is(shader_path, fs::ifstream::binary);